@@ -16,6 +16,8 @@
 
 
 
+import array
+import threading
 import unittest
 import pywraps2 as s2
 
@@ -463,5 +465,53 @@ class PyWrapS2TestCase(unittest.TestCase):
     self.assertEqual(1234, i)
     self.assertEqual(5678, j)
 
+  def testCellIdBatchFunctions(self):
+    lat = array.array("d", [51.5001525, -33.8688])
+    lng = array.array("d", [-0.1262355, 151.2093])
+    ids = array.array("Q", [0, 0])
+    s2.CellIdsFromLatLngDegrees(lat, lng, ids)
+    for i in range(2):
+      expected = s2.S2CellId(s2.S2LatLng.FromDegrees(lat[i], lng[i]))
+      self.assertEqual(expected.id(), ids[i])
+
+    parents = array.array("Q", [0, 0])
+    s2.CellIdsParent(ids, 10, parents)
+    self.assertEqual(s2.S2CellId(ids[0]).parent(10).id(), parents[0])
+    tokens = s2.CellIdsToTokens(parents)
+    self.assertEqual(s2.S2CellId(parents[1]).ToToken(), tokens[1])
+    from_tokens = array.array("Q", [0, 0])
+    s2.CellIdsFromTokens(tokens, from_tokens)
+    self.assertEqual(parents, from_tokens)
+
+    with self.assertRaises(ValueError):
+      s2.CellIdsParent(ids, 10, array.array("Q", [0]))
+    with self.assertRaises(TypeError):
+      s2.CellIdsFromLatLngDegrees(lat, lng, array.array("d", [0, 0]))
+
+  def testS2PolygonContainsLatLngDegrees(self):
+    cell = s2.S2Cell(s2.S2CellId(s2.S2LatLng.FromDegrees(3.0, 4.0)).parent(8))
+    polygon = s2.S2Polygon(cell)
+    center = cell.id().ToLatLng()
+    lat = array.array("d", [center.lat().degrees(), -3.0])
+    lng = array.array("d", [center.lng().degrees(), -4.0])
+    contains = array.array("B", [2, 2])
+    polygon.ContainsLatLngDegrees(lat, lng, contains)
+    self.assertEqual([1, 0], list(contains))
+
+  def testS2PolygonInitToUnionFromThreads(self):
+    london = s2.S2CellId(s2.S2LatLng.FromDegrees(51.5001525, -0.1262355))
+    a = s2.S2Polygon(s2.S2Cell(london.parent(10)))
+    b = s2.S2Polygon(s2.S2Cell(london.parent(10).next()))
+    results = [s2.S2Polygon() for _ in range(4)]
+    threads = [threading.Thread(target=r.InitToUnion, args=(a, b))
+               for r in results]
+    for thread in threads:
+      thread.start()
+    for thread in threads:
+      thread.join()
+    for result in results:
+      self.assertTrue(result.Contains(a))
+      self.assertTrue(result.Contains(b))
+
 if __name__ == "__main__":
   unittest.main()
@@ -4,7 +4,10 @@
 // open source releases of s2.
 
 %{
+#include <cstring>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "s2/s2cell_id.h"
 #include "s2/s2region.h"
@@ -22,6 +25,31 @@
 #include "s2/s2cell_union.h"
 %}
 
+// The module is built with thread support (-threads), but the GIL is only
+// released by the potentially expensive methods listed below, since
+// releasing and reacquiring it costs more than most accessors take to run.
+// These methods do not call back into Python.  Geometry objects such as
+// S2Loop and S2Polygon build their spatial indexes lazily in a thread-safe
+// way, so they can be used concurrently from several Python threads as
+// long as no thread modifies them.  S2RegionCoverer keeps state while
+// computing a covering, so each thread should use its own coverer.
+%nothread;
+%thread S2Loop::Contains(S2Loop const *) const;
+%thread S2Loop::Intersects(S2Loop const *) const;
+%thread S2Loop::IsValid() const;
+%thread S2Polygon::Contains(S2Polygon const *) const;
+%thread S2Polygon::Intersects(S2Polygon const *) const;
+%thread S2Polygon::InitNested;
+%thread S2Polygon::InitToDifference(S2Polygon const *, S2Polygon const *);
+%thread S2Polygon::InitToIntersection(S2Polygon const *, S2Polygon const *);
+%thread S2Polygon::InitToUnion(S2Polygon const *, S2Polygon const *);
+%thread S2Polygon::IntersectWithPolyline;
+%thread S2Polygon::IsValid() const;
+%thread S2RegionCoverer::GetCovering(S2Region const &,
+                                     std::vector<S2CellId> *);
+%thread S2RegionCoverer::GetInteriorCovering(S2Region const &,
+                                             std::vector<S2CellId> *);
+
 %inline %{
   static PyObject *FromS2CellId(const S2CellId &cell_id) {
     return SWIG_NewPointerObj(new S2CellId(cell_id), SWIGTYPE_p_S2CellId,
@@ -29,6 +57,181 @@
   }
 %}
 
+// Batch functions that operate on whole arrays (e.g. NumPy arrays) at once.
+// Arrays are accepted through the Python buffer protocol, so any
+// C-contiguous object with the expected item type works: float64 for
+// coordinates, uint64 for cell ids, and uint8 or bool for flags.  Results
+// are written to caller-provided arrays of the same length, e.g.
+//
+//   ids = numpy.empty(len(lat), dtype=numpy.uint64)
+//   s2.CellIdsFromLatLngDegrees(lat, lng, ids)
+//
+// The loops run in C++ with the GIL released.
+%{
+namespace {
+
+// Owns a buffer obtained from a Python object and releases it on
+// destruction.
+class PyBufferView {
+ public:
+  PyBufferView() : ok_(false) {}
+  ~PyBufferView() { if (ok_) PyBuffer_Release(&view_); }
+
+  // Requests a C-contiguous buffer whose items have the given size and one
+  // of the given struct format codes.  Returns false with a Python
+  // exception set on failure.
+  bool Init(PyObject* obj, const char* name, const char* formats,
+            Py_ssize_t itemsize, bool writable) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if (writable) flags |= PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(obj, &view_, flags) != 0) return false;
+    ok_ = true;
+    const char* format = view_.format ? view_.format : "B";
+    if (*format == '<' || *format == '=' || *format == '@') ++format;
+    if (view_.itemsize != itemsize || format[0] == '\0' || format[1] != '\0' ||
+        strchr(formats, format[0]) == nullptr) {
+      PyErr_Format(PyExc_TypeError, "%s: unsupported array type '%s'",
+                   name, view_.format ? view_.format : "B");
+      return false;
+    }
+    return true;
+  }
+
+  Py_ssize_t size() const { return view_.len / view_.itemsize; }
+  template <class T> T* data() const { return static_cast<T*>(view_.buf); }
+
+ private:
+  Py_buffer view_;
+  bool ok_;
+};
+
+const char kDoubleFormats[] = "d";
+const char kUint64Formats[] = "QL";
+const char kBoolFormats[] = "B?";
+
+bool CheckSameSize(const PyBufferView& a, const PyBufferView& b) {
+  if (a.size() == b.size()) return true;
+  PyErr_SetString(PyExc_ValueError, "arrays must have the same length");
+  return false;
+}
+
+}  // namespace
+%}
+
+%inline %{
+  // Sets out[i] to the id of the leaf cell containing the point with the
+  // given latitude and longitude in degrees.
+  static PyObject *CellIdsFromLatLngDegrees(PyObject *lat, PyObject *lng,
+                                            PyObject *out) {
+    PyBufferView lat_view, lng_view, out_view;
+    if (!lat_view.Init(lat, "lat", kDoubleFormats, 8, false) ||
+        !lng_view.Init(lng, "lng", kDoubleFormats, 8, false) ||
+        !out_view.Init(out, "out", kUint64Formats, 8, true) ||
+        !CheckSameSize(lat_view, lng_view) ||
+        !CheckSameSize(lat_view, out_view)) {
+      return nullptr;
+    }
+    const double* lat_data = lat_view.data<double>();
+    const double* lng_data = lng_view.data<double>();
+    uint64* out_data = out_view.data<uint64>();
+    Py_ssize_t n = lat_view.size();
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      out_data[i] =
+          S2CellId(S2LatLng::FromDegrees(lat_data[i], lng_data[i])).id();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets out[i] to the id of the ancestor of ids[i] at the given level.
+  // Invalid ids and ids whose level is less than "level" yield 0 (the
+  // S2CellId::None() id).
+  static PyObject *CellIdsParent(PyObject *ids, int level, PyObject *out) {
+    if (level < 0 || level > S2CellId::kMaxLevel) {
+      PyErr_SetString(PyExc_ValueError, "level must be in [0, 30]");
+      return nullptr;
+    }
+    PyBufferView ids_view, out_view;
+    if (!ids_view.Init(ids, "ids", kUint64Formats, 8, false) ||
+        !out_view.Init(out, "out", kUint64Formats, 8, true) ||
+        !CheckSameSize(ids_view, out_view)) {
+      return nullptr;
+    }
+    const uint64* ids_data = ids_view.data<uint64>();
+    uint64* out_data = out_view.data<uint64>();
+    Py_ssize_t n = ids_view.size();
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      S2CellId id(ids_data[i]);
+      out_data[i] = (id.is_valid() && id.level() >= level) ?
+                    id.parent(level).id() : 0;
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Returns a list containing the token of each cell id.
+  static PyObject *CellIdsToTokens(PyObject *ids) {
+    PyBufferView ids_view;
+    if (!ids_view.Init(ids, "ids", kUint64Formats, 8, false)) return nullptr;
+    const uint64* ids_data = ids_view.data<uint64>();
+    Py_ssize_t n = ids_view.size();
+    std::vector<std::string> tokens(n);
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      tokens[i] = S2CellId(ids_data[i]).ToToken();
+    }
+    Py_END_ALLOW_THREADS
+    PyObject *result = PyList_New(n);
+    if (result == nullptr) return nullptr;
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      PyObject *const o = PyUnicode_FromStringAndSize(tokens[i].data(),
+                                                      tokens[i].size());
+      if (!o) {
+        Py_DECREF(result);
+        return nullptr;
+      }
+      PyList_SET_ITEM(result, i, o);
+    }
+    return result;
+  }
+
+  // Sets out[i] to the cell id represented by tokens[i], where "tokens" is
+  // a sequence of strings.  Malformed tokens yield 0.
+  static PyObject *CellIdsFromTokens(PyObject *tokens, PyObject *out) {
+    PyBufferView out_view;
+    if (!out_view.Init(out, "out", kUint64Formats, 8, true)) return nullptr;
+    PyObject *seq = PySequence_Fast(tokens, "tokens must be a sequence");
+    if (seq == nullptr) return nullptr;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    if (n != out_view.size()) {
+      Py_DECREF(seq);
+      PyErr_SetString(PyExc_ValueError, "arrays must have the same length");
+      return nullptr;
+    }
+    std::vector<std::string> strings(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      Py_ssize_t size;
+      const char *data = PyUnicode_AsUTF8AndSize(
+          PySequence_Fast_GET_ITEM(seq, i), &size);
+      if (data == nullptr) {
+        Py_DECREF(seq);
+        return nullptr;
+      }
+      strings[i].assign(data, size);
+    }
+    Py_DECREF(seq);
+    uint64* out_data = out_view.data<uint64>();
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      out_data[i] = S2CellId::FromToken(strings[i]).id();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+%}
+
 %apply std::vector<S2CellId> *OUTPUT {std::vector<S2CellId> *covering};
 %apply std::vector<S2CellId> *OUTPUT {std::vector<S2CellId> *interior};
 %apply std::vector<S2CellId> *OUTPUT {std::vector<S2CellId> *output};
@@ -186,6 +389,31 @@ class S2Point {
       out->push_back(polyline.release());
     }
   }
+
+  // Sets out[i] to whether the polygon contains the point with latitude
+  // lat[i] and longitude lng[i] in degrees (see CellIdsFromLatLngDegrees).
+  PyObject *ContainsLatLngDegrees(PyObject *lat, PyObject *lng,
+                                  PyObject *out) const {
+    PyBufferView lat_view, lng_view, out_view;
+    if (!lat_view.Init(lat, "lat", kDoubleFormats, 8, false) ||
+        !lng_view.Init(lng, "lng", kDoubleFormats, 8, false) ||
+        !out_view.Init(out, "out", kBoolFormats, 1, true) ||
+        !CheckSameSize(lat_view, lng_view) ||
+        !CheckSameSize(lat_view, out_view)) {
+      return nullptr;
+    }
+    const double* lat_data = lat_view.data<double>();
+    const double* lng_data = lng_view.data<double>();
+    uint8* out_data = out_view.data<uint8>();
+    Py_ssize_t n = lat_view.size();
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      out_data[i] = $self->Contains(
+          S2LatLng::FromDegrees(lat_data[i], lng_data[i]).ToPoint());
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
 }
 
 // Expose Options functions on S2RegionCoverer until we figure out
@@ -432,6 +660,7 @@ class S2Point {
 %unignore S2Polygon::~S2Polygon;
 %unignore S2Polygon::Clone;
 %unignore S2Polygon::Contains;
+%unignore S2Polygon::ContainsLatLngDegrees;
 %unignore S2Polygon::Copy;
 %unignore S2Polygon::Decode;
 %unignore S2Polygon::Encode;
@@ -443,6 +672,9 @@ class S2Point {
 %unignore S2Polygon::GetRectBound;
 %unignore S2Polygon::Init;
 %unignore S2Polygon::InitNested;
+%unignore S2Polygon::InitToDifference(const S2Polygon*, const S2Polygon*);
+%unignore S2Polygon::InitToIntersection(const S2Polygon*, const S2Polygon*);
+%unignore S2Polygon::InitToUnion(const S2Polygon*, const S2Polygon*);
 %unignore S2Polygon::Intersects;
 %unignore S2Polygon::IntersectWithPolyline;
 %unignore S2Polygon::IsValid;
@@ -28,6 +28,11 @@ class CycleTimer {
     start_ = Now();
   }
 
+  // Returns the elapsed time in seconds.
+  double Get() const {
+    return std::chrono::duration<double>(GetDuration()).count();
+  }
+
   int64 GetInMs() const {
     using msec = std::chrono::milliseconds;
     return std::chrono::duration_cast<msec>(GetDuration()).count();
@@ -0,0 +1,138 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/compact_s2shape_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "s2/base/casts.h"
+#include "s2/base/logging.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+bool CompactS2ShapeIndex::Iterator::Locate(const S2Point& target) {
+  return LocateImpl(target, this);
+}
+
+CompactS2ShapeIndex::CellRelation CompactS2ShapeIndex::Iterator::Locate(
+    S2CellId target) {
+  return LocateImpl(target, this);
+}
+
+void CompactS2ShapeIndex::Iterator::Seek(S2CellId target) {
+  const vector<S2CellId>& ids = index_->cell_ids_;
+  cell_pos_ = std::lower_bound(ids.begin(), ids.end(), target) - ids.begin();
+  Refresh();
+}
+
+const S2ShapeIndexCell* CompactS2ShapeIndex::Iterator::GetCell() const {
+  // Since set_state() is always called with a non-null cell, this method is
+  // never called.
+  S2_LOG(DFATAL) << "Should never be called";
+  return nullptr;
+}
+
+unique_ptr<CompactS2ShapeIndex::IteratorBase>
+CompactS2ShapeIndex::Iterator::Clone() const {
+  return make_unique<Iterator>(*this);
+}
+
+void CompactS2ShapeIndex::Iterator::Copy(const IteratorBase& other)  {
+  *this = *down_cast<const Iterator*>(&other);
+}
+
+CompactS2ShapeIndex::CompactS2ShapeIndex() {
+}
+
+CompactS2ShapeIndex::CompactS2ShapeIndex(MutableS2ShapeIndex* index) {
+  Init(index);
+}
+
+CompactS2ShapeIndex::~CompactS2ShapeIndex() {
+  Clear();
+}
+
+void CompactS2ShapeIndex::Init(MutableS2ShapeIndex* index) {
+  Clear();
+  index->ForceBuild();
+
+  // The first pass counts the cells and the edge ids that are not stored
+  // inline, so that each array can be allocated exactly once.
+  int num_cells = 0;
+  size_t num_edges = 0;
+  MutableS2ShapeIndex::Iterator it;
+  for (it.Init(index, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
+    const S2ShapeIndexCell& cell = it.cell();
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      if (!clipped.is_inline()) num_edges += clipped.num_edges();
+    }
+    ++num_cells;
+  }
+  cell_ids_.reserve(num_cells);
+  cells_.reset(new S2ShapeIndexCell[num_cells]);
+  edges_.resize(num_edges);
+
+  // The second pass copies the clipped shapes.  Edge ids that are not stored
+  // inline are moved into "edges_", which is never resized afterwards.
+  int32* next_edge = edges_.data();
+  for (it.Begin(); !it.done(); it.Next()) {
+    const S2ShapeIndexCell& cell = it.cell();
+    S2ShapeIndexCell* new_cell = &cells_[cell_ids_.size()];
+    cell_ids_.push_back(it.id());
+    if (cell.num_clipped() == 0) continue;
+    S2ClippedShape* new_clipped = new_cell->add_shapes(cell.num_clipped());
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      new_clipped[s] = clipped;
+      if (!clipped.is_inline()) {
+        std::copy(clipped.edges_, clipped.edges_ + clipped.num_edges(),
+                  next_edge);
+        new_clipped[s].edges_ = next_edge;
+        next_edge += clipped.num_edges();
+      }
+    }
+  }
+  S2_DCHECK(next_edge == edges_.data() + edges_.size());
+  shapes_ = index->ReleaseAll();
+}
+
+void CompactS2ShapeIndex::Clear() {
+  // The edge ids are owned by "edges_" rather than by the individual clipped
+  // shapes, so the clipped shapes are removed before the cells are destroyed
+  // (which would otherwise call S2ClippedShape::Destruct).
+  for (int i = 0; i < num_cells(); ++i) {
+    cells_[i].clear_shapes();
+  }
+  cells_.reset();
+  cell_ids_.clear();
+  edges_.clear();
+  shapes_.clear();
+}
+
+size_t CompactS2ShapeIndex::SpaceUsed() const {
+  size_t size = sizeof(*this);
+  size += shapes_.capacity() * sizeof(unique_ptr<S2Shape>);
+  size += cell_ids_.capacity() * sizeof(S2CellId);
+  size += cell_ids_.size() * sizeof(S2ShapeIndexCell);
+  for (int i = 0; i < num_cells(); ++i) {
+    size += cells_[i].num_clipped() * sizeof(S2ClippedShape);
+  }
+  size += edges_.capacity() * sizeof(int32);
+  return size;
+}
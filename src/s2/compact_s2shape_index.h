@@ -0,0 +1,218 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_COMPACT_S2SHAPE_INDEX_H_
+#define S2_COMPACT_S2SHAPE_INDEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+// CompactS2ShapeIndex is a read-only S2ShapeIndex that stores the cells of a
+// fully built MutableS2ShapeIndex in contiguous arrays.  MutableS2ShapeIndex
+// keeps its cells in a btree_map, with each S2ShapeIndexCell and each list of
+// more than two edge ids allocated separately, which roughly doubles the
+// memory used by indexes with many cells.  Here the cell ids, the cells, and
+// all edge ids are each stored in a single array, so the only per-cell
+// allocation that remains is the small array of clipped shapes owned by each
+// S2ShapeIndexCell.
+//
+// The index is initialized by taking over a MutableS2ShapeIndex once no
+// further updates are expected, e.g.:
+//
+//   MutableS2ShapeIndex builder;
+//   for (auto& shape : shapes) builder.Add(std::move(shape));
+//   CompactS2ShapeIndex index(&builder);  // "builder" is now empty.
+//   auto query = MakeS2ContainsPointQuery(&index);
+//
+// Shape ids are preserved, and the index contents (and therefore the results
+// of all queries) are exactly the same as for the original index.  Iterators
+// have the same semantics as MutableS2ShapeIndex::Iterator.
+//
+// Like other S2ShapeIndex types, all const methods are thread-safe.
+class CompactS2ShapeIndex final : public S2ShapeIndex {
+ public:
+  // Creates an empty index, which may be initialized by calling Init().
+  CompactS2ShapeIndex();
+
+  // Convenience constructor that calls Init().
+  explicit CompactS2ShapeIndex(MutableS2ShapeIndex* index);
+
+  ~CompactS2ShapeIndex() override;
+
+  // Initializes the index from the given MutableS2ShapeIndex, applying any
+  // pending updates first.  Takes ownership of all of its shapes, leaving
+  // "index" empty (as though ReleaseAll() had been called).  Any existing
+  // contents of this index are discarded.
+  void Init(MutableS2ShapeIndex* index);
+
+  // The number of distinct shape ids in the index.  This equals the number of
+  // shapes in the index provided that no shapes were ever removed from the
+  // MutableS2ShapeIndex.  (Shape ids are not reused.)
+  int num_shape_ids() const override {
+    return static_cast<int>(shapes_.size());
+  }
+
+  // Returns a pointer to the shape with the given id, or nullptr if the shape
+  // was removed from the MutableS2ShapeIndex.
+  S2Shape* shape(int id) const override { return shapes_[id].get(); }
+
+  // Returns the number of index cells.
+  int num_cells() const { return static_cast<int>(cell_ids_.size()); }
+
+  // Does nothing, since all cell data is required by the index.
+  void Minimize() override {}
+
+  // Returns the number of bytes currently occupied by the index (not
+  // including the shapes).
+  size_t SpaceUsed() const override;
+
+  // The possible relationships between a "target" cell and the cells of the
+  // index are the same as for other S2ShapeIndex types.
+  class Iterator final : public IteratorBase {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator();
+
+    // Constructs an iterator positioned as specified.  By default iterators
+    // are unpositioned, since this avoids an extra seek in this situation
+    // where one of the seek methods (such as Locate) is immediately called.
+    explicit Iterator(const CompactS2ShapeIndex* index,
+                      InitialPosition pos = UNPOSITIONED);
+
+    // Initializes an iterator for the given CompactS2ShapeIndex.
+    void Init(const CompactS2ShapeIndex* index,
+              InitialPosition pos = UNPOSITIONED);
+
+    // Inherited non-virtual methods:
+    //   S2CellId id() const;
+    //   bool done() const;
+    //   S2Point center() const;
+    const S2ShapeIndexCell& cell() const;
+
+    // IteratorBase API:
+    void Begin() override;
+    void Finish() override;
+    void Next() override;
+    bool Prev() override;
+    void Seek(S2CellId target) override;
+    bool Locate(const S2Point& target) override;
+    CellRelation Locate(S2CellId target) override;
+
+   protected:
+    const S2ShapeIndexCell* GetCell() const override;
+    std::unique_ptr<IteratorBase> Clone() const override;
+    void Copy(const IteratorBase& other) override;
+
+   private:
+    void Refresh();  // Updates the IteratorBase fields.
+    const CompactS2ShapeIndex* index_;
+    int cell_pos_;   // Index of current cell in cell_ids_
+    int num_cells_;  // Number of cells
+  };
+
+ protected:
+  std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
+
+ private:
+  friend class Iterator;
+
+  // Deletes all cells and shapes.
+  void Clear();
+
+  std::vector<std::unique_ptr<S2Shape>> shapes_;
+
+  // The cell ids in increasing order, and the corresponding cells.
+  std::vector<S2CellId> cell_ids_;
+  std::unique_ptr<S2ShapeIndexCell[]> cells_;
+
+  // The edge ids of all clipped shapes that do not store them inline.  The
+  // clipped shapes point into this array, so it must not be resized.
+  std::vector<int32> edges_;
+
+  CompactS2ShapeIndex(const CompactS2ShapeIndex&) = delete;
+  void operator=(const CompactS2ShapeIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline CompactS2ShapeIndex::Iterator::Iterator() : index_(nullptr) {
+}
+
+inline CompactS2ShapeIndex::Iterator::Iterator(
+    const CompactS2ShapeIndex* index, InitialPosition pos) {
+  Init(index, pos);
+}
+
+inline void CompactS2ShapeIndex::Iterator::Init(
+    const CompactS2ShapeIndex* index, InitialPosition pos) {
+  index_ = index;
+  num_cells_ = index->num_cells();
+  cell_pos_ = (pos == BEGIN) ? 0 : num_cells_;
+  Refresh();
+}
+
+inline const S2ShapeIndexCell& CompactS2ShapeIndex::Iterator::cell() const {
+  // The "cell_" field is always set, so we can skip the logic in the base
+  // class that conditionally calls GetCell().
+  return *raw_cell();
+}
+
+inline void CompactS2ShapeIndex::Iterator::Refresh() {
+  if (cell_pos_ == num_cells_) {
+    set_finished();
+  } else {
+    set_state(index_->cell_ids_[cell_pos_], &index_->cells_[cell_pos_]);
+  }
+}
+
+inline void CompactS2ShapeIndex::Iterator::Begin() {
+  cell_pos_ = 0;
+  Refresh();
+}
+
+inline void CompactS2ShapeIndex::Iterator::Finish() {
+  cell_pos_ = num_cells_;
+  Refresh();
+}
+
+inline void CompactS2ShapeIndex::Iterator::Next() {
+  S2_DCHECK(!done());
+  ++cell_pos_;
+  Refresh();
+}
+
+inline bool CompactS2ShapeIndex::Iterator::Prev() {
+  if (cell_pos_ == 0) return false;
+  --cell_pos_;
+  Refresh();
+  return true;
+}
+
+inline std::unique_ptr<CompactS2ShapeIndex::IteratorBase>
+CompactS2ShapeIndex::NewIterator(InitialPosition pos) const {
+  return absl::make_unique<Iterator>(this, pos);
+}
+
+#endif  // S2_COMPACT_S2SHAPE_INDEX_H_
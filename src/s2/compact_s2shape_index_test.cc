@@ -0,0 +1,139 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/compact_s2shape_index.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2polyline.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Adds a mix of polygons and polylines to "index", including loops with
+// enough edges that some clipped shapes do not store their edges inline.
+void AddShapes(MutableS2ShapeIndex* index) {
+  for (int i = 0; i < 10; ++i) {
+    S2Point center = S2Testing::RandomPoint();
+    index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        center, S2Testing::KmToAngle(S2Testing::rnd.UniformDouble(10, 1000)),
+        S2Testing::rnd.Uniform(200) + 3)));
+    vector<S2Point> vertices;
+    for (int j = 0; j < 20; ++j) vertices.push_back(S2Testing::RandomPoint());
+    index->Add(make_unique<S2Polyline::OwningShape>(
+        make_unique<S2Polyline>(vertices)));
+  }
+}
+
+TEST(CompactS2ShapeIndex, Empty) {
+  MutableS2ShapeIndex mutable_index;
+  CompactS2ShapeIndex index(&mutable_index);
+  EXPECT_EQ(0, index.num_shape_ids());
+  EXPECT_EQ(0, index.num_cells());
+  CompactS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  EXPECT_TRUE(it.done());
+  EXPECT_FALSE(it.Prev());
+  EXPECT_FALSE(it.Locate(S2Point(1, 0, 0)));
+}
+
+TEST(CompactS2ShapeIndex, SameContentsAsMutableIndex) {
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex expected, mutable_index;
+  AddShapes(&expected);
+  S2Testing::rnd.Reset(1);
+  AddShapes(&mutable_index);
+  mutable_index.ForceBuild();
+  size_t mutable_space = mutable_index.SpaceUsed();
+  CompactS2ShapeIndex index(&mutable_index);
+  EXPECT_EQ(0, mutable_index.num_shape_ids());
+  s2testing::ExpectEqual(expected, index);
+  EXPECT_LT(index.SpaceUsed(), mutable_space);
+
+  // Check that iterators behave identically.
+  MutableS2ShapeIndex::Iterator expected_it(&expected);
+  CompactS2ShapeIndex::Iterator it(&index);
+  for (int iter = 0; iter < 100; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId();
+    EXPECT_EQ(expected_it.Locate(id), it.Locate(id));
+    expected_it.Seek(id);
+    it.Seek(id);
+    ASSERT_EQ(expected_it.done(), it.done());
+    if (!it.done()) EXPECT_EQ(expected_it.id(), it.id());
+    ASSERT_EQ(expected_it.Prev(), it.Prev());
+    EXPECT_EQ(expected_it.id(), it.id());
+  }
+}
+
+TEST(CompactS2ShapeIndex, QueriesMatchMutableIndex) {
+  S2Testing::rnd.Reset(2);
+  MutableS2ShapeIndex expected, mutable_index;
+  AddShapes(&expected);
+  S2Testing::rnd.Reset(2);
+  AddShapes(&mutable_index);
+  CompactS2ShapeIndex index(&mutable_index);
+  auto expected_query = MakeS2ContainsPointQuery(&expected);
+  auto query = MakeS2ContainsPointQuery(&index);
+  S2ClosestEdgeQuery expected_closest(&expected), closest(&index);
+  for (int iter = 0; iter < 200; ++iter) {
+    S2Point p = S2Testing::RandomPoint();
+    vector<int> expected_ids, ids;
+    for (S2Shape* shape : expected_query.GetContainingShapes(p)) {
+      expected_ids.push_back(shape->id());
+    }
+    for (S2Shape* shape : query.GetContainingShapes(p)) {
+      ids.push_back(shape->id());
+    }
+    EXPECT_EQ(expected_ids, ids);
+    S2ClosestEdgeQuery::PointTarget target(p);
+    EXPECT_EQ(expected_closest.GetDistance(&target),
+              closest.GetDistance(&target));
+  }
+}
+
+TEST(CompactS2ShapeIndex, RemovedShapesArePreservedAsNull) {
+  MutableS2ShapeIndex mutable_index;
+  S2Point center(1, 0, 0);
+  mutable_index.Add(make_unique<S2Loop::OwningShape>(
+      S2Loop::MakeRegularLoop(center, S2Testing::KmToAngle(10), 20)));
+  mutable_index.Add(make_unique<S2Loop::OwningShape>(
+      S2Loop::MakeRegularLoop(center, S2Testing::KmToAngle(20), 20)));
+  mutable_index.Release(0);
+  CompactS2ShapeIndex index(&mutable_index);
+  ASSERT_EQ(2, index.num_shape_ids());
+  EXPECT_EQ(nullptr, index.shape(0));
+  ASSERT_NE(nullptr, index.shape(1));
+  EXPECT_EQ(1, index.shape(1)->id());
+  auto query = MakeS2ContainsPointQuery(&index);
+  EXPECT_TRUE(query.ShapeContains(*index.shape(1), center));
+
+  // Init() may be called again to replace the contents.
+  index.Init(&mutable_index);
+  EXPECT_EQ(0, index.num_shape_ids());
+}
+
+}  // namespace
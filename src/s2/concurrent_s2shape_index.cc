@@ -0,0 +1,136 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/concurrent_s2shape_index.h"
+
+#include <atomic>
+
+#include "s2/base/logging.h"
+#include "s2/s2edge_vector_shape.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// An S2Shape that forwards all calls to a shape that is shared between
+// several versions of the index.
+class SharedShape final : public S2Shape {
+ public:
+  explicit SharedShape(shared_ptr<S2Shape> shape) : shape_(std::move(shape)) {}
+
+  // S2Shape interface:
+  int num_edges() const override { return shape_->num_edges(); }
+  Edge edge(int e) const override { return shape_->edge(e); }
+  int dimension() const override { return shape_->dimension(); }
+  ReferencePoint GetReferencePoint() const override {
+    return shape_->GetReferencePoint();
+  }
+  int num_chains() const override { return shape_->num_chains(); }
+  Chain chain(int i) const override { return shape_->chain(i); }
+  Edge chain_edge(int i, int j) const override {
+    return shape_->chain_edge(i, j);
+  }
+  ChainPosition chain_position(int e) const override {
+    return shape_->chain_position(e);
+  }
+  TypeTag type_tag() const override { return shape_->type_tag(); }
+  const void* user_data() const override { return shape_->user_data(); }
+  void* mutable_user_data() override { return shape_->mutable_user_data(); }
+
+ private:
+  shared_ptr<S2Shape> shape_;
+};
+
+}  // namespace
+
+ConcurrentS2ShapeIndex::ConcurrentS2ShapeIndex()
+    : ConcurrentS2ShapeIndex(MutableS2ShapeIndex::Options()) {
+}
+
+ConcurrentS2ShapeIndex::ConcurrentS2ShapeIndex(
+    const MutableS2ShapeIndex::Options& options)
+    : options_(options),
+      published_(std::make_shared<MutableS2ShapeIndex>(options)),
+      spare_(std::make_shared<MutableS2ShapeIndex>(options)) {
+}
+
+ConcurrentS2ShapeIndex::~ConcurrentS2ShapeIndex() {
+}
+
+ConcurrentS2ShapeIndex::Snapshot ConcurrentS2ShapeIndex::snapshot() const {
+  return std::atomic_load(&published_);
+}
+
+int ConcurrentS2ShapeIndex::Add(unique_ptr<S2Shape> shape) {
+  const int id = shapes_.size();
+  shapes_.push_back(shared_ptr<S2Shape>(std::move(shape)));
+  pending_updates_.push_back(Update(id, shapes_.back()));
+  return id;
+}
+
+shared_ptr<S2Shape> ConcurrentS2ShapeIndex::Release(int shape_id) {
+  S2_DCHECK(shapes_[shape_id] != nullptr);
+  pending_updates_.push_back(Update(shape_id, nullptr));
+  return std::move(shapes_[shape_id]);
+}
+
+void ConcurrentS2ShapeIndex::Commit() {
+  // "spare_" can only be modified if no reader still holds a snapshot of it.
+  // Since it is no longer published, no new snapshots of it can be created.
+  if (spare_.use_count() == 1) {
+    // Ensure that all reads by the (former) readers of this version happen
+    // before our modifications.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    ApplyUpdates(unapplied_updates_, spare_.get());
+    ApplyUpdates(pending_updates_, spare_.get());
+  } else {
+    spare_ = BuildFromScratch();
+  }
+  spare_->ForceBuild();
+  spare_ = std::atomic_exchange(&published_, std::move(spare_));
+  unapplied_updates_.swap(pending_updates_);
+  pending_updates_.clear();
+}
+
+void ConcurrentS2ShapeIndex::ApplyUpdates(const vector<Update>& updates,
+                                          MutableS2ShapeIndex* index) const {
+  for (const Update& update : updates) {
+    if (update.added) {
+      int id = index->Add(make_unique<SharedShape>(update.added));
+      S2_DCHECK_EQ(update.shape_id, id);
+    } else {
+      index->Release(update.shape_id);
+    }
+  }
+}
+
+shared_ptr<MutableS2ShapeIndex>
+ConcurrentS2ShapeIndex::BuildFromScratch() const {
+  auto index = std::make_shared<MutableS2ShapeIndex>(options_);
+  for (const auto& shape : shapes_) {
+    if (shape) {
+      index->Add(make_unique<SharedShape>(shape));
+    } else {
+      // Removed shapes still occupy a shape id.  Since the index has not been
+      // built yet, releasing a shape immediately after adding it is cheap.
+      index->Release(index->Add(make_unique<S2EdgeVectorShape>()));
+    }
+  }
+  return index;
+}
@@ -0,0 +1,146 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_CONCURRENT_S2SHAPE_INDEX_H_
+#define S2_CONCURRENT_S2SHAPE_INDEX_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2shape.h"
+
+// ConcurrentS2ShapeIndex allows an index to be queried by many threads while
+// a single writer thread is updating it, without the readers ever waiting for
+// the index to be rebuilt.
+//
+// Readers call snapshot() to obtain an immutable, fully built version of the
+// index.  Updates made by the writer (Add and Release) do not affect any
+// existing snapshot; they become visible to subsequent snapshot() calls when
+// the writer calls Commit(), which builds the new version and then publishes
+// it with a single atomic pointer swap.  A snapshot remains valid (and its
+// shapes remain alive) for as long as the reader holds on to it.
+//
+// Internally two MutableS2ShapeIndex objects are used in a "double-buffered"
+// fashion: readers query the published version while Commit() applies the
+// pending updates incrementally to the other one.  If some reader still holds
+// a snapshot of that other version when Commit() is called, the new version
+// is instead built from scratch so that the writer never waits either.  The
+// shapes themselves are shared between the two versions, so the memory
+// overhead is roughly that of a second index (typically much smaller than the
+// geometry).
+//
+// Example usage:
+//
+//   ConcurrentS2ShapeIndex index;
+//
+//   // Writer thread:
+//   index.Add(absl::make_unique<S2Polygon::OwningShape>(...));
+//   index.Commit();
+//
+//   // Reader threads:
+//   auto snapshot = index.snapshot();
+//   auto query = MakeS2ContainsPointQuery(snapshot.get());
+//   ... query.Contains(point) ...
+//
+// Add(), Release(), and Commit() must all be called from the same thread (or
+// otherwise externally synchronized), while snapshot() may be called
+// concurrently from any number of threads.
+class ConcurrentS2ShapeIndex {
+ public:
+  // An immutable version of the index.  It is safe to call any const method
+  // of MutableS2ShapeIndex on a snapshot from multiple threads.
+  using Snapshot = std::shared_ptr<const MutableS2ShapeIndex>;
+
+  // Creates an index that uses the default MutableS2ShapeIndex options.
+  ConcurrentS2ShapeIndex();
+
+  // Creates an index whose versions are built with the given options.
+  explicit ConcurrentS2ShapeIndex(const MutableS2ShapeIndex::Options& options);
+
+  ~ConcurrentS2ShapeIndex();
+
+  // Returns the most recently committed version of the index.  This method
+  // never blocks waiting for an update to finish.
+  Snapshot snapshot() const;
+
+  // Takes ownership of the given shape and adds it to the index, returning
+  // its id.  Shape ids are assigned sequentially as in MutableS2ShapeIndex,
+  // and the same id refers to the same shape in every snapshot.  The shape
+  // becomes visible to readers after the next call to Commit().
+  //
+  // Note that snapshots contain a lightweight wrapper around each shape, so
+  // clients should use the shape id (rather than the S2Shape pointer) to
+  // identify shapes found by queries.
+  int Add(std::unique_ptr<S2Shape> shape);
+
+  // Removes the given shape from the index.  The shape is not deleted until
+  // every snapshot that contains it has been released, which is why it is
+  // returned as a shared pointer.  The removal becomes visible to readers
+  // after the next call to Commit().
+  std::shared_ptr<S2Shape> Release(int shape_id);
+
+  // Builds a new version of the index that includes all updates made so far,
+  // and makes it visible to readers.
+  void Commit();
+
+  // The number of distinct shape ids that have been assigned, including those
+  // of shapes that have not been committed yet.
+  int num_shape_ids() const { return static_cast<int>(shapes_.size()); }
+
+  // Returns the shape with the given id, or nullptr if the shape has been
+  // removed.  This reflects all updates, whether or not they are committed.
+  S2Shape* shape(int id) const { return shapes_[id].get(); }
+
+ private:
+  // An Add() or Release() operation.  Additions keep a reference to the
+  // added shape since it may have been released by the time the update is
+  // applied to the spare version of the index.
+  struct Update {
+    Update(int _shape_id, std::shared_ptr<S2Shape> _added)
+        : shape_id(_shape_id), added(std::move(_added)) {
+    }
+    int shape_id;
+    std::shared_ptr<S2Shape> added;  // nullptr for removals.
+  };
+
+  void ApplyUpdates(const std::vector<Update>& updates,
+                    MutableS2ShapeIndex* index) const;
+  std::shared_ptr<MutableS2ShapeIndex> BuildFromScratch() const;
+
+  MutableS2ShapeIndex::Options options_;
+
+  // The current set of shapes, indexed by shape id.
+  std::vector<std::shared_ptr<S2Shape>> shapes_;
+
+  // The published version of the index.  This field is only accessed using
+  // std::atomic_load() and std::atomic_exchange().
+  std::shared_ptr<MutableS2ShapeIndex> published_;
+
+  // The version that will be updated by the next call to Commit().  This was
+  // the published version before the most recent Commit(), so it is missing
+  // the updates in "unapplied_updates_".
+  std::shared_ptr<MutableS2ShapeIndex> spare_;
+  std::vector<Update> unapplied_updates_;
+
+  // Updates that have not been committed yet.
+  std::vector<Update> pending_updates_;
+
+  ConcurrentS2ShapeIndex(const ConcurrentS2ShapeIndex&) = delete;
+  void operator=(const ConcurrentS2ShapeIndex&) = delete;
+};
+
+#endif  // S2_CONCURRENT_S2SHAPE_INDEX_H_
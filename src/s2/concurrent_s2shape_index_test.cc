@@ -0,0 +1,144 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/concurrent_s2shape_index.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/casts.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+unique_ptr<S2Shape> MakeCap(const S2Point& center, double radius_km) {
+  return make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      center, S2Testing::KmToAngle(radius_km), 20));
+}
+
+// Returns the number of shapes in "index" that contain "p".
+int CountContaining(const MutableS2ShapeIndex& index, const S2Point& p) {
+  auto query = MakeS2ContainsPointQuery(&index);
+  return query.GetContainingShapes(p).size();
+}
+
+TEST(ConcurrentS2ShapeIndex, UpdatesVisibleAfterCommit) {
+  ConcurrentS2ShapeIndex index;
+  S2Point center(1, 0, 0);
+  auto empty = index.snapshot();
+  EXPECT_EQ(0, empty->num_shape_ids());
+
+  EXPECT_EQ(0, index.Add(MakeCap(center, 10)));
+  EXPECT_EQ(1, index.Add(MakeCap(center, 20)));
+  EXPECT_EQ(0, index.snapshot()->num_shape_ids());
+  index.Commit();
+  auto v1 = index.snapshot();
+  EXPECT_TRUE(v1->is_fresh());
+  EXPECT_EQ(2, CountContaining(*v1, center));
+
+  // Existing snapshots are not affected by subsequent updates.
+  auto released = index.Release(0);
+  EXPECT_EQ(2, index.Add(MakeCap(center, 30)));
+  index.Commit();
+  auto v2 = index.snapshot();
+  EXPECT_EQ(2, CountContaining(*v1, center));
+  EXPECT_EQ(2, CountContaining(*v2, center));
+  EXPECT_EQ(nullptr, v2->shape(0));
+  EXPECT_NE(nullptr, v1->shape(0));
+  EXPECT_EQ(0, CountContaining(*empty, center));
+
+  // "v1" is still held, so this commit builds a new version from scratch.
+  // The ids of removed shapes must be preserved.
+  index.Release(1);
+  index.Commit();
+  auto v3 = index.snapshot();
+  EXPECT_EQ(3, v3->num_shape_ids());
+  EXPECT_EQ(nullptr, v3->shape(0));
+  EXPECT_EQ(nullptr, v3->shape(1));
+  EXPECT_EQ(1, CountContaining(*v3, center));
+
+  // Once the older snapshots are released, updates are applied
+  // incrementally, and the result should be the same as building the index
+  // all at once.
+  empty.reset();
+  v1.reset();
+  v2.reset();
+  index.Add(MakeCap(center, 40));
+  index.Commit();
+  index.Add(MakeCap(center, 50));
+  index.Commit();
+  MutableS2ShapeIndex expected;
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    S2Shape* shape = index.shape(id);
+    if (shape == nullptr) {
+      expected.Release(expected.Add(MakeCap(center, 1)));
+    } else {
+      expected.Add(make_unique<S2Loop::Shape>(
+          down_cast<S2Loop::OwningShape*>(shape)->loop()));
+    }
+  }
+  s2testing::ExpectEqual(expected, *index.snapshot());
+}
+
+TEST(ConcurrentS2ShapeIndex, ReadersDoNotBlockOnCommit) {
+  // Several readers query the index continuously while the writer adds and
+  // removes shapes.  Every snapshot should always be fully built.
+  ConcurrentS2ShapeIndex index;
+  std::atomic<bool> done(false);
+  auto reader = [&index, &done]() {
+    while (!done.load()) {
+      auto snapshot = index.snapshot();
+      EXPECT_TRUE(snapshot->is_fresh());
+      for (MutableS2ShapeIndex::Iterator it(snapshot.get(),
+                                            S2ShapeIndex::BEGIN);
+           !it.done(); it.Next()) {
+        continue;
+      }
+    }
+  };
+  vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) readers.emplace_back(reader);
+  vector<int> ids;
+  for (int iter = 0; iter < 50; ++iter) {
+    ids.push_back(index.Add(MakeCap(S2Testing::RandomPoint(), 1000)));
+    if (ids.size() > 5) {
+      index.Release(ids.front());
+      ids.erase(ids.begin());
+    }
+    index.Commit();
+  }
+  done = true;
+  for (auto& thread : readers) thread.join();
+  auto snapshot = index.snapshot();
+  int num_shapes = 0;
+  for (int id = 0; id < snapshot->num_shape_ids(); ++id) {
+    num_shapes += (snapshot->shape(id) != nullptr);
+  }
+  EXPECT_EQ(ids.size(), num_shapes);
+}
+
+}  // namespace
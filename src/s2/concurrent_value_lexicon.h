@@ -0,0 +1,252 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_CONCURRENT_VALUE_LEXICON_H_
+#define S2_CONCURRENT_VALUE_LEXICON_H_
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+
+#include "s2/base/logging.h"
+#include "s2/base/mutex.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/util/bits/bits.h"
+#include "s2/util/gtl/dense_hash_set.h"
+#include "s2/util/hash/mix.h"
+
+// ConcurrentValueLexicon is a thread-safe version of ValueLexicon: it maps
+// distinct values to sequentially numbered integer identifiers, and Add()
+// may be called from any number of threads concurrently.  This allows
+// threads that produce output in parallel to share a single lexicon rather
+// than building one lexicon each and merging them afterwards (see
+// ValueLexicon::Merge).
+//
+// The values are divided among a fixed number of shards according to their
+// hash value, and Add() locks only the shard of the given value.  The values
+// themselves are stored in blocks that never move once allocated, so value()
+// and size() do not take any locks.
+//
+// Ids are assigned in the order in which distinct values are added, so they
+// are only deterministic if the values are added in a deterministic order.
+//
+// REQUIRES: T is default-constructible and copy-assignable.
+//
+// Example usage:
+//
+//   ConcurrentValueLexicon<string> lexicon;
+//   ParallelFor(executor, n, [&](int i) {
+//       ids[i] = lexicon.Add(names[i]);
+//     });
+//   EXPECT_EQ(names[0], lexicon.value(ids[0]));
+template <class T,
+          class Hasher = std::hash<T>,
+          class KeyEqual = std::equal_to<T>>
+class ConcurrentValueLexicon {
+ public:
+  explicit ConcurrentValueLexicon(const Hasher& hasher = Hasher(),
+                                  const KeyEqual& key_equal = KeyEqual());
+  ~ConcurrentValueLexicon();
+
+  // Adds the given value to the lexicon if it is not already present, and
+  // returns its integer id.  Ids are assigned sequentially starting from
+  // zero.  This method is thread-safe.
+  uint32 Add(const T& value);
+
+  // Returns the number of ids assigned so far.  While other threads are
+  // calling Add(), this may include ids whose values are still being
+  // stored, so it should only be used to iterate over the values once all
+  // Add() calls have finished.
+  uint32 size() const;
+
+  // Returns the value with the given id, which must have been returned by
+  // Add() in this thread or in a thread that has synchronized with this one
+  // since then.  This method does not take any locks.
+  const T& value(uint32 id) const;
+
+ private:
+  // kEmptyKey is never assigned, and kProbeKey refers to the value being
+  // looked up by the current Add() call in a given shard.
+  static const uint32 kEmptyKey = std::numeric_limits<uint32>::max();
+  static const uint32 kProbeKey = kEmptyKey - 1;
+
+  // The values are stored in blocks of exponentially increasing size; block
+  // "b" holds (kFirstBlockSize << b) values.  This supports 2**32 - 2 ids.
+  static const int kFirstBlockBits = 10;
+  static const uint32 kFirstBlockSize = 1 << kFirstBlockBits;
+  static const int kNumBlocks = 32 - kFirstBlockBits + 1;
+  static const int kNumShards = 16;
+
+  struct Shard;
+
+  class IdHasher {
+   public:
+    IdHasher(const Hasher& hasher, const ConcurrentValueLexicon* lexicon,
+             const Shard* shard)
+        : hasher_(hasher), lexicon_(lexicon), shard_(shard) {}
+    size_t operator()(uint32 id) const {
+      return hasher_(lexicon_->shard_value(*shard_, id));
+    }
+
+   private:
+    Hasher hasher_;
+    const ConcurrentValueLexicon* lexicon_;
+    const Shard* shard_;
+  };
+
+  class IdKeyEqual {
+   public:
+    IdKeyEqual(const KeyEqual& key_equal,
+               const ConcurrentValueLexicon* lexicon, const Shard* shard)
+        : key_equal_(key_equal), lexicon_(lexicon), shard_(shard) {}
+    bool operator()(uint32 id1, uint32 id2) const {
+      if (id1 == id2) return true;
+      if (id1 == kEmptyKey || id2 == kEmptyKey) return false;
+      return key_equal_(lexicon_->shard_value(*shard_, id1),
+                        lexicon_->shard_value(*shard_, id2));
+    }
+
+   private:
+    KeyEqual key_equal_;
+    const ConcurrentValueLexicon* lexicon_;
+    const Shard* shard_;
+  };
+
+  using IdSet = gtl::dense_hash_set<uint32, IdHasher, IdKeyEqual>;
+
+  struct Shard {
+    Shard(const Hasher& hasher, const KeyEqual& key_equal,
+          const ConcurrentValueLexicon* lexicon)
+        : ids(0, IdHasher(hasher, lexicon, this),
+              IdKeyEqual(key_equal, lexicon, this)) {
+      ids.set_empty_key(kEmptyKey);
+    }
+    absl::Mutex mutex;
+    const T* probe = nullptr;  // Protected by "mutex".
+    IdSet ids;                 // Protected by "mutex".
+  };
+
+  // Like value(), but also handles kProbeKey.
+  const T& shard_value(const Shard& shard, uint32 id) const {
+    return id == kProbeKey ? *shard.probe : value(id);
+  }
+
+  // Returns the block containing the given id and the id's offset within
+  // that block.
+  static int block_index(uint32 id, uint32* offset);
+
+  // Returns the storage for the given id, allocating its block if necessary.
+  T* mutable_value(uint32 id);
+
+  Hasher hasher_;
+  std::unique_ptr<Shard> shards_[kNumShards];
+  std::atomic<T*> blocks_[kNumBlocks];
+  std::atomic<uint32> size_;
+
+  ConcurrentValueLexicon(const ConcurrentValueLexicon&) = delete;
+  void operator=(const ConcurrentValueLexicon&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class T, class Hasher, class KeyEqual>
+const uint32 ConcurrentValueLexicon<T, Hasher, KeyEqual>::kEmptyKey;
+
+template <class T, class Hasher, class KeyEqual>
+const uint32 ConcurrentValueLexicon<T, Hasher, KeyEqual>::kProbeKey;
+
+template <class T, class Hasher, class KeyEqual>
+ConcurrentValueLexicon<T, Hasher, KeyEqual>::ConcurrentValueLexicon(
+    const Hasher& hasher, const KeyEqual& key_equal)
+    : hasher_(hasher), size_(0) {
+  for (auto& shard : shards_) {
+    shard.reset(new Shard(hasher, key_equal, this));
+  }
+  for (auto& block : blocks_) block.store(nullptr, std::memory_order_relaxed);
+}
+
+template <class T, class Hasher, class KeyEqual>
+ConcurrentValueLexicon<T, Hasher, KeyEqual>::~ConcurrentValueLexicon() {
+  for (auto& block : blocks_) delete[] block.load(std::memory_order_relaxed);
+}
+
+template <class T, class Hasher, class KeyEqual>
+inline int ConcurrentValueLexicon<T, Hasher, KeyEqual>::block_index(
+    uint32 id, uint32* offset) {
+  // Block "b" holds the ids in the range
+  // [kFirstBlockSize * (2**b - 1), kFirstBlockSize * (2**(b+1) - 1)).
+  uint64 n = uint64{id} + kFirstBlockSize;
+  int b = Bits::Log2FloorNonZero64(n) - kFirstBlockBits;
+  *offset = static_cast<uint32>(n - (uint64{kFirstBlockSize} << b));
+  return b;
+}
+
+template <class T, class Hasher, class KeyEqual>
+T* ConcurrentValueLexicon<T, Hasher, KeyEqual>::mutable_value(uint32 id) {
+  uint32 offset;
+  int b = block_index(id, &offset);
+  T* block = blocks_[b].load(std::memory_order_acquire);
+  if (block == nullptr) {
+    // Several threads may allocate the block concurrently; only the first
+    // one to install it keeps it.
+    T* new_block = new T[uint64{kFirstBlockSize} << b];
+    if (blocks_[b].compare_exchange_strong(block, new_block,
+                                           std::memory_order_acq_rel)) {
+      block = new_block;
+    } else {
+      delete[] new_block;
+    }
+  }
+  return &block[offset];
+}
+
+template <class T, class Hasher, class KeyEqual>
+uint32 ConcurrentValueLexicon<T, Hasher, KeyEqual>::Add(const T& value) {
+  // The hash value is mixed so that the choice of shard does not depend on
+  // the low bits that are also used by the shard's hash table.
+  Shard* shard = shards_[HashMix(hasher_(value)).get() % kNumShards].get();
+  shard->mutex.Lock();
+  shard->probe = &value;
+  auto it = shard->ids.find(kProbeKey);
+  uint32 id;
+  if (it != shard->ids.end()) {
+    id = *it;
+  } else {
+    id = size_.fetch_add(1, std::memory_order_relaxed);
+    S2_CHECK_LT(id, kProbeKey);
+    *mutable_value(id) = value;
+    shard->ids.insert(id);
+  }
+  shard->mutex.Unlock();
+  return id;
+}
+
+template <class T, class Hasher, class KeyEqual>
+inline uint32 ConcurrentValueLexicon<T, Hasher, KeyEqual>::size() const {
+  return size_.load(std::memory_order_acquire);
+}
+
+template <class T, class Hasher, class KeyEqual>
+inline const T& ConcurrentValueLexicon<T, Hasher, KeyEqual>::value(
+    uint32 id) const {
+  uint32 offset;
+  int b = block_index(id, &offset);
+  return blocks_[b].load(std::memory_order_acquire)[offset];
+}
+
+#endif  // S2_CONCURRENT_VALUE_LEXICON_H_
@@ -0,0 +1,83 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/concurrent_value_lexicon.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+TEST(ConcurrentValueLexicon, DuplicateValues) {
+  ConcurrentValueLexicon<int64> lex;
+  EXPECT_EQ(0, lex.Add(5));
+  EXPECT_EQ(1, lex.Add(0));
+  EXPECT_EQ(1, lex.Add(0));
+  EXPECT_EQ(2, lex.Add(-3));
+  EXPECT_EQ(0, lex.Add(5));
+  EXPECT_EQ(3, lex.size());
+  EXPECT_EQ(5, lex.value(0));
+  EXPECT_EQ(0, lex.value(1));
+  EXPECT_EQ(-3, lex.value(2));
+}
+
+TEST(ConcurrentValueLexicon, ManyBlocks) {
+  ConcurrentValueLexicon<string> lex;
+  const int kNumValues = 10000;
+  for (int i = 0; i < kNumValues; ++i) {
+    EXPECT_EQ(i, lex.Add(std::to_string(i)));
+  }
+  for (int i = 0; i < kNumValues; ++i) {
+    EXPECT_EQ(i, lex.Add(std::to_string(i)));
+    EXPECT_EQ(std::to_string(i), lex.value(i));
+  }
+  EXPECT_EQ(kNumValues, lex.size());
+}
+
+TEST(ConcurrentValueLexicon, ConcurrentAdds) {
+  // Each thread adds the same values in a different order.  Every value must
+  // get exactly one id.
+  ConcurrentValueLexicon<int> lex;
+  const int kNumThreads = 4, kNumValues = 5000;
+  vector<vector<uint32>> ids(kNumThreads, vector<uint32>(kNumValues));
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&lex, &ids, t]() {
+        for (int i = 0; i < kNumValues; ++i) {
+          int value = (t % 2 == 0) ? i : kNumValues - 1 - i;
+          ids[t][value] = lex.Add(value);
+        }
+      });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(kNumValues, lex.size());
+  vector<bool> used(kNumValues, false);
+  for (int value = 0; value < kNumValues; ++value) {
+    uint32 id = ids[0][value];
+    for (int t = 1; t < kNumThreads; ++t) EXPECT_EQ(id, ids[t][value]);
+    ASSERT_LT(id, kNumValues);
+    EXPECT_FALSE(used[id]);
+    used[id] = true;
+    EXPECT_EQ(value, lex.value(id));
+  }
+}
+
+}  // namespace
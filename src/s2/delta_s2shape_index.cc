@@ -0,0 +1,299 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/delta_s2shape_index.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "s2/base/casts.h"
+#include "s2/base/logging.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_string_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/util/coding/varint.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+// Returns true if the two cells have the same contents.
+static bool SameCell(const S2ShapeIndexCell& a, const S2ShapeIndexCell& b) {
+  if (a.num_clipped() != b.num_clipped()) return false;
+  for (int i = 0; i < a.num_clipped(); ++i) {
+    const S2ClippedShape& a_clipped = a.clipped(i);
+    const S2ClippedShape& b_clipped = b.clipped(i);
+    if (a_clipped.shape_id() != b_clipped.shape_id() ||
+        a_clipped.contains_center() != b_clipped.contains_center() ||
+        a_clipped.num_edges() != b_clipped.num_edges()) {
+      return false;
+    }
+    for (int j = 0; j < a_clipped.num_edges(); ++j) {
+      if (a_clipped.edge(j) != b_clipped.edge(j)) return false;
+    }
+  }
+  return true;
+}
+
+bool DeltaS2ShapeIndex::EncodeDelta(const S2ShapeIndex& base,
+                                    const MutableS2ShapeIndex& index,
+                                    Encoder* encoder) {
+  const int base_num_shape_ids = base.num_shape_ids();
+  const int num_shape_ids = index.num_shape_ids();
+  if (num_shape_ids < base_num_shape_ids) return false;
+
+  // Find the removed shapes and encode the added ones in the format of
+  // s2shapeutil::EncodeTaggedShapes().
+  vector<uint32> removed_shape_ids;
+  for (int id = 0; id < base_num_shape_ids; ++id) {
+    if (index.shape(id) != nullptr) {
+      if (base.shape(id) == nullptr) return false;
+    } else if (base.shape(id) != nullptr) {
+      removed_shape_ids.push_back(id);
+    }
+  }
+  s2coding::StringVectorEncoder added_shapes;
+  for (int id = base_num_shape_ids; id < num_shape_ids; ++id) {
+    Encoder* sub_encoder = added_shapes.AddViaEncoder();
+    const S2Shape* shape = index.shape(id);
+    if (shape == nullptr) continue;  // Encode as zero bytes.
+    uint32 tag = shape->type_tag();
+    if (tag == S2Shape::kNoTypeTag) return false;
+    sub_encoder->Ensure(Encoder::kVarintMax32);
+    sub_encoder->put_varint32(tag);
+    if (!s2shapeutil::CompactEncodeShape(*shape, sub_encoder)) return false;
+  }
+
+  // Merge the two sequences of cells.  A base cell is kept only if "index"
+  // has a cell with the same id and contents; all other cells of "index" are
+  // added.
+  vector<S2CellId> removed_cell_ids, added_cell_ids;
+  s2coding::StringVectorEncoder added_cells;
+  S2ShapeIndex::Iterator base_it(&base, S2ShapeIndex::BEGIN);
+  MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  while (!base_it.done() || !it.done()) {
+    if (base_it.id() < it.id()) {
+      removed_cell_ids.push_back(base_it.id());
+      base_it.Next();
+      continue;
+    }
+    if (base_it.id() == it.id()) {
+      if (SameCell(base_it.cell(), it.cell())) {
+        base_it.Next();
+        it.Next();
+        continue;
+      }
+      removed_cell_ids.push_back(base_it.id());
+      base_it.Next();
+    }
+    added_cell_ids.push_back(it.id());
+    it.cell().Encode(num_shape_ids, added_cells.AddViaEncoder());
+    it.Next();
+  }
+
+  encoder->Ensure(4 * Varint::kMax32);
+  encoder->put_varint32(kCurrentEncodingVersionNumber);
+  encoder->put_varint32(index.options().max_edges_per_cell());
+  encoder->put_varint32(base_num_shape_ids);
+  encoder->put_varint32(num_shape_ids);
+  s2coding::EncodeUintVector<uint32>(removed_shape_ids, encoder);
+  added_shapes.Encode(encoder);
+  s2coding::EncodeS2CellIdVector(removed_cell_ids, encoder);
+  s2coding::EncodeS2CellIdVector(added_cell_ids, encoder);
+  added_cells.Encode(encoder);
+  return true;
+}
+
+DeltaS2ShapeIndex::DeltaS2ShapeIndex() {
+}
+
+DeltaS2ShapeIndex::~DeltaS2ShapeIndex() {
+}
+
+bool DeltaS2ShapeIndex::Init(const S2ShapeIndex* base, Decoder* decoder) {
+  base_ = base;
+  added_shapes_.clear();
+  removed_shapes_.clear();
+  removed_cell_ids_.clear();
+  added_cell_ids_.clear();
+  added_cells_.clear();
+  num_shape_ids_ = base->num_shape_ids();
+
+  uint32 version, max_edges, base_num_shape_ids, num_shape_ids;
+  if (!decoder->get_varint32(&version)) return false;
+  if (version != kCurrentEncodingVersionNumber) return false;
+  if (!decoder->get_varint32(&max_edges)) return false;
+  if (!decoder->get_varint32(&base_num_shape_ids)) return false;
+  if (!decoder->get_varint32(&num_shape_ids)) return false;
+  if (base_num_shape_ids != base->num_shape_ids()) return false;
+  if (num_shape_ids < base_num_shape_ids) return false;
+  max_edges_per_cell_ = max_edges;
+
+  s2coding::EncodedUintVector<uint32> removed_shape_ids;
+  if (!removed_shape_ids.Init(decoder)) return false;
+  removed_shapes_.assign(base_num_shape_ids, false);
+  for (int i = 0; i < removed_shape_ids.size(); ++i) {
+    uint32 id = removed_shape_ids[i];
+    if (id >= base_num_shape_ids) return false;
+    removed_shapes_[id] = true;
+  }
+  s2shapeutil::TaggedShapeFactory shape_factory(s2shapeutil::FullDecodeShape,
+                                                decoder);
+  if (shape_factory.size() != num_shape_ids - base_num_shape_ids) {
+    return false;
+  }
+  added_shapes_.reserve(shape_factory.size());
+  for (int i = 0; i < shape_factory.size(); ++i) {
+    unique_ptr<S2Shape> shape = shape_factory[i];
+    if (shape) shape->id_ = base_num_shape_ids + i;
+    added_shapes_.push_back(std::move(shape));
+  }
+
+  s2coding::EncodedS2CellIdVector removed_cell_ids, added_cell_ids;
+  s2coding::EncodedStringVector added_cells;
+  if (!removed_cell_ids.Init(decoder)) return false;
+  if (!added_cell_ids.Init(decoder)) return false;
+  if (!added_cells.Init(decoder)) return false;
+  if (added_cells.size() != added_cell_ids.size()) return false;
+  removed_cell_ids_.reserve(removed_cell_ids.size());
+  for (int i = 0; i < removed_cell_ids.size(); ++i) {
+    removed_cell_ids_.push_back(removed_cell_ids[i]);
+  }
+  added_cell_ids_.reserve(added_cell_ids.size());
+  added_cells_.reserve(added_cell_ids.size());
+  for (int i = 0; i < added_cell_ids.size(); ++i) {
+    added_cell_ids_.push_back(added_cell_ids[i]);
+    auto cell = make_unique<S2ShapeIndexCell>();
+    Decoder cell_decoder = added_cells.GetDecoder(i);
+    if (!cell->Decode(num_shape_ids, &cell_decoder)) return false;
+    added_cells_.push_back(std::move(cell));
+  }
+  num_shape_ids_ = num_shape_ids;
+  return true;
+}
+
+S2Shape* DeltaS2ShapeIndex::shape(int id) const {
+  if (id < removed_shapes_.size()) {
+    return removed_shapes_[id] ? nullptr : base_->shape(id);
+  }
+  return added_shapes_[id - removed_shapes_.size()].get();
+}
+
+bool DeltaS2ShapeIndex::is_removed(S2CellId id) const {
+  return std::binary_search(removed_cell_ids_.begin(),
+                            removed_cell_ids_.end(), id);
+}
+
+void DeltaS2ShapeIndex::Encode(Encoder* encoder) const {
+  // This follows MutableS2ShapeIndex::Encode().
+  encoder->Ensure(Varint::kMax64);
+  uint64 max_edges = max_edges_per_cell_;
+  encoder->put_varint64(max_edges << 2 |
+                        MutableS2ShapeIndex::kCurrentEncodingVersionNumber);
+  vector<S2CellId> cell_ids;
+  s2coding::StringVectorEncoder encoded_cells;
+  for (Iterator it(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
+    cell_ids.push_back(it.id());
+    it.cell().Encode(num_shape_ids(), encoded_cells.AddViaEncoder());
+  }
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  encoded_cells.Encode(encoder);
+}
+
+size_t DeltaS2ShapeIndex::SpaceUsed() const {
+  size_t size = sizeof(*this);
+  size += added_shapes_.capacity() * sizeof(unique_ptr<S2Shape>);
+  size += removed_shapes_.capacity() / 8;
+  size += removed_cell_ids_.capacity() * sizeof(S2CellId);
+  size += added_cell_ids_.capacity() * sizeof(S2CellId);
+  size += added_cells_.capacity() * sizeof(unique_ptr<S2ShapeIndexCell>);
+  for (const auto& cell : added_cells_) {
+    size += sizeof(S2ShapeIndexCell);
+    for (int s = 0; s < cell->num_clipped(); ++s) {
+      size += sizeof(S2ClippedShape);
+      const S2ClippedShape& clipped = cell->clipped(s);
+      if (clipped.num_edges() > 2) size += clipped.num_edges() * sizeof(int32);
+    }
+  }
+  return size;
+}
+
+bool DeltaS2ShapeIndex::Iterator::Prev() {
+  // Find the previous base cell that has not been removed, if any.
+  const S2CellId start = base_it_.id();
+  bool found_base = false;
+  while (base_it_.Prev()) {
+    if (!index_->is_removed(base_it_.id())) {
+      found_base = true;
+      break;
+    }
+  }
+  const bool found_added = added_pos_ > 0;
+  if (found_added &&
+      (!found_base ||
+       index_->added_cell_ids_[added_pos_ - 1] > base_it_.id())) {
+    // The previous cell is an added cell.  All base cells between it and
+    // "start" have been removed.
+    --added_pos_;
+    if (found_base) {
+      base_it_.Next();
+      SkipRemovedCells();
+    } else {
+      base_it_.Seek(start);
+    }
+    Refresh();
+    return true;
+  }
+  if (found_base) {
+    Refresh();
+    return true;
+  }
+  base_it_.Seek(start);
+  return false;
+}
+
+void DeltaS2ShapeIndex::Iterator::Seek(S2CellId target) {
+  base_it_.Seek(target);
+  SkipRemovedCells();
+  const vector<S2CellId>& ids = index_->added_cell_ids_;
+  added_pos_ = std::lower_bound(ids.begin(), ids.end(), target) - ids.begin();
+  Refresh();
+}
+
+bool DeltaS2ShapeIndex::Iterator::Locate(const S2Point& target) {
+  return LocateImpl(target, this);
+}
+
+DeltaS2ShapeIndex::CellRelation DeltaS2ShapeIndex::Iterator::Locate(
+    S2CellId target) {
+  return LocateImpl(target, this);
+}
+
+const S2ShapeIndexCell* DeltaS2ShapeIndex::Iterator::GetCell() const {
+  // Only base cells are fetched on demand.
+  return &base_it_.cell();
+}
+
+unique_ptr<DeltaS2ShapeIndex::IteratorBase>
+DeltaS2ShapeIndex::Iterator::Clone() const {
+  return make_unique<Iterator>(*this);
+}
+
+void DeltaS2ShapeIndex::Iterator::Copy(const IteratorBase& other)  {
+  *this = *down_cast<const Iterator*>(&other);
+}
@@ -0,0 +1,305 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_DELTA_S2SHAPE_INDEX_H_
+#define S2_DELTA_S2SHAPE_INDEX_H_
+
+#include <memory>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/coding/coder.h"
+
+// DeltaS2ShapeIndex is a read-only S2ShapeIndex that represents a "base"
+// index plus a small set of changes (a "delta"), so that an index can be
+// updated by distributing only the shapes and index cells that changed
+// rather than re-encoding the entire index.
+//
+// A delta is computed by EncodeDelta() from the base index and a
+// MutableS2ShapeIndex obtained by adding shapes to and removing shapes from a
+// copy of it.  It consists of the added shapes, the ids of the removed
+// shapes, the ids of the base cells that no longer exist, and the encoded
+// contents of the new cells.  Since every unchanged cell is shared with the
+// base index, the delta is proportional to the size of the changed region.
+//
+// A DeltaS2ShapeIndex merges the base cells and the new cells at query time,
+// and its contents are exactly the same as those of the MutableS2ShapeIndex
+// that the delta was computed from.  Deltas may be stacked by using one
+// DeltaS2ShapeIndex as the base of another.  A stack of deltas can be
+// compacted into a new base by encoding the merged index (see Encode()),
+// which can be done in a background thread while queries continue.  (This
+// requires shapes that can be encoded, e.g. those returned by
+// s2shapeutil::FullDecodeShapeFactory.)
+//
+// Example usage:
+//
+//   // Writer: "base" is the index that readers currently have, and
+//   // "updated" is a MutableS2ShapeIndex initialized from the same encoding.
+//   updated.Release(old_id);
+//   updated.Add(std::move(new_shape));
+//   Encoder delta;
+//   DeltaS2ShapeIndex::EncodeDelta(base, updated, &delta);
+//
+//   // Reader:
+//   DeltaS2ShapeIndex index;
+//   Decoder decoder(delta.base(), delta.length());
+//   if (!index.Init(&base, &decoder)) ...
+//
+//   // Compaction, producing the input expected by EncodedS2ShapeIndex:
+//   Encoder encoder;
+//   s2shapeutil::CompactEncodeTaggedShapes(index, &encoder);
+//   index.Encode(&encoder);
+//
+// Like other S2ShapeIndex types, all const methods are thread-safe.
+class DeltaS2ShapeIndex final : public S2ShapeIndex {
+ public:
+  // Appends an encoding of the changes from "base" to "index" to "encoder".
+  // Returns false if "index" was not obtained from "base" by adding and
+  // removing shapes (i.e., it has fewer shape ids, or it contains a shape
+  // that the base index does not), or if an added shape does not have a type
+  // tag (see s2shapeutil::EncodeTaggedShapes).
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  static bool EncodeDelta(const S2ShapeIndex& base,
+                          const MutableS2ShapeIndex& index, Encoder* encoder);
+
+  // Creates an index that must be initialized by calling Init().
+  DeltaS2ShapeIndex();
+
+  ~DeltaS2ShapeIndex() override;
+
+  // Initializes the index from the given base index and a delta produced by
+  // EncodeDelta(), returning true on success.  The added shapes and cells
+  // are decoded immediately, so the Decoder data does not need to outlive
+  // this method.
+  //
+  // REQUIRES: "base" outlives this index and is not modified.
+  bool Init(const S2ShapeIndex* base, Decoder* decoder);
+
+  // The base index.
+  const S2ShapeIndex* base() const { return base_; }
+
+  // The maximum number of edges per cell of the index that the delta was
+  // computed from.
+  int max_edges_per_cell() const { return max_edges_per_cell_; }
+
+  // The number of distinct shape ids in the index, including those of the
+  // base index.
+  int num_shape_ids() const override { return num_shape_ids_; }
+
+  // Returns a pointer to the shape with the given id, or nullptr if the shape
+  // has been removed.  Shapes that were not changed are owned by the base.
+  S2Shape* shape(int id) const override;
+
+  // Returns the number of base cells that have been replaced, and the number
+  // of cells added by the delta.
+  int num_removed_cells() const {
+    return static_cast<int>(removed_cell_ids_.size());
+  }
+  int num_added_cells() const {
+    return static_cast<int>(added_cell_ids_.size());
+  }
+
+  // Appends the merged index cells to "encoder" in the format produced by
+  // MutableS2ShapeIndex::Encode().  Together with an encoding of the shapes
+  // (e.g. s2shapeutil::CompactEncodeTaggedShapes(*this, encoder)), this
+  // produces a new base index that no longer needs the delta.
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void Encode(Encoder* encoder) const;
+
+  // Does nothing, since the delta is always fully decoded and the base index
+  // is not owned.
+  void Minimize() override {}
+
+  // Returns the number of bytes used by the delta (not including the base
+  // index or the shapes).
+  size_t SpaceUsed() const override;
+
+  class Iterator final : public IteratorBase {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator();
+
+    // Constructs an iterator positioned as specified.  By default iterators
+    // are unpositioned, since this avoids an extra seek in this situation
+    // where one of the seek methods (such as Locate) is immediately called.
+    explicit Iterator(const DeltaS2ShapeIndex* index,
+                      InitialPosition pos = UNPOSITIONED);
+
+    // Initializes an iterator for the given DeltaS2ShapeIndex.
+    void Init(const DeltaS2ShapeIndex* index,
+              InitialPosition pos = UNPOSITIONED);
+
+    // Inherited non-virtual methods:
+    //   S2CellId id() const;
+    //   const S2ShapeIndexCell& cell() const;
+    //   bool done() const;
+    //   S2Point center() const;
+
+    // IteratorBase API:
+    void Begin() override;
+    void Finish() override;
+    void Next() override;
+    bool Prev() override;
+    void Seek(S2CellId target) override;
+    bool Locate(const S2Point& target) override;
+    CellRelation Locate(S2CellId target) override;
+
+   protected:
+    const S2ShapeIndexCell* GetCell() const override;
+    std::unique_ptr<IteratorBase> Clone() const override;
+    void Copy(const IteratorBase& other) override;
+
+   private:
+    // Advances "base_it_" past any base cells that have been removed.
+    void SkipRemovedCells();
+
+    // Returns true if the current cell comes from the base index.
+    bool at_base_cell() const;
+
+    void Refresh();  // Updates the IteratorBase fields.
+
+    const DeltaS2ShapeIndex* index_;
+
+    // "base_it_" is positioned at the first base cell that has not been
+    // removed and whose id is at least id(), and "added_pos_" is the
+    // position of the first added cell whose id is at least id().  The
+    // current cell is whichever of these has the smaller id (they are never
+    // equal).
+    S2ShapeIndex::Iterator base_it_;
+    int added_pos_;
+  };
+
+ protected:
+  std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
+
+ private:
+  friend class Iterator;
+
+  // The version number of the delta encoding.
+  static const unsigned char kCurrentEncodingVersionNumber = 0;
+
+  // Returns true if the base cell with the given id has been removed.
+  bool is_removed(S2CellId id) const;
+
+  const S2ShapeIndex* base_ = nullptr;
+  int max_edges_per_cell_ = 0;
+  int num_shape_ids_ = 0;
+
+  // The shapes added by the delta, indexed by (id - base_->num_shape_ids()),
+  // and whether each base shape has been removed.
+  std::vector<std::unique_ptr<S2Shape>> added_shapes_;
+  std::vector<bool> removed_shapes_;
+
+  // The ids of the base cells that are no longer part of the index, in
+  // increasing order.
+  std::vector<S2CellId> removed_cell_ids_;
+
+  // The ids and contents of the cells added by the delta, in increasing order
+  // of id.
+  std::vector<S2CellId> added_cell_ids_;
+  std::vector<std::unique_ptr<S2ShapeIndexCell>> added_cells_;
+
+  DeltaS2ShapeIndex(const DeltaS2ShapeIndex&) = delete;
+  void operator=(const DeltaS2ShapeIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline DeltaS2ShapeIndex::Iterator::Iterator()
+    : index_(nullptr), added_pos_(0) {
+}
+
+inline DeltaS2ShapeIndex::Iterator::Iterator(const DeltaS2ShapeIndex* index,
+                                             InitialPosition pos) {
+  Init(index, pos);
+}
+
+inline void DeltaS2ShapeIndex::Iterator::Init(const DeltaS2ShapeIndex* index,
+                                              InitialPosition pos) {
+  index_ = index;
+  base_it_.Init(index->base_);
+  if (pos == BEGIN) {
+    Begin();
+  } else {
+    Finish();
+  }
+}
+
+inline bool DeltaS2ShapeIndex::Iterator::at_base_cell() const {
+  return added_pos_ == index_->added_cell_ids_.size() ||
+         base_it_.id() < index_->added_cell_ids_[added_pos_];
+}
+
+inline void DeltaS2ShapeIndex::Iterator::Refresh() {
+  if (at_base_cell()) {
+    if (base_it_.done()) {
+      set_finished();
+    } else {
+      // The base cell is only fetched if it is needed, since the base index
+      // may decode cells on demand.
+      set_state(base_it_.id(), nullptr);
+    }
+  } else {
+    set_state(index_->added_cell_ids_[added_pos_],
+              index_->added_cells_[added_pos_].get());
+  }
+}
+
+inline void DeltaS2ShapeIndex::Iterator::SkipRemovedCells() {
+  while (!base_it_.done() && index_->is_removed(base_it_.id())) {
+    base_it_.Next();
+  }
+}
+
+inline void DeltaS2ShapeIndex::Iterator::Begin() {
+  base_it_.Begin();
+  SkipRemovedCells();
+  added_pos_ = 0;
+  Refresh();
+}
+
+inline void DeltaS2ShapeIndex::Iterator::Finish() {
+  base_it_.Finish();
+  added_pos_ = index_->added_cell_ids_.size();
+  Refresh();
+}
+
+inline void DeltaS2ShapeIndex::Iterator::Next() {
+  S2_DCHECK(!done());
+  if (at_base_cell()) {
+    base_it_.Next();
+    SkipRemovedCells();
+  } else {
+    ++added_pos_;
+  }
+  Refresh();
+}
+
+inline std::unique_ptr<DeltaS2ShapeIndex::IteratorBase>
+DeltaS2ShapeIndex::NewIterator(InitialPosition pos) const {
+  return absl::make_unique<Iterator>(this, pos);
+}
+
+#endif  // S2_DELTA_S2SHAPE_INDEX_H_
@@ -0,0 +1,188 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/delta_s2shape_index.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+unique_ptr<S2Shape> MakeLoopShape(const S2Point& center, double degrees) {
+  auto loop = S2Loop::MakeRegularLoop(center, S1Angle::Degrees(degrees), 50);
+  vector<S2Point> vertices;
+  for (int i = 0; i < loop->num_vertices(); ++i) {
+    vertices.push_back(loop->vertex(i));
+  }
+  return make_unique<S2LaxPolygonShape>(vector<vector<S2Point>>{vertices});
+}
+
+unique_ptr<S2Shape> MakePolylineShape(const S2Cap& cap) {
+  vector<S2Point> vertices;
+  for (int i = 0; i < 10; ++i) vertices.push_back(S2Testing::SamplePoint(cap));
+  return make_unique<S2LaxPolylineShape>(vertices);
+}
+
+// Appends an encoding of the shapes and cells of "index" to "encoder".
+template <class Index>
+void EncodeIndex(const Index& index, Encoder* encoder) {
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(index, encoder));
+  index.Encode(encoder);
+}
+
+// Checks that the iterators of "expected" and "actual" agree.
+void CheckIterators(const MutableS2ShapeIndex& expected,
+                    const DeltaS2ShapeIndex& actual) {
+  MutableS2ShapeIndex::Iterator expected_it(&expected, S2ShapeIndex::END);
+  DeltaS2ShapeIndex::Iterator it(&actual, S2ShapeIndex::END);
+  while (expected_it.Prev()) {
+    ASSERT_TRUE(it.Prev());
+    ASSERT_EQ(expected_it.id(), it.id());
+  }
+  EXPECT_FALSE(it.Prev());
+  for (int iter = 0; iter < 200; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId();
+    EXPECT_EQ(expected_it.Locate(id), it.Locate(id));
+    expected_it.Seek(id);
+    it.Seek(id);
+    ASSERT_EQ(expected_it.id(), it.id());
+    ASSERT_EQ(expected_it.Prev(), it.Prev());
+    ASSERT_EQ(expected_it.id(), it.id());
+  }
+}
+
+class DeltaS2ShapeIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    S2Testing::rnd.Reset(1);
+    MutableS2ShapeIndex index;
+    for (int i = 0; i < 50; ++i) {
+      index.Add(MakePolylineShape(
+          S2Cap(S2Testing::RandomPoint(), S1Angle::Degrees(3))));
+      index.Add(MakeLoopShape(S2Testing::RandomPoint(), 2));
+    }
+    EncodeIndex(index, &base_encoder_);
+    Decoder decoder(base_encoder_.base(), base_encoder_.length());
+    ASSERT_TRUE(base_.Init(&decoder,
+                           s2shapeutil::FullDecodeShapeFactory(&decoder)));
+
+    // "updated_" starts out as a copy of the base index.
+    decoder.reset(base_encoder_.base(), base_encoder_.length());
+    ASSERT_TRUE(updated_.Init(&decoder,
+                              s2shapeutil::FullDecodeShapeFactory(&decoder)));
+  }
+
+  Encoder base_encoder_;
+  EncodedS2ShapeIndex base_;
+  MutableS2ShapeIndex updated_;
+};
+
+TEST_F(DeltaS2ShapeIndexTest, NoChanges) {
+  Encoder encoder;
+  ASSERT_TRUE(DeltaS2ShapeIndex::EncodeDelta(base_, updated_, &encoder));
+  Decoder decoder(encoder.base(), encoder.length());
+  DeltaS2ShapeIndex index;
+  ASSERT_TRUE(index.Init(&base_, &decoder));
+  EXPECT_EQ(0, index.num_removed_cells());
+  EXPECT_EQ(0, index.num_added_cells());
+  s2testing::ExpectEqual(updated_, index);
+}
+
+TEST_F(DeltaS2ShapeIndexTest, AddAndRemoveShapes) {
+  updated_.Release(3);
+  updated_.Release(40);
+  S2Point center = S2Testing::RandomPoint();
+  updated_.Add(MakeLoopShape(center, 1));
+  updated_.Add(MakePolylineShape(S2Cap(center, S1Angle::Degrees(2))));
+  Encoder delta_encoder;
+  ASSERT_TRUE(DeltaS2ShapeIndex::EncodeDelta(base_, updated_,
+                                             &delta_encoder));
+  EXPECT_LT(delta_encoder.length(), base_encoder_.length() / 4);
+
+  Decoder decoder(delta_encoder.base(), delta_encoder.length());
+  DeltaS2ShapeIndex index;
+  ASSERT_TRUE(index.Init(&base_, &decoder));
+  EXPECT_GT(index.num_removed_cells(), 0);
+  EXPECT_GT(index.num_added_cells(), 0);
+  ASSERT_EQ(updated_.num_shape_ids(), index.num_shape_ids());
+  EXPECT_EQ(nullptr, index.shape(3));
+  EXPECT_EQ(base_.shape(4), index.shape(4));
+  EXPECT_EQ(101, index.shape(101)->id());
+  s2testing::ExpectEqual(updated_, index);
+  CheckIterators(updated_, index);
+  auto query = MakeS2ContainsPointQuery(&index);
+  EXPECT_TRUE(query.Contains(center));
+
+  // A second delta can be stacked on top of the first.
+  updated_.Release(100);
+  updated_.Add(MakeLoopShape(S2Testing::RandomPoint(), 3));
+  Encoder delta_encoder2;
+  ASSERT_TRUE(DeltaS2ShapeIndex::EncodeDelta(index, updated_,
+                                             &delta_encoder2));
+  Decoder decoder2(delta_encoder2.base(), delta_encoder2.length());
+  DeltaS2ShapeIndex index2;
+  ASSERT_TRUE(index2.Init(&index, &decoder2));
+  s2testing::ExpectEqual(updated_, index2);
+  CheckIterators(updated_, index2);
+
+  // Compacting the stack produces an ordinary encoded index.
+  Encoder compacted_encoder;
+  EncodeIndex(index2, &compacted_encoder);
+  Decoder compacted_decoder(compacted_encoder.base(),
+                            compacted_encoder.length());
+  EncodedS2ShapeIndex compacted;
+  ASSERT_TRUE(compacted.Init(
+      &compacted_decoder, s2shapeutil::LazyDecodeShapeFactory(
+                              &compacted_decoder)));
+  EXPECT_EQ(updated_.options().max_edges_per_cell(),
+            compacted.options().max_edges_per_cell());
+  s2testing::ExpectEqual(updated_, compacted);
+}
+
+TEST_F(DeltaS2ShapeIndexTest, WrongBase) {
+  updated_.Add(MakeLoopShape(S2Testing::RandomPoint(), 1));
+  Encoder encoder;
+  ASSERT_TRUE(DeltaS2ShapeIndex::EncodeDelta(base_, updated_, &encoder));
+  MutableS2ShapeIndex other;
+  Decoder decoder(encoder.base(), encoder.length());
+  DeltaS2ShapeIndex index;
+  EXPECT_FALSE(index.Init(&other, &decoder));
+
+  // "updated_" is not derived from "other".
+  other.Add(MakeLoopShape(S2Testing::RandomPoint(), 1));
+  other.Add(MakeLoopShape(S2Testing::RandomPoint(), 1));
+  other.Release(0);
+  EXPECT_FALSE(DeltaS2ShapeIndex::EncodeDelta(updated_, other, &encoder));
+}
+
+}  // namespace
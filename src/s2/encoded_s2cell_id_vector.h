@@ -70,6 +70,15 @@ class EncodedS2CellIdVector {
   // REQUIRES: The vector elements are sorted in non-decreasing order.
   size_t lower_bound(S2CellId target) const;
 
+  // Like lower_bound(target), except that the search starts at position
+  // "start" and uses galloping search (see EncodedUintVector).  This is
+  // efficient for sequences of increasing targets.
+  //
+  // REQUIRES: The vector elements are sorted in non-decreasing order.
+  // REQUIRES: start <= size(), and all elements before "start" are less than
+  //           "target".
+  size_t lower_bound(S2CellId target, size_t start) const;
+
   // Decodes and returns the entire original vector.
   std::vector<S2CellId> Decode() const;
 
@@ -105,6 +114,15 @@ inline size_t EncodedS2CellIdVector::lower_bound(S2CellId target) const {
       (target.id() - base_ + (1ULL << shift_) - 1) >> shift_);
 }
 
+inline size_t EncodedS2CellIdVector::lower_bound(S2CellId target,
+                                                 size_t start) const {
+  // See lower_bound(target) above.
+  if (target.id() <= base_) return start;
+  if (target >= S2CellId::End(S2CellId::kMaxLevel)) return size();
+  return deltas_.lower_bound(
+      (target.id() - base_ + (1ULL << shift_) - 1) >> shift_, start);
+}
+
 }  // namespace s2coding
 
 #endif  // S2_ENCODED_S2CELL_ID_VECTOR_H_
@@ -17,6 +17,7 @@
 
 #include "s2/encoded_s2cell_id_vector.h"
 
+#include <algorithm>
 #include <vector>
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
@@ -229,4 +230,25 @@ TEST(EncodedS2CellIdVector, LowerBoundLimits) {
   EXPECT_EQ(2, cell_ids.lower_bound(S2CellId::Sentinel()));
 }
 
+TEST(EncodedS2CellIdVector, LowerBoundWithStart) {
+  vector<S2CellId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(S2Testing::GetRandomCellId());
+  }
+  std::sort(ids.begin(), ids.end());
+  Encoder encoder;
+  EncodedS2CellIdVector cell_ids = MakeEncodedS2CellIdVector(ids, &encoder);
+  for (int i = 0; i < 100; ++i) {
+    S2CellId target = S2Testing::GetRandomCellId();
+    size_t expected = std::lower_bound(ids.begin(), ids.end(), target) -
+                      ids.begin();
+    for (size_t start = 0; start <= expected; ++start) {
+      EXPECT_EQ(expected, cell_ids.lower_bound(target, start));
+    }
+  }
+  // Also test seeking before the beginning and past the end of the vector.
+  EXPECT_EQ(0, cell_ids.lower_bound(S2CellId::None(), 0));
+  EXPECT_EQ(ids.size(), cell_ids.lower_bound(S2CellId::Sentinel(), 50));
+}
+
 }  // namespace s2coding
@@ -0,0 +1,90 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/encoded_s2cell_union.h"
+
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2latlng_rect.h"
+
+using std::vector;
+
+/*static*/ void EncodedS2CellUnion::Encode(const S2CellUnion& cell_union,
+                                           Encoder* encoder) {
+  S2_DCHECK(cell_union.IsValid());
+  s2coding::EncodeS2CellIdVector(cell_union.cell_ids(), encoder);
+}
+
+bool EncodedS2CellUnion::Init(Decoder* decoder) {
+  return cell_ids_.Init(decoder);
+}
+
+S2CellUnion EncodedS2CellUnion::Decode() const {
+  return S2CellUnion::FromVerbatim(cell_ids_.Decode());
+}
+
+bool EncodedS2CellUnion::Contains(S2CellId id) const {
+  // See S2CellUnion::Contains(S2CellId).
+  size_t i = cell_ids_.lower_bound(id);
+  if (i != cell_ids_.size() && cell_ids_[i].range_min() <= id) return true;
+  return i != 0 && cell_ids_[i - 1].range_max() >= id;
+}
+
+bool EncodedS2CellUnion::Intersects(S2CellId id) const {
+  // See S2CellUnion::Intersects(S2CellId).
+  size_t i = cell_ids_.lower_bound(id);
+  if (i != cell_ids_.size() && cell_ids_[i].range_min() <= id.range_max()) {
+    return true;
+  }
+  return i != 0 && cell_ids_[i - 1].range_max() >= id.range_min();
+}
+
+EncodedS2CellUnion* EncodedS2CellUnion::Clone() const {
+  return new EncodedS2CellUnion(*this);
+}
+
+S2Cap EncodedS2CellUnion::GetCapBound() const {
+  return Decode().GetCapBound();
+}
+
+S2LatLngRect EncodedS2CellUnion::GetRectBound() const {
+  return Decode().GetRectBound();
+}
+
+void EncodedS2CellUnion::GetCellUnionBound(vector<S2CellId> *cell_ids) const {
+  cell_ids->clear();
+  for (int face = 0; face < 6; ++face) {
+    S2CellId face_id = S2CellId::FromFace(face);
+    size_t begin = cell_ids_.lower_bound(face_id.range_min());
+    size_t end = cell_ids_.lower_bound(face_id.range_max().next(), begin);
+    if (begin == end) continue;
+    S2CellId first = cell_ids_[begin].range_min();
+    S2CellId last = cell_ids_[end - 1].range_max();
+    cell_ids->push_back(first.parent(first.GetCommonAncestorLevel(last)));
+  }
+}
+
+bool EncodedS2CellUnion::Contains(const S2Cell& cell) const {
+  return Contains(cell.id());
+}
+
+bool EncodedS2CellUnion::MayIntersect(const S2Cell& cell) const {
+  return Intersects(cell.id());
+}
+
+bool EncodedS2CellUnion::Contains(const S2Point& p) const {
+  return Contains(S2CellId(p));
+}
@@ -0,0 +1,110 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_ENCODED_S2CELL_UNION_H_
+#define S2_ENCODED_S2CELL_UNION_H_
+
+#include <vector>
+
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2region.h"
+#include "s2/util/coding/coder.h"
+
+class S2Cap;
+class S2Cell;
+class S2LatLngRect;
+
+// EncodedS2CellUnion is an S2Region representing an encoded S2CellUnion.
+// Unlike S2CellUnion::Decode(), initialization takes constant time and the
+// cell ids are decoded only as they are accessed, so a covering with many
+// millions of cells can be queried directly from its encoded form (e.g., a
+// memory-mapped file) without allocating a vector of S2CellIds.
+//
+// The cells are stored as an s2coding::EncodedS2CellIdVector, which
+// removes the common leading and trailing bits of the ids and bit-packs
+// the remaining deltas with a fixed width.  For coverings of small regions
+// this is several times smaller than S2CellUnion::Encode(), and since every
+// element can be accessed in constant time, Contains() and Intersects() are
+// binary searches just as for S2CellUnion.  Example usage:
+//
+//   Encoder encoder;
+//   EncodedS2CellUnion::Encode(covering, &encoder);
+//   ...
+//   Decoder decoder(data, size);
+//   EncodedS2CellUnion cell_union;
+//   if (!cell_union.Init(&decoder)) return false;
+//   if (cell_union.Contains(point)) ...
+//
+// REQUIRES: The S2CellUnion passed to Encode() is normalized, or at least
+//           sorted with no overlapping cells (see S2CellUnion::IsValid).
+class EncodedS2CellUnion final : public S2Region {
+ public:
+  // Appends an encoded representation of "cell_union" to "encoder".
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  static void Encode(const S2CellUnion& cell_union, Encoder* encoder);
+
+  // Constructs an uninitialized object; requires Init() to be called.
+  EncodedS2CellUnion() {}
+
+  // Initializes the object from data written by Encode().  Returns false if
+  // the data is malformed.
+  //
+  // REQUIRES: The Decoder data buffer must outlive this object.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of cells in the union.
+  int num_cells() const { return static_cast<int>(cell_ids_.size()); }
+
+  // Returns the cell at the given position.
+  S2CellId cell_id(int i) const { return cell_ids_[i]; }
+
+  // Decodes all the cells into an S2CellUnion.
+  S2CellUnion Decode() const;
+
+  // Returns true if the union contains or intersects the given cell id.
+  // These are fast operations (logarithmic in the size of the union).
+  bool Contains(S2CellId id) const;
+  bool Intersects(S2CellId id) const;
+
+  ////////////////////////////////////////////////////////////////////////
+  // S2Region interface (see s2region.h for details):
+
+  EncodedS2CellUnion* Clone() const override;
+
+  // These methods decode every cell, and are intended for use with
+  // S2RegionCoverer only when the union is not too large.
+  S2Cap GetCapBound() const override;
+  S2LatLngRect GetRectBound() const override;
+
+  // Returns at most one cell per cube face, namely the smallest cell that
+  // contains all the cells of the union on that face.
+  void GetCellUnionBound(std::vector<S2CellId> *cell_ids) const override;
+
+  bool Contains(const S2Cell& cell) const override;
+  bool MayIntersect(const S2Cell& cell) const override;
+
+  // The point 'p' does not need to be normalized.
+  bool Contains(const S2Point& p) const override;
+
+ private:
+  s2coding::EncodedS2CellIdVector cell_ids_;
+};
+
+#endif  // S2_ENCODED_S2CELL_UNION_H_
@@ -0,0 +1,109 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/encoded_s2cell_union.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+S2CellUnion MakeCovering(const S2Cap& cap, int max_cells) {
+  S2RegionCoverer::Options options;
+  options.set_max_cells(max_cells);
+  return S2RegionCoverer(options).GetCovering(cap);
+}
+
+TEST(EncodedS2CellUnion, Empty) {
+  Encoder encoder;
+  EncodedS2CellUnion::Encode(S2CellUnion(), &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2CellUnion cell_union;
+  ASSERT_TRUE(cell_union.Init(&decoder));
+  EXPECT_EQ(0, cell_union.num_cells());
+  EXPECT_FALSE(cell_union.Contains(S2CellId::FromFace(0)));
+  EXPECT_FALSE(cell_union.Intersects(S2CellId::FromFace(0)));
+  vector<S2CellId> bound;
+  cell_union.GetCellUnionBound(&bound);
+  EXPECT_TRUE(bound.empty());
+}
+
+TEST(EncodedS2CellUnion, MatchesS2CellUnion) {
+  S2Testing::rnd.Reset(1);
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(30));
+  S2CellUnion covering = MakeCovering(cap, 2000);
+  Encoder encoder;
+  EncodedS2CellUnion::Encode(covering, &encoder);
+  Encoder plain_encoder;
+  covering.Encode(&plain_encoder);
+  EXPECT_LT(encoder.length(), plain_encoder.length());
+
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2CellUnion cell_union;
+  ASSERT_TRUE(cell_union.Init(&decoder));
+  ASSERT_EQ(covering.num_cells(), cell_union.num_cells());
+  EXPECT_EQ(covering, cell_union.Decode());
+
+  unique_ptr<EncodedS2CellUnion> clone(cell_union.Clone());
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId();
+    if (iter % 2) {
+      id = S2CellId(S2Testing::SamplePoint(cap))
+               .parent(S2Testing::rnd.Uniform(S2CellId::kMaxLevel + 1));
+    }
+    EXPECT_EQ(covering.Contains(id), clone->Contains(id));
+    EXPECT_EQ(covering.Intersects(id), clone->Intersects(id));
+    S2Cell cell(id);
+    EXPECT_EQ(covering.Contains(cell), clone->Contains(cell));
+    EXPECT_EQ(covering.MayIntersect(cell), clone->MayIntersect(cell));
+    S2Point p = cell.GetCenter();
+    EXPECT_EQ(covering.Contains(p), clone->Contains(p));
+  }
+
+  // The cell union bound must contain every cell.
+  vector<S2CellId> bound;
+  cell_union.GetCellUnionBound(&bound);
+  EXPECT_LE(bound.size(), 6);
+  S2CellUnion bound_union(bound);
+  EXPECT_TRUE(bound_union.Contains(covering));
+  EXPECT_TRUE(cell_union.GetCapBound().Contains(covering.GetCapBound()));
+}
+
+TEST(EncodedS2CellUnion, CoveringOfEncodedUnion) {
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(5));
+  S2CellUnion covering = MakeCovering(cap, 100);
+  Encoder encoder;
+  EncodedS2CellUnion::Encode(covering, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2CellUnion cell_union;
+  ASSERT_TRUE(cell_union.Init(&decoder));
+  S2RegionCoverer::Options options;
+  options.set_max_cells(1000);
+  S2CellUnion result = S2RegionCoverer(options).GetCovering(cell_union);
+  EXPECT_TRUE(result.Contains(covering));
+}
+
+}  // namespace
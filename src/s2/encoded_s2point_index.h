@@ -0,0 +1,316 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#ifndef S2_ENCODED_S2POINT_INDEX_H_
+#define S2_ENCODED_S2POINT_INDEX_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "s2/base/logging.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_s2point_vector.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point_index.h"
+#include "s2/util/coding/coder.h"
+
+// EncodedS2PointIndex is a read-only version of S2PointIndex that works
+// directly with data written by S2PointIndex::Encode().  Initialization takes
+// time proportional to the number of points divided by kBlockSize (rather
+// than the O(n log n) time needed to rebuild an S2PointIndex), and points are
+// decoded on demand in small blocks as they are visited.  This makes it
+// possible to load very large point sets almost instantly, e.g. from a
+// memory-mapped file.
+//
+// The class provides the same Iterator interface as S2PointIndex, so it can
+// be used with S2ClosestPointQuery by specifying it as the index type:
+//
+//   Encoder encoder;
+//   point_index.Encode(&encoder);
+//   ...
+//   Decoder decoder(data, size);
+//   EncodedS2PointIndex<int> index;
+//   if (!index.Init(&decoder)) ...
+//   S2ClosestPointQuery<int, EncodedS2PointIndex<int>> query(&index);
+//
+// The index is thread-safe for concurrent readers.  Decoded points are cached
+// until Minimize() is called or the index is destroyed.
+//
+// REQUIRES: "Data" is an integral type or an empty class.
+template <class Data = std::tuple<> /*empty class*/>
+class EncodedS2PointIndex {
+ public:
+  // The (S2Point, data) pairs returned by the iterator.  This is the same
+  // type used by S2PointIndex.
+  using PointData = typename S2PointIndex<Data>::PointData;
+
+  // The number of points that are decoded together.  Matches the block size
+  // of the compact EncodedS2PointVector format so that each block of points
+  // can be decoded with a single call.
+  static constexpr int kBlockSize = s2coding::EncodedS2PointVector::kBlockSize;
+
+  // Creates an index that must be initialized by calling Init().
+  EncodedS2PointIndex();
+  ~EncodedS2PointIndex();
+
+  // Initializes the index from data written by S2PointIndex::Encode().
+  // Returns false on errors.
+  //
+  // REQUIRES: The Decoder data buffer must outlive this object.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of points in the index.
+  int num_points() const;
+
+  // Discards all decoded points in order to reduce memory usage.
+  //
+  // REQUIRES: No iterators, queries, or query results that refer to this
+  //           index are in use.
+  void Minimize();
+
+  class Iterator {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator();
+
+    // Convenience constructor that calls Init().
+    explicit Iterator(const EncodedS2PointIndex* index);
+
+    // Initializes an iterator for the given EncodedS2PointIndex.  If the
+    // index is non-empty, the iterator is positioned at the first cell.
+    void Init(const EncodedS2PointIndex* index);
+
+    // The S2CellId for the current index entry.
+    // REQUIRES: !done()
+    S2CellId id() const;
+
+    // The point associated with the current index entry.
+    // REQUIRES: !done()
+    const S2Point& point() const;
+
+    // The client-supplied data associated with the current index entry.
+    // REQUIRES: !done()
+    const Data& data() const;
+
+    // The (S2Point, data) pair associated with the current index entry.  The
+    // reference remains valid until the index is minimized or destroyed.
+    // REQUIRES: !done()
+    const PointData& point_data() const;
+
+    // Returns true if the iterator is positioned past the last index entry.
+    bool done() const;
+
+    // Positions the iterator at the first index entry (if any).
+    void Begin();
+
+    // Positions the iterator so that done() is true.
+    void Finish();
+
+    // Advances the iterator to the next index entry.
+    // REQUIRES: !done()
+    void Next();
+
+    // If the iterator is already positioned at the beginning, returns false.
+    // Otherwise positions the iterator at the previous entry and returns true.
+    bool Prev();
+
+    // Positions the iterator at the first entry with id() >= target, or at the
+    // end of the index if no such entry exists.
+    void Seek(S2CellId target);
+
+   private:
+    const EncodedS2PointIndex* index_;
+    int pos_;
+  };
+
+ private:
+  // Returns the decoded (point, data) pair at position "i".
+  const PointData& point_data(int i) const;
+
+  // Decodes the given block of points and returns a pointer to its first
+  // element.
+  const PointData* DecodeBlock(int block) const;
+
+  s2coding::EncodedS2CellIdVector cell_ids_;
+  s2coding::EncodedS2PointVector points_;
+  s2coding::internal::EncodedPointIndexData<Data> data_;
+
+  // The decoded blocks of points.  Initially all values are nullptr; blocks
+  // are decoded on demand and added to the vector using
+  // std::atomic::compare_exchange_strong.
+  mutable std::vector<std::atomic<PointData*>> blocks_;
+
+  EncodedS2PointIndex(const EncodedS2PointIndex&) = delete;
+  void operator=(const EncodedS2PointIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Data>
+constexpr int EncodedS2PointIndex<Data>::kBlockSize;
+
+template <class Data>
+EncodedS2PointIndex<Data>::EncodedS2PointIndex() {
+}
+
+template <class Data>
+EncodedS2PointIndex<Data>::~EncodedS2PointIndex() {
+  Minimize();
+}
+
+template <class Data>
+bool EncodedS2PointIndex<Data>::Init(Decoder* decoder) {
+  Minimize();
+  uint64 version;
+  if (!decoder->get_varint64(&version)) return false;
+  if (version != s2coding::internal::kS2PointIndexEncodingVersion) {
+    return false;
+  }
+  if (!cell_ids_.Init(decoder)) return false;
+  if (!points_.Init(decoder)) return false;
+  if (points_.size() != cell_ids_.size()) return false;
+  if (!data_.Init(decoder, points_.size())) return false;
+  std::vector<std::atomic<PointData*>> blocks(
+      (points_.size() + kBlockSize - 1) / kBlockSize);
+  for (auto& block : blocks) block.store(nullptr, std::memory_order_relaxed);
+  blocks_.swap(blocks);
+  return true;
+}
+
+template <class Data>
+inline int EncodedS2PointIndex<Data>::num_points() const {
+  return points_.size();
+}
+
+template <class Data>
+void EncodedS2PointIndex<Data>::Minimize() {
+  for (auto& block : blocks_) {
+    delete[] block.exchange(nullptr, std::memory_order_relaxed);
+  }
+}
+
+template <class Data>
+inline const typename EncodedS2PointIndex<Data>::PointData&
+EncodedS2PointIndex<Data>::point_data(int i) const {
+  const PointData* block =
+      blocks_[i / kBlockSize].load(std::memory_order_acquire);
+  if (block == nullptr) block = DecodeBlock(i / kBlockSize);
+  return block[i % kBlockSize];
+}
+
+template <class Data>
+const typename EncodedS2PointIndex<Data>::PointData*
+EncodedS2PointIndex<Data>::DecodeBlock(int block) const {
+  // For thread safety, we first decode the block and then assign it
+  // atomically using a compare-and-swap operation.
+  int start = block * kBlockSize;
+  int count = std::min<int>(kBlockSize, num_points() - start);
+  S2Point points[kBlockSize];
+  points_.Decode(start, count, points);
+  std::unique_ptr<PointData[]> decoded(new PointData[count]);
+  for (int i = 0; i < count; ++i) {
+    decoded[i] = PointData(points[i], data_[start + i]);
+  }
+  PointData* expected = nullptr;
+  if (!blocks_[block].compare_exchange_strong(expected, decoded.get(),
+                                              std::memory_order_acq_rel)) {
+    // Another thread decoded the block first, so use its copy.
+    return expected;
+  }
+  return decoded.release();
+}
+
+template <class Data>
+inline EncodedS2PointIndex<Data>::Iterator::Iterator()
+    : index_(nullptr), pos_(0) {
+}
+
+template <class Data>
+inline EncodedS2PointIndex<Data>::Iterator::Iterator(
+    const EncodedS2PointIndex* index) {
+  Init(index);
+}
+
+template <class Data>
+inline void EncodedS2PointIndex<Data>::Iterator::Init(
+    const EncodedS2PointIndex* index) {
+  index_ = index;
+  pos_ = 0;
+}
+
+template <class Data>
+inline S2CellId EncodedS2PointIndex<Data>::Iterator::id() const {
+  S2_DCHECK(!done());
+  return index_->cell_ids_[pos_];
+}
+
+template <class Data>
+inline const S2Point& EncodedS2PointIndex<Data>::Iterator::point() const {
+  return point_data().point();
+}
+
+template <class Data>
+inline const Data& EncodedS2PointIndex<Data>::Iterator::data() const {
+  return point_data().data();
+}
+
+template <class Data>
+inline const typename EncodedS2PointIndex<Data>::PointData&
+EncodedS2PointIndex<Data>::Iterator::point_data() const {
+  S2_DCHECK(!done());
+  return index_->point_data(pos_);
+}
+
+template <class Data>
+inline bool EncodedS2PointIndex<Data>::Iterator::done() const {
+  return pos_ == index_->num_points();
+}
+
+template <class Data>
+inline void EncodedS2PointIndex<Data>::Iterator::Begin() {
+  pos_ = 0;
+}
+
+template <class Data>
+inline void EncodedS2PointIndex<Data>::Iterator::Finish() {
+  pos_ = index_->num_points();
+}
+
+template <class Data>
+inline void EncodedS2PointIndex<Data>::Iterator::Next() {
+  S2_DCHECK(!done());
+  ++pos_;
+}
+
+template <class Data>
+inline bool EncodedS2PointIndex<Data>::Iterator::Prev() {
+  if (pos_ == 0) return false;
+  --pos_;
+  return true;
+}
+
+template <class Data>
+inline void EncodedS2PointIndex<Data>::Iterator::Seek(S2CellId target) {
+  pos_ = index_->cell_ids_.lower_bound(target);
+}
+
+#endif  // S2_ENCODED_S2POINT_INDEX_H_
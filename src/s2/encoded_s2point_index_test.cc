@@ -0,0 +1,231 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "s2/encoded_s2point_index.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2point_index.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+template <class Data>
+unique_ptr<EncodedS2PointIndex<Data>> EncodeAndInit(
+    const S2PointIndex<Data>& index, Encoder* encoder) {
+  index.Encode(encoder);
+  Decoder decoder(encoder->base(), encoder->length());
+  auto encoded = absl::make_unique<EncodedS2PointIndex<Data>>();
+  EXPECT_TRUE(encoded->Init(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+  return encoded;
+}
+
+// Checks that both indexes contain the same entries in the same order, and
+// that seeking to random cells gives the same results.
+template <class Data>
+void CheckIteratorsMatch(const S2PointIndex<Data>& index,
+                         const EncodedS2PointIndex<Data>& encoded) {
+  ASSERT_EQ(index.num_points(), encoded.num_points());
+  typename S2PointIndex<Data>::Iterator it(&index);
+  typename EncodedS2PointIndex<Data>::Iterator encoded_it(&encoded);
+  for (; !it.done(); it.Next(), encoded_it.Next()) {
+    ASSERT_FALSE(encoded_it.done());
+    EXPECT_EQ(it.id(), encoded_it.id());
+    EXPECT_EQ(it.point(), encoded_it.point());
+    EXPECT_TRUE(it.data() == encoded_it.data());
+  }
+  EXPECT_TRUE(encoded_it.done());
+  for (int i = 0; i < 100; ++i) {
+    S2CellId target = S2Testing::GetRandomCellId(S2CellId::kMaxLevel);
+    it.Seek(target);
+    encoded_it.Seek(target);
+    ASSERT_EQ(it.done(), encoded_it.done());
+    if (!it.done()) EXPECT_EQ(it.point_data(), encoded_it.point_data());
+    bool has_prev = it.Prev();
+    ASSERT_EQ(has_prev, encoded_it.Prev());
+    if (has_prev) EXPECT_EQ(it.point_data(), encoded_it.point_data());
+  }
+  it.Finish();
+  encoded_it.Finish();
+  EXPECT_TRUE(encoded_it.done());
+  ASSERT_EQ(it.Prev(), encoded_it.Prev());
+}
+
+TEST(EncodedS2PointIndex, Empty) {
+  S2PointIndex<int> index;
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  EXPECT_EQ(0, encoded->num_points());
+  EncodedS2PointIndex<int>::Iterator it(encoded.get());
+  EXPECT_TRUE(it.done());
+  EXPECT_FALSE(it.Prev());
+  it.Seek(S2CellId::FromFace(3));
+  EXPECT_TRUE(it.done());
+}
+
+TEST(EncodedS2PointIndex, MatchesS2PointIndex) {
+  S2Testing::rnd.Reset(1);
+  S2PointIndex<int> index;
+  for (int i = 0; i < 1000; ++i) {
+    S2Point point = S2Testing::RandomPoint();
+    // Include negative values and some duplicate points.
+    index.Add(point, i - 500);
+    if (i % 10 == 0) index.Add(point, i);
+  }
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  CheckIteratorsMatch(index, *encoded);
+
+  // Decoded points are released by Minimize() and decoded again on demand.
+  encoded->Minimize();
+  CheckIteratorsMatch(index, *encoded);
+}
+
+TEST(EncodedS2PointIndex, EmptyData) {
+  S2Testing::rnd.Reset(2);
+  S2PointIndex<> index;
+  for (int i = 0; i < 100; ++i) index.Add(S2Testing::RandomPoint());
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  CheckIteratorsMatch(index, *encoded);
+}
+
+TEST(EncodedS2PointIndex, Int64Data) {
+  S2Testing::rnd.Reset(3);
+  S2PointIndex<int64> index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add(S2Testing::RandomPoint(), int64{i} << 40);
+  }
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  CheckIteratorsMatch(index, *encoded);
+}
+
+TEST(EncodedS2PointIndex, SnappedPointsAreCompact) {
+  // Points snapped to S2CellId centers with consecutive labels take much
+  // less space than the 36 bytes needed to store each S2CellId, point, and
+  // label exactly.
+  S2Testing::rnd.Reset(4);
+  S2PointIndex<int> index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  const int kNumPoints = 1000;
+  for (int i = 0; i < kNumPoints; ++i) {
+    S2CellId id(S2Testing::SamplePoint(cap));
+    index.Add(id.parent(20).ToPoint(), i);
+  }
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  EXPECT_LT(encoder.length(), 16 * kNumPoints);
+  CheckIteratorsMatch(index, *encoded);
+}
+
+TEST(EncodedS2PointIndex, InvalidEncodings) {
+  S2Testing::rnd.Reset(5);
+  S2PointIndex<int> index;
+  for (int i = 0; i < 100; ++i) index.Add(S2Testing::RandomPoint(), i);
+  Encoder encoder;
+  index.Encode(&encoder);
+  for (size_t length = 0; length < encoder.length(); length += 7) {
+    Decoder decoder(encoder.base(), length);
+    EncodedS2PointIndex<int> encoded;
+    EXPECT_FALSE(encoded.Init(&decoder)) << length;
+  }
+  // Indexes with empty data cannot be decoded as indexes with data.
+  S2PointIndex<> empty_data_index;
+  empty_data_index.Add(S2Testing::RandomPoint());
+  Encoder empty_data_encoder;
+  empty_data_index.Encode(&empty_data_encoder);
+  Decoder decoder(empty_data_encoder.base(), empty_data_encoder.length());
+  EncodedS2PointIndex<int> encoded;
+  EXPECT_FALSE(encoded.Init(&decoder));
+}
+
+TEST(EncodedS2PointIndex, ClosestPointQuery) {
+  S2Testing::rnd.Reset(6);
+  S2PointIndex<int> index;
+  for (int i = 0; i < 10000; ++i) index.Add(S2Testing::RandomPoint(), i);
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+
+  S2ClosestPointQuery<int> query(&index);
+  S2ClosestPointQuery<int, EncodedS2PointIndex<int>> encoded_query(
+      encoded.get());
+  for (auto* options : {query.mutable_options(),
+                        encoded_query.mutable_options()}) {
+    options->set_max_results(10);
+    options->set_max_distance(S1Angle::Degrees(20));
+  }
+  for (int i = 0; i < 100; ++i) {
+    S2ClosestPointQuery<int>::PointTarget target(S2Testing::RandomPoint());
+    auto expected = query.FindClosestPoints(&target);
+    auto actual = encoded_query.FindClosestPoints(&target);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].distance(), actual[j].distance());
+      EXPECT_EQ(expected[j].point(), actual[j].point());
+      EXPECT_EQ(expected[j].data(), actual[j].data());
+    }
+    EXPECT_EQ(query.FindClosestPoint(&target).data(),
+              encoded_query.FindClosestPoint(&target).data());
+  }
+}
+
+TEST(EncodedS2PointIndex, ConcurrentQueries) {
+  S2Testing::rnd.Reset(7);
+  S2PointIndex<int> index;
+  for (int i = 0; i < 10000; ++i) index.Add(S2Testing::RandomPoint(), i);
+  Encoder encoder;
+  auto encoded = EncodeAndInit(index, &encoder);
+  vector<S2Point> targets;
+  for (int i = 0; i < 100; ++i) targets.push_back(S2Testing::RandomPoint());
+
+  // Each thread decodes points on demand from the same encoded index.
+  const int kNumThreads = 4;
+  vector<vector<int>> results(kNumThreads);
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&encoded, &targets, &results, t]() {
+      S2ClosestPointQuery<int, EncodedS2PointIndex<int>> query(encoded.get());
+      for (const S2Point& point : targets) {
+        S2ClosestPointQuery<int>::PointTarget target(point);
+        results[t].push_back(query.FindClosestPoint(&target).data());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  S2ClosestPointQuery<int> query(&index);
+  for (int i = 0; i < targets.size(); ++i) {
+    S2ClosestPointQuery<int>::PointTarget target(targets[i]);
+    int expected = query.FindClosestPoint(&target).data();
+    for (int t = 0; t < kNumThreads; ++t) EXPECT_EQ(expected, results[t][i]);
+  }
+}
+
+}  // namespace
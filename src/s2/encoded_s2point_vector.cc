@@ -17,6 +17,11 @@
 
 #include "s2/encoded_s2point_vector.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "s2/s2coords.h"
+
 using absl::Span;
 using std::vector;
 
@@ -30,10 +35,108 @@ namespace s2coding {
 // need to do that.
 static const int kEncodingFormatBits = 3;
 
+const int EncodedS2PointVector::kBlockSize;
+
+// Each point of a CELL_ID block begins with a varint64 whose two low bits
+// are one of the following tags:
+//
+//  - kDelta: the remaining bits are the zigzag-encoded change in "i", and
+//    are followed by a varint64 with the zigzag-encoded change in "j".  The
+//    face is unchanged.
+//  - kAbsolute: the remaining bits are the face, and are followed by
+//    varint64 values for "i" and "j".
+//  - kRaw: the point is not a cell center, and is stored as an S2Point.
+//
+// Here "i" and "j" are the point's (si, ti) coordinates shifted right by the
+// block vector's shift.  The point after a kRaw point (or the first point of
+// a block) never uses kDelta.
+static const int kTagBits = 2;
+enum CellIdTag { kDelta = 0, kAbsolute = 1, kRaw = 2 };
+
+static uint64 EncodeDelta(uint64 a, uint64 b) {
+  int64 delta = static_cast<int64>(b - a);
+  return (static_cast<uint64>(delta) << 1) ^ static_cast<uint64>(delta >> 63);
+}
+
+static uint64 DecodeDelta(uint64 a, uint64 zigzag) {
+  return a + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+}
+
+// Encodes the points of "v" as CELL_ID blocks into "encoder" (using a
+// StringVectorEncoder), setting "shift" to the shift applied to the cell
+// coordinates.  Returns false if none of the points is a cell center.
+static bool EncodeCellIdBlocks(Span<const S2Point> v, int* shift,
+                               Encoder* encoder) {
+  struct CellCoords {
+    int face;
+    unsigned int si, ti;
+    int level;
+  };
+  vector<CellCoords> coords(v.size());
+  int max_level = -1;
+  for (int i = 0; i < v.size(); ++i) {
+    CellCoords* c = &coords[i];
+    c->level = S2::XYZtoFaceSiTi(v[i], &c->face, &c->si, &c->ti);
+    max_level = std::max(max_level, c->level);
+  }
+  if (max_level < 0) return false;
+
+  // Every cell center at a level <= max_level has (si, ti) values that are
+  // multiples of 2**shift.
+  *shift = S2::kMaxCellLevel - max_level;
+  const int kBlockSize = EncodedS2PointVector::kBlockSize;
+  StringVectorEncoder blocks;
+  for (int start = 0; start < v.size(); start += kBlockSize) {
+    int end = std::min<int>(v.size(), start + kBlockSize);
+    Encoder* block = blocks.AddViaEncoder();
+    block->Ensure((end - start) * (2 * Varint::kMax64 + sizeof(S2Point)));
+    const CellCoords* prev = nullptr;
+    for (int k = start; k < end; ++k) {
+      const CellCoords& c = coords[k];
+      if (c.level < 0) {
+        block->put_varint64(kRaw);
+        block->putn(&v[k], sizeof(S2Point));
+        prev = nullptr;
+        continue;
+      }
+      uint64 i = c.si >> *shift, j = c.ti >> *shift;
+      if (prev != nullptr && prev->face == c.face) {
+        uint64 prev_i = prev->si >> *shift, prev_j = prev->ti >> *shift;
+        block->put_varint64(EncodeDelta(prev_i, i) << kTagBits | kDelta);
+        block->put_varint64(EncodeDelta(prev_j, j));
+      } else {
+        block->put_varint64(static_cast<uint64>(c.face) << kTagBits |
+                            kAbsolute);
+        block->put_varint64(i);
+        block->put_varint64(j);
+      }
+      prev = &c;
+    }
+  }
+  blocks.Encode(encoder);
+  return true;
+}
+
 void EncodeS2PointVector(Span<const S2Point> v, CodingHint hint,
                          Encoder* encoder) {
-  // TODO(ericv): Implement CodingHint::COMPACT.
-
+  if (hint == CodingHint::COMPACT) {
+    // Use the CELL_ID format only if it is smaller.
+    int shift;
+    Encoder blocks;
+    const size_t uncompressed_bytes =
+        Varint::Length64(v.size() << kEncodingFormatBits) +
+        v.size() * sizeof(S2Point);
+    if (EncodeCellIdBlocks(v, &shift, &blocks) &&
+        Varint::Length64(v.size() << kEncodingFormatBits) + 1 +
+        blocks.length() < uncompressed_bytes) {
+      encoder->Ensure(Varint::kMax64 + 1 + blocks.length());
+      encoder->put_varint64(v.size() << kEncodingFormatBits |
+                            EncodedS2PointVector::CELL_ID);
+      encoder->put8(shift);
+      encoder->putn(blocks.base(), blocks.length());
+      return;
+    }
+  }
   encoder->Ensure(Varint::kMax64 + v.size() * sizeof(S2Point));
   uint64 size_format = (v.size() << kEncodingFormatBits |
                         EncodedS2PointVector::UNCOMPRESSED);
@@ -45,7 +148,7 @@ bool EncodedS2PointVector::Init(Decoder* decoder) {
   uint64 size_format;
   if (!decoder->get_varint64(&size_format)) return false;
   format_ = static_cast<Format>(size_format & ((1 << kEncodingFormatBits) - 1));
-  if (format_ != UNCOMPRESSED) return false;
+  if (format_ != UNCOMPRESSED && format_ != CELL_ID) return false;
 
   // Note that the encoding format supports up to 2**59 vertices, but we
   // currently only support decoding up to 2**32 vertices.
@@ -53,16 +156,113 @@ bool EncodedS2PointVector::Init(Decoder* decoder) {
   if (size_format > std::numeric_limits<uint32>::max()) return false;
   size_ = size_format;
 
+  if (format_ == CELL_ID) {
+    if (decoder->avail() < 1) return false;
+    cell_id_.shift = decoder->get8();
+    if (cell_id_.shift > S2::kMaxCellLevel) return false;
+    if (!cell_id_.blocks.Init(decoder)) return false;
+    return cell_id_.blocks.size() == (size_t{size_} + kBlockSize - 1) /
+                                     kBlockSize;
+  }
   size_t bytes = size_t{size_} * sizeof(S2Point);
   if (decoder->avail() < bytes) return false;
 
-  uncompressed_.points = reinterpret_cast<const S2Point*>(decoder->ptr());
+  uncompressed_.points = reinterpret_cast<const char*>(decoder->ptr());
   decoder->skip(bytes);
   return true;
 }
 
 vector<S2Point> EncodedS2PointVector::Decode() const {
-  return vector<S2Point>(uncompressed_.points, uncompressed_.points + size_);
+  vector<S2Point> result(size_);
+  Decode(0, size_, result.data());
+  return result;
+}
+
+void EncodedS2PointVector::Decode(int start, int count,
+                                  S2Point* output) const {
+  S2_DCHECK(start >= 0 && count >= 0 && start + count <= size_);
+  switch (format_) {
+    case UNCOMPRESSED:
+      if (count == 0) return;
+      memcpy(output, uncompressed_.points +
+                         static_cast<size_t>(start) * sizeof(S2Point),
+             static_cast<size_t>(count) * sizeof(S2Point));
+      return;
+
+    case CELL_ID:
+      for (int end = start + count; start < end;) {
+        int block = start / kBlockSize;
+        int begin = start - block * kBlockSize;
+        int block_end = std::min(kBlockSize, end - block * kBlockSize);
+        DecodeCellIdBlock(block, begin, block_end, output);
+        output += block_end - begin;
+        start += block_end - begin;
+      }
+      return;
+  }
+}
+
+// Decodes the next point of a CELL_ID block, where "face", "i", and "j" hold
+// the previous cell coordinates (with face == -1 if there are none).  The
+// point is only computed if "p" is non-null.  Returns false on corrupt data.
+static bool DecodeCellIdPoint(Decoder* decoder, int shift, int* face,
+                              uint64* i, uint64* j, S2Point* p) {
+  uint64 tag;
+  if (!decoder->get_varint64(&tag)) return false;
+  switch (tag & ((1 << kTagBits) - 1)) {
+    case kRaw:
+      if (decoder->avail() < sizeof(S2Point)) return false;
+      if (p != nullptr) {
+        decoder->getn(p, sizeof(S2Point));
+      } else {
+        decoder->skip(sizeof(S2Point));
+      }
+      *face = -1;
+      return true;
+
+    case kAbsolute:
+      *face = tag >> kTagBits;
+      if (*face >= 6 || !decoder->get_varint64(i) ||
+          !decoder->get_varint64(j)) {
+        return false;
+      }
+      break;
+
+    case kDelta: {
+      uint64 dj;
+      if (*face < 0 || !decoder->get_varint64(&dj)) return false;
+      *i = DecodeDelta(*i, tag >> kTagBits);
+      *j = DecodeDelta(*j, dj);
+      break;
+    }
+
+    default:
+      return false;
+  }
+  if (*i > (S2::kMaxSiTi >> shift) || *j > (S2::kMaxSiTi >> shift)) {
+    return false;
+  }
+  if (p != nullptr) {
+    *p = S2::FaceSiTitoXYZ(*face, *i << shift, *j << shift).Normalize();
+  }
+  return true;
+}
+
+void EncodedS2PointVector::DecodeCellIdBlock(int block, int begin, int end,
+                                             S2Point* output) const {
+  Decoder decoder = cell_id_.blocks.GetDecoder(block);
+  int face = -1;
+  uint64 i = 0, j = 0;
+  for (int k = 0; k < end; ++k) {
+    S2Point* p = (k < begin) ? nullptr : &output[k - begin];
+    if (!DecodeCellIdPoint(&decoder, cell_id_.shift, &face, &i, &j, p)) {
+      // Init() does not validate the blocks (so that it takes constant
+      // time), so corrupt points are decoded as S2Point(0, 0, 0).
+      std::fill(output + std::max(0, k - begin), output + (end - begin),
+                S2Point());
+      return;
+    }
+  }
 }
 
 }  // namespace s2coding
@@ -18,16 +18,24 @@
 #ifndef S2_ENCODED_S2POINT_VECTOR_H_
 #define S2_ENCODED_S2POINT_VECTOR_H_
 
+#include <cstring>
+
 #include "s2/third_party/absl/types/span.h"
+#include "s2/encoded_string_vector.h"
 #include "s2/encoded_uint_vector.h"
 #include "s2/s2point.h"
 
 namespace s2coding {
 
-// Controls whether to optimize for speed or size when encoding points.  (Note
-// that encoding is always lossless, and that currently compact encodings are
-// only possible when points have been snapped to S2CellId centers.)
-enum CodingHint { FAST, COMPACT };
+// Note that CodingHint is defined in encoded_uint_vector.h.  When encoding
+// points, compact encodings are currently only possible when points have been
+// snapped to S2CellId centers.
+//
+// With CodingHint::COMPACT, points that are S2CellId centers are stored as
+// delta-encoded (i, j) cell coordinates at the finest level used by any of
+// them, in blocks of kBlockSize points so that any point can be decoded
+// without decoding the whole vector.  Other points are stored exactly.  The
+// uncompressed format is used instead if it would be smaller.
 
 // Encodes a vector of S2Points in a format that can later be decoded as an
 // EncodedS2PointVector.
@@ -47,6 +55,11 @@ void EncodeS2PointVector(absl::Span<const S2Point> v, CodingHint hint,
 // be initialized from an encoded format in constant time and then decoded on
 // demand.  This can be a big performance advantage when only a small part of
 // the data structure is actually used.
+//
+// Uncompressed points are read directly from the encoded data, which need not
+// have any particular alignment (the points are usually preceded by a
+// varint).  Each access is a fixed-size memcpy, which compiles to ordinary
+// unaligned loads.
 class EncodedS2PointVector {
  public:
   // Constructs an uninitialized object; requires Init() to be called.
@@ -66,6 +79,18 @@ class EncodedS2PointVector {
   // Decodes and returns the entire original vector.
   std::vector<S2Point> Decode() const;
 
+  // Decodes the "count" elements starting at index "start" into "output",
+  // which must have room for "count" points.  This is much faster than
+  // calling operator[] repeatedly since any per-block decoding work is done
+  // only once.
+  //
+  // REQUIRES: 0 <= start && start + count <= size()
+  void Decode(int start, int count, S2Point* output) const;
+
+  // The number of points in each separately decodable block of the CELL_ID
+  // format.
+  static const int kBlockSize = 16;
+
  private:
   // We use a tagged union to represent multiple formats, as opposed to an
   // abstract base class or templating.  This represents the best compromise
@@ -84,12 +109,20 @@ class EncodedS2PointVector {
   uint32 size_;
   union {
     struct {
-      const S2Point* points;
+      // Not necessarily aligned for S2Point.
+      const char* points;
     } uncompressed_;
-    struct {
-      // TODO(ericv): Implement.
-    } cell_id_;
   };
+  struct {
+    // The cell coordinates are stored shifted right by this many bits.
+    int shift;
+    EncodedStringVector blocks;
+  } cell_id_;
+
+  // Decodes points [begin, end) of the given CELL_ID block into "output".
+  void DecodeCellIdBlock(int block, int begin, int end,
+                         S2Point* output) const;
+
   friend void EncodeS2PointVector(absl::Span<const S2Point>, CodingHint,
                                   Encoder*);
 };
@@ -104,13 +137,20 @@ inline size_t EncodedS2PointVector::size() const {
 
 inline S2Point EncodedS2PointVector::operator[](int i) const {
   switch (format_) {
-    case UNCOMPRESSED:
-      return uncompressed_.points[i];
+    case UNCOMPRESSED: {
+      S2Point p;
+      memcpy(&p,
+             uncompressed_.points + static_cast<size_t>(i) * sizeof(S2Point),
+             sizeof(S2Point));
+      return p;
+    }
 
     case CELL_ID:
-      S2_LOG(FATAL) << "Not implemented yet";
-      return S2Point();
+      break;
   }
+  S2Point p;
+  DecodeCellIdBlock(i / kBlockSize, i % kBlockSize, i % kBlockSize + 1, &p);
+  return p;
 }
 
 }  // namespace s2coding
@@ -19,6 +19,8 @@
 
 #include <vector>
 #include <gtest/gtest.h>
+#include "s2/s2cell_id.h"
+#include "s2/s2testing.h"
 
 using std::vector;
 
@@ -51,4 +53,126 @@ TEST(EncodedS2PointVectorTest, TenPoints) {
   TestEncodedS2PointVector(points, 241);
 }
 
+TEST(EncodedS2PointVectorTest, DecodeRange) {
+  vector<S2Point> points;
+  for (int i = 0; i < 10; ++i) {
+    points.push_back(S2Point(1, i, 0).Normalize());
+  }
+  Encoder encoder;
+  EncodeS2PointVector(points, CodingHint::FAST, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2PointVector actual;
+  ASSERT_TRUE(actual.Init(&decoder));
+  vector<S2Point> output(4);
+  actual.Decode(3, 4, output.data());
+  EXPECT_EQ(vector<S2Point>(points.begin() + 3, points.begin() + 7), output);
+  actual.Decode(10, 0, nullptr);
+}
+
+TEST(EncodedS2PointVectorTest, UnalignedData) {
+  vector<S2Point> points;
+  for (int i = 0; i < 10; ++i) {
+    points.push_back(S2Point(1, i, 0).Normalize());
+  }
+  for (int offset = 0; offset < 8; ++offset) {
+    Encoder encoder;
+    encoder.Ensure(offset);
+    for (int i = 0; i < offset; ++i) encoder.put8(0);
+    EncodeS2PointVector(points, CodingHint::FAST, &encoder);
+    Decoder decoder(encoder.base() + offset, encoder.length() - offset);
+    EncodedS2PointVector actual;
+    ASSERT_TRUE(actual.Init(&decoder));
+    for (int i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(points[i], actual[i]);
+    }
+    EXPECT_EQ(points, actual.Decode());
+  }
+}
+
+// Encodes "points" with the given hint, and checks that every way of decoding
+// them returns the original points.  Returns the encoded size.
+size_t TestEncodedS2PointVectorDecoding(const vector<S2Point>& points,
+                                        CodingHint hint) {
+  Encoder encoder;
+  EncodeS2PointVector(points, hint, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2PointVector actual;
+  EXPECT_TRUE(actual.Init(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+  EXPECT_EQ(points.size(), actual.size());
+  EXPECT_EQ(points, actual.Decode());
+  for (int i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(points[i], actual[i]) << i;
+  }
+  for (int start : {0, 1, 15, 16, 17, 40}) {
+    if (start > points.size()) continue;
+    for (int count : {0, 1, 16, 33}) {
+      count = std::min<int>(count, points.size() - start);
+      vector<S2Point> output(count);
+      actual.Decode(start, count, output.data());
+      EXPECT_EQ(vector<S2Point>(points.begin() + start,
+                                points.begin() + start + count), output);
+    }
+  }
+  return encoder.length();
+}
+
+TEST(EncodedS2PointVectorTest, CompactEmpty) {
+  EXPECT_EQ(1, TestEncodedS2PointVectorDecoding({}, CodingHint::COMPACT));
+}
+
+TEST(EncodedS2PointVectorTest, CompactCellCenters) {
+  // A path of nearby cell centers at several levels, similar to a polyline
+  // that has been snapped to S2CellId centers.
+  vector<S2Point> points;
+  S2CellId id = S2CellId(S2Point(1, 2, 3).Normalize()).parent(20);
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(id.parent(18 + i % 3).ToPoint());
+    id = id.next();
+  }
+  size_t bytes = TestEncodedS2PointVectorDecoding(points, CodingHint::COMPACT);
+  EXPECT_LT(bytes, 10 * points.size());
+}
+
+TEST(EncodedS2PointVectorTest, CompactMixedPoints) {
+  // Cell centers on different faces, points that are not cell centers, and
+  // leaf cell centers.
+  vector<S2Point> points;
+  for (int i = 0; i < 200; ++i) {
+    S2Point p = S2Testing::RandomPoint();
+    switch (i % 4) {
+      case 0: points.push_back(p); break;
+      case 1: points.push_back(S2CellId(p).ToPoint()); break;
+      case 2: points.push_back(S2CellId(p).parent(i % 31).ToPoint()); break;
+      case 3: points.push_back(S2CellId::FromFace(i % 6).ToPoint()); break;
+    }
+  }
+  TestEncodedS2PointVectorDecoding(points, CodingHint::COMPACT);
+}
+
+TEST(EncodedS2PointVectorTest, CompactFallsBackToUncompressed) {
+  // Points that are not cell centers are stored uncompressed.
+  vector<S2Point> points;
+  for (int i = 0; i < 20; ++i) {
+    points.push_back(S2Testing::RandomPoint());
+  }
+  EXPECT_EQ(TestEncodedS2PointVectorDecoding(points, CodingHint::FAST),
+            TestEncodedS2PointVectorDecoding(points, CodingHint::COMPACT));
+}
+
+TEST(EncodedS2PointVectorTest, CompactTruncatedData) {
+  vector<S2Point> points;
+  S2CellId id = S2CellId(S2Point(1, 0, 0)).parent(15);
+  for (int i = 0; i < 40; ++i, id = id.next()) {
+    points.push_back(id.ToPoint());
+  }
+  Encoder encoder;
+  EncodeS2PointVector(points, CodingHint::COMPACT, &encoder);
+  for (size_t length = 0; length < encoder.length(); ++length) {
+    Decoder decoder(encoder.base(), length);
+    EncodedS2PointVector actual;
+    EXPECT_FALSE(actual.Init(&decoder));
+  }
+}
+
 }  // namespace s2coding
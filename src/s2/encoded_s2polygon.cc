@@ -0,0 +1,257 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2polygon.h"
+
+#include <cstdint>
+
+#include "s2/base/commandlineflags.h"
+#include "s2/base/logging.h"
+#include "s2/s2cell.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2point_compression.h"
+#include "s2/s2point_span.h"
+#include "s2/s2predicates.h"
+#include "s2/third_party/absl/container/fixed_array.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/util/coding/coder.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_int32(s2polygon_decode_max_num_vertices);
+DECLARE_int32(s2polygon_decode_max_num_loops);
+
+// These must match the encodings in s2polygon.cc and s2loop.cc.
+static const unsigned char kUncompressedPolygonVersion = 1;
+static const unsigned char kCompressedPolygonVersion = 4;
+static const unsigned char kLosslessLoopVersion = 1;
+static const uint32 kLoopOriginInside = 1 << 0;
+static const uint32 kLoopBoundEncoded = 1 << 1;
+
+EncodedS2Polygon::EncodedS2Polygon() {
+}
+
+EncodedS2Polygon::~EncodedS2Polygon() {
+}
+
+bool EncodedS2Polygon::Init(Decoder* decoder) {
+  encoded_ = reinterpret_cast<const char*>(decoder->ptr());
+  if (decoder->avail() < sizeof(unsigned char)) return false;
+  unsigned char version = decoder->get8();
+  bool ok;
+  switch (version) {
+    case kUncompressedPolygonVersion:
+      ok = InitUncompressed(decoder);
+      break;
+    case kCompressedPolygonVersion:
+      ok = InitCompressed(decoder);
+      break;
+    default:
+      return false;
+  }
+  if (!ok) return false;
+  encoded_size_ = reinterpret_cast<const char*>(decoder->ptr()) - encoded_;
+  num_vertices_ = 0;
+  for (const Loop& loop : loops_) num_vertices_ += loop.num_vertices;
+  return true;
+}
+
+bool EncodedS2Polygon::InitUncompressed(Decoder* decoder) {
+  compressed_ = false;
+  if (decoder->avail() < 2 * sizeof(uint8) + sizeof(uint32)) return false;
+  decoder->get8();  // Ignore the obsolete "owns_loops" field.
+  decoder->get8();  // Ignore the obsolete "has_holes" field.
+  const uint32 num_loops = decoder->get32();
+  if (num_loops > FLAGS_s2polygon_decode_max_num_loops) return false;
+  loops_.resize(num_loops);
+
+  // The offset of each loop's vertices in "owned_vertices_", or -1 if the
+  // vertices are used in place.
+  vector<int64> owned_offsets(num_loops, -1);
+  for (int i = 0; i < num_loops; ++i) {
+    Loop* loop = &loops_[i];
+    loop->encoded = reinterpret_cast<const char*>(decoder->ptr());
+    if (decoder->avail() < sizeof(uint8) + sizeof(uint32)) return false;
+    if (decoder->get8() != kLosslessLoopVersion) return false;
+    const uint32 num_vertices = decoder->get32();
+    if (num_vertices > FLAGS_s2polygon_decode_max_num_vertices) return false;
+    if (decoder->avail() < (num_vertices * sizeof(S2Point) +
+                            sizeof(uint8) + sizeof(uint32))) {
+      return false;
+    }
+    loop->num_vertices = num_vertices;
+    // See S2Loop::DecodeInternal regarding alignment.
+#if defined(ARCH_PIII) || defined(ARCH_K8)
+    bool is_misaligned = false;
+#else
+    bool is_misaligned = ((intptr_t)decoder->ptr() % sizeof(double) != 0);
+#endif
+    if (!is_misaligned) {
+      loop->vertices = reinterpret_cast<const S2Point*>(decoder->ptr());
+      decoder->skip(num_vertices * sizeof(S2Point));
+    } else {
+      owned_offsets[i] = owned_vertices_.size();
+      owned_vertices_.resize(owned_vertices_.size() + num_vertices);
+      decoder->getn(&owned_vertices_[owned_offsets[i]],
+                    num_vertices * sizeof(S2Point));
+    }
+    loop->origin_inside = decoder->get8();
+    loop->depth = decoder->get32();
+    S2LatLngRect loop_bound;
+    if (!loop_bound.Decode(decoder)) return false;
+    loop->encoded_size =
+        reinterpret_cast<const char*>(decoder->ptr()) - loop->encoded;
+  }
+  for (int i = 0; i < num_loops; ++i) {
+    if (owned_offsets[i] >= 0) {
+      loops_[i].vertices = &owned_vertices_[owned_offsets[i]];
+    }
+  }
+  return bound_.Decode(decoder);
+}
+
+bool EncodedS2Polygon::InitCompressed(Decoder* decoder) {
+  compressed_ = true;
+  if (decoder->avail() < sizeof(uint8)) return false;
+  snap_level_ = decoder->get8();
+  if (snap_level_ > S2CellId::kMaxLevel) return false;
+  uint32 num_loops;
+  if (!decoder->get_varint32(&num_loops)) return false;
+  if (num_loops > FLAGS_s2polygon_decode_max_num_loops) return false;
+  loops_.resize(num_loops);
+
+  // The bound of the polygon is not encoded, but it is the union of the
+  // bounds of the outer loops.  Loops with many vertices have their bound
+  // encoded; otherwise it is cheap to compute.
+  bound_ = S2LatLngRect::Empty();
+  vector<int64> owned_offsets(num_loops);
+  for (int i = 0; i < num_loops; ++i) {
+    Loop* loop = &loops_[i];
+    loop->encoded = reinterpret_cast<const char*>(decoder->ptr());
+    uint32 num_vertices;
+    if (!decoder->get_varint32(&num_vertices)) return false;
+    if (num_vertices == 0 ||
+        num_vertices > FLAGS_s2polygon_decode_max_num_vertices) {
+      return false;
+    }
+    loop->num_vertices = num_vertices;
+    owned_offsets[i] = owned_vertices_.size();
+    owned_vertices_.resize(owned_vertices_.size() + num_vertices);
+    absl::Span<S2Point> vertices(&owned_vertices_[owned_offsets[i]],
+                                 num_vertices);
+    if (!S2DecodePointsCompressed(decoder, snap_level_, vertices)) {
+      return false;
+    }
+    uint32 properties, depth;
+    if (!decoder->get_varint32(&properties)) return false;
+    if (!decoder->get_varint32(&depth)) return false;
+    loop->origin_inside = (properties & kLoopOriginInside) != 0;
+    loop->depth = depth;
+    S2LatLngRect loop_bound;
+    if (properties & kLoopBoundEncoded) {
+      if (!loop_bound.Decode(decoder)) return false;
+    } else if (depth == 0) {
+      loop_bound = S2Loop(vector<S2Point>(vertices.begin(), vertices.end()),
+                          S2Debug::DISABLE).GetRectBound();
+    }
+    if (depth == 0) bound_ = bound_.Union(loop_bound);
+    loop->encoded_size =
+        reinterpret_cast<const char*>(decoder->ptr()) - loop->encoded;
+  }
+  for (int i = 0; i < num_loops; ++i) {
+    loops_[i].vertices = &owned_vertices_[owned_offsets[i]];
+  }
+  return true;
+}
+
+unique_ptr<S2Loop> EncodedS2Polygon::DecodeLoop(int i) const {
+  S2_DCHECK(i >= 0 && i < num_loops());
+  const Loop& loop = loops_[i];
+  Decoder decoder(loop.encoded, loop.encoded_size);
+  auto result = make_unique<S2Loop>();
+  bool ok = compressed_ ? result->DecodeCompressed(&decoder, snap_level_)
+                        : result->Decode(&decoder);
+  if (!ok) return nullptr;
+  return result;
+}
+
+bool EncodedS2Polygon::Decode(S2Polygon* polygon) const {
+  Decoder decoder(encoded_, encoded_size_);
+  return polygon->Decode(&decoder);
+}
+
+const S2Polygon& EncodedS2Polygon::polygon() const {
+  std::call_once(polygon_once_, [this]() {
+    polygon_ = make_unique<S2Polygon>();
+    bool ok = Decode(polygon_.get());
+    S2_DCHECK(ok) << "Encoding was validated by Init()";
+  });
+  return *polygon_;
+}
+
+EncodedS2Polygon* EncodedS2Polygon::Clone() const {
+  auto clone = make_unique<EncodedS2Polygon>();
+  Decoder decoder(encoded_, encoded_size_);
+  bool ok = clone->Init(&decoder);
+  S2_DCHECK(ok);
+  return clone.release();
+}
+
+S2Cap EncodedS2Polygon::GetCapBound() const {
+  return bound_.GetCapBound();
+}
+
+bool EncodedS2Polygon::Contains(const S2Cell& cell) const {
+  if (!bound_.Contains(cell.GetRectBound())) return false;
+  return polygon().Contains(cell);
+}
+
+bool EncodedS2Polygon::MayIntersect(const S2Cell& cell) const {
+  if (!bound_.Intersects(cell.GetRectBound())) return false;
+  return polygon().MayIntersect(cell);
+}
+
+bool EncodedS2Polygon::Contains(const S2Point& p) const {
+  if (!bound_.Contains(p)) return false;
+  bool inside = false;
+  for (const Loop& loop : loops_) {
+    inside ^= LoopContains(loop, p);
+  }
+  return inside;
+}
+
+bool EncodedS2Polygon::LoopContains(const Loop& loop, const S2Point& p) {
+  // This is the same algorithm as S2Loop::BruteForceContains().
+  const int n = loop.num_vertices;
+  if (n < 3) return loop.origin_inside;
+  S2Point origin = S2::Origin();
+  S2EdgeCrosser crosser(&origin, &p);
+  absl::FixedArray<int8> signs(n);
+  s2pred::TriageSigns(origin, p, origin.CrossProd(p),
+                      S2PointSpan(loop.vertices, n), signs.data());
+  bool inside = loop.origin_inside;
+  int chain_end = -1;  // The last vertex passed to "crosser".
+  for (int i = 0; i < n; ++i) {
+    int j = (i + 1 == n) ? 0 : i + 1;
+    if (signs[i] * signs[j] > 0) continue;
+    if (chain_end != i) crosser.RestartAt(&loop.vertices[i]);
+    inside ^= crosser.EdgeOrVertexCrossing(&loop.vertices[j]);
+    chain_end = j;
+  }
+  return inside;
+}
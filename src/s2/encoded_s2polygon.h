@@ -0,0 +1,144 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_ENCODED_S2POLYGON_H_
+#define S2_ENCODED_S2POLYGON_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "s2/s2cap.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2region.h"
+
+class Decoder;
+class S2Cell;
+
+// EncodedS2Polygon is a read-only view of an S2Polygon encoding (as produced
+// by S2Polygon::Encode or S2Polygon::EncodeUncompressed).  Init() only
+// parses the loop headers, so it is much faster than S2Polygon::Decode():
+// no S2Loop objects are constructed, no bounds are computed (except for
+// small compressed loops, whose bounds are not stored), and no
+// S2ShapeIndex is built.  The S2Region methods are answered directly from
+// the encoded data where possible:
+//
+//  - GetRectBound() and GetCapBound() are constant time.
+//  - Contains(S2Point) tests all the edges using brute force, which is
+//    faster than building an index unless many points are tested.
+//  - Contains(S2Cell) and MayIntersect(S2Cell) first test the bound, and
+//    only decode the full polygon (once) if that is inconclusive.
+//
+// Individual loops can also be decoded on demand using DecodeLoop().
+//
+// With the uncompressed encoding the vertices are used in place (where
+// alignment permits), so the encoded data must outlive this object.  With
+// the compressed encoding the vertices are decoded by Init().
+//
+// This class is thread-safe for concurrent readers.
+class EncodedS2Polygon final : public S2Region {
+ public:
+  // Constructs an uninitialized object; requires Init() to be called.
+  EncodedS2Polygon();
+
+  ~EncodedS2Polygon() override;
+
+  // Initializes the view from an encoded S2Polygon, returning true on
+  // success.  On success the decoder is positioned after the polygon.
+  //
+  // REQUIRES: The Decoder data buffer must outlive this object.
+  // REQUIRES: Init() has not been called before.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of loops.
+  int num_loops() const { return static_cast<int>(loops_.size()); }
+
+  // Returns the total number of vertices in all loops.
+  int num_vertices() const { return num_vertices_; }
+
+  // Returns the number of vertices in loop "i".
+  int num_loop_vertices(int i) const { return loops_[i].num_vertices; }
+
+  // Returns vertex "j" of loop "i", where 0 <= j < num_loop_vertices(i).
+  const S2Point& loop_vertex(int i, int j) const {
+    return loops_[i].vertices[j];
+  }
+
+  // Returns the nesting depth of loop "i" (see S2Loop::depth).
+  int loop_depth(int i) const { return loops_[i].depth; }
+
+  // Decodes and returns loop "i".
+  std::unique_ptr<S2Loop> DecodeLoop(int i) const;
+
+  // Decodes the entire polygon into "polygon".  Returns false on failure.
+  bool Decode(S2Polygon* polygon) const;
+
+  // Returns the decoded polygon.  It is decoded the first time this method
+  // is called, and the result is cached.
+  const S2Polygon& polygon() const;
+
+  ////////////////////////////////////////////////////////////////////////
+  // S2Region interface (see s2region.h for details):
+
+  EncodedS2Polygon* Clone() const override;
+  S2Cap GetCapBound() const override;  // Cap surrounding rect bound.
+  S2LatLngRect GetRectBound() const override { return bound_; }
+  bool Contains(const S2Cell& cell) const override;
+  bool MayIntersect(const S2Cell& cell) const override;
+  bool Contains(const S2Point& p) const override;
+
+ private:
+  struct Loop {
+    const S2Point* vertices;
+    int num_vertices;
+    int depth;
+    bool origin_inside;
+
+    // The encoding of this loop, used by DecodeLoop().
+    const char* encoded;
+    size_t encoded_size;
+  };
+
+  bool InitUncompressed(Decoder* decoder);
+  bool InitCompressed(Decoder* decoder);
+
+  // Returns true if "loop" contains "p", by testing all of its edges.
+  static bool LoopContains(const Loop& loop, const S2Point& p);
+
+  // The entire polygon encoding.
+  const char* encoded_ = nullptr;
+  size_t encoded_size_ = 0;
+
+  bool compressed_ = false;
+  int snap_level_ = 0;
+  int num_vertices_ = 0;
+  std::vector<Loop> loops_;
+  S2LatLngRect bound_;
+
+  // Vertices that could not be used in place.
+  std::vector<S2Point> owned_vertices_;
+
+  // The decoded polygon, see polygon().
+  mutable std::once_flag polygon_once_;
+  mutable std::unique_ptr<S2Polygon> polygon_;
+
+  EncodedS2Polygon(const EncodedS2Polygon&) = delete;
+  void operator=(const EncodedS2Polygon&) = delete;
+};
+
+#endif  // S2_ENCODED_S2POLYGON_H_
@@ -0,0 +1,147 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2polygon.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/coding/coder.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Returns a polygon with a shell, a hole, and an island inside the hole.
+// The shell has enough vertices that its bound is stored by the compressed
+// encoding, while the island's bound is not.
+unique_ptr<S2Polygon> MakeNestedPolygon() {
+  S2Point center = S2LatLng::FromDegrees(10, 20).ToPoint();
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(10), 100));
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(5), 10));
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(2), 20));
+  return absl::make_unique<S2Polygon>(std::move(loops));
+}
+
+// Encodes "polygon" after "prefix_bytes" bytes of padding (to test unaligned
+// data), and checks that EncodedS2Polygon gives the same results.
+void TestEncodedS2Polygon(const S2Polygon& polygon, bool compressed,
+                          int prefix_bytes) {
+  Encoder encoder;
+  encoder.Ensure(prefix_bytes);
+  for (int i = 0; i < prefix_bytes; ++i) encoder.put8(0);
+  if (compressed) {
+    polygon.Encode(&encoder);
+  } else {
+    polygon.EncodeUncompressed(&encoder);
+  }
+  Decoder decoder(encoder.base(), encoder.length());
+  decoder.skip(prefix_bytes);
+  EncodedS2Polygon encoded;
+  ASSERT_TRUE(encoded.Init(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+
+  ASSERT_EQ(polygon.num_loops(), encoded.num_loops());
+  EXPECT_EQ(polygon.num_vertices(), encoded.num_vertices());
+  EXPECT_EQ(polygon.GetRectBound(), encoded.GetRectBound());
+  EXPECT_EQ(polygon.GetCapBound(), encoded.GetCapBound());
+  for (int i = 0; i < polygon.num_loops(); ++i) {
+    const S2Loop* loop = polygon.loop(i);
+    ASSERT_EQ(loop->num_vertices(), encoded.num_loop_vertices(i));
+    EXPECT_EQ(loop->depth(), encoded.loop_depth(i));
+    for (int j = 0; j < loop->num_vertices(); ++j) {
+      EXPECT_EQ(loop->vertex(j), encoded.loop_vertex(i, j));
+    }
+    unique_ptr<S2Loop> decoded_loop = encoded.DecodeLoop(i);
+    ASSERT_TRUE(decoded_loop != nullptr);
+    EXPECT_TRUE(loop->Equals(decoded_loop.get()));
+    EXPECT_EQ(loop->depth(), decoded_loop->depth());
+  }
+  S2Polygon decoded;
+  ASSERT_TRUE(encoded.Decode(&decoded));
+  EXPECT_TRUE(polygon.Equals(&decoded));
+
+  S2Cap cap = polygon.GetCapBound();
+  for (int iter = 0; iter < 200; ++iter) {
+    S2Point p = (iter % 2 || cap.is_empty()) ? S2Testing::RandomPoint()
+                                             : S2Testing::SamplePoint(cap);
+    EXPECT_EQ(polygon.Contains(p), encoded.Contains(p));
+    S2Cell cell(S2CellId(p).parent(S2Testing::rnd.Uniform(12) + 2));
+    EXPECT_EQ(polygon.Contains(cell), encoded.Contains(cell));
+    EXPECT_EQ(polygon.MayIntersect(cell), encoded.MayIntersect(cell));
+  }
+  unique_ptr<EncodedS2Polygon> clone(encoded.Clone());
+  EXPECT_EQ(encoded.GetRectBound(), clone->GetRectBound());
+  EXPECT_EQ(encoded.num_vertices(), clone->num_vertices());
+}
+
+TEST(EncodedS2Polygon, Uncompressed) {
+  auto polygon = MakeNestedPolygon();
+  for (int prefix_bytes = 0; prefix_bytes < 8; ++prefix_bytes) {
+    TestEncodedS2Polygon(*polygon, false, prefix_bytes);
+  }
+}
+
+TEST(EncodedS2Polygon, Compressed) {
+  auto polygon = MakeNestedPolygon();
+  S2Polygon snapped;
+  snapped.InitToSnapped(polygon.get());
+  TestEncodedS2Polygon(snapped, true, 0);
+  TestEncodedS2Polygon(snapped, true, 3);
+}
+
+TEST(EncodedS2Polygon, EmptyAndFull) {
+  for (bool compressed : {false, true}) {
+    TestEncodedS2Polygon(*s2textformat::MakePolygonOrDie(""), compressed, 0);
+    TestEncodedS2Polygon(*s2textformat::MakePolygonOrDie("full"),
+                         compressed, 0);
+  }
+}
+
+TEST(EncodedS2Polygon, TruncatedEncoding) {
+  auto polygon = MakeNestedPolygon();
+  for (bool compressed : {false, true}) {
+    Encoder encoder;
+    if (compressed) {
+      S2Polygon snapped;
+      snapped.InitToSnapped(polygon.get());
+      snapped.Encode(&encoder);
+    } else {
+      polygon->EncodeUncompressed(&encoder);
+    }
+    for (size_t length : {size_t{0}, size_t{5}, encoder.length() / 2,
+                          encoder.length() - 1}) {
+      Decoder decoder(encoder.base(), length);
+      EncodedS2Polygon encoded;
+      EXPECT_FALSE(encoded.Init(&decoder)) << length;
+    }
+  }
+}
+
+}  // namespace
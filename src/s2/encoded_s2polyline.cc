@@ -0,0 +1,202 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/encoded_s2polyline.h"
+
+#include <algorithm>
+
+#include "s2/base/logging.h"
+#include "s2/s2cell.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2latlng_rect_bounder.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/coding/coder.h"
+
+using absl::make_unique;
+using s2coding::CodingHint;
+
+static const unsigned char kCurrentEncodingVersionNumber = 1;
+
+// The maximum number of edges passed to each call of a RunVisitor.  This is a
+// multiple of the EncodedS2PointVector block size.
+static const int kMaxRunEdges = 64;
+
+void EncodedS2Polyline::Encode(S2PointSpan vertices, Encoder* encoder,
+                               CodingHint hint) {
+  S2LatLngRectBounder bounder;
+  bounder.AddPoints(vertices);
+  encoder->Ensure(1);
+  encoder->put8(kCurrentEncodingVersionNumber);
+  bounder.GetBound().Encode(encoder);
+  s2coding::EncodeS2PointVector(vertices, hint, encoder);
+}
+
+void EncodedS2Polyline::Encode(const S2Polyline& polyline, Encoder* encoder,
+                               CodingHint hint) {
+  S2PointSpan vertices;
+  if (polyline.num_vertices() > 0) {
+    vertices = S2PointSpan(&polyline.vertex(0), polyline.num_vertices());
+  }
+  Encode(vertices, encoder, hint);
+}
+
+EncodedS2Polyline::EncodedS2Polyline() {
+}
+
+EncodedS2Polyline::~EncodedS2Polyline() {
+}
+
+bool EncodedS2Polyline::Init(Decoder* decoder) {
+  encoded_ = reinterpret_cast<const char*>(decoder->ptr());
+  if (decoder->avail() < sizeof(unsigned char)) return false;
+  if (decoder->get8() != kCurrentEncodingVersionNumber) return false;
+  if (!bound_.Decode(decoder)) return false;
+  if (!vertices_.Init(decoder)) return false;
+  encoded_size_ = reinterpret_cast<const char*>(decoder->ptr()) - encoded_;
+  return true;
+}
+
+void EncodedS2Polyline::Decode(S2Polyline* polyline) const {
+  polyline->Init(vertices_.Decode());
+}
+
+bool EncodedS2Polyline::VisitVertexRuns(const RunVisitor& visitor) const {
+  const int n = num_vertices();
+  if (n == 0) return true;
+  S2Point run[kMaxRunEdges + 1];
+  int start = 0;
+  int count = std::min(n, kMaxRunEdges + 1);
+  vertices_.Decode(0, count, run);
+  for (;;) {
+    if (!visitor(start, S2PointSpan(run, count))) return false;
+    if (start + count == n) return true;
+    // The last vertex of this run becomes the first vertex of the next one.
+    run[0] = run[count - 1];
+    start += count - 1;
+    count = std::min(n - start, kMaxRunEdges + 1);
+    vertices_.Decode(start + 1, count - 1, run + 1);
+  }
+}
+
+S1Angle EncodedS2Polyline::GetLength() const {
+  // The lengths are summed in the same order as S2::GetLength().
+  S1Angle length;
+  VisitVertexRuns([&length](int start, S2PointSpan v) {
+      for (int i = 1; i < v.size(); ++i) {
+        length += S1Angle(v[i - 1], v[i]);
+      }
+      return true;
+    });
+  return length;
+}
+
+S2Point EncodedS2Polyline::GetSuffix(double fraction, int* next_vertex) const {
+  S2_DCHECK_GT(num_vertices(), 0);
+  if (fraction <= 0) {
+    *next_vertex = 1;
+    return vertex(0);
+  }
+  S1Angle target = fraction * GetLength();
+  S2Point result;
+  bool found = !VisitVertexRuns([&](int start, S2PointSpan v) {
+      for (int i = 1; i < v.size(); ++i) {
+        S1Angle length(v[i - 1], v[i]);
+        if (target < length) {
+          // This interpolates with respect to arc length rather than
+          // straight-line distance, and produces a unit-length result.
+          result = S2::InterpolateAtDistance(target, v[i - 1], v[i]);
+          // It is possible that (result == v[i]) due to rounding errors.
+          *next_vertex = start + i + (result == v[i] ? 1 : 0);
+          return false;
+        }
+        target -= length;
+      }
+      return true;
+    });
+  if (found) return result;
+  *next_vertex = num_vertices();
+  return vertex(num_vertices() - 1);
+}
+
+S2Point EncodedS2Polyline::Interpolate(double fraction) const {
+  int next_vertex;
+  return GetSuffix(fraction, &next_vertex);
+}
+
+S2Point EncodedS2Polyline::Project(const S2Point& point,
+                                   int* next_vertex) const {
+  S2_DCHECK_GT(num_vertices(), 0);
+  if (num_vertices() == 1) {
+    // If there is only one vertex, it is always closest to any given point.
+    *next_vertex = 1;
+    return vertex(0);
+  }
+  // Find the edge that is closest to the given point, and compute the closest
+  // point on that edge.
+  S1Angle min_distance = S1Angle::Radians(10);  // Larger than any distance.
+  int min_index = -1;
+  S2Point closest_point;
+  VisitVertexRuns([&](int start, S2PointSpan v) {
+      for (int i = 1; i < v.size(); ++i) {
+        S1Angle distance = S2::GetDistance(point, v[i - 1], v[i]);
+        if (distance < min_distance) {
+          min_distance = distance;
+          min_index = start + i;
+          closest_point = S2::Project(point, v[i - 1], v[i]);
+        }
+      }
+      return true;
+    });
+  S2_DCHECK_NE(min_index, -1);
+  *next_vertex = min_index + (closest_point == vertex(min_index) ? 1 : 0);
+  return closest_point;
+}
+
+EncodedS2Polyline* EncodedS2Polyline::Clone() const {
+  auto clone = make_unique<EncodedS2Polyline>();
+  Decoder decoder(encoded_, encoded_size_);
+  bool ok = clone->Init(&decoder);
+  S2_DCHECK(ok);
+  return clone.release();
+}
+
+S2Cap EncodedS2Polyline::GetCapBound() const {
+  return bound_.GetCapBound();
+}
+
+bool EncodedS2Polyline::MayIntersect(const S2Cell& cell) const {
+  if (num_vertices() == 0) return false;
+  S2Point cell_vertices[4];
+  for (int i = 0; i < 4; ++i) {
+    cell_vertices[i] = cell.GetVertex(i);
+  }
+  int8 signs[kMaxRunEdges];
+  return !VisitVertexRuns([&](int start, S2PointSpan v) {
+      for (const S2Point& p : v) {
+        if (cell.Contains(p)) return false;
+      }
+      for (int j = 0; j < 4; ++j) {
+        S2EdgeCrosser crosser(&cell_vertices[j], &cell_vertices[(j + 1) & 3]);
+        crosser.ChainCrossingSigns(v, signs);
+        for (int i = 0; i < v.size() - 1; ++i) {
+          // There is a proper crossing, or two vertices were the same.
+          if (signs[i] >= 0) return false;
+        }
+      }
+      return true;
+    });
+}
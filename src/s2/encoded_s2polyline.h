@@ -0,0 +1,132 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_ENCODED_S2POLYLINE_H_
+#define S2_ENCODED_S2POLYLINE_H_
+
+#include <functional>
+
+#include "s2/encoded_s2point_vector.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2polyline.h"
+#include "s2/s2region.h"
+
+class Decoder;
+class Encoder;
+class S2Cell;
+
+// EncodedS2Polyline is a read-only polyline whose vertices are kept in
+// encoded form (see s2coding::EncodedS2PointVector) and decoded in small
+// blocks as they are needed.  When the vertices have been snapped to
+// S2CellId centers (e.g., using s2builderutil::S2CellIdSnapFunction), the
+// compact encoding typically uses a few bytes per vertex rather than the 24
+// bytes used by S2Polyline, which makes it suitable for holding very large
+// numbers of polylines in memory.  Vertices that are not cell centers are
+// stored exactly, so the encoding is always lossless.
+//
+// Init() takes constant time.  The polyline's bounding rectangle is stored
+// in the encoding, so GetRectBound() and GetCapBound() do not decode any
+// vertices.  Methods such as Project() and Interpolate() decode the vertices
+// in blocks and scan all the edges, which gives exactly the same results as
+// the corresponding S2Polyline methods for polylines with fewer than 64
+// vertices.  (Longer S2Polylines build additional data structures, and their
+// results can differ slightly due to rounding.)
+//
+// The encoded data is not owned by this class and must outlive it.
+//
+// This class is thread-safe for concurrent readers.
+class EncodedS2Polyline final : public S2Region {
+ public:
+  // Encodes a polyline with the given vertices in the format expected by
+  // Init().  CodingHint::FAST stores the vertices uncompressed.
+  static void Encode(S2PointSpan vertices, Encoder* encoder,
+                     s2coding::CodingHint hint = s2coding::CodingHint::COMPACT);
+  static void Encode(const S2Polyline& polyline, Encoder* encoder,
+                     s2coding::CodingHint hint = s2coding::CodingHint::COMPACT);
+
+  // Constructs an uninitialized object; requires Init() to be called.
+  EncodedS2Polyline();
+
+  ~EncodedS2Polyline() override;
+
+  // Initializes the polyline from data encoded by Encode(), returning true
+  // on success.  On success the decoder is positioned after the polyline.
+  //
+  // REQUIRES: The Decoder data buffer must outlive this object.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of vertices.
+  int num_vertices() const { return static_cast<int>(vertices_.size()); }
+
+  // Returns vertex "k", where 0 <= k < num_vertices().  Prefer the methods
+  // below to calling this method for every vertex.
+  S2Point vertex(int k) const { return vertices_[k]; }
+
+  // Decodes the "count" vertices starting at "start" into "output", which
+  // must have room for "count" points.
+  void DecodeVertices(int start, int count, S2Point* output) const {
+    vertices_.Decode(start, count, output);
+  }
+
+  // Decodes the polyline into "polyline".
+  void Decode(S2Polyline* polyline) const;
+
+  // The following methods are equivalent to the S2Polyline methods with the
+  // same names (see s2polyline.h for details).
+  S1Angle GetLength() const;
+  S2Point Interpolate(double fraction) const;
+  S2Point GetSuffix(double fraction, int* next_vertex) const;
+  S2Point Project(const S2Point& point, int* next_vertex) const;
+
+  ////////////////////////////////////////////////////////////////////////
+  // S2Region interface (see s2region.h for details):
+
+  EncodedS2Polyline* Clone() const override;
+  S2Cap GetCapBound() const override;
+  S2LatLngRect GetRectBound() const override { return bound_; }
+  bool Contains(const S2Cell& cell) const override { return false; }
+  bool MayIntersect(const S2Cell& cell) const override;
+
+  // Always returns false, since polylines do not have an interior (see
+  // S2Polyline::Contains).
+  bool Contains(const S2Point& p) const override { return false; }
+
+ private:
+  // Calls "visitor" with consecutive runs of vertices (starting with vertex
+  // 0), where each run after the first begins with the last vertex of the
+  // previous run.  Every edge therefore belongs to exactly one run.  The
+  // first argument is the index of the first vertex of the run.  Returns
+  // false if "visitor" returns false, in which case no more runs are
+  // visited.
+  using RunVisitor = std::function<bool (int start, S2PointSpan vertices)>;
+  bool VisitVertexRuns(const RunVisitor& visitor) const;
+
+  // The entire encoding, used by Clone().
+  const char* encoded_ = nullptr;
+  size_t encoded_size_ = 0;
+
+  S2LatLngRect bound_;
+  s2coding::EncodedS2PointVector vertices_;
+
+  EncodedS2Polyline(const EncodedS2Polyline&) = delete;
+  void operator=(const EncodedS2Polyline&) = delete;
+};
+
+#endif  // S2_ENCODED_S2POLYLINE_H_
@@ -0,0 +1,161 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/encoded_s2polyline.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2latlng.h"
+#include "s2/s2polyline.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/coding/coder.h"
+
+using s2coding::CodingHint;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Returns a random walk of "n" vertices that have been snapped to the
+// centers of cells at the given level (or not snapped if level < 0).
+vector<S2Point> MakeWalk(int n, int level) {
+  vector<S2Point> vertices;
+  S2Point p = S2Testing::RandomPoint();
+  for (int i = 0; i < n; ++i) {
+    S2Point v = (level < 0) ? p : S2CellId(p).parent(level).ToPoint();
+    if (vertices.empty() || v != vertices.back()) vertices.push_back(v);
+    p = S2Testing::SamplePoint(S2Cap(p, S2Testing::KmToAngle(0.5)));
+  }
+  return vertices;
+}
+
+// Checks that EncodedS2Polyline gives the same results as S2Polyline.
+void TestEncodedS2Polyline(const vector<S2Point>& vertices, CodingHint hint) {
+  S2Polyline polyline(vertices);
+  Encoder encoder;
+  EncodedS2Polyline::Encode(polyline, &encoder, hint);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2Polyline encoded;
+  ASSERT_TRUE(encoded.Init(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+
+  ASSERT_EQ(polyline.num_vertices(), encoded.num_vertices());
+  for (int i = 0; i < polyline.num_vertices(); ++i) {
+    EXPECT_EQ(polyline.vertex(i), encoded.vertex(i));
+  }
+  S2Polyline decoded;
+  encoded.Decode(&decoded);
+  EXPECT_TRUE(decoded.Equals(&polyline));
+  EXPECT_EQ(polyline.GetRectBound(), encoded.GetRectBound());
+  EXPECT_EQ(polyline.GetLength(), encoded.GetLength());
+
+  // S2Polyline uses a different algorithm for long polylines, which can
+  // produce slightly different results.
+  const bool exact = polyline.num_vertices() < 64;
+  const S1Angle kMaxError = S1Angle::Radians(1e-15);
+  for (double fraction : {-0.1, 0.0, 0.1, 0.3, 0.5, 0.99, 1.0, 1.1}) {
+    int expected_next, actual_next;
+    S2Point expected = polyline.GetSuffix(fraction, &expected_next);
+    S2Point actual = encoded.GetSuffix(fraction, &actual_next);
+    if (exact) {
+      EXPECT_EQ(expected, actual);
+      EXPECT_EQ(expected_next, actual_next);
+      EXPECT_EQ(expected, encoded.Interpolate(fraction));
+    } else {
+      EXPECT_LE(S1Angle(expected, actual), kMaxError);
+    }
+  }
+  const S2Cap cap = polyline.GetCapBound();
+  for (int i = 0; i < 20; ++i) {
+    S2Point p = S2Testing::SamplePoint(cap);
+    int expected_next, actual_next;
+    S2Point expected = polyline.Project(p, &expected_next);
+    S2Point actual = encoded.Project(p, &actual_next);
+    if (exact) {
+      EXPECT_EQ(expected, actual);
+      EXPECT_EQ(expected_next, actual_next);
+    } else {
+      EXPECT_LE(S1Angle(expected, actual), kMaxError);
+    }
+  }
+  for (int i = 0; i < 20; ++i) {
+    S2Cell cell(S2CellId(S2Testing::SamplePoint(cap)).parent(
+        S2Testing::rnd.Uniform(20)));
+    EXPECT_EQ(polyline.MayIntersect(cell), encoded.MayIntersect(cell));
+  }
+  unique_ptr<EncodedS2Polyline> clone(encoded.Clone());
+  EXPECT_EQ(encoded.num_vertices(), clone->num_vertices());
+  EXPECT_EQ(encoded.GetLength(), clone->GetLength());
+}
+
+TEST(EncodedS2Polyline, Empty) {
+  for (CodingHint hint : {CodingHint::FAST, CodingHint::COMPACT}) {
+    Encoder encoder;
+    EncodedS2Polyline::Encode(S2Polyline(), &encoder, hint);
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2Polyline encoded;
+    ASSERT_TRUE(encoded.Init(&decoder));
+    EXPECT_EQ(0, encoded.num_vertices());
+    EXPECT_EQ(S1Angle::Zero(), encoded.GetLength());
+    EXPECT_TRUE(encoded.GetRectBound().is_empty());
+    EXPECT_FALSE(encoded.MayIntersect(S2Cell::FromFace(0)));
+  }
+}
+
+TEST(EncodedS2Polyline, SnappedVertices) {
+  for (int n : {1, 2, 17, 63, 64, 65, 300}) {
+    vector<S2Point> vertices = MakeWalk(n, 20);
+    TestEncodedS2Polyline(vertices, CodingHint::FAST);
+    TestEncodedS2Polyline(vertices, CodingHint::COMPACT);
+  }
+}
+
+TEST(EncodedS2Polyline, UnsnappedVertices) {
+  for (int n : {1, 5, 63, 200}) {
+    vector<S2Point> vertices = MakeWalk(n, -1);
+    TestEncodedS2Polyline(vertices, CodingHint::COMPACT);
+  }
+}
+
+TEST(EncodedS2Polyline, CompactEncodingIsSmall) {
+  vector<S2Point> vertices = MakeWalk(1000, 22);
+  Encoder fast, compact;
+  EncodedS2Polyline::Encode(vertices, &fast, CodingHint::FAST);
+  EncodedS2Polyline::Encode(vertices, &compact, CodingHint::COMPACT);
+  EXPECT_GT(fast.length(), 24 * vertices.size());
+  EXPECT_LT(compact.length(), 8 * vertices.size());
+}
+
+TEST(EncodedS2Polyline, TruncatedData) {
+  vector<S2Point> vertices = MakeWalk(40, 15);
+  Encoder encoder;
+  EncodedS2Polyline::Encode(vertices, &encoder);
+  for (size_t length = 0; length < encoder.length(); ++length) {
+    Decoder decoder(encoder.base(), length);
+    EncodedS2Polyline encoded;
+    EXPECT_FALSE(encoded.Init(&decoder));
+  }
+}
+
+}  // namespace
@@ -17,11 +17,18 @@
 
 #include "s2/encoded_s2shape_index.h"
 
+#include <algorithm>
 #include <memory>
+#include "s2/base/logging.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/mutable_s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/util/coding/mapped_file.h"
+#include "s2/util/coding/varint.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
+using std::string;
 using std::unique_ptr;
 using std::vector;
 
@@ -43,17 +50,56 @@ void EncodedS2ShapeIndex::Iterator::Copy(const IteratorBase& other)  {
   *this = *down_cast<const Iterator*>(&other);
 }
 
+EncodedS2ShapeIndex::Iterator::Iterator(const Iterator& other)
+    : IteratorBase(other), index_(other.index_), cell_pos_(other.cell_pos_),
+      num_cells_(other.num_cells_), readahead_(other.readahead_),
+      epoch_parity_(other.epoch_parity_) {
+  // The copy may refer to the same cell as "other", so it is registered in
+  // the same epoch.  This cannot race with reclamation since "other" keeps
+  // the epoch's count positive.
+  if (epoch_parity_ >= 0) {
+    index_->active_iterators_[epoch_parity_].fetch_add(1);
+  }
+}
+
+EncodedS2ShapeIndex::Iterator& EncodedS2ShapeIndex::Iterator::operator=(
+    const Iterator& other) {
+  if (this == &other) return *this;
+  if (other.epoch_parity_ >= 0) {
+    other.index_->active_iterators_[other.epoch_parity_].fetch_add(1);
+  }
+  if (epoch_parity_ >= 0) index_->UnpinEpoch(epoch_parity_);
+  IteratorBase::operator=(other);
+  index_ = other.index_;
+  cell_pos_ = other.cell_pos_;
+  num_cells_ = other.num_cells_;
+  readahead_ = other.readahead_;
+  epoch_parity_ = other.epoch_parity_;
+  return *this;
+}
+
 
 S2Shape* EncodedS2ShapeIndex::GetShape(int id) const {
   // This method is called when a shape has not been decoded yet.
   unique_ptr<S2Shape> shape = (*shape_factory_)[id];
   if (shape) shape->id_ = id;
-  S2Shape* expected = kUndecodedShape();
-  if (shapes_[id].compare_exchange_strong(expected, shape.get(),
-                                          std::memory_order_relaxed)) {
-    return shape.release();  // Ownership has been transferred to shapes_.
+  for (;;) {
+    S2Shape* expected = kUndecodedShape();
+    if (shapes_[id].compare_exchange_strong(expected, shape.get(),
+                                            std::memory_order_relaxed)) {
+      break;
+    }
+    // If another thread decoded the shape, use its copy.  (The shape could
+    // also have been evicted in the meantime, in which case we try again.)
+    if (expected != kUndecodedShape()) return expected;
   }
-  return shapes_[id].load(std::memory_order_relaxed);
+  // Ownership has been transferred to shapes_.
+  S2Shape* result = shape.release();
+  if (max_decoded_shapes_ >= 0 && result != nullptr) {
+    shape_referenced_[id].store(true, std::memory_order_relaxed);
+    if (num_decoded_shapes_.fetch_add(1) + 1 > max_decoded_shapes_) Evict();
+  }
+  return result;
 }
 inline const S2ShapeIndexCell* EncodedS2ShapeIndex::GetCell(int i) const {
   // This method is called by Iterator::cell() when the cell has not been
@@ -61,21 +107,212 @@ inline const S2ShapeIndexCell* EncodedS2ShapeIndex::GetCell(int i) const {
   // it atomically using a compare-and-swap operation.
   auto cell = make_unique<S2ShapeIndexCell>();
   Decoder decoder = encoded_cells_.GetDecoder(i);
-  if (cell->Decode(num_shape_ids(), &decoder)) {
+  if (!cell->Decode(num_shape_ids(), &decoder)) {
+    return cells_[i].load(std::memory_order_relaxed);
+  }
+  for (;;) {
     S2ShapeIndexCell* expected = nullptr;
     if (cells_[i].compare_exchange_strong(expected, cell.get(),
                                           std::memory_order_relaxed)) {
-      return cell.release();  // Ownership has been transferred to cells_.
+      break;
+    }
+    // If another thread decoded the cell, use its copy.  (The cell could
+    // also have been evicted in the meantime, in which case we try again.)
+    if (expected != nullptr) return expected;
+  }
+  // Ownership has been transferred to cells_.  The caller's iterator is
+  // registered in the current epoch, so the cell is not deleted while it is
+  // in use even if it is evicted immediately.
+  S2ShapeIndexCell* result = cell.release();
+  if (max_decoded_cell_bytes_ >= 0) {
+    referenced_[i].store(true, std::memory_order_relaxed);
+    if (decoded_cell_bytes_.fetch_add(CellBytes(*result)) +
+        CellBytes(*result) > max_decoded_cell_bytes_) {
+      Evict();
+    }
+  }
+  return result;
+}
+
+int64 EncodedS2ShapeIndex::CellBytes(const S2ShapeIndexCell& cell) {
+  // Edges are stored inline unless there are more than two of them.
+  int64 size = sizeof(S2ShapeIndexCell);
+  for (int i = 0; i < cell.num_clipped(); ++i) {
+    const S2ClippedShape& clipped = cell.clipped(i);
+    size += sizeof(S2ClippedShape);
+    if (clipped.num_edges() > 2) size += clipped.num_edges() * sizeof(int32);
+  }
+  return size;
+}
+
+int8 EncodedS2ShapeIndex::PinEpoch() const {
+  if (max_decoded_cell_bytes_ < 0 && max_decoded_shapes_ < 0) return -1;
+  for (;;) {
+    uint64 epoch = epoch_.load();
+    int8 parity = epoch & 1;
+    active_iterators_[parity].fetch_add(1);
+    // If the epoch has advanced, the cells retired during the previous epoch
+    // with this parity may already be reclaimable, so try again.
+    if (epoch_.load() == epoch) return parity;
+    UnpinEpoch(parity);
+  }
+}
+
+void EncodedS2ShapeIndex::UnpinEpoch(int8 parity) const {
+  active_iterators_[parity].fetch_sub(1);
+}
+
+void EncodedS2ShapeIndex::Evict() const {
+  for (;;) {
+    if (evicting_.exchange(true, std::memory_order_acquire)) return;
+    const uint64 epoch = epoch_.load();
+    if (max_decoded_cell_bytes_ >= 0) EvictCells(&retired_cells_[epoch & 1]);
+    if (max_decoded_shapes_ >= 0 && shape_factory_ != nullptr) {
+      EvictShapes(&retired_shapes_[epoch & 1]);
+    }
+
+    // Objects retired during the previous epoch can be deleted once all the
+    // iterators and pins registered during that epoch are gone.  (Those
+    // registered during the current epoch cannot have seen them, since they
+    // were removed from the index before the current epoch began.)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int previous = (epoch + 1) & 1;
+    if (active_iterators_[previous].load() == 0) {
+      for (S2ShapeIndexCell* cell : retired_cells_[previous]) delete cell;
+      retired_cells_[previous].clear();
+      for (S2Shape* shape : retired_shapes_[previous]) delete shape;
+      retired_shapes_[previous].clear();
+      epoch_.store(epoch + 1);
+    }
+    evicting_.store(false, std::memory_order_release);
+
+    // Other threads that exceeded a limit while we were evicting returned
+    // without evicting anything, so check the limits again.  Otherwise the
+    // limits could remain exceeded until something else is decoded.
+    bool over_limit =
+        (max_decoded_cell_bytes_ >= 0 &&
+         decoded_cell_bytes_.load() > max_decoded_cell_bytes_) ||
+        (max_decoded_shapes_ >= 0 && shape_factory_ != nullptr &&
+         num_decoded_shapes_.load() > max_decoded_shapes_);
+    if (!over_limit) return;
+  }
+}
+
+void EncodedS2ShapeIndex::EvictCells(
+    vector<S2ShapeIndexCell*>* retired) const {
+  // Evict cells until we are comfortably below the limit, so that eviction
+  // does not happen on every newly decoded cell.
+  const int64 target = max_decoded_cell_bytes_ - max_decoded_cell_bytes_ / 8;
+  const size_t num_cells = cells_.size();
+  for (size_t step = 0; step < 2 * num_cells &&
+           decoded_cell_bytes_.load(std::memory_order_relaxed) > target;
+       ++step) {
+    size_t i = clock_hand_;
+    if (++clock_hand_ == num_cells) clock_hand_ = 0;
+    S2ShapeIndexCell* cell = cells_[i].load(std::memory_order_relaxed);
+    if (cell == nullptr) continue;
+    if (referenced_[i].exchange(false, std::memory_order_relaxed)) continue;
+    if (cells_[i].compare_exchange_strong(cell, nullptr)) {
+      decoded_cell_bytes_.fetch_sub(CellBytes(*cell));
+      retired->push_back(cell);
+    }
+  }
+}
+
+void EncodedS2ShapeIndex::EvictShapes(vector<S2Shape*>* retired) const {
+  const int target = max_decoded_shapes_ - max_decoded_shapes_ / 8;
+  const size_t num_shapes = shapes_.size();
+  for (size_t step = 0; step < 2 * num_shapes &&
+           num_decoded_shapes_.load(std::memory_order_relaxed) > target;
+       ++step) {
+    size_t i = shape_clock_hand_;
+    if (++shape_clock_hand_ == num_shapes) shape_clock_hand_ = 0;
+    S2Shape* shape = shapes_[i].load(std::memory_order_relaxed);
+    if (shape == kUndecodedShape() || shape == nullptr) continue;
+    if (shape_referenced_[i].exchange(false, std::memory_order_relaxed)) {
+      continue;
+    }
+    if (shapes_[i].compare_exchange_strong(shape, kUndecodedShape())) {
+      num_decoded_shapes_.fetch_sub(1);
+      retired->push_back(shape);
+    }
+  }
+}
+
+void EncodedS2ShapeIndex::DeleteRetired() {
+  for (auto& retired : retired_cells_) {
+    for (S2ShapeIndexCell* cell : retired) delete cell;
+    retired.clear();
+  }
+  for (auto& retired : retired_shapes_) {
+    for (S2Shape* shape : retired) delete shape;
+    retired.clear();
+  }
+}
+
+void EncodedS2ShapeIndex::set_max_decoded_cell_bytes(int64 max_bytes) {
+  max_decoded_cell_bytes_ = max_bytes;
+  referenced_ = std::vector<std::atomic<bool>>(
+      max_bytes >= 0 ? cells_.size() : 0);
+  int64 bytes = 0;
+  if (max_bytes >= 0) {
+    for (const auto& atomic_cell : cells_) {
+      S2ShapeIndexCell* cell = atomic_cell.load(std::memory_order_relaxed);
+      if (cell != nullptr) bytes += CellBytes(*cell);
     }
   }
-  return cells_[i].load(std::memory_order_relaxed);
+  decoded_cell_bytes_.store(bytes, std::memory_order_relaxed);
+  clock_hand_ = 0;
+}
+
+void EncodedS2ShapeIndex::set_max_decoded_shapes(int max_shapes) {
+  max_decoded_shapes_ = max_shapes;
+  shape_referenced_ = std::vector<std::atomic<bool>>(
+      max_shapes >= 0 ? shapes_.size() : 0);
+  int num_shapes = 0;
+  if (max_shapes >= 0) {
+    for (const auto& atomic_shape : shapes_) {
+      S2Shape* shape = atomic_shape.load(std::memory_order_relaxed);
+      if (shape != kUndecodedShape() && shape != nullptr) ++num_shapes;
+    }
+  }
+  num_decoded_shapes_.store(num_shapes, std::memory_order_relaxed);
+  shape_clock_hand_ = 0;
+}
+
+void EncodedS2ShapeIndex::DecodeCells(int begin, int end) const {
+  for (int i = begin; i < end; ++i) {
+    if (cells_[i].load(std::memory_order_relaxed) == nullptr) GetCell(i);
+  }
+}
+
+void EncodedS2ShapeIndex::DecodeAllCells(Executor* executor) const {
+  // Divide the cells into more tasks than threads to balance the load.
+  const int kTasksPerThread = 4;
+  const int num_cells = cells_.size();
+  const int num_tasks = std::min(
+      num_cells, executor ? kTasksPerThread * executor->num_threads() : 1);
+  ParallelFor(executor, num_tasks, [this, num_cells, num_tasks](int task) {
+    DecodeCells(int64{num_cells} * task / num_tasks,
+                int64{num_cells} * (task + 1) / num_tasks);
+  });
 }
 
 const S2ShapeIndexCell* EncodedS2ShapeIndex::Iterator::GetCell() const {
+  if (readahead_ > 1) {
+    index_->DecodeCells(cell_pos_,
+                        std::min(num_cells_, cell_pos_ + readahead_));
+    auto cell = index_->cells_[cell_pos_].load(std::memory_order_relaxed);
+    if (cell != nullptr) return cell;  // Otherwise it was already evicted.
+  }
   return index_->GetCell(cell_pos_);
 }
 
-EncodedS2ShapeIndex::EncodedS2ShapeIndex() {
+EncodedS2ShapeIndex::EncodedS2ShapeIndex()
+    : decoded_cell_bytes_(0), num_decoded_shapes_(0), evicting_(false),
+      epoch_(0) {
+  active_iterators_[0].store(0, std::memory_order_relaxed);
+  active_iterators_[1].store(0, std::memory_order_relaxed);
 }
 
 EncodedS2ShapeIndex::~EncodedS2ShapeIndex() {
@@ -100,6 +337,8 @@ EncodedS2ShapeIndex::~EncodedS2ShapeIndex() {
 bool EncodedS2ShapeIndex::Init(Decoder* decoder,
                                const ShapeFactory& shape_factory) {
   Minimize();
+  mapped_file_.reset();
+  owned_data_.reset();
   uint64 max_edges_version;
   if (!decoder->get_varint64(&max_edges_version)) return false;
   int version = max_edges_version & 3;
@@ -113,19 +352,113 @@ bool EncodedS2ShapeIndex::Init(Decoder* decoder,
   // initializing all the elements twice.
   shapes_ = std::vector<AtomicShape>(shape_factory.size());
   shape_factory_ = shape_factory.Clone();
+  owned_shapes_.clear();
   if (!cell_ids_.Init(decoder)) return false;
 
   // The cells_ elements are default-initialized to nullptr.
   cells_ = std::vector<std::atomic<S2ShapeIndexCell*>>(cell_ids_.size());
+  if (max_decoded_cell_bytes_ >= 0) {
+    set_max_decoded_cell_bytes(max_decoded_cell_bytes_);
+  }
+  if (max_decoded_shapes_ >= 0) set_max_decoded_shapes(max_decoded_shapes_);
   return encoded_cells_.Init(decoder);
 }
 
+bool EncodedS2ShapeIndex::InitFromFile(const string& path) {
+  auto mapped_file = MappedFile::Open(path);
+  if (mapped_file == nullptr) return false;
+  Decoder decoder = mapped_file->decoder();
+  if (!Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder))) {
+    return false;
+  }
+  mapped_file_ = std::move(mapped_file);
+  return true;
+}
+
+void EncodedS2ShapeIndex::Init(MutableS2ShapeIndex* index) {
+  index->ForceBuild();
+  Minimize();
+  mapped_file_.reset();
+  shape_factory_.reset();
+  options_.set_max_edges_per_cell(index->options().max_edges_per_cell());
+
+  // This follows MutableS2ShapeIndex::Encode(), except that each cell is
+  // deleted as soon as it has been encoded.
+  auto data = make_unique<Encoder>();
+  data->Ensure(Varint::kMax64);
+  uint64 max_edges = options_.max_edges_per_cell();
+  data->put_varint64(max_edges << 2 |
+                     MutableS2ShapeIndex::kCurrentEncodingVersionNumber);
+  vector<S2CellId> cell_ids;
+  cell_ids.reserve(index->cell_map_.size());
+  s2coding::StringVectorEncoder encoded_cells;
+  const int num_shape_ids = index->num_shape_ids();
+  for (MutableS2ShapeIndex::Iterator it(index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    cell_ids.push_back(it.id());
+    it.cell().Encode(num_shape_ids, encoded_cells.AddViaEncoder());
+    index->DeleteCell(&it.cell());
+  }
+  index->cell_map_.clear();
+  s2coding::EncodeS2CellIdVector(cell_ids, data.get());
+  vector<S2CellId>().swap(cell_ids);
+  encoded_cells.Encode(data.get());
+
+  // The shapes are never decoded, so every element of shapes_ is set here.
+  owned_shapes_ = index->ReleaseAll();
+  shapes_ = std::vector<AtomicShape>(owned_shapes_.size());
+  for (int id = 0; id < owned_shapes_.size(); ++id) {
+    shapes_[id].store(owned_shapes_[id].get(), std::memory_order_relaxed);
+  }
+  Decoder decoder(data->base(), data->length());
+  uint64 max_edges_version;
+  S2_CHECK(decoder.get_varint64(&max_edges_version));
+  S2_CHECK(cell_ids_.Init(&decoder));
+  S2_CHECK(encoded_cells_.Init(&decoder));
+  owned_data_ = std::move(data);
+  cells_ = std::vector<std::atomic<S2ShapeIndexCell*>>(cell_ids_.size());
+  if (max_decoded_cell_bytes_ >= 0) {
+    set_max_decoded_cell_bytes(max_decoded_cell_bytes_);
+  }
+  if (max_decoded_shapes_ >= 0) set_max_decoded_shapes(max_decoded_shapes_);
+}
+
+void EncodedS2ShapeIndex::InitReplica(const EncodedS2ShapeIndex& index) {
+  S2_DCHECK(&index != this);
+  Minimize();
+  mapped_file_ = index.mapped_file_;
+  owned_data_.reset();
+  owned_shapes_.clear();
+  options_ = index.options_;
+  cell_ids_ = index.cell_ids_;
+  encoded_cells_ = index.encoded_cells_;
+  const int num_shapes = index.shapes_.size();
+  shapes_ = std::vector<AtomicShape>(num_shapes);
+  if (index.shape_factory_ != nullptr) {
+    shape_factory_ = index.shape_factory_->Clone();
+  } else {
+    // The shapes are owned by "index" and can't be decoded, so they are
+    // shared rather than replicated.
+    shape_factory_.reset();
+    for (int id = 0; id < num_shapes; ++id) {
+      shapes_[id].store(index.shapes_[id].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    }
+  }
+  cells_ = std::vector<std::atomic<S2ShapeIndexCell*>>(cell_ids_.size());
+  set_max_decoded_cell_bytes(index.max_decoded_cell_bytes_);
+  set_max_decoded_shapes(index.max_decoded_shapes_);
+}
+
 void EncodedS2ShapeIndex::Minimize() {
-  for (auto& atomic_shape : shapes_) {
-    S2Shape* shape = atomic_shape.load(std::memory_order_relaxed);
-    if (shape != kUndecodedShape() && shape != nullptr) {
-      atomic_shape.store(kUndecodedShape(), std::memory_order_relaxed);
-      delete shape;
+  // Owned shapes cannot be decoded again, so they are kept.
+  if (shape_factory_ != nullptr) {
+    for (auto& atomic_shape : shapes_) {
+      S2Shape* shape = atomic_shape.load(std::memory_order_relaxed);
+      if (shape != kUndecodedShape() && shape != nullptr) {
+        atomic_shape.store(kUndecodedShape(), std::memory_order_relaxed);
+        delete shape;
+      }
     }
   }
   for (auto& atomic_cell : cells_) {
@@ -135,6 +468,9 @@ void EncodedS2ShapeIndex::Minimize() {
       delete cell;
     }
   }
+  DeleteRetired();
+  decoded_cell_bytes_.store(0, std::memory_order_relaxed);
+  num_decoded_shapes_.store(0, std::memory_order_relaxed);
 }
 
 size_t EncodedS2ShapeIndex::SpaceUsed() const {
@@ -143,5 +479,9 @@ size_t EncodedS2ShapeIndex::SpaceUsed() const {
   size_t size = sizeof(*this);
   size += shapes_.capacity() * sizeof(std::atomic<S2Shape*>);
   size += cells_.capacity() * sizeof(std::atomic<S2ShapeIndexCell*>);
+  size += referenced_.capacity() * sizeof(std::atomic<bool>);
+  size += shape_referenced_.capacity() * sizeof(std::atomic<bool>);
+  size += owned_shapes_.capacity() * sizeof(unique_ptr<S2Shape>);
+  if (owned_data_ != nullptr) size += owned_data_->length();
   return size;
 }
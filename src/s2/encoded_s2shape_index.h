@@ -18,10 +18,18 @@
 #ifndef S2_ENCODED_S2SHAPE_INDEX_H_
 #define S2_ENCODED_S2SHAPE_INDEX_H_
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "s2/encoded_s2cell_id_vector.h"
 #include "s2/encoded_string_vector.h"
 #include "s2/mutable_s2shape_index.h"
 
+class Executor;
+class MappedFile;
+
 class EncodedS2ShapeIndex final : public S2ShapeIndex {
  public:
   using Options = MutableS2ShapeIndex::Options;
@@ -44,6 +52,50 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // in the Decoder's data buffer in this example.
   bool Init(Decoder* decoder, const ShapeFactory& shape_factory);
 
+  // Initializes the EncodedS2ShapeIndex from a file containing the output of
+  // s2shapeutil::CompactEncodeTaggedShapes() (or FastEncodeTaggedShapes())
+  // followed by MutableS2ShapeIndex::Encode(), returning true on success.
+  //
+  // The file is memory-mapped rather than read, and both the shapes and the
+  // index cells are decoded lazily directly from the mapped pages.  This
+  // means that initialization takes constant time regardless of the file
+  // size, only the parts of the file that are actually used by queries are
+  // ever read from disk, and processes that load the same file share its
+  // memory.  The mapping is kept until the index is destroyed or
+  // reinitialized.
+  bool InitFromFile(const std::string& path);
+
+  // Initializes the EncodedS2ShapeIndex from the given MutableS2ShapeIndex
+  // without an Encode()/Init() round trip through a separate buffer.  Any
+  // pending updates are applied first, and then each index cell is encoded
+  // and immediately deleted, so that peak memory usage is only slightly
+  // larger than that of "index" itself.  Ownership of all shapes is
+  // transferred to this index (shape ids and pointers are unchanged), and
+  // "index" is left empty (as though ReleaseAll() had been called).
+  //
+  // Since the shapes are owned rather than decoded, Minimize() and
+  // set_max_decoded_shapes() do not discard them.
+  void Init(MutableS2ShapeIndex* index);
+
+  // Initializes this index as a replica of "index".  The replica shares the
+  // encoded cells and shapes of "index" (and its file mapping, if any), but
+  // decodes cells and shapes into its own caches, starting with an empty
+  // cache.  The decoding limits (max_decoded_cell_bytes and
+  // max_decoded_shapes) of "index" are copied.
+  //
+  // This is useful on machines with several NUMA nodes: rather than having
+  // threads on every node share the decoded state of one index, each node
+  // can query its own replica.  Since memory is normally allocated on the
+  // node of the thread that first touches it, InitReplica() and any calls to
+  // DecodeAllCells() should be made from a thread running on that node.
+  // Replicas are cheap to create, since no encoded data is copied.
+  //
+  // REQUIRES: "index" is initialized and outlives the replica (unless it was
+  //           initialized by InitFromFile(), in which case the replica
+  //           keeps the file mapping alive; the ShapeFactory passed to
+  //           Init(Decoder*, ...) is cloned).
+  void InitReplica(const EncodedS2ShapeIndex& index);
+
   const Options& options() const { return options_; }
 
   // The number of distinct shape ids in the index.  This equals the number of
@@ -53,6 +105,10 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
 
   // Return a pointer to the shape with the given id, or nullptr if the shape
   // has been removed from the index.
+  //
+  // If max_decoded_shapes() >= 0, the returned shape may be evicted at any
+  // time and is only guaranteed to remain valid while an Iterator or Pin
+  // that existed when shape() was called is alive (see below).
   S2Shape* shape(int id) const override;
 
   // Minimizes memory usage by requesting that any data structures that can be
@@ -61,6 +117,89 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // Like all non-const methods, this method is not thread-safe.
   void Minimize() override;
 
+  // Decodes all cells of the index that have not been decoded yet.  If
+  // "executor" is not nullptr, the cells are decoded in parallel.  This is
+  // useful before a full scan of a large index (or before many threads start
+  // querying it), since otherwise each cell is decoded when it is first
+  // accessed.  This method is thread-safe.
+  void DecodeAllCells(Executor* executor = nullptr) const;
+
+  // Sets an approximate limit on the memory used by decoded cells.  When the
+  // limit is exceeded, cells that have not been accessed recently are evicted
+  // (using the CLOCK algorithm) and are decoded again if they are needed
+  // later.  A negative value means that there is no limit, in which case
+  // decoded cells are kept until Minimize() is called.
+  //
+  // Readers may continue to use the index while cells are being evicted.
+  // Evicted cells are only deleted once every iterator that existed at the
+  // time of eviction has been destroyed (or reinitialized), since clients
+  // may keep pointers to the cells they have visited.  This means that the
+  // limit only applies to cells that are reachable from the index:
+  // long-lived iterators (e.g., one iterator used for a full scan) delay
+  // the reclamation of evicted cells until they are destroyed.
+  //
+  // REQUIRES: No iterators exist and no other thread is using the index.
+  //
+  // DEFAULT: -1 (no limit)
+  void set_max_decoded_cell_bytes(int64 max_bytes);
+  int64 max_decoded_cell_bytes() const { return max_decoded_cell_bytes_; }
+
+  // Returns the approximate memory used by the decoded cells that have not
+  // been evicted.  Only maintained when max_decoded_cell_bytes() >= 0.
+  int64 decoded_cell_bytes() const {
+    return decoded_cell_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Sets a limit on the number of decoded shapes (e.g., shapes decoded by
+  // s2shapeutil::LazyDecodeShapeFactory).  When the limit is exceeded,
+  // shapes that have not been accessed recently are evicted (using the CLOCK
+  // algorithm) and are decoded again by the ShapeFactory if they are needed
+  // later, which means that shape() may return a different pointer for the
+  // same shape id over time.  A negative value means that there is no limit.
+  //
+  // Evicted shapes are reclaimed in the same way as evicted cells, i.e. once
+  // every Iterator and Pin that existed at the time of eviction has been
+  // destroyed.  Queries hold an iterator for as long as they use the index,
+  // so they can use the shapes they obtain safely.  Other code should hold a
+  // Pin while using the result of shape():
+  //
+  //   EncodedS2ShapeIndex::Pin pin(&index);
+  //   const S2Shape* shape = index.shape(id);
+  //   ... use "shape" while "pin" is alive ...
+  //
+  // REQUIRES: No iterators or pins exist and no other thread is using the
+  //           index.
+  //
+  // DEFAULT: -1 (no limit)
+  void set_max_decoded_shapes(int max_shapes);
+  int max_decoded_shapes() const { return max_decoded_shapes_; }
+
+  // Returns the number of decoded shapes that have not been evicted.  Only
+  // maintained when max_decoded_shapes() >= 0.
+  int num_decoded_shapes() const {
+    return num_decoded_shapes_.load(std::memory_order_relaxed);
+  }
+
+  // Keeps the cells and shapes obtained from the index while it is alive
+  // from being deleted when they are evicted.  Iterators do the same
+  // implicitly.  Pins are cheap (one atomic increment and decrement) and do
+  // nothing when neither limit is set.
+  class Pin {
+   public:
+    explicit Pin(const EncodedS2ShapeIndex* index)
+        : index_(index), epoch_parity_(index->PinEpoch()) {}
+    ~Pin() {
+      if (epoch_parity_ >= 0) index_->UnpinEpoch(epoch_parity_);
+    }
+
+   private:
+    const EncodedS2ShapeIndex* const index_;
+    const int8 epoch_parity_;
+
+    Pin(const Pin&) = delete;
+    void operator=(const Pin&) = delete;
+  };
+
   class Iterator final : public IteratorBase {
    public:
     // Default constructor; must be followed by a call to Init().
@@ -78,6 +217,10 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
     explicit Iterator(const EncodedS2ShapeIndex* index,
                       InitialPosition pos = UNPOSITIONED);
 
+    Iterator(const Iterator& other);
+    Iterator& operator=(const Iterator& other);
+    ~Iterator() override;
+
     // Initializes an iterator for the given EncodedS2ShapeIndex.
     void Init(const EncodedS2ShapeIndex* index,
               InitialPosition pos = UNPOSITIONED);
@@ -97,6 +240,14 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
     bool Locate(const S2Point& target) override;
     CellRelation Locate(S2CellId target) override;
 
+    // Sets the number of cells that are decoded at once when the iterator
+    // reaches a cell that has not been decoded yet: the current cell and the
+    // following (num_cells - 1) cells are decoded together.  This speeds up
+    // sequential scans, since the encoded cells are then read in order and
+    // the decoding loop stays hot.  The default value of 1 decodes each cell
+    // only when it is accessed.
+    void set_readahead(int num_cells);
+
    protected:
     const S2ShapeIndexCell* GetCell() const override;
     std::unique_ptr<IteratorBase> Clone() const override;
@@ -107,6 +258,11 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
     const EncodedS2ShapeIndex* index_;
     int32 cell_pos_;  // Current position in the vector of index cells.
     int32 num_cells_;
+    int32 readahead_ = 1;
+
+    // The parity of the reclamation epoch that this iterator is registered
+    // in, or -1 if the index does not evict anything (see PinEpoch).
+    int8 epoch_parity_ = -1;
   };
 
   // Returns the number of bytes currently occupied by the index (including any
@@ -134,8 +290,42 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   S2Shape* GetShape(int id) const;
   const S2ShapeIndexCell* GetCell(int i) const;
 
+  // Decodes the cells in the range [begin, end) that have not been decoded
+  // yet.
+  void DecodeCells(int begin, int end) const;
+
+  // Returns the approximate number of bytes used by a decoded cell.
+  static int64 CellBytes(const S2ShapeIndexCell& cell);
+
+  // Registers an iterator or Pin in the current reclamation epoch and
+  // returns the epoch's parity, or returns -1 if nothing is ever evicted.
+  // Cells and shapes evicted during an epoch are deleted only when no
+  // iterators or pins registered in that epoch (or earlier) remain.
+  int8 PinEpoch() const;
+  void UnpinEpoch(int8 parity) const;
+
+  // Evicts cells and shapes until both are below their limits, and deletes
+  // evicted objects that can no longer be referenced by any iterator or pin.
+  // Does nothing if another thread is already evicting.
+  void Evict() const;
+  void EvictCells(std::vector<S2ShapeIndexCell*>* retired) const;
+  void EvictShapes(std::vector<S2Shape*>* retired) const;
+
+  // Deletes all evicted cells and shapes.  Not thread-safe.
+  void DeleteRetired();
+
+  // Decodes the shapes, or nullptr if the shapes are owned (see below).
   std::unique_ptr<ShapeFactory> shape_factory_;
 
+  // When initialized from a MutableS2ShapeIndex, the shapes taken from that
+  // index and the buffer holding the encoded cells.
+  std::vector<std::unique_ptr<S2Shape>> owned_shapes_;
+  std::unique_ptr<Encoder> owned_data_;
+
+  // The file that the index was initialized from, if any.  Decoded shapes
+  // refer directly to its contents, so it must outlive them.
+  std::shared_ptr<const MappedFile> mapped_file_;
+
   // The options specified for this index.
   Options options_;
 
@@ -155,6 +345,30 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // to the vector using std::atomic::compare_exchange_strong.
   mutable std::vector<std::atomic<S2ShapeIndexCell*>> cells_;
 
+  // The fields below implement the bounded cell cache (see
+  // set_max_decoded_cell_bytes).  "referenced_" is only allocated when there
+  // is a limit, and contains the CLOCK "recently used" bit of each cell.
+  int64 max_decoded_cell_bytes_ = -1;
+  mutable std::atomic<int64> decoded_cell_bytes_;
+  mutable std::vector<std::atomic<bool>> referenced_;
+
+  // Likewise for the decoded shapes (see set_max_decoded_shapes).
+  int max_decoded_shapes_ = -1;
+  mutable std::atomic<int> num_decoded_shapes_;
+  mutable std::vector<std::atomic<bool>> shape_referenced_;
+
+  // Only the thread that sets "evicting_" may access the clock hands and the
+  // retired vectors.  Objects evicted during epoch E are appended to
+  // retired_*[E & 1], and "active_iterators_[E & 1]" counts the iterators
+  // and pins registered during epoch E.
+  mutable std::atomic<bool> evicting_;
+  mutable size_t clock_hand_ = 0;
+  mutable size_t shape_clock_hand_ = 0;
+  mutable std::atomic<uint64> epoch_;
+  mutable std::atomic<int> active_iterators_[2];
+  mutable std::vector<S2ShapeIndexCell*> retired_cells_[2];
+  mutable std::vector<S2Shape*> retired_shapes_[2];
+
   EncodedS2ShapeIndex(const EncodedS2ShapeIndex&) = delete;
   void operator=(const EncodedS2ShapeIndex&) = delete;
 };
@@ -171,9 +385,15 @@ inline EncodedS2ShapeIndex::Iterator::Iterator(
   Init(index, pos);
 }
 
+inline EncodedS2ShapeIndex::Iterator::~Iterator() {
+  if (epoch_parity_ >= 0) index_->UnpinEpoch(epoch_parity_);
+}
+
 inline void EncodedS2ShapeIndex::Iterator::Init(
     const EncodedS2ShapeIndex* index, InitialPosition pos) {
+  if (epoch_parity_ >= 0) index_->UnpinEpoch(epoch_parity_);
   index_ = index;
+  epoch_parity_ = index->PinEpoch();
   num_cells_ = index->cell_ids_.size();
   cell_pos_ = (pos == BEGIN) ? 0 : num_cells_;
   Refresh();
@@ -185,9 +405,17 @@ inline void EncodedS2ShapeIndex::Iterator::Refresh() {
   } else {
     set_state(index_->cell_ids_[cell_pos_],
               index_->cells_[cell_pos_].load(std::memory_order_relaxed));
+    if (index_->max_decoded_cell_bytes_ >= 0) {
+      index_->referenced_[cell_pos_].store(true, std::memory_order_relaxed);
+    }
   }
 }
 
+inline void EncodedS2ShapeIndex::Iterator::set_readahead(int num_cells) {
+  S2_DCHECK_GE(num_cells, 1);
+  readahead_ = num_cells;
+}
+
 inline void EncodedS2ShapeIndex::Iterator::Begin() {
   cell_pos_ = 0;
   Refresh();
@@ -212,7 +440,14 @@ inline bool EncodedS2ShapeIndex::Iterator::Prev() {
 }
 
 inline void EncodedS2ShapeIndex::Iterator::Seek(S2CellId target) {
-  cell_pos_ = index_->cell_ids_.lower_bound(target);
+  // Seeks are frequently made in increasing order (e.g., when processing
+  // sorted points), so if the target is ahead of the current cell we search
+  // forward from the current position.
+  if (cell_pos_ < num_cells_ && id() < target) {
+    cell_pos_ = index_->cell_ids_.lower_bound(target, cell_pos_ + 1);
+  } else {
+    cell_pos_ = index_->cell_ids_.lower_bound(target);
+  }
   Refresh();
 }
 
@@ -223,8 +458,11 @@ EncodedS2ShapeIndex::NewIterator(InitialPosition pos) const {
 
 inline S2Shape* EncodedS2ShapeIndex::shape(int id) const {
   S2Shape* shape = shapes_[id].load(std::memory_order_relaxed);
-  if (shape != kUndecodedShape()) return shape;
-  return GetShape(id);
+  if (shape == kUndecodedShape()) return GetShape(id);
+  if (max_decoded_shapes_ >= 0) {
+    shape_referenced_[id].store(true, std::memory_order_relaxed);
+  }
+  return shape;
 }
 
 #endif  // S2_ENCODED_S2SHAPE_INDEX_H_
@@ -17,9 +17,15 @@
 
 #include "s2/encoded_s2shape_index.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <map>
+#include <string>
+#include <thread>
 #include <vector>
 #include <gtest/gtest.h>
+#include "s2/base/mutex.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/strings/str_cat.h"
 #include "s2/mutable_s2shape_index.h"
@@ -36,16 +42,19 @@
 #include "s2/s2loop.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2pointutil.h"
+#include "s2/s2polygon.h"
 #include "s2/s2shapeutil_coding.h"
 #include "s2/s2shapeutil_testing.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using absl::StrCat;
 using s2builderutil::S2CellIdSnapFunction;
 using s2builderutil::S2PolylineLayer;
 using std::max;
+using std::string;
 using std::unique_ptr;
 using std::vector;
 
@@ -242,3 +251,272 @@ TEST(EncodedS2ShapeIndex, SnappedFractalPolylines) {
   TestEncodedS2ShapeIndex<S2LaxPolylineShape, EncodedS2LaxPolylineShape>(
       index, 8698);
 }
+
+TEST(EncodedS2ShapeIndex, InitFromFile) {
+  auto expected = s2textformat::MakeIndexOrDie(
+      "0:0 | 0:1 | 5:5 # 1:1, 1:2, 1:3 | 4:4, 4:5 # 2:2, 2:3, 3:3; 10:10, "
+      "10:12, 12:12, 12:10");
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(*expected, &encoder));
+  expected->Encode(&encoder);
+
+  const char* tmpdir = std::getenv("TEST_TMPDIR");
+  string path = StrCat(tmpdir ? tmpdir : "/tmp", "/encoded_s2shape_index_",
+                       S2Testing::rnd.Rand32());
+  {
+    std::ofstream file(path, std::ios::binary);
+    file.write(encoder.base(), encoder.length());
+    ASSERT_TRUE(file.good());
+  }
+  {
+    EncodedS2ShapeIndex actual;
+    ASSERT_TRUE(actual.InitFromFile(path));
+    std::remove(path.c_str());  // The mapping remains valid.
+    EXPECT_EQ(s2textformat::ToString(*expected),
+              s2textformat::ToString(actual));
+    s2testing::ExpectEqual(*expected, actual);
+  }
+  EncodedS2ShapeIndex missing;
+  EXPECT_FALSE(missing.InitFromFile(path));
+}
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(EncodedS2ShapeIndex, ReadaheadAndDecodeAllCells) {
+  MutableS2ShapeIndex expected;
+  S2Polygon polygon(S2Loop::MakeRegularLoop(S2Point(3, 2, 1).Normalize(),
+                                            S1Angle::Degrees(0.1), 4096));
+  expected.Add(make_unique<S2LaxPolygonShape>(polygon));
+  Encoder encoder;
+  s2shapeutil::EncodeHomogeneousShapes<S2LaxPolygonShape>(expected, &encoder);
+  expected.Encode(&encoder);
+  for (int readahead : {1, 7, 1000}) {
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2ShapeIndex actual;
+    ASSERT_TRUE(DecodeHomegeneousShapeIndex<EncodedS2LaxPolygonShape>(
+        &actual, &decoder));
+    MutableS2ShapeIndex::Iterator expected_it(&expected, S2ShapeIndex::BEGIN);
+    EncodedS2ShapeIndex::Iterator actual_it(&actual, S2ShapeIndex::BEGIN);
+    actual_it.set_readahead(readahead);
+    for (; !expected_it.done(); expected_it.Next(), actual_it.Next()) {
+      ASSERT_FALSE(actual_it.done());
+      EXPECT_EQ(expected_it.id(), actual_it.id());
+      EXPECT_EQ(expected_it.cell().clipped(0).num_edges(),
+                actual_it.cell().clipped(0).num_edges());
+    }
+    EXPECT_TRUE(actual_it.done());
+  }
+  for (bool parallel : {false, true}) {
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2ShapeIndex actual;
+    ASSERT_TRUE(DecodeHomegeneousShapeIndex<EncodedS2LaxPolygonShape>(
+        &actual, &decoder));
+    ThreadPerTaskExecutor executor;
+    actual.DecodeAllCells(parallel ? &executor : nullptr);
+    s2testing::ExpectEqual(expected, actual);
+  }
+}
+
+TEST(EncodedS2ShapeIndex, BoundedDecodedCellCache) {
+  MutableS2ShapeIndex expected;
+  S2Polygon polygon(S2Loop::MakeRegularLoop(S2Point(3, 2, 1).Normalize(),
+                                            S1Angle::Degrees(0.1), 4096));
+  expected.Add(make_unique<S2LaxPolygonShape>(polygon));
+  vector<std::pair<S2CellId, int>> expected_cells;
+  for (MutableS2ShapeIndex::Iterator it(&expected, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    expected_cells.push_back(
+        std::make_pair(it.id(), it.cell().clipped(0).num_edges()));
+  }
+  Encoder encoder;
+  s2shapeutil::EncodeHomogeneousShapes<S2LaxPolygonShape>(expected, &encoder);
+  expected.Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2ShapeIndex actual;
+  ASSERT_TRUE(DecodeHomegeneousShapeIndex<EncodedS2LaxPolygonShape>(
+      &actual, &decoder));
+  const int64 kMaxBytes = 4096;
+  actual.set_max_decoded_cell_bytes(kMaxBytes);
+  EXPECT_EQ(kMaxBytes, actual.max_decoded_cell_bytes());
+
+  // Each scan uses a new iterator, so that evicted cells can be reclaimed.
+  auto scan = [&actual, &expected_cells]() {
+    EncodedS2ShapeIndex::Iterator it(&actual, S2ShapeIndex::BEGIN);
+    for (const auto& cell : expected_cells) {
+      ASSERT_FALSE(it.done());
+      EXPECT_EQ(cell.first, it.id());
+      EXPECT_EQ(cell.second, it.cell().clipped(0).num_edges());
+      it.Next();
+    }
+    EXPECT_TRUE(it.done());
+  };
+  for (int iter = 0; iter < 3; ++iter) {
+    scan();
+    EXPECT_GT(actual.decoded_cell_bytes(), 0);
+    EXPECT_LE(actual.decoded_cell_bytes(), kMaxBytes);
+  }
+  vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&scan]() {
+      for (int iter = 0; iter < 5; ++iter) scan();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  scan();
+  EXPECT_LE(actual.decoded_cell_bytes(), kMaxBytes);
+  s2testing::ExpectEqual(expected, actual);
+}
+
+TEST(EncodedS2ShapeIndex, BoundedDecodedShapes) {
+  const int kNumShapes = 40, kMaxShapes = 5;
+  MutableS2ShapeIndex expected;
+  S2Cap cap(S2Point(0.3, -0.2, 0.8).Normalize(), S1Angle::Degrees(1));
+  for (int i = 0; i < kNumShapes; ++i) {
+    vector<S2Point> vertices;
+    for (int j = 0; j <= 10; ++j) {
+      vertices.push_back(S2Testing::SamplePoint(cap));
+    }
+    expected.Add(make_unique<S2LaxPolylineShape>(vertices));
+  }
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(expected, &encoder));
+  expected.Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2ShapeIndex actual;
+  ASSERT_TRUE(actual.Init(&decoder,
+                          s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+  actual.set_max_decoded_shapes(kMaxShapes);
+  EXPECT_EQ(kMaxShapes, actual.max_decoded_shapes());
+
+  auto check_shapes = [&actual, &expected](int num_iters) {
+    for (int iter = 0; iter < num_iters; ++iter) {
+      int id = iter % kNumShapes;
+      EncodedS2ShapeIndex::Pin pin(&actual);
+      const S2Shape* shape = actual.shape(id);
+      ASSERT_EQ(expected.shape(id)->num_edges(), shape->num_edges());
+      EXPECT_EQ(expected.shape(id)->edge(3), shape->edge(3));
+      EXPECT_EQ(id, shape->id());
+    }
+  };
+  check_shapes(3 * kNumShapes);
+  EXPECT_GT(actual.num_decoded_shapes(), 0);
+  EXPECT_LE(actual.num_decoded_shapes(), kMaxShapes);
+  vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&check_shapes]() { check_shapes(200); });
+  }
+  for (auto& thread : threads) thread.join();
+  check_shapes(kNumShapes);
+  EXPECT_LE(actual.num_decoded_shapes(), kMaxShapes);
+  s2testing::ExpectEqual(expected, actual);
+}
+
+TEST(EncodedS2ShapeIndex, InitFromMutableIndex) {
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex expected, mutable_index;
+  // Cells allocated from an arena must also be released correctly.
+  MutableS2ShapeIndex::Options arena_options;
+  arena_options.set_use_cell_arena(true);
+  mutable_index.Init(arena_options);
+  for (MutableS2ShapeIndex* index : {&expected, &mutable_index}) {
+    S2Testing::rnd.Reset(1);
+    for (int i = 0; i < 20; ++i) {
+      index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+          S2Testing::RandomPoint(), S1Angle::Degrees(5),
+          S2Testing::rnd.Uniform(500) + 3)));
+    }
+  }
+  mutable_index.Release(3);
+  unique_ptr<S2Shape> removed = expected.Release(3);
+  vector<const S2Shape*> shapes;
+  for (int id = 0; id < mutable_index.num_shape_ids(); ++id) {
+    shapes.push_back(mutable_index.shape(id));
+  }
+  EncodedS2ShapeIndex actual;
+  actual.set_max_decoded_cell_bytes(10000);
+  actual.Init(&mutable_index);
+  EXPECT_EQ(0, mutable_index.num_shape_ids());
+  EXPECT_TRUE(MutableS2ShapeIndex::Iterator(&mutable_index,
+                                            S2ShapeIndex::BEGIN).done());
+  ASSERT_EQ(shapes.size(), actual.num_shape_ids());
+  for (int id = 0; id < actual.num_shape_ids(); ++id) {
+    EXPECT_EQ(shapes[id], actual.shape(id));
+  }
+  s2testing::ExpectEqual(expected, actual);
+
+  // The only extra memory is the encoded cell data.
+  Encoder encoder;
+  expected.Encode(&encoder);
+  EXPECT_LT(actual.SpaceUsed(), expected.SpaceUsed() + encoder.length());
+
+  // Owned shapes are not discarded by Minimize().
+  actual.Minimize();
+  EXPECT_EQ(shapes[0], actual.shape(0));
+  EXPECT_EQ(nullptr, actual.shape(3));
+  s2testing::ExpectEqual(expected, actual);
+}
+
+TEST(EncodedS2ShapeIndex, InitReplica) {
+  auto add_loops = [](MutableS2ShapeIndex* index) {
+    S2Testing::rnd.Reset(1);
+    for (int i = 0; i < 20; ++i) {
+      index->Add(make_unique<S2LaxPolygonShape>(S2Polygon(
+          S2Loop::MakeRegularLoop(S2Testing::RandomPoint(),
+                                  S1Angle::Degrees(5), 50))));
+    }
+  };
+  MutableS2ShapeIndex expected;
+  add_loops(&expected);
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(expected, &encoder));
+  expected.Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2ShapeIndex original;
+  ASSERT_TRUE(original.Init(&decoder,
+                            s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+  original.set_max_decoded_shapes(10);
+  original.DecodeAllCells();
+
+  // The replica has the same contents but its own decoded cells and shapes,
+  // which can be built by other threads while the original is in use.
+  EncodedS2ShapeIndex replica;
+  replica.InitReplica(original);
+  EXPECT_EQ(10, replica.max_decoded_shapes());
+  EXPECT_EQ(0, replica.num_decoded_shapes());
+  std::thread thread([&replica]() { replica.DecodeAllCells(); });
+  s2testing::ExpectEqual(expected, original);
+  thread.join();
+  s2testing::ExpectEqual(expected, replica);
+  EncodedS2ShapeIndex::Iterator it1(&original, S2ShapeIndex::BEGIN);
+  EncodedS2ShapeIndex::Iterator it2(&replica, S2ShapeIndex::BEGIN);
+  EXPECT_EQ(it1.id(), it2.id());
+  EXPECT_NE(&it1.cell(), &it2.cell());
+  EncodedS2ShapeIndex::Pin pin1(&original), pin2(&replica);
+  EXPECT_NE(original.shape(0), replica.shape(0));
+
+  // Replicas of an index that owns its shapes share those shapes.
+  EncodedS2ShapeIndex owning;
+  MutableS2ShapeIndex copy;
+  add_loops(&copy);
+  owning.Init(&copy);
+  EncodedS2ShapeIndex owning_replica;
+  owning_replica.InitReplica(owning);
+  EXPECT_EQ(owning.shape(5), owning_replica.shape(5));
+  s2testing::ExpectEqual(expected, owning_replica);
+}
@@ -42,6 +42,31 @@ void StringVectorEncoder::Encode(Span<const string> v, Encoder* encoder) {
   string_vector.Encode(encoder);
 }
 
+bool StringVectorEncoder::EncodeStreaming(
+    int n, const std::function<bool (int i, Encoder* encoder)>& encode,
+    Encoder* encoder) {
+  // First compute the offsets, using a scratch encoder that is large enough
+  // for the longest string.
+  vector<uint64> offsets;
+  offsets.reserve(n);
+  Encoder scratch;
+  uint64 offset = 0;
+  for (int i = 0; i < n; ++i) {
+    scratch.clear();
+    if (!encode(i, &scratch)) return false;
+    offset += scratch.length();
+    offsets.push_back(offset);
+  }
+  EncodeUintVector<uint64>(offsets, encoder);
+  for (int i = 0; i < n; ++i) {
+    size_t start = encoder->length();
+    if (!encode(i, encoder)) return false;
+    S2_DCHECK_EQ(offsets[i] - (i == 0 ? 0 : offsets[i - 1]),
+                 encoder->length() - start);
+  }
+  return true;
+}
+
 bool EncodedStringVector::Init(Decoder* decoder) {
   if (!offsets_.Init(decoder)) return false;
   data_ = reinterpret_cast<const char*>(decoder->ptr());
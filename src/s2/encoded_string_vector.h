@@ -18,6 +18,7 @@
 #ifndef S2_ENCODED_STRING_VECTOR_H_
 #define S2_ENCODED_STRING_VECTOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include "s2/third_party/absl/strings/string_view.h"
@@ -43,7 +44,7 @@ class StringVectorEncoder {
   StringVectorEncoder();
 
   // Adds a string to the encoded vector.
-  void Add(const string& str);
+  void Add(absl::string_view str);
 
   // Adds a string to the encoded vector by means of the given Encoder.  The
   // string consists of all output added to the encoder before the next call
@@ -63,6 +64,22 @@ class StringVectorEncoder {
   //           can be enlarged as necessary by calling Ensure(int).
   static void Encode(absl::Span<const string> v, Encoder* encoder);
 
+  // Encodes "n" strings in a format that can later be decoded as an
+  // EncodedStringVector, where string "i" consists of the output added to an
+  // Encoder by calling encode(i, encoder).  Unlike the methods above, the
+  // string data is never buffered.  Instead "encode" is called twice for each
+  // string: once to determine its length (so that the offsets can be written
+  // before the data), and once to write it directly to "encoder".  This is
+  // useful when "encoder" passes its output to an Encoder::Sink.  "encode"
+  // must produce the same output both times, and may return false to
+  // indicate an error (in which case this method also returns false).
+  //
+  // REQUIRES: "encoder" uses the default constructor or a Sink, so that its
+  //           buffer can be enlarged as necessary by calling Ensure(int).
+  static bool EncodeStreaming(
+      int n, const std::function<bool (int i, Encoder* encoder)>& encode,
+      Encoder* encoder);
+
  private:
   // A vector consisting of the starting offset of each string in the
   // encoder's data buffer, plus a final entry pointing just past the end of
@@ -118,7 +135,7 @@ class EncodedStringVector {
 //////////////////   Implementation details follow   ////////////////////
 
 
-inline void StringVectorEncoder::Add(const string& str) {
+inline void StringVectorEncoder::Add(absl::string_view str) {
   offsets_.push_back(data_.length());
   data_.Ensure(str.size());
   data_.putn(str.data(), str.size());
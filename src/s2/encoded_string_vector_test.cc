@@ -17,6 +17,7 @@
 
 #include "s2/encoded_string_vector.h"
 
+#include <string>
 #include <vector>
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/strings/string_view.h"
@@ -26,6 +27,16 @@ using std::vector;
 
 namespace s2coding {
 
+// An Encoder::Sink that appends its input to a string.
+class StringSink : public Encoder::Sink {
+ public:
+  explicit StringSink(string* output) : output_(output) {}
+  void Append(const char* data, size_t n) override { output_->append(data, n); }
+
+ private:
+  string* output_;
+};
+
 void TestEncodedStringVector(const vector<string>& input,
                              size_t expected_bytes) {
   Encoder encoder;
@@ -39,6 +50,20 @@ void TestEncodedStringVector(const vector<string>& input,
     expected.push_back(string_view(str));
   }
   EXPECT_EQ(actual.Decode(), expected);
+
+  // Check that EncodeStreaming() yields the same output.
+  string streamed;
+  StringSink sink(&streamed);
+  {
+    Encoder sink_encoder(&sink, 16);
+    ASSERT_TRUE(StringVectorEncoder::EncodeStreaming(
+        input.size(), [&input](int i, Encoder* e) {
+          e->Ensure(input[i].size());
+          e->putn(input[i].data(), input[i].size());
+          return true;
+        }, &sink_encoder));
+  }
+  EXPECT_EQ(string(encoder.base(), encoder.length()), streamed);
 }
 
 TEST(EncodedStringVectorTest, Empty) {
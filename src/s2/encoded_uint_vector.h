@@ -18,6 +18,8 @@
 #ifndef S2_ENCODED_UINT_VECTOR_H_
 #define S2_ENCODED_UINT_VECTOR_H_
 
+#include <algorithm>
+#include <limits>
 #include <type_traits>
 #include <vector>
 #include "s2/third_party/absl/base/internal/unaligned_access.h"
@@ -26,6 +28,10 @@
 
 namespace s2coding {
 
+// Controls whether to optimize for speed or size when encoding.  (Note that
+// encoding is always lossless.)
+enum CodingHint { FAST, COMPACT };
+
 // Encodes a vector of unsigned integers in a format that can later be
 // decoded as an EncodedUintVector.
 //
@@ -36,6 +42,15 @@ namespace s2coding {
 template <class T>
 void EncodeUintVector(absl::Span<const T> v, Encoder* encoder);
 
+// As above, but if "hint" is COMPACT then the values may instead be
+// bit-packed using the minimum number of bits per value.  This format is
+// chosen whenever it is smaller.  Bit-packed values are slightly slower to
+// access, and the format cannot be read by EncodedUintVector implementations
+// that predate it.  With FAST this is equivalent to the function above.
+template <class T>
+void EncodeUintVector(absl::Span<const T> v, CodingHint hint,
+                      Encoder* encoder);
+
 // This class represents an encoded vector of unsigned integers of type T.
 // Values are decoded only when they are accessed.  This allows for very fast
 // initialization and no additional memory use beyond the encoded data.
@@ -48,7 +63,9 @@ void EncodeUintVector(absl::Span<const T> v, Encoder* encoder);
 // the data structure is actually used.
 //
 // Values are encoded using a fixed number of bytes per value, where the
-// number of bytes depends on the largest value present.
+// number of bytes depends on the largest value present.  Alternatively values
+// may be bit-packed using a fixed number of bits per value (see
+// EncodeUintVector).
 //
 // REQUIRES: T is an unsigned integer type.
 // REQUIRES: 2 <= sizeof(T) <= 8
@@ -82,13 +99,37 @@ class EncodedUintVector {
   // REQUIRES: The vector elements are sorted in non-decreasing order.
   size_t lower_bound(T target) const;
 
+  // Like lower_bound(target), except that the search starts at position
+  // "start" and proceeds using exponentially increasing steps ("galloping").
+  // This takes time logarithmic in the distance between "start" and the
+  // result, which makes it efficient for sequences of increasing targets.
+  //
+  // REQUIRES: The vector elements are sorted in non-decreasing order.
+  // REQUIRES: start <= size(), and all elements before "start" are less than
+  //           "target".
+  size_t lower_bound(T target, size_t start) const;
+
   // Decodes and returns the entire original vector.
   std::vector<T> Decode() const;
 
+  // Decodes the elements in the range [begin, end) into "output", which must
+  // have room for (end - begin) values.
+  //
+  // REQUIRES: begin <= end <= size()
+  void Decode(size_t begin, size_t end, T* output) const;
+
  private:
+  // Returns the index of the first element x in the range [lo, hi) such that
+  // (x >= target), or "hi" if no such element exists.
+  size_t LowerBoundInRange(T target, size_t lo, size_t hi) const;
+
+  // Returns the element at the given index of a bit-packed vector.
+  T GetBitPacked(size_t i) const;
+
   const char* data_;
   uint32 size_;
-  uint8 len_;
+  uint8 len_;   // Bytes per value, or 0 if the values are bit-packed.
+  uint8 bits_;  // Bits per value, if the values are bit-packed.
 };
 
 // Encodes an unsigned integer in little-endian format using "length" bytes.
@@ -214,10 +255,73 @@ void EncodeUintVector(absl::Span<const T> v, Encoder* encoder) {
   }
 }
 
+// The bit-packed encoding is as follows:
+//
+//   varint64: kBitPackedMarker
+//   varint64: (v.size() << 6) | (bits - 1)
+//   ceil(v.size() * bits / 8) bytes of values, stored as a little-endian
+//       stream of "bits" bits each
+//
+// The marker value corresponds to an empty vector with (len == 2) in the
+// byte-aligned encoding, which EncodeUintVector never produces.
+static constexpr uint64 kBitPackedMarker = 1;
+
+template <class T>
+void EncodeUintVector(absl::Span<const T> v, CodingHint hint,
+                      Encoder* encoder) {
+  if (hint == CodingHint::FAST) return EncodeUintVector(v, encoder);
+
+  T one_bits = 1;  // Ensures bits >= 1.
+  for (auto x : v) one_bits |= x;
+  int bits = Bits::Log2FloorNonZero64(one_bits) + 1;
+  int len = ((bits - 1) >> 3) + 1;
+  uint64 size_len = (uint64{v.size()} * sizeof(T)) | (len - 1);
+  uint64 size_bits = (uint64{v.size()} << 6) | (bits - 1);
+  size_t packed_bytes = (uint64{v.size()} * bits + 7) >> 3;
+  if (Varint::Length64(kBitPackedMarker) + Varint::Length64(size_bits) +
+      packed_bytes >= Varint::Length64(size_len) + v.size() * len) {
+    return EncodeUintVector(v, encoder);
+  }
+  encoder->Ensure(2 * Varint::kMax64 + packed_bytes);
+  encoder->put_varint64(kBitPackedMarker);
+  encoder->put_varint64(size_bits);
+  // "acc" holds the "n" bits that have not been written yet.
+  uint64 acc = 0;
+  int n = 0;
+  for (auto x : v) {
+    uint64 value = x;
+    acc |= value << n;
+    if (n + bits < 64) {
+      n += bits;
+    } else {
+      encoder->put64(acc);
+      int remaining = n + bits - 64;
+      acc = (remaining == 0) ? 0 : value >> (bits - remaining);
+      n = remaining;
+    }
+  }
+  EncodeUintWithLength<uint64>(acc, (n + 7) >> 3, encoder);
+}
+
 template <class T>
 bool EncodedUintVector<T>::Init(Decoder* decoder) {
   uint64 size_len;
   if (!decoder->get_varint64(&size_len)) return false;
+  if (size_len == kBitPackedMarker) {
+    uint64 size_bits;
+    if (!decoder->get_varint64(&size_bits)) return false;
+    uint64 size = size_bits >> 6;
+    bits_ = (size_bits & 63) + 1;
+    if (bits_ > 8 * sizeof(T)) return false;
+    if (size > std::numeric_limits<uint32>::max()) return false;
+    size_ = size;
+    len_ = 0;
+    size_t bytes = (size * bits_ + 7) >> 3;
+    if (decoder->avail() < bytes) return false;
+    data_ = reinterpret_cast<const char*>(decoder->ptr());
+    decoder->skip(bytes);
+    return true;
+  }
   size_ = size_len / sizeof(T);  // Optimized into bit shift.
   len_ = (size_len & (sizeof(T) - 1)) + 1;
   if (size_ > std::numeric_limits<size_t>::max() / sizeof(T)) return false;
@@ -242,9 +346,25 @@ inline size_t EncodedUintVector<T>::size() const {
 template <class T>
 inline T EncodedUintVector<T>::operator[](int i) const {
   S2_DCHECK(i >= 0 && i < size_);
+  if (len_ == 0) return GetBitPacked(i);
   return GetUintWithLength<T>(data_ + i * len_, len_);
 }
 
+template <class T>
+inline T EncodedUintVector<T>::GetBitPacked(size_t i) const {
+  uint64 offset = uint64{i} * bits_;
+  size_t byte = offset >> 3;
+  int shift = offset & 7;
+  // Load up to 8 bytes without reading past the end of the data.
+  size_t avail = ((uint64{size_} * bits_ + 7) >> 3) - byte;
+  uint64 x = GetUintWithLength<uint64>(data_ + byte,
+                                       std::min<size_t>(8, avail)) >> shift;
+  if (shift + bits_ > 64) {
+    x |= uint64{static_cast<uint8>(data_[byte + 8])} << (64 - shift);
+  }
+  return x & (~uint64{0} >> (64 - bits_));
+}
+
 template <class T>
 inline size_t EncodedUintVector<T>::lower_bound(T target) const {
   // TODO(ericv): Consider using the unused 28 bits of "len_" to store the
@@ -253,27 +373,60 @@ inline size_t EncodedUintVector<T>::lower_bound(T target) const {
   // would require declaring the new field (length_lower_bound_hint_) as
   // mutable std::atomic<uint32> (accessed using std::memory_order_relaxed)
   // with a custom copy constructor that resets the hint component to zero.
-  size_t lo = 0, hi = size_;
-  while (lo < hi) {
-    size_t mid = (lo + hi) >> 1;
-    if ((*this)[mid] < target) {
-      lo = mid + 1;
-    } else {
-      hi = mid;
-    }
+  return LowerBoundInRange(target, 0, size_);
+}
+
+template <class T>
+inline size_t EncodedUintVector<T>::lower_bound(T target, size_t start) const {
+  S2_DCHECK_LE(start, size_);
+  // Find a range [lo, hi) that contains the result (or hi == size_), where
+  // the range doubles in size at each step.
+  size_t lo = start, hi = start;
+  for (size_t step = 1; hi < size_ && (*this)[hi] < target; step *= 2) {
+    lo = hi + 1;
+    hi = lo + step;
+  }
+  return LowerBoundInRange(target, lo, std::min<size_t>(hi, size_));
+}
+
+template <class T>
+inline size_t EncodedUintVector<T>::LowerBoundInRange(T target, size_t lo,
+                                                      size_t hi) const {
+  // This binary search does not contain any data-dependent branches (the
+  // conditional is typically compiled into a conditional move), which avoids
+  // branch mispredictions.  The result is in the range [lo, lo + n].
+  size_t n = hi - lo;
+  if (n == 0) return lo;
+  while (n > 1) {
+    size_t half = n >> 1;
+    lo = ((*this)[lo + half] < target) ? lo + half : lo;
+    n -= half;
   }
-  return lo;
+  return lo + ((*this)[lo] < target);
 }
 
 template <class T>
 std::vector<T> EncodedUintVector<T>::Decode() const {
   std::vector<T> result(size_);
-  for (int i = 0; i < size_; ++i) {
-    result[i] = (*this)[i];
-  }
+  Decode(0, size_, result.data());
   return result;
 }
 
+template <class T>
+void EncodedUintVector<T>::Decode(size_t begin, size_t end, T* output) const {
+  S2_DCHECK_LE(begin, end);
+  S2_DCHECK_LE(end, size_);
+  // The mode is tested once outside each loop so that the loops are simple
+  // enough for the compiler to unroll.
+  if (len_ != 0) {
+    for (size_t i = begin; i < end; ++i) {
+      *output++ = GetUintWithLength<T>(data_ + i * len_, len_);
+    }
+  } else {
+    for (size_t i = begin; i < end; ++i) *output++ = GetBitPacked(i);
+  }
+}
+
 }  // namespace s2coding
 
 #endif  // S2_ENCODED_UINT_VECTOR_H_
@@ -17,6 +17,7 @@
 
 #include "s2/encoded_uint_vector.h"
 
+#include <algorithm>
 #include <vector>
 #include <gtest/gtest.h>
 
@@ -69,4 +70,87 @@ TEST(EncodedUintVectorTest, EightBytes) {
   TestEncodedUintVector(vector<uint64>{~0ULL, 0, 0x0102030405060708}, 25);
 }
 
+TEST(EncodedUintVectorTest, LowerBound) {
+  // Test both lower_bound() methods against std::lower_bound, for vectors of
+  // several sizes containing duplicate values.
+  for (int size = 0; size < 40; ++size) {
+    vector<uint32> values;
+    for (int i = 0; i < size; ++i) values.push_back(2 * (i / 3) + 1);
+    Encoder encoder;
+    EncodeUintVector<uint32>(values, &encoder);
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedUintVector<uint32> actual;
+    ASSERT_TRUE(actual.Init(&decoder));
+    for (uint32 target = 0; target <= 2 * (size / 3) + 2; ++target) {
+      size_t expected =
+          std::lower_bound(values.begin(), values.end(), target) -
+          values.begin();
+      EXPECT_EQ(expected, actual.lower_bound(target));
+      for (size_t start = 0; start <= expected; ++start) {
+        EXPECT_EQ(expected, actual.lower_bound(target, start));
+      }
+    }
+  }
+}
+
+// Encodes "expected" using the COMPACT hint and checks that it decodes
+// correctly.  Returns the encoded size.
+template <class T>
+size_t TestCompactEncodedUintVector(const vector<T>& expected) {
+  Encoder encoder;
+  EncodeUintVector<T>(expected, CodingHint::COMPACT, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedUintVector<T> actual;
+  EXPECT_TRUE(actual.Init(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+  EXPECT_EQ(actual.Decode(), expected);
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i], actual[i]);
+  }
+  return encoder.length();
+}
+
+TEST(EncodedUintVectorTest, CompactSmallValues) {
+  // 100 values of 3 bits each require 38 bytes when bit-packed, plus a
+  // 3-byte header.
+  vector<uint32> values;
+  for (int i = 0; i < 100; ++i) values.push_back(i % 7);
+  EXPECT_EQ(3 + 38, TestCompactEncodedUintVector(values));
+}
+
+TEST(EncodedUintVectorTest, CompactFallsBackToBytes) {
+  // Values that need all 8 bits of each byte are never bit-packed, so the
+  // encoding is the same as with the FAST hint.
+  TestCompactEncodedUintVector(vector<uint32>{});
+  EXPECT_EQ(5, TestCompactEncodedUintVector(vector<uint64>{0, 255, 1, 254}));
+}
+
+TEST(EncodedUintVectorTest, CompactAllBitWidths) {
+  // Includes widths where a value straddles the 64-bit load window.
+  for (int bits = 1; bits <= 64; ++bits) {
+    vector<uint64> values;
+    uint64 max_value = ~uint64{0} >> (64 - bits);
+    for (int i = 0; i < 37; ++i) {
+      values.push_back(max_value - (i * 0x9e3779b97f4a7c15ULL) % max_value);
+    }
+    TestCompactEncodedUintVector(values);
+  }
+}
+
+TEST(EncodedUintVectorTest, DecodeRange) {
+  vector<uint16> values;
+  for (int i = 0; i < 50; ++i) values.push_back(i * 37);
+  for (CodingHint hint : {CodingHint::FAST, CodingHint::COMPACT}) {
+    Encoder encoder;
+    EncodeUintVector<uint16>(values, hint, &encoder);
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedUintVector<uint16> actual;
+    ASSERT_TRUE(actual.Init(&decoder));
+    vector<uint16> output(20);
+    actual.Decode(10, 30, output.data());
+    EXPECT_EQ(vector<uint16>(values.begin() + 10, values.begin() + 30),
+              output);
+  }
+}
+
 }  // namespace s2coding
@@ -0,0 +1,176 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/flat_s2shape_index.h"
+
+#include <limits>
+#include <utility>
+
+#include "s2/base/casts.h"
+#include "s2/base/logging.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Fills in the subtree of the Eytzinger search tree rooted at node "k" with
+// the next cell ids in increasing order, starting at ids[*pos].
+void BuildSearchTree(const vector<S2CellId>& ids, size_t k, int32* pos,
+                     vector<uint64>* search_ids, vector<int32>* search_pos) {
+  if (k >= search_ids->size()) return;
+  BuildSearchTree(ids, 2 * k, pos, search_ids, search_pos);
+  (*search_ids)[k] = ids[*pos].id();
+  (*search_pos)[k] = (*pos)++;
+  BuildSearchTree(ids, 2 * k + 1, pos, search_ids, search_pos);
+}
+
+}  // namespace
+
+bool FlatS2ShapeIndex::Iterator::Locate(const S2Point& target) {
+  return LocateImpl(target, this);
+}
+
+FlatS2ShapeIndex::CellRelation FlatS2ShapeIndex::Iterator::Locate(
+    S2CellId target) {
+  return LocateImpl(target, this);
+}
+
+const S2ShapeIndexCell* FlatS2ShapeIndex::Iterator::GetCell() const {
+  // Since set_state() is always called with a non-null cell, this method is
+  // never called.
+  S2_LOG(DFATAL) << "Should never be called";
+  return nullptr;
+}
+
+unique_ptr<FlatS2ShapeIndex::IteratorBase>
+FlatS2ShapeIndex::Iterator::Clone() const {
+  return make_unique<Iterator>(*this);
+}
+
+void FlatS2ShapeIndex::Iterator::Copy(const IteratorBase& other)  {
+  *this = *down_cast<const Iterator*>(&other);
+}
+
+FlatS2ShapeIndex::FlatS2ShapeIndex() {
+}
+
+FlatS2ShapeIndex::FlatS2ShapeIndex(const S2ShapeIndex* index) {
+  Init(index);
+}
+
+FlatS2ShapeIndex::~FlatS2ShapeIndex() {
+  Clear();
+}
+
+void FlatS2ShapeIndex::Init(const S2ShapeIndex* index) {
+  Clear();
+  source_ = index;
+  num_shape_ids_ = index->num_shape_ids();
+
+  // The first pass counts the cells, the clipped shapes, and the edges, so
+  // that each array can be allocated exactly once.
+  int num_cells = 0, num_clipped = 0;
+  size_t num_edge_ids = 0, num_edges = 0;
+  S2ShapeIndex::Iterator it;
+  for (it.Init(index, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
+    const S2ShapeIndexCell& cell = it.cell();
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      if (!clipped.is_inline()) num_edge_ids += clipped.num_edges();
+      num_edges += clipped.num_edges();
+    }
+    num_clipped += cell.num_clipped();
+    ++num_cells;
+  }
+  S2_DCHECK_LE(num_edges, std::numeric_limits<int32>::max());
+  cell_ids_.reserve(num_cells);
+  cells_.reset(new S2ShapeIndexCell[num_cells]);
+  clipped_.resize(num_clipped);
+  edge_ids_.resize(num_edge_ids);
+  edge_begins_.reserve(num_clipped + 1);
+  edge_v0_.reserve(num_edges);
+  edge_v1_.reserve(num_edges);
+
+  // The second pass copies the cells, pointing them into "clipped_" and
+  // "edge_ids_", and copies the endpoints of every clipped edge.
+  S2ClippedShape* next_clipped = clipped_.data();
+  int32* next_edge_id = edge_ids_.data();
+  for (it.Begin(); !it.done(); it.Next()) {
+    const S2ShapeIndexCell& cell = it.cell();
+    S2ShapeIndexCell* new_cell = &cells_[cell_ids_.size()];
+    cell_ids_.push_back(it.id());
+    if (cell.num_clipped() == 0) continue;
+    new_cell->shapes_ = next_clipped;
+    new_cell->num_shapes_ = cell.num_clipped();
+    new_cell->owns_shapes_ = false;
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      const int n = clipped.num_edges();
+      next_clipped->Init(clipped.shape_id(), n, next_edge_id);
+      next_clipped->set_contains_center(clipped.contains_center());
+      if (!next_clipped->is_inline()) next_edge_id += n;
+      edge_begins_.push_back(static_cast<int32>(edge_v0_.size()));
+      const S2Shape* shape = index->shape(clipped.shape_id());
+      for (int i = 0; i < n; ++i) {
+        next_clipped->set_edge(i, clipped.edge(i));
+        auto edge = shape->edge(clipped.edge(i));
+        edge_v0_.push_back(edge.v0);
+        edge_v1_.push_back(edge.v1);
+      }
+      ++next_clipped;
+    }
+  }
+  edge_begins_.push_back(static_cast<int32>(edge_v0_.size()));
+  S2_DCHECK(next_clipped == clipped_.data() + clipped_.size());
+  S2_DCHECK(next_edge_id == edge_ids_.data() + edge_ids_.size());
+
+  search_ids_.resize(num_cells + 1);
+  search_pos_.resize(num_cells + 1);
+  int32 pos = 0;
+  BuildSearchTree(cell_ids_, 1, &pos, &search_ids_, &search_pos_);
+}
+
+void FlatS2ShapeIndex::Clear() {
+  // The clipped shapes and their edge ids are owned by "clipped_" and
+  // "edge_ids_" rather than by the cells, so destroying the cells does not
+  // free them.
+  cells_.reset();
+  cell_ids_.clear();
+  search_ids_.clear();
+  search_pos_.clear();
+  clipped_.clear();
+  edge_ids_.clear();
+  edge_begins_.clear();
+  edge_v0_.clear();
+  edge_v1_.clear();
+  source_ = nullptr;
+  num_shape_ids_ = 0;
+}
+
+size_t FlatS2ShapeIndex::SpaceUsed() const {
+  size_t size = sizeof(*this);
+  size += cell_ids_.capacity() * sizeof(S2CellId);
+  size += cell_ids_.size() * sizeof(S2ShapeIndexCell);
+  size += search_ids_.capacity() * sizeof(uint64);
+  size += search_pos_.capacity() * sizeof(int32);
+  size += clipped_.capacity() * sizeof(S2ClippedShape);
+  size += edge_ids_.capacity() * sizeof(int32);
+  size += edge_begins_.capacity() * sizeof(int32);
+  size += (edge_v0_.capacity() + edge_v1_.capacity()) * sizeof(S2Point);
+  return size;
+}
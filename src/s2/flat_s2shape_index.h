@@ -0,0 +1,297 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_FLAT_S2SHAPE_INDEX_H_
+#define S2_FLAT_S2SHAPE_INDEX_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "s2/base/logging.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/bits/bits.h"
+
+// FlatS2ShapeIndex is a read-only S2ShapeIndex that is laid out for low
+// latency point location and point containment queries, e.g. for servers
+// that answer S2ContainsPointQuery requests against a fixed set of polygons.
+// It is built from any existing S2ShapeIndex and differs from it as follows:
+//
+//  - The cell ids are additionally stored in "Eytzinger" (breadth-first
+//    binary tree) order, so that the first few levels of every Seek() or
+//    Locate() share a few cache lines and later levels are prefetched.
+//
+//  - The edge endpoints of every clipped shape are copied into contiguous
+//    arrays in cell order.  S2ContainsPointQuery<FlatS2ShapeIndex> reads
+//    them from there rather than calling S2Shape::edge() for each edge,
+//    which avoids chasing pointers into the shapes (and, for example, the
+//    loop search in S2Polygon::Shape::edge()).
+//
+// The extra copy of the edge endpoints uses 48 bytes per clipped edge, so
+// this index is larger than the index it was built from.  CompactS2ShapeIndex
+// is a better choice when memory matters more than latency.
+//
+// Example usage:
+//
+//   EncodedS2ShapeIndex encoded;
+//   encoded.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder));
+//   FlatS2ShapeIndex index(&encoded);
+//   auto query = MakeS2ContainsPointQuery(&index);
+//   for (const S2Point& p : points) { if (query.Contains(p)) ... }
+//
+// The shapes are not copied: shape(id) returns the corresponding shape of
+// the original index, which must persist and must not be modified while
+// this index is in use.  Shape ids, iterator semantics, and the results of
+// all queries are exactly the same as for the original index.
+//
+// Like other S2ShapeIndex types, all const methods are thread-safe.
+class FlatS2ShapeIndex final : public S2ShapeIndex {
+ public:
+  // Creates an empty index, which may be initialized by calling Init().
+  FlatS2ShapeIndex();
+
+  // Convenience constructor that calls Init().
+  explicit FlatS2ShapeIndex(const S2ShapeIndex* index);
+
+  ~FlatS2ShapeIndex() override;
+
+  // Initializes the index from the contents of "index", which is not owned
+  // and must persist while this index is in use.  Any existing contents of
+  // this index are discarded.
+  void Init(const S2ShapeIndex* index);
+
+  // Returns the index that this index was built from.
+  const S2ShapeIndex& source() const { return *source_; }
+
+  int num_shape_ids() const override { return num_shape_ids_; }
+
+  // Returns the shape with the given id in the original index.
+  S2Shape* shape(int id) const override { return source_->shape(id); }
+
+  // Returns the number of index cells.
+  int num_cells() const { return static_cast<int>(cell_ids_.size()); }
+
+  // Does nothing, since all cell data is required by the index.
+  void Minimize() override {}
+
+  // Returns the number of bytes currently occupied by the index (not
+  // including the shapes or the original index).
+  size_t SpaceUsed() const override;
+
+  // Copies the endpoints of the edges of "clipped" to v0[i] and v1[i], in
+  // the order given by clipped.edge(i).  This is equivalent to calling
+  // shape(clipped.shape_id())->edge(clipped.edge(i)) for each edge.
+  //
+  // REQUIRES: "clipped" belongs to a cell of this index.
+  void GetClippedEdges(const S2ClippedShape& clipped, S2Point* v0,
+                       S2Point* v1) const;
+
+  class Iterator final : public IteratorBase {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator();
+
+    // Constructs an iterator positioned as specified.  By default iterators
+    // are unpositioned, since this avoids an extra seek in this situation
+    // where one of the seek methods (such as Locate) is immediately called.
+    explicit Iterator(const FlatS2ShapeIndex* index,
+                      InitialPosition pos = UNPOSITIONED);
+
+    // Initializes an iterator for the given FlatS2ShapeIndex.
+    void Init(const FlatS2ShapeIndex* index,
+              InitialPosition pos = UNPOSITIONED);
+
+    // Inherited non-virtual methods:
+    //   S2CellId id() const;
+    //   bool done() const;
+    //   S2Point center() const;
+    const S2ShapeIndexCell& cell() const;
+
+    // IteratorBase API:
+    void Begin() override;
+    void Finish() override;
+    void Next() override;
+    bool Prev() override;
+    void Seek(S2CellId target) override;
+    bool Locate(const S2Point& target) override;
+    CellRelation Locate(S2CellId target) override;
+
+   protected:
+    const S2ShapeIndexCell* GetCell() const override;
+    std::unique_ptr<IteratorBase> Clone() const override;
+    void Copy(const IteratorBase& other) override;
+
+   private:
+    void Refresh();  // Updates the IteratorBase fields.
+    const FlatS2ShapeIndex* index_;
+    int cell_pos_;   // Index of current cell in cell_ids_
+    int num_cells_;  // Number of cells
+  };
+
+ protected:
+  std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
+
+ private:
+  friend class Iterator;
+
+  // Returns the position in cell_ids_ of the first cell id that is greater
+  // than or equal to "target", or num_cells() if there is no such cell.
+  int LowerBound(S2CellId target) const;
+
+  // Deletes all cells.
+  void Clear();
+
+  const S2ShapeIndex* source_ = nullptr;
+  int num_shape_ids_ = 0;
+
+  // The cell ids in increasing order, and the corresponding cells.
+  std::vector<S2CellId> cell_ids_;
+  std::unique_ptr<S2ShapeIndexCell[]> cells_;
+
+  // The cell ids in Eytzinger order: the children of search_ids_[k] are
+  // search_ids_[2k] and search_ids_[2k+1], and search_ids_[0] is unused.
+  // search_pos_[k] is the position of search_ids_[k] in cell_ids_.
+  std::vector<uint64> search_ids_;
+  std::vector<int32> search_pos_;
+
+  // The clipped shapes of all cells, and the edge ids of the clipped shapes
+  // that do not store them inline.  The cells point into these arrays, so
+  // they must not be resized.
+  std::vector<S2ClippedShape> clipped_;
+  std::vector<int32> edge_ids_;
+
+  // The edges of clipped_[i] are (edge_v0_[j], edge_v1_[j]) for
+  // edge_begins_[i] <= j < edge_begins_[i + 1].
+  std::vector<int32> edge_begins_;
+  std::vector<S2Point> edge_v0_, edge_v1_;
+
+  FlatS2ShapeIndex(const FlatS2ShapeIndex&) = delete;
+  void operator=(const FlatS2ShapeIndex&) = delete;
+};
+
+// S2ContainsPointQuery reads the edges of a FlatS2ShapeIndex directly from
+// the index rather than from its shapes.
+template <>
+inline void S2ContainsPointQuery<FlatS2ShapeIndex>::GetClippedEdges(
+    const S2ClippedShape& clipped, const S2Shape& shape, S2Point* v0,
+    S2Point* v1) const {
+  index_->GetClippedEdges(clipped, v0, v1);
+}
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline void FlatS2ShapeIndex::GetClippedEdges(const S2ClippedShape& clipped,
+                                              S2Point* v0, S2Point* v1) const {
+  const size_t i = &clipped - clipped_.data();
+  S2_DCHECK_LT(i, clipped_.size());
+  const int32 begin = edge_begins_[i], end = edge_begins_[i + 1];
+  std::copy(edge_v0_.begin() + begin, edge_v0_.begin() + end, v0);
+  std::copy(edge_v1_.begin() + begin, edge_v1_.begin() + end, v1);
+}
+
+inline int FlatS2ShapeIndex::LowerBound(S2CellId target) const {
+  // Each step descends to the left child if the current key is not less
+  // than "target", and to the right child otherwise.  After the loop, "k"
+  // encodes the path taken; the lower bound is the last node where the path
+  // went left, which is found by stripping the trailing right turns (1 bits)
+  // and the final left turn.
+  const uint64* ids = search_ids_.data();
+  const size_t n = cell_ids_.size();
+  const uint64 key = target.id();
+  size_t k = 1;
+  while (k <= n) {
+    // The descendants of "k" four levels down occupy 16 consecutive
+    // entries (two cache lines), which are fetched ahead of time.
+    __builtin_prefetch(ids + 16 * k);
+    k = 2 * k + (ids[k] < key);
+  }
+  k >>= Bits::FindLSBSetNonZero64(~static_cast<uint64>(k)) + 1;
+  return (k == 0) ? static_cast<int>(n) : search_pos_[k];
+}
+
+inline FlatS2ShapeIndex::Iterator::Iterator() : index_(nullptr) {
+}
+
+inline FlatS2ShapeIndex::Iterator::Iterator(
+    const FlatS2ShapeIndex* index, InitialPosition pos) {
+  Init(index, pos);
+}
+
+inline void FlatS2ShapeIndex::Iterator::Init(
+    const FlatS2ShapeIndex* index, InitialPosition pos) {
+  index_ = index;
+  num_cells_ = index->num_cells();
+  cell_pos_ = (pos == BEGIN) ? 0 : num_cells_;
+  Refresh();
+}
+
+inline const S2ShapeIndexCell& FlatS2ShapeIndex::Iterator::cell() const {
+  // The "cell_" field is always set, so we can skip the logic in the base
+  // class that conditionally calls GetCell().
+  return *raw_cell();
+}
+
+inline void FlatS2ShapeIndex::Iterator::Refresh() {
+  if (cell_pos_ == num_cells_) {
+    set_finished();
+  } else {
+    set_state(index_->cell_ids_[cell_pos_], &index_->cells_[cell_pos_]);
+  }
+}
+
+inline void FlatS2ShapeIndex::Iterator::Begin() {
+  cell_pos_ = 0;
+  Refresh();
+}
+
+inline void FlatS2ShapeIndex::Iterator::Finish() {
+  cell_pos_ = num_cells_;
+  Refresh();
+}
+
+inline void FlatS2ShapeIndex::Iterator::Next() {
+  S2_DCHECK(!done());
+  ++cell_pos_;
+  Refresh();
+}
+
+inline bool FlatS2ShapeIndex::Iterator::Prev() {
+  if (cell_pos_ == 0) return false;
+  --cell_pos_;
+  Refresh();
+  return true;
+}
+
+inline void FlatS2ShapeIndex::Iterator::Seek(S2CellId target) {
+  cell_pos_ = index_->LowerBound(target);
+  Refresh();
+}
+
+inline std::unique_ptr<FlatS2ShapeIndex::IteratorBase>
+FlatS2ShapeIndex::NewIterator(InitialPosition pos) const {
+  return absl::make_unique<Iterator>(this, pos);
+}
+
+#endif  // S2_FLAT_S2SHAPE_INDEX_H_
@@ -0,0 +1,159 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/flat_s2shape_index.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Adds a mix of polygons and polylines to "index", including loops with
+// enough edges that some clipped shapes do not store their edges inline,
+// and a polygon with several loops.
+void AddShapes(MutableS2ShapeIndex* index) {
+  vector<unique_ptr<S2Loop>> loops;
+  for (int i = 0; i < 10; ++i) {
+    S2Point center = S2Testing::RandomPoint();
+    index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        center, S2Testing::KmToAngle(S2Testing::rnd.UniformDouble(10, 1000)),
+        S2Testing::rnd.Uniform(200) + 3)));
+    vector<S2Point> vertices;
+    for (int j = 0; j < 20; ++j) vertices.push_back(S2Testing::RandomPoint());
+    index->Add(make_unique<S2Polyline::OwningShape>(
+        make_unique<S2Polyline>(vertices)));
+    loops.push_back(S2Loop::MakeRegularLoop(
+        center, S2Testing::KmToAngle(S2Testing::rnd.UniformDouble(1, 5)), 8));
+  }
+  auto polygon = make_unique<S2Polygon>();
+  polygon->InitNested(std::move(loops));
+  index->Add(make_unique<S2Polygon::OwningShape>(std::move(polygon)));
+}
+
+TEST(FlatS2ShapeIndex, Empty) {
+  MutableS2ShapeIndex source;
+  FlatS2ShapeIndex index(&source);
+  EXPECT_EQ(0, index.num_shape_ids());
+  EXPECT_EQ(0, index.num_cells());
+  FlatS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  EXPECT_TRUE(it.done());
+  EXPECT_FALSE(it.Prev());
+  EXPECT_FALSE(it.Locate(S2Point(1, 0, 0)));
+  it.Seek(S2CellId::Begin(S2CellId::kMaxLevel));
+  EXPECT_TRUE(it.done());
+}
+
+TEST(FlatS2ShapeIndex, SameContentsAsSourceIndex) {
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex source;
+  AddShapes(&source);
+  FlatS2ShapeIndex index(&source);
+  EXPECT_EQ(&source, &index.source());
+  s2testing::ExpectEqual(source, index);
+
+  // Check that iterators behave identically, including when seeking to the
+  // id of every cell and to the ids just before and after it.
+  MutableS2ShapeIndex::Iterator expected_it(&source);
+  FlatS2ShapeIndex::Iterator it(&index);
+  vector<S2CellId> targets;
+  for (expected_it.Begin(); !expected_it.done(); expected_it.Next()) {
+    targets.push_back(expected_it.id());
+    targets.push_back(expected_it.id().prev());
+    targets.push_back(expected_it.id().range_max().next());
+  }
+  for (int iter = 0; iter < 1000; ++iter) {
+    targets.push_back(S2Testing::GetRandomCellId());
+  }
+  for (S2CellId id : targets) {
+    if (!id.is_valid()) continue;
+    EXPECT_EQ(expected_it.Locate(id), it.Locate(id));
+    expected_it.Seek(id);
+    it.Seek(id);
+    ASSERT_EQ(expected_it.done(), it.done());
+    if (!it.done()) EXPECT_EQ(expected_it.id(), it.id());
+    ASSERT_EQ(expected_it.Prev(), it.Prev());
+    EXPECT_EQ(expected_it.id(), it.id());
+  }
+}
+
+TEST(FlatS2ShapeIndex, QueriesMatchSourceIndex) {
+  S2Testing::rnd.Reset(2);
+  MutableS2ShapeIndex source;
+  AddShapes(&source);
+  FlatS2ShapeIndex index(&source);
+  vector<S2Point> points;
+  for (int i = 0; i < 300; ++i) points.push_back(S2Testing::RandomPoint());
+  // Also test points near the loop boundaries, and the vertices themselves.
+  for (int id = 0; id < source.num_shape_ids(); ++id) {
+    const S2Shape& shape = *source.shape(id);
+    for (int e = 0; e < shape.num_edges(); e += 7) {
+      points.push_back(shape.edge(e).v0);
+      points.push_back(S2Testing::SamplePoint(
+          S2Cap(shape.edge(e).v0, S2Testing::KmToAngle(1))));
+    }
+  }
+  for (auto model : {S2VertexModel::OPEN, S2VertexModel::SEMI_OPEN,
+                     S2VertexModel::CLOSED}) {
+    S2ContainsPointQueryOptions options(model);
+    auto expected_query = MakeS2ContainsPointQuery(&source, options);
+    auto query = MakeS2ContainsPointQuery(&index, options);
+    for (const S2Point& p : points) {
+      EXPECT_EQ(expected_query.GetContainingShapes(p),
+                query.GetContainingShapes(p));
+    }
+  }
+  S2ClosestEdgeQuery expected_closest(&source), closest(&index);
+  for (int iter = 0; iter < 100; ++iter) {
+    S2ClosestEdgeQuery::PointTarget target(S2Testing::RandomPoint());
+    EXPECT_EQ(expected_closest.GetDistance(&target),
+              closest.GetDistance(&target));
+  }
+}
+
+TEST(FlatS2ShapeIndex, Reinit) {
+  MutableS2ShapeIndex source, empty;
+  S2Point center(1, 0, 0);
+  source.Add(make_unique<S2Loop::OwningShape>(
+      S2Loop::MakeRegularLoop(center, S2Testing::KmToAngle(10), 20)));
+  FlatS2ShapeIndex index(&source);
+  ASSERT_EQ(1, index.num_shape_ids());
+  EXPECT_EQ(source.shape(0), index.shape(0));
+  EXPECT_TRUE(MakeS2ContainsPointQuery(&index).Contains(center));
+
+  // Init() may be called again to replace the contents.
+  index.Init(&empty);
+  EXPECT_EQ(0, index.num_shape_ids());
+  EXPECT_EQ(0, index.num_cells());
+}
+
+}  // namespace
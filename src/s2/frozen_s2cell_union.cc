@@ -0,0 +1,44 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/frozen_s2cell_union.h"
+
+#include "s2/base/logging.h"
+
+using std::vector;
+
+FrozenS2CellUnion::FrozenS2CellUnion(const S2CellUnion& cell_union) {
+  Init(cell_union);
+}
+
+void FrozenS2CellUnion::Init(const S2CellUnion& cell_union) {
+  S2_DCHECK(cell_union.IsValid());
+  nodes_.assign(cell_union.num_cells() + 1, Node{0, 0});
+  int next = 0;
+  InitSubtree(cell_union.cell_ids(), 1, &next);
+  S2_DCHECK_EQ(next, cell_union.num_cells());
+}
+
+// Fills in the subtree rooted at nodes_[k] using an in-order traversal, so
+// that the cells are assigned to the nodes in sorted order.
+void FrozenS2CellUnion::InitSubtree(const vector<S2CellId>& cell_ids, int k,
+                                    int* next) {
+  if (k >= static_cast<int>(nodes_.size())) return;
+  InitSubtree(cell_ids, 2 * k, next);
+  S2CellId id = cell_ids[(*next)++];
+  nodes_[k] = Node{id.range_min().id(), id.range_max().id()};
+  InitSubtree(cell_ids, 2 * k + 1, next);
+}
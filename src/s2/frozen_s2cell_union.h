@@ -0,0 +1,123 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_FROZEN_S2CELL_UNION_H_
+#define S2_FROZEN_S2CELL_UNION_H_
+
+#include <vector>
+
+#include "s2/base/port.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/util/bits/bits.h"
+
+// FrozenS2CellUnion is an immutable copy of an S2CellUnion that is laid out
+// for fast membership tests.  S2CellUnion::Contains() performs a binary
+// search over a sorted vector, which incurs a cache miss at almost every
+// step once the union is larger than the cache.  FrozenS2CellUnion instead
+// stores the cells in "Eytzinger" order (the order of a breadth-first
+// traversal of a complete binary search tree), where the nodes visited at
+// the first few levels of every search share a handful of cache lines, and
+// the children of each node are adjacent so that they can be prefetched
+// several levels in advance.
+//
+// This class is worthwhile only for large unions (thousands of cells or
+// more) that are queried many times.  Example usage:
+//
+//   FrozenS2CellUnion frozen(covering);
+//   if (frozen.Contains(point)) ...
+class FrozenS2CellUnion {
+ public:
+  // Constructs an empty union; call Init() to initialize it.
+  FrozenS2CellUnion() : nodes_(1) {}
+
+  // Convenience constructor that calls Init().
+  explicit FrozenS2CellUnion(const S2CellUnion& cell_union);
+
+  // Initializes the object with the cells of "cell_union".
+  //
+  // REQUIRES: cell_union.IsValid() (e.g., the union is normalized).
+  void Init(const S2CellUnion& cell_union);
+
+  // Returns the number of cells in the union.
+  int num_cells() const { return static_cast<int>(nodes_.size()) - 1; }
+
+  // Returns true if the union contains the given cell id.  Equivalent to
+  // S2CellUnion::Contains(S2CellId).
+  bool Contains(S2CellId id) const;
+
+  // Returns true if the union contains the given point, which does not need
+  // to be normalized.
+  bool Contains(const S2Point& p) const { return Contains(S2CellId(p)); }
+
+  // Returns true if the union intersects the given cell id.  Equivalent to
+  // S2CellUnion::Intersects(S2CellId).
+  bool Intersects(S2CellId id) const;
+
+ private:
+  // The range of leaf cell ids covered by one cell of the union.
+  struct Node {
+    uint64 range_min, range_max;
+  };
+
+  void InitSubtree(const std::vector<S2CellId>& cell_ids, int k, int* next);
+
+  // Returns the node with the smallest range_max >= "target", or nullptr if
+  // there is no such node.
+  const Node* LowerBound(uint64 target) const;
+
+  // The cells in Eytzinger order, where nodes_[k] has children nodes_[2k]
+  // and nodes_[2k+1].  nodes_[0] is unused.
+  std::vector<Node> nodes_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline const FrozenS2CellUnion::Node* FrozenS2CellUnion::LowerBound(
+    uint64 target) const {
+  const size_t n = nodes_.size();
+  size_t k = 1;
+  while (k < n) {
+    // The four grandchildren of node "k" are adjacent (64 bytes), so
+    // fetching them now hides most of the memory latency of the next level.
+    if (4 * k < n) prefetch(&nodes_[4 * k]);
+    k = 2 * k + (nodes_[k].range_max < target);
+  }
+  // The path from the root went right at every node that was too small.
+  // The answer is the last node where it went left, which is found by
+  // removing the trailing 1 bits (plus one 0 bit) from "k".
+  k >>= Bits::FindLSBSetNonZero64(~k) + 1;
+  return k == 0 ? nullptr : &nodes_[k];
+}
+
+inline bool FrozenS2CellUnion::Contains(S2CellId id) const {
+  // Since the cells are disjoint, the only cell that can contain "id" is the
+  // first one that ends at or after the end of "id".
+  const Node* node = LowerBound(id.range_max().id());
+  return node != nullptr && node->range_min <= id.range_min().id();
+}
+
+inline bool FrozenS2CellUnion::Intersects(S2CellId id) const {
+  // The first cell that ends at or after the start of "id" intersects it if
+  // and only if that cell also starts before the end of "id".
+  const Node* node = LowerBound(id.range_min().id());
+  return node != nullptr && node->range_min <= id.range_max().id();
+}
+
+#endif  // S2_FROZEN_S2CELL_UNION_H_
@@ -0,0 +1,61 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/frozen_s2cell_union.h"
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+namespace {
+
+TEST(FrozenS2CellUnion, Empty) {
+  FrozenS2CellUnion frozen;
+  EXPECT_EQ(0, frozen.num_cells());
+  EXPECT_FALSE(frozen.Contains(S2CellId::FromFace(1)));
+  EXPECT_FALSE(frozen.Intersects(S2CellId::FromFace(1)));
+}
+
+TEST(FrozenS2CellUnion, MatchesS2CellUnion) {
+  S2Testing::rnd.Reset(1);
+  // Test unions of all sizes up to a few complete tree levels, so that
+  // both complete and incomplete trees are covered.
+  for (int max_cells = 1; max_cells <= 2000; max_cells = 2 * max_cells + 1) {
+    S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(20));
+    S2RegionCoverer::Options options;
+    options.set_max_cells(max_cells);
+    S2CellUnion covering = S2RegionCoverer(options).GetCovering(cap);
+    FrozenS2CellUnion frozen(covering);
+    EXPECT_EQ(covering.num_cells(), frozen.num_cells());
+    for (S2CellId id : covering) {
+      EXPECT_TRUE(frozen.Contains(id));
+      EXPECT_TRUE(frozen.Intersects(id));
+    }
+    for (int iter = 0; iter < 1000; ++iter) {
+      S2CellId id = S2CellId(S2Testing::SamplePoint(cap.Expanded(
+          S1Angle::Degrees(5)))).parent(S2Testing::rnd.Uniform(31));
+      EXPECT_EQ(covering.Contains(id), frozen.Contains(id));
+      EXPECT_EQ(covering.Intersects(id), frozen.Intersects(id));
+      S2Point p = S2Testing::RandomPoint();
+      EXPECT_EQ(covering.Contains(p), frozen.Contains(p));
+    }
+  }
+}
+
+}  // namespace
@@ -68,6 +68,14 @@ int32 IdSetLexicon::AddInternal(std::vector<int32>* ids) {
   }
 }
 
+IdSetLexicon::SetIdMap IdSetLexicon::Merge(const IdSetLexicon& other) {
+  // The sets of "other" are already canonical, so they can be added to
+  // "id_sets_" directly.
+  SetIdMap map;
+  map.sequence_ids_ = id_sets_.Merge(other.id_sets_);
+  return map;
+}
+
 IdSetLexicon::IdSet IdSetLexicon::id_set(int32 set_id) const {
   if (set_id >= 0) {
     return IdSet(set_id);
@@ -129,6 +129,28 @@ class IdSetLexicon {
   // Return the set of integers corresponding to an id returned by Add().
   IdSet id_set(int32 set_id) const;
 
+  // Maps the set ids of one lexicon to the ids of the same sets in another
+  // lexicon (see Merge below).
+  class SetIdMap {
+   public:
+    // Returns the id in the destination lexicon of the set with the given
+    // id in the source lexicon.
+    int32 Map(int32 set_id) const;
+
+   private:
+    friend class IdSetLexicon;
+    std::vector<uint32> sequence_ids_;
+  };
+
+  // Adds all sets of "other" to this lexicon, and returns a SetIdMap that
+  // maps the set ids of "other" to the set ids of this lexicon.  This allows
+  // lexicons built independently (e.g., by different threads) to be combined
+  // in time proportional to the size of "other".  Note that the elements of
+  // the sets are not changed, so they should refer to the same namespace.
+  //
+  // REQUIRES: &other != this
+  SetIdMap Merge(const IdSetLexicon& other);
+
  private:
   // Choose kEmptySetId to be the last id that will ever be generated.
   // (Non-negative ids are reserved for singleton sets.)
@@ -169,6 +191,12 @@ inline IdSetLexicon::IdSet::IdSet(int32 singleton_id)
       singleton_id_(singleton_id) {
 }
 
+inline int32 IdSetLexicon::SetIdMap::Map(int32 set_id) const {
+  // Singleton sets and the empty set have the same id in every lexicon.
+  if (set_id >= 0 || set_id == kEmptySetId) return set_id;
+  return ~sequence_ids_[~set_id];
+}
+
 inline int32 IdSetLexicon::AddSingleton(int32 id) const {
   S2_DCHECK_GE(id, 0);
   S2_DCHECK_LE(id, std::numeric_limits<int32>::max());
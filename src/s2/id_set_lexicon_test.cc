@@ -68,3 +68,16 @@ TEST(IdSetLexicon, Clear) {
   EXPECT_EQ(~0, lexicon.Add(Seq{3, 4}));
   EXPECT_EQ(~1, lexicon.Add(Seq{1, 2}));
 }
+
+TEST(IdSetLexicon, Merge) {
+  IdSetLexicon lexicon, other;
+  EXPECT_EQ(~0, lexicon.Add(Seq{1, 2}));
+  EXPECT_EQ(~0, other.Add(Seq{5, 3}));
+  EXPECT_EQ(~1, other.Add(Seq{2, 1}));
+  IdSetLexicon::SetIdMap map = lexicon.Merge(other);
+  EXPECT_EQ(~1, map.Map(~0));
+  EXPECT_EQ(~0, map.Map(~1));
+  EXPECT_EQ(7, map.Map(other.AddSingleton(7)));
+  EXPECT_EQ(IdSetLexicon::EmptySetId(), map.Map(IdSetLexicon::EmptySetId()));
+  ExpectIdSet({3, 5}, lexicon.id_set(map.Map(~0)));
+}
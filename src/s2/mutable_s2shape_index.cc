@@ -20,10 +20,14 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <memory>
+#include <new>
 
 #include "s2/base/casts.h"
 #include "s2/base/commandlineflags.h"
 #include "s2/base/spinlock.h"
+#include "s2/base/stringprintf.h"
+#include "s2/base/timer.h"
 #include "s2/encoded_s2cell_id_vector.h"
 #include "s2/encoded_string_vector.h"
 #include "s2/r1interval.h"
@@ -38,9 +42,11 @@
 #include "s2/s2padded_cell.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2shapeutil_contains_brute_force.h"
+#include "s2/util/thread/executor.h"
 
 using std::fabs;
 using std::max;
+using std::min;
 using std::unique_ptr;
 using std::vector;
 
@@ -66,10 +72,8 @@ DEFINE_int32(
 //
 // Note that this limit is not a hard guarantee, for several reasons:
 //  (1) the memory estimates are only approximations;
-//  (2) all edges in a given shape are added or removed at once, so shapes
-//      with huge numbers of edges may exceed the budget;
-//  (3) shapes being removed are always processed in a single batch.  (This
-//      could be fixed, but it seems better to keep the code simpler for now.)
+//  (2) all edges in a given shape are added at once, so shapes with huge
+//      numbers of edges may exceed the budget.
 DEFINE_int32(
     s2shape_index_tmp_memory_budget_mb, 100,
     "Attempts to limit the amount of temporary memory used by "
@@ -97,6 +101,19 @@ DEFINE_double(
     "from 0.1 to 10, with smaller values causing more aggressive subdivision "
     "of long edges grouped closely together.");
 
+// FLAGS_s2shape_index_min_short_edge_fraction
+//
+// The minimum fraction of "short" edges that must be present in a cell in
+// order for it to be subdivided (see
+// MutableS2ShapeIndex::Options::min_short_edge_fraction).
+DEFINE_double(
+    s2shape_index_min_short_edge_fraction, 0.0,
+    "The minimum fraction of 'short' edges that must be present in a cell in "
+    "order for it to be subdivided.  If this value is non-zero then the "
+    "total index size and construction time are guaranteed to be linear in "
+    "the number of input edges for any set of long edges.  Reasonable values "
+    "range from 0 (disabled) to about 0.5.");
+
 // The total error when clipping an edge comes from two sources:
 // (1) Clipping the original spherical edge to a cube face (the "face edge").
 //     The maximum error in this step is S2::kFaceClipErrorUVCoord.
@@ -109,7 +126,14 @@ const double MutableS2ShapeIndex::kCellPadding =
     2 * (S2::kFaceClipErrorUVCoord + S2::kEdgeClipErrorUVCoord);
 
 MutableS2ShapeIndex::Options::Options()
-    : max_edges_per_cell_(FLAGS_s2shape_index_default_max_edges_per_cell) {
+    : max_edges_per_cell_(FLAGS_s2shape_index_default_max_edges_per_cell),
+      cell_size_to_long_edge_ratio_(
+          FLAGS_s2shape_index_cell_size_to_long_edge_ratio),
+      min_short_edge_fraction_(FLAGS_s2shape_index_min_short_edge_fraction),
+      max_level_(S2CellId::kMaxLevel),
+      subdivision_mode_(SubdivisionMode::FIXED),
+      executor_(nullptr), build_stats_(nullptr), use_cell_arena_(false),
+      build_one_face_at_a_time_(false) {
 }
 
 void MutableS2ShapeIndex::Options::set_max_edges_per_cell(
@@ -117,6 +141,29 @@ void MutableS2ShapeIndex::Options::set_max_edges_per_cell(
   max_edges_per_cell_ = max_edges_per_cell;
 }
 
+void MutableS2ShapeIndex::Options::set_cell_size_to_long_edge_ratio(
+    double ratio) {
+  S2_DCHECK_GT(ratio, 0);
+  cell_size_to_long_edge_ratio_ = ratio;
+}
+
+void MutableS2ShapeIndex::Options::set_min_short_edge_fraction(
+    double fraction) {
+  S2_DCHECK_GE(fraction, 0);
+  S2_DCHECK_LE(fraction, 1);
+  min_short_edge_fraction_ = fraction;
+}
+
+void MutableS2ShapeIndex::Options::set_max_level(int max_level) {
+  S2_DCHECK_GE(max_level, 0);
+  S2_DCHECK_LE(max_level, S2CellId::kMaxLevel);
+  max_level_ = max_level;
+}
+
+void MutableS2ShapeIndex::Options::set_executor(Executor* executor) {
+  executor_ = executor;
+}
+
 bool MutableS2ShapeIndex::Iterator::Locate(const S2Point& target) {
   return LocateImpl(target, this);
 }
@@ -140,13 +187,89 @@ void MutableS2ShapeIndex::Iterator::Copy(const IteratorBase& other)  {
   *this = *down_cast<const Iterator*>(&other);
 }
 
-// Defines the initial focus point of MutableS2ShapeIndex::InteriorTracker
-// (the start of the S2CellId space-filling curve).
-//
-// TODO(ericv): Move InteriorTracker here to avoid the need for this method.
-static S2Point kInteriorTrackerOrigin() {
-  return S2::FaceUVtoXYZ(0, -1, -1).Normalize();
-}
+// CellArena allocates index cells, together with their clipped shapes and
+// edge ids, from large blocks that are all freed at once by Reset().  Cells
+// may be allocated by several threads at once (see UpdateFacesInParallel).
+class MutableS2ShapeIndex::CellArena {
+ public:
+  CellArena() : next_(nullptr), remaining_(0), bytes_allocated_(0) {}
+
+  // Returns a new cell containing "num_clipped" value-initialized clipped
+  // shapes, and sets "*edges" to point to storage for "num_edges" edge ids.
+  // The clipped shapes should be initialized using the S2ClippedShape::Init
+  // variant that accepts external edge storage.
+  S2ShapeIndexCell* NewCell(int num_clipped, int num_edges, int32** edges) {
+    static_assert(sizeof(S2ShapeIndexCell) % alignof(S2ClippedShape) == 0,
+                  "S2ClippedShape array would be misaligned");
+    const size_t shapes_offset = sizeof(S2ShapeIndexCell);
+    const size_t edges_offset =
+        shapes_offset + num_clipped * sizeof(S2ClippedShape);
+    const size_t kAlign = alignof(S2ShapeIndexCell);
+    size_t bytes = edges_offset + num_edges * sizeof(int32);
+    bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+
+    lock_.Lock();
+    char* ptr = Allocate(bytes);
+    lock_.Unlock();
+
+    S2ShapeIndexCell* cell = new (ptr) S2ShapeIndexCell;
+    cell->shapes_ = reinterpret_cast<S2ClippedShape*>(ptr + shapes_offset);
+    std::uninitialized_fill_n(cell->shapes_, num_clipped, S2ClippedShape());
+    cell->num_shapes_ = num_clipped;
+    cell->owns_shapes_ = false;
+    *edges = reinterpret_cast<int32*>(ptr + edges_offset);
+    return cell;
+  }
+
+  // Frees all the cells allocated so far.  The cells must not be used
+  // afterwards.
+  void Reset() {
+    blocks_.clear();
+    next_ = nullptr;
+    remaining_ = 0;
+    bytes_allocated_ = 0;
+  }
+
+  size_t SpaceUsed() const {
+    return sizeof(*this) + blocks_.capacity() * sizeof(blocks_[0]) +
+           bytes_allocated_;
+  }
+
+ private:
+  static const size_t kBlockSize = 64 << 10;
+
+  // Returns "bytes" bytes of storage, allocating a new block if necessary.
+  // Large requests get a block of their own so that they do not waste the
+  // remainder of the current block.
+  char* Allocate(size_t bytes) {
+    if (bytes > remaining_) {
+      if (bytes > kBlockSize / 4) {
+        blocks_.emplace_back(new char[bytes]);
+        bytes_allocated_ += bytes;
+        return blocks_.back().get();
+      }
+      blocks_.emplace_back(new char[kBlockSize]);
+      bytes_allocated_ += kBlockSize;
+      next_ = blocks_.back().get();
+      remaining_ = kBlockSize;
+    }
+    char* result = next_;
+    next_ += bytes;
+    remaining_ -= bytes;
+    return result;
+  }
+
+  SpinLock lock_;
+  std::vector<std::unique_ptr<char[]>> blocks_;  // Guarded by "lock_".
+  char* next_;                                   // Guarded by "lock_".
+  size_t remaining_;                             // Guarded by "lock_".
+  size_t bytes_allocated_;                       // Guarded by "lock_".
+
+  CellArena(const CellArena&) = delete;
+  void operator=(const CellArena&) = delete;
+};
+
+const size_t MutableS2ShapeIndex::CellArena::kBlockSize;
 
 MutableS2ShapeIndex::MutableS2ShapeIndex()
     : index_status_(FRESH) {
@@ -155,11 +278,29 @@ MutableS2ShapeIndex::MutableS2ShapeIndex()
 MutableS2ShapeIndex::MutableS2ShapeIndex(const Options& options)
     : options_(options),
       index_status_(FRESH) {
+  if (options_.use_cell_arena()) cell_arena_ = absl::make_unique<CellArena>();
 }
 
 void MutableS2ShapeIndex::Init(const Options& options) {
   S2_DCHECK(shapes_.empty());
   options_ = options;
+  if (options_.use_cell_arena()) {
+    cell_arena_ = absl::make_unique<CellArena>();
+  } else {
+    cell_arena_.reset();
+  }
+}
+
+// Destroys an index cell created by MakeIndexCell() or Init(Decoder*).
+// Cells allocated from "cell_arena_" are easy to recognize because they do
+// not own their clipped shapes; their storage is reclaimed only when the
+// arena is reset.
+void MutableS2ShapeIndex::DeleteCell(const S2ShapeIndexCell* cell) const {
+  if (cell->owns_shapes_) {
+    delete cell;
+  } else {
+    cell->~S2ShapeIndexCell();
+  }
 }
 
 MutableS2ShapeIndex::~MutableS2ShapeIndex() {
@@ -184,7 +325,8 @@ unique_ptr<S2Shape> MutableS2ShapeIndex::Release(int shape_id) {
   // This class updates itself lazily, because it is much more efficient to
   // process additions and removals in batches.  However this means that when
   // a shape is removed, we need to make a copy of all its edges, since the
-  // client is free to delete "shape" once this call is finished.
+  // client is free to delete "shape" once this call is finished.  (The edges
+  // are used to find the index cells that refer to the shape.)
 
   S2_DCHECK(shapes_[shape_id] != nullptr);
   auto shape = std::move(shapes_[shape_id]);
@@ -201,8 +343,6 @@ unique_ptr<S2Shape> MutableS2ShapeIndex::Release(int shape_id) {
     RemovedShape* removed = &pending_removals_->back();
     removed->shape_id = shape->id();
     removed->has_interior = (shape->dimension() == 2);
-    removed->contains_tracker_origin =
-        s2shapeutil::ContainsBruteForce(*shape, kInteriorTrackerOrigin());
     int num_edges = shape->num_edges();
     removed->edges.reserve(num_edges);
     for (int e = 0; e < num_edges; ++e) {
@@ -216,9 +356,10 @@ unique_ptr<S2Shape> MutableS2ShapeIndex::Release(int shape_id) {
 vector<unique_ptr<S2Shape>> MutableS2ShapeIndex::ReleaseAll() {
   Iterator it;
   for (it.InitStale(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
-    delete &it.cell();
+    DeleteCell(&it.cell());
   }
   cell_map_.clear();
+  if (cell_arena_ != nullptr) cell_arena_->Reset();
   pending_additions_begin_ = 0;
   pending_removals_.reset();
   S2_DCHECK(update_state_ == nullptr);
@@ -324,6 +465,14 @@ class MutableS2ShapeIndex::InteriorTracker {
   // REQUIRES: shape->dimension() == 2
   inline void TestEdge(int32 shape_id, const S2Shape::Edge& edge);
 
+  // Returns a rectangle in the (u,v)-coordinate system of the given face that
+  // contains the line segment between the old and new focus locations (see
+  // DrawTo), expanded by "padding".  Edges whose clipped bounds do not
+  // intersect this rectangle cannot cross the segment.
+  //
+  // REQUIRES: both focus locations belong to the given face.
+  R2Rect GetSegmentBound(int face, double padding) const;
+
   // The set of shape ids that contain the current focus.
   const ShapeIdSet& shape_ids() const { return shape_ids_; }
 
@@ -429,6 +578,14 @@ inline void MutableS2ShapeIndex::InteriorTracker::TestEdge(
   }
 }
 
+R2Rect MutableS2ShapeIndex::InteriorTracker::GetSegmentBound(
+    int face, double padding) const {
+  R2Point a_uv, b_uv;
+  S2::ValidFaceXYZtoUV(face, a_, &a_uv);
+  S2::ValidFaceXYZtoUV(face, b_, &b_uv);
+  return R2Rect::FromPointPair(a_uv, b_uv).Expanded(padding);
+}
+
 // Like std::lower_bound(shape_ids_.begin(), shape_ids_.end(), shape_id), but
 // implemented with linear rather than binary search because the number of
 // shapes being tracked is typically very small.
@@ -542,6 +699,24 @@ struct MutableS2ShapeIndex::BatchDescriptor {
 // This method updates the index by applying all pending additions and
 // removals.  It does *not* update index_status_ (see ApplyUpdatesThreadSafe).
 void MutableS2ShapeIndex::ApplyUpdatesInternal() {
+  BuildStats* stats = options_.build_stats();
+  if (stats) ++stats->num_updates;
+
+  // Removed shapes are deleted directly from the index cells that refer to
+  // them, so that the cost is proportional to the number of such cells
+  // rather than to the number of cells on the faces that they touch.
+  if (pending_removals_) {
+    if (stats) stats->num_shapes_removed += pending_removals_->size();
+    for (const auto& pending_removal : *pending_removals_) {
+      RemoveShapeFromIndexCells(pending_removal);
+    }
+    pending_removals_.reset(nullptr);
+  }
+  if (options_.build_one_face_at_a_time() && is_first_update()) {
+    BuildOneFaceAtATime();
+    if (stats) UpdateIndexStats(stats);
+    return;
+  }
   // Check whether we have so many edges to process that we should process
   // them in multiple batches to save memory.  Building the index can use up
   // to 20x as much memory (per edge) as the final index size.
@@ -552,48 +727,125 @@ void MutableS2ShapeIndex::ApplyUpdatesInternal() {
     vector<FaceEdge> all_edges[6];
     S2_VLOG(1) << "Batch " << i++ << ": shape_limit=" << batch.additions_end
                << ", edges=" << batch.num_edges;
+    if (stats) {
+      ++stats->num_batches;
+      stats->num_edges_processed += batch.num_edges;
+      for (int id = pending_additions_begin_; id < batch.additions_end; ++id) {
+        if (shape(id) != nullptr) ++stats->num_shapes_added;
+      }
+    }
 
     ReserveSpace(batch, all_edges);
-    InteriorTracker tracker;
-    if (pending_removals_) {
-      // The first batch implicitly includes all shapes being removed.
-      for (const auto& pending_removal : *pending_removals_) {
-        RemoveShape(pending_removal, all_edges, &tracker);
+    if (options_.executor() != nullptr && is_first_update()) {
+      // The index is empty, so each face can be built independently.
+      for (int id = pending_additions_begin_; id < batch.additions_end; ++id) {
+        AddShape(id, all_edges, nullptr);
       }
-      pending_removals_.reset(nullptr);
+      if (options_.subdivision_mode() == SubdivisionMode::ADAPTIVE) {
+        for (int face = 0; face < 6; ++face) {
+          AdaptEdgeMaxLevels(&all_edges[face]);
+        }
+      }
+      UpdateFacesInParallel(batch.additions_end, all_edges);
+      for (int face = 0; face < 6; ++face) {
+        vector<FaceEdge>().swap(all_edges[face]);
+      }
+      pending_additions_begin_ = batch.additions_end;
+      continue;
     }
+    InteriorTracker tracker;
     for (int id = pending_additions_begin_; id < batch.additions_end; ++id) {
       AddShape(id, all_edges, &tracker);
     }
     for (int face = 0; face < 6; ++face) {
-      UpdateFaceEdges(face, all_edges[face], &tracker);
+      if (options_.subdivision_mode() == SubdivisionMode::ADAPTIVE) {
+        AdaptEdgeMaxLevels(&all_edges[face]);
+      }
+      UpdateFaceEdges(face, all_edges[face], &tracker, &cell_map_, stats);
       // Save memory by clearing vectors after we are done with them.
       vector<FaceEdge>().swap(all_edges[face]);
     }
     pending_additions_begin_ = batch.additions_end;
   }
+  if (stats) UpdateIndexStats(stats);
   // It is the caller's responsibility to update index_status_.
 }
 
-// Count the number of edges being updated, and break them into several
+// Replaces the fields of "stats" that describe the index cells (as opposed
+// to the work done by the updates) with the current values.
+void MutableS2ShapeIndex::UpdateIndexStats(BuildStats* stats) const {
+  stats->num_cells = cell_map_.size();
+  std::fill(std::begin(stats->num_cells_by_face),
+            std::end(stats->num_cells_by_face), 0);
+  stats->max_level = 0;
+  stats->num_cells_by_level.assign(S2CellId::kMaxLevel + 1, 0);
+  stats->num_cells_by_num_edges.clear();
+  for (const auto& entry : cell_map_) {
+    S2CellId id = entry.first;
+    const S2ShapeIndexCell& cell = *entry.second;
+    ++stats->num_cells_by_face[id.face()];
+    stats->max_level = max(stats->max_level, id.level());
+    ++stats->num_cells_by_level[id.level()];
+    int num_edges = 0;
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      num_edges += cell.clipped(s).num_edges();
+    }
+    if (num_edges >= stats->num_cells_by_num_edges.size()) {
+      stats->num_cells_by_num_edges.resize(num_edges + 1, 0);
+    }
+    ++stats->num_cells_by_num_edges[num_edges];
+  }
+}
+
+string MutableS2ShapeIndex::BuildStats::ToString() const {
+  string result = StringPrintf(
+      "updates=%lld batches=%lld shapes_added=%lld shapes_removed=%lld "
+      "edges=%lld\n", static_cast<long long>(num_updates),
+      static_cast<long long>(num_batches),
+      static_cast<long long>(num_shapes_added),
+      static_cast<long long>(num_shapes_removed),
+      static_cast<long long>(num_edges_processed));
+  StringAppendF(&result, "face_seconds=");
+  for (int face = 0; face < 6; ++face) {
+    StringAppendF(&result, "%s%.6f", face ? "," : "", face_seconds[face]);
+  }
+  StringAppendF(&result, " clipped_edges=%lld max_clipped_edges=%lld\n",
+                static_cast<long long>(num_clipped_edges),
+                static_cast<long long>(max_clipped_edges));
+  StringAppendF(&result, "cells=%lld max_level=%d cells_by_face=",
+                static_cast<long long>(num_cells), max_level);
+  for (int face = 0; face < 6; ++face) {
+    StringAppendF(&result, "%s%lld", face ? "," : "",
+                  static_cast<long long>(num_cells_by_face[face]));
+  }
+  StringAppendF(&result, "\ncells_by_level:");
+  for (int level = 0; level < num_cells_by_level.size(); ++level) {
+    if (num_cells_by_level[level] == 0) continue;
+    StringAppendF(&result, " %d:%lld", level,
+                  static_cast<long long>(num_cells_by_level[level]));
+  }
+  StringAppendF(&result, "\ncells_by_num_edges:");
+  for (int n = 0; n < num_cells_by_num_edges.size(); ++n) {
+    if (num_cells_by_num_edges[n] == 0) continue;
+    StringAppendF(&result, " %d:%lld", n,
+                  static_cast<long long>(num_cells_by_num_edges[n]));
+  }
+  result += "\n";
+  return result;
+}
+
+// Count the number of edges being added, and break them into several
 // batches if necessary to reduce the amount of memory needed.  (See the
 // documentation for FLAGS_s2shape_index_tmp_memory_budget_mb.)
 void MutableS2ShapeIndex::GetUpdateBatches(vector<BatchDescriptor>* batches)
     const {
-  // Count the edges being removed and added.
-  int num_edges_removed = 0;
-  if (pending_removals_) {
-    for (const auto& pending_removal : *pending_removals_) {
-      num_edges_removed += pending_removal.edges.size();
-    }
-  }
-  int num_edges_added = 0;
+  // Count the edges being added.  (Removals are handled separately.)
+  int num_edges = 0;
   for (int id = pending_additions_begin_; id < shapes_.size(); ++id) {
     const S2Shape* shape = this->shape(id);
     if (shape == nullptr) continue;
-    num_edges_added += shape->num_edges();
+    num_edges += shape->num_edges();
   }
-  int num_edges = num_edges_removed + num_edges_added;
 
   // The following memory estimates are based on heap profiling.
   //
@@ -632,20 +884,6 @@ void MutableS2ShapeIndex::GetUpdateBatches(vector<BatchDescriptor>* batches)
   GetBatchSizes(num_edges, kMaxUpdateBatches, kFinalBytesPerEdge,
                 kTmpBytesPerEdge, kTmpMemoryBudgetBytes, &batch_sizes);
 
-  // We always process removed edges in a single batch, since (1) they already
-  // take up a lot of memory because we have copied all their edges, and (2)
-  // AbsorbIndexCell() uses (shapes_[id] == nullptr) to detect when a shape is
-  // being removed, so in order to split the removals into batches we would
-  // need a different approach (e.g., temporarily add fake entries to shapes_
-  // and restore them back to nullptr as shapes are actually removed).
-  num_edges = 0;
-  if (pending_removals_) {
-    num_edges += num_edges_removed;
-    if (num_edges >= batch_sizes[0]) {
-      batches->push_back(BatchDescriptor(pending_additions_begin_, num_edges));
-      num_edges = 0;
-    }
-  }
   // Keep adding shapes to each batch until the recommended number of edges
   // for that batch is reached, then move on to the next batch.
   for (int id = pending_additions_begin_; id < shapes_.size(); ++id) {
@@ -658,8 +896,8 @@ void MutableS2ShapeIndex::GetUpdateBatches(vector<BatchDescriptor>* batches)
     }
   }
   // Some shapes have no edges.  If a shape with no edges is the last shape to
-  // be added or removed, then the final batch may not include it, so we fix
-  // that problem here.
+  // be added, then the final batch may not include it, so we fix that
+  // problem here.
   batches->back().additions_end = shapes_.size();
   S2_DCHECK_LE(batches->size(), kMaxUpdateBatches);
 }
@@ -749,15 +987,6 @@ void MutableS2ShapeIndex::ReserveSpace(const BatchDescriptor& batch,
   int edge_id = sample_interval / 2;
   const int actual_sample_size = (batch.num_edges + edge_id) / sample_interval;
   int face_count[6] = { 0, 0, 0, 0, 0, 0 };
-  if (pending_removals_) {
-    for (const RemovedShape& removed : *pending_removals_) {
-      edge_id += removed.edges.size();
-      while (edge_id >= sample_interval) {
-        edge_id -= sample_interval;
-        face_count[S2::GetFace(removed.edges[edge_id].v0)] += 1;
-      }
-    }
-  }
   for (int id = pending_additions_begin_; id < batch.additions_end; ++id) {
     const S2Shape* shape = this->shape(id);
     if (shape == nullptr) continue;
@@ -798,8 +1027,11 @@ void MutableS2ShapeIndex::ReserveSpace(const BatchDescriptor& batch,
 
 // Clip all edges of the given shape to the six cube faces, add the clipped
 // edges to "all_edges", and start tracking its interior if necessary.
+// "tracker" may be nullptr if the caller tracks shape interiors itself.
+// If "face" is non-negative, only the edges that intersect that face are
+// added (to all_edges[face]).
 void MutableS2ShapeIndex::AddShape(int id, vector<FaceEdge> all_edges[6],
-                                   InteriorTracker* tracker) const {
+                                   InteriorTracker* tracker, int face) const {
   const S2Shape* shape = this->shape(id);
   if (shape == nullptr) {
     return;  // This shape has already been removed.
@@ -808,56 +1040,113 @@ void MutableS2ShapeIndex::AddShape(int id, vector<FaceEdge> all_edges[6],
   FaceEdge edge;
   edge.shape_id = id;
   edge.has_interior = (shape->dimension() == 2);
-  if (edge.has_interior) {
+  if (edge.has_interior && tracker != nullptr) {
     tracker->AddShape(id, s2shapeutil::ContainsBruteForce(*shape,
                                                           tracker->focus()));
   }
+  // The edges are clipped to the cube faces in batches (see
+  // S2::ClipEdgesToPaddedFaces), since most edges can be assigned to a single
+  // face using branch-free code.
+  static const int kBatchSize = 64;
+  S2Point v0[kBatchSize], v1[kBatchSize];
+  int max_level[kBatchSize];
+  S2::FaceClippedEdge clipped[6 * kBatchSize];
   int num_edges = shape->num_edges();
-  for (int e = 0; e < num_edges; ++e) {
-    edge.edge_id = e;
-    edge.edge = shape->edge(e);
-    edge.max_level = GetEdgeMaxLevel(edge.edge);
-    AddFaceEdge(&edge, all_edges);
+  for (int begin = 0; begin < num_edges; begin += kBatchSize) {
+    int n = min(kBatchSize, num_edges - begin);
+    for (int k = 0; k < n; ++k) {
+      S2Shape::Edge e = shape->edge(begin + k);
+      v0[k] = e.v0;
+      v1[k] = e.v1;
+      max_level[k] = GetEdgeMaxLevel(e);
+    }
+    int num_clipped = S2::ClipEdgesToPaddedFaces(
+        absl::MakeConstSpan(v0, n), absl::MakeConstSpan(v1, n), kCellPadding,
+        absl::MakeSpan(clipped));
+    for (int i = 0; i < num_clipped; ++i) {
+      const S2::FaceClippedEdge& c = clipped[i];
+      if (face >= 0 && c.face != face) continue;
+      edge.edge_id = begin + c.edge;
+      edge.edge = S2Shape::Edge(v0[c.edge], v1[c.edge]);
+      edge.max_level = max_level[c.edge];
+      edge.a = c.a;
+      edge.b = c.b;
+      all_edges[c.face].push_back(edge);
+    }
   }
 }
 
-void MutableS2ShapeIndex::RemoveShape(const RemovedShape& removed,
-                                      vector<FaceEdge> all_edges[6],
-                                      InteriorTracker* tracker) const {
-  FaceEdge edge;
-  edge.edge_id = -1;  // Not used or needed for removed edges.
-  edge.shape_id = removed.shape_id;
-  edge.has_interior = removed.has_interior;
-  if (edge.has_interior) {
-    tracker->AddShape(edge.shape_id, removed.contains_tracker_origin);
-  }
-  for (const auto& removed_edge : removed.edges) {
-    edge.edge = removed_edge;
-    edge.max_level = GetEdgeMaxLevel(edge.edge);
-    AddFaceEdge(&edge, all_edges);
-  }
-}
-
-inline void MutableS2ShapeIndex::AddFaceEdge(
-    FaceEdge* edge, vector<FaceEdge> all_edges[6]) const {
-  // Fast path: both endpoints are on the same face, and are far enough from
-  // the edge of the face that don't intersect any (padded) adjacent face.
-  int a_face = S2::GetFace(edge->edge.v0);
-  if (a_face == S2::GetFace(edge->edge.v1)) {
-    S2::ValidFaceXYZtoUV(a_face, edge->edge.v0, &edge->a);
-    S2::ValidFaceXYZtoUV(a_face, edge->edge.v1, &edge->b);
-    const double kMaxUV = 1 - kCellPadding;
-    if (fabs(edge->a[0]) <= kMaxUV && fabs(edge->a[1]) <= kMaxUV &&
-        fabs(edge->b[0]) <= kMaxUV && fabs(edge->b[1]) <= kMaxUV) {
-      all_edges[a_face].push_back(*edge);
-      return;
+// Deletes the given shape from every index cell that refers to it.  Cells
+// that become empty are removed from the index, but otherwise the cell
+// structure is left unchanged (i.e., neighboring cells are not merged even if
+// they now contain few enough edges).  This keeps the cost of removing a
+// shape proportional to the number of index cells that it intersects.
+//
+// The cells to be visited on each face are found as follows.  All index
+// cells that intersect the removed edges are descendants (or an ancestor) of
+// the cell returned by ShrinkToFit() for the bounding rectangle of those
+// edges.  Any other index cells on the same face do not intersect the shape
+// boundary, and since the rest of the face is connected, either all of them
+// are contained by the shape or none of them are.  Therefore we only need to
+// examine one of these cells to decide whether they need to be visited.
+void MutableS2ShapeIndex::RemoveShapeFromIndexCells(
+    const RemovedShape& removed) {
+  R2Rect face_bounds[6];
+  static const int kBatchSize = 64;
+  S2Point v0[kBatchSize], v1[kBatchSize];
+  S2::FaceClippedEdge clipped[6 * kBatchSize];
+  int num_edges = removed.edges.size();
+  for (int begin = 0; begin < num_edges; begin += kBatchSize) {
+    int n = min(kBatchSize, num_edges - begin);
+    for (int k = 0; k < n; ++k) {
+      v0[k] = removed.edges[begin + k].v0;
+      v1[k] = removed.edges[begin + k].v1;
+    }
+    int num_clipped = S2::ClipEdgesToPaddedFaces(
+        absl::MakeConstSpan(v0, n), absl::MakeConstSpan(v1, n), kCellPadding,
+        absl::MakeSpan(clipped));
+    for (int i = 0; i < num_clipped; ++i) {
+      face_bounds[clipped[i].face].AddPoint(clipped[i].a);
+      face_bounds[clipped[i].face].AddPoint(clipped[i].b);
     }
   }
-  // Otherwise we simply clip the edge to all six faces.
   for (int face = 0; face < 6; ++face) {
-    if (S2::ClipToPaddedFace(edge->edge.v0, edge->edge.v1, face,
-                                     kCellPadding, &edge->a, &edge->b)) {
-      all_edges[face].push_back(*edge);
+    S2CellId face_id = S2CellId::FromFace(face);
+    S2CellId begin = face_id.range_min(), end = face_id.range_min();
+    if (!face_bounds[face].is_empty()) {
+      S2PaddedCell pcell(face_id, kCellPadding);
+      S2CellId shrunk_id = pcell.ShrinkToFit(face_bounds[face]);
+      Iterator iter;
+      iter.InitStale(this);
+      // If the shrunk cell is contained by an index cell, visit that cell.
+      if (iter.Locate(shrunk_id) == INDEXED) shrunk_id = iter.id();
+      begin = shrunk_id.range_min();
+      end = shrunk_id.range_max().next();
+    }
+    if (removed.has_interior && (begin != face_id.range_min() ||
+                                 end != face_id.range_max().next())) {
+      // Check whether the shape contains the rest of this face.
+      CellMap::const_iterator probe =
+          cell_map_.lower_bound(face_id.range_min());
+      if (probe != cell_map_.end() && probe->first >= begin) {
+        probe = cell_map_.lower_bound(end);
+      }
+      if (probe != cell_map_.end() && probe->first <= face_id.range_max() &&
+          probe->second->find_clipped(removed.shape_id) != nullptr) {
+        begin = face_id.range_min();
+        end = face_id.range_max().next();
+      }
+    }
+    for (CellMap::iterator it = cell_map_.lower_bound(begin);
+         it != cell_map_.end() && it->first < end; ) {
+      S2ShapeIndexCell* cell = it->second;
+      cell->remove_clipped(removed.shape_id);
+      if (cell->num_clipped() == 0) {
+        DeleteCell(cell);
+        it = cell_map_.erase(it);
+      } else {
+        ++it;
+      }
     }
   }
 }
@@ -865,14 +1154,60 @@ inline void MutableS2ShapeIndex::AddFaceEdge(
 // Return the first level at which the edge will *not* contribute towards
 // the decision to subdivide.
 int MutableS2ShapeIndex::GetEdgeMaxLevel(const S2Shape::Edge& edge) const {
+  return GetEdgeMaxLevel(edge, options_.cell_size_to_long_edge_ratio());
+}
+
+// As above, but using the given ratio rather than the one in the options.
+int MutableS2ShapeIndex::GetEdgeMaxLevel(
+    const S2Shape::Edge& edge, double cell_size_to_long_edge_ratio) const {
   // Compute the maximum cell size for which this edge is considered "long".
   // The calculation does not need to be perfectly accurate, so we use Norm()
   // rather than Angle() for speed.
   double cell_size = ((edge.v0 - edge.v1).Norm() *
-                      FLAGS_s2shape_index_cell_size_to_long_edge_ratio);
+                      cell_size_to_long_edge_ratio);
   // Now return the first level encountered during subdivision where the
-  // average cell size is at most "cell_size".
-  return S2::kAvgEdge.GetLevelForMaxValue(cell_size);
+  // average cell size is at most "cell_size".  No edge contributes below
+  // max_level(), which ensures that cells at that level are not subdivided.
+  return std::min(S2::kAvgEdge.GetLevelForMaxValue(cell_size),
+                  options_.max_level());
+}
+
+// Recomputes the maximum level of the given edges (which all belong to the
+// same face) using a long edge threshold chosen from the edge lengths and
+// density, as described under Options::subdivision_mode().
+void MutableS2ShapeIndex::AdaptEdgeMaxLevels(
+    vector<FaceEdge>* face_edges) const {
+  int num_edges = face_edges->size();
+  if (num_edges == 0) return;
+  vector<double> lengths;
+  lengths.reserve(num_edges);
+  R2Rect bound = R2Rect::Empty();
+  for (const FaceEdge& edge : *face_edges) {
+    lengths.push_back((edge.edge.v0 - edge.edge.v1).Norm());
+    bound.AddPoint(edge.a);
+    bound.AddPoint(edge.b);
+  }
+  std::nth_element(lengths.begin(), lengths.begin() + num_edges / 2,
+                   lengths.end());
+  double median_length = lengths[num_edges / 2];
+  const double ratio = options_.cell_size_to_long_edge_ratio();
+  if (median_length == 0) return;  // Keep the fixed threshold.
+
+  // A face has 4 units of area in (u,v)-space and 4**k cells at level k, so
+  // the edges would fill cells at level k to max_edges_per_cell() if
+  // 4**k == 4 * num_edges / (max_edges_per_cell() * area).  The area is
+  // bounded below by the area of a leaf cell to handle degenerate bounds.
+  double area = max(bound.GetSize().x() * bound.GetSize().y(),
+                    std::ldexp(4.0, -2 * S2CellId::kMaxLevel));
+  double density =
+      4.0 * num_edges / (max(1, options_.max_edges_per_cell()) * area);
+  int level = static_cast<int>(std::round(0.5 * std::log2(density)));
+  level = max(0, std::min(options_.max_level(), level));
+  double face_ratio = S2::kAvgEdge.GetValue(level) / median_length;
+  face_ratio = max(ratio / 8, std::min(ratio * 8, face_ratio));
+  for (FaceEdge& edge : *face_edges) {
+    edge.max_level = GetEdgeMaxLevel(edge.edge, face_ratio);
+  }
 }
 
 // EdgeAllocator provides temporary storage for new ClippedEdges that are
@@ -883,7 +1218,7 @@ int MutableS2ShapeIndex::GetEdgeMaxLevel(const S2Shape::Edge& edge) const {
 // incrementally updating the index (see AbsorbIndexCell).
 class MutableS2ShapeIndex::EdgeAllocator {
  public:
-  EdgeAllocator() : size_(0) {}
+  EdgeAllocator() : size_(0), num_allocated_(0) {}
 
   // Return a pointer to a newly allocated edge.  The EdgeAllocator
   // retains ownership.
@@ -891,11 +1226,17 @@ class MutableS2ShapeIndex::EdgeAllocator {
     if (size_ == clipped_edges_.size()) {
       clipped_edges_.emplace_back(new ClippedEdge);
     }
+    ++num_allocated_;
     return clipped_edges_[size_++].get();
   }
   // Return the number of allocated edges.
   size_t size() const { return size_; }
 
+  // Return the maximum number of edges that were allocated at once, and the
+  // total number of calls to NewClippedEdge().
+  size_t max_size() const { return clipped_edges_.size(); }
+  int64 num_allocated() const { return num_allocated_; }
+
   // Reset the allocator to only contain the first "size" allocated edges.
   void Reset(size_t size) { size_ = size; }
 
@@ -908,6 +1249,7 @@ class MutableS2ShapeIndex::EdgeAllocator {
   // once they have been allocated.  Instead we keep a pool of allocated edges
   // that are all deleted together at the end.
   size_t size_;
+  int64 num_allocated_;
   vector<unique_ptr<ClippedEdge>> clipped_edges_;
 
   // On the other hand, we can use vector<FaceEdge> because they are allocated
@@ -919,14 +1261,107 @@ class MutableS2ShapeIndex::EdgeAllocator {
   void operator=(const EdgeAllocator&) = delete;
 };
 
+// Builds the index cells for all six faces concurrently using the executor
+// specified in the options, and then merges them into cell_map_.  This method
+// may only be used when the index is initially empty, since otherwise each
+// face would need to modify the shared cell_map_.
+//
+// Each face has its own InteriorTracker.  Normally the tracker state flows
+// from one face to the next along the S2CellId space-filling curve, so here
+// we instead start each tracker at the entry vertex of its face and compute
+// which shapes contain that point directly.
+// Initializes "tracker" to the state it has at the start of the given face
+// when the pending additions (up to "additions_end") are added to an empty
+// index, so that each face can be built independently.
+void MutableS2ShapeIndex::InitFaceTracker(int face, int additions_end,
+                                          InteriorTracker* tracker) const {
+  if (face > 0) {
+    S2CellId face_id = S2CellId::FromFace(face);
+    tracker->MoveTo(S2PaddedCell(face_id, 0).GetEntryVertex());
+    tracker->set_next_cellid(face_id);
+  }
+  for (int id = pending_additions_begin_; id < additions_end; ++id) {
+    const S2Shape* shape = this->shape(id);
+    if (shape == nullptr || shape->dimension() != 2) continue;
+    tracker->AddShape(id, s2shapeutil::ContainsBruteForce(*shape,
+                                                          tracker->focus()));
+  }
+}
+
+// Builds an empty index from the pending additions one face at a time (see
+// Options::build_one_face_at_a_time), so that only the edges of one face
+// are held in memory at once.
+void MutableS2ShapeIndex::BuildOneFaceAtATime() {
+  S2_DCHECK(is_first_update());
+  BuildStats* stats = options_.build_stats();
+  const int additions_end = shapes_.size();
+  if (stats) {
+    for (int id = pending_additions_begin_; id < additions_end; ++id) {
+      const S2Shape* shape = this->shape(id);
+      if (shape == nullptr) continue;
+      ++stats->num_shapes_added;
+      stats->num_edges_processed += shape->num_edges();
+    }
+  }
+  for (int face = 0; face < 6; ++face) {
+    vector<FaceEdge> all_edges[6];
+    for (int id = pending_additions_begin_; id < additions_end; ++id) {
+      AddShape(id, all_edges, nullptr, face);
+    }
+    if (stats) ++stats->num_batches;
+    if (options_.subdivision_mode() == SubdivisionMode::ADAPTIVE) {
+      AdaptEdgeMaxLevels(&all_edges[face]);
+    }
+    InteriorTracker tracker;
+    InitFaceTracker(face, additions_end, &tracker);
+    // Faces are processed in increasing S2CellId order, so every insertion
+    // is at the end of cell_map_.
+    UpdateFaceEdges(face, all_edges[face], &tracker, &cell_map_, stats);
+  }
+  pending_additions_begin_ = additions_end;
+}
+
+void MutableS2ShapeIndex::UpdateFacesInParallel(
+    int additions_end, const vector<FaceEdge> all_edges[6]) {
+  CellMap face_maps[6];
+  BuildStats* stats = options_.build_stats();
+  BuildStats face_stats[6];
+  ParallelFor(options_.executor(), 6, [&](int face) {
+    InteriorTracker tracker;
+    InitFaceTracker(face, additions_end, &tracker);
+    UpdateFaceEdges(face, all_edges[face], &tracker, &face_maps[face],
+                    stats ? &face_stats[face] : nullptr);
+  });
+  if (stats) {
+    for (int face = 0; face < 6; ++face) {
+      stats->face_seconds[face] += face_stats[face].face_seconds[face];
+      stats->num_clipped_edges += face_stats[face].num_clipped_edges;
+      stats->max_clipped_edges = max(stats->max_clipped_edges,
+                                     face_stats[face].max_clipped_edges);
+    }
+  }
+  // Faces are processed in increasing S2CellId order, so every insertion is
+  // at the end of cell_map_.
+  for (const CellMap& face_map : face_maps) {
+    for (const auto& entry : face_map) {
+      cell_map_.insert(cell_map_.end(), entry);
+    }
+  }
+}
+
 // Given a face and a vector of edges that intersect that face, add or remove
 // all the edges from the index.  (An edge is added if shapes_[id] is not
-// nullptr, and removed otherwise.)
+// nullptr, and removed otherwise.)  If "stats" is non-null, the time and
+// temporary edges used are added to it.
 void MutableS2ShapeIndex::UpdateFaceEdges(int face,
                                           const vector<FaceEdge>& face_edges,
-                                          InteriorTracker* tracker) {
+                                          InteriorTracker* tracker,
+                                          CellMap* cell_map,
+                                          BuildStats* stats) {
   int num_edges = face_edges.size();
   if (num_edges == 0 && tracker->shape_ids().empty()) return;
+  CycleTimer timer;
+  if (stats) timer.Start();
 
   // Create the initial ClippedEdge for each FaceEdge.  Additional clipped
   // edges are created when edges are split between child cells.  We create
@@ -955,29 +1390,40 @@ void MutableS2ShapeIndex::UpdateFaceEdges(int face,
   // "disjoint_from_index" means that the current cell being processed (and
   // all its descendants) are not already present in the index.
   bool disjoint_from_index = is_first_update();
-  if (num_edges > 0) {
-    S2CellId shrunk_id = ShrinkToFit(pcell, bound);
-    if (shrunk_id != pcell.id()) {
-      // All the edges are contained by some descendant of the face cell.  We
-      // can save a lot of work by starting directly with that cell, but if we
-      // are in the interior of at least one shape then we need to create
-      // index entries for the cells we are skipping over.
-      SkipCellRange(face_id.range_min(), shrunk_id.range_min(),
-                    tracker, &alloc, disjoint_from_index);
-      pcell = S2PaddedCell(shrunk_id, kCellPadding);
-      UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index);
-      SkipCellRange(shrunk_id.range_max().next(), face_id.range_max().next(),
-                    tracker, &alloc, disjoint_from_index);
-      return;
-    }
+  S2CellId shrunk_id = (num_edges > 0) ? ShrinkToFit(pcell, bound) : face_id;
+  if (shrunk_id != pcell.id()) {
+    // All the edges are contained by some descendant of the face cell.  We
+    // can save a lot of work by starting directly with that cell, but if we
+    // are in the interior of at least one shape then we need to create
+    // index entries for the cells we are skipping over.
+    SkipCellRange(face_id.range_min(), shrunk_id.range_min(),
+                  tracker, &alloc, disjoint_from_index, cell_map);
+    pcell = S2PaddedCell(shrunk_id, kCellPadding);
+    UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index,
+                cell_map);
+    SkipCellRange(shrunk_id.range_max().next(), face_id.range_max().next(),
+                  tracker, &alloc, disjoint_from_index, cell_map);
+  } else {
+    // Otherwise (no edges, or no shrinking is possible), subdivide normally.
+    UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index,
+                cell_map);
+  }
+  if (stats) {
+    stats->face_seconds[face] += timer.Get();
+    stats->num_clipped_edges += alloc.num_allocated();
+    stats->max_clipped_edges = max<int64>(stats->max_clipped_edges,
+                                          alloc.max_size());
   }
-  // Otherwise (no edges, or no shrinking is possible), subdivide normally.
-  UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index);
 }
 
 inline S2CellId MutableS2ShapeIndex::ShrinkToFit(const S2PaddedCell& pcell,
                                                  const R2Rect& bound) const {
   S2CellId shrunk_id = pcell.ShrinkToFit(bound);
+  if (shrunk_id.level() > options_.max_level()) {
+    // Cells are never subdivided below max_level(), so we don't start below
+    // that level either.
+    shrunk_id = shrunk_id.parent(options_.max_level());
+  }
   if (!is_first_update() && shrunk_id != pcell.id()) {
     // Don't shrink any smaller than the existing index cells, since we need
     // to combine the new edges with those cells.
@@ -995,7 +1441,8 @@ inline S2CellId MutableS2ShapeIndex::ShrinkToFit(const S2PaddedCell& pcell,
 void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
                                         InteriorTracker* tracker,
                                         EdgeAllocator* alloc,
-                                        bool disjoint_from_index) {
+                                        bool disjoint_from_index,
+                                        CellMap* cell_map) {
   // If we aren't in the interior of a shape, then skipping over cells is easy.
   if (tracker->shape_ids().empty()) return;
 
@@ -1004,7 +1451,7 @@ void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
   for (S2CellId skipped_id : S2CellUnion::FromBeginEnd(begin, end)) {
     vector<const ClippedEdge*> clipped_edges;
     UpdateEdges(S2PaddedCell(skipped_id, kCellPadding),
-                &clipped_edges, tracker, alloc, disjoint_from_index);
+                &clipped_edges, tracker, alloc, disjoint_from_index, cell_map);
   }
 }
 
@@ -1012,12 +1459,15 @@ void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
 // cell, add or remove all the edges from the index.  Temporary space for
 // edges that need to be subdivided is allocated from the given EdgeAllocator.
 // "disjoint_from_index" is an optimization hint indicating that cell_map_
-// does not contain any entries that overlap the given cell.
+// does not contain any entries that overlap the given cell.  New index cells
+// are inserted into "cell_map", which is either cell_map_ itself or (when
+// building faces in parallel) a temporary map for one face.
 void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
                                       vector<const ClippedEdge*>* edges,
                                       InteriorTracker* tracker,
                                       EdgeAllocator* alloc,
-                                      bool disjoint_from_index) {
+                                      bool disjoint_from_index,
+                                      CellMap* cell_map) {
   // Cases where an index cell is not needed should be detected before this.
   S2_DCHECK(!edges->empty() || !tracker->shape_ids().empty());
 
@@ -1025,24 +1475,20 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
   // (S2CellId::kMaxLevel).  Note that using an explicit stack does not seem
   // to be any faster based on profiling.
 
-  // Incremental updates are handled as follows.  All edges being added or
-  // removed are combined together in "edges", and all shapes with interiors
-  // are tracked using "tracker".  We subdivide recursively as usual until we
-  // encounter an existing index cell.  At this point we "absorb" the index
-  // cell as follows:
+  // Incremental updates are handled as follows.  All edges being added are
+  // combined together in "edges", and all shapes with interiors are tracked
+  // using "tracker".  We subdivide recursively as usual until we encounter an
+  // existing index cell.  At this point we "absorb" the index cell as
+  // follows:
   //
-  //   - Edges and shapes that are being removed are deleted from "edges" and
+  //   - All edges and shapes from the index cell are added to "edges" and
   //     "tracker".
-  //   - All remaining edges and shapes from the index cell are added to
-  //     "edges" and "tracker".
   //   - Continue subdividing recursively, creating new index cells as needed.
   //   - When the recursion gets back to the cell that was absorbed, we
   //     restore "edges" and "tracker" to their previous state.
   //
-  // Note that the only reason that we include removed shapes in the recursive
-  // subdivision process is so that we can find all of the index cells that
-  // contain those shapes efficiently, without maintaining an explicit list of
-  // index cells for each shape (which would be expensive in terms of memory).
+  // Shapes that are being removed are not handled here; they are deleted
+  // from the index cells beforehand (see RemoveShapeFromIndexCells).
   bool index_cell_absorbed = false;
   if (!disjoint_from_index) {
     // There may be existing index cells contained inside "pcell".  If we
@@ -1069,7 +1515,8 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
   // subdividing so that we can merge with those cells.  Otherwise,
   // MakeIndexCell checks if the number of edges is small enough, and creates
   // an index cell if possible (returning true when it does so).
-  if (!disjoint_from_index || !MakeIndexCell(pcell, *edges, tracker)) {
+  if (!disjoint_from_index ||
+      !MakeIndexCell(pcell, *edges, tracker, cell_map)) {
     // Reserve space for the edges that will be passed to each child.  This is
     // important since otherwise the running time is dominated by the time
     // required to grow the vectors.  The amount of memory involved is
@@ -1140,7 +1587,7 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
       pcell.GetChildIJ(pos, &i, &j);
       if (!child_edges[i][j].empty() || !tracker->shape_ids().empty()) {
         UpdateEdges(S2PaddedCell(pcell, i, j), &child_edges[i][j],
-                    tracker, alloc, disjoint_from_index);
+                    tracker, alloc, disjoint_from_index, cell_map);
       }
     }
     // Free any temporary edges that were allocated during clipping.
@@ -1241,11 +1688,9 @@ MutableS2ShapeIndex::UpdateBound(const ClippedEdge* edge, int u_end, double u,
 }
 
 // Absorb an index cell by transferring its contents to "edges" and/or
-// "tracker", and then delete this cell from the index.  If "edges" includes
-// any edges that are being removed, this method also updates their
-// InteriorTracker state to correspond to the exit vertex of this cell, and
-// saves the InteriorTracker state by calling SaveAndClearStateBefore().  It
-// is the caller's responsibility to restore this state by calling
+// "tracker", and then delete this cell from the index.  This method saves the
+// InteriorTracker state by calling SaveAndClearStateBefore(), and it is the
+// caller's responsibility to restore this state by calling
 // RestoreStateBefore() when processing of this cell is finished.
 void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
                                           const Iterator& iter,
@@ -1254,44 +1699,16 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
                                           EdgeAllocator* alloc) {
   S2_DCHECK_EQ(pcell.id(), iter.id());
 
-  // When we absorb a cell, we erase all the edges that are being removed.
-  // However when we are finished with this cell, we want to restore the state
-  // of those edges (since that is how we find all the index cells that need
-  // to be updated).  The edges themselves are restored automatically when
-  // UpdateEdges returns from its recursive call, but the InteriorTracker
-  // state needs to be restored explicitly.
-  //
-  // Here we first update the InteriorTracker state for removed edges to
-  // correspond to the exit vertex of this cell, and then save the
-  // InteriorTracker state.  This state will be restored by UpdateEdges when
-  // it is finished processing the contents of this cell.
-  if (tracker->is_active() && !edges->empty() &&
-      is_shape_being_removed((*edges)[0]->face_edge->shape_id)) {
-    // We probably need to update the InteriorTracker.  ("Probably" because
-    // it's possible that all shapes being removed do not have interiors.)
-    if (!tracker->at_cellid(pcell.id())) {
-      tracker->MoveTo(pcell.GetEntryVertex());
-    }
-    tracker->DrawTo(pcell.GetExitVertex());
-    tracker->set_next_cellid(pcell.id().next());
-    for (const ClippedEdge* edge : *edges) {
-      const FaceEdge* face_edge = edge->face_edge;
-      if (!is_shape_being_removed(face_edge->shape_id)) {
-        break;  // All shapes being removed come first.
-      }
-      if (face_edge->has_interior) {
-        tracker->TestEdge(face_edge->shape_id, face_edge->edge);
-      }
-    }
-  }
-  // Save the state of the edges being removed, so that it can be restored
-  // when we are finished processing this cell and its children.  We don't
-  // need to save the state of the edges being added because they aren't being
-  // removed from "edges" and will therefore be updated normally as we visit
-  // this cell and its children.
+  // Any shapes that already exist in the index are tracked only while we are
+  // processing this cell and its children.  Here we save the current state
+  // of such shapes (of which there are none, since removed shapes are
+  // handled separately and a cell is absorbed at most once along any path)
+  // so that RestoreStateBefore() can discard them when we are finished.  We
+  // don't need to save the state of the edges being added because they will
+  // be updated normally as we visit this cell and its children.
   tracker->SaveAndClearStateBefore(pending_additions_begin_);
 
-  // Create a FaceEdge for each edge in this cell that isn't being removed.
+  // Create a FaceEdge for each edge in this cell.
   vector<FaceEdge>* face_edges = alloc->mutable_face_edges();
   face_edges->clear();
   bool tracker_moved = false;
@@ -1300,7 +1717,7 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
     const S2ClippedShape& clipped = cell.clipped(s);
     int shape_id = clipped.shape_id();
     const S2Shape* shape = this->shape(shape_id);
-    if (shape == nullptr) continue;  // This shape is being removed.
+    S2_DCHECK(shape != nullptr);  // Removed shapes are deleted beforehand.
     int num_edges = clipped.num_edges();
 
     // If this shape has an interior, start tracking whether we are inside the
@@ -1346,26 +1763,21 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
                                                      pcell.bound());
     new_edges.push_back(clipped);
   }
-  // Discard any edges from "edges" that are being removed, and append the
-  // remainder to "new_edges".  (This keeps the edges sorted by shape id.)
-  for (int i = 0; i < edges->size(); ++i) {
-    const ClippedEdge* clipped = (*edges)[i];
-    if (!is_shape_being_removed(clipped->face_edge->shape_id)) {
-      new_edges.insert(new_edges.end(), edges->begin() + i, edges->end());
-      break;
-    }
-  }
+  // Append the edges being added to "new_edges".  (This keeps the edges
+  // sorted by shape id, since shapes being added have the largest ids.)
+  new_edges.insert(new_edges.end(), edges->begin(), edges->end());
   // Update the edge list and delete this cell from the index.
   edges->swap(new_edges);
   cell_map_.erase(pcell.id());
-  delete &cell;
+  DeleteCell(&cell);
 }
 
 // Attempt to build an index cell containing the given edges, and return true
 // if successful.  (Otherwise the edges should be subdivided further.)
 bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
                                         const vector<const ClippedEdge*>& edges,
-                                        InteriorTracker* tracker) {
+                                        InteriorTracker* tracker,
+                                        CellMap* cell_map) {
   if (edges.empty() && tracker->shape_ids().empty()) {
     // No index cell is needed.  (In most cases this situation is detected
     // before we get to this point, but this can happen when all shapes in a
@@ -1374,12 +1786,19 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
   }
 
   // Count the number of edges that have not reached their maximum level yet.
-  // Return false if there are too many such edges.
-  int count = 0;
-  for (const ClippedEdge* edge : edges) {
-    count += (pcell.level() < edge->face_edge->max_level);
-    if (count > options_.max_edges_per_cell())
-      return false;
+  // Return false if there are too many such edges.  Cells that consist
+  // mostly of long edges are not subdivided (see min_short_edge_fraction).
+  if (edges.size() > options_.max_edges_per_cell()) {
+    int max_short_edges = max(
+        options_.max_edges_per_cell(),
+        static_cast<int>(options_.min_short_edge_fraction() *
+                         (edges.size() + tracker->shape_ids().size())));
+    int count = 0;
+    for (const ClippedEdge* edge : edges) {
+      count += (pcell.level() < edge->face_edge->max_level);
+      if (count > max_short_edges)
+        return false;
+    }
   }
 
   // Possible optimization: Continue subdividing as long as exactly one child
@@ -1410,15 +1829,23 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
       tracker->MoveTo(pcell.GetEntryVertex());
     }
     tracker->DrawTo(pcell.GetCenter());
-    TestAllEdges(edges, tracker);
+    TestAllEdges(pcell.id().face(), edges, tracker);
   }
   // Allocate and fill a new index cell.  To get the total number of shapes we
   // need to merge the shapes associated with the intersecting edges together
   // with the shapes that happen to contain the cell center.
   const ShapeIdSet& cshape_ids = tracker->shape_ids();
   int num_shapes = CountShapes(edges, cshape_ids);
-  S2ShapeIndexCell* cell = new S2ShapeIndexCell;
-  S2ClippedShape* base = cell->add_shapes(num_shapes);
+  S2ShapeIndexCell* cell;
+  S2ClippedShape* base;
+  int32* next_edge = nullptr;  // Edge storage when using "cell_arena_".
+  if (cell_arena_ != nullptr) {
+    cell = cell_arena_->NewCell(num_shapes, edges.size(), &next_edge);
+    base = cell->shapes_;
+  } else {
+    cell = new S2ShapeIndexCell;
+    base = cell->add_shapes(num_shapes);
+  }
 
   // To fill the index cell we merge the two sources of shapes: "edge shapes"
   // (those that have at least one edge that intersects this cell), and
@@ -1448,7 +1875,12 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
              edges[enext]->face_edge->shape_id == eshape_id) {
         ++enext;
       }
-      clipped->Init(eshape_id, enext - ebegin);
+      if (next_edge != nullptr) {
+        clipped->Init(eshape_id, enext - ebegin, next_edge);
+        if (!clipped->is_inline()) next_edge += enext - ebegin;
+      } else {
+        clipped->Init(eshape_id, enext - ebegin);
+      }
       for (int e = ebegin; e < enext; ++e) {
         clipped->set_edge(e - ebegin, edges[e]->face_edge->edge_id);
       }
@@ -1463,24 +1895,31 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
   // is much faster to give an insertion hint in this case.  Otherwise the
   // hint doesn't do much harm.  With more effort we could provide a hint even
   // during incremental updates, but this is probably not worth the effort.
-  cell_map_.insert(cell_map_.end(), std::make_pair(pcell.id(), cell));
+  cell_map->insert(cell_map->end(), std::make_pair(pcell.id(), cell));
 
   // Shift the InteriorTracker focus point to the exit vertex of this cell.
   if (tracker->is_active() && !edges.empty()) {
     tracker->DrawTo(pcell.GetExitVertex());
-    TestAllEdges(edges, tracker);
+    TestAllEdges(pcell.id().face(), edges, tracker);
     tracker->set_next_cellid(pcell.id().next());
   }
   return true;
 }
 
 // Call tracker->TestEdge() on all edges from shapes that have interiors.
+// Edges whose clipped bounds are disjoint from the current tracker segment
+// cannot cross it and are skipped, which avoids most of the exact crossing
+// tests when many overlapping polygons share the same cell.  The segment
+// bound is padded by kCellPadding to allow for the errors in the clipped
+// edge bounds and in the (u,v) coordinates of the segment endpoints.
 /* static */
-void MutableS2ShapeIndex::TestAllEdges(const vector<const ClippedEdge*>& edges,
+void MutableS2ShapeIndex::TestAllEdges(int face,
+                                       const vector<const ClippedEdge*>& edges,
                                        InteriorTracker* tracker) {
+  const R2Rect bound = tracker->GetSegmentBound(face, kCellPadding);
   for (const ClippedEdge* edge : edges) {
     const FaceEdge* face_edge = edge->face_edge;
-    if (face_edge->has_interior) {
+    if (face_edge->has_interior && bound.Intersects(edge->bound)) {
       tracker->TestEdge(face_edge->shape_id, face_edge->edge);
     }
   }
@@ -1511,16 +1950,41 @@ int MutableS2ShapeIndex::CountShapes(const vector<const ClippedEdge*>& edges,
   return count;
 }
 
+bool MutableS2ShapeIndex::VisitCells(const CellVisitor& visitor) const {
+  MaybeApplyUpdates();
+  // "ahead" runs kPrefetchDistance cells ahead of the cell being visited and
+  // prefetches each S2ShapeIndexCell.  The clipped shapes of a cell are
+  // prefetched when it is half that distance ahead, by which time the cell
+  // itself has usually been loaded.
+  static const int kPrefetchDistance = 8;
+  const CellMap::const_iterator end = cell_map_.end();
+  CellMap::const_iterator it = cell_map_.begin(), mid = it, ahead = it;
+  for (int i = 0; i < kPrefetchDistance && ahead != end; ++i, ++ahead) {
+    prefetch(ahead->second);
+  }
+  for (int i = 0; i < kPrefetchDistance / 2 && mid != end; ++i, ++mid) {
+    prefetch(mid->second->shapes_);
+  }
+  for (; it != end; ++it) {
+    if (ahead != end) prefetch((ahead++)->second);
+    if (mid != end) prefetch((mid++)->second->shapes_);
+    if (!visitor(it->first, *it->second)) return false;
+  }
+  return true;
+}
+
 size_t MutableS2ShapeIndex::SpaceUsed() const {
   size_t size = sizeof(*this);
   size += shapes_.capacity() * sizeof(std::unique_ptr<S2Shape>);
   // cell_map_ itself is already included in sizeof(*this).
   size += cell_map_.bytes_used() - sizeof(cell_map_);
-  size += cell_map_.size() * sizeof(S2ShapeIndexCell);
+  if (cell_arena_ != nullptr) size += cell_arena_->SpaceUsed();
   Iterator it;
   for (it.InitStale(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
     const S2ShapeIndexCell& cell = it.cell();
-    size += cell.shapes_.capacity() * sizeof(S2ClippedShape);
+    if (!cell.owns_shapes_) continue;  // Counted by cell_arena_.
+    size += sizeof(S2ShapeIndexCell);
+    size += cell.num_clipped() * sizeof(S2ClippedShape);
     for (int s = 0; s < cell.num_clipped(); ++s) {
       const S2ClippedShape& clipped = cell.clipped(s);
       if (!clipped.is_inline()) {
@@ -1545,6 +2009,23 @@ void MutableS2ShapeIndex::Encode(Encoder* encoder) const {
 
   vector<S2CellId> cell_ids;
   cell_ids.reserve(cell_map_.size());
+  if (encoder->has_sink()) {
+    // Encode the cells directly to the sink rather than buffering them all
+    // in memory (see StringVectorEncoder::EncodeStreaming).
+    vector<const S2ShapeIndexCell*> cells;
+    cells.reserve(cell_map_.size());
+    for (Iterator it(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
+      cell_ids.push_back(it.id());
+      cells.push_back(&it.cell());
+    }
+    s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+    s2coding::StringVectorEncoder::EncodeStreaming(
+        cells.size(), [this, &cells](int i, Encoder* cell_encoder) {
+          cells[i]->Encode(num_shape_ids(), cell_encoder);
+          return true;
+        }, encoder);
+    return;
+  }
   s2coding::StringVectorEncoder encoded_cells;
   for (Iterator it(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
     cell_ids.push_back(it.id());
@@ -1582,5 +2063,8 @@ bool MutableS2ShapeIndex::Init(Decoder* decoder,
     if (!cell->Decode(num_shapes, &decoder)) return false;
     cell_map_.insert(cell_map_.end(), std::make_pair(id, cell));
   }
+  // The decoded shapes are already indexed, so later updates must not add
+  // them again (and removing one of them must update its cells).
+  pending_additions_begin_ = num_shapes;
   return true;
 }
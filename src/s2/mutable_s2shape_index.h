@@ -21,13 +21,16 @@
 #include <array>
 #include <atomic>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 
 #include "s2/base/logging.h"
 #include "s2/base/mutex.h"
+#include "s2/base/port.h"
 #include "s2/base/spinlock.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/s2cell_id.h"
@@ -40,6 +43,8 @@
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/util/gtl/btree_map.h"
 
+class Executor;
+
 // MutableS2ShapeIndex is a class for in-memory indexing of polygonal geometry.
 // The objects in the index are known as "shapes", and may consist of points,
 // polylines, and/or polygons, possibly overlapping.  The index makes it very
@@ -119,6 +124,71 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   using CellMap = gtl::btree_map<S2CellId, S2ShapeIndexCell*>;
 
  public:
+  // BuildStats collects statistics about the construction of the index, in
+  // order to help choose max_edges_per_cell() and estimate the memory and
+  // time required to build indexes of a given size and density.  Statistics
+  // are collected only when a BuildStats object is specified by calling
+  // Options::set_build_stats().
+  //
+  // Since updates are applied lazily, the statistics are filled in by
+  // whichever thread applies the pending updates.  They should be read only
+  // after calling ForceBuild() or some other method that applies them.
+  struct BuildStats {
+    // The following fields are summed over all the updates applied while
+    // this object was specified.
+
+    // The number of times that pending updates were applied, and the number
+    // of batches that they were split into (see
+    // --s2shape_index_tmp_memory_budget_mb).
+    int64 num_updates = 0;
+    int64 num_batches = 0;
+
+    // The number of shapes added and removed, and the total number of edges
+    // of those shapes.
+    int64 num_shapes_added = 0;
+    int64 num_shapes_removed = 0;
+    int64 num_edges_processed = 0;
+
+    // The time spent building the index cells of each cube face.  This
+    // excludes the time spent removing shapes and clipping edges to faces.
+    double face_seconds[6] = {};
+
+    // The number of temporary clipped edges created while subdividing cells,
+    // and the largest number of them that were needed at once for any face.
+    // The latter determines the peak temporary memory used by subdivision.
+    int64 num_clipped_edges = 0;
+    int64 max_clipped_edges = 0;
+
+    // The following fields describe the index after the most recent update.
+
+    // The total number of index cells, and the number on each cube face.
+    int64 num_cells = 0;
+    int64 num_cells_by_face[6] = {};
+
+    // The maximum level of any index cell, and the number of index cells at
+    // each level.
+    int max_level = 0;
+    std::vector<int64> num_cells_by_level;
+
+    // The number of index cells containing "n" edges in total (summed over
+    // all shapes), indexed by "n".  Note that cells may have more than
+    // max_edges_per_cell() edges, since long edges are not subdivided.
+    std::vector<int64> num_cells_by_num_edges;
+
+    // Resets all statistics to zero.
+    void Clear() { *this = BuildStats(); }
+
+    // Returns a human-readable summary of the statistics.
+    string ToString() const;
+  };
+
+  // Specifies how the thresholds that control cell subdivision are chosen
+  // (see Options::subdivision_mode).
+  enum class SubdivisionMode {
+    FIXED,     // Use the option values for every face.
+    ADAPTIVE,  // Adjust the long edge threshold per face (see below).
+  };
+
   // Options that affect construction of the MutableS2ShapeIndex.
   class Options {
    public:
@@ -127,7 +197,7 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
     // The maximum number of edges per cell.  If a cell has more than this
     // many edges that are not considered "long" relative to the cell size,
     // then it is subdivided.  (Whether an edge is considered "long" is
-    // controlled by --s2shape_index_cell_size_to_long_edge_ratio flag.)
+    // controlled by cell_size_to_long_edge_ratio() below.)
     //
     // Values between 10 and 50 represent a reasonable balance between memory
     // usage, construction time, and query time.  Small values make queries
@@ -144,8 +214,135 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
     int max_edges_per_cell() const { return max_edges_per_cell_; }
     void set_max_edges_per_cell(int max_edges_per_cell);
 
+    // The cell size relative to the length of an edge at which that edge is
+    // first considered to be "long".  Long edges do not contribute toward
+    // the decision to subdivide a cell further.  Smaller values cause more
+    // aggressive subdivision of long edges grouped closely together.
+    //
+    // DEFAULT: --s2shape_index_cell_size_to_long_edge_ratio
+    double cell_size_to_long_edge_ratio() const {
+      return cell_size_to_long_edge_ratio_;
+    }
+    void set_cell_size_to_long_edge_ratio(double ratio);
+
+    // A cell is subdivided only if the number of short edges is also at
+    // least this fraction of the total number of edges and shapes in the
+    // cell.  This prevents subdivision of cells that consist mostly of long
+    // edges, since such edges need to be copied to most of the children.
+    // Values of about 0.2 reduce the size of indexes where many long edges
+    // are close together; the value 0 disables this check.
+    //
+    // REQUIRES: 0 <= fraction <= 1
+    // DEFAULT: --s2shape_index_min_short_edge_fraction
+    double min_short_edge_fraction() const { return min_short_edge_fraction_; }
+    void set_min_short_edge_fraction(double fraction);
+
+    // Cells are never subdivided beyond this level, no matter how many edges
+    // they contain.  This bounds the depth of the index for geometry with
+    // many short edges that are very close together (e.g., nearly
+    // coincident vertices).
+    //
+    // REQUIRES: 0 <= max_level <= S2CellId::kMaxLevel
+    // DEFAULT: S2CellId::kMaxLevel
+    int max_level() const { return max_level_; }
+    void set_max_level(int max_level);
+
+    // In the ADAPTIVE mode, the long edge threshold of each cube face is
+    // chosen from the edges being added to that face.  If the face's edges
+    // were spread uniformly over their bounding rectangle, cells at some
+    // level L would contain about max_edges_per_cell() edges each.  The
+    // threshold is chosen so that an edge of median length becomes long at
+    // about level L, i.e. the edges of densely populated faces continue to
+    // count toward subdivision at finer levels than those of sparse faces.
+    // The resulting ratio is limited to within a factor of 8 of
+    // cell_size_to_long_edge_ratio().  This is useful when an index mixes
+    // dense small-scale geometry with sparse large-scale geometry, since a
+    // single ratio tends to produce either very deep or very large cells.
+    //
+    // The thresholds are computed from the edges added by each update; any
+    // existing edges in the cells being updated use the fixed ratio.
+    //
+    // DEFAULT: SubdivisionMode::FIXED
+    SubdivisionMode subdivision_mode() const { return subdivision_mode_; }
+    void set_subdivision_mode(SubdivisionMode mode) {
+      subdivision_mode_ = mode;
+    }
+
+    // If non-null, the initial construction of the index is split into one
+    // task per cube face and the tasks are run using the given executor (see
+    // util/thread/executor.h).  The resulting per-face cell maps are then
+    // merged together.  This can substantially reduce the time required to
+    // build large indexes whose geometry spans several faces.  Note that
+    // updates to an index that has already been built are always applied
+    // sequentially.
+    //
+    // The executor is not owned and must outlive any call that causes pending
+    // updates to be applied (see ForceBuild).  This option is not encoded.
+    //
+    // DEFAULT: nullptr (all updates are applied in the calling thread)
+    Executor* executor() const { return executor_; }
+    void set_executor(Executor* executor);
+
+    // If non-null, statistics about every subsequent update of the index are
+    // added to the given object (see BuildStats above).  The object is not
+    // owned and must outlive any call that causes pending updates to be
+    // applied.  This option is not encoded.
+    //
+    // DEFAULT: nullptr
+    BuildStats* build_stats() const { return build_stats_; }
+    void set_build_stats(BuildStats* build_stats) {
+      build_stats_ = build_stats;
+    }
+
+    // If true, the index cells built by this index (including their clipped
+    // shapes and edge ids) are carved out of large contiguous blocks owned by
+    // the index rather than being allocated individually on the heap.  This
+    // reduces heap fragmentation when a process holds many small indexes, and
+    // makes Clear() much cheaper since the blocks are freed all at once.  The
+    // tradeoff is that cells discarded by incremental updates are not
+    // reclaimed until the index is cleared or destroyed.  (Cells decoded by
+    // Init(Decoder*) are always allocated on the heap.)  This option is not
+    // encoded.
+    //
+    // DEFAULT: false
+    bool use_cell_arena() const { return use_cell_arena_; }
+    void set_use_cell_arena(bool use_cell_arena) {
+      use_cell_arena_ = use_cell_arena;
+    }
+
+    // If true, the initial construction of the index (i.e., the first update
+    // after the index is created or cleared) is done one cube face at a time.
+    // The edges of all shapes are clipped to each face in turn and only the
+    // edges that intersect the current face are kept, so the temporary
+    // memory required is proportional to the number of edges on the largest
+    // face rather than the total number of edges.  Since the faces of an
+    // index are built independently, the resulting index is identical to
+    // one built in a single pass.  (In contrast, the automatic splitting of
+    // large updates into batches of shapes, which this option replaces, can
+    // yield a different cell structure; see
+    // --s2shape_index_tmp_memory_budget_mb.)
+    //
+    // The cost is that every edge is clipped to the cube faces six times
+    // rather than once, and that "executor" is not used for the initial
+    // construction.  Later updates are not affected.  This option is not
+    // encoded.
+    //
+    // DEFAULT: false
+    bool build_one_face_at_a_time() const { return build_one_face_at_a_time_; }
+    void set_build_one_face_at_a_time(bool build_one_face_at_a_time) {
+      build_one_face_at_a_time_ = build_one_face_at_a_time;
+    }
+
    private:
     int max_edges_per_cell_;
+    double cell_size_to_long_edge_ratio_;
+    double min_short_edge_fraction_;
+    int max_level_;
+    SubdivisionMode subdivision_mode_;
+    Executor* executor_;
+    BuildStats* build_stats_;
+    bool use_cell_arena_;
+    bool build_one_face_at_a_time_;
   };
 
   // Creates a MutableS2ShapeIndex that uses the default option settings.
@@ -189,8 +386,14 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   //   s2shapeutil::CompactEncodeTaggedShapes(index, encoder);
   //   index.Encode(encoder);
   //
-  // REQUIRES: "encoder" uses the default constructor, so that its buffer
-  //           can be enlarged as necessary by calling Ensure(int).
+  // If "encoder" passes its output to an Encoder::Sink, then the index cells
+  // are encoded directly to the sink rather than being buffered in memory
+  // first.  This allows very large indexes to be written to a file or stream
+  // using a fixed amount of memory (beyond 8 bytes per cell).  The output is
+  // identical either way.
+  //
+  // REQUIRES: "encoder" uses the default constructor or a Sink, so that its
+  //           buffer can be enlarged as necessary by calling Ensure(int).
   void Encode(Encoder* encoder) const;
 
   // Decodes an S2ShapeIndex, returning true on success.
@@ -258,10 +461,21 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
 
    private:
     void Refresh();  // Updates the IteratorBase fields.
+    void PrefetchNext() const;
     const MutableS2ShapeIndex* index_;
     CellMap::const_iterator iter_, end_;
   };
 
+  // Calls visitor(id, cell) for every cell of the index in increasing order
+  // of S2CellId, stopping early if the visitor returns false (in which case
+  // this method also returns false).  This is equivalent to looping over the
+  // index with an Iterator, but it is faster for full scans of large indexes
+  // because the upcoming cells and their clipped shapes are prefetched
+  // several cells in advance.  Pending updates are applied first.
+  using CellVisitor =
+      std::function<bool (S2CellId id, const S2ShapeIndexCell& cell)>;
+  bool VisitCells(const CellVisitor& visitor) const;
+
   // Takes ownership of the given shape and adds it to the index.  Also
   // assigns a unique id to the shape (shape->id()) and returns that id.
   // Shape ids are assigned sequentially starting from 0 in the order shapes
@@ -270,6 +484,12 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
 
   // Removes the given shape from the index and return ownership to the caller.
   // Invalidates all iterators and their associated data.
+  //
+  // The removal is applied lazily (like Add) by deleting the shape from the
+  // index cells that refer to it, so its cost is proportional to the number
+  // of such cells.  Note that cells are not merged with their neighbors, so
+  // the index may be slightly more finely subdivided than if it had been
+  // rebuilt from scratch.
   std::unique_ptr<S2Shape> Release(int shape_id);
 
   // Resets the index to its original state and returns ownership of all
@@ -311,12 +531,14 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
 
  private:
+  friend class DeltaS2ShapeIndex;
   friend class EncodedS2ShapeIndex;
   friend class Iterator;
   friend class MutableS2ShapeIndexTest;
   friend class S2Stats;
 
   struct BatchDescriptor;
+  class CellArena;
   struct ClippedEdge;
   class EdgeAllocator;
   struct FaceEdge;
@@ -331,10 +553,10 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
 
   // Internal methods are documented with their definitions.
   bool is_first_update() const;
-  bool is_shape_being_removed(int shape_id) const;
   void MaybeApplyUpdates() const;
   void ApplyUpdatesThreadSafe();
   void ApplyUpdatesInternal();
+  void UpdateIndexStats(BuildStats* stats) const;
   void GetUpdateBatches(std::vector<BatchDescriptor>* batches) const;
   static void GetBatchSizes(int num_items, int max_batches,
                             double final_bytes_per_item,
@@ -344,32 +566,41 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   void ReserveSpace(const BatchDescriptor& batch,
                     std::vector<FaceEdge> all_edges[6]) const;
   void AddShape(int id, std::vector<FaceEdge> all_edges[6],
-                InteriorTracker* tracker) const;
-  void RemoveShape(const RemovedShape& removed,
-                   std::vector<FaceEdge> all_edges[6],
-                   InteriorTracker* tracker) const;
-  void AddFaceEdge(FaceEdge* edge, std::vector<FaceEdge> all_edges[6]) const;
+                InteriorTracker* tracker, int face = -1) const;
+  void InitFaceTracker(int face, int additions_end,
+                       InteriorTracker* tracker) const;
+  void UpdateFacesInParallel(int additions_end,
+                             const std::vector<FaceEdge> all_edges[6]);
+  void BuildOneFaceAtATime();
+  void RemoveShapeFromIndexCells(const RemovedShape& removed);
+  void AdaptEdgeMaxLevels(std::vector<FaceEdge>* face_edges) const;
   void UpdateFaceEdges(int face, const std::vector<FaceEdge>& face_edges,
-                       InteriorTracker* tracker);
+                       InteriorTracker* tracker, CellMap* cell_map,
+                       BuildStats* stats);
   S2CellId ShrinkToFit(const S2PaddedCell& pcell, const R2Rect& bound) const;
   void SkipCellRange(S2CellId begin, S2CellId end, InteriorTracker* tracker,
-                     EdgeAllocator* alloc, bool disjoint_from_index);
+                     EdgeAllocator* alloc, bool disjoint_from_index,
+                     CellMap* cell_map);
   void UpdateEdges(const S2PaddedCell& pcell,
                    std::vector<const ClippedEdge*>* edges,
                    InteriorTracker* tracker, EdgeAllocator* alloc,
-                   bool disjoint_from_index);
+                   bool disjoint_from_index, CellMap* cell_map);
   void AbsorbIndexCell(const S2PaddedCell& pcell,
                        const Iterator& iter,
                        std::vector<const ClippedEdge*>* edges,
                        InteriorTracker* tracker,
                        EdgeAllocator* alloc);
   int GetEdgeMaxLevel(const S2Shape::Edge& edge) const;
+  int GetEdgeMaxLevel(const S2Shape::Edge& edge,
+                      double cell_size_to_long_edge_ratio) const;
   static int CountShapes(const std::vector<const ClippedEdge*>& edges,
                          const ShapeIdSet& cshape_ids);
   bool MakeIndexCell(const S2PaddedCell& pcell,
                      const std::vector<const ClippedEdge*>& edges,
-                     InteriorTracker* tracker);
-  static void TestAllEdges(const std::vector<const ClippedEdge*>& edges,
+                     InteriorTracker* tracker, CellMap* cell_map);
+  void DeleteCell(const S2ShapeIndexCell* cell) const;
+  static void TestAllEdges(int face,
+                           const std::vector<const ClippedEdge*>& edges,
                            InteriorTracker* tracker);
   inline static const ClippedEdge* UpdateBound(const ClippedEdge* edge,
                                                int u_end, double u,
@@ -403,6 +634,10 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // The options supplied for this index.
   Options options_;
 
+  // If options_.use_cell_arena() is true, the storage for all index cells
+  // built by this index.
+  std::unique_ptr<CellArena> cell_arena_;
+
   // The id of the first shape that has been queued for addition but not
   // processed yet.
   int pending_additions_begin_ = 0;
@@ -411,7 +646,6 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   struct RemovedShape {
     int32 shape_id;
     bool has_interior;  // Belongs to a shape of dimension 2.
-    bool contains_tracker_origin;
     std::vector<S2Shape::Edge> edges;
   };
 
@@ -513,6 +747,7 @@ inline void MutableS2ShapeIndex::Iterator::InitStale(
     iter_ = end_;
   }
   Refresh();
+  PrefetchNext();
 }
 
 inline const S2ShapeIndexCell& MutableS2ShapeIndex::Iterator::cell() const {
@@ -529,11 +764,23 @@ inline void MutableS2ShapeIndex::Iterator::Refresh() {
   }
 }
 
+// Prefetches the clipped shapes of the current cell (whose S2ShapeIndexCell
+// was prefetched by the previous call) and the S2ShapeIndexCell after it.
+// This hides much of the memory latency of sequential scans, since cells are
+// allocated separately from the btree nodes that point to them.
+inline void MutableS2ShapeIndex::Iterator::PrefetchNext() const {
+  if (iter_ == end_) return;
+  prefetch(iter_->second->shapes_);
+  CellMap::const_iterator next = iter_;
+  if (++next != end_) prefetch(next->second);
+}
+
 inline void MutableS2ShapeIndex::Iterator::Begin() {
   // Make sure that the index has not been modified since Init() was called.
   S2_DCHECK(index_->is_fresh());
   iter_ = index_->cell_map_.begin();
   Refresh();
+  PrefetchNext();
 }
 
 inline void MutableS2ShapeIndex::Iterator::Finish() {
@@ -545,6 +792,7 @@ inline void MutableS2ShapeIndex::Iterator::Next() {
   S2_DCHECK(!done());
   ++iter_;
   Refresh();
+  PrefetchNext();
 }
 
 inline bool MutableS2ShapeIndex::Iterator::Prev() {
@@ -575,13 +823,6 @@ inline bool MutableS2ShapeIndex::is_first_update() const {
   return pending_additions_begin_ == 0;
 }
 
-// Given that the given shape is being updated, return true if it is being
-// removed (as opposed to being added).
-inline bool MutableS2ShapeIndex::is_shape_being_removed(int shape_id) const {
-  // All shape ids being removed are less than all shape ids being added.
-  return shape_id < pending_additions_begin_;
-}
-
 // Ensure that any pending updates have been applied.  This method must be
 // called before accessing the cell_map_ field, even if the index_status_
 // appears to be FRESH, because a memory barrier is required in order to
@@ -0,0 +1,246 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for building a MutableS2ShapeIndex.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2crossing_edge_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2polyline.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+void BM_BuildIndexFractalLoop(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(state.range(0));
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                               S2Testing::KmToAngle(1000));
+  for (auto _ : state) {
+    MutableS2ShapeIndex index;
+    index.Add(absl::make_unique<S2Loop::Shape>(loop.get()));
+    index.ForceBuild();
+  }
+  state.SetItemsProcessed(state.iterations() * loop->num_vertices());
+}
+BENCHMARK(BM_BuildIndexFractalLoop)->Arg(100)->Arg(10000)->Arg(1000000);
+
+void BM_BuildIndexManyLoops(benchmark::State& state) {
+  S2Testing::rnd.Reset(2);
+  std::vector<std::unique_ptr<S2Loop>> loops;
+  for (int i = 0; i < state.range(0); ++i) {
+    loops.push_back(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S2Testing::KmToAngle(10), 16));
+  }
+  for (auto _ : state) {
+    MutableS2ShapeIndex index;
+    for (const auto& loop : loops) {
+      index.Add(absl::make_unique<S2Loop::Shape>(loop.get()));
+    }
+    index.ForceBuild();
+  }
+  state.SetItemsProcessed(state.iterations() * loops.size());
+}
+BENCHMARK(BM_BuildIndexManyLoops)->Arg(100)->Arg(10000);
+
+// The remaining benchmarks measure index construction and queries for
+// several kinds of input that stress different parts of the index.  They
+// take three arguments:
+//
+//  - "dist" is the input distribution (see Distribution below).
+//  - "size" is the number of shapes for TINY_LOOPS, and the approximate
+//    total number of vertices otherwise.
+//  - "max_edges" is the MutableS2ShapeIndex max_edges_per_cell() option.
+enum Distribution {
+  TINY_LOOPS,      // Many 6-sided loops with a radius of 1km.
+  HUGE_LOOP,       // A single fractal loop with a radius of 3000km.
+  LONG_POLYLINES,  // 10 polylines whose edges are often longer than a face.
+};
+
+struct Geometry {
+  vector<unique_ptr<S2Loop>> loops;
+  vector<unique_ptr<S2Polyline>> polylines;
+  S2Cap query_cap;  // The region where query points are chosen.
+};
+
+unique_ptr<Geometry> MakeGeometry(Distribution dist, int size) {
+  S2Testing::rnd.Reset(3);
+  auto geometry = make_unique<Geometry>();
+  switch (dist) {
+    case TINY_LOOPS: {
+      geometry->query_cap = S2Cap(S2Testing::RandomPoint(),
+                                  S2Testing::KmToAngle(1000));
+      for (int i = 0; i < size; ++i) {
+        geometry->loops.push_back(make_unique<S2Loop>(
+            S2Testing::MakeRegularPoints(
+                S2Testing::SamplePoint(geometry->query_cap),
+                S2Testing::KmToAngle(1), 6)));
+      }
+      break;
+    }
+    case HUGE_LOOP: {
+      S2Testing::Fractal fractal;
+      fractal.SetLevelForApproxMaxEdges(size);
+      S2Point center = S2Testing::RandomPoint();
+      geometry->loops.push_back(fractal.MakeLoop(
+          S2Testing::GetRandomFrameAt(center), S2Testing::KmToAngle(3000)));
+      geometry->query_cap = S2Cap(center, S2Testing::KmToAngle(4000));
+      break;
+    }
+    case LONG_POLYLINES: {
+      for (int i = 0; i < 10; ++i) {
+        vector<S2Point> vertices;
+        for (int j = 0; j < std::max(2, size / 10); ++j) {
+          vertices.push_back(S2Testing::RandomPoint());
+        }
+        geometry->polylines.push_back(make_unique<S2Polyline>(vertices));
+      }
+      geometry->query_cap = S2Cap::Full();
+      break;
+    }
+  }
+  return geometry;
+}
+
+// Adds the shapes of "geometry" to "index" without transferring ownership,
+// and returns the number of edges added.
+int AddShapes(const Geometry& geometry, MutableS2ShapeIndex* index) {
+  int num_edges = 0;
+  for (const auto& loop : geometry.loops) {
+    index->Add(make_unique<S2Loop::Shape>(loop.get()));
+    num_edges += loop->num_vertices();
+  }
+  for (const auto& polyline : geometry.polylines) {
+    index->Add(make_unique<S2Polyline::Shape>(polyline.get()));
+    num_edges += polyline->num_vertices() - 1;
+  }
+  return num_edges;
+}
+
+MutableS2ShapeIndex::Options GetIndexOptions(const benchmark::State& state) {
+  MutableS2ShapeIndex::Options options;
+  options.set_max_edges_per_cell(state.range(2));
+  return options;
+}
+
+// Builds an index containing the given geometry, reporting its size.
+unique_ptr<MutableS2ShapeIndex> BuildIndex(const Geometry& geometry,
+                                           benchmark::State* state) {
+  auto index = make_unique<MutableS2ShapeIndex>(GetIndexOptions(*state));
+  AddShapes(geometry, index.get());
+  index->ForceBuild();
+  state->counters["bytes"] = index->SpaceUsed();
+  return index;
+}
+
+vector<S2Point> SampleQueryPoints(const Geometry& geometry) {
+  vector<S2Point> points;
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(S2Testing::SamplePoint(geometry.query_cap));
+  }
+  return points;
+}
+
+void BM_BuildIndexDistribution(benchmark::State& state) {
+  auto geometry = MakeGeometry(static_cast<Distribution>(state.range(0)),
+                               state.range(1));
+  int num_edges = 0;
+  size_t space_used = 0;
+  for (auto _ : state) {
+    MutableS2ShapeIndex index(GetIndexOptions(state));
+    num_edges = AddShapes(*geometry, &index);
+    index.ForceBuild();
+    space_used = index.SpaceUsed();
+  }
+  state.counters["bytes"] = space_used;
+  state.SetItemsProcessed(state.iterations() * num_edges);
+}
+
+void BM_ContainsPointDistribution(benchmark::State& state) {
+  auto geometry = MakeGeometry(static_cast<Distribution>(state.range(0)),
+                               state.range(1));
+  auto index = BuildIndex(*geometry, &state);
+  vector<S2Point> points = SampleQueryPoints(*geometry);
+  auto query = MakeS2ContainsPointQuery(index.get());
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+
+void BM_ClosestEdgeDistribution(benchmark::State& state) {
+  auto geometry = MakeGeometry(static_cast<Distribution>(state.range(0)),
+                               state.range(1));
+  auto index = BuildIndex(*geometry, &state);
+  vector<S2Point> points = SampleQueryPoints(*geometry);
+  S2ClosestEdgeQuery query(index.get());
+  int i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdge(&target));
+    if (++i == points.size()) i = 0;
+  }
+}
+
+// The query edges have a length of up to 1% of the query cap diameter.
+void BM_CrossingEdgesDistribution(benchmark::State& state) {
+  auto geometry = MakeGeometry(static_cast<Distribution>(state.range(0)),
+                               state.range(1));
+  auto index = BuildIndex(*geometry, &state);
+  vector<S2Point> points = SampleQueryPoints(*geometry);
+  vector<S2Point> ends;
+  for (const S2Point& p : points) {
+    ends.push_back(S2Testing::SamplePoint(
+        S2Cap(p, 0.02 * geometry->query_cap.GetRadius())));
+  }
+  S2CrossingEdgeQuery query(index.get());
+  vector<s2shapeutil::ShapeEdge> edges;
+  int i = 0;
+  for (auto _ : state) {
+    query.GetCrossingEdges(points[i], ends[i], s2shapeutil::CrossingType::ALL,
+                           &edges);
+    benchmark::DoNotOptimize(edges.data());
+    if (++i == points.size()) i = 0;
+  }
+}
+
+void DistributionArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"dist", "size", "max_edges"});
+  b->ArgsProduct({{TINY_LOOPS, HUGE_LOOP, LONG_POLYLINES},
+                  {1000, 100000},
+                  {4, 10, 50}});
+}
+BENCHMARK(BM_BuildIndexDistribution)->Apply(DistributionArgs);
+BENCHMARK(BM_ContainsPointDistribution)->Apply(DistributionArgs);
+BENCHMARK(BM_ClosestEdgeDistribution)->Apply(DistributionArgs);
+BENCHMARK(BM_CrossingEdgesDistribution)->Apply(DistributionArgs);
+
+}  // namespace
@@ -17,7 +17,9 @@
 
 #include "s2/mutable_s2shape_index.h"
 
+#include <algorithm>
 #include <functional>
+#include <map>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -41,6 +43,7 @@
 #include "s2/s2edge_crosser.h"
 #include "s2/s2edge_vector_shape.h"
 #include "s2/s2error.h"
+#include "s2/s2latlng.h"
 #include "s2/s2loop.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2polygon.h"
@@ -51,6 +54,7 @@
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 #include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
 
 using absl::WrapUnique;
 using absl::make_unique;
@@ -107,6 +111,7 @@ void MutableS2ShapeIndexTest::QuadraticValidate() {
     // Iterate through all the shapes, simultaneously validating the current
     // index cell and all the skipped cells.
     int short_edges = 0;  // number of edges counted toward subdivision
+    int total_edges = 0;
     for (int id = 0; id < index_.num_shape_ids(); ++id) {
       const S2Shape* shape = index_.shape(id);
       const S2ClippedShape* clipped = nullptr;
@@ -134,6 +139,7 @@ void MutableS2ShapeIndexTest::QuadraticValidate() {
         if (!it.done()) {
           bool has_edge = clipped && clipped->ContainsEdge(e);
           ValidateEdge(edge.v0, edge.v1, it.id(), has_edge);
+          total_edges += has_edge;
           int max_level = index_.GetEdgeMaxLevel(edge);
           if (has_edge && it.id().level() < max_level) {
             ++short_edges;
@@ -141,7 +147,17 @@ void MutableS2ShapeIndexTest::QuadraticValidate() {
         }
       }
     }
-    EXPECT_LE(short_edges, index_.options().max_edges_per_cell());
+    // In the ADAPTIVE mode, the edges of each face use a different threshold
+    // for being short.
+    const MutableS2ShapeIndex::Options& options = index_.options();
+    if (options.subdivision_mode() ==
+        MutableS2ShapeIndex::SubdivisionMode::FIXED) {
+      EXPECT_LE(short_edges, std::max(options.max_edges_per_cell(),
+                                      static_cast<int>(
+                                          options.min_short_edge_fraction() *
+                                          (total_edges +
+                                           index_.num_shape_ids()))));
+    }
     if (it.done()) break;
   }
 }
@@ -171,6 +187,20 @@ void MutableS2ShapeIndexTest::ValidateInterior(
   }
 }
 
+namespace {
+
+// An Encoder::Sink that appends its input to a string.
+class StringSink : public Encoder::Sink {
+ public:
+  explicit StringSink(string* output) : output_(output) {}
+  void Append(const char* data, size_t n) override { output_->append(data, n); }
+
+ private:
+  string* output_;
+};
+
+}  // namespace
+
 void MutableS2ShapeIndexTest::TestEncodeDecode() {
   Encoder encoder;
   index_.Encode(&encoder);
@@ -178,6 +208,16 @@ void MutableS2ShapeIndexTest::TestEncodeDecode() {
   MutableS2ShapeIndex index2;
   ASSERT_TRUE(index2.Init(&decoder, s2shapeutil::WrappedShapeFactory(&index_)));
   s2testing::ExpectEqual(index_, index2);
+
+  // Encoding to a sink in small chunks should yield the same output.
+  string streamed;
+  StringSink sink(&streamed);
+  {
+    Encoder sink_encoder(&sink, 64);
+    index_.Encode(&sink_encoder);
+    EXPECT_EQ(encoder.length(), sink_encoder.length());
+  }
+  EXPECT_EQ(string(encoder.base(), encoder.length()), streamed);
 }
 
 namespace {
@@ -234,6 +274,39 @@ void TestIteratorMethods(const MutableS2ShapeIndex& index) {
   }
 }
 
+TEST_F(MutableS2ShapeIndexTest, LocateNearbyPoints) {
+  // Locates a sequence of nearby points (which are usually in the same or an
+  // adjacent cell) with a single iterator, and checks the results against
+  // those of a fresh iterator.  The loops are small enough that many of the
+  // points are in gaps between index cells.
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.05), 50)));
+  }
+  MutableS2ShapeIndex::Iterator it(&index_);
+  const S2ShapeIndex& base_index = index_;
+  S2ShapeIndex::Iterator generic_it(&base_index);
+  S2Point p = cap.center();
+  for (int i = 0; i < 2000; ++i) {
+    if (S2Testing::rnd.OneIn(100)) {
+      p = S2Testing::SamplePoint(cap);
+    } else {
+      S2Cap step(p, S1Angle::Degrees(0.01));
+      p = S2Testing::SamplePoint(step);
+    }
+    MutableS2ShapeIndex::Iterator expected(&index_);
+    bool found = expected.Locate(p);
+    ASSERT_EQ(found, it.Locate(p));
+    ASSERT_EQ(found, generic_it.Locate(p));
+    if (found) {
+      EXPECT_EQ(expected.id(), it.id());
+      EXPECT_EQ(expected.id(), generic_it.id());
+    }
+  }
+}
+
 TEST_F(MutableS2ShapeIndexTest, SpaceUsed) {
   index_.Add(make_unique<S2EdgeVectorShape>(S2Point(1, 0, 0),
                                             S2Point(0, 1, 0)));
@@ -294,6 +367,31 @@ TEST_F(MutableS2ShapeIndexTest, LoopsSpanningThreeFaces) {
   TestEncodeDecode();
 }
 
+TEST_F(MutableS2ShapeIndexTest, ManyOverlappingLoops) {
+  // Many overlapping polygons share the same index cells, so the interior
+  // tracker must skip edges that cannot cross its segments while still
+  // handling edges that pass through cell vertices and centers.
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  vector<unique_ptr<S2Loop>> loops;
+  S2Point center = S2Point(1, 0.5, 0.5).Normalize();
+  S2Cap cap(center, S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    loops.push_back(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap),
+        S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 1)), 16));
+  }
+  S2CellId id = S2CellId(center).parent(8);
+  for (int i = 0; i < 4; ++i) {
+    loops.push_back(make_unique<S2Loop>(S2Cell(id.child(i))));
+    loops.push_back(make_unique<S2Loop>(S2Cell(id.child(i).child(i))));
+  }
+  for (const auto& loop : loops) {
+    index_.Add(make_unique<S2Loop::Shape>(loop.get()));
+  }
+  QuadraticValidate();
+  TestIteratorMethods(index_);
+}
+
 TEST_F(MutableS2ShapeIndexTest, ManyIdenticalEdges) {
   const int kNumEdges = 100;  // Validation is quadratic
   S2Point a = S2Point(0.99, 0.99, 1).Normalize();
@@ -354,6 +452,87 @@ TEST_F(MutableS2ShapeIndexTest, ManyTinyEdges) {
   EXPECT_TRUE(it.done());
 }
 
+TEST_F(MutableS2ShapeIndexTest, MaxLevel) {
+  // Like the test above, except that subdivision stops at max_level().
+  MutableS2ShapeIndex::Options options;
+  options.set_max_level(10);
+  index_.Init(options);
+  S2Point a = S2CellId(S2Point(1, 0, 0)).ToPoint();
+  S2Point b = (a + S2Point(0, 1e-12, 0)).Normalize();
+  auto shape = make_unique<S2EdgeVectorShape>();
+  for (int i = 0; i < 100; ++i) {
+    shape->Add(a, b);
+  }
+  index_.Add(std::move(shape));
+  QuadraticValidate();
+  MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+  ASSERT_TRUE(!it.done());
+  EXPECT_EQ(10, it.id().level());
+  it.Next();
+  EXPECT_TRUE(it.done());
+}
+
+// Adds many long edges close together, surrounded by short edges.
+static void AddLongAndShortEdges(MutableS2ShapeIndex* index) {
+  auto shape = make_unique<S2EdgeVectorShape>();
+  for (int i = 0; i < 100; ++i) {
+    S2Point a = S2LatLng::FromDegrees(1e-4 * i, 0).ToPoint();
+    S2Point b = S2LatLng::FromDegrees(1e-4 * i, 1).ToPoint();
+    shape->Add(a, b);
+  }
+  S2Testing::rnd.Reset(1);
+  S2Cap cap(S2LatLng::FromDegrees(0, 0.5).ToPoint(), S1Angle::Degrees(0.5));
+  for (int i = 0; i < 100; ++i) {
+    S2Point a = S2Testing::SamplePoint(cap);
+    shape->Add(a, (a + S2Point(0, 1e-6, 0)).Normalize());
+  }
+  index->Add(std::move(shape));
+}
+
+TEST_F(MutableS2ShapeIndexTest, MinShortEdgeFraction) {
+  AddLongAndShortEdges(&index_);
+  QuadraticValidate();
+  int num_cells = 0;
+  for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    ++num_cells;
+  }
+  // Cells that contain mostly long edges are no longer subdivided.
+  MutableS2ShapeIndex::Options options;
+  options.set_min_short_edge_fraction(0.5);
+  index_.Clear();
+  index_.Init(options);
+  AddLongAndShortEdges(&index_);
+  QuadraticValidate();
+  int num_fraction_cells = 0;
+  for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    ++num_fraction_cells;
+  }
+  EXPECT_LT(num_fraction_cells, num_cells);
+}
+
+TEST_F(MutableS2ShapeIndexTest, AdaptiveSubdivision) {
+  // Small dense loops on one face and a large sparse loop spanning others.
+  MutableS2ShapeIndex::Options options;
+  options.set_subdivision_mode(MutableS2ShapeIndex::SubdivisionMode::ADAPTIVE);
+  index_.Init(options);
+  S2Cap cap(S2Point(1, 0, 0), S1Angle::Degrees(1));
+  for (int i = 0; i < 10; ++i) {
+    index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S2Testing::KmToAngle(0.1), 10)));
+  }
+  index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(0, 0, 1), S1Angle::Degrees(80), 100)));
+  QuadraticValidate();
+  TestEncodeDecode();
+
+  // Incremental updates combine adaptive and fixed thresholds.
+  index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(2), 50)));
+  QuadraticValidate();
+}
+
 TEST_F(MutableS2ShapeIndexTest, SimpleUpdates) {
   // Add 5 loops one at a time, then release them one at a time,
   // validating the index at each step.
@@ -439,6 +618,277 @@ TEST_F(MutableS2ShapeIndexTest, RandomUpdates) {
   }
 }
 
+TEST_F(MutableS2ShapeIndexTest, ReleaseOnlyModifiesCellsContainingShape) {
+  // Index many small loops plus one large loop, then remove a small loop and
+  // check that the only cells that changed are the ones containing it.
+  index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(30), 100)));
+  for (int i = 0; i < 50; ++i) {
+    index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S2Testing::KmToAngle(100), 20)));
+  }
+  index_.ForceBuild();
+  std::map<S2CellId, const S2ShapeIndexCell*> before;
+  const int kRemovedId = 7;
+  for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    if (it.cell().find_clipped(kRemovedId) == nullptr) {
+      before[it.id()] = &it.cell();
+    }
+  }
+  auto released = index_.Release(kRemovedId);
+  for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    auto old = before.find(it.id());
+    if (old != before.end()) {
+      EXPECT_EQ(old->second, &it.cell());
+      before.erase(old);
+    }
+  }
+  EXPECT_TRUE(before.empty());
+  QuadraticValidate();
+  TestEncodeDecode();
+
+  // Also remove the large loop (whose interior contains index cells that
+  // have no edges).
+  released = index_.Release(0);
+  QuadraticValidate();
+  TestEncodeDecode();
+}
+
+// An Executor that runs every closure in a new thread.  All threads are
+// joined when the executor is destroyed.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST_F(MutableS2ShapeIndexTest, ParallelConstruction) {
+  // Build an index containing shapes that span several faces (including
+  // loops whose interiors contain entire faces), using one task per face.
+  ThreadPerTaskExecutor executor;
+  MutableS2ShapeIndex::Options options;
+  options.set_executor(&executor);
+  index_.Init(options);
+  MutableS2ShapeIndex serial;
+  auto add_loop = [this, &serial](unique_ptr<S2Loop> loop) {
+    serial.Add(make_unique<S2Loop::Shape>(loop.get()));
+    index_.Add(make_unique<S2Loop::OwningShape>(std::move(loop)));
+  };
+  add_loop(S2Loop::MakeRegularLoop(S2Point(1, 0.5, 0.5).Normalize(),
+                                   S1Angle::Degrees(89), 20));
+  add_loop(S2Loop::MakeRegularLoop(S2Point(-1, 1, 1).Normalize(),
+                                   S1Angle::Radians(M_PI - 0.001), 10));
+  add_loop(S2Loop::MakeRegularLoop(S2Point(-1, -1, -1).Normalize(),
+                                   S1Angle::Radians(M_PI - 0.001), 10));
+  add_loop(make_unique<S2Loop>(S2Loop::kFull()));
+  for (int i = 0; i < 20; ++i) {
+    add_loop(S2Loop::MakeRegularLoop(S2Testing::RandomPoint(),
+                                     S2Testing::KmToAngle(3000), 50));
+  }
+  serial.Add(make_unique<S2Polyline::OwningShape>(
+      MakePolyline("0:0, 45:90, 0:180, -45:-90")));
+  index_.Add(make_unique<S2Polyline::OwningShape>(
+      MakePolyline("0:0, 45:90, 0:180, -45:-90")));
+  index_.ForceBuild();
+  s2testing::ExpectEqual(serial, index_);
+  QuadraticValidate();
+
+  // Subsequent incremental updates are applied sequentially.
+  serial.Release(1);
+  auto released = index_.Release(1);
+  s2testing::ExpectEqual(serial, index_);
+  QuadraticValidate();
+}
+
+TEST(MutableS2ShapeIndex, CellArena) {
+  // Checks that an index whose cells are allocated from an arena is identical
+  // to one whose cells are allocated on the heap, including after shapes are
+  // removed and added incrementally and after the index is cleared.
+  MutableS2ShapeIndex::Options options;
+  options.set_use_cell_arena(true);
+  ThreadPerTaskExecutor executor;
+  for (Executor* e : {static_cast<Executor*>(nullptr),
+                      static_cast<Executor*>(&executor)}) {
+    options.set_executor(e);
+    MutableS2ShapeIndex arena_index(options), heap_index;
+    for (int iter = 0; iter < 2; ++iter) {
+      for (int i = 0; i < 10; ++i) {
+        auto loop = S2Loop::MakeRegularLoop(S2Testing::RandomPoint(),
+                                            S2Testing::KmToAngle(1000), 100);
+        heap_index.Add(make_unique<S2Loop::OwningShape>(
+            unique_ptr<S2Loop>(loop->Clone())));
+        arena_index.Add(make_unique<S2Loop::OwningShape>(std::move(loop)));
+      }
+      heap_index.ForceBuild();
+      arena_index.ForceBuild();
+      s2testing::ExpectEqual(heap_index, arena_index);
+      EXPECT_GT(arena_index.SpaceUsed(), 0);
+
+      // Remove some shapes and add another one incrementally.
+      for (int id : {1, 4, 7}) {
+        heap_index.Release(iter * 11 + id);
+        arena_index.Release(iter * 11 + id);
+      }
+      heap_index.Add(make_unique<S2Polyline::OwningShape>(
+          MakePolyline("0:0, 10:10, 20:0, 30:10")));
+      arena_index.Add(make_unique<S2Polyline::OwningShape>(
+          MakePolyline("0:0, 10:10, 20:0, 30:10")));
+      heap_index.ForceBuild();
+      arena_index.ForceBuild();
+      s2testing::ExpectEqual(heap_index, arena_index);
+    }
+    arena_index.Clear();
+    MutableS2ShapeIndex::Iterator it(&arena_index, S2ShapeIndex::BEGIN);
+    EXPECT_TRUE(it.done());
+    arena_index.Add(make_unique<S2Polyline::OwningShape>(
+        MakePolyline("0:0, 0:1")));
+    arena_index.ForceBuild();
+    EXPECT_EQ(1, MutableS2ShapeIndex::Iterator(
+        &arena_index, S2ShapeIndex::BEGIN).cell().num_clipped());
+  }
+}
+
+TEST(MutableS2ShapeIndex, BuildOneFaceAtATime) {
+  // Checks that building the index one face at a time yields exactly the
+  // same index as building it in a single pass, including for shapes that
+  // span several faces and in ADAPTIVE subdivision mode.
+  for (auto mode : {MutableS2ShapeIndex::SubdivisionMode::FIXED,
+                    MutableS2ShapeIndex::SubdivisionMode::ADAPTIVE}) {
+    MutableS2ShapeIndex::Options options;
+    options.set_subdivision_mode(mode);
+    MutableS2ShapeIndex::BuildStats stats;
+    MutableS2ShapeIndex::Options face_options = options;
+    face_options.set_build_one_face_at_a_time(true);
+    face_options.set_build_stats(&stats);
+    MutableS2ShapeIndex index(options), face_index(face_options);
+    for (int i = 0; i < 20; ++i) {
+      auto loop = S2Loop::MakeRegularLoop(S2Testing::RandomPoint(),
+                                          S2Testing::KmToAngle(3000), 100);
+      index.Add(make_unique<S2Loop::OwningShape>(
+          unique_ptr<S2Loop>(loop->Clone())));
+      face_index.Add(make_unique<S2Loop::OwningShape>(std::move(loop)));
+    }
+    for (auto* target : {&index, &face_index}) {
+      target->Add(make_unique<S2Polyline::OwningShape>(
+          MakePolyline("-60:0, 0:90, 60:180, 0:-90")));
+    }
+    index.ForceBuild();
+    face_index.ForceBuild();
+    EXPECT_EQ(6, stats.num_batches);
+    EXPECT_EQ(21, stats.num_shapes_added);
+    s2testing::ExpectEqual(index, face_index);
+    Encoder expected, actual;
+    index.Encode(&expected);
+    face_index.Encode(&actual);
+    EXPECT_EQ(string(expected.base(), expected.length()),
+              string(actual.base(), actual.length()));
+
+    // Later updates are applied as usual.
+    face_index.Add(make_unique<S2Polyline::OwningShape>(
+        MakePolyline("0:0, 10:10")));
+    face_index.ForceBuild();
+    EXPECT_EQ(7, stats.num_batches);
+  }
+}
+
+TEST(MutableS2ShapeIndex, VisitCells) {
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 10; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S2Testing::KmToAngle(2000), 200)));
+  }
+  // Pending updates are applied before the cells are visited.
+  vector<std::pair<S2CellId, const S2ShapeIndexCell*>> visited;
+  EXPECT_TRUE(index.VisitCells(
+      [&visited](S2CellId id, const S2ShapeIndexCell& cell) {
+        visited.push_back(std::make_pair(id, &cell));
+        return true;
+      }));
+  MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  for (const auto& entry : visited) {
+    ASSERT_FALSE(it.done());
+    EXPECT_EQ(it.id(), entry.first);
+    EXPECT_EQ(&it.cell(), entry.second);
+    it.Next();
+  }
+  EXPECT_TRUE(it.done());
+  ASSERT_GT(visited.size(), 20);
+
+  // The visitor can stop the scan early.
+  int num_visited = 0;
+  EXPECT_FALSE(index.VisitCells(
+      [&num_visited](S2CellId id, const S2ShapeIndexCell& cell) {
+        return ++num_visited < 20;
+      }));
+  EXPECT_EQ(20, num_visited);
+
+  MutableS2ShapeIndex empty;
+  EXPECT_TRUE(empty.VisitCells(
+      [](S2CellId id, const S2ShapeIndexCell& cell) { return false; }));
+}
+
+TEST(MutableS2ShapeIndex, BuildStats) {
+  MutableS2ShapeIndex::BuildStats stats;
+  MutableS2ShapeIndex::Options options;
+  options.set_max_edges_per_cell(10);
+  options.set_build_stats(&stats);
+  MutableS2ShapeIndex index(options);
+  index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(10), 1000)));
+  index.Add(make_unique<S2Polyline::OwningShape>(
+      MakePolyline("0:0, 0:90, 0:180")));
+  index.ForceBuild();
+  EXPECT_EQ(1, stats.num_updates);
+  EXPECT_EQ(1, stats.num_batches);
+  EXPECT_EQ(2, stats.num_shapes_added);
+  EXPECT_EQ(0, stats.num_shapes_removed);
+  EXPECT_EQ(1002, stats.num_edges_processed);
+  EXPECT_GT(stats.num_clipped_edges, 0);
+  EXPECT_GT(stats.max_clipped_edges, 0);
+
+  // Check the cell statistics against the index itself.
+  int64 num_cells = 0, num_cells_by_face[6] = {}, max_level = 0;
+  for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    ++num_cells;
+    ++num_cells_by_face[it.id().face()];
+    max_level = std::max<int64>(max_level, it.id().level());
+  }
+  EXPECT_EQ(num_cells, stats.num_cells);
+  EXPECT_EQ(max_level, stats.max_level);
+  int64 total_by_level = 0, total_by_num_edges = 0;
+  for (int64 n : stats.num_cells_by_level) total_by_level += n;
+  for (int64 n : stats.num_cells_by_num_edges) total_by_num_edges += n;
+  EXPECT_EQ(num_cells, total_by_level);
+  EXPECT_EQ(num_cells, total_by_num_edges);
+  for (int face = 0; face < 6; ++face) {
+    EXPECT_EQ(num_cells_by_face[face], stats.num_cells_by_face[face]);
+  }
+  EXPECT_FALSE(stats.ToString().empty());
+
+  // Incremental updates are added to the existing statistics.
+  index.Release(1);
+  index.ForceBuild();
+  EXPECT_EQ(2, stats.num_updates);
+  EXPECT_EQ(1, stats.num_shapes_removed);
+  EXPECT_LT(stats.num_cells, num_cells);
+  stats.Clear();
+  EXPECT_EQ(0, stats.num_updates);
+}
+
 // A test that repeatedly updates "index_" in one thread and attempts to
 // concurrently read the index_ from several other threads.  When all threads
 // have finished reading, the first thread makes another update.
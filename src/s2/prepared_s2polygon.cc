@@ -0,0 +1,93 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/prepared_s2polygon.h"
+
+#include "s2/s2contains_point_query.h"
+#include "s2/s2region_coverer.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+
+PreparedS2Polygon::Options::Options() {
+}
+
+PreparedS2Polygon::PreparedS2Polygon() {
+}
+
+PreparedS2Polygon::PreparedS2Polygon(const S2Polygon* polygon,
+                                     const Options& options) {
+  Init(polygon, options);
+}
+
+void PreparedS2Polygon::Init(const S2Polygon* polygon,
+                             const Options& options) {
+  polygon_ = polygon;
+  S2RegionCoverer::Options coverer_options;
+  coverer_options.set_max_cells(options.max_cells());
+  coverer_options.set_max_level(options.max_level());
+  S2RegionCoverer coverer(coverer_options);
+  covering_ = coverer.GetCovering(*polygon);
+  interior_covering_ = coverer.GetInteriorCovering(*polygon);
+  index_.Clear();
+  index_.Add(make_unique<S2Polygon::Shape>(polygon));
+  index_.ForceBuild();
+}
+
+bool PreparedS2Polygon::Contains(const S2Point& p) const {
+  // The covering contains the leaf cell of every point of the polygon
+  // (including its boundary), since S2Polygon::MayIntersect() is
+  // conservative.
+  S2CellId id(p);
+  if (interior_covering_.Contains(id)) return true;
+  if (!covering_.Contains(id)) return false;
+  return MakeS2ContainsPointQuery(&index_).Contains(p);
+}
+
+bool PreparedS2Polygon::Intersects(const S2Polyline& b) const {
+  if (b.num_vertices() == 0) return false;
+  if (!polygon_->GetRectBound().Intersects(b.GetRectBound())) return false;
+  for (int i = 0; i < b.num_vertices(); ++i) {
+    if (interior_covering_.Contains(S2CellId(b.vertex(i)))) return true;
+  }
+  return polygon_->Intersects(b);
+}
+
+bool PreparedS2Polygon::Contains(const S2Polygon& b) const {
+  if (b.is_empty()) return true;
+
+  // If some vertex of "b" is not in the covering, then it is not in the
+  // closure of this polygon, and neither are the points of "b" near it.
+  for (int i = 0; i < b.num_loops(); ++i) {
+    const S2Loop& loop = *b.loop(i);
+    if (loop.is_empty_or_full()) continue;
+    for (int j = 0; j < loop.num_vertices(); ++j) {
+      if (!covering_.Contains(S2CellId(loop.vertex(j)))) return false;
+    }
+  }
+  // The index cells of "b" cover all of its points, so if they are all
+  // contained by the interior covering then so is "b".
+  bool inside = true;
+  for (MutableS2ShapeIndex::Iterator it(&b.index(), S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    if (!interior_covering_.Contains(it.id())) {
+      inside = false;
+      break;
+    }
+  }
+  if (inside) return true;
+  return polygon_->Contains(&b);
+}
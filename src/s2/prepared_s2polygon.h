@@ -0,0 +1,106 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_PREPARED_S2POLYGON_H_
+#define S2_PREPARED_S2POLYGON_H_
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+
+// PreparedS2Polygon answers repeated predicates about a fixed S2Polygon
+// (e.g. a geofence that is tested against millions of points) more quickly
+// than S2Polygon itself.  It precomputes an S2CellUnion covering of the
+// polygon and an interior covering, which settle most queries away from the
+// polygon boundary with a single lookup; only queries near the boundary fall
+// back to exact tests using an S2ShapeIndex that is built in advance.
+//
+// Example usage:
+//
+//   PreparedS2Polygon prepared(&geofence);
+//   for (const S2Point& p : points) {
+//     if (prepared.Contains(p)) ...
+//   }
+//
+// All results are identical to the corresponding S2Polygon methods.  The
+// polygon must persist and must not be modified while this object is in
+// use.  All methods are const and thread-safe.
+class PreparedS2Polygon {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The maximum number of cells in each of the two coverings.  Larger
+    // values settle more queries without exact tests, but take longer to
+    // compute and use more memory.
+    //
+    // DEFAULT: kDefaultMaxCells
+    static constexpr int kDefaultMaxCells = 512;
+    int max_cells() const { return max_cells_; }
+    void set_max_cells(int max_cells) { max_cells_ = max_cells; }
+
+    // The maximum level of the cells in the coverings.  Limiting the level
+    // bounds the time spent subdividing cells along the polygon boundary.
+    //
+    // DEFAULT: kDefaultMaxLevel
+    static constexpr int kDefaultMaxLevel = 24;
+    int max_level() const { return max_level_; }
+    void set_max_level(int max_level) { max_level_ = max_level; }
+
+   private:
+    int max_cells_ = kDefaultMaxCells;
+    int max_level_ = kDefaultMaxLevel;
+  };
+
+  // Default constructor; requires Init() to be called.
+  PreparedS2Polygon();
+
+  // Convenience constructor that calls Init().
+  explicit PreparedS2Polygon(const S2Polygon* polygon,
+                             const Options& options = Options());
+
+  // Prepares the given polygon, computing its coverings and building its
+  // index.
+  void Init(const S2Polygon* polygon, const Options& options = Options());
+
+  const S2Polygon& polygon() const { return *polygon_; }
+
+  // A covering of the polygon (every point of the polygon is contained by
+  // some cell), and a set of cells contained by the polygon.
+  const S2CellUnion& covering() const { return covering_; }
+  const S2CellUnion& interior_covering() const { return interior_covering_; }
+
+  // Equivalent to S2Polygon::Contains(const S2Point&).
+  bool Contains(const S2Point& p) const;
+
+  // Equivalent to S2Polygon::Intersects(const S2Polyline&).
+  bool Intersects(const S2Polyline& b) const;
+
+  // Equivalent to S2Polygon::Contains(const S2Polygon*).
+  bool Contains(const S2Polygon& b) const;
+
+ private:
+  const S2Polygon* polygon_ = nullptr;
+  S2CellUnion covering_;
+  S2CellUnion interior_covering_;
+  MutableS2ShapeIndex index_;
+};
+
+#endif  // S2_PREPARED_S2POLYGON_H_
@@ -0,0 +1,104 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/prepared_s2polygon.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2loop.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using s2textformat::MakePoint;
+using s2textformat::MakePolygonOrDie;
+using std::vector;
+
+namespace {
+
+TEST(PreparedS2Polygon, ContainsPointMatchesPolygon) {
+  S2Testing::rnd.Reset(1);
+  auto polygon = MakePolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 2:2, 8:2, 8:8, 2:8");
+  PreparedS2Polygon prepared(polygon.get());
+  EXPECT_FALSE(prepared.covering().empty());
+  EXPECT_FALSE(prepared.interior_covering().empty());
+  S2Cap cap(MakePoint("5:5"), S1Angle::Degrees(10));
+  for (int iter = 0; iter < 10000; ++iter) {
+    S2Point p = S2Testing::SamplePoint(cap);
+    EXPECT_EQ(polygon->Contains(p), prepared.Contains(p));
+  }
+  // Vertices are the hardest case for the semi-open boundary model.
+  for (int i = 0; i < polygon->num_loops(); ++i) {
+    for (int j = 0; j < polygon->loop(i)->num_vertices(); ++j) {
+      S2Point p = polygon->loop(i)->vertex(j);
+      EXPECT_EQ(polygon->Contains(p), prepared.Contains(p));
+    }
+  }
+}
+
+TEST(PreparedS2Polygon, IntersectsPolylineMatchesPolygon) {
+  S2Testing::rnd.Reset(2);
+  S2Polygon polygon(S2Loop::MakeRegularLoop(MakePoint("0:0"),
+                                            S1Angle::Degrees(5), 100));
+  PreparedS2Polygon prepared(&polygon);
+  S2Cap cap(MakePoint("0:0"), S1Angle::Degrees(15));
+  for (int iter = 0; iter < 200; ++iter) {
+    vector<S2Point> vertices;
+    for (int i = 0; i < 3; ++i) {
+      vertices.push_back(S2Testing::SamplePoint(cap));
+    }
+    S2Polyline polyline(vertices);
+    EXPECT_EQ(polygon.Intersects(polyline), prepared.Intersects(polyline));
+  }
+  EXPECT_FALSE(prepared.Intersects(S2Polyline()));
+}
+
+TEST(PreparedS2Polygon, ContainsPolygonMatchesPolygon) {
+  S2Testing::rnd.Reset(3);
+  S2Polygon polygon(S2Loop::MakeRegularLoop(MakePoint("0:0"),
+                                            S1Angle::Degrees(10), 100));
+  PreparedS2Polygon prepared(&polygon);
+  S2Cap cap(MakePoint("0:0"), S1Angle::Degrees(15));
+  for (int iter = 0; iter < 200; ++iter) {
+    S2Polygon b(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap),
+        S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 5)), 10));
+    EXPECT_EQ(polygon.Contains(&b), prepared.Contains(b));
+  }
+  S2Polygon empty, full(make_unique<S2Loop>(S2Loop::kFull()));
+  EXPECT_TRUE(prepared.Contains(empty));
+  EXPECT_FALSE(prepared.Contains(full));
+  EXPECT_TRUE(prepared.Contains(polygon));
+}
+
+TEST(PreparedS2Polygon, EmptyAndFull) {
+  S2Polygon empty, full(make_unique<S2Loop>(S2Loop::kFull()));
+  PreparedS2Polygon prepared_empty(&empty), prepared_full(&full);
+  S2Point p = MakePoint("1:2");
+  EXPECT_FALSE(prepared_empty.Contains(p));
+  EXPECT_TRUE(prepared_full.Contains(p));
+  EXPECT_TRUE(prepared_full.Contains(full));
+  EXPECT_FALSE(prepared_empty.Contains(full));
+}
+
+}  // namespace
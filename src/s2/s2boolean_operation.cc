@@ -70,6 +70,7 @@
 #include <utility>
 
 #include "s2/third_party/absl/memory/memory.h"
+#include "s2/mutable_s2shape_index.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
@@ -79,8 +80,10 @@
 #include "s2/s2edge_crossings.h"
 #include "s2/s2measures.h"
 #include "s2/s2predicates.h"
+#include "s2/s2query_listener.h"
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 #include "s2/util/gtl/btree_map.h"
+#include "s2/util/thread/executor.h"
 
 // TODO(ericv): Remove this debugging output at some point.
 extern bool s2builder_verbose;
@@ -113,6 +116,9 @@ using PolygonModel = S2BooleanOperation::PolygonModel;
 using PolylineModel = S2BooleanOperation::PolylineModel;
 using Precision = S2BooleanOperation::Precision;
 
+// The number of edges processed between calls to the progress callback.
+static const int kProgressInterval = 10000;
+
 // A collection of special InputEdgeIds that allow the GraphEdgeClipper state
 // modifications to be inserted into the list of edge crossings.
 static const InputEdgeId kSetInside = -1;
@@ -782,7 +788,8 @@ void EdgeClippingLayer::Build(const Graph& g, S2Error* error) {
 class S2BooleanOperation::Impl {
  public:
   explicit Impl(S2BooleanOperation* op)
-      : op_(op), index_crossings_first_region_id_(-1) {
+      : op_(op), index_crossings_first_region_id_(-1),
+        num_boundaries_started_(0), cancelled_(false) {
   }
   bool Build(S2Error* error);
 
@@ -852,10 +859,13 @@ class S2BooleanOperation::Impl {
   static bool AddIndexCrossing(const ShapeEdge& a, const ShapeEdge& b,
                                bool is_interior, IndexCrossings* crossings);
   bool GetIndexCrossings(int region_id);
+  bool GetIndexCrossingsInFace(int face, IndexCrossings* crossings) const;
   bool AddBoundaryPair(bool invert_a, bool invert_b, bool invert_result,
                        CrossingProcessor* cp);
   bool AreRegionsIdentical() const;
   bool BuildOpType(OpType op_type);
+  bool ReportBoundaryProgress(int a_shape_id, int a_num_shape_ids);
+  bool ReportProgress(double fraction);
 
   S2BooleanOperation* op_;
 
@@ -886,6 +896,12 @@ class S2BooleanOperation::Impl {
   // Temporary storage used in GetChainStarts(), declared here to avoid
   // repeatedly allocating memory.
   IndexCrossings tmp_crossings_;
+
+  // The number of calls to AddBoundary() so far, used to estimate progress.
+  int num_boundaries_started_;
+
+  // True if options_.progress_callback() has asked Build() to stop.
+  bool cancelled_;
 };
 
 const s2shapeutil::ShapeEdgeId S2BooleanOperation::Impl::kSentinel(
@@ -1702,7 +1718,11 @@ bool S2BooleanOperation::Impl::AddBoundary(
   const S2ShapeIndex& a_index = *op_->regions_[a_region_id];
   const S2ShapeIndex& b_index = *op_->regions_[1 - a_region_id];
   if (!GetIndexCrossings(a_region_id)) return false;
+  ++num_boundaries_started_;
+  const int a_num_shape_ids = a_index.num_shape_ids();
+  if (!ReportBoundaryProgress(0, a_num_shape_ids)) return false;
   cp->StartBoundary(a_region_id, invert_a, invert_b, invert_result);
+  int num_edges_processed = 0;
 
   // Walk the boundary of region A and build a list of all edge crossings.
   // We also keep track of whether the current vertex is inside region B.
@@ -1713,6 +1733,7 @@ bool S2BooleanOperation::Impl::AddBoundary(
   while (next_id != kSentinel) {
     int a_shape_id = next_id.shape_id;
     const S2Shape& a_shape = *a_index.shape(a_shape_id);
+    if (!ReportBoundaryProgress(a_shape_id, a_num_shape_ids)) return false;
     cp->StartShape(&a_shape);
     while (next_id.shape_id == a_shape_id) {
       // TODO(ericv): Special handling of dimension 0?  Can omit most of this
@@ -1731,6 +1752,10 @@ bool S2BooleanOperation::Impl::AddBoundary(
         if (!cp->ProcessEdge(a_id, &next_crossing)) {
           return false;
         }
+        if (++num_edges_processed % kProgressInterval == 0 &&
+            !ReportBoundaryProgress(a_shape_id, a_num_shape_ids)) {
+          return false;
+        }
         if (cp->inside()) {
           ++edge_id;
         } else if (next_crossing.a_id().shape_id == a_shape_id &&
@@ -1873,17 +1898,24 @@ bool S2BooleanOperation::Impl::GetIndexCrossings(int region_id) {
   if (region_id == index_crossings_first_region_id_) return true;
   if (index_crossings_first_region_id_ < 0) {
     S2_DCHECK_EQ(region_id, 0);  // For efficiency, not correctness.
-    if (!s2shapeutil::VisitCrossingEdgePairs(
-            *op_->regions_[0], *op_->regions_[1],
-            s2shapeutil::CrossingType::ALL,
-            [this](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
-              // For all supported operations (union, intersection, and
-              // difference), if the input edges have an interior crossing
-              // then the output is guaranteed to have at least one edge.
-              if (is_interior && is_boolean_output()) return false;
-              return AddIndexCrossing(a, b, is_interior, &index_crossings_);
-            })) {
-      return false;
+    if (op_->options_.executor() == nullptr) {
+      if (!GetIndexCrossingsInFace(-1, &index_crossings_)) return false;
+    } else {
+      // Each face is processed independently.  The results are concatenated
+      // and then sorted below, so they do not depend on the order in which
+      // the faces are processed.
+      IndexCrossings face_crossings[6];
+      bool face_results[6];
+      ParallelFor(op_->options_.executor(), 6, [&](int face) {
+          face_results[face] = GetIndexCrossingsInFace(face,
+                                                       &face_crossings[face]);
+        });
+      for (int face = 0; face < 6; ++face) {
+        if (!face_results[face]) return false;
+        index_crossings_.insert(index_crossings_.end(),
+                                face_crossings[face].begin(),
+                                face_crossings[face].end());
+      }
     }
     if (index_crossings_.size() > 1) {
       std::sort(index_crossings_.begin(), index_crossings_.end());
@@ -1908,6 +1940,32 @@ bool S2BooleanOperation::Impl::GetIndexCrossings(int region_id) {
   return true;
 }
 
+// Appends the crossing edge pairs found in the given cube face (or in all
+// faces if "face" is -1) to "crossings".  This method may be called
+// concurrently for different faces.
+//
+// Supports "early exit" in the case of boolean results by returning false
+// as soon as the result is known to be non-empty.
+bool S2BooleanOperation::Impl::GetIndexCrossingsInFace(
+    int face, IndexCrossings* crossings) const {
+  auto visitor = [this, crossings](const ShapeEdge& a, const ShapeEdge& b,
+                                   bool is_interior) {
+    // For all supported operations (union, intersection, and difference), if
+    // the input edges have an interior crossing then the output is guaranteed
+    // to have at least one edge.
+    if (is_interior && is_boolean_output()) return false;
+    return AddIndexCrossing(a, b, is_interior, crossings);
+  };
+  const S2ShapeIndex& a = *op_->regions_[0];
+  const S2ShapeIndex& b = *op_->regions_[1];
+  if (face < 0) {
+    return s2shapeutil::VisitCrossingEdgePairs(
+        a, b, s2shapeutil::CrossingType::ALL, visitor);
+  }
+  return s2shapeutil::VisitCrossingEdgePairs(
+      a, b, face, s2shapeutil::CrossingType::ALL, visitor);
+}
+
 // Supports "early exit" in the case of boolean results by returning false
 // as soon as the result is known to be non-empty.
 bool S2BooleanOperation::Impl::AddBoundaryPair(
@@ -1935,6 +1993,30 @@ bool S2BooleanOperation::Impl::AddBoundaryPair(
   return true;
 }
 
+// Reports progress after processing the first "a_shape_id" shapes of the
+// boundary that is currently being added.  Returns false if the operation
+// has been cancelled.
+bool S2BooleanOperation::Impl::ReportBoundaryProgress(int a_shape_id,
+                                                      int a_num_shape_ids) {
+  // Each boundary is considered to be an equal share of the clipping phase,
+  // which is in turn considered to be half of the work when S2Builder is
+  // used to construct the output.
+  const int num_boundaries =
+      (op_->op_type() == OpType::SYMMETRIC_DIFFERENCE) ? 4 : 2;
+  double fraction = num_boundaries_started_ - 1;
+  if (a_num_shape_ids > 0) fraction += a_shape_id / double{a_num_shape_ids};
+  fraction /= num_boundaries;
+  return ReportProgress(is_boolean_output() ? fraction : 0.5 * fraction);
+}
+
+// Calls the progress callback (if any) with the given fraction of the total
+// work completed, and returns false if the operation has been cancelled.
+bool S2BooleanOperation::Impl::ReportProgress(double fraction) {
+  const auto& callback = op_->options_.progress_callback();
+  if (!cancelled_ && callback && !callback(fraction)) cancelled_ = true;
+  return !cancelled_;
+}
+
 // Supports "early exit" in the case of boolean results by returning false
 // as soon as the result is known to be non-empty.
 bool S2BooleanOperation::Impl::BuildOpType(OpType op_type) {
@@ -2016,22 +2098,45 @@ bool S2BooleanOperation::Impl::AreRegionsIdentical() const {
 
 bool S2BooleanOperation::Impl::Build(S2Error* error) {
   error->Clear();
+  // Clear the state from any previous call, retaining allocated storage.
+  input_dimensions_.clear();
+  input_crossings_.clear();
+  index_crossings_.clear();
+  index_crossings_first_region_id_ = -1;
+  num_boundaries_started_ = 0;
+  cancelled_ = false;
   if (is_boolean_output()) {
     // BuildOpType() returns true if and only if the result is empty.
-    *op_->result_empty_ = BuildOpType(op_->op_type());
+    bool result_empty = BuildOpType(op_->op_type());
+    if (cancelled_) {
+      error->Init(S2Error::CANCELLED, "S2BooleanOperation was cancelled");
+      return false;
+    }
+    *op_->result_empty_ = result_empty;
     return true;
   }
   // TODO(ericv): Rather than having S2Builder split the edges, it would be
   // faster to call AddVertex() in this class and have a new S2Builder
   // option that increases the edge_snap_radius_ to account for errors in
   // the intersection point (the way that split_crossing_edges does).
-  S2Builder::Options options(op_->options_.snap_function());
-  options.set_split_crossing_edges(true);
-
-  // TODO(ericv): Ideally idempotent() should be true, but existing clients
-  // expect vertices closer than the full "snap_radius" to be snapped.
-  options.set_idempotent(false);
-  builder_ = make_unique<S2Builder>(options);
+  if (builder_ == nullptr) {
+    S2Builder::Options options(op_->options_.snap_function());
+    options.set_split_crossing_edges(true);
+
+    // TODO(ericv): Ideally idempotent() should be true, but existing clients
+    // expect vertices closer than the full "snap_radius" to be snapped.
+    options.set_idempotent(false);
+
+    // The second half of the progress range is reported by S2Builder.  If
+    // the operation was already cancelled, S2Builder::Build() stops
+    // immediately (which also discards the edges added so far).
+    if (op_->options_.progress_callback()) {
+      options.set_progress_callback([this](double fraction) {
+          return ReportProgress(0.5 + 0.5 * fraction);
+        });
+    }
+    builder_ = make_unique<S2Builder>(options);
+  }
   builder_->StartLayer(make_unique<EdgeClippingLayer>(
       &op_->layers_, &input_dimensions_, &input_crossings_));
 
@@ -2062,7 +2167,9 @@ S2BooleanOperation::Options::Options(const Options& options)
        polyline_loops_have_boundaries_(options.polyline_loops_have_boundaries_),
        precision_(options.precision_),
        conservative_output_(options.conservative_output_),
-       source_id_lexicon_(options.source_id_lexicon_) {
+       source_id_lexicon_(options.source_id_lexicon_),
+       executor_(options.executor_),
+       progress_callback_(options.progress_callback_) {
 }
 
 S2BooleanOperation::Options& S2BooleanOperation::Options::operator=(
@@ -2074,6 +2181,8 @@ S2BooleanOperation::Options& S2BooleanOperation::Options::operator=(
   precision_ = options.precision_;
   conservative_output_ = options.conservative_output_;
   source_id_lexicon_ = options.source_id_lexicon_;
+  executor_ = options.executor_;
+  progress_callback_ = options.progress_callback_;
   return *this;
 }
 
@@ -2124,6 +2233,24 @@ S2BooleanOperation::Options::source_id_lexicon() const {
   return source_id_lexicon_;
 }
 
+Executor* S2BooleanOperation::Options::executor() const {
+  return executor_;
+}
+
+void S2BooleanOperation::Options::set_executor(Executor* executor) {
+  executor_ = executor;
+}
+
+const S2Builder::ProgressCallback&
+S2BooleanOperation::Options::progress_callback() const {
+  return progress_callback_;
+}
+
+void S2BooleanOperation::Options::set_progress_callback(
+    S2Builder::ProgressCallback progress_callback) {
+  progress_callback_ = std::move(progress_callback);
+}
+
 const char* S2BooleanOperation::OpTypeToString(OpType op_type) {
   switch (op_type) {
     case OpType::UNION:                return "UNION";
@@ -2158,21 +2285,76 @@ S2BooleanOperation::S2BooleanOperation(
       result_empty_(nullptr) {
 }
 
+S2BooleanOperation::~S2BooleanOperation() {
+}
+
 bool S2BooleanOperation::Build(const S2ShapeIndex& a,
                                const S2ShapeIndex& b,
                                S2Error* error) {
+  S2QueryTimer timer(S2QueryListener::Operation::BOOLEAN_OPERATION);
   regions_[0] = &a;
   regions_[1] = &b;
-  return Impl(this).Build(error);
+  if (impl_ == nullptr) impl_ = make_unique<Impl>(this);
+  return impl_->Build(error);
+}
+
+// Returns true if some cell of index "a" intersects some cell of index "b".
+// Since the cells of an index cover all of its geometry (including points
+// near cell boundaries, due to the padding used when clipping edges), the
+// geometry of "a" and "b" is disjoint whenever this function returns false.
+static bool IndexCellsIntersect(const S2ShapeIndex& a, const S2ShapeIndex& b) {
+  S2ShapeIndex::Iterator ai(&a, S2ShapeIndex::BEGIN);
+  S2ShapeIndex::Iterator bi(&b, S2ShapeIndex::BEGIN);
+  while (!ai.done() && !bi.done()) {
+    if (ai.id().range_max() < bi.id().range_min()) {
+      // Advance "ai" to the first cell that ends at or after the start of
+      // the current "b" cell.
+      S2CellId target = bi.id().range_min();
+      ai.Seek(target);
+      if (ai.Prev() && ai.id().range_max() < target) ai.Next();
+    } else if (bi.id().range_max() < ai.id().range_min()) {
+      S2CellId target = ai.id().range_min();
+      bi.Seek(target);
+      if (bi.Prev() && bi.id().range_max() < target) bi.Next();
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool IndexIsEmpty(const S2ShapeIndex& index) {
+  return S2ShapeIndex::Iterator(&index, S2ShapeIndex::BEGIN).done();
 }
 
 bool S2BooleanOperation::IsEmpty(
     OpType op_type, const S2ShapeIndex& a, const S2ShapeIndex& b,
     const Options& options) {
-  bool result_empty;
+  // Predicates are often evaluated on regions that are far apart.  If the
+  // index cells of "a" and "b" are disjoint then so are the regions, and the
+  // result can be determined without computing any crossings.
+  if (!IndexCellsIntersect(a, b)) {
+    MutableS2ShapeIndex empty;
+    switch (op_type) {
+      case OpType::INTERSECTION:
+        return true;
+      case OpType::DIFFERENCE:
+        // A - B == A - {}.  (The general case below handles B == {}.)
+        if (IndexIsEmpty(a)) return true;
+        if (!IndexIsEmpty(b)) return IsEmpty(op_type, a, empty, options);
+        break;
+      case OpType::UNION:
+      case OpType::SYMMETRIC_DIFFERENCE:
+        return (IndexIsEmpty(a) ||
+                IsEmpty(OpType::DIFFERENCE, a, empty, options)) &&
+               (IndexIsEmpty(b) ||
+                IsEmpty(OpType::DIFFERENCE, b, empty, options));
+    }
+  }
+  bool result_empty = false;
   S2BooleanOperation op(op_type, &result_empty, options);
   S2Error error;
   op.Build(a, b, &error);
-  S2_DCHECK(error.ok());
+  S2_DCHECK(error.ok() || error.code() == S2Error::CANCELLED);
   return result_empty;
 }
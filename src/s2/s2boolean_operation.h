@@ -26,6 +26,8 @@
 #include "s2/s2builder_layer.h"
 #include "s2/value_lexicon.h"
 
+class Executor;
+
 // This class implements boolean operations (intersection, union, difference,
 // and symmetric difference) for regions whose boundaries are defined by
 // geodesic edges.
@@ -367,6 +369,29 @@ class S2BooleanOperation {
     ValueLexicon<SourceId>* source_id_lexicon() const;
     // void set_source_id_lexicon(ValueLexicon<SourceId>* source_id_lexicon);
 
+    // If non-null, the search for crossing edge pairs between the two input
+    // regions (typically the most expensive step for large inputs) is split
+    // by cube face and run concurrently using the given executor.  The
+    // result of the operation is exactly the same as without an executor.
+    // The executor must outlive the S2BooleanOperation.
+    //
+    // DEFAULT: nullptr
+    Executor* executor() const;
+    void set_executor(Executor* executor);
+
+    // If non-empty, this function is called periodically while the input
+    // boundaries are clipped against each other and while the output is
+    // built, with the approximate fraction of the work completed so far.  If
+    // it returns false, Build() stops as soon as possible and returns false
+    // with the error code S2Error::CANCELLED.  (See
+    // S2Builder::ProgressCallback for details.)  The static predicates such
+    // as IsEmpty() cannot report cancellation; if cancelled, they return
+    // false.
+    //
+    // DEFAULT: empty
+    const S2Builder::ProgressCallback& progress_callback() const;
+    void set_progress_callback(S2Builder::ProgressCallback progress_callback);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -379,6 +404,8 @@ class S2BooleanOperation {
     Precision precision_ = Precision::EXACT;
     bool conservative_output_ = false;
     ValueLexicon<SourceId>* source_id_lexicon_ = nullptr;
+    Executor* executor_ = nullptr;
+    S2Builder::ProgressCallback progress_callback_;
   };
 
   S2BooleanOperation(OpType op_type,
@@ -407,11 +434,21 @@ class S2BooleanOperation {
                      std::vector<std::unique_ptr<S2Builder::Layer>> layers,
                      const Options& options = Options());
 
+  ~S2BooleanOperation();
+
   OpType op_type() const { return op_type_; }
 
   // Executes the given operation.  Returns true on success, and otherwise
   // sets "error" appropriately.  (This class does not generate any errors
   // itself, but the S2Builder::Layer might.)
+  //
+  // Build() may be called any number of times with different inputs; each
+  // call sends its result to the output layers.  The S2Builder and all
+  // temporary storage are retained between calls, so it is much faster to
+  // reuse one S2BooleanOperation than to construct one per pair of inputs.
+  // Similarly, when many regions are combined with a fixed region (e.g.
+  // clipping against a mask), the fixed region's index should be built once
+  // and passed to every call.
   bool Build(const S2ShapeIndex& a, const S2ShapeIndex& b,
              S2Error* error);
 
@@ -465,6 +502,9 @@ class S2BooleanOperation {
 
   // The following field is set if and only if there are no output layers.
   bool* result_empty_;
+
+  // The implementation, which is retained between calls to Build().
+  std::unique_ptr<Impl> impl_;
 };
 
 
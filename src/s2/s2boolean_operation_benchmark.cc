@@ -0,0 +1,92 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for S2BooleanOperation.
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using OpType = S2BooleanOperation::OpType;
+
+namespace {
+
+// Benchmarks the given operation on two overlapping fractal loops, each with
+// approximately "num_edges" edges.
+void BenchmarkOperation(OpType op_type, int num_edges,
+                        benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(num_edges);
+  S2Point center = S2Testing::RandomPoint();
+  auto frame = S2Testing::GetRandomFrameAt(center);
+  MutableS2ShapeIndex a, b;
+  a.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S2Testing::KmToAngle(100))));
+  frame = S2Testing::GetRandomFrameAt(
+      (center + 0.5 * S2Testing::KmToAngle(100).radians() * frame.Col(0))
+      .Normalize());
+  b.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S2Testing::KmToAngle(100))));
+  a.ForceBuild();
+  b.ForceBuild();
+  for (auto _ : state) {
+    S2Polygon result;
+    S2BooleanOperation op(
+        op_type, make_unique<s2builderutil::S2PolygonLayer>(&result));
+    S2Error error;
+    if (!op.Build(a, b, &error)) state.SkipWithError(error.text().c_str());
+  }
+}
+
+void BM_Union(benchmark::State& state) {
+  BenchmarkOperation(OpType::UNION, state.range(0), state);
+}
+BENCHMARK(BM_Union)->Arg(100)->Arg(10000);
+
+void BM_Intersection(benchmark::State& state) {
+  BenchmarkOperation(OpType::INTERSECTION, state.range(0), state);
+}
+BENCHMARK(BM_Intersection)->Arg(100)->Arg(10000);
+
+void BM_Intersects(benchmark::State& state) {
+  S2Testing::rnd.Reset(2);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(state.range(0));
+  S2Point center = S2Testing::RandomPoint();
+  MutableS2ShapeIndex a, b;
+  a.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      S2Testing::GetRandomFrameAt(center), S2Testing::KmToAngle(100))));
+  b.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      S2Testing::GetRandomFrameAt(center), S2Testing::KmToAngle(50))));
+  a.ForceBuild();
+  b.ForceBuild();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(S2BooleanOperation::Intersects(a, b));
+  }
+}
+BENCHMARK(BM_Intersects)->Arg(100)->Arg(10000);
+
+}  // namespace
@@ -18,16 +18,23 @@
 #include "s2/s2boolean_operation.h"
 
 #include <memory>
+#include <thread>
 #include <gtest/gtest.h>
+#include "s2/base/mutex.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/strings/str_split.h"
 #include "s2/third_party/absl/strings/strip.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cap.h"
+#include "s2/s2loop.h"
 #include "s2/s2polygon.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 namespace {
 
@@ -1044,3 +1051,151 @@ TEST(S2BooleanOperation, PolylineCrossingRectangleTwice) {
       "# 0:-5, 0:-1 | 0:1, 0:5, 5:0, 1:0 | -1:0, -5:0 "
       "# 1:1, 1:0, 1:-1, 0:-1, -1:-1, -1:0, -1:1, 0:1");
 }
+
+namespace {
+
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 6; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+}  // namespace
+
+TEST(S2BooleanOperation, ExecutorGivesIdenticalResults) {
+  // Each input is a large loop that spans several cube faces.
+  MutableS2ShapeIndex a, b;
+  a.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 1, 1).Normalize(), S1Angle::Degrees(80), 1000)));
+  b.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(-1, 1, 0.5).Normalize(), S1Angle::Degrees(70), 1000)));
+  ThreadPerTaskExecutor executor;
+  for (auto op_type : {OpType::UNION, OpType::INTERSECTION,
+                       OpType::DIFFERENCE, OpType::SYMMETRIC_DIFFERENCE}) {
+    S2BooleanOperation::Options options;
+    S2Polygon serial, parallel;
+    S2Error error;
+    S2BooleanOperation serial_op(
+        op_type, make_unique<s2builderutil::S2PolygonLayer>(&serial),
+        options);
+    ASSERT_TRUE(serial_op.Build(a, b, &error)) << error;
+    options.set_executor(&executor);
+    S2BooleanOperation parallel_op(
+        op_type, make_unique<s2builderutil::S2PolygonLayer>(&parallel),
+        options);
+    ASSERT_TRUE(parallel_op.Build(a, b, &error)) << error;
+    EXPECT_TRUE(serial.Equals(&parallel))
+        << S2BooleanOperation::OpTypeToString(op_type);
+    EXPECT_EQ(S2BooleanOperation::IsEmpty(op_type, a, b),
+              S2BooleanOperation::IsEmpty(op_type, a, b, options));
+  }
+}
+
+TEST(S2BooleanOperation, PredicatesOnDisjointIndexCells) {
+  // Exercises the fast path used when the index cells of the two regions do
+  // not intersect.
+  auto a = s2textformat::MakeIndex("# # 0:0, 0:1, 1:0");
+  auto b = s2textformat::MakeIndex("# # 10:10, 10:11, 11:10");
+  auto empty = s2textformat::MakeIndex("# #");
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*a, *b));
+  EXPECT_FALSE(S2BooleanOperation::Contains(*a, *b));
+  EXPECT_FALSE(S2BooleanOperation::Equals(*a, *b));
+  EXPECT_TRUE(S2BooleanOperation::Contains(*a, *empty));
+  EXPECT_FALSE(S2BooleanOperation::Contains(*empty, *a));
+  EXPECT_FALSE(S2BooleanOperation::Equals(*a, *empty));
+  EXPECT_TRUE(S2BooleanOperation::Equals(*empty, *empty));
+  EXPECT_FALSE(S2BooleanOperation::IsEmpty(OpType::UNION, *a, *b));
+
+  // Geometry that touches only at a point on a cube face boundary (where
+  // adjacent index cells meet) must still be found to intersect.
+  auto point = s2textformat::MakeIndex("0:45 # #");
+  auto polyline = s2textformat::MakeIndex("# 0:40, 0:45 #");
+  auto polygon = s2textformat::MakeIndex("# # 0:45, 1:46, -1:46");
+  S2BooleanOperation::Options options;
+  options.set_polygon_model(PolygonModel::CLOSED);
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*point, *polyline));
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*polyline, *polygon, options));
+  EXPECT_TRUE(S2BooleanOperation::Contains(*polygon, *point, options));
+}
+
+TEST(S2BooleanOperation, ReusedOperationGivesIdenticalResults) {
+  // Clips several polygons against a fixed mask using one operation.
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex mask;
+  mask.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(10), 100)));
+  S2Polygon reused_output;
+  S2BooleanOperation reused_op(
+      OpType::INTERSECTION,
+      make_unique<s2builderutil::S2PolygonLayer>(&reused_output));
+  for (int iter = 0; iter < 10; ++iter) {
+    MutableS2ShapeIndex input;
+    input.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(S2Cap(S2Point(1, 0, 0), S1Angle::Degrees(15))),
+        S1Angle::Degrees(5), 20)));
+    S2Error error;
+    S2Polygon expected;
+    S2BooleanOperation op(
+        OpType::INTERSECTION,
+        make_unique<s2builderutil::S2PolygonLayer>(&expected));
+    ASSERT_TRUE(op.Build(input, mask, &error)) << error;
+    ASSERT_TRUE(reused_op.Build(input, mask, &error)) << error;
+    EXPECT_TRUE(expected.Equals(&reused_output));
+  }
+}
+
+TEST(S2BooleanOperation, ProgressCallbackCanCancel) {
+  MutableS2ShapeIndex a, b;
+  a.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(10), 1000)));
+  b.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0.1, 0).Normalize(), S1Angle::Degrees(10), 1000)));
+
+  // Progress is reported in increasing order, and the operation completes
+  // normally when the callback never cancels it.
+  vector<double> fractions;
+  S2BooleanOperation::Options options;
+  options.set_progress_callback([&fractions](double fraction) {
+      fractions.push_back(fraction);
+      return true;
+    });
+  S2Polygon output;
+  S2Error error;
+  S2BooleanOperation op(OpType::UNION,
+                        make_unique<s2builderutil::S2PolygonLayer>(&output),
+                        options);
+  ASSERT_TRUE(op.Build(a, b, &error)) << error;
+  EXPECT_FALSE(output.is_empty());
+  ASSERT_FALSE(fractions.empty());
+  EXPECT_TRUE(std::is_sorted(fractions.begin(), fractions.end()));
+  EXPECT_GE(fractions.front(), 0);
+  EXPECT_LE(fractions.back(), 1);
+
+  // Cancelling at any point (either while clipping the boundaries or while
+  // building the output) yields S2Error::CANCELLED.
+  for (int cancel_at : {0, static_cast<int>(fractions.size()) - 1}) {
+    int num_calls = 0;
+    options.set_progress_callback([&num_calls, cancel_at](double fraction) {
+        return num_calls++ < cancel_at;
+      });
+    S2Polygon cancelled_output;
+    S2BooleanOperation cancelled_op(
+        OpType::UNION,
+        make_unique<s2builderutil::S2PolygonLayer>(&cancelled_output),
+        options);
+    EXPECT_FALSE(cancelled_op.Build(a, b, &error));
+    EXPECT_EQ(S2Error::CANCELLED, error.code());
+    EXPECT_EQ(cancel_at + 1, num_calls);
+  }
+}
@@ -0,0 +1,201 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2buffer_operation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "s2/base/logging.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2loop.h"
+#include "s2/s2pointutil.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using s2builderutil::IdentitySnapFunction;
+using std::max;
+using std::unique_ptr;
+using std::vector;
+
+// The bands and discs are tessellated by placing vertices at distance "r"
+// from the input and connecting them with geodesics, which bulge outward.
+// Two vertices at distance "r" that are separated by an angle of 2*h as
+// seen from the input (either the center of a disc or the edge of a band)
+// are connected by a geodesic whose midpoint is at distance
+// atan(tan(r) / cos(h)).  This function returns the maximum "h" such that
+// this distance is at most r + max_error.
+static double GetMaxHalfAngle(double r, double max_error) {
+  return std::acos(std::tan(r) / std::tan(r + max_error));
+}
+
+S2BufferOperation::Options::Options()
+    : radius_(S1Angle::Zero()), max_error_(S1Angle::Infinity()),
+      executor_(nullptr) {
+}
+
+S2BufferOperation::Options::Options(S1Angle radius) : Options() {
+  radius_ = radius;
+}
+
+S1Angle S2BufferOperation::Options::max_error() const {
+  if (max_error_ == S1Angle::Infinity()) return 0.01 * radius_.abs();
+  return max_error_;
+}
+
+S2BufferOperation::S2BufferOperation(const Options& options)
+    : options_(options) {
+}
+
+// Returns a disc of radius "r" around "center", tessellated using the given
+// maximum half-angle (see above).  The disc is a regular polygon whose edge
+// midpoints are at distance "r" from the center.
+static unique_ptr<S2Polygon> MakeDisc(const S2Point& center, double r,
+                                      double h) {
+  int num_vertices = max(3, static_cast<int>(std::ceil(M_PI / h)));
+  S1Angle vertex_radius = S1Angle::Radians(
+      std::atan(std::tan(r) / std::cos(M_PI / num_vertices)));
+  return make_unique<S2Polygon>(
+      S2Loop::MakeRegularLoop(center, vertex_radius, num_vertices));
+}
+
+void S2BufferOperation::AddEdgeBuffers(
+    const S2Shape& shape, const vector<int>& edge_ids, S1Angle radius,
+    vector<unique_ptr<S2Polygon>>* polygons) const {
+  const double r = radius.radians();
+  const double h = GetMaxHalfAngle(r, options_.max_error().radians());
+  const double cos_r = std::cos(r), sin_r = std::sin(r);
+  vector<S2Point> points, band;
+  for (int e : edge_ids) {
+    S2Shape::Edge edge = shape.edge(e);
+    if (shape.dimension() == 2) {
+      polygons->push_back(MakeDisc(edge.v0, r, h));
+    } else {
+      // Polylines also need a disc at the last vertex of each chain.
+      if (shape.chain_position(e).offset == 0) {
+        polygons->push_back(MakeDisc(edge.v0, r, h));
+      }
+      polygons->push_back(MakeDisc(edge.v1, r, h));
+    }
+    // Edges shorter than the snap radius used by the union need no band,
+    // since the discs at their endpoints cover the band to within the
+    // snapping error.
+    double length = edge.v0.Angle(edge.v1);
+    if (length < S2::kIntersectionMergeRadius.radians()) continue;
+
+    // The band consists of the points at distance "r" on the right side of
+    // the edge (from v0 to v1), followed by the points at distance "r" on the
+    // left side (from v1 to v0).
+    S2Point n = S2::RobustCrossProd(edge.v0, edge.v1).Normalize();
+    int num_segments = max(1, static_cast<int>(std::ceil(length / (2 * h))));
+    points.clear();
+    points.push_back(edge.v0);
+    for (int i = 1; i < num_segments; ++i) {
+      points.push_back(S2::Interpolate(static_cast<double>(i) / num_segments,
+                                       edge.v0, edge.v1));
+    }
+    points.push_back(edge.v1);
+    band.clear();
+    for (int i = 0; i <= num_segments; ++i) {
+      band.push_back((cos_r * points[i] - sin_r * n).Normalize());
+    }
+    for (int i = num_segments; i >= 0; --i) {
+      band.push_back((cos_r * points[i] + sin_r * n).Normalize());
+    }
+    polygons->push_back(make_unique<S2Polygon>(make_unique<S2Loop>(band)));
+  }
+}
+
+void S2BufferOperation::BufferIndex(const MutableS2ShapeIndex& index,
+                                    const S2Polygon* polygon, S1Angle radius,
+                                    S2Polygon* output) const {
+  // Divide the edges into batches, where each batch consists of the edges of
+  // one index cell that have not already been assigned to a batch.
+  const S2Shape& shape = *index.shape(0);
+  vector<bool> assigned(shape.num_edges(), false);
+  vector<vector<int>> batches;
+  for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    const S2ClippedShape* clipped = it.cell().find_clipped(0);
+    if (clipped == nullptr) continue;
+    vector<int> batch;
+    for (int j = 0; j < clipped->num_edges(); ++j) {
+      int e = clipped->edge(j);
+      if (assigned[e]) continue;
+      assigned[e] = true;
+      batch.push_back(e);
+    }
+    if (!batch.empty()) batches.push_back(std::move(batch));
+  }
+  // The buffers of each batch are unioned first, so that the final union
+  // combines a small number of polygons that are mostly disjoint.
+  IdentitySnapFunction snap_function(S2::kIntersectionMergeRadius);
+  vector<unique_ptr<S2Polygon>> pieces(batches.size());
+  ParallelFor(options_.executor(), batches.size(), [&](int i) {
+      vector<unique_ptr<S2Polygon>> polygons;
+      AddEdgeBuffers(shape, batches[i], radius, &polygons);
+      pieces[i] = S2Polygon::DestructiveUnion(std::move(polygons),
+                                              snap_function);
+    });
+  if (polygon != nullptr) {
+    pieces.push_back(make_unique<S2Polygon>());
+    pieces.back()->Copy(polygon);
+  }
+  unique_ptr<S2Polygon> result = S2Polygon::DestructiveUnion(
+      std::move(pieces), snap_function, options_.executor());
+  output->Copy(result.get());
+}
+
+void S2BufferOperation::Buffer(const S2Polygon& polygon,
+                               S2Polygon* output) const {
+  S1Angle radius = options_.radius();
+  S2_DCHECK_LT(radius.abs() + options_.max_error(),
+               S1Angle::Degrees(90));
+  if (radius == S1Angle::Zero() || polygon.num_vertices() == 0) {
+    output->Copy(&polygon);
+  } else if (radius > S1Angle::Zero()) {
+    BufferIndex(polygon.index(), &polygon, radius, output);
+  } else {
+    // Shrinking a polygon is equivalent to growing its complement.
+    S2Polygon complement;
+    complement.InitToComplement(&polygon);
+    BufferIndex(complement.index(), &complement, -radius, output);
+    output->Invert();
+  }
+}
+
+void S2BufferOperation::Buffer(const S2Polyline& polyline,
+                               S2Polygon* output) const {
+  S1Angle radius = options_.radius();
+  S2_DCHECK_GE(radius, S1Angle::Zero());
+  S2_DCHECK_LT(radius + options_.max_error(), S1Angle::Degrees(90));
+  if (radius <= S1Angle::Zero() || polyline.num_vertices() == 0) {
+    output->InitNested(vector<unique_ptr<S2Loop>>());
+  } else if (polyline.num_vertices() == 1) {
+    // A polyline with one vertex has no edges, so we buffer it as a point.
+    double r = radius.radians();
+    output->Copy(MakeDisc(polyline.vertex(0), r,
+                          GetMaxHalfAngle(r, options_.max_error().radians()))
+                 .get());
+  } else {
+    MutableS2ShapeIndex index;
+    index.Add(make_unique<S2Polyline::Shape>(&polyline));
+    BufferIndex(index, nullptr, radius, output);
+  }
+}
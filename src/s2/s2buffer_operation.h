@@ -0,0 +1,125 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2BUFFER_OPERATION_H_
+#define S2_S2BUFFER_OPERATION_H_
+
+#include <memory>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+
+class Executor;
+
+// S2BufferOperation computes the buffer (offset) of an S2Polygon or
+// S2Polyline by a given radius, i.e. the region consisting of all points
+// within the radius of the input.  Unlike covering an
+// S2ShapeIndexBufferedRegion, the result is a polygon whose boundary follows
+// the true buffer boundary to within a given tolerance, with rounded joins
+// at the input vertices.
+//
+// The buffer is computed as the union of the input polygon (if any) with
+// one "band" per input edge (the points within the radius of the edge's
+// interior) and one disc per input vertex.  The bands and discs are
+// tessellated so that they contain the exact buffer, and so that their
+// boundaries are within max_error() of it.  The edges are processed in
+// batches consisting of the edges of each S2ShapeIndex cell, and the batches
+// are unioned using S2Polygon's cascaded union.  This keeps the
+// intermediate polygons small, and allows the batches to be processed
+// concurrently when an executor is given.
+//
+// Example usage:
+//
+//   S2BufferOperation::Options options(S1Angle::Degrees(0.1));
+//   S2BufferOperation op(options);
+//   S2Polygon buffered;
+//   op.Buffer(polygon, &buffered);
+class S2BufferOperation {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // Convenience constructor that sets the buffer radius.
+    explicit Options(S1Angle radius);
+
+    // The buffer radius.  Polygons may be buffered by a negative radius,
+    // which shrinks them (i.e., it removes all points within the given
+    // distance of the polygon's boundary).  Polylines require a
+    // non-negative radius.
+    //
+    // REQUIRES: |radius| + max_error < 90 degrees
+    //
+    // DEFAULT: 0
+    S1Angle radius() const { return radius_; }
+    void set_radius(S1Angle radius) { radius_ = radius; }
+
+    // The maximum distance between the boundary of the output polygon and
+    // the boundary of the exact buffer.  The output always contains the
+    // exact buffer (or for negative radii, is always contained by it), so
+    // this error is only in the outward direction.  Smaller values produce
+    // more vertices, since the number of vertices used for each round join
+    // is proportional to sqrt(|radius| / max_error).
+    //
+    // DEFAULT: 1% of the radius.
+    S1Angle max_error() const;
+    void set_max_error(S1Angle max_error) { max_error_ = max_error; }
+
+    // If not nullptr, the edge batches are processed concurrently using
+    // the given executor.  The result does not depend on whether an
+    // executor is used.
+    //
+    // DEFAULT: nullptr
+    Executor* executor() const { return executor_; }
+    void set_executor(Executor* executor) { executor_ = executor; }
+
+   private:
+    S1Angle radius_;
+    S1Angle max_error_;
+    Executor* executor_;
+  };
+
+  S2BufferOperation() = default;
+  explicit S2BufferOperation(const Options& options);
+
+  const Options& options() const { return options_; }
+  Options* mutable_options() { return &options_; }
+
+  // Sets "output" to the given polygon buffered by options().radius().
+  void Buffer(const S2Polygon& polygon, S2Polygon* output) const;
+
+  // Sets "output" to the given polyline buffered by options().radius().
+  // REQUIRES: options().radius() >= S1Angle::Zero()
+  void Buffer(const S2Polyline& polyline, S2Polygon* output) const;
+
+ private:
+  // Computes the union of "polygon" (which may be nullptr) and the bands and
+  // discs for the edges of the given index, which contains a single shape of
+  // dimension 1 or 2, using the given non-negative radius.
+  void BufferIndex(const MutableS2ShapeIndex& index, const S2Polygon* polygon,
+                   S1Angle radius, S2Polygon* output) const;
+
+  // Appends the bands and discs for the edges of "shape" with the given ids.
+  void AddEdgeBuffers(const S2Shape& shape, const std::vector<int>& edge_ids,
+                      S1Angle radius,
+                      std::vector<std::unique_ptr<S2Polygon>>* polygons) const;
+
+  Options options_;
+};
+
+#endif  // S2_S2BUFFER_OPERATION_H_
@@ -0,0 +1,197 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2buffer_operation.h"
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using s2textformat::MakePolygonOrDie;
+using s2textformat::MakePolylineOrDie;
+using std::vector;
+
+namespace {
+
+// Checks that "output" contains every point within "radius" of the
+// geometry in "index", and no point farther than "radius + max_error" (plus
+// a small tolerance for the snapping done by the union).  If "negative" is
+// true, the output should instead consist of the points of the index's
+// polygon that are farther than "radius" from its boundary.
+void CheckBuffer(const MutableS2ShapeIndex& index, S1Angle radius,
+                 S1Angle max_error, const S2Polygon& output,
+                 bool negative = false) {
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_include_interiors(!negative);
+  const S2Shape& shape = *index.shape(0);
+  S2Cap bound = S2Cap::FromPoint(shape.edge(0).v0);
+  for (int i = 0; i < shape.num_edges(); ++i) {
+    bound.AddPoint(shape.edge(i).v1);
+  }
+  bound = bound.Expanded(2 * radius.abs());
+  S2ContainsPointQuery<MutableS2ShapeIndex> contains_query(&index);
+  const S1Angle kSlop = S1Angle::Radians(1e-13);
+  for (int iter = 0; iter < 2000; ++iter) {
+    S2Point p = S2Testing::SamplePoint(bound);
+    S2ClosestEdgeQuery::PointTarget target(p);
+    S1Angle d = query.GetDistance(&target).ToAngle();
+    if (!negative) {
+      if (d <= radius - kSlop) {
+        EXPECT_TRUE(output.Contains(p)) << d << " " << radius;
+      } else if (d >= radius + max_error + kSlop) {
+        EXPECT_FALSE(output.Contains(p)) << d << " " << radius;
+      }
+    } else {
+      if (!contains_query.Contains(p) || d <= radius.abs() - kSlop) {
+        EXPECT_FALSE(output.Contains(p)) << d << " " << radius;
+      } else if (d >= radius.abs() + max_error + kSlop) {
+        EXPECT_TRUE(output.Contains(p)) << d << " " << radius;
+      }
+    }
+  }
+}
+
+TEST(S2BufferOperation, ZeroRadius) {
+  auto polygon = MakePolygonOrDie("0:0, 0:10, 10:0");
+  S2BufferOperation op;
+  S2Polygon output;
+  op.Buffer(*polygon, &output);
+  EXPECT_TRUE(output.Equals(polygon.get()));
+  op.Buffer(*MakePolylineOrDie("0:0, 0:10"), &output);
+  EXPECT_TRUE(output.is_empty());
+}
+
+TEST(S2BufferOperation, EmptyAndFull) {
+  S2BufferOperation op(S2BufferOperation::Options(S1Angle::Degrees(1)));
+  S2Polygon empty, full(make_unique<S2Loop>(S2Loop::kFull())), output;
+  op.Buffer(empty, &output);
+  EXPECT_TRUE(output.is_empty());
+  op.Buffer(full, &output);
+  EXPECT_TRUE(output.is_full());
+  op.mutable_options()->set_radius(S1Angle::Degrees(-1));
+  op.Buffer(full, &output);
+  EXPECT_TRUE(output.is_full());
+}
+
+TEST(S2BufferOperation, Point) {
+  // A polyline with one vertex is buffered as a point.
+  S1Angle radius = S1Angle::Degrees(2);
+  S2BufferOperation op{S2BufferOperation::Options(radius)};
+  auto polyline = MakePolylineOrDie("10:20");
+  S2Polygon output;
+  op.Buffer(*polyline, &output);
+  S2Point center = polyline->vertex(0);
+  S1Angle max_error = op.options().max_error();
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2Point p = S2Testing::SamplePoint(S2Cap(center, 2 * radius));
+    S1Angle d(center, p);
+    if (d <= radius) EXPECT_TRUE(output.Contains(p));
+    if (d >= radius + max_error) EXPECT_FALSE(output.Contains(p));
+  }
+}
+
+TEST(S2BufferOperation, Polyline) {
+  auto polyline = MakePolylineOrDie("0:0, 0:10, 10:10, 5:-5");
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Polyline::Shape>(polyline.get()));
+  for (double degrees : {0.01, 1.0, 5.0}) {
+    S2BufferOperation::Options options(S1Angle::Degrees(degrees));
+    S2Polygon output;
+    S2BufferOperation(options).Buffer(*polyline, &output);
+    CheckBuffer(index, options.radius(), options.max_error(), output);
+  }
+}
+
+TEST(S2BufferOperation, PolygonWithHole) {
+  auto polygon = MakePolygonOrDie(
+      "0:0, 0:20, 20:20, 20:0; 5:5, 15:5, 15:15, 5:15");
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Polygon::Shape>(polygon.get()));
+  S2BufferOperation::Options options(S1Angle::Degrees(2));
+  options.set_max_error(S1Angle::Degrees(0.001));
+  S2Polygon output;
+  S2BufferOperation(options).Buffer(*polygon, &output);
+  CheckBuffer(index, options.radius(), options.max_error(), output);
+  EXPECT_TRUE(output.Contains(polygon.get()));
+  EXPECT_EQ(2, output.num_loops());
+
+  // A large enough radius fills the hole.
+  options.set_radius(S1Angle::Degrees(6));
+  S2BufferOperation(options).Buffer(*polygon, &output);
+  EXPECT_EQ(1, output.num_loops());
+}
+
+TEST(S2BufferOperation, NegativeRadius) {
+  auto polygon = MakePolygonOrDie("0:0, 0:20, 20:20, 20:0");
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Polygon::Shape>(polygon.get()));
+  S2BufferOperation::Options options(S1Angle::Degrees(-3));
+  S2Polygon output;
+  S2BufferOperation(options).Buffer(*polygon, &output);
+  CheckBuffer(index, options.radius(), options.max_error(), output, true);
+  EXPECT_TRUE(polygon->Contains(&output));
+
+  // Shrinking by more than half the width produces the empty polygon.
+  options.set_radius(S1Angle::Degrees(-11));
+  S2BufferOperation(options).Buffer(*polygon, &output);
+  EXPECT_TRUE(output.is_empty());
+}
+
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(S2BufferOperation, ExecutorDoesNotChangeOutput) {
+  S2Testing::rnd.Reset(1);
+  S2Polygon polygon(S2Loop::MakeRegularLoop(
+      S2Testing::RandomPoint(), S1Angle::Degrees(10), 50));
+  S2BufferOperation::Options options(S1Angle::Degrees(0.5));
+  S2Polygon outputs[2];
+  ThreadPerTaskExecutor executor;
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    options.set_executor(parallel ? &executor : nullptr);
+    S2BufferOperation(options).Buffer(polygon, &outputs[parallel]);
+  }
+  EXPECT_TRUE(outputs[0].Equals(&outputs[1]));
+}
+
+}  // namespace
@@ -79,6 +79,7 @@
 
 #include "s2/base/casts.h"
 #include "s2/base/logging.h"
+#include "s2/base/mutex.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/util/bits/bits.h"
 #include "s2/id_set_lexicon.h"
@@ -102,6 +103,7 @@
 #include "s2/s2predicates.h"
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using gtl::compact_array;
@@ -113,6 +115,13 @@ using std::vector;
 // Internal flag intended to be set from within a debugger.
 bool s2builder_verbose = false;
 
+// When an executor is used, the input edges are split into this many ranges
+// per thread so that the work is balanced even if some ranges are slower.
+static const int kTasksPerThread = 8;
+
+// The number of loop iterations between calls to the progress callback.
+static const int kProgressInterval = 10000;
+
 S1Angle S2Builder::SnapFunction::max_edge_deviation() const {
   // We want max_edge_deviation() to be large enough compared to snap_radius()
   // such that edge splitting is rare.
@@ -135,6 +144,14 @@ S1Angle S2Builder::SnapFunction::max_edge_deviation() const {
   return kMaxEdgeDeviationRatio * snap_radius();
 }
 
+void S2Builder::SnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                         absl::Span<S2Point> snapped) const {
+  S2_DCHECK_EQ(points.size(), snapped.size());
+  for (size_t k = 0; k < points.size(); ++k) {
+    snapped[k] = SnapPoint(points[k]);
+  }
+}
+
 S2Builder::Options::Options()
     : snap_function_(
           make_unique<s2builderutil::IdentitySnapFunction>(S1Angle::Zero())) {
@@ -148,7 +165,11 @@ S2Builder::Options::Options(const Options& options)
     :  snap_function_(options.snap_function_->Clone()),
        split_crossing_edges_(options.split_crossing_edges_),
        simplify_edge_chains_(options.simplify_edge_chains_),
-       idempotent_(options.idempotent_) {
+       idempotent_(options.idempotent_),
+       retain_memory_(options.retain_memory_),
+       executor_(options.executor_),
+       build_layers_in_parallel_(options.build_layers_in_parallel_),
+       progress_callback_(options.progress_callback_) {
 }
 
 S2Builder::Options& S2Builder::Options::operator=(const Options& options) {
@@ -156,6 +177,10 @@ S2Builder::Options& S2Builder::Options::operator=(const Options& options) {
   split_crossing_edges_ = options.split_crossing_edges_;
   simplify_edge_chains_ = options.simplify_edge_chains_;
   idempotent_ = options.idempotent_;
+  retain_memory_ = options.retain_memory_;
+  executor_ = options.executor_;
+  build_layers_in_parallel_ = options.build_layers_in_parallel_;
+  progress_callback_ = options.progress_callback_;
   return *this;
 }
 
@@ -371,6 +396,21 @@ void S2Builder::AddPolyline(const S2Polyline& polyline) {
   }
 }
 
+void S2Builder::AddSnappedPolyline(absl::Span<const S2Point> vertices) {
+  const int begin = input_vertices_.size();
+  for (int i = 1; i < vertices.size(); ++i) {
+    AddEdge(vertices[i - 1], vertices[i]);
+  }
+  input_vertex_is_snapped_.resize(input_vertices_.size());
+  std::fill(input_vertex_is_snapped_.begin() + begin,
+            input_vertex_is_snapped_.end(), true);
+}
+
+// Returns true if the given input vertex was added by AddSnappedPolyline().
+inline bool S2Builder::IsInputVertexSnapped(InputVertexId id) const {
+  return id < input_vertex_is_snapped_.size() && input_vertex_is_snapped_[id];
+}
+
 void S2Builder::AddLoop(const S2Loop& loop) {
   // Ignore loops that do not have a boundary.
   if (loop.is_empty_or_full()) return;
@@ -396,9 +436,23 @@ void S2Builder::AddPolygon(const S2Polygon& polygon) {
 }
 
 void S2Builder::AddShape(const S2Shape& shape) {
-  for (int e = 0, n = shape.num_edges(); e < n; ++e) {
-    S2Shape::Edge edge = shape.edge(e);
-    AddEdge(edge.v0, edge.v1);
+  S2PointSpan vertices;
+  for (int i = 0, n = shape.num_chains(); i < n; ++i) {
+    int length = shape.chain(i).length;
+    if (shape.GetChainVertices(i, &vertices)) {
+      // Visit the vertex array directly rather than making a virtual call
+      // for each edge.
+      for (int j = 0; j < length; ++j) {
+        int k = j + 1;
+        if (k == vertices.size()) k = 0;
+        AddEdge(vertices[j], vertices[k]);
+      }
+    } else {
+      for (int j = 0; j < length; ++j) {
+        S2Shape::Edge edge = shape.chain_edge(i, j);
+        AddEdge(edge.v0, edge.v1);
+      }
+    }
   }
 }
 
@@ -454,6 +508,7 @@ bool S2Builder::Build(S2Error* error) {
   S2_CHECK(error != nullptr);
   error->Clear();
   error_ = error;
+  cancelled_ = false;
 
   // Mark the end of the last layer.
   layer_begins_.push_back(input_edges_.size());
@@ -462,18 +517,31 @@ bool S2Builder::Build(S2Error* error) {
   if (snapping_requested_ && !options_.idempotent()) {
     snapping_needed_ = true;
   }
-  ChooseSites();
-  BuildLayers();
+  if (ReportProgress(0)) ChooseSites();
+  if (ReportProgress(0.7)) BuildLayers();
   Reset();
   return error->ok();
 }
 
+// Calls the progress callback (if any) and returns false if Build() has been
+// cancelled, in which case error_ is set to S2Error::CANCELLED.
+bool S2Builder::ReportProgress(double fraction) {
+  const ProgressCallback& callback = options_.progress_callback();
+  if (!cancelled_ && callback && !callback(fraction)) {
+    cancelled_ = true;
+    error_->Init(S2Error::CANCELLED, "S2Builder::Build() was cancelled");
+  }
+  return !cancelled_;
+}
+
 void S2Builder::Reset() {
   input_vertices_.clear();
   input_edges_.clear();
+  input_vertex_is_snapped_.clear();
   layers_.clear();
   layer_options_.clear();
   layer_begins_.clear();
+  layer_is_full_polygon_predicates_.clear();
   label_set_ids_.clear();
   label_set_lexicon_.Clear();
   label_set_.clear();
@@ -491,12 +559,23 @@ void S2Builder::ChooseSites() {
       input_edges_, input_vertices_));
   if (options_.split_crossing_edges()) {
     AddEdgeCrossings(input_edge_index);
+    if (!ReportProgress(0.1)) return;
   }
   if (snapping_requested_) {
+    // Input that was already snapped by a previous S2Builder invocation with
+    // the same snap function (e.g., when re-encoding geometry) does not need
+    // Voronoi sites.  Checking for this directly is much cheaper than running
+    // the site selection below, which would reach the same conclusion.
+    if (!snapping_needed_ && sites_.empty() && IsInputAlreadySnapped()) {
+      CopyInputEdges();
+      return;
+    }
     S2PointIndex<SiteId> site_index;
     AddForcedSites(&site_index);
     ChooseInitialSites(&site_index);
+    if (cancelled_) return;
     CollectSiteEdges(site_index);
+    if (!ReportProgress(0.4)) return;
   }
   if (snapping_needed_) {
     AddExtraSites(input_edge_index);
@@ -602,14 +681,32 @@ void S2Builder::AddEdgeCrossings(const MutableS2ShapeIndex& input_edge_index) {
   // We need to build a list of intersections and add them afterwards so that
   // we don't reallocate vertices_ during the VisitCrossings() call.
   vector<S2Point> new_vertices;
-  s2shapeutil::VisitCrossingEdgePairs(
-      input_edge_index, s2shapeutil::CrossingType::INTERIOR,
-      [&new_vertices](const s2shapeutil::ShapeEdge& a,
-                      const s2shapeutil::ShapeEdge& b, bool) {
-        new_vertices.push_back(
-            S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
-        return true;  // Continue visiting.
-      });
+  if (options_.executor() == nullptr) {
+    s2shapeutil::VisitCrossingEdgePairs(
+        input_edge_index, s2shapeutil::CrossingType::INTERIOR,
+        [&new_vertices](const s2shapeutil::ShapeEdge& a,
+                        const s2shapeutil::ShapeEdge& b, bool) {
+          new_vertices.push_back(
+              S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
+          return true;  // Continue visiting.
+        });
+  } else {
+    absl::Mutex mutex;
+    s2shapeutil::VisitCrossingEdgePairs(
+        input_edge_index, s2shapeutil::CrossingType::INTERIOR,
+        [&new_vertices, &mutex](const s2shapeutil::ShapeEdge& a,
+                                const s2shapeutil::ShapeEdge& b, bool) {
+          S2Point x = S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1());
+          mutex.Lock();
+          new_vertices.push_back(x);
+          mutex.Unlock();
+          return true;  // Continue visiting.
+        }, options_.executor());
+    // The order of the new vertices does not affect the output (since the
+    // input vertices are sorted by ChooseInitialSites), but sorting them
+    // makes the intermediate state deterministic.
+    std::sort(new_vertices.begin(), new_vertices.end());
+  }
   if (!new_vertices.empty()) {
     snapping_needed_ = true;
     for (const auto& vertex : new_vertices) AddVertex(vertex);
@@ -627,6 +724,64 @@ void S2Builder::AddForcedSites(S2PointIndex<SiteId>* site_index) {
   num_forced_sites_ = sites_.size();
 }
 
+// Returns true if the input vertices are all fixed points of the snap
+// function, no two distinct vertices are closer than min_site_separation_ca_,
+// and no vertex is closer than min_edge_site_separation_ca_ to an edge that
+// it is not an endpoint of.  These are the same conditions that
+// ChooseInitialSites() and CollectSiteEdges() use to set snapping_needed_,
+// except that they are tested without choosing sites or collecting the sites
+// near each edge.  Input crossings must be handled by the caller.
+bool S2Builder::IsInputAlreadySnapped() const {
+  // This test is cheap and rejects most input that has not been snapped.
+  const SnapFunction& snap_function = options_.snap_function();
+  for (InputVertexId i = 0; i < input_vertices_.size(); ++i) {
+    if (IsInputVertexSnapped(i)) continue;
+    const S2Point& vertex = input_vertices_[i];
+    if (snap_function.SnapPoint(vertex) != vertex) return false;
+  }
+  vector<S2Point> vertices = input_vertices_;
+  std::sort(vertices.begin(), vertices.end());
+  vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+  S2PointIndex<int32> vertex_index;
+  for (int i = 0; i < vertices.size(); ++i) {
+    vertex_index.Add(vertices[i], i);
+  }
+
+  // FindClosestPoints() measures distances conservatively, so we recheck the
+  // distances using exact predicates (as in ChooseInitialSites).
+  S2ClosestPointQueryOptions options;
+  options.set_conservative_max_distance(min_site_separation_ca_);
+  S2ClosestPointQuery<int32> query(&vertex_index, options);
+  vector<S2ClosestPointQuery<int32>::Result> results;
+  for (const S2Point& vertex : vertices) {
+    S2ClosestPointQueryPointTarget target(vertex);
+    query.FindClosestPoints(&target, &results);
+    for (const auto& result : results) {
+      if (result.point() != vertex &&
+          s2pred::CompareDistance(vertex, result.point(),
+                                  min_site_separation_ca_) <= 0) {
+        return false;
+      }
+    }
+  }
+  query.mutable_options()->set_conservative_max_distance(
+      min_edge_site_separation_ca_);
+  for (const InputEdge& edge : input_edges_) {
+    const S2Point& v0 = input_vertices_[edge.first];
+    const S2Point& v1 = input_vertices_[edge.second];
+    S2ClosestPointQueryEdgeTarget target(v0, v1);
+    query.FindClosestPoints(&target, &results);
+    for (const auto& result : results) {
+      if (result.point() != v0 && result.point() != v1 &&
+          s2pred::CompareEdgeDistance(result.point(), v0, v1,
+                                      min_edge_site_separation_ca_) < 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 void S2Builder::ChooseInitialSites(S2PointIndex<SiteId>* site_index) {
   // Find all points whose distance is <= min_site_separation_ca_.
   S2ClosestPointQueryOptions options;
@@ -648,9 +803,26 @@ void S2Builder::ChooseInitialSites(S2PointIndex<SiteId>* site_index) {
   // "0:0, 0:0" rather than the expected "0:0, 0:1", because the snap radius
   // is approximately sqrt(2) degrees and therefore it is legal to snap both
   // input points to "0:0".  "Snap first" produces "0:0, 0:1" as expected.
-  for (const InputVertexKey& key : SortInputVertices()) {
-    const S2Point& vertex = input_vertices_[key.second];
-    S2Point site = SnapSite(vertex);
+  vector<InputVertexKey> sorted = SortInputVertices();
+
+  // Snap all the input vertices first using SnapFunction::SnapPoints(),
+  // which is usually faster than snapping them one at a time.
+  vector<S2Point> snapped;
+  if (snapping_requested_) SnapInputVertices(&snapped);
+  for (int k = 0; k < sorted.size(); ++k) {
+    if (k % kProgressInterval == 0 &&
+        !ReportProgress(0.1 + 0.2 * k / sorted.size())) {
+      return;
+    }
+    const InputVertexId id = sorted[k].second;
+    const S2Point& vertex = input_vertices_[id];
+    S2Point site;
+    if (snapped.empty() || IsInputVertexSnapped(id)) {
+      site = vertex;
+    } else {
+      site = snapped[id];
+      CheckSnappedSite(vertex, site);
+    }
     // If any vertex moves when snapped, the output cannot be idempotent.
     snapping_needed_ = snapping_needed_ || site != vertex;
 
@@ -680,10 +852,50 @@ void S2Builder::ChooseInitialSites(S2PointIndex<SiteId>* site_index) {
   }
 }
 
+// Sets (*snapped)[i] to the snap site for input_vertices_[i], except for
+// vertices added by AddSnappedPolyline() (whose entries are left unset).  If
+// an executor is available, ranges of vertices are snapped concurrently.
+void S2Builder::SnapInputVertices(vector<S2Point>* snapped) const {
+  const SnapFunction& snap_function = options_.snap_function();
+  const int num_vertices = input_vertices_.size();
+  snapped->resize(num_vertices);
+  auto snap = [&](int begin, int end) {
+    // Skip over runs of vertices that are already snapped.
+    while (begin < end) {
+      while (begin < end && IsInputVertexSnapped(begin)) ++begin;
+      int run_end = begin;
+      while (run_end < end && !IsInputVertexSnapped(run_end)) ++run_end;
+      snap_function.SnapPoints(
+          absl::MakeConstSpan(input_vertices_).subspan(begin, run_end - begin),
+          absl::MakeSpan(*snapped).subspan(begin, run_end - begin));
+      begin = run_end;
+    }
+  };
+  Executor* executor = options_.executor();
+  if (executor == nullptr) {
+    snap(0, num_vertices);
+    return;
+  }
+  const int num_tasks =
+      std::min(num_vertices, kTasksPerThread * executor->num_threads());
+  ParallelFor(executor, num_tasks, [&](int task) {
+    snap(static_cast<int64>(num_vertices) * task / num_tasks,
+         static_cast<int64>(num_vertices) * (task + 1) / num_tasks);
+  });
+}
+
 S2Point S2Builder::SnapSite(const S2Point& point) const {
   if (!snapping_requested_) return point;
   S2Point site = options_.snap_function().SnapPoint(point);
-S1ChordAngle dist_moved(site, point);
+  CheckSnappedSite(point, site);
+  return site;
+}
+
+// Sets error_ if the snap function moved "point" to "site" by more than the
+// snap radius.
+void S2Builder::CheckSnappedSite(const S2Point& point,
+                                 const S2Point& site) const {
+  S1ChordAngle dist_moved(site, point);
   if (dist_moved > site_snap_radius_ca_) {
     error_->Init(S2Error::BUILDER_SNAP_RADIUS_TOO_SMALL,
                  "Snap function moved vertex (%.15g, %.15g, %.15g) "
@@ -692,7 +904,6 @@ S1ChordAngle dist_moved(site, point);
                  dist_moved.ToAngle().radians(),
                  site_snap_radius_ca_.ToAngle().radians());
   }
-  return site;
 }
 
 // For each edge, find all sites within min_edge_site_query_radius_ca_ and
@@ -703,32 +914,57 @@ void S2Builder::CollectSiteEdges(const S2PointIndex<SiteId>& site_index) {
   // Find all points whose distance is <= edge_site_query_radius_ca_.
   S2ClosestPointQueryOptions options;
   options.set_conservative_max_distance(edge_site_query_radius_ca_);
-  S2ClosestPointQuery<SiteId> site_query(&site_index, options);
-  vector<S2ClosestPointQuery<SiteId>::Result> results;
   edge_sites_.resize(input_edges_.size());
-  for (InputEdgeId e = 0; e < input_edges_.size(); ++e) {
-    const InputEdge& edge = input_edges_[e];
-    const S2Point& v0 = input_vertices_[edge.first];
-    const S2Point& v1 = input_vertices_[edge.second];
-    if (s2builder_verbose) {
-      std::cout << "S2Polyline: " << s2textformat::ToString(v0)
-                << ", " << s2textformat::ToString(v1) << "\n";
-    }
-    S2ClosestPointQueryEdgeTarget target(v0, v1);
-    site_query.FindClosestPoints(&target, &results);
-    auto* sites = &edge_sites_[e];
-    sites->reserve(results.size());
-    for (const auto& result : results) {
-      sites->push_back(result.data());
-      if (!snapping_needed_ &&
-          result.distance() < min_edge_site_separation_ca_limit_ &&
-          result.point() != v0 && result.point() != v1 &&
-          s2pred::CompareEdgeDistance(result.point(), v0, v1,
-                                      min_edge_site_separation_ca_) < 0) {
-        snapping_needed_ = true;
+
+  // Collects the sites for the edges in [begin, end), and returns true if
+  // any of them shows that snapping is needed.  Each call uses its own
+  // query, so that ranges of edges can be processed concurrently.
+  auto collect = [&](InputEdgeId begin, InputEdgeId end) {
+    S2ClosestPointQuery<SiteId> site_query(&site_index, options);
+    vector<S2ClosestPointQuery<SiteId>::Result> results;
+    bool snapping_needed = snapping_needed_;
+    for (InputEdgeId e = begin; e < end; ++e) {
+      const InputEdge& edge = input_edges_[e];
+      const S2Point& v0 = input_vertices_[edge.first];
+      const S2Point& v1 = input_vertices_[edge.second];
+      if (s2builder_verbose) {
+        std::cout << "S2Polyline: " << s2textformat::ToString(v0)
+                  << ", " << s2textformat::ToString(v1) << "\n";
+      }
+      S2ClosestPointQueryEdgeTarget target(v0, v1);
+      site_query.FindClosestPoints(&target, &results);
+      auto* sites = &edge_sites_[e];
+      sites->reserve(results.size());
+      for (const auto& result : results) {
+        sites->push_back(result.data());
+        if (!snapping_needed &&
+            result.distance() < min_edge_site_separation_ca_limit_ &&
+            result.point() != v0 && result.point() != v1 &&
+            s2pred::CompareEdgeDistance(result.point(), v0, v1,
+                                        min_edge_site_separation_ca_) < 0) {
+          snapping_needed = true;
+        }
       }
+      SortSitesByDistance(v0, sites);
     }
-    SortSitesByDistance(v0, sites);
+    return snapping_needed;
+  };
+  Executor* executor = options_.executor();
+  if (executor == nullptr) {
+    snapping_needed_ = collect(0, input_edges_.size());
+    return;
+  }
+  const int num_edges = input_edges_.size();
+  const int num_tasks =
+      std::min(num_edges, kTasksPerThread * executor->num_threads());
+  vector<char> task_snapping_needed(num_tasks);
+  ParallelFor(executor, num_tasks, [&](int task) {
+    task_snapping_needed[task] =
+        collect(static_cast<int64>(num_edges) * task / num_tasks,
+                static_cast<int64>(num_edges) * (task + 1) / num_tasks);
+  });
+  for (char needed : task_snapping_needed) {
+    if (needed) snapping_needed_ = true;
   }
 }
 
@@ -766,7 +1002,42 @@ void S2Builder::AddExtraSites(const MutableS2ShapeIndex& input_edge_index) {
 
   vector<SiteId> chain;  // Temporary
   vector<InputEdgeId> snap_queue;
+
+  // If an executor is available, first check all the edges concurrently
+  // against the initial sites.  Most edges don't need any extra sites, and
+  // since the check depends only on the edge and its nearby sites, such an
+  // edge can be skipped below as long as no site has been added near it.
+  // (Adding a site to edge_sites_[e] always increases its size.)
+  vector<char> needs_check;
+  vector<int> initial_num_sites;
+  Executor* executor = options_.executor();
+  if (executor != nullptr) {
+    const int num_edges = input_edges_.size();
+    needs_check.resize(num_edges);
+    initial_num_sites.resize(num_edges);
+    const int num_tasks =
+        std::min(num_edges, kTasksPerThread * executor->num_threads());
+    ParallelFor(executor, num_tasks, [&](int task) {
+      vector<SiteId> task_chain;
+      S2Point new_site;
+      InputEdgeId end = static_cast<int64>(num_edges) * (task + 1) / num_tasks;
+      for (InputEdgeId e = static_cast<int64>(num_edges) * task / num_tasks;
+           e < end; ++e) {
+        SnapEdge(e, &task_chain);
+        needs_check[e] = FindExtraSite(e, task_chain, &new_site);
+        initial_num_sites[e] = edge_sites_[e].size();
+      }
+    });
+  }
   for (InputEdgeId max_e = 0; max_e < input_edges_.size(); ++max_e) {
+    if (max_e % kProgressInterval == 0 &&
+        !ReportProgress(0.4 + 0.3 * max_e / input_edges_.size())) {
+      return;
+    }
+    if (executor != nullptr && !needs_check[max_e] &&
+        edge_sites_[max_e].size() == initial_num_sites[max_e]) {
+      continue;
+    }
     snap_queue.push_back(max_e);
     while (!snap_queue.empty()) {
       InputEdgeId e = snap_queue.back();
@@ -785,6 +1056,16 @@ void S2Builder::MaybeAddExtraSites(InputEdgeId edge_id,
                                    const vector<SiteId>& chain,
                                    const MutableS2ShapeIndex& input_edge_index,
                                    vector<InputEdgeId>* snap_queue) {
+  S2Point new_site;
+  if (FindExtraSite(edge_id, chain, &new_site)) {
+    AddExtraSite(new_site, max_edge_id, input_edge_index, snap_queue);
+  }
+}
+
+// Returns true if an extra site needs to be added because of the given
+// snapped edge chain, and sets "new_site" to its position.
+bool S2Builder::FindExtraSite(InputEdgeId edge_id, const vector<SiteId>& chain,
+                              S2Point* new_site) const {
   // The snapped chain is always a *subsequence* of the nearby sites
   // (edge_sites_), so we walk through the two arrays in parallel looking for
   // sites that weren't snapped.  We also keep track of the current snapped
@@ -814,9 +1095,8 @@ void S2Builder::MaybeAddExtraSites(InputEdgeId edge_id,
         // the input edge and taking their midpoint.
         S2Point mid = (S2::Project(v0, a0, a1) +
                        S2::Project(v1, a0, a1)).Normalize();
-        S2Point new_site = GetSeparationSite(mid, v0, v1, edge_id);
-        AddExtraSite(new_site, max_edge_id, input_edge_index, snap_queue);
-        return;
+        *new_site = GetSeparationSite(mid, v0, v1, edge_id);
+        return true;
       }
     } else if (i > 0 && id >= num_forced_sites_) {
       // Check whether this "site to avoid" is closer to the snapped edge than
@@ -836,13 +1116,13 @@ void S2Builder::MaybeAddExtraSites(InputEdgeId edge_id,
         // adding a new site along the input edge (a "separation site"), then
         // we find all the edges near the new site (including this one) and
         // add them to the snap queue.
-        S2Point new_site = GetSeparationSite(site_to_avoid, v0, v1, edge_id);
-        S2_DCHECK_NE(site_to_avoid, new_site);
-        AddExtraSite(new_site, max_edge_id, input_edge_index, snap_queue);
-        return;
+        *new_site = GetSeparationSite(site_to_avoid, v0, v1, edge_id);
+        S2_DCHECK_NE(site_to_avoid, *new_site);
+        return true;
       }
     }
   }
+  return false;
 }
 
 // Adds a new site, then updates "edge_sites"_ for all edges near the new site
@@ -1041,17 +1321,17 @@ void S2Builder::BuildLayers() {
   // Each output edge has an "input edge id set id" (an int32) representing
   // the set of input edge ids that were snapped to this edge.  The actual
   // InputEdgeIds can be retrieved using "input_edge_id_set_lexicon".
-  vector<vector<Edge>> layer_edges;
-  vector<vector<InputEdgeIdSetId>> layer_input_edge_ids;
-  IdSetLexicon input_edge_id_set_lexicon;
-  BuildLayerEdges(&layer_edges, &layer_input_edge_ids,
-                  &input_edge_id_set_lexicon);
+  BuildLayerEdges(&layer_edges_, &layer_input_edge_ids_,
+                  &input_edge_id_set_lexicon_);
 
   // At this point we have no further need for the input geometry or nearby
-  // site data, so we clear those fields to save space.
-  vector<S2Point>().swap(input_vertices_);
-  vector<InputEdge>().swap(input_edges_);
-  vector<compact_array<SiteId>>().swap(edge_sites_);
+  // site data, so we clear those fields to save space (unless the memory
+  // will be reused by the next call to Build).
+  if (!options_.retain_memory()) {
+    vector<S2Point>().swap(input_vertices_);
+    vector<InputEdge>().swap(input_edges_);
+    vector<compact_array<SiteId>>().swap(edge_sites_);
+  }
 
   // If there are a large number of layers, then we build a minimal subset of
   // vertices for each layer.  This ensures that layer types that iterate over
@@ -1071,22 +1351,53 @@ void S2Builder::BuildLayers() {
       vector<Graph::VertexId> filter_tmp;  // Temporary used by FilterVertices.
       layer_vertices.resize(layers_.size());
       for (int i = 0; i < layers_.size(); ++i) {
-        layer_vertices[i] = Graph::FilterVertices(sites_, &layer_edges[i],
+        layer_vertices[i] = Graph::FilterVertices(sites_, &layer_edges_[i],
                                                   &filter_tmp);
       }
-      vector<S2Point>().swap(sites_);  // Release memory
+      if (!options_.retain_memory()) {
+        vector<S2Point>().swap(sites_);  // Release memory
+      }
     }
   }
-  for (int i = 0; i < layers_.size(); ++i) {
+  auto build_layer = [this, &layer_vertices](int i, S2Error* error) {
     const vector<S2Point>& vertices = (layer_vertices.empty() ?
                                        sites_ : layer_vertices[i]);
-    Graph graph(layer_options_[i], &vertices, &layer_edges[i],
-                &layer_input_edge_ids[i], &input_edge_id_set_lexicon,
+    Graph graph(layer_options_[i], &vertices, &layer_edges_[i],
+                &layer_input_edge_ids_[i], &input_edge_id_set_lexicon_,
                 &label_set_ids_, &label_set_lexicon_,
                 layer_is_full_polygon_predicates_[i]);
-    layers_[i]->Build(graph, error_);
+    layers_[i]->Build(graph, error);
     // Don't free the layer data until all layers have been built, in order to
     // support building multiple layers at once (e.g. ClosedSetNormalizer).
+  };
+  Executor* executor = options_.executor();
+  if (executor != nullptr && options_.build_layers_in_parallel() &&
+      layers_.size() > 1) {
+    // Each layer reports errors separately; they are then applied in layer
+    // order so that the result matches building the layers sequentially.
+    vector<S2Error> layer_errors(layers_.size());
+    if (ReportProgress(0.8)) {
+      ParallelFor(executor, layers_.size(), [&](int i) {
+          build_layer(i, &layer_errors[i]);
+        });
+    }
+    for (const S2Error& layer_error : layer_errors) {
+      if (!layer_error.ok()) *error_ = layer_error;
+    }
+  } else {
+    for (int i = 0; i < layers_.size(); ++i) {
+      if (!ReportProgress(0.8 + 0.2 * i / layers_.size())) break;
+      build_layer(i, error_);
+    }
+  }
+  if (options_.retain_memory()) {
+    for (auto& edges : layer_edges_) edges.clear();
+    for (auto& input_edge_ids : layer_input_edge_ids_) input_edge_ids.clear();
+    input_edge_id_set_lexicon_.Clear();
+  } else {
+    vector<vector<Edge>>().swap(layer_edges_);
+    vector<vector<InputEdgeIdSetId>>().swap(layer_input_edge_ids_);
+    input_edge_id_set_lexicon_ = IdSetLexicon();
   }
 }
 
@@ -1228,7 +1539,10 @@ class S2Builder::EdgeChainSimplifier {
   int graph_edge_layer(EdgeId e) const;
   int input_edge_layer(InputEdgeId id) const;
   bool IsInterior(VertexId v);
-  void SimplifyChain(VertexId v0, VertexId v1);
+  void AddChain(VertexId v0, VertexId v1);
+  struct Chain;
+  void SimplifyChain(Chain* chain) const;
+  void OutputChain(int i);
   Graph::VertexId FollowChain(VertexId v0, VertexId v1) const;
   void OutputAllEdges(VertexId v0, VertexId v1);
   bool TargetInputVertices(VertexId v, S2PolylineSimplifier* simplifier) const;
@@ -1261,6 +1575,21 @@ class S2Builder::EdgeChainSimplifier {
   // used_[e] indicates that EdgeId "e" has already been processed.
   vector<bool> used_;
 
+  // An edge chain that starts and ends at a non-interior vertex (or forms a
+  // loop of interior vertices).  "ends" is the index within "vertices" of
+  // the last vertex of each simplified subchain; each subchain starts where
+  // the previous one ended (or at vertices[0]).
+  struct Chain {
+    vector<VertexId> vertices;
+    vector<int> ends;
+  };
+  vector<Chain> chains_;
+
+  // The order in which Run() visits edges and chains.  A non-negative value
+  // is an EdgeId that is copied to the output unless it has been used by a
+  // previous chain; a negative value "-1 - i" refers to chains_[i].
+  vector<int> steps_;
+
   // Temporary vectors, declared here to avoid repeated allocation.
   vector<VertexId> tmp_vertices_;
   vector<EdgeId> tmp_edges_;
@@ -1378,9 +1707,9 @@ void S2Builder::EdgeChainSimplifier::Run() {
     Edge edge = g_.edge(e);
     if (is_interior_[edge.first]) continue;
     if (!is_interior_[edge.second]) {
-      OutputEdge(e);  // An edge between two non-interior vertices.
+      steps_.push_back(e);  // An edge between two non-interior vertices.
     } else {
-      SimplifyChain(edge.first, edge.second);
+      AddChain(edge.first, edge.second);
     }
   }
   // If there are any edges left, they form one or more disjoint loops where
@@ -1401,10 +1730,39 @@ void S2Builder::EdgeChainSimplifier::Run() {
     if (edge.first == edge.second) {
       // Note that it is safe to output degenerate edges as we go along,
       // because this vertex has at least one non-degenerate outgoing edge and
-      // therefore we will (or just did) start an edge chain here.
-      OutputEdge(e);
+      // therefore we will (or just did) start an edge chain here.  Whether
+      // the edge is still unused is only known once the chains before it
+      // have been merged, so the check is deferred until then.
+      steps_.push_back(e);
     } else {
-      SimplifyChain(edge.first, edge.second);
+      AddChain(edge.first, edge.second);
+    }
+  }
+
+  // Each chain is now known, and simplifying a chain only reads the graph,
+  // so the chains can be simplified concurrently.  The results are then
+  // output in the order above, so that the output does not depend on
+  // whether an executor is used.
+  Executor* executor = builder_.options_.executor();
+  const int num_chains = chains_.size();
+  if (executor == nullptr) {
+    for (Chain& chain : chains_) SimplifyChain(&chain);
+  } else {
+    const int num_tasks =
+        std::min(num_chains, kTasksPerThread * executor->num_threads());
+    ParallelFor(executor, num_tasks, [&](int task) {
+      int end = static_cast<int64>(num_chains) * (task + 1) / num_tasks;
+      for (int i = static_cast<int64>(num_chains) * task / num_tasks;
+           i < end; ++i) {
+        SimplifyChain(&chains_[i]);
+      }
+    });
+  }
+  for (int step : steps_) {
+    if (step < 0) {
+      OutputChain(-1 - step);
+    } else if (!used_[step]) {
+      OutputEdge(step);
     }
   }
 
@@ -1541,41 +1899,67 @@ bool S2Builder::EdgeChainSimplifier::IsInterior(VertexId v) {
 }
 
 // Follows the edge chain starting with (v0, v1) until either we find a
-// non-interior vertex or we return to the original vertex v0.  At each vertex
-// we simplify a subchain of edges that is as long as possible.
-void S2Builder::EdgeChainSimplifier::SimplifyChain(VertexId v0, VertexId v1) {
-  // Avoid allocating "chain" each time by reusing it.
-  vector<VertexId>& chain = tmp_vertices_;
-  S2PolylineSimplifier simplifier;
+// non-interior vertex or we return to the original vertex v0, and records
+// the chain so that it can be simplified later.  All non-degenerate edges
+// of the chain are marked as used.
+void S2Builder::EdgeChainSimplifier::AddChain(VertexId v0, VertexId v1) {
+  steps_.push_back(-1 - static_cast<int>(chains_.size()));
+  chains_.emplace_back();
+  vector<VertexId>& vertices = chains_.back().vertices;
   VertexId vstart = v0;
-  bool done = false;
-  do {
-    // Simplify a subchain of edges starting (v0, v1).
+  vertices.push_back(v0);
+  for (;;) {
+    vertices.push_back(v1);
+    for (EdgeId e : out_.edge_ids(v0, v1)) used_[e] = true;
+    for (EdgeId e : out_.edge_ids(v1, v0)) used_[e] = true;
+    if (!is_interior_[v1] || v1 == vstart) break;
+    VertexId vprev = v0;
+    v0 = v1;
+    v1 = FollowChain(vprev, v0);
+  }
+}
+
+// Splits the given chain into subchains that are each as long as possible,
+// such that each subchain can be replaced by a single edge.  This method
+// only modifies "chain" and may be called concurrently for different chains.
+void S2Builder::EdgeChainSimplifier::SimplifyChain(Chain* chain) const {
+  const vector<VertexId>& vertices = chain->vertices;
+  const int n = vertices.size();
+  S2PolylineSimplifier simplifier;
+  for (int start = 0; start < n - 1; ) {
+    // Simplify a subchain of edges starting at vertices[start].
+    VertexId v0 = vertices[start];
     simplifier.Init(g_.vertex(v0));
-    AvoidSites(v0, v0, v1, &simplifier);
-    chain.push_back(v0);
-    do {
-      chain.push_back(v1);
-      done = !is_interior_[v1] || v1 == vstart;
-      if (done) break;
-
-      // Attempt to extend the chain to the next vertex.
-      VertexId vprev = v0;
-      v0 = v1;
-      v1 = FollowChain(vprev, v0);
-    } while (TargetInputVertices(v0, &simplifier) &&
-             AvoidSites(chain[0], v0, v1, &simplifier) &&
-             simplifier.Extend(g_.vertex(v1)));
-
-    if (chain.size() == 2) {
-      OutputAllEdges(chain[0], chain[1]);  // Could not simplify.
+    AvoidSites(v0, v0, vertices[start + 1], &simplifier);
+    int end = start + 1;
+    while (end + 1 < n &&
+           TargetInputVertices(vertices[end], &simplifier) &&
+           AvoidSites(v0, vertices[end], vertices[end + 1], &simplifier) &&
+           simplifier.Extend(g_.vertex(vertices[end + 1]))) {
+      ++end;
+    }
+    chain->ends.push_back(end);
+    start = end;
+  }
+}
+
+// Outputs the simplified subchains of chains_[i].
+void S2Builder::EdgeChainSimplifier::OutputChain(int i) {
+  const Chain& chain = chains_[i];
+  int start = 0;
+  for (int end : chain.ends) {
+    if (end == start + 1) {
+      // Could not simplify.
+      OutputAllEdges(chain.vertices[start], chain.vertices[end]);
     } else {
-      MergeChain(chain);
+      tmp_vertices_.assign(chain.vertices.begin() + start,
+                           chain.vertices.begin() + end + 1);
+      MergeChain(tmp_vertices_);
     }
-    // Note that any degenerate edges that were not merged into a chain are
-    // output by EdgeChainSimplifier::Run().
-    chain.clear();
-  } while (!done);
+    start = end;
+  }
+  // Note that any degenerate edges that were not merged into a chain are
+  // output by EdgeChainSimplifier::Run().
 }
 
 // Given an edge (v0, v1) where v1 is an interior vertex, returns the (unique)
@@ -21,11 +21,13 @@
 #ifndef S2_S2BUILDER_H_
 #define S2_S2BUILDER_H_
 
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/base/macros.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/id_set_lexicon.h"
 #include "s2/mutable_s2shape_index.h"
@@ -37,6 +39,7 @@
 #include "s2/s2shape_index.h"
 #include "s2/util/gtl/compact_array.h"
 
+class Executor;
 class S2Loop;
 class S2Polygon;
 class S2Polyline;
@@ -255,10 +258,31 @@ class S2Builder {
     // distance from "x" is no greater than "snap_radius".
     virtual S2Point SnapPoint(const S2Point& point) const = 0;
 
+    // Batch version of SnapPoint() that sets snapped[k] to
+    // SnapPoint(points[k]).  S2Builder calls this method to snap all the
+    // input vertices at once.  The default implementation simply calls
+    // SnapPoint() for each point; subclasses can override it with a faster
+    // equivalent.
+    //
+    // REQUIRES: snapped.size() == points.size()
+    virtual void SnapPoints(absl::Span<const S2Point> points,
+                            absl::Span<S2Point> snapped) const;
+
     // Returns a deep copy of this SnapFunction.
     virtual std::unique_ptr<SnapFunction> Clone() const = 0;
   };
 
+  // A function that is called periodically during Build() to report progress
+  // and to check whether the operation should be cancelled.  "fraction" is a
+  // rough estimate of the fraction of the work completed so far (between 0
+  // and 1).  If the function returns false, Build() stops as soon as possible
+  // and returns false with the error code S2Error::CANCELLED; the output
+  // layers are not built (or, if the callback is invoked between layers, the
+  // remaining layers are not built).
+  //
+  // The function is always called from the thread that called Build().
+  using ProgressCallback = std::function<bool (double fraction)>;
+
   class Options {
    public:
     Options();
@@ -369,6 +393,55 @@ class S2Builder {
     bool idempotent() const;
     void set_idempotent(bool idempotent);
 
+    // If true, the S2Builder keeps the memory used by its internal buffers
+    // (sites, snapped edges, per-layer edge vectors, etc.) from one call to
+    // Build() to the next rather than releasing it as soon as possible.  This
+    // is useful when a single S2Builder (e.g., one per thread) is used to
+    // build many small pieces of geometry, since after the first few calls
+    // most of its allocations are avoided.  The drawback is that the memory
+    // is not released until the S2Builder is destroyed, and that peak memory
+    // usage during Build() is somewhat higher.
+    //
+    // DEFAULT: false
+    bool retain_memory() const;
+    void set_retain_memory(bool retain_memory);
+
+    // If non-null, the steps of Build() that process each input vertex or
+    // edge independently run concurrently using the given executor.  These
+    // are snapping the input vertices, finding the sites near each input
+    // edge, finding edge crossings (if split_crossing_edges() is true), the
+    // initial check of every snapped edge for extra sites, and simplifying
+    // each edge chain (if simplify_edge_chains() is true).  Selecting the
+    // sites and adding extra sites remain sequential, so the output is
+    // exactly the same as without an executor.  The snap function must be
+    // thread-safe, and the executor must outlive the S2Builder.
+    //
+    // DEFAULT: nullptr
+    Executor* executor() const;
+    void set_executor(Executor* executor);
+
+    // If true and executor() is non-null, the output layers are built
+    // concurrently: the S2Builder::Graph for each layer is constructed and
+    // passed to Layer::Build() in a separate executor task.  This is only
+    // valid if the layers are independent of each other and may be built in
+    // any order.  In particular it must not be used with layers that
+    // coordinate with each other during Build(), such as those created by
+    // s2builderutil::NormalizeClosedSet().  If several layers report an
+    // error, the one reported by the layer added last is returned, just as
+    // when the layers are built sequentially.
+    //
+    // DEFAULT: false
+    bool build_layers_in_parallel() const;
+    void set_build_layers_in_parallel(bool build_layers_in_parallel);
+
+    // If non-empty, this function is called at the boundaries between the
+    // phases of Build() and periodically within its longer loops (see
+    // ProgressCallback above).
+    //
+    // DEFAULT: empty
+    const ProgressCallback& progress_callback() const;
+    void set_progress_callback(ProgressCallback progress_callback);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -378,6 +451,10 @@ class S2Builder {
     bool split_crossing_edges_ = false;
     bool simplify_edge_chains_ = false;
     bool idempotent_ = true;
+    bool retain_memory_ = false;
+    Executor* executor_ = nullptr;
+    bool build_layers_in_parallel_ = false;
+    ProgressCallback progress_callback_;
   };
 
   // The following classes are only needed by Layer implementations.
@@ -454,6 +531,15 @@ class S2Builder {
   // consists of 0 or 1 vertices, this method does nothing.)
   void AddPolyline(const S2Polyline& polyline);
 
+  // Like AddPolyline(), except that the caller guarantees that every vertex
+  // is already a fixed point of snap_function(), i.e. SnapPoint(v) == v.
+  // SnapPoint() is then not called for these vertices.  For example, E7
+  // coordinates can be converted with
+  // IntLatLngSnapFunction::IntLatLngToPoints() and added with this method
+  // when building with IntLatLngSnapFunction(7).  (If the guarantee does not
+  // hold, the output may not satisfy the S2Builder guarantees.)
+  void AddSnappedPolyline(absl::Span<const S2Point> vertices);
+
   // Adds the edges in the given loop.  If the sign() of the loop is negative
   // (i.e. this loop represents a hole within a polygon), the edge directions
   // are automatically reversed to ensure that the polygon interior is always
@@ -588,8 +674,13 @@ class S2Builder {
   void AddEdgeCrossings(const MutableS2ShapeIndex& input_edge_index);
   void AddForcedSites(S2PointIndex<SiteId>* site_index);
   bool is_forced(SiteId v) const;
+  bool IsInputAlreadySnapped() const;
+  bool IsInputVertexSnapped(InputVertexId id) const;
   void ChooseInitialSites(S2PointIndex<SiteId>* site_index);
+  bool ReportProgress(double fraction);
+  void SnapInputVertices(std::vector<S2Point>* snapped) const;
   S2Point SnapSite(const S2Point& point) const;
+  void CheckSnappedSite(const S2Point& point, const S2Point& site) const;
   void CollectSiteEdges(const S2PointIndex<SiteId>& site_index);
   void SortSitesByDistance(const S2Point& x,
                            gtl::compact_array<SiteId>* sites) const;
@@ -599,6 +690,8 @@ class S2Builder {
                           const std::vector<SiteId>& chain,
                           const MutableS2ShapeIndex& input_edge_index,
                           std::vector<InputEdgeId>* snap_queue);
+  bool FindExtraSite(InputEdgeId edge_id, const std::vector<SiteId>& chain,
+                     S2Point* new_site) const;
   void AddExtraSite(const S2Point& new_site,
                     InputEdgeId max_edge_id,
                     const MutableS2ShapeIndex& input_edge_index,
@@ -674,6 +767,9 @@ class S2Builder {
   // A copy of the argument to Build().
   S2Error* error_;
 
+  // True if options_.progress_callback() has asked Build() to stop.
+  bool cancelled_;
+
   // True if snapping was requested.  This is true if either snap_radius() is
   // positive, or split_crossing_edges() is true (which implicitly requests
   // snapping to ensure that both crossing edges are snapped to the
@@ -694,6 +790,12 @@ class S2Builder {
   std::vector<S2Point> input_vertices_;
   std::vector<InputEdge> input_edges_;
 
+  // input_vertex_is_snapped_[i] indicates that input vertex "i" was added by
+  // AddSnappedPolyline() and is a fixed point of the snap function.  Vertices
+  // beyond the end of this vector (including all vertices when the method
+  // has not been called) are snapped as usual.
+  std::vector<bool> input_vertex_is_snapped_;
+
   std::vector<std::unique_ptr<Layer>> layers_;
   std::vector<GraphOptions> layer_options_;
   std::vector<InputEdgeId> layer_begins_;
@@ -734,6 +836,15 @@ class S2Builder {
   // the "sites to avoid" (needed for simplification).
   std::vector<gtl::compact_array<SiteId>> edge_sites_;
 
+  ////////////// Data for Building Layers //////////////
+
+  // The snapped edges of each layer, together with the set of input edges
+  // that were snapped to each output edge.  These are only kept between
+  // calls to Build() when options().retain_memory() is true.
+  std::vector<std::vector<Edge>> layer_edges_;
+  std::vector<std::vector<InputEdgeIdSetId>> layer_input_edge_ids_;
+  IdSetLexicon input_edge_id_set_lexicon_;
+
   S2Builder(const S2Builder&) = delete;
   S2Builder& operator=(const S2Builder&) = delete;
 };
@@ -963,6 +1074,41 @@ inline void S2Builder::Options::set_idempotent(bool idempotent) {
   idempotent_ = idempotent;
 }
 
+inline bool S2Builder::Options::retain_memory() const {
+  return retain_memory_;
+}
+
+inline void S2Builder::Options::set_retain_memory(bool retain_memory) {
+  retain_memory_ = retain_memory;
+}
+
+inline Executor* S2Builder::Options::executor() const {
+  return executor_;
+}
+
+inline void S2Builder::Options::set_executor(Executor* executor) {
+  executor_ = executor;
+}
+
+inline bool S2Builder::Options::build_layers_in_parallel() const {
+  return build_layers_in_parallel_;
+}
+
+inline void S2Builder::Options::set_build_layers_in_parallel(
+    bool build_layers_in_parallel) {
+  build_layers_in_parallel_ = build_layers_in_parallel;
+}
+
+inline const S2Builder::ProgressCallback&
+S2Builder::Options::progress_callback() const {
+  return progress_callback_;
+}
+
+inline void S2Builder::Options::set_progress_callback(
+    ProgressCallback progress_callback) {
+  progress_callback_ = std::move(progress_callback);
+}
+
 inline S2Builder::GraphOptions::EdgeType
 S2Builder::GraphOptions::edge_type() const {
   return edge_type_;
@@ -59,15 +59,71 @@ Graph::Graph(const GraphOptions& options,
 }
 
 vector<Graph::EdgeId> Graph::GetInEdgeIds() const {
-  vector<EdgeId> in_edge_ids(num_edges());
-  std::iota(in_edge_ids.begin(), in_edge_ids.end(), 0);
-  std::sort(in_edge_ids.begin(), in_edge_ids.end(),
-            [this](EdgeId ai, EdgeId bi) {
-      return StableLessThan(reverse(edge(ai)), reverse(edge(bi)), ai, bi);
-    });
+  vector<EdgeId> in_edge_ids;
+  SortEdgeIds(edges(), true /*reverse_edges*/, &in_edge_ids);
   return in_edge_ids;
 }
 
+void Graph::SortEdgeIds(const vector<Edge>& edges, bool reverse_edges,
+                        vector<EdgeId>* edge_ids) {
+  // Below this size std::sort is faster than the fixed overhead of clearing
+  // the digit counts on every pass.
+  static const int kMinRadixSortEdges = 512;
+  static const int kRadixBits = 11;
+  static const uint32 kRadixMask = (1 << kRadixBits) - 1;
+
+  const EdgeId n = edges.size();
+  edge_ids->resize(n);
+  std::iota(edge_ids->begin(), edge_ids->end(), 0);
+  if (n < kMinRadixSortEdges) {
+    if (reverse_edges) {
+      std::sort(edge_ids->begin(), edge_ids->end(),
+                [&edges](EdgeId ai, EdgeId bi) {
+          return StableLessThan(reverse(edges[ai]), reverse(edges[bi]),
+                                ai, bi);
+        });
+    } else {
+      std::sort(edge_ids->begin(), edge_ids->end(),
+                [&edges](EdgeId ai, EdgeId bi) {
+          return StableLessThan(edges[ai], edges[bi], ai, bi);
+        });
+    }
+    return;
+  }
+  // Only as many digits as are needed to represent the largest VertexId are
+  // examined, so graphs with few vertices need few passes.
+  uint32 max_vertex = 0;
+  for (const Edge& e : edges) {
+    max_vertex = max(max_vertex, static_cast<uint32>(max(e.first, e.second)));
+  }
+  int num_digits = 0;
+  for (uint32 m = max_vertex; m != 0; m >>= kRadixBits) ++num_digits;
+
+  // Sort by the minor key first and the major key second.  Every pass is
+  // stable and the initial order is by EdgeId, so equal edges end up ordered
+  // by EdgeId exactly as with StableLessThan.
+  vector<EdgeId> tmp(n);
+  vector<EdgeId> counts(kRadixMask + 2);
+  for (int k = 0; k < 2; ++k) {
+    const bool use_first = (k == 0) == reverse_edges;
+    for (int d = 0; d < num_digits; ++d) {
+      const int shift = d * kRadixBits;
+      auto digit = [&edges, use_first, shift](EdgeId e) {
+        const Edge& edge = edges[e];
+        return (static_cast<uint32>(use_first ? edge.first : edge.second)
+                >> shift) & kRadixMask;
+      };
+      std::fill(counts.begin(), counts.end(), 0);
+      for (EdgeId e : *edge_ids) ++counts[digit(e) + 1];
+      // Skip passes where every edge has the same digit.
+      if (*std::max_element(counts.begin(), counts.end()) == n) continue;
+      for (int i = 1; i < counts.size(); ++i) counts[i] += counts[i - 1];
+      for (EdgeId e : *edge_ids) tmp[counts[digit(e)]++] = e;
+      edge_ids->swap(tmp);
+    }
+  }
+}
+
 vector<Graph::EdgeId> Graph::GetSiblingMap() const {
   vector<EdgeId> in_edge_ids = GetInEdgeIds();
   MakeSiblingMap(&in_edge_ids);
@@ -307,7 +363,12 @@ bool Graph::GetLeftTurnMap(const vector<EdgeId>& in_edge_ids,
 
 void Graph::CanonicalizeLoopOrder(const vector<InputEdgeId>& min_input_ids,
                                   vector<EdgeId>* loop) {
-  if (loop->empty()) return;
+  CanonicalizeLoopOrder(min_input_ids, absl::MakeSpan(*loop));
+}
+
+void Graph::CanonicalizeLoopOrder(const vector<InputEdgeId>& min_input_ids,
+                                  absl::Span<EdgeId> loop) {
+  if (loop.empty()) return;
   // Find the position of the element with the highest input edge id.  If
   // there are multiple such elements together (i.e., the edge was split
   // into several pieces by snapping it to several vertices), then we choose
@@ -326,8 +387,8 @@ void Graph::CanonicalizeLoopOrder(const vector<InputEdgeId>& min_input_ids,
   // we still end up preserving the original cyclic vertex order.
   int pos = 0;
   bool saw_gap = false;
-  for (int i = 1; i < loop->size(); ++i) {
-    int cmp = min_input_ids[(*loop)[i]] - min_input_ids[(*loop)[pos]];
+  for (int i = 1; i < loop.size(); ++i) {
+    int cmp = min_input_ids[loop[i]] - min_input_ids[loop[pos]];
     if (cmp < 0) {
       saw_gap = true;
     } else if (cmp > 0 || !saw_gap) {
@@ -335,8 +396,8 @@ void Graph::CanonicalizeLoopOrder(const vector<InputEdgeId>& min_input_ids,
       saw_gap = false;
     }
   }
-  if (++pos == loop->size()) pos = 0;  // Convert loop end to loop start.
-  std::rotate(loop->begin(), loop->begin() + pos, loop->end());
+  if (++pos == loop.size()) pos = 0;  // Convert loop end to loop start.
+  std::rotate(loop.begin(), loop.begin() + pos, loop.end());
 }
 
 void Graph::CanonicalizeVectorOrder(const vector<InputEdgeId>& min_input_ids,
@@ -347,15 +408,68 @@ void Graph::CanonicalizeVectorOrder(const vector<InputEdgeId>& min_input_ids,
     });
 }
 
+void Graph::CanonicalizeVectorOrder(const vector<InputEdgeId>& min_input_ids,
+                                    EdgeChains* chains) {
+  vector<int> order(chains->num_chains());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+    [&min_input_ids, chains](int a, int b) {
+      return make_pair(min_input_ids[chains->chain(a)[0]], a) <
+             make_pair(min_input_ids[chains->chain(b)[0]], b);
+    });
+  chains->Reorder(order);
+}
+
+void Graph::EdgeChains::Reorder(const vector<int>& order) {
+  S2_DCHECK_EQ(order.size(), num_chains());
+  tmp_edges_.clear();
+  tmp_offsets_.assign(1, 0);
+  for (int i : order) {
+    tmp_edges_.insert(tmp_edges_.end(), edges_.begin() + offsets_[i],
+                      edges_.begin() + offsets_[i + 1]);
+    tmp_offsets_.push_back(tmp_edges_.size());
+  }
+  edges_.swap(tmp_edges_);
+  offsets_.swap(tmp_offsets_);
+}
+
 bool Graph::GetDirectedLoops(LoopType loop_type, vector<EdgeLoop>* loops,
                              S2Error* error) const {
+  EdgeChains chains;
+  vector<InputEdgeId> min_input_ids;
+  if (!BuildDirectedLoops(loop_type, &chains, &min_input_ids, error)) {
+    return false;
+  }
+  for (int i = 0; i < chains.num_chains(); ++i) {
+    absl::Span<const EdgeId> loop = chains.chain(i);
+    loops->push_back(EdgeLoop(loop.begin(), loop.end()));
+  }
+  CanonicalizeVectorOrder(min_input_ids, loops);
+  return true;
+}
+
+bool Graph::GetDirectedLoops(LoopType loop_type, EdgeChains* loops,
+                             S2Error* error) const {
+  loops->Clear();
+  vector<InputEdgeId> min_input_ids;
+  if (!BuildDirectedLoops(loop_type, loops, &min_input_ids, error)) {
+    return false;
+  }
+  CanonicalizeVectorOrder(min_input_ids, loops);
+  return true;
+}
+
+bool Graph::BuildDirectedLoops(LoopType loop_type, EdgeChains* loops,
+                               vector<InputEdgeId>* min_input_ids_out,
+                               S2Error* error) const {
   S2_DCHECK(options_.degenerate_edges() == DegenerateEdges::DISCARD ||
          options_.degenerate_edges() == DegenerateEdges::DISCARD_EXCESS);
   S2_DCHECK(options_.edge_type() == EdgeType::DIRECTED);
 
   vector<EdgeId> left_turn_map;
   if (!GetLeftTurnMap(GetInEdgeIds(), &left_turn_map, error)) return false;
-  vector<InputEdgeId> min_input_ids = GetMinInputEdgeIds();
+  vector<InputEdgeId>& min_input_ids = *min_input_ids_out;
+  min_input_ids = GetMinInputEdgeIds();
 
   // If we are breaking loops at repeated vertices, we maintain a map from
   // VertexId to its position in "path".
@@ -382,22 +496,22 @@ bool Graph::GetDirectedLoops(LoopType loop_type, vector<EdgeLoop>* loops,
         int loop_start = path_index[edge(e).second];
         if (loop_start < 0) continue;
         // Peel off a loop from the path.
-        vector<EdgeId> loop(path.begin() + loop_start, path.end());
-        path.erase(path.begin() + loop_start, path.end());
+        absl::Span<EdgeId> loop(path.data() + loop_start,
+                                path.size() - loop_start);
         for (EdgeId e2 : loop) path_index[edge(e2).first] = -1;
-        CanonicalizeLoopOrder(min_input_ids, &loop);
-        loops->push_back(std::move(loop));
+        CanonicalizeLoopOrder(min_input_ids, loop);
+        loops->AddChain(loop);
+        path.erase(path.begin() + loop_start, path.end());
       }
     }
     if (loop_type == LoopType::SIMPLE) {
       S2_DCHECK(path.empty());  // Invariant.
     } else {
       CanonicalizeLoopOrder(min_input_ids, &path);
-      loops->push_back(std::move(path));
+      loops->AddChain(path);
       path.clear();
     }
   }
-  CanonicalizeVectorOrder(min_input_ids, loops);
   return true;
 }
 
@@ -594,13 +708,15 @@ bool Graph::GetUndirectedComponents(LoopType loop_type,
 class Graph::PolylineBuilder {
  public:
   explicit PolylineBuilder(const Graph& g);
-  vector<EdgePolyline> BuildPaths();
+  // Appends the paths to "polylines" without sorting them.
+  void BuildPaths(EdgeChains* polylines);
   vector<EdgePolyline> BuildWalks();
+  const vector<InputEdgeId>& min_input_ids() const { return min_input_ids_; }
 
  private:
   bool is_interior(VertexId v);
   int excess_degree(VertexId v);
-  EdgePolyline BuildPath(EdgeId e);
+  void BuildPath(EdgeId e, EdgePolyline* polyline);
   EdgePolyline BuildWalk(VertexId v);
   void MaximizeWalk(EdgePolyline* polyline);
 
@@ -623,12 +739,41 @@ vector<Graph::EdgePolyline> Graph::GetPolylines(
          options_.sibling_pairs() == SiblingPairs::KEEP);
   PolylineBuilder builder(*this);
   if (polyline_type == PolylineType::PATH) {
-    return builder.BuildPaths();
+    EdgeChains chains;
+    builder.BuildPaths(&chains);
+    vector<EdgePolyline> polylines;
+    polylines.reserve(chains.num_chains());
+    for (int i = 0; i < chains.num_chains(); ++i) {
+      absl::Span<const EdgeId> polyline = chains.chain(i);
+      polylines.push_back(EdgePolyline(polyline.begin(), polyline.end()));
+    }
+    // Sort the polylines to correspond to the input order (if possible).
+    CanonicalizeVectorOrder(builder.min_input_ids(), &polylines);
+    return polylines;
   } else {
     return builder.BuildWalks();
   }
 }
 
+void Graph::GetPolylines(PolylineType polyline_type,
+                         EdgeChains* polylines) const {
+  S2_DCHECK(options_.sibling_pairs() == SiblingPairs::DISCARD ||
+         options_.sibling_pairs() == SiblingPairs::DISCARD_EXCESS ||
+         options_.sibling_pairs() == SiblingPairs::KEEP);
+  polylines->Clear();
+  PolylineBuilder builder(*this);
+  if (polyline_type == PolylineType::PATH) {
+    builder.BuildPaths(polylines);
+    CanonicalizeVectorOrder(builder.min_input_ids(), polylines);
+  } else {
+    // Walks are extended by splicing loops into the middle of them (see
+    // MaximizeWalk), so they are built separately and then copied.
+    for (const EdgePolyline& polyline : builder.BuildWalks()) {
+      polylines->AddChain(polyline);
+    }
+  }
+}
+
 Graph::PolylineBuilder::PolylineBuilder(const Graph& g)
     : g_(g), in_(g), out_(g),
       min_input_ids_(g.GetMinInputEdgeIds()),
@@ -653,7 +798,7 @@ inline int Graph::PolylineBuilder::excess_degree(VertexId v) {
   return directed_ ? out_.degree(v) - in_.degree(v) : out_.degree(v) % 2;
 }
 
-vector<Graph::EdgePolyline> Graph::PolylineBuilder::BuildPaths() {
+void Graph::PolylineBuilder::BuildPaths(EdgeChains* polylines) {
   // First build polylines starting at all the vertices that cannot be in the
   // polyline interior (i.e., indegree != 1 or outdegree != 1 for directed
   // edges, or degree != 2 for undirected edges).  We consider the possible
@@ -661,11 +806,12 @@ vector<Graph::EdgePolyline> Graph::PolylineBuilder::BuildPaths() {
   // direction even when undirected edges are used.  (Undirected edges are
   // represented by sibling pairs where only the edge in the input direction
   // is labeled with an input edge id.)
-  vector<EdgePolyline> polylines;
+  EdgePolyline polyline;  // Reused for each path.
   vector<EdgeId> edges = g_.GetInputEdgeOrder(min_input_ids_);
   for (EdgeId e : edges) {
     if (!used_[e] && !is_interior(g_.edge(e).first)) {
-      polylines.push_back(BuildPath(e));
+      BuildPath(e, &polyline);
+      polylines->AddChain(polyline);
     }
   }
   // If there are any edges left, they form non-intersecting loops.  We build
@@ -677,25 +823,21 @@ vector<Graph::EdgePolyline> Graph::PolylineBuilder::BuildPaths() {
   for (EdgeId e : edges) {
     if (edges_left_ == 0) break;
     if (used_[e]) continue;
-    EdgePolyline polyline = BuildPath(e);
+    BuildPath(e, &polyline);
     CanonicalizeLoopOrder(min_input_ids_, &polyline);
-    polylines.push_back(std::move(polyline));
+    polylines->AddChain(polyline);
   }
   S2_DCHECK_EQ(0, edges_left_);
-
-  // Sort the polylines to correspond to the input order (if possible).
-  CanonicalizeVectorOrder(min_input_ids_, &polylines);
-  return polylines;
 }
 
-Graph::EdgePolyline Graph::PolylineBuilder::BuildPath(EdgeId e) {
+void Graph::PolylineBuilder::BuildPath(EdgeId e, EdgePolyline* polyline) {
   // We simply follow edges until either we reach a vertex where there is a
   // choice about which way to go (where is_interior(v) is false), or we
   // return to the starting vertex (if the polyline is actually a loop).
-  EdgePolyline polyline;
+  polyline->clear();
   VertexId start = g_.edge(e).first;
   for (;;) {
-    polyline.push_back(e);
+    polyline->push_back(e);
     S2_DCHECK(!used_[e]);
     used_[e] = true;
     if (!directed_) used_[sibling_map_[e]] = true;
@@ -710,7 +852,6 @@ Graph::EdgePolyline Graph::PolylineBuilder::BuildPath(EdgeId e) {
       for (EdgeId e2 : out_.edge_ids(v)) if (!used_[e2]) e = e2;
     }
   }
-  return polyline;
 }
 
 vector<Graph::EdgePolyline> Graph::PolylineBuilder::BuildWalks() {
@@ -884,14 +1025,8 @@ Graph::EdgeProcessor::EdgeProcessor(const GraphOptions& options,
   // Sort the outgoing and incoming edges in lexigraphic order.  We use a
   // stable sort to ensure that each undirected edge becomes a sibling pair,
   // even if there are multiple identical input edges.
-  std::iota(out_edges_.begin(), out_edges_.end(), 0);
-  std::sort(out_edges_.begin(), out_edges_.end(), [this](EdgeId a, EdgeId b) {
-      return StableLessThan(edges_[a], edges_[b], a, b);
-    });
-  std::iota(in_edges_.begin(), in_edges_.end(), 0);
-  std::sort(in_edges_.begin(), in_edges_.end(), [this](EdgeId a, EdgeId b) {
-      return StableLessThan(reverse(edges_[a]), reverse(edges_[b]), a, b);
-    });
+  SortEdgeIds(edges_, false /*reverse_edges*/, &out_edges_);
+  SortEdgeIds(edges_, true /*reverse_edges*/, &in_edges_);
   new_edges_.reserve(edges_.size());
   new_input_ids_.reserve(edges_.size());
 }
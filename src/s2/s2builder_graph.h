@@ -23,7 +23,9 @@
 #include <iterator>
 #include <utility>
 #include <vector>
+#include "s2/base/logging.h"
 #include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/id_set_lexicon.h"
 #include "s2/s2builder.h"
 #include "s2/s2error.h"
@@ -422,6 +424,10 @@ class S2Builder::Graph {
       const std::vector<InputEdgeId>& min_input_ids,
       std::vector<EdgeId>* loop);
 
+  // As above, but rotates the edges of a loop stored in an arbitrary array.
+  static void CanonicalizeLoopOrder(
+      const std::vector<InputEdgeId>& min_input_ids, absl::Span<EdgeId> loop);
+
   // Sorts the given edge chains (i.e., loops or polylines) by the minimum
   // input edge id of each chains's first edge.  This ensures that when the
   // output consists of multiple loops or polylines, they are sorted in the
@@ -430,6 +436,50 @@ class S2Builder::Graph {
       const std::vector<InputEdgeId>& min_input_ids,
       std::vector<std::vector<EdgeId>>* chains);
 
+  // A flat representation of a sequence of edge chains (i.e., loops or
+  // polylines), where the edges of all chains are stored in one vector.
+  // Unlike std::vector<EdgeLoop>, this does not allocate memory for each
+  // chain, and since Clear() retains the allocated memory, an EdgeChains
+  // object that is reused across calls (e.g. to the flat variants of
+  // GetDirectedLoops and GetPolylines) eventually stops allocating at all.
+  class EdgeChains {
+   public:
+    EdgeChains();
+
+    int num_chains() const;
+    int num_edges() const;  // Total number of edges in all chains.
+
+    // Returns the edges of the given chain.
+    // REQUIRES: 0 <= i < num_chains()
+    absl::Span<const EdgeId> chain(int i) const;
+
+    // Appends a chain consisting of the given edges.
+    void AddChain(absl::Span<const EdgeId> chain);
+
+    // Reorders the chains so that chain "i" is the chain that was previously
+    // at position order[i].
+    // REQUIRES: "order" is a permutation of [0, num_chains())
+    void Reorder(const std::vector<int>& order);
+
+    // Removes all chains but keeps the allocated memory.
+    void Clear();
+
+   private:
+    std::vector<EdgeId> edges_;
+    // Chain "i" consists of edges_[offsets_[i]] through
+    // edges_[offsets_[i + 1] - 1].  The first element is always zero.
+    std::vector<int> offsets_;
+    // Temporary storage used by Reorder().
+    std::vector<EdgeId> tmp_edges_;
+    std::vector<int> tmp_offsets_;
+  };
+
+  // Like CanonicalizeVectorOrder above, but for a flat set of edge chains.
+  // Chains whose first edges have the same minimum input edge id keep their
+  // relative order.
+  static void CanonicalizeVectorOrder(
+      const std::vector<InputEdgeId>& min_input_ids, EdgeChains* chains);
+
   // A loop consisting of a sequence of edges.
   using EdgeLoop = std::vector<EdgeId>;
 
@@ -460,6 +510,11 @@ class S2Builder::Graph {
   bool GetDirectedLoops(LoopType loop_type, std::vector<EdgeLoop>* loops,
                         S2Error* error) const;
 
+  // As above, but replaces the contents of "loops" with the loops in a flat
+  // representation.  This avoids allocating a vector for every loop.
+  bool GetDirectedLoops(LoopType loop_type, EdgeChains* loops,
+                        S2Error* error) const;
+
   // Builds loops from a set of directed edges, turning left at each vertex
   // until a repeated edge is found (i.e., LoopType::CIRCUIT).  The loops are
   // further grouped into connected components, where each component consists
@@ -567,6 +622,11 @@ class S2Builder::Graph {
   using EdgePolyline = std::vector<EdgeId>;
   std::vector<EdgePolyline> GetPolylines(PolylineType polyline_type) const;
 
+  // As above, but replaces the contents of "polylines" with the polylines in
+  // a flat representation.  For PolylineType::PATH this avoids allocating a
+  // vector for every polyline.
+  void GetPolylines(PolylineType polyline_type, EdgeChains* polylines) const;
+
   ////////////////////////////////////////////////////////////////////////
   //////////////// Helper Functions for Creating Graphs //////////////////
 
@@ -618,10 +678,24 @@ class S2Builder::Graph {
   static bool StableLessThan(const Edge& a, const Edge& b,
                              EdgeId ai, EdgeId bi);
 
+  // Sets "edge_ids" to the permutation of [0, edges.size()) that sorts the
+  // given edges according to StableLessThan.  If "reverse_edges" is true,
+  // the edges are sorted as though each one had been reversed first (as in
+  // GetInEdgeIds).  Large inputs are sorted using an LSD radix sort over the
+  // VertexId keys, which is much faster than std::sort for this purpose.
+  static void SortEdgeIds(const std::vector<Edge>& edges, bool reverse_edges,
+                          std::vector<EdgeId>* edge_ids);
+
  private:
   class EdgeProcessor;
   class PolylineBuilder;
 
+  // Builds the loops for GetDirectedLoops() and appends them to "loops"
+  // without sorting them, and sets "min_input_ids" to GetMinInputEdgeIds().
+  bool BuildDirectedLoops(LoopType loop_type, EdgeChains* loops,
+                          std::vector<InputEdgeId>* min_input_ids,
+                          S2Error* error) const;
+
   GraphOptions options_;
   VertexId num_vertices_;  // Cached to avoid division by 24.
 
@@ -779,6 +853,36 @@ S2Builder::Graph::is_full_polygon_predicate() const {
   return is_full_polygon_predicate_;
 }
 
+inline S2Builder::Graph::EdgeChains::EdgeChains() : offsets_(1, 0) {
+}
+
+inline int S2Builder::Graph::EdgeChains::num_chains() const {
+  return static_cast<int>(offsets_.size()) - 1;
+}
+
+inline int S2Builder::Graph::EdgeChains::num_edges() const {
+  return static_cast<int>(edges_.size());
+}
+
+inline absl::Span<const S2Builder::Graph::EdgeId>
+S2Builder::Graph::EdgeChains::chain(int i) const {
+  S2_DCHECK_GE(i, 0);
+  S2_DCHECK_LT(i, num_chains());
+  return absl::Span<const EdgeId>(edges_.data() + offsets_[i],
+                                  offsets_[i + 1] - offsets_[i]);
+}
+
+inline void S2Builder::Graph::EdgeChains::AddChain(
+    absl::Span<const EdgeId> chain) {
+  edges_.insert(edges_.end(), chain.begin(), chain.end());
+  offsets_.push_back(edges_.size());
+}
+
+inline void S2Builder::Graph::EdgeChains::Clear() {
+  edges_.clear();
+  offsets_.resize(1);
+}
+
 inline bool S2Builder::Graph::StableLessThan(
     const Edge& a, const Edge& b, EdgeId ai, EdgeId bi) {
   // The following is simpler but the compiler (2016) doesn't optimize it as
@@ -20,8 +20,10 @@
 
 #include "s2/s2builder_graph.h"
 
+#include <algorithm>
 #include <iosfwd>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -29,6 +31,7 @@
 #include "s2/id_set_lexicon.h"
 #include "s2/s2builderutil_testing.h"
 #include "s2/s2lax_polyline_shape.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using absl::make_unique;
@@ -79,6 +82,44 @@ TEST(GetDirectedLoops, DegenerateEdges) {
   EXPECT_EQ(loops[2].size(), 2);
 }
 
+// Checks that the flat representation "chains" has the same chains as
+// "expected".
+void ExpectSameChains(const vector<vector<EdgeId>>& expected,
+                      const Graph::EdgeChains& chains) {
+  ASSERT_EQ(expected.size(), chains.num_chains());
+  int num_edges = 0;
+  for (int i = 0; i < chains.num_chains(); ++i) {
+    absl::Span<const EdgeId> chain = chains.chain(i);
+    EXPECT_EQ(expected[i], vector<EdgeId>(chain.begin(), chain.end()));
+    num_edges += chain.size();
+  }
+  EXPECT_EQ(num_edges, chains.num_edges());
+}
+
+TEST(GetDirectedLoops, EdgeChainsMatchVectors) {
+  GraphClone gc;
+  S2Builder builder{S2Builder::Options()};
+  GraphOptions graph_options(
+      EdgeType::DIRECTED, DegenerateEdges::DISCARD_EXCESS,
+      DuplicateEdges::KEEP, SiblingPairs::KEEP);
+  builder.StartLayer(make_unique<GraphCloningLayer>(graph_options, &gc));
+  builder.AddShape(*MakeLaxPolylineOrDie("5:5, 5:7, 7:7, 7:5, 5:5"));
+  builder.AddShape(*MakeLaxPolylineOrDie("1:1, 1:1"));
+  builder.AddShape(*MakeLaxPolylineOrDie("0:0, 0:2, 2:2, 2:0, 0:0"));
+  builder.AddShape(*MakeLaxPolylineOrDie("0:3, 3:3, 0:3"));
+  S2Error error;
+  EXPECT_TRUE(builder.Build(&error));
+  const Graph& g = gc.graph();
+  Graph::EdgeChains chains;
+  chains.AddChain(vector<EdgeId>{0});  // Should be cleared.
+  for (auto loop_type : {LoopType::SIMPLE, LoopType::CIRCUIT}) {
+    vector<vector<EdgeId>> loops;
+    ASSERT_TRUE(g.GetDirectedLoops(loop_type, &loops, &error));
+    ASSERT_TRUE(g.GetDirectedLoops(loop_type, &chains, &error));
+    ExpectSameChains(loops, chains);
+  }
+}
+
 TEST(GetDirectedComponents, DegenerateEdges) {
   GraphClone gc;
   S2Builder builder{S2Builder::Options()};
@@ -149,6 +190,28 @@ TEST(GetPolylines, UndirectedDegeneratePaths) {
   EXPECT_EQ(polylines.size(), 7);
 }
 
+TEST(GetPolylines, EdgeChainsMatchVectors) {
+  for (auto edge_type : {EdgeType::DIRECTED, EdgeType::UNDIRECTED}) {
+    GraphClone gc;
+    S2Builder builder{S2Builder::Options()};
+    GraphOptions graph_options(edge_type, DegenerateEdges::KEEP,
+                               DuplicateEdges::KEEP, SiblingPairs::KEEP);
+    builder.StartLayer(make_unique<GraphCloningLayer>(graph_options, &gc));
+    builder.AddShape(*MakeLaxPolylineOrDie("0:0, 0:1, 1:1, 1:2"));
+    builder.AddShape(*MakeLaxPolylineOrDie("1:1, 2:1, 2:2"));
+    builder.AddShape(*MakeLaxPolylineOrDie("3:3, 3:4, 4:4, 3:3"));
+    builder.AddShape(*MakeLaxPolylineOrDie("5:5, 5:5"));
+    S2Error error;
+    EXPECT_TRUE(builder.Build(&error));
+    const Graph& g = gc.graph();
+    Graph::EdgeChains chains;
+    for (auto polyline_type : {PolylineType::PATH, PolylineType::WALK}) {
+      g.GetPolylines(polyline_type, &chains);
+      ExpectSameChains(g.GetPolylines(polyline_type), chains);
+    }
+  }
+}
+
 TEST(GetPolylines, UndirectedDegenerateWalks) {
   GraphClone gc;
   S2Builder builder{S2Builder::Options()};
@@ -461,4 +524,33 @@ TEST(ProcessEdges, CreateUndirectedSiblingPairsMergeDuplicates) {
   EXPECT_EQ(EdgeType::DIRECTED, options.edge_type());
 }
 
+TEST(SortEdgeIds, MatchesStableLessThan) {
+  // Test inputs on both sides of the radix sort threshold, with vertex ids
+  // small enough to produce many duplicate edges as well as large ones.
+  for (int num_edges : {0, 1, 100, 5000}) {
+    for (int max_vertex : {1, 50, 1 << 30}) {
+      vector<Edge> edges;
+      for (int i = 0; i < num_edges; ++i) {
+        edges.push_back(Edge(S2Testing::rnd.Uniform(max_vertex),
+                             S2Testing::rnd.Uniform(max_vertex)));
+      }
+      for (bool reverse_edges : {false, true}) {
+        vector<EdgeId> expected(num_edges);
+        std::iota(expected.begin(), expected.end(), 0);
+        std::sort(expected.begin(), expected.end(),
+                  [&edges, reverse_edges](EdgeId a, EdgeId b) {
+            if (!reverse_edges) {
+              return Graph::StableLessThan(edges[a], edges[b], a, b);
+            }
+            return Graph::StableLessThan(Graph::reverse(edges[a]),
+                                         Graph::reverse(edges[b]), a, b);
+          });
+        vector<EdgeId> actual;
+        Graph::SortEdgeIds(edges, reverse_edges, &actual);
+        EXPECT_EQ(expected, actual);
+      }
+    }
+  }
+}
+
 }  // namespace s2builder
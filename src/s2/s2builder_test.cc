@@ -24,10 +24,12 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "s2/base/commandlineflags.h"
 #include "s2/base/log_severity.h"
+#include "s2/base/mutex.h"
 #include "s2/base/timer.h"
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
@@ -51,6 +53,7 @@
 #include "s2/s2predicates.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::StrAppend;
 using absl::StrCat;
@@ -116,6 +119,39 @@ TEST(S2Builder, AddShape) {
   ExpectPolygonsEqual(*input, output);
 }
 
+TEST(S2Builder, RetainMemory) {
+  // Checks that a builder that keeps its memory between calls to Build()
+  // gives the same results as a new builder for each input.
+  S2Builder::Options options(IntLatLngSnapFunction(3));
+  options.set_split_crossing_edges(true);
+  options.set_retain_memory(true);
+  S2Builder reused(options);
+  for (int iter = 0; iter < 20; ++iter) {
+    // Vary the number of layers so that the retained layers are resized.
+    int num_layers = 1 + S2Testing::rnd.Uniform(3);
+    vector<unique_ptr<S2Loop>> loops;
+    for (int i = 0; i < num_layers; ++i) {
+      loops.push_back(S2Loop::MakeRegularLoop(
+          S2Testing::RandomPoint(), S1Angle::Degrees(10),
+          3 + S2Testing::rnd.Uniform(50)));
+    }
+    S2Builder fresh(options);
+    vector<S2Polygon> expected(num_layers), actual(num_layers);
+    for (int i = 0; i < num_layers; ++i) {
+      fresh.StartLayer(make_unique<S2PolygonLayer>(&expected[i]));
+      fresh.AddLoop(*loops[i]);
+      reused.StartLayer(make_unique<S2PolygonLayer>(&actual[i]));
+      reused.AddLoop(*loops[i]);
+    }
+    S2Error error;
+    ASSERT_TRUE(fresh.Build(&error)) << error;
+    ASSERT_TRUE(reused.Build(&error)) << error;
+    for (int i = 0; i < num_layers; ++i) {
+      EXPECT_TRUE(expected[i].Equals(&actual[i]));
+    }
+  }
+}
+
 TEST(S2Builder, SimpleVertexMerging) {
   // When IdentitySnapFunction is used (i.e., no special requirements on
   // vertex locations), check that vertices closer together than the snap
@@ -173,6 +209,35 @@ TEST(S2Builder, SimpleIntLatLngSnapping) {
   ExpectPolygonsEqual(*expected, output);
 }
 
+TEST(S2Builder, AddSnappedPolyline) {
+  // Adding E7 vertices with AddSnappedPolyline() yields the same output as
+  // adding them with AddPolyline() and snapping them again.
+  S2Testing::rnd.Reset(1);
+  IntLatLngSnapFunction snap_function(7);
+  S2Cap cap = S2Testing::GetRandomCap(1e-6, 1e-5);
+  vector<pair<int64, int64>> coords;
+  for (int i = 0; i < 100; ++i) {
+    S2LatLng ll(S2Testing::SamplePoint(cap));
+    coords.push_back(make_pair(ll.lat().e7(), ll.lng().e7()));
+  }
+  vector<S2Point> vertices;
+  snap_function.IntLatLngToPoints(coords, &vertices);
+  S2Polyline outputs[2];
+  for (int snapped = 0; snapped < 2; ++snapped) {
+    S2Builder builder{S2Builder::Options(snap_function)};
+    builder.StartLayer(make_unique<S2PolylineLayer>(&outputs[snapped]));
+    if (snapped) {
+      builder.AddSnappedPolyline(vertices);
+    } else {
+      builder.AddPolyline(S2Polyline(vertices));
+    }
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+  }
+  EXPECT_TRUE(outputs[0].Equals(&outputs[1]));
+  EXPECT_GT(outputs[0].num_vertices(), 1);
+}
+
 TEST(S2Builder, VerticesMoveLessThanSnapRadius) {
   // Check that chains of closely spaced vertices do not collapse into a
   // single vertex.
@@ -374,6 +439,27 @@ TEST(S2Builder, IdempotencyDoesNotSnapAdequatelySeparatedEdges) {
   EXPECT_EQ(expected, s2textformat::ToString(output2));
 }
 
+TEST(S2Builder, IdempotencyPreservesSnappedInput) {
+  // Checks that rebuilding geometry that was already snapped at a given
+  // S2CellId level does not change it, including geometry whose snapped
+  // vertices are close to other edges.
+  for (int level : {5, 10, 20}) {
+    S2Builder::Options options((S2CellIdSnapFunction(level)));
+    S2Builder builder(options);
+    S2Polygon snapped, output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&snapped));
+    builder.AddLoop(*S2Loop::MakeRegularLoop(
+        S2LatLng::FromDegrees(10, 20).ToPoint(), S1Angle::Degrees(5), 500));
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddPolygon(snapped);
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    EXPECT_TRUE(snapped.Equals(&output)) << level;
+    EXPECT_TRUE(output.IsValid());
+  }
+}
+
 TEST(S2Builder, kMaxSnapRadiusCanSnapAtLevel0) {
   // Verify that kMaxSnapRadius will allow snapping at S2CellId level 0.
   EXPECT_LE(S2CellIdSnapFunction::MinSnapRadiusForLevel(0),
@@ -1194,6 +1280,206 @@ TEST(S2Builder, SelfIntersectionStressTest) {
   }
 }
 
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(S2Builder, ExecutorDoesNotChangeOutput) {
+  // Builds self-intersecting polylines with and without an executor, and
+  // checks that the outputs are identical.
+  for (int iter = 0; iter < 10; ++iter) {
+    S2Testing::rnd.Reset(iter + 1);
+    S2Cap cap = S2Testing::GetRandomCap(1e-10, 1e-2);
+    S2Builder::Options options;
+    options.set_split_crossing_edges(true);
+    if (iter % 2 == 0) {
+      int exponent = IntLatLngSnapFunction::ExponentForMaxSnapRadius(
+          cap.GetRadius());
+      options.set_snap_function(IntLatLngSnapFunction(
+          min(IntLatLngSnapFunction::kMaxExponent,
+              exponent + S2Testing::rnd.Uniform(5))));
+    }
+    vector<S2Point> vertices(40);
+    for (S2Point& vertex : vertices) {
+      vertex = S2Testing::SamplePoint(cap);
+    }
+    S2Polyline input(vertices);
+
+    ThreadPerTaskExecutor executor;
+    vector<S2Point> outputs[2];
+    for (int parallel = 0; parallel < 2; ++parallel) {
+      options.set_executor(parallel ? &executor : nullptr);
+      S2Builder builder(options);
+      vector<unique_ptr<S2Polyline>> output;
+      builder.StartLayer(make_unique<S2PolylineVectorLayer>(&output));
+      builder.AddPolyline(input);
+      S2Error error;
+      ASSERT_TRUE(builder.Build(&error)) << error;
+      for (const auto& polyline : output) {
+        outputs[parallel].insert(outputs[parallel].end(),
+                                 &polyline->vertex(0),
+                                 &polyline->vertex(0) +
+                                 polyline->num_vertices());
+      }
+    }
+    EXPECT_EQ(outputs[0], outputs[1]);
+    EXPECT_GT(outputs[0].size(), vertices.size());
+  }
+}
+
+TEST(S2Builder, ExecutorDoesNotChangeSimplifiedEdgeChains) {
+  // Simplifies many independent edge chains (including a loop) with and
+  // without an executor, and checks that the outputs are identical.
+  S2Testing::rnd.Reset(1);
+  S2Cap cap = S2Testing::GetRandomCap(1e-3, 1e-2);
+  vector<unique_ptr<S2Polyline>> inputs;
+  for (int i = 0; i < 20; ++i) {
+    vector<S2Point> vertices(200);
+    S2Point start = S2Testing::SamplePoint(cap);
+    S2Point end = S2Testing::SamplePoint(cap);
+    for (int j = 0; j < vertices.size(); ++j) {
+      vertices[j] = S2::Interpolate(j / 199.0, start, end);
+    }
+    inputs.push_back(make_unique<S2Polyline>(vertices));
+  }
+  S2Polygon loop(S2Loop::MakeRegularLoop(cap.center(), S1Angle::Radians(1e-3),
+                                         200));
+  S2Builder::Options options(IdentitySnapFunction(S1Angle::Radians(1e-5)));
+  options.set_simplify_edge_chains(true);
+  ThreadPerTaskExecutor executor;
+  vector<S2Point> outputs[2];
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    options.set_executor(parallel ? &executor : nullptr);
+    S2Builder builder(options);
+    vector<unique_ptr<S2Polyline>> output;
+    builder.StartLayer(make_unique<S2PolylineVectorLayer>(&output));
+    for (const auto& input : inputs) builder.AddPolyline(*input);
+    S2Polygon polygon_output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&polygon_output));
+    builder.AddPolygon(loop);
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    for (const auto& polyline : output) {
+      outputs[parallel].insert(outputs[parallel].end(),
+                               &polyline->vertex(0),
+                               &polyline->vertex(0) +
+                               polyline->num_vertices());
+    }
+    const S2Loop* result = polygon_output.loop(0);
+    outputs[parallel].insert(outputs[parallel].end(), &result->vertex(0),
+                             &result->vertex(0) + result->num_vertices());
+  }
+  EXPECT_EQ(outputs[0], outputs[1]);
+  EXPECT_LT(outputs[0].size(), 4200);
+}
+
+TEST(S2Builder, BuildLayersInParallel) {
+  // Builds several independent layers concurrently and checks that the
+  // output of each one is the same as when they are built sequentially.
+  S2Testing::rnd.Reset(1);
+  const int kNumLayers = 6;
+  vector<unique_ptr<S2Polygon>> inputs;
+  for (int i = 0; i < kNumLayers; ++i) {
+    inputs.push_back(make_unique<S2Polygon>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S1Angle::Degrees(5), 100)));
+  }
+  // A layer that reports an error when built (since its input consists of
+  // two disjoint polylines), which should be returned regardless of whether
+  // the layers are built in parallel.
+  auto invalid0 = MakePolylineOrDie("0:0, 0:10");
+  auto invalid1 = MakePolylineOrDie("5:5, 5:6");
+
+  ThreadPerTaskExecutor executor;
+  S2Builder::Options options(IntLatLngSnapFunction(5));
+  options.set_executor(&executor);
+  S2Polygon outputs[2][kNumLayers];
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    options.set_build_layers_in_parallel(parallel);
+    S2Builder builder(options);
+    for (int i = 0; i < kNumLayers; ++i) {
+      builder.StartLayer(make_unique<S2PolygonLayer>(&outputs[parallel][i]));
+      builder.AddPolygon(*inputs[i]);
+    }
+    S2Polyline invalid_output;
+    builder.StartLayer(make_unique<S2PolylineLayer>(&invalid_output));
+    builder.AddPolyline(*invalid0);
+    builder.AddPolyline(*invalid1);
+    S2Error error;
+    EXPECT_FALSE(builder.Build(&error));
+    EXPECT_EQ(S2Error::BUILDER_EDGES_DO_NOT_FORM_POLYLINE, error.code());
+  }
+  for (int i = 0; i < kNumLayers; ++i) {
+    EXPECT_TRUE(outputs[0][i].Equals(&outputs[1][i]));
+    EXPECT_GT(outputs[0][i].num_vertices(), 0);
+  }
+}
+
+TEST(S2Builder, ProgressCallbackCanCancel) {
+  S2Polygon input(S2Loop::MakeRegularLoop(S2Point(1, 0, 0),
+                                          S1Angle::Degrees(10), 12000));
+  S2Builder::Options options(IntLatLngSnapFunction(4));
+
+  // Progress is reported in increasing order, and Build() completes normally
+  // when the callback never cancels it.
+  vector<double> fractions;
+  options.set_progress_callback([&fractions](double fraction) {
+      fractions.push_back(fraction);
+      return true;
+    });
+  {
+    S2Builder builder(options);
+    S2Polygon output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddPolygon(input);
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    EXPECT_FALSE(output.is_empty());
+  }
+  ASSERT_GT(fractions.size(), 3);
+  EXPECT_TRUE(std::is_sorted(fractions.begin(), fractions.end()));
+  EXPECT_EQ(0, fractions.front());
+  EXPECT_LE(fractions.back(), 1);
+
+  // Cancelling at any point yields S2Error::CANCELLED and leaves the output
+  // layers unbuilt.  The builder can then be reused.
+  const int num_fractions = fractions.size();
+  for (int cancel_at : {0, 1, num_fractions / 2, num_fractions - 1}) {
+    int num_calls = 0;
+    options.set_progress_callback([&num_calls, cancel_at](double fraction) {
+        return num_calls++ < cancel_at;
+      });
+    S2Builder builder(options);
+    S2Polygon output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddPolygon(input);
+    S2Error error;
+    EXPECT_FALSE(builder.Build(&error));
+    EXPECT_EQ(S2Error::CANCELLED, error.code());
+    EXPECT_EQ(cancel_at + 1, num_calls);
+    EXPECT_EQ(0, output.num_loops());
+
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddPolygon(input);
+    num_calls = -1000000;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    EXPECT_FALSE(output.is_empty());
+  }
+}
+
 TEST(S2Builder, FractalStressTest) {
   const int kIters = (google::DEBUG_MODE ? 100 : 1000) * FLAGS_iteration_multiplier;
   for (int iter = 0; iter < kIters; ++iter) {
@@ -0,0 +1,83 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_callback_layer.h"
+
+#include <utility>
+
+using std::vector;
+
+using EdgeType = S2Builder::EdgeType;
+using Graph = S2Builder::Graph;
+using GraphOptions = S2Builder::GraphOptions;
+
+using DegenerateEdges = GraphOptions::DegenerateEdges;
+using DuplicateEdges = GraphOptions::DuplicateEdges;
+using SiblingPairs = GraphOptions::SiblingPairs;
+
+using EdgeId = Graph::EdgeId;
+using LoopType = Graph::LoopType;
+
+namespace s2builderutil {
+
+LoopCallbackLayer::LoopCallbackLayer(LoopCallback callback)
+    : callback_(std::move(callback)) {
+}
+
+GraphOptions LoopCallbackLayer::graph_options() const {
+  // These are the same options that S2PolygonLayer uses for directed edges.
+  return GraphOptions(EdgeType::DIRECTED, DegenerateEdges::DISCARD,
+                      DuplicateEdges::KEEP, SiblingPairs::DISCARD);
+}
+
+void LoopCallbackLayer::Build(const Graph& g, S2Error* error) {
+  Graph::EdgeChains edge_loops;
+  if (!g.GetDirectedLoops(LoopType::SIMPLE, &edge_loops, error)) return;
+  vector<S2Point> vertices;  // Temporary storage for vertices.
+  for (int i = 0; i < edge_loops.num_chains(); ++i) {
+    for (EdgeId e : edge_loops.chain(i)) {
+      vertices.push_back(g.vertex(g.edge(e).first));
+    }
+    callback_(vertices);
+    vertices.clear();
+  }
+}
+
+PolylineCallbackLayer::PolylineCallbackLayer(PolylineCallback callback,
+                                             const Options& options)
+    : callback_(std::move(callback)), options_(options) {
+}
+
+GraphOptions PolylineCallbackLayer::graph_options() const {
+  return GraphOptions(options_.edge_type(), DegenerateEdges::DISCARD,
+                      options_.duplicate_edges(), options_.sibling_pairs());
+}
+
+void PolylineCallbackLayer::Build(const Graph& g, S2Error* error) {
+  Graph::EdgeChains edge_polylines;
+  g.GetPolylines(options_.polyline_type(), &edge_polylines);
+  vector<S2Point> vertices;  // Temporary storage for vertices.
+  for (int i = 0; i < edge_polylines.num_chains(); ++i) {
+    absl::Span<const EdgeId> edge_polyline = edge_polylines.chain(i);
+    vertices.push_back(g.vertex(g.edge(edge_polyline[0]).first));
+    for (EdgeId e : edge_polyline) {
+      vertices.push_back(g.vertex(g.edge(e).second));
+    }
+    callback_(vertices);
+    vertices.clear();
+  }
+}
+
+}  // namespace s2builderutil
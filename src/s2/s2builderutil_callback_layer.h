@@ -0,0 +1,99 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Layer types that pass the output of S2Builder to a callback one loop or
+// polyline at a time, rather than constructing S2Polygon or S2Polyline
+// objects.  This is useful when the output is only going to be serialized
+// or otherwise consumed once (e.g., when clipping geometry into tiles),
+// since it avoids constructing S2Loops, computing their bounds, and building
+// their spatial indexes.
+//
+// For example, the loops can be encoded as they are produced:
+//
+//   Encoder encoder;
+//   builder.StartLayer(absl::make_unique<s2builderutil::LoopCallbackLayer>(
+//       [&encoder](S2PointSpan loop) {
+//         s2coding::EncodeS2PointVector(loop, s2coding::CodingHint::COMPACT,
+//                                       &encoder);
+//       }));
+
+#ifndef S2_S2BUILDERUTIL_CALLBACK_LAYER_H_
+#define S2_S2BUILDERUTIL_CALLBACK_LAYER_H_
+
+#include <functional>
+#include <vector>
+
+#include "s2/s2builder.h"
+#include "s2/s2builder_graph.h"
+#include "s2/s2builder_layer.h"
+#include "s2/s2builderutil_s2polyline_vector_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+
+namespace s2builderutil {
+
+// A layer type that assembles directed edges into loops and passes the
+// vertices of each loop to a callback.  The edges must be oriented so that
+// the polygon interior is to the left of all edges (as S2Builder::AddLoop()
+// and S2Builder::AddPolygon() do automatically), and the loops are reported
+// in the same orientation.  Loops are reported in the same order that
+// S2PolygonLayer would construct them before nesting them, and (like
+// S2PolygonLayer) sibling edge pairs and degenerate edges are removed first.
+// Returns an error if the edges cannot be assembled into loops.
+//
+// Note that unlike S2PolygonLayer, the loops are not checked for validity
+// and no loop nesting is computed.
+class LoopCallbackLayer : public S2Builder::Layer {
+ public:
+  // The vertices are only valid for the duration of the call.
+  using LoopCallback = std::function<void(S2PointSpan vertices)>;
+
+  explicit LoopCallbackLayer(LoopCallback callback);
+
+  // Layer interface:
+  GraphOptions graph_options() const override;
+  void Build(const Graph& g, S2Error* error) override;
+
+ private:
+  LoopCallback callback_;
+};
+
+// A layer type that assembles edges into polylines (exactly as
+// S2PolylineVectorLayer does) and passes the vertices of each polyline to a
+// callback.  The validate() and s2debug_override() options are ignored since
+// no S2Polyline objects are constructed.
+class PolylineCallbackLayer : public S2Builder::Layer {
+ public:
+  using Options = S2PolylineVectorLayer::Options;
+
+  // The vertices are only valid for the duration of the call.
+  using PolylineCallback = std::function<void(S2PointSpan vertices)>;
+
+  explicit PolylineCallbackLayer(PolylineCallback callback,
+                                 const Options& options = Options());
+
+  // Layer interface:
+  GraphOptions graph_options() const override;
+  void Build(const Graph& g, S2Error* error) override;
+
+ private:
+  PolylineCallback callback_;
+  Options options_;
+};
+
+}  // namespace s2builderutil
+
+#endif  // S2_S2BUILDERUTIL_CALLBACK_LAYER_H_
@@ -0,0 +1,109 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_callback_layer.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/s2text_format.h"
+
+using absl::make_unique;
+using s2builderutil::LoopCallbackLayer;
+using s2builderutil::PolylineCallbackLayer;
+using s2textformat::MakePolygonOrDie;
+using s2textformat::MakePolylineOrDie;
+using std::string;
+using std::vector;
+
+using EdgeType = S2Builder::EdgeType;
+
+namespace {
+
+TEST(LoopCallbackLayer, ReportsPolygonLoops) {
+  auto input = MakePolygonOrDie("0:0, 0:10, 10:10, 10:0; 2:2, 8:2, 8:8");
+  S2Builder builder{S2Builder::Options()};
+  vector<string> loops;
+  builder.StartLayer(make_unique<LoopCallbackLayer>(
+      [&loops](S2PointSpan vertices) {
+        loops.push_back(s2textformat::ToString(
+            S2Loop(vector<S2Point>(vertices.begin(), vertices.end()))));
+      }));
+  builder.AddPolygon(*input);
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  // Unlike in S2Polygon, holes are oriented clockwise.
+  ASSERT_EQ(2, loops.size());
+  EXPECT_EQ("0:0, 0:10, 10:10, 10:0", loops[0]);
+  EXPECT_EQ("2:2, 8:2, 8:8", loops[1]);
+}
+
+TEST(LoopCallbackLayer, SnappedLoopsMatchS2PolygonLayer) {
+  // Assembling the reported loops into a polygon should give the same
+  // result as S2PolygonLayer.
+  auto input = MakePolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 2:2, 8:2, 8:8, 2:8; 0:20, 0:25, 5:25; "
+      "0.1:10.1, 0.2:10.6, 0.6:10.2");
+  S2Builder::Options options(s2builderutil::IntLatLngSnapFunction(0));
+  vector<std::unique_ptr<S2Loop>> loops;
+  S2Builder builder(options);
+  builder.StartLayer(make_unique<LoopCallbackLayer>(
+      [&loops](S2PointSpan vertices) {
+        loops.push_back(make_unique<S2Loop>(
+            vector<S2Point>(vertices.begin(), vertices.end())));
+      }));
+  builder.AddPolygon(*input);
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+
+  S2Polygon expected;
+  S2Builder expected_builder(options);
+  expected_builder.StartLayer(
+      make_unique<s2builderutil::S2PolygonLayer>(&expected));
+  expected_builder.AddPolygon(*input);
+  ASSERT_TRUE(expected_builder.Build(&error)) << error;
+
+  S2Polygon actual;
+  actual.InitOriented(std::move(loops));
+  EXPECT_TRUE(expected.Equals(&actual));
+}
+
+TEST(PolylineCallbackLayer, ReportsPolylines) {
+  S2Builder builder{S2Builder::Options()};
+  vector<string> polylines;
+  builder.StartLayer(make_unique<PolylineCallbackLayer>(
+      [&polylines](S2PointSpan vertices) {
+        polylines.push_back(s2textformat::ToString(
+            vector<S2Point>(vertices.begin(), vertices.end())));
+      }));
+  builder.AddPolyline(*MakePolylineOrDie("0:0, 0:5, 5:5"));
+  builder.AddPolyline(*MakePolylineOrDie("10:10, 10:15"));
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  ASSERT_EQ(2, polylines.size());
+  EXPECT_EQ("0:0, 0:5, 5:5", polylines[0]);
+  EXPECT_EQ("10:10, 10:15", polylines[1]);
+}
+
+}  // namespace
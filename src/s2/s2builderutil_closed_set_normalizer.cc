@@ -75,10 +75,17 @@ const vector<Graph>& ClosedSetNormalizer::Run(
   for (int dim = 0; dim < 3; ++dim) {
     S2_DCHECK(g[dim].options() == graph_options_in_[dim]);
   }
+  // Clear the output of any previous call (but keep the allocated memory).
+  new_graphs_.clear();
+  for (int dim = 0; dim < 3; ++dim) {
+    new_edges_[dim].clear();
+    new_input_edge_ids_[dim].clear();
+  }
+  in_edges2_.clear();
   if (options_.suppress_lower_dimensions()) {
     // Build the auxiliary data needed to suppress lower-dimensional edges.
     in_edges2_ = g[2].GetInEdgeIds();
-    is_suppressed_.resize(g[0].vertices().size());
+    is_suppressed_.assign(g[0].vertices().size(), false);
     for (int dim = 1; dim <= 2; ++dim) {
       for (int e = 0; e < g[dim].num_edges(); ++e) {
         Edge edge = g[dim].edge(e);
@@ -90,41 +97,48 @@ const vector<Graph>& ClosedSetNormalizer::Run(
     }
   }
 
-  // Compute the edges that belong in the output graphs.
-  NormalizeEdges(g, error);
-
-  // If any edges were added or removed, we need to run Graph::ProcessEdges to
-  // ensure that the edges satisfy the requested GraphOptions.  Note that
-  // since edges are never added to dimension 2, we can use the edge count to
-  // test whether any edges were removed.  If no edges were removed from
-  // dimension 2, then no edges were added to dimension 1, and so we can again
-  // use the edge count to test whether any edges were removed, etc.
-  bool modified[3];
-  bool any_modified = false;
-  for (int dim = 2; dim >= 0; --dim) {
-    if (new_edges_[dim].size() != g[dim].num_edges()) any_modified = true;
-    modified[dim] = any_modified;
+  // Real-world input rarely has any degeneracies, so we first check whether
+  // normalization would leave the graphs unchanged.  This takes linear time
+  // and avoids copying the edges of every dimension.
+  bool modified[3] = {false, false, false};
+  bool any_modified = !IsNormalized(g);
+  if (any_modified) {
+    // Compute the edges that belong in the output graphs.
+    NormalizeEdges(g, error);
+
+    // If any edges were added or removed, we need to run Graph::ProcessEdges
+    // to ensure that the edges satisfy the requested GraphOptions.  Note that
+    // since edges are never added to dimension 2, we can use the edge count
+    // to test whether any edges were removed.  If no edges were removed from
+    // dimension 2, then no edges were added to dimension 1, and so we can
+    // again use the edge count to test whether any edges were removed, etc.
+    any_modified = false;
+    for (int dim = 2; dim >= 0; --dim) {
+      if (new_edges_[dim].size() != g[dim].num_edges()) any_modified = true;
+      modified[dim] = any_modified;
+    }
   }
-  if (!any_modified) {
-    for (int dim = 0; dim < 3; ++dim) {
-      // Copy the graphs to ensure that they have the GraphOptions that were
-      // originally requested.
+  if (any_modified) {
+    // Make a copy of input_edge_id_set_lexicon() so that ProcessEdges can
+    // merge edges if necessary.
+    new_input_edge_id_set_lexicon_ = g[0].input_edge_id_set_lexicon();
+  }
+  for (int dim = 0; dim < 3; ++dim) {
+    if (!modified[dim]) {
+      // The edges are unchanged, so the output graph refers to the input
+      // data directly.  (It is still copied to ensure that it has the
+      // GraphOptions that were originally requested.)
+      new_edges_[dim].clear();
+      new_input_edge_ids_[dim].clear();
       new_graphs_.push_back(Graph(
           graph_options_out_[dim], &g[dim].vertices(), &g[dim].edges(),
           &g[dim].input_edge_id_set_ids(), &g[dim].input_edge_id_set_lexicon(),
           &g[dim].label_set_ids(), &g[dim].label_set_lexicon(),
           g[dim].is_full_polygon_predicate()));
-    }
-  } else {
-    // Make a copy of input_edge_id_set_lexicon() so that ProcessEdges can
-    // merge edges if necessary.
-    new_input_edge_id_set_lexicon_ = g[0].input_edge_id_set_lexicon();
-    for (int dim = 0; dim < 3; ++dim) {
-      if (modified[dim]) {
-        Graph::ProcessEdges(&graph_options_out_[dim], &new_edges_[dim],
-                            &new_input_edge_ids_[dim],
-                            &new_input_edge_id_set_lexicon_, error);
-      }
+    } else {
+      Graph::ProcessEdges(&graph_options_out_[dim], &new_edges_[dim],
+                          &new_input_edge_ids_[dim],
+                          &new_input_edge_id_set_lexicon_, error);
       new_graphs_.push_back(Graph(
           graph_options_out_[dim], &g[dim].vertices(), &new_edges_[dim],
           &new_input_edge_ids_[dim], &new_input_edge_id_set_lexicon_,
@@ -135,6 +149,62 @@ const vector<Graph>& ClosedSetNormalizer::Run(
   return new_graphs_;
 }
 
+// Returns true if NormalizeEdges() would leave the given graphs unchanged,
+// i.e. there are no polyline or polygon degeneracies and (if lower
+// dimensions are being suppressed) no point or polyline edge coincides with
+// a higher-dimensional edge.  Requires the auxiliary data built by Run().
+bool ClosedSetNormalizer::IsNormalized(const vector<Graph>& g) const {
+  // Degenerate polyline edges become points, and degenerate polygon edges
+  // become points or are discarded.
+  for (int dim = 1; dim <= 2; ++dim) {
+    for (const Edge& edge : g[dim].edges()) {
+      if (edge.first == edge.second) return false;
+    }
+  }
+  // Polygon sibling pairs become polyline edges or are discarded.
+  if (options_.suppress_lower_dimensions()) {
+    if (HasReversedEdge(g[2], g[2], in_edges2_)) return false;
+  } else {
+    if (HasReversedEdge(g[2], g[2], g[2].GetInEdgeIds())) return false;
+  }
+  if (!options_.suppress_lower_dimensions()) return true;
+
+  for (const Edge& edge : g[0].edges()) {
+    if (is_suppressed_[edge.first]) return false;
+  }
+  // Check for polyline edges that match a polygon edge in either direction.
+  EdgeId e1 = -1, e2 = -1;
+  Edge edge1 = Advance(g[1], &e1), edge2 = Advance(g[2], &e2);
+  while (edge1 != sentinel_ && edge2 != sentinel_) {
+    if (edge1 == edge2) return false;
+    if (edge1 < edge2) {
+      edge1 = Advance(g[1], &e1);
+    } else {
+      edge2 = Advance(g[2], &e2);
+    }
+  }
+  return !HasReversedEdge(g[1], g[2], in_edges2_);
+}
+
+// Returns true if some edge of "a" is the reverse of an edge of "b", where
+// "b_in_edges" is the result of b.GetInEdgeIds().
+bool ClosedSetNormalizer::HasReversedEdge(
+    const Graph& a, const Graph& b, const vector<EdgeId>& b_in_edges) const {
+  EdgeId e = -1;
+  int in_e = -1;
+  Edge edge = Advance(a, &e);
+  Edge in_edge = AdvanceIncoming(b, b_in_edges, &in_e);
+  while (edge != sentinel_ && in_edge != sentinel_) {
+    if (edge == in_edge) return true;
+    if (edge < in_edge) {
+      edge = Advance(a, &e);
+    } else {
+      in_edge = AdvanceIncoming(b, b_in_edges, &in_e);
+    }
+  }
+  return false;
+}
+
 // Helper function that advances to the next edge in the given graph,
 // returning a sentinel value once all edges are exhausted.
 inline Edge ClosedSetNormalizer::Advance(const Graph& g, EdgeId* e) const {
@@ -128,6 +128,10 @@ class ClosedSetNormalizer {
   S2Builder::Graph::Edge AdvanceIncoming(
       const S2Builder::Graph& g,
       const std::vector<S2Builder::Graph::EdgeId>& in_edges, int* i) const;
+  bool IsNormalized(const std::vector<S2Builder::Graph>& g) const;
+  bool HasReversedEdge(
+      const S2Builder::Graph& a, const S2Builder::Graph& b,
+      const std::vector<S2Builder::Graph::EdgeId>& b_in_edges) const;
   void NormalizeEdges(const std::vector<S2Builder::Graph>& g, S2Error* error);
   void AddEdge(int new_dim, const S2Builder::Graph& g,
                S2Builder::Graph::EdgeId e);
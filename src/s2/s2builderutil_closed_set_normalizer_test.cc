@@ -53,7 +53,8 @@ namespace s2builderutil {
 // and the S2Builder::GraphOptions for each of the three output layers.
 class NormalizeTest : public testing::Test {
  public:
-  NormalizeTest() : suppress_lower_dimensions_(true) {
+  NormalizeTest()
+      : suppress_lower_dimensions_(true), expect_input_edges_(false) {
     // Set the default GraphOptions for building S2Points, S2Polylines, and
     // S2Polygons.  Tests can modify these options as necessary.  Most of the
     // defaults are KEEP so that we can verify edge counts in some cases.
@@ -75,6 +76,9 @@ class NormalizeTest : public testing::Test {
 
  protected:
   bool suppress_lower_dimensions_;
+  // If true, checks that the output graphs refer to the input edge vectors
+  // (i.e., that the input was recognized as already being normalized).
+  bool expect_input_edges_;
   vector<GraphOptions> graph_options_out_;
 
  private:
@@ -100,9 +104,20 @@ void NormalizeTest::Run(const string& input_str,
   EXPECT_TRUE(builder.Build(&error)) << error;
 
   const vector<Graph>& actual = normalizer.Run(input, &error);
+  vector<string> actual_strs;
   for (int dim = 0; dim < 3; ++dim) {
     EXPECT_TRUE(expected[dim].options() == actual[dim].options());
     EXPECT_EQ(ToString(expected[dim]), ToString(actual[dim])) << "dim=" << dim;
+    if (expect_input_edges_) {
+      EXPECT_EQ(&input[dim].edges(), &actual[dim].edges()) << "dim=" << dim;
+    }
+    actual_strs.push_back(ToString(actual[dim]));
+  }
+  // Running the same normalizer again should produce the same output.
+  const vector<Graph>& again = normalizer.Run(input, &error);
+  ASSERT_EQ(3, again.size());
+  for (int dim = 0; dim < 3; ++dim) {
+    EXPECT_EQ(actual_strs[dim], ToString(again[dim])) << "dim=" << dim;
   }
 }
 
@@ -144,6 +159,14 @@ TEST_F(NormalizeTest, NonDegenerateInputs) {
       "0:0 # 1:0, 1:1 | 1:2, 1:3 # 2:2, 2:3, 3:2");
 }
 
+TEST_F(NormalizeTest, NonDegenerateInputsAreNotCopied) {
+  expect_input_edges_ = true;
+  Run("0:0 # 1:0, 1:1 | 1:2, 1:3 # 2:2, 2:3, 3:2",
+      "0:0 # 1:0, 1:1 | 1:2, 1:3 # 2:2, 2:3, 3:2");
+  suppress_lower_dimensions_ = false;
+  Run("2:2 # 2:2, 2:3 # 2:2, 2:3, 3:2", "2:2 # 2:2, 2:3 # 2:2, 2:3, 3:2");
+}
+
 TEST_F(NormalizeTest, PointShell) {
   Run("# # 0:0", "0:0 # #");
 }
@@ -17,6 +17,7 @@
 
 #include "s2/s2builderutil_find_polygon_degeneracies.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <utility>
 #include <vector>
@@ -24,6 +25,7 @@
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2builder_graph.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2contains_vertex_query.h"
 #include "s2/s2crossing_edge_query.h"
 #include "s2/s2edge_crosser.h"
@@ -57,6 +59,9 @@ struct Component {
   // The root vertex from which this component was built.
   VertexId root;
 
+  // The S2CellId containing the root vertex (used for sorting).
+  S2CellId root_id;
+
   // +1 if "root" inside the polygon, -1 if outside, and 0 if unknown.
   int root_sign = 0;
 
@@ -155,6 +160,18 @@ vector<PolygonDegeneracy> DegeneracyFinder::Run(S2Error* error) {
       known_vertex = FindUnbalancedVertex();
       known_vertex_sign = ContainsVertexSign(known_vertex);
     }
+    // Rather than counting crossings along an edge from "known_vertex" to
+    // every root, we visit the components in S2CellId order and count the
+    // crossings from the previous root (whose sign is then known).  Nearby
+    // components are usually adjacent in this order, so the edges are short
+    // and cross few polygon edges (and few index cells).
+    for (Component& component : components) {
+      component.root_id = S2CellId(g_.vertex(component.root));
+    }
+    std::sort(components.begin(), components.end(),
+              [](const Component& a, const Component& b) {
+                return a.root_id < b.root_id;
+              });
     const int kMaxUnindexedContainsCalls = 20;  // Tuned using benchmarks.
     if (num_unknown_signs <= kMaxUnindexedContainsCalls) {
       ComputeUnknownSignsBruteForce(known_vertex, known_vertex_sign,
@@ -290,8 +307,9 @@ int DegeneracyFinder::ContainsVertexSign(VertexId v0) const {
 }
 
 // Determines any unknown signs of component root vertices by counting
-// crossings starting from a vertex whose sign is known.  This version simply
-// tests all edges for crossings.
+// crossings starting from a vertex whose sign is known.  Each root whose sign
+// is determined becomes the starting vertex for the next component.  This
+// version simply tests all edges for crossings.
 void DegeneracyFinder::ComputeUnknownSignsBruteForce(
     VertexId known_vertex, int known_vertex_sign,
     vector<Component>* components) const {
@@ -307,6 +325,8 @@ void DegeneracyFinder::ComputeUnknownSignsBruteForce(
                                              &g_.vertex(edge.second));
     }
     component.root_sign = inside ? 1 : -1;
+    known_vertex = component.root;
+    known_vertex_sign = component.root_sign;
   }
 }
 
@@ -357,6 +377,8 @@ void DegeneracyFinder::ComputeUnknownSignsIndexed(
                                              &g_.vertex(g_.edge(e).second));
     }
     component.root_sign = inside ? 1 : -1;
+    known_vertex = component.root;
+    known_vertex_sign = component.root_sign;
   }
 }
 
@@ -31,6 +31,7 @@
 #include "s2/s2text_format.h"
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
+#include "s2/third_party/absl/strings/str_cat.h"
 
 using absl::make_unique;
 using std::unique_ptr;
@@ -179,4 +180,23 @@ TEST(FindPolygonDegeneracies, SiblingPairHolesWithinFull) {
     });
 }
 
+TEST(FindPolygonDegeneracies, ManyPointShellsAndHoles) {
+  // Enough degenerate components are present that their signs are computed
+  // using an index, and the components inside and outside the loop are
+  // interleaved when sorted by S2CellId.
+  string polygon_str = "0:0, 0:10, 10:10, 10:0";
+  vector<TestDegeneracy> expected;
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      for (int lng : {1 + 2 * j, 11 + 2 * j}) {
+        string point = absl::StrCat(1 + 2 * i, ":", lng);
+        polygon_str += "; " + point;
+        expected.push_back(
+            TestDegeneracy(point + ", " + point, lng < 10 /*is_hole*/));
+      }
+    }
+  }
+  ExpectDegeneracies(polygon_str, expected);
+}
+
 }  // namespace s2builderutil
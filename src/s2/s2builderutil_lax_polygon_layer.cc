@@ -0,0 +1,86 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2builderutil_lax_polygon_layer.h"
+
+#include <vector>
+#include "s2/third_party/absl/types/span.h"
+
+using absl::Span;
+using std::vector;
+
+using EdgeType = S2Builder::EdgeType;
+using Graph = S2Builder::Graph;
+using GraphOptions = S2Builder::GraphOptions;
+
+using DegenerateEdges = GraphOptions::DegenerateEdges;
+using DuplicateEdges = GraphOptions::DuplicateEdges;
+using SiblingPairs = GraphOptions::SiblingPairs;
+
+using LoopType = Graph::LoopType;
+
+namespace s2builderutil {
+
+using DegenerateBoundaries = LaxPolygonLayer::Options::DegenerateBoundaries;
+
+LaxPolygonLayer::LaxPolygonLayer(S2LaxPolygonShape* polygon,
+                                 const Options& options)
+    : polygon_(polygon), options_(options) {
+}
+
+GraphOptions LaxPolygonLayer::graph_options() const {
+  // As with S2PolygonLayer, duplicate edges are kept since this tends to
+  // produce more comprehensible errors for invalid input.
+  if (options_.degenerate_boundaries() == DegenerateBoundaries::DISCARD) {
+    return GraphOptions(EdgeType::DIRECTED, DegenerateEdges::DISCARD,
+                        DuplicateEdges::KEEP, SiblingPairs::DISCARD);
+  } else {
+    return GraphOptions(EdgeType::DIRECTED, DegenerateEdges::DISCARD_EXCESS,
+                        DuplicateEdges::KEEP, SiblingPairs::DISCARD_EXCESS);
+  }
+}
+
+void LaxPolygonLayer::Build(const Graph& g, S2Error* error) {
+  // Simple loops are needed when sibling pairs are discarded, whereas
+  // circuits allow a degenerate shell or hole to be traced as part of the
+  // loop that it touches.
+  LoopType loop_type =
+      (options_.degenerate_boundaries() == DegenerateBoundaries::DISCARD) ?
+      LoopType::SIMPLE : LoopType::CIRCUIT;
+  Graph::EdgeChains edge_loops;
+  if (!g.GetDirectedLoops(loop_type, &edge_loops, error)) return;
+
+  // Gather the vertices of all loops into a single vector, which
+  // S2LaxPolygonShape then copies into its own flat array.
+  vector<S2Point> vertices;
+  vertices.reserve(edge_loops.num_edges());
+  for (int i = 0; i < edge_loops.num_chains(); ++i) {
+    for (Graph::EdgeId e : edge_loops.chain(i)) {
+      vertices.push_back(g.vertex(g.edge(e).first));
+    }
+  }
+  vector<Span<const S2Point>> loops;
+  loops.reserve(edge_loops.num_chains());
+  const S2Point* loop_begin = vertices.data();
+  for (int i = 0; i < edge_loops.num_chains(); ++i) {
+    int n = edge_loops.chain(i).size();
+    loops.push_back(Span<const S2Point>(loop_begin, n));
+    loop_begin += n;
+  }
+  polygon_->Init(loops);
+}
+
+}  // namespace s2builderutil
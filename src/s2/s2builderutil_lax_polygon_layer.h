@@ -0,0 +1,143 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2BUILDERUTIL_LAX_POLYGON_LAYER_H_
+#define S2_S2BUILDERUTIL_LAX_POLYGON_LAYER_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include "s2/base/logging.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2builder.h"
+#include "s2/s2builder_graph.h"
+#include "s2/s2builder_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+
+namespace s2builderutil {
+
+// A layer type that assembles directed edges into an S2LaxPolygonShape.
+// Returns an error if the edges cannot be assembled into loops.
+//
+// Unlike S2PolygonLayer, this layer does not construct any S2Loop objects or
+// compute loop nesting: the loops are written directly into the flat vertex
+// array of the S2LaxPolygonShape.  This makes it much cheaper when the
+// output is only going to be added to an S2ShapeIndex (see
+// IndexedLaxPolygonLayer below).
+//
+// The input edges must be oriented such that the polygon interior is to the
+// left of all edges (S2Builder::AddPolygon() does this automatically).  The
+// output loops have the same orientation; in particular, holes are oriented
+// clockwise as required by S2LaxPolygonShape.
+//
+// CAVEAT: Because polygons are constructed from their boundaries, this method
+// cannot distinguish between the empty and full polygons.  An empty boundary
+// always yields an empty polygon (see also S2PolygonLayer).
+class LaxPolygonLayer : public S2Builder::Layer {
+ public:
+  class Options {
+   public:
+    // Specifies whether degenerate boundaries (i.e., degenerate edges and
+    // sibling edge pairs, which represent zero-area shells or holes) should
+    // be kept in the output.  If DISCARD, they are removed before the loops
+    // are assembled (as in S2PolygonLayer).  If KEEP, each degenerate edge
+    // becomes a loop with one vertex and sibling pairs become part of the
+    // loops that contain them (see Graph::GetDirectedLoops and
+    // LoopType::CIRCUIT).
+    enum class DegenerateBoundaries { DISCARD, KEEP };
+
+    // Constructor that uses the default options (listed below).
+    Options();
+
+    // Constructor that specifies how degenerate boundaries are handled.
+    explicit Options(DegenerateBoundaries degenerate_boundaries);
+
+    // DEFAULT: DegenerateBoundaries::KEEP
+    DegenerateBoundaries degenerate_boundaries() const;
+    void set_degenerate_boundaries(DegenerateBoundaries degenerate_boundaries);
+
+   private:
+    DegenerateBoundaries degenerate_boundaries_;
+  };
+
+  // Specifies that a polygon should be constructed using the given options.
+  explicit LaxPolygonLayer(S2LaxPolygonShape* polygon,
+                           const Options& options = Options());
+
+  // Layer interface:
+  GraphOptions graph_options() const override;
+  void Build(const Graph& g, S2Error* error) override;
+
+ private:
+  S2LaxPolygonShape* polygon_;
+  Options options_;
+};
+
+// Like LaxPolygonLayer, but adds the polygon to a MutableS2ShapeIndex (if the
+// polygon is non-empty).
+class IndexedLaxPolygonLayer : public S2Builder::Layer {
+ public:
+  using Options = LaxPolygonLayer::Options;
+  explicit IndexedLaxPolygonLayer(MutableS2ShapeIndex* index,
+                                  const Options& options = Options())
+      : index_(index), polygon_(new S2LaxPolygonShape),
+        layer_(polygon_.get(), options) {}
+
+  GraphOptions graph_options() const override {
+    return layer_.graph_options();
+  }
+
+  void Build(const Graph& g, S2Error* error) override {
+    layer_.Build(g, error);
+    if (error->ok() && polygon_->num_loops() > 0) {
+      index_->Add(std::move(polygon_));
+    }
+  }
+
+ private:
+  MutableS2ShapeIndex* index_;
+  std::unique_ptr<S2LaxPolygonShape> polygon_;
+  LaxPolygonLayer layer_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline LaxPolygonLayer::Options::Options()
+    : degenerate_boundaries_(DegenerateBoundaries::KEEP) {
+}
+
+inline LaxPolygonLayer::Options::Options(
+    DegenerateBoundaries degenerate_boundaries)
+    : degenerate_boundaries_(degenerate_boundaries) {
+}
+
+inline LaxPolygonLayer::Options::DegenerateBoundaries
+LaxPolygonLayer::Options::degenerate_boundaries() const {
+  return degenerate_boundaries_;
+}
+
+inline void LaxPolygonLayer::Options::set_degenerate_boundaries(
+    DegenerateBoundaries degenerate_boundaries) {
+  degenerate_boundaries_ = degenerate_boundaries;
+}
+
+}  // namespace s2builderutil
+
+#endif  // S2_S2BUILDERUTIL_LAX_POLYGON_LAYER_H_
@@ -0,0 +1,145 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2builderutil_lax_polygon_layer.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2latlng.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using s2builderutil::IndexedLaxPolygonLayer;
+using s2builderutil::LaxPolygonLayer;
+using s2textformat::MakeLaxPolygonOrDie;
+using s2textformat::MakePolygonOrDie;
+using std::unique_ptr;
+
+using DegenerateBoundaries = LaxPolygonLayer::Options::DegenerateBoundaries;
+
+namespace {
+
+// Builds "input" (a string in s2textformat::MakeLaxPolygon format) using the
+// given options and returns the resulting loop sizes.
+std::vector<int> GetLoopSizes(const char* input,
+                              DegenerateBoundaries degenerate_boundaries) {
+  S2Builder builder{S2Builder::Options()};
+  S2LaxPolygonShape output;
+  builder.StartLayer(make_unique<LaxPolygonLayer>(
+      &output, LaxPolygonLayer::Options(degenerate_boundaries)));
+  builder.AddShape(*MakeLaxPolygonOrDie(input));
+  S2Error error;
+  EXPECT_TRUE(builder.Build(&error)) << error;
+  std::vector<int> sizes;
+  for (int i = 0; i < output.num_loops(); ++i) {
+    sizes.push_back(output.num_loop_vertices(i));
+  }
+  return sizes;
+}
+
+TEST(LaxPolygonLayer, Empty) {
+  for (auto db : {DegenerateBoundaries::DISCARD, DegenerateBoundaries::KEEP}) {
+    EXPECT_TRUE(GetLoopSizes("empty", db).empty());
+  }
+}
+
+TEST(LaxPolygonLayer, MatchesS2Polygon) {
+  // The output should have the same interior as the input polygon, with
+  // holes oriented clockwise.
+  auto polygon = MakePolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 2:2, 8:2, 8:8, 2:8; 20:20, 20:25, 25:20");
+  S2Builder builder{S2Builder::Options()};
+  auto output = make_unique<S2LaxPolygonShape>();
+  builder.StartLayer(make_unique<LaxPolygonLayer>(output.get()));
+  builder.AddPolygon(*polygon);
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  EXPECT_EQ(3, output->num_loops());
+  EXPECT_EQ(polygon->num_vertices(), output->num_vertices());
+
+  MutableS2ShapeIndex index;
+  index.Add(std::move(output));
+  auto query = MakeS2ContainsPointQuery(&index);
+  S2Cap cap = polygon->GetCapBound().Expanded(S1Angle::Degrees(1));
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2Point p = S2Testing::SamplePoint(cap);
+    EXPECT_EQ(polygon->Contains(p), query.Contains(p));
+  }
+}
+
+TEST(LaxPolygonLayer, DegenerateBoundaries) {
+  // A degenerate edge and a sibling pair on their own.
+  EXPECT_TRUE(GetLoopSizes("1:1", DegenerateBoundaries::DISCARD).empty());
+  EXPECT_EQ(std::vector<int>({1}),
+            GetLoopSizes("1:1", DegenerateBoundaries::KEEP));
+  EXPECT_TRUE(GetLoopSizes("1:1, 2:2", DegenerateBoundaries::DISCARD).empty());
+  EXPECT_EQ(std::vector<int>({2}),
+            GetLoopSizes("1:1, 2:2", DegenerateBoundaries::KEEP));
+
+  // A shell with a degenerate hole consisting of a sibling pair that touches
+  // the boundary.
+  const char* kShell = "0:0, 0:5, 5:5, 5:0; 0:0, 1:1";
+  EXPECT_EQ(std::vector<int>({4}),
+            GetLoopSizes(kShell, DegenerateBoundaries::DISCARD));
+  std::vector<int> sizes = GetLoopSizes(kShell, DegenerateBoundaries::KEEP);
+  int num_vertices = 0;
+  for (int size : sizes) num_vertices += size;
+  EXPECT_EQ(6, num_vertices);
+}
+
+TEST(LaxPolygonLayer, EdgesDoNotFormLoops) {
+  S2Builder builder{S2Builder::Options()};
+  S2LaxPolygonShape output;
+  builder.StartLayer(make_unique<LaxPolygonLayer>(&output));
+  builder.AddEdge(S2LatLng::FromDegrees(0, 0).ToPoint(),
+                  S2LatLng::FromDegrees(0, 1).ToPoint());
+  S2Error error;
+  EXPECT_FALSE(builder.Build(&error));
+  EXPECT_EQ(S2Error::BUILDER_EDGES_DO_NOT_FORM_LOOPS, error.code());
+}
+
+TEST(IndexedLaxPolygonLayer, AddsShape) {
+  S2Builder builder{S2Builder::Options()};
+  MutableS2ShapeIndex index;
+  builder.StartLayer(make_unique<IndexedLaxPolygonLayer>(&index));
+  builder.AddPolygon(*MakePolygonOrDie("0:0, 0:10, 10:0"));
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  ASSERT_EQ(1, index.num_shape_ids());
+  EXPECT_EQ(3, index.shape(0)->num_edges());
+  EXPECT_EQ(2, index.shape(0)->dimension());
+}
+
+TEST(IndexedLaxPolygonLayer, DoesNotAddEmptyShape) {
+  S2Builder builder{S2Builder::Options()};
+  MutableS2ShapeIndex index;
+  builder.StartLayer(make_unique<IndexedLaxPolygonLayer>(&index));
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  EXPECT_EQ(0, index.num_shape_ids());
+}
+
+}  // namespace
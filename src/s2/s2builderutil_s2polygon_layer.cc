@@ -74,28 +74,28 @@ GraphOptions S2PolygonLayer::graph_options() const {
 }
 
 void S2PolygonLayer::AppendS2Loops(const Graph& g,
-                                   const vector<Graph::EdgeLoop>& edge_loops,
+                                   const Graph::EdgeChains& edge_loops,
                                    vector<unique_ptr<S2Loop>>* loops) const {
-  vector<S2Point> vertices;
-  for (const auto& edge_loop : edge_loops) {
+  for (int i = 0; i < edge_loops.num_chains(); ++i) {
+    absl::Span<const Graph::EdgeId> edge_loop = edge_loops.chain(i);
+    vector<S2Point> vertices;
     vertices.reserve(edge_loop.size());
     for (auto edge_id : edge_loop) {
       vertices.push_back(g.vertex(g.edge(edge_id).first));
     }
-    loops->push_back(
-        make_unique<S2Loop>(vertices, polygon_->s2debug_override()));
-    vertices.clear();
+    loops->push_back(make_unique<S2Loop>(std::move(vertices),
+                                         polygon_->s2debug_override()));
   }
 }
 
-void S2PolygonLayer::AppendEdgeLabels(
-    const Graph& g,
-    const vector<Graph::EdgeLoop>& edge_loops) {
+void S2PolygonLayer::AppendEdgeLabels(const Graph& g,
+                                      const Graph::EdgeChains& edge_loops) {
   if (!label_set_ids_) return;
 
   vector<Label> labels;  // Temporary storage for labels.
   Graph::LabelFetcher fetcher(g, options_.edge_type());
-  for (const auto& edge_loop : edge_loops) {
+  for (int i = 0; i < edge_loops.num_chains(); ++i) {
+    absl::Span<const Graph::EdgeId> edge_loop = edge_loops.chain(i);
     vector<LabelSetId> loop_label_set_ids;
     loop_label_set_ids.reserve(edge_loop.size());
     for (auto edge_id : edge_loop) {
@@ -142,14 +142,13 @@ void S2PolygonLayer::Build(const Graph& g, S2Error* error) {
   // S2Polygon loops we can fix up the edge labels appropriately.
   LoopMap loop_map;
   if (g.options().edge_type() == EdgeType::DIRECTED) {
-    vector<Graph::EdgeLoop> edge_loops;
+    Graph::EdgeChains edge_loops;
     if (!g.GetDirectedLoops(LoopType::SIMPLE, &edge_loops, error)) {
       return;
     }
     vector<unique_ptr<S2Loop>> loops;
     AppendS2Loops(g, edge_loops, &loops);
     AppendEdgeLabels(g, edge_loops);
-    vector<Graph::EdgeLoop>().swap(edge_loops);  // Release memory
     InitLoopMap(loops, &loop_map);
     polygon_->InitOriented(std::move(loops));
   } else {
@@ -165,12 +164,14 @@ void S2PolygonLayer::Build(const Graph& g, S2Error* error) {
     // multiple loops that touch, only one of the two complements matches the
     // structure of the input loops.  GetUndirectedComponents() tries to
     // ensure that this is always complement 0 of each component.
-    vector<unique_ptr<S2Loop>> loops;
+    Graph::EdgeChains edge_loops;
     for (const auto& component : components) {
-      AppendS2Loops(g, component[0], &loops);
-      AppendEdgeLabels(g, component[0]);
+      for (const auto& edge_loop : component[0]) edge_loops.AddChain(edge_loop);
     }
     vector<Graph::UndirectedComponent>().swap(components);  // Release memory
+    vector<unique_ptr<S2Loop>> loops;
+    AppendS2Loops(g, edge_loops, &loops);
+    AppendEdgeLabels(g, edge_loops);
     InitLoopMap(loops, &loop_map);
     for (const auto& loop : loops) loop->Normalize();
     polygon_->InitNested(std::move(loops));
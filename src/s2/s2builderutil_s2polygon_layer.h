@@ -134,11 +134,9 @@ class S2PolygonLayer : public S2Builder::Layer {
  private:
   void Init(S2Polygon* polygon, LabelSetIds* label_set_ids,
             IdSetLexicon* label_set_lexicon, const Options& options);
-  void AppendS2Loops(const Graph& g,
-                     const std::vector<Graph::EdgeLoop>& edge_loops,
+  void AppendS2Loops(const Graph& g, const Graph::EdgeChains& edge_loops,
                      std::vector<std::unique_ptr<S2Loop>>* loops) const;
-  void AppendEdgeLabels(const Graph& g,
-                        const std::vector<Graph::EdgeLoop>& edge_loops);
+  void AppendEdgeLabels(const Graph& g, const Graph::EdgeChains& edge_loops);
   using LoopMap = gtl::btree_map<S2Loop*, std::pair<int, bool>>;
   void InitLoopMap(const std::vector<std::unique_ptr<S2Loop>>& loops,
                    LoopMap* loop_map) const;
@@ -64,13 +64,14 @@ GraphOptions S2PolylineVectorLayer::graph_options() const {
 }
 
 void S2PolylineVectorLayer::Build(const Graph& g, S2Error* error) {
-  vector<Graph::EdgePolyline> edge_polylines = g.GetPolylines(
-      options_.polyline_type());
-  polylines_->reserve(edge_polylines.size());
-  if (label_set_ids_) label_set_ids_->reserve(edge_polylines.size());
+  Graph::EdgeChains edge_polylines;
+  g.GetPolylines(options_.polyline_type(), &edge_polylines);
+  polylines_->reserve(edge_polylines.num_chains());
+  if (label_set_ids_) label_set_ids_->reserve(edge_polylines.num_chains());
   vector<S2Point> vertices;  // Temporary storage for vertices.
   vector<Label> labels;  // Temporary storage for labels.
-  for (const auto& edge_polyline : edge_polylines) {
+  for (int i = 0; i < edge_polylines.num_chains(); ++i) {
+    absl::Span<const EdgeId> edge_polyline = edge_polylines.chain(i);
     vertices.push_back(g.vertex(g.edge(edge_polyline[0]).first));
     for (EdgeId e : edge_polyline) {
       vertices.push_back(g.vertex(g.edge(e).second));
@@ -25,6 +25,7 @@
 #include "s2/base/logging.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2coords.h"
 #include "s2/s2latlng.h"
 #include "s2/s2metrics.h"
 
@@ -32,6 +33,7 @@ using absl::make_unique;
 using std::max;
 using std::min;
 using std::unique_ptr;
+using std::vector;
 
 namespace s2builderutil {
 
@@ -202,6 +204,24 @@ S2Point S2CellIdSnapFunction::SnapPoint(const S2Point& point) const {
   return S2CellId(point).parent(level_).ToPoint();
 }
 
+void S2CellIdSnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                      absl::Span<S2Point> snapped) const {
+  S2_DCHECK_EQ(points.size(), snapped.size());
+  // The center of the level-"level_" cell containing a point can be computed
+  // directly from the (face, i, j) coordinates of its leaf cell, which avoids
+  // mapping (i, j) to a Hilbert curve position and back again.  The result
+  // is the same as S2CellId::GetCenterSiTi() followed by ToPoint().
+  const int size = S2CellId::GetSizeIJ(level_);
+  for (size_t k = 0; k < points.size(); ++k) {
+    double u, v;
+    int face = S2::XYZtoFaceUV(points[k], &u, &v);
+    int i = S2::STtoIJ(S2::UVtoST(u)) & -size;
+    int j = S2::STtoIJ(S2::UVtoST(v)) & -size;
+    snapped[k] = S2::FaceSiTitoXYZ(face, 2 * i + size, 2 * j + size)
+                 .Normalize();
+  }
+}
+
 unique_ptr<S2Builder::SnapFunction> S2CellIdSnapFunction::Clone() const {
   return make_unique<S2CellIdSnapFunction>(*this);
 }
@@ -344,9 +364,40 @@ S2Point IntLatLngSnapFunction::SnapPoint(const S2Point& point) const {
   S2LatLng input(point);
   int64 lat = MathUtil::FastInt64Round(input.lat().degrees() * from_degrees_);
   int64 lng = MathUtil::FastInt64Round(input.lng().degrees() * from_degrees_);
+  return IntLatLngToPoint(lat, lng);
+}
+
+S2Point IntLatLngSnapFunction::IntLatLngToPoint(int64 lat, int64 lng) const {
+  S2_DCHECK_GE(exponent_, 0);  // Make sure the snap function was initialized.
   return S2LatLng::FromDegrees(lat * to_degrees_, lng * to_degrees_).ToPoint();
 }
 
+void IntLatLngSnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                       absl::Span<S2Point> snapped) const {
+  S2_DCHECK_EQ(points.size(), snapped.size());
+  S2_DCHECK_GE(exponent_, 0);  // Make sure the snap function was initialized.
+  // Each point is converted to integer coordinates and back directly rather
+  // than through S2LatLng, so that the loop only consists of arithmetic.
+  for (size_t k = 0; k < points.size(); ++k) {
+    const S2Point& p = points[k];
+    int64 lat = MathUtil::FastInt64Round(
+        S2LatLng::Latitude(p).degrees() * from_degrees_);
+    int64 lng = MathUtil::FastInt64Round(
+        S2LatLng::Longitude(p).degrees() * from_degrees_);
+    snapped[k] = IntLatLngToPoint(lat, lng);
+  }
+}
+
+void IntLatLngSnapFunction::IntLatLngToPoints(
+    absl::Span<const std::pair<int64, int64>> coords,
+    vector<S2Point>* points) const {
+  points->clear();
+  points->reserve(coords.size());
+  for (const auto& coord : coords) {
+    points->push_back(IntLatLngToPoint(coord.first, coord.second));
+  }
+}
+
 unique_ptr<S2Builder::SnapFunction> IntLatLngSnapFunction::Clone() const {
   return make_unique<IntLatLngSnapFunction>(*this);
 }
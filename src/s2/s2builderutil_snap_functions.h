@@ -19,6 +19,10 @@
 #define S2_S2BUILDERUTIL_SNAP_FUNCTIONS_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2builder.h"
 #include "s2/s2cell_id.h"
@@ -133,6 +137,8 @@ class S2CellIdSnapFunction : public S2Builder::SnapFunction {
   S1Angle min_edge_vertex_separation() const override;
 
   S2Point SnapPoint(const S2Point& point) const override;
+  void SnapPoints(absl::Span<const S2Point> points,
+                  absl::Span<S2Point> snapped) const override;
 
   std::unique_ptr<SnapFunction> Clone() const override;
 
@@ -225,8 +231,24 @@ class IntLatLngSnapFunction : public S2Builder::SnapFunction {
   // or more.
   S1Angle min_edge_vertex_separation() const override;
   S2Point SnapPoint(const S2Point& point) const override;
+  void SnapPoints(absl::Span<const S2Point> points,
+                  absl::Span<S2Point> snapped) const override;
   std::unique_ptr<SnapFunction> Clone() const override;
 
+  // Returns the snapped point whose coordinates are the given integers
+  // (i.e., lat and lng in degrees multiplied by 10 raised to exponent()).
+  // This is the point that SnapPoint() returns for any point whose
+  // coordinates round to these integers, but it avoids converting an
+  // S2Point to S2LatLng.  This is useful when the input is already stored
+  // as integer (e.g. E7) coordinates.
+  S2Point IntLatLngToPoint(int64 lat, int64 lng) const;
+
+  // Converts a sequence of integer (lat, lng) coordinates as described above,
+  // storing the results in "points" (which is cleared first).  The points
+  // can be passed directly to S2Builder::AddSnappedPolyline().
+  void IntLatLngToPoints(absl::Span<const std::pair<int64, int64>> coords,
+                         std::vector<S2Point>* points) const;
+
  private:
   // Copying and assignment are allowed.
   int exponent_;
@@ -88,6 +88,19 @@ TEST(S2CellIdSnapFunction, SnapPoint) {
   }
 }
 
+TEST(S2CellIdSnapFunction, SnapPoints) {
+  vector<S2Point> points(1000);
+  for (S2Point& p : points) p = S2Testing::RandomPoint();
+  vector<S2Point> snapped(points.size());
+  for (int level = 0; level <= S2CellId::kMaxLevel; ++level) {
+    S2CellIdSnapFunction f(level);
+    f.SnapPoints(points, absl::MakeSpan(snapped));
+    for (int k = 0; k < points.size(); ++k) {
+      EXPECT_EQ(f.SnapPoint(points[k]), snapped[k]);
+    }
+  }
+}
+
 TEST(IntLatLngSnapFunction, ExponentToFromSnapRadius) {
   for (int exponent = IntLatLngSnapFunction::kMinExponent;
        exponent <= IntLatLngSnapFunction::kMaxExponent; ++exponent) {
@@ -126,6 +139,37 @@ TEST(IntLatLngSnapFunction, SnapPoint) {
   }
 }
 
+TEST(IntLatLngSnapFunction, SnapPoints) {
+  vector<S2Point> points(1000);
+  for (S2Point& p : points) p = S2Testing::RandomPoint();
+  vector<S2Point> snapped(points.size());
+  for (int exponent = IntLatLngSnapFunction::kMinExponent;
+       exponent <= IntLatLngSnapFunction::kMaxExponent; ++exponent) {
+    IntLatLngSnapFunction f(exponent);
+    f.SnapPoints(points, absl::MakeSpan(snapped));
+    for (int k = 0; k < points.size(); ++k) {
+      EXPECT_EQ(f.SnapPoint(points[k]), snapped[k]);
+    }
+  }
+}
+
+TEST(IntLatLngSnapFunction, IntLatLngToPoint) {
+  IntLatLngSnapFunction f(7);
+  vector<std::pair<int64, int64>> coords;
+  vector<S2Point> expected;
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2Point p = S2Testing::RandomPoint();
+    S2LatLng ll(p);
+    coords.push_back(std::make_pair(ll.lat().e7(), ll.lng().e7()));
+    expected.push_back(f.SnapPoint(p));
+    EXPECT_EQ(expected.back(), f.IntLatLngToPoint(ll.lat().e7(),
+                                                  ll.lng().e7()));
+  }
+  vector<S2Point> points;
+  f.IntLatLngToPoints(coords, &points);
+  EXPECT_EQ(expected, points);
+}
+
 static S2CellId kSearchRootId = S2CellId::FromFace(0);
 static S2CellId kSearchFocusId = S2CellId::FromFace(0).child(3);
 
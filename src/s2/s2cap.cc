@@ -293,6 +293,26 @@ bool S2Cap::Contains(const S2Point& p) const {
   return S1ChordAngle(center_, p) <= radius_;
 }
 
+void S2Cap::GetContainsMask(S2PointSpan points,
+                            std::vector<uint64>* mask) const {
+  const int n = points.size();
+  mask->assign((n + 63) / 64, 0);
+  // This is the same test as S1ChordAngle(center_, p) <= radius_.
+  const double x = center_.x(), y = center_.y(), z = center_.z();
+  const double r2 = radius_.length2();
+  for (int i = 0; i < n; i += 64) {
+    const int count = std::min(64, n - i);
+    const S2Point* p = &points[i];
+    uint64 bits = 0;
+    for (int j = 0; j < count; ++j) {
+      double dx = x - p[j].x(), dy = y - p[j].y(), dz = z - p[j].z();
+      double d2 = std::min(4.0, dx * dx + dy * dy + dz * dz);
+      bits |= static_cast<uint64>(d2 <= r2) << j;
+    }
+    (*mask)[i / 64] = bits;
+  }
+}
+
 bool S2Cap::InteriorContains(const S2Point& p) const {
   S2_DCHECK(S2::IsUnitLength(p));
   return is_full() || S1ChordAngle(center_, p) < radius_;
@@ -27,8 +27,10 @@
 #include "s2/_fp_contract_off.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2region.h"
+#include "s2/third_party/absl/base/integral_types.h"
 
 class Decoder;
 class Encoder;
@@ -189,6 +191,13 @@ class S2Cap final : public S2Region {
   // The point "p" should be a unit-length vector.
   bool Contains(const S2Point& p) const override;
 
+  // Tests the given points for containment, and sets bit (i % 64) of
+  // (*mask)[i / 64] iff Contains(points[i]) is true.  This is equivalent to
+  // calling Contains() for each point but is much faster, since it avoids
+  // virtual calls and the loop can be vectorized.  It is intended as a
+  // prefilter for large numbers of points.
+  void GetContainsMask(S2PointSpan points, std::vector<uint64>* mask) const;
+
   // Appends a serialized representation of the S2Cap to "encoder".
   //
   // REQUIRES: "encoder" uses the default constructor, so that its buffer
@@ -151,6 +151,30 @@ TEST(S2Cap, Basic) {
       S2Cap::FromCenterHeight(-concave.center(), 0.1)));
 }
 
+TEST(S2Cap, GetContainsMask) {
+  vector<S2Point> points;
+  for (int i = 0; i < 1000; ++i) points.push_back(S2Testing::RandomPoint());
+  S2Point center = S2Testing::RandomPoint();
+  points.push_back(center);
+  points.push_back(-center);
+  vector<S2Cap> caps = {S2Cap::Empty(), S2Cap::Full(), S2Cap::FromPoint(center),
+                        S2Cap(-center, S1Angle::Degrees(180))};
+  for (int i = 0; i < 20; ++i) {
+    caps.push_back(S2Cap(center, S1Angle::Radians(
+        M_PI * S2Testing::rnd.RandDouble())));
+  }
+  // A cap whose boundary passes through one of the points.
+  caps.push_back(S2Cap(center, S1ChordAngle(center, points[0])));
+  for (const S2Cap& cap : caps) {
+    vector<uint64> mask;
+    cap.GetContainsMask(points, &mask);
+    ASSERT_EQ((points.size() + 63) / 64, mask.size());
+    for (int i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(cap.Contains(points[i]), (mask[i / 64] >> (i % 64)) & 1);
+    }
+  }
+}
+
 TEST(S2Cap, GetRectBound) {
   // Empty and full caps.
   EXPECT_TRUE(S2Cap::Empty().GetRectBound().is_empty());
@@ -104,6 +104,40 @@ bool S2Cell::Subdivide(S2Cell children[4]) const {
   return true;
 }
 
+void S2ChildCellGenerator::Init() {
+  int ij[2], orientation;
+  face_ = parent_.ToFaceIJOrientation(&ij[0], &ij[1], &orientation);
+  orientation_ = orientation;
+  int cell_size = S2CellId::GetSizeIJ(parent_.level());
+  for (int d = 0; d < 2; ++d) {
+    int ij_lo = ij[d] & -cell_size;
+    for (int k = 0; k < 3; ++k) {
+      uv_[d][k] = S2::STtoUV(S2::IJtoSTMin(ij_lo + k * (cell_size >> 1)));
+    }
+  }
+  initialized_ = true;
+}
+
+S2Cell S2ChildCellGenerator::child(int pos) {
+  S2_DCHECK_GE(pos, 0);
+  S2_DCHECK_LT(pos, 4);
+  if (!initialized_) Init();
+  S2Cell child;
+  child.face_ = face_;
+  child.level_ = parent_.level() + 1;
+  child.orientation_ = orientation_ ^ kPosToOrientation[pos];
+  child.id_ = parent_.child(pos);
+  // See S2Cell::Subdivide.  The index for "i" is in bit 1 of ij.
+  int ij = kPosToIJ[orientation_][pos];
+  int i = ij >> 1;
+  int j = ij & 1;
+  child.uv_[0][0] = uv_[0][i];
+  child.uv_[0][1] = uv_[0][i + 1];
+  child.uv_[1][0] = uv_[1][j];
+  child.uv_[1][1] = uv_[1][j + 1];
+  return child;
+}
+
 S2Point S2Cell::GetCenterRaw() const {
   return id_.ToPointRaw();
 }
@@ -206,6 +206,8 @@ class S2Cell final : public S2Region {
   S1ChordAngle GetDistanceInternal(const S2Point& target_xyz,
                                    bool to_interior) const;
 
+  friend class S2ChildCellGenerator;
+
   // This structure occupies 44 bytes plus one pointer for the vtable.
   int8 face_;
   int8 level_;
@@ -214,6 +216,40 @@ class S2Cell final : public S2Region {
   R2Rect uv_;
 };
 
+// S2ChildCellGenerator constructs the children of a given cell on demand.
+// The parent S2CellId is decoded only when the first child is requested,
+// and each child's (u,v) bounds are then taken from the parent's bounds and
+// midpoint (as S2Cell::Subdivide does) rather than by decoding the child's
+// own S2CellId.  This is useful for traversals that test many child ids but
+// only construct an S2Cell for a few of them.  Example usage:
+//
+//   S2ChildCellGenerator children(parent_id);
+//   for (int pos = 0; pos < 4; ++pos) {
+//     if (NeedsCell(parent_id.child(pos))) Process(children.child(pos));
+//   }
+class S2ChildCellGenerator {
+ public:
+  // REQUIRES: !parent.is_leaf()
+  explicit S2ChildCellGenerator(S2CellId parent) : parent_(parent) {
+    S2_DCHECK(!parent.is_leaf());
+  }
+
+  // Returns the child of the parent cell at the given position (0..3), where
+  // the children are numbered in S2CellId order.
+  S2Cell child(int pos);
+
+ private:
+  void Init();
+
+  S2CellId parent_;
+  bool initialized_ = false;
+  int8 face_;
+  int8 orientation_;
+  // The lower boundary, midpoint, and upper boundary of the parent cell
+  // along the u-axis (uv_[0]) and the v-axis (uv_[1]).
+  double uv_[2][3];
+};
+
 inline bool operator==(const S2Cell& x, const S2Cell& y) {
   return x.id() == y.id();
 }
@@ -0,0 +1,312 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "s2/util/bits/bits.h"
+
+using std::vector;
+
+// The number of positions in a chunk is 2**kChunkBits.
+static const int kChunkBits = 16;
+static const int kChunkSize = 1 << kChunkBits;
+static const int kNumWords = kChunkSize / 64;
+
+// Chunks with more than this many positions are stored as bitsets.  This is
+// the size at which a bitset uses less space than an array.
+static const int kMaxArraySize = kChunkSize / 16;
+
+// Sets "bits" to the bitset representation of the given offsets.
+static void ArrayToBits(const vector<uint16>& array, vector<uint64>* bits) {
+  bits->assign(kNumWords, 0);
+  for (uint16 offset : array) {
+    (*bits)[offset >> 6] |= uint64{1} << (offset & 63);
+  }
+}
+
+// Appends the offsets in the given bitset to "array" in increasing order.
+static void BitsToArray(const vector<uint64>& bits, vector<uint16>* array) {
+  for (int i = 0; i < kNumWords; ++i) {
+    for (uint64 word = bits[i]; word != 0; word &= word - 1) {
+      array->push_back(64 * i + Bits::FindLSBSetNonZero64(word));
+    }
+  }
+}
+
+S2CellBitmap::S2CellBitmap(int level)
+    : level_(level), shift_(2 * (S2CellId::kMaxLevel - level) + 1) {
+  S2_DCHECK_GE(level, 0);
+  S2_DCHECK_LE(level, S2CellId::kMaxLevel);
+}
+
+bool S2CellBitmap::Chunk::Contains(uint16 offset) const {
+  if (is_bitset()) return (bits[offset >> 6] >> (offset & 63)) & 1;
+  return std::binary_search(array.begin(), array.end(), offset);
+}
+
+// Sets the contents of "chunk" from the given bitset, choosing the smaller
+// representation.
+static void SetChunkBits(vector<uint64> bits, int* cardinality,
+                         vector<uint16>* array, vector<uint64>* chunk_bits) {
+  int count = 0;
+  for (uint64 word : bits) count += Bits::CountOnes64(word);
+  *cardinality = count;
+  array->clear();
+  chunk_bits->clear();
+  if (count <= kMaxArraySize) {
+    BitsToArray(bits, array);
+  } else {
+    *chunk_bits = std::move(bits);
+  }
+}
+
+/*static*/ S2CellBitmap S2CellBitmap::FromCellUnion(
+    const S2CellUnion& cell_union, int level) {
+  S2CellBitmap bitmap(level);
+  for (S2CellId id : cell_union) bitmap.Add(id);
+  return bitmap;
+}
+
+S2CellUnion S2CellBitmap::ToCellUnion() const {
+  vector<S2CellId> cell_ids;
+  cell_ids.reserve(num_cells());
+  vector<uint16> offsets;
+  for (int i = 0; i < keys_.size(); ++i) {
+    const Chunk& chunk = chunks_[i];
+    offsets.clear();
+    if (chunk.is_bitset()) BitsToArray(chunk.bits, &offsets);
+    const vector<uint16>& array = chunk.is_bitset() ? offsets : chunk.array;
+    for (uint16 offset : array) {
+      cell_ids.push_back(GetCellId((keys_[i] << kChunkBits) | offset));
+    }
+  }
+  // The constructor merges groups of four child cells into their parents.
+  return S2CellUnion(std::move(cell_ids));
+}
+
+int64 S2CellBitmap::num_cells() const {
+  int64 count = 0;
+  for (const Chunk& chunk : chunks_) count += chunk.cardinality;
+  return count;
+}
+
+const S2CellBitmap::Chunk* S2CellBitmap::FindChunk(uint64 key) const {
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  if (it == keys_.end() || *it != key) return nullptr;
+  return &chunks_[it - keys_.begin()];
+}
+
+S2CellBitmap::Chunk* S2CellBitmap::MutableChunk(uint64 key) {
+  // Chunks are usually added in increasing order, so check the end first.
+  if (keys_.empty() || keys_.back() < key) {
+    keys_.push_back(key);
+    chunks_.emplace_back();
+    return &chunks_.back();
+  }
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  int i = it - keys_.begin();
+  if (*it != key) {
+    keys_.insert(it, key);
+    chunks_.insert(chunks_.begin() + i, Chunk());
+  }
+  return &chunks_[i];
+}
+
+/*static*/ void S2CellBitmap::AddRange(int begin, int end, Chunk* chunk) {
+  vector<uint64> bits;
+  if (chunk->is_bitset()) {
+    bits = std::move(chunk->bits);
+  } else {
+    ArrayToBits(chunk->array, &bits);
+  }
+  for (int i = begin; i < end; ++i) {
+    bits[i >> 6] |= uint64{1} << (i & 63);
+  }
+  SetChunkBits(std::move(bits), &chunk->cardinality, &chunk->array,
+               &chunk->bits);
+}
+
+void S2CellBitmap::Add(S2CellId id) {
+  S2_DCHECK(id.is_valid());
+  if (id.level() >= level_) {
+    uint64 pos = GetPosition(id);
+    Chunk* chunk = MutableChunk(pos >> kChunkBits);
+    uint16 offset = pos & (kChunkSize - 1);
+    if (chunk->is_bitset()) {
+      uint64& word = chunk->bits[offset >> 6];
+      uint64 mask = uint64{1} << (offset & 63);
+      if (!(word & mask)) {
+        word |= mask;
+        ++chunk->cardinality;
+      }
+      return;
+    }
+    auto it = std::lower_bound(chunk->array.begin(), chunk->array.end(),
+                               offset);
+    if (it != chunk->array.end() && *it == offset) return;
+    chunk->array.insert(it, offset);
+    if (++chunk->cardinality > kMaxArraySize) {
+      ArrayToBits(chunk->array, &chunk->bits);
+      chunk->array.clear();
+    }
+    return;
+  }
+  // The cell is larger than level(), so add the range of positions of its
+  // descendants.
+  uint64 first = GetPosition(id.range_min());
+  uint64 last = GetPosition(id.range_max());
+  for (uint64 key = first >> kChunkBits; key <= last >> kChunkBits; ++key) {
+    int begin = (key == first >> kChunkBits) ? first & (kChunkSize - 1) : 0;
+    int end = (key == last >> kChunkBits) ? (last & (kChunkSize - 1)) + 1
+                                          : kChunkSize;
+    AddRange(begin, end, MutableChunk(key));
+  }
+}
+
+/*static*/ bool S2CellBitmap::ContainsRange(const Chunk& chunk, int begin,
+                                            int end) {
+  if (chunk.cardinality < end - begin) return false;
+  if (!chunk.is_bitset()) {
+    auto lo = std::lower_bound(chunk.array.begin(), chunk.array.end(), begin);
+    auto hi = std::lower_bound(lo, chunk.array.end(), end);
+    return hi - lo == end - begin;
+  }
+  for (int i = begin; i < end; ++i) {
+    if (!((chunk.bits[i >> 6] >> (i & 63)) & 1)) return false;
+  }
+  return true;
+}
+
+bool S2CellBitmap::Contains(S2CellId id) const {
+  if (id.level() >= level_) {
+    uint64 pos = GetPosition(id);
+    const Chunk* chunk = FindChunk(pos >> kChunkBits);
+    return chunk != nullptr && chunk->Contains(pos & (kChunkSize - 1));
+  }
+  uint64 first = GetPosition(id.range_min());
+  uint64 last = GetPosition(id.range_max());
+  for (uint64 key = first >> kChunkBits; key <= last >> kChunkBits; ++key) {
+    const Chunk* chunk = FindChunk(key);
+    if (chunk == nullptr) return false;
+    int begin = (key == first >> kChunkBits) ? first & (kChunkSize - 1) : 0;
+    int end = (key == last >> kChunkBits) ? (last & (kChunkSize - 1)) + 1
+                                          : kChunkSize;
+    if (!ContainsRange(*chunk, begin, end)) return false;
+  }
+  return true;
+}
+
+bool S2CellBitmap::Contains(const S2Point& p) const {
+  return Contains(S2CellId(p));
+}
+
+S2CellBitmap S2CellBitmap::Combine(const S2CellBitmap& other, Op op) const {
+  S2_DCHECK_EQ(level_, other.level_);
+  S2CellBitmap result(level_);
+  vector<uint64> a_bits, b_bits;
+  for (int i = 0, j = 0; i < keys_.size() || j < other.keys_.size();) {
+    bool has_a = i < keys_.size() &&
+                 (j == other.keys_.size() || keys_[i] <= other.keys_[j]);
+    bool has_b = j < other.keys_.size() &&
+                 (i == keys_.size() || other.keys_[j] <= keys_[i]);
+    uint64 key = has_a ? keys_[i] : other.keys_[j];
+    const Chunk* a = has_a ? &chunks_[i++] : nullptr;
+    const Chunk* b = has_b ? &other.chunks_[j++] : nullptr;
+    if (a == nullptr || b == nullptr) {
+      // Only one of the bitmaps has a chunk with this key.
+      if (op == Op::INTERSECTION || (op == Op::DIFFERENCE && a == nullptr)) {
+        continue;
+      }
+      result.keys_.push_back(key);
+      result.chunks_.push_back(a ? *a : *b);
+      continue;
+    }
+    Chunk chunk;
+    if (!a->is_bitset() && !b->is_bitset()) {
+      auto out = std::back_inserter(chunk.array);
+      if (op == Op::UNION) {
+        std::set_union(a->array.begin(), a->array.end(), b->array.begin(),
+                       b->array.end(), out);
+      } else if (op == Op::INTERSECTION) {
+        std::set_intersection(a->array.begin(), a->array.end(),
+                              b->array.begin(), b->array.end(), out);
+      } else {
+        std::set_difference(a->array.begin(), a->array.end(),
+                            b->array.begin(), b->array.end(), out);
+      }
+      chunk.cardinality = chunk.array.size();
+      if (chunk.cardinality > kMaxArraySize) {
+        ArrayToBits(chunk.array, &chunk.bits);
+        chunk.array.clear();
+      }
+    } else {
+      // At least one chunk is a bitset, so combine them word by word.
+      if (a->is_bitset()) {
+        a_bits = a->bits;
+      } else {
+        ArrayToBits(a->array, &a_bits);
+      }
+      if (b->is_bitset()) {
+        b_bits = b->bits;
+      } else {
+        ArrayToBits(b->array, &b_bits);
+      }
+      for (int k = 0; k < kNumWords; ++k) {
+        if (op == Op::UNION) {
+          a_bits[k] |= b_bits[k];
+        } else if (op == Op::INTERSECTION) {
+          a_bits[k] &= b_bits[k];
+        } else {
+          a_bits[k] &= ~b_bits[k];
+        }
+      }
+      SetChunkBits(std::move(a_bits), &chunk.cardinality, &chunk.array,
+                   &chunk.bits);
+    }
+    if (chunk.cardinality == 0) continue;
+    result.keys_.push_back(key);
+    result.chunks_.push_back(std::move(chunk));
+  }
+  return result;
+}
+
+S2CellBitmap S2CellBitmap::Union(const S2CellBitmap& other) const {
+  return Combine(other, Op::UNION);
+}
+
+S2CellBitmap S2CellBitmap::Intersection(const S2CellBitmap& other) const {
+  return Combine(other, Op::INTERSECTION);
+}
+
+S2CellBitmap S2CellBitmap::Difference(const S2CellBitmap& other) const {
+  return Combine(other, Op::DIFFERENCE);
+}
+
+bool operator==(const S2CellBitmap& x, const S2CellBitmap& y) {
+  // Every chunk has a unique representation, so they can be compared
+  // directly.
+  if (x.level_ != y.level_ || x.keys_ != y.keys_) return false;
+  for (int i = 0; i < x.chunks_.size(); ++i) {
+    const auto& a = x.chunks_[i];
+    const auto& b = y.chunks_[i];
+    if (a.array != b.array || a.bits != b.bits) return false;
+  }
+  return true;
+}
@@ -0,0 +1,141 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2CELL_BITMAP_H_
+#define S2_S2CELL_BITMAP_H_
+
+#include <vector>
+
+#include "s2/base/logging.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2point.h"
+
+// S2CellBitmap represents a set of S2Cells at a single fixed level as a
+// compressed bitmap.  It is much smaller and faster than an S2CellUnion for
+// dense coverings at one level (e.g., a level-13 grid over a metropolitan
+// area), and supports fast set operations, conversion to and from
+// S2CellUnion, and point containment by a direct bit lookup.
+//
+// Each cell at the bitmap's level is identified by its position in S2CellId
+// order, i.e. the cell id with its trailing bits removed.  Following the
+// "Roaring bitmap" design, positions are grouped into chunks of 2**16
+// consecutive values, and each non-empty chunk is stored either as a sorted
+// array of 16-bit offsets (if it contains at most 4096 cells) or as a
+// 2**16-bit bitset, whichever is smaller.  Example usage:
+//
+//   S2CellBitmap bitmap = S2CellBitmap::FromCellUnion(covering, 13);
+//   if (bitmap.Contains(point)) ...
+//   S2CellBitmap both = bitmap.Intersection(other_bitmap);
+//   S2CellUnion result = both.ToCellUnion();
+class S2CellBitmap {
+ public:
+  // Constructs an empty bitmap of cells at the given level.
+  //
+  // REQUIRES: 0 <= level <= S2CellId::kMaxLevel
+  explicit S2CellBitmap(int level);
+
+  // Returns a bitmap of the cells at the given level that intersect
+  // "cell_union".  Cells of the union that are larger than "level" are
+  // expanded into all of their descendants at that level, and cells that are
+  // smaller are replaced by their ancestor at that level, so that the bitmap
+  // contains the union (exactly if no cell is smaller than "level").
+  static S2CellBitmap FromCellUnion(const S2CellUnion& cell_union, int level);
+
+  // Returns the bitmap as a normalized S2CellUnion.
+  S2CellUnion ToCellUnion() const;
+
+  // Returns the level of the cells in this bitmap.
+  int level() const { return level_; }
+
+  // Returns the number of cells in the bitmap.
+  int64 num_cells() const;
+
+  // Returns true if the bitmap is empty.
+  bool is_empty() const { return keys_.empty(); }
+
+  // Adds the ancestor at level() of the given cell, or all the descendants
+  // at level() if the cell is larger.
+  void Add(S2CellId id);
+
+  // Returns true if every point of the given cell is contained by a cell of
+  // the bitmap.
+  bool Contains(S2CellId id) const;
+
+  // Returns true if the given point is contained by a cell of the bitmap.
+  // The point does not need to be normalized.
+  bool Contains(const S2Point& p) const;
+
+  // Set operations.
+  // REQUIRES: other.level() == level()
+  S2CellBitmap Union(const S2CellBitmap& other) const;
+  S2CellBitmap Intersection(const S2CellBitmap& other) const;
+  S2CellBitmap Difference(const S2CellBitmap& other) const;
+
+  friend bool operator==(const S2CellBitmap& x, const S2CellBitmap& y);
+  friend bool operator!=(const S2CellBitmap& x, const S2CellBitmap& y) {
+    return !(x == y);
+  }
+
+ private:
+  // The offsets within one chunk of 2**16 positions.
+  struct Chunk {
+    // The number of positions in the chunk.
+    int cardinality = 0;
+
+    // Exactly one of the following is used.  "bits" has kNumWords elements
+    // and is used when the cardinality exceeds kMaxArraySize.
+    std::vector<uint16> array;
+    std::vector<uint64> bits;
+
+    bool is_bitset() const { return !bits.empty(); }
+    bool Contains(uint16 offset) const;
+  };
+
+  enum class Op { UNION, INTERSECTION, DIFFERENCE };
+  S2CellBitmap Combine(const S2CellBitmap& other, Op op) const;
+
+  // Returns the position of the given cell, which has level() or higher.
+  uint64 GetPosition(S2CellId id) const { return id.id() >> shift_; }
+
+  // Returns the cell at the given position.
+  S2CellId GetCellId(uint64 pos) const {
+    return S2CellId((pos << shift_) | (uint64{1} << (shift_ - 1)));
+  }
+
+  // Returns the chunk with the given key, or nullptr if there is none.
+  // Keys are the positions divided by 2**16.
+  const Chunk* FindChunk(uint64 key) const;
+
+  // Returns the chunk with the given key, creating it if necessary.
+  Chunk* MutableChunk(uint64 key);
+
+  // Adds the positions [begin, end) within one chunk.
+  static void AddRange(int begin, int end, Chunk* chunk);
+
+  // Returns true if the chunk contains every position in [begin, end).
+  static bool ContainsRange(const Chunk& chunk, int begin, int end);
+
+  int level_;
+  int shift_;
+
+  // The keys of the non-empty chunks, in increasing order, and the chunks.
+  std::vector<uint64> keys_;
+  std::vector<Chunk> chunks_;
+};
+
+#endif  // S2_S2CELL_BITMAP_H_
@@ -0,0 +1,107 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_bitmap.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+// Returns a covering of the given cap by cells at exactly the given level,
+// as a normalized S2CellUnion.  (Coverings at a fixed level are not
+// normalized, since groups of four cells are not replaced by their parent.)
+S2CellUnion GetCovering(const S2Cap& cap, int level) {
+  S2RegionCoverer::Options options;
+  options.set_fixed_level(level);
+  options.set_max_cells(1 << 20);
+  return S2CellUnion(S2RegionCoverer(options).GetCovering(cap).cell_ids());
+}
+
+TEST(S2CellBitmap, Empty) {
+  S2CellBitmap bitmap(10);
+  EXPECT_TRUE(bitmap.is_empty());
+  EXPECT_EQ(0, bitmap.num_cells());
+  EXPECT_TRUE(bitmap.ToCellUnion().empty());
+  EXPECT_FALSE(bitmap.Contains(S2Testing::RandomPoint()));
+}
+
+TEST(S2CellBitmap, RoundTripsCellUnion) {
+  S2Testing::rnd.Reset(1);
+  // The first covering is sparse and the second one is dense enough to use
+  // bitset chunks.
+  for (double radius : {0.5, 3.0}) {
+    const int kLevel = 12;
+    S2CellUnion covering = GetCovering(
+        S2Cap(S2Testing::RandomPoint(), S1Angle::Degrees(radius)), kLevel);
+    S2CellBitmap bitmap = S2CellBitmap::FromCellUnion(covering, kLevel);
+    EXPECT_EQ(covering, bitmap.ToCellUnion());
+    vector<S2CellId> expanded;
+    covering.Denormalize(kLevel, 1, &expanded);
+    EXPECT_EQ(expanded.size(), bitmap.num_cells());
+    for (int iter = 0; iter < 1000; ++iter) {
+      S2Point p = S2Testing::RandomPoint();
+      EXPECT_EQ(covering.Contains(p), bitmap.Contains(p));
+      S2CellId id = S2CellId(p).parent(S2Testing::rnd.Uniform(31));
+      EXPECT_EQ(covering.Contains(id), bitmap.Contains(id));
+    }
+    for (S2CellId id : covering) EXPECT_TRUE(bitmap.Contains(id));
+  }
+}
+
+TEST(S2CellBitmap, SmallerCellsAreRoundedUp) {
+  S2CellId id = S2Testing::GetRandomCellId(20);
+  S2CellBitmap bitmap(10);
+  bitmap.Add(id);
+  EXPECT_EQ(1, bitmap.num_cells());
+  EXPECT_TRUE(bitmap.Contains(id.parent(10)));
+  EXPECT_FALSE(bitmap.Contains(id.parent(9)));
+}
+
+TEST(S2CellBitmap, SetOperationsMatchS2CellUnion) {
+  S2Testing::rnd.Reset(1);
+  const int kLevel = 11;
+  for (int iter = 0; iter < 10; ++iter) {
+    // Use overlapping caps of various sizes so that all combinations of
+    // array and bitset chunks occur.
+    S2Point center = S2Testing::RandomPoint();
+    S2CellUnion x = GetCovering(S2Cap(
+        center, S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 4))),
+        kLevel);
+    S2CellUnion y = GetCovering(S2Cap(
+        S2Testing::SamplePoint(S2Cap(center, S1Angle::Degrees(2))),
+        S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 4))), kLevel);
+    S2CellBitmap bx = S2CellBitmap::FromCellUnion(x, kLevel);
+    S2CellBitmap by = S2CellBitmap::FromCellUnion(y, kLevel);
+    EXPECT_EQ(x.Union(y), bx.Union(by).ToCellUnion());
+    EXPECT_EQ(x.Intersection(y), bx.Intersection(by).ToCellUnion());
+    EXPECT_EQ(x.Difference(y), bx.Difference(by).ToCellUnion());
+    EXPECT_TRUE(bx.Union(by) ==
+                S2CellBitmap::FromCellUnion(x.Union(y), kLevel));
+    EXPECT_TRUE(bx.Difference(bx).is_empty());
+  }
+}
+
+}  // namespace
@@ -0,0 +1,126 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_histogram.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "s2/base/logging.h"
+#include "s2/util/thread/executor.h"
+
+using std::pair;
+using std::vector;
+
+void S2CellHistogram::Add(S2CellId id, int64 count) {
+  S2_DCHECK(id.is_valid());
+  pending_.push_back(std::make_pair(id, count));
+}
+
+void S2CellHistogram::Build() {
+  if (pending_.empty()) return;
+  // Include the cells from the previous Build() so that they are combined
+  // with the new ones.
+  for (int i = 0; i < num_cells(); ++i) {
+    pending_.push_back(std::make_pair(ids_[i], sums_[i + 1] - sums_[i]));
+  }
+  std::sort(pending_.begin(), pending_.end(),
+            [](const pair<S2CellId, int64>& x,
+               const pair<S2CellId, int64>& y) {
+              return x.first < y.first;
+            });
+  ids_.clear();
+  sums_.assign(1, 0);
+  for (const auto& entry : pending_) {
+    if (ids_.empty() || ids_.back() != entry.first) {
+      ids_.push_back(entry.first);
+      sums_.push_back(sums_.back());
+    }
+    sums_.back() += entry.second;
+  }
+  pending_.clear();
+}
+
+void S2CellHistogram::Clear() {
+  pending_.clear();
+  ids_.clear();
+  sums_.assign(1, 0);
+}
+
+inline int S2CellHistogram::LowerBound(S2CellId id) const {
+  return static_cast<int>(std::lower_bound(ids_.begin(), ids_.end(), id) -
+                          ids_.begin());
+}
+
+int64 S2CellHistogram::GetCount(S2CellId id) const {
+  S2_DCHECK(pending_.empty()) << "Call Build() first";
+  // The cells contained by "id" are exactly those in [range_min, range_max].
+  int begin = LowerBound(id.range_min());
+  int end = LowerBound(id.range_max().next());
+  return sums_[end] - sums_[begin];
+}
+
+int64 S2CellHistogram::GetCount(const S2CellUnion& cell_union) const {
+  int64 count = 0;
+  for (S2CellId id : cell_union) count += GetCount(id);
+  return count;
+}
+
+void S2CellHistogram::Merge(const S2CellHistogram& other) {
+  S2_DCHECK(pending_.empty() && other.pending_.empty()) << "Call Build()";
+  vector<S2CellId> ids;
+  vector<int64> sums(1, 0);
+  ids.reserve(ids_.size() + other.ids_.size());
+  sums.reserve(ids.capacity() + 1);
+  int i = 0, j = 0;
+  while (i < num_cells() || j < other.num_cells()) {
+    S2CellId id;
+    int64 count = 0;
+    if (j == other.num_cells() ||
+        (i < num_cells() && ids_[i] <= other.ids_[j])) {
+      id = ids_[i];
+      count += sums_[i + 1] - sums_[i];
+      ++i;
+    } else {
+      id = other.ids_[j];
+    }
+    if (j < other.num_cells() && other.ids_[j] == id) {
+      count += other.sums_[j + 1] - other.sums_[j];
+      ++j;
+    }
+    ids.push_back(id);
+    sums.push_back(sums.back() + count);
+  }
+  ids_.swap(ids);
+  sums_.swap(sums);
+}
+
+S2CellHistogram S2CellHistogram::MergeAll(vector<S2CellHistogram> histograms,
+                                          Executor* executor) {
+  if (histograms.empty()) return S2CellHistogram();
+  // At each round, histogram[i] absorbs histogram[i + step] for every "i"
+  // that is a multiple of 2 * step.
+  for (int step = 1; step < histograms.size(); step *= 2) {
+    int num_merges = static_cast<int>(
+        (histograms.size() + 2 * step - 1 - step) / (2 * step));
+    ParallelFor(executor, num_merges, [&](int k) {
+        int i = 2 * step * k;
+        histograms[i].Merge(histograms[i + step]);
+        histograms[i + step].Clear();
+      });
+  }
+  return std::move(histograms[0]);
+}
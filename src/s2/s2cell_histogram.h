@@ -0,0 +1,107 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2CELL_HISTOGRAM_H_
+#define S2_S2CELL_HISTOGRAM_H_
+
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+
+class Executor;
+
+// S2CellHistogram stores a count for each of a collection of S2CellIds and
+// answers "how many are there within this cell (or S2CellUnion)" queries.
+// It is intended for aggregating point counts at many levels at once (e.g.,
+// for heatmaps) without maintaining a separate map per level.
+//
+// Counts are stored once, at the cell where they were added (typically a
+// leaf cell), in S2CellId order together with their prefix sums.  Since the
+// descendants of a cell form a contiguous range of S2CellIds, the count for
+// any cell is the difference of two prefix sums found by binary search.
+// A count added at a cell is included in the totals for that cell and its
+// ancestors, but not for its descendants.
+//
+// To build a histogram, call Add() for each cell and then call Build():
+//
+//   S2CellHistogram histogram;
+//   for (const S2Point& p : points) histogram.Add(S2CellId(p));
+//   histogram.Build();
+//   int64 n = histogram.GetCount(covering);
+//
+// Histograms built from disjoint shards of the data can be combined with
+// Merge(), which is linear in the number of distinct cells.
+class S2CellHistogram {
+ public:
+  S2CellHistogram() {}
+
+  // Adds "count" to the given cell.  Invalidates any previous Build().
+  void Add(S2CellId id, int64 count = 1);
+
+  // Sorts the cells added so far and combines duplicates.  This method must
+  // be called before the query methods below.
+  void Build();
+
+  // Clears the contents of the histogram.
+  void Clear();
+
+  // Returns the number of distinct cells with a count.
+  // REQUIRES: Build() has been called.
+  int num_cells() const { return static_cast<int>(ids_.size()); }
+
+  // Returns the sum of all counts.
+  // REQUIRES: Build() has been called.
+  int64 total_count() const { return sums_.back(); }
+
+  // Returns the sum of the counts of all cells contained by "id".
+  // REQUIRES: Build() has been called.
+  int64 GetCount(S2CellId id) const;
+
+  // Returns the sum of the counts of all cells contained by "cell_union".
+  // The union should be normalized (or at least not contain overlapping
+  // cells), since otherwise some counts are included more than once.
+  // REQUIRES: Build() has been called.
+  int64 GetCount(const S2CellUnion& cell_union) const;
+
+  // Adds the counts of "other" to this histogram.  The result is the same as
+  // calling Add() for every cell of "other" followed by Build(), but takes
+  // time linear in the number of cells.
+  // REQUIRES: Build() has been called on both histograms.
+  void Merge(const S2CellHistogram& other);
+
+  // Merges the given histograms into one by combining them pairwise, using
+  // "executor" (if not nullptr) to perform the merges at each round in
+  // parallel.  The inputs are consumed.
+  // REQUIRES: Build() has been called on every histogram.
+  static S2CellHistogram MergeAll(std::vector<S2CellHistogram> histograms,
+                                  Executor* executor = nullptr);
+
+ private:
+  // Returns the index of the first cell whose id is at least "id".
+  int LowerBound(S2CellId id) const;
+
+  // Cells added since the last call to Build().
+  std::vector<std::pair<S2CellId, int64>> pending_;
+
+  // The distinct cells in increasing order, and the prefix sums of their
+  // counts (i.e., sums_[i] is the total count of ids_[0..i-1]).
+  std::vector<S2CellId> ids_;
+  std::vector<int64> sums_ = {0};
+};
+
+#endif  // S2_S2CELL_HISTOGRAM_H_
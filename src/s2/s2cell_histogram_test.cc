@@ -0,0 +1,128 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_histogram.h"
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/s2cap.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+#include "s2/util/thread/executor.h"
+
+using std::vector;
+
+namespace {
+
+// Returns the number of points in "points" contained by "cell_union".
+int64 BruteForceCount(const vector<S2CellId>& points,
+                      const S2CellUnion& cell_union) {
+  int64 count = 0;
+  for (S2CellId id : points) count += cell_union.Contains(id);
+  return count;
+}
+
+TEST(S2CellHistogram, Empty) {
+  S2CellHistogram histogram;
+  histogram.Build();
+  EXPECT_EQ(0, histogram.num_cells());
+  EXPECT_EQ(0, histogram.total_count());
+  EXPECT_EQ(0, histogram.GetCount(S2CellId::FromFace(0)));
+}
+
+TEST(S2CellHistogram, CountsAncestorsButNotDescendants) {
+  S2CellId leaf = S2Testing::GetRandomCellId(S2CellId::kMaxLevel);
+  S2CellHistogram histogram;
+  histogram.Add(leaf, 3);
+  histogram.Add(leaf.parent(10), 5);
+  histogram.Add(leaf);
+  histogram.Build();
+  EXPECT_EQ(2, histogram.num_cells());
+  EXPECT_EQ(9, histogram.total_count());
+  EXPECT_EQ(4, histogram.GetCount(leaf));
+  EXPECT_EQ(4, histogram.GetCount(leaf.parent(20)));
+  EXPECT_EQ(9, histogram.GetCount(leaf.parent(10)));
+  EXPECT_EQ(9, histogram.GetCount(leaf.parent(0)));
+  EXPECT_EQ(0, histogram.GetCount(leaf.parent(10).next()));
+}
+
+TEST(S2CellHistogram, CellUnionMatchesBruteForce) {
+  S2Testing::rnd.Reset(1);
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(10));
+  vector<S2CellId> points;
+  S2CellHistogram histogram;
+  for (int i = 0; i < 10000; ++i) {
+    points.push_back(S2CellId(S2Testing::SamplePoint(cap)));
+    histogram.Add(points.back());
+  }
+  histogram.Build();
+  EXPECT_EQ(points.size(), histogram.total_count());
+  S2RegionCoverer coverer;
+  for (int iter = 0; iter < 20; ++iter) {
+    S2Cap query(S2Testing::SamplePoint(cap),
+                S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 5)));
+    S2CellUnion covering = coverer.GetCovering(query);
+    EXPECT_EQ(BruteForceCount(points, covering),
+              histogram.GetCount(covering));
+  }
+}
+
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(S2CellHistogram, MergeShards) {
+  S2Testing::rnd.Reset(1);
+  S2CellHistogram expected;
+  vector<S2CellHistogram> shards(7);
+  for (int i = 0; i < 5000; ++i) {
+    // Use low-level cells so that the shards contain duplicates.
+    S2CellId id = S2Testing::GetRandomCellId(6);
+    expected.Add(id);
+    shards[i % shards.size()].Add(id);
+  }
+  expected.Build();
+  for (auto& shard : shards) shard.Build();
+  ThreadPerTaskExecutor executor;
+  S2CellHistogram merged =
+      S2CellHistogram::MergeAll(std::move(shards), &executor);
+  EXPECT_EQ(expected.num_cells(), merged.num_cells());
+  EXPECT_EQ(expected.total_count(), merged.total_count());
+  for (int iter = 0; iter < 100; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId(S2Testing::rnd.Uniform(7));
+    EXPECT_EQ(expected.GetCount(id), merged.GetCount(id));
+  }
+}
+
+}  // namespace
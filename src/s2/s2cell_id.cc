@@ -22,6 +22,7 @@
 #include <cmath>
 #include <cstring>
 #include <iosfwd>
+#include <iterator>
 #include <mutex>
 #include <vector>
 
@@ -70,6 +71,7 @@ const int S2CellId::kNumFaces;
 const int S2CellId::kMaxLevel;
 const int S2CellId::kPosBits;
 const int S2CellId::kMaxSize;
+const int S2CellId::kMaxTokenLength;
 
 static const int kLookupBits = 4;
 static uint16 lookup_pos[1 << (2 * kLookupBits + 2)];
@@ -193,15 +195,12 @@ int S2CellId::GetCommonAncestorLevel(S2CellId other) const {
   return max(60 - Bits::FindMSBSetNonZero64(bits), -1) >> 1;
 }
 
-// Print the num_digits low order hex digits.
-static string HexFormatString(uint64 val, size_t num_digits) {
-  string result(num_digits, ' ');
-  for (; num_digits--; val >>= 4)
-    result[num_digits] = "0123456789abcdef"[val & 0xF];
-  return result;
+string S2CellId::ToToken() const {
+  char buffer[kMaxTokenLength];
+  return string(buffer, ToToken(buffer));
 }
 
-string S2CellId::ToToken() const {
+int S2CellId::ToToken(char* buffer) const {
   // Simple implementation: print the id in hex without trailing zeros.
   // Using hex has the advantage that the tokens are case-insensitive, all
   // characters are alphanumeric, no characters require any special escaping
@@ -214,34 +213,81 @@ string S2CellId::ToToken() const {
 
   // "0" with trailing 0s stripped is the empty string, which is not a
   // reasonable token.  Encode as "X".
-  if (id_ == 0) return "X";
-  const size_t num_zero_digits = Bits::FindLSBSetNonZero64(id_) / 4;
-  return HexFormatString(id_ >> (4 * num_zero_digits), 16 - num_zero_digits);
+  if (id_ == 0) {
+    buffer[0] = 'X';
+    return 1;
+  }
+  const int num_digits = 16 - Bits::FindLSBSetNonZero64(id_) / 4;
+  uint64 val = id_ >> (4 * (16 - num_digits));
+  for (int i = num_digits; i-- > 0; val >>= 4) {
+    buffer[i] = "0123456789abcdef"[val & 0xF];
+  }
+  return num_digits;
 }
 
+namespace {
+
+// A table that maps each character to its hex digit value, or to -1 if the
+// character is not a hex digit.
+class HexDigitTable {
+ public:
+  HexDigitTable() {
+    std::fill_n(values_, 256, -1);
+    for (int d = 0; d < 10; ++d) values_['0' + d] = d;
+    for (int d = 0; d < 6; ++d) {
+      values_['a' + d] = values_['A' + d] = 10 + d;
+    }
+  }
+  int value(char c) const { return values_[static_cast<unsigned char>(c)]; }
+
+ private:
+  int8 values_[256];
+};
+
+const HexDigitTable& GetHexDigitTable() {
+  static const HexDigitTable* const table = new HexDigitTable;
+  return *table;
+}
+
+}  // namespace
+
 S2CellId S2CellId::FromToken(const char* token, size_t length) {
-  if (length > 16) return S2CellId::None();
+  if (length > kMaxTokenLength) return S2CellId::None();
+  const HexDigitTable& table = GetHexDigitTable();
   uint64 id = 0;
+  int invalid = 0;
   for (int i = 0, pos = 60; i < length; ++i, pos -= 4) {
-    uint64 d;
-    if ('0' <= token[i] && token[i] <= '9') {
-      d = token[i] - '0';
-    } else if ('a' <= token[i] && token[i] <= 'f') {
-      d = token[i] - 'a' + 10;
-    } else if ('A' <= token[i] && token[i] <= 'F') {
-      d = token[i] - 'A' + 10;
-    } else {
-      return S2CellId::None();
-    }
-    id |= d << pos;
+    // Invalid digits are accumulated rather than tested individually, so
+    // that the loop has no data-dependent branches.
+    int d = table.value(token[i]);
+    invalid |= d;
+    id |= static_cast<uint64>(d & 0xF) << pos;
   }
-  return S2CellId(id);
+  return invalid < 0 ? S2CellId::None() : S2CellId(id);
 }
 
 S2CellId S2CellId::FromToken(const string& token) {
   return FromToken(token.data(), token.size());
 }
 
+/*static*/ void S2CellId::ToTokens(absl::Span<const S2CellId> ids,
+                                   absl::Span<char> buffer,
+                                   absl::Span<int> lengths) {
+  S2_DCHECK_EQ(kMaxTokenLength * ids.size(), buffer.size());
+  S2_DCHECK_EQ(ids.size(), lengths.size());
+  for (size_t k = 0; k < ids.size(); ++k) {
+    lengths[k] = ids[k].ToToken(&buffer[k * kMaxTokenLength]);
+  }
+}
+
+/*static*/ void S2CellId::FromTokens(
+    absl::Span<const absl::string_view> tokens, absl::Span<S2CellId> ids) {
+  S2_DCHECK_EQ(tokens.size(), ids.size());
+  for (size_t k = 0; k < tokens.size(); ++k) {
+    ids[k] = FromToken(tokens[k].data(), tokens[k].size());
+  }
+}
+
 void S2CellId::Encode(Encoder* const encoder) const {
   encoder->Ensure(sizeof(uint64));  // A single uint64.
   encoder->put64(id_);
@@ -253,17 +299,16 @@ bool S2CellId::Decode(Decoder* const decoder) {
   return true;
 }
 
-S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
-  // Initialization if not done yet
-  MaybeInit();
-
+// Returns S2CellId::FromFaceIJ(face, i, j).id().
+// REQUIRES: MaybeInit() has been called.
+inline static uint64 FaceIJToId(int face, int i, int j) {
   // Optimization notes:
   //  - Non-overlapping bit fields can be combined with either "+" or "|".
   //    Generally "+" seems to produce better code, but not always.
 
   // Note that this value gets shifted one bit to the left at the end
   // of the function.
-  uint64 n = absl::implicit_cast<uint64>(face) << (kPosBits - 1);
+  uint64 n = absl::implicit_cast<uint64>(face) << (S2CellId::kPosBits - 1);
 
   // Alternating faces have opposite Hilbert curve orientations; this
   // is necessary in order for all faces to have a right-handed
@@ -294,7 +339,13 @@ S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
   GET_BITS(0);
 #undef GET_BITS
 
-  return S2CellId(n * 2 + 1);
+  return n * 2 + 1;
+}
+
+S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
+  // Initialization if not done yet
+  MaybeInit();
+  return S2CellId(FaceIJToId(face, i, j));
 }
 
 S2CellId::S2CellId(const S2Point& p) {
@@ -309,6 +360,47 @@ S2CellId::S2CellId(const S2LatLng& ll)
   : S2CellId(ll.ToPoint()) {
 }
 
+// The number of points converted at once by S2CellId::FromPoints.
+static const int kBatchSize = 64;
+
+/*static*/ void S2CellId::FromPoints(absl::Span<const S2Point> points,
+                                     absl::Span<S2CellId> ids) {
+  S2_DCHECK_EQ(points.size(), ids.size());
+  MaybeInit();
+  int face[kBatchSize], i[kBatchSize], j[kBatchSize];
+  double u[kBatchSize], v[kBatchSize];
+  for (size_t start = 0; start < points.size(); start += kBatchSize) {
+    int n = min<size_t>(kBatchSize, points.size() - start);
+    // First project the points onto the cube faces.  These loops consist of
+    // branch-free floating-point arithmetic only, which the compiler can
+    // schedule (and possibly vectorize) without waiting for memory lookups.
+    auto u_span = absl::MakeSpan(u, n), v_span = absl::MakeSpan(v, n);
+    S2::XYZtoFaceUV(points.subspan(start, n), absl::MakeSpan(face, n),
+                    u_span, v_span);
+    S2::UVtoST(u_span, u_span);
+    S2::UVtoST(v_span, v_span);
+    for (int k = 0; k < n; ++k) {
+      i[k] = S2::STtoIJ(u[k]);
+      j[k] = S2::STtoIJ(v[k]);
+    }
+    // Then map each (face, i, j) to a Hilbert curve position.
+    for (int k = 0; k < n; ++k) {
+      ids[start + k] = S2CellId(FaceIJToId(face[k], i[k], j[k]));
+    }
+  }
+}
+
+/*static*/ void S2CellId::FromLatLngs(absl::Span<const S2LatLng> latlngs,
+                                      absl::Span<S2CellId> ids) {
+  S2_DCHECK_EQ(latlngs.size(), ids.size());
+  S2Point points[kBatchSize];
+  for (size_t start = 0; start < latlngs.size(); start += kBatchSize) {
+    int n = min<size_t>(kBatchSize, latlngs.size() - start);
+    for (int k = 0; k < n; ++k) points[k] = latlngs[start + k].ToPoint();
+    FromPoints(absl::MakeConstSpan(points, n), ids.subspan(start, n));
+  }
+}
+
 int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
   // Initialization if not done yet
   MaybeInit();
@@ -372,6 +464,72 @@ S2Point S2CellId::ToPointRaw() const {
   return S2::FaceSiTitoXYZ(face, si, ti);
 }
 
+// Converts parallel arrays of latitudes and longitudes to S2CellIds at the
+// given level, where "to_angle" converts each coordinate to an S1Angle.
+template <class T>
+static void FromLatLngColumns(absl::Span<const T> lats,
+                              absl::Span<const T> lngs, S1Angle to_angle(T),
+                              int level, absl::Span<S2CellId> ids) {
+  S2_DCHECK_EQ(lats.size(), lngs.size());
+  S2_DCHECK_EQ(lats.size(), ids.size());
+  S2_DCHECK_GE(level, 0);
+  S2_DCHECK_LE(level, S2CellId::kMaxLevel);
+  S2Point points[kBatchSize];
+  for (size_t start = 0; start < lats.size(); start += kBatchSize) {
+    int n = min<size_t>(kBatchSize, lats.size() - start);
+    // This is equivalent to S2LatLng::ToPoint().  Because the sine and cosine
+    // of each angle are computed together, the compiler can use a combined
+    // sincos() routine.
+    for (int k = 0; k < n; ++k) {
+      double phi = to_angle(lats[start + k]).radians();
+      double theta = to_angle(lngs[start + k]).radians();
+      double cosphi = cos(phi);
+      points[k] = S2Point(cos(theta) * cosphi, sin(theta) * cosphi, sin(phi));
+    }
+    absl::Span<S2CellId> batch_ids = ids.subspan(start, n);
+    S2CellId::FromPoints(absl::MakeConstSpan(points, n), batch_ids);
+    if (level < S2CellId::kMaxLevel) {
+      for (S2CellId& id : batch_ids) id = id.parent(level);
+    }
+  }
+}
+
+/*static*/ void S2CellId::FromE7(absl::Span<const int32> lats,
+                                 absl::Span<const int32> lngs,
+                                 int level, absl::Span<S2CellId> ids) {
+  FromLatLngColumns(lats, lngs, S1Angle::E7, level, ids);
+}
+
+/*static*/ void S2CellId::FromDegrees(absl::Span<const double> lats,
+                                      absl::Span<const double> lngs,
+                                      int level, absl::Span<S2CellId> ids) {
+  FromLatLngColumns(lats, lngs, S1Angle::Degrees, level, ids);
+}
+
+/*static*/ void S2CellId::ToPoints(absl::Span<const S2CellId> ids,
+                                   absl::Span<S2Point> points) {
+  S2_DCHECK_EQ(ids.size(), points.size());
+  for (size_t k = 0; k < ids.size(); ++k) points[k] = ids[k].ToPoint();
+}
+
+/*static*/ void S2CellId::GetParents(absl::Span<const S2CellId> ids,
+                                     absl::Span<const int> levels,
+                                     absl::Span<S2CellId> parents) {
+  S2_DCHECK_EQ(levels.size() * ids.size(), parents.size());
+  S2CellId* out = parents.data();
+  for (int level : levels) {
+    S2_DCHECK_GE(level, 0);
+    S2_DCHECK_LE(level, kMaxLevel);
+    const uint64 new_lsb = lsb_for_level(level);
+    const uint64 mask = ~new_lsb + 1;
+    for (size_t k = 0; k < ids.size(); ++k) {
+      S2_DCHECK_LE(level, ids[k].level());
+      out[k] = S2CellId((ids[k].id() & mask) | new_lsb);
+    }
+    out += ids.size();
+  }
+}
+
 S2LatLng S2CellId::ToLatLng() const {
   return S2LatLng(ToPointRaw());
 }
@@ -585,6 +743,142 @@ void S2CellId::AppendAllNeighbors(int nbr_level,
   }
 }
 
+// Describes how the (i,j) coordinates just beyond one edge of a cube face
+// map onto the adjacent face.  The edges of each face are numbered as in
+// GetEdgeNeighbors: 0 = bottom (j < 0), 1 = right (i >= kMaxSize), 2 = top
+// (j >= kMaxSize), and 3 = left (i < 0).  The "along" coordinate is the one
+// parallel to the edge, and the "depth" is the distance beyond the edge
+// (in leaf cells, starting from zero).
+struct FaceEdgeUnfolding {
+  int face;             // The adjacent face.
+  bool along_is_i;      // True if "along" maps to i on the adjacent face.
+  bool reverse_along;   // True if "along" maps to kMaxSize - 1 - along.
+  bool depth_from_max;  // True if "depth" maps to kMaxSize - 1 - depth.
+};
+static FaceEdgeUnfolding unfoldings[6][4];
+
+static std::once_flag unfoldings_flag;
+inline static void MaybeInitUnfoldings() {
+  std::call_once(unfoldings_flag, []{
+    const int kMaxSize = S2CellId::kMaxSize;
+    for (int face = 0; face < 6; ++face) {
+      for (int edge = 0; edge < 4; ++edge) {
+        // Find the neighbors across the edge of two leaf cells along the
+        // edge, and check where they are on the adjacent face.
+        int i[2], j[2], f = face;
+        for (int k = 0; k < 2; ++k) {
+          int along = (2 * k + 1) * (kMaxSize / 4);
+          int boundary = (edge == 0 || edge == 3) ? 0 : kMaxSize - 1;
+          S2CellId nbrs[4];
+          S2CellId::FromFaceIJ(face, (edge & 1) ? boundary : along,
+                               (edge & 1) ? along : boundary)
+              .GetEdgeNeighbors(nbrs);
+          f = nbrs[edge].ToFaceIJOrientation(&i[k], &j[k], nullptr);
+        }
+        FaceEdgeUnfolding* u = &unfoldings[face][edge];
+        u->face = f;
+        u->along_is_i = (j[0] == j[1]);
+        int along0 = u->along_is_i ? i[0] : j[0];
+        int along1 = u->along_is_i ? i[1] : j[1];
+        int depth0 = u->along_is_i ? j[0] : i[0];
+        u->reverse_along = (along1 < along0);
+        u->depth_from_max = (depth0 != 0);
+        S2_DCHECK_EQ(u->reverse_along ? kMaxSize - 1 - kMaxSize / 4
+                                      : kMaxSize / 4, along0);
+        S2_DCHECK(depth0 == 0 || depth0 == kMaxSize - 1);
+      }
+    }
+  });
+}
+
+// Given leaf cell coordinates (i,j) on the given face where exactly one of
+// "i" or "j" is outside the range [0, kMaxSize-1], maps them across the
+// corresponding face edge to the leaf cell coordinates on the adjacent face.
+static void UnfoldFaceIJ(int* face, int* i, int* j) {
+  const int kMaxSize = S2CellId::kMaxSize;
+  int edge, along, depth;
+  if (*j < 0 || *j >= kMaxSize) {
+    edge = (*j < 0) ? 0 : 2;
+    along = *i;
+    depth = (*j < 0) ? -1 - *j : *j - kMaxSize;
+  } else {
+    edge = (*i < 0) ? 3 : 1;
+    along = *j;
+    depth = (*i < 0) ? -1 - *i : *i - kMaxSize;
+  }
+  const FaceEdgeUnfolding& u = unfoldings[*face][edge];
+  if (u.reverse_along) along = kMaxSize - 1 - along;
+  if (u.depth_from_max) depth = kMaxSize - 1 - depth;
+  *face = u.face;
+  *i = u.along_is_i ? along : depth;
+  *j = u.along_is_i ? depth : along;
+}
+
+void S2CellId::AppendDisc(int k, vector<S2CellId>* output) const {
+  S2_DCHECK_GE(k, 0);
+  S2_DCHECK_LE(2 * k + 1, 1 << level());
+  const int level = this->level();
+  int i, j;
+  int face = ToFaceIJOrientation(&i, &j, nullptr);
+  int size = GetSizeIJ();
+  i &= -size;
+  j &= -size;
+
+  // If the (2k+1)x(2k+1) block of cells centered on this cell extends across
+  // both an i-edge and a j-edge of the face, then it surrounds a cube vertex.
+  // Since only three faces meet at a vertex, some cells near the vertex are
+  // fewer than "k" steps away even though they are outside the block.  This
+  // is rare, so we simply expand the disc one step at a time.
+  bool crosses_i = (i < k * size || i + (k + 1) * size > kMaxSize);
+  bool crosses_j = (j < k * size || j + (k + 1) * size > kMaxSize);
+  if (crosses_i && crosses_j) {
+    vector<S2CellId> disc = {*this}, frontier = {*this}, nbrs, merged;
+    for (int step = 0; step < k; ++step) {
+      nbrs.clear();
+      for (S2CellId id : frontier) id.AppendAllNeighbors(level, &nbrs);
+      std::sort(nbrs.begin(), nbrs.end());
+      nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+      frontier.clear();
+      std::set_difference(nbrs.begin(), nbrs.end(), disc.begin(), disc.end(),
+                          std::back_inserter(frontier));
+      merged.clear();
+      std::merge(disc.begin(), disc.end(), frontier.begin(), frontier.end(),
+                 std::back_inserter(merged));
+      disc.swap(merged);
+    }
+    output->insert(output->end(), disc.begin(), disc.end());
+    return;
+  }
+  // Otherwise every cell in the block is found using (i,j) arithmetic, where
+  // each cell is identified by the coordinates of its lower left-hand leaf
+  // cell.  Cells beyond the face boundary are found by unfolding the cube
+  // across the face edge, which preserves the number of steps.
+  MaybeInitUnfoldings();
+  const size_t begin = output->size();
+  for (int dj = -k; dj <= k; ++dj) {
+    for (int di = -k; di <= k; ++di) {
+      int f = face, ci = i + di * size, cj = j + dj * size;
+      if (ci < 0 || ci >= kMaxSize || cj < 0 || cj >= kMaxSize) {
+        UnfoldFaceIJ(&f, &ci, &cj);
+      }
+      output->push_back(FromFaceIJ(f, ci, cj).parent(level));
+    }
+  }
+  std::sort(output->begin() + begin, output->end());
+}
+
+void S2CellId::AppendRing(int k, vector<S2CellId>* output) const {
+  if (k == 0) {
+    output->push_back(*this);
+    return;
+  }
+  vector<S2CellId> outer, inner;
+  AppendDisc(k, &outer);
+  AppendDisc(k - 1, &inner);
+  std::set_difference(outer.begin(), outer.end(), inner.begin(), inner.end(),
+                      std::back_inserter(*output));
+}
+
 string S2CellId::ToString() const {
   if (!is_valid()) {
     return StrCat("Invalid: ", absl::Hex(id(), absl::kZeroPad16));
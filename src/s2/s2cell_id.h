@@ -34,6 +34,7 @@
 #include "s2/s2coords.h"
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/strings/string_view.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/util/bits/bits.h"
 #include "s2/util/coding/coder.h"
 
@@ -107,6 +108,33 @@ class S2CellId {
   // Construct a leaf cell containing the given normalized S2LatLng.
   explicit S2CellId(const S2LatLng& ll);
 
+  // Batch versions of the two constructors above, which set ids[k] to the
+  // leaf cell containing points[k] (or latlngs[k]).  These methods are
+  // faster than converting the values one at a time because the projections
+  // onto the cube faces are computed in a separate pass from the Hilbert
+  // curve table lookups.
+  //
+  // REQUIRES: ids.size() == points.size() (or latlngs.size())
+  static void FromPoints(absl::Span<const S2Point> points,
+                         absl::Span<S2CellId> ids);
+  static void FromLatLngs(absl::Span<const S2LatLng> latlngs,
+                          absl::Span<S2CellId> ids);
+
+  // Columnar versions of FromLatLngs() that take parallel arrays of latitudes
+  // and longitudes, and set ids[k] to the cell at the given level containing
+  // (lats[k], lngs[k]).  No intermediate S2LatLng objects are constructed.
+  // The result is identical to
+  //
+  //   S2CellId(S2LatLng::FromE7(lats[k], lngs[k])).parent(level)
+  //
+  // REQUIRES: lats.size() == lngs.size() && lats.size() == ids.size()
+  // REQUIRES: 0 <= level <= kMaxLevel
+  static void FromE7(absl::Span<const int32> lats, absl::Span<const int32> lngs,
+                     int level, absl::Span<S2CellId> ids);
+  static void FromDegrees(absl::Span<const double> lats,
+                          absl::Span<const double> lngs,
+                          int level, absl::Span<S2CellId> ids);
+
   // The default constructor returns an invalid cell id.
   IFNDEF_SWIG(constexpr) S2CellId() : id_(0) {}
   static constexpr S2CellId None() { return S2CellId(); }
@@ -136,6 +164,12 @@ class S2CellId {
   S2Point ToPoint() const { return ToPointRaw().Normalize(); }
   S2Point ToPointRaw() const;
 
+  // Batch version of ToPoint() that sets points[k] to ids[k].ToPoint().
+  //
+  // REQUIRES: points.size() == ids.size()
+  static void ToPoints(absl::Span<const S2CellId> ids,
+                       absl::Span<S2Point> points);
+
   // Return the center of the cell in (s,t) coordinates (see s2coords.h).
   R2Point GetCenterST() const;
 
@@ -275,6 +309,18 @@ class S2CellId {
   S2CellId parent() const;
   S2CellId parent(int level) const;
 
+  // Columnar batch version of parent(level) that computes the ancestors of
+  // every cell in "ids" at each of the given levels.  The ancestors at
+  // levels[i] are stored contiguously, i.e. parents[i * ids.size() + k] is
+  // set to ids[k].parent(levels[i]).  The inner loop over "ids" uses only
+  // mask arithmetic so that the compiler can vectorize it.
+  //
+  // REQUIRES: parents.size() == levels.size() * ids.size()
+  // REQUIRES: 0 <= levels[i] <= ids[k].level() for all i and k
+  static void GetParents(absl::Span<const S2CellId> ids,
+                         absl::Span<const int> levels,
+                         absl::Span<S2CellId> parents);
+
   // Return the immediate child of this cell at the given traversal order
   // position (in the range 0 to 3).  This cell must not be a leaf cell.
   S2CellId child(int position) const;
@@ -367,6 +413,26 @@ class S2CellId {
   static S2CellId FromToken(const char* token, size_t length);
   static S2CellId FromToken(const string& token);
 
+  // The maximum number of characters in a token.
+  static const int kMaxTokenLength = 16;
+
+  // Allocation-free version of ToToken() that writes the token to "buffer"
+  // (without a terminating NUL) and returns its length.
+  //
+  // REQUIRES: "buffer" has room for at least kMaxTokenLength characters.
+  int ToToken(char* buffer) const;
+
+  // Batch versions of ToToken() and FromToken().  ToTokens() writes the
+  // token for ids[k] to buffer[k * kMaxTokenLength] and sets lengths[k] to
+  // its length.  FromTokens() sets ids[k] to FromToken(tokens[k]).
+  //
+  // REQUIRES: buffer.size() == kMaxTokenLength * ids.size()
+  // REQUIRES: lengths.size() == ids.size() (or tokens.size() == ids.size())
+  static void ToTokens(absl::Span<const S2CellId> ids, absl::Span<char> buffer,
+                       absl::Span<int> lengths);
+  static void FromTokens(absl::Span<const absl::string_view> tokens,
+                         absl::Span<S2CellId> ids);
+
   // Use encoder to generate a serialized representation of this cell id.
   // Can also encode an invalid cell.
   void Encode(Encoder* const encoder) const;
@@ -414,6 +480,28 @@ class S2CellId {
   // REQUIRES: nbr_level >= this->level().
   void AppendAllNeighbors(int nbr_level, std::vector<S2CellId>* output) const;
 
+  // Appends all cells at this cell's level that are within "k" steps of this
+  // cell to "output", including this cell itself.  Each step moves to a
+  // neighbor as defined by AppendAllNeighbors(), so unless the cells are
+  // near a cube vertex the result is the (2k+1)x(2k+1) block of cells
+  // centered on this cell.  The cells are appended in increasing order
+  // without duplicates.  Except near the cube vertices they are computed
+  // directly from (i,j) coordinates, unfolding the cube across a face edge
+  // where necessary, which is much faster than expanding
+  // AppendAllNeighbors() repeatedly and removing duplicates.
+  //
+  // REQUIRES: k >= 0
+  // REQUIRES: 2 * k + 1 <= 2**level() (the block is no larger than a face)
+  void AppendDisc(int k, std::vector<S2CellId>* output) const;
+
+  // Like AppendDisc(), but appends only the cells that are exactly "k" steps
+  // from this cell.  (AppendRing(1, output) appends the same cells as
+  // AppendAllNeighbors(level(), output), but sorted and without duplicates.)
+  //
+  // REQUIRES: k >= 0
+  // REQUIRES: 2 * k + 1 <= 2**level()
+  void AppendRing(int k, std::vector<S2CellId>* output) const;
+
   /////////////////////////////////////////////////////////////////////
   // Low-level methods.
 
@@ -0,0 +1,236 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2cell_id_external_sorter.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "s2/base/logging.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/coding/coder.h"
+
+using std::vector;
+
+// A sorted run of entries stored in a temporary file.  The file consists of
+// a sequence of blocks, where each block is a 64-bit length followed by an
+// encoded vector of S2CellIds and an encoded vector of values.
+class S2CellIdExternalSorter::Run {
+ public:
+  // Takes ownership of "file".
+  explicit Run(std::FILE* file) : file_(file) {}
+  ~Run() { std::fclose(file_); }
+
+  // Appends the given sorted entries to the file.
+  bool Write(const vector<Entry>& entries, int block_size, S2Error* error);
+
+  // Prepares to read the entries from the start of the file.
+  bool Start(S2Error* error);
+
+  // Returns true if all entries in the file have been read.
+  bool done() const { return pos_ == size_; }
+
+  // Returns the current entry.
+  // REQUIRES: !done()
+  const Entry& entry() const { return entry_; }
+
+  // Advances to the next entry.  Returns false on errors.
+  bool Next(S2Error* error);
+
+ private:
+  // Reads the next block of the file, or sets done() if there are no more
+  // blocks.  Returns false on errors.
+  bool ReadBlock(S2Error* error);
+
+  std::FILE* const file_;
+  vector<char> block_;
+  s2coding::EncodedS2CellIdVector ids_;
+  s2coding::EncodedUintVector<uint64> values_;
+  size_t pos_ = 0, size_ = 0;  // Position and size of the current block.
+  Entry entry_;
+};
+
+bool S2CellIdExternalSorter::Run::Write(const vector<Entry>& entries,
+                                        int block_size, S2Error* error) {
+  vector<S2CellId> ids;
+  vector<uint64> values;
+  Encoder encoder, header;
+  for (size_t start = 0; start < entries.size(); start += block_size) {
+    size_t end = std::min(entries.size(), start + block_size);
+    ids.clear();
+    values.clear();
+    for (size_t i = start; i < end; ++i) {
+      ids.push_back(entries[i].id);
+      values.push_back(entries[i].value);
+    }
+    encoder.clear();
+    s2coding::EncodeS2CellIdVector(ids, &encoder);
+    s2coding::EncodeUintVector<uint64>(values, &encoder);
+    header.clear();
+    header.Ensure(sizeof(uint64));
+    header.put64(encoder.length());
+    if (std::fwrite(header.base(), 1, header.length(), file_) !=
+            header.length() ||
+        std::fwrite(encoder.base(), 1, encoder.length(), file_) !=
+            encoder.length()) {
+      error->Init(S2Error::RESOURCE_EXHAUSTED,
+                  "Could not write to temporary file");
+      return false;
+    }
+  }
+  if (std::fflush(file_) != 0) {
+    error->Init(S2Error::RESOURCE_EXHAUSTED,
+                "Could not write to temporary file");
+    return false;
+  }
+  return true;
+}
+
+bool S2CellIdExternalSorter::Run::Start(S2Error* error) {
+  std::rewind(file_);
+  return ReadBlock(error);
+}
+
+bool S2CellIdExternalSorter::Run::Next(S2Error* error) {
+  S2_DCHECK(!done());
+  if (++pos_ == size_) return ReadBlock(error);
+  entry_ = Entry(ids_[pos_], values_[pos_]);
+  return true;
+}
+
+bool S2CellIdExternalSorter::Run::ReadBlock(S2Error* error) {
+  pos_ = size_ = 0;
+  char header[sizeof(uint64)];
+  size_t n = std::fread(header, 1, sizeof(header), file_);
+  if (n == 0 && std::feof(file_)) return true;  // No more blocks.
+  if (n == sizeof(header)) {
+    Decoder decoder(header, sizeof(header));
+    block_.resize(decoder.get64());
+    if (std::fread(block_.data(), 1, block_.size(), file_) == block_.size()) {
+      decoder.reset(block_.data(), block_.size());
+      if (ids_.Init(&decoder) && values_.Init(&decoder) &&
+          ids_.size() > 0 && ids_.size() == values_.size()) {
+        size_ = ids_.size();
+        entry_ = Entry(ids_[0], values_[0]);
+        return true;
+      }
+    }
+  }
+  error->Init(S2Error::DATA_LOSS, "Could not read temporary file");
+  return false;
+}
+
+S2CellIdExternalSorter::Options::Options() {
+}
+
+void S2CellIdExternalSorter::Options::set_max_entries_in_memory(
+    int max_entries_in_memory) {
+  S2_DCHECK_GT(max_entries_in_memory, 0);
+  max_entries_in_memory_ = max_entries_in_memory;
+}
+
+void S2CellIdExternalSorter::Options::set_block_size(int block_size) {
+  S2_DCHECK_GT(block_size, 0);
+  block_size_ = block_size;
+}
+
+S2CellIdExternalSorter::S2CellIdExternalSorter()
+    : S2CellIdExternalSorter(Options()) {
+}
+
+S2CellIdExternalSorter::S2CellIdExternalSorter(const Options& options)
+    : options_(options) {
+}
+
+S2CellIdExternalSorter::~S2CellIdExternalSorter() {
+}
+
+void S2CellIdExternalSorter::Add(S2CellId id, uint64 value) {
+  S2_DCHECK(!finished_);
+  ++num_entries_;
+  if (!error_.ok()) return;
+  buffer_.push_back(Entry(id, value));
+  if (buffer_.size() >= options_.max_entries_in_memory()) WriteRun();
+}
+
+void S2CellIdExternalSorter::WriteRun() {
+  std::sort(buffer_.begin(), buffer_.end());
+  std::FILE* file = std::tmpfile();
+  if (file == nullptr) {
+    error_.Init(S2Error::RESOURCE_EXHAUSTED,
+                "Could not create temporary file");
+    return;
+  }
+  runs_.push_back(absl::make_unique<Run>(file));
+  runs_.back()->Write(buffer_, options_.block_size(), &error_);
+  buffer_.clear();
+}
+
+namespace {
+
+// Orders runs so that the run with the smallest current entry is at the top
+// of the heap.
+struct RunGreater {
+  template <class T>
+  bool operator()(const T* x, const T* y) const {
+    return y->entry() < x->entry();
+  }
+};
+
+}  // namespace
+
+bool S2CellIdExternalSorter::Finish(S2Error* error) {
+  S2_DCHECK(!finished_);
+  finished_ = true;
+  if (runs_.empty()) {
+    std::sort(buffer_.begin(), buffer_.end());
+  } else if (error_.ok()) {
+    if (!buffer_.empty()) WriteRun();
+    vector<Entry>().swap(buffer_);
+    for (const auto& run : runs_) {
+      if (!run->Start(&error_)) break;
+      if (!run->done()) heap_.push_back(run.get());
+    }
+    std::make_heap(heap_.begin(), heap_.end(), RunGreater());
+  }
+  if (!error_.ok()) heap_.clear();
+  *error = error_;
+  return error_.ok();
+}
+
+bool S2CellIdExternalSorter::Next(Entry* entry) {
+  S2_DCHECK(finished_);
+  if (runs_.empty()) {
+    if (buffer_pos_ == buffer_.size()) return false;
+    *entry = buffer_[buffer_pos_++];
+    return true;
+  }
+  if (heap_.empty()) return false;
+  std::pop_heap(heap_.begin(), heap_.end(), RunGreater());
+  Run* run = heap_.back();
+  *entry = run->entry();
+  if (!run->Next(&error_)) {
+    heap_.clear();
+    return false;
+  }
+  if (run->done()) {
+    heap_.pop_back();
+  } else {
+    std::push_heap(heap_.begin(), heap_.end(), RunGreater());
+  }
+  return true;
+}
@@ -0,0 +1,158 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2CELL_ID_EXTERNAL_SORTER_H_
+#define S2_S2CELL_ID_EXTERNAL_SORTER_H_
+
+#include <memory>
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2error.h"
+
+// S2CellIdExternalSorter sorts a stream of (S2CellId, value) pairs that may
+// be too large to fit in memory.  The "value" is an arbitrary 64-bit integer,
+// typically the position of the corresponding record in some other file.
+// Entries are buffered in memory up to a configurable limit; each time the
+// limit is reached the buffer is sorted and written to a temporary file as a
+// "run".  Finish() then merges the runs, and the sorted entries can be read
+// back one at a time using Next().  If all the entries fit in memory, no
+// temporary files are created.
+//
+// The runs are written in blocks of S2CellIds and values encoded using
+// EncodedS2CellIdVector and EncodedUintVector, which typically take much
+// less space than the entries themselves since the S2CellIds are sorted.
+//
+// The sorted output is suitable for the bulk loading methods of the various
+// indexes, e.g. S2PointIndex::AddSorted().  For example:
+//
+//   S2CellIdExternalSorter sorter;
+//   for (...each record...) {
+//     sorter.Add(S2CellId(record.point()), record_offset);
+//   }
+//   S2Error error;
+//   if (!sorter.Finish(&error)) { ... }
+//   S2CellIdExternalSorter::Entry entry;
+//   while (sorter.Next(&entry)) {
+//     ... entry.id, entry.value ...
+//   }
+//   if (!sorter.error().ok()) { ... }
+//
+// Temporary files are created using std::tmpfile(), so they are removed
+// automatically when the sorter is destroyed (or the process exits).
+class S2CellIdExternalSorter {
+ public:
+  struct Entry {
+    S2CellId id;
+    uint64 value;
+
+    Entry() : value(0) {}
+    Entry(S2CellId _id, uint64 _value) : id(_id), value(_value) {}
+
+    // Entries are sorted by S2CellId, and then by value.
+    friend bool operator<(const Entry& x, const Entry& y) {
+      return x.id < y.id || (x.id == y.id && x.value < y.value);
+    }
+    friend bool operator==(const Entry& x, const Entry& y) {
+      return x.id == y.id && x.value == y.value;
+    }
+  };
+
+  class Options {
+   public:
+    Options();
+
+    // The maximum number of entries that are buffered in memory.  When this
+    // limit is reached, the buffered entries are sorted and written to a
+    // temporary file.  Each entry takes 16 bytes of memory.
+    //
+    // DEFAULT: 4194304 (i.e., 64MB)
+    int max_entries_in_memory() const { return max_entries_in_memory_; }
+    void set_max_entries_in_memory(int max_entries_in_memory);
+
+    // The number of entries in each encoded block of a temporary file.
+    // During the merge, one block from each run is held in memory.
+    //
+    // DEFAULT: 4096
+    int block_size() const { return block_size_; }
+    void set_block_size(int block_size);
+
+   private:
+    int max_entries_in_memory_ = 4194304;
+    int block_size_ = 4096;
+  };
+
+  // Default constructor; uses the default options.
+  S2CellIdExternalSorter();
+
+  explicit S2CellIdExternalSorter(const Options& options);
+
+  ~S2CellIdExternalSorter();
+
+  const Options& options() const { return options_; }
+
+  // Adds an entry to be sorted.
+  //
+  // REQUIRES: Finish() has not been called.
+  void Add(S2CellId id, uint64 value);
+
+  // Finishes adding entries and prepares to return them in sorted order.
+  // Returns false and sets "error" if writing a temporary file failed.
+  bool Finish(S2Error* error);
+
+  // Sets "entry" to the next entry in sorted order and returns true, or
+  // returns false if there are no more entries or an error occurred while
+  // reading a temporary file (see error()).
+  //
+  // REQUIRES: Finish() has been called and returned true.
+  bool Next(Entry* entry);
+
+  // Returns the first error encountered by this object, if any.
+  const S2Error& error() const { return error_; }
+
+  // Returns the total number of entries that have been added.
+  int64 num_entries() const { return num_entries_; }
+
+  // Returns the number of temporary files (sorted runs) that were written.
+  int num_runs() const { return static_cast<int>(runs_.size()); }
+
+ private:
+  class Run;
+
+  // Sorts the buffered entries and writes them to a new run.
+  void WriteRun();
+
+  Options options_;
+  int64 num_entries_ = 0;
+  bool finished_ = false;
+  S2Error error_;
+
+  // Entries that have not been written to a run yet.  If no runs were
+  // written, this is also where the entries are returned from.
+  std::vector<Entry> buffer_;
+  size_t buffer_pos_ = 0;
+
+  std::vector<std::unique_ptr<Run>> runs_;
+
+  // A min-heap of the runs that still have entries, ordered by their current
+  // entry.  Used to merge the runs.
+  std::vector<Run*> heap_;
+
+  S2CellIdExternalSorter(const S2CellIdExternalSorter&) = delete;
+  void operator=(const S2CellIdExternalSorter&) = delete;
+};
+
+#endif  // S2_S2CELL_ID_EXTERNAL_SORTER_H_
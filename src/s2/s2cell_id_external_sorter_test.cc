@@ -0,0 +1,83 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2cell_id_external_sorter.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2testing.h"
+
+using std::vector;
+
+using Entry = S2CellIdExternalSorter::Entry;
+
+namespace {
+
+// Adds "num_entries" random entries to a sorter with the given options, and
+// checks that they are returned in sorted order.
+void TestSort(const S2CellIdExternalSorter::Options& options,
+              int num_entries, int expected_num_runs) {
+  S2CellIdExternalSorter sorter(options);
+  vector<Entry> expected;
+  for (int i = 0; i < num_entries; ++i) {
+    // Use cells at various levels, including some duplicate S2CellIds (which
+    // are ordered by value).
+    S2CellId id = (i % 3 == 0) ? S2Testing::GetRandomCellId()
+                               : S2CellId(S2Testing::RandomPoint());
+    uint64 value = S2Testing::rnd.Rand64();
+    if (i % 5 == 0 && !expected.empty()) id = expected.back().id;
+    sorter.Add(id, value);
+    expected.push_back(Entry(id, value));
+  }
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(num_entries, sorter.num_entries());
+
+  S2Error error;
+  ASSERT_TRUE(sorter.Finish(&error)) << error;
+  EXPECT_EQ(expected_num_runs, sorter.num_runs());
+  vector<Entry> actual;
+  Entry entry;
+  while (sorter.Next(&entry)) actual.push_back(entry);
+  EXPECT_TRUE(sorter.error().ok()) << sorter.error();
+  EXPECT_TRUE(expected == actual);
+}
+
+TEST(S2CellIdExternalSorter, Empty) {
+  TestSort(S2CellIdExternalSorter::Options(), 0, 0);
+}
+
+TEST(S2CellIdExternalSorter, InMemory) {
+  TestSort(S2CellIdExternalSorter::Options(), 1000, 0);
+}
+
+TEST(S2CellIdExternalSorter, MergesRuns) {
+  S2CellIdExternalSorter::Options options;
+  options.set_max_entries_in_memory(1000);
+  options.set_block_size(64);
+  // The last run is partially full.
+  TestSort(options, 10500, 11);
+}
+
+TEST(S2CellIdExternalSorter, ExactMultipleOfRunSize) {
+  S2CellIdExternalSorter::Options options;
+  options.set_max_entries_in_memory(100);
+  options.set_block_size(100);
+  TestSort(options, 300, 3);
+}
+
+}  // namespace
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <iosfwd>
 #include <iostream>
+#include <set>
 #include <unordered_map>
 #include <vector>
 
@@ -36,8 +37,10 @@
 #include "s2/s2metrics.h"
 #include "s2/s2testing.h"
 #include "s2/third_party/absl/base/macros.h"
+#include "s2/third_party/absl/strings/str_cat.h"
 
 using S2::internal::kPosToOrientation;
+using absl::StrCat;
 using std::fabs;
 using std::min;
 using std::unordered_map;
@@ -282,6 +285,76 @@ TEST(S2CellId, Inverses) {
   }
 }
 
+TEST(S2CellId, BatchConversions) {
+  // Use a size that is not a multiple of the internal batch size.
+  static const int kNumPoints = 1000;
+  vector<S2Point> points;
+  vector<S2LatLng> latlngs;
+  for (int i = 0; i < kNumPoints; ++i) {
+    // Include some points that are not unit length.
+    points.push_back((1 + i % 3) * S2Testing::RandomPoint());
+    latlngs.push_back(S2LatLng(points.back()));
+  }
+  vector<S2CellId> ids(kNumPoints), latlng_ids(kNumPoints);
+  S2CellId::FromPoints(points, absl::MakeSpan(ids));
+  S2CellId::FromLatLngs(latlngs, absl::MakeSpan(latlng_ids));
+  vector<S2Point> centers(kNumPoints);
+  S2CellId::ToPoints(ids, absl::MakeSpan(centers));
+  for (int i = 0; i < kNumPoints; ++i) {
+    EXPECT_EQ(S2CellId(points[i]), ids[i]);
+    EXPECT_EQ(S2CellId(latlngs[i]), latlng_ids[i]);
+    EXPECT_EQ(ids[i].ToPoint(), centers[i]);
+  }
+}
+
+TEST(S2CellId, ColumnarConversions) {
+  static const int kNumPoints = 300;
+  vector<int32> lats_e7, lngs_e7;
+  vector<double> lats_degrees, lngs_degrees;
+  for (int i = 0; i < kNumPoints; ++i) {
+    S2LatLng ll(S2Testing::RandomPoint());
+    lats_e7.push_back(ll.lat().e7());
+    lngs_e7.push_back(ll.lng().e7());
+    lats_degrees.push_back(ll.lat().degrees());
+    lngs_degrees.push_back(ll.lng().degrees());
+  }
+  // Also test the poles and the antimeridian.
+  lats_e7.insert(lats_e7.end(), {900000000, -900000000, 0});
+  lngs_e7.insert(lngs_e7.end(), {0, 1800000000, -1800000000});
+  for (int level : {0, 10, S2CellId::kMaxLevel}) {
+    vector<S2CellId> ids(lats_e7.size());
+    S2CellId::FromE7(lats_e7, lngs_e7, level, absl::MakeSpan(ids));
+    for (int i = 0; i < ids.size(); ++i) {
+      EXPECT_EQ(S2CellId(S2LatLng::FromE7(lats_e7[i], lngs_e7[i]))
+                .parent(level), ids[i]);
+    }
+    ids.resize(kNumPoints);
+    S2CellId::FromDegrees(lats_degrees, lngs_degrees, level,
+                          absl::MakeSpan(ids));
+    for (int i = 0; i < kNumPoints; ++i) {
+      EXPECT_EQ(S2CellId(S2LatLng::FromDegrees(lats_degrees[i],
+                                               lngs_degrees[i]))
+                .parent(level), ids[i]);
+    }
+  }
+}
+
+TEST(S2CellId, GetParents) {
+  vector<S2CellId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(S2Testing::GetRandomCellId(S2CellId::kMaxLevel));
+  }
+  ids.push_back(S2CellId::FromFace(0).child_begin(S2CellId::kMaxLevel));
+  const vector<int> levels = {0, 5, 12, 29, S2CellId::kMaxLevel};
+  vector<S2CellId> parents(levels.size() * ids.size());
+  S2CellId::GetParents(ids, levels, absl::MakeSpan(parents));
+  for (int i = 0; i < levels.size(); ++i) {
+    for (int k = 0; k < ids.size(); ++k) {
+      EXPECT_EQ(ids[k].parent(levels[i]), parents[i * ids.size() + k]);
+    }
+  }
+}
+
 TEST(S2CellId, Tokens) {
   // Test random cell ids at all levels.
   for (int i = 0; i < 10000; ++i) {
@@ -317,6 +390,29 @@ TEST(S2CellId, Tokens) {
   EXPECT_EQ(S2CellId::None(), S2CellId::FromToken(" 876bee99"));
 }
 
+TEST(S2CellId, BatchTokens) {
+  vector<S2CellId> ids = {S2CellId::None(), S2CellId::Sentinel()};
+  for (int i = 0; i < 100; ++i) ids.push_back(S2Testing::GetRandomCellId());
+  vector<char> buffer(S2CellId::kMaxTokenLength * ids.size());
+  vector<int> lengths(ids.size());
+  S2CellId::ToTokens(ids, absl::MakeSpan(buffer), absl::MakeSpan(lengths));
+  vector<absl::string_view> tokens;
+  for (int k = 0; k < ids.size(); ++k) {
+    tokens.emplace_back(&buffer[k * S2CellId::kMaxTokenLength], lengths[k]);
+    EXPECT_EQ(ids[k].ToToken(), string(tokens.back()));
+  }
+  // Upper case digits are accepted and invalid tokens yield None().
+  tokens.push_back("89C25");
+  tokens.push_back("89g25");
+  tokens.push_back("89c25000000000000");
+  vector<S2CellId> decoded(tokens.size());
+  S2CellId::FromTokens(tokens, absl::MakeSpan(decoded));
+  for (int k = 0; k < ids.size(); ++k) EXPECT_EQ(ids[k], decoded[k]);
+  EXPECT_EQ(S2CellId::FromToken("89c25"), decoded[ids.size()]);
+  EXPECT_EQ(S2CellId::None(), decoded[ids.size() + 1]);
+  EXPECT_EQ(S2CellId::None(), decoded[ids.size() + 2]);
+}
+
 TEST(S2CellId, EncodeDecode) {
   S2CellId id(0x7837423);
   Encoder encoder;
@@ -556,6 +652,65 @@ static R2Point ProjectToBoundary(const R2Point& uv, const R2Rect& rect) {
   return R2Point(rect[0].Project(uv[0]), rect[1][1]);
 }
 
+// Returns the cells within "k" steps of "id" by expanding AppendAllNeighbors
+// repeatedly, in increasing order.
+static vector<S2CellId> GetDiscBruteForce(S2CellId id, int k) {
+  std::set<S2CellId> disc = {id};
+  vector<S2CellId> frontier = {id};
+  for (int step = 0; step < k; ++step) {
+    vector<S2CellId> neighbors, next;
+    for (S2CellId cell : frontier) cell.AppendAllNeighbors(id.level(),
+                                                           &neighbors);
+    for (S2CellId nbr : neighbors) {
+      if (disc.insert(nbr).second) next.push_back(nbr);
+    }
+    frontier.swap(next);
+  }
+  return vector<S2CellId>(disc.begin(), disc.end());
+}
+
+static void TestAppendDisc(S2CellId id, int k) {
+  SCOPED_TRACE(StrCat(id.ToString(), " k=", k));
+  vector<S2CellId> expected = GetDiscBruteForce(id, k);
+  vector<S2CellId> actual = {S2CellId::None()};  // Should be preserved.
+  id.AppendDisc(k, &actual);
+  ASSERT_EQ(S2CellId::None(), actual[0]);
+  actual.erase(actual.begin());
+  EXPECT_EQ(expected, actual);
+
+  vector<S2CellId> ring, inner = GetDiscBruteForce(id, k - 1);
+  id.AppendRing(k, &ring);
+  if (k == 0) inner.clear();
+  std::set<S2CellId> ring_set(ring.begin(), ring.end());
+  EXPECT_EQ(ring.size(), ring_set.size());
+  EXPECT_TRUE(std::is_sorted(ring.begin(), ring.end()));
+  EXPECT_EQ(expected.size(), ring.size() + inner.size());
+  for (S2CellId cell : inner) EXPECT_EQ(0, ring_set.count(cell));
+}
+
+TEST(S2CellId, AppendDisc) {
+  // Cells in the interior of a face, next to a face edge, and next to a cube
+  // vertex, where the cube must be unfolded across one or two edges.
+  for (int face = 0; face < 6; ++face) {
+    for (int level : {3, 6, 12}) {
+      const int n = 1 << level, size = S2CellId::GetSizeIJ(level);
+      for (int i : {0, 1, n / 2, n - 2, n - 1}) {
+        for (int j : {0, 2, n / 2, n - 1}) {
+          S2CellId id = S2CellId::FromFaceIJ(face, i * size, j * size)
+                            .parent(level);
+          for (int k = 0; 2 * k + 1 <= min(9, n); ++k) {
+            TestAppendDisc(id, k);
+          }
+        }
+      }
+    }
+  }
+  for (int iter = 0; iter < 20; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId(S2Testing::rnd.Uniform(10) + 5);
+    TestAppendDisc(id, S2Testing::rnd.Uniform(8));
+  }
+}
+
 void TestExpandedByDistanceUV(S2CellId id, S1Angle distance) {
   R2Rect bound = id.GetBoundUV();
   R2Rect expanded = S2CellId::ExpandedByDistanceUV(bound, distance);
@@ -17,14 +17,26 @@
 
 #include "s2/s2cell_index.h"
 
+#include <algorithm>
+
+#include "s2/util/coding/varint.h"
+#include "s2/util/thread/executor.h"
+
 using std::vector;
 
 using Label = S2CellIndex::Label;
 
 void S2CellIndex::RangeIterator::Seek(S2CellId target) {
   S2_DCHECK(target.is_leaf());
-  it_ = std::upper_bound(range_nodes_->begin(), range_nodes_->end(),
-                         target) - 1;
+  if (!index_->is_encoded_) {
+    const auto& range_nodes = index_->range_nodes_;
+    pos_ = std::upper_bound(range_nodes.begin(), range_nodes.end(),
+                            target) - range_nodes.begin() - 1;
+  } else {
+    // Find the last range node whose start_id is <= target.
+    pos_ = index_->encoded_range_start_ids_.lower_bound(target);
+    if (pos_ > end_ || index_->range_start_id(pos_) != target) --pos_;
+  }
 }
 
 void S2CellIndex::ContentsIterator::StartUnion(const RangeIterator& range) {
@@ -41,11 +53,11 @@ void S2CellIndex::ContentsIterator::StartUnion(const RangeIterator& range) {
   // non-overlapping, then cell_tree_ would be empty (since every node is a
   // leaf node and could therefore be stored directly in a RangeNode).  It
   // would also be faster because cell_tree_ would rarely be accessed.
-  int contents = range.it_->contents;
+  int contents = range.contents();
   if (contents <= node_cutoff_) {
     set_done();
   } else {
-    node_ = (*cell_tree_)[contents];
+    node_ = index_->cell_node(contents);
   }
 
   // When visiting ancestors, we can stop as soon as the node index is smaller
@@ -65,6 +77,86 @@ void S2CellIndex::Add(const S2CellUnion& cell_ids, Label label) {
 }
 
 void S2CellIndex::Build() {
+  S2_DCHECK(!is_encoded_) << "Decoded indexes cannot be modified.";
+  vector<CellNode> nodes;
+  nodes.swap(cell_tree_);
+  BuildRanges(nodes, S2CellId::Begin(S2CellId::kMaxLevel),
+              S2CellId::End(S2CellId::kMaxLevel), &cell_tree_, &range_nodes_);
+}
+
+void S2CellIndex::Build(Executor* executor) {
+  S2_DCHECK(!is_encoded_) << "Decoded indexes cannot be modified.";
+  if (executor == nullptr) {
+    Build();
+    return;
+  }
+  // Group the cells by face, preserving their relative order.
+  int face_start[S2CellId::kNumFaces + 1] = {0};
+  for (const CellNode& node : cell_tree_) ++face_start[node.cell_id.face() + 1];
+  for (int face = 0; face < S2CellId::kNumFaces; ++face) {
+    face_start[face + 1] += face_start[face];
+  }
+  vector<CellNode> nodes(cell_tree_.size());
+  {
+    int pos[S2CellId::kNumFaces];
+    std::copy(face_start, face_start + S2CellId::kNumFaces, pos);
+    for (const CellNode& node : cell_tree_) {
+      nodes[pos[node.cell_id.face()]++] = node;
+    }
+    vector<CellNode>().swap(cell_tree_);
+  }
+
+  // Since each cell is contained by a single face, the faces can be processed
+  // independently.
+  vector<CellNode> face_tree[S2CellId::kNumFaces];
+  vector<RangeNode> face_ranges[S2CellId::kNumFaces];
+  ParallelFor(executor, S2CellId::kNumFaces, [&](int face) {
+    absl::Span<const CellNode> face_nodes(
+        nodes.data() + face_start[face],
+        face_start[face + 1] - face_start[face]);
+    BuildRanges(face_nodes, S2CellId::FromFace(face).range_min(),
+                S2CellId::FromFace(face).range_max().next(),
+                &face_tree[face], &face_ranges[face]);
+  });
+  vector<CellNode>().swap(nodes);
+
+  // Concatenate the results.  The range node emitted at the end of each face
+  // is always empty and is dropped, since it duplicates the one emitted at
+  // the start of the next face.  A range node at the start of a face is only
+  // kept if it differs from the previous range, so that the result is the
+  // same as if all the faces had been processed together.
+  int num_ranges = 1;
+  for (const auto& ranges : face_ranges) num_ranges += ranges.size() - 1;
+  cell_tree_.reserve(face_start[S2CellId::kNumFaces]);
+  range_nodes_.reserve(num_ranges);
+  for (int face = 0; face < S2CellId::kNumFaces; ++face) {
+    const int32 offset = cell_tree_.size();
+    for (const CellNode& node : face_tree[face]) {
+      cell_tree_.push_back(node);
+      if (node.parent >= 0) cell_tree_.back().parent += offset;
+    }
+    const vector<RangeNode>& ranges = face_ranges[face];
+    S2_DCHECK_EQ(-1, ranges.back().contents);
+    for (int i = 0; i + 1 < ranges.size(); ++i) {
+      int32 contents = ranges[i].contents;
+      if (contents >= 0) {
+        contents += offset;
+      } else if (i == 0 && !range_nodes_.empty() &&
+                 range_nodes_.back().contents < 0) {
+        continue;
+      }
+      range_nodes_.push_back({ranges[i].start_id, contents});
+    }
+    vector<CellNode>().swap(face_tree[face]);
+    vector<RangeNode>().swap(face_ranges[face]);
+  }
+  range_nodes_.push_back({S2CellId::End(S2CellId::kMaxLevel), -1});
+}
+
+void S2CellIndex::BuildRanges(absl::Span<const CellNode> nodes,
+                              S2CellId begin, S2CellId end,
+                              vector<CellNode>* cell_tree,
+                              vector<RangeNode>* range_nodes) {
   // To build the cell tree and leaf cell ranges, we maintain a stack of
   // (cell_id, label) pairs that contain the current leaf cell.  This class
   // represents an instruction to push or pop a (cell_id, label) pair.
@@ -93,41 +185,95 @@ void S2CellIndex::Build() {
   };
 
   vector<Delta> deltas;
-  deltas.reserve(2 * cell_tree_.size() + 2);
+  deltas.reserve(2 * nodes.size() + 2);
   // Create two deltas for each (cell_id, label) pair: one to add the pair to
   // the stack (at the start of its leaf cell range), and one to remove it from
   // the stack (at the end of its leaf cell range).
-  for (const CellNode& node : cell_tree_) {
+  for (const CellNode& node : nodes) {
     deltas.push_back(Delta(node.cell_id.range_min(), node.cell_id, node.label));
     deltas.push_back(Delta(node.cell_id.range_max().next(),
                            S2CellId::Sentinel(), -1));
   }
   // We also create two special deltas to ensure that a RangeNode is emitted at
   // the beginning and end of the S2CellId range.
-  deltas.push_back(
-      Delta(S2CellId::Begin(S2CellId::kMaxLevel), S2CellId::None(), -1));
-  deltas.push_back(
-      Delta(S2CellId::End(S2CellId::kMaxLevel), S2CellId::None(), -1));
+  deltas.push_back(Delta(begin, S2CellId::None(), -1));
+  deltas.push_back(Delta(end, S2CellId::None(), -1));
   std::sort(deltas.begin(), deltas.end());
 
   // Now walk through the deltas to build the leaf cell ranges and cell tree
   // (which is essentially a permanent form of the "stack" described above).
-  cell_tree_.clear();
-  range_nodes_.reserve(deltas.size());
+  cell_tree->clear();
+  range_nodes->reserve(deltas.size());
   int contents = -1;
   for (int i = 0; i < deltas.size(); ) {
     S2CellId start_id = deltas[i].start_id;
     // Process all the deltas associated with the current start_id.
     for (; i < deltas.size() && deltas[i].start_id == start_id; ++i) {
       if (deltas[i].label >= 0) {
-        cell_tree_.push_back({deltas[i].cell_id, deltas[i].label, contents});
-        contents = cell_tree_.size() - 1;
+        cell_tree->push_back({deltas[i].cell_id, deltas[i].label, contents});
+        contents = cell_tree->size() - 1;
       } else if (deltas[i].cell_id == S2CellId::Sentinel()) {
-        contents = cell_tree_[contents].parent;
+        contents = (*cell_tree)[contents].parent;
       }
     }
-    range_nodes_.push_back({start_id, contents});
+    range_nodes->push_back({start_id, contents});
+  }
+}
+
+// The encoding consists of a version number followed by the range node start
+// ids and contents, and then the cell tree ids, labels, and parents.
+static constexpr int kCurrentEncodingVersionNumber = 0;
+
+void S2CellIndex::Encode(Encoder* encoder) const {
+  S2_DCHECK(num_range_nodes() > 0) << "Call Build() first.";
+  vector<S2CellId> cell_ids;
+  vector<uint32> values;
+  encoder->Ensure(Varint::kMax64);
+  encoder->put_varint64(kCurrentEncodingVersionNumber);
+
+  int num_ranges = num_range_nodes();
+  for (int i = 0; i < num_ranges; ++i) cell_ids.push_back(range_start_id(i));
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  for (int i = 0; i < num_ranges; ++i) values.push_back(range_contents(i) + 1);
+  s2coding::EncodeUintVector<uint32>(values, s2coding::CodingHint::COMPACT,
+                                     encoder);
+
+  cell_ids.clear();
+  values.clear();
+  int num_nodes = num_cells();
+  for (int i = 0; i < num_nodes; ++i) cell_ids.push_back(cell_node(i).cell_id);
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  for (int i = 0; i < num_nodes; ++i) values.push_back(cell_node(i).label);
+  s2coding::EncodeUintVector<uint32>(values, s2coding::CodingHint::COMPACT,
+                                     encoder);
+  values.clear();
+  for (int i = 0; i < num_nodes; ++i) {
+    values.push_back(cell_node(i).parent + 1);
+  }
+  s2coding::EncodeUintVector<uint32>(values, s2coding::CodingHint::COMPACT,
+                                     encoder);
+}
+
+bool S2CellIndex::Init(Decoder* decoder) {
+  Clear();
+  uint64 version;
+  if (!decoder->get_varint64(&version)) return false;
+  if (version != kCurrentEncodingVersionNumber) return false;
+  if (!encoded_range_start_ids_.Init(decoder) ||
+      !encoded_range_contents_.Init(decoder) ||
+      !encoded_cell_ids_.Init(decoder) ||
+      !encoded_labels_.Init(decoder) ||
+      !encoded_parents_.Init(decoder)) {
+    return false;
+  }
+  if (encoded_range_start_ids_.size() == 0 ||
+      encoded_range_contents_.size() != encoded_range_start_ids_.size() ||
+      encoded_labels_.size() != encoded_cell_ids_.size() ||
+      encoded_parents_.size() != encoded_cell_ids_.size()) {
+    return false;
   }
+  is_encoded_ = true;
+  return true;
 }
 
 vector<Label> S2CellIndex::GetIntersectingLabels(const S2CellUnion& target)
@@ -21,8 +21,14 @@
 #include <vector>
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/base/logging.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_uint_vector.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/util/coding/coder.h"
+
+class Executor;
 
 // S2CellIndex stores a collection of (cell_id, label) pairs.  The S2CellIds
 // may be overlapping or contain duplicate values.  For example, an
@@ -150,9 +156,30 @@ class S2CellIndex {
   // may be used until the index is built.
   void Build();
 
+  // Like Build(), except that the cells of each S2 cube face are sorted and
+  // processed concurrently using the given executor, and the results are then
+  // concatenated.  This is useful for very large indexes.  The resulting
+  // index is identical to the one constructed by Build().
+  void Build(Executor* executor);
+
   // Clears the index so that it can be re-used.
   void Clear();
 
+  // Appends an encoded representation of the index to "encoder".  The leaf
+  // cell ranges and the cell tree are stored using EncodedS2CellIdVector and
+  // EncodedUintVector, so that the encoded index is compact and can be
+  // queried directly.
+  //
+  // REQUIRES: Build() has been called.
+  void Encode(Encoder* encoder) const;
+
+  // Initializes the index from data written by Encode().  Returns false on
+  // errors.  The index (and all its iterators) read the encoded data in
+  // place rather than decoding it into vectors, so the data must persist for
+  // as long as the index is used.  A decoded index cannot be modified, but
+  // Clear() returns it to an empty state where cells can be added again.
+  bool Init(Decoder* decoder);
+
   // A function that is called with each (cell_id, label) pair to be visited.
   // The function may return false in order to indicate that no further
   // (cell_id, label) pairs are needed.
@@ -196,6 +223,22 @@ class S2CellIndex {
     CellNode() : cell_id(S2CellId::None()), label(kDoneContents), parent(-1) {}
   };
 
+  // Methods to access the index data, which may be stored either in vectors
+  // or in encoded form (see Init).
+  int num_range_nodes() const;
+  S2CellId range_start_id(int i) const;
+  int32 range_contents(int i) const;
+  CellNode cell_node(int i) const;
+
+  // Builds the cell tree and range nodes for the given cells, all of which
+  // must be contained by the leaf cell range [begin, end).  Range nodes are
+  // emitted at "begin" and "end", and "cell_tree" parent indexes and
+  // "range_nodes" contents are relative to the start of "cell_tree".
+  static void BuildRanges(absl::Span<const CellNode> nodes,
+                          S2CellId begin, S2CellId end,
+                          std::vector<CellNode>* cell_tree,
+                          std::vector<RangeNode>* range_nodes);
+
  public:
   class ContentsIterator;
 
@@ -228,7 +271,8 @@ class S2CellIndex {
    private:
     // NOTE(ericv): There is a potential optimization that would require this
     // class to iterate over both cell_tree_ *and* range_nodes_.
-    std::vector<CellNode>::const_iterator cell_it_, cell_end_;
+    const S2CellIndex* index_;
+    int pos_, end_;
   };
 
   // An iterator that seeks and iterates over a set of non-overlapping leaf
@@ -287,8 +331,13 @@ class S2CellIndex {
 
    private:
     friend class ContentsIterator;
-    const std::vector<RangeNode>* range_nodes_;
-    std::vector<RangeNode>::const_iterator it_;
+
+    // The contents of the current range (an index within the cell tree).
+    int32 contents() const;
+
+    const S2CellIndex* index_;
+    int pos_;  // The current position within the range nodes, or -1.
+    int end_;  // The position of the final (sentinel) range node.
   };
 
   // Like RangeIterator, but only visits leaf cell ranges that overlap at
@@ -373,7 +422,7 @@ class S2CellIndex {
     void set_done() { node_.label = kDoneContents; }
 
     // A pointer to the cell tree itself (owned by the S2CellIndex).
-    const std::vector<CellNode>* cell_tree_;
+    const S2CellIndex* index_;
 
     // The value of it.start_id() from the previous call to StartUnion().
     // This is used to check whether these values are monotonically
@@ -422,6 +471,16 @@ class S2CellIndex {
   };
   std::vector<RangeNode> range_nodes_;
 
+  // When the index has been initialized using Init(), the vectors above are
+  // empty and the same data is stored here instead.  Contents and parent
+  // indexes are stored with an offset of 1 so that -1 can be represented.
+  bool is_encoded_ = false;
+  s2coding::EncodedS2CellIdVector encoded_range_start_ids_;
+  s2coding::EncodedUintVector<uint32> encoded_range_contents_;
+  s2coding::EncodedS2CellIdVector encoded_cell_ids_;
+  s2coding::EncodedUintVector<uint32> encoded_labels_;
+  s2coding::EncodedUintVector<uint32> encoded_parents_;
+
   S2CellIndex(const S2CellIndex&) = delete;
   void operator=(const S2CellIndex&) = delete;
 };
@@ -430,80 +489,104 @@ std::ostream& operator<<(std::ostream& os, S2CellIndex::LabelledCell x);
 //////////////////   Implementation details follow   ////////////////////
 
 
+inline int S2CellIndex::num_range_nodes() const {
+  if (is_encoded_) return encoded_range_start_ids_.size();
+  return range_nodes_.size();
+}
+
+inline S2CellId S2CellIndex::range_start_id(int i) const {
+  if (is_encoded_) return encoded_range_start_ids_[i];
+  return range_nodes_[i].start_id;
+}
+
+inline int32 S2CellIndex::range_contents(int i) const {
+  if (is_encoded_) return static_cast<int32>(encoded_range_contents_[i]) - 1;
+  return range_nodes_[i].contents;
+}
+
+inline S2CellIndex::CellNode S2CellIndex::cell_node(int i) const {
+  if (is_encoded_) {
+    return CellNode(encoded_cell_ids_[i], encoded_labels_[i],
+                    static_cast<int32>(encoded_parents_[i]) - 1);
+  }
+  return cell_tree_[i];
+}
+
 inline S2CellIndex::CellIterator::CellIterator(const S2CellIndex* index)
-    : cell_it_(index->cell_tree_.begin()),
-      cell_end_(index->cell_tree_.end()) {
-  S2_DCHECK(!index->range_nodes_.empty()) << "Call Build() first.";
+    : index_(index), pos_(0), end_(index->num_cells()) {
+  S2_DCHECK_GT(index->num_range_nodes(), 0) << "Call Build() first.";
 }
 
 inline S2CellId S2CellIndex::CellIterator::cell_id() const {
   S2_DCHECK(!done());
-  return cell_it_->cell_id;
+  if (!index_->is_encoded_) return index_->cell_tree_[pos_].cell_id;
+  return index_->encoded_cell_ids_[pos_];
 }
 
 inline S2CellIndex::Label S2CellIndex::CellIterator::label() const {
   S2_DCHECK(!done());
-  return cell_it_->label;
+  if (!index_->is_encoded_) return index_->cell_tree_[pos_].label;
+  return index_->encoded_labels_[pos_];
 }
 
 inline S2CellIndex::LabelledCell S2CellIndex::CellIterator::labelled_cell()
     const {
   S2_DCHECK(!done());
-  return LabelledCell(cell_it_->cell_id, cell_it_->label);
+  return LabelledCell(cell_id(), label());
 }
 
 inline bool S2CellIndex::CellIterator::done() const {
-  return cell_it_ == cell_end_;
+  return pos_ == end_;
 }
 
 inline void S2CellIndex::CellIterator::Next() {
   S2_DCHECK(!done());
-  ++cell_it_;
+  ++pos_;
 }
 
 inline S2CellIndex::RangeIterator::RangeIterator(const S2CellIndex* index)
-    : range_nodes_(&index->range_nodes_), it_() {
-  S2_DCHECK(!range_nodes_->empty()) << "Call Build() first.";
+    : index_(index), pos_(-1), end_(index->num_range_nodes() - 1) {
+  S2_DCHECK_GE(end_, 0) << "Call Build() first.";
 }
 
 inline S2CellId S2CellIndex::RangeIterator::start_id() const {
-  return it_->start_id;
+  return index_->range_start_id(pos_);
 }
 
 inline S2CellId S2CellIndex::RangeIterator::limit_id() const {
   S2_DCHECK(!done());
-  return (it_ + 1)->start_id;
+  return index_->range_start_id(pos_ + 1);
 }
 
 inline bool S2CellIndex::RangeIterator::done() const {
-  S2_DCHECK(it_ != decltype(it_)()) << "Call Begin() or Seek() first.";
+  S2_DCHECK_GE(pos_, 0) << "Call Begin() or Seek() first.";
 
   // Note that the last element of range_nodes_ is a sentinel value.
-  return it_ >= range_nodes_->end() - 1;
+  return pos_ >= end_;
 }
 
 inline void S2CellIndex::RangeIterator::Begin() {
-  it_ = range_nodes_->begin();
+  pos_ = 0;
 }
 
 inline void S2CellIndex::RangeIterator::Finish() {
   // Note that the last element of range_nodes_ is a sentinel value.
-  it_ = range_nodes_->end() - 1;
+  pos_ = end_;
 }
 
 inline void S2CellIndex::RangeIterator::Next() {
   S2_DCHECK(!done());
-  ++it_;
+  ++pos_;
 }
 
 inline bool S2CellIndex::RangeIterator::is_empty() const {
-  return it_->contents == kDoneContents;
+  return contents() == kDoneContents;
 }
 
 inline bool S2CellIndex::RangeIterator::Advance(int n) {
   // Note that the last element of range_nodes_ is a sentinel value.
-  if (it_ + n >= range_nodes_->end() - 1) return false;
-  it_ += n;
+  if (pos_ + n >= end_) return false;
+  pos_ += n;
   return true;
 }
 
@@ -538,13 +621,17 @@ inline void S2CellIndex::NonEmptyRangeIterator::Seek(S2CellId target) {
 }
 
 inline bool S2CellIndex::RangeIterator::Prev() {
-  if (it_ == range_nodes_->begin()) return false;
-  --it_;
+  if (pos_ == 0) return false;
+  --pos_;
   return true;
 }
 
+inline int32 S2CellIndex::RangeIterator::contents() const {
+  return index_->range_contents(pos_);
+}
+
 inline S2CellIndex::ContentsIterator::ContentsIterator()
-    : cell_tree_(nullptr) {
+    : index_(nullptr) {
 }
 
 inline S2CellIndex::ContentsIterator::ContentsIterator(
@@ -553,7 +640,7 @@ inline S2CellIndex::ContentsIterator::ContentsIterator(
 }
 
 inline void S2CellIndex::ContentsIterator::Init(const S2CellIndex* index) {
-  cell_tree_ = &index->cell_tree_;
+  index_ = index;
   Clear();
 }
 
@@ -591,23 +678,26 @@ inline void S2CellIndex::ContentsIterator::Next() {
     node_cutoff_ = next_node_cutoff_;
     set_done();
   } else {
-    node_ = (*cell_tree_)[node_.parent];
+    node_ = index_->cell_node(node_.parent);
   }
 }
 
 inline int S2CellIndex::num_cells() const {
+  if (is_encoded_) return encoded_cell_ids_.size();
   return cell_tree_.size();
 }
 
 inline void S2CellIndex::Add(S2CellId cell_id, Label label) {
   S2_DCHECK(cell_id.is_valid());
   S2_DCHECK_GE(label, 0);
+  S2_DCHECK(!is_encoded_) << "Decoded indexes cannot be modified.";
   cell_tree_.push_back(CellNode(cell_id, label, -1));
 }
 
 inline void S2CellIndex::Clear() {
   cell_tree_.clear();
   range_nodes_.clear();
+  is_encoded_ = false;
 }
 
 inline bool S2CellIndex::VisitIntersectingCells(
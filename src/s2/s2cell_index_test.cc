@@ -17,14 +17,19 @@
 
 #include "s2/s2cell_index.h"
 
+#include <functional>
 #include <set>
+#include <thread>
 #include <utility>
 #include <vector>
+#include "s2/base/mutex.h"
 #include "s2/base/stringprintf.h"
 #include <gtest/gtest.h>
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2testing.h"
+#include "s2/util/coding/coder.h"
+#include "s2/util/thread/executor.h"
 
 using std::pair;
 using std::set;
@@ -389,6 +394,36 @@ TEST_F(S2CellIndexTest, IntersectionRandomUnions) {
   }
 }
 
+TEST_F(S2CellIndexTest, EncodeDecode) {
+  for (int i = 0; i < 100; ++i) {
+    Add(GetRandomCellUnion(), i);
+  }
+  Build();
+  Encoder encoder;
+  index_.Encode(&encoder);
+
+  // Replace the index with its encoded form, which is queried in place.
+  Decoder decoder(encoder.base(), encoder.length());
+  ASSERT_TRUE(index_.Init(&decoder));
+  EXPECT_EQ(contents_.size(), index_.num_cells());
+  VerifyCellIterator();
+  VerifyIndexContents();
+  VerifyRangeIterators();
+  for (int i = 0; i < 50; ++i) {
+    TestIntersection(GetRandomCellUnion());
+  }
+
+  // Re-encoding the decoded index yields the same bytes.
+  Encoder encoder2;
+  index_.Encode(&encoder2);
+  EXPECT_EQ(string(encoder.base(), encoder.length()),
+            string(encoder2.base(), encoder2.length()));
+
+  // Truncated data is rejected.
+  Decoder truncated(encoder.base(), encoder.length() - 1);
+  EXPECT_FALSE(index_.Init(&truncated));
+}
+
 TEST_F(S2CellIndexTest, IntersectionSemiRandomUnions) {
   // This test also uses random S2CellUnions, but the unions are specially
   // constructed so that interesting cases are more likely to arise.
@@ -408,4 +443,52 @@ TEST_F(S2CellIndexTest, IntersectionSemiRandomUnions) {
   }
 }
 
+// A simple executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST_F(S2CellIndexTest, BuildWithExecutor) {
+  // Include cells that touch the boundaries of faces, and leave some faces
+  // empty, so that the per-face results need to be merged correctly.
+  Add("0/", 0);
+  Add("0/3", 1);
+  Add("1/0", 2);
+  Add("4/33", 3);
+  Add("5/", 4);
+  for (int i = 0; i < 50; ++i) {
+    Add(GetRandomCellUnion(), 5 + i);
+  }
+  S2CellIndex expected;
+  for (const LabelledCell& x : contents_) expected.Add(x.cell_id, x.label);
+  expected.Build();
+
+  ThreadPerTaskExecutor executor;
+  index_.Build(&executor);
+  VerifyCellIterator();
+  VerifyIndexContents();
+  VerifyRangeIterators();
+
+  // The two indexes should be identical, which we check by comparing their
+  // encodings.
+  Encoder expected_encoder, actual_encoder;
+  expected.Encode(&expected_encoder);
+  index_.Encode(&actual_encoder);
+  EXPECT_EQ(string(expected_encoder.base(), expected_encoder.length()),
+            string(actual_encoder.base(), actual_encoder.length()));
+}
+
 }  // namespace
@@ -0,0 +1,150 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_range_planner.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "s2/base/logging.h"
+#include "s2/s2metrics.h"
+
+using std::vector;
+
+S2CellRangePlanner::Options::Options()
+    : seek_cost_(100), key_density_(1e9),
+      max_ranges_(std::numeric_limits<int>::max()) {
+}
+
+void S2CellRangePlanner::Options::set_seek_cost(double seek_cost) {
+  S2_DCHECK_GE(seek_cost, 0);
+  seek_cost_ = seek_cost;
+}
+
+void S2CellRangePlanner::Options::set_key_density(double key_density) {
+  S2_DCHECK_GE(key_density, 0);
+  key_density_ = key_density;
+}
+
+void S2CellRangePlanner::Options::set_max_ranges(int max_ranges) {
+  S2_DCHECK_GE(max_ranges, 1);
+  max_ranges_ = max_ranges;
+}
+
+S2CellRangePlanner::S2CellRangePlanner() {
+}
+
+S2CellRangePlanner::S2CellRangePlanner(const Options& options)
+    : options_(options) {
+}
+
+// Returns the expected number of keys in the given number of leaf cells.
+static double ExpectedKeys(double num_leaf_cells, double key_density) {
+  static const double kLeafArea = S2::kAvgArea.GetValue(S2CellId::kMaxLevel);
+  return num_leaf_cells * kLeafArea * key_density;
+}
+
+vector<S2CellRangePlanner::Range> S2CellRangePlanner::PlanRanges(
+    const S2CellUnion& covering) const {
+  // Convert the cells to leaf cell ranges, merging ranges that are adjacent.
+  S2_DCHECK(covering.IsValid());
+  vector<Range> ranges;
+  for (S2CellId id : covering) {
+    S2CellId min = id.range_min(), max = id.range_max();
+    if (!ranges.empty() && min == ranges.back().max().next()) {
+      min = ranges.back().min();
+      ranges.pop_back();
+    }
+    ranges.emplace_back(min, max, true);
+  }
+  if (ranges.size() <= 1) return ranges;
+
+  // Since the cost of each gap is independent of the others, the minimum
+  // total cost is achieved by merging every gap whose expected overscan is
+  // cheaper than a seek.  If more ranges remain than max_ranges() allows, we
+  // also merge the smallest remaining gaps.  Either way the merged gaps are
+  // the smallest ones, so we find them by sorting the gaps by size.
+  const int num_gaps = ranges.size() - 1;
+  vector<uint64> gap_size(num_gaps);
+  for (int i = 0; i < num_gaps; ++i) {
+    gap_size[i] = (ranges[i + 1].min().id() - ranges[i].max().id()) / 2 - 1;
+  }
+  vector<int> order(num_gaps);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&gap_size](int x, int y) {
+      return gap_size[x] < gap_size[y] || (gap_size[x] == gap_size[y] && x < y);
+    });
+  int num_merged = 0;
+  while (num_merged < num_gaps &&
+         ExpectedKeys(gap_size[order[num_merged]], options_.key_density()) <
+         options_.seek_cost()) {
+    ++num_merged;
+  }
+  num_merged = std::max<int64>(num_merged,
+                               static_cast<int64>(ranges.size()) -
+                               options_.max_ranges());
+  vector<bool> merge_gap(num_gaps, false);
+  for (int k = 0; k < num_merged; ++k) merge_gap[order[k]] = true;
+
+  vector<Range> result;
+  result.reserve(ranges.size() - num_merged);
+  result.push_back(ranges[0]);
+  for (int i = 0; i < num_gaps; ++i) {
+    const Range& next = ranges[i + 1];
+    if (merge_gap[i]) {
+      result.back() = Range(result.back().min(), next.max(), false);
+    } else {
+      result.push_back(next);
+    }
+  }
+  return result;
+}
+
+double S2CellRangePlanner::GetCost(const vector<Range>& ranges) const {
+  double cost = 0;
+  for (const Range& range : ranges) {
+    cost += options_.seek_cost() +
+            ExpectedKeys(range.num_leaf_cells(), options_.key_density());
+  }
+  return cost;
+}
+
+S2CellRangePlanner::KeyFilter::KeyFilter(const S2CellUnion* covering)
+    : cells_(&covering->cell_ids()) {
+  S2_DCHECK(covering->IsValid());
+}
+
+bool S2CellRangePlanner::KeyFilter::Contains(S2CellId key) {
+  // Maintain the invariant that "pos_" is the first cell whose range_max()
+  // is at least the current key.  Keys normally increase, so we first try
+  // advancing a few cells and otherwise fall back to binary search.
+  const vector<S2CellId>& cells = *cells_;
+  const int n = cells.size();
+  static const int kMaxLinearSteps = 8;
+  if (pos_ > 0 && key <= cells[pos_ - 1].range_max()) {
+    pos_ = 0;  // The key went backwards; search from the beginning.
+  }
+  int limit = std::min(n, pos_ + kMaxLinearSteps);
+  while (pos_ < limit && cells[pos_].range_max() < key) ++pos_;
+  if (pos_ == limit && pos_ < n) {
+    pos_ = std::lower_bound(cells.begin() + pos_, cells.end(), key,
+                            [](S2CellId cell, S2CellId key) {
+                              return cell.range_max() < key;
+                            }) - cells.begin();
+  }
+  return pos_ < n && cells[pos_].contains(key);
+}
@@ -0,0 +1,156 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2CELL_RANGE_PLANNER_H_
+#define S2_S2CELL_RANGE_PLANNER_H_
+
+#include <vector>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+
+// S2CellRangePlanner converts a covering (typically computed by
+// S2RegionCoverer) into the key ranges to scan in a key-value store whose
+// keys are S2CellIds (e.g. the leaf cell of each stored point).  Each cell
+// of the covering corresponds to the key range [range_min(), range_max()],
+// so a covering with hundreds of cells yields hundreds of small scans.  The
+// planner merges adjacent ranges, and then merges nearby ranges whenever the
+// cost of the keys expected in the gap between them is less than the cost of
+// an extra seek.
+//
+// The cost model is linear: each range costs seek_cost(), and each key that
+// is read costs 1.  The number of keys in a gap is estimated from its area
+// (the number of leaf cells it spans times their average area) using
+// key_density().  Since each gap contributes independently to the total
+// cost, merging exactly those gaps whose expected overscan is cheaper than a
+// seek yields a minimal-cost set of ranges.  Optionally the number of ranges
+// can also be limited, in which case the cheapest remaining gaps are merged.
+//
+// Keys read from a merged gap are not in the covering.  When exact results
+// are needed, the scanned keys can be checked with KeyFilter, which only
+// needs to be consulted for ranges that are not exact().
+//
+// Example usage:
+//
+//   S2RegionCoverer coverer(coverer_options);
+//   S2CellUnion covering = coverer.GetCovering(region);
+//   S2CellRangePlanner planner(planner_options);
+//   S2CellRangePlanner::KeyFilter filter(&covering);
+//   for (const auto& range : planner.PlanRanges(covering)) {
+//     for (S2CellId key : Scan(range.min(), range.max())) {
+//       if (range.exact() || filter.Contains(key)) Process(key);
+//     }
+//   }
+class S2CellRangePlanner {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The cost of starting a new range scan, in units of the cost of reading
+    // one key.
+    //
+    // DEFAULT: 100
+    double seek_cost() const { return seek_cost_; }
+    void set_seek_cost(double seek_cost);
+
+    // The expected number of stored keys per steradian (unit of area on the
+    // unit sphere).  A density of D keys per square kilometer of the Earth
+    // corresponds to D / S2Earth::SquareKmToSteradians(1).
+    //
+    // DEFAULT: 1e9 (about 25 keys per square kilometer of the Earth)
+    double key_density() const { return key_density_; }
+    void set_key_density(double key_density);
+
+    // The maximum number of ranges to return.  If merging the gaps that are
+    // cheaper than a seek leaves more ranges than this, the remaining gaps
+    // are merged in order of increasing size.
+    //
+    // DEFAULT: no limit
+    int max_ranges() const { return max_ranges_; }
+    void set_max_ranges(int max_ranges);
+
+   private:
+    double seek_cost_;
+    double key_density_;
+    int max_ranges_;
+  };
+
+  // An inclusive range of keys [min(), max()] to scan.
+  class Range {
+   public:
+    Range(S2CellId min, S2CellId max, bool exact)
+        : min_(min), max_(max), exact_(exact) {}
+
+    // The first and last leaf cell ids in the range.
+    S2CellId min() const { return min_; }
+    S2CellId max() const { return max_; }
+
+    // True if every key in the range is contained by the covering, i.e. no
+    // gaps were merged into this range.
+    bool exact() const { return exact_; }
+
+    // The number of leaf cells spanned by the range.
+    uint64 num_leaf_cells() const {
+      return (max_.id() - min_.id()) / 2 + 1;
+    }
+
+   private:
+    S2CellId min_, max_;
+    bool exact_;
+  };
+
+  // An exact post-filter for keys read from the ranges returned by
+  // PlanRanges().  It is optimized for keys that are tested in increasing
+  // order (as they are returned by range scans), in which case each test
+  // takes amortized constant time, but keys may be tested in any order.
+  //
+  // The covering must persist for the lifetime of the filter.
+  class KeyFilter {
+   public:
+    // REQUIRES: covering->IsValid()
+    explicit KeyFilter(const S2CellUnion* covering);
+
+    // Returns true if "key" is contained by the covering (in the same sense
+    // as S2CellUnion::Contains(S2CellId)).
+    bool Contains(S2CellId key);
+
+   private:
+    const std::vector<S2CellId>* cells_;
+    int pos_ = 0;  // First cell whose range_max() might be >= the last key.
+  };
+
+  S2CellRangePlanner();
+  explicit S2CellRangePlanner(const Options& options);
+
+  const Options& options() const { return options_; }
+
+  // Returns the ranges to scan in order to read all keys contained by the
+  // given covering, in increasing order.  The covering does not need to be
+  // normalized.
+  //
+  // REQUIRES: covering.IsValid()
+  std::vector<Range> PlanRanges(const S2CellUnion& covering) const;
+
+  // Returns the expected cost of scanning the given ranges under the cost
+  // model described above.
+  double GetCost(const std::vector<Range>& ranges) const;
+
+ private:
+  Options options_;
+};
+
+#endif  // S2_S2CELL_RANGE_PLANNER_H_
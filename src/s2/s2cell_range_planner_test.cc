@@ -0,0 +1,177 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2cell_range_planner.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2metrics.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+using Range = S2CellRangePlanner::Range;
+
+// Returns the cost of merging a gap of the given number of leaf cells.
+double GapCost(double num_leaf_cells, double key_density) {
+  return num_leaf_cells * S2::kAvgArea.GetValue(S2CellId::kMaxLevel) *
+         key_density;
+}
+
+// Checks that "ranges" are disjoint, sorted, and cover "covering", and that
+// exact() is set correctly.
+void CheckRanges(const S2CellUnion& covering, const vector<Range>& ranges) {
+  S2CellUnion normalized = covering;
+  normalized.Normalize();
+  for (int i = 0; i < ranges.size(); ++i) {
+    EXPECT_LE(ranges[i].min(), ranges[i].max());
+    if (i > 0) EXPECT_LT(ranges[i - 1].max().next(), ranges[i].min());
+    S2CellUnion range_cells =
+        S2CellUnion::FromMinMax(ranges[i].min(), ranges[i].max());
+    EXPECT_EQ(ranges[i].exact(), normalized.Contains(range_cells));
+  }
+  for (S2CellId id : covering) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), id.range_min(),
+                               [](S2CellId x, const Range& range) {
+                                 return x < range.min();
+                               });
+    ASSERT_TRUE(it != ranges.begin());
+    --it;
+    EXPECT_LE(id.range_max(), it->max());
+  }
+}
+
+TEST(S2CellRangePlanner, EmptyCovering) {
+  S2CellRangePlanner planner;
+  EXPECT_TRUE(planner.PlanRanges(S2CellUnion()).empty());
+}
+
+TEST(S2CellRangePlanner, MergesAdjacentCells) {
+  // The covering is valid but not normalized.
+  S2CellId id = S2CellId::FromFace(5).child_begin(10);
+  S2CellUnion covering = S2CellUnion::FromVerbatim(
+      {id, id.next().child(0), id.next().child(1), id.next().child(2),
+       id.next().child(3), id.next().next()});
+  S2CellRangePlanner::Options options;
+  options.set_key_density(0);
+  options.set_seek_cost(0);  // Never merge gaps.
+  auto ranges = S2CellRangePlanner(options).PlanRanges(covering);
+  ASSERT_EQ(1, ranges.size());
+  EXPECT_EQ(id.range_min(), ranges[0].min());
+  EXPECT_EQ(id.next().next().range_max(), ranges[0].max());
+  EXPECT_TRUE(ranges[0].exact());
+}
+
+TEST(S2CellRangePlanner, MergesGapsCheaperThanSeek) {
+  // Three cells separated by gaps of one and three cells at level 20.
+  S2CellId a = S2CellId::FromFace(1).child_begin(20);
+  S2CellId b = a.next().next();
+  S2CellId c = b.advance(4);
+  S2CellUnion covering({a, b, c});
+  const double kCellLeaves = Range(a.range_min(), a.range_max(), true)
+                                 .num_leaf_cells();
+  S2CellRangePlanner::Options options;
+  options.set_key_density(1e9);
+
+  // A seek costs more than one cell of gap but less than three.
+  options.set_seek_cost(2 * GapCost(kCellLeaves, options.key_density()));
+  auto ranges = S2CellRangePlanner(options).PlanRanges(covering);
+  ASSERT_EQ(2, ranges.size());
+  EXPECT_EQ(a.range_min(), ranges[0].min());
+  EXPECT_EQ(b.range_max(), ranges[0].max());
+  EXPECT_FALSE(ranges[0].exact());
+  EXPECT_EQ(c.range_min(), ranges[1].min());
+  EXPECT_TRUE(ranges[1].exact());
+  CheckRanges(covering, ranges);
+
+  // Limiting the number of ranges merges the remaining gap too.
+  options.set_max_ranges(1);
+  ranges = S2CellRangePlanner(options).PlanRanges(covering);
+  ASSERT_EQ(1, ranges.size());
+  EXPECT_EQ(a.range_min(), ranges[0].min());
+  EXPECT_EQ(c.range_max(), ranges[0].max());
+  CheckRanges(covering, ranges);
+}
+
+TEST(S2CellRangePlanner, MinimizesCost) {
+  // Merging gaps never increases the cost, and the planned ranges are no
+  // more expensive than either scanning each cell or one big range.
+  S2RegionCoverer::Options coverer_options;
+  coverer_options.set_max_cells(200);
+  S2RegionCoverer coverer(coverer_options);
+  for (int iter = 0; iter < 20; ++iter) {
+    S2Cap cap = S2Testing::GetRandomCap(1e-8, 1e-4);
+    S2CellUnion covering = coverer.GetCovering(cap);
+    S2CellRangePlanner::Options options;
+    options.set_key_density(1e9 * S2Testing::rnd.RandDouble());
+    options.set_seek_cost(1000 * S2Testing::rnd.RandDouble());
+    S2CellRangePlanner planner(options);
+    auto ranges = planner.PlanRanges(covering);
+    CheckRanges(covering, ranges);
+    EXPECT_LE(ranges.size(), covering.size());
+
+    vector<Range> per_cell, single;
+    for (S2CellId id : covering) {
+      per_cell.emplace_back(id.range_min(), id.range_max(), true);
+    }
+    single.emplace_back(covering.cell_ids().front().range_min(),
+                        covering.cell_ids().back().range_max(), false);
+    double cost = planner.GetCost(ranges);
+    EXPECT_LE(cost, planner.GetCost(per_cell) * (1 + 1e-12));
+    EXPECT_LE(cost, planner.GetCost(single) * (1 + 1e-12));
+  }
+}
+
+TEST(S2CellRangePlanner, KeyFilter) {
+  S2RegionCoverer::Options coverer_options;
+  coverer_options.set_max_cells(50);
+  S2Cap cap = S2Testing::GetRandomCap(1e-6, 1e-4);
+  S2CellUnion covering = S2RegionCoverer(coverer_options).GetCovering(cap);
+  S2Cap sample_cap(cap.center(), 2 * cap.GetRadius());
+  vector<S2CellId> keys;
+  for (int i = 0; i < 1000; ++i) {
+    keys.push_back(S2CellId(S2Testing::SamplePoint(sample_cap)));
+  }
+  for (S2CellId id : covering) {
+    keys.push_back(id.range_min());
+    keys.push_back(id.range_max());
+    keys.push_back(id.range_min().prev());
+    keys.push_back(id.range_max().next());
+  }
+  // Keys in increasing order, as returned by range scans.
+  vector<S2CellId> sorted = keys;
+  std::sort(sorted.begin(), sorted.end());
+  S2CellRangePlanner::KeyFilter filter(&covering);
+  for (S2CellId key : sorted) {
+    EXPECT_EQ(covering.Contains(key), filter.Contains(key));
+  }
+  // Keys in arbitrary order.
+  S2CellRangePlanner::KeyFilter filter2(&covering);
+  for (S2CellId key : keys) {
+    EXPECT_EQ(covering.Contains(key), filter2.Contains(key));
+  }
+}
+
+}  // namespace
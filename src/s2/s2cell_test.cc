@@ -401,6 +401,25 @@ TEST(S2Cell, TestSubdivide) {
   }
 }
 
+TEST(S2ChildCellGenerator, MatchesS2CellConstructor) {
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2CellId id = S2Testing::GetRandomCellId();
+    if (id.is_leaf()) continue;
+    S2ChildCellGenerator children(id);
+    // Request the children out of order to check that nothing depends on
+    // the order in which they are generated.
+    for (int pos : {2, 0, 3, 1}) {
+      S2Cell expected(id.child(pos));
+      S2Cell actual = children.child(pos);
+      EXPECT_EQ(expected.id(), actual.id());
+      EXPECT_EQ(expected.face(), actual.face());
+      EXPECT_EQ(expected.level(), actual.level());
+      EXPECT_EQ(expected.orientation(), actual.orientation());
+      EXPECT_EQ(expected.GetBoundUV(), actual.GetBoundUV());
+    }
+  }
+}
+
 TEST(S2Cell, CellVsLoopRectBound) {
   // This test verifies that the S2Cell and S2Loop bounds contain each other
   // to within their maximum errors.
@@ -18,6 +18,8 @@
 #include "s2/s2cell_union.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <vector>
 
 #include "s2/base/logging.h"
@@ -146,10 +148,15 @@ bool S2CellUnion::Normalize() {
 }
 
 /*static*/ bool S2CellUnion::Normalize(vector<S2CellId>* ids) {
+  std::sort(ids->begin(), ids->end());
+  return NormalizeSorted(ids);
+}
+
+/*static*/ bool S2CellUnion::NormalizeSorted(vector<S2CellId>* ids) {
+  S2_DCHECK(is_sorted(ids->begin(), ids->end()));
+
   // Optimize the representation by discarding cells contained by other cells,
   // and looking for cases where all subcells of a parent cell are present.
-
-  std::sort(ids->begin(), ids->end());
   int out = 0;
   for (S2CellId id : *ids) {
     // Check whether this cell is contained by the previous cell.
@@ -287,11 +294,20 @@ bool S2CellUnion::Intersects(const S2CellUnion& y) const {
 }
 
 S2CellUnion S2CellUnion::Union(const S2CellUnion& y) const {
-  vector<S2CellId> cell_ids;
-  cell_ids.reserve(num_cells() + y.num_cells());
-  cell_ids = cell_ids_;
-  cell_ids.insert(cell_ids.end(), y.cell_ids_.begin(), y.cell_ids_.end());
-  return S2CellUnion(std::move(cell_ids));
+  S2CellUnion result;
+  GetUnion(cell_ids_, y.cell_ids_, &result.cell_ids_);
+  return result;
+}
+
+/*static*/ void S2CellUnion::GetUnion(const vector<S2CellId>& x,
+                                      const vector<S2CellId>& y,
+                                      vector<S2CellId>* out) {
+  S2_DCHECK_NE(out, &x);
+  S2_DCHECK_NE(out, &y);
+  out->clear();
+  out->reserve(x.size() + y.size());
+  std::merge(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(*out));
+  NormalizeSorted(out);
 }
 
 S2CellUnion S2CellUnion::Intersection(S2CellId id) const {
@@ -317,84 +333,149 @@ S2CellUnion S2CellUnion::Intersection(const S2CellUnion& y) const {
   return result;
 }
 
-/*static*/ void S2CellUnion::GetIntersection(const vector<S2CellId>& x,
-                                             const vector<S2CellId>& y,
-                                             vector<S2CellId>* out) {
-  S2_DCHECK_NE(out, &x);
-  S2_DCHECK_NE(out, &y);
+// Returns the first element of [begin, end) that is not less than "target".
+// The search starts with exponentially increasing steps ("galloping"), so
+// that it takes time logarithmic in the distance from "begin" to the result
+// rather than in the length of the whole range.  This makes a sequence of
+// searches through a sorted vector efficient no matter how far apart the
+// results are.
+static const S2CellId* GallopLowerBound(const S2CellId* begin,
+                                        const S2CellId* end,
+                                        S2CellId target) {
+  const S2CellId* lo = begin;
+  ptrdiff_t step = 1;
+  for (; end - lo > step && lo[step] < target; step *= 2) {
+    lo += step;
+  }
+  return std::lower_bound(lo, lo + min(step + 1, end - lo), target);
+}
+
+// Computes the intersection of two sorted vectors of cell ids, and calls
+// emit(id) for each cell in the result (in sorted order).
+template <class Emit>
+static void GetIntersectionInternal(absl::Span<const S2CellId> x,
+                                    absl::Span<const S2CellId> y,
+                                    Emit emit) {
   S2_DCHECK(is_sorted(x.begin(), x.end()));
   S2_DCHECK(is_sorted(y.begin(), y.end()));
 
-  // This is a fairly efficient calculation that uses binary search to skip
+  // This is a fairly efficient calculation that uses galloping search to skip
   // over sections of both input vectors.  It takes logarithmic time if all the
   // cells of "x" come before or after all the cells of "y" in S2CellId order.
-
-  out->clear();
-  vector<S2CellId>::const_iterator i = x.begin();
-  vector<S2CellId>::const_iterator j = y.begin();
-  while (i != x.end() && j != y.end()) {
+  const S2CellId* i = x.data();
+  const S2CellId* j = y.data();
+  const S2CellId* x_end = x.data() + x.size();
+  const S2CellId* y_end = y.data() + y.size();
+  while (i != x_end && j != y_end) {
     S2CellId imin = i->range_min();
     S2CellId jmin = j->range_min();
     if (imin > jmin) {
       // Either j->contains(*i) or the two cells are disjoint.
       if (*i <= j->range_max()) {
-        out->push_back(*i++);
+        emit(*i++);
       } else {
         // Advance "j" to the first cell possibly contained by *i.
-        j = std::lower_bound(j + 1, y.end(), imin);
+        j = GallopLowerBound(j + 1, y_end, imin);
         // The previous cell *(j-1) may now contain *i.
         if (*i <= (j - 1)->range_max()) --j;
       }
     } else if (jmin > imin) {
       // Identical to the code above with "i" and "j" reversed.
       if (*j <= i->range_max()) {
-        out->push_back(*j++);
+        emit(*j++);
       } else {
-        i = std::lower_bound(i + 1, x.end(), jmin);
+        i = GallopLowerBound(i + 1, x_end, jmin);
         if (*j <= (i - 1)->range_max()) --i;
       }
     } else {
       // "i" and "j" have the same range_min(), so one contains the other.
       if (*i < *j)
-        out->push_back(*i++);
+        emit(*i++);
       else
-        out->push_back(*j++);
+        emit(*j++);
     }
   }
+}
+
+/*static*/ void S2CellUnion::GetIntersection(const vector<S2CellId>& x,
+                                             const vector<S2CellId>& y,
+                                             vector<S2CellId>* out) {
+  S2_DCHECK_NE(out, &x);
+  S2_DCHECK_NE(out, &y);
+  out->clear();
+  GetIntersectionInternal(x, y, [out](S2CellId id) { out->push_back(id); });
   // The output is generated in sorted order.
   S2_DCHECK(is_sorted(out->begin(), out->end()));
 }
 
+/*static*/ int S2CellUnion::GetIntersection(absl::Span<const S2CellId> x,
+                                            absl::Span<const S2CellId> y,
+                                            absl::Span<S2CellId> out) {
+  S2_DCHECK_GE(out.size(), x.size() + y.size());
+  int n = 0;
+  GetIntersectionInternal(x, y, [&out, &n](S2CellId id) {
+    S2_DCHECK_LT(n, out.size());
+    out[n++] = id;
+  });
+  return n;
+}
+
+// Adds the difference between "cell" and "y" to "cell_ids", where "y" is
+// the subset of some valid cell union that intersects "cell".  If they
+// intersect but the difference is non-empty, divide and conquer.
 static void GetDifferenceInternal(S2CellId cell,
-                                  const S2CellUnion& y,
+                                  absl::Span<const S2CellId> y,
                                   vector<S2CellId>* cell_ids) {
-  // Add the difference between cell and y to cell_ids.
-  // If they intersect but the difference is non-empty, divide and conquer.
-  if (!y.Intersects(cell)) {
+  if (y.empty()) {
     cell_ids->push_back(cell);
-  } else if (!y.Contains(cell)) {
+  } else if (!y[0].contains(cell)) {
+    // Every cell of "y" is contained by "cell".
+    const S2CellId* begin = y.data();
+    const S2CellId* end = y.data() + y.size();
     S2CellId child = cell.child_begin();
     for (int i = 0; ; ++i) {
-      GetDifferenceInternal(child, y, cell_ids);
+      const S2CellId* child_end = (i == 3) ? end :
+          std::upper_bound(begin, end, child.range_max());
+      GetDifferenceInternal(child, absl::MakeConstSpan(begin, child_end),
+                            cell_ids);
       if (i == 3) break;  // Avoid unnecessary next() computation.
+      begin = child_end;
       child = child.next();
     }
   }
 }
 
 S2CellUnion S2CellUnion::Difference(const S2CellUnion& y) const {
-  // TODO(ericv): this is approximately O(N*log(N)), but could probably
-  // use similar techniques as GetIntersection() to be more efficient.
-
   S2CellUnion result;
-  for (S2CellId id : *this) {
-    GetDifferenceInternal(id, y, &result.cell_ids_);
-  }
+  GetDifference(cell_ids_, y.cell_ids_, &result.cell_ids_);
   // The output is normalized as long as the first argument is normalized.
   S2_DCHECK(result.IsNormalized() || !IsNormalized());
   return result;
 }
 
+/*static*/ void S2CellUnion::GetDifference(const vector<S2CellId>& x,
+                                           const vector<S2CellId>& y,
+                                           vector<S2CellId>* out) {
+  S2_DCHECK_NE(out, &x);
+  S2_DCHECK_NE(out, &y);
+  out->clear();
+  // Since the cells of "x" are sorted, the cells of "y" that intersect them
+  // can be found by searching forward from the previous position.
+  const S2CellId* j = y.data();
+  const S2CellId* y_end = y.data() + y.size();
+  for (S2CellId id : x) {
+    S2CellId id_min = id.range_min(), id_max = id.range_max();
+    j = GallopLowerBound(j, y_end, id_min);
+    // The previous cell *(j-1) may contain "id".
+    if (j != y.data() && (j - 1)->range_max() >= id_min) --j;
+    // Find the cells contained by "id", followed by a cell that contains
+    // "id" (if any).
+    const S2CellId* j_end = GallopLowerBound(j, y_end, id_max.next());
+    if (j_end != y_end && j_end->range_min() <= id_max) ++j_end;
+    GetDifferenceInternal(id, absl::MakeConstSpan(j, j_end), out);
+  }
+}
+
 void S2CellUnion::Expand(int expand_level) {
   vector<S2CellId> output;
   uint64 level_lsb = S2CellId::lsb_for_level(expand_level);
@@ -27,6 +27,7 @@
 #include "s2/s2region.h"
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/base/macros.h"
+#include "s2/third_party/absl/types/span.h"
 
 class Decoder;
 class Encoder;
@@ -330,6 +331,34 @@ class S2CellUnion final : public S2Region {
                               const std::vector<S2CellId>& y,
                               std::vector<S2CellId>* out);
 
+  // Like GetIntersection() above, but writes the result into a buffer
+  // provided by the caller and returns the number of cells written.  This
+  // method never allocates memory.
+  //
+  // REQUIRES: "x" and "y" satisfy the requirements of IsValid().
+  // REQUIRES: out.size() >= x.size() + y.size()
+  static int GetIntersection(absl::Span<const S2CellId> x,
+                             absl::Span<const S2CellId> y,
+                             absl::Span<S2CellId> out);
+
+  // Like Union(), but works directly with vectors of S2CellIds.  Since the
+  // inputs are already sorted they are merged in linear time rather than
+  // being sorted again.  The result is normalized.
+  //
+  // REQUIRES: "x" and "y" are sorted.
+  // REQUIRES: out != &x && out != &y
+  static void GetUnion(const std::vector<S2CellId>& x,
+                       const std::vector<S2CellId>& y,
+                       std::vector<S2CellId>* out);
+
+  // Like Difference(), but works directly with vectors of S2CellIds.
+  //
+  // REQUIRES: "x" and "y" satisfy the requirements of IsValid().
+  // REQUIRES: out != &x && out != &y
+  static void GetDifference(const std::vector<S2CellId>& x,
+                            const std::vector<S2CellId>& y,
+                            std::vector<S2CellId>* out);
+
  private:
   friend class S2CellUnionTestPeer;  // For creating invalid S2CellUnions.
 
@@ -338,6 +367,9 @@ class S2CellUnion final : public S2Region {
   S2CellUnion(std::vector<S2CellId> cell_ids, VerbatimFlag verbatim)
       : cell_ids_(std::move(cell_ids)) {}
 
+  // Like Normalize(), but requires the cell ids to be sorted already.
+  static bool NormalizeSorted(std::vector<S2CellId>* cell_ids);
+
   // Converts a vector of uint64 to a vector of S2CellIds.
   static std::vector<S2CellId> ToS2CellIds(const std::vector<uint64>& ids);
 
@@ -280,6 +280,59 @@ TEST(S2CellUnion, Normalize) {
   printf("avg in %.2f, avg out %.2f\n", in_sum / kIters, out_sum / kIters);
 }
 
+// Adds the difference between "cell" and "y" to "out" by recursively
+// subdividing "cell", which is simple but slow.
+static void GetDifferenceBruteForce(S2CellId cell, const S2CellUnion& y,
+                                    vector<S2CellId>* out) {
+  if (!y.Intersects(cell)) {
+    out->push_back(cell);
+  } else if (!y.Contains(cell)) {
+    for (S2CellId child = cell.child_begin(); child != cell.child_end();
+         child = child.next()) {
+      GetDifferenceBruteForce(child, y, out);
+    }
+  }
+}
+
+TEST(S2CellUnion, StaticSetOperations) {
+  for (int iter = 0; iter < 500; ++iter) {
+    vector<S2CellId> input, expected, x, y;
+    AddCells(S2CellId::None(), false, &input, &expected);
+    for (S2CellId input_id : input) {
+      if (rnd.OneIn(2)) x.push_back(input_id);
+      if (rnd.OneIn(2)) y.push_back(input_id);
+    }
+    S2CellUnion xcells(std::move(x)), ycells(std::move(y));
+
+    // GetUnion() merges the sorted inputs without sorting them again.
+    vector<S2CellId> x_or_y;
+    S2CellUnion::GetUnion(xcells.cell_ids(), ycells.cell_ids(), &x_or_y);
+    vector<S2CellId> x_or_y_expected = xcells.cell_ids();
+    x_or_y_expected.insert(x_or_y_expected.end(), ycells.begin(),
+                           ycells.end());
+    S2CellUnion::Normalize(&x_or_y_expected);
+    EXPECT_EQ(x_or_y_expected, x_or_y);
+
+    // The buffer version of GetIntersection() matches the vector version.
+    vector<S2CellId> x_and_y;
+    S2CellUnion::GetIntersection(xcells.cell_ids(), ycells.cell_ids(),
+                                 &x_and_y);
+    vector<S2CellId> buffer(xcells.size() + ycells.size());
+    int n = S2CellUnion::GetIntersection(xcells.cell_ids(), ycells.cell_ids(),
+                                         absl::MakeSpan(buffer));
+    EXPECT_EQ(x_and_y, vector<S2CellId>(buffer.begin(), buffer.begin() + n));
+
+    // Check GetDifference() against a simple recursive implementation.
+    for (const auto& a : {&xcells, &ycells}) {
+      const auto& b = (a == &xcells) ? ycells : xcells;
+      vector<S2CellId> diff, diff_expected;
+      S2CellUnion::GetDifference(a->cell_ids(), b.cell_ids(), &diff);
+      for (S2CellId id : *a) GetDifferenceBruteForce(id, b, &diff_expected);
+      EXPECT_EQ(diff_expected, diff);
+    }
+  }
+}
+
 // Return the maximum geodesic distance from "axis" to any point of
 // "covering".
 static double GetRadius(const S2CellUnion& covering, const S2Point& axis) {
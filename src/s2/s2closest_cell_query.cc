@@ -94,7 +94,7 @@ S2ClosestCellQuery::~S2ClosestCellQuery() {
 }
 
 bool S2ClosestCellQuery::IsDistanceLess(Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 40, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_max_distance(limit);
@@ -104,7 +104,7 @@ bool S2ClosestCellQuery::IsDistanceLess(Target* target, S1ChordAngle limit) {
 
 bool S2ClosestCellQuery::IsDistanceLessOrEqual(Target* target,
                                                S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 40, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_inclusive_max_distance(limit);
@@ -114,7 +114,7 @@ bool S2ClosestCellQuery::IsDistanceLessOrEqual(Target* target,
 
 bool S2ClosestCellQuery::IsConservativeDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 40, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_conservative_max_distance(limit);
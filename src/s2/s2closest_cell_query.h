@@ -243,6 +243,15 @@ class S2ClosestCellQuery {
   // since it does not require allocating a new vector on each call.
   void FindClosestCells(Target* target, std::vector<Result>* results);
 
+  // Finds the closest cells to each of the given targets, storing the
+  // results for targets[i] in (*results)[i].  This is faster than calling
+  // FindClosestCells() on each target separately, and the targets can be
+  // searched in parallel by specifying an "executor" (see
+  // S2ClosestCellQueryBase for details).
+  void FindClosestCells(const std::vector<Target*>& targets,
+                        std::vector<std::vector<Result>>* results,
+                        Executor* executor = nullptr);
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the closest cell to the target.  If no cell satisfies the search
@@ -370,9 +379,15 @@ inline void S2ClosestCellQuery::FindClosestCells(Target* target,
   base_.FindClosestCells(target, options_, results);
 }
 
+inline void S2ClosestCellQuery::FindClosestCells(
+    const std::vector<Target*>& targets,
+    std::vector<std::vector<Result>>* results, Executor* executor) {
+  base_.FindClosestCells(targets, options_, results, executor);
+}
+
 inline S2ClosestCellQuery::Result S2ClosestCellQuery::FindClosestCell(
     Target* target) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 40, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   return base_.FindClosestCell(target, tmp_options);
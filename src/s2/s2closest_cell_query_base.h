@@ -20,6 +20,9 @@
 #ifndef S2_S2CLOSEST_CELL_QUERY_BASE_H_
 #define S2_S2CLOSEST_CELL_QUERY_BASE_H_
 
+#include <algorithm>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "s2/base/logging.h"
@@ -30,10 +33,12 @@
 #include "s2/s2cell_index.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2distance_target.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2region_coverer.h"
 #include "s2/util/gtl/btree_set.h"
-#include "s2/util/gtl/dense_hash_set.h"
+#include "s2/util/gtl/flat_hash_set.h"
 #include "s2/util/hash/mix.h"
+#include "s2/util/thread/executor.h"
 
 // S2ClosestCellQueryBase is a templatized class for finding the closest
 // (cell_id, label) pairs in an S2CellIndex to a given target.  It is not
@@ -57,7 +62,15 @@
 // used as long as it implements the Distance concept described in
 // s2distance_targets.h.  For example this can be used to measure maximum
 // distances, to get more accuracy, or to measure non-spheroidal distances.
-template <class Distance>
+//
+// The optional TargetType template argument is the type of target used by
+// every query (the default accepts any S2DistanceTarget<Distance>).  When it
+// is a "final" class such as S2ClosestCellQuery::PointTarget, the compiler
+// can call its distance methods directly (and inline them) rather than going
+// through S2DistanceTarget's virtual methods.  This is most useful when many
+// similar queries are made against small indexes, e.g. k-nearest-neighbor
+// lookups of query points.
+template <class Distance, class TargetType = S2DistanceTarget<Distance>>
 class S2ClosestCellQueryBase {
  public:
   using Delta = typename Distance::Delta;
@@ -138,12 +151,20 @@ class S2ClosestCellQueryBase {
     bool use_brute_force() const;
     void set_use_brute_force(bool use_brute_force);
 
+    // If specified, the statistics of every query are added to the given
+    // object (see s2query_stats.h).
+    //
+    // DEFAULT: nullptr
+    S2QueryStats* stats() const;
+    void set_stats(S2QueryStats* stats);
+
    private:
     Distance max_distance_ = Distance::Infinity();
     Delta max_error_ = Delta::Zero();
     const S2Region* region_ = nullptr;
     int max_results_ = kMaxMaxResults;
     bool use_brute_force_ = false;
+    S2QueryStats* stats_ = nullptr;
   };
 
   // The Target class represents the geometry to which the distance is
@@ -153,7 +174,9 @@ class S2ClosestCellQueryBase {
   //
   // Implementations do *not* need to be thread-safe.  They may cache data or
   // allocate temporary data structures in order to improve performance.
-  using Target = S2DistanceTarget<Distance>;
+  using Target = TargetType;
+  static_assert(std::is_base_of<S2DistanceTarget<Distance>, Target>::value,
+                "TargetType must be a subtype of S2DistanceTarget<Distance>");
 
   // Each "Result" object represents a closest (cell_id, label) pair.
   class Result {
@@ -251,6 +274,21 @@ class S2ClosestCellQueryBase {
   // REQUIRES: options.max_results() == 1
   Result FindClosestCell(Target* target, const Options& options);
 
+  // Finds the closest (cell_id, label) pairs to each of the given targets,
+  // storing the results for targets[i] in (*results)[i].  The targets are
+  // processed in S2CellId order of their bounding cap centers, so that
+  // consecutive searches reuse the index iterators and visit the same index
+  // ranges.  If "executor" is specified, the sorted targets are divided into
+  // contiguous runs that are searched in parallel, each by a separate query
+  // with its own iterators and priority queue; statistics (if requested) are
+  // added to options.stats() once all searches are finished.
+  //
+  // REQUIRES: If "executor" is specified, the targets are distinct objects.
+  void FindClosestCells(const std::vector<Target*>& targets,
+                        const Options& options,
+                        std::vector<std::vector<Result>>* results,
+                        Executor* executor = nullptr);
+
  private:
   using CellIterator = S2CellIndex::CellIterator;
   using ContentsIterator = S2CellIndex::ContentsIterator;
@@ -265,13 +303,18 @@ class S2ClosestCellQueryBase {
   void InitCovering();
   void AddInitialRange(S2CellId first_id, S2CellId last_id);
   void MaybeAddResult(S2CellId cell_id, Label label);
-  bool ProcessOrEnqueue(S2CellId id, NonEmptyRangeIterator* iter, bool seek);
+  bool ProcessOrEnqueue(S2CellId id, NonEmptyRangeIterator* iter, bool seek,
+                        S2ChildCellGenerator* parent = nullptr);
   void AddRange(const RangeIterator& range);
 
   const S2CellIndex* index_;
   const Options* options_;
   Target* target_;
 
+  // The statistics of the current query are added to this object (if not
+  // nullptr).
+  S2QueryStats* stats_ = nullptr;
+
   // True if max_error() must be subtracted from priority queue cell distances
   // in order to ensure that such distances are measured conservatively.  This
   // is true only if the target takes advantage of max_error() in order to
@@ -335,7 +378,7 @@ class S2ClosestCellQueryBase {
       return mix.get();
     }
   };
-  gtl::dense_hash_set<LabelledCell, LabelledCellHash> tested_cells_;
+  gtl::flat_hash_set<LabelledCell, LabelledCellHash> tested_cells_;
 
   // The algorithm maintains a priority queue of unprocessed S2CellIds, sorted
   // in increasing order of distance from the target.
@@ -376,125 +419,143 @@ class S2ClosestCellQueryBase {
 //////////////////   Implementation details follow   ////////////////////
 
 
-template <class Distance>
-inline S2ClosestCellQueryBase<Distance>::Options::Options() {
+template <class Distance, class TargetType>
+inline S2ClosestCellQueryBase<Distance, TargetType>::Options::Options() {
 }
 
-template <class Distance>
-inline int S2ClosestCellQueryBase<Distance>::Options::max_results() const {
+template <class Distance, class TargetType>
+inline int
+S2ClosestCellQueryBase<Distance, TargetType>::Options::max_results() const {
   return max_results_;
 }
 
-template <class Distance>
-inline void S2ClosestCellQueryBase<Distance>::Options::set_max_results(
+template <class Distance, class TargetType>
+inline void
+S2ClosestCellQueryBase<Distance, TargetType>::Options::set_max_results(
     int max_results) {
   S2_DCHECK_GE(max_results, 1);
   max_results_ = max_results;
 }
 
-template <class Distance>
-inline Distance S2ClosestCellQueryBase<Distance>::Options::max_distance()
-    const {
+template <class Distance, class TargetType>
+inline Distance
+S2ClosestCellQueryBase<Distance, TargetType>::Options::max_distance() const {
   return max_distance_;
 }
 
-template <class Distance>
-inline void S2ClosestCellQueryBase<Distance>::Options::set_max_distance(
+template <class Distance, class TargetType>
+inline void
+S2ClosestCellQueryBase<Distance, TargetType>::Options::set_max_distance(
     Distance max_distance) {
   max_distance_ = max_distance;
 }
 
-template <class Distance>
+template <class Distance, class TargetType>
 inline typename Distance::Delta
-S2ClosestCellQueryBase<Distance>::Options::max_error() const {
+S2ClosestCellQueryBase<Distance, TargetType>::Options::max_error() const {
   return max_error_;
 }
 
-template <class Distance>
-inline void S2ClosestCellQueryBase<Distance>::Options::set_max_error(
+template <class Distance, class TargetType>
+inline void
+S2ClosestCellQueryBase<Distance, TargetType>::Options::set_max_error(
     Delta max_error) {
   max_error_ = max_error;
 }
 
-template <class Distance>
-inline const S2Region* S2ClosestCellQueryBase<Distance>::Options::region()
-    const {
+template <class Distance, class TargetType>
+inline const S2Region*
+S2ClosestCellQueryBase<Distance, TargetType>::Options::region() const {
   return region_;
 }
 
-template <class Distance>
-inline void S2ClosestCellQueryBase<Distance>::Options::set_region(
+template <class Distance, class TargetType>
+inline void S2ClosestCellQueryBase<Distance, TargetType>::Options::set_region(
     const S2Region* region) {
   region_ = region;
 }
 
-template <class Distance>
-inline bool S2ClosestCellQueryBase<Distance>::Options::use_brute_force() const {
+template <class Distance, class TargetType>
+inline bool
+S2ClosestCellQueryBase<Distance, TargetType>::Options::use_brute_force() const {
   return use_brute_force_;
 }
 
-template <class Distance>
-inline void S2ClosestCellQueryBase<Distance>::Options::set_use_brute_force(
+template <class Distance, class TargetType>
+inline void
+S2ClosestCellQueryBase<Distance, TargetType>::Options::set_use_brute_force(
     bool use_brute_force) {
   use_brute_force_ = use_brute_force;
 }
 
-template <class Distance>
-S2ClosestCellQueryBase<Distance>::S2ClosestCellQueryBase()
+template <class Distance, class TargetType>
+inline S2QueryStats*
+S2ClosestCellQueryBase<Distance, TargetType>::Options::stats() const {
+  return stats_;
+}
+
+template <class Distance, class TargetType>
+inline void S2ClosestCellQueryBase<Distance, TargetType>::Options::set_stats(
+    S2QueryStats* stats) {
+  stats_ = stats;
+}
+
+template <class Distance, class TargetType>
+S2ClosestCellQueryBase<Distance, TargetType>::S2ClosestCellQueryBase()
     : tested_cells_(1) /* expected_max_elements*/ {
-  tested_cells_.set_empty_key(LabelledCell(S2CellId::None(), -1));
 }
 
-template <class Distance>
-S2ClosestCellQueryBase<Distance>::~S2ClosestCellQueryBase() {
+template <class Distance, class TargetType>
+S2ClosestCellQueryBase<Distance, TargetType>::~S2ClosestCellQueryBase() {
   // Prevent inline destructor bloat by providing a definition.
 }
 
-template <class Distance>
-inline S2ClosestCellQueryBase<Distance>::S2ClosestCellQueryBase(
+template <class Distance, class TargetType>
+inline S2ClosestCellQueryBase<Distance, TargetType>::S2ClosestCellQueryBase(
     const S2CellIndex* index) : S2ClosestCellQueryBase() {
   Init(index);
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::Init(
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::Init(
     const S2CellIndex* index) {
   index_ = index;
   contents_it_.Init(index);
   ReInit();
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::ReInit() {
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::ReInit() {
   index_covering_.clear();
 }
 
-template <class Distance>
+template <class Distance, class TargetType>
 inline const S2CellIndex&
-S2ClosestCellQueryBase<Distance>::index() const {
+S2ClosestCellQueryBase<Distance, TargetType>::index() const {
   return *index_;
 }
 
-template <class Distance>
-inline std::vector<typename S2ClosestCellQueryBase<Distance>::Result>
-S2ClosestCellQueryBase<Distance>::FindClosestCells(
+template <class Distance, class TargetType>
+inline std::vector<
+    typename S2ClosestCellQueryBase<Distance, TargetType>::Result>
+S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCells(
     Target* target, const Options& options) {
   std::vector<Result> results;
   FindClosestCells(target, options, &results);
   return results;
 }
 
-template <class Distance>
-typename S2ClosestCellQueryBase<Distance>::Result
-S2ClosestCellQueryBase<Distance>::FindClosestCell(
+template <class Distance, class TargetType>
+typename S2ClosestCellQueryBase<Distance, TargetType>::Result
+S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCell(
     Target* target, const Options& options) {
   S2_DCHECK_EQ(options.max_results(), 1);
   FindClosestCellsInternal(target, options);
   return result_singleton_;
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::FindClosestCells(
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCells(
     Target* target, const Options& options, std::vector<Result>* results) {
   FindClosestCellsInternal(target, options);
   results->clear();
@@ -513,11 +574,52 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCells(
   }
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::FindClosestCellsInternal(
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCells(
+    const std::vector<Target*>& targets, const Options& options,
+    std::vector<std::vector<Result>>* results, Executor* executor) {
+  std::vector<std::pair<S2CellId, int>> order;
+  order.reserve(targets.size());
+  for (int i = 0; i < targets.size(); ++i) {
+    order.push_back(std::make_pair(
+        S2CellId(targets[i]->GetCapBound().center()), i));
+  }
+  std::sort(order.begin(), order.end());
+  results->resize(targets.size());
+  const int n = static_cast<int>(order.size());
+  const int num_runs = (executor == nullptr) ? 1 :
+                       std::min(n, executor->num_threads());
+  if (num_runs <= 1) {
+    for (const auto& entry : order) {
+      FindClosestCells(targets[entry.second], options,
+                       &(*results)[entry.second]);
+    }
+    return;
+  }
+  std::vector<S2QueryStats> run_stats(num_runs);
+  ParallelFor(executor, num_runs, [&](int run) {
+      S2ClosestCellQueryBase worker(index_);
+      Options worker_options = options;
+      if (options.stats()) worker_options.set_stats(&run_stats[run]);
+      const int begin = static_cast<int64>(run) * n / num_runs;
+      const int end = static_cast<int64>(run + 1) * n / num_runs;
+      for (int i = begin; i < end; ++i) {
+        worker.FindClosestCells(targets[order[i].second], worker_options,
+                                &(*results)[order[i].second]);
+      }
+    });
+  if (options.stats()) {
+    for (const S2QueryStats& stats : run_stats) options.stats()->Add(stats);
+  }
+}
+
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCellsInternal(
     Target* target, const Options& options) {
   target_ = target;
   options_ = &options;
+  stats_ = options.stats();
+  if (stats_) ++stats_->num_queries;
 
   tested_cells_.clear();
   contents_it_.Clear();
@@ -569,6 +671,7 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCellsInternal(
   if (options.use_brute_force() ||
       index_->num_cells() <= target_->max_brute_force_index_size()) {
     avoid_duplicates_ = false;
+    if (stats_) ++stats_->num_brute_force_queries;
     FindClosestCellsBruteForce();
   } else {
     // If the target takes advantage of max_error() then we need to avoid
@@ -578,15 +681,16 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCellsInternal(
   }
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::FindClosestCellsBruteForce() {
+template <class Distance, class TargetType>
+void
+S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCellsBruteForce() {
   for (CellIterator it(index_); !it.done(); it.Next()) {
     MaybeAddResult(it.cell_id(), it.label());
   }
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::FindClosestCellsOptimized() {
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::FindClosestCellsOptimized() {
   InitQueue();
   while (!queue_.empty()) {
     // We need to copy the top entry before removing it, and we need to remove
@@ -605,15 +709,16 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCellsOptimized() {
     // Each child may either be processed directly or enqueued again.  The
     // loop is optimized so that we don't seek unnecessarily.
     bool seek = true;
+    S2ChildCellGenerator children(entry.id);
     NonEmptyRangeIterator range(index_);
     for (int i = 0; i < 4; ++i, child = child.next()) {
-      seek = ProcessOrEnqueue(child, &range, seek);
+      seek = ProcessOrEnqueue(child, &range, seek, &children);
     }
   }
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::InitQueue() {
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::InitQueue() {
   S2_DCHECK(queue_.empty());
 
   // Optimization: rather than starting with the entire index, see if we can
@@ -682,8 +787,8 @@ void S2ClosestCellQueryBase<Distance>::InitQueue() {
   }
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::InitCovering() {
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::InitCovering() {
   // Compute the "index covering", which is a small number of S2CellIds that
   // cover the indexed cells.  There are two cases:
   //
@@ -735,8 +840,8 @@ void S2ClosestCellQueryBase<Distance>::InitCovering() {
 // Adds a cell to index_covering_ that covers the given inclusive range.
 //
 // REQUIRES: "first" and "last" have a common ancestor.
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::AddInitialRange(
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::AddInitialRange(
     S2CellId first_id, S2CellId last_id) {
   // Add the lowest common ancestor of the given range.
   int level = first_id.GetCommonAncestorLevel(last_id);
@@ -746,9 +851,10 @@ void S2ClosestCellQueryBase<Distance>::AddInitialRange(
 
 // TODO(ericv): Consider having this method return false when distance_limit_
 // is reduced to zero, and terminating any calling loops early.
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::MaybeAddResult(S2CellId cell_id,
-                                                      Label label) {
+template <class Distance, class TargetType>
+void
+S2ClosestCellQueryBase<Distance, TargetType>::MaybeAddResult(
+    S2CellId cell_id, Label label) {
   if (avoid_duplicates_ &&
       !tested_cells_.insert(LabelledCell(cell_id, label)).second) {
     return;
@@ -758,6 +864,7 @@ void S2ClosestCellQueryBase<Distance>::MaybeAddResult(S2CellId cell_id,
   // multiple times with different labels.  This could be optimized by
   // remembering the last "cell_id" argument and its distance.  However this
   // may not be beneficial when Options::max_results() == 1, for example.
+  if (stats_) ++stats_->num_edges_tested;
   S2Cell cell(cell_id);
   Distance distance = distance_limit_;
   if (!target_->UpdateMinDistance(cell, &distance)) return;
@@ -795,9 +902,14 @@ void S2ClosestCellQueryBase<Distance>::MaybeAddResult(S2CellId cell_id,
 // Returns "true" if the cell was added to the queue, and "false" if it was
 // processed immediately, in which case "iter" is positioned at the first
 // non-empty range (if any) with start_id() > id.range_max().
-template <class Distance>
-bool S2ClosestCellQueryBase<Distance>::ProcessOrEnqueue(
-    S2CellId id, NonEmptyRangeIterator* iter, bool seek) {
+//
+// If "parent" is not nullptr, it generates the children of id.parent() and
+// is used to construct the S2Cell for "id" if the cell needs to be enqueued.
+template <class Distance, class TargetType>
+bool S2ClosestCellQueryBase<Distance, TargetType>::ProcessOrEnqueue(
+    S2CellId id, NonEmptyRangeIterator* iter, bool seek,
+    S2ChildCellGenerator* parent) {
+  if (stats_) ++stats_->num_cells_visited;
   if (seek) iter->Seek(id.range_min());
   S2CellId last = id.range_max();
   if (iter->start_id() > last) {
@@ -810,7 +922,8 @@ bool S2ClosestCellQueryBase<Distance>::ProcessOrEnqueue(
   RangeIterator max_it = *iter;
   if (max_it.Advance(kMinRangesToEnqueue - 1) && max_it.start_id() <= last) {
     // This cell intersects at least kMinRangesToEnqueue ranges, so enqueue it.
-    S2Cell cell(id);
+    S2Cell cell =
+        parent ? parent->child(id.child_position()) : S2Cell(id);
     Distance distance = distance_limit_;
     // We check "region_" second because it may be relatively expensive.
     if (target_->UpdateMinDistance(cell, &distance) &&
@@ -820,6 +933,7 @@ bool S2ClosestCellQueryBase<Distance>::ProcessOrEnqueue(
         distance = distance - options().max_error();
       }
       queue_.push(QueueEntry(distance, id));
+      if (stats_) stats_->UpdateQueueSize(queue_.size());
     }
     return true;  // Seek to next child.
   }
@@ -830,8 +944,9 @@ bool S2ClosestCellQueryBase<Distance>::ProcessOrEnqueue(
   return false;  // No need to seek to next child.
 }
 
-template <class Distance>
-void S2ClosestCellQueryBase<Distance>::AddRange(const RangeIterator& range) {
+template <class Distance, class TargetType>
+void S2ClosestCellQueryBase<Distance, TargetType>::AddRange(
+    const RangeIterator& range) {
   for (contents_it_.StartUnion(range);
        !contents_it_.done(); contents_it_.Next()) {
     MaybeAddResult(contents_it_.cell_id(), contents_it_.label());
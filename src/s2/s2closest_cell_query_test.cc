@@ -19,8 +19,10 @@
 
 #include <memory>
 #include <set>
+#include <thread>
 #include <vector>
 
+#include "s2/base/mutex.h"
 #include "s2/base/stringprintf.h"
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
@@ -33,6 +35,8 @@
 #include "s2/s2loop.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
+#include "s2/util/thread/work_stealing_executor.h"
 
 namespace {
 
@@ -141,6 +145,37 @@ TEST(S2ClosestCellQuery, EmptyCellUnionTarget) {
   EXPECT_EQ(S1ChordAngle::Infinity(), one_cell_query.GetDistance(&target));
 }
 
+TEST(S2ClosestCellQuery, DecodedIndex) {
+  // Verifies that an index initialized from S2CellIndex::Encode() can be
+  // queried in place with the same results as the original index.
+  S2Testing::rnd.Reset(1);
+  S2CellIndex index;
+  for (int i = 0; i < 1000; ++i) {
+    index.Add(S2Testing::GetRandomCellId(S2Testing::rnd.Uniform(20) + 5), i);
+  }
+  index.Build();
+  Encoder encoder;
+  index.Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  S2CellIndex decoded_index;
+  ASSERT_TRUE(decoded_index.Init(&decoder));
+
+  S2ClosestCellQuery query(&index), decoded_query(&decoded_index);
+  query.mutable_options()->set_max_results(5);
+  decoded_query.mutable_options()->set_max_results(5);
+  for (int i = 0; i < 100; ++i) {
+    S2ClosestCellQuery::PointTarget target(S2Testing::RandomPoint());
+    auto expected = query.FindClosestCells(&target);
+    auto actual = decoded_query.FindClosestCells(&target);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].distance(), actual[j].distance());
+      EXPECT_EQ(expected[j].cell_id(), actual[j].cell_id());
+      EXPECT_EQ(expected[j].label(), actual[j].label());
+    }
+  }
+}
+
 // An abstract class that adds cells to an S2CellIndex for benchmarking.
 struct CellIndexFactory {
  public:
@@ -394,4 +429,64 @@ TEST(S2ClosestCellQuery, ConservativeCellDistanceIsUsed) {
   FLAGS_s2_random_seed = saved_seed;
 }
 
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(S2ClosestCellQuery, BatchOfTargets) {
+  // Checks that searching a batch of targets (serially or in parallel) gives
+  // the same results as searching each target separately.
+  S2CellIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 500; ++i) {
+    S2CellId id(S2Testing::SamplePoint(cap));
+    index.Add(id.parent(S2Testing::rnd.Uniform(10) + 10), i);
+  }
+  index.Build();
+  S2ClosestCellQuery query(&index);
+  query.mutable_options()->set_max_results(3);
+  S2QueryStats stats;
+  query.mutable_options()->set_stats(&stats);
+  vector<unique_ptr<S2ClosestCellQuery::PointTarget>> owned_targets;
+  vector<S2ClosestCellQuery::Target*> targets;
+  for (int i = 0; i < 100; ++i) {
+    owned_targets.push_back(make_unique<S2ClosestCellQuery::PointTarget>(
+        S2Testing::SamplePoint(cap)));
+    targets.push_back(owned_targets.back().get());
+  }
+  vector<vector<S2ClosestCellQuery::Result>> expected(targets.size());
+  for (int i = 0; i < targets.size(); ++i) {
+    query.FindClosestCells(targets[i], &expected[i]);
+  }
+  S2QueryStats serial_stats = stats;
+  ThreadPerTaskExecutor executor;
+  WorkStealingExecutor pool(3);
+  for (Executor* e : {static_cast<Executor*>(nullptr),
+                      static_cast<Executor*>(&executor),
+                      static_cast<Executor*>(&pool)}) {
+    stats.Clear();
+    vector<vector<S2ClosestCellQuery::Result>> actual;
+    query.FindClosestCells(targets, &actual, e);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i], actual[i]) << i;
+    }
+    EXPECT_EQ(serial_stats.num_queries, stats.num_queries);
+  }
+}
+
 }  // namespace
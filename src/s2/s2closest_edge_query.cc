@@ -77,7 +77,7 @@ S2ClosestEdgeQuery::~S2ClosestEdgeQuery() {
 }
 
 bool S2ClosestEdgeQuery::IsDistanceLess(Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_max_distance(limit);
@@ -87,7 +87,7 @@ bool S2ClosestEdgeQuery::IsDistanceLess(Target* target, S1ChordAngle limit) {
 
 bool S2ClosestEdgeQuery::IsDistanceLessOrEqual(Target* target,
                                                S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_inclusive_max_distance(limit);
@@ -97,7 +97,7 @@ bool S2ClosestEdgeQuery::IsDistanceLessOrEqual(Target* target,
 
 bool S2ClosestEdgeQuery::IsConservativeDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_conservative_max_distance(limit);
@@ -249,6 +249,28 @@ class S2ClosestEdgeQuery {
   // since it does not require allocating a new vector on each call.
   void FindClosestEdges(Target* target, std::vector<Result>* results);
 
+  // Finds the closest edges to each of the given targets, storing the
+  // results for targets[i] in (*results)[i].  This is faster than calling
+  // FindClosestEdges() on each target separately when the targets are close
+  // to each other (see S2ClosestEdgeQueryBase for details).
+  void FindClosestEdges(const std::vector<Target*>& targets,
+                        std::vector<std::vector<Result>>* results);
+
+  // Calls "visitor" for each edge that satisfies the current options,
+  // terminating early if it returns false.  If max_results() is unlimited,
+  // results are streamed to the visitor in arbitrary order as they are
+  // found.  See S2ClosestEdgeQueryBase for details.
+  using ResultVisitor = Base::ResultVisitor;
+  bool VisitClosestEdges(Target* target, const ResultVisitor& visitor);
+
+  // A resumable version of FindClosestEdges() for callers that need to bound
+  // the time spent in each call (e.g. cooperative schedulers).  The options
+  // must not be modified until FinishFindClosestEdges() has been called.
+  // See S2ClosestEdgeQueryBase for details.
+  void StartFindClosestEdges(Target* target);
+  bool ContinueFindClosestEdges(int max_cells);
+  void FinishFindClosestEdges(std::vector<Result>* results);
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the closest edge to the target.  If no edge satisfies the search
@@ -395,9 +417,33 @@ inline void S2ClosestEdgeQuery::FindClosestEdges(Target* target,
   base_.FindClosestEdges(target, options_, results);
 }
 
+inline void S2ClosestEdgeQuery::FindClosestEdges(
+    const std::vector<Target*>& targets,
+    std::vector<std::vector<Result>>* results) {
+  base_.FindClosestEdges(targets, options_, results);
+}
+
+inline bool S2ClosestEdgeQuery::VisitClosestEdges(
+    Target* target, const ResultVisitor& visitor) {
+  return base_.VisitClosestEdges(target, options_, visitor);
+}
+
+inline void S2ClosestEdgeQuery::StartFindClosestEdges(Target* target) {
+  base_.StartFindClosestEdges(target, options_);
+}
+
+inline bool S2ClosestEdgeQuery::ContinueFindClosestEdges(int max_cells) {
+  return base_.ContinueFindClosestEdges(max_cells);
+}
+
+inline void S2ClosestEdgeQuery::FinishFindClosestEdges(
+    std::vector<Result>* results) {
+  base_.FinishFindClosestEdges(results);
+}
+
 inline S2ClosestEdgeQuery::Result S2ClosestEdgeQuery::FindClosestEdge(
     Target* target) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   return base_.FindClosestEdge(target, tmp_options);
@@ -18,9 +18,15 @@
 #ifndef S2_S2CLOSEST_EDGE_QUERY_BASE_H_
 #define S2_S2CLOSEST_EDGE_QUERY_BASE_H_
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "s2/base/casts.h"
 #include "s2/base/logging.h"
 #include "s2/third_party/absl/container/inlined_vector.h"
 #include "s2/_fp_contract_off.h"
@@ -31,12 +37,16 @@
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2distance_target.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2query_listener.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2region_coverer.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_count_edges.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
 #include "s2/util/gtl/btree_set.h"
-#include "s2/util/gtl/dense_hash_set.h"
+#include "s2/util/gtl/flat_hash_set.h"
+#include "s2/util/thread/executor.h"
 
 // S2ClosestEdgeQueryBase is a templatized class for finding the closest
 // edge(s) between two geometries.  It is not intended to be used directly,
@@ -65,7 +75,15 @@
 // used as long as it implements the Distance concept described in
 // s2distance_targets.h.  For example this can be used to measure maximum
 // distances, to get more accuracy, or to measure non-spheroidal distances.
-template <class Distance>
+//
+// The optional TargetType template argument is the type of target used by
+// every query (the default accepts any S2DistanceTarget<Distance>).  When it
+// is a "final" class such as S2ClosestEdgeQuery::PointTarget, the compiler
+// can call its distance methods directly (and inline them) rather than going
+// through S2DistanceTarget's virtual methods.  This is most useful when many
+// similar queries are made against small indexes, e.g. k-nearest-neighbor
+// lookups of query points.
+template <class Distance, class TargetType = S2DistanceTarget<Distance>>
 class S2ClosestEdgeQueryBase {
  public:
   using Delta = typename Distance::Delta;
@@ -143,12 +161,62 @@ class S2ClosestEdgeQueryBase {
     bool use_brute_force() const;
     void set_use_brute_force(bool use_brute_force);
 
+    // If specified, queries that return all edges within max_distance()
+    // (i.e., max_results() == kMaxMaxResults) split the index cells near the
+    // target into independent subtrees that are searched concurrently using
+    // the given executor, and the per-task results are merged.  Since the
+    // distance limit never changes in such queries, the tasks do not need to
+    // communicate.  This is only worthwhile when a single query visits a
+    // very large number of edges.  The results are always identical to those
+    // computed without an executor.  Other queries ignore this option.
+    //
+    // REQUIRES: the target's methods must be safe to call from several
+    //           threads at once.  This is true for the point, edge, and cell
+    //           targets, but not for S2ShapeIndex targets.
+    //
+    // DEFAULT: nullptr
+    Executor* executor() const { return executor_; }
+    void set_executor(Executor* executor) { executor_ = executor; }
+
+    // If specified, the statistics of every query are added to the given
+    // object (see s2query_stats.h).
+    //
+    // DEFAULT: nullptr
+    S2QueryStats* stats() const { return stats_; }
+    void set_stats(S2QueryStats* stats) { stats_ = stats; }
+
+    // If specified, only shapes for which the given predicate returns true
+    // are considered by the query; all other shapes are skipped before any of
+    // their edges are tested, and they never contribute interior results.
+    // This is much faster than discarding the unwanted results afterwards
+    // when the index contains many categories of shapes.  For example, to
+    // restrict the query to a set of shape ids stored as a bitset:
+    //
+    //   std::vector<bool> roads = ...;
+    //   Options::ShapeFilter filter = [&roads](int shape_id) {
+    //     return roads[shape_id];
+    //   };
+    //   options.set_shape_filter(&filter);
+    //
+    // The predicate must persist while the query is in use, and must be safe
+    // to call from several threads at once if executor() is specified.
+    //
+    // DEFAULT: nullptr (all shapes are considered)
+    using ShapeFilter = std::function<bool (int shape_id)>;
+    const ShapeFilter* shape_filter() const { return shape_filter_; }
+    void set_shape_filter(const ShapeFilter* shape_filter) {
+      shape_filter_ = shape_filter;
+    }
+
    private:
     Distance max_distance_ = Distance::Infinity();
     Delta max_error_ = Delta::Zero();
     int max_results_ = kMaxMaxResults;
     bool include_interiors_ = true;
     bool use_brute_force_ = false;
+    Executor* executor_ = nullptr;
+    S2QueryStats* stats_ = nullptr;
+    const ShapeFilter* shape_filter_ = nullptr;
   };
 
   // The Target class represents the geometry to which the distance is
@@ -158,7 +226,9 @@ class S2ClosestEdgeQueryBase {
   //
   // Implementations do *not* need to be thread-safe.  They may cache data or
   // allocate temporary data structures in order to improve performance.
-  using Target = S2DistanceTarget<Distance>;
+  using Target = TargetType;
+  static_assert(std::is_base_of<S2DistanceTarget<Distance>, Target>::value,
+                "TargetType must be a subtype of S2DistanceTarget<Distance>");
 
   // Each "Result" object represents a closest edge.  Note the following
   // special cases:
@@ -271,27 +341,99 @@ class S2ClosestEdgeQueryBase {
   // REQUIRES: options.max_results() == 1
   Result FindClosestEdge(Target* target, const Options& options);
 
+  // Finds the closest edges to each of the given targets, storing the
+  // results for targets[i] in (*results)[i].  This is equivalent to calling
+  // FindClosestEdges() for each target in turn, but it is faster when the
+  // targets are near each other (e.g., a batch of nearby probe points).  The
+  // targets are processed in S2CellId order of their bounding cap centers so
+  // that consecutive searches visit the same index cells, and when
+  // max_results() == 1 the index cell containing each target is found without
+  // seeking whenever it is the same as for the previous target.
+  void FindClosestEdges(const std::vector<Target*>& targets,
+                        const Options& options,
+                        std::vector<std::vector<Result>>* results);
+
+  // A function that is called with each result.  If it returns false, the
+  // query is stopped.
+  using ResultVisitor = std::function<bool (const Result& result)>;
+
+  // Calls "visitor" for each edge that satisfies the given options,
+  // terminating early if it returns false (in which case VisitClosestEdges
+  // returns false as well).  When max_results() is unlimited (e.g. when
+  // finding all edges within a given distance), each result is visited as
+  // soon as it is found, in arbitrary order, rather than being buffered and
+  // sorted.  Otherwise the results are visited in the order returned by
+  // FindClosestEdges().
+  //
+  // Note that options.executor() is ignored when results are streamed (so
+  // the visitor does not need to be thread-safe).
+  bool VisitClosestEdges(Target* target, const Options& options,
+                         const ResultVisitor& visitor);
+
+  // The following methods are a resumable version of FindClosestEdges() for
+  // callers that need to bound the time spent in each call, e.g. servers
+  // based on cooperative scheduling (fibers or coroutines).  For example:
+  //
+  //   query.StartFindClosestEdges(&target, options);
+  //   while (!query.ContinueFindClosestEdges(1000)) {
+  //     Yield();
+  //   }
+  //   query.FinishFindClosestEdges(&results);
+  //
+  // The results are the same as FindClosestEdges().  The target and options
+  // must remain valid until FinishFindClosestEdges() is called, and no other
+  // query may use this object in the meantime.  Note that the query setup
+  // (including the whole query if the brute force algorithm is used) is done
+  // by StartFindClosestEdges(), and that options.executor() is ignored.
+  void StartFindClosestEdges(Target* target, const Options& options);
+
+  // Processes at most "max_cells" cells of the search queue (each cell is
+  // either subdivided or has its edges tested) and returns true if the query
+  // is complete.
+  bool ContinueFindClosestEdges(int max_cells);
+
+  // Returns the results of a resumable query.  If this is called before
+  // ContinueFindClosestEdges() has returned true, the query is abandoned and
+  // the results found so far are returned (i.e., edges that satisfy the
+  // options but are not necessarily the closest ones).
+  void FinishFindClosestEdges(std::vector<Result>* results);
+
  private:
   class QueueEntry;
 
   const Options& options() const { return *options_; }
+  bool IncludesShape(int shape_id) const;
   void FindClosestEdgesInternal(Target* target, const Options& options);
+  bool InitQuery(Target* target, const Options& options);
+  void GetResults(std::vector<Result>* results);
   void FindClosestEdgesBruteForce();
   void FindClosestEdgesOptimized();
+  void ProcessQueue(int max_queue_size,
+                    int max_cells = std::numeric_limits<int>::max());
+  void ProcessQueueInParallel();
   void InitQueue();
+  bool LocateCenterCell(const S2Point& center);
   void InitCovering();
   void AddInitialRange(const S2ShapeIndex::Iterator& first,
                        const S2ShapeIndex::Iterator& last);
   void MaybeAddResult(const S2Shape& shape, int edge_id);
+  bool MaybeAddPointResults(const S2SoAPointVectorShape& shape,
+                            const std::vector<int32>& edge_ids);
   void AddResult(const Result& result);
   void ProcessEdges(const QueueEntry& entry);
-  void ProcessOrEnqueue(S2CellId id);
-  void ProcessOrEnqueue(S2CellId id, const S2ShapeIndexCell* index_cell);
+  void ProcessOrEnqueue(const S2Cell& cell);
+  void ProcessOrEnqueue(S2CellId id, const S2ShapeIndexCell* index_cell,
+                        const S2Cell* cell = nullptr);
 
   const S2ShapeIndex* index_;
   const Options* options_;
   Target* target_;
 
+  // The statistics of the current query are added to this object (if not
+  // nullptr).  This is usually options().stats(), except in the worker
+  // queries used by ProcessQueueInParallel().
+  S2QueryStats* stats_ = nullptr;
+
   // True if max_error() must be subtracted from priority queue cell distances
   // in order to ensure that such distances are measured conservatively.  This
   // is true only if the target takes advantage of max_error() in order to
@@ -362,8 +504,24 @@ class S2ClosestEdgeQueryBase {
   // TODO(ericv): Check whether it is faster to avoid duplicates by default
   // (even when Options::max_results() == 1), rather than just when we need to.
   bool avoid_duplicates_;
+
+  // If not nullptr, results are passed to this visitor rather than being
+  // collected (see VisitClosestEdges).
+  const ResultVisitor* visitor_ = nullptr;
+  bool visitor_stopped_ = false;
   using ShapeEdgeId = s2shapeutil::ShapeEdgeId;
-  gtl::dense_hash_set<ShapeEdgeId, s2shapeutil::ShapeEdgeIdHash> tested_edges_;
+  gtl::flat_hash_set<ShapeEdgeId, s2shapeutil::ShapeEdgeIdHash> tested_edges_;
+
+  // Temporary storage for computing the distances to the points of an
+  // S2SoAPointVectorShape in batches (see MaybeAddPointResults).
+  std::vector<int32> batch_edge_ids_;
+  std::vector<Distance> batch_distances_;
+
+  // Temporary storage for computing the distances to the edges of each index
+  // cell in a single call (see ProcessEdges).
+  std::vector<S2Shape::Edge> batch_edges_;
+  std::unique_ptr<bool[]> batch_updated_;
+  int batch_updated_size_ = 0;
 
   // The algorithm maintains a priority queue of unprocessed S2CellIds, sorted
   // in increasing order of distance from the target.
@@ -391,151 +549,186 @@ class S2ClosestEdgeQueryBase {
       return other.distance < distance;
     }
   };
-  using CellQueue =
-      std::priority_queue<QueueEntry, absl::InlinedVector<QueueEntry, 16>>;
+  // A priority queue that can be emptied without releasing its storage, so
+  // that repeated queries do not need to reallocate it.
+  class CellQueue : public std::priority_queue<
+      QueueEntry, absl::InlinedVector<QueueEntry, 16>> {
+   public:
+    // Note that InlinedVector::clear() frees any heap storage.
+    void clear() { this->c.erase(this->c.begin(), this->c.end()); }
+  };
   CellQueue queue_;
 
   // Temporaries, defined here to avoid multiple allocations / initializations.
+  //
+  // All of the temporary containers above and below keep their capacity from
+  // one query to the next, so a query object that is reused for many targets
+  // (e.g., one per thread) does not allocate memory in the steady state.
 
   S2ShapeIndex::Iterator iter_;
+  S2RegionCoverer coverer_;
   std::vector<S2CellId> max_distance_covering_;
   std::vector<S2CellId> initial_cells_;
+
+  // The index cell that contained the center of the most recent target (see
+  // LocateCenterCell), or nullptr if none.  Consecutive targets are often in
+  // the same cell, especially when a batch of targets is sorted.
+  S2CellId center_cell_id_;
+  const S2ShapeIndexCell* center_cell_;
 };
 
 
 //////////////////   Implementation details follow   ////////////////////
 
 
-template <class Distance>
-inline S2ClosestEdgeQueryBase<Distance>::Options::Options() {
+template <class Distance, class TargetType>
+inline S2ClosestEdgeQueryBase<Distance, TargetType>::Options::Options() {
 }
 
-template <class Distance>
-inline int S2ClosestEdgeQueryBase<Distance>::Options::max_results() const {
+template <class Distance, class TargetType>
+inline int
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::max_results() const {
   return max_results_;
 }
 
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::Options::set_max_results(
+template <class Distance, class TargetType>
+inline void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::set_max_results(
     int max_results) {
   S2_DCHECK_GE(max_results, 1);
   max_results_ = max_results;
 }
 
-template <class Distance>
-inline Distance S2ClosestEdgeQueryBase<Distance>::Options::max_distance()
-    const {
+template <class Distance, class TargetType>
+inline Distance
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::max_distance() const {
   return max_distance_;
 }
 
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::Options::set_max_distance(
+template <class Distance, class TargetType>
+inline void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::set_max_distance(
     Distance max_distance) {
   max_distance_ = max_distance;
 }
 
-template <class Distance>
+template <class Distance, class TargetType>
 inline typename Distance::Delta
-S2ClosestEdgeQueryBase<Distance>::Options::max_error() const {
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::max_error() const {
   return max_error_;
 }
 
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::Options::set_max_error(
+template <class Distance, class TargetType>
+inline void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::set_max_error(
     Delta max_error) {
   max_error_ = max_error;
 }
 
-template <class Distance>
-inline bool S2ClosestEdgeQueryBase<Distance>::Options::include_interiors()
+template <class Distance, class TargetType>
+inline bool
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::include_interiors()
     const {
   return include_interiors_;
 }
 
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::Options::set_include_interiors(
+template <class Distance, class TargetType>
+inline void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::set_include_interiors(
     bool include_interiors) {
   include_interiors_ = include_interiors;
 }
 
-template <class Distance>
-inline bool S2ClosestEdgeQueryBase<Distance>::Options::use_brute_force() const {
+template <class Distance, class TargetType>
+inline bool
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::use_brute_force() const {
   return use_brute_force_;
 }
 
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::Options::set_use_brute_force(
+template <class Distance, class TargetType>
+inline void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Options::set_use_brute_force(
     bool use_brute_force) {
   use_brute_force_ = use_brute_force;
 }
 
-template <class Distance>
-S2ClosestEdgeQueryBase<Distance>::S2ClosestEdgeQueryBase()
-    : tested_edges_(1) /* expected_max_elements*/ {
-  tested_edges_.set_empty_key(ShapeEdgeId(-1, -1));
+template <class Distance, class TargetType>
+S2ClosestEdgeQueryBase<Distance, TargetType>::S2ClosestEdgeQueryBase()
+    : tested_edges_(1) /* expected_max_elements*/, center_cell_(nullptr) {
+  coverer_.mutable_options()->set_max_cells(4);
 }
 
-template <class Distance>
-S2ClosestEdgeQueryBase<Distance>::~S2ClosestEdgeQueryBase() {
+template <class Distance, class TargetType>
+S2ClosestEdgeQueryBase<Distance, TargetType>::~S2ClosestEdgeQueryBase() {
   // Prevent inline destructor bloat by providing a definition.
 }
 
-template <class Distance>
-inline S2ClosestEdgeQueryBase<Distance>::S2ClosestEdgeQueryBase(
+template <class Distance, class TargetType>
+inline S2ClosestEdgeQueryBase<Distance, TargetType>::S2ClosestEdgeQueryBase(
     const S2ShapeIndex* index) : S2ClosestEdgeQueryBase() {
   Init(index);
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::Init(const S2ShapeIndex* index) {
+template <class Distance, class TargetType>
+void
+S2ClosestEdgeQueryBase<Distance, TargetType>::Init(const S2ShapeIndex* index) {
   index_ = index;
   ReInit();
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::ReInit() {
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::ReInit() {
   index_num_edges_ = 0;
   index_num_edges_limit_ = 0;
   index_covering_.clear();
   index_cells_.clear();
+  center_cell_ = nullptr;
   // We don't initialize iter_ here to make queries on small indexes a bit
   // faster (i.e., where brute force is used).
 }
 
-template <class Distance>
-inline const S2ShapeIndex& S2ClosestEdgeQueryBase<Distance>::index() const {
+template <class Distance, class TargetType>
+inline const S2ShapeIndex&
+S2ClosestEdgeQueryBase<Distance, TargetType>::index() const {
   return *index_;
 }
 
-template <class Distance>
-inline std::vector<typename S2ClosestEdgeQueryBase<Distance>::Result>
-S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(Target* target,
-                                                   const Options& options) {
+template <class Distance, class TargetType>
+inline std::vector<
+    typename S2ClosestEdgeQueryBase<Distance, TargetType>::Result>
+S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdges(
+    Target* target, const Options& options) {
   std::vector<Result> results;
   FindClosestEdges(target, options, &results);
   return results;
 }
 
-template <class Distance>
-typename S2ClosestEdgeQueryBase<Distance>::Result
-S2ClosestEdgeQueryBase<Distance>::FindClosestEdge(Target* target,
-                                                  const Options& options) {
+template <class Distance, class TargetType>
+typename S2ClosestEdgeQueryBase<Distance, TargetType>::Result
+S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdge(
+    Target* target, const Options& options) {
   S2_DCHECK_EQ(options.max_results(), 1);
   FindClosestEdgesInternal(target, options);
   return result_singleton_;
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdges(
     Target* target, const Options& options,
     std::vector<Result>* results) {
   FindClosestEdgesInternal(target, options);
+  GetResults(results);
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::GetResults(
+    std::vector<Result>* results) {
   results->clear();
-  if (options.max_results() == 1) {
+  if (options().max_results() == 1) {
     if (result_singleton_.shape_id() >= 0) {
       results->push_back(result_singleton_);
     }
-  } else if (options.max_results() == Options::kMaxMaxResults) {
+  } else if (options().max_results() == Options::kMaxMaxResults) {
     std::sort(result_vector_.begin(), result_vector_.end());
     std::unique_copy(result_vector_.begin(), result_vector_.end(),
                      std::back_inserter(*results));
@@ -546,19 +739,97 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdges(
+    const std::vector<Target*>& targets, const Options& options,
+    std::vector<std::vector<Result>>* results) {
+  // Sort the targets along the Hilbert curve so that each search starts near
+  // where the previous one ended.
+  std::vector<std::pair<S2CellId, int>> order;
+  order.reserve(targets.size());
+  for (int i = 0; i < targets.size(); ++i) {
+    order.push_back(std::make_pair(
+        S2CellId(targets[i]->GetCapBound().center()), i));
+  }
+  std::sort(order.begin(), order.end());
+  results->resize(targets.size());
+  for (const auto& entry : order) {
+    FindClosestEdges(targets[entry.second], options,
+                     &(*results)[entry.second]);
+  }
+}
+
+template <class Distance, class TargetType>
+bool S2ClosestEdgeQueryBase<Distance, TargetType>::VisitClosestEdges(
+    Target* target, const Options& options, const ResultVisitor& visitor) {
+  if (options.max_results() != Options::kMaxMaxResults) {
+    for (const Result& result : FindClosestEdges(target, options)) {
+      if (!visitor(result)) return false;
+    }
+    return true;
+  }
+  // Otherwise the distance limit never changes, so every result found is
+  // final.  We avoid duplicate edges explicitly since results can't be
+  // uniqued at the end.
+  S2QueryTimer timer(S2QueryListener::Operation::CLOSEST_EDGES,
+                     options.stats());
+  visitor_ = &visitor;
+  visitor_stopped_ = false;
+  if (InitQuery(target, options)) {
+    avoid_duplicates_ = true;
+    FindClosestEdgesOptimized();
+  }
+  visitor_ = nullptr;
+  return !visitor_stopped_;
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::StartFindClosestEdges(
+    Target* target, const Options& options) {
+  if (InitQuery(target, options)) InitQueue();
+}
+
+template <class Distance, class TargetType>
+bool S2ClosestEdgeQueryBase<Distance, TargetType>::ContinueFindClosestEdges(
+    int max_cells) {
+  ProcessQueue(std::numeric_limits<int>::max(), max_cells);
+  return queue_.empty();
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::FinishFindClosestEdges(
+    std::vector<Result>* results) {
+  queue_.clear();  // Abandons the query if it is not complete.
+  GetResults(results);
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdgesInternal(
+    Target* target, const Options& options) {
+  S2QueryTimer timer(S2QueryListener::Operation::CLOSEST_EDGES,
+                     options.stats());
+  if (InitQuery(target, options)) FindClosestEdgesOptimized();
+}
+
+// Initializes the state of a query, and returns true if the optimized
+// algorithm needs to be run.  Otherwise the query is already complete.
+template <class Distance, class TargetType>
+bool S2ClosestEdgeQueryBase<Distance, TargetType>::InitQuery(
     Target* target, const Options& options) {
   target_ = target;
   options_ = &options;
+  stats_ = options.stats();
+  if (stats_) ++stats_->num_queries;
 
-  tested_edges_.clear();
+  // Unlike clear(), this does not shrink and reallocate the hash table.  It is
+  // O(1) unless the previous query actually needed to avoid duplicates.
+  tested_edges_.clear_no_resize();
   distance_limit_ = options.max_distance();
   result_singleton_ = Result();
   S2_DCHECK(result_vector_.empty());
   S2_DCHECK(result_set_.empty());
   S2_DCHECK_GE(target->max_brute_force_index_size(), 0);
-  if (distance_limit_ == Distance::Zero()) return;
+  if (distance_limit_ == Distance::Zero()) return false;
 
   if (options.max_results() == Options::kMaxMaxResults &&
       options.max_distance() == Distance::Infinity()) {
@@ -568,15 +839,16 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
   if (options.include_interiors()) {
     gtl::btree_set<int32> shape_ids;
     (void) target->VisitContainingShapes(
-        *index_, [&shape_ids, &options](S2Shape* containing_shape,
-                                        const S2Point& target_point) {
+        *index_, [this, &shape_ids, &options](S2Shape* containing_shape,
+                                              const S2Point& target_point) {
+          if (!IncludesShape(containing_shape->id())) return true;
           shape_ids.insert(containing_shape->id());
           return shape_ids.size() < options.max_results();
         });
     for (int shape_id : shape_ids) {
       AddResult(Result(Distance::Zero(), shape_id, -1));
     }
-    if (distance_limit_ == Distance::Zero()) return;
+    if (distance_limit_ == Distance::Zero()) return false;
   }
 
   // If max_error() > 0 and the target takes advantage of this, then we may
@@ -624,32 +896,59 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
   if (options.use_brute_force() || index_num_edges_ < min_optimized_edges) {
     // The brute force algorithm considers each edge exactly once.
     avoid_duplicates_ = false;
+    if (stats_) ++stats_->num_brute_force_queries;
     FindClosestEdgesBruteForce();
-  } else {
-    // If the target takes advantage of max_error() then we need to avoid
-    // duplicate edges explicitly.  (Otherwise it happens automatically.)
-    avoid_duplicates_ = (target_uses_max_error && options.max_results() > 1);
-    FindClosestEdgesOptimized();
+    return false;
   }
+  // If the target takes advantage of max_error() then we need to avoid
+  // duplicate edges explicitly.  (Otherwise it happens automatically.)
+  avoid_duplicates_ = (target_uses_max_error && options.max_results() > 1);
+  return true;
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesBruteForce() {
+template <class Distance, class TargetType>
+void
+S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdgesBruteForce() {
   for (S2Shape* shape : *index_) {
-    if (shape == nullptr) continue;
+    if (shape == nullptr || !IncludesShape(shape->id())) continue;
     int num_edges = shape->num_edges();
+    if (shape->type_tag() == S2SoAPointVectorShape::kTypeTag) {
+      batch_edge_ids_.resize(num_edges);
+      for (int e = 0; e < num_edges; ++e) batch_edge_ids_[e] = e;
+      if (MaybeAddPointResults(
+              *down_cast<const S2SoAPointVectorShape*>(shape),
+              batch_edge_ids_)) {
+        continue;
+      }
+    }
     for (int e = 0; e < num_edges; ++e) {
       MaybeAddResult(*shape, e);
     }
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized() {
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::FindClosestEdgesOptimized() {
   InitQueue();
-  // Repeatedly find the closest S2Cell to "target" and either split it into
-  // its four children or process all of its edges.
-  while (!queue_.empty()) {
+  if (options().executor() != nullptr && visitor_ == nullptr &&
+      options().max_results() == Options::kMaxMaxResults) {
+    ProcessQueueInParallel();
+  } else {
+    ProcessQueue(std::numeric_limits<int>::max());
+  }
+}
+
+// Repeatedly finds the closest S2Cell to "target" and either splits it into
+// its four children or processes all of its edges, until the queue is empty
+// or contains at least "max_queue_size" entries, or "max_cells" cells have
+// been processed.
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::ProcessQueue(
+    int max_queue_size, int max_cells) {
+  for (int num_cells = 0; num_cells < max_cells; ++num_cells) {
+    if (queue_.empty() || static_cast<int>(queue_.size()) >= max_queue_size) {
+      break;
+    }
     // We need to copy the top entry before removing it, and we need to
     // remove it before adding any new entries to the queue.
     QueueEntry entry = queue_.top();
@@ -658,7 +957,7 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized() {
     // entry.distance.
     Distance distance = entry.distance;
     if (!(distance < distance_limit_)) {
-      queue_ = CellQueue();  // Clear any remaining entries.
+      queue_.clear();  // Clear any remaining entries.
       break;
     }
     // If this is already known to be an index cell, just process it.
@@ -670,26 +969,69 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized() {
     // child back to the queue, we first check whether it is empty.  We do
     // this in two seek operations rather than four by seeking to the key
     // between children 0 and 1 and to the key between children 2 and 3.
+    // The child cells are derived from the parent's bounds, which is much
+    // faster than constructing each S2Cell from its id.
     S2CellId id = entry.id;
+    S2ChildCellGenerator children(id);
     iter_.Seek(id.child(1).range_min());
     if (!iter_.done() && iter_.id() <= id.child(1).range_max()) {
-      ProcessOrEnqueue(id.child(1));
+      ProcessOrEnqueue(children.child(1));
     }
     if (iter_.Prev() && iter_.id() >= id.range_min()) {
-      ProcessOrEnqueue(id.child(0));
+      ProcessOrEnqueue(children.child(0));
     }
     iter_.Seek(id.child(3).range_min());
     if (!iter_.done() && iter_.id() <= id.range_max()) {
-      ProcessOrEnqueue(id.child(3));
+      ProcessOrEnqueue(children.child(3));
     }
     if (iter_.Prev() && iter_.id() >= id.child(2).range_min()) {
-      ProcessOrEnqueue(id.child(2));
+      ProcessOrEnqueue(children.child(2));
     }
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
+// Processes the queue using options().executor().  This is only valid when
+// max_results() is unlimited, since then distance_limit_ never changes and
+// the queue entries can be processed independently in any order.
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::ProcessQueueInParallel() {
+  // First split the closest cells until there are enough subtrees to keep
+  // all the threads busy.  (Large subtrees are split first since the queue
+  // is ordered by distance, which is a reasonable proxy.)
+  const int kTasksPerThread = 8;
+  Executor* executor = options().executor();
+  ProcessQueue(kTasksPerThread * executor->num_threads());
+  std::vector<QueueEntry> entries;
+  entries.reserve(queue_.size());
+  for (; !queue_.empty(); queue_.pop()) entries.push_back(queue_.top());
+
+  // Each task searches one subtree using its own query object (and therefore
+  // its own iterator, queue, and results).
+  std::vector<std::vector<Result>> task_results(entries.size());
+  std::vector<S2QueryStats> task_stats(stats_ ? entries.size() : 0);
+  ParallelFor(executor, entries.size(), [&](int i) {
+    S2ClosestEdgeQueryBase worker(index_);
+    worker.target_ = target_;
+    worker.options_ = options_;
+    worker.stats_ = stats_ ? &task_stats[i] : nullptr;
+    worker.distance_limit_ = distance_limit_;
+    worker.use_conservative_cell_distance_ = use_conservative_cell_distance_;
+    worker.avoid_duplicates_ = false;  // Duplicates are removed below.
+    worker.iter_.Init(index_, S2ShapeIndex::UNPOSITIONED);
+    worker.queue_.push(entries[i]);
+    worker.ProcessQueue(std::numeric_limits<int>::max());
+    task_results[i].swap(worker.result_vector_);
+  });
+  // Note that FindClosestEdges() sorts and uniques result_vector_.
+  for (const auto& results : task_results) {
+    result_vector_.insert(result_vector_.end(), results.begin(),
+                          results.end());
+  }
+  for (const S2QueryStats& stats : task_stats) stats_->Add(stats);
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::InitQueue() {
   S2_DCHECK(queue_.empty());
   if (index_covering_.empty()) {
     // We delay iterator initialization until now to make queries on very
@@ -709,8 +1051,8 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   // process one or both of the adjacent index cells in S2CellId order,
   // provided that those cells are closer than distance_limit_.
   S2Cap cap = target_->GetCapBound();
-  if (options().max_results() == 1 && iter_.Locate(cap.center())) {
-    ProcessEdges(QueueEntry(Distance::Zero(), iter_.id(), &iter_.cell()));
+  if (options().max_results() == 1 && LocateCenterCell(cap.center())) {
+    ProcessEdges(QueueEntry(Distance::Zero(), center_cell_id_, center_cell_));
     // Skip the rest of the algorithm if we found an intersecting edge.
     if (distance_limit_ == Distance::Zero()) return;
   }
@@ -723,11 +1065,9 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   } else {
     // Compute a covering of the search disc and intersect it with the
     // precomputed index covering.
-    S2RegionCoverer coverer;
-    coverer.mutable_options()->set_max_cells(4);
     S1ChordAngle radius = cap.radius() + distance_limit_.GetChordAngleBound();
     S2Cap search_cap(cap.center(), radius);
-    coverer.GetFastCovering(search_cap, &max_distance_covering_);
+    coverer_.GetFastCovering(search_cap, &max_distance_covering_);
     S2CellUnion::GetIntersection(index_covering_, max_distance_covering_,
                                  &initial_cells_);
 
@@ -765,8 +1105,24 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::InitCovering() {
+// Returns true if "center" is contained by an index cell, and sets
+// center_cell_id_ and center_cell_ to that cell.  The index is only searched
+// if "center" is not contained by the cell found for the previous target.
+template <class Distance, class TargetType>
+bool S2ClosestEdgeQueryBase<Distance, TargetType>::LocateCenterCell(
+    const S2Point& center) {
+  S2CellId target_id(center);
+  if (center_cell_ != nullptr && center_cell_id_.contains(target_id)) {
+    return true;
+  }
+  if (!iter_.Locate(center)) return false;
+  center_cell_id_ = iter_.id();
+  center_cell_ = &iter_.cell();
+  return true;
+}
+
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::InitCovering() {
   // Find the range of S2Cells spanned by the index and choose a level such
   // that the entire index can be covered with just a few cells.  These are
   // the "top-level" cells.  There are two cases:
@@ -820,8 +1176,8 @@ void S2ClosestEdgeQueryBase<Distance>::InitCovering() {
 // inclusive range of cells.
 //
 // REQUIRES: "first" and "last" have a common ancestor.
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::AddInitialRange(
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::AddInitialRange(
     const S2ShapeIndex::Iterator& first,
     const S2ShapeIndex::Iterator& last) {
   if (first.id() == last.id()) {
@@ -837,13 +1193,14 @@ void S2ClosestEdgeQueryBase<Distance>::AddInitialRange(
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::MaybeAddResult(
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::MaybeAddResult(
     const S2Shape& shape, int edge_id) {
   if (avoid_duplicates_ &&
       !tested_edges_.insert(ShapeEdgeId(shape.id(), edge_id)).second) {
     return;
   }
+  if (stats_) ++stats_->num_edges_tested;
   auto edge = shape.edge(edge_id);
   Distance distance = distance_limit_;
   if (target_->UpdateMinDistance(edge.v0, edge.v1, &distance)) {
@@ -851,13 +1208,48 @@ void S2ClosestEdgeQueryBase<Distance>::MaybeAddResult(
   }
 }
 
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::AddResult(const Result& result) {
+// Like MaybeAddResult(), but computes the distances to the given points of
+// an S2SoAPointVectorShape all at once.  The results are the same as calling
+// MaybeAddResult() for each edge in order.  Returns false (without doing
+// anything) if the target does not support batch distance computations.
+template <class Distance, class TargetType>
+bool S2ClosestEdgeQueryBase<Distance, TargetType>::MaybeAddPointResults(
+    const S2SoAPointVectorShape& shape, const std::vector<int32>& edge_ids) {
+  int n = edge_ids.size();
+  batch_distances_.resize(n);
+  if (!target_->GetPointDistances(shape.points(), edge_ids.data(), n,
+                                  batch_distances_.data())) {
+    return false;
+  }
+  if (stats_) stats_->num_edges_tested += n;
+  for (int i = 0; i < n; ++i) {
+    if (avoid_duplicates_ &&
+        !tested_edges_.insert(ShapeEdgeId(shape.id(), edge_ids[i])).second) {
+      continue;
+    }
+    if (batch_distances_[i] < distance_limit_) {
+      AddResult(Result(batch_distances_[i], shape.id(), edge_ids[i]));
+    }
+  }
+  return true;
+}
+
+template <class Distance, class TargetType>
+void
+S2ClosestEdgeQueryBase<Distance, TargetType>::AddResult(const Result& result) {
   if (options().max_results() == 1) {
     // Optimization for the common case where only the closest edge is wanted.
     result_singleton_ = result;
     distance_limit_ = result.distance() - options().max_error();
   } else if (options().max_results() == Options::kMaxMaxResults) {
+    if (visitor_ != nullptr) {
+      if (!(*visitor_)(result)) {
+        // Setting the distance limit to zero stops the query.
+        visitor_stopped_ = true;
+        distance_limit_ = Distance::Zero();
+      }
+      return;
+    }
     result_vector_.push_back(result);  // Sort/unique at end.
   } else {
     // Add this edge to result_set_.  Note that even if we already have enough
@@ -875,54 +1267,118 @@ void S2ClosestEdgeQueryBase<Distance>::AddResult(const Result& result) {
   }
 }
 
-// Return the number of edges in the given index cell.
-inline static int CountEdges(const S2ShapeIndexCell* cell) {
+template <class Distance, class TargetType>
+inline bool S2ClosestEdgeQueryBase<Distance, TargetType>::IncludesShape(
+    int shape_id) const {
+  const typename Options::ShapeFilter* filter = options().shape_filter();
+  return filter == nullptr || (*filter)(shape_id);
+}
+
+// Return the number of edges in the given index cell, not counting the edges
+// of shapes that are rejected by "filter" (if non-null).
+template <class ShapeFilter>
+inline static int CountEdges(const S2ShapeIndexCell* cell,
+                             const ShapeFilter* filter) {
   int count = 0;
   for (int s = 0; s < cell->num_clipped(); ++s) {
-    count += cell->clipped(s).num_edges();
+    const S2ClippedShape& clipped = cell->clipped(s);
+    if (filter && !(*filter)(clipped.shape_id())) continue;
+    count += clipped.num_edges();
   }
   return count;
 }
 
 // Process all the edges of the given index cell.
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::ProcessEdges(const QueueEntry& entry) {
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::ProcessEdges(
+    const QueueEntry& entry) {
   const S2ShapeIndexCell* index_cell = entry.index_cell;
+  if (stats_) ++stats_->num_cells_visited;
   for (int s = 0; s < index_cell->num_clipped(); ++s) {
     const S2ClippedShape& clipped = index_cell->clipped(s);
+    if (!IncludesShape(clipped.shape_id())) continue;
     const S2Shape* shape = index_->shape(clipped.shape_id());
+    if (shape->type_tag() == S2SoAPointVectorShape::kTypeTag) {
+      batch_edge_ids_.resize(clipped.num_edges());
+      for (int j = 0; j < clipped.num_edges(); ++j) {
+        batch_edge_ids_[j] = clipped.edge(j);
+      }
+      if (MaybeAddPointResults(
+              *down_cast<const S2SoAPointVectorShape*>(shape),
+              batch_edge_ids_)) {
+        continue;
+      }
+    }
+    // The distances to all the edges are computed in one call so that the
+    // target can process them efficiently.  Since the distances are computed
+    // using the current distance limit, any edge that is still a candidate
+    // after the limit has been reduced by AddResult() below is tested again
+    // so that the results are the same as calling MaybeAddResult() for each
+    // edge in turn.
+    batch_edge_ids_.clear();
+    batch_edges_.clear();
     for (int j = 0; j < clipped.num_edges(); ++j) {
-      MaybeAddResult(*shape, clipped.edge(j));
+      int edge_id = clipped.edge(j);
+      if (avoid_duplicates_ &&
+          !tested_edges_.insert(ShapeEdgeId(shape->id(), edge_id)).second) {
+        continue;
+      }
+      batch_edge_ids_.push_back(edge_id);
+      batch_edges_.push_back(shape->edge(edge_id));
+    }
+    const int n = batch_edges_.size();
+    if (stats_) stats_->num_edges_tested += n;
+    if (n > batch_updated_size_) {
+      batch_updated_.reset(new bool[n]);
+      batch_updated_size_ = n;
+    }
+    const Distance limit = distance_limit_;
+    batch_distances_.assign(n, limit);
+    target_->UpdateMinDistances(batch_edges_, batch_distances_.data(),
+                                batch_updated_.get());
+    for (int i = 0; i < n; ++i) {
+      if (!batch_updated_[i]) continue;
+      Distance distance = batch_distances_[i];
+      if (distance_limit_ < limit) {
+        distance = distance_limit_;
+        const S2Shape::Edge& edge = batch_edges_[i];
+        if (!target_->UpdateMinDistance(edge.v0, edge.v1, &distance)) {
+          continue;
+        }
+      }
+      AddResult(Result(distance, shape->id(), batch_edge_ids_[i]));
     }
   }
 }
 
-// Enqueue the given cell id.
-// REQUIRES: iter_ is positioned at a cell contained by "id".
-template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
-    S2CellId id) {
+// Enqueue the given cell.
+// REQUIRES: iter_ is positioned at a cell contained by "cell".
+template <class Distance, class TargetType>
+inline void S2ClosestEdgeQueryBase<Distance, TargetType>::ProcessOrEnqueue(
+    const S2Cell& cell) {
+  S2CellId id = cell.id();
   S2_DCHECK(id.contains(iter_.id()));
   if (iter_.id() == id) {
-    ProcessOrEnqueue(id, &iter_.cell());
+    ProcessOrEnqueue(id, &iter_.cell(), &cell);
   } else {
-    ProcessOrEnqueue(id, nullptr);
+    ProcessOrEnqueue(id, nullptr, &cell);
   }
 }
 
 // Add the given cell id to the queue.  "index_cell" is the corresponding
-// S2ShapeIndexCell, or nullptr if "id" is not an index cell.
+// S2ShapeIndexCell, or nullptr if "id" is not an index cell.  "cell" is the
+// S2Cell for "id" if the caller has already computed it, or nullptr.
 //
 // This version is called directly only by InitQueue().
-template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
-    S2CellId id, const S2ShapeIndexCell* index_cell) {
+template <class Distance, class TargetType>
+void S2ClosestEdgeQueryBase<Distance, TargetType>::ProcessOrEnqueue(
+    S2CellId id, const S2ShapeIndexCell* index_cell, const S2Cell* cell) {
   if (index_cell) {
     // If this index cell has only a few edges, then it is faster to check
     // them directly rather than computing the minimum distance to the S2Cell
     // and inserting it into the queue.
     static const int kMinEdgesToEnqueue = 10;
-    int num_edges = CountEdges(index_cell);
+    int num_edges = CountEdges(index_cell, options().shape_filter());
     if (num_edges == 0) return;
     if (num_edges < kMinEdgesToEnqueue) {
       // Set "distance" to zero to avoid the expense of computing it.
@@ -932,14 +1388,16 @@ void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
   }
   // Otherwise compute the minimum distance to any point in the cell and add
   // it to the priority queue.
-  S2Cell cell(id);
   Distance distance = distance_limit_;
-  if (!target_->UpdateMinDistance(cell, &distance)) return;
+  if (!target_->UpdateMinDistance(cell ? *cell : S2Cell(id), &distance)) {
+    return;
+  }
   if (use_conservative_cell_distance_) {
     // Ensure that "distance" is a lower bound on the true distance to the cell.
     distance = distance - options().max_error();  // operator-=() not defined.
   }
   queue_.push(QueueEntry(distance, id, index_cell));
+  if (stats_) stats_->UpdateQueueSize(queue_.size());
 }
 
 #endif  // S2_S2CLOSEST_EDGE_QUERY_BASE_H_
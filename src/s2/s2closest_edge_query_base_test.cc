@@ -56,4 +56,29 @@ TEST(S2ClosestEdgeQueryBase, MaxDistance) {
               1e-13);
 }
 
+TEST(S2ClosestEdgeQueryBase, StaticTargetType) {
+  // The target type can also be a template argument, in which case only
+  // that type of target is accepted.
+  using StaticQuery =
+      S2ClosestEdgeQueryBase<S2MaxDistance, FurthestPointTarget>;
+  auto index = s2textformat::MakeIndex("0:0 | 1:0 | 2:0 | 3:0 # 0:1, 0:2 #");
+  FurthestEdgeQuery query(index.get());
+  StaticQuery static_query(index.get());
+  FurthestEdgeQuery::Options options;
+  options.set_max_results(3);
+  StaticQuery::Options static_options;
+  static_options.set_max_results(3);
+  for (const char* str : {"4:0", "-1:1", "0:-2"}) {
+    FurthestPointTarget target(s2textformat::MakePoint(str));
+    auto expected = query.FindClosestEdges(&target, options);
+    auto actual = static_query.FindClosestEdges(&target, static_options);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].shape_id(), actual[i].shape_id());
+      EXPECT_EQ(expected[i].edge_id(), actual[i].edge_id());
+      EXPECT_EQ(expected[i].distance(), actual[i].distance());
+    }
+  }
+}
+
 }  // namespace
@@ -0,0 +1,127 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for S2ClosestEdgeQuery.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2closest_edge_query_base.h"
+#include "s2/s2loop.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using std::vector;
+
+namespace {
+
+void BM_FindClosestEdge(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(state.range(0));
+  S2Point center = S2Testing::RandomPoint();
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrameAt(center),
+                               S2Testing::KmToAngle(100));
+  MutableS2ShapeIndex index;
+  index.Add(absl::make_unique<S2Loop::Shape>(loop.get()));
+  index.ForceBuild();
+  S2Cap query_cap(center, S2Testing::KmToAngle(200));
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(S2Testing::SamplePoint(query_cap));
+  }
+  S2ClosestEdgeQuery query(&index);
+  int i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(targets[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdge(&target));
+    if (++i == targets.size()) i = 0;
+  }
+}
+BENCHMARK(BM_FindClosestEdge)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_IsDistanceLess(benchmark::State& state) {
+  S2Testing::rnd.Reset(2);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(10000);
+  S2Point center = S2Testing::RandomPoint();
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrameAt(center),
+                               S2Testing::KmToAngle(100));
+  MutableS2ShapeIndex index;
+  index.Add(absl::make_unique<S2Loop::Shape>(loop.get()));
+  index.ForceBuild();
+  S2Cap query_cap(center, S2Testing::KmToAngle(200));
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(S2Testing::SamplePoint(query_cap));
+  }
+  S2ClosestEdgeQuery query(&index);
+  S1ChordAngle limit(S2Testing::KmToAngle(1));
+  int i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(targets[i]);
+    benchmark::DoNotOptimize(query.IsDistanceLess(&target, limit));
+    if (++i == targets.size()) i = 0;
+  }
+}
+BENCHMARK(BM_IsDistanceLess);
+
+// Compares S2ClosestEdgeQueryBase with the default (virtual) target type
+// against a query whose target type is the final PointTarget class.
+template <class Query>
+void BenchmarkFindClosestEdgeBase(benchmark::State& state) {
+  S2Testing::rnd.Reset(3);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(state.range(0));
+  S2Point center = S2Testing::RandomPoint();
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrameAt(center),
+                               S2Testing::KmToAngle(100));
+  MutableS2ShapeIndex index;
+  index.Add(absl::make_unique<S2Loop::Shape>(loop.get()));
+  index.ForceBuild();
+  S2Cap query_cap(center, S2Testing::KmToAngle(200));
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(S2Testing::SamplePoint(query_cap));
+  }
+  Query query(&index);
+  typename Query::Options options;
+  options.set_max_results(state.range(1));
+  int i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(targets[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdges(&target, options));
+    if (++i == targets.size()) i = 0;
+  }
+}
+
+void BM_FindClosestEdgesDynamicTarget(benchmark::State& state) {
+  BenchmarkFindClosestEdgeBase<S2ClosestEdgeQueryBase<S2MinDistance>>(state);
+}
+BENCHMARK(BM_FindClosestEdgesDynamicTarget)
+    ->Args({100, 1})->Args({10000, 1})->Args({10000, 10});
+
+void BM_FindClosestEdgesStaticTarget(benchmark::State& state) {
+  BenchmarkFindClosestEdgeBase<S2ClosestEdgeQueryBase<
+      S2MinDistance, S2ClosestEdgeQuery::PointTarget>>(state);
+}
+BENCHMARK(BM_FindClosestEdgesStaticTarget)
+    ->Args({100, 1})->Args({10000, 1})->Args({10000, 10});
+
+}  // namespace
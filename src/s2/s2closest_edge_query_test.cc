@@ -17,11 +17,14 @@
 
 #include "s2/s2closest_edge_query.h"
 
+#include <algorithm>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
+#include "s2/base/mutex.h"
 #include "s2/encoded_s2shape_index.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
@@ -38,6 +41,7 @@
 #include "s2/s2shapeutil_coding.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using s2shapeutil::ShapeEdgeId;
@@ -146,6 +150,310 @@ TEST(S2ClosestEdgeQuery, TestReuseOfQuery) {
   EXPECT_EQ(results1.size(), results2.size());
 }
 
+TEST(S2ClosestEdgeQuery, BatchOfTargets) {
+  // Checks that processing a batch of targets gives the same results as
+  // processing each target separately.
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 10; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S1Angle::Degrees(5), 100)));
+  }
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(20));
+  vector<unique_ptr<S2ClosestEdgeQuery::PointTarget>> targets;
+  vector<S2ClosestEdgeQuery::Target*> target_ptrs;
+  for (int i = 0; i < 200; ++i) {
+    targets.push_back(make_unique<S2ClosestEdgeQuery::PointTarget>(
+        S2Testing::SamplePoint(cap)));
+    target_ptrs.push_back(targets.back().get());
+  }
+  for (int max_results : {1, 5}) {
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_results(max_results);
+    S2ClosestEdgeQuery batch_query(&index, options);
+    vector<vector<S2ClosestEdgeQuery::Result>> batch_results;
+    batch_query.FindClosestEdges(target_ptrs, &batch_results);
+    ASSERT_EQ(targets.size(), batch_results.size());
+    S2ClosestEdgeQuery query(&index, options);
+    for (int i = 0; i < targets.size(); ++i) {
+      auto expected = query.FindClosestEdges(targets[i].get());
+      ASSERT_EQ(expected.size(), batch_results[i].size());
+      for (int j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(expected[j].distance(), batch_results[i][j].distance());
+        EXPECT_EQ(expected[j].shape_id(), batch_results[i][j].shape_id());
+        EXPECT_EQ(expected[j].edge_id(), batch_results[i][j].edge_id());
+      }
+    }
+  }
+}
+
+TEST(S2ClosestEdgeQuery, ResumableQuery) {
+  // Checks that a resumable query gives the same results as FindClosestEdges()
+  // no matter how many cells are processed per step.
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 10; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S1Angle::Degrees(5), 100)));
+  }
+  for (int max_results : {1, 5, S2ClosestEdgeQuery::Options::kMaxMaxResults}) {
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_results(max_results);
+    if (max_results > 5) options.set_max_distance(S1Angle::Degrees(3));
+    S2ClosestEdgeQuery query(&index, options);
+    for (int max_cells : {1, 7, 1000}) {
+      S2ClosestEdgeQuery::PointTarget target(S2Testing::RandomPoint());
+      auto expected = query.FindClosestEdges(&target);
+      query.StartFindClosestEdges(&target);
+      while (!query.ContinueFindClosestEdges(max_cells)) continue;
+      vector<S2ClosestEdgeQuery::Result> actual;
+      query.FinishFindClosestEdges(&actual);
+      ASSERT_EQ(expected.size(), actual.size());
+      for (int j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(expected[j].distance(), actual[j].distance());
+        EXPECT_EQ(expected[j].shape_id(), actual[j].shape_id());
+        EXPECT_EQ(expected[j].edge_id(), actual[j].edge_id());
+      }
+    }
+  }
+
+  // A query can be abandoned, after which the object can be reused.
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(3);
+  S2ClosestEdgeQuery::PointTarget target(S2Testing::RandomPoint());
+  query.StartFindClosestEdges(&target);
+  EXPECT_FALSE(query.ContinueFindClosestEdges(1));
+  vector<S2ClosestEdgeQuery::Result> partial;
+  query.FinishFindClosestEdges(&partial);
+  EXPECT_LE(partial.size(), 3);
+  EXPECT_EQ(3, query.FindClosestEdges(&target).size());
+}
+
+TEST(S2ClosestEdgeQuery, VisitClosestEdges) {
+  // Checks that the visitor is called for the same edges that are returned
+  // by FindClosestEdges(), and that it can stop the query early.
+  MutableS2ShapeIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.2), 200)));
+  }
+  for (int max_results : {5, S2ClosestEdgeQuery::Options::kMaxMaxResults}) {
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_results(max_results);
+    options.set_max_distance(S1Angle::Degrees(0.3));
+    S2ClosestEdgeQuery query(&index, options);
+    for (int iter = 0; iter < 10; ++iter) {
+      S2ClosestEdgeQuery::PointTarget target(S2Testing::SamplePoint(cap));
+      auto expected = query.FindClosestEdges(&target);
+      vector<S2ClosestEdgeQuery::Result> actual;
+      EXPECT_TRUE(query.VisitClosestEdges(
+          &target, [&actual](const S2ClosestEdgeQuery::Result& result) {
+            actual.push_back(result);
+            return true;
+          }));
+      if (max_results == S2ClosestEdgeQuery::Options::kMaxMaxResults) {
+        std::sort(actual.begin(), actual.end());
+      }
+      EXPECT_TRUE(expected == actual);
+
+      // Stop after visiting a few edges.
+      if (expected.size() < 3) continue;
+      int num_visited = 0;
+      EXPECT_FALSE(query.VisitClosestEdges(
+          &target, [&num_visited](const S2ClosestEdgeQuery::Result& result) {
+            return ++num_visited < 3;
+          }));
+      EXPECT_EQ(3, num_visited);
+    }
+  }
+}
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+TEST(S2ClosestEdgeQuery, ParallelAllEdgesWithinDistance) {
+  // Checks that searching subtrees in parallel gives the same results as
+  // the serial algorithm.
+  MutableS2ShapeIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.2), 200)));
+  }
+  S2ClosestEdgeQuery::Options options;
+  options.set_max_distance(S1Angle::Degrees(0.3));
+  S2ClosestEdgeQuery query(&index, options);
+  ThreadPerTaskExecutor executor;
+  S2ClosestEdgeQuery::Options parallel_options = options;
+  parallel_options.set_executor(&executor);
+  S2ClosestEdgeQuery parallel_query(&index, parallel_options);
+  for (int iter = 0; iter < 20; ++iter) {
+    S2ClosestEdgeQuery::PointTarget target(S2Testing::SamplePoint(cap));
+    auto expected = query.FindClosestEdges(&target);
+    auto actual = parallel_query.FindClosestEdges(&target);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].distance(), actual[j].distance());
+      EXPECT_EQ(expected[j].shape_id(), actual[j].shape_id());
+      EXPECT_EQ(expected[j].edge_id(), actual[j].edge_id());
+    }
+  }
+}
+
+TEST(S2ClosestEdgeQuery, Stats) {
+  MutableS2ShapeIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.2), 200)));
+  }
+  S2QueryStats stats[3];
+  ThreadPerTaskExecutor executor;
+  vector<vector<S2ClosestEdgeQuery::Result>> results(3);
+  for (int i = 0; i < 3; ++i) {
+    // The queries use the optimized, brute force, and parallel algorithms.
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_distance(S1Angle::Degrees(0.3));
+    options.set_use_brute_force(i == 1);
+    if (i == 2) options.set_executor(&executor);
+    options.set_stats(&stats[i]);
+    S2ClosestEdgeQuery query(&index, options);
+    S2ClosestEdgeQuery::PointTarget target(cap.center());
+    results[i] = query.FindClosestEdges(&target);
+    query.FindClosestEdges(&target);
+  }
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(2, stats[i].num_queries);
+    EXPECT_EQ(results[0].size(), results[i].size());
+  }
+  EXPECT_EQ(0, stats[0].num_brute_force_queries);
+  EXPECT_GT(stats[0].num_cells_visited, 0);
+  EXPECT_GT(stats[0].max_queue_size, 0);
+  EXPECT_LT(stats[0].num_edges_tested, 2 * 20 * 200);
+
+  EXPECT_EQ(2, stats[1].num_brute_force_queries);
+  EXPECT_EQ(0, stats[1].num_cells_visited);
+  EXPECT_EQ(2 * 20 * 200, stats[1].num_edges_tested);
+
+  // The parallel subtree searches are merged into the caller's statistics.
+  EXPECT_EQ(0, stats[2].num_brute_force_queries);
+  EXPECT_GT(stats[2].num_cells_visited, 0);
+  EXPECT_GT(stats[2].num_edges_tested, 0);
+
+  stats[0].Add(stats[1]);
+  EXPECT_EQ(4, stats[0].num_queries);
+  stats[0].Clear();
+  EXPECT_EQ(0, stats[0].num_queries);
+  EXPECT_EQ(0, stats[0].max_queue_size);
+}
+
+TEST(S2ClosestEdgeQuery, ShapeFilter) {
+  // Checks that filtering shapes gives the same results as discarding the
+  // results for rejected shapes afterwards, while testing fewer edges.
+  MutableS2ShapeIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.2), 200)));
+  }
+  vector<bool> included(index.num_shape_ids());
+  for (int i = 0; i < included.size(); ++i) included[i] = (i % 4 == 0);
+  ThreadPerTaskExecutor executor;
+  for (int i = 0; i < 3; ++i) {
+    // The queries use the optimized, brute force, and parallel algorithms.
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_distance(S1Angle::Degrees(0.3));
+    options.set_use_brute_force(i == 1);
+    if (i == 2) options.set_executor(&executor);
+    S2QueryStats stats, filtered_stats;
+    S2ClosestEdgeQuery::Options filtered_options = options;
+    options.set_stats(&stats);
+    filtered_options.set_stats(&filtered_stats);
+    S2ClosestEdgeQuery::Options::ShapeFilter filter =
+        [&included](int shape_id) { return included[shape_id]; };
+    filtered_options.set_shape_filter(&filter);
+    S2ClosestEdgeQuery query(&index, options);
+    S2ClosestEdgeQuery filtered_query(&index, filtered_options);
+    for (int iter = 0; iter < 10; ++iter) {
+      S2ClosestEdgeQuery::PointTarget target(S2Testing::SamplePoint(cap));
+      vector<S2ClosestEdgeQuery::Result> expected;
+      for (const auto& result : query.FindClosestEdges(&target)) {
+        if (included[result.shape_id()]) expected.push_back(result);
+      }
+      auto actual = filtered_query.FindClosestEdges(&target);
+      ASSERT_EQ(expected.size(), actual.size());
+      for (int j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(expected[j].distance(), actual[j].distance());
+        EXPECT_EQ(expected[j].shape_id(), actual[j].shape_id());
+        EXPECT_EQ(expected[j].edge_id(), actual[j].edge_id());
+      }
+    }
+    EXPECT_LT(filtered_stats.num_edges_tested, stats.num_edges_tested);
+  }
+}
+
+TEST(S2ClosestEdgeQuery, ShapeFilterExcludesInteriors) {
+  auto index = MakeIndexOrDie(
+      "# # 0:0, 0:5, 5:5, 5:0 | 0:10, 0:15, 5:15, 5:10");
+  S2ClosestEdgeQuery::Options options;
+  options.set_include_interiors(true);
+  options.set_max_distance(S1Angle::Degrees(1));
+  S2ClosestEdgeQuery::Options::ShapeFilter filter = [](int shape_id) {
+    return shape_id != 0;
+  };
+  options.set_shape_filter(&filter);
+  S2ClosestEdgeQuery query(index.get(), options);
+  S2ClosestEdgeQuery::PointTarget target(MakePointOrDie("2:2"));
+  EXPECT_TRUE(query.FindClosestEdges(&target).empty());
+  S2ClosestEdgeQuery::PointTarget target2(MakePointOrDie("2:12"));
+  auto results = query.FindClosestEdges(&target2);
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ(1, results[0].shape_id());
+  EXPECT_TRUE(results[0].is_interior());
+}
+
+TEST(S2ClosestEdgeQuery, SoAPointVectorShapeMatchesPointVectorShape) {
+  // Checks that the batched distance computation used for
+  // S2SoAPointVectorShape gives exactly the same results as the generic
+  // code used for S2PointVectorShape.
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  vector<S2Point> points;
+  for (int i = 0; i < 1000; ++i) points.push_back(S2Testing::SamplePoint(cap));
+  MutableS2ShapeIndex index, soa_index;
+  index.Add(make_unique<S2PointVectorShape>(points));
+  soa_index.Add(make_unique<S2SoAPointVectorShape>(points));
+  for (bool brute_force : {false, true}) {
+    S2ClosestEdgeQuery::Options options;
+    options.set_max_results(10);
+    options.set_use_brute_force(brute_force);
+    S2ClosestEdgeQuery query(&index, options), soa_query(&soa_index, options);
+    for (int iter = 0; iter < 20; ++iter) {
+      S2ClosestEdgeQuery::PointTarget target(S2Testing::SamplePoint(cap));
+      auto expected = query.FindClosestEdges(&target);
+      auto actual = soa_query.FindClosestEdges(&target);
+      ASSERT_EQ(expected.size(), actual.size());
+      for (int j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(expected[j].distance(), actual[j].distance());
+        EXPECT_EQ(expected[j].edge_id(), actual[j].edge_id());
+      }
+    }
+  }
+}
+
 TEST(S2ClosestEdgeQuery, TargetPointInsideIndexedPolygon) {
   // Tests a target point in the interior of an indexed polygon.
   // (The index also includes a polyline loop with no interior.)
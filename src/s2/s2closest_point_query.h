@@ -85,6 +85,7 @@ class S2ClosestPointQueryOptions :
   using Base::set_max_results;
   using Base::set_region;
   using Base::set_use_brute_force;
+  using Base::set_max_cells_visited;
 };
 
 // S2ClosestPointQueryTarget represents the geometry to which the distance is
@@ -197,18 +198,25 @@ class S2ClosestPointQueryShapeIndexTarget final :
 //
 // The implementation is designed to be fast for both small and large
 // point sets.
-template <class Data>
+//
+// The optional IndexType template argument allows indexes other than
+// S2PointIndex to be searched, e.g. an EncodedS2PointIndex<Data> that reads
+// the output of S2PointIndex::Encode() in place:
+//
+//   S2ClosestPointQuery<int, EncodedS2PointIndex<int>> query(&encoded_index);
+template <class Data, class IndexType = S2PointIndex<Data>>
 class S2ClosestPointQuery {
  public:
   // See S2ClosestPointQueryBase for full documentation.
 
-  using Index = S2PointIndex<Data>;
-  using PointData = typename Index::PointData;
+  using Index = IndexType;
+  using PointData = typename S2PointIndex<Data>::PointData;
 
   // S2MinDistance is a thin wrapper around S1ChordAngle that implements the
   // Distance concept required by S2ClosestPointQueryBase.
   using Distance = S2MinDistance;
-  using Base = S2ClosestPointQueryBase<Distance, Data>;
+  using Base = S2ClosestPointQueryBase<Distance, Data,
+                                       S2DistanceTarget<Distance>, IndexType>;
 
   // Each "Result" object represents a closest point.  Here are its main
   // methods (see S2ClosestPointQueryBase::Result for details):
@@ -306,6 +314,13 @@ class S2ClosestPointQuery {
   // are guaranteed to not intersect after snapping.
   bool IsConservativeDistanceLessOrEqual(Target* target, S1ChordAngle limit);
 
+  // Returns a lower bound on the distance to any point that was not examined
+  // by the last query, or Infinity() if the query was exact (see
+  // Options::set_max_cells_visited).
+  S1ChordAngle last_unvisited_distance() const {
+    return base_.last_unvisited_distance();
+  }
+
  private:
   Options options_;
   Base base_;
@@ -358,81 +373,82 @@ inline S2ClosestPointQueryShapeIndexTarget::S2ClosestPointQueryShapeIndexTarget(
     : S2MinDistanceShapeIndexTarget(index) {
 }
 
-template <class Data>
-inline S2ClosestPointQuery<Data>::S2ClosestPointQuery(const Index* index,
-                                                      const Options& options) {
+template <class Data, class IndexType>
+inline S2ClosestPointQuery<Data, IndexType>::S2ClosestPointQuery(
+    const Index* index, const Options& options) {
   Init(index, options);
 }
 
-template <class Data>
-S2ClosestPointQuery<Data>::S2ClosestPointQuery() {
+template <class Data, class IndexType>
+S2ClosestPointQuery<Data, IndexType>::S2ClosestPointQuery() {
   // Prevent inline constructor bloat by defining here.
 }
 
-template <class Data>
-S2ClosestPointQuery<Data>::~S2ClosestPointQuery() {
+template <class Data, class IndexType>
+S2ClosestPointQuery<Data, IndexType>::~S2ClosestPointQuery() {
   // Prevent inline destructor bloat by defining here.
 }
 
-template <class Data>
-void S2ClosestPointQuery<Data>::Init(const Index* index,
-                                     const Options& options) {
+template <class Data, class IndexType>
+void S2ClosestPointQuery<Data, IndexType>::Init(const Index* index,
+                                                const Options& options) {
   options_ = options;
   base_.Init(index);
 }
 
-template <class Data>
-inline void S2ClosestPointQuery<Data>::ReInit() {
+template <class Data, class IndexType>
+inline void S2ClosestPointQuery<Data, IndexType>::ReInit() {
   base_.ReInit();
 }
 
-template <class Data>
-inline const S2PointIndex<Data>& S2ClosestPointQuery<Data>::index() const {
+template <class Data, class IndexType>
+inline const IndexType& S2ClosestPointQuery<Data, IndexType>::index() const {
   return base_.index();
 }
 
-template <class Data>
-inline const S2ClosestPointQueryOptions& S2ClosestPointQuery<Data>::options()
-    const {
+template <class Data, class IndexType>
+inline const S2ClosestPointQueryOptions&
+S2ClosestPointQuery<Data, IndexType>::options() const {
   return options_;
 }
 
-template <class Data>
+template <class Data, class IndexType>
 inline S2ClosestPointQueryOptions*
-S2ClosestPointQuery<Data>::mutable_options() {
+S2ClosestPointQuery<Data, IndexType>::mutable_options() {
   return &options_;
 }
 
-template <class Data>
-inline std::vector<typename S2ClosestPointQuery<Data>::Result>
-S2ClosestPointQuery<Data>::FindClosestPoints(Target* target) {
+template <class Data, class IndexType>
+inline std::vector<typename S2ClosestPointQuery<Data, IndexType>::Result>
+S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(Target* target) {
   return base_.FindClosestPoints(target, options_);
 }
 
-template <class Data>
-inline void S2ClosestPointQuery<Data>::FindClosestPoints(
+template <class Data, class IndexType>
+inline void S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(
     Target* target, std::vector<Result>* results) {
   base_.FindClosestPoints(target, options_, results);
 }
 
-template <class Data>
-inline typename S2ClosestPointQuery<Data>::Result
-S2ClosestPointQuery<Data>::FindClosestPoint(Target* target) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+template <class Data, class IndexType>
+inline typename S2ClosestPointQuery<Data, IndexType>::Result
+S2ClosestPointQuery<Data, IndexType>::FindClosestPoint(Target* target) {
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   return base_.FindClosestPoint(target, tmp_options);
 }
 
-template <class Data>
-inline S1ChordAngle S2ClosestPointQuery<Data>::GetDistance(Target* target) {
+template <class Data, class IndexType>
+inline S1ChordAngle S2ClosestPointQuery<Data, IndexType>::GetDistance(
+    Target* target) {
   return FindClosestPoint(target).distance();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsDistanceLess(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsDistanceLess(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_max_distance(limit);
@@ -440,10 +456,10 @@ bool S2ClosestPointQuery<Data>::IsDistanceLess(
   return !base_.FindClosestPoint(target, tmp_options).is_empty();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsDistanceLessOrEqual(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_inclusive_max_distance(limit);
@@ -451,10 +467,10 @@ bool S2ClosestPointQuery<Data>::IsDistanceLessOrEqual(
   return !base_.FindClosestPoint(target, tmp_options).is_empty();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsConservativeDistanceLessOrEqual(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsConservativeDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_conservative_max_distance(limit);
@@ -20,6 +20,8 @@
 #ifndef S2_S2CLOSEST_POINT_QUERY_BASE_H_
 #define S2_S2CLOSEST_POINT_QUERY_BASE_H_
 
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 #include "s2/base/logging.h"
@@ -31,6 +33,7 @@
 #include "s2/s2distance_target.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2point_index.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2region_coverer.h"
 
 // Options that control the set of points returned.  Note that by default
@@ -111,12 +114,37 @@ class S2ClosestPointQueryBaseOptions {
   bool use_brute_force() const;
   void set_use_brute_force(bool use_brute_force);
 
+  // Specifies the maximum number of index cells that are expanded from the
+  // priority queue before the search stops, which makes the query
+  // approximate.  The cells are expanded in increasing order of distance, so
+  // the search is truncated far from the target, and any points that were
+  // not examined are at least last_unvisited_distance() away (see
+  // S2ClosestPointQueryBase).  This bounds the cost of queries whose
+  // max_distance() is large or unset, at the expense of recall.  Note that
+  // max_error() can also be used to stop the search early, using an
+  // absolute error bound rather than a budget.
+  //
+  // REQUIRES: max_cells_visited >= 1
+  // DEFAULT: kMaxMaxCellsVisited (i.e., the search is exact)
+  int max_cells_visited() const;
+  void set_max_cells_visited(int max_cells_visited);
+  static constexpr int kMaxMaxCellsVisited = std::numeric_limits<int>::max();
+
+  // If specified, the statistics of every query are added to the given
+  // object (see s2query_stats.h).
+  //
+  // DEFAULT: nullptr
+  S2QueryStats* stats() const;
+  void set_stats(S2QueryStats* stats);
+
  private:
   Distance max_distance_ = Distance::Infinity();
   Delta max_error_ = Delta::Zero();
   const S2Region* region_ = nullptr;
   int max_results_ = kMaxMaxResults;
+  int max_cells_visited_ = kMaxMaxCellsVisited;
   bool use_brute_force_ = false;
+  S2QueryStats* stats_ = nullptr;
 };
 
 // S2ClosestPointQueryBase is a templatized class for finding the closest
@@ -141,12 +169,29 @@ class S2ClosestPointQueryBaseOptions {
 // used as long as it implements the Distance concept described in
 // s2distance_targets.h.  For example this can be used to measure maximum
 // distances, to get more accuracy, or to measure non-spheroidal distances.
-template <class Distance, class Data>
+//
+// The optional TargetType template argument is the type of target used by
+// every query (the default accepts any S2DistanceTarget<Distance>).  When it
+// is a "final" class such as S2ClosestPointQueryPointTarget, the compiler
+// can call its distance methods directly (and inline them) rather than going
+// through S2DistanceTarget's virtual methods.  This is most useful when many
+// similar queries are made against small indexes, e.g. k-nearest-neighbor
+// lookups of query points.
+//
+// The optional IndexType template argument is the type of index that is
+// searched.  It defaults to S2PointIndex<Data>, but any class that provides
+// the same num_points() and Iterator interface and stores the same PointData
+// type may be used instead (e.g., EncodedS2PointIndex<Data>).
+template <class Distance, class Data,
+          class TargetType = S2DistanceTarget<Distance>,
+          class IndexType = S2PointIndex<Data>>
 class S2ClosestPointQueryBase {
  public:
   using Delta = typename Distance::Delta;
-  using Index = S2PointIndex<Data>;
-  using PointData = typename Index::PointData;
+  using Index = IndexType;
+  using PointData = typename S2PointIndex<Data>::PointData;
+  static_assert(std::is_same<typename Index::PointData, PointData>::value,
+                "IndexType must store S2PointIndex<Data>::PointData values");
   using Options = S2ClosestPointQueryBaseOptions<Distance>;
 
   // The Target class represents the geometry to which the distance is
@@ -156,7 +201,9 @@ class S2ClosestPointQueryBase {
   //
   // Implementations do *not* need to be thread-safe.  They may cache data or
   // allocate temporary data structures in order to improve performance.
-  using Target = S2DistanceTarget<Distance>;
+  using Target = TargetType;
+  static_assert(std::is_base_of<S2DistanceTarget<Distance>, Target>::value,
+                "TargetType must be a subtype of S2DistanceTarget<Distance>");
 
   // Each "Result" object represents a closest point.
   class Result {
@@ -243,6 +290,16 @@ class S2ClosestPointQueryBase {
   // REQUIRES: options.max_results() == 1
   Result FindClosestPoint(Target* target, const Options& options);
 
+  // Returns a lower bound on the distance from the target of the last query
+  // to any point that the query did not examine, or Infinity() if the search
+  // was not truncated by options.max_cells_visited().  In other words, the
+  // returned results include every qualifying point closer than this
+  // distance (up to max_results() of them).  For example, if the distance of
+  // the k-th result is at most this bound then the results are exact, and
+  // otherwise the k-th result distance may be reduced by at most
+  // (k-th result distance - bound) in an exact search.
+  Distance last_unvisited_distance() const { return last_unvisited_distance_; }
+
  private:
   using Iterator = typename Index::Iterator;
 
@@ -254,12 +311,17 @@ class S2ClosestPointQueryBase {
   void InitCovering();
   void AddInitialRange(S2CellId first_id, S2CellId last_id);
   void MaybeAddResult(const PointData* point_data);
-  bool ProcessOrEnqueue(S2CellId id, Iterator* iter, bool seek);
+  bool ProcessOrEnqueue(S2CellId id, Iterator* iter, bool seek,
+                        S2ChildCellGenerator* parent = nullptr);
 
   const Index* index_;
   const Options* options_;
   Target* target_;
 
+  // The statistics of the current query are added to this object (if not
+  // nullptr).
+  S2QueryStats* stats_ = nullptr;
+
   // True if max_error() must be subtracted from priority queue cell distances
   // in order to ensure that such distances are measured conservatively.  This
   // is true only if the target takes advantage of max_error() in order to
@@ -280,6 +342,9 @@ class S2ClosestPointQueryBase {
   // but it can also be updated by the algorithm (see MaybeAddResult).
   Distance distance_limit_;
 
+  // See last_unvisited_distance().
+  Distance last_unvisited_distance_ = Distance::Infinity();
+
   // The current result set is stored in one of three ways:
   //
   //  - If max_results() == 1, the best result is kept in result_singleton_.
@@ -394,61 +459,89 @@ inline void S2ClosestPointQueryBaseOptions<Distance>::set_use_brute_force(
   use_brute_force_ = use_brute_force;
 }
 
-template <class Distance, class Data>
-S2ClosestPointQueryBase<Distance, Data>::S2ClosestPointQueryBase() {
+template <class Distance>
+inline int S2ClosestPointQueryBaseOptions<Distance>::max_cells_visited()
+    const {
+  return max_cells_visited_;
+}
+
+template <class Distance>
+inline void S2ClosestPointQueryBaseOptions<Distance>::set_max_cells_visited(
+    int max_cells_visited) {
+  S2_DCHECK_GE(max_cells_visited, 1);
+  max_cells_visited_ = max_cells_visited;
+}
+
+template <class Distance>
+inline S2QueryStats* S2ClosestPointQueryBaseOptions<Distance>::stats() const {
+  return stats_;
+}
+
+template <class Distance>
+inline void S2ClosestPointQueryBaseOptions<Distance>::set_stats(
+    S2QueryStats* stats) {
+  stats_ = stats;
+}
+
+template <class Distance, class Data, class TargetType, class IndexType>
+S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+S2ClosestPointQueryBase() {
 }
 
-template <class Distance, class Data>
-S2ClosestPointQueryBase<Distance, Data>::~S2ClosestPointQueryBase() {
+template <class Distance, class Data, class TargetType, class IndexType>
+S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+~S2ClosestPointQueryBase() {
   // Prevent inline destructor bloat by providing a definition.
 }
 
-template <class Distance, class Data>
-inline S2ClosestPointQueryBase<Distance, Data>::S2ClosestPointQueryBase(
-    const S2PointIndex<Data>* index) : S2ClosestPointQueryBase() {
+template <class Distance, class Data, class TargetType, class IndexType>
+inline S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+S2ClosestPointQueryBase(const IndexType* index) : S2ClosestPointQueryBase() {
   Init(index);
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::Init(
-    const S2PointIndex<Data>* index) {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::Init(
+    const IndexType* index) {
   index_ = index;
   ReInit();
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::ReInit() {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::ReInit() {
   iter_.Init(index_);
   index_covering_.clear();
 }
 
-template <class Distance, class Data>
-inline const S2PointIndex<Data>&
-S2ClosestPointQueryBase<Distance, Data>::index() const {
+template <class Distance, class Data, class TargetType, class IndexType>
+inline const IndexType&
+S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::index() const {
   return *index_;
 }
 
-template <class Distance, class Data>
-inline std::vector<typename S2ClosestPointQueryBase<Distance, Data>::Result>
-S2ClosestPointQueryBase<Distance, Data>::FindClosestPoints(
-    Target* target, const Options& options) {
+template <class Distance, class Data, class TargetType, class IndexType>
+inline std::vector<typename S2ClosestPointQueryBase<
+    Distance, Data, TargetType, IndexType>::Result>
+S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPoints(Target* target, const Options& options) {
   std::vector<Result> results;
   FindClosestPoints(target, options, &results);
   return results;
 }
 
-template <class Distance, class Data>
-typename S2ClosestPointQueryBase<Distance, Data>::Result
-S2ClosestPointQueryBase<Distance, Data>::FindClosestPoint(
-    Target* target, const Options& options) {
+template <class Distance, class Data, class TargetType, class IndexType>
+typename S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::Result
+S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPoint(Target* target, const Options& options) {
   S2_DCHECK_EQ(options.max_results(), 1);
   FindClosestPointsInternal(target, options);
   return result_singleton_;
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::FindClosestPoints(
-    Target* target, const Options& options, std::vector<Result>* results) {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPoints(Target* target, const Options& options,
+                  std::vector<Result>* results) {
   FindClosestPointsInternal(target, options);
   results->clear();
   if (options.max_results() == 1) {
@@ -471,13 +564,16 @@ void S2ClosestPointQueryBase<Distance, Data>::FindClosestPoints(
   }
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::FindClosestPointsInternal(
-    Target* target, const Options& options) {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPointsInternal(Target* target, const Options& options) {
   target_ = target;
   options_ = &options;
+  stats_ = options.stats();
+  if (stats_) ++stats_->num_queries;
 
   distance_limit_ = options.max_distance();
+  last_unvisited_distance_ = Distance::Infinity();
   result_singleton_ = Result();
   S2_DCHECK(result_vector_.empty());
   S2_DCHECK(result_set_.empty());
@@ -526,23 +622,26 @@ void S2ClosestPointQueryBase<Distance, Data>::FindClosestPointsInternal(
   // duplicate points in the results.
   if (options.use_brute_force() ||
       index_->num_points() <= target_->max_brute_force_index_size()) {
+    if (stats_) ++stats_->num_brute_force_queries;
     FindClosestPointsBruteForce();
   } else {
     FindClosestPointsOptimized();
   }
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::FindClosestPointsBruteForce() {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPointsBruteForce() {
   for (iter_.Begin(); !iter_.done(); iter_.Next()) {
     MaybeAddResult(&iter_.point_data());
   }
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::FindClosestPointsOptimized() {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+FindClosestPointsOptimized() {
   InitQueue();
-  while (!queue_.empty()) {
+  for (int num_visited = 0; !queue_.empty(); ++num_visited) {
     // We need to copy the top entry before removing it, and we need to remove
     // it before adding any new entries to the queue.
     QueueEntry entry = queue_.top();
@@ -554,19 +653,28 @@ void S2ClosestPointQueryBase<Distance, Data>::FindClosestPointsOptimized() {
       queue_ = CellQueue();  // Clear any remaining entries.
       break;
     }
+    if (num_visited == options().max_cells_visited()) {
+      // The remaining queue entries are at least this far away, and they
+      // contain all the points that have not been examined.
+      last_unvisited_distance_ = distance;
+      queue_ = CellQueue();
+      break;
+    }
     S2CellId child = entry.id.child_begin();
     // We already know that it has too many points, so process its children.
     // Each child may either be processed directly or enqueued again.  The
     // loop is optimized so that we don't seek unnecessarily.
     bool seek = true;
+    S2ChildCellGenerator children(entry.id);
     for (int i = 0; i < 4; ++i, child = child.next()) {
-      seek = ProcessOrEnqueue(child, &iter_, seek);
+      seek = ProcessOrEnqueue(child, &iter_, seek, &children);
     }
   }
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::InitQueue() {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+InitQueue() {
   S2_DCHECK(queue_.empty());
 
   // Optimization: rather than starting with the entire index, see if we can
@@ -627,8 +735,9 @@ void S2ClosestPointQueryBase<Distance, Data>::InitQueue() {
   }
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::InitCovering() {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+InitCovering() {
   // Compute the "index covering", which is a small number of S2CellIds that
   // cover the indexed points.  There are two cases:
   //
@@ -678,18 +787,19 @@ void S2ClosestPointQueryBase<Distance, Data>::InitCovering() {
 // Adds a cell to index_covering_ that covers the given inclusive range.
 //
 // REQUIRES: "first" and "last" have a common ancestor.
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::AddInitialRange(
-    S2CellId first_id, S2CellId last_id) {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+AddInitialRange(S2CellId first_id, S2CellId last_id) {
   // Add the lowest common ancestor of the given range.
   int level = first_id.GetCommonAncestorLevel(last_id);
   S2_DCHECK_GE(level, 0);
   index_covering_.push_back(first_id.parent(level));
 }
 
-template <class Distance, class Data>
-void S2ClosestPointQueryBase<Distance, Data>::MaybeAddResult(
-    const PointData* point_data) {
+template <class Distance, class Data, class TargetType, class IndexType>
+void S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+MaybeAddResult(const PointData* point_data) {
+  if (stats_) ++stats_->num_edges_tested;
   Distance distance = distance_limit_;
   if (!target_->UpdateMinDistance(point_data->point(), &distance)) return;
 
@@ -725,9 +835,14 @@ void S2ClosestPointQueryBase<Distance, Data>::MaybeAddResult(
 // Returns "true" if the cell was added to the queue, and "false" if it was
 // processed immediately, in which case "iter" is left positioned at the next
 // cell in S2CellId order.
-template <class Distance, class Data>
-bool S2ClosestPointQueryBase<Distance, Data>::ProcessOrEnqueue(
-    S2CellId id, Iterator* iter, bool seek) {
+//
+// If "parent" is not nullptr, it generates the children of id.parent() and
+// is used to construct the S2Cell for "id" if the cell needs to be enqueued.
+template <class Distance, class Data, class TargetType, class IndexType>
+bool S2ClosestPointQueryBase<Distance, Data, TargetType, IndexType>::
+ProcessOrEnqueue(S2CellId id, Iterator* iter, bool seek,
+                 S2ChildCellGenerator* parent) {
+  if (stats_) ++stats_->num_cells_visited;
   if (seek) iter->Seek(id.range_min());
   if (id.is_leaf()) {
     // Leaf cells can't be subdivided.
@@ -741,7 +856,8 @@ bool S2ClosestPointQueryBase<Distance, Data>::ProcessOrEnqueue(
   for (; !iter->done() && iter->id() <= last; iter->Next()) {
     if (num_points == kMinPointsToEnqueue - 1) {
       // This cell has too many points (including this one), so enqueue it.
-      S2Cell cell(id);
+      S2Cell cell =
+        parent ? parent->child(id.child_position()) : S2Cell(id);
       Distance distance = distance_limit_;
       // We check "region_" second because it may be relatively expensive.
       if (target_->UpdateMinDistance(cell, &distance) &&
@@ -751,6 +867,7 @@ bool S2ClosestPointQueryBase<Distance, Data>::ProcessOrEnqueue(
           distance = distance - options().max_error();
         }
         queue_.push(QueueEntry(distance, id));
+        if (stats_) stats_->UpdateQueueSize(queue_.size());
       }
       return true;  // Seek to next child.
     }
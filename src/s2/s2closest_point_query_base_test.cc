@@ -60,4 +60,30 @@ TEST(S2ClosestPointQueryBase, MaxDistance) {
               1e-13);
 }
 
+TEST(S2ClosestPointQueryBase, StaticTargetType) {
+  // The target type can also be a template argument, in which case only
+  // that type of target is accepted.
+  using StaticQuery =
+      S2ClosestPointQueryBase<S2MaxDistance, int, FurthestPointTarget>;
+  S2PointIndex<int> index;
+  auto points = s2textformat::ParsePointsOrDie("0:0, 1:0, 2:0, 3:0, 0:1");
+  for (int i = 0; i < points.size(); ++i) {
+    index.Add(points[i], i);
+  }
+  FurthestPointQuery<int> query(&index);
+  StaticQuery static_query(&index);
+  StaticQuery::Options options;
+  options.set_max_results(3);
+  for (const char* str : {"4:0", "-1:1", "0:-2"}) {
+    FurthestPointTarget target(s2textformat::MakePoint(str));
+    auto expected = query.FindClosestPoints(&target, options);
+    auto actual = static_query.FindClosestPoints(&target, options);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].data(), actual[i].data());
+      EXPECT_EQ(expected[i].distance(), actual[i].distance());
+    }
+  }
+}
+
 }  // namespace
@@ -0,0 +1,75 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Benchmarks for S2ClosestPointQuery.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2closest_point_query_base.h"
+#include "s2/s2point_index.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+// Finds the k nearest neighbors of random query points among "num_points"
+// indexed points (state.range(0)), where k = state.range(1).  This compares
+// S2ClosestPointQueryBase with the default (virtual) target type against a
+// query whose target type is the final S2ClosestPointQueryPointTarget class.
+template <class Query>
+void BenchmarkFindClosestPoints(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Point center = S2Testing::RandomPoint();
+  S2Cap index_cap(center, S2Testing::KmToAngle(100));
+  S2PointIndex<int> index;
+  for (int i = 0; i < state.range(0); ++i) {
+    index.Add(S2Testing::SamplePoint(index_cap), i);
+  }
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(S2Testing::SamplePoint(index_cap));
+  }
+  Query query(&index);
+  typename Query::Options options;
+  options.set_max_results(state.range(1));
+  int i = 0;
+  for (auto _ : state) {
+    S2ClosestPointQueryPointTarget target(targets[i]);
+    benchmark::DoNotOptimize(query.FindClosestPoints(&target, options));
+    if (++i == targets.size()) i = 0;
+  }
+}
+
+void BM_FindClosestPointsDynamicTarget(benchmark::State& state) {
+  BenchmarkFindClosestPoints<S2ClosestPointQueryBase<S2MinDistance, int>>(
+      state);
+}
+BENCHMARK(BM_FindClosestPointsDynamicTarget)
+    ->Args({100, 1})->Args({10000, 1})->Args({10000, 10});
+
+void BM_FindClosestPointsStaticTarget(benchmark::State& state) {
+  BenchmarkFindClosestPoints<S2ClosestPointQueryBase<
+      S2MinDistance, int, S2ClosestPointQueryPointTarget>>(state);
+}
+BENCHMARK(BM_FindClosestPointsStaticTarget)
+    ->Args({100, 1})->Args({10000, 1})->Args({10000, 10});
+
+}  // namespace
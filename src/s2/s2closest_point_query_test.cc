@@ -123,6 +123,44 @@ struct GridPointIndexFactory : public PointIndexFactory {
 };
 
 // The approximate radius of S2Cap from which query points are chosen.
+TEST(S2ClosestPointQuery, MaxCellsVisited) {
+  TestIndex index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  for (int i = 0; i < 10000; ++i) {
+    index.Add(S2Testing::SamplePoint(cap), i);
+  }
+  TestQuery exact_query(&index);
+  exact_query.mutable_options()->set_max_results(10);
+  TestQuery query(&index);
+  query.mutable_options()->set_max_results(10);
+  int num_truncated = 0;
+  for (int iter = 0; iter < 50; ++iter) {
+    query.mutable_options()->set_max_cells_visited(1 + iter % 5);
+    TestQuery::PointTarget target(S2Testing::SamplePoint(cap));
+    auto expected = exact_query.FindClosestPoints(&target);
+    EXPECT_EQ(S1ChordAngle::Infinity(), exact_query.last_unvisited_distance());
+    auto actual = query.FindClosestPoints(&target);
+    ASSERT_LE(actual.size(), expected.size());
+    S1ChordAngle bound = query.last_unvisited_distance();
+    if (bound < S1ChordAngle::Infinity()) {
+      ++num_truncated;
+    } else {
+      EXPECT_EQ(expected.size(), actual.size());
+    }
+    // Every point closer than the bound must have been found.
+    for (int i = 0; i < expected.size(); ++i) {
+      if (i < actual.size()) {
+        EXPECT_LE(expected[i].distance(), actual[i].distance());
+      }
+      if (expected[i].distance() < bound) {
+        ASSERT_LT(i, actual.size());
+        EXPECT_EQ(expected[i].distance(), actual[i].distance());
+      }
+    }
+  }
+  EXPECT_GT(num_truncated, 0);
+}
+
 static const S1Angle kTestCapRadius = S2Testing::KmToAngle(10);
 
 // The result format required by CheckDistanceResults() in s2testing.h.
@@ -0,0 +1,63 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2contains_point_cell_table.h"
+
+#include "s2/base/logging.h"
+
+S2ContainsPointCellTable::S2ContainsPointCellTable() {
+}
+
+S2ContainsPointCellTable::S2ContainsPointCellTable(const S2ShapeIndex& index,
+                                                   int level) {
+  Init(index, level);
+}
+
+void S2ContainsPointCellTable::Init(const S2ShapeIndex& index, int level) {
+  S2_DCHECK_GE(level, 0);
+  S2_DCHECK_LE(level, S2CellId::kMaxLevel);
+  level_ = level;
+  cells_.clear();
+  shape_ids_.clear();
+  list_begins_.clear();
+  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    S2CellId id = it.id();
+    if (id.level() > level) continue;
+    const S2ShapeIndexCell& cell = it.cell();
+    bool has_edges = false;
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      if (cell.clipped(s).num_edges() > 0) {
+        has_edges = true;
+        break;
+      }
+    }
+    if (has_edges) continue;
+
+    // Every shape in an index cell without edges contains the entire cell.
+    // (Shapes are only present in such cells if they contain the center.)
+    int32 list = static_cast<int32>(list_begins_.size());
+    list_begins_.push_back(static_cast<int32>(shape_ids_.size()));
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      shape_ids_.push_back(cell.clipped(s).shape_id());
+    }
+    for (S2CellId child = id.child_begin(level);
+         child != id.child_end(level); child = child.next()) {
+      cells_[child] = list;
+    }
+  }
+  list_begins_.push_back(static_cast<int32>(shape_ids_.size()));
+}
@@ -0,0 +1,102 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2CONTAINS_POINT_CELL_TABLE_H_
+#define S2_S2CONTAINS_POINT_CELL_TABLE_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2shape_index.h"
+
+// S2ContainsPointCellTable is an optional companion to S2ContainsPointQuery
+// that speeds up point queries against large polygons.  Every cell at a
+// fixed level that lies entirely within an S2ShapeIndexCell with no edges is
+// mapped to the shapes containing it, so that a query point in such a cell
+// is answered with a single hash lookup rather than by positioning an index
+// iterator.  Points in other cells (near edges, or outside all index cells)
+// are handled by S2ContainsPointQuery as usual.
+//
+// The number of table entries is the number of cells at the chosen level
+// that lie within edge-free index cells.  Coarser levels use less memory,
+// while finer levels answer more queries near the polygon boundaries.  (For
+// reference, level 10 cells are about 10km wide and level 14 cells are about
+// 600m wide.)
+//
+// Example usage:
+//
+//   S2ContainsPointCellTable table(index, 12);
+//   S2ContainsPointQueryOptions options;
+//   options.set_cell_table(&table);
+//   auto query = MakeS2ContainsPointQuery(&index, options);
+//   for (const S2Point& p : points) { if (query.Contains(p)) ... }
+//
+// The table must be rebuilt whenever the index is modified.  It may be shared
+// by any number of queries, including queries running concurrently.
+class S2ContainsPointCellTable {
+ public:
+  // Default constructor; requires Init() to be called.
+  S2ContainsPointCellTable();
+
+  // Convenience constructor that calls Init().
+  S2ContainsPointCellTable(const S2ShapeIndex& index, int level);
+
+  // Builds the table for the given index using cells at the given level.
+  //
+  // REQUIRES: 0 <= level <= S2CellId::kMaxLevel
+  void Init(const S2ShapeIndex& index, int level);
+
+  int level() const { return level_; }
+
+  // Returns the number of cells in the table.
+  int num_cells() const { return static_cast<int>(cells_.size()); }
+
+  // If the level() cell containing "p" is in the table, sets "shape_ids" to
+  // the ids of the shapes that contain it (in increasing order) and returns
+  // true.  The shapes contain "p" under every S2VertexModel.
+  bool Lookup(const S2Point& p, absl::Span<const int32>* shape_ids) const;
+
+ private:
+  int level_ = 0;
+
+  // Maps each cell to an index into "list_begins_".
+  std::unordered_map<S2CellId, int32, S2CellIdHash> cells_;
+
+  // The shape ids of list "i" are shape_ids_[list_begins_[i]] through
+  // shape_ids_[list_begins_[i + 1] - 1].
+  std::vector<int32> shape_ids_;
+  std::vector<int32> list_begins_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline bool S2ContainsPointCellTable::Lookup(
+    const S2Point& p, absl::Span<const int32>* shape_ids) const {
+  auto it = cells_.find(S2CellId(p).parent(level_));
+  if (it == cells_.end()) return false;
+  int32 begin = list_begins_[it->second];
+  *shape_ids = absl::MakeConstSpan(shape_ids_.data() + begin,
+                                   list_begins_[it->second + 1] - begin);
+  return true;
+}
+
+#endif  // S2_S2CONTAINS_POINT_CELL_TABLE_H_
@@ -18,11 +18,22 @@
 #ifndef S2_S2CONTAINS_POINT_QUERY_H_
 #define S2_S2CONTAINS_POINT_QUERY_H_
 
+#include <algorithm>
+#include <functional>
+#include <utility>
 #include <vector>
 
+#include "s2/s2contains_point_cell_table.h"
 #include "s2/s2edge_crosser.h"
+#include "s2/s2point_span.h"
+#include "s2/s2predicates.h"
+#include "s2/s2query_listener.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_shape_edge.h"
+#include "s2/third_party/absl/container/fixed_array.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/util/thread/executor.h"
 
 // Defines whether shapes are considered to contain their vertices.  Note that
 // these definitions differ from the ones used by S2BooleanOperation.
@@ -59,8 +70,49 @@ class S2ContainsPointQueryOptions {
   S2VertexModel vertex_model() const;
   void set_vertex_model(S2VertexModel model);
 
+  // If specified, the statistics of every query are added to the given
+  // object (see s2query_stats.h).  Each point passed to Contains(),
+  // ShapeContains(), VisitContainingShapes(), or VisitIncidentEdges() counts
+  // as one query.
+  //
+  // DEFAULT: nullptr
+  S2QueryStats* stats() const;
+  void set_stats(S2QueryStats* stats);
+
+  // If specified, Contains(), ShapeContains() and VisitContainingShapes()
+  // first look up the query point in the given table, and only search the
+  // index if the point is not in a table cell (see
+  // s2contains_point_cell_table.h).  The table must have been built from
+  // the same index and must persist while the query is in use.
+  //
+  // DEFAULT: nullptr
+  const S2ContainsPointCellTable* cell_table() const;
+  void set_cell_table(const S2ContainsPointCellTable* cell_table);
+
+  // If specified, only shapes for which the given predicate returns true are
+  // considered by the query, as though all other shapes were not present in
+  // the index.  Rejected shapes are skipped before any of their edges are
+  // tested.  (The low-level ShapeContains(it, clipped, p) method ignores this
+  // option.)  For example, to restrict the query to the shape ids in a
+  // bitset:
+  //
+  //   std::vector<bool> buildings = ...;
+  //   S2ContainsPointQueryOptions::ShapeFilter filter =
+  //       [&buildings](int shape_id) { return buildings[shape_id]; };
+  //   options.set_shape_filter(&filter);
+  //
+  // The predicate must persist while the query is in use.
+  //
+  // DEFAULT: nullptr (all shapes are considered)
+  using ShapeFilter = std::function<bool (int shape_id)>;
+  const ShapeFilter* shape_filter() const;
+  void set_shape_filter(const ShapeFilter* shape_filter);
+
  private:
   S2VertexModel vertex_model_ = S2VertexModel::SEMI_OPEN;
+  S2QueryStats* stats_ = nullptr;
+  const S2ContainsPointCellTable* cell_table_ = nullptr;
+  const ShapeFilter* shape_filter_ = nullptr;
 };
 
 // S2ContainsPointQuery determines whether one or more shapes in an
@@ -110,6 +162,32 @@ class S2ContainsPointQuery {
   // under the vertex model specified (OPEN, SEMI_OPEN, or CLOSED).
   bool Contains(const S2Point& p);
 
+  // Like Contains(), but tests every point in "points" and sets (*results)[i]
+  // to true if and only if points[i] is contained by some shape.
+  //
+  // This is much faster than calling Contains() for each point when there
+  // are many points, especially if the points are clustered.  The points are
+  // processed in S2CellId order rather than in the given order, so that the
+  // index iterator only ever moves forward and consecutive points that fall
+  // in the same index cell (or in the same gap between cells) do not need to
+  // search the index at all.
+  void Contains(S2PointSpan points, std::vector<bool>* results);
+
+  // Like the method above, but the query points are given as leaf cell ids
+  // (each representing the point S2CellId::ToPoint()).  This is convenient
+  // when the points are already stored in that form, since they are sorted
+  // without converting them first.
+  //
+  // If "executor" is non-null, the sorted points are split into contiguous
+  // ranges of cell ids that are classified concurrently, each by a separate
+  // query using the same options (see util/thread/executor.h).  If
+  // options().stats() is non-null, the statistics of all ranges are added to
+  // it before this method returns.  This object is not modified otherwise.
+  //
+  // REQUIRES: Every element of "point_ids" is a leaf cell.
+  void Contains(absl::Span<const S2CellId> point_ids, Executor* executor,
+                std::vector<bool>* results);
+
   // Returns true if the given shape contains the point "p" under the vertex
   // model specified (OPEN, SEMI_OPEN, or CLOSED).
   //
@@ -152,6 +230,38 @@ class S2ContainsPointQuery {
                      const S2Point& p) const;
 
  private:
+  // Counts one query, and returns true if point "p" is contained by an index
+  // cell (in which case "it_" is positioned at that cell).
+  bool Locate(const S2Point& p);
+
+  // Returns true if the given shape is accepted by options().shape_filter().
+  bool IncludesShape(int shape_id) const;
+
+  // Returns true if point "p" is in a cell of options().cell_table(), in
+  // which case the query is counted and "shape_ids" is set to the shapes
+  // that contain "p".
+  bool LookupCellTable(const S2Point& p, absl::Span<const int32>* shape_ids);
+
+  // Tests the points in "sorted", which is a list of (leaf cell id, point
+  // index) pairs sorted by cell id, sweeping the index in that order.  For
+  // each point that is contained by some shape, calls output(k) where "k" is
+  // the position of the point within "sorted".  The point corresponding to
+  // sorted[k] is given by point(sorted[k].second).
+  // Copies the endpoints of the edges of "clipped", which belongs to
+  // "shape", to v0[i] and v1[i] in the order given by clipped.edge(i).  Index
+  // types that store the edge endpoints themselves may specialize this
+  // method (see flat_s2shape_index.h).
+  void GetClippedEdges(const S2ClippedShape& clipped, const S2Shape& shape,
+                       S2Point* v0, S2Point* v1) const;
+
+  template <class PointFn, class OutputFn>
+  void ContainsSorted(absl::Span<const std::pair<S2CellId, int>> sorted,
+                      const PointFn& point, const OutputFn& output);
+
+  // The minimum number of points that Contains() assigns to each task when
+  // an Executor is specified.
+  static constexpr int kMinPointsPerTask = 4096;
+
   const IndexType* index_;
   Options options_;
   Iterator it_;
@@ -184,6 +294,34 @@ inline void S2ContainsPointQueryOptions::set_vertex_model(S2VertexModel model) {
   vertex_model_ = model;
 }
 
+inline S2QueryStats* S2ContainsPointQueryOptions::stats() const {
+  return stats_;
+}
+
+inline void S2ContainsPointQueryOptions::set_stats(S2QueryStats* stats) {
+  stats_ = stats;
+}
+
+inline const S2ContainsPointCellTable*
+S2ContainsPointQueryOptions::cell_table() const {
+  return cell_table_;
+}
+
+inline void S2ContainsPointQueryOptions::set_cell_table(
+    const S2ContainsPointCellTable* cell_table) {
+  cell_table_ = cell_table;
+}
+
+inline const S2ContainsPointQueryOptions::ShapeFilter*
+S2ContainsPointQueryOptions::shape_filter() const {
+  return shape_filter_;
+}
+
+inline void S2ContainsPointQueryOptions::set_shape_filter(
+    const ShapeFilter* shape_filter) {
+  shape_filter_ = shape_filter;
+}
+
 template <class IndexType>
 inline S2ContainsPointQuery<IndexType>::S2ContainsPointQuery()
     : index_(nullptr) {
@@ -210,21 +348,194 @@ void S2ContainsPointQuery<IndexType>::Init(const IndexType* index,
 }
 
 template <class IndexType>
-bool S2ContainsPointQuery<IndexType>::Contains(const S2Point& p) {
+inline bool S2ContainsPointQuery<IndexType>::Locate(const S2Point& p) {
+  S2QueryStats* stats = options_.stats();
+  if (stats == nullptr) return it_.Locate(p);
+  ++stats->num_queries;
   if (!it_.Locate(p)) return false;
+  ++stats->num_cells_visited;
+  return true;
+}
+
+template <class IndexType>
+inline bool S2ContainsPointQuery<IndexType>::IncludesShape(
+    int shape_id) const {
+  const Options::ShapeFilter* filter = options_.shape_filter();
+  return filter == nullptr || (*filter)(shape_id);
+}
+
+template <class IndexType>
+inline bool S2ContainsPointQuery<IndexType>::LookupCellTable(
+    const S2Point& p, absl::Span<const int32>* shape_ids) {
+  const S2ContainsPointCellTable* table = options_.cell_table();
+  if (table == nullptr || !table->Lookup(p, shape_ids)) return false;
+  if (options_.stats()) ++options_.stats()->num_queries;
+  return true;
+}
+
+template <class IndexType>
+bool S2ContainsPointQuery<IndexType>::Contains(const S2Point& p) {
+  S2QueryTimer timer(S2QueryListener::Operation::CONTAINS_POINT,
+                     options_.stats());
+  absl::Span<const int32> shape_ids;
+  if (LookupCellTable(p, &shape_ids)) {
+    for (int32 shape_id : shape_ids) {
+      if (IncludesShape(shape_id)) return true;
+    }
+    return false;
+  }
+  if (!Locate(p)) return false;
 
   const S2ShapeIndexCell& cell = it_.cell();
   int num_clipped = cell.num_clipped();
   for (int s = 0; s < num_clipped; ++s) {
-    if (ShapeContains(it_, cell.clipped(s), p)) return true;
+    const S2ClippedShape& clipped = cell.clipped(s);
+    if (IncludesShape(clipped.shape_id()) && ShapeContains(it_, clipped, p)) {
+      return true;
+    }
   }
   return false;
 }
 
+template <class IndexType>
+void S2ContainsPointQuery<IndexType>::Contains(S2PointSpan points,
+                                               std::vector<bool>* results) {
+  S2QueryTimer timer(S2QueryListener::Operation::CONTAINS_POINT,
+                     options_.stats());
+  results->assign(points.size(), false);
+  std::vector<std::pair<S2CellId, int>> sorted;
+  sorted.reserve(points.size());
+  for (int i = 0; i < points.size(); ++i) {
+    sorted.push_back(std::make_pair(S2CellId(points[i]), i));
+  }
+  std::sort(sorted.begin(), sorted.end());
+  ContainsSorted(sorted, [points](int i) -> const S2Point& {
+      return points[i];
+    }, [results, &sorted](int k) {
+      (*results)[sorted[k].second] = true;
+    });
+}
+
+template <class IndexType>
+constexpr int S2ContainsPointQuery<IndexType>::kMinPointsPerTask;
+
+template <class IndexType>
+void S2ContainsPointQuery<IndexType>::Contains(
+    absl::Span<const S2CellId> point_ids, Executor* executor,
+    std::vector<bool>* results) {
+  S2QueryTimer timer(S2QueryListener::Operation::CONTAINS_POINT,
+                     options_.stats());
+  results->assign(point_ids.size(), false);
+  std::vector<std::pair<S2CellId, int>> sorted;
+  sorted.reserve(point_ids.size());
+  for (int i = 0; i < point_ids.size(); ++i) {
+    S2_DCHECK(point_ids[i].is_leaf());
+    sorted.push_back(std::make_pair(point_ids[i], i));
+  }
+  std::sort(sorted.begin(), sorted.end());
+  auto point = [point_ids](int i) { return point_ids[i].ToPoint(); };
+
+  int num_tasks = 1;
+  if (executor != nullptr) {
+    num_tasks = std::min(4 * executor->num_threads(),
+                         static_cast<int>(sorted.size() / kMinPointsPerTask));
+  }
+  if (num_tasks <= 1) {
+    ContainsSorted(sorted, point, [results, &sorted](int k) {
+        (*results)[sorted[k].second] = true;
+      });
+    return;
+  }
+  // Each task writes to a separate range of "contained", since concurrent
+  // writes to distinct elements of std::vector<bool> are not safe.
+  std::vector<char> contained(sorted.size(), false);
+  std::vector<S2QueryStats> task_stats(num_tasks);
+  ParallelFor(executor, num_tasks, [&](int task) {
+      int begin = static_cast<int64>(sorted.size()) * task / num_tasks;
+      int end = static_cast<int64>(sorted.size()) * (task + 1) / num_tasks;
+      Options options = options_;
+      if (options.stats()) options.set_stats(&task_stats[task]);
+      S2ContainsPointQuery query(index_, options);
+      query.ContainsSorted(
+          absl::MakeConstSpan(sorted.data() + begin, end - begin), point,
+          [&contained, begin](int k) { contained[begin + k] = true; });
+    });
+  if (options_.stats()) {
+    for (const S2QueryStats& stats : task_stats) options_.stats()->Add(stats);
+  }
+  for (int k = 0; k < sorted.size(); ++k) {
+    if (contained[k]) (*results)[sorted[k].second] = true;
+  }
+}
+
+template <class IndexType>
+template <class PointFn, class OutputFn>
+void S2ContainsPointQuery<IndexType>::ContainsSorted(
+    absl::Span<const std::pair<S2CellId, int>> sorted, const PointFn& point,
+    const OutputFn& output) {
+  S2QueryStats* stats = options_.stats();
+  if (stats) stats->num_queries += sorted.size();
+
+  // The range of leaf cell ids [range_min, range_max] that is known to be
+  // covered by the current index cell (if "in_cell" is true) or to be
+  // outside all index cells (otherwise).  Initially the range is empty.
+  S2CellId range_min = S2CellId::Sentinel(), range_max = S2CellId::None();
+  bool in_cell = false;
+  for (int k = 0; k < sorted.size(); ++k) {
+    const S2CellId target = sorted[k].first;
+    if (target < range_min || target > range_max) {
+      // Equivalent to Iterator::Locate(), except that it also determines the
+      // extent of the gap when "target" is not contained by any cell.
+      range_min = target;
+      it_.Seek(target);
+      S2CellId gap_end = S2CellId::Sentinel();
+      if (!it_.done()) {
+        if (it_.id().range_min() <= target) {
+          gap_end = S2CellId::None();
+        } else {
+          gap_end = it_.id().range_min();
+        }
+      }
+      if (gap_end == S2CellId::None() ||
+          (it_.Prev() && it_.id().range_max() >= target)) {
+        in_cell = true;
+        range_min = it_.id().range_min();
+        range_max = it_.id().range_max();
+      } else {
+        // The targets are leaf cells, so every target in the gap precedes
+        // "gap_end" by at least one leaf cell.
+        in_cell = false;
+        range_max = (gap_end == S2CellId::Sentinel()) ? gap_end :
+                    gap_end.prev();
+      }
+    }
+    if (!in_cell) continue;
+    if (stats) ++stats->num_cells_visited;
+    const S2Point& p = point(sorted[k].second);
+    const S2ShapeIndexCell& cell = it_.cell();
+    int num_clipped = cell.num_clipped();
+    for (int s = 0; s < num_clipped; ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      if (IncludesShape(clipped.shape_id()) &&
+          ShapeContains(it_, clipped, p)) {
+        output(k);
+        break;
+      }
+    }
+  }
+}
+
 template <class IndexType>
 bool S2ContainsPointQuery<IndexType>::ShapeContains(const S2Shape& shape,
                                                     const S2Point& p) {
-  if (!it_.Locate(p)) return false;
+  S2QueryTimer timer(S2QueryListener::Operation::CONTAINS_POINT,
+                     options_.stats());
+  if (!IncludesShape(shape.id())) return false;
+  absl::Span<const int32> shape_ids;
+  if (LookupCellTable(p, &shape_ids)) {
+    return std::binary_search(shape_ids.begin(), shape_ids.end(), shape.id());
+  }
+  if (!Locate(p)) return false;
   const S2ClippedShape* clipped = it_.cell().find_clipped(shape.id());
   if (clipped == nullptr) return false;
   return ShapeContains(it_, *clipped, p);
@@ -233,15 +544,26 @@ bool S2ContainsPointQuery<IndexType>::ShapeContains(const S2Shape& shape,
 template <class IndexType>
 bool S2ContainsPointQuery<IndexType>::VisitContainingShapes(
     const S2Point& p, const ShapeVisitor& visitor) {
+  S2QueryTimer timer(S2QueryListener::Operation::CONTAINS_POINT,
+                     options_.stats());
   // This function returns "false" only if the algorithm terminates early
   // because the "visitor" function returned false.
-  if (!it_.Locate(p)) return true;
+  absl::Span<const int32> shape_ids;
+  if (LookupCellTable(p, &shape_ids)) {
+    for (int32 shape_id : shape_ids) {
+      if (IncludesShape(shape_id) && !visitor(index_->shape(shape_id))) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (!Locate(p)) return true;
 
   const S2ShapeIndexCell& cell = it_.cell();
   int num_clipped = cell.num_clipped();
   for (int s = 0; s < num_clipped; ++s) {
     const S2ClippedShape& clipped = cell.clipped(s);
-    if (ShapeContains(it_, clipped, p) &&
+    if (IncludesShape(clipped.shape_id()) && ShapeContains(it_, clipped, p) &&
         !visitor(index_->shape(clipped.shape_id()))) {
       return false;
     }
@@ -254,14 +576,15 @@ bool S2ContainsPointQuery<IndexType>::VisitIncidentEdges(
     const S2Point& p, const EdgeVisitor& visitor) {
   // This function returns "false" only if the algorithm terminates early
   // because the "visitor" function returned false.
-  if (!it_.Locate(p)) return true;
+  if (!Locate(p)) return true;
 
   const S2ShapeIndexCell& cell = it_.cell();
   int num_clipped = cell.num_clipped();
   for (int s = 0; s < num_clipped; ++s) {
     const S2ClippedShape& clipped = cell.clipped(s);
     int num_edges = clipped.num_edges();
-    if (num_edges == 0) continue;
+    if (num_edges == 0 || !IncludesShape(clipped.shape_id())) continue;
+    if (options_.stats()) options_.stats()->num_edges_tested += num_edges;
     const S2Shape& shape = *index_->shape(clipped.shape_id());
     for (int i = 0; i < num_edges; ++i) {
       int edge_id = clipped.edge(i);
@@ -286,6 +609,18 @@ std::vector<S2Shape*> S2ContainsPointQuery<IndexType>::GetContainingShapes(
   return results;
 }
 
+template <class IndexType>
+inline void S2ContainsPointQuery<IndexType>::GetClippedEdges(
+    const S2ClippedShape& clipped, const S2Shape& shape, S2Point* v0,
+    S2Point* v1) const {
+  const int num_edges = clipped.num_edges();
+  for (int i = 0; i < num_edges; ++i) {
+    auto edge = shape.edge(clipped.edge(i));
+    v0[i] = edge.v0;
+    v1[i] = edge.v1;
+  }
+}
+
 template <class IndexType>
 bool S2ContainsPointQuery<IndexType>::ShapeContains(
     const Iterator& it, const S2ClippedShape& clipped, const S2Point& p) const {
@@ -296,6 +631,7 @@ bool S2ContainsPointQuery<IndexType>::ShapeContains(
     if (shape.dimension() < 2) {
       // Points and polylines can be ignored unless the vertex model is CLOSED.
       if (options_.vertex_model() != S2VertexModel::CLOSED) return false;
+      if (options_.stats()) options_.stats()->num_edges_tested += num_edges;
 
       // Otherwise, the point is contained if and only if it matches a vertex.
       for (int i = 0; i < num_edges; ++i) {
@@ -306,18 +642,33 @@ bool S2ContainsPointQuery<IndexType>::ShapeContains(
     }
     // Test containment by drawing a line segment from the cell center to the
     // given point and counting edge crossings.
+    if (options_.stats()) options_.stats()->num_edges_tested += num_edges;
     S2CopyingEdgeCrosser crosser(it.center(), p);
+
+    // An edge cannot cross the segment if both of its endpoints are
+    // definitely on the same side of the great circle through the segment.
+    // We first classify all the edge endpoints in two vectorizable passes
+    // (see s2pred::TriageSigns) so that only the remaining edges need to be
+    // tested exactly.
+    absl::FixedArray<S2Point, 32> v0(num_edges), v1(num_edges);
+    GetClippedEdges(clipped, shape, v0.data(), v1.data());
+    absl::FixedArray<int8, 64> v0_signs(num_edges), v1_signs(num_edges);
+    const Vector3_d a_cross_b = crosser.a().CrossProd(crosser.b());
+    s2pred::TriageSigns(crosser.a(), crosser.b(), a_cross_b,
+                        S2PointSpan(v0.data(), num_edges), v0_signs.data());
+    s2pred::TriageSigns(crosser.a(), crosser.b(), a_cross_b,
+                        S2PointSpan(v1.data(), num_edges), v1_signs.data());
     for (int i = 0; i < num_edges; ++i) {
-      auto edge = shape.edge(clipped.edge(i));
-      int sign = crosser.CrossingSign(edge.v0, edge.v1);
+      if (v0_signs[i] * v1_signs[i] > 0) continue;  // No crossing.
+      int sign = crosser.CrossingSign(v0[i], v1[i]);
       if (sign < 0) continue;
       if (sign == 0) {
         // For the OPEN and CLOSED models, check whether "p" is a vertex.
         if (options_.vertex_model() != S2VertexModel::SEMI_OPEN &&
-            (edge.v0 == p || edge.v1 == p)) {
+            (v0[i] == p || v1[i] == p)) {
           return (options_.vertex_model() == S2VertexModel::CLOSED);
         }
-        sign = S2::VertexCrossing(crosser.a(), crosser.b(), edge.v0, edge.v1);
+        sign = S2::VertexCrossing(crosser.a(), crosser.b(), v0[i], v1[i]);
       }
       inside ^= sign;
     }
@@ -0,0 +1,89 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for S2ContainsPointQuery.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/flat_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using std::vector;
+
+namespace {
+
+// Builds an index containing a fractal loop with approximately the given
+// number of edges, and returns points sampled from a cap around it.
+vector<S2Point> InitFractalIndex(int num_edges, MutableS2ShapeIndex* index) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(num_edges);
+  S2Point center = S2Testing::RandomPoint();
+  index->Add(absl::make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      S2Testing::GetRandomFrameAt(center), S2Testing::KmToAngle(100))));
+  index->ForceBuild();
+  S2Cap query_cap(center, S2Testing::KmToAngle(150));
+  vector<S2Point> points;
+  for (int i = 0; i < 10000; ++i) {
+    points.push_back(S2Testing::SamplePoint(query_cap));
+  }
+  return points;
+}
+
+void BM_Contains(benchmark::State& state) {
+  MutableS2ShapeIndex index;
+  vector<S2Point> points = InitFractalIndex(state.range(0), &index);
+  auto query = MakeS2ContainsPointQuery(&index);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_Contains)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_ContainsFlatIndex(benchmark::State& state) {
+  MutableS2ShapeIndex source;
+  vector<S2Point> points = InitFractalIndex(state.range(0), &source);
+  FlatS2ShapeIndex index(&source);
+  auto query = MakeS2ContainsPointQuery(&index);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_ContainsFlatIndex)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_ContainsBatch(benchmark::State& state) {
+  MutableS2ShapeIndex index;
+  vector<S2Point> points = InitFractalIndex(state.range(0), &index);
+  auto query = MakeS2ContainsPointQuery(&index);
+  vector<bool> results;
+  for (auto _ : state) {
+    query.Contains(points, &results);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_ContainsBatch)->Arg(100)->Arg(10000)->Arg(100000);
+
+}  // namespace
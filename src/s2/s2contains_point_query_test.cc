@@ -26,6 +26,7 @@
 #include "s2/s2loop.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/work_stealing_executor.h"
 
 using absl::make_unique;
 using s2shapeutil::ShapeEdge;
@@ -134,6 +135,218 @@ TEST(S2ContainsPointQuery, GetContainingShapes) {
   }
 }
 
+TEST(S2ContainsPointQuery, ContainsBatch) {
+  // Sample points from a region larger than the loops, so that some points
+  // fall in the gaps between index cells.  Also include duplicate points,
+  // loop vertices, and points on other faces.
+  const S1Angle kMaxLoopRadius = S2Testing::KmToAngle(10);
+  const S2Cap center_cap(S2Testing::RandomPoint(), 10 * kMaxLoopRadius);
+  MutableS2ShapeIndex index;
+  vector<S2Point> points;
+  for (int i = 0; i < 20; ++i) {
+    std::unique_ptr<S2Loop> loop = S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(center_cap),
+        S2Testing::rnd.RandDouble() * kMaxLoopRadius, 10);
+    points.push_back(loop->vertex(0));
+    index.Add(make_unique<S2Loop::OwningShape>(std::move(loop)));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(S2Testing::SamplePoint(center_cap));
+  }
+  for (int i = 0; i < 10; ++i) {
+    points.push_back(points[S2Testing::rnd.Uniform(points.size())]);
+    points.push_back(S2Testing::RandomPoint());
+  }
+  for (auto model : {S2VertexModel::OPEN, S2VertexModel::SEMI_OPEN,
+                     S2VertexModel::CLOSED}) {
+    auto query = MakeS2ContainsPointQuery(
+        &index, S2ContainsPointQueryOptions(model));
+    vector<bool> results;
+    query.Contains(points, &results);
+    ASSERT_EQ(points.size(), results.size());
+    int num_contained = 0;
+    for (int i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(query.Contains(points[i]), results[i]) << i;
+      num_contained += results[i];
+    }
+    EXPECT_GT(num_contained, 0);
+    EXPECT_LT(num_contained, points.size());
+  }
+}
+
+TEST(S2ContainsPointQuery, ManyEdgesPerCellMatchesBruteForce) {
+  // Index small loops with many edges in each cell, and check that the
+  // results agree with S2Loop's brute force crossing test.  The loop
+  // vertices are also tested, since they require the exact crossing test.
+  MutableS2ShapeIndex::Options options;
+  options.set_max_edges_per_cell(100);
+  MutableS2ShapeIndex index(options);
+  const S2Cap cap(S2Testing::RandomPoint(), S2Testing::KmToAngle(20));
+  vector<std::unique_ptr<S2Loop>> loops;
+  for (int i = 0; i < 10; ++i) {
+    loops.push_back(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S2Testing::KmToAngle(5),
+        3 + S2Testing::rnd.Uniform(60)));
+    loops.back()->set_max_unindexed_contains_calls(-1);
+    index.Add(make_unique<S2Loop::Shape>(loops.back().get()));
+  }
+  for (auto model : {S2VertexModel::OPEN, S2VertexModel::SEMI_OPEN,
+                     S2VertexModel::CLOSED}) {
+    auto query = MakeS2ContainsPointQuery(
+        &index, S2ContainsPointQueryOptions(model));
+    for (int i = 0; i < 1000; ++i) {
+      S2Point p = S2Testing::SamplePoint(cap);
+      for (int k = 0; k < loops.size(); ++k) {
+        EXPECT_EQ(loops[k]->Contains(p),
+                  query.ShapeContains(*index.shape(k), p));
+      }
+    }
+    for (int k = 0; k < loops.size(); ++k) {
+      const S2Loop& loop = *loops[k];
+      for (int j = 0; j < loop.num_vertices(); ++j) {
+        const S2Point& v = loop.vertex(j);
+        bool expected = (model == S2VertexModel::SEMI_OPEN) ?
+                        loop.Contains(v) : (model == S2VertexModel::CLOSED);
+        EXPECT_EQ(expected, query.ShapeContains(*index.shape(k), v));
+      }
+    }
+  }
+}
+
+TEST(S2ContainsPointQuery, Stats) {
+  auto index = MakeIndexOrDie("# # 0:0, 0:10, 10:10, 10:0");
+  S2QueryStats stats;
+  S2ContainsPointQueryOptions options;
+  options.set_stats(&stats);
+  auto query = MakeS2ContainsPointQuery(index.get(), options);
+  EXPECT_TRUE(query.Contains(MakePointOrDie("5:5")));
+  EXPECT_FALSE(query.Contains(MakePointOrDie("-50:50")));
+  EXPECT_EQ(2, stats.num_queries);
+  EXPECT_EQ(0, stats.num_brute_force_queries);
+
+  vector<bool> results;
+  query.Contains(vector<S2Point>{MakePointOrDie("1:1"),
+                                 MakePointOrDie("2:2")}, &results);
+  EXPECT_EQ(4, stats.num_queries);
+  EXPECT_GE(stats.num_cells_visited, 1);
+  EXPECT_LE(stats.num_cells_visited, 3);
+  EXPECT_GE(stats.num_edges_tested, 0);
+}
+
+TEST(S2ContainsPointQuery, ShapeFilter) {
+  // Shape 0 is a point at 2:2, and shapes 1 and 2 are polygons containing it.
+  auto index = MakeIndexOrDie(
+      "2:2 # # 0:0, 0:5, 5:5, 5:0 | 1:1, 1:4, 4:4, 4:1");
+  S2ContainsPointQueryOptions options(S2VertexModel::CLOSED);
+  S2ContainsPointQueryOptions::ShapeFilter filter = [](int shape_id) {
+    return shape_id == 0;
+  };
+  options.set_shape_filter(&filter);
+  auto query = MakeS2ContainsPointQuery(index.get(), options);
+  S2Point p = MakePointOrDie("2:2");
+  vector<S2Shape*> shapes = query.GetContainingShapes(p);
+  ASSERT_EQ(1, shapes.size());
+  EXPECT_EQ(0, shapes[0]->id());
+  EXPECT_TRUE(query.ShapeContains(*index->shape(0), p));
+  EXPECT_FALSE(query.ShapeContains(*index->shape(1), p));
+  // Only the point at 2:2 passes the filter.
+  EXPECT_TRUE(query.Contains(p));
+  EXPECT_FALSE(query.Contains(MakePointOrDie("3:3")));
+  vector<bool> results;
+  query.Contains(vector<S2Point>{p, MakePointOrDie("3:3")}, &results);
+  EXPECT_EQ((vector<bool>{true, false}), results);
+  int num_incident = 0;
+  query.VisitIncidentEdges(MakePointOrDie("0:0"),
+                           [&num_incident](const s2shapeutil::ShapeEdge&) {
+                             ++num_incident;
+                             return true;
+                           });
+  EXPECT_EQ(0, num_incident);
+
+  // The filter also applies when a cell table is used.
+  S2ContainsPointCellTable table(*index, 8);
+  options.set_cell_table(&table);
+  query.Init(index.get(), options);
+  EXPECT_TRUE(query.Contains(p));
+  EXPECT_FALSE(query.Contains(MakePointOrDie("3:3")));
+  EXPECT_FALSE(query.ShapeContains(*index->shape(1), MakePointOrDie("3:3")));
+}
+
+TEST(S2ContainsPointQuery, CellTableGivesIdenticalResults) {
+  // Two large overlapping loops, so that many index cells have no edges and
+  // some of them are contained by both loops.
+  MutableS2ShapeIndex index;
+  S2Point center = MakePointOrDie("10:20");
+  index.Add(make_unique<S2Loop::OwningShape>(
+      S2Loop::MakeRegularLoop(center, S1Angle::Degrees(10), 100)));
+  index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      MakePointOrDie("12:22"), S1Angle::Degrees(5), 100)));
+  S2ContainsPointCellTable table(index, 10);
+  EXPECT_EQ(10, table.level());
+  EXPECT_GT(table.num_cells(), 0);
+
+  S2QueryStats stats, table_stats;
+  S2ContainsPointQueryOptions options;
+  options.set_stats(&stats);
+  auto query = MakeS2ContainsPointQuery(&index, options);
+  options.set_cell_table(&table);
+  options.set_stats(&table_stats);
+  auto table_query = MakeS2ContainsPointQuery(&index, options);
+  const S2Cap cap(center, S1Angle::Degrees(6));
+  const int kNumPoints = 1000;
+  for (int i = 0; i < kNumPoints; ++i) {
+    S2Point p = S2Testing::SamplePoint(cap);
+    EXPECT_EQ(query.Contains(p), table_query.Contains(p));
+    for (S2Shape* shape : index) {
+      EXPECT_EQ(query.ShapeContains(*shape, p),
+                table_query.ShapeContains(*shape, p));
+    }
+    EXPECT_EQ(query.GetContainingShapes(p),
+              table_query.GetContainingShapes(p));
+  }
+  // Many points inside the loops are answered without visiting index cells.
+  EXPECT_EQ(stats.num_queries, table_stats.num_queries);
+  EXPECT_LT(table_stats.num_cells_visited, 0.8 * stats.num_cells_visited);
+}
+
+TEST(S2ContainsPointQuery, ContainsCellIdBatch) {
+  const S1Angle kMaxLoopRadius = S2Testing::KmToAngle(10);
+  const S2Cap center_cap(S2Testing::RandomPoint(), 10 * kMaxLoopRadius);
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(center_cap),
+        S2Testing::rnd.RandDouble() * kMaxLoopRadius, 10)));
+  }
+  vector<S2CellId> point_ids;
+  for (int i = 0; i < 50000; ++i) {
+    point_ids.push_back(S2CellId(S2Testing::SamplePoint(center_cap)));
+  }
+  for (int i = 0; i < 10; ++i) {
+    point_ids.push_back(point_ids[S2Testing::rnd.Uniform(point_ids.size())]);
+    point_ids.push_back(S2CellId(S2Testing::RandomPoint()));
+  }
+  WorkStealingExecutor executor(3);
+  for (Executor* e : {static_cast<Executor*>(nullptr),
+                      static_cast<Executor*>(&executor)}) {
+    S2QueryStats stats;
+    S2ContainsPointQueryOptions options;
+    options.set_stats(&stats);
+    auto query = MakeS2ContainsPointQuery(&index, options);
+    vector<bool> results;
+    query.Contains(point_ids, e, &results);
+    ASSERT_EQ(point_ids.size(), results.size());
+    EXPECT_EQ(point_ids.size(), stats.num_queries);
+    int num_contained = 0;
+    for (int i = 0; i < point_ids.size(); ++i) {
+      EXPECT_EQ(query.Contains(point_ids[i].ToPoint()), results[i]) << i;
+      num_contained += results[i];
+    }
+    EXPECT_GT(num_contained, 0);
+    EXPECT_LT(num_contained, point_ids.size());
+  }
+}
+
 using EdgeIdVector = vector<ShapeEdgeId>;
 
 void ExpectIncidentEdgeIds(const EdgeIdVector& expected,
@@ -38,11 +38,13 @@ S2ConvexHullQuery::S2ConvexHullQuery()
 }
 
 void S2ConvexHullQuery::AddPoint(const S2Point& point) {
+  points_are_hull_ = false;
   bound_.AddPoint(point);
   points_.push_back(point);
 }
 
 void S2ConvexHullQuery::AddPolyline(const S2Polyline& polyline) {
+  points_are_hull_ = false;
   bound_ = bound_.Union(polyline.GetRectBound());
   for (int i = 0; i < polyline.num_vertices(); ++i) {
     points_.push_back(polyline.vertex(i));
@@ -50,6 +52,7 @@ void S2ConvexHullQuery::AddPolyline(const S2Polyline& polyline) {
 }
 
 void S2ConvexHullQuery::AddLoop(const S2Loop& loop) {
+  points_are_hull_ = false;
   bound_ = bound_.Union(loop.GetRectBound());
   if (loop.is_empty_or_full()) {
     // The empty and full loops consist of a single fake "vertex" that should
@@ -111,6 +114,8 @@ unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
     // convex hull).
     return make_unique<S2Loop>(S2Loop::kFull());
   }
+  if (points_are_hull_) return make_unique<S2Loop>(points_);
+
   // This code implements Andrew's monotone chain algorithm, which is a simple
   // variant of the Graham scan.  Rather than sorting by x-coordinate, instead
   // we sort the points in CCW order around an origin O such that all points
@@ -153,7 +158,12 @@ unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
   lower.pop_back();
   upper.pop_back();
   lower.insert(lower.end(), upper.begin(), upper.end());
-  return make_unique<S2Loop>(lower);
+
+  // Only the hull vertices are needed to compute the hull again after more
+  // geometry is added.
+  points_.swap(lower);
+  points_are_hull_ = true;
+  return make_unique<S2Loop>(points_);
 }
 
 // Iterate through the given points, selecting the maximal subset of points
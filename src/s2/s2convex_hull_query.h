@@ -56,6 +56,12 @@
 // hull again.  If you want to start from scratch, simply declare a new
 // S2ConvexHullQuery object (they are cheap to create).
 //
+// The hull can be maintained incrementally for a stream of points: each call
+// to GetConvexHull() discards the points that are not hull vertices, so the
+// next call only needs to process the hull vertices plus the geometry added
+// since then.  If nothing has been added, GetConvexHull() simply returns a
+// copy of the previous hull.
+//
 // This class is not thread-safe.  There are no "const" methods.
 class S2ConvexHullQuery {
  public:
@@ -103,6 +109,10 @@ class S2ConvexHullQuery {
   S2LatLngRect bound_;
   std::vector<S2Point> points_;
 
+  // True if "points_" consists of the vertices of the convex hull in CCW
+  // order, i.e. nothing has been added since the hull was last computed.
+  bool points_are_hull_ = false;
+
   S2ConvexHullQuery(const S2ConvexHullQuery&) = delete;
   void operator=(const S2ConvexHullQuery&) = delete;
 };
@@ -205,4 +205,30 @@ TEST(S2ConvexHullQueryTest, PointsInsideHull) {
   }
 }
 
+TEST(S2ConvexHullQueryTest, StreamingPointsMatchFullRecomputation) {
+  // Checks that computing the hull after each batch of points, which keeps
+  // only the previous hull vertices, gives the same hull as computing it
+  // from all the points at once.
+  S2Testing::rnd.Reset(1);
+  S2ConvexHullQuery streaming_query;
+  vector<S2Point> points;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(10));
+  for (int batch = 0; batch < 20; ++batch) {
+    for (int i = 0; i < 50; ++i) {
+      points.push_back(S2Testing::SamplePoint(cap));
+      streaming_query.AddPoint(points.back());
+    }
+    S2ConvexHullQuery query;
+    for (const S2Point& p : points) query.AddPoint(p);
+    unique_ptr<S2Loop> expected = query.GetConvexHull();
+    unique_ptr<S2Loop> actual = streaming_query.GetConvexHull();
+    EXPECT_TRUE(actual->BoundaryEquals(expected.get())) << batch;
+
+    // Calling GetConvexHull() again without adding points returns the same
+    // hull.
+    EXPECT_TRUE(streaming_query.GetConvexHull()->BoundaryEquals(
+        actual.get()));
+  }
+}
+
 }  // namespace
@@ -143,4 +143,101 @@ S2Point FaceSiTitoXYZ(int face, unsigned int si, unsigned int ti) {
   return FaceUVtoXYZ(face, u, v);
 }
 
+void XYZtoFaceUV(absl::Span<const S2Point> points, absl::Span<int> faces,
+                 absl::Span<double> u, absl::Span<double> v) {
+  S2_DCHECK_EQ(points.size(), faces.size());
+  S2_DCHECK_EQ(points.size(), u.size());
+  S2_DCHECK_EQ(points.size(), v.size());
+  for (size_t k = 0; k < points.size(); ++k) {
+    double x = points[k][0], y = points[k][1], z = points[k][2];
+    double ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+    // The axis selection must match S2Point::LargestAbsComponent() exactly.
+    bool x_axis = (ax > ay) & (ax > az);
+    bool y_axis = !(ax > ay) & (ay > az);
+    double w = x_axis ? x : (y_axis ? y : z);
+    bool neg = w < 0;
+    // See ValidFaceXYZtoUV() for the numerators used on each face.  Note that
+    // negating a numerator before dividing yields the same result as
+    // negating the quotient.
+    double nu = x_axis ? (neg ? z : y)
+                       : (y_axis ? (neg ? z : -x) : (neg ? -y : -x));
+    double nv = x_axis ? (neg ? y : z)
+                       : (y_axis ? (neg ? -x : z) : (neg ? -x : -y));
+    faces[k] = (x_axis ? 0 : (y_axis ? 1 : 2)) + 3 * neg;
+    u[k] = nu / w;
+    v[k] = nv / w;
+  }
+}
+
+void FaceUVtoXYZ(absl::Span<const int> faces, absl::Span<const double> u,
+                 absl::Span<const double> v, absl::Span<S2Point> points) {
+  S2_DCHECK_EQ(faces.size(), u.size());
+  S2_DCHECK_EQ(faces.size(), v.size());
+  S2_DCHECK_EQ(faces.size(), points.size());
+  for (size_t k = 0; k < faces.size(); ++k) {
+    int face = faces[k];
+    double uk = u[k], vk = v[k];
+    bool neg = face >= 3;
+    int axis = face - 3 * neg;
+    double s = neg ? -1 : 1;
+    // This is FaceUVtoXYZ(face, u, v) with the switch statement replaced by
+    // selections on the face axis and sign.
+    double x = (axis == 0) ? s : (neg ? vk : -uk);
+    double y = (axis == 1) ? s : (axis == 0) ? (neg ? -vk : uk)
+                                             : (neg ? uk : -vk);
+    double z = (axis == 2) ? s : (neg ? -uk : vk);
+    points[k] = S2Point(x, y, z);
+  }
+}
+
+void UVtoST(absl::Span<const double> u, absl::Span<double> s) {
+  S2_DCHECK_EQ(u.size(), s.size());
+  for (size_t k = 0; k < u.size(); ++k) {
+#if S2_PROJECTION == S2_QUADRATIC_PROJECTION
+    // Both branches of UVtoST() evaluate the same square root, since
+    // 1 - 3*u == 1 + 3*|u| exactly when u < 0.
+    double r = 0.5 * std::sqrt(1 + 3 * std::fabs(u[k]));
+    s[k] = (u[k] >= 0) ? r : 1 - r;
+#else
+    s[k] = UVtoST(u[k]);
+#endif
+  }
+}
+
+void STtoUV(absl::Span<const double> s, absl::Span<double> u) {
+  S2_DCHECK_EQ(s.size(), u.size());
+  for (size_t k = 0; k < s.size(); ++k) {
+#if S2_PROJECTION == S2_QUADRATIC_PROJECTION
+    // The two branches of STtoUV() are negations of each other after
+    // reflecting s about 0.5.
+    bool upper = s[k] >= 0.5;
+    double t = upper ? s[k] : 1 - s[k];
+    double r = (1/3.) * (4*t*t - 1);
+    u[k] = upper ? r : -r;
+#else
+    u[k] = STtoUV(s[k]);
+#endif
+  }
+}
+
+void GetFacePermutation(absl::Span<const int> faces,
+                        absl::Span<int> permutation, int face_begin[7]) {
+  S2_DCHECK_EQ(faces.size(), permutation.size());
+  // This is a counting sort.
+  int count[6] = {0, 0, 0, 0, 0, 0};
+  for (int face : faces) {
+    S2_DCHECK(face >= 0 && face < 6);
+    ++count[face];
+  }
+  face_begin[0] = 0;
+  for (int face = 0; face < 6; ++face) {
+    face_begin[face + 1] = face_begin[face] + count[face];
+  }
+  int next[6];
+  std::copy(face_begin, face_begin + 6, next);
+  for (int k = 0; k < faces.size(); ++k) {
+    permutation[next[faces[k]]++] = k;
+  }
+}
+
 }  // namespace S2
@@ -104,6 +104,7 @@
 #include "s2/r2.h"
 #include "s2/s2coords_internal.h"
 #include "s2/s2point.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/util/math/mathutil.h"
 
 // S2 is a namespace for constants and simple utility functions that are used
@@ -221,6 +222,31 @@ S2Point GetUVWAxis(int face, int axis);
 // face that is adjacent to face 4 in the positive u-axis direction.
 int GetUVWFace(int face, int axis, int direction);
 
+// Batch versions of XYZtoFaceUV(), FaceUVtoXYZ(), UVtoST(), and STtoUV().
+// These return exactly the same results as the functions above, but select
+// the face and the coordinates using arithmetic rather than branches so
+// that the compiler can vectorize the loops.  Each output element
+// corresponds to the input element(s) at the same index.
+//
+// REQUIRES: All spans passed to a given function have the same size.
+// (The input and output of UVtoST() and STtoUV() may be the same span.)
+void XYZtoFaceUV(absl::Span<const S2Point> points, absl::Span<int> faces,
+                 absl::Span<double> u, absl::Span<double> v);
+void FaceUVtoXYZ(absl::Span<const int> faces, absl::Span<const double> u,
+                 absl::Span<const double> v, absl::Span<S2Point> points);
+void UVtoST(absl::Span<const double> u, absl::Span<double> s);
+void STtoUV(absl::Span<const double> s, absl::Span<double> u);
+
+// Computes a permutation of the indices of "faces" that groups them by face,
+// preserving their original order within each face.  On return, the indices
+// with face "f" are permutation[face_begin[f] .. face_begin[f + 1] - 1].
+// This is useful for processing a batch of points one face at a time (e.g.
+// when clipping edges to faces).
+//
+// REQUIRES: permutation.size() == faces.size()
+void GetFacePermutation(absl::Span<const int> faces,
+                        absl::Span<int> permutation, int face_begin[7]);
+
 
 //////////////////   Implementation details follow   ////////////////////
 
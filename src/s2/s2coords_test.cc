@@ -18,6 +18,7 @@
 #include "s2/s2coords.h"
 
 #include <cmath>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/s2cell_id.h"
@@ -216,3 +217,54 @@ TEST(S2, UVWFace) {
     }
   }
 }
+
+TEST(S2, BatchConversionsMatchScalar) {
+  // Include points on the boundaries between faces, where the face selection
+  // depends on exactly how ties are broken.
+  std::vector<S2Point> points = {
+    S2Point(1, 0, 0), S2Point(0, -1, 0), S2Point(0, 0, 1),
+    S2Point(1, 1, 0), S2Point(-1, 0, -1), S2Point(0, 1, -1),
+    S2Point(1, 1, 1), S2Point(-1, -1, -1), S2Point(-1, 1, -1),
+    S2Point(-0.0, 0.0, -1), S2Point(0.5, -0.5, 0.5),
+  };
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(S2Testing::RandomPoint());
+  }
+  int n = points.size();
+  std::vector<int> faces(n);
+  std::vector<double> u(n), v(n), s(n), t(n);
+  std::vector<S2Point> xyz(n);
+  S2::XYZtoFaceUV(points, absl::MakeSpan(faces), absl::MakeSpan(u),
+                  absl::MakeSpan(v));
+  S2::FaceUVtoXYZ(faces, u, v, absl::MakeSpan(xyz));
+  S2::UVtoST(u, absl::MakeSpan(s));
+  S2::UVtoST(v, absl::MakeSpan(t));
+  for (int k = 0; k < n; ++k) {
+    double expected_u, expected_v;
+    EXPECT_EQ(S2::XYZtoFaceUV(points[k], &expected_u, &expected_v), faces[k]);
+    EXPECT_EQ(expected_u, u[k]);
+    EXPECT_EQ(expected_v, v[k]);
+    EXPECT_EQ(S2::FaceUVtoXYZ(faces[k], u[k], v[k]), xyz[k]);
+    EXPECT_EQ(S2::UVtoST(u[k]), s[k]);
+    EXPECT_EQ(S2::UVtoST(v[k]), t[k]);
+  }
+  // Check STtoUV in place, including the boundary values.
+  s.insert(s.end(), {0.0, 0.5, 1.0});
+  std::vector<double> st = s;
+  S2::STtoUV(st, absl::MakeSpan(st));
+  for (int k = 0; k < s.size(); ++k) {
+    EXPECT_EQ(S2::STtoUV(s[k]), st[k]);
+  }
+}
+
+TEST(S2, GetFacePermutation) {
+  std::vector<int> faces = {3, 0, 5, 3, 1, 0, 3};
+  std::vector<int> permutation(faces.size());
+  int face_begin[7];
+  S2::GetFacePermutation(faces, absl::MakeSpan(permutation), face_begin);
+  EXPECT_EQ(std::vector<int>({1, 5, 4, 0, 3, 6, 2}), permutation);
+  const int kExpectedBegin[7] = {0, 2, 3, 3, 6, 6, 7};
+  for (int face = 0; face <= 6; ++face) {
+    EXPECT_EQ(kExpectedBegin[face], face_begin[face]);
+  }
+}
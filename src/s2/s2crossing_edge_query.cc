@@ -20,11 +20,16 @@
 #include <algorithm>
 #include <vector>
 
+#include "s2/base/casts.h"
 #include "s2/base/logging.h"
 #include "s2/r1interval.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2edge_clipping.h"
 #include "s2/s2edge_crosser.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point_soa.h"
+#include "s2/s2predicates.h"
+#include "s2/s2query_listener.h"
 #include "s2/s2shapeutil_count_edges.h"
 
 using s2shapeutil::ShapeEdge;
@@ -35,6 +40,19 @@ using std::vector;
 // determined using the benchmarks in the unit test.
 static const int kMaxBruteForceEdges = 27;
 
+// Sets "edges" to the edges of the given index cell, which are sorted and
+// unique.
+static void GetCellEdges(const S2ShapeIndexCell& cell,
+                         vector<ShapeEdgeId>* edges) {
+  edges->clear();
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = cell.clipped(s);
+    for (int j = 0; j < clipped.num_edges(); ++j) {
+      edges->push_back(ShapeEdgeId(clipped.shape_id(), clipped.edge(j)));
+    }
+  }
+}
+
 S2CrossingEdgeQuery::S2CrossingEdgeQuery() {
 }
 
@@ -64,13 +82,20 @@ vector<s2shapeutil::ShapeEdge> S2CrossingEdgeQuery::GetCrossingEdges(
 void S2CrossingEdgeQuery::GetCrossingEdges(
     const S2Point& a0, const S2Point& a1, CrossingType type,
     vector<ShapeEdge>* edges) {
+  S2QueryTimer timer(S2QueryListener::Operation::CROSSING_EDGES);
   edges->clear();
   GetCandidates(a0, a1, &tmp_candidates_);
+  if (S2QueryStats* stats = timer.extra_stats()) {
+    stats->num_edges_tested = tmp_candidates_.size();
+  }
+  FindNoncrossingCandidates(a0, a1, nullptr);
   int min_sign = (type == CrossingType::ALL) ? 0 : 1;
   S2CopyingEdgeCrosser crosser(a0, a1);
   int shape_id = -1;
   const S2Shape* shape = nullptr;
-  for (ShapeEdgeId candidate : tmp_candidates_) {
+  for (int i = 0; i < tmp_candidates_.size(); ++i) {
+    if (!tmp_noncrossing_.empty() && tmp_noncrossing_[i]) continue;
+    ShapeEdgeId candidate = tmp_candidates_[i];
     if (candidate.shape_id != shape_id) {
       shape_id = candidate.shape_id;
       shape = index_->shape(shape_id);
@@ -86,12 +111,18 @@ void S2CrossingEdgeQuery::GetCrossingEdges(
 void S2CrossingEdgeQuery::GetCrossingEdges(
     const S2Point& a0, const S2Point& a1, const S2Shape& shape,
     CrossingType type, vector<ShapeEdge>* edges) {
+  S2QueryTimer timer(S2QueryListener::Operation::CROSSING_EDGES);
   edges->clear();
   GetCandidates(a0, a1, shape, &tmp_candidates_);
+  if (S2QueryStats* stats = timer.extra_stats()) {
+    stats->num_edges_tested = tmp_candidates_.size();
+  }
+  FindNoncrossingCandidates(a0, a1, &shape);
   int min_sign = (type == CrossingType::ALL) ? 0 : 1;
   S2CopyingEdgeCrosser crosser(a0, a1);
-  for (ShapeEdgeId candidate : tmp_candidates_) {
-    int edge_id = candidate.edge_id;
+  for (int i = 0; i < tmp_candidates_.size(); ++i) {
+    if (!tmp_noncrossing_.empty() && tmp_noncrossing_[i]) continue;
+    int edge_id = tmp_candidates_[i].edge_id;
     S2Shape::Edge b = shape.edge(edge_id);
     if (crosser.CrossingSign(b.v0, b.v1) >= min_sign) {
       edges->push_back(ShapeEdge(shape.id(), edge_id, b));
@@ -99,6 +130,119 @@ void S2CrossingEdgeQuery::GetCrossingEdges(
   }
 }
 
+void S2CrossingEdgeQuery::GetPolylineCrossings(
+    const vector<S2PointSpan>& polylines, CrossingType type,
+    vector<PolylineCrossing>* output) {
+  // Sort the polyline edges by the S2CellId of their first vertex, so that
+  // consecutive edges tend to fall in the same index cell.
+  struct SortedEdge {
+    S2CellId id;
+    int32 polyline_id, edge_id;
+    bool operator<(const SortedEdge& other) const { return id < other.id; }
+  };
+  vector<SortedEdge> sorted;
+  for (int p = 0; p < polylines.size(); ++p) {
+    for (int e = 0; e + 1 < static_cast<int>(polylines[p].size()); ++e) {
+      sorted.push_back(SortedEdge{S2CellId(polylines[p][e]), p, e});
+    }
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  const size_t output_begin = output->size();
+  const int min_sign = (type == CrossingType::ALL) ? 0 : 1;
+  S2CellId cell_id = S2CellId::None();
+  vector<ShapeEdgeId> cell_edges;
+  for (const SortedEdge& edge : sorted) {
+    const S2Point& a0 = polylines[edge.polyline_id][edge.edge_id];
+    const S2Point& a1 = polylines[edge.polyline_id][edge.edge_id + 1];
+    // If the index cell containing a0 also contains a1, then it contains the
+    // entire edge (since cells are convex) and its edges are the candidates.
+    const vector<ShapeEdgeId>* candidates = &cell_edges;
+    S2CellId a1_id(a1);
+    if (cell_id == S2CellId::None() || !cell_id.contains(edge.id) ||
+        !cell_id.contains(a1_id)) {
+      if (iter_.Locate(a0) && iter_.id().contains(a1_id)) {
+        cell_id = iter_.id();
+        GetCellEdges(iter_.cell(), &cell_edges);
+      } else {
+        GetCandidates(a0, a1, &tmp_candidates_);
+        candidates = &tmp_candidates_;
+      }
+    }
+    S2CopyingEdgeCrosser crosser(a0, a1);
+    int shape_id = -1;
+    const S2Shape* shape = nullptr;
+    for (ShapeEdgeId candidate : *candidates) {
+      if (candidate.shape_id != shape_id) {
+        shape_id = candidate.shape_id;
+        shape = index_->shape(shape_id);
+      }
+      S2Shape::Edge b = shape->edge(candidate.edge_id);
+      if (crosser.CrossingSign(b.v0, b.v1) >= min_sign) {
+        output->push_back(
+            PolylineCrossing(edge.polyline_id, edge.edge_id, candidate));
+      }
+    }
+  }
+  std::sort(output->begin() + output_begin, output->end(),
+            [](const PolylineCrossing& x, const PolylineCrossing& y) {
+      if (x.polyline_id != y.polyline_id) return x.polyline_id < y.polyline_id;
+      if (x.edge_id != y.edge_id) return x.edge_id < y.edge_id;
+      return x.index_edge < y.index_edge;
+    });
+}
+
+// Sets tmp_noncrossing_[i] to true if candidate "i" is an edge of an
+// S2SoALaxPolylineShape whose endpoints are definitely on the same side of
+// the great circle through A0A1.  S2EdgeCrosser::CrossingSign() returns -1
+// for such edges, so they can be skipped without changing the results.  The
+// orientation tests are done in batches (one per shape) so that they can be
+// vectorized.  Otherwise tmp_noncrossing_ is left empty.  If "shape" is not
+// nullptr then all candidates belong to that shape.
+void S2CrossingEdgeQuery::FindNoncrossingCandidates(const S2Point& a0,
+                                                    const S2Point& a1,
+                                                    const S2Shape* shape) {
+  tmp_noncrossing_.clear();
+  const Vector3_d a_cross_b = a0.CrossProd(a1);
+  const int n = tmp_candidates_.size();
+  for (int begin = 0, end; begin < n; begin = end) {
+    int shape_id = tmp_candidates_[begin].shape_id;
+    for (end = begin + 1;
+         end < n && tmp_candidates_[end].shape_id == shape_id; ++end) {
+      continue;
+    }
+    const S2Shape* b = (shape != nullptr) ? shape : index_->shape(shape_id);
+    if (b->type_tag() != S2SoALaxPolylineShape::kTypeTag) continue;
+    const S2PointSoA& vertices =
+        down_cast<const S2SoALaxPolylineShape*>(b)->vertices();
+    if (tmp_noncrossing_.empty()) tmp_noncrossing_.resize(n, false);
+
+    // Gather the first endpoints of the candidate edges followed by their
+    // second endpoints, and classify them all at once.
+    const int count = end - begin;
+    tmp_coords_.resize(6 * count);
+    double* x = tmp_coords_.data();
+    double* y = x + 2 * count;
+    double* z = y + 2 * count;
+    for (int i = 0; i < count; ++i) {
+      int e = tmp_candidates_[begin + i].edge_id;
+      x[i] = vertices.x()[e];
+      y[i] = vertices.y()[e];
+      z[i] = vertices.z()[e];
+      x[count + i] = vertices.x()[e + 1];
+      y[count + i] = vertices.y()[e + 1];
+      z[count + i] = vertices.z()[e + 1];
+    }
+    tmp_signs_.resize(2 * count);
+    s2pred::TriageSigns(a0, a1, a_cross_b, x, y, z, 2 * count,
+                        tmp_signs_.data());
+    for (int i = 0; i < count; ++i) {
+      int sign0 = tmp_signs_[i], sign1 = tmp_signs_[count + i];
+      tmp_noncrossing_[begin + i] = (sign0 == sign1 && sign0 != 0);
+    }
+  }
+}
+
 vector<ShapeEdgeId> S2CrossingEdgeQuery::GetCandidates(
     const S2Point& a0, const S2Point& a1) {
   vector<ShapeEdgeId> edges;
@@ -148,6 +292,37 @@ void S2CrossingEdgeQuery::GetCandidates(const S2Point& a0, const S2Point& a1,
   }
 }
 
+bool S2CrossingEdgeQuery::VisitChainCandidates(
+    S2PointSpan vertices, const ChainCandidatesVisitor& visitor) {
+  // The index cell that contains the current chain vertex (if any), and the
+  // edges of that cell.
+  S2CellId cell_id = S2CellId::None();
+  vector<ShapeEdgeId> cell_edges, edges;
+  bool small_index = s2shapeutil::CountEdgesUpTo(
+      *index_, kMaxBruteForceEdges + 1) <= kMaxBruteForceEdges;
+  for (int i = 0; i + 1 < static_cast<int>(vertices.size()); ++i) {
+    const S2Point& a0 = vertices[i];
+    const S2Point& a1 = vertices[i + 1];
+    // "cell_id" contains a0 by construction, so if it also contains a1 then
+    // it contains the entire edge.
+    if (cell_id != S2CellId::None() && cell_id.contains(S2CellId(a1))) {
+      if (!visitor(i, cell_edges)) return false;
+      continue;
+    }
+    GetCandidates(a0, a1, &edges);
+    if (!visitor(i, edges)) return false;
+    // Remember the cell containing the end of this edge, which is the start
+    // of the next edge.  This is pointless when the index is small, since
+    // GetCandidates() then returns all edges without clipping.
+    cell_id = S2CellId::None();
+    if (!small_index && iter_.Locate(a1)) {
+      cell_id = iter_.id();
+      GetCellEdges(iter_.cell(), &cell_edges);
+    }
+  }
+  return true;
+}
+
 bool S2CrossingEdgeQuery::VisitRawCandidates(
     const S2Point& a0, const S2Point& a1, const ShapeEdgeIdVisitor& visitor) {
   int num_edges = s2shapeutil::CountEdgesUpTo(*index_, kMaxBruteForceEdges + 1);
@@ -21,12 +21,15 @@
 #include <type_traits>
 #include <vector>
 
+#include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/base/macros.h"
 #include "s2/third_party/absl/container/inlined_vector.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/r2.h"
 #include "s2/r2rect.h"
 #include "s2/s2padded_cell.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_shape_edge.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
@@ -104,6 +107,30 @@ class S2CrossingEdgeQuery {
                         const S2Shape& shape, CrossingType type,
                         std::vector<s2shapeutil::ShapeEdge>* edges);
 
+  // A crossing between edge "edge_id" of polyline "polyline_id" of a batch
+  // (see GetPolylineCrossings) and the index edge "index_edge".
+  struct PolylineCrossing {
+    int32 polyline_id;
+    int32 edge_id;
+    s2shapeutil::ShapeEdgeId index_edge;
+
+    PolylineCrossing(int32 _polyline_id, int32 _edge_id,
+                     s2shapeutil::ShapeEdgeId _index_edge)
+        : polyline_id(_polyline_id), edge_id(_edge_id),
+          index_edge(_index_edge) {}
+  };
+
+  // Appends to "output" every crossing of the given CrossingType between an
+  // edge of one of the given polylines and an edge of the index.  This is
+  // equivalent to calling GetCrossingEdges() for every polyline edge, but
+  // is much faster for large batches: the polyline edges are sorted by
+  // S2CellId so that the index is swept once, and the edges of each index
+  // cell are reused for all polyline edges that lie within that cell.
+  // Crossings are sorted by (polyline_id, edge_id, index_edge).
+  void GetPolylineCrossings(const std::vector<S2PointSpan>& polylines,
+                            CrossingType type,
+                            std::vector<PolylineCrossing>* output);
+
 
   /////////////////////////// Low-Level Methods ////////////////////////////
   //
@@ -131,6 +158,28 @@ class S2CrossingEdgeQuery {
   void GetCandidates(const S2Point& a0, const S2Point& a1, const S2Shape& shape,
                      std::vector<s2shapeutil::ShapeEdgeId>* edges);
 
+  // A function that is called with the candidates for the edge
+  // (vertices[i], vertices[i+1]) of a chain (see VisitChainCandidates).  The
+  // function may return false in order to request that the algorithm should
+  // be terminated.
+  using ChainCandidatesVisitor = std::function<
+    bool (int i, const std::vector<s2shapeutil::ShapeEdgeId>& candidates)>;
+
+  // Visits each edge of the chain formed by the given vertices in order,
+  // together with a sorted, unique superset of the index edges that
+  // intersect it.  This is equivalent to calling GetCandidates() for each
+  // edge, but is much faster for dense chains such as GPS tracks: whenever
+  // both endpoints of an edge lie in the index cell that contained the end
+  // of the previous edge, the edge lies entirely within that cell (since
+  // cells are convex), so the cell's edges are reused as the candidates
+  // without clipping the edge through the index again.  Returns false if
+  // the visitor terminated the traversal.
+  //
+  // Note that the candidate sets may differ from those of GetCandidates(),
+  // although both are supersets of the crossing edges.
+  bool VisitChainCandidates(S2PointSpan vertices,
+                            const ChainCandidatesVisitor& visitor);
+
   // A function that is called with each candidate intersecting edge.  The
   // function may return false in order to request that the algorithm should
   // be terminated, i.e. no further crossings are needed.
@@ -189,6 +238,8 @@ class S2CrossingEdgeQuery {
                    R2Rect child_bounds[2]) const;
   static void SplitBound(const R2Rect& edge_bound, int u_end, double u,
                          int v_end, double v, R2Rect child_bounds[2]);
+  void FindNoncrossingCandidates(const S2Point& a0, const S2Point& a1,
+                                 const S2Shape* shape);
 
   const S2ShapeIndex* index_ = nullptr;
 
@@ -200,6 +251,9 @@ class S2CrossingEdgeQuery {
 
   // Avoids repeated allocation when methods are called many times.
   std::vector<s2shapeutil::ShapeEdgeId> tmp_candidates_;
+  std::vector<bool> tmp_noncrossing_;
+  std::vector<double> tmp_coords_;
+  std::vector<int8> tmp_signs_;
 };
 
 
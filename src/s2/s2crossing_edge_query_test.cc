@@ -33,6 +33,7 @@
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2edge_vector_shape.h"
+#include "s2/s2lax_polyline_shape.h"
 #include "s2/s2metrics.h"
 #include "s2/s2polyline.h"
 #include "s2/s2testing.h"
@@ -325,4 +326,115 @@ TEST(GetCrossings, ShapeIdsAreCorrect) {
   TestPolylineCrossings(index, MakePoint("1:-10"), MakePoint("1:30"));
 }
 
+TEST(GetCrossings, SoALaxPolylineShapeMatchesPolyline) {
+  // Checks that the edges skipped using the batched orientation tests for
+  // S2SoALaxPolylineShape do not change the results.
+  auto polyline = make_unique<S2Polyline>(S2Testing::MakeRegularPoints(
+      MakePoint("0:0"), S1Angle::Degrees(5), 500));
+  MutableS2ShapeIndex index, soa_index;
+  soa_index.Add(make_unique<S2SoALaxPolylineShape>(*polyline));
+  index.Add(make_unique<S2Polyline::OwningShape>(std::move(polyline)));
+  S2CrossingEdgeQuery query(&index), soa_query(&soa_index);
+  S2Cap cap(MakePoint("0:0"), S1Angle::Degrees(10));
+  for (int iter = 0; iter < 100; ++iter) {
+    S2Point a0 = S2Testing::SamplePoint(cap);
+    S2Point a1 = S2Testing::SamplePoint(cap);
+    for (CrossingType type : {CrossingType::ALL, CrossingType::INTERIOR}) {
+      vector<ShapeEdge> expected = query.GetCrossingEdges(a0, a1, type);
+      vector<ShapeEdge> actual = soa_query.GetCrossingEdges(a0, a1, type);
+      vector<ShapeEdge> shape_actual = soa_query.GetCrossingEdges(
+          a0, a1, *soa_index.shape(0), type);
+      ASSERT_EQ(expected.size(), actual.size());
+      ASSERT_EQ(expected.size(), shape_actual.size());
+      for (int i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].id(), actual[i].id());
+        EXPECT_EQ(expected[i].id(), shape_actual[i].id());
+      }
+    }
+  }
+}
+
+TEST(VisitChainCandidates, CandidatesIncludeAllCrossings) {
+  // A dense chain of short edges (like a GPS track) against an index where
+  // most cells are small relative to the chain edges and some are large.
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Polyline::OwningShape>(
+      make_unique<S2Polyline>(S2Testing::MakeRegularPoints(
+          MakePoint("0:0"), S1Angle::Degrees(5), 1000))));
+  index.Add(make_unique<S2Polyline::OwningShape>(
+      make_unique<S2Polyline>(S2Testing::MakeRegularPoints(
+          MakePoint("1:1"), S1Angle::Degrees(2), 50))));
+  vector<S2Point> chain = {MakePoint("0:-8")};
+  for (int i = 0; i < 2000; ++i) {
+    chain.push_back(S2::InterpolateAtDistance(S1Angle::Degrees(0.02),
+        chain.back(), S2Testing::RandomPoint()));
+  }
+  S2CrossingEdgeQuery query(&index);
+  int num_edges = 0;
+  EXPECT_TRUE(query.VisitChainCandidates(
+      chain, [&](int i, const vector<ShapeEdgeId>& candidates) {
+        EXPECT_EQ(num_edges++, i);
+        EXPECT_TRUE(std::is_sorted(candidates.begin(), candidates.end()));
+        EXPECT_TRUE(std::adjacent_find(candidates.begin(), candidates.end())
+                    == candidates.end());
+        S2CrossingEdgeQuery check_query(&index);
+        for (const auto& edge : check_query.GetCrossingEdges(
+                 chain[i], chain[i + 1], CrossingType::ALL)) {
+          EXPECT_TRUE(std::binary_search(candidates.begin(), candidates.end(),
+                                         edge.id()));
+        }
+        return true;
+      }));
+  EXPECT_EQ(chain.size() - 1, num_edges);
+
+  // The visitor can stop the traversal early.
+  num_edges = 0;
+  EXPECT_FALSE(query.VisitChainCandidates(
+      chain, [&](int i, const vector<ShapeEdgeId>& candidates) {
+        return ++num_edges < 10;
+      }));
+  EXPECT_EQ(10, num_edges);
+}
+
+TEST(GetPolylineCrossings, MatchesGetCrossingEdges) {
+  MutableS2ShapeIndex index;
+  S2Cap cap(MakePoint("0:0"), S1Angle::Degrees(5));
+  for (int i = 0; i < 20; ++i) {
+    index.Add(make_unique<S2Polyline::OwningShape>(
+        make_unique<S2Polyline>(S2Testing::MakeRegularPoints(
+            S2Testing::SamplePoint(cap), S1Angle::Degrees(1), 50))));
+  }
+  vector<vector<S2Point>> polylines(100);
+  for (auto& polyline : polylines) {
+    polyline.push_back(S2Testing::SamplePoint(cap));
+    for (int i = 0; i < 20; ++i) {
+      polyline.push_back(S2::InterpolateAtDistance(
+          S1Angle::Degrees(0.5), polyline.back(),
+          S2Testing::SamplePoint(cap)));
+    }
+  }
+  vector<S2PointSpan> spans(polylines.begin(), polylines.end());
+  S2CrossingEdgeQuery query(&index);
+  for (CrossingType type : {CrossingType::ALL, CrossingType::INTERIOR}) {
+    vector<S2CrossingEdgeQuery::PolylineCrossing> expected, actual;
+    for (int p = 0; p < polylines.size(); ++p) {
+      for (int e = 0; e + 1 < polylines[p].size(); ++e) {
+        for (const auto& edge : query.GetCrossingEdges(
+                 polylines[p][e], polylines[p][e + 1], type)) {
+          expected.push_back(
+              S2CrossingEdgeQuery::PolylineCrossing(p, e, edge.id()));
+        }
+      }
+    }
+    query.GetPolylineCrossings(spans, type, &actual);
+    EXPECT_FALSE(expected.empty());
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].polyline_id, actual[i].polyline_id);
+      EXPECT_EQ(expected[i].edge_id, actual[i].edge_id);
+      EXPECT_EQ(expected[i].index_edge, actual[i].index_edge);
+    }
+  }
+}
+
 }  // namespace
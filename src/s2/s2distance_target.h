@@ -20,7 +20,12 @@
 
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
+#include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
+
+class S2PointSoA;
 
 // S2DistanceTarget represents a geometric object to which distances are
 // measured.  For example, there are subtypes for measuring distances to a
@@ -107,6 +112,19 @@ class S2DistanceTarget {
   // returns false.
   virtual bool UpdateMinDistance(const S2Cell& cell, Distance* min_dist) = 0;
 
+  // Equivalent to calling UpdateMinDistance(edges[i].v0, edges[i].v1,
+  // &min_dists[i]) and setting updated[i] to the result, for every edge.
+  // Subtypes may override this method to process the edges more efficiently
+  // (e.g., using loops that can be vectorized).
+  //
+  // REQUIRES: "min_dists" and "updated" have room for edges.size() values.
+  virtual void UpdateMinDistances(absl::Span<const S2Shape::Edge> edges,
+                                  Distance* min_dists, bool* updated) {
+    for (int i = 0; i < edges.size(); ++i) {
+      updated[i] = UpdateMinDistance(edges[i].v0, edges[i].v1, &min_dists[i]);
+    }
+  }
+
   // Finds all polygons in the given "query_index" that completely contain a
   // connected component of the target geometry.  (For example, if the
   // target consists of 10 points, this method finds polygons that contain
@@ -160,6 +178,19 @@ class S2DistanceTarget {
   //
   // By default this method returns -1, indicating that it is not implemented.
   virtual int max_brute_force_index_size() const { return -1; }
+
+  // Sets distances[i] to the distance to the point points[ids[i]] for
+  // 0 <= i < n, and returns true.  The distances must be the same as those
+  // computed by UpdateMinDistance(p, p, min_dist) for each point "p".  This
+  // allows queries to compute the distances to many points using vectorized
+  // loops.
+  //
+  // By default this method returns false, indicating that it is not
+  // implemented.
+  virtual bool GetPointDistances(const S2PointSoA& points, const int32* ids,
+                                 int n, Distance* distances) {
+    return false;
+  }
 };
 
 #endif  // S2_S2DISTANCE_TARGET_H_
@@ -18,6 +18,8 @@
 #include <cmath>
 #include <algorithm>
 
+#include "s2/base/logging.h"
+
 namespace {
 
 // http://en.wikipedia.org/wiki/Haversine_formula
@@ -29,8 +31,63 @@ double Haversine(const double radians) {
   return sinHalf * sinHalf;
 }
 
+// Distances (in radians) up to this value are converted to and from
+// S1ChordAngles using the series expansions below.  The truncation error of
+// both series is below 1e-16 (relative) throughout this range.
+const double kMaxSeriesRadians = 0.1;
+const double kMaxSeriesLength2 = 0.01;
+
 }  // namespace
 
+void S2Earth::ToChordAngles(absl::Span<const double> meters,
+                            absl::Span<S1ChordAngle> chord_angles) {
+  S2_DCHECK_EQ(meters.size(), chord_angles.size());
+  const double inv_radius = 1 / RadiusMeters();
+  for (size_t i = 0; i < meters.size(); ++i) {
+    const double x = meters[i] * inv_radius;
+    if (x >= 0 && x <= kMaxSeriesRadians) {
+      // (2 * sin(x / 2)) ** 2 == 2 * (1 - cos(x)), expanded as a polynomial
+      // in x**2 and evaluated using Horner's rule.
+      const double x2 = x * x;
+      double p = 1.0 / 1814400;
+      p = 1.0 / 20160 - x2 * p;
+      p = 1.0 / 360 - x2 * p;
+      p = 1.0 / 12 - x2 * p;
+      p = 1 - x2 * p;
+      const double length2 = x2 * p;
+      chord_angles[i] = S1ChordAngle::FromLength2(length2);
+    } else {
+      chord_angles[i] =
+          S1ChordAngle(S1Angle::Radians(MetersToRadians(meters[i])));
+    }
+  }
+}
+
+void S2Earth::ToMeters(absl::Span<const S1ChordAngle> chord_angles,
+                       absl::Span<double> meters) {
+  S2_DCHECK_EQ(chord_angles.size(), meters.size());
+  const double radius = RadiusMeters();
+  for (size_t i = 0; i < chord_angles.size(); ++i) {
+    const double length2 = chord_angles[i].length2();
+    if (length2 >= 0 && length2 <= kMaxSeriesLength2) {
+      // 2 * asin(s) where s = sqrt(length2) / 2, expanded as s times a
+      // polynomial in s**2.
+      const double s = 0.5 * sqrt(length2);
+      const double s2 = s * s;
+      double p = 231.0 / 13312;
+      p = 63.0 / 2816 + s2 * p;
+      p = 35.0 / 1152 + s2 * p;
+      p = 5.0 / 112 + s2 * p;
+      p = 3.0 / 40 + s2 * p;
+      p = 1.0 / 6 + s2 * p;
+      p = 1 + s2 * p;
+      meters[i] = 2 * s * p * radius;
+    } else {
+      meters[i] = ToMeters(chord_angles[i]);
+    }
+  }
+}
+
 double S2Earth::ToLongitudeRadians(const util::units::Meters& distance,
                                    double latitude_radians) {
   double scalar = cos(latitude_radians);
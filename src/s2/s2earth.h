@@ -26,6 +26,7 @@
 #include "s2/s1chord_angle.h"
 #include "s2/s2latlng.h"
 #include "s2/s2point.h"
+#include "s2/third_party/absl/types/span.h"
 #include "s2/util/units/length-units.h"
 
 class S2Earth {
@@ -57,6 +58,19 @@ class S2Earth {
   inline static double MetersToRadians(double meters);
   inline static double RadiansToMeters(double radians);
 
+  // Batch conversions between distances in meters and S1ChordAngles.  These
+  // are equivalent to calling MetersToRadians() followed by the S1ChordAngle
+  // constructor, or ToMeters(), on each element (to within a few ULPs).  Note
+  // that the distances are doubles rather than (single-precision)
+  // util::units::Meters.  Short distances (up to about 600km) are
+  // converted using polynomial approximations rather than trigonometric
+  // functions.  This is useful when converting many distance limits or query
+  // results at once.  The input and output spans must have the same size.
+  static void ToChordAngles(absl::Span<const double> meters,
+                            absl::Span<S1ChordAngle> chord_angles);
+  static void ToMeters(absl::Span<const S1ChordAngle> chord_angles,
+                       absl::Span<double> meters);
+
   // These functions convert between areas on the unit sphere
   // (as returned by the S2 library) and areas on the Earth's surface.
   // Note that the area of a region on the unit sphere is equal to the
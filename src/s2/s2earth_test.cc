@@ -18,6 +18,7 @@
 #include "s2/s2earth.h"
 
 #include <cmath>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/util/units/physical-units.h"
@@ -144,3 +145,25 @@ TEST(S2EarthTest, TestGetDistance) {
                                               S2LatLng::FromDegrees(55, -153)),
                    1000 * S2Earth::RadiusKm() * M_PI / 4);
 }
+
+TEST(S2EarthTest, TestBatchChordAngleConversion) {
+  // Include values on both sides of the series approximation threshold, as
+  // well as the special values handled by the scalar conversions.
+  std::vector<double> meters = {0, 1e-3, 1, 1000, 1e5, 6e5, 6.3e5, 6.4e5,
+                                6.5e5, 1e6, 5e6, 1e7, 2e7, -1};
+  for (double m = 1; m < 4e7; m *= 1.1) meters.push_back(m);
+  std::vector<S1ChordAngle> chord_angles(meters.size());
+  S2Earth::ToChordAngles(meters, absl::MakeSpan(chord_angles));
+  std::vector<double> round_trip(meters.size());
+  S2Earth::ToMeters(chord_angles, absl::MakeSpan(round_trip));
+  for (size_t i = 0; i < meters.size(); ++i) {
+    S1ChordAngle expected(
+        S1Angle::Radians(S2Earth::MetersToRadians(meters[i])));
+    EXPECT_NEAR(expected.length2(), chord_angles[i].length2(),
+                1e-15 * std::fabs(expected.length2())) << meters[i];
+    double expected_meters = S2Earth::ToMeters(chord_angles[i]);
+    EXPECT_NEAR(expected_meters, round_trip[i],
+                1e-15 * std::fabs(expected_meters)) << meters[i];
+  }
+  EXPECT_TRUE(chord_angles[13].is_special());  // -1 meters
+}
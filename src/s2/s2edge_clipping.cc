@@ -28,6 +28,8 @@
 
 namespace S2 {
 
+using absl::MakeSpan;
+using absl::Span;
 using std::fabs;
 using std::max;
 using std::min;
@@ -371,6 +373,47 @@ bool ClipToPaddedFace(const S2Point& a_xyz, const S2Point& b_xyz, int face,
   return a_score + b_score < 3;
 }
 
+int ClipEdgesToPaddedFaces(Span<const S2Point> a, Span<const S2Point> b,
+                           double padding, Span<FaceClippedEdge> clipped) {
+  S2_DCHECK_EQ(a.size(), b.size());
+  S2_DCHECK_GE(clipped.size(), 6 * a.size());
+  S2_DCHECK_GT(padding, 0);
+  static const int kBatchSize = 64;
+  int a_face[kBatchSize], b_face[kBatchSize];
+  double a_u[kBatchSize], a_v[kBatchSize], b_u[kBatchSize], b_v[kBatchSize];
+  const double kMaxUV = 1 - padding;
+  int num_clipped = 0;
+  for (int begin = 0; begin < a.size(); begin += kBatchSize) {
+    int n = min<int>(kBatchSize, a.size() - begin);
+    S2::XYZtoFaceUV(a.subspan(begin, n), MakeSpan(a_face, n),
+                    MakeSpan(a_u, n), MakeSpan(a_v, n));
+    S2::XYZtoFaceUV(b.subspan(begin, n), MakeSpan(b_face, n),
+                    MakeSpan(b_u, n), MakeSpan(b_v, n));
+    for (int k = 0; k < n; ++k) {
+      int e = begin + k;
+      double max_uv = max(max(fabs(a_u[k]), fabs(a_v[k])),
+                          max(fabs(b_u[k]), fabs(b_v[k])));
+      if (a_face[k] == b_face[k] && max_uv <= kMaxUV) {
+        FaceClippedEdge* out = &clipped[num_clipped++];
+        out->edge = e;
+        out->face = a_face[k];
+        out->a = R2Point(a_u[k], a_v[k]);
+        out->b = R2Point(b_u[k], b_v[k]);
+        continue;
+      }
+      for (int face = 0; face < 6; ++face) {
+        FaceClippedEdge* out = &clipped[num_clipped];
+        if (ClipToPaddedFace(a[e], b[e], face, padding, &out->a, &out->b)) {
+          out->edge = e;
+          out->face = face;
+          ++num_clipped;
+        }
+      }
+    }
+  }
+  return num_clipped;
+}
+
 bool IntersectsRect(const R2Point& a, const R2Point& b, const R2Rect& rect) {
   // First check whether the bound of AB intersects "rect".
   R2Rect bound = R2Rect::FromPointPair(a, b);
@@ -36,6 +36,7 @@
 #include "s2/r2.h"
 #include "s2/r2rect.h"
 #include "s2/s2point.h"
+#include "s2/third_party/absl/types/span.h"
 
 namespace S2 {
 
@@ -75,6 +76,31 @@ bool ClipToFace(const S2Point& a, const S2Point& b, int face,
 bool ClipToPaddedFace(const S2Point& a, const S2Point& b, int face,
                       double padding, R2Point* a_uv, R2Point* b_uv);
 
+// FaceClippedEdge represents edge "edge" of a batch of edges clipped to the
+// padded cube face "face" (see ClipEdgesToPaddedFaces).
+struct FaceClippedEdge {
+  int edge;
+  int face;
+  R2Point a, b;
+};
+
+// Clips a batch of edges (a[i], b[i]) to the six padded cube faces, writing
+// one FaceClippedEdge for every face that each edge intersects and returning
+// the number written.  The results are ordered by edge index and then by
+// face.  Edges whose endpoints are on the same face and at least "padding"
+// away from its boundary are clipped only to that face, since they cannot
+// intersect any adjacent padded face (this is the common case).  The faces
+// and (u,v) coordinates of all endpoints are computed together using the
+// branch-free S2::XYZtoFaceUV batch function, and only the remaining edges
+// are clipped one face at a time using ClipToPaddedFace.
+//
+// REQUIRES: a.size() == b.size()
+// REQUIRES: clipped.size() >= 6 * a.size()
+// REQUIRES: padding > 0
+int ClipEdgesToPaddedFaces(absl::Span<const S2Point> a,
+                           absl::Span<const S2Point> b, double padding,
+                           absl::Span<FaceClippedEdge> clipped);
+
 // The maximum error in the vertices returned by GetFaceSegments and
 // ClipToFace (compared to an exact calculation):
 //
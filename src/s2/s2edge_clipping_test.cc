@@ -21,14 +21,17 @@
 #include <cfloat>
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include "s2/base/logging.h"
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/strings/str_cat.h"
 #include "s2/r1interval.h"
 #include "s2/r2rect.h"
+#include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s1interval.h"
+#include "s2/s2cap.h"
 #include "s2/s2coords.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -198,6 +201,69 @@ TEST(S2EdgeUtil, FaceClipping) {
   }
 }
 
+TEST(S2EdgeUtil, ClipEdgesToPaddedFaces) {
+  // Check that the batch version returns exactly the faces and clipped
+  // coordinates that ClipToPaddedFace returns when each face is tried, except
+  // for edges that are well inside a single face.
+  S2Testing::Random* rnd = &S2Testing::rnd;
+  R2Rect biunit(R1Interval(-1, 1), R1Interval(-1, 1));
+  const int kNumEdges = 1000;
+  std::vector<S2Point> a, b;
+  for (int i = 0; i < kNumEdges; ++i) {
+    if (rnd->OneIn(2)) {
+      // An edge that nearly follows one of the cube edges.
+      int face = rnd->Uniform(6);
+      int k = rnd->Uniform(4);
+      S2Point p = S2::FaceUVtoXYZ(face, biunit.GetVertex(k));
+      S2Point q = S2::FaceUVtoXYZ(face, biunit.GetVertex((k + 1) & 3));
+      a.push_back(PerturbedCornerOrMidpoint(p, q).Normalize());
+      b.push_back(PerturbedCornerOrMidpoint(p, q).Normalize());
+    } else {
+      // An edge of random length, often short enough to stay on one face.
+      S2Point p = S2Testing::RandomPoint();
+      a.push_back(p);
+      b.push_back(S2Testing::SamplePoint(
+          S2Cap(p, S1Angle::Radians(M_PI * rnd->RandDouble()))));
+    }
+  }
+  for (double padding : {1e-15, 0.01, 0.3}) {
+    SCOPED_TRACE(StrCat("padding = ", padding));
+    std::vector<S2::FaceClippedEdge> clipped(6 * kNumEdges);
+    int n = S2::ClipEdgesToPaddedFaces(a, b, padding, absl::MakeSpan(clipped));
+    int k = 0;
+    for (int i = 0; i < kNumEdges; ++i) {
+      int a_face = S2::GetFace(a[i]);
+      R2Point a_uv, b_uv;
+      if (a_face == S2::GetFace(b[i])) {
+        S2::ValidFaceXYZtoUV(a_face, a[i], &a_uv);
+        S2::ValidFaceXYZtoUV(a_face, b[i], &b_uv);
+        if (max(fabs(a_uv[0]), fabs(a_uv[1])) <= 1 - padding &&
+            max(fabs(b_uv[0]), fabs(b_uv[1])) <= 1 - padding) {
+          ASSERT_LT(k, n);
+          EXPECT_EQ(i, clipped[k].edge);
+          EXPECT_EQ(a_face, clipped[k].face);
+          EXPECT_EQ(a_uv, clipped[k].a);
+          EXPECT_EQ(b_uv, clipped[k].b);
+          ++k;
+          continue;
+        }
+      }
+      for (int face = 0; face < 6; ++face) {
+        if (!S2::ClipToPaddedFace(a[i], b[i], face, padding, &a_uv, &b_uv)) {
+          continue;
+        }
+        ASSERT_LT(k, n);
+        EXPECT_EQ(i, clipped[k].edge);
+        EXPECT_EQ(face, clipped[k].face);
+        EXPECT_EQ(a_uv, clipped[k].a);
+        EXPECT_EQ(b_uv, clipped[k].b);
+        ++k;
+      }
+    }
+    EXPECT_EQ(n, k);
+  }
+}
+
 // Choose a random point in the rectangle defined by points A and B, sometimes
 // returning a point on the edge AB or the points A and B themselves.
 R2Point ChooseRectPoint(const R2Point& a, const R2Point& b) {
@@ -21,6 +21,36 @@
 #include "s2/s2pointutil.h"
 #include "s2/s2predicates.h"
 
+void S2EdgeCrosser::ChainCrossingSigns(S2PointSpan chain, int8* signs) {
+  const int n = chain.size();
+  if (n == 0) return;
+  if (n == 1) {
+    RestartAt(&chain[0]);
+    return;
+  }
+  // The orientations of all vertices except the last are stored in "signs"
+  // temporarily.  The orientation of vertex i is no longer needed once the
+  // result for edge i has been computed, so the results can overwrite them.
+  s2pred::TriageSigns(*a_, *b_, a_cross_b_, chain.subspan(0, n - 1), signs);
+  c_ = &chain[0];
+  acb_ = -signs[0];
+  for (int i = 0; i < n - 1; ++i) {
+    const S2Point* d = &chain[i + 1];
+    S2_DCHECK(S2::IsUnitLength(*d));
+    int bda = (i + 2 < n) ? signs[i + 1]
+                          : s2pred::TriageSign(*a_, *b_, *d, a_cross_b_);
+    // The remainder of this loop is equivalent to CrossingSign(d).
+    if (acb_ == -bda && bda != 0) {
+      c_ = d;
+      acb_ = -bda;
+      signs[i] = -1;
+    } else {
+      bda_ = bda;
+      signs[i] = CrossingSignInternal(d);
+    }
+  }
+}
+
 int S2EdgeCrosser::CrossingSignInternal(const S2Point* d) {
   // Compute the actual result, and then save the current vertex D as the next
   // vertex C, and save the orientation of the next triangle ACB (which is
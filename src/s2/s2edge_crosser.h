@@ -21,8 +21,10 @@
 #include "s2/base/logging.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/s2edge_crossings.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2predicates.h"
+#include "s2/third_party/absl/base/integral_types.h"
 
 class S2CopyingEdgeCrosser;  // Forward declaration
 
@@ -146,6 +148,22 @@ class S2EdgeCrosser {
   // The argument must point to a value that persists until the next call.
   bool EdgeOrVertexCrossing(const S2Point* d);
 
+  // Tests every edge of the given vertex chain against AB, setting signs[i]
+  // to CrossingSign(&chain[i], &chain[i + 1]) for 0 <= i < chain.size() - 1.
+  // This is faster than calling CrossingSign() once per vertex because the
+  // side of AB that each vertex lies on is computed for the whole chain in a
+  // single vectorizable pass (see s2pred::TriageSigns), leaving only the
+  // edges that might cross AB for the per-edge code.
+  //
+  // The previous chain vertex (if any) is ignored, and afterwards the last
+  // vertex of "chain" becomes the current chain vertex, as though RestartAt()
+  // and CrossingSign() had been called for each vertex in turn.
+  //
+  // REQUIRES: "signs" has room for chain.size() - 1 values.
+  //
+  // The vertices of "chain" must persist until the next call.
+  void ChainCrossingSigns(S2PointSpan chain, int8* signs);
+
   // Returns the last vertex of the current edge chain being tested, i.e. the
   // C vertex that will be used to construct the edge CD when one of the
   // methods above is called.
@@ -23,6 +23,7 @@
 
 #include "s2/base/logging.h"
 #include <gtest/gtest.h>
+#include "s2/s2cap.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2pointutil.h"
@@ -81,6 +82,12 @@ void TestCrossing(const S2Point& a, const S2Point& b,
   EXPECT_EQ(robust, crosser.CrossingSign(&d, &c));
   EXPECT_EQ(robust, crosser.CrossingSign(&c, &d));
 
+  vector<S2Point> chain = {c, d, c};
+  int8 signs[2];
+  crosser.ChainCrossingSigns(chain, signs);
+  EXPECT_EQ(robust, signs[0]);
+  EXPECT_EQ(robust, signs[1]);
+
   EXPECT_EQ(edge_or_vertex, S2::EdgeOrVertexCrossing(a, b, c, d));
   crosser.RestartAt(&c);
   EXPECT_EQ(edge_or_vertex, crosser.EdgeOrVertexCrossing(&d));
@@ -195,6 +202,30 @@ TEST(S2EdgeUtil, Crossings) {
                 -1, false);
 }
 
+TEST(S2EdgeUtil, ChainCrossingSigns) {
+  // Test a random chain that crosses AB many times and also shares vertices
+  // with it, then check that the crosser continues the chain afterwards.
+  for (int iter = 0; iter < 100; ++iter) {
+    S2Point a = S2Testing::RandomPoint();
+    S2Point b = S2Testing::RandomPoint();
+    S2Cap cap(a, S1Angle::Radians(a.Angle(b)));
+    vector<S2Point> chain;
+    for (int i = 0; i < 50; ++i) {
+      int k = S2Testing::rnd.Uniform(10);
+      chain.push_back(k == 0 ? a : k == 1 ? b : S2Testing::SamplePoint(cap));
+    }
+    S2EdgeCrosser crosser(&a, &b, &chain[0]);
+    vector<int8> signs(chain.size() - 1);
+    crosser.ChainCrossingSigns(chain, signs.data());
+    for (int i = 0; i + 1 < chain.size(); ++i) {
+      EXPECT_EQ(S2::CrossingSign(a, b, chain[i], chain[i + 1]), signs[i]);
+    }
+    EXPECT_EQ(&chain.back(), crosser.c());
+    EXPECT_EQ(S2::CrossingSign(a, b, chain.back(), chain[0]),
+              crosser.CrossingSign(&chain[0]));
+  }
+}
+
 TEST(S2EdgeUtil, CollinearEdgesThatDontTouch) {
   const int kIters = 500;
   for (int iter = 0; iter < kIters; ++iter) {
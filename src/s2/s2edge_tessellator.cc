@@ -18,6 +18,8 @@
 #include "s2/s2edge_tessellator.h"
 
 #include <cmath>
+#include <vector>
+
 #include "s2/s2latlng.h"
 #include "s2/s2pointutil.h"
 
@@ -32,9 +34,15 @@ S1Angle S2EdgeTessellator::kMinTolerance() {
 S2EdgeTessellator::S2EdgeTessellator(const S2::Projection* projection,
                                      S1Angle tolerance)
     : proj_(*projection),
+      projection_type_(ProjectionType::OTHER),
       tolerance_(std::max(tolerance, kMinTolerance())),
       wrap_distance_(projection->wrap_distance()) {
   if (tolerance < kMinTolerance()) S2_LOG(DFATAL) << "Tolerance too small";
+  if (dynamic_cast<const S2::PlateCarreeProjection*>(projection)) {
+    projection_type_ = ProjectionType::PLATE_CARREE;
+  } else if (dynamic_cast<const S2::MercatorProjection*>(projection)) {
+    projection_type_ = ProjectionType::MERCATOR;
+  }
 }
 
 void S2EdgeTessellator::AppendProjected(
@@ -88,6 +96,114 @@ void S2EdgeTessellator::AppendProjected(const R2Point& pa, const S2Point& a,
   }
 }
 
+void S2EdgeTessellator::AppendProjectedPolyline(
+    S2PointSpan polyline, vector<R2Point>* vertices) const {
+  if (polyline.size() < 2) return;
+  switch (projection_type_) {
+    case ProjectionType::PLATE_CARREE:
+      return AppendProjectedChain(
+          static_cast<const S2::PlateCarreeProjection&>(proj_), polyline,
+          false /*is_loop*/, vertices);
+    case ProjectionType::MERCATOR:
+      return AppendProjectedChain(
+          static_cast<const S2::MercatorProjection&>(proj_), polyline,
+          false /*is_loop*/, vertices);
+    default:
+      return AppendProjectedChain(proj_, polyline, false /*is_loop*/,
+                                  vertices);
+  }
+}
+
+void S2EdgeTessellator::AppendProjectedLoop(
+    S2PointLoopSpan loop, vector<R2Point>* vertices) const {
+  if (loop.empty()) return;
+  switch (projection_type_) {
+    case ProjectionType::PLATE_CARREE:
+      return AppendProjectedChain(
+          static_cast<const S2::PlateCarreeProjection&>(proj_), loop,
+          true /*is_loop*/, vertices);
+    case ProjectionType::MERCATOR:
+      return AppendProjectedChain(
+          static_cast<const S2::MercatorProjection&>(proj_), loop,
+          true /*is_loop*/, vertices);
+    default:
+      return AppendProjectedChain(proj_, loop, true /*is_loop*/, vertices);
+  }
+}
+
+template <class Projection>
+void S2EdgeTessellator::AppendProjectedChain(
+    const Projection& proj, S2PointSpan chain, bool is_loop,
+    vector<R2Point>* vertices) const {
+  // Project all the vertices, wrapping each one relative to the previous
+  // vertex.  A loop is treated as a polyline whose last vertex is the first.
+  const int num_edges = is_loop ? chain.size() : chain.size() - 1;
+  auto vertex = [&chain](int i) -> const S2Point& {
+    return chain[i == chain.size() ? 0 : i];
+  };
+  vector<R2Point> projected(num_edges + 1);
+  projected[0] = proj.Project(chain[0]);
+  for (int i = 1; i <= num_edges; ++i) {
+    projected[i] = WrapDestination(projected[i - 1], proj.Project(vertex(i)));
+  }
+
+  // Measure the error of every edge before subdividing any of them (see the
+  // comments in the recursive AppendProjected() for the error metric).
+  vector<bool> edge_ok(num_edges);
+  int num_ok = 0;
+  for (int i = 0; i < num_edges; ++i) {
+    S2Point mid = (vertex(i) + vertex(i + 1)).Normalize();
+    S2Point test_mid = proj.Unproject(
+        proj.Interpolate(0.5, projected[i], projected[i + 1]));
+    edge_ok[i] = S1ChordAngle(mid, test_mid) < tolerance_;
+    num_ok += edge_ok[i];
+  }
+
+  if (vertices->empty()) {
+    vertices->push_back(projected[0]);
+  } else {
+    S2_DCHECK_EQ(vertices->back(), projected[0])
+        << "Appended edges must form a chain";
+  }
+  // Edges that need to be subdivided generally produce several vertices.
+  vertices->reserve(vertices->size() + num_ok + 4 * (num_edges - num_ok));
+
+  // Subdivide the remaining edges depth-first, so that the vertices are
+  // appended in the same order as the recursive algorithm.
+  struct Segment {
+    R2Point pa;
+    S2Point a;
+    R2Point pb;
+    S2Point b;
+  };
+  vector<Segment> stack;
+  for (int i = 0; i < num_edges; ++i) {
+    if (edge_ok[i]) {
+      vertices->push_back(projected[i + 1]);
+      continue;
+    }
+    // The first test has already failed, so split the edge immediately.
+    stack.push_back({projected[i], vertex(i), projected[i + 1], vertex(i + 1)});
+    bool split = true;
+    while (!stack.empty()) {
+      Segment s = stack.back();
+      stack.pop_back();
+      S2Point mid = (s.a + s.b).Normalize();
+      if (!split) {
+        S2Point test_mid = proj.Unproject(proj.Interpolate(0.5, s.pa, s.pb));
+        if (S1ChordAngle(mid, test_mid) < tolerance_) {
+          vertices->push_back(s.pb);
+          continue;
+        }
+      }
+      split = false;
+      R2Point pmid = WrapDestination(s.pa, proj.Project(mid));
+      stack.push_back({pmid, mid, s.pb, s.b});
+      stack.push_back({s.pa, s.a, pmid, mid});
+    }
+  }
+}
+
 void S2EdgeTessellator::AppendUnprojected(
     const R2Point& pa, const R2Point& pb_in, vector<S2Point>* vertices) const {
   R2Point pb = WrapDestination(pa, pb_in);
@@ -22,6 +22,7 @@
 #include "s2/r2.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2projections.h"
 
 // Given an edge in some 2D projection (e.g., Mercator), S2EdgeTessellator
@@ -59,6 +60,32 @@ class S2EdgeTessellator {
   void AppendProjected(const S2Point& a, const S2Point& b,
                        std::vector<R2Point>* vertices) const;
 
+  // Converts every edge of the given spherical polyline to a chain of planar
+  // edges and appends the vertices to "vertices", following the same rules
+  // as AppendProjected(a, b).  This is faster than calling AppendProjected()
+  // for each edge:
+  //
+  //  - If the projection is an S2::PlateCarreeProjection or an
+  //    S2::MercatorProjection, it is called without virtual dispatch.
+  //  - All vertices are projected, and the error of approximating each edge
+  //    by a single planar edge is measured, in one pass before any edge is
+  //    subdivided (most edges typically need no subdivision).
+  //  - Edges are subdivided using an explicit stack rather than recursion,
+  //    and "vertices" is reserved for the expected output size.
+  //
+  // Each vertex is wrapped to be as close as possible to the previous one
+  // (see above), including the first vertex of each edge.  Does nothing if
+  // the polyline has fewer than two vertices.
+  void AppendProjectedPolyline(S2PointSpan polyline,
+                               std::vector<R2Point>* vertices) const;
+
+  // Like AppendProjectedPolyline(), but also converts the edge from the last
+  // vertex back to the first.  The last output vertex therefore corresponds
+  // to the first input vertex (its coordinates may differ from those of the
+  // first output vertex if the loop wraps around a coordinate axis).
+  void AppendProjectedLoop(S2PointLoopSpan loop,
+                           std::vector<R2Point>* vertices) const;
+
   // Converts the planar edge AB in the given projection to a chain of
   // spherical geodesic edges and appends the vertices to "vertices".
   //
@@ -85,9 +112,21 @@ class S2EdgeTessellator {
                        const R2Point& pb, const S2Point& b,
                        std::vector<R2Point>* vertices) const;
 
+  // Implements AppendProjectedPolyline() and AppendProjectedLoop() using
+  // "proj", which is the same object as proj_ but may have a more derived
+  // type.
+  template <class Projection>
+  void AppendProjectedChain(const Projection& proj, S2PointSpan chain,
+                            bool is_loop,
+                            std::vector<R2Point>* vertices) const;
+
   R2Point WrapDestination(const R2Point& pa, const R2Point& pb) const;
 
+  // The projections that have specialized versions of AppendProjectedChain.
+  enum class ProjectionType { OTHER, PLATE_CARREE, MERCATOR };
+
   const S2::Projection& proj_;
+  ProjectionType projection_type_;
   S1ChordAngle tolerance_;
   R2Point wrap_distance_;  // Local copy
 };
@@ -19,6 +19,7 @@
 
 #include <gtest/gtest.h>
 #include "s2/s2edge_distances.h"
+#include "s2/s2latlng.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2projections.h"
 #include "s2/s2testing.h"
@@ -199,4 +200,95 @@ TEST(S2EdgeTessellator, SeattleToNewYork) {
   EXPECT_LT(stats.max_dist(), tolerance);
 }
 
+// A projection that forwards to another one, used to test the code path for
+// projections that are not specialized.
+class ForwardingProjection : public S2::Projection {
+ public:
+  explicit ForwardingProjection(const S2::Projection* proj) : proj_(*proj) {}
+  R2Point Project(const S2Point& p) const override {
+    return proj_.Project(p);
+  }
+  S2Point Unproject(const R2Point& p) const override {
+    return proj_.Unproject(p);
+  }
+  R2Point FromLatLng(const S2LatLng& ll) const override {
+    return proj_.FromLatLng(ll);
+  }
+  S2LatLng ToLatLng(const R2Point& p) const override {
+    return proj_.ToLatLng(p);
+  }
+  R2Point wrap_distance() const override { return proj_.wrap_distance(); }
+
+ private:
+  const S2::Projection& proj_;
+};
+
+void ExpectNear(const vector<R2Point>& expected,
+                const vector<R2Point>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i].x(), actual[i].x(), 1e-12);
+    EXPECT_NEAR(expected[i].y(), actual[i].y(), 1e-12);
+  }
+}
+
+TEST(S2EdgeTessellator, PolylineMatchesEdges) {
+  S2::PlateCarreeProjection plate_carree(180);
+  S2::MercatorProjection mercator(180);
+  ForwardingProjection forwarding(&plate_carree);
+  S2Testing::rnd.Reset(1);
+  for (const S2::Projection* proj :
+           {static_cast<const S2::Projection*>(&plate_carree),
+            static_cast<const S2::Projection*>(&mercator),
+            static_cast<const S2::Projection*>(&forwarding)}) {
+    S2EdgeTessellator tess(proj, S1Angle::Degrees(0.01));
+    for (int iter = 0; iter < 20; ++iter) {
+      // Keep the longitudes away from the 180 degree meridian so that the
+      // edge-by-edge results don't need to be wrapped.
+      vector<S2Point> polyline;
+      for (int i = 0; i < 10; ++i) {
+        polyline.push_back(S2LatLng::FromDegrees(
+            S2Testing::rnd.UniformDouble(-80, 80),
+            S2Testing::rnd.UniformDouble(-90, 90)).ToPoint());
+      }
+      vector<R2Point> expected, actual;
+      for (int i = 0; i < polyline.size(); ++i) {
+        // Tessellate each edge separately, since wrapping the coordinates
+        // can change the last vertex of an edge by a tiny amount.
+        vector<R2Point> edge;
+        tess.AppendProjected(polyline[i], polyline[(i + 1) % polyline.size()],
+                             &edge);
+        expected.insert(expected.end(), edge.begin() + (i > 0), edge.end());
+      }
+      tess.AppendProjectedLoop(polyline, &actual);
+      ExpectNear(expected, actual);
+
+      // The polyline output is the same except for the closing edge.
+      vector<R2Point> polyline_vertices;
+      tess.AppendProjectedPolyline(polyline, &polyline_vertices);
+      ASSERT_LT(polyline_vertices.size(), actual.size());
+      actual.resize(polyline_vertices.size());
+      EXPECT_EQ(actual, polyline_vertices);
+    }
+  }
+}
+
+TEST(S2EdgeTessellator, LoopWrapping) {
+  // A loop around the north pole crosses the 180 degree meridian.  Every
+  // vertex should be close to the previous one.
+  S2::PlateCarreeProjection proj(180);
+  S2EdgeTessellator tess(&proj, S1Angle::Degrees(0.01));
+  vector<S2Point> loop;
+  for (int lng = -180; lng < 180; lng += 30) {
+    loop.push_back(S2LatLng::FromDegrees(60, lng + 15).ToPoint());
+  }
+  vector<R2Point> vertices;
+  tess.AppendProjectedLoop(loop, &vertices);
+  ASSERT_GT(vertices.size(), loop.size());
+  for (int i = 1; i < vertices.size(); ++i) {
+    EXPECT_LT(fabs(vertices[i].x() - vertices[i - 1].x()), 30.0);
+  }
+  EXPECT_NEAR(360, fabs(vertices.back().x() - vertices[0].x()), 1e-10);
+}
+
 }  // namespace
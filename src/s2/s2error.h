@@ -45,6 +45,7 @@ class S2Error {
     INTERNAL = 1005,             // An internal invariant has failed.
     DATA_LOSS = 1006,            // Data loss or corruption.
     RESOURCE_EXHAUSTED = 1007,   // A resource has been exhausted.
+    CANCELLED = 1008,            // Operation was cancelled by the client.
 
     ////////////////////////////////////////////////////////////////////
     // Error codes in the following range can be defined by clients:
@@ -181,6 +181,36 @@ TEST(S2FurthestEdgeQuery, AntipodalPointOutsideIndexedPolygon) {
   EXPECT_EQ(0, results.size());
 }
 
+TEST(S2FurthestEdgeQuery, ShapeIndexTargetMatchesBruteForce) {
+  // Most candidates of a ShapeIndexTarget are rejected using the bounding
+  // cap of the target index, without running a nested query.  Check that
+  // this does not change the results.
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex index;
+  S2Cap cap(MakePointOrDie("0:0"), S1Angle::Degrees(30));
+  for (int i = 0; i < 50; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::SamplePoint(cap), S1Angle::Degrees(0.5), 20)));
+  }
+  S2FurthestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(3);
+  S2FurthestEdgeQuery brute_force_query(&index);
+  brute_force_query.mutable_options()->set_max_results(3);
+  brute_force_query.mutable_options()->set_use_brute_force(true);
+  for (int i = 0; i < 20; ++i) {
+    MutableS2ShapeIndex target_index;
+    target_index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Testing::RandomPoint(), S1Angle::Degrees(5), 10)));
+    S2FurthestEdgeQuery::ShapeIndexTarget target(&target_index);
+    auto expected = brute_force_query.FindFurthestEdges(&target);
+    auto actual = query.FindFurthestEdges(&target);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].distance(), actual[j].distance());
+    }
+  }
+}
+
 TEST(S2FurthestEdgeQuery, TargetPolygonContainingIndexedPoints) {
   // Two points are contained within a polyline loop (no interior) and two
   // points are contained within a polygon.
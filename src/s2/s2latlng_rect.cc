@@ -147,6 +147,48 @@ bool S2LatLngRect::Contains(const S2LatLng& ll) const {
           lng_.Contains(ll.lng().radians()));
 }
 
+// Sets bit (i % 64) of (*mask)[i / 64] iff the rectangle contains the
+// S2LatLng returned by get_latlng(i), for 0 <= i < n.  This implements the
+// same tests as S2LatLngRect::Contains(const S2LatLng&).
+template <class GetLatLng>
+static void GetContainsMaskImpl(const R1Interval& lat, const S1Interval& lng,
+                                int n, GetLatLng get_latlng,
+                                std::vector<uint64>* mask) {
+  mask->assign((n + 63) / 64, 0);
+  if (lat.is_empty() || lng.is_empty()) return;
+  const double lat_lo = lat.lo(), lat_hi = lat.hi();
+  const double lng_lo = lng.lo(), lng_hi = lng.hi();
+  const bool inverted = lng.is_inverted();
+  for (int i = 0; i < n; i += 64) {
+    const int count = std::min(64, n - i);
+    uint64 bits = 0;
+    for (int j = 0; j < count; ++j) {
+      S2LatLng ll = get_latlng(i + j);
+      double lat_p = ll.lat().radians();
+      double lng_p = ll.lng().radians();
+      // S1Interval treats -Pi as Pi.
+      lng_p = (lng_p == -M_PI) ? M_PI : lng_p;
+      bool lng_contains = inverted ? (lng_p >= lng_lo) | (lng_p <= lng_hi)
+                                   : (lng_p >= lng_lo) & (lng_p <= lng_hi);
+      bool contains = (lat_p >= lat_lo) & (lat_p <= lat_hi) & lng_contains;
+      bits |= static_cast<uint64>(contains) << j;
+    }
+    (*mask)[i / 64] = bits;
+  }
+}
+
+void S2LatLngRect::GetContainsMask(absl::Span<const S2LatLng> latlngs,
+                                   std::vector<uint64>* mask) const {
+  GetContainsMaskImpl(lat_, lng_, latlngs.size(),
+                      [&latlngs](int i) { return latlngs[i]; }, mask);
+}
+
+void S2LatLngRect::GetContainsMask(S2PointSpan points,
+                                   std::vector<uint64>* mask) const {
+  GetContainsMaskImpl(lat_, lng_, points.size(),
+                      [&points](int i) { return S2LatLng(points[i]); }, mask);
+}
+
 bool S2LatLngRect::InteriorContains(const S2Point& p) const {
   return InteriorContains(S2LatLng(p));
 }
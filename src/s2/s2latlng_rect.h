@@ -21,6 +21,7 @@
 #include <cmath>
 #include <iosfwd>
 #include <iostream>
+#include <vector>
 
 #include "s2/base/logging.h"
 #include "s2/_fp_contract_off.h"
@@ -28,7 +29,10 @@
 #include "s2/s1angle.h"
 #include "s2/s1interval.h"
 #include "s2/s2latlng.h"
+#include "s2/s2point_span.h"
 #include "s2/s2region.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
 
 class Decoder;
 class Encoder;
@@ -173,6 +177,18 @@ class S2LatLngRect final : public S2Region {
   // an S2Point.  The argument must be normalized.
   bool Contains(const S2LatLng& ll) const;
 
+  // Tests the given points for containment, and sets bit (i % 64) of
+  // (*mask)[i / 64] iff Contains(latlngs[i]) is true.  This is equivalent to
+  // calling Contains() for each point but is much faster, since it consists
+  // of two branch-free interval tests per point.  It is intended as a
+  // prefilter for large numbers of points.  The points must be normalized.
+  void GetContainsMask(absl::Span<const S2LatLng> latlngs,
+                       std::vector<uint64>* mask) const;
+
+  // As above, but first converts each S2Point to an S2LatLng.  The points do
+  // not need to be normalized.
+  void GetContainsMask(S2PointSpan points, std::vector<uint64>* mask) const;
+
   // Returns true if and only if the given point is contained in the interior
   // of the region (i.e. the region excluding its boundary).  The point 'p'
   // does not need to be normalized.
@@ -17,6 +17,7 @@
 
 #include "s2/s2latlng_rect_bounder.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 
@@ -35,6 +36,26 @@ void S2LatLngRectBounder::AddPoint(const S2Point& b) {
   AddInternal(b, S2LatLng(b));
 }
 
+void S2LatLngRectBounder::AddPoints(S2PointSpan points) {
+  // The latitudes and longitudes are computed in a separate loop so that the
+  // compiler can vectorize the arithmetic and pipeline the atan2() calls.
+  // The results are bitwise identical to S2LatLng(S2Point).
+  static const int kBatchSize = 64;
+  double lat[kBatchSize], lng[kBatchSize];
+  for (int i = 0; i < points.size(); i += kBatchSize) {
+    const int count = min<int>(kBatchSize, points.size() - i);
+    const S2Point* p = &points[i];
+    for (int j = 0; j < count; ++j) {
+      S2_DCHECK(S2::IsUnitLength(p[j]));
+      lat[j] = atan2(p[j][2], sqrt(p[j][0] * p[j][0] + p[j][1] * p[j][1]));
+      lng[j] = atan2(p[j][1], p[j][0]);
+    }
+    for (int j = 0; j < count; ++j) {
+      AddInternal(p[j], S2LatLng::FromRadians(lat[j], lng[j]));
+    }
+  }
+}
+
 void S2LatLngRectBounder::AddLatLng(const S2LatLng& b_latlng) {
   AddInternal(b_latlng.ToPoint(), b_latlng);
 }
@@ -21,6 +21,7 @@
 #include "s2/s2point.h"
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/s2point_span.h"
 
 // This class computes a bounding rectangle that contains all edges defined
 // by a vertex chain v0, v1, v2, ...  All vertices must be unit length.
@@ -42,6 +43,10 @@ class S2LatLngRectBounder {
   // vertices are ignored.
   void AddPoint(const S2Point& b);
 
+  // Equivalent to calling AddPoint() for each of the given points in order,
+  // but faster because the S2LatLng conversions are done in batches.
+  void AddPoints(S2PointSpan points);
+
   // This method is called to add a vertex to the chain when the vertex is
   // represented as an S2LatLng.  Repeated vertices are ignored.
   void AddLatLng(const S2LatLng& b_latlng);
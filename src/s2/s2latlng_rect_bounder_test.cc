@@ -23,6 +23,7 @@
 
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/strings/str_cat.h"
+#include "s2/s2cap.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -215,6 +216,33 @@ TEST(RectBounder, NearlyIdenticalOrAntipodalPoints) {
   }
 }
 
+TEST(RectBounder, AddPointsMatchesAddPoint) {
+  S2Testing::Random* rnd = &S2Testing::rnd;
+  for (int iter = 0; iter < 100; ++iter) {
+    // Chains of various lengths (including ones that are not a multiple of
+    // the batch size) with some repeated and nearly antipodal vertices.
+    std::vector<S2Point> points;
+    S2Cap cap(S2Testing::RandomPoint(),
+              S1Angle::Degrees(rnd->OneIn(2) ? 1 : 180));
+    int n = rnd->Uniform(300);
+    for (int i = 0; i < n; ++i) {
+      if (!points.empty() && rnd->OneIn(10)) {
+        points.push_back(points.back());
+      } else if (!points.empty() && rnd->OneIn(10)) {
+        points.push_back(-points.back());
+      } else if (rnd->OneIn(10)) {
+        points.push_back(PointNearPole());
+      } else {
+        points.push_back(S2Testing::SamplePoint(cap));
+      }
+    }
+    S2LatLngRectBounder single, batch;
+    for (const S2Point& p : points) single.AddPoint(p);
+    batch.AddPoints(points);
+    EXPECT_EQ(single.GetBound(), batch.GetBound());
+  }
+}
+
 S2LatLngRect GetSubregionBound(double x_lat, double x_lng,
                                double y_lat, double y_lng) {
   S2LatLngRect in = S2LatLngRect::FromPointPair(
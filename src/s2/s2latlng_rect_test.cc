@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/util/coding/coder.h"
@@ -38,6 +39,7 @@
 using s2textformat::MakePointOrDie;
 using std::fabs;
 using std::min;
+using std::vector;
 
 static S2LatLngRect RectFromDegrees(double lat_lo, double lng_lo,
                                     double lat_hi, double lng_hi) {
@@ -179,6 +181,45 @@ TEST(S2LatLngRect, Contains) {
   EXPECT_FALSE(r1.Contains(S2Point(0.5, 0.2, 0.1)));
 }
 
+TEST(S2LatLngRect, GetContainsMask) {
+  // Include points on the boundary, including both representations of the
+  // antimeridian.
+  vector<S2LatLng> latlngs;
+  for (int i = 0; i < 1000; ++i) {
+    latlngs.push_back(S2LatLng(S2Testing::RandomPoint()));
+  }
+  latlngs.push_back(S2LatLng::FromRadians(0, -M_PI));
+  latlngs.push_back(S2LatLng::FromRadians(0, M_PI));
+  latlngs.push_back(S2LatLng::FromDegrees(10, 20));
+  latlngs.push_back(S2LatLng::FromRadians(M_PI_2, 0));
+  vector<S2Point> points;
+  for (const S2LatLng& ll : latlngs) points.push_back(ll.ToPoint());
+
+  vector<S2LatLngRect> rects = {
+      S2LatLngRect::Empty(), S2LatLngRect::Full(),
+      RectFromDegrees(10, 20, 30, 40), RectFromDegrees(-10, 170, 50, -150),
+      RectFromDegrees(0, 180, 90, 180), RectFromDegrees(0, -180, 90, 20)};
+  for (int i = 0; i < 20; ++i) {
+    rects.push_back(S2LatLngRect::FromPointPair(
+        S2LatLng(S2Testing::RandomPoint()),
+        S2LatLng(S2Testing::RandomPoint())));
+  }
+  for (const S2LatLngRect& rect : rects) {
+    vector<uint64> latlng_mask, point_mask;
+    rect.GetContainsMask(latlngs, &latlng_mask);
+    rect.GetContainsMask(points, &point_mask);
+    ASSERT_EQ((latlngs.size() + 63) / 64, latlng_mask.size());
+    ASSERT_EQ(latlng_mask.size(), point_mask.size());
+    for (int i = 0; i < latlngs.size(); ++i) {
+      int word = i / 64, bit = i % 64;
+      EXPECT_EQ(rect.Contains(latlngs[i]), (latlng_mask[word] >> bit) & 1)
+          << rect << " " << latlngs[i];
+      EXPECT_EQ(rect.Contains(points[i]), (point_mask[word] >> bit) & 1)
+          << rect << " " << latlngs[i];
+    }
+  }
+}
+
 static void TestIntervalOps(const S2LatLngRect& x, const S2LatLngRect& y,
                             const char* expected_relation,
                             const S2LatLngRect& expected_union,
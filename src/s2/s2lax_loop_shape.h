@@ -83,6 +83,10 @@ class S2LaxLoopShape : public S2Shape {
   ChainPosition chain_position(int e) const final {
     return ChainPosition(0, e);
   }
+  bool GetChainVertices(int i, S2PointSpan* vertices) const final {
+    *vertices = S2PointSpan(vertices_.get(), num_vertices_);
+    return true;
+  }
 
  private:
   // For clients that have many small loops, we save some memory by
@@ -19,7 +19,6 @@
 
 #include "s2/s2shapeutil_get_reference_point.h"
 
-using absl::make_unique;
 using absl::MakeSpan;
 using absl::Span;
 using std::vector;
@@ -30,14 +29,21 @@ using ChainPosition = S2Shape::ChainPosition;
 static const unsigned char kCurrentEncodingVersionNumber = 1;
 
 S2LaxPolygonShape::S2LaxPolygonShape(
-    const vector<S2LaxPolygonShape::Loop>& loops) {
+    const vector<S2LaxPolygonShape::Loop>& loops) : S2LaxPolygonShape() {
   Init(loops);
 }
 
-S2LaxPolygonShape::S2LaxPolygonShape(const S2Polygon& polygon) {
+S2LaxPolygonShape::S2LaxPolygonShape(const S2Polygon& polygon)
+    : S2LaxPolygonShape() {
   Init(polygon);
 }
 
+S2LaxPolygonShape::S2LaxPolygonShape(vector<S2Point>&& vertices,
+                                     Span<const uint32> loop_offsets)
+    : S2LaxPolygonShape() {
+  Init(std::move(vertices), loop_offsets);
+}
+
 void S2LaxPolygonShape::Init(const vector<S2LaxPolygonShape::Loop>& loops) {
   vector<Span<const S2Point>> spans;
   for (const S2LaxPolygonShape::Loop& loop : loops) {
@@ -69,14 +75,14 @@ void S2LaxPolygonShape::Init(const S2Polygon& polygon) {
 }
 
 void S2LaxPolygonShape::Init(const vector<Span<const S2Point>>& loops) {
+  if (num_loops_ > 1) delete[] cumulative_vertices_;  // Reinitializing.
   num_loops_ = loops.size();
   if (num_loops_ == 0) {
     num_vertices_ = 0;
-    vertices_ = nullptr;
+    vertices_ = vector<S2Point>();
   } else if (num_loops_ == 1) {
     num_vertices_ = loops[0].size();
-    vertices_.reset(new S2Point[num_vertices_]);
-    std::copy(loops[0].begin(), loops[0].end(), vertices_.get());
+    vertices_ = vector<S2Point>(loops[0].begin(), loops[0].end());
   } else {
     cumulative_vertices_ = new uint32[num_loops_ + 1];
     int32 num_vertices = 0;
@@ -85,14 +91,32 @@ void S2LaxPolygonShape::Init(const vector<Span<const S2Point>>& loops) {
       num_vertices += loops[i].size();
     }
     cumulative_vertices_[num_loops_] = num_vertices;
-    vertices_.reset(new S2Point[num_vertices]);
+    vertices_ = vector<S2Point>(num_vertices);
     for (int i = 0; i < num_loops_; ++i) {
       std::copy(loops[i].begin(), loops[i].end(),
-                vertices_.get() + cumulative_vertices_[i]);
+                vertices_.begin() + cumulative_vertices_[i]);
     }
   }
 }
 
+void S2LaxPolygonShape::Init(vector<S2Point>&& vertices,
+                             Span<const uint32> loop_offsets) {
+  S2_DCHECK(loop_offsets.empty() || loop_offsets.front() == 0);
+  S2_DCHECK_EQ(loop_offsets.empty() ? 0 : loop_offsets.back(),
+               vertices.size());
+  if (num_loops_ > 1) delete[] cumulative_vertices_;  // Reinitializing.
+  num_loops_ = std::max<int>(0, loop_offsets.size() - 1);
+  vertices_ = std::move(vertices);
+  if (num_loops_ <= 1) {
+    num_vertices_ = vertices_.size();
+  } else {
+    // The offsets are only O(num_loops), so they are copied in order to keep
+    // the compact representation used by the other constructors.
+    cumulative_vertices_ = new uint32[num_loops_ + 1];
+    std::copy(loop_offsets.begin(), loop_offsets.end(), cumulative_vertices_);
+  }
+}
+
 S2LaxPolygonShape::~S2LaxPolygonShape() {
   if (num_loops() > 1) {
     delete[] cumulative_vertices_;
@@ -131,7 +155,7 @@ void S2LaxPolygonShape::Encode(Encoder* encoder,
   encoder->Ensure(1 + Varint::kMax32);
   encoder->put8(kCurrentEncodingVersionNumber);
   encoder->put_varint32(num_loops_);
-  s2coding::EncodeS2PointVector(MakeSpan(vertices_.get(), num_vertices()),
+  s2coding::EncodeS2PointVector(MakeSpan(vertices_.data(), num_vertices()),
                                 hint, encoder);
   if (num_loops() > 1) {
     s2coding::EncodeUintVector<uint32>(MakeSpan(cumulative_vertices_,
@@ -152,21 +176,18 @@ bool S2LaxPolygonShape::Init(Decoder* decoder) {
 
   if (num_loops_ == 0) {
     num_vertices_ = 0;
-    vertices_ = nullptr;
+    vertices_ = vector<S2Point>();
   } else {
-    vertices_ = make_unique<S2Point[]>(vertices.size());
-    for (int i = 0; i < vertices.size(); ++i) {
-      vertices_[i] = vertices[i];
-    }
+    vertices_ = vector<S2Point>(vertices.size());
+    vertices.Decode(0, vertices.size(), vertices_.data());
     if (num_loops_ == 1) {
       num_vertices_ = vertices.size();
     } else {
       s2coding::EncodedUintVector<uint32> cumulative_vertices;
       if (!cumulative_vertices.Init(decoder)) return false;
       cumulative_vertices_ = new uint32[cumulative_vertices.size()];
-      for (int i = 0; i < cumulative_vertices.size(); ++i) {
-        cumulative_vertices_[i] = cumulative_vertices[i];
-      }
+      cumulative_vertices.Decode(0, cumulative_vertices.size(),
+                                 cumulative_vertices_);
     }
   }
   return true;
@@ -206,6 +227,12 @@ S2Shape::Chain S2LaxPolygonShape::chain(int i) const {
   }
 }
 
+bool S2LaxPolygonShape::GetChainVertices(int i, S2PointSpan* vertices) const {
+  Chain chain = S2LaxPolygonShape::chain(i);  // Avoid virtual call.
+  *vertices = S2PointSpan(vertices_.data() + chain.start, chain.length);
+  return true;
+}
+
 S2Shape::Edge S2LaxPolygonShape::chain_edge(int i, int j) const {
   S2_DCHECK_LT(i, num_loops());
   S2_DCHECK_LT(j, num_loop_vertices(i));
@@ -345,3 +372,103 @@ S2Shape::ChainPosition EncodedS2LaxPolygonShape::chain_position(int e) const {
     return ChainPosition(next - 1, e - cumulative_vertices_[next - 1]);
   }
 }
+
+S2CellIdLaxPolygonShape::S2CellIdLaxPolygonShape(
+    const vector<CellIdLoop>& loops) {
+  Init(loops);
+}
+
+S2CellIdLaxPolygonShape::S2CellIdLaxPolygonShape(
+    const vector<S2LaxPolygonShape::Loop>& loops) {
+  Init(loops);
+}
+
+void S2CellIdLaxPolygonShape::Init(const vector<CellIdLoop>& loops) {
+  num_loops_ = loops.size();
+  vertices_.clear();
+  cumulative_vertices_.assign(1, 0);
+  for (const CellIdLoop& loop : loops) {
+    vertices_.insert(vertices_.end(), loop.begin(), loop.end());
+    cumulative_vertices_.push_back(vertices_.size());
+  }
+  vertices_.shrink_to_fit();
+  cumulative_vertices_.shrink_to_fit();
+}
+
+void S2CellIdLaxPolygonShape::Init(
+    const vector<S2LaxPolygonShape::Loop>& loops) {
+  vector<CellIdLoop> id_loops;
+  id_loops.reserve(loops.size());
+  for (const S2LaxPolygonShape::Loop& loop : loops) {
+    id_loops.emplace_back();
+    id_loops.back().reserve(loop.size());
+    for (const S2Point& p : loop) id_loops.back().push_back(S2CellId(p));
+  }
+  Init(id_loops);
+}
+
+int S2CellIdLaxPolygonShape::num_loop_vertices(int i) const {
+  S2_DCHECK_LT(i, num_loops());
+  return cumulative_vertices_[i + 1] - cumulative_vertices_[i];
+}
+
+S2Point S2CellIdLaxPolygonShape::loop_vertex(int i, int j) const {
+  return loop_vertex_id(i, j).ToPoint();
+}
+
+S2CellId S2CellIdLaxPolygonShape::loop_vertex_id(int i, int j) const {
+  S2_DCHECK_LT(i, num_loops());
+  S2_DCHECK_LT(j, num_loop_vertices(i));
+  return vertices_[cumulative_vertices_[i] + j];
+}
+
+int S2CellIdLaxPolygonShape::GetLoopIndex(int e) const {
+  // Find the index of the first vertex of the loop following this one.
+  const int kMaxLinearSearchLoops = 12;  // From benchmarks.
+  const uint32* next = cumulative_vertices_.data() + 1;
+  if (num_loops() <= kMaxLinearSearchLoops) {
+    while (*next <= e) ++next;
+  } else {
+    next = std::lower_bound(next, next + num_loops(), e + 1);
+  }
+  return next - (cumulative_vertices_.data() + 1);
+}
+
+S2Shape::Edge S2CellIdLaxPolygonShape::edge(int e0) const {
+  S2_DCHECK_LT(e0, num_edges());
+  int e1 = e0 + 1;
+  if (num_loops() == 1) {
+    if (e1 == num_vertices()) { e1 = 0; }
+  } else {
+    // Wrap around to the first vertex of the loop if necessary.
+    int i = GetLoopIndex(e0);
+    if (e1 == cumulative_vertices_[i + 1]) { e1 = cumulative_vertices_[i]; }
+  }
+  return Edge(vertices_[e0].ToPoint(), vertices_[e1].ToPoint());
+}
+
+S2Shape::ReferencePoint S2CellIdLaxPolygonShape::GetReferencePoint() const {
+  return s2shapeutil::GetReferencePoint(*this);
+}
+
+S2Shape::Chain S2CellIdLaxPolygonShape::chain(int i) const {
+  S2_DCHECK_LT(i, num_loops());
+  int start = cumulative_vertices_[i];
+  return Chain(start, cumulative_vertices_[i + 1] - start);
+}
+
+S2Shape::Edge S2CellIdLaxPolygonShape::chain_edge(int i, int j) const {
+  S2_DCHECK_LT(i, num_loops());
+  S2_DCHECK_LT(j, num_loop_vertices(i));
+  int n = num_loop_vertices(i);
+  int k = (j + 1 == n) ? 0 : j + 1;
+  int base = cumulative_vertices_[i];
+  return Edge(vertices_[base + j].ToPoint(), vertices_[base + k].ToPoint());
+}
+
+S2Shape::ChainPosition S2CellIdLaxPolygonShape::chain_position(int e) const {
+  S2_DCHECK_LT(e, num_edges());
+  if (num_loops() == 1) return ChainPosition(0, e);
+  int i = GetLoopIndex(e);
+  return ChainPosition(i, e - cumulative_vertices_[i]);
+}
@@ -24,6 +24,7 @@
 #include "s2/third_party/absl/types/span.h"
 #include "s2/encoded_uint_vector.h"
 #include "s2/encoded_s2point_vector.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2polygon.h"
 #include "s2/s2shape.h"
 
@@ -85,6 +86,17 @@ class S2LaxPolygonShape : public S2Shape {
   // Full and empty S2Polygons are supported.
   explicit S2LaxPolygonShape(const S2Polygon& polygon);
 
+  // Constructs an S2LaxPolygonShape that takes ownership of "vertices", which
+  // contains the vertices of all loops concatenated together.  Loop "i"
+  // consists of vertices [loop_offsets[i], loop_offsets[i + 1]), so
+  // "loop_offsets" has one more element than the number of loops, its first
+  // element is 0, and its last element is vertices.size().  (An empty
+  // "loop_offsets" is also accepted and yields an empty polygon.)  This is
+  // the layout produced by most flat import formats (e.g. WKB), and avoids
+  // copying the vertices.
+  S2LaxPolygonShape(std::vector<S2Point>&& vertices,
+                    absl::Span<const uint32> loop_offsets);
+
   ~S2LaxPolygonShape() override;
 
   // Initializes an S2LaxPolygonShape from the given vertex loops.
@@ -94,6 +106,16 @@ class S2LaxPolygonShape : public S2Shape {
   // Full and empty S2Polygons are supported.
   void Init(const S2Polygon& polygon);
 
+  // Initializes an S2LaxPolygonShape from the given vertex loops, where each
+  // loop may refer to an arbitrary array of vertices (e.g., a subrange of a
+  // single vector containing the vertices of all loops).
+  void Init(const std::vector<absl::Span<const S2Point>>& loops);
+
+  // Initializes an S2LaxPolygonShape from a flat vertex vector and loop
+  // offsets, taking ownership of the vertices (see constructor above).
+  void Init(std::vector<S2Point>&& vertices,
+            absl::Span<const uint32> loop_offsets);
+
   // Returns the number of loops.
   int num_loops() const { return num_loops_; }
 
@@ -128,13 +150,12 @@ class S2LaxPolygonShape : public S2Shape {
   Chain chain(int i) const final;
   Edge chain_edge(int i, int j) const final;
   ChainPosition chain_position(int e) const final;
+  bool GetChainVertices(int i, S2PointSpan* vertices) const final;
   TypeTag type_tag() const override { return kTypeTag; }
 
  private:
-  void Init(const std::vector<absl::Span<const S2Point>>& loops);
-
   int32 num_loops_;
-  std::unique_ptr<S2Point[]> vertices_;
+  std::vector<S2Point> vertices_;
   // If num_loops_ <= 1, this union stores the number of vertices.
   // Otherwise it points to an array of size (num_loops + 1) where element "i"
   // is the total number of vertices in loops 0..i-1.
@@ -180,4 +201,65 @@ class EncodedS2LaxPolygonShape : public S2Shape {
   s2coding::EncodedUintVector<uint32> cumulative_vertices_;
 };
 
+// Like S2LaxPolygonShape, except that each vertex is stored as the S2CellId
+// whose center is that vertex, and is converted back to an S2Point only as
+// it is accessed.  This uses 8 bytes per vertex rather than 24, which is
+// useful for keeping large numbers of polygons in memory when their
+// vertices are snapped to S2CellId centers (e.g. using S2Builder with
+// s2builderutil::S2CellIdSnapFunction).  Decoding a vertex costs about as
+// much as S2CellId::ToPoint().
+//
+// Vertices may be snapped to cell centers at any level, but note that
+// polygons whose vertices are snapped to E7 coordinates should first be
+// snapped to leaf cells (which moves each vertex by at most 1cm).
+class S2CellIdLaxPolygonShape : public S2Shape {
+ public:
+  // Constructs an empty polygon.
+  S2CellIdLaxPolygonShape() : num_loops_(0), cumulative_vertices_(1, 0) {}
+
+  // Constructs a polygon from the given loops of cell ids.  Each vertex is
+  // the center of the corresponding cell (see S2CellId::ToPoint).
+  using CellIdLoop = std::vector<S2CellId>;
+  explicit S2CellIdLaxPolygonShape(const std::vector<CellIdLoop>& loops);
+
+  // Constructs a polygon from the given loops of points, replacing each
+  // point by the center of the leaf cell that contains it.  Points that are
+  // already leaf cell centers are represented exactly.
+  explicit S2CellIdLaxPolygonShape(
+      const std::vector<S2LaxPolygonShape::Loop>& loops);
+
+  // Initializes the polygon from the given loops of cell ids.
+  void Init(const std::vector<CellIdLoop>& loops);
+
+  // Initializes the polygon from the given loops of points (see above).
+  void Init(const std::vector<S2LaxPolygonShape::Loop>& loops);
+
+  int num_loops() const { return num_loops_; }
+  int num_vertices() const { return cumulative_vertices_[num_loops_]; }
+  int num_loop_vertices(int i) const;
+  S2Point loop_vertex(int i, int j) const;
+
+  // Returns the cell id of the given vertex.
+  S2CellId loop_vertex_id(int i, int j) const;
+
+  // S2Shape interface:
+  int num_edges() const final { return num_vertices(); }
+  Edge edge(int e) const final;
+  int dimension() const final { return 2; }
+  ReferencePoint GetReferencePoint() const final;
+  int num_chains() const final { return num_loops(); }
+  Chain chain(int i) const final;
+  Edge chain_edge(int i, int j) const final;
+  ChainPosition chain_position(int e) const final;
+
+ private:
+  // Returns the index of the loop containing vertex "e".
+  int GetLoopIndex(int e) const;
+
+  int32 num_loops_;
+  std::vector<S2CellId> vertices_;
+  // Element "i" is the total number of vertices in loops 0..i-1.
+  std::vector<uint32> cumulative_vertices_;
+};
+
 #endif  // S2_S2LAX_POLYGON_SHAPE_H_
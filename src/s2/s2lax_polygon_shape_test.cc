@@ -152,6 +152,47 @@ TEST(S2LaxPolygonShape, MultiLoopS2Polygon) {
   }
 }
 
+TEST(S2LaxPolygonShape, FlatVerticesConstructor) {
+  // Test the constructor that takes ownership of a flat vertex vector, with
+  // zero, one, and several loops (including a full loop).
+  vector<vector<S2LaxPolygonShape::Loop>> tests = {
+    {},
+    {{}},
+    {s2textformat::ParsePoints("0:0, 0:3, 3:3")},
+    {s2textformat::ParsePoints("0:0, 0:3, 3:3"),
+     s2textformat::ParsePoints("1:1, 2:2, 1:2"),
+     s2textformat::ParsePoints("5:5")},
+  };
+  for (const auto& loops : tests) {
+    S2LaxPolygonShape expected(loops);
+    vector<S2Point> vertices;
+    vector<uint32> loop_offsets = {0};
+    for (const auto& loop : loops) {
+      vertices.insert(vertices.end(), loop.begin(), loop.end());
+      loop_offsets.push_back(vertices.size());
+    }
+    S2LaxPolygonShape shape(std::move(vertices), loop_offsets);
+    ASSERT_EQ(expected.num_loops(), shape.num_loops());
+    ASSERT_EQ(expected.num_vertices(), shape.num_vertices());
+    for (int i = 0; i < shape.num_loops(); ++i) {
+      ASSERT_EQ(expected.num_loop_vertices(i), shape.num_loop_vertices(i));
+      EXPECT_EQ(expected.chain(i).start, shape.chain(i).start);
+    }
+    for (int e = 0; e < shape.num_edges(); ++e) {
+      EXPECT_EQ(expected.edge(e), shape.edge(e));
+      EXPECT_EQ(expected.chain_position(e).chain_id,
+                shape.chain_position(e).chain_id);
+    }
+    EXPECT_EQ(expected.is_full(), shape.is_full());
+    EXPECT_EQ(expected.GetReferencePoint().contained,
+              shape.GetReferencePoint().contained);
+  }
+  // An empty offsets vector also yields an empty polygon.
+  S2LaxPolygonShape empty(vector<S2Point>(), {});
+  EXPECT_EQ(0, empty.num_loops());
+  EXPECT_TRUE(empty.is_empty());
+}
+
 TEST(S2LaxPolygonShape, ManyLoopPolygon) {
   // Test a polygon with enough loops so that cumulative_vertices_ is used.
   vector<vector<S2Point>> loops;
@@ -232,3 +273,47 @@ TEST(S2LaxPolygonShape, CompareToS2Loop) {
     CompareS2LoopToShape(*loop, make_unique<S2LaxPolygonShape>(loops));
   }
 }
+
+TEST(S2CellIdLaxPolygonShape, MatchesS2LaxPolygonShape) {
+  for (int num_loops : {0, 1, 3, 20}) {
+    // Snap the vertices to leaf cell centers so that both shapes represent
+    // the same polygon.
+    vector<S2LaxPolygonShape::Loop> loops;
+    for (int i = 0; i < num_loops; ++i) {
+      S2Point center(S2LatLng::FromDegrees(0, 3 * i));
+      loops.push_back(S2Testing::MakeRegularPoints(
+          center, S1Angle::Degrees(1), 1 + S2Testing::rnd.Uniform(10)));
+      for (S2Point& p : loops.back()) p = S2CellId(p).ToPoint();
+    }
+    S2LaxPolygonShape expected(loops);
+    S2CellIdLaxPolygonShape actual(loops);
+    ASSERT_EQ(expected.num_loops(), actual.num_loops());
+    ASSERT_EQ(expected.num_edges(), actual.num_edges());
+    for (int e = 0; e < expected.num_edges(); ++e) {
+      EXPECT_EQ(expected.edge(e), actual.edge(e));
+      EXPECT_EQ(expected.chain_position(e), actual.chain_position(e));
+    }
+    for (int i = 0; i < expected.num_chains(); ++i) {
+      EXPECT_EQ(expected.chain(i).start, actual.chain(i).start);
+      EXPECT_EQ(expected.chain(i).length, actual.chain(i).length);
+      for (int j = 0; j < expected.num_loop_vertices(i); ++j) {
+        EXPECT_EQ(expected.loop_vertex(i, j), actual.loop_vertex(i, j));
+        EXPECT_EQ(expected.chain_edge(i, j), actual.chain_edge(i, j));
+      }
+    }
+    EXPECT_EQ(expected.GetReferencePoint(), actual.GetReferencePoint());
+  }
+}
+
+TEST(S2CellIdLaxPolygonShape, CellIdVertices) {
+  // Vertices may be cell centers at any level.
+  S2CellId id = S2CellId::FromFace(2).child(1).child(3);
+  vector<S2CellIdLaxPolygonShape::CellIdLoop> loops = {
+      {id.child(0), id.child(1), id.child(2)}};
+  S2CellIdLaxPolygonShape shape(loops);
+  EXPECT_EQ(3, shape.num_vertices());
+  EXPECT_EQ(id.child(1), shape.loop_vertex_id(0, 1));
+  EXPECT_EQ(id.child(1).ToPoint(), shape.loop_vertex(0, 1));
+  EXPECT_EQ(S2Shape::Edge(id.child(2).ToPoint(), id.child(0).ToPoint()),
+            shape.edge(2));
+}
@@ -61,9 +61,7 @@ bool S2LaxPolylineShape::Init(Decoder* decoder) {
   if (!vertices.Init(decoder)) return false;
   num_vertices_ = vertices.size();
   vertices_ = make_unique<S2Point[]>(vertices.size());
-  for (int i = 0; i < num_vertices_; ++i) {
-    vertices_[i] = vertices[i];
-  }
+  vertices.Decode(0, num_vertices_, vertices_.get());
   return true;
 }
 
@@ -80,6 +78,12 @@ S2Shape::Chain S2LaxPolylineShape::chain(int i) const {
   return Chain(0, S2LaxPolylineShape::num_edges());  // Avoid virtual call.
 }
 
+bool S2LaxPolylineShape::GetChainVertices(int i, S2PointSpan* vertices) const {
+  S2_DCHECK_EQ(i, 0);
+  *vertices = S2PointSpan(vertices_.get(), num_vertices_);
+  return true;
+}
+
 S2Shape::Edge S2LaxPolylineShape::chain_edge(int i, int j) const {
   S2_DCHECK_EQ(i, 0);
   S2_DCHECK_LT(j, num_edges());
@@ -116,3 +120,52 @@ S2Shape::Edge EncodedS2LaxPolylineShape::chain_edge(int i, int j) const {
 S2Shape::ChainPosition EncodedS2LaxPolylineShape::chain_position(int e) const {
   return S2Shape::ChainPosition(0, e);
 }
+
+S2SoALaxPolylineShape::S2SoALaxPolylineShape(S2PointSpan vertices) {
+  Init(vertices);
+}
+
+S2SoALaxPolylineShape::S2SoALaxPolylineShape(const S2Polyline& polyline) {
+  Init(MakeSpan(&polyline.vertex(0), polyline.num_vertices()));
+}
+
+void S2SoALaxPolylineShape::Init(S2PointSpan vertices) {
+  S2_LOG_IF(WARNING, vertices.size() == 1)
+      << "S2SoALaxPolylineShape with one vertex has no edges";
+  vertices_.Init(vertices);
+}
+
+void S2SoALaxPolylineShape::Encode(Encoder* encoder,
+                                   s2coding::CodingHint hint) const {
+  s2coding::EncodeS2PointVector(vertices_.ToVector(), hint, encoder);
+}
+
+bool S2SoALaxPolylineShape::Init(Decoder* decoder) {
+  s2coding::EncodedS2PointVector vertices;
+  if (!vertices.Init(decoder)) return false;
+  vertices_.Init(vertices.Decode());
+  return true;
+}
+
+S2Shape::Edge S2SoALaxPolylineShape::edge(int e) const {
+  S2_DCHECK_LT(e, num_edges());
+  return Edge(vertex(e), vertex(e + 1));
+}
+
+int S2SoALaxPolylineShape::num_chains() const {
+  return std::min(1, S2SoALaxPolylineShape::num_edges());
+}
+
+S2Shape::Chain S2SoALaxPolylineShape::chain(int i) const {
+  return Chain(0, S2SoALaxPolylineShape::num_edges());
+}
+
+S2Shape::Edge S2SoALaxPolylineShape::chain_edge(int i, int j) const {
+  S2_DCHECK_EQ(i, 0);
+  S2_DCHECK_LT(j, num_edges());
+  return Edge(vertex(j), vertex(j + 1));
+}
+
+S2Shape::ChainPosition S2SoALaxPolylineShape::chain_position(int e) const {
+  return S2Shape::ChainPosition(0, e);
+}
@@ -21,6 +21,7 @@
 #include <memory>
 #include <vector>
 #include "s2/encoded_s2point_vector.h"
+#include "s2/s2point_soa.h"
 #include "s2/s2polyline.h"
 #include "s2/s2shape.h"
 
@@ -78,6 +79,7 @@ class S2LaxPolylineShape : public S2Shape {
   Chain chain(int i) const final;
   Edge chain_edge(int i, int j) const final;
   ChainPosition chain_position(int e) const final;
+  bool GetChainVertices(int i, S2PointSpan* vertices) const final;
   TypeTag type_tag() const override { return kTypeTag; }
 
  private:
@@ -121,4 +123,59 @@ class EncodedS2LaxPolylineShape : public S2Shape {
   s2coding::EncodedS2PointVector vertices_;
 };
 
+// Like S2LaxPolylineShape, except that the vertices are stored in structure
+// of arrays form (see S2PointSoA).  S2CrossingEdgeQuery recognizes this
+// shape type and classifies its candidate edges using vectorized loops.
+// The encoding is the same as S2LaxPolylineShape.
+class S2SoALaxPolylineShape : public S2Shape {
+ public:
+  static constexpr TypeTag kTypeTag = 7;
+
+  // Constructs an empty polyline.
+  S2SoALaxPolylineShape() {}
+
+  // Constructs an S2SoALaxPolylineShape with the given vertices.
+  explicit S2SoALaxPolylineShape(S2PointSpan vertices);
+
+  // Constructs an S2SoALaxPolylineShape from the given S2Polyline, by
+  // copying its data.
+  explicit S2SoALaxPolylineShape(const S2Polyline& polyline);
+
+  // Initializes an S2SoALaxPolylineShape with the given vertices.
+  void Init(S2PointSpan vertices);
+
+  int num_vertices() const { return vertices_.size(); }
+  S2Point vertex(int i) const { return vertices_[i]; }
+
+  // Returns the vertices in structure of arrays form.
+  const S2PointSoA& vertices() const { return vertices_; }
+
+  // Appends an encoded representation of the S2SoALaxPolylineShape to
+  // "encoder".
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void Encode(Encoder* encoder,
+              s2coding::CodingHint hint = s2coding::CodingHint::COMPACT) const;
+
+  // Decodes an S2SoALaxPolylineShape, returning true on success.
+  bool Init(Decoder* decoder);
+
+  // S2Shape interface:
+  int num_edges() const final { return std::max(0, num_vertices() - 1); }
+  Edge edge(int e) const final;
+  int dimension() const final { return 1; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final;
+  Chain chain(int i) const final;
+  Edge chain_edge(int i, int j) const final;
+  ChainPosition chain_position(int e) const final;
+  TypeTag type_tag() const override { return kTypeTag; }
+
+ private:
+  S2PointSoA vertices_;
+};
+
 #endif  // S2_S2LAX_POLYLINE_SHAPE_H_
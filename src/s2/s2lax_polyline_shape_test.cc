@@ -17,8 +17,12 @@
 
 #include "s2/s2lax_polyline_shape.h"
 
+#include <memory>
+
 #include <gtest/gtest.h>
+#include "s2/s2shapeutil_coding.h"
 #include "s2/s2text_format.h"
+#include "s2/util/coding/coder.h"
 
 using std::vector;
 
@@ -60,3 +64,31 @@ TEST(S2LaxPolylineShape, EdgeAccess) {
   EXPECT_EQ(vertices[1], edge1.v0);
   EXPECT_EQ(vertices[2], edge1.v1);
 }
+
+TEST(S2SoALaxPolylineShape, EdgeAccessAndCoding) {
+  vector<S2Point> vertices = s2textformat::ParsePoints("0:0, 0:1, 1:1, 2:0");
+  S2SoALaxPolylineShape shape(vertices);
+  S2LaxPolylineShape expected(vertices);
+  EXPECT_TRUE(shape.type_tag() == S2SoALaxPolylineShape::kTypeTag);
+  ASSERT_EQ(expected.num_edges(), shape.num_edges());
+  EXPECT_EQ(1, shape.num_chains());
+  EXPECT_EQ(1, shape.dimension());
+  for (int e = 0; e < shape.num_edges(); ++e) {
+    EXPECT_EQ(expected.edge(e), shape.edge(e));
+    EXPECT_EQ(expected.chain_edge(0, e), shape.chain_edge(0, e));
+  }
+  for (auto encode : {s2shapeutil::FastEncodeShape,
+                      s2shapeutil::CompactEncodeShape}) {
+    Encoder encoder;
+    ASSERT_TRUE(encode(shape, &encoder));
+    Decoder decoder(encoder.base(), encoder.length());
+    std::unique_ptr<S2Shape> decoded =
+        s2shapeutil::LazyDecodeShape(shape.type_tag(), &decoder);
+    ASSERT_TRUE(decoded != nullptr);
+    EXPECT_TRUE(decoded->type_tag() == S2SoALaxPolylineShape::kTypeTag);
+    ASSERT_EQ(shape.num_edges(), decoded->num_edges());
+    for (int e = 0; e < shape.num_edges(); ++e) {
+      EXPECT_EQ(shape.edge(e), decoded->edge(e));
+    }
+  }
+}
@@ -0,0 +1,100 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2lnglat_buffer_shape.h"
+
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2shapeutil_get_reference_point.h"
+
+using absl::make_unique;
+
+S2LngLatBuffer::S2LngLatBuffer(absl::Span<const double> coords)
+    : coords_(coords) {
+  S2_DCHECK_EQ(0, coords.size() % 2);
+}
+
+S2LngLatPolygonShape::S2LngLatPolygonShape(
+    S2LngLatBuffer points, absl::Span<const int32> ring_offsets)
+    : points_(points), ring_offsets_(ring_offsets),
+      num_loops_(std::max<int>(0, ring_offsets.size() - 1)) {
+  if (num_loops_ > 0) {
+    for (int i = 0; i < num_loops_; ++i) {
+      S2_DCHECK_GE(ring_offsets[i + 1] - ring_offsets[i], 2);
+    }
+    S2_DCHECK_LE(ring_offsets[num_loops_], points.num_points());
+    num_edges_ = ring_offsets[num_loops_] - ring_offsets[0] - num_loops_;
+  }
+}
+
+S2Shape::ReferencePoint S2LngLatPolygonShape::GetReferencePoint() const {
+  return s2shapeutil::GetReferencePoint(*this);
+}
+
+S2Shape::ChainPosition S2LngLatPolygonShape::chain_position(int e) const {
+  S2_DCHECK(e >= 0 && e < num_edges());
+  // Binary search for the last ring whose first edge is at most "e".
+  int lo = 0, hi = num_loops_ - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (chain(mid).start <= e) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return ChainPosition(lo, e - chain(lo).start);
+}
+
+int AddLngLatPointColumn(absl::Span<const double> coords,
+                         absl::Span<const int32> geom_offsets,
+                         MutableS2ShapeIndex* index) {
+  int first_id = index->num_shape_ids();
+  for (int i = 0; i + 1 < geom_offsets.size(); ++i) {
+    int begin = geom_offsets[i], end = geom_offsets[i + 1];
+    index->Add(make_unique<S2LngLatPointVectorShape>(S2LngLatBuffer(
+        coords.subspan(2 * begin, 2 * (end - begin)))));
+  }
+  return first_id;
+}
+
+int AddLngLatPolylineColumn(absl::Span<const double> coords,
+                            absl::Span<const int32> geom_offsets,
+                            MutableS2ShapeIndex* index) {
+  int first_id = index->num_shape_ids();
+  for (int i = 0; i + 1 < geom_offsets.size(); ++i) {
+    int begin = geom_offsets[i], end = geom_offsets[i + 1];
+    index->Add(make_unique<S2LngLatPolylineShape>(S2LngLatBuffer(
+        coords.subspan(2 * begin, 2 * (end - begin)))));
+  }
+  return first_id;
+}
+
+int AddLngLatPolygonColumn(absl::Span<const double> coords,
+                           absl::Span<const int32> ring_offsets,
+                           absl::Span<const int32> geom_offsets,
+                           MutableS2ShapeIndex* index) {
+  S2LngLatBuffer buffer(coords);
+  int first_id = index->num_shape_ids();
+  for (int i = 0; i + 1 < geom_offsets.size(); ++i) {
+    int begin = geom_offsets[i], end = geom_offsets[i + 1];
+    // The rings of this geometry are described by the ring offsets
+    // [begin, end], which includes the end offset of the last ring.
+    index->Add(make_unique<S2LngLatPolygonShape>(
+        buffer, ring_offsets.subspan(begin, end - begin + 1)));
+  }
+  return first_id;
+}
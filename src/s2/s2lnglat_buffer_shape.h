@@ -0,0 +1,203 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// This file defines S2Shape types that are views of geometry stored in
+// columnar form, such as the "native" encodings of Apache Arrow and
+// GeoParquet (GeoArrow).  The coordinates are given as a buffer of
+// interleaved (longitude, latitude) pairs in degrees, and multi-part
+// geometries are described by arrays of offsets into that buffer.  The
+// shapes do not copy or validate their input; each vertex is converted to
+// an S2Point when it is accessed, so the buffers must outlive the shapes.
+//
+// The functions at the end of this file add an entire column of geometries
+// to a MutableS2ShapeIndex at once.
+
+#ifndef S2_S2LNGLAT_BUFFER_SHAPE_H_
+#define S2_S2LNGLAT_BUFFER_SHAPE_H_
+
+#include <algorithm>
+
+#include "s2/base/logging.h"
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/s2latlng.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+
+class MutableS2ShapeIndex;
+
+// A view of an interleaved (longitude, latitude) coordinate buffer in
+// degrees, i.e. {lng0, lat0, lng1, lat1, ...}.
+class S2LngLatBuffer {
+ public:
+  S2LngLatBuffer() {}
+
+  // REQUIRES: coords.size() is even.
+  explicit S2LngLatBuffer(absl::Span<const double> coords);
+
+  int num_points() const { return coords_.size() / 2; }
+
+  // Returns the given point converted to an S2Point.
+  S2Point point(int i) const {
+    return S2LatLng::FromDegrees(coords_[2 * i + 1], coords_[2 * i]).ToPoint();
+  }
+
+ private:
+  absl::Span<const double> coords_;
+};
+
+// A collection of points stored in an S2LngLatBuffer (e.g. an Arrow
+// "geoarrow.point" or "geoarrow.multipoint" column value).
+class S2LngLatPointVectorShape : public S2Shape {
+ public:
+  S2LngLatPointVectorShape() {}
+  explicit S2LngLatPointVectorShape(S2LngLatBuffer points)
+      : points_(points) {}
+
+  int num_points() const { return points_.num_points(); }
+  S2Point point(int i) const { return points_.point(i); }
+
+  // S2Shape interface:
+  int num_edges() const final { return num_points(); }
+  Edge edge(int e) const final {
+    S2Point p = point(e);
+    return Edge(p, p);
+  }
+  int dimension() const final { return 0; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final { return num_points(); }
+  Chain chain(int i) const final { return Chain(i, 1); }
+  Edge chain_edge(int i, int j) const final {
+    S2_DCHECK_EQ(j, 0);
+    return edge(i);
+  }
+  ChainPosition chain_position(int e) const final {
+    return ChainPosition(e, 0);
+  }
+
+ private:
+  S2LngLatBuffer points_;
+};
+
+// A polyline whose vertices are stored in an S2LngLatBuffer (e.g. an Arrow
+// "geoarrow.linestring" column value).  Like S2LaxPolylineShape, a polyline
+// with fewer than two vertices has no edges.
+class S2LngLatPolylineShape : public S2Shape {
+ public:
+  S2LngLatPolylineShape() {}
+  explicit S2LngLatPolylineShape(S2LngLatBuffer vertices)
+      : vertices_(vertices) {}
+
+  int num_vertices() const { return vertices_.num_points(); }
+  S2Point vertex(int i) const { return vertices_.point(i); }
+
+  // S2Shape interface:
+  int num_edges() const final { return std::max(0, num_vertices() - 1); }
+  Edge edge(int e) const final { return Edge(vertex(e), vertex(e + 1)); }
+  int dimension() const final { return 1; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final { return std::min(1, num_edges()); }
+  Chain chain(int i) const final { return Chain(0, num_edges()); }
+  Edge chain_edge(int i, int j) const final {
+    S2_DCHECK_EQ(i, 0);
+    return edge(j);
+  }
+  ChainPosition chain_position(int e) const final {
+    return ChainPosition(0, e);
+  }
+
+ private:
+  S2LngLatBuffer vertices_;
+};
+
+// A polygon whose rings are stored in an S2LngLatBuffer and described by
+// an array of ring offsets, as in an Arrow "geoarrow.polygon" or
+// "geoarrow.multipolygon" column value.  Ring "i" consists of the points
+// [ring_offsets[i], ring_offsets[i + 1]) of the buffer, and as in WKB each
+// ring repeats its first vertex at the end.  (The offsets may be a slice of
+// a larger offsets array, and so need not start at zero.)
+//
+// The interior is the region to the left of all rings, as for
+// S2LaxPolygonShape.  This means that shells must be counter-clockwise and
+// holes clockwise, which is the OGC convention; rings are not reoriented.
+class S2LngLatPolygonShape : public S2Shape {
+ public:
+  S2LngLatPolygonShape() {}
+
+  // REQUIRES: ring_offsets is empty or non-decreasing, and each ring has
+  //           at least two points (otherwise it would be a full loop).
+  S2LngLatPolygonShape(S2LngLatBuffer points,
+                       absl::Span<const int32> ring_offsets);
+
+  int num_loops() const { return num_loops_; }
+  int num_loop_vertices(int i) const { return chain(i).length; }
+
+  // S2Shape interface:
+  int num_edges() const final { return num_edges_; }
+  Edge edge(int e) const final {
+    ChainPosition pos = chain_position(e);
+    return chain_edge(pos.chain_id, pos.offset);
+  }
+  int dimension() const final { return 2; }
+  ReferencePoint GetReferencePoint() const final;
+  int num_chains() const final { return num_loops_; }
+  Chain chain(int i) const final {
+    // Each ring has one more point than it has edges.
+    return Chain(ring_offsets_[i] - ring_offsets_[0] - i,
+                 ring_offsets_[i + 1] - ring_offsets_[i] - 1);
+  }
+  Edge chain_edge(int i, int j) const final {
+    int k = ring_offsets_[i] + j;
+    return Edge(points_.point(k), points_.point(k + 1));
+  }
+  ChainPosition chain_position(int e) const final;
+
+ private:
+  S2LngLatBuffer points_;
+  absl::Span<const int32> ring_offsets_;
+  int num_loops_ = 0;
+  int num_edges_ = 0;
+};
+
+// The following functions add one shape per geometry of a column to
+// "index", and return the id of the first shape added (the shape ids of
+// the column are consecutive).  "coords" is the interleaved coordinate
+// buffer of the column, and geometry "i" consists of the elements
+// [geom_offsets[i], geom_offsets[i + 1]) of the next level down, i.e. the
+// points of "coords" for point and polyline columns, and the rings of
+// "ring_offsets" for polygon columns.  Multi-geometries whose offsets have
+// an additional level can be added by passing the innermost offsets (e.g.
+// the part offsets of a MultiLineString column add one shape per part).
+// The buffers must outlive the index.
+//
+// The index is built lazily, so adding a column is cheap; the cost of
+// building the index is paid by the first query.
+int AddLngLatPointColumn(absl::Span<const double> coords,
+                         absl::Span<const int32> geom_offsets,
+                         MutableS2ShapeIndex* index);
+int AddLngLatPolylineColumn(absl::Span<const double> coords,
+                            absl::Span<const int32> geom_offsets,
+                            MutableS2ShapeIndex* index);
+int AddLngLatPolygonColumn(absl::Span<const double> coords,
+                           absl::Span<const int32> ring_offsets,
+                           absl::Span<const int32> geom_offsets,
+                           MutableS2ShapeIndex* index);
+
+#endif  // S2_S2LNGLAT_BUFFER_SHAPE_H_
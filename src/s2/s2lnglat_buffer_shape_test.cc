@@ -0,0 +1,105 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2lnglat_buffer_shape.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2text_format.h"
+
+using std::vector;
+
+namespace {
+
+TEST(S2LngLatPointVectorShape, Basic) {
+  vector<double> coords = {10, 20, -30, 40};
+  S2LngLatPointVectorShape shape{S2LngLatBuffer(coords)};
+  EXPECT_EQ(2, shape.num_edges());
+  EXPECT_EQ(2, shape.num_chains());
+  EXPECT_EQ(0, shape.dimension());
+  EXPECT_EQ(s2textformat::MakePointOrDie("40:-30"), shape.edge(1).v0);
+}
+
+TEST(S2LngLatPolylineShape, MatchesLaxPolyline) {
+  vector<double> coords = {0, 0, 5, 0, 5, 5, 10, 5};
+  S2LngLatPolylineShape shape{S2LngLatBuffer(coords)};
+  auto expected = s2textformat::MakeLaxPolylineOrDie("0:0, 0:5, 5:5, 5:10");
+  s2testing::ExpectEqual(*expected, shape);
+}
+
+TEST(S2LngLatPolygonShape, MatchesLaxPolygon) {
+  // A shell and a hole, as a slice of a larger offsets array.
+  vector<double> coords = {
+    99, 99,
+    0, 0, 10, 0, 10, 10, 0, 10, 0, 0,
+    4, 4, 4, 6, 6, 6, 6, 4, 4, 4,
+  };
+  vector<int32> ring_offsets = {0, 1, 6, 11};
+  S2LngLatPolygonShape shape(
+      S2LngLatBuffer(coords),
+      absl::MakeConstSpan(ring_offsets).subspan(1));
+  auto expected = s2textformat::MakeLaxPolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 4:4, 6:4, 6:6, 4:6");
+  s2testing::ExpectEqual(*expected, shape);
+  EXPECT_EQ(expected->GetReferencePoint(), shape.GetReferencePoint());
+}
+
+TEST(AddLngLatPolygonColumn, Containment) {
+  // Two polygons: a square with a hole, and a triangle.
+  vector<double> coords = {
+    0, 0, 10, 0, 10, 10, 0, 10, 0, 0,
+    4, 4, 4, 6, 6, 6, 6, 4, 4, 4,
+    20, 20, 30, 20, 25, 25, 20, 20,
+  };
+  vector<int32> ring_offsets = {0, 5, 10, 14};
+  vector<int32> geom_offsets = {0, 2, 3};
+  MutableS2ShapeIndex index;
+  EXPECT_EQ(0, AddLngLatPolygonColumn(coords, ring_offsets, geom_offsets,
+                                      &index));
+  ASSERT_EQ(2, index.num_shape_ids());
+  EXPECT_EQ(8, index.shape(0)->num_edges());
+  EXPECT_EQ(3, index.shape(1)->num_edges());
+  auto query = MakeS2ContainsPointQuery(&index);
+  EXPECT_TRUE(query.ShapeContains(*index.shape(0),
+                                  s2textformat::MakePointOrDie("2:2")));
+  EXPECT_FALSE(query.ShapeContains(*index.shape(0),
+                                   s2textformat::MakePointOrDie("5:5")));
+  EXPECT_TRUE(query.ShapeContains(*index.shape(1),
+                                  s2textformat::MakePointOrDie("22:25")));
+  EXPECT_FALSE(query.Contains(s2textformat::MakePointOrDie("15:15")));
+}
+
+TEST(AddLngLatPointAndPolylineColumns, ShapeIds) {
+  vector<double> coords = {0, 0, 1, 1, 2, 2, 3, 3, 4, 4};
+  vector<int32> offsets = {0, 2, 5};
+  MutableS2ShapeIndex index;
+  EXPECT_EQ(0, AddLngLatPointColumn(coords, offsets, &index));
+  EXPECT_EQ(2, AddLngLatPolylineColumn(coords, offsets, &index));
+  ASSERT_EQ(4, index.num_shape_ids());
+  EXPECT_EQ(3, index.shape(1)->num_edges());
+  EXPECT_EQ(1, index.shape(2)->num_edges());
+  EXPECT_EQ(2, index.shape(3)->num_edges());
+}
+
+}  // namespace
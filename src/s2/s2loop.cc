@@ -53,6 +53,7 @@
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 #include "s2/s2wedge_relations.h"
 #include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/container/fixed_array.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/types/span.h"
 #include "s2/util/coding/coder.h"
@@ -66,6 +67,7 @@ using std::max;
 using std::min;
 using std::pair;
 using std::set;
+using std::unique_ptr;
 using std::vector;
 
 DEFINE_bool(
@@ -105,6 +107,23 @@ S2Loop::S2Loop(const vector<S2Point>& vertices,
   Init(vertices);
 }
 
+S2Loop::S2Loop(vector<S2Point>&& vertices)
+  : S2Loop(std::move(vertices), S2Debug::ALLOW) {}
+
+S2Loop::S2Loop(vector<S2Point>&& vertices, S2Debug override)
+  : s2debug_override_(override) {
+  Init(std::move(vertices));
+}
+
+S2Loop::S2Loop(unique_ptr<S2Point[]> vertices, int num_vertices)
+  : S2Loop(std::move(vertices), num_vertices, S2Debug::ALLOW) {}
+
+S2Loop::S2Loop(unique_ptr<S2Point[]> vertices, int num_vertices,
+               S2Debug override)
+  : s2debug_override_(override) {
+  Init(std::move(vertices), num_vertices);
+}
+
 void S2Loop::set_s2debug_override(S2Debug override) {
   s2debug_override_ = override;
 }
@@ -113,14 +132,23 @@ S2Debug S2Loop::s2debug_override() const {
   return s2debug_override_;
 }
 
+const int S2Loop::kDefaultMaxUnindexedContainsCalls;
+
 void S2Loop::ClearIndex() {
   unindexed_contains_calls_.store(0, std::memory_order_relaxed);
   index_.Clear();
 }
 
+void S2Loop::FreeVertices() {
+  if (owns_vertices_ && vertex_storage_.empty()) delete[] vertices_;
+  vector<S2Point>().swap(vertex_storage_);
+  vertices_ = nullptr;
+  owns_vertices_ = false;
+}
+
 void S2Loop::Init(const vector<S2Point>& vertices) {
   ClearIndex();
-  if (owns_vertices_) delete[] vertices_;
+  FreeVertices();
   num_vertices_ = vertices.size();
   vertices_ = new S2Point[num_vertices_];
   std::copy(vertices.begin(), vertices.end(), &vertices_[0]);
@@ -128,6 +156,27 @@ void S2Loop::Init(const vector<S2Point>& vertices) {
   InitOriginAndBound();
 }
 
+void S2Loop::Init(vector<S2Point>&& vertices) {
+  ClearIndex();
+  FreeVertices();
+  num_vertices_ = vertices.size();
+  if (num_vertices_ > 0) {
+    vertex_storage_ = std::move(vertices);
+    vertices_ = vertex_storage_.data();
+    owns_vertices_ = true;
+  }
+  InitOriginAndBound();
+}
+
+void S2Loop::Init(unique_ptr<S2Point[]> vertices, int num_vertices) {
+  ClearIndex();
+  FreeVertices();
+  num_vertices_ = num_vertices;
+  vertices_ = vertices.release();
+  owns_vertices_ = true;
+  InitOriginAndBound();
+}
+
 bool S2Loop::IsValid() const {
   S2Error error;
   if (FindValidationError(&error)) {
@@ -258,9 +307,8 @@ void S2Loop::InitBound() {
   // Note that a small clockwise loop near the equator contains both poles.
 
   S2LatLngRectBounder bounder;
-  for (int i = 0; i <= num_vertices(); ++i) {
-    bounder.AddPoint(vertex(i));
-  }
+  bounder.AddPoints(vertices_span());
+  bounder.AddPoint(vertex(0));
   S2LatLngRect b = bounder.GetBound();
   if (Contains(S2Point(0, 0, 1))) {
     b = S2LatLngRect(R1Interval(b.lat().lo(), M_PI_2), S1Interval::Full());
@@ -304,7 +352,7 @@ S2Loop::S2Loop(const S2Cell& cell)
 }
 
 S2Loop::~S2Loop() {
-  if (owns_vertices_) delete[] vertices_;
+  FreeVertices();
 }
 
 S2Loop::S2Loop(const S2Loop& src)
@@ -315,6 +363,7 @@ S2Loop::S2Loop(const S2Loop& src)
       s2debug_override_(src.s2debug_override_),
       origin_inside_(src.origin_inside_),
       unindexed_contains_calls_(0),
+      max_unindexed_contains_calls_(src.max_unindexed_contains_calls_),
       bound_(src.bound_),
       subregion_bound_(src.subregion_bound_) {
   std::copy(&src.vertices_[0], &src.vertices_[num_vertices_], &vertices_[0]);
@@ -532,16 +581,18 @@ bool S2Loop::Contains(const S2Point& p) const {
   // time we would have saved with an index approximately equals the cost of
   // building the index, and then build it.  (This gives the optimal
   // competitive ratio of 2; look up "competitive algorithms" for details.)
-  // We set the limit somewhat lower than this (20 rather than 50) because
-  // building the index may be forced anyway by other API calls, and so we
-  // want to err on the side of building it too early.
+  // We set the default limit somewhat lower than this (20 rather than 50)
+  // because building the index may be forced anyway by other API calls, and
+  // so we want to err on the side of building it too early.  Clients that
+  // know how many calls they will make can change the limit (see
+  // set_max_unindexed_contains_calls).
 
   static const int kMaxBruteForceVertices = 32;
-  static const int kMaxUnindexedContainsCalls = 20;  // See notes above.
+  const int max_calls = max_unindexed_contains_calls_;
   if (index_.num_shape_ids() == 0 ||  // InitIndex() not called yet
       num_vertices() <= kMaxBruteForceVertices ||
       (!index_.is_fresh() &&
-       ++unindexed_contains_calls_ != kMaxUnindexedContainsCalls)) {
+       (max_calls < 0 || ++unindexed_contains_calls_ != max_calls + 1))) {
     return BruteForceContains(p);
   }
   // Otherwise we look up the S2ShapeIndex cell containing this point.  Note
@@ -556,11 +607,22 @@ bool S2Loop::BruteForceContains(const S2Point& p) const {
   // zero vertices do, so we might as well handle them all at once.
   if (num_vertices() < 3) return origin_inside_;
 
+  // An edge can cross the segment from "origin" to "p" only if its endpoints
+  // are not definitely on the same side of the great circle through them, so
+  // we classify all the vertices first and then skip most edges entirely.
   S2Point origin = S2::Origin();
-  S2EdgeCrosser crosser(&origin, &p, &vertex(0));
+  S2EdgeCrosser crosser(&origin, &p);
+  absl::FixedArray<int8> signs(num_vertices());
+  s2pred::TriageSigns(origin, p, origin.CrossProd(p),
+                      S2PointSpan(vertices_, num_vertices()), signs.data());
   bool inside = origin_inside_;
-  for (int i = 1; i <= num_vertices(); ++i) {
-    inside ^= crosser.EdgeOrVertexCrossing(&vertex(i));
+  int chain_end = -1;  // The last vertex passed to "crosser".
+  for (int i = 0; i < num_vertices(); ++i) {
+    int j = (i + 1 == num_vertices()) ? 0 : i + 1;
+    if (signs[i] * signs[j] > 0) continue;
+    if (chain_end != i) crosser.RestartAt(&vertex(i));
+    inside ^= crosser.EdgeOrVertexCrossing(&vertex(i + 1));
+    chain_end = i + 1;
   }
   return inside;
 }
@@ -619,6 +681,14 @@ bool S2Loop::DecodeWithinScope(Decoder* const decoder) {
   return false;
 }
 
+bool S2Loop::DecodeTrusted(Decoder* const decoder) {
+  S2Debug s2debug_override = s2debug_override_;
+  s2debug_override_ = S2Debug::DISABLE;
+  bool success = Decode(decoder);
+  s2debug_override_ = s2debug_override;
+  return success;
+}
+
 bool S2Loop::DecodeInternal(Decoder* const decoder,
                             bool within_scope) {
   // Perform all checks before modifying vertex state. Empty loops are
@@ -634,7 +704,7 @@ bool S2Loop::DecodeInternal(Decoder* const decoder,
     return false;
   }
   ClearIndex();
-  if (owns_vertices_) delete[] vertices_;
+  FreeVertices();
   num_vertices_ = num_vertices;
 
   // x86 can do unaligned floating-point reads; however, many other
@@ -1375,7 +1445,7 @@ void S2Loop::GetXYZFaceSiTiVertices(S2XYZFaceSiTi* vertices) const {
 }
 
 void S2Loop::EncodeCompressed(Encoder* encoder, const S2XYZFaceSiTi* vertices,
-                              int snap_level) const {
+                              int snap_level, bool encode_bound) const {
   // Ensure enough for the data we write before S2EncodePointsCompressed.
   // S2EncodePointsCompressed ensures its space.
   encoder->Ensure(Encoder::kVarintMax32);
@@ -1384,7 +1454,8 @@ void S2Loop::EncodeCompressed(Encoder* encoder, const S2XYZFaceSiTi* vertices,
   S2EncodePointsCompressed(MakeSpan(vertices, num_vertices_),
                            snap_level, encoder);
 
-  std::bitset<kNumProperties> properties = GetCompressedEncodingProperties();
+  std::bitset<kNumProperties> properties =
+      GetCompressedEncodingProperties(encode_bound);
 
   // Ensure enough only for what we write.  Let the bound ensure its own
   // space.
@@ -1409,7 +1480,7 @@ bool S2Loop::DecodeCompressed(Decoder* decoder, int snap_level) {
     return false;
   }
   ClearIndex();
-  if (owns_vertices_) delete[] vertices_;
+  FreeVertices();
   num_vertices_ = unsigned_num_vertices;
   vertices_ = new S2Point[num_vertices_];
   owns_vertices_ = true;
@@ -1443,7 +1514,8 @@ bool S2Loop::DecodeCompressed(Decoder* decoder, int snap_level) {
   return true;
 }
 
-std::bitset<kNumProperties> S2Loop::GetCompressedEncodingProperties() const {
+std::bitset<kNumProperties> S2Loop::GetCompressedEncodingProperties(
+    bool encode_bound) const {
   std::bitset<kNumProperties> properties;
   if (origin_inside_) {
     properties.set(kOriginInside);
@@ -1457,7 +1529,7 @@ std::bitset<kNumProperties> S2Loop::GetCompressedEncodingProperties() const {
   // acceptable.  At ~3.5 bytes / vertex without the bound, adding
   // the bound will increase the size by <15%, which is also acceptable.
   static const int kMinVerticesForBound = 64;
-  if (num_vertices_ >= kMinVerticesForBound) {
+  if (encode_bound || num_vertices_ >= kMinVerticesForBound) {
     properties.set(kBoundEncoded);
   }
   return properties;
@@ -112,6 +112,20 @@ class S2Loop final : public S2Region {
   // kEmpty and kFull).  This method may be called multiple times.
   void Init(const std::vector<S2Point>& vertices);
 
+  // Like the constructors and Init() above, except that the loop takes
+  // ownership of the given vertex storage rather than copying it.  Note that
+  // any excess capacity in the vector is retained.
+  explicit S2Loop(std::vector<S2Point>&& vertices);
+  S2Loop(std::vector<S2Point>&& vertices, S2Debug override);
+  void Init(std::vector<S2Point>&& vertices);
+
+  // Like the above, except that the vertices are given as an array of
+  // "num_vertices" points allocated with new[].
+  S2Loop(std::unique_ptr<S2Point[]> vertices, int num_vertices);
+  S2Loop(std::unique_ptr<S2Point[]> vertices, int num_vertices,
+         S2Debug override);
+  void Init(std::unique_ptr<S2Point[]> vertices, int num_vertices);
+
   // A special vertex chain of length 1 that creates an empty loop (i.e., a
   // loop with no edges that contains no points).  Example usage:
   //
@@ -389,6 +403,22 @@ class S2Loop final : public S2Region {
   // The point 'p' does not need to be normalized.
   bool Contains(const S2Point& p) const override;
 
+  // Contains(S2Point) does not build the loop's S2ShapeIndex until it has
+  // been called this many times, using a brute force crossing test instead.
+  // (Loops with few vertices always use brute force.)  Clients that plan to
+  // make many Contains(S2Point) calls can set this to 0 so that the index is
+  // built by the first call, while clients that make only a few calls can
+  // set it to -1 so that this method never builds the index.  Note that the
+  // index may still be built by other methods.  This setting is copied by
+  // the copy constructor.
+  static const int kDefaultMaxUnindexedContainsCalls = 20;
+  void set_max_unindexed_contains_calls(int max_calls) {
+    max_unindexed_contains_calls_ = max_calls;
+  }
+  int max_unindexed_contains_calls() const {
+    return max_unindexed_contains_calls_;
+  }
+
   // Appends a serialized representation of the S2Loop to "encoder".
   //
   // Generally clients should not use S2Loop::Encode().  Instead they should
@@ -412,6 +442,13 @@ class S2Loop final : public S2Region {
   // only valid within the scope (lifetime) of the Decoder's memory buffer.
   bool DecodeWithinScope(Decoder* const decoder);
 
+  // Like Decode(), except that the encoded data is trusted to have been
+  // produced by Encode() from a valid loop.  The loop is not validated (even
+  // when --s2debug is enabled), and the encoded bound, depth, and
+  // origin_inside values are used as is.  Returns false only if the data is
+  // truncated or otherwise cannot be parsed.
+  bool DecodeTrusted(Decoder* const decoder);
+
   ////////////////////////////////////////////////////////////////////////
   // Methods intended primarily for use by the S2Polygon implementation:
 
@@ -486,6 +523,13 @@ class S2Loop final : public S2Region {
     ChainPosition chain_position(int e) const final {
       return ChainPosition(0, e);
     }
+    bool GetChainVertices(int i, S2PointSpan* vertices) const final {
+      S2_DCHECK_EQ(i, 0);
+      // Empty and full loops have a vertex but no edges.
+      if (loop_->is_empty_or_full()) return false;
+      *vertices = S2PointSpan(&loop_->vertex(0), loop_->num_vertices());
+      return true;
+    }
 
    private:
     const S2Loop* loop_;
@@ -512,6 +556,7 @@ class S2Loop final : public S2Region {
   // method should be public.
   friend class Shape;
   friend class S2Polygon;
+  friend class EncodedS2Polygon;
   friend class S2Stats;
   friend class S2LoopTestBase;
   friend class LoopCrosser;
@@ -537,6 +582,8 @@ class S2Loop final : public S2Region {
   static S2Point kFullVertex();
 
   void InitOriginAndBound();
+  // Releases the current vertices (if owned) and clears vertex_storage_.
+  void FreeVertices();
   void InitBound();
   void InitIndex();
 
@@ -569,8 +616,12 @@ class S2Loop final : public S2Region {
   // GetXYZFaceSiTiVertices.
   //
   // REQUIRES: the loop is initialized and valid.
+  //
+  // If "encode_bound" is true then the bound is always encoded, otherwise it
+  // is encoded only for loops with many vertices (since it can be
+  // recomputed when the loop is decoded).
   void EncodeCompressed(Encoder* encoder, const S2XYZFaceSiTi* vertices,
-                        int snap_level) const;
+                        int snap_level, bool encode_bound = false) const;
 
   // Decode a loop encoded with EncodeCompressed. The parameters must be the
   // same as the one used when EncodeCompressed was called.
@@ -579,7 +630,7 @@ class S2Loop final : public S2Region {
   // Returns a bitset of properties used by EncodeCompressed
   // to efficiently encode boolean values.  Properties are
   // origin_inside and whether the bound was encoded.
-  std::bitset<2> GetCompressedEncodingProperties() const;
+  std::bitset<2> GetCompressedEncodingProperties(bool encode_bound) const;
 
   // Given an iterator that is already positioned at the S2ShapeIndexCell
   // containing "p", returns Contains(p).
@@ -640,6 +691,11 @@ class S2Loop final : public S2Region {
   S2Point* vertices_ = nullptr;
   bool owns_vertices_ = false;
 
+  // When the loop is initialized from a std::vector that it takes ownership
+  // of, this field holds that vector and vertices_ points to its data.
+  // Otherwise it is empty and owned vertices_ were allocated with new[].
+  std::vector<S2Point> vertex_storage_;
+
   S2Debug s2debug_override_ = S2Debug::ALLOW;
   bool origin_inside_ = false;  // Does the loop contain S2::Origin()?
 
@@ -649,6 +705,7 @@ class S2Loop final : public S2Region {
   // we keep track of the number of calls made and only build the index once
   // enough calls have been made that we think an index would be worthwhile.
   mutable std::atomic<int32> unindexed_contains_calls_;
+  int32 max_unindexed_contains_calls_ = kDefaultMaxUnindexedContainsCalls;
 
   // "bound_" is a conservative bound on all points contained by this loop:
   // if A.Contains(P), then A.bound_.Contains(S2LatLng(P)).
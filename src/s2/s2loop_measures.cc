@@ -51,6 +51,60 @@ double GetArea(S2PointLoopSpan loop) {
   return area;
 }
 
+// Computes the signed area of "loop" as the sum over the triangle fan from
+// vertex 0, returning false if any edge of the fan might be numerically
+// unstable (in which case GetSurfaceIntegral must be used instead).  This
+// handles the common case of loops that span much less than a hemisphere.
+//
+// Each triangle area is computed using the formula of Van Oosterom and
+// Strackee,
+//
+//   tan(E/2) = det(a, b, c) / (1 + a.b + b.c + c.a) ,
+//
+// which requires only one atan2() per triangle rather than the seven trig
+// functions used by S2::SignedArea().  The determinant is evaluated as
+// a.((b-a)x(c-a)), which has good relative accuracy for small triangles since
+// the differences are computed almost exactly, and the denominator is
+// between 1 and 4 for such triangles.  Finally the triangle areas are summed
+// using compensated (Neumaier) summation, so that the error of the result
+// does not grow with the number of vertices.
+static bool GetFanSignedArea(S2PointLoopSpan loop, double* area) {
+  *area = 0;
+  int n = loop.size();
+  if (n < 3) return true;
+  // The fan edges must be shorter than the kMaxLength threshold used by
+  // GetSurfaceIntegral (Pi - 1e-5).  Any two points whose dot product exceeds
+  // this value are separated by less than 3 radians, even with rounding.
+  static const double kMinDotProd = -0.99;
+  const S2Point& a = loop[0];
+  for (int i = 2; i < n - 1; ++i) {
+    if (a.DotProd(loop[i]) < kMinDotProd) return false;
+  }
+  // The fan triangles are processed in blocks so that the determinants and
+  // denominators can be computed in straight-line code before the atan2()
+  // calls.
+  static const int kBlockSize = 8;
+  double num[kBlockSize], den[kBlockSize];
+  double sum = 0, c = 0;
+  for (int begin = 1; begin + 1 < n; begin += kBlockSize) {
+    int count = min(kBlockSize, n - 1 - begin);
+    for (int k = 0; k < count; ++k) {
+      const S2Point& b = loop[begin + k];
+      const S2Point& v = loop[begin + k + 1];
+      num[k] = a.DotProd((b - a).CrossProd(v - a));
+      den[k] = 1 + a.DotProd(b) + b.DotProd(v) + v.DotProd(a);
+    }
+    for (int k = 0; k < count; ++k) {
+      double e = 2 * atan2(num[k], den[k]);
+      double t = sum + e;
+      c += (fabs(sum) >= fabs(e)) ? (sum - t) + e : (e - t) + sum;
+      sum = t;
+    }
+  }
+  *area = sum + c;
+  return true;
+}
+
 double GetSignedArea(S2PointLoopSpan loop) {
   // It is suprisingly difficult to compute the area of a loop robustly.  The
   // main issues are (1) whether degenerate loops are considered to be CCW or
@@ -118,7 +172,10 @@ double GetSignedArea(S2PointLoopSpan loop) {
 
   // The signed area should be between approximately -4*Pi and 4*Pi.
   // Normalize it to be in the range [-2*Pi, 2*Pi].
-  double area = GetSurfaceIntegral(loop, S2::SignedArea);
+  double area;
+  if (!GetFanSignedArea(loop, &area)) {
+    area = GetSurfaceIntegral(loop, S2::SignedArea);
+  }
   double max_error = GetCurvatureMaxError(loop);
   S2_DCHECK_LE(fabs(area), 4 * M_PI + max_error);
   area = remainder(area, 4 * M_PI);
@@ -219,6 +219,11 @@ T GetSurfaceIntegral(S2PointLoopSpan loop,
   // reduced further if desired.
   static const double kMaxLength = M_PI - 1e-5;
 
+  // Points whose dot product is at least this value are separated by less
+  // than 3 radians (even allowing for rounding errors), which is used to
+  // avoid computing most edge lengths.
+  static const double kMinDotProd = -0.99;
+
   // The default constructor for T must initialize the value to zero.
   // (This is true for built-in types such as "double".)
   T sum = T();
@@ -239,7 +244,8 @@ T GetSurfaceIntegral(S2PointLoopSpan loop,
     S2_DCHECK(i == 1 || origin.Angle(loop[i]) < kMaxLength);
     S2_DCHECK(origin == loop[0] || std::fabs(origin.DotProd(loop[0])) < 1e-15);
 
-    if (loop[i + 1].Angle(origin) > kMaxLength) {
+    if (origin.DotProd(loop[i + 1]) < kMinDotProd &&
+        loop[i + 1].Angle(origin) > kMaxLength) {
       // We are about to create an unstable edge, so choose a new origin O'
       // for the triangle fan.
       S2Point old_origin = origin;
@@ -25,6 +25,7 @@
 #include "s2/s2latlng.h"
 #include "s2/s2loop.h"
 #include "s2/s2measures.h"
+#include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
@@ -236,6 +237,34 @@ TEST_F(LoopTestBase, GetAreaAccuracy) {
   // than 1e-15 on loops whose area is small.
 }
 
+TEST(GetSignedArea, MatchesSurfaceIntegral) {
+  // GetSignedArea() sums the triangle fan directly for loops where this is
+  // numerically stable.  Check that it agrees with the general method (which
+  // uses l'Huilier's formula) to within a small error, for loops
+  // ranging from a few millimeters to nearly a hemisphere across.
+  for (double radius : {1e-9, 1e-6, 1e-3, 0.1, 1.0, 1.5}) {
+    for (int num_vertices : {3, 4, 17, 1000}) {
+      auto loop = S2Loop::MakeRegularLoop(S2Point(1, 2, 3).Normalize(),
+                                          S1Angle::Radians(radius),
+                                          num_vertices);
+      vector<S2Point> vertices(&loop->vertex(0),
+                               &loop->vertex(0) + loop->num_vertices());
+      double expected = S2::GetSurfaceIntegral(S2PointLoopSpan(vertices),
+                                               S2::SignedArea);
+      double actual = S2::GetSignedArea(vertices);
+      // The vertices themselves have rounding errors of about 1e-16, which
+      // perturbs the true area by up to about 1e-16 times the perimeter.
+      double max_error = 1e-13 * expected + 1e-15 * radius;
+      EXPECT_NEAR(expected, actual, max_error)
+          << "radius " << radius << ", num_vertices " << num_vertices;
+
+      // The reversed loop has the opposite signed area.
+      vector<S2Point> reversed(vertices.rbegin(), vertices.rend());
+      EXPECT_NEAR(-actual, S2::GetSignedArea(reversed), max_error);
+    }
+  }
+}
+
 TEST_F(LoopTestBase, GetAreaAndCentroid) {
   EXPECT_EQ(4 * M_PI, S2::GetArea(full_));
   EXPECT_EQ(S2Point(0, 0, 0), S2::GetCentroid(full_));
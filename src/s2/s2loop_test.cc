@@ -36,6 +36,7 @@
 #include "s2/s1angle.h"
 #include "s2/s1interval.h"
 #include "s2/s2cell.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2debug.h"
 #include "s2/s2edge_crossings.h"
@@ -518,6 +519,34 @@ TEST_F(S2LoopTestBase, Contains) {
   }
 }
 
+TEST(S2Loop, MaxUnindexedContainsCalls) {
+  // Check that Contains(S2Point) gives the same results regardless of when
+  // (or whether) the index is built, and that the setting is preserved by
+  // Clone().
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  unique_ptr<S2Loop> loop = S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(10), 100);
+  EXPECT_EQ(S2Loop::kDefaultMaxUnindexedContainsCalls,
+            loop->max_unindexed_contains_calls());
+  vector<S2Point> points;
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(S2Testing::SamplePoint(S2Cap(S2Point(1, 0, 0),
+                                                  S1Angle::Degrees(15))));
+  }
+  // A limit of -1 means that Contains(S2Point) always uses brute force.
+  unique_ptr<S2Loop> brute_force(loop->Clone());
+  brute_force->set_max_unindexed_contains_calls(-1);
+  for (int max_calls : {0, 1, 50}) {
+    unique_ptr<S2Loop> copy(loop->Clone());
+    copy->set_max_unindexed_contains_calls(max_calls);
+    unique_ptr<S2Loop> copy2(copy->Clone());
+    EXPECT_EQ(max_calls, copy2->max_unindexed_contains_calls());
+    for (const S2Point& p : points) {
+      EXPECT_EQ(brute_force->Contains(p), copy2->Contains(p));
+    }
+  }
+}
+
 TEST(S2Loop, ContainsMatchesCrossingSign) {
   // This test demonstrates a former incompatibility between CrossingSign()
   // and Contains(const S2Point&).  It constructs an S2Cell-based loop L and
@@ -1055,6 +1084,20 @@ TEST(S2Loop, EncodeDecode) {
   TestEncodeDecode(uninitialized);
 }
 
+TEST(S2Loop, DecodeTrusted) {
+  unique_ptr<S2Loop> l(s2textformat::MakeLoop("30:20, 40:20, 39:43, 33:35"));
+  l->set_depth(3);
+  Encoder encoder;
+  l->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Loop decoded_loop;
+  ASSERT_TRUE(decoded_loop.DecodeTrusted(&decoder));
+  EXPECT_TRUE(l->Equals(&decoded_loop));
+  EXPECT_EQ(l->depth(), decoded_loop.depth());
+  EXPECT_EQ(l->GetRectBound(), decoded_loop.GetRectBound());
+  EXPECT_EQ(S2Debug::ALLOW, decoded_loop.s2debug_override());
+}
+
 static void TestEmptyFullSnapped(const S2Loop& loop, int level) {
   S2_CHECK(loop.is_empty_or_full());
   S2CellId cellid = S2CellId(loop.vertex(0)).parent(level);
@@ -1165,6 +1208,38 @@ TEST_F(S2LoopTestBase, CompressedEncodedLoopDecodesApproxEqual) {
 // previously was not the case, because S2Cells calculate their bounding
 // rectangles slightly differently, and S2Loops created from them just copied
 // the S2Cell bounds.
+TEST(S2Loop, AdoptsVertexStorage) {
+  vector<S2Point> vertices = s2textformat::ParsePoints("0:0, 0:3, 3:3, 3:0");
+  S2Loop expected(vertices);
+
+  // Moving a vector transfers its storage to the loop.
+  vector<S2Point> moved = vertices;
+  const S2Point* data = moved.data();
+  S2Loop from_vector(std::move(moved));
+  EXPECT_EQ(data, &from_vector.vertex(0));
+  EXPECT_TRUE(expected.Equals(&from_vector));
+
+  // Likewise for an array allocated with new[].
+  unique_ptr<S2Point[]> array(new S2Point[vertices.size()]);
+  std::copy(vertices.begin(), vertices.end(), array.get());
+  data = array.get();
+  S2Loop from_array(std::move(array), vertices.size(), S2Debug::DISABLE);
+  EXPECT_EQ(data, &from_array.vertex(0));
+  EXPECT_TRUE(expected.Equals(&from_array));
+
+  // Adopted vertices may be modified, and the loop may be reinitialized
+  // using either kind of storage.
+  from_vector.Invert();
+  EXPECT_EQ(vertices.back(), from_vector.vertex(0));
+  EXPECT_FALSE(from_vector.Equals(&expected));
+  from_vector.Init(vertices);
+  EXPECT_TRUE(expected.Equals(&from_vector));
+  from_array.Init(S2Loop::kFull());
+  EXPECT_TRUE(from_array.is_full());
+  from_array.Init(vector<S2Point>(vertices));
+  EXPECT_TRUE(expected.Equals(&from_array));
+}
+
 TEST(S2Loop, S2CellConstructorAndContains) {
   S2Cell cell(S2CellId(S2LatLng::FromE6(40565459, -74645276)));
   S2Loop cell_as_loop(cell);
@@ -0,0 +1,158 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2loop_view.h"
+
+#include <cmath>
+#include <vector>
+
+#include "s2/s1interval.h"
+#include "s2/s2cell.h"
+#include "s2/s2debug.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2latlng_rect_bounder.h"
+#include "s2/s2loop_measures.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2predicates.h"
+#include "s2/third_party/absl/container/fixed_array.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+using absl::make_unique;
+using std::vector;
+
+S2LoopView::S2LoopView(S2PointLoopSpan vertices) : vertices_(vertices) {
+}
+
+S2LoopView::~S2LoopView() {
+}
+
+bool S2LoopView::contains_origin() const {
+  MaybeInitOriginAndBound();
+  return origin_inside_;
+}
+
+double S2LoopView::GetArea() const {
+  // S2Loop has its own convention for empty and full loops.
+  if (is_empty_or_full()) {
+    return (vertex(0).z() < 0) ? (4 * M_PI) : 0;
+  }
+  return S2::GetArea(vertices_);
+}
+
+S2Point S2LoopView::GetCentroid() const {
+  // Empty and full loops are handled correctly.
+  return S2::GetCentroid(vertices_);
+}
+
+double S2LoopView::GetCurvature() const {
+  // For empty and full loops we return the limit value as the area
+  // approaches 0 or 4*Pi respectively (see S2Loop::GetCurvature).
+  if (is_empty_or_full()) {
+    return (vertex(0).z() < 0) ? (-2 * M_PI) : (2 * M_PI);
+  }
+  return S2::GetCurvature(vertices_);
+}
+
+const S2Loop& S2LoopView::loop() const {
+  std::call_once(loop_once_, [this]() {
+    loop_ = make_unique<S2Loop>(
+        vector<S2Point>(vertices_.begin(), vertices_.end()), S2Debug::DISABLE);
+  });
+  return *loop_;
+}
+
+S2LoopView* S2LoopView::Clone() const {
+  return new S2LoopView(vertices_);
+}
+
+S2Cap S2LoopView::GetCapBound() const {
+  return GetRectBound().GetCapBound();
+}
+
+S2LatLngRect S2LoopView::GetRectBound() const {
+  MaybeInitOriginAndBound();
+  return bound_;
+}
+
+bool S2LoopView::Contains(const S2Cell& cell) const {
+  if (!GetRectBound().Contains(cell.GetRectBound())) return false;
+  return loop().Contains(cell);
+}
+
+bool S2LoopView::MayIntersect(const S2Cell& cell) const {
+  if (!GetRectBound().Intersects(cell.GetRectBound())) return false;
+  return loop().MayIntersect(cell);
+}
+
+bool S2LoopView::Contains(const S2Point& p) const {
+  MaybeInitOriginAndBound();
+  if (!bound_.Contains(p)) return false;
+  return BruteForceContains(p, origin_inside_);
+}
+
+void S2LoopView::MaybeInitOriginAndBound() const {
+  std::call_once(origin_and_bound_once_, [this]() { InitOriginAndBound(); });
+}
+
+void S2LoopView::InitOriginAndBound() const {
+  // This follows S2Loop::InitOriginAndBound() and S2Loop::InitBound().
+  if (num_vertices() < 3) {
+    // Only the empty and full loops are valid with fewer than 3 vertices.
+    origin_inside_ = is_empty_or_full() && vertex(0).z() < 0;
+    bound_ = origin_inside_ ? S2LatLngRect::Full() : S2LatLngRect::Empty();
+    return;
+  }
+  // Guess that the origin is outside, and check whether this gives the
+  // correct containment result for vertex 1 (see S2Loop for details).
+  bool v1_inside = s2pred::OrderedCCW(S2::Ortho(vertex(1)), vertex(0),
+                                      vertex(2), vertex(1));
+  origin_inside_ = (v1_inside != BruteForceContains(vertex(1), false));
+
+  S2LatLngRectBounder bounder;
+  for (int i = 0; i <= num_vertices(); ++i) {
+    bounder.AddPoint(vertex(i));
+  }
+  S2LatLngRect b = bounder.GetBound();
+  if (BruteForceContains(S2Point(0, 0, 1), origin_inside_)) {
+    b = S2LatLngRect(R1Interval(b.lat().lo(), M_PI_2), S1Interval::Full());
+  }
+  if (b.lng().is_full() &&
+      BruteForceContains(S2Point(0, 0, -1), origin_inside_)) {
+    b.mutable_lat()->set_lo(-M_PI_2);
+  }
+  bound_ = b;
+}
+
+bool S2LoopView::BruteForceContains(const S2Point& p,
+                                    bool origin_inside) const {
+  // This is the same algorithm as S2Loop::BruteForceContains().
+  const int n = num_vertices();
+  if (n < 3) return origin_inside;
+  S2Point origin = S2::Origin();
+  S2EdgeCrosser crosser(&origin, &p);
+  absl::FixedArray<int8> signs(n);
+  s2pred::TriageSigns(origin, p, origin.CrossProd(p),
+                      S2PointSpan(vertices_.data(), n), signs.data());
+  bool inside = origin_inside;
+  int chain_end = -1;  // The last vertex passed to "crosser".
+  for (int i = 0; i < n; ++i) {
+    int j = (i + 1 == n) ? 0 : i + 1;
+    if (signs[i] * signs[j] > 0) continue;
+    if (chain_end != i) crosser.RestartAt(&vertex(i));
+    inside ^= crosser.EdgeOrVertexCrossing(&vertex(i + 1));
+    chain_end = i + 1;
+  }
+  return inside;
+}
@@ -0,0 +1,117 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2LOOP_VIEW_H_
+#define S2_S2LOOP_VIEW_H_
+
+#include <memory>
+#include <mutex>
+
+#include "s2/s2cap.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2region.h"
+
+class S2Cell;
+
+// S2LoopView is a lightweight, read-only S2Region view of a loop's vertices
+// that follows the S2Loop conventions (the interior is on the left, and the
+// empty and full loops consist of the single vertex S2Loop::kEmptyVertex()
+// or S2Loop::kFullVertex()).  Unlike S2Loop, constructing a view copies no
+// vertices and computes nothing:
+//
+//  - GetArea(), GetCentroid(), and GetCurvature() only use the vertices.
+//  - contains_origin(), GetRectBound(), GetCapBound(), and Contains(S2Point)
+//    compute the origin-inside bit and the bound the first time one of them
+//    is called.  Contains(S2Point) then tests all the edges using brute
+//    force, which is faster than building an index unless many points are
+//    tested.
+//  - Contains(S2Cell) and MayIntersect(S2Cell) first test the bound, and
+//    only construct an S2Loop (once) if that is inconclusive.
+//
+// This is useful for code that computes measures of many loops and only
+// occasionally needs their bounds or containment.  Use S2Loop if the loop is
+// queried many times or needs to be modified.
+//
+// The vertices must outlive this object.  This class is thread-safe for
+// concurrent readers.
+class S2LoopView final : public S2Region {
+ public:
+  // REQUIRES: "vertices" remains valid for the lifetime of this object.
+  explicit S2LoopView(S2PointLoopSpan vertices);
+
+  ~S2LoopView() override;
+
+  int num_vertices() const { return static_cast<int>(vertices_.size()); }
+
+  // Returns vertex "i", where 0 <= i < 2 * num_vertices() (see
+  // S2Loop::vertex).
+  const S2Point& vertex(int i) const { return vertices_[i]; }
+
+  S2PointLoopSpan vertices_span() const { return vertices_; }
+
+  // Returns true if this is the special empty or full loop.
+  bool is_empty_or_full() const { return num_vertices() == 1; }
+
+  // Returns true if the loop contains S2::Origin().  This is computed the
+  // first time it is needed.
+  bool contains_origin() const;
+
+  // Like the corresponding S2Loop methods; see s2loop_measures.h.
+  double GetArea() const;
+  S2Point GetCentroid() const;
+  double GetCurvature() const;
+
+  // Returns an S2Loop with the same vertices.  It is constructed the first
+  // time this method is called, and the result is cached.
+  const S2Loop& loop() const;
+
+  ////////////////////////////////////////////////////////////////////////
+  // S2Region interface (see s2region.h for details):
+
+  S2LoopView* Clone() const override;
+  S2Cap GetCapBound() const override;  // Cap surrounding rect bound.
+  S2LatLngRect GetRectBound() const override;
+  bool Contains(const S2Cell& cell) const override;
+  bool MayIntersect(const S2Cell& cell) const override;
+  bool Contains(const S2Point& p) const override;
+
+ private:
+  // Computes origin_inside_ and bound_ if they have not been computed yet.
+  void MaybeInitOriginAndBound() const;
+  void InitOriginAndBound() const;
+
+  // Returns true if the loop contains "p", assuming that it contains
+  // S2::Origin() if and only if "origin_inside" is true.
+  bool BruteForceContains(const S2Point& p, bool origin_inside) const;
+
+  S2PointLoopSpan vertices_;
+
+  // Computed by InitOriginAndBound().
+  mutable std::once_flag origin_and_bound_once_;
+  mutable bool origin_inside_ = false;
+  mutable S2LatLngRect bound_;
+
+  // The equivalent S2Loop, see loop().
+  mutable std::once_flag loop_once_;
+  mutable std::unique_ptr<S2Loop> loop_;
+
+  S2LoopView(const S2LoopView&) = delete;
+  void operator=(const S2LoopView&) = delete;
+};
+
+#endif  // S2_S2LOOP_VIEW_H_
@@ -0,0 +1,97 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2loop_view.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2loop.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+void CheckMatchesLoop(const vector<S2Point>& vertices) {
+  S2Loop loop(vertices, S2Debug::DISABLE);
+  S2LoopView view(vertices);
+  ASSERT_EQ(loop.num_vertices(), view.num_vertices());
+  EXPECT_EQ(loop.GetArea(), view.GetArea());
+  EXPECT_EQ(loop.GetCentroid(), view.GetCentroid());
+  EXPECT_EQ(loop.GetCurvature(), view.GetCurvature());
+  EXPECT_EQ(loop.Contains(S2::Origin()), view.contains_origin());
+  EXPECT_EQ(loop.GetRectBound(), view.GetRectBound());
+  EXPECT_EQ(loop.GetCapBound(), view.GetCapBound());
+  S2Cap cap = loop.GetCapBound();
+  for (int i = 0; i < 50; ++i) {
+    S2Point p = (i % 2 == 0 || cap.is_empty())
+                    ? S2Testing::RandomPoint() : S2Testing::SamplePoint(cap);
+    EXPECT_EQ(loop.Contains(p), view.Contains(p));
+    S2Cell cell(S2CellId(p).parent(S2Testing::rnd.Uniform(15)));
+    EXPECT_EQ(loop.Contains(cell), view.Contains(cell));
+    EXPECT_EQ(loop.MayIntersect(cell), view.MayIntersect(cell));
+  }
+  unique_ptr<S2LoopView> clone(view.Clone());
+  EXPECT_EQ(view.GetRectBound(), clone->GetRectBound());
+}
+
+TEST(S2LoopView, EmptyAndFull) {
+  CheckMatchesLoop(S2Loop::kEmpty());
+  CheckMatchesLoop(S2Loop::kFull());
+  vector<S2Point> empty_vertices = S2Loop::kEmpty();
+  vector<S2Point> full_vertices = S2Loop::kFull();
+  S2LoopView empty(empty_vertices), full(full_vertices);
+  EXPECT_TRUE(empty.GetRectBound().is_empty());
+  EXPECT_TRUE(full.GetRectBound().is_full());
+  EXPECT_FALSE(empty.Contains(S2Point(1, 0, 0)));
+  EXPECT_TRUE(full.Contains(S2Point(1, 0, 0)));
+}
+
+TEST(S2LoopView, PolesAndCrossings) {
+  // Loops that contain the north pole, the south pole, or S2::Origin(), in
+  // both orientations.
+  for (const char* str : {"0:0, 0:90, 0:180, 0:-90",
+                          "0:-90, 0:180, 0:90, 0:0",
+                          "-10:0, 10:120, -10:-120",
+                          "10:10, 10:20, 20:20"}) {
+    vector<S2Point> vertices = s2textformat::ParsePoints(str);
+    CheckMatchesLoop(vertices);
+  }
+}
+
+TEST(S2LoopView, MatchesRandomLoops) {
+  S2Testing::rnd.Reset(1);
+  for (int iter = 0; iter < 50; ++iter) {
+    S2Point center = S2Testing::RandomPoint();
+    S1Angle radius = S1Angle::Degrees(1 + 170 * S2Testing::rnd.RandDouble());
+    vector<S2Point> vertices = S2Testing::MakeRegularPoints(
+        center, radius, 3 + S2Testing::rnd.Uniform(100));
+    // Also test the complement of the loop.
+    if (iter % 2 == 1) std::reverse(vertices.begin(), vertices.end());
+    CheckMatchesLoop(vertices);
+  }
+}
+
+}  // namespace
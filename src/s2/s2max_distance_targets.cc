@@ -193,6 +193,7 @@ S2Cap S2MaxDistanceShapeIndexTarget::GetCapBound() {
 
 bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
     const S2Point& p, S2MaxDistance* min_dist) {
+  if (CannotImprove(S2Cap(p, S1ChordAngle::Zero()), *min_dist)) return false;
   query_->mutable_options()->set_min_distance(S1ChordAngle(*min_dist));
   S2FurthestEdgeQuery::PointTarget target(p);
   S2FurthestEdgeQuery::Result r = query_->FindFurthestEdge(&target);
@@ -205,6 +206,7 @@ bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
 
 bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
     const S2Point& v0, const S2Point& v1, S2MaxDistance* min_dist) {
+  if (CannotImprove(S2Cap(v0, S1ChordAngle(v0, v1)), *min_dist)) return false;
   query_->mutable_options()->set_min_distance(S1ChordAngle(*min_dist));
   S2FurthestEdgeQuery::EdgeTarget target(v0, v1);
   S2FurthestEdgeQuery::Result r = query_->FindFurthestEdge(&target);
@@ -215,6 +217,7 @@ bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
 
 bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
     const S2Cell& cell, S2MaxDistance* min_dist) {
+  if (CannotImprove(cell.GetCapBound(), *min_dist)) return false;
   query_->mutable_options()->set_min_distance(S1ChordAngle(*min_dist));
   S2FurthestEdgeQuery::CellTarget target(cell);
   S2FurthestEdgeQuery::Result r = query_->FindFurthestEdge(&target);
@@ -223,6 +226,28 @@ bool S2MaxDistanceShapeIndexTarget::UpdateMinDistance(
   return true;
 }
 
+// Returns true if no point of "cap" can be further from the target than
+// "min_dist", using only the bounding caps of "cap" and the target index.
+// This avoids running a nested S2FurthestEdgeQuery for the many candidates
+// that cannot improve the current result.
+bool S2MaxDistanceShapeIndexTarget::CannotImprove(
+    const S2Cap& cap, const S2MaxDistance& min_dist) {
+  if (min_dist == S2MaxDistance::Infinity()) return false;
+  if (!has_index_cap_) {
+    index_cap_ = MakeS2ShapeIndexRegion(index_).GetCapBound();
+    has_index_cap_ = true;
+  }
+  if (index_cap_.is_empty()) return false;
+
+  // An upper bound on the distance from any point of "cap" to any point of
+  // the index, plus a conservative bound on the rounding error.
+  static const S1Angle kMaxError = S1Angle::Radians(1e-14);
+  S1Angle max_distance = S1Angle(cap.center(), index_cap_.center()) +
+                         cap.GetRadius() + index_cap_.GetRadius() + kMaxError;
+  if (max_distance >= S1Angle::Radians(M_PI)) return false;
+  return !(S2MaxDistance(S1ChordAngle(max_distance)) < min_dist);
+}
+
 // For target types consisting of multiple connected components (such as
 // S2MaxDistanceShapeIndexTarget), this method should return the
 // polygons containing the antipodal reflection of *any* connected
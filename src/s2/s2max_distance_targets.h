@@ -180,8 +180,15 @@ class S2MaxDistanceShapeIndexTarget : public S2MaxDistanceTarget {
                              const ShapeVisitor& visitor) final;
 
  private:
+  bool CannotImprove(const S2Cap& cap, const S2MaxDistance& min_dist);
+
   const S2ShapeIndex* index_;
   std::unique_ptr<S2FurthestEdgeQuery> query_;
+
+  // A bounding cap for the index (not its antipode), computed when first
+  // needed by CannotImprove().
+  S2Cap index_cap_;
+  bool has_index_cap_ = false;
 };
 
 
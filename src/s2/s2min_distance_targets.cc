@@ -17,6 +17,7 @@
 
 #include "s2/s2min_distance_targets.h"
 
+#include <algorithm>
 #include <memory>
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/s1angle.h"
@@ -25,6 +26,7 @@
 #include "s2/s2closest_cell_query.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2edge_distances.h"
+#include "s2/s2point_soa.h"
 #include "s2/s2shape_index_region.h"
 
 S2Cap S2MinDistancePointTarget::GetCapBound() {
@@ -54,6 +56,61 @@ bool S2MinDistancePointTarget::VisitContainingShapes(
       });
 }
 
+// The number of points whose distances are computed in each batch.
+static const int kPointDistanceBatchSize = 64;
+
+bool S2MinDistancePointTarget::GetPointDistances(
+    const S2PointSoA& points, const int32* ids, int n,
+    S2MinDistance* distances) {
+  // The squared distances are computed in a separate loop so that it can be
+  // vectorized.
+  double d2[kPointDistanceBatchSize];
+  for (int begin = 0; begin < n; begin += kPointDistanceBatchSize) {
+    int count = std::min(n - begin, kPointDistanceBatchSize);
+    points.GetSquaredDistances(point_, ids + begin, count, d2);
+    for (int i = 0; i < count; ++i) {
+      distances[begin + i] = S2MinDistance(S1ChordAngle::FromLength2(d2[i]));
+    }
+  }
+  return true;
+}
+
+void S2MinDistancePointTarget::UpdateMinDistances(
+    absl::Span<const S2Shape::Edge> edges, S2MinDistance* min_dists,
+    bool* updated) {
+  // The first loop computes the squared distances that S2::UpdateMinDistance
+  // starts with, using the same arithmetic so that it can be vectorized.
+  // Usually the planar test below shows that the closest point is a vertex,
+  // in which case the result follows directly.  Otherwise the edge is passed
+  // to S2::UpdateMinDistance, which is exact.
+  double xa2[kPointDistanceBatchSize], xb2[kPointDistanceBatchSize];
+  double ab2[kPointDistanceBatchSize];
+  const int n = edges.size();
+  for (int begin = 0; begin < n; begin += kPointDistanceBatchSize) {
+    const int count = std::min(n - begin, kPointDistanceBatchSize);
+    const S2Shape::Edge* batch = edges.data() + begin;
+    for (int i = 0; i < count; ++i) {
+      xa2[i] = (point_ - batch[i].v0).Norm2();
+      xb2[i] = (point_ - batch[i].v1).Norm2();
+      ab2[i] = (batch[i].v0 - batch[i].v1).Norm2();
+    }
+    for (int i = 0; i < count; ++i) {
+      S2MinDistance* min_dist = &min_dists[begin + i];
+      double dist2 = std::min(xa2[i], xb2[i]);
+      if (std::max(xa2[i], xb2[i]) >= dist2 + ab2[i]) {
+        // The closest point is a vertex.
+        updated[begin + i] = dist2 < min_dist->length2();
+        if (updated[begin + i]) {
+          *min_dist = S2MinDistance(S1ChordAngle::FromLength2(dist2));
+        }
+      } else {
+        updated[begin + i] =
+            S2::UpdateMinDistance(point_, batch[i].v0, batch[i].v1, min_dist);
+      }
+    }
+  }
+}
+
 S2Cap S2MinDistanceEdgeTarget::GetCapBound() {
   // The following computes a radius equal to half the edge length in an
   // efficient and numerically stable way.
@@ -81,6 +81,10 @@ class S2MinDistancePointTarget : public S2MinDistanceTarget {
                          S2MinDistance* min_dist) final;
   bool VisitContainingShapes(const S2ShapeIndex& index,
                              const ShapeVisitor& visitor) final;
+  bool GetPointDistances(const S2PointSoA& points, const int32* ids, int n,
+                         S2MinDistance* distances) final;
+  void UpdateMinDistances(absl::Span<const S2Shape::Edge> edges,
+                          S2MinDistance* min_dists, bool* updated) final;
 
  private:
   S2Point point_;
@@ -17,6 +17,7 @@
 
 #include "s2/s2min_distance_targets.h"
 
+#include <memory>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -26,6 +27,7 @@
 #include "s2/s2cell.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 #include "s2/util/gtl/btree_set.h"
 
@@ -44,6 +46,31 @@ TEST(PointTarget, UpdateMinDistanceToEdgeWhenEqual) {
   EXPECT_FALSE(target.UpdateMinDistance(edge[0], edge[1], &dist));
 }
 
+TEST(PointTarget, UpdateMinDistancesMatchesUpdateMinDistance) {
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  S2MinDistancePointTarget target(S2Testing::SamplePoint(cap));
+  vector<S2Shape::Edge> edges;
+  for (int i = 0; i < 200; ++i) {
+    S2Point a = S2Testing::SamplePoint(cap);
+    // Include some degenerate edges.
+    S2Point b = (i % 10 == 0) ? a : S2Testing::SamplePoint(cap);
+    edges.push_back(S2Shape::Edge(a, b));
+  }
+  for (S1Angle limit : {S1Angle::Degrees(0.1), S1Angle::Degrees(0.5),
+                        S1Angle::Infinity()}) {
+    vector<S2MinDistance> dists(edges.size(), S2MinDistance(limit));
+    std::unique_ptr<bool[]> updated(new bool[edges.size()]);
+    target.UpdateMinDistances(edges, dists.data(), updated.get());
+    for (int i = 0; i < edges.size(); ++i) {
+      S2MinDistance expected(limit);
+      EXPECT_EQ(target.UpdateMinDistance(edges[i].v0, edges[i].v1, &expected),
+                updated[i]);
+      EXPECT_EQ(expected, dists[i]);
+    }
+  }
+}
+
 TEST(PointTarget, UpdateMinDistanceToCellWhenEqual) {
   // Verifies that UpdateMinDistance only returns true when the new distance
   // is less than the old distance (not less than or equal to).
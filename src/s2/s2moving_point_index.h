@@ -0,0 +1,181 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2MOVING_POINT_INDEX_H_
+#define S2_S2MOVING_POINT_INDEX_H_
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "s2/base/logging.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+#include "s2/third_party/absl/types/span.h"
+
+// S2MovingPointIndex maintains the current positions of a set of moving
+// objects (e.g., vehicles) identified by a client-supplied key.  It wraps an
+// S2PointIndex<Key>, so the objects closest to a target can be found with
+// S2ClosestPointQuery<Key> in the usual way:
+//
+//   S2MovingPointIndex<int64> index;
+//   index.Update(vehicle_id, position);
+//   ...
+//   S2ClosestPointQuery<int64> query(&index.index());
+//
+// Updates are optimized for objects that move only a short distance:
+//
+//  - If an object remains within the same leaf cell (e.g., it is parked or
+//    reports the same position again), its entry is updated in place.
+//
+//  - ApplyUpdates() processes a batch of updates at once.  Objects that
+//    change cells are removed individually but reinserted together using
+//    S2PointIndex::AddUnsorted(), which is much faster than one insertion
+//    per object.
+//
+// "Key" must be copyable, equality comparable, and hashable by "Hash".
+// This class is not thread-safe.
+template <class Key, class Hash = std::hash<Key>>
+class S2MovingPointIndex {
+ public:
+  using Index = S2PointIndex<Key>;
+  using PointData = typename Index::PointData;
+
+  S2MovingPointIndex() {}
+
+  // Returns the number of objects in the index.
+  int num_points() const { return index_.num_points(); }
+
+  // Returns the underlying S2PointIndex (e.g., for use with
+  // S2ClosestPointQuery).  Updates invalidate all iterators and queries.
+  const Index& index() const { return index_; }
+
+  // If the object with the given key is present, sets "point" to its current
+  // position and returns true.  Otherwise returns false.
+  bool GetPoint(const Key& key, S2Point* point) const;
+
+  // Sets the position of the object with the given key, adding the object
+  // if it is not already present.
+  void Update(const Key& key, const S2Point& point);
+
+  // Applies a batch of updates, with the same result as calling Update() for
+  // each one in order.
+  void ApplyUpdates(absl::Span<const std::pair<Key, S2Point>> updates);
+
+  // Removes the object with the given key.  Returns false if the object was
+  // not present.
+  bool Remove(const Key& key);
+
+  // Removes all objects from the index.
+  void Clear();
+
+ private:
+  Index index_;
+  std::unordered_map<Key, S2Point, Hash> points_;
+
+  // Temporary storage used by ApplyUpdates().
+  std::vector<PointData> tmp_added_;
+
+  S2MovingPointIndex(const S2MovingPointIndex&) = delete;
+  void operator=(const S2MovingPointIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Key, class Hash>
+bool S2MovingPointIndex<Key, Hash>::GetPoint(const Key& key,
+                                             S2Point* point) const {
+  auto it = points_.find(key);
+  if (it == points_.end()) return false;
+  *point = it->second;
+  return true;
+}
+
+template <class Key, class Hash>
+void S2MovingPointIndex<Key, Hash>::Update(const Key& key,
+                                           const S2Point& point) {
+  auto inserted = points_.insert(std::make_pair(key, point));
+  if (inserted.second) {
+    index_.Add(point, key);
+  } else {
+    S2Point& old_point = inserted.first->second;
+    bool moved = index_.Move(PointData(old_point, key), point);
+    S2_DCHECK(moved);
+    (void) moved;
+    old_point = point;
+  }
+}
+
+template <class Key, class Hash>
+void S2MovingPointIndex<Key, Hash>::ApplyUpdates(
+    absl::Span<const std::pair<Key, S2Point>> updates) {
+  // Objects that change cells are removed from the index immediately, and
+  // their new positions are collected in "tmp_added_".  "pending" maps the
+  // keys of such objects to their positions in "tmp_added_", so that later
+  // updates of the same object in this batch can be applied there.
+  std::unordered_map<Key, int, Hash> pending;
+  tmp_added_.clear();
+  for (const auto& update : updates) {
+    const Key& key = update.first;
+    const S2Point& point = update.second;
+    auto pending_it = pending.find(key);
+    if (pending_it != pending.end()) {
+      tmp_added_[pending_it->second] = PointData(point, key);
+      points_[key] = point;
+      continue;
+    }
+    auto inserted = points_.insert(std::make_pair(key, point));
+    if (!inserted.second) {
+      S2Point& old_point = inserted.first->second;
+      if (S2CellId(old_point) == S2CellId(point)) {
+        index_.Move(PointData(old_point, key), point);
+        old_point = point;
+        continue;
+      }
+      bool removed = index_.Remove(old_point, key);
+      S2_DCHECK(removed);
+      (void) removed;
+      old_point = point;
+    }
+    pending[key] = static_cast<int>(tmp_added_.size());
+    tmp_added_.push_back(PointData(point, key));
+  }
+  index_.AddUnsorted(tmp_added_);
+  tmp_added_.clear();
+}
+
+template <class Key, class Hash>
+bool S2MovingPointIndex<Key, Hash>::Remove(const Key& key) {
+  auto it = points_.find(key);
+  if (it == points_.end()) return false;
+  bool removed = index_.Remove(it->second, key);
+  S2_DCHECK(removed);
+  (void) removed;
+  points_.erase(it);
+  return true;
+}
+
+template <class Key, class Hash>
+void S2MovingPointIndex<Key, Hash>::Clear() {
+  index_.Clear();
+  points_.clear();
+}
+
+#endif  // S2_S2MOVING_POINT_INDEX_H_
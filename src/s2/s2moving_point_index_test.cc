@@ -0,0 +1,134 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2moving_point_index.h"
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2point_index.h"
+#include "s2/s2testing.h"
+
+using std::pair;
+using std::vector;
+
+namespace {
+
+using Index = S2MovingPointIndex<int>;
+
+// Checks that "index" contains exactly the given positions.
+void CheckIndex(const Index& index, const vector<S2Point>& positions) {
+  ASSERT_EQ(positions.size(), index.num_points());
+  vector<bool> seen(positions.size());
+  for (S2PointIndex<int>::Iterator it(&index.index()); !it.done();
+       it.Next()) {
+    EXPECT_EQ(positions[it.data()], it.point());
+    EXPECT_EQ(S2CellId(it.point()), it.id());
+    EXPECT_FALSE(seen[it.data()]);
+    seen[it.data()] = true;
+  }
+  S2Point point;
+  for (int i = 0; i < positions.size(); ++i) {
+    ASSERT_TRUE(index.GetPoint(i, &point));
+    EXPECT_EQ(positions[i], point);
+  }
+}
+
+// Returns a point near "p".  Half of the time the new point is in the same
+// leaf cell as "p".
+S2Point Jitter(const S2Point& p) {
+  if (S2Testing::rnd.OneIn(2)) {
+    S2Point q = (p + 1e-12 * S2Testing::RandomPoint()).Normalize();
+    return S2CellId(q) == S2CellId(p) ? q : p;
+  }
+  return S2::InterpolateAtDistance(S1Angle::Degrees(0.01), p,
+                                   S2Testing::RandomPoint());
+}
+
+TEST(S2MovingPointIndex, UpdateAndRemove) {
+  S2Testing::rnd.Reset(1);
+  Index index;
+  vector<S2Point> positions;
+  for (int i = 0; i < 100; ++i) {
+    positions.push_back(S2Testing::RandomPoint());
+    index.Update(i, positions[i]);
+  }
+  CheckIndex(index, positions);
+  for (int iter = 0; iter < 5; ++iter) {
+    for (int i = 0; i < positions.size(); ++i) {
+      positions[i] = Jitter(positions[i]);
+      index.Update(i, positions[i]);
+    }
+    CheckIndex(index, positions);
+  }
+  EXPECT_TRUE(index.Remove(99));
+  EXPECT_FALSE(index.Remove(99));
+  positions.pop_back();
+  CheckIndex(index, positions);
+}
+
+TEST(S2MovingPointIndex, ApplyUpdates) {
+  S2Testing::rnd.Reset(1);
+  Index index;
+  vector<S2Point> positions;
+  vector<pair<int, S2Point>> updates;
+  for (int i = 0; i < 100; ++i) {
+    positions.push_back(S2Testing::RandomPoint());
+    updates.push_back(std::make_pair(i, positions[i]));
+  }
+  index.ApplyUpdates(updates);
+  CheckIndex(index, positions);
+  for (int iter = 0; iter < 5; ++iter) {
+    updates.clear();
+    // Also include objects that are updated more than once in a batch.
+    for (int k = 0; k < 150; ++k) {
+      int i = S2Testing::rnd.Uniform(positions.size());
+      positions[i] = Jitter(positions[i]);
+      updates.push_back(std::make_pair(i, positions[i]));
+    }
+    index.ApplyUpdates(updates);
+    CheckIndex(index, positions);
+  }
+}
+
+TEST(S2MovingPointIndex, ClosestPointQuery) {
+  S2Testing::rnd.Reset(1);
+  Index index;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(1));
+  vector<pair<int, S2Point>> updates;
+  for (int i = 0; i < 1000; ++i) {
+    updates.push_back(std::make_pair(i, S2Testing::SamplePoint(cap)));
+  }
+  index.ApplyUpdates(updates);
+  S2ClosestPointQuery<int> query(&index.index());
+  S2ClosestPointQuery<int>::PointTarget target(cap.center());
+  auto closest = query.FindClosestPoint(&target);
+  ASSERT_FALSE(closest.is_empty());
+  S1ChordAngle min_distance = S1ChordAngle::Infinity();
+  for (const auto& update : updates) {
+    min_distance = std::min(min_distance,
+                            S1ChordAngle(cap.center(), update.second));
+  }
+  EXPECT_EQ(min_distance, closest.distance());
+}
+
+}  // namespace
@@ -0,0 +1,168 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2partitioned_shape_index.h"
+
+#include <algorithm>
+
+#include "s2/base/logging.h"
+#include "s2/s2cell.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2shape_index_region.h"
+#include "s2/util/thread/executor.h"
+
+using std::pair;
+using std::vector;
+
+S2PartitionedShapeIndex::Options::Options() {
+}
+
+void S2PartitionedShapeIndex::Options::set_max_covering_cells(
+    int max_covering_cells) {
+  S2_DCHECK_GT(max_covering_cells, 0);
+  max_covering_cells_ = max_covering_cells;
+}
+
+S2PartitionedShapeIndex::S2PartitionedShapeIndex()
+    : S2PartitionedShapeIndex(Options()) {
+}
+
+S2PartitionedShapeIndex::S2PartitionedShapeIndex(const Options& options)
+    : options_(options) {
+}
+
+int S2PartitionedShapeIndex::Add(const S2ShapeIndex* index) {
+  S2RegionCoverer::Options coverer_options;
+  coverer_options.set_max_cells(options_.max_covering_cells());
+  S2RegionCoverer coverer(coverer_options);
+  return Add(index, coverer.GetCovering(MakeS2ShapeIndexRegion(index)));
+}
+
+int S2PartitionedShapeIndex::Add(const S2ShapeIndex* index,
+                                 S2CellUnion covering) {
+  partitions_.push_back(Partition{index, std::move(covering), num_shape_ids_});
+  num_shape_ids_ += index->num_shape_ids();
+  return num_partitions() - 1;
+}
+
+pair<int, int> S2PartitionedShapeIndex::local_shape_id(
+    int global_shape_id) const {
+  S2_DCHECK(global_shape_id >= 0 && global_shape_id < num_shape_ids_);
+  // Find the last partition whose first shape id is <= global_shape_id.
+  // Partitions without any shapes are skipped automatically, since the
+  // following partition has the same first shape id.
+  auto it = std::upper_bound(
+      partitions_.begin(), partitions_.end(), global_shape_id,
+      [](int id, const Partition& partition) {
+        return id < partition.first_shape_id;
+      });
+  --it;
+  return std::make_pair(static_cast<int>(it - partitions_.begin()),
+                        global_shape_id - it->first_shape_id);
+}
+
+S2Shape* S2PartitionedShapeIndex::shape(int global_shape_id) const {
+  pair<int, int> local = local_shape_id(global_shape_id);
+  return partitions_[local.first].index->shape(local.second);
+}
+
+vector<int> S2PartitionedShapeIndex::GetContainingShapeIds(
+    const S2Point& p, const S2ContainsPointQueryOptions& options,
+    Executor* executor) const {
+  vector<int> candidates;
+  for (int i = 0; i < num_partitions(); ++i) {
+    if (partitions_[i].covering.Contains(p)) candidates.push_back(i);
+  }
+  vector<vector<int>> partition_results(candidates.size());
+  ParallelFor(executor, candidates.size(), [&](int i) {
+    const Partition& partition = partitions_[candidates[i]];
+    auto query = MakeS2ContainsPointQuery(partition.index, options);
+    query.VisitContainingShapes(p, [&](S2Shape* shape) {
+      partition_results[i].push_back(partition.first_shape_id + shape->id());
+      return true;
+    });
+  });
+  // Partitions are processed in order and their shape id ranges do not
+  // overlap, so only the shapes within each partition need to be sorted.
+  vector<int> result;
+  for (auto& ids : partition_results) {
+    std::sort(ids.begin(), ids.end());
+    result.insert(result.end(), ids.begin(), ids.end());
+  }
+  return result;
+}
+
+bool S2PartitionedShapeIndex::Contains(
+    const S2Point& p, const S2ContainsPointQueryOptions& options) const {
+  for (const Partition& partition : partitions_) {
+    if (partition.covering.Contains(p) &&
+        MakeS2ContainsPointQuery(partition.index, options).Contains(p)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+vector<int> S2PartitionedShapeIndex::GetCandidatePartitions(
+    S2ClosestEdgeQuery::Target* target, S1ChordAngle max_distance) const {
+  vector<int> candidates;
+  if (max_distance == S1ChordAngle::Infinity()) {
+    for (int i = 0; i < num_partitions(); ++i) candidates.push_back(i);
+    return candidates;
+  }
+  // Allow for the error in computing the distance to each covering cell.
+  S1ChordAngle limit =
+      max_distance.PlusError(S2::GetUpdateMinDistanceMaxError(max_distance));
+  for (int i = 0; i < num_partitions(); ++i) {
+    for (S2CellId id : partitions_[i].covering) {
+      S2MinDistance distance(limit);
+      if (target->UpdateMinDistance(S2Cell(id), &distance)) {
+        candidates.push_back(i);
+        break;
+      }
+    }
+  }
+  return candidates;
+}
+
+vector<S2ClosestEdgeQuery::Result> S2PartitionedShapeIndex::FindClosestEdges(
+    S2ClosestEdgeQuery::Target* target,
+    const S2ClosestEdgeQuery::Options& options, Executor* executor) const {
+  using Result = S2ClosestEdgeQuery::Result;
+  vector<int> candidates =
+      GetCandidatePartitions(target, options.max_distance());
+  vector<vector<Result>> partition_results(candidates.size());
+  ParallelFor(executor, candidates.size(), [&](int i) {
+    const Partition& partition = partitions_[candidates[i]];
+    S2ClosestEdgeQuery query(partition.index, options);
+    for (const Result& result : query.FindClosestEdges(target)) {
+      partition_results[i].push_back(
+          Result(result.distance(),
+                 partition.first_shape_id + result.shape_id(),
+                 result.edge_id()));
+    }
+  });
+  vector<Result> results;
+  for (const auto& partition_result : partition_results) {
+    results.insert(results.end(), partition_result.begin(),
+                   partition_result.end());
+  }
+  std::sort(results.begin(), results.end());
+  if (results.size() > static_cast<size_t>(options.max_results())) {
+    results.resize(options.max_results());
+  }
+  return results;
+}
@@ -0,0 +1,155 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2PARTITIONED_SHAPE_INDEX_H_
+#define S2_S2PARTITIONED_SHAPE_INDEX_H_
+
+#include <utility>
+#include <vector>
+
+#include "s2/s2cell_union.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2point.h"
+#include "s2/s2shape_index.h"
+
+class Executor;
+class S2Shape;
+
+// S2PartitionedShapeIndex runs queries over a collection of S2ShapeIndexes
+// ("partitions"), such as per-region EncodedS2ShapeIndex files.  Each
+// partition has a coarse S2CellUnion covering that is used to skip the
+// partitions that cannot contribute to a query.  The remaining partitions
+// are queried in parallel (if an Executor is given), and the results are
+// merged.
+//
+// Shapes are identified by "global" shape ids: the shape ids of partition i
+// are offset by the total number of shape ids in partitions 0..i-1.  For
+// example:
+//
+//   S2PartitionedShapeIndex partitions;
+//   for (const auto& index : indexes) partitions.Add(index.get());
+//   for (int id : partitions.GetContainingShapeIds(point)) {
+//     const S2Shape* shape = partitions.shape(id);
+//     ...
+//   }
+//
+// The partitions are not owned, and must not be modified (in particular,
+// their number of shape ids must not change) while they belong to this
+// object.  Like S2ShapeIndex, this class is thread-safe for concurrent
+// readers once all partitions have been added.
+class S2PartitionedShapeIndex {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The maximum number of cells in the covering of each partition that is
+    // computed by Add(const S2ShapeIndex*).  Larger coverings prune more
+    // partitions but take more time to test.
+    //
+    // DEFAULT: 16
+    int max_covering_cells() const { return max_covering_cells_; }
+    void set_max_covering_cells(int max_covering_cells);
+
+   private:
+    int max_covering_cells_ = 16;
+  };
+
+  // Default constructor; uses the default options.
+  S2PartitionedShapeIndex();
+
+  explicit S2PartitionedShapeIndex(const Options& options);
+
+  const Options& options() const { return options_; }
+
+  // Adds a partition and returns its number.  The covering is computed from
+  // the contents of "index".  Does not take ownership of "index".
+  int Add(const S2ShapeIndex* index);
+
+  // Like Add(), but uses the given covering of the partition.
+  //
+  // REQUIRES: "covering" contains every shape in "index", including their
+  //           interiors.
+  int Add(const S2ShapeIndex* index, S2CellUnion covering);
+
+  // Returns the number of partitions.
+  int num_partitions() const { return static_cast<int>(partitions_.size()); }
+
+  // Returns the given partition and its covering.
+  const S2ShapeIndex& partition(int i) const { return *partitions_[i].index; }
+  const S2CellUnion& covering(int i) const { return partitions_[i].covering; }
+
+  // Returns the total number of shape ids in all partitions.
+  int num_shape_ids() const { return num_shape_ids_; }
+
+  // Converts between global shape ids and (partition, shape id) pairs.
+  int global_shape_id(int partition, int shape_id) const {
+    return partitions_[partition].first_shape_id + shape_id;
+  }
+  std::pair<int, int> local_shape_id(int global_shape_id) const;
+
+  // Returns the shape with the given global id, or nullptr if the shape has
+  // been removed from its partition.
+  S2Shape* shape(int global_shape_id) const;
+
+  // Returns the global ids of all shapes that contain the point "p", in
+  // increasing order.  Only partitions whose covering contains "p" are
+  // searched.  If "executor" is not nullptr, they are searched in parallel.
+  std::vector<int> GetContainingShapeIds(
+      const S2Point& p,
+      const S2ContainsPointQueryOptions& options =
+          S2ContainsPointQueryOptions(),
+      Executor* executor = nullptr) const;
+
+  // Returns true if any shape in any partition contains the point "p".
+  bool Contains(const S2Point& p, const S2ContainsPointQueryOptions& options =
+                                      S2ContainsPointQueryOptions()) const;
+
+  // Returns the edges closest to "target" in any partition, as though all
+  // partitions were a single index.  The results are sorted by distance and
+  // use global shape ids.  Partitions whose covering is farther than
+  // options.max_distance() from the target are skipped.
+  //
+  // If "executor" is not nullptr, the partitions are searched in parallel
+  // and "target" is used concurrently, so it must be thread-safe.  This is
+  // true of PointTarget, EdgeTarget, and CellTarget, but not of
+  // ShapeIndexTarget.
+  std::vector<S2ClosestEdgeQuery::Result> FindClosestEdges(
+      S2ClosestEdgeQuery::Target* target,
+      const S2ClosestEdgeQuery::Options& options,
+      Executor* executor = nullptr) const;
+
+ private:
+  struct Partition {
+    const S2ShapeIndex* index;
+    S2CellUnion covering;
+    int first_shape_id;  // The global id of the partition's shape id 0.
+  };
+
+  // Returns the partitions that may be within "max_distance" of "target".
+  std::vector<int> GetCandidatePartitions(
+      S2ClosestEdgeQuery::Target* target,
+      S1ChordAngle max_distance) const;
+
+  Options options_;
+  std::vector<Partition> partitions_;
+  int num_shape_ids_ = 0;
+
+  S2PartitionedShapeIndex(const S2PartitionedShapeIndex&) = delete;
+  void operator=(const S2PartitionedShapeIndex&) = delete;
+};
+
+#endif  // S2_S2PARTITIONED_SHAPE_INDEX_H_
@@ -0,0 +1,149 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2partitioned_shape_index.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// Adds "num_loops" random loops near "center" to both "partition" and
+// "combined".
+void AddLoops(const S2Point& center, int num_loops,
+              MutableS2ShapeIndex* partition, MutableS2ShapeIndex* combined) {
+  S2Cap cap(center, S1Angle::Degrees(2));
+  for (int i = 0; i < num_loops; ++i) {
+    S2Point loop_center = S2Testing::SamplePoint(cap);
+    S2Polygon polygon(S2Loop::MakeRegularLoop(
+        loop_center, S1Angle::Degrees(0.5), 8 + S2Testing::rnd.Uniform(20)));
+    partition->Add(make_unique<S2LaxPolygonShape>(polygon));
+    combined->Add(make_unique<S2LaxPolygonShape>(polygon));
+  }
+}
+
+class S2PartitionedShapeIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    S2Testing::rnd.Reset(1);
+    for (int i = 0; i < 6; ++i) {
+      partitions_.push_back(make_unique<MutableS2ShapeIndex>());
+      // Partition 2 is empty, to test shape id mapping.
+      if (i != 2) {
+        centers_.push_back(S2Testing::RandomPoint());
+        AddLoops(centers_.back(), 10, partitions_.back().get(), &combined_);
+      }
+      index_.Add(partitions_.back().get());
+    }
+  }
+
+  vector<unique_ptr<MutableS2ShapeIndex>> partitions_;
+  vector<S2Point> centers_;
+  MutableS2ShapeIndex combined_;
+  S2PartitionedShapeIndex index_;
+};
+
+TEST_F(S2PartitionedShapeIndexTest, ShapeIds) {
+  ASSERT_EQ(6, index_.num_partitions());
+  ASSERT_EQ(combined_.num_shape_ids(), index_.num_shape_ids());
+  for (int id = 0; id < index_.num_shape_ids(); ++id) {
+    auto local = index_.local_shape_id(id);
+    EXPECT_NE(2, local.first);
+    EXPECT_EQ(id, index_.global_shape_id(local.first, local.second));
+    EXPECT_EQ(combined_.shape(id)->num_edges(),
+              index_.shape(id)->num_edges());
+    EXPECT_EQ(combined_.shape(id)->edge(0), index_.shape(id)->edge(0));
+  }
+}
+
+TEST_F(S2PartitionedShapeIndexTest, ContainsPoint) {
+  ThreadPerTaskExecutor executor;
+  auto query = MakeS2ContainsPointQuery(&combined_);
+  for (int iter = 0; iter < 500; ++iter) {
+    S2Point p = (iter % 5 == 0) ? S2Testing::RandomPoint()
+        : S2Testing::SamplePoint(S2Cap(
+              centers_[iter % centers_.size()], S1Angle::Degrees(2.5)));
+    vector<int> expected;
+    for (S2Shape* shape : query.GetContainingShapes(p)) {
+      expected.push_back(shape->id());
+    }
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, index_.GetContainingShapeIds(p));
+    EXPECT_EQ(expected.empty(), !index_.Contains(p));
+    if (iter % 50 == 0) {
+      EXPECT_EQ(expected, index_.GetContainingShapeIds(
+          p, S2ContainsPointQueryOptions(), &executor));
+    }
+  }
+}
+
+TEST_F(S2PartitionedShapeIndexTest, FindClosestEdges) {
+  ThreadPerTaskExecutor executor;
+  S2ClosestEdgeQuery::Options options;
+  options.set_max_results(5);
+  for (int iter = 0; iter < 100; ++iter) {
+    if (iter == 50) options.set_max_distance(S1Angle::Degrees(1));
+    S2Point p = (iter % 5 == 0) ? S2Testing::RandomPoint()
+        : S2Testing::SamplePoint(S2Cap(
+              centers_[iter % centers_.size()], S1Angle::Degrees(3)));
+    S2ClosestEdgeQuery::PointTarget target(p);
+    S2ClosestEdgeQuery query(&combined_, options);
+    auto expected = query.FindClosestEdges(&target);
+    EXPECT_EQ(expected, index_.FindClosestEdges(&target, options));
+    if (iter % 10 == 0) {
+      EXPECT_EQ(expected, index_.FindClosestEdges(&target, options,
+                                                  &executor));
+    }
+  }
+}
+
+}  // namespace
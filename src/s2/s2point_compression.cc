@@ -16,6 +16,7 @@
 
 #include "s2/s2point_compression.h"
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -80,24 +81,6 @@ struct FaceRun {
 // Run-length encoder/decoder for face numbers.
 class Faces {
  public:
-  class Iterator {
-   public:
-    explicit Iterator(const Faces& faces);
-
-    // Return the next face.
-    int Next();
-
-   private:
-    // The faces_ vector of the Faces object for which this is an iterator.
-    const vector<FaceRun>& faces_;
-
-    // The index that the next face will come from.
-    int face_index_;
-
-    // Number of faces already consumed for face_index_.
-    int num_faces_used_for_index_;
-  };
-
   Faces() {}
 
   // Add the face to the list of face runs, combining with the last if
@@ -110,10 +93,9 @@ class Faces {
   // Decodes the faces, returning true on success.
   bool Decode(int num_vertices, Decoder* decoder);
 
-  Iterator GetIterator() const {
-    Iterator iterator(*this);
-    return iterator;
-  }
+  // Returns the runs of faces.  Note that the count of the last run may
+  // exceed the number of vertices remaining.
+  const vector<FaceRun>& runs() const { return faces_; }
 
  private:
   // Run-length encoded list of faces.
@@ -148,23 +130,6 @@ bool Faces::Decode(int num_vertices, Decoder* decoder) {
   return true;
 }
 
-Faces::Iterator::Iterator(const Faces& faces)
-    : faces_(faces.faces_), face_index_(0),
-      num_faces_used_for_index_(0) {
-}
-
-int Faces::Iterator::Next() {
-  S2_DCHECK_NE(faces_.size(), face_index_);
-  S2_DCHECK_LE(num_faces_used_for_index_, faces_[face_index_].count);
-  if (num_faces_used_for_index_ == faces_[face_index_].count) {
-    ++face_index_;
-    num_faces_used_for_index_ = 0;
-  }
-
-  ++num_faces_used_for_index_;
-  return faces_[face_index_].face;
-}
-
 // Unused function (for documentation purposes only).
 inline int STtoPiQi(double s, int level) {
   // We introduce a new coordinate system (pi, qi), which is (si, ti)
@@ -198,10 +163,31 @@ inline double PiQitoST(int pi, int level) {
   return (pi + 0.5) / (1 << level);
 }
 
-S2Point FacePiQitoXYZ(int face, int pi, int qi, int level) {
-  return S2::FaceUVtoXYZ(face,
-                         S2::STtoUV(PiQitoST(pi, level)),
-                         S2::STtoUV(PiQitoST(qi, level))).Normalize();
+// Converts each element of "vertices_pi_qi" on the given face to the
+// corresponding unit-length S2Point.  Making the face a template parameter
+// moves the face switch out of the loop, and the division in PiQitoST is
+// replaced by an (exact) multiplication by a power of two.
+template <int kFace>
+void FacePiQiRunToXYZ(Span<const pair<int, int>> vertices_pi_qi, int level,
+                      S2Point* output) {
+  const double scale = 1.0 / (1 << level);
+  for (const auto& pi_qi : vertices_pi_qi) {
+    double u = S2::STtoUV((pi_qi.first + 0.5) * scale);
+    double v = S2::STtoUV((pi_qi.second + 0.5) * scale);
+    *output++ = S2::FaceUVtoXYZ(kFace, u, v).Normalize();
+  }
+}
+
+void FacePiQiRunToXYZ(int face, Span<const pair<int, int>> vertices_pi_qi,
+                      int level, S2Point* output) {
+  switch (face) {
+    case 0: return FacePiQiRunToXYZ<0>(vertices_pi_qi, level, output);
+    case 1: return FacePiQiRunToXYZ<1>(vertices_pi_qi, level, output);
+    case 2: return FacePiQiRunToXYZ<2>(vertices_pi_qi, level, output);
+    case 3: return FacePiQiRunToXYZ<3>(vertices_pi_qi, level, output);
+    case 4: return FacePiQiRunToXYZ<4>(vertices_pi_qi, level, output);
+    default: return FacePiQiRunToXYZ<5>(vertices_pi_qi, level, output);
+  }
 }
 
 void EncodeFirstPointFixedLength(const pair<int, int>& vertex_pi_qi,
@@ -289,27 +275,28 @@ bool DecodeFirstPointFixedLength(Decoder* decoder,
   return true;
 }
 
-bool DecodePointCompressed(Decoder* decoder,
-                           int level,
-                           NthDerivativeCoder* pi_coder,
-                           NthDerivativeCoder* qi_coder,
-                           pair<int, int>* vertex_pi_qi) {
-  uint64 interleaved_zig_zag_encoded_deriv_pi_qi;
-  if (!decoder->get_varint64(&interleaved_zig_zag_encoded_deriv_pi_qi)) {
-    return false;
+// Decodes the points following the first one given their encoded
+// derivatives (the varint64 values written by EncodePointCompressed), where
+// vertices_pi_qi[0] is the first point.  This is equivalent to calling
+// NthDerivativeCoder::Decode() for each coordinate of each point, but is
+// faster because the second-order state is kept in local variables.
+void DecodePointsCompressed(Span<const uint64> derivs,
+                            Span<pair<int, int>> vertices_pi_qi) {
+  static_assert(kDerivativeEncodingOrder == 2, "Update DecodePointsCompressed");
+  S2_DCHECK_EQ(derivs.size() + 1, vertices_pi_qi.size());
+  uint32 pi = vertices_pi_qi[0].first, qi = vertices_pi_qi[0].second;
+  uint32 deriv_pi = 0, deriv_qi = 0;
+  for (int i = 0; i < derivs.size(); ++i) {
+    uint32 zig_zag_encoded_deriv2_pi, zig_zag_encoded_deriv2_qi;
+    util_bits::DeinterleaveUint32(derivs[i], &zig_zag_encoded_deriv2_pi,
+                                  &zig_zag_encoded_deriv2_qi);
+    deriv_pi += ZigZagDecode(zig_zag_encoded_deriv2_pi);
+    deriv_qi += ZigZagDecode(zig_zag_encoded_deriv2_qi);
+    pi += deriv_pi;
+    qi += deriv_qi;
+    vertices_pi_qi[i + 1].first = pi;
+    vertices_pi_qi[i + 1].second = qi;
   }
-
-  uint32 zig_zag_encoded_deriv_pi, zig_zag_encoded_deriv_qi;
-  util_bits::DeinterleaveUint32(interleaved_zig_zag_encoded_deriv_pi_qi,
-                                &zig_zag_encoded_deriv_pi,
-                                &zig_zag_encoded_deriv_qi);
-
-  vertex_pi_qi->first =
-      pi_coder->Decode(ZigZagDecode(zig_zag_encoded_deriv_pi));
-  vertex_pi_qi->second =
-      qi_coder->Decode(ZigZagDecode(zig_zag_encoded_deriv_qi));
-
-  return true;
 }
 
 }  // namespace
@@ -349,26 +336,31 @@ bool S2DecodePointsCompressed(Decoder* decoder, int level,
     return false;
   }
 
-  NthDerivativeCoder pi_coder(kDerivativeEncodingOrder);
-  NthDerivativeCoder qi_coder(kDerivativeEncodingOrder);
-  Faces::Iterator faces_iterator = faces.GetIterator();
-  for (int i = 0; i < points.size(); ++i) {
-    pair<int, int> vertex_pi_qi;
-    if (i == 0) {
-      if (!DecodeFirstPointFixedLength(decoder, level, &pi_coder, &qi_coder,
-                                       &vertex_pi_qi)) {
-        return false;
-      }
-    } else {
-      if (!DecodePointCompressed(decoder, level, &pi_coder, &qi_coder,
-                                 &vertex_pi_qi)) {
-        return false;
-      }
+  if (!points.empty()) {
+    NthDerivativeCoder pi_coder(kDerivativeEncodingOrder);
+    NthDerivativeCoder qi_coder(kDerivativeEncodingOrder);
+    absl::FixedArray<pair<int, int>> vertices_pi_qi(points.size());
+    if (!DecodeFirstPointFixedLength(decoder, level, &pi_coder, &qi_coder,
+                                     &vertices_pi_qi[0])) {
+      return false;
+    }
+    // The remaining points are encoded as consecutive varints, which are much
+    // faster to decode all at once.
+    absl::FixedArray<uint64> derivs(points.size() - 1);
+    if (!decoder->get_varint64_array(derivs.data(), derivs.size())) {
+      return false;
+    }
+    DecodePointsCompressed(derivs, absl::MakeSpan(vertices_pi_qi));
+
+    // Convert each run of points on the same face to XYZ.
+    int start = 0;
+    for (const FaceRun& run : faces.runs()) {
+      int count = std::min<int>(run.count, points.size() - start);
+      FacePiQiRunToXYZ(run.face,
+                       absl::MakeConstSpan(&vertices_pi_qi[start], count),
+                       level, &points[start]);
+      start += count;
     }
-
-    int face = faces_iterator.Next();
-    points[i] =
-        FacePiQitoXYZ(face, vertex_pi_qi.first, vertex_pi_qi.second, level);
   }
 
   unsigned int num_off_center;
@@ -18,11 +18,72 @@
 #ifndef S2_S2POINT_INDEX_H_
 #define S2_S2POINT_INDEX_H_
 
+#include <algorithm>
 #include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+#include "s2/base/logging.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_s2point_vector.h"
+#include "s2/encoded_uint_vector.h"
 #include "s2/s2cell_id.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/util/coding/coder.h"
 #include "s2/util/gtl/btree_map.h"
 
+namespace s2coding {
+namespace internal {
+
+// The current version of the encoding written by S2PointIndex::Encode().
+constexpr int kS2PointIndexEncodingVersion = 0;
+
+// Stores the "Data" values of an S2PointIndex as an EncodedUintVector (see
+// S2PointIndex::Encode).  Signed values are stored as the corresponding
+// unsigned type, so small non-negative values are encoded most compactly.
+// The specialization below handles empty Data types, which use no space.
+template <class Data, bool kIsEmpty = std::is_empty<Data>::value>
+class EncodedPointIndexData {
+ public:
+  static_assert(std::is_integral<Data>::value,
+                "Only empty or integral Data types can be encoded");
+
+  static void Encode(const std::vector<Data>& values, Encoder* encoder) {
+    std::vector<Uint> uint_values;
+    uint_values.reserve(values.size());
+    for (const Data& value : values) {
+      uint_values.push_back(static_cast<DataUint>(value));
+    }
+    EncodeUintVector<Uint>(uint_values, CodingHint::COMPACT, encoder);
+  }
+
+  bool Init(Decoder* decoder, size_t num_points) {
+    return values_.Init(decoder) && values_.size() == num_points;
+  }
+
+  Data operator[](int i) const {
+    return static_cast<Data>(static_cast<DataUint>(values_[i]));
+  }
+
+ private:
+  using DataUint = typename std::make_unsigned<Data>::type;
+  // EncodedUintVector does not support single-byte values.
+  using Uint = typename std::conditional<(sizeof(Data) > 4),
+                                         uint64, uint32>::type;
+  EncodedUintVector<Uint> values_;
+};
+
+template <class Data>
+class EncodedPointIndexData<Data, true> {
+ public:
+  static void Encode(const std::vector<Data>& values, Encoder* encoder) {}
+  bool Init(Decoder* decoder, size_t num_points) { return true; }
+  Data operator[](int i) const { return Data(); }
+};
+
+}  // namespace internal
+}  // namespace s2coding
+
 // S2PointIndex maintains an index of points sorted by leaf S2CellId.  Each
 // point can optionally store auxiliary data such as an integer or pointer.
 // This can be used to map results back to client data structures.
@@ -80,6 +141,9 @@
 //     DoSomething(it.id(), it.point(), it.data());
 //   }
 //
+// The index can be serialized using Encode().  The encoded index can then be
+// queried in place (without rebuilding the btree) using EncodedS2PointIndex.
+//
 // TODO(ericv): Consider adding an S2PointIndexRegion class, which could be
 // used to efficiently compute coverings of a collection of S2Points.
 //
@@ -126,6 +190,19 @@ class S2PointIndex {
   // Convenience function for the case when Data is an empty class.
   void Add(const S2Point& point);
 
+  // Adds the given points to the index, which must be sorted in increasing
+  // order of S2CellId(point) (e.g., as written out by iterating over another
+  // S2PointIndex).  This takes linear rather than O(n log n) time when the
+  // index is initially empty, because each point is appended directly after
+  // the previous one rather than being located by a search.  Invalidates all
+  // iterators.
+  void AddSorted(absl::Span<const PointData> points);
+
+  // Like AddSorted(), but accepts points in any order.  The points are first
+  // sorted by S2CellId, which is still much faster than adding them one at a
+  // time.  Invalidates all iterators.
+  void AddUnsorted(absl::Span<const PointData> points);
+
   // Removes the given point from the index.  Both the "point" and "data"
   // fields must match the point to be removed.  Returns false if the given
   // point was not present.  Invalidates all iterators.
@@ -135,9 +212,28 @@ class S2PointIndex {
   // Convenience function for the case when Data is an empty class.
   void Remove(const S2Point& point);
 
+  // Moves the given point to "new_point", keeping its data.  If both points
+  // belong to the same leaf cell, the entry is updated in place without
+  // restructuring the btree (and iterators remain valid); otherwise this is
+  // equivalent to Remove() followed by Add().  Returns false if the given
+  // point was not present.
+  bool Move(const PointData& point_data, const S2Point& new_point);
+
   // Resets the index to its original empty state.  Invalidates all iterators.
   void Clear();
 
+  // Appends an encoded representation of the index to "encoder".  The leaf
+  // S2CellIds are delta-encoded using EncodedS2CellIdVector, the points are
+  // stored using EncodedS2PointVector (which represents points snapped to
+  // S2CellId centers compactly), and the data values are stored using
+  // EncodedUintVector.  The result can be queried directly using
+  // EncodedS2PointIndex.
+  //
+  // REQUIRES: "Data" is an integral type or an empty class.
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void Encode(Encoder* encoder) const;
+
  private:
   // Defined here because the Iterator class below uses it.
   using Map = gtl::btree_multimap<S2CellId, PointData>;
@@ -237,6 +333,42 @@ void S2PointIndex<Data>::Add(const S2Point& point) {
   Add(point, {});
 }
 
+template <class Data>
+void S2PointIndex<Data>::AddSorted(absl::Span<const PointData> points) {
+  // Inserting each point just before the successor of the previous point
+  // requires only a constant number of comparisons for sorted input, and
+  // btree nodes are split so that appending leaves the left node full.
+  auto hint = map_.end();
+  S2CellId prev_id = S2CellId::None();
+  for (const PointData& point_data : points) {
+    S2CellId id(point_data.point());
+    S2_DCHECK_LE(prev_id, id);
+    hint = map_.insert(hint, std::make_pair(id, point_data));
+    ++hint;
+    prev_id = id;
+  }
+}
+
+template <class Data>
+void S2PointIndex<Data>::AddUnsorted(absl::Span<const PointData> points) {
+  // Sort (S2CellId, index) pairs rather than the points themselves, since
+  // these are smaller and the cell ids only need to be computed once.
+  // Ties are broken by index so that points with the same S2CellId are
+  // added in their original order, as with Add().
+  std::vector<std::pair<S2CellId, int>> order;
+  order.reserve(points.size());
+  for (int i = 0; i < points.size(); ++i) {
+    order.push_back(std::make_pair(S2CellId(points[i].point()), i));
+  }
+  std::sort(order.begin(), order.end());
+  auto hint = map_.end();
+  for (const auto& entry : order) {
+    hint = map_.insert(hint, std::make_pair(entry.first,
+                                            points[entry.second]));
+    ++hint;
+  }
+}
+
 template <class Data>
 bool S2PointIndex<Data>::Remove(const PointData& point_data) {
   S2CellId id(point_data.point());
@@ -261,11 +393,51 @@ void S2PointIndex<Data>::Remove(const S2Point& point) {
   Remove(point, {});
 }
 
+template <class Data>
+bool S2PointIndex<Data>::Move(const PointData& point_data,
+                              const S2Point& new_point) {
+  S2CellId id(point_data.point());
+  for (typename Map::iterator it = map_.lower_bound(id), end = map_.end();
+       it != end && it->first == id; ++it) {
+    if (it->second == point_data) {
+      if (S2CellId(new_point) == id) {
+        it->second = PointData(new_point, point_data.data());
+      } else {
+        map_.erase(it);
+        Add(new_point, point_data.data());
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
 template <class Data>
 void S2PointIndex<Data>::Clear() {
   map_.clear();
 }
 
+template <class Data>
+void S2PointIndex<Data>::Encode(Encoder* encoder) const {
+  std::vector<S2CellId> cell_ids;
+  std::vector<S2Point> points;
+  std::vector<Data> data;
+  cell_ids.reserve(map_.size());
+  points.reserve(map_.size());
+  data.reserve(map_.size());
+  for (const auto& entry : map_) {
+    cell_ids.push_back(entry.first);
+    points.push_back(entry.second.point());
+    data.push_back(entry.second.data());
+  }
+  encoder->Ensure(Varint::kMax64);
+  encoder->put_varint64(s2coding::internal::kS2PointIndexEncodingVersion);
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  s2coding::EncodeS2PointVector(points, s2coding::CodingHint::COMPACT,
+                                encoder);
+  s2coding::internal::EncodedPointIndexData<Data>::Encode(data, encoder);
+}
+
 template <class Data>
 inline S2PointIndex<Data>::Iterator::Iterator() : map_(nullptr) {
 }
@@ -0,0 +1,173 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2POINT_INDEX_SUMMARY_H_
+#define S2_S2POINT_INDEX_SUMMARY_H_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/base/logging.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2point_index.h"
+
+// S2PointIndexSummary is a snapshot of an S2PointIndex that answers range
+// count and range sum queries without visiting the individual points.  For
+// example, the number of points in an S2CellUnion covering of a region (or
+// the sum of their weights) takes O(covering size * log n) time rather than
+// time proportional to the number of points.
+//
+// The summary stores the S2CellIds of the points in sorted order (which is
+// the order of the index itself) together with the prefix sums of their
+// weights.  Since the points contained by a cell form a contiguous range of
+// S2CellIds, every query is the difference of two prefix sums found by
+// binary search.  Example usage:
+//
+//   S2PointIndexSummary<double> summary(
+//       index, [](const S2PointIndex<double>::PointData& p) {
+//         return p.data();  // The data is the weight of the point.
+//       });
+//   S2CellUnion covering = coverer.GetCovering(cap);
+//   int num_points = summary.GetCount(covering);
+//   double weight = summary.GetWeight(covering);
+//
+// Note that a covering can contain points that are outside the region
+// itself; use an interior covering to obtain a lower bound instead.
+//
+// The summary is not updated when the index is modified; construct a new
+// summary (or call Init() again) after changing the index.
+template <class Data>
+class S2PointIndexSummary {
+ public:
+  using Index = S2PointIndex<Data>;
+  using PointData = typename Index::PointData;
+
+  // Returns the weight of a point.  The weights should be additive, e.g. a
+  // mass or a population.
+  using WeightFunction = std::function<double(const PointData&)>;
+
+  // Default constructor; requires Init() to be called.
+  S2PointIndexSummary() {}
+
+  // Convenience constructor that calls Init().
+  explicit S2PointIndexSummary(const Index& index,
+                               const WeightFunction& weight = nullptr);
+
+  // Initializes the summary with the points of "index".  If "weight" is not
+  // nullptr, the summary also supports GetWeight() queries.
+  void Init(const Index& index, const WeightFunction& weight = nullptr);
+
+  // Returns the number of points in the index.
+  int num_points() const { return static_cast<int>(ids_.size()); }
+
+  // Returns the number of points contained by the given cell or cell union.
+  // The union should not contain overlapping cells (e.g., it should be
+  // normalized), since otherwise some points are counted more than once.
+  int GetCount(S2CellId id) const;
+  int GetCount(const S2CellUnion& cell_union) const;
+
+  // Returns the sum of the weights of the points contained by the given cell
+  // or cell union (see GetCount).
+  //
+  // REQUIRES: a weight function was supplied to Init().
+  double GetWeight(S2CellId id) const;
+  double GetWeight(const S2CellUnion& cell_union) const;
+
+ private:
+  // Returns the range [*begin, *end) of points that are contained by "id".
+  void GetRange(S2CellId id, int* begin, int* end) const;
+
+  std::vector<S2CellId> ids_;
+
+  // weight_sums_[i] is the total weight of the first "i" points.  This is
+  // empty if no weight function was supplied.
+  std::vector<double> weight_sums_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Data>
+S2PointIndexSummary<Data>::S2PointIndexSummary(const Index& index,
+                                               const WeightFunction& weight) {
+  Init(index, weight);
+}
+
+template <class Data>
+void S2PointIndexSummary<Data>::Init(const Index& index,
+                                     const WeightFunction& weight) {
+  ids_.clear();
+  weight_sums_.clear();
+  ids_.reserve(index.num_points());
+  if (weight) {
+    weight_sums_.reserve(index.num_points() + 1);
+    weight_sums_.push_back(0);
+  }
+  typename Index::Iterator it(&index);
+  for (; !it.done(); it.Next()) {
+    ids_.push_back(it.id());
+    if (weight) {
+      weight_sums_.push_back(weight_sums_.back() + weight(it.point_data()));
+    }
+  }
+}
+
+template <class Data>
+inline void S2PointIndexSummary<Data>::GetRange(S2CellId id, int* begin,
+                                                int* end) const {
+  *begin = static_cast<int>(
+      std::lower_bound(ids_.begin(), ids_.end(), id.range_min()) -
+      ids_.begin());
+  *end = static_cast<int>(
+      std::upper_bound(ids_.begin() + *begin, ids_.end(), id.range_max()) -
+      ids_.begin());
+}
+
+template <class Data>
+int S2PointIndexSummary<Data>::GetCount(S2CellId id) const {
+  int begin, end;
+  GetRange(id, &begin, &end);
+  return end - begin;
+}
+
+template <class Data>
+int S2PointIndexSummary<Data>::GetCount(const S2CellUnion& cell_union) const {
+  int count = 0;
+  for (S2CellId id : cell_union) count += GetCount(id);
+  return count;
+}
+
+template <class Data>
+double S2PointIndexSummary<Data>::GetWeight(S2CellId id) const {
+  S2_DCHECK(!weight_sums_.empty()) << "No weight function was supplied";
+  int begin, end;
+  GetRange(id, &begin, &end);
+  return weight_sums_[end] - weight_sums_[begin];
+}
+
+template <class Data>
+double S2PointIndexSummary<Data>::GetWeight(
+    const S2CellUnion& cell_union) const {
+  double weight = 0;
+  for (S2CellId id : cell_union) weight += GetWeight(id);
+  return weight;
+}
+
+#endif  // S2_S2POINT_INDEX_SUMMARY_H_
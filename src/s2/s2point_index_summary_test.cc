@@ -0,0 +1,75 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2point_index_summary.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2point_index.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+TEST(S2PointIndexSummary, Empty) {
+  S2PointIndex<int> index;
+  S2PointIndexSummary<int> summary(index);
+  EXPECT_EQ(0, summary.num_points());
+  EXPECT_EQ(0, summary.GetCount(S2CellId::FromFace(3)));
+}
+
+TEST(S2PointIndexSummary, CountAndWeightMatchBruteForce) {
+  S2Testing::rnd.Reset(1);
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(10));
+  using Index = S2PointIndex<double>;
+  Index index;
+  vector<Index::PointData> points;
+  for (int i = 0; i < 5000; ++i) {
+    points.emplace_back(S2Testing::SamplePoint(cap),
+                        S2Testing::rnd.UniformDouble(0, 10));
+    index.Add(points.back());
+  }
+  // Also add a duplicate point, which must be counted twice.
+  index.Add(points[0]);
+  points.push_back(points[0]);
+
+  S2PointIndexSummary<double> summary(
+      index, [](const Index::PointData& p) { return p.data(); });
+  EXPECT_EQ(points.size(), summary.num_points());
+  S2RegionCoverer coverer;
+  for (int iter = 0; iter < 20; ++iter) {
+    S2Cap query(S2Testing::SamplePoint(cap),
+                S1Angle::Degrees(S2Testing::rnd.UniformDouble(0.1, 5)));
+    S2CellUnion covering = coverer.GetCovering(query);
+    int expected_count = 0;
+    double expected_weight = 0;
+    for (const auto& p : points) {
+      if (covering.Contains(p.point())) {
+        ++expected_count;
+        expected_weight += p.data();
+      }
+    }
+    EXPECT_EQ(expected_count, summary.GetCount(covering));
+    EXPECT_NEAR(expected_weight, summary.GetWeight(covering), 1e-9);
+  }
+}
+
+}  // namespace
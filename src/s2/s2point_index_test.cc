@@ -18,12 +18,15 @@
 #include "s2/s2point_index.h"
 
 #include <set>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2testing.h"
 
+using std::vector;
+
 class S2PointIndexTest : public ::testing::Test {
  protected:
   using Index = S2PointIndex<int>;
@@ -135,6 +138,65 @@ TEST_F(S2PointIndexTest, RandomPoints) {
   }
 }
 
+TEST_F(S2PointIndexTest, AddSortedAndUnsorted) {
+  // Points added in bulk should be iterated in the same order as points
+  // added one at a time, including points with the same S2CellId.
+  vector<PointData> points;
+  for (int i = 0; i < 1000; ++i) {
+    S2Point p = S2Testing::RandomPoint();
+    points.push_back(PointData(p, i));
+    if (i % 10 == 0) points.push_back(PointData(p, -i));
+  }
+  for (const PointData& point_data : points) {
+    Add(point_data.point(), point_data.data());
+  }
+  Index unsorted;
+  unsorted.AddUnsorted(points);
+  vector<PointData> sorted;
+  for (Index::Iterator it(&index_); !it.done(); it.Next()) {
+    sorted.push_back(it.point_data());
+  }
+  vector<PointData> actual;
+  for (Index::Iterator it(&unsorted); !it.done(); it.Next()) {
+    actual.push_back(it.point_data());
+  }
+  EXPECT_TRUE(sorted == actual);
+
+  // AddSorted() to an empty and to a non-empty index.
+  Index from_sorted;
+  from_sorted.AddSorted(sorted);
+  EXPECT_EQ(sorted.size(), from_sorted.num_points());
+  for (Index::Iterator it(&from_sorted), it2(&index_); !it.done();
+       it.Next(), it2.Next()) {
+    EXPECT_TRUE(it.point_data() == it2.point_data());
+  }
+  index_.AddSorted(sorted);
+  for (const PointData& point_data : sorted) {
+    contents_.insert(point_data);
+  }
+  Verify();
+}
+
+TEST_F(S2PointIndexTest, Move) {
+  S2Point p = S2Testing::RandomPoint();
+  Add(p, 1);
+  Add(p, 2);
+  // A move within the same leaf cell is done in place.
+  S2Point q = (p + 1e-15 * S2Point(1, 1, 1)).Normalize();
+  ASSERT_EQ(S2CellId(p), S2CellId(q));
+  EXPECT_TRUE(index_.Move(PointData(p, 2), q));
+  contents_.erase(contents_.find(PointData(p, 2)));
+  contents_.insert(PointData(q, 2));
+  Verify();
+  // A move to another cell reinserts the point.
+  S2Point r = S2Testing::RandomPoint();
+  EXPECT_TRUE(index_.Move(PointData(p, 1), r));
+  contents_.erase(contents_.find(PointData(p, 1)));
+  contents_.insert(PointData(r, 1));
+  Verify();
+  EXPECT_FALSE(index_.Move(PointData(p, 1), r));
+}
+
 TEST(S2PointIndex, EmptyData) {
   // Verify that when Data is an empty class, no space is used.
   EXPECT_EQ(sizeof(S2Point), sizeof(S2PointIndex<>::PointData));
@@ -0,0 +1,116 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2point_soa.h"
+
+#include <cstdint>
+#include <utility>
+
+using std::vector;
+
+// The number of doubles in each aligned block.
+static const int kBlockSize = S2PointSoA::kAlignment / sizeof(double);
+
+S2PointSoA::S2PointSoA()
+    : size_(0), x_(nullptr), y_(nullptr), z_(nullptr) {
+}
+
+S2PointSoA::S2PointSoA(S2PointSpan points) : S2PointSoA() {
+  Init(points);
+}
+
+S2PointSoA::S2PointSoA(S2PointSoA&& other)
+    : size_(other.size_), storage_(std::move(other.storage_)),
+      x_(other.x_), y_(other.y_), z_(other.z_) {
+  other.size_ = 0;
+  other.x_ = other.y_ = other.z_ = nullptr;
+}
+
+S2PointSoA& S2PointSoA::operator=(S2PointSoA&& other) {
+  size_ = other.size_;
+  storage_ = std::move(other.storage_);
+  x_ = other.x_;
+  y_ = other.y_;
+  z_ = other.z_;
+  other.size_ = 0;
+  other.x_ = other.y_ = other.z_ = nullptr;
+  return *this;
+}
+
+void S2PointSoA::Init(S2PointSpan points) {
+  size_ = points.size();
+  if (size_ == 0) {
+    storage_.reset();
+    x_ = y_ = z_ = nullptr;
+    return;
+  }
+  // Round each array up to a whole number of blocks so that all three are
+  // aligned, and allocate one extra block to align the first array.
+  const int stride = (size_ + kBlockSize - 1) / kBlockSize * kBlockSize;
+  storage_.reset(new double[3 * stride + kBlockSize]);
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage_.get());
+  uintptr_t padding = (kAlignment - address % kAlignment) % kAlignment;
+  x_ = storage_.get() + padding / sizeof(double);
+  y_ = x_ + stride;
+  z_ = y_ + stride;
+  for (int i = 0; i < size_; ++i) {
+    x_[i] = points[i].x();
+    y_[i] = points[i].y();
+    z_[i] = points[i].z();
+  }
+}
+
+vector<S2Point> S2PointSoA::ToVector() const {
+  vector<S2Point> result;
+  result.reserve(size_);
+  for (int i = 0; i < size_; ++i) result.push_back((*this)[i]);
+  return result;
+}
+
+void S2PointSoA::GetSquaredDistances(const S2Point& p, int begin, int end,
+                                     double* d2) const {
+  S2_DCHECK_GE(begin, 0);
+  S2_DCHECK_LE(end, size_);
+  // The arithmetic is the same as S2Point::Norm2(), so that the results
+  // agree exactly with the scalar code.
+  const double px = p.x(), py = p.y(), pz = p.z();
+  const double* x = x_ + begin;
+  const double* y = y_ + begin;
+  const double* z = z_ + begin;
+  const int n = end - begin;
+  for (int i = 0; i < n; ++i) {
+    double dx = px - x[i], dy = py - y[i], dz = pz - z[i];
+    d2[i] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+void S2PointSoA::GetSquaredDistances(const S2Point& p, const int32* ids,
+                                     int n, double* d2) const {
+  const double px = p.x(), py = p.y(), pz = p.z();
+  for (int i = 0; i < n; ++i) {
+    S2_DCHECK_LT(ids[i], size_);
+    double dx = px - x_[ids[i]], dy = py - y_[ids[i]], dz = pz - z_[ids[i]];
+    d2[i] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+size_t S2PointSoA::SpaceUsed() const {
+  size_t size = sizeof(*this);
+  if (size_ > 0) {
+    const int stride = (size_ + kBlockSize - 1) / kBlockSize * kBlockSize;
+    size += (3 * stride + kBlockSize) * sizeof(double);
+  }
+  return size;
+}
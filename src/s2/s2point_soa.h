@@ -0,0 +1,97 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2POINT_SOA_H_
+#define S2_S2POINT_SOA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "s2/_fp_contract_off.h"
+#include "s2/base/logging.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/third_party/absl/base/integral_types.h"
+
+// S2PointSoA stores a sequence of S2Points in "structure of arrays" form,
+// i.e. as three separate arrays of x, y, and z coordinates.  Each array is
+// aligned to a 64-byte boundary.  This layout allows kernels that process
+// many points at once (e.g. computing the distance from a fixed point to
+// every vertex) to be vectorized efficiently, which is not possible when
+// the coordinates of each point are interleaved.
+//
+// The class is used by S2SoAPointVectorShape and S2SoALaxPolylineShape, which
+// are recognized by S2ClosestEdgeQuery and S2CrossingEdgeQuery.
+class S2PointSoA {
+ public:
+  // The alignment of the coordinate arrays, in bytes.
+  static constexpr int kAlignment = 64;
+
+  // Constructs an empty array.
+  S2PointSoA();
+
+  // Constructs an array containing the given points.
+  explicit S2PointSoA(S2PointSpan points);
+
+  S2PointSoA(S2PointSoA&& other);
+  S2PointSoA& operator=(S2PointSoA&& other);
+
+  // Replaces the contents of the array with the given points.
+  void Init(S2PointSpan points);
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns the point at index "i".
+  S2Point operator[](int i) const {
+    S2_DCHECK_GE(i, 0);
+    S2_DCHECK_LT(i, size_);
+    return S2Point(x_[i], y_[i], z_[i]);
+  }
+
+  // Returns the coordinate arrays.  Each array has size() elements and is
+  // aligned to kAlignment bytes.
+  const double* x() const { return x_; }
+  const double* y() const { return y_; }
+  const double* z() const { return z_; }
+
+  // Returns the points as a vector of S2Points.
+  std::vector<S2Point> ToVector() const;
+
+  // Sets d2[i - begin] to (p - (*this)[i]).Norm2() for begin <= i < end.
+  // The results are bitwise identical to computing each value separately.
+  void GetSquaredDistances(const S2Point& p, int begin, int end,
+                           double* d2) const;
+
+  // Sets d2[i] to (p - (*this)[ids[i]]).Norm2() for 0 <= i < n.
+  void GetSquaredDistances(const S2Point& p, const int32* ids, int n,
+                           double* d2) const;
+
+  // Returns the number of bytes used by the array.
+  size_t SpaceUsed() const;
+
+ private:
+  int size_;
+  std::unique_ptr<double[]> storage_;
+  double* x_;
+  double* y_;
+  double* z_;
+
+  S2PointSoA(const S2PointSoA&) = delete;
+  void operator=(const S2PointSoA&) = delete;
+};
+
+#endif  // S2_S2POINT_SOA_H_
@@ -0,0 +1,89 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2point_soa.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+vector<S2Point> MakeRandomPoints(int n) {
+  vector<S2Point> points;
+  for (int i = 0; i < n; ++i) points.push_back(S2Testing::RandomPoint());
+  return points;
+}
+
+bool IsAligned(const double* p) {
+  return reinterpret_cast<uintptr_t>(p) % S2PointSoA::kAlignment == 0;
+}
+
+TEST(S2PointSoA, Empty) {
+  S2PointSoA soa;
+  EXPECT_EQ(0, soa.size());
+  EXPECT_TRUE(soa.empty());
+  EXPECT_TRUE(soa.ToVector().empty());
+}
+
+TEST(S2PointSoA, RoundTripAndAlignment) {
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  for (int n : {1, 7, 8, 9, 100}) {
+    vector<S2Point> points = MakeRandomPoints(n);
+    S2PointSoA soa(points);
+    ASSERT_EQ(n, soa.size());
+    EXPECT_EQ(points, soa.ToVector());
+    for (int i = 0; i < n; ++i) {
+      EXPECT_EQ(points[i], soa[i]);
+      EXPECT_EQ(points[i].x(), soa.x()[i]);
+    }
+    EXPECT_TRUE(IsAligned(soa.x()));
+    EXPECT_TRUE(IsAligned(soa.y()));
+    EXPECT_TRUE(IsAligned(soa.z()));
+  }
+}
+
+TEST(S2PointSoA, Move) {
+  vector<S2Point> points = MakeRandomPoints(10);
+  S2PointSoA soa(points);
+  S2PointSoA moved(std::move(soa));
+  EXPECT_EQ(points, moved.ToVector());
+  soa = std::move(moved);
+  EXPECT_EQ(points, soa.ToVector());
+}
+
+TEST(S2PointSoA, GetSquaredDistances) {
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  vector<S2Point> points = MakeRandomPoints(37);
+  S2PointSoA soa(points);
+  S2Point p = S2Testing::RandomPoint();
+  vector<double> d2(points.size());
+  soa.GetSquaredDistances(p, 3, points.size(), d2.data());
+  for (int i = 3; i < points.size(); ++i) {
+    EXPECT_EQ((p - points[i]).Norm2(), d2[i - 3]);
+  }
+  vector<int32> ids = {5, 0, 36, 5, 17};
+  soa.GetSquaredDistances(p, ids.data(), ids.size(), d2.data());
+  for (int i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ((p - points[ids[i]]).Norm2(), d2[i]);
+  }
+}
+
+}  // namespace
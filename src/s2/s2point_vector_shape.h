@@ -20,6 +20,7 @@
 
 #include <vector>
 #include "s2/encoded_s2point_vector.h"
+#include "s2/s2point_soa.h"
 #include "s2/s2shape.h"
 
 // S2PointVectorShape is an S2Shape representing a set of S2Points. Each point
@@ -78,6 +79,10 @@ class S2PointVectorShape : public S2Shape {
   ChainPosition chain_position(int e) const final {
     return ChainPosition(e, 0);
   }
+  bool GetChainVertices(int i, S2PointSpan* vertices) const final {
+    *vertices = S2PointSpan(&points_[i], 1);
+    return true;
+  }
   TypeTag type_tag() const override { return kTypeTag; }
 
  private:
@@ -123,5 +128,68 @@ class EncodedS2PointVectorShape : public S2Shape {
   s2coding::EncodedS2PointVector points_;
 };
 
+// Like S2PointVectorShape, except that the points are stored in structure of
+// arrays form (see S2PointSoA).  S2ClosestEdgeQuery recognizes this shape
+// type and computes the distances to its points using vectorized loops.
+// The encoding is the same as S2PointVectorShape.
+class S2SoAPointVectorShape : public S2Shape {
+ public:
+  static constexpr TypeTag kTypeTag = 6;
+
+  // Constructs an empty point vector.
+  S2SoAPointVectorShape() {}
+
+  // Constructs an S2SoAPointVectorShape from the given points.
+  explicit S2SoAPointVectorShape(S2PointSpan points) : points_(points) {}
+
+  int num_points() const { return points_.size(); }
+  S2Point point(int i) const { return points_[i]; }
+
+  // Returns the points in structure of arrays form.
+  const S2PointSoA& points() const { return points_; }
+
+  // Appends an encoded representation of the S2SoAPointVectorShape to
+  // "encoder".
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void Encode(Encoder* encoder,
+              s2coding::CodingHint hint = s2coding::CodingHint::COMPACT) const {
+    s2coding::EncodeS2PointVector(points_.ToVector(), hint, encoder);
+  }
+
+  // Decodes an S2SoAPointVectorShape, returning true on success.
+  bool Init(Decoder* decoder) {
+    s2coding::EncodedS2PointVector points;
+    if (!points.Init(decoder)) return false;
+    points_.Init(points.Decode());
+    return true;
+  }
+
+  // S2Shape interface:
+  int num_edges() const final { return num_points(); }
+  Edge edge(int e) const final {
+    S2Point p = points_[e];
+    return Edge(p, p);
+  }
+  int dimension() const final { return 0; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final { return num_points(); }
+  Chain chain(int i) const final { return Chain(i, 1); }
+  Edge chain_edge(int i, int j) const final {
+    S2_DCHECK_EQ(j, 0);
+    return edge(i);
+  }
+  ChainPosition chain_position(int e) const final {
+    return ChainPosition(e, 0);
+  }
+  TypeTag type_tag() const override { return kTypeTag; }
+
+ private:
+  S2PointSoA points_;
+};
+
 
 #endif  // S2_S2POINT_VECTOR_SHAPE_H_
@@ -20,7 +20,9 @@
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "s2/s2shapeutil_coding.h"
 #include "s2/s2testing.h"
+#include "s2/util/coding/coder.h"
 
 TEST(S2PointVectorShape, Empty) {
   std::vector<S2Point> points;
@@ -57,3 +59,29 @@ TEST(S2PointVectorShape, ConstructionAndAccess) {
     EXPECT_EQ(pt, edge.v1);
   }
 }
+
+TEST(S2SoAPointVectorShape, MatchesS2PointVectorShapeAndCoding) {
+  std::vector<S2Point> points;
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  for (int i = 0; i < 20; ++i) points.push_back(S2Testing::RandomPoint());
+  S2SoAPointVectorShape shape(points);
+  S2PointVectorShape expected(points);
+  EXPECT_TRUE(shape.type_tag() == S2SoAPointVectorShape::kTypeTag);
+  ASSERT_EQ(expected.num_edges(), shape.num_edges());
+  EXPECT_EQ(expected.num_chains(), shape.num_chains());
+  EXPECT_EQ(0, shape.dimension());
+  for (int i = 0; i < shape.num_edges(); ++i) {
+    EXPECT_EQ(expected.edge(i), shape.edge(i));
+    EXPECT_EQ(points[i], shape.point(i));
+  }
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeShape(shape, &encoder));
+  Decoder decoder(encoder.base(), encoder.length());
+  auto decoded = s2shapeutil::FullDecodeShape(shape.type_tag(), &decoder);
+  ASSERT_TRUE(decoded != nullptr);
+  EXPECT_TRUE(decoded->type_tag() == S2SoAPointVectorShape::kTypeTag);
+  ASSERT_EQ(shape.num_edges(), decoded->num_edges());
+  for (int i = 0; i < shape.num_edges(); ++i) {
+    EXPECT_EQ(shape.edge(i), decoded->edge(i));
+  }
+}
@@ -19,10 +19,13 @@
 
 #include <algorithm>
 #include <array>
+#include <cfloat>
 #include <cmath>
 #include <cstddef>
+#include <functional>
 #include <set>
 #include <stack>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -35,6 +38,7 @@
 #include "s2/s1interval.h"
 #include "s2/s2boolean_operation.h"
 #include "s2/s2builder.h"
+#include "s2/s2builder_graph.h"
 #include "s2/s2builderutil_s2polygon_layer.h"
 #include "s2/s2builderutil_s2polyline_layer.h"
 #include "s2/s2builderutil_s2polyline_vector_layer.h"
@@ -68,6 +72,7 @@
 #include "s2/third_party/absl/container/inlined_vector.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/util/coding/coder.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using s2builderutil::IdentitySnapFunction;
@@ -84,6 +89,14 @@ using std::sqrt;
 using std::unique_ptr;
 using std::vector;
 
+using EdgeType = S2Builder::EdgeType;
+using Graph = S2Builder::Graph;
+using GraphOptions = S2Builder::GraphOptions;
+
+using DegenerateEdges = GraphOptions::DegenerateEdges;
+using DuplicateEdges = GraphOptions::DuplicateEdges;
+using SiblingPairs = GraphOptions::SiblingPairs;
+
 DEFINE_bool(
     s2polygon_lazy_indexing, true,
     "Build the S2ShapeIndex only when it is first needed.  This can save "
@@ -132,6 +145,8 @@ S2Debug S2Polygon::s2debug_override() const {
   return s2debug_override_;
 }
 
+const int S2Polygon::kDefaultMaxUnindexedContainsCalls;
+
 void S2Polygon::Copy(const S2Polygon* src) {
   ClearLoops();
   for (int i = 0; i < src->num_loops(); ++i) {
@@ -142,6 +157,7 @@ void S2Polygon::Copy(const S2Polygon* src) {
   // property of the polygon but only of the way the polygon was constructed.
   num_vertices_ = src->num_vertices();
   unindexed_contains_calls_.store(0, std::memory_order_relaxed);
+  max_unindexed_contains_calls_ = src->max_unindexed_contains_calls_;
   bound_ = src->bound_;
   subregion_bound_ = src->subregion_bound_;
   InitIndex();  // TODO(ericv): Copy the index efficiently.
@@ -174,18 +190,44 @@ S2Polygon::~S2Polygon() {
   ClearLoops();
 }
 
-bool S2Polygon::IsValid() const {
+bool S2Polygon::IsValid(Executor* executor) const {
   S2Error error;
-  if (FindValidationError(&error)) {
+  if (FindValidationError(&error, executor)) {
     S2_LOG_IF(ERROR, FLAGS_s2debug) << error;
     return false;
   }
   return true;
 }
 
-bool S2Polygon::FindValidationError(S2Error* error) const {
-  for (int i = 0; i < num_loops(); ++i) {
-    // Check for loop errors that don't require building an S2ShapeIndex.
+// Calls fn(i, error) for every i in [0, n), possibly concurrently, and
+// returns true if any call returns true.  In that case "error" is set to the
+// error of the smallest such "i", so that the result does not depend on the
+// number of threads.
+static bool FindFirstError(
+    int n, S2Error* error, Executor* executor,
+    const std::function<bool (int i, S2Error* error)>& fn) {
+  if (executor == nullptr) {
+    for (int i = 0; i < n; ++i) {
+      if (fn(i, error)) return true;
+    }
+    return false;
+  }
+  vector<S2Error> errors(n);
+  vector<char> found(n, false);
+  ParallelFor(executor, n, [&](int i) { found[i] = fn(i, &errors[i]); });
+  for (int i = 0; i < n; ++i) {
+    if (found[i]) {
+      *error = errors[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool S2Polygon::FindValidationError(S2Error* error, Executor* executor) const {
+  // Check for loop errors that don't require building an S2ShapeIndex.
+  if (FindFirstError(num_loops(), error, executor,
+                     [this](int i, S2Error* error) {
     if (loop(i)->FindValidationErrorNoIndex(error)) {
       error->Init(error->code(),
                   "Loop %d: %s", i, error->text().c_str());
@@ -203,11 +245,14 @@ bool S2Polygon::FindValidationError(S2Error* error) const {
                   "Loop %d: full loop appears in non-full polygon", i);
       return true;
     }
+    return false;
+  })) {
+    return true;
   }
 
   // Check for loop self-intersections and loop pairs that cross
   // (including duplicate edges and vertices).
-  if (s2shapeutil::FindSelfIntersection(index_, error)) return true;
+  if (s2shapeutil::FindSelfIntersection(index_, error, executor)) return true;
 
   // Check whether InitOriented detected inconsistent loop orientations.
   if (error_inconsistent_loop_orientations_) {
@@ -217,10 +262,11 @@ bool S2Polygon::FindValidationError(S2Error* error) const {
   }
 
   // Finally, verify the loop nesting hierarchy.
-  return FindLoopNestingError(error);
+  return FindLoopNestingError(error, executor);
 }
 
-bool S2Polygon::FindLoopNestingError(S2Error* error) const {
+bool S2Polygon::FindLoopNestingError(S2Error* error,
+                                     Executor* executor) const {
   // First check that the loop depths make sense.
   for (int last_depth = -1, i = 0; i < num_loops(); ++i) {
     int depth = loop(i)->depth();
@@ -231,23 +277,118 @@ bool S2Polygon::FindLoopNestingError(S2Error* error) const {
     }
     last_depth = depth;
   }
-  // Then check that they correspond to the actual loop nesting.  This test
-  // is quadratic in the number of loops but the cost per iteration is small.
-  for (int i = 0; i < num_loops(); ++i) {
-    int last = GetLastDescendant(i);
-    for (int j = 0; j < num_loops(); ++j) {
-      if (i == j) continue;
-      bool nested = (j >= i + 1) && (j <= last);
-      const bool reverse_b = false;
-      if (loop(i)->ContainsNonCrossingBoundary(loop(j), reverse_b) != nested) {
-        error->Init(S2Error::POLYGON_INVALID_LOOP_NESTING,
-                    "Invalid nesting: loop %d should %scontain loop %d",
-                    i, nested ? "" : "not ", j);
-        return true;
+  // Then check that they correspond to the actual loop nesting.  Rather than
+  // testing every pair of loops (which is quadratic in the number of loops),
+  // we find all the loops that contain each loop in a single pass over an
+  // S2ShapeIndex of all the loops.  Since the loops do not cross (this was
+  // checked above), a loop is contained by exactly those loops that contain
+  // its first vertex, unless that vertex is shared with the other loop (in
+  // which case S2Loop::ContainsNonCrossingBoundary() compares the edges).
+  const int n = num_loops();
+  if (n <= 1) return false;
+  MutableS2ShapeIndex loop_index;
+  for (int i = 0; i < n; ++i) {
+    loop_index.Add(make_unique<S2Loop::Shape>(loop(i)));
+  }
+  loop_index.ForceBuild();  // Required for concurrent queries.
+
+  // Find the loops that share the first vertex of each loop.
+  std::unordered_map<S2Point, vector<int>, S2PointHash> first_vertex_loops;
+  for (int j = 0; j < n; ++j) {
+    first_vertex_loops[loop(j)->vertex(0)].push_back(j);
+  }
+  vector<vector<int>> shared_loops(n);
+  for (int i = 0; i < n; ++i) {
+    for (int k = 0; k < loop(i)->num_vertices(); ++k) {
+      auto it = first_vertex_loops.find(loop(i)->vertex(k));
+      if (it == first_vertex_loops.end()) continue;
+      for (int j : it->second) {
+        if (j != i) shared_loops[j].push_back(i);
       }
     }
   }
-  return false;
+  // The ancestors of each loop are the most recent loops at each smaller
+  // depth (the depths were validated above).
+  vector<vector<int>> ancestors(n);
+  vector<int> open_loops;
+  for (int j = 0; j < n; ++j) {
+    open_loops.resize(loop(j)->depth());
+    ancestors[j] = open_loops;
+    open_loops.push_back(j);
+  }
+  // For each loop "j", find the smallest loop "i" whose containment of "j"
+  // disagrees with the nesting hierarchy (or "n" if there is none).
+  vector<int> first_mismatch(n, n);
+  auto check_loops = [&](int begin, int end) {
+    S2ContainsPointQuery<MutableS2ShapeIndex> query(&loop_index);
+    vector<int> containing;
+    for (int j = begin; j < end; ++j) {
+      containing.clear();
+      const vector<int>& shared = shared_loops[j];
+      if (loop(j)->is_empty_or_full()) {
+        // These loops have no edges, so they are compared directly.
+        for (int i = 0; i < n; ++i) {
+          if (i != j && loop(i)->ContainsNonCrossingBoundary(loop(j), false)) {
+            containing.push_back(i);
+          }
+        }
+      } else {
+        query.VisitContainingShapes(loop(j)->vertex(0), [&](S2Shape* shape) {
+            int i = shape->id();
+            if (i != j &&
+                std::find(shared.begin(), shared.end(), i) == shared.end()) {
+              containing.push_back(i);
+            }
+            return true;
+          });
+        const bool reverse_b = false;
+        for (int i : shared) {
+          if (loop(i)->ContainsNonCrossingBoundary(loop(j), reverse_b)) {
+            containing.push_back(i);
+          }
+        }
+        std::sort(containing.begin(), containing.end());
+        containing.erase(std::unique(containing.begin(), containing.end()),
+                         containing.end());
+      }
+      // Both lists are sorted, so the first difference is the smallest loop
+      // whose containment is wrong.
+      const vector<int>& expected = ancestors[j];
+      size_t k = 0;
+      while (k < containing.size() && k < expected.size() &&
+             containing[k] == expected[k]) {
+        ++k;
+      }
+      if (k < containing.size()) first_mismatch[j] = containing[k];
+      if (k < expected.size()) {
+        first_mismatch[j] = std::min(first_mismatch[j], expected[k]);
+      }
+    }
+  };
+  if (executor == nullptr) {
+    check_loops(0, n);
+  } else {
+    const int num_tasks = std::min(n, 8 * executor->num_threads());
+    ParallelFor(executor, num_tasks, [&](int task) {
+        check_loops(static_cast<int64>(n) * task / num_tasks,
+                    static_cast<int64>(n) * (task + 1) / num_tasks);
+      });
+  }
+  // Report the error for the smallest pair (i, j), as if the loops had been
+  // compared pairwise in that order.
+  int i = n, j = n;
+  for (int k = 0; k < n; ++k) {
+    if (first_mismatch[k] < i) {
+      i = first_mismatch[k];
+      j = k;
+    }
+  }
+  if (i == n) return false;
+  bool nested = (j >= i + 1) && (j <= GetLastDescendant(i));
+  error->Init(S2Error::POLYGON_INVALID_LOOP_NESTING,
+              "Invalid nesting: loop %d should %scontain loop %d",
+              i, nested ? "" : "not ", j);
+  return true;
 }
 
 void S2Polygon::InsertLoop(S2Loop* new_loop, S2Loop* parent,
@@ -529,9 +670,7 @@ S1Angle S2Polygon::GetDistanceToBoundary(const S2Point& x) const {
 
 /*static*/ pair<double, double> S2Polygon::GetOverlapFractions(
     const S2Polygon* a, const S2Polygon* b) {
-  S2Polygon intersection;
-  intersection.InitToIntersection(a, b);
-  double intersection_area = intersection.GetArea();
+  double intersection_area = GetIntersectionArea(a, b);
   double a_area = a->GetArea();
   double b_area = b->GetArea();
   return std::make_pair(
@@ -642,10 +781,10 @@ bool S2Polygon::Contains(const S2Point& p) const {
   // build the index once enough calls have been made so that we think it is
   // worth the effort.  See S2Loop::Contains(S2Point) for detailed comments.
   static const int kMaxBruteForceVertices = 32;
-  static const int kMaxUnindexedContainsCalls = 20;
+  const int max_calls = max_unindexed_contains_calls_;
   if (num_vertices() <= kMaxBruteForceVertices ||
       (!index_.is_fresh() &&
-       ++unindexed_contains_calls_ != kMaxUnindexedContainsCalls)) {
+       (max_calls < 0 || ++unindexed_contains_calls_ != max_calls + 1))) {
     bool inside = false;
     for (int i = 0; i < num_loops(); ++i) {
       // Use brute force to avoid building the loop's S2ShapeIndex.
@@ -658,8 +797,17 @@ bool S2Polygon::Contains(const S2Point& p) const {
 }
 
 void S2Polygon::Encode(Encoder* const encoder) const {
+  EncodeInternal(encoder, false);
+}
+
+void S2Polygon::EncodeWithBounds(Encoder* const encoder) const {
+  EncodeInternal(encoder, true);
+}
+
+void S2Polygon::EncodeInternal(Encoder* const encoder,
+                               bool encode_all_bounds) const {
   if (num_vertices_ == 0) {
-    EncodeCompressed(encoder, nullptr, S2::kMaxCellLevel);
+    EncodeCompressed(encoder, nullptr, S2::kMaxCellLevel, encode_all_bounds);
     return;
   }
   // Converts all the polygon vertices to S2XYZFaceSiTi format.
@@ -701,7 +849,8 @@ void S2Polygon::Encode(Encoder* const encoder) const {
   int compressed_size = 4 * num_vertices_ + exact_point_size * num_unsnapped;
   int lossless_size = sizeof(S2Point) * num_vertices_;
   if (compressed_size < lossless_size) {
-    EncodeCompressed(encoder, all_vertices.data(), snap_level);
+    EncodeCompressed(encoder, all_vertices.data(), snap_level,
+                     encode_all_bounds);
   } else {
     EncodeUncompressed(encoder);
   }
@@ -751,6 +900,17 @@ bool S2Polygon::DecodeWithinScope(Decoder* const decoder) {
   return false;
 }
 
+bool S2Polygon::DecodeTrusted(Decoder* const decoder) {
+  S2Debug s2debug_override = s2debug_override_;
+  s2debug_override_ = S2Debug::DISABLE;
+  bool success = Decode(decoder);
+  s2debug_override_ = s2debug_override;
+  for (const unique_ptr<S2Loop>& loop : loops_) {
+    loop->set_s2debug_override(s2debug_override);
+  }
+  return success;
+}
+
 bool S2Polygon::DecodeUncompressed(Decoder* const decoder, bool within_scope) {
   if (decoder->avail() < 2 * sizeof(uint8) + sizeof(uint32)) return false;
   ClearLoops();
@@ -879,6 +1039,130 @@ bool S2Polygon::InitToOperation(S2BooleanOperation::OpType op_type,
   return true;
 }
 
+namespace {
+
+// An S2Builder::Layer that computes the area enclosed by the output edges
+// without assembling them into loops.  Since the polygon interior is always
+// to the left of every directed edge, the sum over all edges (a, b) of the
+// signed area of the triangle (o, a, b) equals the polygon area modulo 4*Pi
+// for any fixed point "o".  (Each loop contributes its own area, less 4*Pi
+// if it contains "o".)
+//
+// The result is normalized to the range [-2*Pi, 2*Pi] as in
+// S2::GetSignedArea(), and "max_error" is set to a bound on its absolute
+// error.  If the result is within this bound of zero then the output is
+// either nearly empty or nearly full, and the caller must decide which.
+class AreaLayer : public S2Builder::Layer {
+ public:
+  AreaLayer(double* area, double* max_error)
+      : area_(area), max_error_(max_error) {
+  }
+
+  GraphOptions graph_options() const override {
+    return GraphOptions(EdgeType::DIRECTED, DegenerateEdges::DISCARD,
+                        DuplicateEdges::KEEP, SiblingPairs::DISCARD);
+  }
+
+  void Build(const Graph& g, S2Error* error) override;
+
+ private:
+  double* area_;
+  double* max_error_;
+};
+
+void AreaLayer::Build(const Graph& g, S2Error* error) {
+  *area_ = *max_error_ = 0;
+  if (g.num_edges() == 0) return;
+
+  // We use the first vertex as the origin of the triangle fan, which gives
+  // small, accurate triangles for polygons that span much less than a
+  // hemisphere.  Like S2::GetSignedArea(), each triangle area is computed
+  // using the formula of Van Oosterom and Strackee and the areas are summed
+  // using compensated summation.  If any vertex is nearly antipodal to the
+  // origin we fall back to S2::SignedArea() with a fixed origin instead.
+  static const double kMinDotProd = -0.99;
+  const S2Point& o = g.vertex(g.edge(0).first);
+  bool use_fan = true;
+  for (const S2Point& v : g.vertices()) {
+    if (o.DotProd(v) < kMinDotProd) {
+      use_fan = false;
+      break;
+    }
+  }
+  double sum = 0, c = 0;
+  for (const Graph::Edge& edge : g.edges()) {
+    const S2Point& a = g.vertex(edge.first);
+    const S2Point& b = g.vertex(edge.second);
+    double e;
+    if (use_fan) {
+      e = 2 * atan2(o.DotProd((a - o).CrossProd(b - o)),
+                    1 + o.DotProd(a) + a.DotProd(b) + b.DotProd(o));
+    } else {
+      e = S2::SignedArea(S2::Origin(), a, b);
+    }
+    double t = sum + e;
+    c += (fabs(sum) >= fabs(e)) ? (sum - t) + e : (e - t) + sum;
+    sum = t;
+  }
+  *area_ = remainder(sum + c, 4 * M_PI);
+  // This is the same per-edge error bound used by S2::GetCurvatureMaxError.
+  *max_error_ = 11.25 * DBL_EPSILON * g.num_edges();
+}
+
+}  // namespace
+
+/*static*/ double S2Polygon::GetOperationArea(
+    S2BooleanOperation::OpType op_type, const S2Polygon& a,
+    const S2Polygon& b) {
+  S2BooleanOperation::Options options;
+  options.set_snap_function(
+      IdentitySnapFunction(S2::kIntersectionMergeRadius));
+  double area, max_error;
+  S2BooleanOperation op(op_type, make_unique<AreaLayer>(&area, &max_error),
+                        options);
+  S2Error error;
+  if (!op.Build(a.index_, b.index_, &error)) {
+    S2_LOG(DFATAL) << S2BooleanOperation::OpTypeToString(op_type)
+                << " operation failed: " << error;
+    return 0;
+  }
+  if (fabs(area) > max_error) return (area < 0) ? area + 4 * M_PI : area;
+
+  // The result is either nearly empty or nearly full.  We use the same
+  // heuristics as InitToIntersection() and InitToUnion(), i.e. we compute the
+  // minimum and maximum result area based on the areas of the two input
+  // polygons and choose whichever of {0, 4*Pi} is closest to being possible.
+  bool full = false;
+  if (op_type == S2BooleanOperation::OpType::INTERSECTION) {
+    if (a.bound_.Area() > 2 * M_PI && b.bound_.Area() > 2 * M_PI) {
+      double a_area = a.GetArea(), b_area = b.GetArea();
+      double min_area = max(0.0, a_area + b_area - 4 * M_PI);
+      double max_area = min(a_area, b_area);
+      full = (min_area > 4 * M_PI - max_area);
+    }
+  } else {
+    S2_DCHECK(op_type == S2BooleanOperation::OpType::UNION);
+    if (a.bound_.Area() + b.bound_.Area() > 2 * M_PI) {
+      double a_area = a.GetArea(), b_area = b.GetArea();
+      double min_area = max(a_area, b_area);
+      double max_area = min(4 * M_PI, a_area + b_area);
+      full = (min_area > 4 * M_PI - max_area);
+    }
+  }
+  return full ? 4 * M_PI + min(area, 0.0) : max(area, 0.0);
+}
+
+/*static*/ double S2Polygon::GetIntersectionArea(const S2Polygon* a,
+                                                 const S2Polygon* b) {
+  if (!a->bound_.Intersects(b->bound_)) return 0;
+  return GetOperationArea(S2BooleanOperation::OpType::INTERSECTION, *a, *b);
+}
+
+/*static*/ double S2Polygon::GetUnionArea(const S2Polygon* a,
+                                          const S2Polygon* b) {
+  return GetOperationArea(S2BooleanOperation::OpType::UNION, *a, *b);
+}
+
 void S2Polygon::InitToIntersection(const S2Polygon* a, const S2Polygon* b) {
   InitToApproxIntersection(a, b, S2::kIntersectionMergeRadius);
 }
@@ -1327,6 +1611,45 @@ unique_ptr<S2Polygon> S2Polygon::DestructiveApproxUnion(
     return std::move(queue.begin()->second);
 }
 
+unique_ptr<S2Polygon> S2Polygon::DestructiveUnion(
+    vector<unique_ptr<S2Polygon>> polygons,
+    const S2Builder::SnapFunction& snap_function, Executor* executor) {
+  if (polygons.empty()) return make_unique<S2Polygon>();
+
+  // Sort the polygons by the S2CellId of their centroids so that adjacent
+  // polygons in the sequence tend to be spatially close.  (Ties are broken
+  // using the original order so that the result is deterministic.)
+  vector<pair<S2CellId, int>> order;
+  order.reserve(polygons.size());
+  for (int i = 0; i < polygons.size(); ++i) {
+    S2Point centroid = polygons[i]->GetCentroid();
+    S2CellId id = (centroid == S2Point(0, 0, 0)) ? S2CellId::FromFace(0) :
+                  S2CellId(centroid);
+    order.push_back(std::make_pair(id, i));
+  }
+  std::sort(order.begin(), order.end());
+  vector<unique_ptr<S2Polygon>> level;
+  level.reserve(polygons.size());
+  for (const auto& entry : order) {
+    level.push_back(std::move(polygons[entry.second]));
+  }
+
+  // Repeatedly replace each adjacent pair of polygons by their union.
+  while (level.size() > 1) {
+    const int num_pairs = level.size() / 2;
+    vector<unique_ptr<S2Polygon>> next(num_pairs + level.size() % 2);
+    ParallelFor(executor, num_pairs, [&](int i) {
+        next[i] = make_unique<S2Polygon>();
+        next[i]->InitToUnion(*level[2 * i], *level[2 * i + 1], snap_function);
+        level[2 * i].reset();
+        level[2 * i + 1].reset();
+      });
+    if (level.size() % 2 != 0) next.back() = std::move(level.back());
+    level.swap(next);
+  }
+  return std::move(level[0]);
+}
+
 void S2Polygon::InitToCellUnionBorder(const S2CellUnion& cells) {
   // We use S2Builder to compute the union.  Due to rounding errors, we can't
   // compute an exact union - when a small cell is adjacent to a larger cell,
@@ -1462,7 +1785,8 @@ bool S2Polygon::BoundaryNear(const S2Polygon& b, S1Angle max_error) const {
 
 void S2Polygon::EncodeCompressed(Encoder* encoder,
                                  const S2XYZFaceSiTi* all_vertices,
-                                 int snap_level) const {
+                                 int snap_level,
+                                 bool encode_all_bounds) const {
   S2_CHECK_GE(snap_level, 0);
   // Sufficient for what we write. Typically enough for a 4 vertex polygon.
   encoder->Ensure(40);
@@ -1472,7 +1796,8 @@ void S2Polygon::EncodeCompressed(Encoder* encoder,
   S2_DCHECK_GE(encoder->avail(), 0);
   const S2XYZFaceSiTi* current_loop_vertices = all_vertices;
   for (int i = 0; i < num_loops(); ++i) {
-    loops_[i]->EncodeCompressed(encoder, current_loop_vertices, snap_level);
+    loops_[i]->EncodeCompressed(encoder, current_loop_vertices, snap_level,
+                                encode_all_bounds);
     current_loop_vertices += loops_[i]->num_vertices();
   }
   // Do not write the bound or num_vertices as they can be cheaply recomputed
@@ -1585,6 +1910,16 @@ S2Shape::Edge S2Polygon::Shape::chain_edge(int i, int j) const {
               polygon()->loop(i)->oriented_vertex(j + 1));
 }
 
+bool S2Polygon::Shape::GetChainVertices(int i, S2PointSpan* vertices) const {
+  S2_DCHECK_LT(i, Shape::num_chains());
+  // Holes are stored in the opposite orientation from their S2Shape edges,
+  // and empty and full loops have a vertex but no edges.
+  const S2Loop* loop = polygon_->loop(i);
+  if (loop->is_hole() || loop->is_empty_or_full()) return false;
+  *vertices = S2PointSpan(&loop->vertex(0), loop->num_vertices());
+  return true;
+}
+
 S2Shape::ChainPosition S2Polygon::Shape::chain_position(int e) const {
   // TODO(ericv): Make inline to remove code duplication with GetEdge.
   S2_DCHECK_LT(e, num_edges());
@@ -40,6 +40,7 @@
 
 class Decoder;
 class Encoder;
+class Executor;
 class S1Angle;
 class S2Cap;
 class S2Cell;
@@ -205,8 +206,8 @@ class S2Polygon final : public S2Region {
   // Returns true if this is a valid polygon (including checking whether all
   // the loops are themselves valid).  Note that validity is checked
   // automatically during initialization when --s2debug is enabled (true by
-  // default in debug binaries).
-  bool IsValid() const;
+  // default in debug binaries).  See FindValidationError() for "executor".
+  bool IsValid(Executor* executor = nullptr) const;
 
   // Returns true if this is *not* a valid polygon and sets "error"
   // appropriately.  Otherwise returns false and leaves "error" unchanged.
@@ -214,8 +215,13 @@ class S2Polygon final : public S2Region {
   // Note that in error messages, loops that represent holes have their edges
   // numbered in reverse order, starting from the last vertex of the loop.
   //
+  // If "executor" is not nullptr, the loops are validated concurrently, and
+  // then the edge crossings and loop nesting are checked concurrently.  The
+  // result is the same, except that if the polygon has several edge
+  // crossing errors it is unspecified which one is reported.
+  //
   // REQUIRES: error != nullptr
-  bool FindValidationError(S2Error* error) const;
+  bool FindValidationError(S2Error* error, Executor* executor = nullptr) const;
 
   // Return true if this is the empty polygon (consisting of no loops).
   bool is_empty() const { return loops_.empty(); }
@@ -284,6 +290,15 @@ class S2Polygon final : public S2Region {
   static std::pair<double, double> GetOverlapFractions(const S2Polygon* a,
                                                        const S2Polygon* b);
 
+  // Return the area of the intersection (or union) of two polygons.  The
+  // result is equivalent to calling InitToIntersection (or InitToUnion)
+  // followed by GetArea(), except that it is computed directly from the
+  // edges produced by the boolean operation without assembling them into
+  // loops or building a polygon.  This is much faster when only the area is
+  // needed.
+  static double GetIntersectionArea(const S2Polygon* a, const S2Polygon* b);
+  static double GetUnionArea(const S2Polygon* a, const S2Polygon* b);
+
   // If the given point is contained by the polygon, return it.  Otherwise
   // return the closest point on the polygon boundary.  If the polygon is
   // empty, return the input argument.  Note that the result may or may not be
@@ -549,6 +564,19 @@ class S2Polygon final : public S2Region {
   static std::unique_ptr<S2Polygon> DestructiveApproxUnion(
       std::vector<std::unique_ptr<S2Polygon> > polygons,
       S1Angle snap_radius);
+
+  // Like DestructiveUnion(), but uses the given snap function and computes
+  // the union as a "cascaded union": the polygons are sorted along the
+  // S2CellId curve by centroid, and then adjacent pairs are merged
+  // repeatedly until one polygon remains.  Each union then typically
+  // combines nearby polygons of similar size, and all the unions in a given
+  // round are independent.  If "executor" is non-null they are run
+  // concurrently.  The result does not depend on whether an executor is
+  // used.
+  static std::unique_ptr<S2Polygon> DestructiveUnion(
+      std::vector<std::unique_ptr<S2Polygon>> polygons,
+      const S2Builder::SnapFunction& snap_function,
+      Executor* executor = nullptr);
 #endif  // !defined(SWIG)
 
   // Initialize this polygon to the outline of the given cell union.
@@ -639,6 +667,19 @@ class S2Polygon final : public S2Region {
   // The point 'p' does not need to be normalized.
   bool Contains(const S2Point& p) const override;
 
+  // Contains(S2Point) does not build the polygon's S2ShapeIndex until it has
+  // been called this many times.  Set this to 0 to build the index on the
+  // first call, or to -1 so that this method never builds the index.  See
+  // S2Loop::set_max_unindexed_contains_calls() for details.  This setting is
+  // preserved by Copy() but not by Encode/Decode.
+  static const int kDefaultMaxUnindexedContainsCalls = 20;
+  void set_max_unindexed_contains_calls(int max_calls) {
+    max_unindexed_contains_calls_ = max_calls;
+  }
+  int max_unindexed_contains_calls() const {
+    return max_unindexed_contains_calls_;
+  }
+
   // Appends a serialized representation of the S2Polygon to "encoder".
   //
   // The encoding uses about 4 bytes per vertex for typical polygons in
@@ -664,9 +705,28 @@ class S2Polygon final : public S2Region {
   //           can be enlarged as necessary by calling Ensure(int).
   void EncodeUncompressed(Encoder* encoder) const;
 
+  // Like Encode(), except that the bound of every loop is stored even when
+  // the compressed format is chosen (normally only loops with many vertices
+  // store their bound).  This costs up to 32 bytes per loop but allows
+  // DecodeTrusted() to skip recomputing the loop bounds.  The output can be
+  // decoded by any of the Decode methods below.
+  //
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void EncodeWithBounds(Encoder* const encoder) const;
+
   // Decodes a polygon encoded with Encode().  Returns true on success.
   bool Decode(Decoder* const decoder);
 
+  // Like Decode(), except that the encoded data is trusted to have been
+  // produced by Encode() or EncodeWithBounds() from a valid polygon, e.g.
+  // data read back from a cache written by the same process.  The polygon
+  // and its loops are not validated (even when --s2debug is enabled), and
+  // any encoded bounds, loop depths, and origin_inside values are used as
+  // is.  The current s2debug_override() setting is preserved.  Returns false
+  // only if the data is truncated or otherwise cannot be parsed.
+  bool DecodeTrusted(Decoder* const decoder);
+
   // Decodes a polygon by pointing the S2Loop vertices directly into the
   // decoder's memory buffer (which needs to persist for the lifetime of the
   // decoded S2Polygon).  It is much faster than Decode(), but requires that
@@ -723,6 +783,7 @@ class S2Polygon final : public S2Region {
     Chain chain(int i) const final;
     Edge chain_edge(int i, int j) const final;
     ChainPosition chain_position(int e) const final;
+    bool GetChainVertices(int i, S2PointSpan* vertices) const final;
     TypeTag type_tag() const override { return kTypeTag; }
 
    private:
@@ -797,7 +858,7 @@ class S2Polygon final : public S2Region {
   void ClearLoops();
 
   // Return true if there is an error in the loop nesting hierarchy.
-  bool FindLoopNestingError(S2Error* error) const;
+  bool FindLoopNestingError(S2Error* error, Executor* executor) const;
 
   // A map from each loop to its immediate children with respect to nesting.
   // This map is built during initialization of multi-loop polygons to
@@ -820,6 +881,11 @@ class S2Polygon final : public S2Region {
                        const S2Builder::SnapFunction& snap_function,
                        const S2Polygon& a, const S2Polygon& b);
 
+  // Returns the area of the result of the given boolean operation, computed
+  // without constructing the resulting polygon.
+  static double GetOperationArea(S2BooleanOperation::OpType op_type,
+                                 const S2Polygon& a, const S2Polygon& b);
+
   // Initializes the polygon from input polygon "a" using the given S2Builder.
   // If the result has an empty boundary (no loops), also decides whether the
   // result should be the full polygon rather than the empty one based on the
@@ -836,14 +902,20 @@ class S2Polygon final : public S2Region {
   // specifies whether to call DecodeWithinScope on the loops.
   bool DecodeUncompressed(Decoder* const decoder, bool within_scope);
 
+  // Encodes the polygon as described by Encode().  If "encode_all_bounds" is
+  // true then the compressed format stores the bound of every loop.
+  void EncodeInternal(Encoder* const encoder, bool encode_all_bounds) const;
+
   // Encode the polygon's vertices using about 4 bytes / vertex plus 24 bytes /
   // unsnapped vertex. All the loop vertices must be converted first to the
   // S2XYZFaceSiTi format using S2Loop::GetXYZFaceSiTiVertices, and concatenated
   // in the all_vertices array.
   //
+  // If "encode_all_bounds" is true then the bound of every loop is stored.
+  //
   // REQUIRES: snap_level >= 0.
   void EncodeCompressed(Encoder* encoder, const S2XYZFaceSiTi* all_vertices,
-                        int snap_level) const;
+                        int snap_level, bool encode_all_bounds) const;
 
   // Decode a polygon encoded with EncodeCompressed().
   bool DecodeCompressed(Decoder* decoder);
@@ -884,6 +956,7 @@ class S2Polygon final : public S2Region {
   // we keep track of the number of calls made and only build the index once
   // enough calls have been made that we think an index would be worthwhile.
   mutable std::atomic<int32> unindexed_contains_calls_;
+  int32 max_unindexed_contains_calls_ = kDefaultMaxUnindexedContainsCalls;
 
   // "bound_" is a conservative bound on all points contained by this polygon:
   // if A.Contains(P), then A.bound_.Contains(S2LatLng(P)).
@@ -25,6 +25,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -33,6 +34,7 @@
 #include "s2/base/casts.h"
 #include "s2/base/commandlineflags.h"
 #include "s2/base/logging.h"
+#include "s2/base/mutex.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
@@ -66,6 +68,7 @@
 #include "s2/util/coding/coder.h"
 #include "s2/util/gtl/legacy_random_shuffle.h"
 #include "s2/util/math/matrix3x3.h"
+#include "s2/util/thread/executor.h"
 
 using absl::StrCat;
 using absl::make_unique;
@@ -604,6 +607,57 @@ static void TestDestructiveUnion(const S2Polygon& a, const S2Polygon& b) {
   CheckEqual(c, *c_destructive);
 }
 
+namespace {
+
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+}  // namespace
+
+TEST(S2Polygon, CascadedDestructiveUnion) {
+  // Union a shuffled grid of adjacent cells that straddles a face boundary.
+  S2CellId start = S2CellId::FromFace(0).child_end(8).prev();
+  vector<S2CellId> cell_ids;
+  S2CellId id = start;
+  for (int i = 0; i < 37; ++i, id = id.next()) cell_ids.push_back(id);
+  S2CellUnion cell_union(cell_ids);
+  auto make_polygons = [&cell_ids]() {
+    vector<unique_ptr<S2Polygon>> polygons;
+    for (S2CellId id : cell_ids) {
+      polygons.push_back(make_unique<S2Polygon>(S2Cell(id)));
+    }
+    std::reverse(polygons.begin(), polygons.end());
+    return polygons;
+  };
+  s2builderutil::IdentitySnapFunction snap_function(S2::kIntersectionMergeRadius);
+  auto serial = S2Polygon::DestructiveUnion(make_polygons(), snap_function);
+  ThreadPerTaskExecutor executor;
+  auto parallel = S2Polygon::DestructiveUnion(make_polygons(), snap_function,
+                                              &executor);
+  EXPECT_TRUE(serial->Equals(parallel.get()));
+  auto expected = S2Polygon::DestructiveUnion(make_polygons());
+  EXPECT_TRUE(serial->BoundaryNear(*expected, S1Angle::Radians(1e-15)));
+  S2Polygon border;
+  border.InitToCellUnionBorder(cell_union);
+  EXPECT_TRUE(serial->BoundaryNear(border, S1Angle::Radians(1e-15)));
+
+  EXPECT_TRUE(S2Polygon::DestructiveUnion({}, snap_function)->is_empty());
+}
+
 static void TestRelationWithDesc(const S2Polygon& a, const S2Polygon& b,
                                  bool contains, bool contained,
                                  bool intersects, const char* description) {
@@ -701,6 +755,27 @@ TEST_F(S2PolygonTestBase, Relations) {
 #undef TestRelation
 }
 
+TEST_F(S2PolygonTestBase, IntersectionAndUnionArea) {
+  // Check that the areas computed directly from the boolean operation edges
+  // match the areas of the polygons built by InitToIntersection/InitToUnion.
+  const vector<const S2Polygon*> polygons = {
+    empty_.get(), full_.get(), near_10_.get(), near_30_.get(),
+    near_3210_.get(), near_H3210_.get(), far_H3210_.get(), south_H21_.get(),
+    nf1_n10_f2_s10abc_.get(), cross1_side_hole_.get(), cross2_.get(),
+    overlap1_center_hole_.get(), overlap2_.get(), far_H_south_H_.get()
+  };
+  for (const S2Polygon* a : polygons) {
+    for (const S2Polygon* b : polygons) {
+      S2Polygon intersection, union_;
+      intersection.InitToIntersection(a, b);
+      union_.InitToUnion(a, b);
+      EXPECT_NEAR(intersection.GetArea(), S2Polygon::GetIntersectionArea(a, b),
+                  1e-14);
+      EXPECT_NEAR(union_.GetArea(), S2Polygon::GetUnionArea(a, b), 1e-14);
+    }
+  }
+}
+
 TEST_F(S2PolygonTestBase, EmptyAndFull) {
   EXPECT_TRUE(empty_->is_empty());
   EXPECT_FALSE(full_->is_empty());
@@ -2075,6 +2150,64 @@ TEST(S2Polygon, CompressedEncodedPolygonRequires69Bytes) {
   EXPECT_EQ(1 + 1 + 1 + 2 * 5 + 7 * 8, encoder.length());
 }
 
+TEST(S2Polygon, EncodeWithBoundsStoresLoopBounds) {
+  const unique_ptr<const S2Polygon> polygon(
+      s2textformat::MakePolygon("0:0, 0:2, 2:0; 0:0, 0:-2, -2:-2, -2:0"));
+  S2Polygon snapped_polygon;
+  snapped_polygon.InitToSnapped(polygon.get());
+
+  Encoder encoder, bounds_encoder;
+  snapped_polygon.Encode(&encoder);
+  snapped_polygon.EncodeWithBounds(&bounds_encoder);
+  // Each loop additionally stores its S2LatLngRect bound.
+  Encoder rect_encoder;
+  snapped_polygon.loop(0)->GetRectBound().Encode(&rect_encoder);
+  EXPECT_EQ(encoder.length() + 2 * rect_encoder.length(),
+            bounds_encoder.length());
+
+  // The output can be read by both Decode() and DecodeTrusted().
+  for (bool trusted : {false, true}) {
+    Decoder decoder(bounds_encoder.base(), bounds_encoder.length());
+    S2Polygon decoded_polygon;
+    if (trusted) {
+      ASSERT_TRUE(decoded_polygon.DecodeTrusted(&decoder));
+    } else {
+      ASSERT_TRUE(decoded_polygon.Decode(&decoder));
+    }
+    EXPECT_TRUE(snapped_polygon.Equals(&decoded_polygon));
+    EXPECT_EQ(snapped_polygon.GetRectBound(), decoded_polygon.GetRectBound());
+    for (int i = 0; i < snapped_polygon.num_loops(); ++i) {
+      EXPECT_EQ(snapped_polygon.loop(i)->GetRectBound(),
+                decoded_polygon.loop(i)->GetRectBound());
+    }
+  }
+}
+
+TEST_F(S2PolygonTestBase, DecodeTrusted) {
+  for (const S2Polygon* polygon : {near_30_.get(), cross1_.get()}) {
+    Encoder encoder;
+    polygon->Encode(&encoder);
+    Decoder decoder(encoder.base(), encoder.length());
+    S2Polygon decoded_polygon;
+    decoded_polygon.set_s2debug_override(S2Debug::ALLOW);
+    ASSERT_TRUE(decoded_polygon.DecodeTrusted(&decoder));
+    EXPECT_TRUE(polygon->Equals(&decoded_polygon));
+    EXPECT_EQ(polygon->GetRectBound(), decoded_polygon.GetRectBound());
+    // The caller's s2debug_override() setting is preserved.
+    EXPECT_EQ(S2Debug::ALLOW, decoded_polygon.s2debug_override());
+    for (int i = 0; i < decoded_polygon.num_loops(); ++i) {
+      EXPECT_EQ(S2Debug::ALLOW, decoded_polygon.loop(i)->s2debug_override());
+    }
+  }
+
+  // Truncated data is still rejected.
+  Encoder encoder;
+  near_30_->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length() - 1);
+  S2Polygon decoded_polygon;
+  EXPECT_FALSE(decoded_polygon.DecodeTrusted(&decoder));
+}
+
 TEST_F(S2PolygonTestBase, CompressedEncodedPolygonDecodesApproxEqual) {
   // To compare the boundaries, etc we want to snap first.
   S2Polygon snapped;
@@ -2099,6 +2232,40 @@ TEST_F(S2PolygonTestBase, CompressedEncodedPolygonDecodesApproxEqual) {
   EXPECT_EQ(1, decoded_polygon.loop(1)->depth());
 }
 
+TEST(S2Polygon, MaxUnindexedContainsCalls) {
+  // Check when Contains(S2Point) builds the index (which is built lazily).
+  // Validity checking is disabled because it also builds the index.
+  auto loop = S2Loop::MakeRegularLoop(S2Point(0, 0, 1), S1Angle::Degrees(10),
+                                      100);
+  S2Point p(0, 0, 1);
+  S2Polygon polygon(absl::WrapUnique(loop->Clone()), S2Debug::DISABLE);
+  EXPECT_EQ(S2Polygon::kDefaultMaxUnindexedContainsCalls,
+            polygon.max_unindexed_contains_calls());
+  for (int i = 0; i < S2Polygon::kDefaultMaxUnindexedContainsCalls; ++i) {
+    EXPECT_TRUE(polygon.Contains(p));
+  }
+  EXPECT_FALSE(polygon.index().is_fresh());
+  EXPECT_TRUE(polygon.Contains(p));
+  EXPECT_TRUE(polygon.index().is_fresh());
+
+  // A limit of 0 builds the index on the first call.
+  S2Polygon eager(absl::WrapUnique(loop->Clone()), S2Debug::DISABLE);
+  eager.set_max_unindexed_contains_calls(0);
+  EXPECT_TRUE(eager.Contains(p));
+  EXPECT_TRUE(eager.index().is_fresh());
+
+  // A limit of -1 never builds the index, and the limit is copied.
+  S2Polygon never(absl::WrapUnique(loop->Clone()), S2Debug::DISABLE);
+  never.set_max_unindexed_contains_calls(-1);
+  S2Polygon never_copy;
+  never_copy.Copy(&never);
+  EXPECT_EQ(-1, never_copy.max_unindexed_contains_calls());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(never_copy.Contains(p));
+  }
+  EXPECT_FALSE(never_copy.index().is_fresh());
+}
+
 // This test checks that S2Polygons created directly from S2Cells behave
 // identically to S2Polygons created from the vertices of those cells; this
 // previously was not the case, because S2Cells calculate their bounding
@@ -2292,6 +2459,12 @@ class IsValidTest : public testing::Test {
     EXPECT_TRUE(polygon.FindValidationError(&error));
     EXPECT_TRUE(error.text().find(snippet) != string::npos)
         << "\nActual error: " << error << "\nExpected substring: " << snippet;
+    ThreadPerTaskExecutor executor;
+    S2Error parallel_error;
+    EXPECT_TRUE(polygon.FindValidationError(&parallel_error, &executor));
+    EXPECT_TRUE(parallel_error.text().find(snippet) != string::npos)
+        << "\nActual error: " << parallel_error
+        << "\nExpected substring: " << snippet;
     Reset();
   }
 
@@ -2465,6 +2638,57 @@ TEST_F(IsValidTest, LoopNestingInvalid) {
   }
 }
 
+// Returns the loop nesting error found by comparing every pair of loops, or
+// an empty string if there is none.
+static string PairwiseLoopNestingError(const S2Polygon& polygon) {
+  for (int i = 0; i < polygon.num_loops(); ++i) {
+    int last = polygon.GetLastDescendant(i);
+    for (int j = 0; j < polygon.num_loops(); ++j) {
+      if (i == j) continue;
+      bool nested = (j >= i + 1) && (j <= last);
+      if (polygon.loop(i)->ContainsNonCrossingBoundary(polygon.loop(j),
+                                                       false) != nested) {
+        return absl::StrCat("Invalid nesting: loop ", i, " should ",
+                            nested ? "" : "not ", "contain loop ", j);
+      }
+    }
+  }
+  return "";
+}
+
+TEST(S2Polygon, LoopNestingManyLoops) {
+  // A grid of islands, each with a lake containing a smaller island.
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  vector<unique_ptr<S2Loop>> loops;
+  for (int lat = 0; lat < 10; ++lat) {
+    for (int lng = 0; lng < 10; ++lng) {
+      S2Point center = S2LatLng::FromDegrees(lat, lng).ToPoint();
+      for (double radius : {0.4, 0.2, 0.1}) {
+        loops.push_back(S2Loop::MakeRegularLoop(
+            center, S1Angle::Degrees(radius), 4 + S2Testing::rnd.Uniform(5)));
+      }
+    }
+  }
+  S2Polygon polygon(std::move(loops));
+  ThreadPerTaskExecutor executor;
+  S2Error error;
+  EXPECT_FALSE(polygon.FindValidationError(&error)) << error;
+  EXPECT_FALSE(polygon.FindValidationError(&error, &executor)) << error;
+
+  for (int iter = 0; iter < 20; ++iter) {
+    S2Polygon invalid;
+    invalid.set_s2debug_override(S2Debug::DISABLE);
+    invalid.Copy(&polygon);
+    invalid.loop(S2Testing::rnd.Uniform(invalid.num_loops()))->Invert();
+    string expected = PairwiseLoopNestingError(invalid);
+    ASSERT_FALSE(expected.empty());
+    ASSERT_TRUE(invalid.FindValidationError(&error));
+    EXPECT_EQ(expected, error.text());
+    ASSERT_TRUE(invalid.FindValidationError(&error, &executor));
+    EXPECT_EQ(expected, error.text());
+  }
+}
+
 TEST_F(IsValidTest, FuzzTest) {
   // Check that the S2Loop/S2Polygon constructors and IsValid() don't crash
   // when they receive arbitrary invalid input.  (We don't test large inputs;
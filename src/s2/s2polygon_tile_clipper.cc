@@ -0,0 +1,260 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2polygon_tile_clipper.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "s2/base/mutex.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/r2rect.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2edge_clipping.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2loop.h"
+#include "s2/s2padded_cell.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using s2builderutil::IdentitySnapFunction;
+using s2builderutil::S2PolygonLayer;
+using std::unique_ptr;
+using std::vector;
+
+// The padding used when clipping polygon edges to a tile in (u,v)-space.
+// This accounts for the errors in both S2::ClipToPaddedFace() and
+// S2::IntersectsRect(), so that no edge that intersects the tile is missed.
+static const double kTilePadding =
+    S2::kFaceClipErrorUVCoord + S2::kIntersectsRectErrorUVDist;
+
+// Polygon vertices that are this close to a tile edge (and vice versa) are
+// treated as being on the edge, so that the edge is split at that vertex.
+static const S1ChordAngle kOnEdgeTolerance(S2::kIntersectionError);
+
+// Appends the edges obtained by splitting AB at the given points, keeping
+// only the pieces whose midpoint satisfies "keep".  The split points are
+// sorted along the edge, and duplicates are ignored.
+template <class Keep>
+static void AddSplitEdge(const S2Point& a, const S2Point& b,
+                         vector<S2Point>* splits, const Keep& keep,
+                         S2Builder* builder) {
+  std::sort(splits->begin(), splits->end(),
+            [&a](const S2Point& x, const S2Point& y) {
+      return S1ChordAngle(a, x) < S1ChordAngle(a, y);
+    });
+  S2Point prev = a;
+  for (const S2Point& x : *splits) {
+    if (x == prev || x == b) continue;
+    if (keep(prev, x)) builder->AddEdge(prev, x);
+    prev = x;
+  }
+  if (keep(prev, b)) builder->AddEdge(prev, b);
+}
+
+S2PolygonTileClipper::S2PolygonTileClipper(const S2Polygon* polygon)
+    : polygon_(polygon) {
+}
+
+void S2PolygonTileClipper::GetCandidateEdges(const S2Cell& tile,
+                                             vector<int>* edges) const {
+  const MutableS2ShapeIndex& index = polygon_->index();
+  MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::UNPOSITIONED);
+  S2CellId id = tile.id();
+  S2ShapeIndex::CellRelation relation = it.Locate(id);
+  if (relation == S2ShapeIndex::DISJOINT) return;
+
+  // Collect the edges of the index cells that overlap the tile.  There is
+  // either one index cell that contains the tile (INDEXED), or several index
+  // cells that are contained by it (SUBDIVIDED).
+  vector<int> edge_ids;
+  S2CellId last = (relation == S2ShapeIndex::INDEXED) ? it.id()
+                                                       : id.range_max();
+  for (; !it.done() && it.id() <= last; it.Next()) {
+    const S2ShapeIndexCell& cell = it.cell();
+    for (int s = 0; s < cell.num_clipped(); ++s) {
+      const S2ClippedShape& clipped = cell.clipped(s);
+      for (int j = 0; j < clipped.num_edges(); ++j) {
+        edge_ids.push_back(clipped.edge(j));
+      }
+    }
+  }
+  std::sort(edge_ids.begin(), edge_ids.end());
+  edge_ids.erase(std::unique(edge_ids.begin(), edge_ids.end()),
+                 edge_ids.end());
+
+  // An index cell that contains the tile may have many edges that don't
+  // intersect the tile, so we discard them by clipping each edge to the
+  // padded tile in (u,v)-space.
+  const S2Shape& shape = *index.shape(0);
+  S2PaddedCell pcell(id, kTilePadding);
+  for (int e : edge_ids) {
+    S2Shape::Edge edge = shape.edge(e);
+    R2Point a, b;
+    if (S2::ClipToPaddedFace(edge.v0, edge.v1, tile.face(), kTilePadding,
+                             &a, &b) &&
+        S2::IntersectsRect(a, b, pcell.bound())) {
+      edges->push_back(e);
+    }
+  }
+}
+
+void S2PolygonTileClipper::AddClippedEdges(const S2Cell& tile,
+                                           S2Builder* builder) const {
+  vector<int> edge_ids;
+  if (polygon_->num_loops() > 0) GetCandidateEdges(tile, &edge_ids);
+  S2ContainsPointQuery<MutableS2ShapeIndex> query(&polygon_->index());
+  if (edge_ids.empty()) {
+    // The tile is either entirely inside or entirely outside the polygon.
+    if (query.Contains(tile.GetCenter())) builder->AddLoop(S2Loop(tile));
+    return;
+  }
+  S2Point v[4];
+  for (int k = 0; k < 4; ++k) v[k] = tile.GetVertex(k);
+
+  // Split each polygon edge where it crosses the tile boundary, and keep the
+  // pieces inside the tile.  The tile boundary is split at the same points
+  // so that the pieces of both meet exactly.  We also split edges at
+  // vertices of the other boundary that lie on them.
+  const S2Shape& shape = *polygon_->index().shape(0);
+  vector<S2Point> tile_splits[4], splits;
+  for (int e : edge_ids) {
+    S2Shape::Edge edge = shape.edge(e);
+    splits.clear();
+    bool tile_vertex_on_edge[4];
+    for (int k = 0; k < 4; ++k) {
+      tile_vertex_on_edge[k] =
+          S2::IsDistanceLess(v[k], edge.v0, edge.v1, kOnEdgeTolerance);
+      if (tile_vertex_on_edge[k]) splits.push_back(v[k]);
+    }
+    for (int k = 0; k < 4; ++k) {
+      const S2Point& c = v[k];
+      const S2Point& d = v[(k + 1) & 3];
+      bool v0_on_tile_edge = S2::IsDistanceLess(edge.v0, c, d,
+                                                kOnEdgeTolerance);
+      bool v1_on_tile_edge = S2::IsDistanceLess(edge.v1, c, d,
+                                                kOnEdgeTolerance);
+      if (v0_on_tile_edge) tile_splits[k].push_back(edge.v0);
+      if (v1_on_tile_edge) tile_splits[k].push_back(edge.v1);
+      // If any vertex is on the other edge, the edges are split at that
+      // vertex instead (since their intersection point would not be exact).
+      if (!v0_on_tile_edge && !v1_on_tile_edge && !tile_vertex_on_edge[k] &&
+          !tile_vertex_on_edge[(k + 1) & 3] &&
+          S2::CrossingSign(edge.v0, edge.v1, c, d) > 0) {
+        S2Point x = S2::GetIntersection(edge.v0, edge.v1, c, d);
+        splits.push_back(x);
+        tile_splits[k].push_back(x);
+      }
+    }
+    AddSplitEdge(edge.v0, edge.v1, &splits,
+                 [&tile](const S2Point& x, const S2Point& y) {
+                   return tile.Contains((x + y).Normalize());
+                 }, builder);
+  }
+
+  // Keep the pieces of the tile boundary that are inside the polygon.  If a
+  // piece lies along a polygon edge in the same direction, it already
+  // appears as a polygon piece and is skipped.  If it lies along a polygon
+  // edge in the opposite direction, both are kept and S2Builder discards
+  // them as a sibling pair.
+  auto keep_boundary = [&](const S2Point& x, const S2Point& y) {
+    S2Point mid = (x + y).Normalize();
+    for (int e : edge_ids) {
+      S2Shape::Edge edge = shape.edge(e);
+      if (S2::IsDistanceLess(mid, edge.v0, edge.v1, kOnEdgeTolerance)) {
+        return (edge.v1 - edge.v0).DotProd(y - x) < 0;
+      }
+    }
+    return query.Contains(mid);
+  };
+  for (int k = 0; k < 4; ++k) {
+    AddSplitEdge(v[k], v[(k + 1) & 3], &tile_splits[k], keep_boundary,
+                 builder);
+  }
+}
+
+bool S2PolygonTileClipper::ClipToCell(const S2Cell& tile, S2Polygon* result,
+                                      S2Error* error) const {
+  // All the vertices are either polygon vertices, tile vertices, or
+  // intersection points that are shared by both pieces, so no snapping is
+  // needed.
+  S2Builder builder{S2Builder::Options()};
+  builder.StartLayer(make_unique<S2PolygonLayer>(result));
+  AddClippedEdges(tile, &builder);
+  return builder.Build(error);
+}
+
+bool S2PolygonTileClipper::ClipToCellUnion(const S2CellUnion& tile,
+                                           S2Polygon* result,
+                                           S2Error* error) const {
+  // The edges shared by adjacent cells cancel as sibling pairs.  Snapping is
+  // needed because a cell edge may be shared with a larger neighboring cell,
+  // in which case it must be split at the vertex of the smaller cell (which
+  // is within a tiny distance of the larger cell's edge).
+  S2Builder builder{S2Builder::Options(
+      IdentitySnapFunction(S2::kIntersectionMergeRadius))};
+  builder.StartLayer(make_unique<S2PolygonLayer>(result));
+  for (S2CellId id : tile) {
+    AddClippedEdges(S2Cell(id), &builder);
+  }
+  return builder.Build(error);
+}
+
+bool S2PolygonTileClipper::ClipAll(
+    int n, const std::function<bool(int, S2Polygon*, S2Error*)>& clip,
+    vector<unique_ptr<S2Polygon>>* results, S2Error* error,
+    Executor* executor) const {
+  results->clear();
+  for (int i = 0; i < n; ++i) results->push_back(make_unique<S2Polygon>());
+  error->Clear();
+  absl::Mutex mutex;
+  int error_index = n;  // Report the error for the first failing tile.
+  ParallelFor(executor, n, [&](int i) {
+    S2Error tile_error;
+    if (!clip(i, (*results)[i].get(), &tile_error)) {
+      mutex.Lock();
+      if (i < error_index) {
+        error_index = i;
+        *error = tile_error;
+      }
+      mutex.Unlock();
+    }
+  });
+  return error->ok();
+}
+
+bool S2PolygonTileClipper::ClipToCells(
+    const vector<S2Cell>& tiles, vector<unique_ptr<S2Polygon>>* results,
+    S2Error* error, Executor* executor) const {
+  return ClipAll(tiles.size(),
+                 [this, &tiles](int i, S2Polygon* result, S2Error* error) {
+                   return ClipToCell(tiles[i], result, error);
+                 }, results, error, executor);
+}
+
+bool S2PolygonTileClipper::ClipToCellUnions(
+    const vector<S2CellUnion>& tiles, vector<unique_ptr<S2Polygon>>* results,
+    S2Error* error, Executor* executor) const {
+  return ClipAll(tiles.size(),
+                 [this, &tiles](int i, S2Polygon* result, S2Error* error) {
+                   return ClipToCellUnion(tiles[i], result, error);
+                 }, results, error, executor);
+}
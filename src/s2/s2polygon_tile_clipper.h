@@ -0,0 +1,107 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2POLYGON_TILE_CLIPPER_H_
+#define S2_S2POLYGON_TILE_CLIPPER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "s2/s2builder.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2error.h"
+#include "s2/s2polygon.h"
+
+class Executor;
+
+// S2PolygonTileClipper computes the intersection of one polygon with many
+// S2Cell "tiles", e.g. to produce vector tiles from a large polygon.  This is
+// equivalent to calling S2Polygon::InitToIntersection() with S2Polygon(tile)
+// for each tile, except that the work done for each tile is proportional to
+// the number of polygon edges near the tile rather than to the size of the
+// polygon:
+//
+//  - The candidate edges for each tile are found using the polygon's own
+//    S2ShapeIndex, which is built only once.  They are then clipped to the
+//    padded tile in (u,v)-space (see s2edge_clipping.h) to discard edges
+//    that only pass near the tile.
+//
+//  - The remaining edges are split exactly where they cross the tile
+//    boundary, and the boundary is split at the same points.  The pieces
+//    inside the tile and the parts of the tile boundary inside the polygon
+//    are then assembled with S2Builder.
+//
+// Example usage:
+//
+//   S2PolygonTileClipper clipper(&polygon);
+//   std::vector<std::unique_ptr<S2Polygon>> pieces;
+//   S2Error error;
+//   if (!clipper.ClipToCells(tiles, &pieces, &error)) { ... }
+//
+// The polygon must be valid, and it must persist (without modification) for
+// the lifetime of this object.  This class is thread-safe.
+class S2PolygonTileClipper {
+ public:
+  // REQUIRES: "polygon" persists for the lifetime of this object.
+  explicit S2PolygonTileClipper(const S2Polygon* polygon);
+
+  const S2Polygon& polygon() const { return *polygon_; }
+
+  // Sets "result" to the part of the polygon inside "tile".  Returns false
+  // and sets "error" if the output could not be assembled (which can only
+  // happen if the polygon is not valid).
+  bool ClipToCell(const S2Cell& tile, S2Polygon* result,
+                  S2Error* error) const;
+
+  // Like ClipToCell(), but the tile is the union of the given cells.  The
+  // boundaries between adjacent cells of the union are not part of the
+  // result.
+  bool ClipToCellUnion(const S2CellUnion& tile, S2Polygon* result,
+                       S2Error* error) const;
+
+  // Clips the polygon to each of the given tiles, so that (*results)[i] is
+  // the part of the polygon inside tiles[i].  If "executor" is not nullptr,
+  // the tiles are clipped concurrently.  Returns false and sets "error" if
+  // any of the tiles failed (see ClipToCell).
+  bool ClipToCells(const std::vector<S2Cell>& tiles,
+                   std::vector<std::unique_ptr<S2Polygon>>* results,
+                   S2Error* error, Executor* executor = nullptr) const;
+  bool ClipToCellUnions(const std::vector<S2CellUnion>& tiles,
+                        std::vector<std::unique_ptr<S2Polygon>>* results,
+                        S2Error* error, Executor* executor = nullptr) const;
+
+ private:
+  // Appends the ids of all polygon edges that may intersect "tile".
+  void GetCandidateEdges(const S2Cell& tile, std::vector<int>* edges) const;
+
+  // Adds the directed edges of the intersection of the polygon and "tile"
+  // to "builder".
+  void AddClippedEdges(const S2Cell& tile, S2Builder* builder) const;
+
+  // Calls "clip" for each index in [0, n) and stores the results.
+  bool ClipAll(int n,
+               const std::function<bool(int, S2Polygon*, S2Error*)>& clip,
+               std::vector<std::unique_ptr<S2Polygon>>* results,
+               S2Error* error, Executor* executor) const;
+
+  const S2Polygon* polygon_;
+
+  S2PolygonTileClipper(const S2PolygonTileClipper&) = delete;
+  void operator=(const S2PolygonTileClipper&) = delete;
+};
+
+#endif  // S2_S2POLYGON_TILE_CLIPPER_H_
@@ -0,0 +1,169 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2polygon_tile_clipper.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// Checks that "actual" is the intersection of "polygon" and "tile".
+void ExpectIntersection(const S2Polygon& polygon, const S2Polygon& tile,
+                        const S2Polygon& actual) {
+  S2Polygon expected;
+  expected.InitToIntersection(&polygon, &tile);
+  EXPECT_TRUE(actual.IsValid());
+  EXPECT_TRUE(expected.BoundaryNear(actual, S1Angle::Radians(1e-14)))
+      << "\nExpected: " << s2textformat::ToString(expected)
+      << "\nActual: " << s2textformat::ToString(actual);
+}
+
+TEST(S2PolygonTileClipper, CellBoundaries) {
+  // A polygon that is exactly an S2Cell, clipped to itself, a child, a
+  // neighbor, and its parent.
+  S2CellId id = S2CellId::FromFace(2).child_begin(5).next();
+  S2Polygon polygon((S2Cell(id)));
+  S2PolygonTileClipper clipper(&polygon);
+  S2Error error;
+  for (S2CellId tile_id : {id, id.child(1), id.next(), id.parent()}) {
+    S2Cell tile(tile_id);
+    S2Polygon result;
+    ASSERT_TRUE(clipper.ClipToCell(tile, &result, &error)) << error;
+    if (tile_id == id.next()) {
+      EXPECT_TRUE(result.is_empty());
+    } else if (tile_id == id.parent()) {
+      EXPECT_TRUE(result.BoundaryEquals(&polygon));
+    } else {
+      S2Polygon expected(tile);
+      EXPECT_TRUE(result.BoundaryEquals(&expected));
+    }
+  }
+}
+
+TEST(S2PolygonTileClipper, EmptyAndFull) {
+  S2Polygon empty, full(s2textformat::MakeLoopOrDie("full"));
+  S2PolygonTileClipper empty_clipper(&empty), full_clipper(&full);
+  S2Cell tile(S2CellId::FromFace(1).child_begin(3));
+  S2Polygon result;
+  S2Error error;
+  ASSERT_TRUE(empty_clipper.ClipToCell(tile, &result, &error));
+  EXPECT_TRUE(result.is_empty());
+  ASSERT_TRUE(full_clipper.ClipToCell(tile, &result, &error));
+  S2Polygon expected(tile);
+  EXPECT_TRUE(result.BoundaryEquals(&expected));
+}
+
+TEST(S2PolygonTileClipper, MatchesIntersection) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(1000);
+  fractal.set_fractal_dimension(1.5);
+  ThreadPerTaskExecutor executor;
+  for (int iter = 0; iter < 3; ++iter) {
+    S2Polygon polygon(fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                                       S1Angle::Degrees(10)));
+    // Use every cell at some level that intersects the polygon as a tile.
+    S2RegionCoverer::Options options;
+    options.set_fixed_level(6 + iter);
+    S2RegionCoverer coverer(options);
+    S2CellUnion covering = coverer.GetCovering(polygon);
+    vector<S2Cell> tiles;
+    for (S2CellId id : covering) tiles.push_back(S2Cell(id));
+
+    S2PolygonTileClipper clipper(&polygon);
+    vector<unique_ptr<S2Polygon>> results, parallel_results;
+    S2Error error;
+    ASSERT_TRUE(clipper.ClipToCells(tiles, &results, &error)) << error;
+    ASSERT_TRUE(clipper.ClipToCells(tiles, &parallel_results, &error,
+                                    &executor)) << error;
+    ASSERT_EQ(tiles.size(), results.size());
+    double total_area = 0;
+    for (int i = 0; i < tiles.size(); ++i) {
+      ExpectIntersection(polygon, S2Polygon(tiles[i]), *results[i]);
+      EXPECT_TRUE(results[i]->BoundaryEquals(parallel_results[i].get()));
+      total_area += results[i]->GetArea();
+    }
+    EXPECT_NEAR(polygon.GetArea(), total_area, 1e-9 * polygon.GetArea());
+  }
+}
+
+TEST(S2PolygonTileClipper, CellUnionTiles) {
+  S2Testing::rnd.Reset(2);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(300);
+  S2Polygon polygon(fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                                     S1Angle::Degrees(5)));
+  S2PolygonTileClipper clipper(&polygon);
+  // Tiles of mixed levels, so that some cell edges are shared with larger
+  // neighboring cells.
+  S2RegionCoverer::Options options;
+  options.set_max_cells(20);
+  S2RegionCoverer coverer(options);
+  S2CellUnion covering = coverer.GetCovering(polygon);
+  vector<S2CellUnion> tiles;
+  vector<S2CellId> ids = covering.cell_ids();
+  for (int i = 0; i < ids.size(); i += 3) {
+    tiles.push_back(S2CellUnion(vector<S2CellId>(
+        ids.begin() + i, ids.begin() + std::min<int>(i + 5, ids.size()))));
+  }
+  vector<unique_ptr<S2Polygon>> results;
+  S2Error error;
+  ASSERT_TRUE(clipper.ClipToCellUnions(tiles, &results, &error)) << error;
+  for (int i = 0; i < tiles.size(); ++i) {
+    S2Polygon tile;
+    tile.InitToCellUnionBorder(tiles[i]);
+    ExpectIntersection(polygon, tile, *results[i]);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,299 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "s2/s2polygon_topology.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "s2/base/logging.h"
+#include "s2/s2loop.h"
+#include "s2/s2shapeutil_get_reference_point.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/hash/mix.h"
+
+using ChainPosition = S2Shape::ChainPosition;
+using std::pair;
+using std::unique_ptr;
+using std::vector;
+
+constexpr int S2PolygonTopology::kNoFace;
+
+namespace {
+
+using VertexPair = pair<S2Point, S2Point>;
+
+struct VertexPairHash {
+  size_t operator()(const VertexPair& x) const {
+    HashMix mix(S2PointHash()(x.first));
+    mix.Mix(S2PointHash()(x.second));
+    return mix.get();
+  }
+};
+
+// A directed edge of one of the input loops, oriented so that the polygon
+// interior is on its left.
+struct HalfEdge {
+  int32 face;
+  int32 next, prev;  // Adjacent half-edges in the same loop
+  int32 twin;        // Oppositely oriented half-edge of another face, or -1
+  int32 chain;       // The chain containing this edge, or -1
+};
+
+}  // namespace
+
+void S2PolygonTopology::Init(const vector<const S2Polygon*>& polygons) {
+  vertices_.clear();
+  chains_.clear();
+  faces_.clear();
+
+  // Build the half-edges of all loops, and record the first half-edge of each
+  // loop with its length.
+  vector<HalfEdge> edges;
+  vector<S2Point> origins;
+  vector<pair<int32, int32>> loops;
+  std::unordered_map<VertexPair, int32, VertexPairHash> edge_map;
+  for (int f = 0; f < polygons.size(); ++f) {
+    for (int i = 0; i < polygons[f]->num_loops(); ++i) {
+      const S2Loop& loop = *polygons[f]->loop(i);
+      if (loop.is_empty_or_full()) continue;
+      int begin = edges.size(), n = loop.num_vertices();
+      loops.emplace_back(begin, n);
+      for (int j = 0; j < n; ++j) {
+        HalfEdge e;
+        e.face = f;
+        e.next = begin + (j + 1) % n;
+        e.prev = begin + (j + n - 1) % n;
+        e.twin = -1;
+        e.chain = -1;
+        const S2Point& a = loop.oriented_vertex(j);
+        const S2Point& b = loop.oriented_vertex(j + 1);
+        auto it = edge_map.find(VertexPair(b, a));
+        if (it != edge_map.end() && edges[it->second].twin < 0 &&
+            edges[it->second].face != f) {
+          e.twin = it->second;
+          edges[it->second].twin = edges.size();
+        } else {
+          edge_map.emplace(VertexPair(a, b), edges.size());
+        }
+        edges.push_back(e);
+        origins.push_back(a);
+      }
+    }
+  }
+  auto twin_face = [&edges](int32 e) {
+    return edges[e].twin < 0 ? kNoFace : edges[edges[e].twin].face;
+  };
+  // Returns true if a chain must start at half-edge "e", i.e. if the previous
+  // edge of the loop does not continue the same chain.  The condition is
+  // symmetric, so that the twin edges break at the same vertices.
+  auto starts_chain = [&edges, &twin_face](int32 e) {
+    int32 prev = edges[e].prev;
+    int32 twin = edges[e].twin;
+    if (twin_face(prev) != twin_face(e)) return true;
+    return twin >= 0 && edges[twin].next != edges[prev].twin;
+  };
+  // Creates a new chain starting at half-edge "e".
+  auto add_chain = [&](int32 e, bool closed) {
+    ChainInfo chain;
+    chain.begin = vertices_.size();
+    chain.left_face = edges[e].face;
+    chain.right_face = twin_face(e);
+    int32 id = chains_.size();
+    int32 start = e;
+    do {
+      vertices_.push_back(origins[e]);
+      edges[e].chain = id;
+      if (edges[e].twin >= 0) edges[edges[e].twin].chain = id;
+      e = edges[e].next;
+    } while (e != start && (closed || !starts_chain(e)));
+    vertices_.push_back(origins[e]);
+    chain.end = vertices_.size();
+    chains_.push_back(chain);
+  };
+  for (const auto& loop : loops) {
+    int32 begin = loop.first, end = loop.first + loop.second;
+    bool any_start = false;
+    for (int32 e = begin; e < end; ++e) {
+      if (!starts_chain(e)) continue;
+      any_start = true;
+      if (edges[e].chain < 0) add_chain(e, false);
+    }
+    if (!any_start && edges[begin].chain < 0) add_chain(begin, true);
+  }
+
+  // Now assemble the boundary of each face.
+  vector<vector<OrientedChain>> face_chains(polygons.size());
+  for (int i = 0; i < chains_.size(); ++i) {
+    const ChainInfo& chain = chains_[i];
+    face_chains[chain.left_face].push_back(OrientedChain{i, false});
+    if (chain.right_face != kNoFace) {
+      face_chains[chain.right_face].push_back(OrientedChain{i, true});
+    }
+  }
+  faces_.reserve(polygons.size());
+  for (auto& chains : face_chains) {
+    faces_.push_back(AssembleLoops(std::move(chains)));
+  }
+}
+
+const S2Point& S2PolygonTopology::start_vertex(OrientedChain c) const {
+  const ChainInfo& chain = chains_[c.chain];
+  return vertices_[c.reversed ? chain.end - 1 : chain.begin];
+}
+
+const S2Point& S2PolygonTopology::end_vertex(OrientedChain c) const {
+  const ChainInfo& chain = chains_[c.chain];
+  return vertices_[c.reversed ? chain.begin : chain.end - 1];
+}
+
+S2PolygonTopology::Boundary S2PolygonTopology::AssembleLoops(
+    vector<OrientedChain> chains) const {
+  // Map each start vertex to the chains that start there.  When several
+  // chains start at the same vertex (i.e. loops touch at a vertex), any
+  // choice yields a valid set of loops.
+  std::unordered_map<S2Point, vector<int>, S2PointHash> starts;
+  for (int i = 0; i < chains.size(); ++i) {
+    starts[start_vertex(chains[i])].push_back(i);
+  }
+  Boundary result;
+  result.chains.reserve(chains.size());
+  result.cumulative_edges.reserve(chains.size() + 1);
+  result.cumulative_edges.push_back(0);
+  vector<bool> used(chains.size(), false);
+  auto append = [&](int i) {
+    used[i] = true;
+    result.chains.push_back(chains[i]);
+    const ChainInfo& chain = chains_[chains[i].chain];
+    result.cumulative_edges.push_back(result.cumulative_edges.back() +
+                                      (chain.end - chain.begin - 1));
+  };
+  for (int first = 0; first < chains.size(); ++first) {
+    if (used[first]) continue;
+    result.loop_starts.push_back(result.chains.size());
+    const S2Point& loop_start = start_vertex(chains[first]);
+    append(first);
+    for (int i = first;;) {
+      const S2Point& v = end_vertex(chains[i]);
+      if (v == loop_start) break;
+      vector<int>& candidates = starts[v];
+      while (!candidates.empty() && used[candidates.back()]) {
+        candidates.pop_back();
+      }
+      if (candidates.empty()) {
+        S2_LOG(DFATAL) << "Chains do not form closed loops";
+        break;
+      }
+      i = candidates.back();
+      append(i);
+    }
+  }
+  result.loop_starts.push_back(result.chains.size());
+  return result;
+}
+
+unique_ptr<S2LaxPolygonShape> S2PolygonTopology::Dissolve(
+    const vector<int>& faces) const {
+  vector<bool> selected(num_faces(), false);
+  for (int f : faces) selected[f] = true;
+  auto is_selected = [&selected](int f) {
+    return f != kNoFace && selected[f];
+  };
+  vector<OrientedChain> chains;
+  for (int i = 0; i < chains_.size(); ++i) {
+    bool left = is_selected(chains_[i].left_face);
+    bool right = is_selected(chains_[i].right_face);
+    if (left != right) chains.push_back(OrientedChain{i, right});
+  }
+  Boundary boundary = AssembleLoops(std::move(chains));
+  vector<S2LaxPolygonShape::Loop> loops(boundary.loop_starts.size() - 1);
+  for (int i = 0; i < loops.size(); ++i) {
+    S2LaxPolygonShape::Loop& loop = loops[i];
+    for (int k = boundary.loop_starts[i]; k < boundary.loop_starts[i + 1];
+         ++k) {
+      // Each chain ends where the next one starts, so we skip its last vertex.
+      auto vertices = chain_vertices(boundary.chains[k].chain);
+      if (boundary.chains[k].reversed) {
+        loop.insert(loop.end(), vertices.rbegin(), vertices.rend() - 1);
+      } else {
+        loop.insert(loop.end(), vertices.begin(), vertices.end() - 1);
+      }
+    }
+  }
+  return absl::make_unique<S2LaxPolygonShape>(loops);
+}
+
+S2PolygonTopology::FaceShape::FaceShape(const S2PolygonTopology* topology,
+                                        int face)
+    : topology_(topology), face_(face) {
+  S2_DCHECK_GE(face, 0);
+  S2_DCHECK_LT(face, topology->num_faces());
+}
+
+int S2PolygonTopology::FaceShape::num_edges() const {
+  return topology_->faces_[face_].cumulative_edges.back();
+}
+
+S2Shape::Edge S2PolygonTopology::FaceShape::edge(int e) const {
+  const Boundary& boundary = topology_->faces_[face_];
+  const auto& cumulative = boundary.cumulative_edges;
+  S2_DCHECK_GE(e, 0);
+  S2_DCHECK_LT(e, cumulative.back());
+  int k = std::upper_bound(cumulative.begin(), cumulative.end(), e) -
+          cumulative.begin() - 1;
+  OrientedChain c = boundary.chains[k];
+  const ChainInfo& chain = topology_->chains_[c.chain];
+  const vector<S2Point>& vertices = topology_->vertices_;
+  int j = e - cumulative[k];
+  if (c.reversed) {
+    return Edge(vertices[chain.end - 1 - j], vertices[chain.end - 2 - j]);
+  }
+  return Edge(vertices[chain.begin + j], vertices[chain.begin + j + 1]);
+}
+
+S2Shape::ReferencePoint
+S2PolygonTopology::FaceShape::GetReferencePoint() const {
+  return s2shapeutil::GetReferencePoint(*this);
+}
+
+int S2PolygonTopology::FaceShape::num_chains() const {
+  return topology_->faces_[face_].loop_starts.size() - 1;
+}
+
+S2Shape::Chain S2PolygonTopology::FaceShape::chain(int i) const {
+  const Boundary& boundary = topology_->faces_[face_];
+  int start = boundary.cumulative_edges[boundary.loop_starts[i]];
+  int limit = boundary.cumulative_edges[boundary.loop_starts[i + 1]];
+  return Chain(start, limit - start);
+}
+
+S2Shape::Edge S2PolygonTopology::FaceShape::chain_edge(int i, int j) const {
+  S2_DCHECK_LT(j, chain(i).length);
+  return edge(chain(i).start + j);
+}
+
+ChainPosition S2PolygonTopology::FaceShape::chain_position(int e) const {
+  const Boundary& boundary = topology_->faces_[face_];
+  const auto& cumulative = boundary.cumulative_edges;
+  int k = std::upper_bound(cumulative.begin(), cumulative.end(), e) -
+          cumulative.begin() - 1;
+  const auto& starts = boundary.loop_starts;
+  int i = std::upper_bound(starts.begin(), starts.end(), k) -
+          starts.begin() - 1;
+  return ChainPosition(i, e - cumulative[starts[i]]);
+}
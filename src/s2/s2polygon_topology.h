@@ -0,0 +1,156 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#ifndef S2_S2POLYGON_TOPOLOGY_H_
+#define S2_S2POLYGON_TOPOLOGY_H_
+
+#include <memory>
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shape.h"
+
+// S2PolygonTopology stores a collection of polygons with pairwise disjoint
+// interiors (e.g. administrative regions or land parcels) such that each
+// boundary shared by two adjacent polygons is stored only once.  The
+// boundaries are divided into "edge chains", i.e. maximal sequences of edges
+// that have the same polygon (or "face") on each side.  Each chain records
+// the face to its left and the face to its right, where kNoFace represents
+// the exterior of all polygons.
+//
+// Each face can be added to an S2ShapeIndex by constructing a FaceShape,
+// which refers to the shared chain vertices rather than copying them.
+// Faces can also be merged with Dissolve(), which simply selects the chains
+// that separate the chosen faces from the other faces (no geometric boolean
+// operation is required).
+//
+// Example usage:
+//
+//   S2PolygonTopology topology;
+//   topology.Init({&county1, &county2, &county3});
+//   MutableS2ShapeIndex index;
+//   for (int f = 0; f < topology.num_faces(); ++f) {
+//     index.Add(absl::make_unique<S2PolygonTopology::FaceShape>(&topology, f));
+//   }
+//   auto state = topology.Dissolve({0, 1, 2});
+//
+// The polygons must have identical vertices along their shared boundaries,
+// as is the case for datasets that store each border twice.  (Borders where
+// one polygon has a vertex that the other does not are treated as separate
+// unshared chains; S2Builder can be used to fix such inputs first.)
+class S2PolygonTopology {
+ public:
+  // The face id of the exterior of all polygons.
+  static constexpr int kNoFace = -1;
+
+  // Constructs an empty topology.
+  S2PolygonTopology() = default;
+
+  // Initializes the topology from the given polygons.  Face "i" corresponds
+  // to polygons[i].  The polygons are not referenced after this call.
+  //
+  // REQUIRES: The polygon interiors are pairwise disjoint.
+  void Init(const std::vector<const S2Polygon*>& polygons);
+
+  // Returns the number of faces, i.e. the number of input polygons.
+  int num_faces() const { return faces_.size(); }
+
+  // Returns the number of edge chains.
+  int num_chains() const { return chains_.size(); }
+
+  // Returns the vertices of the given chain.  A chain that forms a closed
+  // loop repeats its first vertex at the end.
+  absl::Span<const S2Point> chain_vertices(int i) const {
+    return absl::MakeConstSpan(&vertices_[chains_[i].begin],
+                               chains_[i].end - chains_[i].begin);
+  }
+
+  // Returns the face to the left or right of the given chain (as it is
+  // traversed from its first vertex to its last), or kNoFace.
+  int left_face(int i) const { return chains_[i].left_face; }
+  int right_face(int i) const { return chains_[i].right_face; }
+
+  // Returns the total number of vertices stored by all chains.
+  int num_vertices() const { return vertices_.size(); }
+
+  // Returns the union of the given faces as a polygon, computed by selecting
+  // the chains that have one of the given faces on exactly one side.  Faces
+  // may be listed in any order and repeated.
+  std::unique_ptr<S2LaxPolygonShape> Dissolve(
+      const std::vector<int>& faces) const;
+
+  // An S2Shape representing a single face.  The topology must persist for
+  // the lifetime of this object.
+  class FaceShape final : public S2Shape {
+   public:
+    FaceShape(const S2PolygonTopology* topology, int face);
+
+    // Returns the face id represented by this shape.
+    int face() const { return face_; }
+
+    // S2Shape interface:
+    int num_edges() const override;
+    Edge edge(int e) const override;
+    int dimension() const override { return 2; }
+    ReferencePoint GetReferencePoint() const override;
+    int num_chains() const override;
+    Chain chain(int i) const override;
+    Edge chain_edge(int i, int j) const override;
+    ChainPosition chain_position(int e) const override;
+
+   private:
+    const S2PolygonTopology* topology_;
+    int face_;
+  };
+
+ private:
+  struct ChainInfo {
+    int32 begin, end;  // Range of vertices_
+    int32 left_face, right_face;
+  };
+
+  // A chain traversed in the given direction.
+  struct OrientedChain {
+    int32 chain;
+    bool reversed;
+  };
+
+  // The boundary of a region as a sequence of oriented chains, grouped into
+  // loops.  Loop "i" consists of chains [loop_starts[i], loop_starts[i+1]),
+  // and "cumulative_edges[k]" is the number of edges in chains 0..k-1.
+  struct Boundary {
+    std::vector<OrientedChain> chains;
+    std::vector<int32> loop_starts;
+    std::vector<int32> cumulative_edges;
+  };
+
+  const S2Point& start_vertex(OrientedChain c) const;
+  const S2Point& end_vertex(OrientedChain c) const;
+
+  // Arranges the given chains into loops by joining chain endpoints.
+  Boundary AssembleLoops(std::vector<OrientedChain> chains) const;
+
+  std::vector<S2Point> vertices_;
+  std::vector<ChainInfo> chains_;
+  std::vector<Boundary> faces_;
+};
+
+#endif  // S2_S2POLYGON_TOPOLOGY_H_
@@ -0,0 +1,179 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "s2/s2polygon_topology.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+unique_ptr<S2Loop> MakeRect(double lat0, double lng0, double lat1,
+                            double lng1) {
+  vector<S2Point> vertices = {
+    S2LatLng::FromDegrees(lat0, lng0).ToPoint(),
+    S2LatLng::FromDegrees(lat0, lng1).ToPoint(),
+    S2LatLng::FromDegrees(lat1, lng1).ToPoint(),
+    S2LatLng::FromDegrees(lat1, lng0).ToPoint()
+  };
+  return make_unique<S2Loop>(vertices);
+}
+
+// Returns an n x n grid of adjacent unit squares.
+vector<unique_ptr<S2Polygon>> MakeGrid(int n) {
+  vector<unique_ptr<S2Polygon>> grid;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      grid.push_back(make_unique<S2Polygon>(MakeRect(i, j, i + 1, j + 1)));
+    }
+  }
+  return grid;
+}
+
+vector<const S2Polygon*> GetPointers(
+    const vector<unique_ptr<S2Polygon>>& polygons) {
+  vector<const S2Polygon*> result;
+  for (const auto& polygon : polygons) result.push_back(polygon.get());
+  return result;
+}
+
+// Checks that the given shape represents the same region as the given
+// polygon.
+void ExpectEqualRegions(unique_ptr<S2Shape> shape, const S2Polygon& polygon) {
+  MutableS2ShapeIndex a, b;
+  a.Add(std::move(shape));
+  b.Add(make_unique<S2Polygon::Shape>(&polygon));
+  EXPECT_TRUE(S2BooleanOperation::Equals(a, b));
+}
+
+TEST(S2PolygonTopology, AdjacentSquaresShareOneChain) {
+  auto grid = MakeGrid(1);
+  grid.push_back(make_unique<S2Polygon>(MakeRect(0, 1, 1, 2)));
+  S2PolygonTopology topology;
+  topology.Init(GetPointers(grid));
+  ASSERT_EQ(2, topology.num_faces());
+  ASSERT_EQ(3, topology.num_chains());
+  int num_shared = 0;
+  for (int i = 0; i < topology.num_chains(); ++i) {
+    if (topology.right_face(i) == S2PolygonTopology::kNoFace) {
+      EXPECT_EQ(4, topology.chain_vertices(i).size());
+    } else {
+      ++num_shared;
+      EXPECT_EQ(2, topology.chain_vertices(i).size());
+      EXPECT_NE(topology.left_face(i), topology.right_face(i));
+    }
+  }
+  EXPECT_EQ(1, num_shared);
+}
+
+TEST(S2PolygonTopology, FaceShapesMatchPolygons) {
+  auto grid = MakeGrid(3);
+  S2PolygonTopology topology;
+  topology.Init(GetPointers(grid));
+  ASSERT_EQ(9, topology.num_faces());
+  // Each of the 12 interior unit edges is stored once, in its own chain.
+  int num_shared = 0;
+  for (int i = 0; i < topology.num_chains(); ++i) {
+    if (topology.right_face(i) != S2PolygonTopology::kNoFace) ++num_shared;
+  }
+  EXPECT_EQ(12, num_shared);
+  for (int f = 0; f < topology.num_faces(); ++f) {
+    auto shape = make_unique<S2PolygonTopology::FaceShape>(&topology, f);
+    EXPECT_EQ(4, shape->num_edges());
+    ASSERT_EQ(1, shape->num_chains());
+    for (int e = 0; e < shape->num_edges(); ++e) {
+      EXPECT_EQ(S2Shape::ChainPosition(0, e), shape->chain_position(e));
+      EXPECT_EQ(shape->edge(e).v1, shape->edge((e + 1) % 4).v0);
+    }
+    ExpectEqualRegions(std::move(shape), *grid[f]);
+  }
+}
+
+// Returns the union of the given grid squares.  (Note that this is not the
+// same as a single rectangle, since the grid vertices along the top and
+// bottom edges do not lie on the same geodesic.)
+unique_ptr<S2Polygon> Union(const vector<unique_ptr<S2Polygon>>& grid,
+                            const vector<int>& faces) {
+  auto result = make_unique<S2Polygon>();
+  for (int f : faces) {
+    S2Polygon next;
+    next.InitToUnion(result.get(), grid[f].get());
+    result->Copy(&next);
+  }
+  return result;
+}
+
+TEST(S2PolygonTopology, Dissolve) {
+  auto grid = MakeGrid(3);
+  S2PolygonTopology topology;
+  topology.Init(GetPointers(grid));
+
+  vector<int> all = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+  ExpectEqualRegions(topology.Dissolve(all), *Union(grid, all));
+  ExpectEqualRegions(topology.Dissolve({4}), *grid[4]);
+
+  // The first two rows, with faces repeated.
+  ExpectEqualRegions(topology.Dissolve({5, 4, 3, 2, 1, 0, 0}),
+                     *Union(grid, {0, 1, 2, 3, 4, 5}));
+
+  // A ring of eight squares around the center square.
+  vector<int> ring = {0, 1, 2, 3, 5, 6, 7, 8};
+  auto shape = topology.Dissolve(ring);
+  EXPECT_EQ(2, shape->num_loops());
+  ExpectEqualRegions(std::move(shape), *Union(grid, ring));
+}
+
+TEST(S2PolygonTopology, HoleFilledByIsland) {
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(MakeRect(0, 0, 3, 3));
+  loops.push_back(MakeRect(1, 1, 2, 2));
+  vector<unique_ptr<S2Polygon>> polygons;
+  polygons.push_back(make_unique<S2Polygon>(std::move(loops)));
+  polygons.push_back(make_unique<S2Polygon>(MakeRect(1, 1, 2, 2)));
+  S2PolygonTopology topology;
+  topology.Init(GetPointers(polygons));
+
+  // The hole boundary is a single closed chain shared by both faces.
+  ASSERT_EQ(2, topology.num_chains());
+  int shared = topology.right_face(0) == S2PolygonTopology::kNoFace ? 1 : 0;
+  EXPECT_EQ(5, topology.chain_vertices(shared).size());
+  EXPECT_EQ(1, topology.left_face(shared) + topology.right_face(shared));
+
+  ExpectEqualRegions(
+      make_unique<S2PolygonTopology::FaceShape>(&topology, 0), *polygons[0]);
+  ExpectEqualRegions(
+      make_unique<S2PolygonTopology::FaceShape>(&topology, 1), *polygons[1]);
+  S2Polygon shell(MakeRect(0, 0, 3, 3));
+  auto shape = topology.Dissolve({0, 1});
+  EXPECT_EQ(1, shape->num_loops());
+  ExpectEqualRegions(std::move(shape), shell);
+}
+
+}  // namespace
@@ -26,12 +26,16 @@
 
 #include "s2/base/commandlineflags.h"
 #include "s2/base/logging.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/utility/utility.h"
 #include "s2/util/coding/coder.h"
 #include "s2/s1angle.h"
 #include "s2/s1interval.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2crossing_edge_query.h"
 #include "s2/s2debug.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2edge_distances.h"
@@ -49,6 +53,53 @@ using std::vector;
 
 static const unsigned char kCurrentLosslessEncodingVersionNumber = 1;
 
+// Polylines with fewer vertices than this are searched linearly, since the
+// index would not pay for itself.
+static const int kMinVerticesForAcceleration = 64;
+
+// Intersects() builds the index of the longer polyline only if the shorter
+// one has at least this many vertices, since otherwise testing all the edge
+// pairs is faster.
+static const int kMinVerticesForIntersectsIndex = 16;
+
+struct S2Polyline::AccelerationData {
+  explicit AccelerationData(const S2Polyline* polyline);
+
+  // cumulative_lengths[i] is the length of the polyline from vertex 0 to
+  // vertex i (see S2::GetCumulativeLengths).
+  vector<S1Angle> cumulative_lengths;
+
+  // An index containing the polyline's edges.
+  MutableS2ShapeIndex index;
+};
+
+S2Polyline::AccelerationData::AccelerationData(const S2Polyline* polyline)
+    : cumulative_lengths(S2::GetCumulativeLengths(S2PointSpan(
+          &polyline->vertices_[0], polyline->num_vertices_))) {
+  index.Add(absl::make_unique<S2Polyline::Shape>(polyline));
+  index.ForceBuild();
+}
+
+const S2Polyline::AccelerationData* S2Polyline::GetAccelerationData() const {
+  if (num_vertices_ < kMinVerticesForAcceleration) return nullptr;
+  AccelerationData* data = acceleration_data_.load(std::memory_order_acquire);
+  if (data != nullptr) return data;
+
+  // If several threads build the data concurrently, the first one wins.
+  AccelerationData* new_data = new AccelerationData(this);
+  if (acceleration_data_.compare_exchange_strong(
+          data, new_data, std::memory_order_acq_rel,
+          std::memory_order_acquire)) {
+    return new_data;
+  }
+  delete new_data;
+  return data;
+}
+
+void S2Polyline::ResetAccelerationData() {
+  delete acceleration_data_.exchange(nullptr, std::memory_order_acq_rel);
+}
+
 S2Polyline::S2Polyline()
   : s2debug_override_(S2Debug::ALLOW) {}
 
@@ -56,12 +107,15 @@ S2Polyline::S2Polyline(S2Polyline&& other)
   : s2debug_override_(other.s2debug_override_),
     num_vertices_(absl::exchange(other.num_vertices_, 0)),
     vertices_(std::move(other.vertices_)) {
+  other.ResetAccelerationData();
 }
 
 S2Polyline& S2Polyline::operator=(S2Polyline&& other) {
   s2debug_override_ = other.s2debug_override_;
   num_vertices_ = absl::exchange(other.num_vertices_, 0);
   vertices_ = std::move(other.vertices_);
+  ResetAccelerationData();
+  other.ResetAccelerationData();
   return *this;
 }
 
@@ -84,6 +138,7 @@ S2Polyline::S2Polyline(const vector<S2LatLng>& vertices,
 }
 
 S2Polyline::~S2Polyline() {
+  ResetAccelerationData();
 }
 
 void S2Polyline::set_s2debug_override(S2Debug override) {
@@ -95,6 +150,7 @@ S2Debug S2Polyline::s2debug_override() const {
 }
 
 void S2Polyline::Init(const vector<S2Point>& vertices) {
+  ResetAccelerationData();
   num_vertices_ = vertices.size();
   vertices_.reset(new S2Point[num_vertices_]);
   std::copy(vertices.begin(), vertices.end(), &vertices_[0]);
@@ -104,6 +160,7 @@ void S2Polyline::Init(const vector<S2Point>& vertices) {
 }
 
 void S2Polyline::Init(const vector<S2LatLng>& vertices) {
+  ResetAccelerationData();
   num_vertices_ = vertices.size();
   vertices_.reset(new S2Point[num_vertices_]);
   for (int i = 0; i < num_vertices_; ++i) {
@@ -158,6 +215,11 @@ S2Polyline* S2Polyline::Clone() const {
 }
 
 S1Angle S2Polyline::GetLength() const {
+  // Use the cumulative lengths if they have already been computed, but don't
+  // build the index just for this.
+  const AccelerationData* data =
+      acceleration_data_.load(std::memory_order_acquire);
+  if (data != nullptr) return data->cumulative_lengths.back();
   return S2::GetLength(S2PointSpan(&vertices_[0], num_vertices_));
 }
 
@@ -174,6 +236,12 @@ S2Point S2Polyline::GetSuffix(double fraction, int* next_vertex) const {
     *next_vertex = 1;
     return vertex(0);
   }
+  const AccelerationData* data = GetAccelerationData();
+  if (data != nullptr) {
+    return S2::InterpolateAtLength(
+        S2PointSpan(&vertices_[0], num_vertices_), data->cumulative_lengths,
+        fraction * data->cumulative_lengths.back(), next_vertex);
+  }
   S1Angle length_sum;
   for (int i = 1; i < num_vertices(); ++i) {
     length_sum += S1Angle(vertex(i-1), vertex(i));
@@ -206,6 +274,12 @@ double S2Polyline::UnInterpolate(const S2Point& point, int next_vertex) const {
   if (num_vertices() < 2) {
     return 0;
   }
+  const AccelerationData* data = GetAccelerationData();
+  if (data != nullptr) {
+    S1Angle length_to_point = data->cumulative_lengths[next_vertex-1] +
+                              S1Angle(vertex(next_vertex-1), point);
+    return min(1.0, length_to_point / data->cumulative_lengths.back());
+  }
   S1Angle length_sum;
   for (int i = 1; i < next_vertex; ++i) {
     length_sum += S1Angle(vertex(i-1), vertex(i));
@@ -228,17 +302,23 @@ S2Point S2Polyline::Project(const S2Point& point, int* next_vertex) const {
     return vertex(0);
   }
 
-  // Initial value larger than any possible distance on the unit sphere.
-  S1Angle min_distance = S1Angle::Radians(10);
-  int min_index = -1;
-
   // Find the line segment in the polyline that is closest to the point given.
-  for (int i = 1; i < num_vertices(); ++i) {
-    S1Angle distance_to_segment = S2::GetDistance(point, vertex(i-1),
-                                                          vertex(i));
-    if (distance_to_segment < min_distance) {
-      min_distance = distance_to_segment;
-      min_index = i;
+  int min_index = -1;
+  const AccelerationData* data = GetAccelerationData();
+  if (data != nullptr) {
+    S2ClosestEdgeQuery query(&data->index);
+    S2ClosestEdgeQuery::PointTarget target(point);
+    min_index = query.FindClosestEdge(&target).edge_id() + 1;
+  } else {
+    // Initial value larger than any possible distance on the unit sphere.
+    S1Angle min_distance = S1Angle::Radians(10);
+    for (int i = 1; i < num_vertices(); ++i) {
+      S1Angle distance_to_segment = S2::GetDistance(point, vertex(i-1),
+                                                            vertex(i));
+      if (distance_to_segment < min_distance) {
+        min_distance = distance_to_segment;
+        min_index = i;
+      }
     }
   }
   S2_DCHECK_NE(min_index, -1);
@@ -288,28 +368,51 @@ bool S2Polyline::Intersects(const S2Polyline* line) const {
     return false;
   }
 
-  // TODO(ericv): Use S2ShapeIndex here.
+  // If the longer polyline is indexed (or worth indexing), test the edges of
+  // the shorter one against the index.  The index is built lazily and kept,
+  // so it is reused by later calls.
+  const S2Polyline* a = this;
+  const S2Polyline* b = line;
+  if (a->num_vertices() > b->num_vertices()) std::swap(a, b);
+  if (b->acceleration_data_.load(std::memory_order_acquire) != nullptr ||
+      a->num_vertices() >= kMinVerticesForIntersectsIndex) {
+    const AccelerationData* data = b->GetAccelerationData();
+    if (data != nullptr) {
+      S2CrossingEdgeQuery query(&data->index);
+      return !query.VisitChainCandidates(
+          S2PointSpan(&a->vertex(0), a->num_vertices()),
+          [a, b](int i, const vector<s2shapeutil::ShapeEdgeId>& candidates) {
+            S2EdgeCrosser crosser(&a->vertex(i), &a->vertex(i + 1));
+            for (const auto& candidate : candidates) {
+              int j = candidate.edge_id;
+              if (crosser.CrossingSign(&b->vertex(j), &b->vertex(j + 1)) >= 0) {
+                return false;
+              }
+            }
+            return true;
+          });
+    }
+  }
+  S2PointSpan line_vertices(&line->vertex(0), line->num_vertices());
+  vector<int8> signs(line->num_vertices());
   for (int i = 1; i < num_vertices(); ++i) {
-    S2EdgeCrosser crosser(
-        &vertex(i - 1), &vertex(i), &line->vertex(0));
-    for (int j = 1; j < line->num_vertices(); ++j) {
-      if (crosser.CrossingSign(&line->vertex(j)) >= 0) {
-        return true;
-      }
+    S2EdgeCrosser crosser(&vertex(i - 1), &vertex(i));
+    crosser.ChainCrossingSigns(line_vertices, signs.data());
+    for (int j = 0; j < line->num_vertices() - 1; ++j) {
+      if (signs[j] >= 0) return true;
     }
   }
   return false;
 }
 
 void S2Polyline::Reverse() {
+  ResetAccelerationData();
   std::reverse(&vertices_[0], &vertices_[num_vertices_]);
 }
 
 S2LatLngRect S2Polyline::GetRectBound() const {
   S2LatLngRectBounder bounder;
-  for (int i = 0; i < num_vertices(); ++i) {
-    bounder.AddPoint(vertex(i));
-  }
+  bounder.AddPoints(S2PointSpan(&vertices_[0], num_vertices_));
   return bounder.GetBound();
 }
 
@@ -330,14 +433,14 @@ bool S2Polyline::MayIntersect(const S2Cell& cell) const {
   for (int i = 0; i < 4; ++i) {
     cell_vertices[i] = cell.GetVertex(i);
   }
+  vector<int8> signs(num_vertices());
   for (int j = 0; j < 4; ++j) {
-    S2EdgeCrosser crosser(&cell_vertices[j], &cell_vertices[(j+1)&3],
-                                    &vertex(0));
-    for (int i = 1; i < num_vertices(); ++i) {
-      if (crosser.CrossingSign(&vertex(i)) >= 0) {
-        // There is a proper crossing, or two vertices were the same.
-        return true;
-      }
+    S2EdgeCrosser crosser(&cell_vertices[j], &cell_vertices[(j+1)&3]);
+    crosser.ChainCrossingSigns(S2PointSpan(&vertex(0), num_vertices()),
+                               signs.data());
+    for (int i = 0; i < num_vertices() - 1; ++i) {
+      // There is a proper crossing, or two vertices were the same.
+      if (signs[i] >= 0) return true;
     }
   }
   return false;
@@ -358,6 +461,7 @@ bool S2Polyline::Decode(Decoder* const decoder) {
   unsigned char version = decoder->get8();
   if (version > kCurrentLosslessEncodingVersionNumber) return false;
 
+  ResetAccelerationData();
   num_vertices_ = decoder->get32();
   vertices_.reset(new S2Point[num_vertices_]);
   if (decoder->avail() < num_vertices_ * sizeof(vertices_[0])) return false;
@@ -369,6 +473,14 @@ bool S2Polyline::Decode(Decoder* const decoder) {
   return true;
 }
 
+bool S2Polyline::DecodeTrusted(Decoder* const decoder) {
+  S2Debug s2debug_override = s2debug_override_;
+  s2debug_override_ = S2Debug::DISABLE;
+  bool success = Decode(decoder);
+  s2debug_override_ = s2debug_override;
+  return success;
+}
+
 namespace {
 
 // Given a polyline, a tolerance distance, and a start index, this function
@@ -487,7 +599,14 @@ bool S2Polyline::ApproxEquals(const S2Polyline& b, S1Angle max_error) const {
 }
 
 size_t S2Polyline::SpaceUsed() const {
-  return sizeof(*this) + num_vertices() * sizeof(S2Point);
+  size_t size = sizeof(*this) + num_vertices() * sizeof(S2Point);
+  const AccelerationData* data =
+      acceleration_data_.load(std::memory_order_acquire);
+  if (data != nullptr) {
+    size += sizeof(*data) + data->index.SpaceUsed() - sizeof(data->index) +
+            data->cumulative_lengths.capacity() * sizeof(S1Angle);
+  }
+  return size;
 }
 
 namespace {
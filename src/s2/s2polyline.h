@@ -18,6 +18,7 @@
 #ifndef S2_S2POLYLINE_H_
 #define S2_S2POLYLINE_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -116,7 +117,8 @@ class S2Polyline final : public S2Region {
     return vertices_[k];
   }
 
-  // Return the length of the polyline.
+  // Return the length of the polyline.  This takes constant time if the
+  // internal index described under Project() has been built.
   S1Angle GetLength() const;
 
   // Return the true centroid of the polyline multiplied by the length of the
@@ -129,8 +131,9 @@ class S2Polyline final : public S2Region {
 
   // Return the point whose distance from vertex 0 along the polyline is the
   // given fraction of the polyline's total length.  Fractions less than zero
-  // or greater than one are clamped.  The return value is unit length.  This
-  // cost of this function is currently linear in the number of vertices.
+  // or greater than one are clamped.  The return value is unit length.  The
+  // cost of this function is linear in the number of vertices for short
+  // polylines, and logarithmic for long polylines (see Project() below).
   // The polyline must not be empty.
   S2Point Interpolate(double fraction) const;
 
@@ -167,6 +170,12 @@ class S2Polyline final : public S2Region {
   // here w.r.t. the projected point as opposed to the interpolated point in
   // GetSuffix().
   //
+  // For polylines with many vertices, the first call to Project(),
+  // GetSuffix(), Interpolate() or UnInterpolate() builds an internal index
+  // (the cumulative edge lengths and an S2ShapeIndex of the edges) so that
+  // later calls take logarithmic rather than linear time.  The index is
+  // built in a thread-safe way and is discarded when the vertices change.
+  //
   // The polyline must be non-empty.
   S2Point Project(const S2Point& point, int* next_vertex) const;
 
@@ -183,9 +192,11 @@ class S2Polyline final : public S2Region {
   // polyline endpoint is the only intersection with the other polyline, the
   // function may return true or false arbitrarily.
   //
-  // The running time is quadratic in the number of vertices.  (To intersect
-  // polylines more efficiently, or compute the actual intersection geometry,
-  // use S2BooleanOperation.)
+  // When both polylines are long, the edges of the shorter polyline are
+  // tested against a lazily built S2ShapeIndex of the longer one (the same
+  // index used by Project()), so the running time is roughly linear.
+  // Otherwise all pairs of edges are tested.  (To compute the actual
+  // intersection geometry, use S2BooleanOperation.)
   bool Intersects(const S2Polyline* line) const;
 
   // Reverse the order of the polyline vertices.
@@ -270,6 +281,12 @@ class S2Polyline final : public S2Region {
   // Decodes an S2Polyline encoded with Encode().  Returns true on success.
   bool Decode(Decoder* const decoder);
 
+  // Like Decode(), except that the encoded data is trusted to have been
+  // produced by Encode() from a valid polyline.  The polyline is not
+  // validated (even when --s2debug is enabled).  Returns false only if the
+  // data is truncated or otherwise cannot be parsed.
+  bool DecodeTrusted(Decoder* const decoder);
+
 #ifndef SWIG
   // Wrapper class for indexing a polyline (see S2ShapeIndex).  Once this
   // object is inserted into an S2ShapeIndex it is owned by that index, and
@@ -322,6 +339,12 @@ class S2Polyline final : public S2Region {
     ChainPosition chain_position(int e) const final {
       return ChainPosition(0, e);
     }
+    bool GetChainVertices(int i, S2PointSpan* vertices) const final {
+      S2_DCHECK_EQ(i, 0);
+      *vertices = S2PointSpan(&polyline_->vertex(0),
+                              polyline_->num_vertices());
+      return true;
+    }
     TypeTag type_tag() const override { return kTypeTag; }
 
    private:
@@ -369,6 +392,14 @@ class S2Polyline final : public S2Region {
   int num_vertices_ = 0;
   std::unique_ptr<S2Point[]> vertices_;
 
+  // Lazily built data that speeds up GetSuffix(), UnInterpolate() and
+  // Project() for polylines with many vertices.  Returns nullptr if the
+  // polyline is too short for the index to be worthwhile.
+  struct AccelerationData;
+  const AccelerationData* GetAccelerationData() const;
+  void ResetAccelerationData();
+  mutable std::atomic<AccelerationData*> acceleration_data_{nullptr};
+
 #ifndef SWIG
   void operator=(const S2Polyline&) = delete;
 #endif  // SWIG
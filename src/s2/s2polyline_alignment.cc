@@ -18,6 +18,7 @@
 #include "s2/s2polyline_alignment_internal.h"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -27,6 +28,7 @@
 #include "s2/base/logging.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/util/math/mathutil.h"
+#include "s2/util/thread/executor.h"
 
 namespace s2polyline_alignment {
 
@@ -139,18 +141,6 @@ bool Window::IsValid() const {
   return true;
 }
 
-inline double BoundsCheckedTableCost(const int row, const int col,
-                                     const ColumnStride& stride,
-                                     const CostTable& table) {
-  if (row < 0 && col < 0) {
-    return 0.0;
-  } else if (row < 0 || col < 0 || !stride.InRange(col)) {
-    return DOUBLE_MAX;
-  } else {
-    return table[row][col];
-  }
-}
-
 // Perform dynamic timewarping by filling in the DP table on cells that are
 // inside our search window. For an exact (all-squares) evaluation, this
 // incurs bounds checking overhead - we don't need to ensure that we're inside
@@ -173,22 +163,51 @@ inline double BoundsCheckedTableCost(const int row, const int col,
 //
 // This method takes time proportional to the number of cells in the window,
 // which can range from O(max(a, b)) cells (best) to O(a*b) cells (worst)
+//
+// If `workspace` is not nullptr, its storage is reused for the cost table,
+// which only stores the cells inside the window.
 VertexAlignment DynamicTimewarp(const S2Polyline& a, const S2Polyline& b,
-                                const Window& w) {
+                                const Window& w,
+                                AlignmentWorkspace* workspace) {
+  AlignmentWorkspace local_workspace;
+  if (workspace == nullptr) workspace = &local_workspace;
   const int rows = a.num_vertices();
   const int cols = b.num_vertices();
-  auto costs = CostTable(rows, std::vector<double>(cols));
+
+  // Only the cells inside the window are stored, so that the table takes
+  // space proportional to the number of cells in the window.
+  std::vector<int>& offsets = workspace->row_offsets_;
+  offsets.resize(rows);
+  int num_cells = 0;
+  for (int row = 0; row < rows; ++row) {
+    ColumnStride stride = w.GetColumnStride(row);
+    offsets[row] = num_cells - stride.start;
+    num_cells += stride.end - stride.start;
+  }
+  std::vector<double>& costs = workspace->costs_;
+  costs.resize(num_cells);
+  auto table_cost = [&](const int row, const int col,
+                        const ColumnStride& stride) {
+    if (row < 0 && col < 0) {
+      return 0.0;
+    } else if (row < 0 || col < 0 || !stride.InRange(col)) {
+      return DOUBLE_MAX;
+    } else {
+      return costs[offsets[row] + col];
+    }
+  };
 
   ColumnStride curr;
   ColumnStride prev = ColumnStride::All();
   for (int row = 0; row < rows; ++row) {
     curr = w.GetColumnStride(row);
+    const S2Point& a_vertex = a.vertex(row);
     for (int col = curr.start; col < curr.end; ++col) {
-      double d_cost = BoundsCheckedTableCost(row - 1, col - 1, prev, costs);
-      double u_cost = BoundsCheckedTableCost(row - 1, col - 0, prev, costs);
-      double l_cost = BoundsCheckedTableCost(row - 0, col - 1, curr, costs);
-      costs[row][col] = std::min({d_cost, u_cost, l_cost}) +
-                        (a.vertex(row) - b.vertex(col)).Norm2();
+      double d_cost = table_cost(row - 1, col - 1, prev);
+      double u_cost = table_cost(row - 1, col - 0, prev);
+      double l_cost = table_cost(row - 0, col - 1, curr);
+      costs[offsets[row] + col] = std::min({d_cost, u_cost, l_cost}) +
+                                  (a_vertex - b.vertex(col)).Norm2();
     }
     prev = curr;
   }
@@ -210,9 +229,9 @@ VertexAlignment DynamicTimewarp(const S2Polyline& a, const S2Polyline& b,
   prev = w.GetCheckedColumnStride(row - 1);
   while (row >= 0 && col >= 0) {
     warp_path.push_back({row, col});
-    double d_cost = BoundsCheckedTableCost(row - 1, col - 1, prev, costs);
-    double u_cost = BoundsCheckedTableCost(row - 1, col - 0, prev, costs);
-    double l_cost = BoundsCheckedTableCost(row - 0, col - 1, curr, costs);
+    double d_cost = table_cost(row - 1, col - 1, prev);
+    double u_cost = table_cost(row - 1, col - 0, prev);
+    double l_cost = table_cost(row - 0, col - 1, curr);
     if (d_cost <= u_cost && d_cost <= l_cost) {
       row -= 1;
       col -= 1;
@@ -227,7 +246,7 @@ VertexAlignment DynamicTimewarp(const S2Polyline& a, const S2Polyline& b,
     }
   }
   std::reverse(warp_path.begin(), warp_path.end());
-  return VertexAlignment(costs.back().back(), warp_path);
+  return VertexAlignment(costs.back(), warp_path);
 }
 
 std::unique_ptr<S2Polyline> HalfResolution(const S2Polyline& in) {
@@ -253,37 +272,156 @@ VertexAlignment AlignmentFn(const S2Polyline& a, const S2Polyline& b,
                 : GetExactVertexAlignment(a, b);
 }
 
+// Computes the medoid by accumulating the total cost of each candidate
+// separately (concurrently when "executor" is not nullptr), abandoning a
+// candidate as soon as its partial cost exceeds the best total found so far.
+// Candidates whose partial cost merely equals the best are completed, so the
+// result is the lowest-index candidate with the minimum total cost no matter
+// how the candidates are scheduled.
+int GetMedoidPolylineWithEarlyTermination(
+    const std::vector<std::unique_ptr<S2Polyline>>& polylines,
+    const bool approx, Executor* executor) {
+  const int num_polylines = polylines.size();
+  std::atomic<double> best_cost(DOUBLE_MAX);
+  std::vector<double> costs(num_polylines, DOUBLE_MAX);
+  ParallelFor(executor, num_polylines, [&](int i) {
+      double cost = 0;
+      for (int j = 0; j < num_polylines; ++j) {
+        if (j == i) continue;
+        cost += CostFn(*polylines[i], *polylines[j], approx);
+        if (cost > best_cost.load(std::memory_order_relaxed)) return;
+      }
+      costs[i] = cost;
+      double best = best_cost.load();
+      while (cost < best && !best_cost.compare_exchange_weak(best, cost)) {}
+    });
+  return std::min_element(costs.begin(), costs.end()) - costs.begin();
+}
+
 // PUBLIC API IMPLEMENTATION DETAILS
 
+size_t AlignmentWorkspace::SpaceUsed() const {
+  return (sizeof(*this) + costs_.capacity() * sizeof(double) +
+          row_offsets_.capacity() * sizeof(int) +
+          coords_.capacity() * sizeof(double) +
+          diagonals_.capacity() * sizeof(double));
+}
+
 // This is the constant-space implementation of Dynamic Timewarp that can
 // compute the alignment cost, but not the warp path.
 double GetExactVertexAlignmentCost(const S2Polyline& a, const S2Polyline& b) {
+  AlignmentWorkspace workspace;
+  return GetExactVertexAlignmentCost(a, b, &workspace);
+}
+
+// The cost table is filled in one anti-diagonal (row + col == k) at a time.
+// Each cell depends only on the previous two anti-diagonals, so the cells of
+// an anti-diagonal can be computed independently.  The vertices of "b" are
+// stored in reverse order so that both polylines are accessed sequentially
+// as the row increases along an anti-diagonal, which allows the inner loop
+// to be vectorized.
+double GetExactVertexAlignmentCost(const S2Polyline& a, const S2Polyline& b,
+                                   AlignmentWorkspace* workspace) {
   const int a_n = a.num_vertices();
   const int b_n = b.num_vertices();
   S2_CHECK(a_n > 0) << "A is empty polyline.";
   S2_CHECK(b_n > 0) << "B is empty polyline.";
-  std::vector<double> cost(b_n, DOUBLE_MAX);
-  double left_diag_min_cost = 0;
-  for (int row = 0; row < a_n; ++row) {
-    for (int col = 0; col < b_n; ++col) {
-      double up_cost = cost[col];
-      cost[col] = std::min(left_diag_min_cost, up_cost) +
-                  (a.vertex(row) - b.vertex(col)).Norm2();
-      left_diag_min_cost = std::min(cost[col], up_cost);
+
+  std::vector<double>& coords = workspace->coords_;
+  coords.resize(3 * (a_n + b_n));
+  double* ax = coords.data();
+  double* ay = ax + a_n;
+  double* az = ay + a_n;
+  double* bx = az + a_n;
+  double* by = bx + b_n;
+  double* bz = by + b_n;
+  for (int i = 0; i < a_n; ++i) {
+    const S2Point& p = a.vertex(i);
+    ax[i] = p.x();
+    ay[i] = p.y();
+    az[i] = p.z();
+  }
+  for (int j = 0; j < b_n; ++j) {
+    const S2Point& p = b.vertex(b_n - 1 - j);
+    bx[j] = p.x();
+    by[j] = p.y();
+    bz[j] = p.z();
+  }
+
+  // Each anti-diagonal is indexed by row + 1, so that index 0 (row -1) and
+  // the entries just outside the range of valid rows act as sentinels
+  // containing DOUBLE_MAX.
+  const int stride = a_n + 2;
+  std::vector<double>& diagonals = workspace->diagonals_;
+  diagonals.assign(3 * stride, DOUBLE_MAX);
+  double* prev2 = diagonals.data();
+  double* prev1 = prev2 + stride;
+  double* curr = prev1 + stride;
+  prev2[0] = 0;  // The predecessor of cell (0, 0).
+  for (int k = 0; k < a_n + b_n - 1; ++k) {
+    const int lo = std::max(0, k - (b_n - 1));
+    const int hi = std::min(a_n - 1, k);
+    // With b reversed, column (k - row) is at index (b_n - 1 - k + row).
+    const int b_offset = b_n - 1 - k;
+    for (int row = lo; row <= hi; ++row) {
+      double dx = ax[row] - bx[b_offset + row];
+      double dy = ay[row] - by[b_offset + row];
+      double dz = az[row] - bz[b_offset + row];
+      // prev2[row] is cell (row - 1, col - 1), prev1[row] is (row - 1, col),
+      // and prev1[row + 1] is (row, col - 1).
+      double min_cost = std::min(prev2[row], std::min(prev1[row],
+                                                      prev1[row + 1]));
+      curr[row + 1] = min_cost + (dx * dx + dy * dy + dz * dz);
     }
-    left_diag_min_cost = DOUBLE_MAX;
+    curr[lo] = DOUBLE_MAX;
+    curr[hi + 2] = DOUBLE_MAX;
+    double* tmp = prev2;
+    prev2 = prev1;
+    prev1 = curr;
+    curr = tmp;
   }
-  return cost.back();
+  return prev1[a_n];
 }
 
 VertexAlignment GetExactVertexAlignment(const S2Polyline& a,
                                         const S2Polyline& b) {
+  return GetExactVertexAlignment(a, b, nullptr);
+}
+
+VertexAlignment GetExactVertexAlignment(const S2Polyline& a,
+                                        const S2Polyline& b,
+                                        AlignmentWorkspace* workspace) {
   const int a_n = a.num_vertices();
   const int b_n = b.num_vertices();
   S2_CHECK(a_n > 0) << "A is empty polyline.";
   S2_CHECK(b_n > 0) << "B is empty polyline.";
   const auto w = Window(std::vector<ColumnStride>(a_n, {0, b_n}));
-  return DynamicTimewarp(a, b, w);
+  return DynamicTimewarp(a, b, w, workspace);
+}
+
+VertexAlignment GetBandedVertexAlignment(const S2Polyline& a,
+                                         const S2Polyline& b,
+                                         const int band_radius,
+                                         AlignmentWorkspace* workspace) {
+  const int a_n = a.num_vertices();
+  const int b_n = b.num_vertices();
+  S2_CHECK(a_n > 0) << "A is empty polyline.";
+  S2_CHECK(b_n > 0) << "B is empty polyline.";
+  S2_CHECK(band_radius >= 0) << "Band radius is negative.";
+
+  // Row "row" of the window extends from the diagonal at this row to the
+  // diagonal at the next row, dilated by "band_radius".  This ensures that
+  // consecutive strides overlap, so that a warp path always exists.
+  const double slope =
+      (a_n == 1) ? 0 : static_cast<double>(b_n - 1) / (a_n - 1);
+  std::vector<ColumnStride> strides(a_n);
+  for (int row = 0; row < a_n; ++row) {
+    int start = static_cast<int>(row * slope) - band_radius;
+    int end = (row == a_n - 1) ? b_n :
+              static_cast<int>((row + 1) * slope) + band_radius + 1;
+    strides[row] = {std::max(0, start), std::min(end, b_n)};
+  }
+  return DynamicTimewarp(a, b, Window(strides), workspace);
 }
 
 VertexAlignment GetApproxVertexAlignment(const S2Polyline& a,
@@ -319,7 +457,7 @@ VertexAlignment GetApproxVertexAlignment(const S2Polyline& a,
   const auto b_half = HalfResolution(b);
   const auto proj = GetApproxVertexAlignment(*a_half, *b_half, radius);
   const auto w = Window(proj.warp_path).Upsample(a_n, b_n).Dilate(radius);
-  return DynamicTimewarp(a, b, w);
+  return DynamicTimewarp(a, b, w, nullptr);
 }
 
 // This method calls the approx method with a reasonable default for radius.
@@ -339,6 +477,10 @@ int GetMedoidPolyline(const std::vector<std::unique_ptr<S2Polyline>>& polylines,
   const int num_polylines = polylines.size();
   const bool approx = options.approx();
   S2_CHECK_GT(num_polylines, 0);
+  if (options.executor() != nullptr) {
+    return GetMedoidPolylineWithEarlyTermination(polylines, approx,
+                                                 options.executor());
+  }
 
   // costs[i] stores total cost of aligning [i] with all other polylines.
   std::vector<double> costs(num_polylines, 0.0);
@@ -384,6 +526,7 @@ std::unique_ptr<S2Polyline> GetConsensusPolyline(
   if (options.seed_medoid()) {
     MedoidOptions medoid_options;
     medoid_options.set_approx(approx);
+    medoid_options.set_executor(options.executor());
     seed_index = GetMedoidPolyline(polylines, medoid_options);
   }
   auto consensus = std::unique_ptr<S2Polyline>(polylines[seed_index]->Clone());
@@ -393,11 +536,17 @@ std::unique_ptr<S2Polyline> GetConsensusPolyline(
   bool converged = false;
   int iterations = 0;
   while (!converged && iterations < options.iteration_cap()) {
+    // The alignments are independent, but they are accumulated in order so
+    // that the result does not depend on whether an executor is used.
+    std::vector<WarpPath> warp_paths(num_polylines);
+    ParallelFor(options.executor(), num_polylines, [&](int i) {
+        warp_paths[i] =
+            AlignmentFn(*consensus, *polylines[i], approx).warp_path;
+      });
     std::vector<S2Point> points(num_consensus_vertices, S2Point());
-    for (const auto& polyline : polylines) {
-      const auto alignment = AlignmentFn(*consensus, *polyline, approx);
-      for (const auto& pair : alignment.warp_path) {
-        points[pair.first] += polyline->vertex(pair.second);
+    for (int i = 0; i < num_polylines; ++i) {
+      for (const auto& pair : warp_paths[i]) {
+        points[pair.first] += polylines[i]->vertex(pair.second);
       }
     }
     for (S2Point& p : points) {
@@ -22,6 +22,8 @@
 
 #include "s2/s2polyline.h"
 
+class Executor;
+
 // This library provides code to compute vertex alignments between S2Polylines.
 //
 // A vertex "alignment" or "warp" between two polylines is a matching between
@@ -93,6 +95,40 @@ namespace s2polyline_alignment {
 
 typedef std::vector<std::pair<int, int>> WarpPath;
 
+class Window;
+struct VertexAlignment;
+
+// AlignmentWorkspace holds the temporary storage used to compute vertex
+// alignments (most importantly the dynamic programming cost table).  Passing
+// the same workspace to repeated alignment calls avoids reallocating this
+// storage each time.  A workspace may be used for any number of calls, but
+// not by more than one thread at a time.
+class AlignmentWorkspace {
+ public:
+  AlignmentWorkspace() = default;
+
+  // Returns the number of bytes of storage currently allocated.
+  size_t SpaceUsed() const;
+
+ private:
+  friend VertexAlignment DynamicTimewarp(const S2Polyline& a,
+                                         const S2Polyline& b, const Window& w,
+                                         AlignmentWorkspace* workspace);
+  friend double GetExactVertexAlignmentCost(const S2Polyline& a,
+                                            const S2Polyline& b,
+                                            AlignmentWorkspace* workspace);
+
+  // The cost table, stored row by row.  Only the cells inside the search
+  // window are stored.
+  std::vector<double> costs_;
+  // costs_[row_offsets_[row] + col] is the cost of cell (row, col).
+  std::vector<int> row_offsets_;
+  // The coordinates of both polylines, and three anti-diagonals of the cost
+  // table (see GetExactVertexAlignmentCost).
+  std::vector<double> coords_;
+  std::vector<double> diagonals_;
+};
+
 struct VertexAlignment {
   // `alignment_cost` represents the sum of the squared chordal distances
   // between each pair of vertices in the warp path. Specifically,
@@ -134,6 +170,30 @@ VertexAlignment GetExactVertexAlignment(const S2Polyline& a,
 // O(max(A,B)). This method provides that space-efficiency optimization.
 double GetExactVertexAlignmentCost(const S2Polyline& a, const S2Polyline& b);
 
+// Like the functions above, but uses the given workspace for temporary
+// storage.  The cost is computed by processing the cost table one
+// anti-diagonal at a time; the cells of an anti-diagonal do not depend on
+// each other, which allows the compiler to vectorize the inner loop.
+VertexAlignment GetExactVertexAlignment(const S2Polyline& a,
+                                        const S2Polyline& b,
+                                        AlignmentWorkspace* workspace);
+double GetExactVertexAlignmentCost(const S2Polyline& a, const S2Polyline& b,
+                                   AlignmentWorkspace* workspace);
+
+// GetBandedVertexAlignment computes the optimal vertex alignment subject to
+// a Sakoe-Chiba band constraint: vertex a.vertex(i) may only be paired with
+// vertices b.vertex(j) that are within `band_radius` positions of the
+// diagonal of the cost table (i.e., j is within `band_radius` of
+// i * (B - 1) / (A - 1), widened as necessary so that a warp path exists).
+// This is a common constraint for trajectory matching, since it prevents
+// pathological alignments and reduces the time and space complexity to
+// O(max(A, B) * band_radius).  The result is exact when `band_radius` is at
+// least max(A, B).  If `workspace` is not nullptr, it is used for temporary
+// storage.
+VertexAlignment GetBandedVertexAlignment(
+    const S2Polyline& a, const S2Polyline& b, const int band_radius,
+    AlignmentWorkspace* workspace = nullptr);
+
 // GetApproxVertexAlignment takes two non-empty polylines `a` and `b` as input,
 // and a `radius` paramater GetApproxVertexAlignment (quickly) computes an
 // approximately optimal vertex alignment of points between polylines `a` and
@@ -178,8 +238,23 @@ class MedoidOptions {
   bool approx() const { return approx_; }
   void set_approx(bool approx) { approx_ = approx; }
 
+  // If options.executor() is not nullptr, the total alignment cost of each
+  // candidate polyline is computed concurrently using the given executor.
+  // Each candidate's cost is accumulated separately, and the computation for
+  // a candidate stops as soon as its partial cost exceeds the lowest total
+  // cost found so far.  This evaluates each pair of polylines up to twice
+  // (rather than once), but early termination usually skips most of the
+  // work.  The result does not depend on the executor or on thread
+  // scheduling; however since each pair may be evaluated in either order,
+  // it may differ from the serial result when two candidates have costs
+  // that are equal to within rounding error (this can only happen when
+  // approx() is true).
+  Executor* executor() const { return executor_; }
+  void set_executor(Executor* executor) { executor_ = executor; }
+
  private:
   bool approx_ = true;
+  Executor* executor_ = nullptr;
 };
 
 int GetMedoidPolyline(const std::vector<std::unique_ptr<S2Polyline>>& polylines,
@@ -232,10 +307,18 @@ class ConsensusOptions {
   int iteration_cap() const { return iteration_cap_; }
   void set_iteration_cap(int iteration_cap) { iteration_cap_ = iteration_cap; }
 
+  // If options.executor() is not nullptr, the alignments of each iteration
+  // (and the medoid computation, if seed_medoid() is true) are computed
+  // concurrently using the given executor.  The result is the same as
+  // without an executor, except as noted for MedoidOptions::executor().
+  Executor* executor() const { return executor_; }
+  void set_executor(Executor* executor) { executor_ = executor; }
+
  private:
   bool approx_ = true;
   bool seed_medoid_ = false;
   int iteration_cap_ = 5;
+  Executor* executor_ = nullptr;
 };
 
 std::unique_ptr<S2Polyline> GetConsensusPolyline(
@@ -16,10 +16,13 @@
 #include "s2/s2polyline_alignment.h"
 #include "s2/s2polyline_alignment_internal.h"
 
+#include <functional>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 
+#include "s2/base/mutex.h"
 #include "s2/base/stringprintf.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/strings/str_cat.h"
@@ -27,6 +30,7 @@
 #include "s2/s2loop.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 namespace s2polyline_alignment {
 
@@ -459,6 +463,69 @@ TEST(S2PolylineAlignmentTest, FuzzedWithBruteForce) {
   }
 }
 
+// The anti-diagonal kernel used with a workspace should produce exactly the
+// same costs as the row-by-row cost table.
+TEST(S2PolylineAlignmentTest, WorkspaceMatchesExact) {
+  AlignmentWorkspace workspace;
+  for (int num_vertices : {1, 2, 7, 50}) {
+    const auto lines = GenPolylines(4, num_vertices, 1.5);
+    const auto other = GenPolylines(1, 2 * num_vertices + 1, 1.5);
+    for (const auto& line : lines) {
+      const VertexAlignment exact = GetExactVertexAlignment(*line, *other[0]);
+      EXPECT_EQ(exact.alignment_cost,
+                GetExactVertexAlignmentCost(*line, *other[0], &workspace));
+      EXPECT_EQ(exact.alignment_cost,
+                GetExactVertexAlignmentCost(*other[0], *line, &workspace));
+      const VertexAlignment reused =
+          GetExactVertexAlignment(*line, *other[0], &workspace);
+      EXPECT_EQ(exact.alignment_cost, reused.alignment_cost);
+      EXPECT_EQ(exact.warp_path, reused.warp_path);
+    }
+  }
+  EXPECT_GT(workspace.SpaceUsed(), 0);
+}
+
+TEST(S2PolylineAlignmentTest, BandedAlignment) {
+  const auto a = GenPolylines(1, 40, 1.5);
+  const auto b = GenPolylines(1, 25, 1.5);
+  const VertexAlignment exact = GetExactVertexAlignment(*a[0], *b[0]);
+
+  // A band that covers the whole table gives the exact result.
+  const VertexAlignment wide = GetBandedVertexAlignment(*a[0], *b[0], 40);
+  EXPECT_EQ(exact.alignment_cost, wide.alignment_cost);
+  EXPECT_EQ(exact.warp_path, wide.warp_path);
+
+  // Narrower bands give valid warp paths whose cost is an upper bound, and
+  // all pairs are within the band.
+  AlignmentWorkspace workspace;
+  const double slope = 24.0 / 39.0;
+  for (int radius = 0; radius < 5; ++radius) {
+    const VertexAlignment banded =
+        GetBandedVertexAlignment(*a[0], *b[0], radius, &workspace);
+    EXPECT_GE(banded.alignment_cost, exact.alignment_cost);
+    EXPECT_EQ(std::make_pair(0, 0), banded.warp_path.front());
+    EXPECT_EQ(std::make_pair(39, 24), banded.warp_path.back());
+    double cost = 0;
+    for (const auto& pair : banded.warp_path) {
+      cost += (a[0]->vertex(pair.first) - b[0]->vertex(pair.second)).Norm2();
+      EXPECT_LE(std::fabs(pair.second - pair.first * slope), radius + 1);
+    }
+    EXPECT_FLOAT_EQ(cost, banded.alignment_cost);
+  }
+}
+
+// A band of radius zero still allows a path when one polyline is much longer.
+TEST(S2PolylineAlignmentTest, BandedAlignmentSteepSlope) {
+  const auto a = s2textformat::MakePolylineOrDie("0:0, 0:10");
+  const auto b = s2textformat::MakePolylineOrDie(
+      "0:0, 0:1, 0:2, 0:3, 0:4, 0:5, 0:6, 0:7, 0:8, 0:9, 0:10");
+  const VertexAlignment banded = GetBandedVertexAlignment(*a, *b, 0);
+  EXPECT_EQ(11, banded.warp_path.size());
+  EXPECT_EQ(std::make_pair(1, 10), banded.warp_path.back());
+  EXPECT_GE(banded.alignment_cost,
+            GetExactVertexAlignment(*a, *b).alignment_cost);
+}
+
 // TESTS FOR TRAJECTORY CONSENSUS ALGORITHMS
 
 // Tests for GetMedoidPolyline
@@ -607,4 +674,44 @@ TEST(S2PolylineAlignmentTest, ConsensusPolylineOverlappingPolylines) {
   EXPECT_TRUE(result->ApproxEquals(*expected));
 }
 
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+TEST(S2PolylineAlignmentTest, MedoidPolylineWithExecutor) {
+  ThreadPerTaskExecutor executor;
+  for (int iter = 0; iter < 5; ++iter) {
+    const auto polylines = GenPolylines(12 + iter, 30, 1.5);
+    MedoidOptions options;
+    options.set_approx(false);
+    const int serial = GetMedoidPolyline(polylines, options);
+    options.set_executor(&executor);
+    EXPECT_EQ(serial, GetMedoidPolyline(polylines, options));
+  }
+}
+
+TEST(S2PolylineAlignmentTest, ConsensusPolylineWithExecutor) {
+  ThreadPerTaskExecutor executor;
+  const auto polylines = GenPolylines(10, 40, 1.5);
+  ConsensusOptions options;
+  options.set_seed_medoid(true);
+  const auto serial = GetConsensusPolyline(polylines, options);
+  options.set_executor(&executor);
+  const auto parallel = GetConsensusPolyline(polylines, options);
+  EXPECT_TRUE(serial->Equals(parallel.get()));
+}
+
 }  // namespace s2polyline_alignment
@@ -17,9 +17,15 @@
 
 #include "s2/s2polyline_measures.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
+
 #include "s2/base/logging.h"
 #include "s2/s2centroids.h"
+#include "s2/s2edge_distances.h"
+
+using std::vector;
 
 namespace S2 {
 
@@ -39,4 +45,44 @@ S2Point GetCentroid(S2PointSpan polyline) {
   return centroid;
 }
 
+vector<S1Angle> GetCumulativeLengths(S2PointSpan polyline) {
+  vector<S1Angle> result;
+  if (polyline.empty()) return result;
+  result.reserve(polyline.size());
+  S1Angle length;
+  result.push_back(length);
+  for (int i = 1; i < polyline.size(); ++i) {
+    length += S1Angle(polyline[i - 1], polyline[i]);
+    result.push_back(length);
+  }
+  return result;
+}
+
+S2Point InterpolateAtLength(S2PointSpan polyline,
+                            const vector<S1Angle>& cumulative_lengths,
+                            S1Angle length, int* next_vertex) {
+  S2_DCHECK_GT(polyline.size(), 0);
+  S2_DCHECK_EQ(polyline.size(), cumulative_lengths.size());
+  if (length <= S1Angle::Zero()) {
+    *next_vertex = 1;
+    return polyline[0];
+  }
+  // Find the first vertex whose distance along the polyline exceeds the
+  // target distance.
+  int i = std::upper_bound(cumulative_lengths.begin() + 1,
+                           cumulative_lengths.end(), length) -
+          cumulative_lengths.begin();
+  if (i == polyline.size()) {
+    *next_vertex = i;
+    return polyline[i - 1];
+  }
+  // This interpolates with respect to arc length rather than straight-line
+  // distance, and produces a unit-length result.
+  S2Point result = S2::InterpolateAtDistance(length - cumulative_lengths[i - 1],
+                                             polyline[i - 1], polyline[i]);
+  // It is possible that (result == polyline[i]) due to rounding errors.
+  *next_vertex = (result == polyline[i]) ? (i + 1) : i;
+  return result;
+}
+
 }  // namespace S2
@@ -26,6 +26,8 @@
 #ifndef S2_S2POLYLINE_MEASURES_H_
 #define S2_S2POLYLINE_MEASURES_H_
 
+#include <vector>
+
 #include "s2/s1angle.h"
 #include "s2/s2point.h"
 #include "s2/s2point_span.h"
@@ -48,6 +50,26 @@ S1Angle GetLength(S2PointSpan polyline);
 // the polyline, whose value is always zero if the polyline is degenerate.]
 S2Point GetCentroid(S2PointSpan polyline);
 
+// Returns a table whose ith entry is the length of the polyline from vertex
+// 0 to vertex i (so the first entry is zero and the last entry is the
+// length of the polyline).  Returns an empty table for empty polylines.
+//
+// The table can be passed to InterpolateAtLength() to find the point at a
+// given distance along the polyline in O(log n) time, which is useful when
+// the same polyline is interpolated many times.
+std::vector<S1Angle> GetCumulativeLengths(S2PointSpan polyline);
+
+// Returns the point at the given distance along the polyline from vertex 0,
+// where "cumulative_lengths" is the result of GetCumulativeLengths().
+// Distances less than zero or greater than the polyline length are clamped.
+// Also sets "next_vertex" to the index of the next polyline vertex after
+// the returned point, with the same meaning as in S2Polyline::GetSuffix().
+//
+// REQUIRES: polyline.size() > 0
+S2Point InterpolateAtLength(S2PointSpan polyline,
+                            const std::vector<S1Angle>& cumulative_lengths,
+                            S1Angle length, int* next_vertex);
+
 }  // namespace S2
 
 #endif  // S2_S2POLYLINE_MEASURES_H_
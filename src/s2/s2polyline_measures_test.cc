@@ -22,6 +22,8 @@
 
 #include <gtest/gtest.h>
 #include "s2/s1angle.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
 
 using std::fabs;
@@ -54,4 +56,42 @@ TEST(GetLengthAndCentroid, GreatCircles) {
   }
 }
 
+TEST(InterpolateAtLength, MatchesLinearScan) {
+  vector<S2Point> line;
+  for (int i = 0; i < 100; ++i) line.push_back(S2Testing::RandomPoint());
+  line.push_back(line.back());  // A degenerate edge.
+  line.push_back(S2Testing::RandomPoint());
+  vector<S1Angle> lengths = S2::GetCumulativeLengths(line);
+  ASSERT_EQ(line.size(), lengths.size());
+  EXPECT_EQ(S1Angle::Zero(), lengths[0]);
+  EXPECT_EQ(S2::GetLength(line), lengths.back());
+
+  int next_vertex;
+  EXPECT_EQ(line[0], S2::InterpolateAtLength(line, lengths,
+                                             S1Angle::Radians(-1),
+                                             &next_vertex));
+  EXPECT_EQ(1, next_vertex);
+  EXPECT_EQ(line.back(), S2::InterpolateAtLength(line, lengths,
+                                                 2 * lengths.back(),
+                                                 &next_vertex));
+  EXPECT_EQ(line.size(), next_vertex);
+  for (int iter = 0; iter < 100; ++iter) {
+    S1Angle target = S2Testing::rnd.RandDouble() * lengths.back();
+    S1Angle remaining = target;
+    int i = 1;
+    while (remaining >= S1Angle(line[i - 1], line[i])) {
+      remaining -= S1Angle(line[i - 1], line[i]);
+      ++i;
+    }
+    S2Point expected = S2::InterpolateAtDistance(remaining, line[i - 1],
+                                                 line[i]);
+    S2Point actual = S2::InterpolateAtLength(line, lengths, target,
+                                             &next_vertex);
+    EXPECT_TRUE(S2::ApproxEquals(expected, actual, S1Angle::Radians(1e-12)));
+    EXPECT_GE(next_vertex, i);
+    EXPECT_LE(next_vertex, i + 1);
+  }
+  EXPECT_TRUE(S2::GetCumulativeLengths(vector<S2Point>()).empty());
+}
+
 }  // namespace
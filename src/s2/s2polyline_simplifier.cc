@@ -185,3 +185,39 @@ double S2PolylineSimplifier::GetSemiwidth(const S2Point& p, S1ChordAngle r,
   double error = (2 * 10 + 4) * DBL_ERR + 17 * DBL_ERR * semiwidth;
   return semiwidth + round_direction * error;
 }
+
+S2StreamingPolylineSimplifier::S2StreamingPolylineSimplifier(
+    S1ChordAngle max_error) : max_error_(max_error) {
+}
+
+void S2StreamingPolylineSimplifier::AddPoint(const S2Point& p,
+                                             std::vector<S2Point>* output) {
+  if (num_points_ == 0) {
+    output->push_back(p);
+    simplifier_.Init(p);
+  } else {
+    if (p == last_) return;
+    bool ok = simplifier_.Extend(p);
+    if (!ok && last_ != simplifier_.src()) {
+      // The edge from src() can't be extended to "p", so the previous vertex
+      // becomes final.
+      output->push_back(last_);
+      simplifier_.Init(last_);
+      ok = simplifier_.Extend(p);
+    }
+    if (ok) {
+      simplifier_.TargetDisc(p, max_error_);
+    } else {
+      // The edge to "p" is longer than 90 degrees, so "p" is final.
+      output->push_back(p);
+      simplifier_.Init(p);
+    }
+  }
+  last_ = p;
+  ++num_points_;
+}
+
+void S2StreamingPolylineSimplifier::Finish(std::vector<S2Point>* output) {
+  if (num_points_ > 0 && last_ != simplifier_.src()) output->push_back(last_);
+  num_points_ = 0;
+}
@@ -57,9 +57,12 @@
 #ifndef S2_S2POLYLINE_SIMPLIFIER_H_
 #define S2_S2POLYLINE_SIMPLIFIER_H_
 
+#include <vector>
+
 #include "s2/_fp_contract_off.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s1interval.h"
+#include "s2/s2point.h"
 
 class S2PolylineSimplifier {
  public:
@@ -106,4 +109,55 @@ class S2PolylineSimplifier {
   S1Interval window_;
 };
 
+// S2StreamingPolylineSimplifier simplifies a polyline whose vertices arrive
+// one at a time (e.g. a live GPS feed) using the driver loop shown above.
+// Output vertices are appended as soon as they are final, so the memory
+// used does not depend on the length of the input and each point takes
+// O(1) work.  Every input vertex is within "max_error" of the simplified
+// polyline, and the output vertices are a subset of the input vertices
+// (including the first and last ones).
+//
+// Example usage:
+//
+//   S2StreamingPolylineSimplifier simplifier(max_error);
+//   vector<S2Point> output;
+//   for (const S2Point& p : stream) {
+//     simplifier.AddPoint(p, &output);
+//     // "output" now contains all the vertices that are final so far.
+//   }
+//   simplifier.Finish(&output);
+//
+// As with S2PolylineSimplifier, the results are best when the points of
+// each output edge are in increasing order of distance from its source.
+class S2StreamingPolylineSimplifier {
+ public:
+  explicit S2StreamingPolylineSimplifier(S1ChordAngle max_error);
+
+  // Adds the next vertex of the polyline, and appends to "output" any
+  // simplified vertices that have become final.  Consecutive duplicate
+  // vertices are ignored.
+  void AddPoint(const S2Point& p, std::vector<S2Point>* output);
+
+  // Appends the last simplified vertex (if any) to "output", and resets the
+  // simplifier so that it can be used for another polyline.
+  void Finish(std::vector<S2Point>* output);
+
+  // Returns the number of distinct vertices added since the last Finish().
+  int num_points() const { return num_points_; }
+
+ private:
+  S1ChordAngle max_error_;
+  S2PolylineSimplifier simplifier_;
+  S2Point last_;  // The most recent vertex added.
+  int num_points_ = 0;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline S2Point S2PolylineSimplifier::src() const {
+  return src_;
+}
+
 #endif  // S2_S2POLYLINE_SIMPLIFIER_H_
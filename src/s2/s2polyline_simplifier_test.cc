@@ -23,6 +23,7 @@
 #include <gtest/gtest.h>
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -163,3 +164,85 @@ TEST(S2PolylineSimplifier, Precision) {
     EXPECT_EQ(bad_disc < 0, simplifier.Extend(dst));
   }
 }
+
+TEST(S2StreamingPolylineSimplifier, MatchesDriverLoop) {
+  S1ChordAngle max_error(S1Angle::Degrees(0.1));
+  S2StreamingPolylineSimplifier streaming(max_error);
+  for (int iter = 0; iter < 20; ++iter) {
+    // A random walk with small steps towards a fixed heading, so that many
+    // vertices are removed and the vertices of each output edge are in
+    // increasing order of distance from its source.
+    std::vector<S2Point> v = {S2Testing::RandomPoint()};
+    S2Point heading = S2Testing::RandomPoint();
+    for (int i = 1; i < 200; ++i) {
+      S2Point target = S2Testing::SamplePoint(
+          S2Cap(heading, S1Angle::Degrees(20)));
+      v.push_back(S2::InterpolateAtDistance(S1Angle::Degrees(0.05),
+                                            v.back(), target));
+    }
+    // The driver loop from s2polyline_simplifier.h.
+    std::vector<S2Point> expected = {v[0]};
+    S2PolylineSimplifier simplifier;
+    simplifier.Init(v[0]);
+    for (int i = 1; i < v.size(); ++i) {
+      if (!simplifier.Extend(v[i])) {
+        expected.push_back(v[i - 1]);
+        simplifier.Init(v[i - 1]);
+      }
+      simplifier.TargetDisc(v[i], max_error);
+    }
+    expected.push_back(v.back());
+
+    std::vector<S2Point> output;
+    for (const S2Point& p : v) {
+      int old_size = output.size();
+      streaming.AddPoint(p, &output);
+      EXPECT_LE(output.size(), old_size + 1);
+    }
+    EXPECT_EQ(v.size(), streaming.num_points());
+    streaming.Finish(&output);
+    EXPECT_EQ(0, streaming.num_points());
+    EXPECT_EQ(expected, output);
+    EXPECT_LT(output.size(), v.size());
+
+    // Every input vertex is within "max_error" of the output.
+    for (const S2Point& p : v) {
+      S1ChordAngle min_dist = S1ChordAngle::Infinity();
+      for (int i = 0; i + 1 < output.size(); ++i) {
+        S2::UpdateMinDistance(p, output[i], output[i + 1], &min_dist);
+      }
+      EXPECT_LE(min_dist, max_error);
+    }
+  }
+}
+
+TEST(S2StreamingPolylineSimplifier, DegenerateInputs) {
+  S2StreamingPolylineSimplifier streaming(S1ChordAngle(S1Angle::Degrees(1)));
+  std::vector<S2Point> output;
+  streaming.Finish(&output);
+  EXPECT_TRUE(output.empty());
+
+  // A single point (possibly repeated) produces a single vertex.
+  S2Point a = s2textformat::MakePoint("0:0");
+  streaming.AddPoint(a, &output);
+  streaming.AddPoint(a, &output);
+  streaming.Finish(&output);
+  EXPECT_EQ(std::vector<S2Point>({a}), output);
+
+  // Collinear points are removed, and duplicates are ignored.
+  output.clear();
+  for (const char* str : {"0:0", "0:1", "0:1", "0:2", "0:3"}) {
+    streaming.AddPoint(s2textformat::MakePoint(str), &output);
+  }
+  streaming.Finish(&output);
+  EXPECT_EQ(std::vector<S2Point>({a, s2textformat::MakePoint("0:3")}),
+            output);
+
+  // Edges longer than 90 degrees are split at the input vertices.
+  output.clear();
+  for (const char* str : {"0:0", "0:100", "0:-160"}) {
+    streaming.AddPoint(s2textformat::MakePoint(str), &output);
+  }
+  streaming.Finish(&output);
+  EXPECT_EQ(3, output.size());
+}
@@ -26,8 +26,11 @@
 #include <gtest/gtest.h>
 
 #include "s2/s1angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2debug.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2edge_distances.h"
 #include "s2/s2latlng.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -221,6 +224,59 @@ TEST(S2Polyline, Project) {
   EXPECT_EQ(4, next_vertex);
 }
 
+TEST(S2Polyline, LongPolylineProjectAndInterpolate) {
+  // Polylines with many vertices use an internal index; check that the
+  // results agree with a linear scan.
+  S2Testing::rnd.Reset(1);
+  vector<S2LatLng> latlngs;
+  for (int i = 0; i < 1000; ++i) {
+    latlngs.push_back(S2LatLng::FromDegrees(
+        (i % 2) * 0.1 + 0.01 * S2Testing::rnd.RandDouble(), 0.05 * i));
+  }
+  S2Polyline line(latlngs);
+  for (int reversed = 0; reversed < 2; ++reversed) {
+    if (reversed) line.Reverse();
+    vector<double> cumulative_length(line.num_vertices(), 0);
+    for (int i = 1; i < line.num_vertices(); ++i) {
+      cumulative_length[i] = cumulative_length[i - 1] +
+                             line.vertex(i - 1).Angle(line.vertex(i));
+    }
+    for (int iter = 0; iter < 100; ++iter) {
+      // A point near the polyline.
+      int k = S2Testing::rnd.Uniform(line.num_vertices());
+      S2Point point = S2Testing::SamplePoint(
+          S2Cap(line.vertex(k), S1Angle::Degrees(0.5)));
+      S1ChordAngle min_dist = S1ChordAngle::Infinity();
+      for (int i = 1; i < line.num_vertices(); ++i) {
+        S2::UpdateMinDistance(point, line.vertex(i - 1), line.vertex(i),
+                              &min_dist);
+      }
+      int next_vertex;
+      S2Point projected = line.Project(point, &next_vertex);
+      EXPECT_NEAR(min_dist.ToAngle().radians(),
+                  S1Angle(point, projected).radians(), 1e-15);
+      ASSERT_GE(next_vertex, 1);
+      ASSERT_LE(next_vertex, line.num_vertices());
+
+      double fraction = S2Testing::rnd.RandDouble();
+      double target = fraction * cumulative_length.back();
+      int i = 1;
+      while (cumulative_length[i] <= target) ++i;
+      S2Point expected = S2::InterpolateAtDistance(
+          S1Angle::Radians(target - cumulative_length[i - 1]),
+          line.vertex(i - 1), line.vertex(i));
+      S2Point interpolated = line.GetSuffix(fraction, &next_vertex);
+      EXPECT_TRUE(S2::ApproxEquals(expected, interpolated,
+                                   S1Angle::Radians(1e-14)));
+      EXPECT_EQ(i, next_vertex);
+      EXPECT_NEAR(fraction, line.UnInterpolate(interpolated, next_vertex),
+                  1e-14);
+    }
+    EXPECT_EQ(line.vertex(0), line.Interpolate(0));
+    EXPECT_EQ(line.vertex(line.num_vertices() - 1), line.Interpolate(1));
+  }
+}
+
 TEST(S2Polyline, IsOnRight) {
   vector<S2LatLng> latlngs = {
       S2LatLng::FromDegrees(0, 0), S2LatLng::FromDegrees(0, 1),
@@ -276,6 +332,53 @@ TEST(S2Polyline, IntersectsAtVertex) {
   EXPECT_TRUE(line1->Intersects(line3.get()));
 }
 
+// Returns true if any edge of "a" crosses or shares a vertex with any edge
+// of "b", by testing all pairs of edges.
+static bool BruteForceIntersects(const S2Polyline& a, const S2Polyline& b) {
+  for (int i = 0; i + 1 < a.num_vertices(); ++i) {
+    for (int j = 0; j + 1 < b.num_vertices(); ++j) {
+      if (S2::CrossingSign(a.vertex(i), a.vertex(i + 1),
+                           b.vertex(j), b.vertex(j + 1)) >= 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+TEST(S2Polyline, IntersectsLongPolylines) {
+  // Random walks of various lengths, so that both the indexed and the brute
+  // force code paths are used.  Some walks share vertices with others.
+  S2Testing::rnd.Reset(FLAGS_s2_random_seed);
+  const S2Cap cap(S2Point(1, 0, 0), S2Testing::KmToAngle(10));
+  vector<unique_ptr<S2Polyline>> lines;
+  for (int n : {2, 10, 20, 100, 300}) {
+    for (int k = 0; k < 3; ++k) {
+      vector<S2Point> vertices;
+      S2Point p = S2Testing::SamplePoint(cap);
+      for (int i = 0; i < n; ++i) {
+        vertices.push_back(p);
+        p = S2Testing::SamplePoint(S2Cap(p, S2Testing::KmToAngle(0.5)));
+      }
+      if (!lines.empty() && S2Testing::rnd.OneIn(2)) {
+        const S2Polyline& other = *lines.back();
+        vertices[n / 2] = other.vertex(other.num_vertices() / 2);
+      }
+      lines.push_back(make_unique<S2Polyline>(vertices));
+    }
+  }
+  int num_intersecting = 0;
+  for (const auto& a : lines) {
+    for (const auto& b : lines) {
+      bool expected = BruteForceIntersects(*a, *b);
+      EXPECT_EQ(expected, a->Intersects(b.get()));
+      num_intersecting += expected;
+    }
+  }
+  EXPECT_GT(num_intersecting, lines.size());
+  EXPECT_LT(num_intersecting, lines.size() * lines.size());
+}
+
 TEST(S2Polyline, IntersectsVertexOnEdge)  {
   unique_ptr<S2Polyline> horizontal_left_to_right(MakePolyline("0:1, 0:3"));
   unique_ptr<S2Polyline> vertical_bottom_to_top(MakePolyline("-1:2, 0:2, 1:2"));
@@ -416,6 +519,17 @@ TEST(S2Polyline, EncodeDecode) {
   EXPECT_TRUE(decoded_polyline.ApproxEquals(*polyline, S1Angle::Zero()));
 }
 
+TEST(S2Polyline, DecodeTrusted) {
+  unique_ptr<S2Polyline> polyline(MakePolyline("0:0, 0:10, 10:20, 20:30"));
+  Encoder encoder;
+  polyline->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Polyline decoded_polyline;
+  EXPECT_TRUE(decoded_polyline.DecodeTrusted(&decoder));
+  EXPECT_TRUE(decoded_polyline.ApproxEquals(*polyline, S1Angle::Zero()));
+  EXPECT_EQ(S2Debug::ALLOW, decoded_polyline.s2debug_override());
+}
+
 TEST(S2PolylineShape, Basic) {
   unique_ptr<S2Polyline> polyline(MakePolyline("0:0, 1:0, 1:1, 2:1"));
   S2Polyline::Shape shape(polyline.get());
@@ -21,9 +21,12 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <initializer_list>
+#include <limits>
 #include <ostream>
 #include "s2/s1chord_angle.h"
 #include "s2/util/math/exactfloat/exactfloat.h"
+#include "s2/util/math/expansion.h"
 #include "s2/util/math/vector.h"
 
 using std::fabs;
@@ -42,6 +45,43 @@ constexpr long double LD_ERR = rounding_epsilon<long double>();
 // A predefined S1ChordAngle representing (approximately) 45 degrees.
 static const S1ChordAngle k45Degrees = S1ChordAngle::FromLength2(2 - M_SQRT2);
 
+#ifdef S2_PREDICATE_STATS
+static thread_local PredicateStats predicate_stats;
+#endif
+
+// Records that the given predicate was resolved using the given stage (if
+// S2_PREDICATE_STATS is defined), and returns "result".
+template <class T>
+inline static T Resolved(PredicateStats::Predicate predicate,
+                         PredicateStats::Stage stage, T result) {
+#ifdef S2_PREDICATE_STATS
+  ++predicate_stats.counts[predicate][stage];
+#endif
+  return result;
+}
+
+bool PredicateStatsEnabled() {
+#ifdef S2_PREDICATE_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+PredicateStats GetPredicateStats() {
+#ifdef S2_PREDICATE_STATS
+  return predicate_stats;
+#else
+  return PredicateStats();
+#endif
+}
+
+void ResetPredicateStats() {
+#ifdef S2_PREDICATE_STATS
+  predicate_stats = PredicateStats();
+#endif
+}
+
 int Sign(const S2Point& a, const S2Point& b, const S2Point& c) {
   // We don't need RobustCrossProd() here because Sign() does its own
   // error estimation and calls ExpensiveSign() if there is any uncertainty
@@ -49,6 +89,42 @@ int Sign(const S2Point& a, const S2Point& b, const S2Point& c) {
   return Sign(a, b, c, a.CrossProd(b));
 }
 
+void Signs(const S2Point& a, const S2Point& b, S2PointSpan c, int8* signs) {
+  TriageSigns(a, b, a.CrossProd(b), c, signs);
+  for (int i = 0; i < c.size(); ++i) {
+    if (signs[i] == 0) signs[i] = ExpensiveSign(a, b, c[i]);
+  }
+}
+
+void TriageSigns(const S2Point& a, const S2Point& b, const Vector3_d& a_cross_b,
+                 S2PointSpan c, int8* signs) {
+  // See TriageSign() for the derivation of this error bound.  The loop below
+  // computes exactly the same determinant as TriageSign(), but it has no
+  // branches so that it can be vectorized.
+  const double kMaxDetError = 1.8274 * DBL_EPSILON;
+  const int n = c.size();
+  for (int i = 0; i < n; ++i) {
+    double det = a_cross_b.DotProd(c[i]);
+    signs[i] = (det > kMaxDetError) - (det < -kMaxDetError);
+    S2_DCHECK_EQ(TriageSign(a, b, c[i], a_cross_b), signs[i]);
+  }
+}
+
+void TriageSigns(const S2Point& a, const S2Point& b, const Vector3_d& a_cross_b,
+                 const double* x, const double* y, const double* z, int n,
+                 int8* signs) {
+  // The determinant is computed in the same order as Vector3::DotProd() so
+  // that the results are identical to TriageSign().
+  const double kMaxDetError = 1.8274 * DBL_EPSILON;
+  const double nx = a_cross_b.x(), ny = a_cross_b.y(), nz = a_cross_b.z();
+  for (int i = 0; i < n; ++i) {
+    double det = nx * x[i] + ny * y[i] + nz * z[i];
+    signs[i] = (det > kMaxDetError) - (det < -kMaxDetError);
+    S2_DCHECK_EQ(TriageSign(a, b, S2Point(x[i], y[i], z[i]), a_cross_b),
+                 signs[i]);
+  }
+}
+
 // Compute the determinant in a numerically stable way.  Unlike TriageSign(),
 // this method can usually compute the correct determinant sign even when all
 // three points are as collinear as possible.  For example if three points are
@@ -98,6 +174,64 @@ int StableSign(const S2Point& a, const S2Point& b, const S2Point& c) {
   return (fabs(det) <= max_error) ? 0 : (det > 0) ? 1 : -1;
 }
 
+// The exact predicates below first try to evaluate their polynomials using
+// Expansion, which is much faster than ExactFloat because it does not
+// allocate memory.  ExactFloat is used only when the input coordinates are
+// too small for every intermediate product to be represented exactly using
+// doubles.
+using Vector3_ex = Vector3<Expansion>;
+
+// Returns a power of two such that any homogeneous polynomial of the given
+// degree in the coordinates of the given points, multiplied by this scale
+// factor, can be evaluated exactly using Expansion arithmetic.  Returns 0 if
+// there is no such scale factor.  (All the polynomials below are
+// homogeneous, so scaling the points by a positive constant does not change
+// the sign of the result.)
+static double GetExpansionScale(
+    int degree, std::initializer_list<const S2Point*> points) {
+  // The scale factor is chosen so that the magnitudes of all intermediate
+  // results are less than 2**(1023 - 64), which leaves plenty of room for
+  // the integer coefficients and the number of terms in each sum.
+  const int scale_exp = (1023 - 64) / degree - 1;
+  int min_exp = std::numeric_limits<int>::max();
+  for (const S2Point* p : points) {
+    for (int i = 0; i < 3; ++i) {
+      double x = (*p)[i];
+      if (x == 0) continue;
+      if (!(fabs(x) < 2)) return 0;  // Also rejects NaN.
+      min_exp = min(min_exp, std::ilogb(x));
+    }
+  }
+  // Each scaled coordinate is a multiple of 2**u, where u is the exponent of
+  // the unit in the last place of the smallest coordinate.  Every
+  // intermediate result (including the components of each Expansion) is
+  // therefore a multiple of 2**(k * u) for some k <= degree, and all such
+  // values are exactly representable as long as they are not subnormal.
+  const int u = min_exp + scale_exp - (std::numeric_limits<double>::digits - 1);
+  if (min_exp != std::numeric_limits<int>::max() && u < 0 &&
+      degree * u < std::numeric_limits<double>::min_exponent - 1) {
+    return 0;
+  }
+  return std::ldexp(1.0, scale_exp);
+}
+
+inline static Vector3_ex ToExpansion(const S2Point& x, double scale) {
+  return Vector3_ex(x[0] * scale, x[1] * scale, x[2] * scale);
+}
+
+bool ExpansionSign(const S2Point& a, const S2Point& b, const S2Point& c,
+                   int* sign) {
+  double scale = GetExpansionScale(3, {&a, &b, &c});
+  if (scale == 0) return false;
+  Vector3_ex xa = ToExpansion(a, scale);
+  Vector3_ex xb = ToExpansion(b, scale);
+  Vector3_ex xc = ToExpansion(c, scale);
+  Expansion det = xa.DotProd(xb.CrossProd(xc));
+  if (!det.ok()) return false;
+  *sign = det.sgn();
+  return true;
+}
+
 // The following function returns the sign of the determinant of three points
 // A, B, C under a model where every possible S2Point is slightly perturbed by
 // a unique infinitesmal amount such that no three perturbed points are
@@ -234,28 +368,35 @@ int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
   if (*pa > *pb) { swap(pa, pb); perm_sign = -perm_sign; }
   S2_DCHECK(*pa < *pb && *pb < *pc);
 
-  // Construct multiple-precision versions of the sorted points and compute
-  // their exact 3x3 determinant.
+  // Compute the exact 3x3 determinant of the sorted points, using ExactFloat
+  // only if the determinant cannot be computed using expansions.
+  int det_sign;
+  if (!ExpansionSign(*pa, *pb, *pc, &det_sign)) {
+    Vector3_xf xa = Vector3_xf::Cast(*pa);
+    Vector3_xf xb = Vector3_xf::Cast(*pb);
+    Vector3_xf xc = Vector3_xf::Cast(*pc);
+    ExactFloat det = xa.DotProd(xb.CrossProd(xc));
+
+    // The precision of ExactFloat is high enough that the result should
+    // always be exact (no rounding was performed).
+    S2_DCHECK(!det.is_nan());
+    S2_DCHECK_LT(det.prec(), det.max_prec());
+    det_sign = det.sgn();
+  }
+  // If the exact determinant is non-zero, we're done.
+  if (det_sign != 0 || !perturb) {
+    return Resolved(PredicateStats::SIGN, PredicateStats::EXACT,
+                    perm_sign * det_sign);
+  }
+  // Otherwise, we need to resort to symbolic perturbations to resolve the
+  // sign of the determinant.
   Vector3_xf xa = Vector3_xf::Cast(*pa);
   Vector3_xf xb = Vector3_xf::Cast(*pb);
   Vector3_xf xc = Vector3_xf::Cast(*pc);
-  Vector3_xf xb_cross_xc = xb.CrossProd(xc);
-  ExactFloat det = xa.DotProd(xb_cross_xc);
-
-  // The precision of ExactFloat is high enough that the result should always
-  // be exact (no rounding was performed).
-  S2_DCHECK(!det.is_nan());
-  S2_DCHECK_LT(det.prec(), det.max_prec());
-
-  // If the exact determinant is non-zero, we're done.
-  int det_sign = det.sgn();
-  if (det_sign == 0 && perturb) {
-    // Otherwise, we need to resort to symbolic perturbations to resolve the
-    // sign of the determinant.
-    det_sign = SymbolicallyPerturbedSign(xa, xb, xc, xb_cross_xc);
-    S2_DCHECK_NE(0, det_sign);
-  }
-  return perm_sign * det_sign;
+  det_sign = SymbolicallyPerturbedSign(xa, xb, xc, xb.CrossProd(xc));
+  S2_DCHECK_NE(0, det_sign);
+  return Resolved(PredicateStats::SIGN, PredicateStats::SYMBOLIC,
+                  perm_sign * det_sign);
 }
 
 // ExpensiveSign() uses arbitrary-precision arithmetic and the "simulation of
@@ -274,7 +415,9 @@ using Vector3_xf = Vector3<ExactFloat>;
 int ExpensiveSign(const S2Point& a, const S2Point& b, const S2Point& c,
                   bool perturb) {
   // Return zero if and only if two points are the same.  This ensures (1).
-  if (a == b || b == c || c == a) return 0;
+  if (a == b || b == c || c == a) {
+    return Resolved(PredicateStats::SIGN, PredicateStats::DOUBLE, 0);
+  }
 
   // Next we try recomputing the determinant still using floating-point
   // arithmetic but in a more precise way.  This is more expensive than the
@@ -283,14 +426,13 @@ int ExpensiveSign(const S2Point& a, const S2Point& b, const S2Point& c,
   // compute the correct determinant sign in virtually all cases except when
   // the three points are truly collinear (e.g., three points on the equator).
   int det_sign = StableSign(a, b, c);
-  if (det_sign != 0) return det_sign;
+  if (det_sign != 0) {
+    return Resolved(PredicateStats::SIGN, PredicateStats::DOUBLE, det_sign);
+  }
 
   // TODO(ericv): Create a templated version of StableSign so that we can
   // retry in "long double" precision before falling back to ExactFloat.
 
-  // TODO(ericv): Optimize ExactFloat so that it stores up to 32 bytes of
-  // mantissa inline (without requiring memory allocation).
-
   // Otherwise fall back to exact arithmetic and symbolic permutations.
   return ExactSign(a, b, c, perturb);
 }
@@ -405,6 +547,28 @@ int ExactCompareDistances(const Vector3_xf& x,
   return a_sign * cmp.sgn();
 }
 
+bool ExpansionCompareDistances(const S2Point& x, const S2Point& a,
+                               const S2Point& b, int* result) {
+  // See ExactCompareDistances() for the derivation.
+  double scale = GetExpansionScale(6, {&x, &a, &b});
+  if (scale == 0) return false;
+  Vector3_ex xx = ToExpansion(x, scale);
+  Vector3_ex xa = ToExpansion(a, scale);
+  Vector3_ex xb = ToExpansion(b, scale);
+  Expansion cos_ax = xx.DotProd(xa);
+  Expansion cos_bx = xx.DotProd(xb);
+  if (!cos_ax.ok() || !cos_bx.ok()) return false;
+  int a_sign = cos_ax.sgn(), b_sign = cos_bx.sgn();
+  if (a_sign != b_sign) {
+    *result = (a_sign > b_sign) ? -1 : 1;
+    return true;
+  }
+  Expansion cmp = cos_bx * cos_bx * xa.Norm2() - cos_ax * cos_ax * xb.Norm2();
+  if (!cmp.ok()) return false;
+  *result = a_sign * cmp.sgn();
+  return true;
+}
+
 // Given three points such that AX == BX (exactly), returns -1, 0, or +1
 // according whether AX < BX, AX == BX, or AX > BX after symbolic
 // perturbations are taken into account.
@@ -430,10 +594,14 @@ int SymbolicCompareDistances(const S2Point& x,
   return (a < b) ? 1 : (a > b) ? -1 : 0;
 }
 
+// Also sets "stage" to the precision that was used (for PredicateStats).
 static int CompareSin2Distances(const S2Point& x,
-                                const S2Point& a, const S2Point& b) {
+                                const S2Point& a, const S2Point& b,
+                                PredicateStats::Stage* stage) {
+  *stage = PredicateStats::DOUBLE;
   int sign = TriageCompareSin2Distances(x, a, b);
   if (sign != 0) return sign;
+  *stage = PredicateStats::LONG_DOUBLE;
   return TriageCompareSin2Distances(ToLD(x), ToLD(a), ToLD(b));
 }
 
@@ -443,11 +611,12 @@ int CompareDistances(const S2Point& x, const S2Point& a, const S2Point& b) {
   // over the entire range of possible angles.  (We can only use the sin^2
   // technique if both angles are less than 90 degrees or both angles are
   // greater than 90 degrees.)
+  constexpr auto kPredicate = PredicateStats::COMPARE_DISTANCES;
   int sign = TriageCompareCosDistances(x, a, b);
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
 
   // Optimization for (a == b) to avoid falling back to exact arithmetic.
-  if (a == b) return 0;
+  if (a == b) return Resolved(kPredicate, PredicateStats::DOUBLE, 0);
 
   // It is much better numerically to compare distances using cos(angle) if
   // the distances are near 90 degrees and sin^2(angle) if the distances are
@@ -455,20 +624,24 @@ int CompareDistances(const S2Point& x, const S2Point& a, const S2Point& b) {
   // making this decision because the fact that the test above failed means
   // that angles "a" and "b" are very close together.
   double cos_ax = a.DotProd(x);
+  PredicateStats::Stage stage = PredicateStats::LONG_DOUBLE;
   if (cos_ax > M_SQRT1_2) {
     // Angles < 45 degrees.
-    sign = CompareSin2Distances(x, a, b);
+    sign = CompareSin2Distances(x, a, b, &stage);
   } else if (cos_ax < -M_SQRT1_2) {
     // Angles > 135 degrees.  sin^2(angle) is decreasing in this range.
-    sign = -CompareSin2Distances(x, a, b);
+    sign = -CompareSin2Distances(x, a, b, &stage);
   } else {
     // We've already tried double precision, so continue with "long double".
     sign = TriageCompareCosDistances(ToLD(x), ToLD(a), ToLD(b));
   }
-  if (sign != 0) return sign;
-  sign = ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
-  if (sign != 0) return sign;
-  return SymbolicCompareDistances(x, a, b);
+  if (sign != 0) return Resolved(kPredicate, stage, sign);
+  if (!ExpansionCompareDistances(x, a, b, &sign)) {
+    sign = ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
+  }
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::EXACT, sign);
+  return Resolved(kPredicate, PredicateStats::SYMBOLIC,
+                  SymbolicCompareDistances(x, a, b));
 }
 
 template <class T>
@@ -519,8 +692,9 @@ int CompareDistance(const S2Point& x, const S2Point& y, S1ChordAngle r) {
   // As with CompareDistances(), we start by comparing dot products because
   // the sin^2 method is only valid when the distance XY and the limit "r" are
   // both less than 90 degrees.
+  constexpr auto kPredicate = PredicateStats::COMPARE_DISTANCE;
   int sign = TriageCompareCosDistance(x, y, r.length2());
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
 
   // Unlike with CompareDistances(), it's not worth using the sin^2 method
   // when the distance limit is near 180 degrees because the S1ChordAngle
@@ -528,13 +702,14 @@ int CompareDistance(const S2Point& x, const S2Point& y, S1ChordAngle r) {
   // distances near 180 degrees.
   if (r < k45Degrees) {
     sign = TriageCompareSin2Distance(x, y, r.length2());
-    if (sign != 0) return sign;
+    if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
     sign = TriageCompareSin2Distance(ToLD(x), ToLD(y), ToLD(r.length2()));
   } else {
     sign = TriageCompareCosDistance(ToLD(x), ToLD(y), ToLD(r.length2()));
   }
-  if (sign != 0) return sign;
-  return ExactCompareDistance(ToExact(x), ToExact(y), r.length2());
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::LONG_DOUBLE, sign);
+  return Resolved(kPredicate, PredicateStats::EXACT,
+                  ExactCompareDistance(ToExact(x), ToExact(y), r.length2()));
 }
 
 // Helper function that compares the distance XY against the squared chord
@@ -750,16 +925,18 @@ int CompareEdgeDistance(const S2Point& x, const S2Point& a0, const S2Point& a1,
   // the most common case -- the full test is in ExactCompareEdgeDistance.)
   S2_DCHECK_NE(a0, -a1);
 
+  constexpr auto kPredicate = PredicateStats::COMPARE_EDGE_DISTANCE;
   int sign = TriageCompareEdgeDistance(x, a0, a1, r.length2());
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
 
   // Optimization for the case where the edge is degenerate.
   if (a0 == a1) return CompareDistance(x, a0, r);
 
   sign = TriageCompareEdgeDistance(ToLD(x), ToLD(a0), ToLD(a1),
                                    ToLD(r.length2()));
-  if (sign != 0) return sign;
-  return ExactCompareEdgeDistance(x, a0, a1, r);
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::LONG_DOUBLE, sign);
+  return Resolved(kPredicate, PredicateStats::EXACT,
+                  ExactCompareEdgeDistance(x, a0, a1, r));
 }
 
 template <class T>
@@ -799,16 +976,19 @@ int CompareEdgeDirections(const S2Point& a0, const S2Point& a1,
   S2_DCHECK_NE(a0, -a1);
   S2_DCHECK_NE(b0, -b1);
 
+  constexpr auto kPredicate = PredicateStats::COMPARE_EDGE_DIRECTIONS;
   int sign = TriageCompareEdgeDirections(a0, a1, b0, b1);
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
 
   // Optimization for the case where either edge is degenerate.
-  if (a0 == a1 || b0 == b1) return 0;
-
+  if (a0 == a1 || b0 == b1) {
+    return Resolved(kPredicate, PredicateStats::DOUBLE, 0);
+  }
   sign = TriageCompareEdgeDirections(ToLD(a0), ToLD(a1), ToLD(b0), ToLD(b1));
-  if (sign != 0) return sign;
-  return ExactCompareEdgeDirections(ToExact(a0), ToExact(a1),
-                                    ToExact(b0), ToExact(b1));
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::LONG_DOUBLE, sign);
+  return Resolved(kPredicate, PredicateStats::EXACT,
+                  ExactCompareEdgeDirections(ToExact(a0), ToExact(a1),
+                                             ToExact(b0), ToExact(b1)));
 }
 
 // If triangle ABC has positive sign, returns its circumcenter.  If ABC has
@@ -971,6 +1151,61 @@ int ExactEdgeCircumcenterSign(const Vector3_xf& x0, const Vector3_xf& x1,
   return abc_sign * result;
 }
 
+bool ExpansionEdgeCircumcenterSign(const S2Point& x0, const S2Point& x1,
+                                   const S2Point& a, const S2Point& b,
+                                   const S2Point& c, int abc_sign,
+                                   int* result) {
+  // This is the same algorithm as ExactEdgeCircumcenterSign() (see there for
+  // the derivation), except that every value is checked for exactness before
+  // its sign is used.  The final polynomial has degree 20.
+  double scale = GetExpansionScale(20, {&x0, &x1, &a, &b, &c});
+  if (scale == 0) return false;
+  Vector3_ex xx0 = ToExpansion(x0, scale);
+  Vector3_ex xx1 = ToExpansion(x1, scale);
+  Vector3_ex xa = ToExpansion(a, scale);
+  Vector3_ex xb = ToExpansion(b, scale);
+  Vector3_ex xc = ToExpansion(c, scale);
+
+  // Return zero if the edge X is degenerate.
+  Vector3_ex nx = xx0.CrossProd(xx1);
+  if (!nx[0].ok() || !nx[1].ok() || !nx[2].ok()) return false;
+  if (nx[0].sgn() == 0 && nx[1].sgn() == 0 && nx[2].sgn() == 0) {
+    *result = 0;
+    return true;
+  }
+  Expansion dab = nx.DotProd(xa.CrossProd(xb));
+  Expansion dbc = nx.DotProd(xb.CrossProd(xc));
+  Expansion dca = nx.DotProd(xc.CrossProd(xa));
+  Expansion abc2 = xa.Norm2() * (dbc * dbc);
+  Expansion bca2 = xb.Norm2() * (dca * dca);
+  Expansion cab2 = xc.Norm2() * (dab * dab);
+  if (!abc2.ok() || !bca2.ok() || !cab2.ok()) return false;
+
+  int lhs3_sgn = dab.sgn(), rhs3_sgn = -dbc.sgn();
+  int lhs2_sgn = max(-1, min(1, lhs3_sgn - rhs3_sgn));
+  if (lhs2_sgn == 0 && lhs3_sgn != 0) {
+    Expansion diff = cab2 - abc2;
+    if (!diff.ok()) return false;
+    lhs2_sgn = diff.sgn() * lhs3_sgn;
+  }
+  int rhs2_sgn = -dca.sgn();
+  int sign = max(-1, min(1, lhs2_sgn - rhs2_sgn));
+  if (sign == 0 && lhs2_sgn != 0) {
+    int lhs4_sgn = dab.sgn() * dbc.sgn();
+    Expansion rhs4 = bca2 - cab2 - abc2;
+    if (!rhs4.ok()) return false;
+    sign = max(-1, min(1, lhs4_sgn - rhs4.sgn()));
+    if (sign == 0 && lhs4_sgn != 0) {
+      Expansion diff = 4 * abc2 * cab2 - rhs4 * rhs4;
+      if (!diff.ok()) return false;
+      sign = diff.sgn() * lhs4_sgn;
+    }
+    sign *= lhs2_sgn;
+  }
+  *result = abc_sign * sign;
+  return true;
+}
+
 // Like Sign, except this method does not use symbolic perturbations when
 // the input points are exactly coplanar with the origin (i.e., linearly
 // dependent).  Clients should never use this method, but it is useful here in
@@ -1061,24 +1296,29 @@ int EdgeCircumcenterSign(const S2Point& x0, const S2Point& x1,
   // the most common case -- the full test is in ExactEdgeCircumcenterSign.)
   S2_DCHECK_NE(x0, -x1);
 
+  constexpr auto kPredicate = PredicateStats::EDGE_CIRCUMCENTER_SIGN;
   int abc_sign = Sign(a, b, c);
   int sign = TriageEdgeCircumcenterSign(x0, x1, a, b, c, abc_sign);
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::DOUBLE, sign);
 
   // Optimization for the cases that are going to return zero anyway, in order
   // to avoid falling back to exact arithmetic.
-  if (x0 == x1 || a == b || b == c || c == a) return 0;
-
+  if (x0 == x1 || a == b || b == c || c == a) {
+    return Resolved(kPredicate, PredicateStats::DOUBLE, 0);
+  }
   sign = TriageEdgeCircumcenterSign(
       ToLD(x0), ToLD(x1), ToLD(a), ToLD(b), ToLD(c), abc_sign);
-  if (sign != 0) return sign;
-  sign = ExactEdgeCircumcenterSign(
-      ToExact(x0), ToExact(x1), ToExact(a), ToExact(b), ToExact(c), abc_sign);
-  if (sign != 0) return sign;
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::LONG_DOUBLE, sign);
+  if (!ExpansionEdgeCircumcenterSign(x0, x1, a, b, c, abc_sign, &sign)) {
+    sign = ExactEdgeCircumcenterSign(ToExact(x0), ToExact(x1), ToExact(a),
+                                     ToExact(b), ToExact(c), abc_sign);
+  }
+  if (sign != 0) return Resolved(kPredicate, PredicateStats::EXACT, sign);
 
   // Unlike the other methods, SymbolicEdgeCircumcenterSign does not depend
   // on the sign of triangle ABC.
-  return SymbolicEdgeCircumcenterSign(x0, x1, a, b, c);
+  return Resolved(kPredicate, PredicateStats::SYMBOLIC,
+                  SymbolicEdgeCircumcenterSign(x0, x1, a, b, c));
 }
 
 template <class T>
@@ -1399,19 +1639,25 @@ Excluded GetVoronoiSiteExclusion(const S2Point& a, const S2Point& b,
   // ensure that either A or B is considered closer (in a consistent way).
   // This also ensures that the choice of A or B does not depend on the
   // direction of X.
+  constexpr auto kPredicate = PredicateStats::VORONOI_SITE_EXCLUSION;
   if (s2pred::CompareDistances(x1, a, b) < 0) {
-    return Excluded::SECOND;  // Site A is closer to every point on X.
+    // Site A is closer to every point on X.
+    return Resolved(kPredicate, PredicateStats::DOUBLE, Excluded::SECOND);
   }
 
   Excluded result = TriageVoronoiSiteExclusion(a, b, x0, x1, r.length2());
-  if (result != Excluded::UNCERTAIN) return result;
-
+  if (result != Excluded::UNCERTAIN) {
+    return Resolved(kPredicate, PredicateStats::DOUBLE, result);
+  }
   result = TriageVoronoiSiteExclusion(ToLD(a), ToLD(b), ToLD(x0), ToLD(x1),
                                       ToLD(r.length2()));
-  if (result != Excluded::UNCERTAIN) return result;
-
-  return ExactVoronoiSiteExclusion(ToExact(a), ToExact(b), ToExact(x0),
-                                   ToExact(x1), r.length2());
+  if (result != Excluded::UNCERTAIN) {
+    return Resolved(kPredicate, PredicateStats::LONG_DOUBLE, result);
+  }
+  return Resolved(kPredicate, PredicateStats::EXACT,
+                  ExactVoronoiSiteExclusion(ToExact(a), ToExact(b),
+                                            ToExact(x0), ToExact(x1),
+                                            r.length2()));
 }
 
 std::ostream& operator<<(std::ostream& os, Excluded excluded) {
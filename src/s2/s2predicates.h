@@ -37,7 +37,9 @@
 #include "s2/_fp_contract_off.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2debug.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
+#include "s2/third_party/absl/base/integral_types.h"
 
 namespace s2pred {
 
@@ -75,6 +77,16 @@ namespace s2pred {
 // involving antipodal points.
 int Sign(const S2Point& a, const S2Point& b, const S2Point& c);
 
+// Batch version of Sign() for a fixed pair of points A and B: sets signs[i]
+// to Sign(a, b, c[i]) for every point in "c".  This is faster than calling
+// Sign() repeatedly because the cheap determinant test is done for all the
+// points in a single branch-free pass (which the compiler can vectorize), and
+// ExpensiveSign() is then called only for the points where that test was
+// inconclusive.
+//
+// REQUIRES: "signs" has room for c.size() values.
+void Signs(const S2Point& a, const S2Point& b, S2PointSpan c, int8* signs);
+
 // Given 4 points on the unit sphere, return true if the edges OA, OB, and
 // OC are encountered in that order while sweeping CCW around the point O.
 // You can think of this as testing whether A <= B <= C with respect to the
@@ -214,6 +226,23 @@ inline int Sign(const S2Point& a, const S2Point& b, const S2Point& c,
 inline int TriageSign(const S2Point& a, const S2Point& b,
                       const S2Point& c, const Vector3_d& a_cross_b);
 
+// Sets signs[i] to TriageSign(a, b, c[i], a_cross_b) for every point in "c".
+// This is useful for algorithms that test many points against the same edge
+// AB, since most of them can typically be classified without calling
+// ExpensiveSign() (e.g., an edge CD cannot cross AB if C and D are
+// definitely on the same side of it).
+//
+// REQUIRES: "signs" has room for c.size() values.
+void TriageSigns(const S2Point& a, const S2Point& b, const Vector3_d& a_cross_b,
+                 S2PointSpan c, int8* signs);
+
+// Like the function above, except that the points "c" are given as separate
+// arrays of coordinates (see S2PointSoA), i.e. the i-th point is
+// (x[i], y[i], z[i]) for 0 <= i < n.
+void TriageSigns(const S2Point& a, const S2Point& b, const Vector3_d& a_cross_b,
+                 const double* x, const double* y, const double* z, int n,
+                 int8* signs);
+
 // This function is invoked by Sign() if the sign of the determinant is
 // uncertain.  It always returns a non-zero result unless two of the input
 // points are the same.  It uses a combination of multiple-precision
@@ -232,6 +261,49 @@ inline int TriageSign(const S2Point& a, const S2Point& b,
 int ExpensiveSign(const S2Point& a, const S2Point& b,
                   const S2Point& c, bool perturb = true);
 
+// Counts the number of times that each predicate was resolved using each
+// level of precision.  This can be used to find out whether a workload spends
+// significant time in the slower stages (e.g., because its input points are
+// often nearly collinear).  Counting is enabled only if the library was
+// compiled with S2_PREDICATE_STATS defined (see the WITH_PREDICATE_STATS
+// CMake option), since otherwise it would add overhead to every predicate;
+// when disabled all counts are zero.
+//
+// The counts are maintained separately for each thread.  Note that calls to
+// Sign() are only counted when the inlined double-precision test is
+// inconclusive (i.e., when ExpensiveSign() is called), and that
+// CompareEdgeDistance() calls CompareDistance() when the edge is degenerate.
+struct PredicateStats {
+  enum Predicate {
+    SIGN,
+    COMPARE_DISTANCES,
+    COMPARE_DISTANCE,
+    COMPARE_EDGE_DISTANCE,
+    COMPARE_EDGE_DIRECTIONS,
+    EDGE_CIRCUMCENTER_SIGN,
+    VORONOI_SITE_EXCLUSION,
+    NUM_PREDICATES
+  };
+  enum Stage { DOUBLE, LONG_DOUBLE, EXACT, SYMBOLIC, NUM_STAGES };
+
+  // Returns the number of calls to "predicate" that were resolved using
+  // "stage".
+  int64 count(Predicate predicate, Stage stage) const {
+    return counts[predicate][stage];
+  }
+
+  int64 counts[NUM_PREDICATES][NUM_STAGES] = {};
+};
+
+// Returns true if the library was compiled with S2_PREDICATE_STATS defined.
+bool PredicateStatsEnabled();
+
+// Returns a snapshot of the counts for the calling thread.
+PredicateStats GetPredicateStats();
+
+// Sets all the counts for the calling thread to zero.
+void ResetPredicateStats();
+
 //////////////////   Implementation details follow   ////////////////////
 
 inline int Sign(const S2Point& a, const S2Point& b, const S2Point& c,
@@ -0,0 +1,118 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for the orientation predicates and S2EdgeCrosser.  All inputs
+// are generated from fixed seeds so that results can be compared between
+// releases.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2predicates.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/base/integral_types.h"
+
+using std::vector;
+
+namespace {
+
+// Returns "n" random points near the given edge, so that the predicates
+// below are frequently close to degenerate.
+vector<S2Point> MakePointsNearEdge(const S2Point& a, const S2Point& b, int n) {
+  S2Point mid = (a + b).Normalize();
+  S2Cap cap(mid, S1Angle::Radians(a.Angle(b)));
+  vector<S2Point> points;
+  for (int i = 0; i < n; ++i) {
+    points.push_back(S2Testing::SamplePoint(cap));
+  }
+  return points;
+}
+
+void BM_Sign(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Point a = S2Testing::RandomPoint();
+  S2Point b = S2Testing::RandomPoint();
+  vector<S2Point> points = MakePointsNearEdge(a, b, 1024);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s2pred::Sign(a, b, points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_Sign);
+
+void BM_SignNearlyCollinear(benchmark::State& state) {
+  // Points that are as collinear as possible, which forces ExpensiveSign().
+  S2Testing::rnd.Reset(2);
+  S2Point a, x, y;
+  S2Testing::GetRandomFrame(&a, &x, &y);
+  S2Point b = (a + 1e-10 * x).Normalize();
+  S2Point c = (a + 2e-10 * x).Normalize();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(s2pred::Sign(a, b, c));
+  }
+}
+BENCHMARK(BM_SignNearlyCollinear);
+
+void BM_Signs(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  S2Point a = S2Testing::RandomPoint();
+  S2Point b = S2Testing::RandomPoint();
+  vector<S2Point> points = MakePointsNearEdge(a, b, state.range(0));
+  vector<int8> signs(points.size());
+  for (auto _ : state) {
+    s2pred::Signs(a, b, points, signs.data());
+    benchmark::DoNotOptimize(signs.data());
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_Signs)->Arg(16)->Arg(1024);
+
+void BM_EdgeCrosserChain(benchmark::State& state) {
+  S2Testing::rnd.Reset(3);
+  S2Point a = S2Testing::RandomPoint();
+  S2Point b = S2Testing::RandomPoint();
+  vector<S2Point> chain = MakePointsNearEdge(a, b, state.range(0));
+  for (auto _ : state) {
+    S2EdgeCrosser crosser(&a, &b, &chain[0]);
+    int crossings = 0;
+    for (int i = 1; i < chain.size(); ++i) {
+      crossings += (crosser.CrossingSign(&chain[i]) > 0);
+    }
+    benchmark::DoNotOptimize(crossings);
+  }
+  state.SetItemsProcessed(state.iterations() * (chain.size() - 1));
+}
+BENCHMARK(BM_EdgeCrosserChain)->Arg(16)->Arg(1024);
+
+void BM_EdgeCrosserChainCrossingSigns(benchmark::State& state) {
+  S2Testing::rnd.Reset(3);
+  S2Point a = S2Testing::RandomPoint();
+  S2Point b = S2Testing::RandomPoint();
+  vector<S2Point> chain = MakePointsNearEdge(a, b, state.range(0));
+  vector<int8> signs(chain.size() - 1);
+  for (auto _ : state) {
+    S2EdgeCrosser crosser(&a, &b);
+    crosser.ChainCrossingSigns(chain, signs.data());
+    benchmark::DoNotOptimize(signs.data());
+  }
+  state.SetItemsProcessed(state.iterations() * (chain.size() - 1));
+}
+BENCHMARK(BM_EdgeCrosserChainCrossingSigns)->Arg(16)->Arg(1024);
+
+}  // namespace
@@ -67,6 +67,24 @@ int StableSign(const S2Point& a, const S2Point& b, const S2Point& c);
 int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
               bool perturb);
 
+// The following functions compute the same results as ExactSign (without
+// perturbations), ExactCompareDistances, and ExactEdgeCircumcenterSign, but
+// using floating-point expansions (see util/math/expansion.h) rather than
+// ExactFloat so that no memory is allocated.  Each function returns false if
+// the result cannot be computed this way, which happens only when some input
+// coordinates are extremely small.  Otherwise it sets "result" to the exact
+// sign (which may be zero) and returns true.
+bool ExpansionSign(const S2Point& a, const S2Point& b, const S2Point& c,
+                   int* result);
+
+bool ExpansionCompareDistances(const S2Point& x, const S2Point& a,
+                               const S2Point& b, int* result);
+
+bool ExpansionEdgeCircumcenterSign(const S2Point& x0, const S2Point& x1,
+                                   const S2Point& a, const S2Point& b,
+                                   const S2Point& c, int abc_sign,
+                                   int* result);
+
 int SymbolicallyPerturbedSign(
     const Vector3_xf& a, const Vector3_xf& b,
     const Vector3_xf& c, const Vector3_xf& b_cross_c);
@@ -31,6 +31,7 @@
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
 #include "s2/util/math/exactfloat/exactfloat.h"
+#include "s2/util/math/expansion.h"
 #include "s2/util/math/vector.h"
 
 DEFINE_int32(consistency_iters, 5000,
@@ -338,6 +339,77 @@ TEST_F(SignTest, StressTest) {
   }
 }
 
+TEST(Expansion, ExactArithmetic) {
+  // 1 + 2**-60 is not representable as a double, but it is representable as
+  // an expansion with two components.
+  Expansion x = Expansion(1.0) + Expansion(ldexp(1.0, -60));
+  EXPECT_TRUE(x.ok());
+  EXPECT_EQ(2, x.size());
+  EXPECT_EQ(1, (x - 1.0).sgn());
+  EXPECT_EQ(0, (x - x).sgn());
+  EXPECT_EQ(-1, (1.0 - x).sgn());
+
+  // (1 + 2**-60)**2 - 1 - 2**-59 == 2**-120 exactly.
+  Expansion y = x * x - 1.0 - Expansion(ldexp(1.0, -59));
+  EXPECT_TRUE(y.ok());
+  EXPECT_EQ(ldexp(1.0, -120), y.ToDouble());
+  EXPECT_EQ(-1, (-y).sgn());
+  EXPECT_FALSE(Expansion(numeric_limits<double>::infinity()).ok());
+}
+
+TEST(ExpansionSign, MatchesExactSign) {
+  // Checks random points, exactly collinear points, and nearly collinear
+  // points, including points with tiny coordinates where ExactFloat must be
+  // used instead.
+  auto& rnd = S2Testing::rnd;
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2Point a = S2Testing::RandomPoint();
+    S2Point b = S2Testing::RandomPoint();
+    S2Point c;
+    switch (iter % 4) {
+      case 0: c = S2Testing::RandomPoint(); break;
+      case 1: c = -a; break;
+      case 2: c = (a + ldexp(rnd.RandDouble(), -60) * b).Normalize(); break;
+      case 3:
+        a = S2Point(1, ldexp(1.0, -rnd.Uniform(1070)), 0);
+        b = S2Point(1, ldexp(rnd.RandDouble(), -rnd.Uniform(1070)), 0);
+        c = S2Point(1, 0, ldexp(1.0, -rnd.Uniform(1070)));
+        break;
+    }
+    int sign;
+    if (ExpansionSign(a, b, c, &sign)) {
+      EXPECT_EQ(ToExact(a).DotProd(ToExact(b).CrossProd(ToExact(c))).sgn(),
+                sign);
+    } else {
+      // Only inputs with extremely small coordinates need ExactFloat.
+      EXPECT_EQ(3, iter % 4);
+    }
+  }
+}
+
+TEST(Signs, MatchesSign) {
+  // Include points that are identical to A or B, exactly collinear, and
+  // nearly collinear so that both the fast and the exact paths are tested.
+  for (int iter = 0; iter < 100; ++iter) {
+    S2Point a, x, y;
+    S2Testing::GetRandomFrame(&a, &x, &y);
+    S2Point b = (a + 1e-3 * x).Normalize();
+    vector<S2Point> c = {a, b, -a, -b, (a + 2e-3 * x).Normalize()};
+    for (int i = 0; i < 50; ++i) {
+      c.push_back(S2Testing::RandomPoint());
+      c.push_back((a + 1e-3 * i * x + 1e-17 * y).Normalize());
+    }
+    vector<int8> triage_signs(c.size()), signs(c.size());
+    Vector3_d a_cross_b = a.CrossProd(b);
+    s2pred::TriageSigns(a, b, a_cross_b, c, triage_signs.data());
+    s2pred::Signs(a, b, c, signs.data());
+    for (int i = 0; i < c.size(); ++i) {
+      EXPECT_EQ(TriageSign(a, b, c[i], a_cross_b), triage_signs[i]);
+      EXPECT_EQ(Sign(a, b, c[i]), signs[i]);
+    }
+  }
+}
+
 class StableSignTest : public testing::Test {
  protected:
   // Estimate the probability that S2::StableSign() will not be able to compute
@@ -645,6 +717,10 @@ Precision TestCompareDistancesConsistency(const S2Point& x, const S2Point& a,
   int dbl_sign = CompareDistancesWrapper::Triage(x, a, b);
   int ld_sign = CompareDistancesWrapper::Triage(ToLD(x), ToLD(a), ToLD(b));
   int exact_sign = ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
+  int expansion_sign;
+  if (ExpansionCompareDistances(x, a, b, &expansion_sign)) {
+    EXPECT_EQ(exact_sign, expansion_sign);
+  }
   if (dbl_sign != 0) EXPECT_EQ(ld_sign, dbl_sign);
   if (ld_sign != 0) EXPECT_EQ(exact_sign, ld_sign);
   if (exact_sign != 0) {
@@ -1181,6 +1257,11 @@ Precision TestEdgeCircumcenterSignConsistency(
       ToLD(x0), ToLD(x1), ToLD(a), ToLD(b), ToLD(c), abc_sign);
   int exact_sign = ExactEdgeCircumcenterSign(
       ToExact(x0), ToExact(x1), ToExact(a), ToExact(b), ToExact(c), abc_sign);
+  int expansion_sign;
+  if (ExpansionEdgeCircumcenterSign(x0, x1, a, b, c, abc_sign,
+                                    &expansion_sign)) {
+    EXPECT_EQ(exact_sign, expansion_sign);
+  }
   if (dbl_sign != 0) EXPECT_EQ(ld_sign, dbl_sign);
   if (ld_sign != 0) EXPECT_EQ(exact_sign, ld_sign);
   if (exact_sign != 0) {
@@ -1424,4 +1505,33 @@ TEST(VoronoiSiteExclusion, Consistency) {
   S2_LOG(ERROR) << stats.ToString();
 }
 
+TEST(PredicateStats, CountsStages) {
+  ResetPredicateStats();
+  // Three distinct points that are exactly collinear (so that the exact
+  // determinant is zero), which requires symbolic perturbations.
+  S2Point a(0.72571927877036835, 0.46058825605889098, 0.51106749730504852);
+  S2Point b(0.7257192746638208, 0.46058826573818168, 0.51106749441312738);
+  S2Point c(0.72571927671709457, 0.46058826089853633, 0.51106749585908795);
+  Sign(a, b, c);
+  // Distances that are exactly equal, and distances that are very different.
+  S2Point x(1, 0, 0), y(0, 1, 0), z(0, 0, 1);
+  CompareDistances(x, y, z);
+  CompareDistances(x, x, y);
+
+  PredicateStats stats = GetPredicateStats();
+  int expected = PredicateStatsEnabled() ? 1 : 0;
+  EXPECT_EQ(expected,
+            stats.count(PredicateStats::SIGN, PredicateStats::SYMBOLIC));
+  EXPECT_EQ(0, stats.count(PredicateStats::SIGN, PredicateStats::EXACT));
+  EXPECT_EQ(expected, stats.count(PredicateStats::COMPARE_DISTANCES,
+                                  PredicateStats::SYMBOLIC));
+  EXPECT_EQ(expected, stats.count(PredicateStats::COMPARE_DISTANCES,
+                                  PredicateStats::DOUBLE));
+  EXPECT_EQ(0, stats.count(PredicateStats::COMPARE_DISTANCE,
+                           PredicateStats::DOUBLE));
+  ResetPredicateStats();
+  EXPECT_EQ(0, GetPredicateStats().count(PredicateStats::SIGN,
+                                         PredicateStats::SYMBOLIC));
+}
+
 }  // namespace s2pred
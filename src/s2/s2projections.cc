@@ -29,6 +29,22 @@ R2Point Projection::Interpolate(double f,
   return (1 - f) * a + f * b;
 }
 
+void Projection::ProjectPoints(S2PointSpan points,
+                               absl::Span<R2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  for (int i = 0; i < points.size(); ++i) {
+    output[i] = Project(points[i]);
+  }
+}
+
+void Projection::UnprojectPoints(absl::Span<const R2Point> points,
+                                 absl::Span<S2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  for (int i = 0; i < points.size(); ++i) {
+    output[i] = Unproject(points[i]);
+  }
+}
+
 PlateCarreeProjection::PlateCarreeProjection(double x_scale)
     : x_wrap_(2 * x_scale),
       to_radians_(M_PI / x_scale),
@@ -57,6 +73,33 @@ R2Point PlateCarreeProjection::wrap_distance() const {
   return R2Point(x_wrap_, 0);
 }
 
+// The batch methods below inline the S2LatLng conversions so that the loops
+// contain no function calls other than the math library functions.  They
+// give exactly the same results as Project() and Unproject().
+void PlateCarreeProjection::ProjectPoints(S2PointSpan points,
+                                          absl::Span<R2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  const double scale = from_radians_;
+  for (int i = 0; i < points.size(); ++i) {
+    const S2Point& p = points[i];
+    double lat = atan2(p.z(), sqrt(p.x() * p.x() + p.y() * p.y()));
+    double lng = atan2(p.y(), p.x());
+    output[i] = R2Point(scale * lng, scale * lat);
+  }
+}
+
+void PlateCarreeProjection::UnprojectPoints(
+    absl::Span<const R2Point> points, absl::Span<S2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  const double scale = to_radians_, wrap = x_wrap_;
+  for (int i = 0; i < points.size(); ++i) {
+    double lat = scale * points[i].y();
+    double lng = scale * remainder(points[i].x(), wrap);
+    double cos_lat = cos(lat);
+    output[i] = S2Point(cos(lng) * cos_lat, sin(lng) * cos_lat, sin(lat));
+  }
+}
+
 MercatorProjection::MercatorProjection(double max_x)
     : x_wrap_(2 * max_x),
       to_radians_(M_PI / max_x),
@@ -91,4 +134,47 @@ R2Point MercatorProjection::wrap_distance() const {
   return R2Point(x_wrap_, 0);
 }
 
+// Unlike Project() and Unproject(), the batch methods compute the Mercator
+// "y" coordinate directly from the point coordinates (and vice versa) rather
+// than computing the latitude first, which saves two trigonometric functions
+// per point.  The results agree with Project() and Unproject() to within
+// rounding errors, except that ProjectPoints() is more accurate near the
+// poles.
+void MercatorProjection::ProjectPoints(S2PointSpan points,
+                                       absl::Span<R2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  const double scale = from_radians_;
+  for (int i = 0; i < points.size(); ++i) {
+    const S2Point& p = points[i];
+    // With r = sqrt(x^2 + y^2), the formula 0.5 * log((1 + sin(phi)) /
+    // (1 - sin(phi))) used by FromLatLng() is equivalent to
+    // log((|p| + |z|) / r), with the sign of z.  This avoids the
+    // cancellation in (1 - sin(phi)) near the poles.
+    double r = sqrt(p.x() * p.x() + p.y() * p.y());
+    double y = std::copysign(log((p.Norm() + fabs(p.z())) / r), p.z());
+    output[i] = R2Point(scale * atan2(p.y(), p.x()), scale * y);
+  }
+}
+
+void MercatorProjection::UnprojectPoints(absl::Span<const R2Point> points,
+                                         absl::Span<S2Point> output) const {
+  S2_DCHECK_EQ(points.size(), output.size());
+  const double scale = to_radians_, wrap = x_wrap_;
+  for (int i = 0; i < points.size(); ++i) {
+    double lng = scale * remainder(points[i].x(), wrap);
+    // sin(phi) = tanh(y) = (k - 1) / (k + 1) and cos(phi) = sech(y) =
+    // 2 * sqrt(k) / (k + 1), where k = exp(2 * y).
+    double k = exp(2 * scale * points[i].y());
+    double sin_phi, cos_phi;
+    if (std::isinf(k)) {
+      sin_phi = 1;
+      cos_phi = 0;
+    } else {
+      sin_phi = (k - 1) / (k + 1);
+      cos_phi = 2 * sqrt(k) / (k + 1);
+    }
+    output[i] = S2Point(cos(lng) * cos_phi, sin(lng) * cos_phi, sin_phi);
+  }
+}
+
 }  // namespace S2
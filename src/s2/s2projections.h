@@ -25,6 +25,8 @@
 #include "s2/r2.h"
 #include "s2/s2latlng.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/third_party/absl/types/span.h"
 
 namespace S2 {
 
@@ -52,6 +54,22 @@ class Projection {
   // implementation may be more efficient.
   virtual S2LatLng ToLatLng(const R2Point& p) const = 0;
 
+  // Converts each of the given points on the sphere to a projected 2D point,
+  // i.e. output[i] = Project(points[i]).  Projections may override this to
+  // avoid the per-point overhead of Project(); the default implementation
+  // simply calls Project() for each point.
+  //
+  // REQUIRES: output.size() == points.size()
+  virtual void ProjectPoints(S2PointSpan points,
+                             absl::Span<R2Point> output) const;
+
+  // Converts each of the given projected 2D points to a point on the sphere,
+  // i.e. output[i] = Unproject(points[i]).  See ProjectPoints().
+  //
+  // REQUIRES: output.size() == points.size()
+  virtual void UnprojectPoints(absl::Span<const R2Point> points,
+                               absl::Span<S2Point> output) const;
+
   // Returns the point obtained by interpolating the given fraction of the
   // distance along the line from A to B.  Almost all projections should
   // use the default implementation of this method, which simply interpolates
@@ -108,6 +126,10 @@ class PlateCarreeProjection final : public Projection {
   R2Point FromLatLng(const S2LatLng& ll) const override;
   S2LatLng ToLatLng(const R2Point& p) const override;
   R2Point wrap_distance() const override;
+  void ProjectPoints(S2PointSpan points,
+                     absl::Span<R2Point> output) const override;
+  void UnprojectPoints(absl::Span<const R2Point> points,
+                       absl::Span<S2Point> output) const override;
 
  private:
   double x_wrap_;
@@ -141,6 +163,10 @@ class MercatorProjection final : public Projection {
   R2Point FromLatLng(const S2LatLng& ll) const override;
   S2LatLng ToLatLng(const R2Point& p) const override;
   R2Point wrap_distance() const override;
+  void ProjectPoints(S2PointSpan points,
+                     absl::Span<R2Point> output) const override;
+  void UnprojectPoints(absl::Span<const R2Point> points,
+                       absl::Span<S2Point> output) const override;
 
  private:
   double x_wrap_;
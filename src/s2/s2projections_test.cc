@@ -18,7 +18,10 @@
 #include "s2/s2projections.h"
 
 #include <limits>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "s2/third_party/absl/types/span.h"
 #include "s2/s2latlng.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -75,4 +78,46 @@ TEST(MercatorProjection, ProjectUnproject) {
                        S2LatLng::FromRadians(1, 0).ToPoint());
 }
 
+// Checks that the batch methods agree with Project() and Unproject() to
+// within "max_error" (relative to the magnitude of each coordinate).
+void TestBatchMethods(const Projection& projection, double max_error) {
+  std::vector<S2Point> points;
+  for (int i = 0; i < 1000; ++i) points.push_back(S2Testing::RandomPoint());
+  points.push_back(S2Point(1, 0, 0));
+  points.push_back(S2Point(0, 0, 1));
+  points.push_back(S2Point(0, 0, -1));
+  std::vector<R2Point> projected(points.size());
+  projection.ProjectPoints(points, absl::MakeSpan(projected));
+  for (int i = 0; i < points.size(); ++i) {
+    R2Point expected = projection.Project(points[i]);
+    if (std::isinf(expected.y())) {
+      EXPECT_EQ(expected, projected[i]);
+      continue;
+    }
+    EXPECT_NEAR(expected.x(), projected[i].x(),
+                max_error * std::max(1.0, fabs(expected.x())));
+    EXPECT_NEAR(expected.y(), projected[i].y(),
+                max_error * std::max(1.0, fabs(expected.y())));
+  }
+  std::vector<S2Point> unprojected(points.size());
+  projection.UnprojectPoints(projected, absl::MakeSpan(unprojected));
+  for (int i = 0; i < points.size(); ++i) {
+    S2Point expected = projection.Unproject(projected[i]);
+    EXPECT_LE((expected - unprojected[i]).Norm(), max_error);
+    EXPECT_TRUE(S2::ApproxEquals(points[i], unprojected[i],
+                                 S1Angle::Radians(1e-13))) << i;
+  }
+}
+
+TEST(PlateCarreeProjection, BatchMethods) {
+  // The batch methods should return exactly the same results.
+  TestBatchMethods(PlateCarreeProjection(180), 0);
+}
+
+TEST(MercatorProjection, BatchMethods) {
+  // Project() loses accuracy near the poles, where the "y" coordinate is
+  // large.
+  TestBatchMethods(MercatorProjection(180), 1e-10);
+}
+
 }  //  namespace S2
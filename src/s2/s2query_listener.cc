@@ -0,0 +1,41 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2query_listener.h"
+
+#include <atomic>
+
+namespace {
+
+std::atomic<S2QueryListener*> global_listener(nullptr);
+
+}  // namespace
+
+bool S2QueryListenerEnabled() {
+#ifdef S2_QUERY_LISTENER
+  return true;
+#else
+  return false;
+#endif
+}
+
+S2QueryListener* SetS2QueryListener(S2QueryListener* listener) {
+  return global_listener.exchange(listener, std::memory_order_acq_rel);
+}
+
+S2QueryListener* GetS2QueryListener() {
+  return global_listener.load(std::memory_order_acquire);
+}
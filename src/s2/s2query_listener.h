@@ -0,0 +1,183 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2QUERY_LISTENER_H_
+#define S2_S2QUERY_LISTENER_H_
+
+#include <chrono>
+
+#include "s2/s2query_stats.h"
+
+// S2QueryListener is an interface for exporting the latency of S2 operations
+// (e.g. as histograms in a metrics system) without instrumenting every call
+// site.  Once a listener is installed, it is called after every operation of
+// the following classes:
+//
+//   CONTAINS_POINT:    S2ContainsPointQuery::Contains(), ShapeContains(), and
+//                      VisitContainingShapes() (a batch counts as one call)
+//   CLOSEST_EDGES:     S2ClosestEdgeQuery::FindClosestEdge(s)(),
+//                      VisitClosestEdges() and the other distance methods
+//   CROSSING_EDGES:    S2CrossingEdgeQuery::GetCrossingEdges()
+//   REGION_COVERING:   S2RegionCoverer::GetCovering() and its variants,
+//                      except GetFastCovering()
+//   BOOLEAN_OPERATION: S2BooleanOperation::Build()
+//
+// Operations that use other operations internally also report those (e.g.
+// S2BooleanOperation uses S2ContainsPointQuery and S2CrossingEdgeQuery).
+//
+// Instrumentation is compiled in only if the library was compiled with
+// S2_QUERY_LISTENER defined (see the WITH_QUERY_LISTENER CMake option).
+// Otherwise the hooks compile to nothing and listeners are never called.
+// Since S2ContainsPointQuery and S2ClosestEdgeQueryBase are templates, code
+// that uses them must be compiled with the same setting.
+// When compiled in but no listener is installed, each operation costs one
+// atomic load.
+//
+// Example usage:
+//
+//   class MyListener : public S2QueryListener {
+//    public:
+//     void OnOperation(Operation operation, std::chrono::nanoseconds duration,
+//                      const S2QueryStats& stats) override {
+//       histograms_[static_cast<int>(operation)].Add(duration.count());
+//     }
+//   };
+//   static MyListener* listener = new MyListener;
+//   SetS2QueryListener(listener);
+class S2QueryListener {
+ public:
+  enum class Operation {
+    CONTAINS_POINT,
+    CLOSEST_EDGES,
+    CROSSING_EDGES,
+    REGION_COVERING,
+    BOOLEAN_OPERATION,
+  };
+
+  virtual ~S2QueryListener() {}
+
+  // Called when an operation finishes.  "stats" contains the work counters
+  // that the operation added to the S2QueryStats object of its options (see
+  // S2ContainsPointQueryOptions::set_stats, etc), if one was specified.
+  // Otherwise num_queries is 1 and the remaining counters are zero, except
+  // that CROSSING_EDGES sets num_edges_tested to the number of candidate
+  // edges and REGION_COVERING sets num_cells_visited to the number of
+  // candidate cells.
+  //
+  // This method may be called concurrently from multiple threads, and it is
+  // called in the thread that performed the operation.
+  virtual void OnOperation(Operation operation,
+                           std::chrono::nanoseconds duration,
+                           const S2QueryStats& stats) = 0;
+};
+
+// Returns true if the library was compiled with S2_QUERY_LISTENER defined.
+bool S2QueryListenerEnabled();
+
+// Installs "listener" as the global listener (which is not owned), and
+// returns the previous listener.  A null listener disables reporting.  The
+// listener must persist until it is replaced and all operations that started
+// while it was installed have finished.
+S2QueryListener* SetS2QueryListener(S2QueryListener* listener);
+
+// Returns the current global listener, or nullptr if there is none.
+S2QueryListener* GetS2QueryListener();
+
+// S2QueryTimer reports a single operation to the global listener when it is
+// destroyed.  This class is used internally by the operations listed above.
+class S2QueryTimer {
+ public:
+  // Starts timing an operation.  "stats" is the S2QueryStats object (if any)
+  // that the operation adds its work counters to.
+  explicit S2QueryTimer(S2QueryListener::Operation operation,
+                        const S2QueryStats* stats = nullptr);
+
+  // Reports the operation to the listener, if any.
+  ~S2QueryTimer();
+
+  // Returns the counters to report when no S2QueryStats object was given to
+  // the constructor, or nullptr if the operation will not be reported.
+  S2QueryStats* extra_stats();
+
+ private:
+#ifdef S2_QUERY_LISTENER
+  using Clock = std::chrono::steady_clock;
+  S2QueryListener::Operation operation_;
+  S2QueryListener* listener_;
+  const S2QueryStats* stats_;
+  S2QueryStats start_stats_;
+  S2QueryStats extra_stats_;
+  Clock::time_point start_;
+#endif
+
+  S2QueryTimer(const S2QueryTimer&) = delete;
+  void operator=(const S2QueryTimer&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+#ifdef S2_QUERY_LISTENER
+
+inline S2QueryTimer::S2QueryTimer(S2QueryListener::Operation operation,
+                                  const S2QueryStats* stats)
+    : operation_(operation), listener_(GetS2QueryListener()), stats_(stats) {
+  if (listener_ == nullptr) return;
+  if (stats_) start_stats_ = *stats_;
+  extra_stats_.num_queries = 1;
+  start_ = Clock::now();
+}
+
+inline S2QueryTimer::~S2QueryTimer() {
+  if (listener_ == nullptr) return;
+  auto duration = Clock::now() - start_;
+  S2QueryStats stats = extra_stats_;
+  if (stats_) {
+    stats.num_queries = stats_->num_queries - start_stats_.num_queries;
+    stats.num_brute_force_queries =
+        stats_->num_brute_force_queries - start_stats_.num_brute_force_queries;
+    stats.num_cells_visited =
+        stats_->num_cells_visited - start_stats_.num_cells_visited;
+    stats.num_edges_tested =
+        stats_->num_edges_tested - start_stats_.num_edges_tested;
+    stats.max_queue_size = stats_->max_queue_size;
+  }
+  listener_->OnOperation(
+      operation_,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration), stats);
+}
+
+inline S2QueryStats* S2QueryTimer::extra_stats() {
+  return (listener_ && !stats_) ? &extra_stats_ : nullptr;
+}
+
+#else  // !defined(S2_QUERY_LISTENER)
+
+inline S2QueryTimer::S2QueryTimer(S2QueryListener::Operation operation,
+                                  const S2QueryStats* stats) {
+}
+
+inline S2QueryTimer::~S2QueryTimer() {
+}
+
+inline S2QueryStats* S2QueryTimer::extra_stats() {
+  return nullptr;
+}
+
+#endif  // !defined(S2_QUERY_LISTENER)
+
+#endif  // S2_S2QUERY_LISTENER_H_
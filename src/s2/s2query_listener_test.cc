@@ -0,0 +1,162 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2query_listener.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2crossing_edge_query.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2text_format.h"
+
+using std::vector;
+using Operation = S2QueryListener::Operation;
+
+namespace {
+
+class RecordingListener : public S2QueryListener {
+ public:
+  void OnOperation(Operation operation, std::chrono::nanoseconds duration,
+                   const S2QueryStats& stats) override {
+    EXPECT_GE(duration.count(), 0);
+    operations.push_back(operation);
+    last_stats = stats;
+  }
+
+  vector<Operation> operations;
+  S2QueryStats last_stats;
+};
+
+// Installs a RecordingListener for the lifetime of this object.
+class ScopedListener {
+ public:
+  ScopedListener() { EXPECT_EQ(nullptr, SetS2QueryListener(&listener_)); }
+  ~ScopedListener() { EXPECT_EQ(&listener_, SetS2QueryListener(nullptr)); }
+
+  // Returns the operations reported so far, and clears them.
+  vector<Operation> TakeOperations() {
+    vector<Operation> result;
+    result.swap(listener_.operations);
+    return result;
+  }
+
+  const S2QueryStats& last_stats() const { return listener_.last_stats; }
+
+ private:
+  RecordingListener listener_;
+};
+
+// Returns the expected list of operations, given the list that would be
+// reported if instrumentation is compiled in.
+vector<Operation> Expected(vector<Operation> operations) {
+  if (!S2QueryListenerEnabled()) operations.clear();
+  return operations;
+}
+
+// Returns the number of times "operation" occurs in "operations".
+int Count(const vector<Operation>& operations, Operation operation) {
+  return std::count(operations.begin(), operations.end(), operation);
+}
+
+TEST(S2QueryListener, NoListenerByDefault) {
+  EXPECT_EQ(nullptr, GetS2QueryListener());
+}
+
+TEST(S2QueryListener, ContainsPointQuery) {
+  auto index = s2textformat::MakeIndexOrDie("# # 0:0, 0:5, 5:5, 5:0");
+  ScopedListener listener;
+  S2QueryStats stats;
+  S2ContainsPointQueryOptions options;
+  options.set_stats(&stats);
+  auto query = MakeS2ContainsPointQuery(index.get(), options);
+  EXPECT_TRUE(query.Contains(s2textformat::MakePointOrDie("1:1")));
+  EXPECT_EQ(Expected({Operation::CONTAINS_POINT}),
+            listener.TakeOperations());
+  if (S2QueryListenerEnabled()) {
+    EXPECT_EQ(1, listener.last_stats().num_queries);
+    EXPECT_EQ(stats.num_edges_tested, listener.last_stats().num_edges_tested);
+  }
+  vector<S2Point> points(10, s2textformat::MakePointOrDie("1:1"));
+  vector<bool> results;
+  query.Contains(points, &results);
+  EXPECT_EQ(Expected({Operation::CONTAINS_POINT}),
+            listener.TakeOperations());
+  if (S2QueryListenerEnabled()) {
+    EXPECT_EQ(10, listener.last_stats().num_queries);
+  }
+}
+
+TEST(S2QueryListener, ClosestEdgeQuery) {
+  auto index = s2textformat::MakeIndexOrDie("# 0:0, 1:1 #");
+  ScopedListener listener;
+  S2ClosestEdgeQuery::Options options;
+  options.set_max_results(2);
+  S2ClosestEdgeQuery query(index.get(), options);
+  S2ClosestEdgeQuery::PointTarget target(s2textformat::MakePointOrDie("2:2"));
+  query.FindClosestEdge(&target);
+  query.FindClosestEdges(&target);
+  // The query also reports the point containment queries it runs in order to
+  // find polygons that contain the target.
+  EXPECT_EQ(S2QueryListenerEnabled() ? 2 : 0,
+            Count(listener.TakeOperations(), Operation::CLOSEST_EDGES));
+}
+
+TEST(S2QueryListener, CrossingEdgeQuery) {
+  auto index = s2textformat::MakeIndexOrDie("# 0:0, 1:1 #");
+  ScopedListener listener;
+  S2CrossingEdgeQuery query(index.get());
+  EXPECT_EQ(1, query.GetCrossingEdges(s2textformat::MakePointOrDie("0:1"),
+                                      s2textformat::MakePointOrDie("1:0"),
+                                      s2shapeutil::CrossingType::ALL).size());
+  EXPECT_EQ(Expected({Operation::CROSSING_EDGES}), listener.TakeOperations());
+  if (S2QueryListenerEnabled()) {
+    EXPECT_EQ(1, listener.last_stats().num_edges_tested);
+  }
+}
+
+TEST(S2QueryListener, RegionCoverer) {
+  ScopedListener listener;
+  S2RegionCoverer coverer;
+  S2CellUnion covering = coverer.GetCovering(
+      S2Cap(S2Point(1, 0, 0), S1Angle::Degrees(1)));
+  EXPECT_FALSE(covering.empty());
+  EXPECT_EQ(Expected({Operation::REGION_COVERING}),
+            listener.TakeOperations());
+  if (S2QueryListenerEnabled()) {
+    EXPECT_GT(listener.last_stats().num_cells_visited, 0);
+  }
+}
+
+TEST(S2QueryListener, BooleanOperation) {
+  auto a = s2textformat::MakeIndexOrDie("# # 0:0, 0:5, 5:5, 5:0");
+  auto b = s2textformat::MakeIndexOrDie("# # 1:1, 1:2, 2:2, 2:1");
+  ScopedListener listener;
+  EXPECT_TRUE(S2BooleanOperation::Contains(*a, *b));
+  // The operation also uses other queries internally.
+  EXPECT_EQ(S2QueryListenerEnabled() ? 1 : 0,
+            Count(listener.TakeOperations(), Operation::BOOLEAN_OPERATION));
+}
+
+}  // namespace
@@ -0,0 +1,84 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2QUERY_STATS_H_
+#define S2_S2QUERY_STATS_H_
+
+#include <algorithm>
+
+#include "s2/third_party/absl/base/integral_types.h"
+
+// S2QueryStats collects statistics about the work done by S2ClosestEdgeQuery,
+// S2ClosestPointQuery, S2ClosestCellQuery, and S2ContainsPointQuery.  This is
+// useful for tuning index and query options (e.g.,
+// MutableS2ShapeIndex::Options::max_edges_per_cell) for a given workload.
+//
+// Statistics are collected only if an S2QueryStats object is specified by
+// calling set_stats() on the query options.  The statistics of each query
+// are added to the existing values, so that they can be accumulated over
+// many queries.  An S2QueryStats object may be shared by several query
+// objects, but not by queries that are running concurrently.
+//
+// Example usage:
+//
+//   S2QueryStats stats;
+//   S2ClosestEdgeQuery query(&index);
+//   query.mutable_options()->set_stats(&stats);
+//   for (const S2Point& point : points) {
+//     S2ClosestEdgeQuery::PointTarget target(point);
+//     query.FindClosestEdge(&target);
+//   }
+//   double edges_per_query =
+//       static_cast<double>(stats.num_edges_tested) / stats.num_queries;
+struct S2QueryStats {
+  // The number of queries.
+  int64 num_queries = 0;
+
+  // The number of queries that were answered by testing every edge (or
+  // point or cell) in the index rather than by traversing the index cells
+  // near the target.
+  int64 num_brute_force_queries = 0;
+
+  // The number of index cells whose contents were examined.
+  int64 num_cells_visited = 0;
+
+  // The number of edges whose distance to the target was computed, or whose
+  // crossing with a line segment was tested by S2ContainsPointQuery.  For
+  // S2ClosestPointQuery and S2ClosestCellQuery, the number of points or cells
+  // whose distance to the target was computed.
+  int64 num_edges_tested = 0;
+
+  // The maximum number of entries in the priority queue of any query.
+  int64 max_queue_size = 0;
+
+  // Resets all statistics to zero.
+  void Clear() { *this = S2QueryStats(); }
+
+  // Adds the statistics in "other" to this object.
+  void Add(const S2QueryStats& other) {
+    num_queries += other.num_queries;
+    num_brute_force_queries += other.num_brute_force_queries;
+    num_cells_visited += other.num_cells_visited;
+    num_edges_tested += other.num_edges_tested;
+    max_queue_size = std::max(max_queue_size, other.max_queue_size);
+  }
+
+  // Records that the priority queue contains "size" entries.
+  void UpdateQueueSize(int64 size) {
+    max_queue_size = std::max(max_queue_size, size);
+  }
+};
+
+#endif  // S2_S2QUERY_STATS_H_
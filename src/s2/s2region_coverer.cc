@@ -18,21 +18,30 @@
 #include "s2/s2region_coverer.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <memory>
 #include <queue>
 #include <unordered_set>
 #include <vector>
 
 #include "s2/base/logging.h"
+#include "s2/base/spinlock.h"
 #include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2latlng_rect.h"
 #include "s2/s2metrics.h"
+#include "s2/s2polygon.h"
+#include "s2/s2query_listener.h"
 #include "s2/s2region.h"
 #include "s2/third_party/absl/base/casts.h"
+#include "s2/third_party/absl/container/fixed_array.h"
+#include "s2/third_party/absl/container/inlined_vector.h"
+#include "s2/util/thread/executor.h"
 
 using std::is_sorted;
 using std::max;
@@ -88,38 +97,75 @@ int S2RegionCoverer::Options::true_max_level() const {
   return max_level_ - (max_level_ - min_level_) % level_mod_;
 }
 
-S2RegionCoverer::Candidate* S2RegionCoverer::NewCandidate(const S2Cell& cell) {
-  if (!region_->MayIntersect(cell)) return nullptr;
+namespace {
+
+// These functions call the MayIntersect() and Contains() methods of "Region"
+// itself, so that they are not dispatched through S2Region's vtable (unless
+// Region is S2Region).
+template <class Region>
+inline bool RegionMayIntersect(const Region& region, const S2Cell& cell) {
+  return region.Region::MayIntersect(cell);
+}
+
+template <class Region>
+inline bool RegionContains(const Region& region, const S2Cell& cell) {
+  return region.Region::Contains(cell);
+}
+
+template <>
+inline bool RegionMayIntersect(const S2Region& region, const S2Cell& cell) {
+  return region.MayIntersect(cell);
+}
+
+template <>
+inline bool RegionContains(const S2Region& region, const S2Cell& cell) {
+  return region.Contains(cell);
+}
+
+}  // namespace
+
+template <class Region>
+S2RegionCoverer::Candidate* S2RegionCoverer::NewCandidate(
+    const Region& region, const S2Cell& cell) const {
+  if (!RegionMayIntersect(region, cell)) return nullptr;
 
   bool is_terminal = false;
   if (cell.level() >= options_.min_level()) {
     if (interior_covering_) {
-      if (region_->Contains(cell)) {
+      if (RegionContains(region, cell)) {
         is_terminal = true;
       } else if (cell.level() + options_.level_mod() > options_.max_level()) {
         return nullptr;
       }
     } else {
       if (cell.level() + options_.level_mod() > options_.max_level() ||
-          region_->Contains(cell)) {
+          RegionContains(region, cell)) {
         is_terminal = true;
       }
     }
   }
-  size_t children_size = 0;
-  if (!is_terminal) {
-    children_size = sizeof(Candidate*) << max_children_shift();
+  int pool_index = is_terminal ? 0 : options_.level_mod();
+  auto* free_list = &free_candidates_[pool_index];
+  Candidate* candidate;
+  if (options_.executor() == nullptr && !free_list->empty()) {
+    candidate = free_list->back().release();
+    free_list->pop_back();
+  } else {
+    size_t children_size = 0;
+    if (!is_terminal) {
+      children_size = sizeof(Candidate*) << max_children_shift();
+    }
+    candidate = static_cast<Candidate*>(
+        ::operator new(sizeof(Candidate) + children_size));
   }
-  Candidate* candidate = static_cast<Candidate*>(
-      ::operator new(sizeof(Candidate) + children_size));
   candidate->cell = cell;
   candidate->is_terminal = is_terminal;
+  candidate->pool_index = pool_index;
   candidate->num_children = 0;
   if (!is_terminal) {
     std::fill_n(&candidate->children[0], 1 << max_children_shift(),
                 absl::implicit_cast<Candidate*>(nullptr));
   }
-  ++candidates_created_counter_;
   return candidate;
 }
 
@@ -129,23 +175,25 @@ void S2RegionCoverer::DeleteCandidate(Candidate* candidate,
     for (int i = 0; i < candidate->num_children; ++i)
       DeleteCandidate(candidate->children[i], true);
   }
-  ::operator delete(candidate);
+  free_candidates_[candidate->pool_index].emplace_back(candidate);
 }
 
-int S2RegionCoverer::ExpandChildren(Candidate* candidate,
-                                    const S2Cell& cell, int num_levels) {
+template <class Region>
+int S2RegionCoverer::ExpandChildren(const Region& region, Candidate* candidate,
+                                    const S2Cell& cell, int num_levels) const {
   num_levels--;
   S2Cell child_cells[4];
   cell.Subdivide(child_cells);
   int num_terminals = 0;
   for (int i = 0; i < 4; ++i) {
     if (num_levels > 0) {
-      if (region_->MayIntersect(child_cells[i])) {
-        num_terminals += ExpandChildren(candidate, child_cells[i], num_levels);
+      if (RegionMayIntersect(region, child_cells[i])) {
+        num_terminals += ExpandChildren(region, candidate, child_cells[i],
+                                        num_levels);
       }
       continue;
     }
-    Candidate* child = NewCandidate(child_cells[i]);
+    Candidate* child = NewCandidate(region, child_cells[i]);
     if (child) {
       candidate->children[candidate->num_children++] = child;
       if (child->is_terminal) ++num_terminals;
@@ -154,7 +202,9 @@ int S2RegionCoverer::ExpandChildren(Candidate* candidate,
   return num_terminals;
 }
 
-void S2RegionCoverer::AddCandidate(Candidate* candidate) {
+template <class Region>
+void S2RegionCoverer::AddCandidate(const Region& region,
+                                   Candidate* candidate) {
   if (candidate == nullptr) return;
 
   if (candidate->is_terminal) {
@@ -162,14 +212,50 @@ void S2RegionCoverer::AddCandidate(Candidate* candidate) {
     DeleteCandidate(candidate, true);
     return;
   }
+  AddExpandedCandidate(region, candidate, ExpandCandidate(region, candidate));
+}
+
+template <class Region>
+void S2RegionCoverer::AddCandidates(const Region& region,
+                                    Candidate* const* candidates,
+                                    int num_candidates) {
+  // Only the calls to the region are done concurrently.  The candidates are
+  // then added in their original order so that the result is the same as
+  // calling AddCandidate() on each one.
+  absl::FixedArray<int> num_terminals(num_candidates, -1);
+  ParallelFor(options_.executor(), num_candidates,
+              [this, &region, candidates, &num_terminals](int i) {
+    if (candidates[i] != nullptr && !candidates[i]->is_terminal) {
+      num_terminals[i] = ExpandCandidate(region, candidates[i]);
+    }
+  });
+  for (int i = 0; i < num_candidates; ++i) {
+    if (num_terminals[i] < 0) {
+      AddCandidate(region, candidates[i]);
+    } else {
+      AddExpandedCandidate(region, candidates[i], num_terminals[i]);
+    }
+  }
+}
+
+template <class Region>
+int S2RegionCoverer::ExpandCandidate(const Region& region,
+                                     Candidate* candidate) const {
+  S2_DCHECK(!candidate->is_terminal);
   S2_DCHECK_EQ(0, candidate->num_children);
 
   // Expand one level at a time until we hit min_level() to ensure that we
   // don't skip over it.
   int num_levels = ((candidate->cell.level() < options_.min_level()) ?
                     1 : options_.level_mod());
-  int num_terminals = ExpandChildren(candidate, candidate->cell, num_levels);
+  return ExpandChildren(region, candidate, candidate->cell, num_levels);
+}
 
+template <class Region>
+void S2RegionCoverer::AddExpandedCandidate(const Region& region,
+                                           Candidate* candidate,
+                                           int num_terminals) {
+  candidates_created_counter_ += candidate->num_children;
   if (candidate->num_children == 0) {
     DeleteCandidate(candidate, false);
 
@@ -181,7 +267,7 @@ void S2RegionCoverer::AddCandidate(Candidate* candidate) {
     // intersect the region, but may not be contained by it - we need to
     // subdivide them further.
     candidate->is_terminal = true;
-    AddCandidate(candidate);
+    AddCandidate(region, candidate);
 
   } else {
     // We negate the priority so that smaller absolute priorities are returned
@@ -221,23 +307,33 @@ void S2RegionCoverer::AdjustCellLevels(vector<S2CellId>* cells) const {
   cells->resize(out);
 }
 
-void S2RegionCoverer::GetInitialCandidates() {
+template <class Region>
+void S2RegionCoverer::GetInitialCandidates(const Region& region) {
   // Optimization: start with a small (usually 4 cell) covering of the
   // region's bounding cap.
   S2RegionCoverer tmp_coverer;
   tmp_coverer.mutable_options()->set_max_cells(min(4, options_.max_cells()));
   tmp_coverer.mutable_options()->set_max_level(options_.max_level());
-  vector<S2CellId> cells;
-  tmp_coverer.GetFastCovering(*region_, &cells);
-  AdjustCellLevels(&cells);
-  for (S2CellId cell_id : cells) {
-    AddCandidate(NewCandidate(S2Cell(cell_id)));
+  // (The S2Region version is used even for S2Cap and S2LatLngRect, so that
+  // the result does not depend on the static type of the region.)
+  tmp_coverer.GetFastCovering(static_cast<const S2Region&>(region),
+                              &initial_cells_);
+  AdjustCellLevels(&initial_cells_);
+  absl::InlinedVector<Candidate*, 8> candidates;
+  for (S2CellId cell_id : initial_cells_) {
+    Candidate* candidate = NewCandidate(region, S2Cell(cell_id));
+    if (candidate == nullptr) continue;
+    ++candidates_created_counter_;
+    candidates.push_back(candidate);
   }
+  AddCandidates(region, candidates.data(), candidates.size());
 }
 
-void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
+template <class Region>
+void S2RegionCoverer::GetCoveringInternal(const Region& region) {
   // We check this on each call because of mutable_options().
   S2_DCHECK_LE(options_.min_level(), options_.max_level());
+  S2QueryTimer timer(S2QueryListener::Operation::REGION_COVERING);
 
   // Strategy: Start with the 6 faces of the cube.  Discard any
   // that do not intersect the shape.  Then repeatedly choose the
@@ -255,10 +351,9 @@ void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
 
   S2_DCHECK(pq_.empty());
   S2_DCHECK(result_.empty());
-  region_ = &region;
   candidates_created_counter_ = 0;
 
-  GetInitialCandidates();
+  GetInitialCandidates(region);
   while (!pq_.empty() &&
          (!interior_covering_ || result_.size() < options_.max_cells())) {
     Candidate* candidate = pq_.top().second;
@@ -277,28 +372,39 @@ void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
         candidate->num_children == 1 ||
         (result_.size() + pq_.size() + candidate->num_children <=
          options_.max_cells())) {
-      // Expand this candidate into its children.
+      // Expand this candidate into its children.  Each child adds at most
+      // one cell to result_, so the children can be expanded concurrently
+      // unless some of them might be discarded below.
+      if (options_.executor() != nullptr &&
+          (!interior_covering_ ||
+           result_.size() + candidate->num_children <= options_.max_cells())) {
+        AddCandidates(region, candidate->children, candidate->num_children);
+        DeleteCandidate(candidate, false);
+        continue;
+      }
       for (int i = 0; i < candidate->num_children; ++i) {
         if (interior_covering_ && result_.size() >= options_.max_cells()) {
           DeleteCandidate(candidate->children[i], true);
         } else {
-          AddCandidate(candidate->children[i]);
+          AddCandidate(region, candidate->children[i]);
         }
       }
       DeleteCandidate(candidate, false);
     } else {
       candidate->is_terminal = true;
-      AddCandidate(candidate);
+      AddCandidate(region, candidate);
     }
   }
   S2_VLOG(2) << "Created " << result_.size() << " cells, " <<
       candidates_created_counter_ << " candidates created, " <<
       pq_.size() << " left";
+  if (S2QueryStats* stats = timer.extra_stats()) {
+    stats->num_cells_visited = candidates_created_counter_;
+  }
   while (!pq_.empty()) {
     DeleteCandidate(pq_.top().second, true);
     pq_.pop();
   }
-  region_ = nullptr;
 
   // Rather than just returning the raw list of cell ids, we construct a cell
   // union and then denormalize it.  This has the effect of replacing four
@@ -308,13 +414,20 @@ void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
   // compared to computing the covering in the first place.
   S2CellUnion::Normalize(&result_);
   if (options_.min_level() > 0 || options_.level_mod() > 1) {
-    auto result_copy = result_;
-    S2CellUnion::Denormalize(result_copy, options_.min_level(),
+    tmp_result_.swap(result_);
+    S2CellUnion::Denormalize(tmp_result_, options_.min_level(),
                              options_.level_mod(), &result_);
   }
   S2_DCHECK(IsCanonical(result_));
 }
 
+// Instantiate the region types supported by S2RegionCovererT.
+template void S2RegionCoverer::GetCoveringInternal(const S2Region& region);
+template void S2RegionCoverer::GetCoveringInternal(const S2Cap& region);
+template void S2RegionCoverer::GetCoveringInternal(const S2LatLngRect& region);
+template void S2RegionCoverer::GetCoveringInternal(const S2Polygon& region);
+template void S2RegionCoverer::GetCoveringInternal(const S2CellUnion& region);
+
 void S2RegionCoverer::GetCovering(const S2Region& region,
                                   vector<S2CellId>* covering) {
   interior_covering_ = false;
@@ -329,6 +442,35 @@ void S2RegionCoverer::GetInteriorCovering(const S2Region& region,
   *interior = std::move(result_);
 }
 
+void S2RegionCoverer::GetCoverings(absl::Span<const S2Region* const> regions,
+                                   vector<S2CellId>* cell_ids,
+                                   vector<int>* offsets) {
+  interior_covering_ = false;
+  GetCoveringsInternal(regions, cell_ids, offsets);
+}
+
+void S2RegionCoverer::GetInteriorCoverings(
+    absl::Span<const S2Region* const> regions, vector<S2CellId>* cell_ids,
+    vector<int>* offsets) {
+  interior_covering_ = true;
+  GetCoveringsInternal(regions, cell_ids, offsets);
+}
+
+void S2RegionCoverer::GetCoveringsInternal(
+    absl::Span<const S2Region* const> regions, vector<S2CellId>* cell_ids,
+    vector<int>* offsets) {
+  cell_ids->clear();
+  offsets->clear();
+  offsets->reserve(regions.size() + 1);
+  offsets->push_back(0);
+  for (const S2Region* region : regions) {
+    GetCoveringInternal(*region);
+    cell_ids->insert(cell_ids->end(), result_.begin(), result_.end());
+    offsets->push_back(cell_ids->size());
+    result_.clear();  // Keeps the capacity for the next region.
+  }
+}
+
 S2CellUnion S2RegionCoverer::GetCovering(const S2Region& region) {
   interior_covering_ = false;
   GetCoveringInternal(region);
@@ -347,6 +489,89 @@ void S2RegionCoverer::GetFastCovering(const S2Region& region,
   CanonicalizeCovering(covering);
 }
 
+void S2RegionCoverer::GetFastCovering(const S2Cap& cap,
+                                      vector<S2CellId>* covering) {
+  GetLevelByLevelCovering(cap, covering);
+}
+
+void S2RegionCoverer::GetFastCovering(const S2LatLngRect& rect,
+                                      vector<S2CellId>* covering) {
+  GetLevelByLevelCovering(rect, covering);
+}
+
+template <class Region>
+void S2RegionCoverer::GetLevelByLevelCovering(const Region& region,
+                                              vector<S2CellId>* covering) {
+  // We check this on each call because of mutable_options().
+  S2_DCHECK_LE(options_.min_level(), options_.max_level());
+  const int max_level = options_.max_level();
+  const int min_level = options_.min_level();
+  const int max_cells = options_.max_cells();
+
+  // Start with the cells of the region's cell union bound (at most a few)
+  // that intersect the region.  Cells that are contained by the region or
+  // have reached max_level() are "terminal" and are never subdivided.
+  vector<S2CellId> bound;
+  region.GetCellUnionBound(&bound);
+  covering->clear();
+  for (S2CellId id : bound) {
+    if (id.level() > max_level) id = id.parent(max_level);
+    if (region.MayIntersect(S2Cell(id))) covering->push_back(id);
+  }
+  S2CellUnion::Normalize(covering);
+  vector<bool> terminal;
+  for (S2CellId id : *covering) {
+    terminal.push_back(id.level() >= max_level ||
+                       region.Contains(S2Cell(id)));
+  }
+
+  // Each pass subdivides the non-terminal cells at the coarsest level
+  // present, visiting them in S2CellId order.  A cell is subdivided only if
+  // its intersecting children fit within max_cells() (or if it is smaller
+  // than min_level()); otherwise it becomes terminal.
+  vector<S2CellId> next;
+  vector<bool> next_terminal;
+  for (;;) {
+    int level = S2CellId::kMaxLevel + 1;
+    for (int i = 0; i < covering->size(); ++i) {
+      if (!terminal[i]) level = min(level, (*covering)[i].level());
+    }
+    if (level > S2CellId::kMaxLevel) break;
+    next.clear();
+    next_terminal.clear();
+    int size = covering->size();
+    for (int i = 0; i < covering->size(); ++i) {
+      S2CellId id = (*covering)[i];
+      if (terminal[i] || id.level() != level) {
+        next.push_back(id);
+        next_terminal.push_back(terminal[i]);
+        continue;
+      }
+      S2Cell children[4];
+      S2Cell(id).Subdivide(children);
+      int num_children = 0;
+      for (const S2Cell& child : children) {
+        if (region.MayIntersect(child)) children[num_children++] = child;
+      }
+      if (level < min_level || size - 1 + num_children <= max_cells) {
+        size += num_children - 1;
+        for (int j = 0; j < num_children; ++j) {
+          next.push_back(children[j].id());
+          next_terminal.push_back(children[j].level() >= max_level ||
+                                  region.Contains(children[j]));
+        }
+      } else {
+        next.push_back(id);
+        next_terminal.push_back(true);
+      }
+    }
+    covering->swap(next);
+    terminal.swap(next_terminal);
+  }
+  // Enforce level_mod() and min_level(), and merge cells if necessary.
+  CanonicalizeCovering(covering);
+}
+
 bool S2RegionCoverer::IsCanonical(const S2CellUnion& covering) const {
   return IsCanonical(covering.cell_ids());
 }
@@ -524,3 +749,140 @@ void S2RegionCoverer::GetSimpleCovering(
     int level, vector<S2CellId>* output) {
   return FloodFill(region, S2CellId(start).parent(level), output);
 }
+
+namespace {
+
+// A set of S2CellIds at a fixed level that supports concurrent insertion.
+// Cells within the S2CellId range spanned by the region's cell union bound
+// are recorded in a bitmap (one bit per cell), while all other cells are
+// recorded in a hash set partitioned into independently locked shards.
+class ConcurrentCellSet {
+ public:
+  ConcurrentCellSet(const S2Region& region, int level);
+
+  // Inserts "id" and returns true if it was not already present.
+  // REQUIRES: "id" is at the level given to the constructor.
+  bool Insert(S2CellId id);
+
+ private:
+  static constexpr int kShardBits = 6;
+
+  // The maximum number of cells that are recorded in the bitmap (8MB).
+  static constexpr uint64 kMaxBitmapCells = uint64{1} << 26;
+
+  struct Shard {
+    SpinLock lock;
+    unordered_set<S2CellId, S2CellIdHash> cells;  // Guarded by "lock".
+  };
+
+  // The bitmap records the cells in the range [begin_, begin_ + num_cells_)
+  // at the given level, where a cell's index is (id - begin_) >> shift_.
+  S2CellId begin_;
+  uint64 num_cells_ = 0;
+  int shift_;
+  std::unique_ptr<std::atomic<uint64>[]> bitmap_;
+
+  Shard shards_[1 << kShardBits];
+
+  ConcurrentCellSet(const ConcurrentCellSet&) = delete;
+  void operator=(const ConcurrentCellSet&) = delete;
+};
+
+ConcurrentCellSet::ConcurrentCellSet(const S2Region& region, int level)
+    : shift_(2 * (S2CellId::kMaxLevel - level) + 1) {
+  vector<S2CellId> bound;
+  region.GetCellUnionBound(&bound);
+  if (bound.empty()) return;
+  S2CellId lo = bound[0].range_min(), hi = bound[0].range_max();
+  for (S2CellId id : bound) {
+    lo = min(lo, id.range_min());
+    hi = max(hi, id.range_max());
+  }
+  S2CellId begin = lo.parent(level);
+  uint64 num_cells = ((hi.parent(level).id() - begin.id()) >> shift_) + 1;
+  if (num_cells > kMaxBitmapCells) return;
+
+  begin_ = begin;
+  num_cells_ = num_cells;
+  size_t num_words = (num_cells + 63) >> 6;
+  bitmap_.reset(new std::atomic<uint64>[num_words]);
+  for (size_t i = 0; i < num_words; ++i) {
+    bitmap_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+bool ConcurrentCellSet::Insert(S2CellId id) {
+  if (id >= begin_) {
+    uint64 index = (id.id() - begin_.id()) >> shift_;
+    if (index < num_cells_) {
+      uint64 bit = uint64{1} << (index & 63);
+      uint64 old = bitmap_[index >> 6].fetch_or(bit,
+                                                std::memory_order_relaxed);
+      return (old & bit) == 0;
+    }
+  }
+  // S2CellIdHash does not mix the bits, so we use Fibonacci hashing to pick
+  // the shard.
+  uint64 hash = id.id() * 0x9e3779b97f4a7c15ULL;
+  Shard* shard = &shards_[hash >> (64 - kShardBits)];
+  shard->lock.Lock();
+  bool inserted = shard->cells.insert(id).second;
+  shard->lock.Unlock();
+  return inserted;
+}
+
+constexpr int ConcurrentCellSet::kShardBits;
+constexpr uint64 ConcurrentCellSet::kMaxBitmapCells;
+
+}  // namespace
+
+void S2RegionCoverer::FloodFill(const S2Region& region, S2CellId start,
+                                Executor* executor,
+                                vector<S2CellId>* output) {
+  if (executor == nullptr) return FloodFill(region, start, output);
+
+  // The cells are visited in breadth-first order.  Each step tests all the
+  // cells of the current frontier concurrently, after sorting them and
+  // partitioning them into ranges of consecutive S2CellIds so that each task
+  // processes a spatially compact group of cells.
+  static const int kMinCellsPerTask = 64;
+  ConcurrentCellSet visited(region, start.level());
+  vector<S2CellId> frontier;
+  output->clear();
+  visited.Insert(start);
+  frontier.push_back(start);
+  while (!frontier.empty()) {
+    std::sort(frontier.begin(), frontier.end());
+    const int num_cells = frontier.size();
+    const int num_tasks = min(max(1, 4 * executor->num_threads()),
+                              (num_cells + kMinCellsPerTask - 1) /
+                              kMinCellsPerTask);
+    vector<vector<S2CellId>> found(num_tasks), next(num_tasks);
+    ParallelFor(executor, num_tasks, [&](int task) {
+      int begin = static_cast<int64>(num_cells) * task / num_tasks;
+      int end = static_cast<int64>(num_cells) * (task + 1) / num_tasks;
+      for (int i = begin; i < end; ++i) {
+        S2CellId id = frontier[i];
+        if (!region.MayIntersect(S2Cell(id))) continue;
+        found[task].push_back(id);
+
+        S2CellId neighbors[4];
+        id.GetEdgeNeighbors(neighbors);
+        for (S2CellId nbr : neighbors) {
+          if (visited.Insert(nbr)) next[task].push_back(nbr);
+        }
+      }
+    });
+    frontier.clear();
+    for (int task = 0; task < num_tasks; ++task) {
+      output->insert(output->end(), found[task].begin(), found[task].end());
+      frontier.insert(frontier.end(), next[task].begin(), next[task].end());
+    }
+  }
+}
+
+void S2RegionCoverer::GetSimpleCovering(
+    const S2Region& region, const S2Point& start, int level,
+    Executor* executor, vector<S2CellId>* output) {
+  return FloodFill(region, S2CellId(start).parent(level), executor, output);
+}
@@ -18,17 +18,24 @@
 #ifndef S2_S2REGION_COVERER_H_
 #define S2_S2REGION_COVERER_H_
 
+#include <memory>
 #include <queue>
 #include <utility>
 #include <vector>
 
+#include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/base/macros.h"
 #include "s2/_fp_contract_off.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/third_party/absl/types/span.h"
 
+class Executor;
 class S2Region;
+template <class Region> class S2RegionCovererT;
 
 // An S2RegionCoverer is a class that allows arbitrary regions to be
 // approximated as unions of cells (S2CellUnion).  This is useful for
@@ -149,11 +156,27 @@ class S2RegionCoverer {
     // This is the maximum level that will actually be used in coverings.
     int true_max_level() const;
 
+    // If specified, the region is tested against the children of several
+    // candidate cells concurrently using the given executor.  This is only
+    // worthwhile when MayIntersect() and Contains() are expensive (e.g., for
+    // a complex S2Polygon with a large max_cells()).  The covering is always
+    // identical to the one computed without an executor.
+    //
+    // REQUIRES: the region's MayIntersect() and Contains() methods must be
+    //           safe to call from several threads at once.  This is true for
+    //           S2Cap, S2LatLngRect, S2Loop, S2Polygon, and S2Polyline, but
+    //           not for S2ShapeIndexRegion (use one clone per thread).
+    //
+    // DEFAULT: nullptr
+    Executor* executor() const { return executor_; }
+    void set_executor(Executor* executor) { executor_ = executor; }
+
    protected:
     int max_cells_ = kDefaultMaxCells;
     int min_level_ = 0;
     int max_level_ = S2CellId::kMaxLevel;
     int level_mod_ = 1;
+    Executor* executor_ = nullptr;
   };
 
   // Constructs an S2RegionCoverer with the given options.
@@ -190,6 +213,18 @@ class S2RegionCoverer {
   void GetInteriorCovering(const S2Region& region,
                            std::vector<S2CellId>* interior);
 
+  // Computes the coverings of many regions at once.  The covering of
+  // regions[i] is stored in cell_ids[offsets[i], offsets[i+1]), where
+  // "offsets" has regions.size() + 1 entries.  Both vectors are cleared
+  // first.  This is faster than calling GetCovering() for each region
+  // (e.g., for many small caps), since after the first few regions almost
+  // no memory needs to be allocated.
+  void GetCoverings(absl::Span<const S2Region* const> regions,
+                    std::vector<S2CellId>* cell_ids, std::vector<int>* offsets);
+  void GetInteriorCoverings(absl::Span<const S2Region* const> regions,
+                            std::vector<S2CellId>* cell_ids,
+                            std::vector<int>* offsets);
+
   // Like GetCovering(), except that this method is much faster and the
   // coverings are not as tight.  All of the usual parameters are respected
   // (max_cells, min_level, max_level, and level_mod), except that the
@@ -200,6 +235,18 @@ class S2RegionCoverer {
   // recursively subdivide cells.
   void GetFastCovering(const S2Region& region, std::vector<S2CellId>* covering);
 
+  // Specialized versions of GetFastCovering() for the most common query
+  // regions.  Rather than just canonicalizing the region's cell union bound,
+  // these methods refine the bound one level at a time: every cell at the
+  // current level that is not contained by the region is replaced by its
+  // intersecting children, as long as the covering stays within max_cells().
+  // This takes advantage of max_cells() and is usually nearly as tight as
+  // GetCovering(), but it avoids the candidate priority queue and calls the
+  // region's (final) intersection methods directly.
+  void GetFastCovering(const S2Cap& cap, std::vector<S2CellId>* covering);
+  void GetFastCovering(const S2LatLngRect& rect,
+                       std::vector<S2CellId>* covering);
+
   // Given a connected region and a starting point on the boundary or inside the
   // region, returns a set of cells at the given level that cover the region.
   // The output cells are returned in arbitrary order.
@@ -219,6 +266,20 @@ class S2RegionCoverer {
   static void FloodFill(const S2Region& region, S2CellId start,
                         std::vector<S2CellId>* output);
 
+  // Like the methods above, but the region is tested against the cells
+  // concurrently using the given executor (or serially if it is nullptr).
+  // This is worthwhile for large fixed-level coverings, e.g. polygons that
+  // contain millions of cells at the requested level.  The output consists of
+  // the same set of cells, but in a different arbitrary order.
+  //
+  // REQUIRES: region's MayIntersect() method must be safe to call from
+  //           several threads at once (see Options::set_executor).
+  static void GetSimpleCovering(const S2Region& region, const S2Point& start,
+                                int level, Executor* executor,
+                                std::vector<S2CellId>* output);
+  static void FloodFill(const S2Region& region, S2CellId start,
+                        Executor* executor, std::vector<S2CellId>* output);
+
   // Returns true if the given S2CellId vector represents a valid covering
   // that conforms to the current covering parameters.  In particular:
   //
@@ -247,36 +308,80 @@ class S2RegionCoverer {
   struct Candidate {
     S2Cell cell;
     bool is_terminal;        // Cell should not be expanded further.
+    int8 pool_index;         // The free list this candidate is returned to.
     int num_children;        // Number of children that intersect the region.
     Candidate* children[0];  // Actual size may be 0, 4, 16, or 64 elements.
   };
 
+  // The methods below that take a "region" argument are templates so that
+  // S2RegionCovererT<Region> can call the region's MayIntersect() and
+  // Contains() methods without going through S2Region's virtual methods.
+  // They are instantiated in s2region_coverer.cc for the supported types.
+  template <class Region> friend class S2RegionCovererT;
+
   // If the cell intersects the given region, return a new candidate with no
   // children, otherwise return nullptr.  Also marks the candidate as "terminal"
   // if it should not be expanded further.
-  Candidate* NewCandidate(const S2Cell& cell);
+  template <class Region>
+  Candidate* NewCandidate(const Region& region, const S2Cell& cell) const;
 
   // Returns the log base 2 of the maximum number of children of a candidate.
   int max_children_shift() const { return 2 * options().level_mod(); }
 
-  // Frees the memory associated with a candidate.
-  static void DeleteCandidate(Candidate* candidate, bool delete_children);
+  // Frees the memory associated with a candidate.  The memory is kept in
+  // free_candidates_ so that it can be reused by later candidates.
+  void DeleteCandidate(Candidate* candidate, bool delete_children);
+
 
   // Processes a candidate by either adding it to the result_ vector or
   // expanding its children and inserting it into the priority queue.
   // Passing an argument of nullptr does nothing.
-  void AddCandidate(Candidate* candidate);
+  template <class Region>
+  void AddCandidate(const Region& region, Candidate* candidate);
+
+  // Like calling AddCandidate() on each of the given candidates in order,
+  // except that the candidates are expanded concurrently using
+  // options().executor().
+  template <class Region>
+  void AddCandidates(const Region& region, Candidate* const* candidates,
+                     int num_candidates);
+
+  // Expands the children of a non-terminal candidate and returns the number
+  // of children that were marked "terminal".  This method only reads the
+  // state of the S2RegionCoverer, so it may be called concurrently.
+  template <class Region>
+  int ExpandCandidate(const Region& region, Candidate* candidate) const;
+
+  // Adds a candidate expanded by ExpandCandidate() to the result_ vector or
+  // the priority queue.
+  template <class Region>
+  void AddExpandedCandidate(const Region& region, Candidate* candidate,
+                            int num_terminals);
 
   // Populates the children of "candidate" by expanding the given number of
   // levels from the given cell.  Returns the number of children that were
   // marked "terminal".
-  int ExpandChildren(Candidate* candidate, const S2Cell& cell, int num_levels);
+  template <class Region>
+  int ExpandChildren(const Region& region, Candidate* candidate,
+                     const S2Cell& cell, int num_levels) const;
 
   // Computes a set of initial candidates that cover the given region.
-  void GetInitialCandidates();
+  template <class Region>
+  void GetInitialCandidates(const Region& region);
 
   // Generates a covering and stores it in result_.
-  void GetCoveringInternal(const S2Region& region);
+  template <class Region>
+  void GetCoveringInternal(const Region& region);
+
+  // Implements the specialized versions of GetFastCovering().
+  template <class Region>
+  void GetLevelByLevelCovering(const Region& region,
+                               std::vector<S2CellId>* covering);
+
+  // Generates the coverings of several regions (see GetCoverings).
+  void GetCoveringsInternal(absl::Span<const S2Region* const> regions,
+                            std::vector<S2CellId>* cell_ids,
+                            std::vector<int>* offsets);
 
   // If level > min_level(), then reduces "level" if necessary so that it also
   // satisfies level_mod().  Levels smaller than min_level() are not affected
@@ -301,11 +406,6 @@ class S2RegionCoverer {
 
   Options options_;
 
-  // We save a temporary copy of the pointer passed to GetCovering() in order
-  // to avoid passing this parameter around internally.  It is only used (and
-  // only valid) for the duration of a single GetCovering() call.
-  const S2Region* region_ = nullptr;
-
   // The set of S2CellIds that have been added to the covering so far.
   std::vector<S2CellId> result_;
 
@@ -329,8 +429,104 @@ class S2RegionCoverer {
   // True if we're computing an interior covering.
   bool interior_covering_;
 
+  // Candidates that have been deleted, indexed by Candidate::pool_index:
+  // entry 0 holds terminal candidates (which have no space for children) and
+  // entry "k" holds candidates with space for the children of level_mod() k.
+  // The free lists are not used while options().executor() is set, since
+  // candidates are then created by several threads at once.
+  struct CandidateDeleter {
+    void operator()(Candidate* candidate) const {
+      ::operator delete(candidate);
+    }
+  };
+  using CandidatePtr = std::unique_ptr<Candidate, CandidateDeleter>;
+  mutable std::vector<CandidatePtr> free_candidates_[4];
+
+  // Temporaries, defined here to avoid multiple allocations.
+  std::vector<S2CellId> initial_cells_;
+  std::vector<S2CellId> tmp_result_;
+
   // Counter of number of candidates created, for performance evaluation.
   int candidates_created_counter_;
 };
 
+#ifndef SWIG
+// S2RegionCovererT<Region> computes exactly the same coverings as
+// S2RegionCoverer with the same options, but it calls Region::MayIntersect()
+// and Region::Contains() directly rather than through S2Region's virtual
+// methods.  These are called once or more for every candidate cell, so this
+// can save a significant fraction of the covering time for regions whose
+// predicates are cheap (e.g. S2Cap and S2LatLngRect).  For example:
+//
+//   S2RegionCovererT<S2Cap> coverer(options);
+//   for (const S2Cap& cap : caps) {
+//     coverer.GetCovering(cap, &covering);
+//     ...
+//   }
+//
+// Note that the predicates of "Region" itself are used even if the object
+// passed in is a subtype that overrides them.
+//
+// Region must be one of S2Cap, S2LatLngRect, S2Polygon, S2CellUnion, or
+// S2Region.  (S2RegionCovererT<S2Region> is equivalent to S2RegionCoverer.)
+template <class Region>
+class S2RegionCovererT {
+ public:
+  using Options = S2RegionCoverer::Options;
+
+  S2RegionCovererT() = default;
+  explicit S2RegionCovererT(const Options& options) : coverer_(options) {}
+
+  // Returns the current options.  Options can be modifed between calls.
+  const Options& options() const { return coverer_.options(); }
+  Options* mutable_options() { return coverer_.mutable_options(); }
+
+  // These methods are equivalent to the S2RegionCoverer methods with the
+  // same names.
+  S2CellUnion GetCovering(const Region& region);
+  S2CellUnion GetInteriorCovering(const Region& region);
+  void GetCovering(const Region& region, std::vector<S2CellId>* covering);
+  void GetInteriorCovering(const Region& region,
+                           std::vector<S2CellId>* interior);
+
+ private:
+  S2RegionCoverer coverer_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Region>
+S2CellUnion S2RegionCovererT<Region>::GetCovering(const Region& region) {
+  coverer_.interior_covering_ = false;
+  coverer_.GetCoveringInternal(region);
+  return S2CellUnion::FromVerbatim(std::move(coverer_.result_));
+}
+
+template <class Region>
+S2CellUnion S2RegionCovererT<Region>::GetInteriorCovering(
+    const Region& region) {
+  coverer_.interior_covering_ = true;
+  coverer_.GetCoveringInternal(region);
+  return S2CellUnion::FromVerbatim(std::move(coverer_.result_));
+}
+
+template <class Region>
+void S2RegionCovererT<Region>::GetCovering(const Region& region,
+                                           std::vector<S2CellId>* covering) {
+  coverer_.interior_covering_ = false;
+  coverer_.GetCoveringInternal(region);
+  *covering = std::move(coverer_.result_);
+}
+
+template <class Region>
+void S2RegionCovererT<Region>::GetInteriorCovering(
+    const Region& region, std::vector<S2CellId>* interior) {
+  coverer_.interior_covering_ = true;
+  coverer_.GetCoveringInternal(region);
+  *interior = std::move(coverer_.result_);
+}
+#endif  // SWIG
+
 #endif  // S2_S2REGION_COVERER_H_
@@ -0,0 +1,67 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for S2RegionCoverer.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2loop.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+void BM_GetCoveringCap(benchmark::State& state) {
+  S2Testing::rnd.Reset(1);
+  vector<S2Cap> caps;
+  for (int i = 0; i < 100; ++i) {
+    caps.push_back(S2Cap(S2Testing::RandomPoint(),
+                         S2Testing::KmToAngle(S2Testing::rnd.Uniform(1000))));
+  }
+  S2RegionCoverer::Options options;
+  options.set_max_cells(state.range(0));
+  S2RegionCoverer coverer(options);
+  vector<S2CellId> covering;
+  int i = 0;
+  for (auto _ : state) {
+    coverer.GetCovering(caps[i], &covering);
+    if (++i == caps.size()) i = 0;
+  }
+}
+BENCHMARK(BM_GetCoveringCap)->Arg(8)->Arg(100)->Arg(1000);
+
+void BM_GetCoveringFractalLoop(benchmark::State& state) {
+  S2Testing::rnd.Reset(2);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(1000);
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                               S2Testing::KmToAngle(100));
+  S2RegionCoverer::Options options;
+  options.set_max_cells(state.range(0));
+  S2RegionCoverer coverer(options);
+  vector<S2CellId> covering;
+  for (auto _ : state) {
+    coverer.GetCovering(*loop, &covering);
+  }
+}
+BENCHMARK(BM_GetCoveringFractalLoop)->Arg(8)->Arg(100)->Arg(1000);
+
+}  // namespace
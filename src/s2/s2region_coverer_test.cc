@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +30,7 @@
 
 #include "s2/base/commandlineflags.h"
 #include "s2/base/logging.h"
+#include "s2/base/mutex.h"
 #include "s2/base/stringprintf.h"
 #include "s2/base/strtoint.h"
 #include "s2/s1angle.h"
@@ -37,11 +39,16 @@
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2latlng.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
 #include "s2/s2region.h"
 #include "s2/s2testing.h"
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/strings/str_cat.h"
 #include "s2/third_party/absl/strings/str_split.h"
+#include "s2/util/thread/executor.h"
+#include "s2/util/thread/work_stealing_executor.h"
 
 using absl::StrCat;
 using std::max;
@@ -140,6 +147,44 @@ TEST(S2RegionCoverer, RandomCaps) {
   }
 }
 
+TEST(S2RegionCoverer, GetCoverings) {
+  // Checks that batch coverings match individual coverings.  The same
+  // coverer is used for all option settings so that candidates of every
+  // size are recycled.
+  S2RegionCoverer coverer;
+  S2RegionCoverer expected_coverer;
+  for (int iter = 0; iter < 20; ++iter) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1 + S2Testing::rnd.Skewed(6));
+    options.set_level_mod(1 + S2Testing::rnd.Uniform(3));
+    *coverer.mutable_options() = options;
+    *expected_coverer.mutable_options() = options;
+    vector<S2Cap> caps;
+    for (int i = 0; i < 50; ++i) {
+      caps.push_back(S2Testing::GetRandomCap(
+          S2Cell::AverageArea(S2CellId::kMaxLevel), 4 * M_PI));
+    }
+    vector<const S2Region*> regions;
+    for (const S2Cap& cap : caps) regions.push_back(&cap);
+    vector<S2CellId> cell_ids, interior_ids;
+    vector<int> offsets, interior_offsets;
+    coverer.GetCoverings(regions, &cell_ids, &offsets);
+    coverer.GetInteriorCoverings(regions, &interior_ids, &interior_offsets);
+    ASSERT_EQ(regions.size() + 1, offsets.size());
+    ASSERT_EQ(regions.size() + 1, interior_offsets.size());
+    for (int i = 0; i < regions.size(); ++i) {
+      vector<S2CellId> expected;
+      expected_coverer.GetCovering(*regions[i], &expected);
+      EXPECT_EQ(expected, vector<S2CellId>(cell_ids.begin() + offsets[i],
+                                           cell_ids.begin() + offsets[i + 1]));
+      expected_coverer.GetInteriorCovering(*regions[i], &expected);
+      EXPECT_EQ(expected, vector<S2CellId>(
+          interior_ids.begin() + interior_offsets[i],
+          interior_ids.begin() + interior_offsets[i + 1]));
+    }
+  }
+}
+
 TEST(S2RegionCoverer, SimpleCoverings) {
   static const int kMaxLevel = S2CellId::kMaxLevel;
   S2RegionCoverer::Options options;
@@ -305,6 +350,106 @@ TEST(S2RegionCoverer, InteriorCovering) {
   }
 }
 
+namespace {
+
+// An executor that runs every task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+}  // namespace
+
+TEST(S2RegionCoverer, ExecutorGivesIdenticalCoverings) {
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(1000);
+  fractal.set_fractal_dimension(1.5);
+  S2Polygon polygon(fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                                     S1Angle::Degrees(10)));
+  ThreadPerTaskExecutor executor;
+  for (int max_cells : {8, 100, 1000}) {
+    for (int level_mod : {1, 2}) {
+      S2RegionCoverer::Options options;
+      options.set_max_cells(max_cells);
+      options.set_level_mod(level_mod);
+      S2RegionCoverer serial(options);
+      options.set_executor(&executor);
+      S2RegionCoverer parallel(options);
+      EXPECT_EQ(serial.GetCovering(polygon), parallel.GetCovering(polygon));
+      EXPECT_EQ(serial.GetInteriorCovering(polygon),
+                parallel.GetInteriorCovering(polygon));
+    }
+  }
+}
+
+TEST(S2RegionCoverer, ParallelSimpleCoverings) {
+  WorkStealingExecutor executor(3);
+  for (int i = 0; i < 200; ++i) {
+    int level = S2Testing::rnd.Uniform(S2CellId::kMaxLevel + 1);
+    double max_area = min(4 * M_PI, 3000 * S2Cell::AverageArea(level));
+    S2Cap cap = S2Testing::GetRandomCap(0.1 * S2Cell::AverageArea(level),
+                                        max_area);
+    // Also test caps near a cube vertex, whose cell union bounds span
+    // several faces.
+    if (i % 4 == 0) cap = S2Cap(S2Point(1, 1, 1).Normalize(), cap.radius());
+    vector<S2CellId> expected, actual;
+    S2RegionCoverer::GetSimpleCovering(cap, cap.center(), level, &expected);
+    S2RegionCoverer::GetSimpleCovering(cap, cap.center(), level, &executor,
+                                       &actual);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+TEST(S2RegionCovererT, GivesIdenticalCoverings) {
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(100);
+  for (int i = 0; i < 50; ++i) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1 + S2Testing::rnd.Skewed(8));
+    options.set_min_level(S2Testing::rnd.Uniform(6));
+    options.set_max_level(options.min_level() + S2Testing::rnd.Uniform(20));
+    options.set_level_mod(1 + S2Testing::rnd.Uniform(3));
+    S2RegionCoverer coverer(options);
+    S2Cap cap = S2Testing::GetRandomCap(1e-8, 0.1);
+    S2LatLngRect rect = cap.GetRectBound();
+    S2Polygon polygon(fractal.MakeLoop(S2Testing::GetRandomFrame(),
+                                       cap.GetRadius()));
+    S2CellUnion cell_union = coverer.GetCovering(polygon);
+
+    S2RegionCovererT<S2Cap> cap_coverer(options);
+    EXPECT_EQ(coverer.GetCovering(cap), cap_coverer.GetCovering(cap));
+    EXPECT_EQ(coverer.GetInteriorCovering(cap),
+              cap_coverer.GetInteriorCovering(cap));
+    S2RegionCovererT<S2LatLngRect> rect_coverer(options);
+    EXPECT_EQ(coverer.GetCovering(rect), rect_coverer.GetCovering(rect));
+    EXPECT_EQ(coverer.GetInteriorCovering(rect),
+              rect_coverer.GetInteriorCovering(rect));
+    S2RegionCovererT<S2Polygon> polygon_coverer(options);
+    EXPECT_EQ(cell_union, polygon_coverer.GetCovering(polygon));
+    EXPECT_EQ(coverer.GetInteriorCovering(polygon),
+              polygon_coverer.GetInteriorCovering(polygon));
+    S2RegionCovererT<S2CellUnion> cell_union_coverer(options);
+    vector<S2CellId> expected, actual;
+    coverer.GetCovering(cell_union, &expected);
+    cell_union_coverer.GetCovering(cell_union, &actual);
+    EXPECT_EQ(expected, actual);
+  }
+}
+
 TEST(GetFastCovering, HugeFixedLevelCovering) {
   // Test a "fast covering" with a huge number of cells due to min_level().
   S2RegionCoverer::Options options;
@@ -316,6 +461,58 @@ TEST(GetFastCovering, HugeFixedLevelCovering) {
   EXPECT_GE(covering.size(), 1 << 16);
 }
 
+TEST(GetFastCovering, RandomCapsAndRects) {
+  // The specialized coverings of caps and rectangles must be valid coverings
+  // that conform to the options, and (with the default level_mod) at least
+  // as tight as the generic fast covering of the same region.
+  static const int kMaxLevel = S2CellId::kMaxLevel;
+  S2RegionCoverer::Options options;
+  for (int i = 0; i < 500; ++i) {
+    do {
+      options.set_min_level(S2Testing::rnd.Uniform(kMaxLevel + 1));
+      options.set_max_level(S2Testing::rnd.Uniform(kMaxLevel + 1));
+    } while (options.min_level() > options.max_level());
+    options.set_max_cells(S2Testing::rnd.Skewed(5));
+    options.set_level_mod(1 + S2Testing::rnd.Uniform(3));
+    double max_area =  min(4 * M_PI, (3 * options.max_cells() + 1) *
+                           S2Cell::AverageArea(options.min_level()));
+    S2Cap cap = S2Testing::GetRandomCap(0.1 * S2Cell::AverageArea(kMaxLevel),
+                                        max_area);
+    S2LatLngRect rect = cap.GetRectBound();
+    S2RegionCoverer coverer(options);
+    vector<S2CellId> covering, generic;
+    coverer.GetFastCovering(cap, &covering);
+    CheckCovering(options, cap, covering, false);
+    coverer.GetFastCovering(static_cast<const S2Region&>(cap), &generic);
+    if (options.level_mod() == 1) {
+      EXPECT_LE(S2CellUnion(covering).ApproxArea(),
+                S2CellUnion(generic).ApproxArea() * (1 + 1e-12));
+    }
+    coverer.GetFastCovering(rect, &covering);
+    CheckCovering(options, rect, covering, false);
+  }
+}
+
+TEST(GetFastCovering, CapUsesMaxCells) {
+  S2Cap cap(S2LatLng::FromDegrees(10, 20).ToPoint(), S1Angle::Degrees(1));
+  S2RegionCoverer::Options options;
+  options.set_max_cells(20);
+  S2RegionCoverer coverer(options);
+  vector<S2CellId> fast, generic;
+  coverer.GetFastCovering(cap, &fast);
+  coverer.GetFastCovering(static_cast<const S2Region&>(cap), &generic);
+  EXPECT_LE(fast.size(), 20);
+  EXPECT_GT(fast.size(), generic.size());
+  EXPECT_LT(S2CellUnion(fast).ApproxArea(),
+            0.5 * S2CellUnion(generic).ApproxArea());
+
+  // An empty region has an empty covering.
+  coverer.GetFastCovering(S2Cap::Empty(), &fast);
+  EXPECT_TRUE(fast.empty());
+  coverer.GetFastCovering(S2LatLngRect::Empty(), &fast);
+  EXPECT_TRUE(fast.empty());
+}
+
 bool IsCanonical(const vector<string>& input_str,
                  const S2RegionCoverer::Options& options) {
   vector<S2CellId> input;
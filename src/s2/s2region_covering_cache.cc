@@ -0,0 +1,211 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2region_covering_cache.h"
+
+#include <cstring>
+
+#include "s2/base/logging.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/util/hash/mix.h"
+
+namespace {
+
+// A fingerprint accumulator.  HashMix is used (rather than std::hash) so
+// that fingerprints do not depend on the standard library implementation.
+// A type tag is mixed in first so that different region types with the same
+// numeric values have different fingerprints.
+class Fingerprinter {
+ public:
+  explicit Fingerprinter(int type_tag) : mix_(type_tag) {}
+
+  void Add(uint64 value) {
+    // Mix both halves so that the result is the same when size_t is 32 bits.
+    mix_.Mix(static_cast<size_t>(value));
+    mix_.Mix(static_cast<size_t>(value >> 32));
+  }
+  void Add(double value) {
+    uint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    Add(bits);
+  }
+  void Add(const S2Point& p) {
+    Add(p.x());
+    Add(p.y());
+    Add(p.z());
+  }
+  void Add(const S2Loop& loop) {
+    Add(static_cast<uint64>(loop.num_vertices()));
+    for (int i = 0; i < loop.num_vertices(); ++i) Add(loop.vertex(i));
+  }
+
+  uint64 get() const { return mix_.get(); }
+
+ private:
+  HashMix mix_;
+};
+
+enum TypeTag { CAP = 1, CELL, LAT_LNG_RECT, LOOP, POLYGON };
+
+}  // namespace
+
+S2RegionCoveringCache::Options::Options() : max_entries_(1000) {
+}
+
+void S2RegionCoveringCache::Options::set_max_entries(int max_entries) {
+  S2_DCHECK_GE(max_entries, 0);
+  max_entries_ = max_entries;
+}
+
+S2RegionCoveringCache::S2RegionCoveringCache()
+    : S2RegionCoveringCache(Options()) {
+}
+
+S2RegionCoveringCache::S2RegionCoveringCache(const Options& options)
+    : options_(options) {
+}
+
+bool S2RegionCoveringCache::Key::operator==(const Key& other) const {
+  return (fingerprint == other.fingerprint && interior == other.interior &&
+          min_level == other.min_level && max_level == other.max_level &&
+          level_mod == other.level_mod && max_cells == other.max_cells);
+}
+
+size_t S2RegionCoveringCache::KeyHasher::operator()(const Key& key) const {
+  HashMix mix(static_cast<size_t>(key.fingerprint));
+  mix.Mix(key.interior);
+  mix.Mix(key.min_level);
+  mix.Mix(key.max_level);
+  mix.Mix(key.level_mod);
+  mix.Mix(key.max_cells);
+  return mix.get();
+}
+
+S2CellUnion S2RegionCoveringCache::GetCovering(
+    const S2Region& region, uint64 fingerprint,
+    const S2RegionCoverer::Options& options) {
+  return GetCoveringInternal(region, fingerprint, options, false);
+}
+
+S2CellUnion S2RegionCoveringCache::GetInteriorCovering(
+    const S2Region& region, uint64 fingerprint,
+    const S2RegionCoverer::Options& options) {
+  return GetCoveringInternal(region, fingerprint, options, true);
+}
+
+S2CellUnion S2RegionCoveringCache::GetCoveringInternal(
+    const S2Region& region, uint64 fingerprint,
+    const S2RegionCoverer::Options& options, bool interior) {
+  Key key{fingerprint, interior, options.min_level(), options.max_level(),
+          options.level_mod(), options.max_cells()};
+  mutex_.Lock();
+  auto it = map_.find(key);
+  if (it != map_.end()) {
+    // Move the entry to the front of the list.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    S2CellUnion result = it->second->second;
+    ++hits_;
+    mutex_.Unlock();
+    return result;
+  }
+  ++misses_;
+  mutex_.Unlock();
+
+  // The covering is computed without holding the lock.  If several threads
+  // compute the same covering concurrently, the first result is kept.
+  S2RegionCoverer coverer(options);
+  S2CellUnion result = interior ? coverer.GetInteriorCovering(region)
+                                : coverer.GetCovering(region);
+  if (options_.max_entries() == 0) return result;
+
+  mutex_.Lock();
+  if (map_.find(key) == map_.end()) {
+    if (map_.size() >= options_.max_entries()) {
+      map_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(key, result);
+    map_[key] = entries_.begin();
+  }
+  mutex_.Unlock();
+  return result;
+}
+
+uint64 S2RegionCoveringCache::Fingerprint(const S2Cap& cap) {
+  Fingerprinter f(CAP);
+  f.Add(cap.center());
+  f.Add(cap.radius().length2());
+  return f.get();
+}
+
+uint64 S2RegionCoveringCache::Fingerprint(const S2Cell& cell) {
+  Fingerprinter f(CELL);
+  f.Add(cell.id().id());
+  return f.get();
+}
+
+uint64 S2RegionCoveringCache::Fingerprint(const S2LatLngRect& rect) {
+  Fingerprinter f(LAT_LNG_RECT);
+  f.Add(rect.lat().lo());
+  f.Add(rect.lat().hi());
+  f.Add(rect.lng().lo());
+  f.Add(rect.lng().hi());
+  return f.get();
+}
+
+uint64 S2RegionCoveringCache::Fingerprint(const S2Loop& loop) {
+  Fingerprinter f(LOOP);
+  f.Add(loop);
+  return f.get();
+}
+
+uint64 S2RegionCoveringCache::Fingerprint(const S2Polygon& polygon) {
+  Fingerprinter f(POLYGON);
+  f.Add(static_cast<uint64>(polygon.num_loops()));
+  for (int i = 0; i < polygon.num_loops(); ++i) f.Add(*polygon.loop(i));
+  return f.get();
+}
+
+int64 S2RegionCoveringCache::hits() const {
+  mutex_.Lock();
+  int64 result = hits_;
+  mutex_.Unlock();
+  return result;
+}
+
+int64 S2RegionCoveringCache::misses() const {
+  mutex_.Lock();
+  int64 result = misses_;
+  mutex_.Unlock();
+  return result;
+}
+
+int S2RegionCoveringCache::size() const {
+  mutex_.Lock();
+  int result = map_.size();
+  mutex_.Unlock();
+  return result;
+}
+
+void S2RegionCoveringCache::Clear() {
+  mutex_.Lock();
+  map_.clear();
+  entries_.clear();
+  mutex_.Unlock();
+}
@@ -0,0 +1,136 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2REGION_COVERING_CACHE_H_
+#define S2_S2REGION_COVERING_CACHE_H_
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "s2/base/mutex.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2region.h"
+#include "s2/s2region_coverer.h"
+#include "s2/third_party/absl/base/integral_types.h"
+
+class S2Cap;
+class S2Cell;
+class S2LatLngRect;
+class S2Loop;
+class S2Polygon;
+
+// S2RegionCoveringCache memoizes the results of S2RegionCoverer for regions
+// that are covered repeatedly, e.g. the same city polygons or radius caps
+// appearing in many queries.  The cache has a bounded size and evicts the
+// least recently used covering when it is full.
+//
+// Since S2Region does not define equality, the caller identifies each region
+// by a 64-bit "fingerprint".  Fingerprint() computes suitable values for the
+// common region types, or the caller may use any other value that uniquely
+// identifies the region (e.g. a database key).  The cache key consists of the
+// fingerprint together with the S2RegionCoverer::Options, so the same region
+// may be cached with several different options.
+//
+// Example usage:
+//
+//   S2RegionCoveringCache cache;
+//   S2CellUnion covering = cache.GetCovering(
+//       cap, S2RegionCoveringCache::Fingerprint(cap), coverer_options);
+//
+// This class is thread-safe.
+class S2RegionCoveringCache {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The maximum number of coverings stored in the cache.
+    //
+    // DEFAULT: 1000
+    int max_entries() const { return max_entries_; }
+    void set_max_entries(int max_entries);
+
+   private:
+    int max_entries_;
+  };
+
+  S2RegionCoveringCache();
+  explicit S2RegionCoveringCache(const Options& options);
+
+  const Options& options() const { return options_; }
+
+  // Returns S2RegionCoverer(options).GetCovering(region), using the cached
+  // result if the same fingerprint and options were seen recently.
+  //
+  // REQUIRES: "fingerprint" uniquely identifies "region".
+  S2CellUnion GetCovering(const S2Region& region, uint64 fingerprint,
+                          const S2RegionCoverer::Options& options);
+
+  // Like GetCovering(), but returns an interior covering.
+  S2CellUnion GetInteriorCovering(const S2Region& region, uint64 fingerprint,
+                                  const S2RegionCoverer::Options& options);
+
+  // Returns a fingerprint of the given region.  Regions with the same
+  // fingerprint are equal with very high probability.
+  static uint64 Fingerprint(const S2Cap& cap);
+  static uint64 Fingerprint(const S2Cell& cell);
+  static uint64 Fingerprint(const S2LatLngRect& rect);
+  static uint64 Fingerprint(const S2Loop& loop);
+  static uint64 Fingerprint(const S2Polygon& polygon);
+
+  // Returns the number of calls that were answered from the cache, and the
+  // number of calls where the covering had to be computed.
+  int64 hits() const;
+  int64 misses() const;
+
+  // Returns the number of coverings currently in the cache.
+  int size() const;
+
+  // Removes all coverings from the cache.  The hit and miss counters are not
+  // reset.
+  void Clear();
+
+ private:
+  struct Key {
+    uint64 fingerprint;
+    bool interior;
+    int min_level, max_level, level_mod, max_cells;
+
+    bool operator==(const Key& other) const;
+  };
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+  // The list is in order of most recent use, and the map points into it.
+  using Entry = std::pair<Key, S2CellUnion>;
+  using EntryList = std::list<Entry>;
+
+  S2CellUnion GetCoveringInternal(const S2Region& region, uint64 fingerprint,
+                                  const S2RegionCoverer::Options& options,
+                                  bool interior);
+
+  Options options_;
+  mutable absl::Mutex mutex_;
+  EntryList entries_;
+  std::unordered_map<Key, EntryList::iterator, KeyHasher> map_;
+  int64 hits_ = 0;
+  int64 misses_ = 0;
+
+  S2RegionCoveringCache(const S2RegionCoveringCache&) = delete;
+  void operator=(const S2RegionCoveringCache&) = delete;
+};
+
+#endif  // S2_S2REGION_COVERING_CACHE_H_
@@ -0,0 +1,141 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2region_covering_cache.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+TEST(S2RegionCoveringCache, MatchesRegionCoverer) {
+  S2RegionCoveringCache cache;
+  S2RegionCoverer::Options options;
+  options.set_max_cells(20);
+  S2RegionCoverer coverer(options);
+  for (int iter = 0; iter < 10; ++iter) {
+    S2Cap cap = S2Testing::GetRandomCap(1e-6, 0.1);
+    uint64 fingerprint = S2RegionCoveringCache::Fingerprint(cap);
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(coverer.GetCovering(cap),
+                cache.GetCovering(cap, fingerprint, options));
+      EXPECT_EQ(coverer.GetInteriorCovering(cap),
+                cache.GetInteriorCovering(cap, fingerprint, options));
+    }
+  }
+  EXPECT_EQ(20, cache.misses());
+  EXPECT_EQ(20, cache.hits());
+  EXPECT_EQ(20, cache.size());
+}
+
+TEST(S2RegionCoveringCache, OptionsArePartOfKey) {
+  S2RegionCoveringCache cache;
+  S2Cap cap = S2Testing::GetRandomCap(1e-4, 1e-2);
+  uint64 fingerprint = S2RegionCoveringCache::Fingerprint(cap);
+  S2RegionCoverer::Options options;
+  for (int max_cells = 1; max_cells <= 16; max_cells *= 2) {
+    options.set_max_cells(max_cells);
+    EXPECT_EQ(S2RegionCoverer(options).GetCovering(cap),
+              cache.GetCovering(cap, fingerprint, options));
+  }
+  EXPECT_EQ(5, cache.misses());
+  EXPECT_EQ(0, cache.hits());
+}
+
+TEST(S2RegionCoveringCache, LeastRecentlyUsedEviction) {
+  S2RegionCoveringCache::Options cache_options;
+  cache_options.set_max_entries(2);
+  S2RegionCoveringCache cache(cache_options);
+  S2RegionCoverer::Options options;
+  S2Cell a(S2CellId::FromFace(0)), b(S2CellId::FromFace(1)),
+      c(S2CellId::FromFace(2));
+  auto get = [&](const S2Cell& cell) {
+    cache.GetCovering(cell, S2RegionCoveringCache::Fingerprint(cell), options);
+  };
+  get(a);
+  get(b);
+  get(a);  // Hit; "b" is now the least recently used.
+  get(c);  // Evicts "b".
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(1, cache.hits());
+  get(a);
+  EXPECT_EQ(2, cache.hits());
+  get(b);
+  EXPECT_EQ(2, cache.hits());
+  EXPECT_EQ(4, cache.misses());
+  cache.Clear();
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST(S2RegionCoveringCache, Fingerprints) {
+  using Cache = S2RegionCoveringCache;
+  S2Cap cap = S2Cap::FromPoint(S2Point(1, 0, 0));
+  EXPECT_EQ(Cache::Fingerprint(cap), Cache::Fingerprint(S2Cap(cap)));
+  EXPECT_NE(Cache::Fingerprint(cap), Cache::Fingerprint(S2Cap::Empty()));
+  EXPECT_NE(Cache::Fingerprint(cap), Cache::Fingerprint(S2Cap::Full()));
+  EXPECT_NE(Cache::Fingerprint(S2LatLngRect::Empty()),
+            Cache::Fingerprint(S2LatLngRect::Full()));
+  unique_ptr<S2Loop> loop1(s2textformat::MakeLoopOrDie("0:0, 0:1, 1:0"));
+  unique_ptr<S2Loop> loop2(s2textformat::MakeLoopOrDie("0:0, 0:1, 1:1"));
+  EXPECT_NE(Cache::Fingerprint(*loop1), Cache::Fingerprint(*loop2));
+  unique_ptr<S2Polygon> polygon1(s2textformat::MakePolygonOrDie("0:0, 0:1, 1:0"));
+  unique_ptr<S2Polygon> polygon2(s2textformat::MakePolygonOrDie("0:0, 0:1, 1:0"));
+  EXPECT_EQ(Cache::Fingerprint(*polygon1), Cache::Fingerprint(*polygon2));
+  EXPECT_NE(Cache::Fingerprint(*polygon1), Cache::Fingerprint(*loop1));
+}
+
+TEST(S2RegionCoveringCache, ConcurrentAccess) {
+  S2RegionCoveringCache::Options cache_options;
+  cache_options.set_max_entries(5);
+  S2RegionCoveringCache cache(cache_options);
+  S2RegionCoverer::Options options;
+  vector<S2Cap> caps;
+  for (int i = 0; i < 10; ++i) {
+    caps.push_back(S2Testing::GetRandomCap(1e-6, 0.1));
+  }
+  vector<S2CellUnion> expected;
+  for (const S2Cap& cap : caps) {
+    expected.push_back(S2RegionCoverer(options).GetCovering(cap));
+  }
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 100; ++i) {
+        int j = (i * 7 + t) % caps.size();
+        EXPECT_EQ(expected[j], cache.GetCovering(
+            caps[j], S2RegionCoveringCache::Fingerprint(caps[j]), options));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(400, cache.hits() + cache.misses());
+  EXPECT_LE(cache.size(), 5);
+}
+
+}  // namespace
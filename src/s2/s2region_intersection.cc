@@ -17,7 +17,9 @@
 #include "s2/s2region_intersection.h"
 
 #include "s2/s2cap.h"
+#include "s2/s2cell.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/third_party/absl/container/inlined_vector.h"
 
 using std::vector;
 
@@ -41,6 +43,7 @@ S2RegionIntersection::S2RegionIntersection(const S2RegionIntersection& src)
 vector<std::unique_ptr<S2Region>> S2RegionIntersection::Release() {
   vector<std::unique_ptr<S2Region>> result;
   result.swap(regions_);
+  index_.Reset();
   return result;
 }
 
@@ -62,7 +65,16 @@ S2LatLngRect S2RegionIntersection::GetRectBound() const {
   return result;
 }
 
+bool S2RegionIntersection::CoveringsIntersect(const S2Cell& cell) const {
+  absl::InlinedVector<int, 16> region_ids;
+  if (!index_.GetIntersectingRegions(regions_, cell.id(), &region_ids)) {
+    return true;
+  }
+  return region_ids.size() == num_regions();
+}
+
 bool S2RegionIntersection::Contains(const S2Cell& cell) const {
+  if (!CoveringsIntersect(cell)) return false;
   for (int i = 0; i < num_regions(); ++i) {
     if (!region(i)->Contains(cell)) return false;
   }
@@ -77,6 +89,7 @@ bool S2RegionIntersection::Contains(const S2Point& p) const {
 }
 
 bool S2RegionIntersection::MayIntersect(const S2Cell& cell) const {
+  if (!CoveringsIntersect(cell)) return false;
   for (int i = 0; i < num_regions(); ++i) {
     if (!region(i)->MayIntersect(cell)) return false;
   }
@@ -23,6 +23,7 @@
 #include "s2/base/logging.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/s2region.h"
+#include "s2/s2region_set_index.h"
 #include "s2/third_party/absl/base/macros.h"
 
 class Decoder;
@@ -71,8 +72,16 @@ class S2RegionIntersection final : public S2Region {
   // its argument.
   S2RegionIntersection(const S2RegionIntersection& src);
 
+  // Returns false if "cell" is known not to intersect some region because it
+  // does not intersect that region's covering in index_.
+  bool CoveringsIntersect(const S2Cell& cell) const;
+
   std::vector<std::unique_ptr<S2Region>> regions_;
 
+  // An index of the region coverings, used to avoid testing every region in
+  // Contains(S2Cell) and MayIntersect(S2Cell) when there are many regions.
+  S2RegionSetIndex index_;
+
   void operator=(const S2RegionIntersection&) = delete;
 };
 
@@ -0,0 +1,70 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2region_intersection.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2testing.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+TEST(S2RegionIntersectionTest, ManyRegions) {
+  // Builds the intersection of many caps that all contain a common point, and
+  // checks that using the index of region coverings does not change the
+  // results of MayIntersect() and Contains().
+  S2Point center = S2Testing::RandomPoint();
+  vector<S2Cap> caps;
+  vector<unique_ptr<S2Region>> regions;
+  for (int i = 0; i < 50; ++i) {
+    S1Angle radius = S1Angle::Degrees(S2Testing::rnd.UniformDouble(5, 20));
+    S2Cap cap(S2Testing::SamplePoint(S2Cap(center, 0.5 * radius)), radius);
+    caps.push_back(cap);
+    regions.push_back(make_unique<S2Cap>(cap));
+  }
+  S2RegionIntersection intersection(std::move(regions));
+  for (int i = 0; i < 5000; ++i) {
+    S2Point p = (i % 2 == 0) ? S2Testing::SamplePoint(caps[0])
+                             : S2Testing::RandomPoint();
+    S2Cell cell(S2CellId(p).parent(S2Testing::rnd.Uniform(25)));
+    bool may_intersect = true, contains = true;
+    for (const S2Cap& cap : caps) {
+      may_intersect &= cap.MayIntersect(cell);
+      contains &= cap.Contains(cell);
+    }
+    EXPECT_EQ(may_intersect, intersection.MayIntersect(cell));
+    EXPECT_EQ(contains, intersection.Contains(cell));
+  }
+  EXPECT_TRUE(intersection.Contains(center));
+
+  // Releasing the regions invalidates the index.
+  EXPECT_EQ(50, intersection.Release().size());
+  EXPECT_TRUE(intersection.MayIntersect(S2Cell::FromFace(0)));
+  EXPECT_TRUE(intersection.Contains(S2Cell::FromFace(0)));
+}
+
+}  // namespace
@@ -0,0 +1,76 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2region_set_index.h"
+
+#include <algorithm>
+
+#include "s2/s2cell_union.h"
+#include "s2/s2region_coverer.h"
+
+using std::vector;
+
+// Define storage for header file constants (the values are not needed here).
+constexpr int S2RegionSetIndex::kMinRegions;
+constexpr int S2RegionSetIndex::kMaxCellsPerRegion;
+
+void S2RegionSetIndex::Reset() {
+  if (is_built_.load(std::memory_order_relaxed)) {
+    index_.Clear();
+    is_built_.store(false, std::memory_order_relaxed);
+  }
+}
+
+void S2RegionSetIndex::Build(
+    const vector<std::unique_ptr<S2Region>>& regions) const {
+  lock_.Lock();
+  if (!is_built_.load(std::memory_order_relaxed)) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(kMaxCellsPerRegion);
+    S2RegionCoverer coverer(options);
+    vector<S2CellId> covering;
+    for (int i = 0; i < regions.size(); ++i) {
+      coverer.GetCovering(*regions[i], &covering);
+      for (S2CellId id : covering) index_.Add(id, i);
+    }
+    index_.Build();
+    is_built_.store(true, std::memory_order_release);
+  }
+  lock_.Unlock();
+}
+
+bool S2RegionSetIndex::GetIntersectingRegions(
+    const vector<std::unique_ptr<S2Region>>& regions, S2CellId id,
+    absl::InlinedVector<int, 16>* region_ids) const {
+  if (regions.size() < kMinRegions) return false;
+  if (!is_built_.load(std::memory_order_acquire)) Build(regions);
+
+  // This is VisitIntersectingCells() specialized for a single target cell.
+  region_ids->clear();
+  S2CellIndex::RangeIterator range(&index_);
+  S2CellIndex::ContentsIterator contents(&index_);
+  for (range.Seek(id.range_min()); range.start_id() <= id.range_max();
+       range.Next()) {
+    for (contents.StartUnion(range); !contents.done(); contents.Next()) {
+      region_ids->push_back(contents.label());
+    }
+  }
+  // A region whose covering has several cells may be reported more than once.
+  std::sort(region_ids->begin(), region_ids->end());
+  region_ids->erase(std::unique(region_ids->begin(), region_ids->end()),
+                    region_ids->end());
+  return true;
+}
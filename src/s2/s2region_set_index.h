@@ -0,0 +1,75 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2REGION_SET_INDEX_H_
+#define S2_S2REGION_SET_INDEX_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "s2/base/mutex.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_index.h"
+#include "s2/s2region.h"
+#include "s2/third_party/absl/container/inlined_vector.h"
+
+// S2RegionSetIndex is a helper class for regions that are defined in terms
+// of a set of other regions (such as S2RegionUnion and S2RegionIntersection).
+// It indexes a small covering of each region so that the regions that may
+// intersect a given S2CellId can be found without testing every region.
+//
+// The index is built lazily the first time it is needed, and this is done in
+// a thread-safe way.  Sets with fewer than kMinRegions regions are not
+// indexed, since then it is faster to simply test every region.
+class S2RegionSetIndex {
+ public:
+  // The minimum number of regions that are indexed.
+  static constexpr int kMinRegions = 8;
+
+  // The maximum number of cells used to cover each region.
+  static constexpr int kMaxCellsPerRegion = 8;
+
+  S2RegionSetIndex() = default;
+
+  // Discards the index (if any).  This must be called whenever the set of
+  // regions is modified.  This method is not thread-safe.
+  void Reset();
+
+  // If the given set of regions is indexed, sets "region_ids" to the indices
+  // of the regions whose coverings intersect "id" (in increasing order with
+  // no duplicates) and returns true.  Regions that are not in "region_ids"
+  // do not intersect "id".  Otherwise returns false, in which case every
+  // region must be tested.
+  //
+  // REQUIRES: "regions" is the same set of regions on every call (since the
+  //           last call to Reset).
+  bool GetIntersectingRegions(
+      const std::vector<std::unique_ptr<S2Region>>& regions, S2CellId id,
+      absl::InlinedVector<int, 16>* region_ids) const;
+
+ private:
+  void Build(const std::vector<std::unique_ptr<S2Region>>& regions) const;
+
+  mutable absl::Mutex lock_;
+  mutable std::atomic<bool> is_built_{false};
+  mutable S2CellIndex index_;  // Written only while "lock_" is held.
+
+  S2RegionSetIndex(const S2RegionSetIndex&) = delete;
+  void operator=(const S2RegionSetIndex&) = delete;
+};
+
+#endif  // S2_S2REGION_SET_INDEX_H_
@@ -74,7 +74,10 @@
 
 #include "s2/s2region_term_indexer.h"
 
+#include <algorithm>
 #include <cctype>
+#include <limits>
+#include <utility>
 
 #include "s2/base/logging.h"
 #include "s2/s1angle.h"
@@ -121,8 +124,9 @@ string S2RegionTermIndexer::GetTerm(TermType term_type, const S2CellId& id,
   }
 }
 
-vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
-                                                  string_view prefix) {
+template <class AddTerm>
+void S2RegionTermIndexer::VisitIndexTerms(const S2Point& point,
+                                          const AddTerm& add_term) const {
   // See the top of this file for an overview of the indexing strategy.
   //
   // The last cell generated by this loop is effectively the covering for
@@ -133,24 +137,15 @@ vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
   // max_level() != true_max_level() (see S2RegionCoverer::Options).
 
   const S2CellId id(point);
-  vector<string> terms;
   for (int level = options_.min_level(); level <= options_.max_level();
        level += options_.level_mod()) {
-    terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
+    add_term(TermType::ANCESTOR, id.parent(level));
   }
-  return terms;
 }
 
-vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
-                                                  string_view prefix) {
-  // Note that options may have changed since the last call.
-  *coverer_.mutable_options() = options_;
-  S2CellUnion covering = coverer_.GetCovering(region);
-  return GetIndexTermsForCanonicalCovering(covering, prefix);
-}
-
-vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
-    const S2CellUnion& covering, string_view prefix) {
+template <class AddTerm>
+void S2RegionTermIndexer::VisitIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, const AddTerm& add_term) {
   // See the top of this file for an overview of the indexing strategy.
   //
   // Cells in the covering are normally indexed as covering terms.  If we are
@@ -165,7 +160,6 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
     *coverer_.mutable_options() = options_;
     S2_CHECK(coverer_.IsCanonical(covering));
   }
-  vector<string> terms;
   S2CellId prev_id = S2CellId::None();
   int true_max_level = options_.true_max_level();
   for (S2CellId id : covering) {
@@ -178,11 +172,11 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
 
     if (level < true_max_level) {
       // Add a covering term for this cell.
-      terms.push_back(GetTerm(TermType::COVERING, id, prefix));
+      add_term(TermType::COVERING, id);
     }
     if (level == true_max_level || !options_.optimize_for_space()) {
       // Add an ancestor term for this cell at the constrained level.
-      terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
+      add_term(TermType::ANCESTOR, id.parent(level));
     }
     // Finally, add ancestor terms for all the ancestors of this cell.
     while ((level -= options_.level_mod()) >= options_.min_level()) {
@@ -191,48 +185,38 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
           prev_id.parent(level) == ancestor_id) {
         break;  // We have already processed this cell and its ancestors.
       }
-      terms.push_back(GetTerm(TermType::ANCESTOR, ancestor_id, prefix));
+      add_term(TermType::ANCESTOR, ancestor_id);
     }
     prev_id = id;
   }
-  return terms;
 }
 
-vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Point& point,
-                                                  string_view prefix) {
+template <class AddTerm>
+void S2RegionTermIndexer::VisitQueryTerms(const S2Point& point,
+                                          const AddTerm& add_term) const {
   // See the top of this file for an overview of the indexing strategy.
 
   const S2CellId id(point);
-  vector<string> terms;
   // Recall that all true_max_level() cells are indexed only as ancestor terms.
   int level = options_.true_max_level();
-  terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
-  if (options_.index_contains_points_only()) return terms;
+  add_term(TermType::ANCESTOR, id.parent(level));
+  if (options_.index_contains_points_only()) return;
 
   // Add covering terms for all the ancestor cells.
   for (; level >= options_.min_level(); level -= options_.level_mod()) {
-    terms.push_back(GetTerm(TermType::COVERING, id.parent(level), prefix));
+    add_term(TermType::COVERING, id.parent(level));
   }
-  return terms;
-}
-
-vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
-                                                  string_view prefix) {
-  // Note that options may have changed since the last call.
-  *coverer_.mutable_options() = options_;
-  S2CellUnion covering = coverer_.GetCovering(region);
-  return GetQueryTermsForCanonicalCovering(covering, prefix);
 }
 
-vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
-    const S2CellUnion& covering, string_view prefix) {
+template <class AddTerm>
+void S2RegionTermIndexer::VisitQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, const AddTerm& add_term) {
   // See the top of this file for an overview of the indexing strategy.
 
   if (google::DEBUG_MODE) {
     *coverer_.mutable_options() = options_;
     S2_CHECK(coverer_.IsCanonical(covering));
   }
-  vector<string> terms;
   S2CellId prev_id = S2CellId::None();
   int true_max_level = options_.true_max_level();
   for (S2CellId id : covering) {
@@ -244,7 +228,7 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
     S2_DCHECK_EQ(0, (level - options_.min_level()) % options_.level_mod());
 
     // Cells in the covering are always queried as ancestor terms.
-    terms.push_back(GetTerm(TermType::ANCESTOR, id, prefix));
+    add_term(TermType::ANCESTOR, id);
 
     // If the index only contains points, there are no covering terms.
     if (options_.index_contains_points_only()) continue;
@@ -253,7 +237,7 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
     // also queried as covering terms (except for true_max_level() cells,
     // which are indexed and queried as ancestor cells only).
     if (options_.optimize_for_space() && level < true_max_level) {
-      terms.push_back(GetTerm(TermType::COVERING, id, prefix));
+      add_term(TermType::COVERING, id);
     }
     // Finally, add covering terms for all the ancestors of this cell.
     while ((level -= options_.level_mod()) >= options_.min_level()) {
@@ -262,9 +246,180 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
           prev_id.parent(level) == ancestor_id) {
         break;  // We have already processed this cell and its ancestors.
       }
-      terms.push_back(GetTerm(TermType::COVERING, ancestor_id, prefix));
+      add_term(TermType::COVERING, ancestor_id);
     }
     prev_id = id;
   }
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
+                                                  string_view prefix) {
+  vector<string> terms;
+  VisitIndexTerms(point, [&](TermType term_type, S2CellId id) {
+      terms.push_back(GetTerm(term_type, id, prefix));
+    });
+  return terms;
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
+                                                  string_view prefix) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  return GetIndexTermsForCanonicalCovering(covering, prefix);
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, string_view prefix) {
+  vector<string> terms;
+  VisitIndexTermsForCanonicalCovering(
+      covering, [&](TermType term_type, S2CellId id) {
+        terms.push_back(GetTerm(term_type, id, prefix));
+      });
+  return terms;
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Point& point,
+                                                  string_view prefix) {
+  vector<string> terms;
+  VisitQueryTerms(point, [&](TermType term_type, S2CellId id) {
+      terms.push_back(GetTerm(term_type, id, prefix));
+    });
+  return terms;
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
+                                                  string_view prefix) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  return GetQueryTermsForCanonicalCovering(covering, prefix);
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, string_view prefix) {
+  vector<string> terms;
+  VisitQueryTermsForCanonicalCovering(
+      covering, [&](TermType term_type, S2CellId id) {
+        terms.push_back(GetTerm(term_type, id, prefix));
+      });
   return terms;
 }
+
+uint64 S2RegionTermIndexer::GetTermId(TermType term_type,
+                                      const S2CellId& id) {
+  if (term_type == TermType::ANCESTOR) return id.id();
+  S2_DCHECK(!id.is_leaf());
+  return id.id() | (id.lsb() >> 1);
+}
+
+bool S2RegionTermIndexer::IsCoveringTerm(uint64 term) {
+  // The lowest set bit of a valid S2CellId is always at an even position.
+  return (term & (~term + 1) & 0xAAAAAAAAAAAAAAAAULL) != 0;
+}
+
+S2CellId S2RegionTermIndexer::GetTermCellId(uint64 term) {
+  if (!IsCoveringTerm(term)) return S2CellId(term);
+  return S2CellId(term & (term - 1));  // Clears the lowest set bit.
+}
+
+string S2RegionTermIndexer::GetTermString(uint64 term,
+                                          string_view prefix) const {
+  return GetTerm(IsCoveringTerm(term) ? TermType::COVERING : TermType::ANCESTOR,
+                 GetTermCellId(term), prefix);
+}
+
+void S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
+                                        vector<uint64>* terms) {
+  terms->clear();
+  VisitIndexTerms(point, [terms](TermType term_type, S2CellId id) {
+      terms->push_back(GetTermId(term_type, id));
+    });
+}
+
+void S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
+                                        vector<uint64>* terms) {
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  GetIndexTermsForCanonicalCovering(covering, terms);
+}
+
+void S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, vector<uint64>* terms) {
+  terms->clear();
+  VisitIndexTermsForCanonicalCovering(
+      covering, [terms](TermType term_type, S2CellId id) {
+        terms->push_back(GetTermId(term_type, id));
+      });
+}
+
+void S2RegionTermIndexer::GetQueryTerms(const S2Point& point,
+                                        vector<uint64>* terms) {
+  terms->clear();
+  const int true_max_level = options_.true_max_level();
+  VisitQueryTerms(point, [=](TermType term_type, S2CellId id) {
+      // See the comments in the header regarding this term.
+      if (term_type == TermType::COVERING && id.level() == true_max_level) {
+        return;
+      }
+      terms->push_back(GetTermId(term_type, id));
+    });
+}
+
+void S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
+                                        vector<uint64>* terms) {
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  GetQueryTermsForCanonicalCovering(covering, terms);
+}
+
+void S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, vector<uint64>* terms) {
+  terms->clear();
+  VisitQueryTermsForCanonicalCovering(
+      covering, [terms](TermType term_type, S2CellId id) {
+        terms->push_back(GetTermId(term_type, id));
+      });
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTermsWithCostModel(
+    const S2Region& region, const TermCostFunction& term_cost,
+    string_view prefix, double* cost) {
+  vector<uint64> terms;
+  GetQueryTermsWithCostModel(region, term_cost, &terms, cost);
+  vector<string> result;
+  result.reserve(terms.size());
+  for (uint64 term : terms) {
+    result.push_back(GetTermString(term, prefix));
+  }
+  return result;
+}
+
+void S2RegionTermIndexer::GetQueryTermsWithCostModel(
+    const S2Region& region, const TermCostFunction& term_cost,
+    vector<uint64>* terms, double* cost) {
+  terms->clear();
+  vector<uint64> candidate_terms;
+  S2CellUnion prev_covering;
+  double best_cost = std::numeric_limits<double>::infinity();
+  const int max_cells = options_.max_cells();
+  for (int num_cells = 1; ; num_cells = std::min(2 * num_cells, max_cells)) {
+    // Note that options may have changed since the last call.
+    *coverer_.mutable_options() = options_;
+    coverer_.mutable_options()->set_max_cells(num_cells);
+    S2CellUnion covering = coverer_.GetCovering(region);
+    // Allowing more cells often yields the same covering.
+    if (num_cells == 1 || covering != prev_covering) {
+      GetQueryTermsForCanonicalCovering(covering, &candidate_terms);
+      double candidate_cost = 0;
+      for (uint64 term : candidate_terms) candidate_cost += term_cost(term);
+      if (candidate_cost < best_cost) {
+        best_cost = candidate_cost;
+        terms->swap(candidate_terms);
+      }
+      prev_covering = std::move(covering);
+    }
+    if (num_cells >= max_cells) break;
+  }
+  if (cost) *cost = best_cost;
+}
@@ -97,12 +97,15 @@
 #ifndef S2_S2REGION_TERM_INDEXER_H_
 #define S2_S2REGION_TERM_INDEXER_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2region.h"
 #include "s2/s2region_coverer.h"
+#include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/strings/string_view.h"
 
 class S2RegionTermIndexer {
@@ -286,12 +289,87 @@ class S2RegionTermIndexer {
   std::vector<string> GetQueryTermsForCanonicalCovering(
       const S2CellUnion& covering, absl::string_view prefix);
 
+  // The methods below are like the ones above, except that each term is
+  // represented by a 64-bit integer rather than a string.  This avoids
+  // allocating a string for every term, and "terms" can be reused across
+  // calls to avoid allocating memory for the result.  (Any previous contents
+  // of "terms" are discarded.)  GetTermString() converts an integer term to
+  // the corresponding string term.
+  //
+  // An ancestor term is simply S2CellId::id().  A covering term is the id()
+  // with the bit just below its lowest set bit also set.  This is never a
+  // valid S2CellId (whose lowest set bit is always at an even position), so
+  // the two kinds of terms are distinct.
+  //
+  // The terms are the same as those returned by the string methods, except
+  // that GetQueryTerms(S2Point) omits the covering term for the
+  // true_max_level() cell.  That term can never match an index term (since
+  // true_max_level() cells are only indexed as ancestor terms), and omitting
+  // it ensures that covering terms are never needed for leaf cells.
+  void GetIndexTerms(const S2Region& region, std::vector<uint64>* terms);
+  void GetQueryTerms(const S2Region& region, std::vector<uint64>* terms);
+  void GetIndexTerms(const S2Point& point, std::vector<uint64>* terms);
+  void GetQueryTerms(const S2Point& point, std::vector<uint64>* terms);
+  void GetIndexTermsForCanonicalCovering(const S2CellUnion& covering,
+                                         std::vector<uint64>* terms);
+  void GetQueryTermsForCanonicalCovering(const S2CellUnion& covering,
+                                         std::vector<uint64>* terms);
+
+  // Returns the string form of an integer term, as returned by the methods
+  // that return strings.  "prefix" should match the value used elsewhere.
+  string GetTermString(uint64 term, absl::string_view prefix) const;
+
+  // Returns true if the given integer term is a covering term rather than
+  // an ancestor term.
+  static bool IsCoveringTerm(uint64 term);
+
+  // Returns the cell that the given integer term refers to.
+  static S2CellId GetTermCellId(uint64 term);
+
+  // A function that returns the expected cost of looking up the given
+  // integer query term, e.g. the length of its posting list in the index
+  // (optionally plus a fixed per-term overhead).  GetTermCellId() and
+  // IsCoveringTerm() can be used to decode the term.
+  using TermCostFunction = std::function<double(uint64 term)>;
+
+  // Like GetQueryTerms(region, ...), except that rather than always using
+  // a covering with up to max_cells() cells, the covering is chosen to
+  // minimize the total cost of its query terms as estimated by "term_cost".
+  // Coverings with fewer cells have fewer terms but match more documents
+  // outside the query region; this method finds the best tradeoff.  The
+  // coverings considered have 1, 2, 4, ... cells up to max_cells(), so
+  // max_cells() should be set to the largest number of cells that is
+  // acceptable.  If "cost" is not nullptr, it is set to the total cost.
+  std::vector<string> GetQueryTermsWithCostModel(
+      const S2Region& region, const TermCostFunction& term_cost,
+      absl::string_view prefix, double* cost = nullptr);
+  void GetQueryTermsWithCostModel(const S2Region& region,
+                                  const TermCostFunction& term_cost,
+                                  std::vector<uint64>* terms,
+                                  double* cost = nullptr);
+
  private:
   enum TermType { ANCESTOR, COVERING };
 
+  static uint64 GetTermId(TermType term_type, const S2CellId& id);
+
   string GetTerm(TermType term_type, const S2CellId& id,
                  absl::string_view prefix) const;
 
+  // These methods generate the terms for the corresponding public methods by
+  // calling "add_term(term_type, id)" for each term in order.  They are used
+  // to generate both string and integer terms.
+  template <class AddTerm>
+  void VisitIndexTerms(const S2Point& point, const AddTerm& add_term) const;
+  template <class AddTerm>
+  void VisitIndexTermsForCanonicalCovering(const S2CellUnion& covering,
+                                           const AddTerm& add_term);
+  template <class AddTerm>
+  void VisitQueryTerms(const S2Point& point, const AddTerm& add_term) const;
+  template <class AddTerm>
+  void VisitQueryTermsForCanonicalCovering(const S2CellUnion& covering,
+                                           const AddTerm& add_term);
+
   Options options_;
   S2RegionCoverer coverer_;
 };
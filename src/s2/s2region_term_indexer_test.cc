@@ -190,6 +190,86 @@ TEST(S2RegionTermIndexer, MaxLevelSetLoosely) {
             indexer2.GetQueryTerms(cap, ""));
 }
 
+TEST(S2RegionTermIndexer, IntegerTermsMatchStringTerms) {
+  for (bool optimize_for_space : {false, true}) {
+    S2RegionTermIndexer::Options options;
+    options.set_min_level(2);
+    options.set_max_level(30);
+    options.set_level_mod(2);
+    options.set_optimize_for_space(optimize_for_space);
+    S2RegionTermIndexer indexer(options);
+    vector<uint64> terms;  // Reused across calls.
+    auto to_strings = [&indexer](const vector<uint64>& terms) {
+      vector<string> result;
+      for (uint64 term : terms) {
+        EXPECT_TRUE(S2RegionTermIndexer::GetTermCellId(term).is_valid());
+        result.push_back(indexer.GetTermString(term, "p_"));
+      }
+      return result;
+    };
+    for (int iter = 0; iter < 20; ++iter) {
+      S2Cap cap = S2Testing::GetRandomCap(1e-10, 0.1);
+      indexer.GetIndexTerms(cap, &terms);
+      EXPECT_EQ(indexer.GetIndexTerms(cap, "p_"), to_strings(terms));
+      indexer.GetQueryTerms(cap, &terms);
+      EXPECT_EQ(indexer.GetQueryTerms(cap, "p_"), to_strings(terms));
+
+      S2Point point = S2Testing::RandomPoint();
+      indexer.GetIndexTerms(point, &terms);
+      EXPECT_EQ(indexer.GetIndexTerms(point, "p_"), to_strings(terms));
+      // The integer version omits the covering term for the leaf cell.
+      indexer.GetQueryTerms(point, &terms);
+      vector<string> expected = indexer.GetQueryTerms(point, "p_");
+      expected.erase(expected.begin() + 1);
+      EXPECT_EQ(expected, to_strings(terms));
+    }
+  }
+  S2CellId id = S2CellId::FromFace(3).child_begin(10);
+  S2RegionTermIndexer indexer;
+  vector<uint64> terms;
+  indexer.GetIndexTermsForCanonicalCovering(S2CellUnion({id}), &terms);
+  ASSERT_FALSE(terms.empty());
+  EXPECT_TRUE(S2RegionTermIndexer::IsCoveringTerm(terms[0]));
+  EXPECT_EQ(id, S2RegionTermIndexer::GetTermCellId(terms[0]));
+  EXPECT_FALSE(S2RegionTermIndexer::IsCoveringTerm(id.id()));
+  EXPECT_FALSE(S2RegionTermIndexer::IsCoveringTerm(id.child_begin(30).id()));
+}
+
+TEST(S2RegionTermIndexer, CostModelChoosesCheapestCovering) {
+  S2RegionTermIndexer::Options options;
+  options.set_max_cells(32);
+  S2RegionTermIndexer indexer(options);
+  S2Cap cap = S2Testing::GetRandomCap(1e-6, 1e-4);
+
+  // If every term has the same cost, the cheapest covering is the one with
+  // the fewest terms.
+  auto unit_cost = [](uint64 term) { return 1.0; };
+  double cost;
+  vector<uint64> terms;
+  indexer.GetQueryTermsWithCostModel(cap, unit_cost, &terms, &cost);
+  EXPECT_EQ(terms.size(), cost);
+  for (int max_cells = 1; max_cells <= 32; max_cells *= 2) {
+    indexer.mutable_options()->set_max_cells(max_cells);
+    EXPECT_LE(terms.size(), indexer.GetQueryTerms(cap, "").size());
+  }
+
+  // If terms for large cells are very expensive (i.e., postings lists are
+  // long), the covering uses more and smaller cells.
+  indexer.mutable_options()->set_max_cells(32);
+  auto area_cost = [](uint64 term) {
+    return S2Cell(S2RegionTermIndexer::GetTermCellId(term)).ExactArea();
+  };
+  vector<uint64> area_terms;
+  indexer.GetQueryTermsWithCostModel(cap, area_cost, &area_terms);
+  EXPECT_GE(area_terms.size(), terms.size());
+  vector<string> strings =
+      indexer.GetQueryTermsWithCostModel(cap, area_cost, "p_");
+  ASSERT_EQ(area_terms.size(), strings.size());
+  for (int i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(indexer.GetTermString(area_terms[i], "p_"), strings[i]);
+  }
+}
+
 TEST(S2RegionTermIndexer, MoveConstructor) {
   S2RegionTermIndexer x;
   x.mutable_options()->set_max_cells(12345);
@@ -18,7 +18,9 @@
 #include "s2/s2region_union.h"
 
 #include "s2/s2cap.h"
+#include "s2/s2cell.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/third_party/absl/container/inlined_vector.h"
 
 using std::vector;
 
@@ -41,11 +43,13 @@ S2RegionUnion::S2RegionUnion(const S2RegionUnion& src)
 vector<std::unique_ptr<S2Region>> S2RegionUnion::Release() {
   vector<std::unique_ptr<S2Region>> result;
   result.swap(regions_);
+  index_.Reset();
   return result;
 }
 
 void S2RegionUnion::Add(std::unique_ptr<S2Region> region) {
   regions_.push_back(std::move(region));
+  index_.Reset();
 }
 
 S2RegionUnion* S2RegionUnion::Clone() const {
@@ -69,6 +73,13 @@ S2LatLngRect S2RegionUnion::GetRectBound() const {
 bool S2RegionUnion::Contains(const S2Cell& cell) const {
   // Note that this method is allowed to return false even if the cell
   // is contained by the region.
+  absl::InlinedVector<int, 16> region_ids;
+  if (index_.GetIntersectingRegions(regions_, cell.id(), &region_ids)) {
+    for (int i : region_ids) {
+      if (region(i)->Contains(cell)) return true;
+    }
+    return false;
+  }
   for (int i = 0; i < num_regions(); ++i) {
     if (region(i)->Contains(cell)) return true;
   }
@@ -83,6 +94,13 @@ bool S2RegionUnion::Contains(const S2Point& p) const {
 }
 
 bool S2RegionUnion::MayIntersect(const S2Cell& cell) const {
+  absl::InlinedVector<int, 16> region_ids;
+  if (index_.GetIntersectingRegions(regions_, cell.id(), &region_ids)) {
+    for (int i : region_ids) {
+      if (region(i)->MayIntersect(cell)) return true;
+    }
+    return false;
+  }
   for (int i = 0; i < num_regions(); ++i) {
     if (region(i)->MayIntersect(cell)) return true;
   }
@@ -24,6 +24,7 @@
 #include "s2/base/logging.h"
 #include "s2/_fp_contract_off.h"
 #include "s2/s2region.h"
+#include "s2/s2region_set_index.h"
 #include "s2/third_party/absl/base/macros.h"
 
 class Decoder;
@@ -77,6 +78,10 @@ class S2RegionUnion final : public S2Region {
 
   std::vector<std::unique_ptr<S2Region>> regions_;
 
+  // An index of the region coverings, used to avoid testing every region in
+  // Contains(S2Cell) and MayIntersect(S2Cell) when there are many regions.
+  S2RegionSetIndex index_;
+
   void operator=(const S2RegionUnion&) = delete;
 };
 
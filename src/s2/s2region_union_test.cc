@@ -29,6 +29,7 @@
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point_region.h"
 #include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using absl::make_unique;
@@ -86,4 +87,34 @@ TEST(S2RegionUnionTest, Basic) {
   EXPECT_EQ(face0.id(), covering[0]);
 }
 
+TEST(S2RegionUnionTest, ManyRegions) {
+  // With many regions, MayIntersect() and Contains() only test the regions
+  // whose coverings intersect the cell.  Check that the results are the same.
+  vector<S2Cap> caps;
+  S2RegionUnion region_union;
+  for (int i = 0; i < 200; ++i) {
+    caps.push_back(S2Testing::GetRandomCap(1e-10, 1e-3));
+    region_union.Add(make_unique<S2Cap>(caps.back()));
+  }
+  for (int i = 0; i < 5000; ++i) {
+    const S2Cap& cap = caps[S2Testing::rnd.Uniform(caps.size())];
+    S2Point p = (i % 2 == 0) ? S2Testing::SamplePoint(cap)
+                             : S2Testing::RandomPoint();
+    S2Cell cell(S2CellId(p).parent(S2Testing::rnd.Uniform(25)));
+    bool may_intersect = false, contains = false;
+    for (const S2Cap& c : caps) {
+      may_intersect |= c.MayIntersect(cell);
+      contains |= c.Contains(cell);
+    }
+    EXPECT_EQ(may_intersect, region_union.MayIntersect(cell));
+    EXPECT_EQ(contains, region_union.Contains(cell));
+  }
+
+  // Adding a region invalidates the index.
+  S2Cell face0 = S2Cell::FromFace(0);
+  EXPECT_FALSE(region_union.Contains(face0));
+  region_union.Add(make_unique<S2Cell>(face0));
+  EXPECT_TRUE(region_union.Contains(face0));
+}
+
 }  // namespace
@@ -20,6 +20,7 @@
 
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
 
 // The purpose of S2Shape is to represent polygonal geometry in a flexible
@@ -219,6 +220,22 @@ class S2Shape {
   // where     pos == shape.chain_position(edge_id).
   virtual ChainPosition chain_position(int edge_id) const = 0;
 
+  // If the vertices of chain "chain_id" are stored contiguously in memory,
+  // sets "vertices" to point to them and returns true.  The vertices are
+  // arranged such that edge "j" of the chain is
+  //
+  //   Edge(vertices[j], vertices[(j + 1) % vertices.size()])
+  //
+  // (e.g., polylines have chain(i).length + 1 vertices, while loops have
+  // chain(i).length vertices).  This allows code that visits entire chains
+  // to iterate over the raw vertex memory rather than making a virtual call
+  // per edge.  Returns false if the vertices are not available in this form
+  // (e.g. because they are encoded), in which case callers should fall back
+  // to chain_edge().  The default implementation always returns false.
+  virtual bool GetChainVertices(int chain_id, S2PointSpan* vertices) const {
+    return false;
+  }
+
   // A unique id assigned to this shape by S2ShapeIndex.  Shape ids are
   // assigned sequentially starting from 0 in the order shapes are added.
   //
@@ -271,6 +288,7 @@ class S2Shape {
  private:
   // Next available type tag available for use within the S2 library: 6.
 
+  friend class DeltaS2ShapeIndex;
   friend class EncodedS2ShapeIndex;
   friend class MutableS2ShapeIndex;
 
@@ -17,6 +17,9 @@
 
 #include "s2/s2shape_index.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 bool S2ClippedShape::ContainsEdge(int id) const {
   // Linear search is fast because the number of edges per shape is typically
   // very small (less than 10).
@@ -28,9 +31,11 @@ bool S2ClippedShape::ContainsEdge(int id) const {
 
 S2ShapeIndexCell::~S2ShapeIndexCell() {
   // Free memory for all shapes owned by this cell.
-  for (S2ClippedShape& s : shapes_)
-    s.Destruct();
-  shapes_.clear();
+  if (!owns_shapes_) return;
+  for (int i = 0; i < num_shapes_; ++i) {
+    shapes_[i].Destruct();
+  }
+  clear_shapes();
 }
 
 const S2ClippedShape*
@@ -38,8 +43,8 @@ S2ShapeIndexCell::find_clipped(int shape_id) const {
   // Linear search is fine because the number of shapes per cell is typically
   // very small (most often 1), and is large only for pathological inputs
   // (e.g. very deeply nested loops).
-  for (const auto& s : shapes_) {
-    if (s.shape_id() == shape_id) return &s;
+  for (int i = 0; i < num_shapes_; ++i) {
+    if (shapes_[i].shape_id() == shape_id) return &shapes_[i];
   }
   return nullptr;
 }
@@ -49,11 +54,38 @@ S2ShapeIndexCell::find_clipped(int shape_id) const {
 // shapes will have a larger shape id than any current shape, and that shapes
 // will be added in increasing shape id order.
 S2ClippedShape* S2ShapeIndexCell::add_shapes(int n) {
-  int size = shapes_.size();
-  shapes_.resize(size + n);
+  S2_DCHECK(owns_shapes_);
+  int size = num_shapes_;
+  shapes_ = static_cast<S2ClippedShape*>(
+      realloc(shapes_, (size + n) * sizeof(S2ClippedShape)));
+  // Value-initialize the new shapes so that they can be destroyed safely
+  // even if they are never initialized (e.g. when decoding fails).
+  std::fill(shapes_ + size, shapes_ + size + n, S2ClippedShape());
+  num_shapes_ = size + n;
   return &shapes_[size];
 }
 
+// Remove the clipped shape with the given shape id from the cell (if it is
+// present), freeing its edges if they are owned by this cell.
+void S2ShapeIndexCell::remove_clipped(int shape_id) {
+  for (int i = 0; i < num_shapes_; ++i) {
+    if (shapes_[i].shape_id() == shape_id) {
+      if (owns_shapes_) shapes_[i].Destruct();
+      std::copy(shapes_ + i + 1, shapes_ + num_shapes_, shapes_ + i);
+      --num_shapes_;
+      return;
+    }
+  }
+}
+
+// Free the array of clipped shapes without freeing any of their edges.  This
+// is used by classes that store the edge ids of their cells elsewhere.
+void S2ShapeIndexCell::clear_shapes() {
+  if (owns_shapes_) free(shapes_);
+  shapes_ = nullptr;
+  num_shapes_ = 0;
+}
+
 void S2ShapeIndexCell::Encode(int num_shape_ids, Encoder* encoder) const {
   // The encoding is designed to be especially compact in certain common
   // situations:
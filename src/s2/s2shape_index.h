@@ -41,7 +41,6 @@
 #include "s2/third_party/absl/base/macros.h"
 #include "s2/third_party/absl/base/thread_annotations.h"
 #include "s2/third_party/absl/memory/memory.h"
-#include "s2/util/gtl/compact_array.h"
 
 class R1Interval;
 class S2PaddedCell;
@@ -79,12 +78,15 @@ class S2ClippedShape {
   // This class may be copied by value, but note that it does *not* own its
   // underlying data.  (It is owned by the containing S2ShapeIndexCell.)
 
+  friend class CompactS2ShapeIndex;
+  friend class FlatS2ShapeIndex;
   friend class MutableS2ShapeIndex;
   friend class S2ShapeIndexCell;
   friend class S2Stats;
 
   // Internal methods are documented with their definition.
   void Init(int32 shape_id, int32 num_edges);
+  void Init(int32 shape_id, int32 num_edges, int32* edges);
   void Destruct();
   bool is_inline() const;
   void set_contains_center(bool contains_center);
@@ -113,7 +115,7 @@ class S2ShapeIndexCell {
   ~S2ShapeIndexCell();
 
   // Returns the number of clipped shapes in this cell.
-  int num_clipped() const { return shapes_.size(); }
+  int num_clipped() const { return num_shapes_; }
 
   // Returns the clipped shape at the given index.  Shapes are kept sorted in
   // increasing order of shape id.
@@ -143,18 +145,28 @@ class S2ShapeIndexCell {
   bool Decode(int num_shape_ids, Decoder* decoder);
 
  private:
+  friend class CompactS2ShapeIndex;
+  friend class FlatS2ShapeIndex;
   friend class MutableS2ShapeIndex;
   friend class EncodedS2ShapeIndex;
   friend class S2Stats;
 
   // Internal methods are documented with their definitions.
   S2ClippedShape* add_shapes(int n);
+  void remove_clipped(int shape_id);
+  void clear_shapes();
   static void EncodeEdges(const S2ClippedShape& clipped, Encoder* encoder);
   static bool DecodeEdges(int num_edges, S2ClippedShape* clipped,
                           Decoder* decoder);
 
-  using S2ClippedShapeSet = gtl::compact_array<S2ClippedShape>;
-  S2ClippedShapeSet shapes_;
+  // The clipped shapes are stored in an array that is normally allocated
+  // with malloc() and owned by the cell, along with the edge arrays of the
+  // clipped shapes.  If "owns_shapes_" is false then both the shape array
+  // and the edge arrays are owned by some other object (e.g. an arena
+  // belonging to the index), and the cell never frees them.
+  S2ClippedShape* shapes_ = nullptr;
+  int32 num_shapes_ = 0;
+  bool owns_shapes_ = true;
 
   S2ShapeIndexCell(const S2ShapeIndexCell&) = delete;
   void operator=(const S2ShapeIndexCell&) = delete;
@@ -397,6 +409,12 @@ class S2ShapeIndex {
     // exists, returns false and leaves the iterator positioned arbitrarily.
     // The returned index cell is guaranteed to contain all edges that might
     // intersect the line segment between "target" and the cell center.
+    //
+    // If the iterator is already positioned at the cell containing "target",
+    // or at one of its neighbors in S2CellId order, or on either side of the
+    // gap between index cells that contains "target", then the result is
+    // determined without seeking.  This makes locating a sequence of nearby
+    // points (such as a GPS track) much faster than independent lookups.
     bool Locate(const S2Point& target) {
       return IteratorBase::LocateImpl(target, this);
     }
@@ -596,6 +614,19 @@ inline void S2ClippedShape::Init(int32 shape_id, int32 num_edges) {
   }
 }
 
+// Initialize an S2ClippedShape to hold the given number of edges, using the
+// given storage for the edge ids if they are not stored inline.  The storage
+// is not owned, so Destruct() must not be called.
+inline void S2ClippedShape::Init(int32 shape_id, int32 num_edges,
+                                 int32* edges) {
+  shape_id_ = shape_id;
+  num_edges_ = num_edges;
+  contains_center_ = false;
+  if (!is_inline()) {
+    edges_ = edges;
+  }
+}
+
 // Free any memory allocated by this S2ClippedShape.  We don't do this in
 // the destructor because S2ClippedShapes are copied by STL code, and we
 // don't want to repeatedly copy and free the edge data.  Instead the data
@@ -732,8 +763,22 @@ inline bool S2ShapeIndex::IteratorBase::LocateImpl(
   // "target_point".  Then if T is contained by an index cell, then the
   // containing cell is either I or I'.  We test for containment by comparing
   // the ranges of leaf cells spanned by T, I, and I'.
-
+  //
+  // Before seeking, we check whether T is in or next to the current cell,
+  // since consecutive calls often locate nearby points.  Moving to an
+  // adjacent cell is cheap compared to Seek() for all index types.
   S2CellId target(target_point);
+  if (!it->done()) {
+    if (target >= it->id().range_min()) {
+      if (target <= it->id().range_max()) return true;
+      it->Next();
+      if (it->done() || target < it->id().range_min()) return false;
+      if (target <= it->id().range_max()) return true;
+    } else {
+      if (!it->Prev() || target > it->id().range_max()) return false;
+      if (target >= it->id().range_min()) return true;
+    }
+  }
   it->Seek(target);
   if (!it->done() && it->id().range_min() <= target) return true;
   if (it->Prev() && it->id().range_max() >= target) return true;
@@ -18,8 +18,10 @@
 #include "s2/s2shape_index_buffered_region.h"
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 #include "s2/s2metrics.h"
+#include "s2/s2region_coverer.h"
 #include "s2/s2shape_index_region.h"
 
 using std::min;
@@ -111,3 +113,60 @@ bool S2ShapeIndexBufferedRegion::Contains(const S2Point& p) const {
   // Return true if the distance is less than or equal to "radius_".
   return query_.IsDistanceLess(&target, radius_successor_);
 }
+
+S2CellUnion S2ShapeIndexBufferedRegion::GetDilatedCovering(
+    int max_cells, int max_level) const {
+  // Cells at "level" are at least twice as wide as the radius, so every point
+  // within "radius_" of a cell at this level is contained by the cell or one
+  // of its 8 neighbors.
+  int level = min(max_level,
+                  S2::kMinWidth.GetLevelForMinValue(
+                      radius_.ToAngle().radians()) - 1);
+  S2RegionCoverer::Options options;
+  options.set_max_cells(max_cells);
+  options.set_max_level(std::max(0, level));
+  S2CellUnion covering = S2RegionCoverer(options).GetCovering(
+      MakeS2ShapeIndexRegion(&index()));
+  if (covering.empty()) return covering;
+  if (level < 0) {
+    vector<S2CellId> faces;
+    S2Cap::Full().GetCellUnionBound(&faces);
+    return S2CellUnion(std::move(faces));
+  }
+
+  // Any point within "radius_" of the indexed geometry is either contained by
+  // the covering, or it is within "radius_" of a covering cell that is on the
+  // boundary of the covering.  We find the boundary cells at "level" by
+  // subdividing covering cells that have a neighbor outside the covering.
+  // The neighbors of the boundary cells are then added if they are within
+  // "radius_" of the indexed geometry.
+  vector<S2CellId> stack(covering.begin(), covering.end());
+  vector<S2CellId> neighbors, candidates;
+  while (!stack.empty()) {
+    S2CellId id = stack.back();
+    stack.pop_back();
+    neighbors.clear();
+    id.AppendAllNeighbors(id.level(), &neighbors);
+    bool on_boundary = false;
+    for (S2CellId neighbor : neighbors) {
+      if (!covering.Contains(neighbor)) {
+        on_boundary = true;
+        if (id.level() == level) candidates.push_back(neighbor);
+      }
+    }
+    if (on_boundary && id.level() < level) {
+      for (S2CellId child = id.child_begin(); child != id.child_end();
+           child = child.next()) {
+        stack.push_back(child);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  vector<S2CellId> result(covering.begin(), covering.end());
+  for (S2CellId id : candidates) {
+    if (MayIntersect(S2Cell(id))) result.push_back(id);
+  }
+  return S2CellUnion(std::move(result));
+}
@@ -103,6 +103,23 @@ class S2ShapeIndexBufferedRegion final : public S2Region {
   // i.e. if it is within the given radius of any original shape.
   bool Contains(const S2Point& p) const override;
 
+  ////////////////////////////////////////////////////////////////////////
+  // Additional methods:
+
+  // Returns a covering of the buffered region that is computed by covering
+  // the original (unbuffered) index with up to "max_cells" cells, and then
+  // dilating that covering by the buffer radius using cell neighbors.
+  // Distances to the indexed geometry are only measured for the cells added
+  // along the boundary of the covering, which makes this much faster than
+  // S2RegionCoverer::GetCovering() when the radius is large compared to the
+  // detail of the indexed geometry (e.g., buffering a coastline by several
+  // kilometers).  The result typically has more than "max_cells" cells.
+  //
+  // The cells added by dilation have level at most "max_level", and also at
+  // most the level where the cell width is approximately twice the radius.
+  S2CellUnion GetDilatedCovering(int max_cells,
+                                 int max_level = S2CellId::kMaxLevel) const;
+
  private:
   S1ChordAngle radius_;
 
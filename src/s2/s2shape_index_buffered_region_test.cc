@@ -99,6 +99,27 @@ TEST(S2ShapeIndexBufferedRegion, BufferedPointVsCap) {
   S2Testing::CheckCovering(equivalent_cap, covering, true);
 }
 
+// Checks that "covering" contains the given index buffered by "radius" (see
+// TestBufferIndex below).
+void CheckBufferCovering(const S2ShapeIndex& index, S1ChordAngle radius,
+                         const S2CellUnion& covering) {
+  // Compute an S2Polygon representing the union of the cells in the covering.
+  S2Polygon covering_polygon;
+  covering_polygon.InitToCellUnionBorder(covering);
+  MutableS2ShapeIndex covering_index;
+  covering_index.Add(make_unique<S2Polygon::Shape>(&covering_polygon));
+
+  // (a) Check that the covering contains the original index.
+  EXPECT_TRUE(S2BooleanOperation::Contains(covering_index, index));
+
+  // (b) Check that the distance between the boundary of the covering and the
+  // the original indexed geometry is at least "radius".
+  S2ClosestEdgeQuery query(&covering_index);
+  query.mutable_options()->set_include_interiors(false);
+  S2ClosestEdgeQuery::ShapeIndexTarget target(&index);
+  EXPECT_FALSE(query.IsDistanceLess(&target, radius));
+}
+
 // Verifies that an arbitrary S2ShapeIndex is buffered correctly, by first
 // converting the covering to an S2Polygon and then checking that (a) the
 // S2Polygon contains the original geometry and (b) the distance between the
@@ -121,23 +142,25 @@ void TestBufferIndex(const string& index_str, S1Angle radius_angle,
     }
     cout << "\n\n" << std::flush;
   }
-  // Compute an S2Polygon representing the union of the cells in the covering.
-  S2Polygon covering_polygon;
-  covering_polygon.InitToCellUnionBorder(covering);
-  MutableS2ShapeIndex covering_index;
-  covering_index.Add(make_unique<S2Polygon::Shape>(&covering_polygon));
+  CheckBufferCovering(*index, radius, covering);
+}
 
-  // (a) Check that the covering contains the original index.
-  EXPECT_TRUE(S2BooleanOperation::Contains(covering_index, *index));
+// Like TestBufferIndex, but uses GetDilatedCovering().
+void TestDilatedCovering(const string& index_str, S1Angle radius_angle,
+                         int max_cells) {
+  auto index = MakeIndexOrDie(index_str);
+  S1ChordAngle radius(radius_angle);
+  S2ShapeIndexBufferedRegion region(index.get(), radius);
+  S2CellUnion covering = region.GetDilatedCovering(max_cells);
+  CheckBufferCovering(*index, radius, covering);
 
-  // (b) Check that the distance between the boundary of the covering and the
-  // the original indexed geometry is at least "radius".
-  S2ClosestEdgeQuery query(&covering_index);
-  query.mutable_options()->set_include_interiors(false);
-  S2ClosestEdgeQuery::ShapeIndexTarget target(index.get());
-  EXPECT_FALSE(query.IsDistanceLess(&target, radius));
+  // Every cell should intersect the buffered region.
+  for (S2CellId id : covering) {
+    EXPECT_TRUE(region.MayIntersect(S2Cell(id)));
+  }
 }
 
+
 TEST(S2ShapeIndexBufferedRegion, PointSet) {
   // Test buffering a set of points.
   S2RegionCoverer coverer;
@@ -160,3 +183,22 @@ TEST(S2ShapeIndexBufferedRegion, PolygonWithHole) {
   TestBufferIndex("# # 10:10, 10:100, 70:0; 11:11, 69:0, 11:99",
                   S1Angle::Degrees(2), &coverer);
 }
+
+TEST(S2ShapeIndexBufferedRegion, DilatedCovering) {
+  TestDilatedCovering("10:20 | 10:23 | 10:26 # #", S1Angle::Degrees(5), 20);
+  TestDilatedCovering("# 10:5, 20:30, -10:60, -60:100 #",
+                      S1Angle::Degrees(2), 50);
+  TestDilatedCovering("# # 10:10, 10:100, 70:0; 11:11, 69:0, 11:99",
+                      S1Angle::Degrees(0.5), 100);
+  TestDilatedCovering("34:25 # #", S1Angle::Zero(), 8);
+}
+
+TEST(S2ShapeIndexBufferedRegion, DilatedCoveringEmptyAndFull) {
+  MutableS2ShapeIndex index;
+  S2ShapeIndexBufferedRegion region(&index, S1Angle::Degrees(2));
+  EXPECT_TRUE(region.GetDilatedCovering(8).empty());
+
+  auto points = MakeIndexOrDie("0:0 | 0:90 # #");
+  S2ShapeIndexBufferedRegion large(points.get(), S1Angle::Degrees(60));
+  EXPECT_EQ(6, large.GetDilatedCovering(8).num_cells());
+}
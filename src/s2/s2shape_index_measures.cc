@@ -17,7 +17,12 @@
 
 #include "s2/s2shape_index_measures.h"
 
+#include <vector>
+
 #include "s2/s2shape_measures.h"
+#include "s2/util/thread/executor.h"
+
+using std::vector;
 
 namespace S2 {
 
@@ -89,4 +94,50 @@ S2Point GetCentroid(const S2ShapeIndex& index) {
   return centroid;
 }
 
+// Sets (*output)[i] to measure(shape(i)) for every shape id "i".
+template <class T, class Measure>
+static void GetShapeMeasures(const S2ShapeIndex& index, Measure measure,
+                             vector<T>* output, Executor* executor) {
+  output->assign(index.num_shape_ids(), T());
+  ParallelFor(executor, index.num_shape_ids(), [&](int i) {
+      S2Shape* shape = index.shape(i);
+      if (shape) (*output)[i] = measure(*shape);
+    });
+}
+
+void GetShapeLengths(const S2ShapeIndex& index, vector<S1Angle>* output,
+                     Executor* executor) {
+  GetShapeMeasures(index, [](const S2Shape& shape) {
+      return S2::GetLength(shape);
+    }, output, executor);
+}
+
+void GetShapePerimeters(const S2ShapeIndex& index, vector<S1Angle>* output,
+                        Executor* executor) {
+  GetShapeMeasures(index, [](const S2Shape& shape) {
+      return S2::GetPerimeter(shape);
+    }, output, executor);
+}
+
+void GetShapeAreas(const S2ShapeIndex& index, vector<double>* output,
+                   Executor* executor) {
+  GetShapeMeasures(index, [](const S2Shape& shape) {
+      return S2::GetArea(shape);
+    }, output, executor);
+}
+
+void GetShapeApproxAreas(const S2ShapeIndex& index, vector<double>* output,
+                         Executor* executor) {
+  GetShapeMeasures(index, [](const S2Shape& shape) {
+      return S2::GetApproxArea(shape);
+    }, output, executor);
+}
+
+void GetShapeCentroids(const S2ShapeIndex& index, vector<S2Point>* output,
+                       Executor* executor) {
+  GetShapeMeasures(index, [](const S2Shape& shape) {
+      return S2::GetCentroid(shape);
+    }, output, executor);
+}
+
 }  // namespace S2
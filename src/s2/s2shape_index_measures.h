@@ -22,10 +22,14 @@
 #ifndef S2_S2SHAPE_INDEX_MEASURES_H_
 #define S2_S2SHAPE_INDEX_MEASURES_H_
 
+#include <vector>
+
 #include "s2/s1angle.h"
 #include "s2/s2point.h"
 #include "s2/s2shape_index.h"
 
+class Executor;
+
 namespace S2 {
 
 // Returns the maximum dimension of any shape in the index.  Returns -1 if the
@@ -95,6 +99,30 @@ double GetApproxArea(const S2ShapeIndex& index);
 // centroids can simply be summed).
 S2Point GetCentroid(const S2ShapeIndex& index);
 
+// The following functions compute a measure of every shape in the index
+// separately, using the corresponding function in s2shape_measures.h.  On
+// return, (*output)[i] is the measure of the shape with id "i", or zero if
+// that shape has been removed.  If "executor" is not nullptr, the shapes are
+// processed concurrently, which is useful for indexes with many shapes
+// (e.g., millions of parcels).  The results do not depend on whether an
+// executor is used.
+void GetShapeLengths(const S2ShapeIndex& index, std::vector<S1Angle>* output,
+                     Executor* executor = nullptr);
+void GetShapePerimeters(const S2ShapeIndex& index,
+                        std::vector<S1Angle>* output,
+                        Executor* executor = nullptr);
+void GetShapeAreas(const S2ShapeIndex& index, std::vector<double>* output,
+                   Executor* executor = nullptr);
+void GetShapeApproxAreas(const S2ShapeIndex& index,
+                         std::vector<double>* output,
+                         Executor* executor = nullptr);
+
+// Like the above, but computes the centroid of every shape (scaled by its
+// measure, see S2::GetCentroid(const S2Shape&)).
+void GetShapeCentroids(const S2ShapeIndex& index,
+                       std::vector<S2Point>* output,
+                       Executor* executor = nullptr);
+
 }  // namespace S2
 
 #endif  // S2_S2SHAPE_INDEX_MEASURES_H_
@@ -21,14 +21,21 @@
 
 #include "s2/s2shape_index_measures.h"
 
+#include <functional>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "s2/base/mutex.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2pointutil.h"
+#include "s2/s2shape_measures.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using s2textformat::MakeIndexOrDie;
@@ -133,4 +140,51 @@ TEST(GetCentroid, Polygon) {
       S2::GetCentroid(*MakeIndexOrDie("5:5 # 6:6, 7:7 # 0:0, 0:90, 90:0"))));
 }
 
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+TEST(GetShapeMeasures, MatchShapeMeasures) {
+  auto index = MakeIndexOrDie(
+      "5:5 | 6:6 # 0:0, 0:90 | 1:1, 2:2 # "
+      "0:0, 0:90, 90:0 | 10:10, 10:11, 11:10");
+  index->Release(1);
+  ThreadPerTaskExecutor executor;
+  for (Executor* e : {static_cast<Executor*>(nullptr),
+                      static_cast<Executor*>(&executor)}) {
+    std::vector<double> areas;
+    std::vector<S1Angle> lengths;
+    std::vector<S2Point> centroids;
+    S2::GetShapeAreas(*index, &areas, e);
+    S2::GetShapeLengths(*index, &lengths, e);
+    S2::GetShapeCentroids(*index, &centroids, e);
+    ASSERT_EQ(index->num_shape_ids(), areas.size());
+    ASSERT_EQ(index->num_shape_ids(), centroids.size());
+    for (int i = 0; i < index->num_shape_ids(); ++i) {
+      const S2Shape* shape = index->shape(i);
+      if (shape == nullptr) {
+        EXPECT_EQ(0, areas[i]);
+        EXPECT_EQ(S2Point(), centroids[i]);
+        continue;
+      }
+      EXPECT_EQ(S2::GetArea(*shape), areas[i]);
+      EXPECT_EQ(S2::GetLength(*shape), lengths[i]);
+      EXPECT_EQ(S2::GetCentroid(*shape), centroids[i]);
+    }
+  }
+}
+
 }  // namespace
@@ -17,6 +17,7 @@
 #ifndef S2_S2SHAPE_INDEX_REGION_H_
 #define S2_S2SHAPE_INDEX_REGION_H_
 
+#include <algorithm>
 #include <vector>
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
@@ -68,6 +69,22 @@ class S2ShapeIndexRegion final : public S2Region {
 
   const IndexType& index() const;
 
+  // Returns a covering of the index consisting of at most "max_cells" cells
+  // (or one cell per intersected cube face, if that is larger).  The covering
+  // is derived directly from the index cells: it starts with the cells of the
+  // index itself and repeatedly replaces runs of adjacent cells by their
+  // deepest common ancestor until the limit is met, normalizing the result
+  // with S2CellUnion after each pass.  This takes time linear in the number
+  // of index cells (times at most 31 passes) and does not call
+  // Contains(S2Cell) or MayIntersect(S2Cell), which makes it much cheaper
+  // than S2RegionCoverer::GetCovering() on this region.  The tradeoff is
+  // that merged cells are never subdivided again, so the covering may be
+  // somewhat looser than the one chosen by S2RegionCoverer.
+  //
+  // The result is a normalized, sorted list of cells that covers every
+  // index cell (and therefore every shape in the index).
+  void GetCovering(int max_cells, std::vector<S2CellId>* covering) const;
+
   ////////////////////////////////////////////////////////////////////////
   // S2Region interface (see s2region.h for details):
 
@@ -246,6 +263,54 @@ inline void S2ShapeIndexRegion<IndexType>::CoverRange(
   }
 }
 
+template <class IndexType>
+void S2ShapeIndexRegion<IndexType>::GetCovering(
+    int max_cells, std::vector<S2CellId>* covering) const {
+  covering->clear();
+  for (iter_.Begin(); !iter_.done(); iter_.Next()) {
+    covering->push_back(iter_.id());
+  }
+  // The index cells are already sorted and disjoint, but groups of four
+  // sibling cells may still be replaced by their parent.
+  S2CellUnion::Normalize(covering);
+
+  const size_t limit = std::max(max_cells, 1);
+  std::vector<S2CellId> merged;
+  while (covering->size() > limit) {
+    // Find the deepest level at which two adjacent cells have a common
+    // ancestor.  Merging at that level loses the least precision.
+    int level = -1;
+    for (size_t i = 1; i < covering->size(); ++i) {
+      level = std::max(level, (*covering)[i - 1].GetCommonAncestorLevel(
+                                  (*covering)[i]));
+    }
+    if (level < 0) break;  // One cell per face; no further merging possible.
+
+    // Merge runs of cells that share an ancestor at "level", stopping once
+    // the covering is small enough.  Cells contained by an ancestor that was
+    // already added are always absorbed.
+    int excess = covering->size() - limit;
+    merged.clear();
+    for (S2CellId id : *covering) {
+      if (!merged.empty()) {
+        S2CellId& back = merged.back();
+        if (back.contains(id)) {
+          --excess;
+          continue;
+        }
+        if (excess > 0 && back.GetCommonAncestorLevel(id) >= level) {
+          back = id.parent(level);
+          --excess;
+          continue;
+        }
+      }
+      merged.push_back(id);
+    }
+    covering->swap(merged);
+    S2CellUnion::Normalize(covering);
+  }
+}
+
 template <class IndexType>
 bool S2ShapeIndexRegion<IndexType>::Contains(const S2Cell& target) const {
   S2ShapeIndex::CellRelation relation = iter_.Locate(target.id());
@@ -104,6 +104,58 @@ TEST(S2ShapeIndexRegion, GetCellUnionBoundOneFace) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(S2ShapeIndexRegion, GetCoveringContainsIndexCells) {
+  vector<S2CellId> input = {
+    MakeCellId("5/010"), MakeCellId("5/0211030"),
+    MakeCellId("5/110230123"), MakeCellId("5/11023021133"),
+    MakeCellId("5/311020003003030303"), MakeCellId("5/311020023"),
+  };
+  MutableS2ShapeIndex index;
+  for (auto id : input) {
+    for (int copy = 0; copy < 3; ++copy) {
+      index.Add(NewPaddedCell(id, -kPadding));
+    }
+  }
+  vector<S2CellId> index_cells;
+  MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  for (; !it.done(); it.Next()) index_cells.push_back(it.id());
+  ASSERT_GT(index_cells.size(), 8);
+
+  auto region = MakeS2ShapeIndexRegion(&index);
+  for (int max_cells : {1, 2, 3, 4, 8, 20}) {
+    vector<S2CellId> covering;
+    region.GetCovering(max_cells, &covering);
+    EXPECT_LE(covering.size(), max_cells);
+    S2CellUnion cell_union(covering);
+    EXPECT_TRUE(cell_union.IsNormalized());
+    EXPECT_EQ(cell_union.cell_ids(), covering);
+    for (S2CellId id : index_cells) {
+      EXPECT_TRUE(cell_union.Contains(id)) << max_cells << ": " << id;
+    }
+  }
+  // With a large enough limit the covering is just the (normalized) index.
+  vector<S2CellId> covering;
+  region.GetCovering(1000, &covering);
+  EXPECT_EQ(S2CellUnion(index_cells).cell_ids(), covering);
+}
+
+TEST(S2ShapeIndexRegion, GetCoveringMultipleFaces) {
+  vector<S2CellId> ids = { MakeCellId("3/00123"), MakeCellId("2/11200013") };
+  MutableS2ShapeIndex index;
+  for (auto id : ids) index.Add(NewPaddedCell(id, -kPadding));
+  vector<S2CellId> covering;
+  MakeS2ShapeIndexRegion(&index).GetCovering(1, &covering);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, covering);
+}
+
+TEST(S2ShapeIndexRegion, GetCoveringEmptyIndex) {
+  MutableS2ShapeIndex index;
+  vector<S2CellId> covering = {MakeCellId("1/")};
+  MakeS2ShapeIndexRegion(&index).GetCovering(8, &covering);
+  EXPECT_TRUE(covering.empty());
+}
+
 TEST(S2ShapeIndexRegion, ContainsCellMultipleShapes) {
   auto id = S2CellId::FromDebugString("3/0123012301230123012301230123");
 
@@ -27,14 +27,34 @@ using std::vector;
 
 namespace S2 {
 
+namespace {
+
+// Returns the vertices of the given edge chain in the format returned by
+// GetChainVertices().  The shape's own vertex storage is used if possible,
+// and otherwise the vertices are copied into "tmp".
+S2PointSpan GetChainVertexSpan(const S2Shape& shape, int chain_id,
+                               vector<S2Point>* tmp) {
+  S2PointSpan vertices;
+  // S2Shape::GetChainVertices() does not repeat the first vertex of closed
+  // polylines, so its result is not used for them.
+  if (shape.GetChainVertices(chain_id, &vertices) &&
+      vertices.size() ==
+          shape.chain(chain_id).length + (shape.dimension() == 1)) {
+    return vertices;
+  }
+  GetChainVertices(shape, chain_id, tmp);
+  return *tmp;
+}
+
+}  // namespace
+
 S1Angle GetLength(const S2Shape& shape) {
   if (shape.dimension() != 1) return S1Angle::Zero();
   S1Angle length;
   vector<S2Point> vertices;
   int num_chains = shape.num_chains();
   for (int chain_id = 0; chain_id < num_chains; ++chain_id) {
-    GetChainVertices(shape, chain_id, &vertices);
-    length += S2::GetLength(vertices);
+    length += S2::GetLength(GetChainVertexSpan(shape, chain_id, &vertices));
   }
   return length;
 }
@@ -45,8 +65,8 @@ S1Angle GetPerimeter(const S2Shape& shape) {
   vector<S2Point> vertices;
   int num_chains = shape.num_chains();
   for (int chain_id = 0; chain_id < num_chains; ++chain_id) {
-    GetChainVertices(shape, chain_id, &vertices);
-    perimeter += S2::GetPerimeter(vertices);
+    S2PointSpan span = GetChainVertexSpan(shape, chain_id, &vertices);
+    perimeter += S2::GetPerimeter(S2PointLoopSpan(span.data(), span.size()));
   }
   return perimeter;
 }
@@ -70,8 +90,8 @@ double GetArea(const S2Shape& shape) {
   vector<S2Point> vertices;
   int num_chains = shape.num_chains();
   for (int chain_id = 0; chain_id < num_chains; ++chain_id) {
-    GetChainVertices(shape, chain_id, &vertices);
-    area += S2::GetSignedArea(vertices);
+    S2PointSpan span = GetChainVertexSpan(shape, chain_id, &vertices);
+    area += S2::GetSignedArea(S2PointLoopSpan(span.data(), span.size()));
   }
   // Note that S2::GetSignedArea() guarantees that the full loop (containing
   // all points on the sphere) has a very small negative area.
@@ -87,8 +107,8 @@ double GetApproxArea(const S2Shape& shape) {
   vector<S2Point> vertices;
   int num_chains = shape.num_chains();
   for (int chain_id = 0; chain_id < num_chains; ++chain_id) {
-    GetChainVertices(shape, chain_id, &vertices);
-    area += S2::GetApproxArea(vertices);
+    S2PointSpan span = GetChainVertexSpan(shape, chain_id, &vertices);
+    area += S2::GetApproxArea(S2PointLoopSpan(span.data(), span.size()));
   }
   // Special case to ensure that full polygons are handled correctly.
   if (area <= 4 * M_PI) return area;
@@ -106,13 +126,14 @@ S2Point GetCentroid(const S2Shape& shape) {
         centroid += shape.edge(chain_id).v0;
         break;
       case 1:
-        GetChainVertices(shape, chain_id, &vertices);
-        centroid += S2::GetCentroid(S2PointSpan(vertices));
+        centroid += S2::GetCentroid(
+            GetChainVertexSpan(shape, chain_id, &vertices));
         break;
-      default:
-        GetChainVertices(shape, chain_id, &vertices);
-        centroid += S2::GetCentroid(S2PointLoopSpan(vertices));
+      default: {
+        S2PointSpan span = GetChainVertexSpan(shape, chain_id, &vertices);
+        centroid += S2::GetCentroid(S2PointLoopSpan(span.data(), span.size()));
         break;
+      }
     }
   }
   return centroid;
@@ -24,16 +24,21 @@
 #include <gtest/gtest.h>
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2edge_vector_shape.h"
+#include "s2/s2lax_loop_shape.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point_vector_shape.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/s2shapeutil_testing.h"
 #include "s2/s2text_format.h"
 
 using s2textformat::MakeIndexOrDie;
 using s2textformat::MakeLaxPolygonOrDie;
 using s2textformat::MakeLaxPolylineOrDie;
 using s2textformat::MakePolygonOrDie;
+using s2textformat::MakePolylineOrDie;
 using s2textformat::ParsePointsOrDie;
 
 namespace {
@@ -136,4 +141,43 @@ TEST(GetCentroid, Polygon) {
       S2::GetCentroid(*MakeLaxPolygonOrDie("0:0, 0:90, 90:0"))));
 }
 
+TEST(GetChainVertices, ContiguousStorageMatchesEdges) {
+  // Shapes that store their vertices contiguously expose them through
+  // S2Shape::GetChainVertices(), which must agree with chain_edge().
+  using s2testing::ExpectChainVerticesConsistent;
+  EXPECT_EQ(2, ExpectChainVerticesConsistent(
+      *MakeLaxPolygonOrDie("0:0, 0:3, 3:3; 1:1")));
+  EXPECT_EQ(1, ExpectChainVerticesConsistent(
+      *MakeLaxPolylineOrDie("0:0, 0:3, 3:3")));
+  EXPECT_EQ(3, ExpectChainVerticesConsistent(S2PointVectorShape(
+      ParsePointsOrDie("0:0, 0:3, 3:3"))));
+  EXPECT_EQ(1, ExpectChainVerticesConsistent(S2LaxClosedPolylineShape(
+      ParsePointsOrDie("0:0, 0:3, 3:3"))));
+  auto polyline = MakePolylineOrDie("0:0, 0:3, 3:3");
+  EXPECT_EQ(1, ExpectChainVerticesConsistent(
+      S2Polyline::Shape(polyline.get())));
+
+  // S2Polygon holes are stored with the opposite orientation, so only the
+  // shell is available.
+  auto polygon = MakePolygonOrDie("0:0, 0:3, 3:3; 1:1, 1:2, 2:2");
+  EXPECT_EQ(1, ExpectChainVerticesConsistent(
+      S2Polygon::Shape(polygon.get())));
+  auto full = MakePolygonOrDie("full");
+  EXPECT_EQ(0, ExpectChainVerticesConsistent(S2Polygon::Shape(full.get())));
+}
+
+TEST(GetLength, ClosedPolyline) {
+  // GetChainVertices() does not repeat the first vertex of closed polylines,
+  // so the measures must still include the closing edge.
+  S2LaxClosedPolylineShape shape(ParsePointsOrDie("0:0, 0:90, 90:0"));
+  EXPECT_DOUBLE_EQ(3 * M_PI_2, S2::GetLength(shape).radians());
+}
+
+TEST(GetArea, PolygonWithHoleMatchesS2Polygon) {
+  auto polygon = MakePolygonOrDie("0:0, 0:3, 3:3, 3:0; 1:1, 1:2, 2:2, 2:1");
+  S2Polygon::Shape shape(polygon.get());
+  EXPECT_NEAR(polygon->GetArea(), S2::GetArea(shape), 1e-15);
+  EXPECT_NEAR(polygon->GetArea(), S2::GetApproxArea(shape), 1e-15);
+}
+
 }  // namespace
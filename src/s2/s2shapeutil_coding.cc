@@ -17,6 +17,8 @@
 
 #include "s2/s2shapeutil_coding.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #include "s2/third_party/absl/memory/memory.h"
@@ -27,6 +29,7 @@
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2polygon.h"
 #include "s2/s2polyline.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using std::make_shared;
@@ -62,6 +65,16 @@ bool FastEncodeShape(const S2Shape& shape, Encoder* encoder) {
           encoder, CodingHint::FAST);
       return true;
     }
+    case S2SoAPointVectorShape::kTypeTag: {
+      down_cast<const S2SoAPointVectorShape*>(&shape)->Encode(
+          encoder, CodingHint::FAST);
+      return true;
+    }
+    case S2SoALaxPolylineShape::kTypeTag: {
+      down_cast<const S2SoALaxPolylineShape*>(&shape)->Encode(
+          encoder, CodingHint::FAST);
+      return true;
+    }
     default: {
       S2_LOG(DFATAL) << "Unsupported S2Shape type: " << shape.type_tag();
       return false;
@@ -90,6 +103,16 @@ bool CompactEncodeShape(const S2Shape& shape, Encoder* encoder) {
           encoder, CodingHint::COMPACT);
       return true;
     }
+    case S2SoAPointVectorShape::kTypeTag: {
+      down_cast<const S2SoAPointVectorShape*>(&shape)->Encode(
+          encoder, CodingHint::COMPACT);
+      return true;
+    }
+    case S2SoALaxPolylineShape::kTypeTag: {
+      down_cast<const S2SoALaxPolylineShape*>(&shape)->Encode(
+          encoder, CodingHint::COMPACT);
+      return true;
+    }
     default: {
       return FastEncodeShape(shape, encoder);
     }
@@ -125,6 +148,16 @@ unique_ptr<S2Shape> FullDecodeShape(S2Shape::TypeTag tag, Decoder* decoder) {
       if (!shape->Init(decoder)) return nullptr;
       return std::move(shape);
     }
+    case S2SoAPointVectorShape::kTypeTag: {
+      auto shape = make_unique<S2SoAPointVectorShape>();
+      if (!shape->Init(decoder)) return nullptr;
+      return std::move(shape);
+    }
+    case S2SoALaxPolylineShape::kTypeTag: {
+      auto shape = make_unique<S2SoALaxPolylineShape>();
+      if (!shape->Init(decoder)) return nullptr;
+      return std::move(shape);
+    }
     default: {
       S2_LOG(DFATAL) << "Unsupported S2Shape type: " << tag;
       return nullptr;
@@ -155,33 +188,87 @@ unique_ptr<S2Shape> LazyDecodeShape(S2Shape::TypeTag tag, Decoder* decoder) {
   }
 }
 
+// Appends the tagged encoding of "shape" (which may be nullptr) to "encoder".
+static bool EncodeTaggedShape(const S2Shape* shape,
+                              const ShapeEncoder& shape_encoder,
+                              Encoder* encoder) {
+  if (shape == nullptr) return true;  // Encode as zero bytes.
+
+  uint32 tag = shape->type_tag();
+  if (tag == S2Shape::kNoTypeTag) {
+    S2_LOG(DFATAL) << "Unsupported S2Shape type: " << tag;
+    return false;
+  }
+  encoder->Ensure(Encoder::kVarintMax32);
+  encoder->put_varint32(tag);
+  shape_encoder(*shape, encoder);
+  return true;
+}
+
 bool EncodeTaggedShapes(const S2ShapeIndex& index,
                         const ShapeEncoder& shape_encoder,
-                        Encoder* encoder) {
+                        Encoder* encoder, Executor* executor) {
+  if (encoder->has_sink()) {
+    // Encode the shapes directly to the sink rather than buffering them all
+    // in memory (see StringVectorEncoder::EncodeStreaming).
+    return s2coding::StringVectorEncoder::EncodeStreaming(
+        index.num_shape_ids(), [&](int id, Encoder* output) {
+          return EncodeTaggedShape(index.shape(id), shape_encoder, output);
+        }, encoder);
+  }
   s2coding::StringVectorEncoder shape_vector;
-  for (S2Shape* shape : index) {
-    Encoder* sub_encoder = shape_vector.AddViaEncoder();
-    if (shape == nullptr) continue;  // Encode as zero bytes.
-
-    uint32 tag = shape->type_tag();
-    if (tag == S2Shape::kNoTypeTag) {
-      S2_LOG(DFATAL) << "Unsupported S2Shape type: " << tag;
-      return false;
+  if (executor == nullptr) {
+    for (S2Shape* shape : index) {
+      if (!EncodeTaggedShape(shape, shape_encoder,
+                             shape_vector.AddViaEncoder())) {
+        return false;
+      }
+    }
+    shape_vector.Encode(encoder);
+    return true;
+  }
+  // Each chunk of consecutive shapes is encoded into its own buffer, along
+  // with the end offset of each shape within that buffer.  The buffers are
+  // then added to "shape_vector" in order, which yields the same offsets and
+  // data as encoding the shapes sequentially.
+  static const int kShapesPerChunk = 16;
+  const int num_shapes = index.num_shape_ids();
+  const int num_chunks = (num_shapes + kShapesPerChunk - 1) / kShapesPerChunk;
+  vector<Encoder> chunks(num_chunks);
+  vector<vector<size_t>> ends(num_chunks);
+  std::atomic<bool> ok(true);
+  ParallelFor(executor, num_chunks, [&](int i) {
+      const int begin = i * kShapesPerChunk;
+      const int end = std::min(begin + kShapesPerChunk, num_shapes);
+      for (int id = begin; id < end; ++id) {
+        if (!EncodeTaggedShape(index.shape(id), shape_encoder, &chunks[i])) {
+          ok.store(false, std::memory_order_relaxed);
+          return;
+        }
+        ends[i].push_back(chunks[i].length());
+      }
+    });
+  if (!ok.load(std::memory_order_relaxed)) return false;
+  for (int i = 0; i < num_chunks; ++i) {
+    const char* data = chunks[i].base();
+    size_t start = 0;
+    for (size_t end : ends[i]) {
+      shape_vector.Add(absl::string_view(data + start, end - start));
+      start = end;
     }
-    sub_encoder->Ensure(Encoder::kVarintMax32);
-    sub_encoder->put_varint32(tag);
-    shape_encoder(*shape, sub_encoder);
   }
   shape_vector.Encode(encoder);
   return true;
 }
 
-bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder) {
-  return EncodeTaggedShapes(index, FastEncodeShape, encoder);
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                            Executor* executor) {
+  return EncodeTaggedShapes(index, FastEncodeShape, encoder, executor);
 }
 
-bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder) {
-  return EncodeTaggedShapes(index, CompactEncodeShape, encoder);
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                               Executor* executor) {
+  return EncodeTaggedShapes(index, CompactEncodeShape, encoder, executor);
 }
 
 TaggedShapeFactory::TaggedShapeFactory(const ShapeDecoder& shape_decoder,
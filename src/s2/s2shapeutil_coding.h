@@ -43,6 +43,8 @@
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 
+class Executor;
+
 namespace s2shapeutil {
 
 // A function that appends a serialized representation of the given shape to
@@ -114,25 +116,37 @@ std::unique_ptr<S2Shape> LazyDecodeShape(S2Shape::TypeTag tag,
 // This is because when the index is decoded, the shape vector is required as
 // a parameter.
 //
-// REQUIRES: "encoder" uses the default constructor, so that its buffer
-//           can be enlarged as necessary by calling Ensure(int).
+// If "executor" is not nullptr, the shapes are encoded in parallel into
+// separate buffers that are then concatenated.  The output is identical
+// either way.  "shape_encoder" must then be safe to call concurrently.
+//
+// If "encoder" passes its output to an Encoder::Sink, then the shapes are
+// instead encoded one at a time directly to the sink (and "executor" is
+// ignored).  This avoids buffering the entire encoding in memory, at the
+// cost of encoding each shape twice (see
+// StringVectorEncoder::EncodeStreaming).
+//
+// REQUIRES: "encoder" uses the default constructor or a Sink, so that its
+//           buffer can be enlarged as necessary by calling Ensure(int).
 bool EncodeTaggedShapes(const S2ShapeIndex& index,
                         const ShapeEncoder& shape_encoder,
-                        Encoder* encoder);
+                        Encoder* encoder, Executor* executor = nullptr);
 
 // Convenience function that calls EncodeTaggedShapes using FastEncodeShape as
 // the ShapeEncoder.
 //
 // REQUIRES: "encoder" uses the default constructor, so that its buffer
 //           can be enlarged as necessary by calling Ensure(int).
-bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder);
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                            Executor* executor = nullptr);
 
 // Convenience function that calls EncodeTaggedShapes using CompactEncodeShape
 // as the ShapeEncoder.
 //
 // REQUIRES: "encoder" uses the default constructor, so that its buffer
 //           can be enlarged as necessary by calling Ensure(int).
-bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder);
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                               Executor* executor = nullptr);
 
 // A ShapeFactory that decodes a vector generated by EncodeTaggedShapes()
 // above.  Example usage:
@@ -0,0 +1,510 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Benchmarks that compare the available shape and index encodings, so that
+// clients can choose among them using their own geometry.  Every benchmark
+// takes an argument "compact" that selects the compact (1) or the fast (0)
+// variant of an encoding:
+//
+//  - Shapes:  CompactEncodeTaggedShapes() vs. FastEncodeTaggedShapes().
+//  - Index:   the shapes as above, followed by MutableS2ShapeIndex::Encode().
+//  - Polygon: S2Polygon::Encode() vs. S2Polygon::EncodeUncompressed().
+//  - Points:  EncodeS2PointVector() with CodingHint::COMPACT (which uses
+//             S2CellIds when the points are snapped) vs. CodingHint::FAST.
+//
+// Each benchmark reports the encoded size as the "bytes" counter.  There are
+// separate benchmarks for encoding (where "items" are edges or points), for
+// decoding everything, for lazy decoding (i.e. the setup time before the
+// data can be used), and for the latency of a first query (a lazy decode
+// followed by one point containment test or point lookup).
+//
+// By default the geometry consists of a fractal polygon, some polylines, and
+// some points snapped to S2CellId centers.  To use real geometry instead,
+// set the environment variable S2_CODING_BENCHMARK_INPUT to the name of a
+// file that contains either an S2ShapeIndex in s2textformat (see
+// s2text_format.h), or a WKB geometry if the file name ends in ".wkb" (see
+// s2wkb.h).  For example:
+//
+//   S2_CODING_BENCHMARK_INPUT=parcels.wkb ./s2shapeutil_coding_benchmark
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "s2/base/logging.h"
+#include "s2/encoded_s2point_vector.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/s2wkb.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/third_party/absl/strings/match.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/util/coding/coder.h"
+
+using absl::make_unique;
+using s2coding::CodingHint;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The geometry shared by all benchmarks.
+struct Geometry {
+  unique_ptr<MutableS2ShapeIndex> index;
+
+  // The polygonal shapes of "index" that are valid S2Polygons.
+  vector<unique_ptr<S2Polygon>> polygons;
+
+  // The vertices of all shapes of "index".
+  vector<S2Point> vertices;
+
+  // Points near the vertices, used for the first-query benchmarks.
+  vector<S2Point> query_points;
+
+  int num_edges = 0;
+};
+
+void AddSyntheticShapes(MutableS2ShapeIndex* index) {
+  S2Testing::rnd.Reset(1);
+  S2Testing::Fractal fractal;
+  fractal.SetLevelForApproxMaxEdges(10000);
+  S2Point center = S2Testing::RandomPoint();
+  auto loop = fractal.MakeLoop(S2Testing::GetRandomFrameAt(center),
+                               S2Testing::KmToAngle(100));
+  vector<S2Point> loop_vertices;
+  for (int i = 0; i < loop->num_vertices(); ++i) {
+    loop_vertices.push_back(loop->vertex(i));
+  }
+  index->Add(make_unique<S2LaxPolygonShape>(
+      vector<S2LaxPolygonShape::Loop>{loop_vertices}));
+
+  S2Cap cap(center, S2Testing::KmToAngle(200));
+  for (int i = 0; i < 20; ++i) {
+    vector<S2Point> polyline;
+    for (int j = 0; j < 100; ++j) {
+      polyline.push_back(S2Testing::SamplePoint(cap));
+    }
+    index->Add(make_unique<S2LaxPolylineShape>(polyline));
+  }
+  vector<S2Point> points;
+  for (int i = 0; i < 5000; ++i) {
+    points.push_back(S2CellId(S2Testing::SamplePoint(cap)).parent(20)
+                     .ToPoint());
+  }
+  index->Add(make_unique<S2PointVectorShape>(std::move(points)));
+}
+
+unique_ptr<MutableS2ShapeIndex> LoadIndex(const string& path) {
+  std::ifstream file(path, std::ios::binary);
+  S2_CHECK(file) << "Could not open " << path;
+  std::stringstream contents;
+  contents << file.rdbuf();
+  const string data = contents.str();
+  auto index = make_unique<MutableS2ShapeIndex>();
+  if (absl::EndsWith(path, ".wkb")) {
+    S2Error error;
+    S2_CHECK(s2wkb::DecodeShapes(
+        absl::MakeConstSpan(reinterpret_cast<const uint8*>(data.data()),
+                            data.size()),
+        index.get(), &error)) << path << ": " << error;
+  } else {
+    S2_CHECK(s2textformat::MakeIndex(data, &index))
+        << path << ": invalid s2textformat index";
+  }
+  return index;
+}
+
+// Returns the polygonal shape "shape" as an S2Polygon, or nullptr if it is
+// not a valid S2Polygon.
+unique_ptr<S2Polygon> MakePolygon(const S2Shape& shape) {
+  vector<unique_ptr<S2Loop>> loops;
+  for (int c = 0; c < shape.num_chains(); ++c) {
+    S2Shape::Chain chain = shape.chain(c);
+    vector<S2Point> vertices;
+    for (int j = 0; j < chain.length; ++j) {
+      vertices.push_back(shape.chain_edge(c, j).v0);
+    }
+    auto loop = make_unique<S2Loop>(vertices, S2Debug::DISABLE);
+    if (!loop->IsValid()) return nullptr;
+    loops.push_back(std::move(loop));
+  }
+  auto polygon = make_unique<S2Polygon>();
+  polygon->set_s2debug_override(S2Debug::DISABLE);
+  polygon->InitOriented(std::move(loops));
+  if (!polygon->IsValid()) return nullptr;
+  return polygon;
+}
+
+const Geometry& GetGeometry() {
+  static const Geometry* geometry = [] {
+    auto g = new Geometry;
+    const char* path = std::getenv("S2_CODING_BENCHMARK_INPUT");
+    if (path != nullptr) {
+      g->index = LoadIndex(path);
+    } else {
+      g->index = make_unique<MutableS2ShapeIndex>();
+      AddSyntheticShapes(g->index.get());
+    }
+    g->index->ForceBuild();
+    for (int id = 0; id < g->index->num_shape_ids(); ++id) {
+      const S2Shape* shape = g->index->shape(id);
+      if (shape == nullptr) continue;
+      for (int e = 0; e < shape->num_edges(); ++e) {
+        g->vertices.push_back(shape->edge(e).v0);
+      }
+      g->num_edges += shape->num_edges();
+      if (shape->dimension() == 2) {
+        auto polygon = MakePolygon(*shape);
+        if (polygon) g->polygons.push_back(std::move(polygon));
+      }
+    }
+    S2Testing::rnd.Reset(2);
+    for (int i = 0; i < 1000; ++i) {
+      S2Point center = g->vertices.empty() ? S2Testing::RandomPoint() :
+          g->vertices[S2Testing::rnd.Uniform(g->vertices.size())];
+      g->query_points.push_back(
+          S2Testing::SamplePoint(S2Cap(center, S2Testing::KmToAngle(1))));
+    }
+    return g;
+  }();
+  return *geometry;
+}
+
+bool IsCompact(const benchmark::State& state) {
+  return state.range(0) != 0;
+}
+
+void ReportSize(const Encoder& encoder, benchmark::State* state) {
+  state->counters["bytes"] = encoder.length();
+}
+
+void EncodeShapes(const S2ShapeIndex& index, bool compact, Encoder* encoder) {
+  if (compact) {
+    S2_CHECK(s2shapeutil::CompactEncodeTaggedShapes(index, encoder));
+  } else {
+    S2_CHECK(s2shapeutil::FastEncodeTaggedShapes(index, encoder));
+  }
+}
+
+void EncodeIndex(const MutableS2ShapeIndex& index, bool compact,
+                 Encoder* encoder) {
+  EncodeShapes(index, compact, encoder);
+  index.Encode(encoder);
+}
+
+void EncodePolygons(const vector<unique_ptr<S2Polygon>>& polygons,
+                    bool compact, Encoder* encoder) {
+  for (const auto& polygon : polygons) {
+    if (compact) {
+      polygon->Encode(encoder);
+    } else {
+      polygon->EncodeUncompressed(encoder);
+    }
+  }
+}
+
+void EncodePoints(const vector<S2Point>& points, bool compact,
+                  Encoder* encoder) {
+  s2coding::EncodeS2PointVector(
+      points, compact ? CodingHint::COMPACT : CodingHint::FAST, encoder);
+}
+
+// Returns the query point to use for the given benchmark iteration.
+const S2Point& QueryPoint(const Geometry& g, int64 iteration) {
+  return g.query_points[iteration % g.query_points.size()];
+}
+
+////////////////////////////////// Shapes //////////////////////////////////
+
+void BM_EncodeShapes(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  for (auto _ : state) {
+    encoder.clear();
+    EncodeShapes(*g.index, IsCompact(state), &encoder);
+  }
+  ReportSize(encoder, &state);
+  state.SetItemsProcessed(state.iterations() * g.num_edges);
+}
+BENCHMARK(BM_EncodeShapes)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Decodes every shape fully (see s2shapeutil::FullDecodeShape).
+void BM_FullDecodeShapes(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeShapes(*g.index, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    auto factory = s2shapeutil::FullDecodeShapeFactory(&decoder);
+    for (int id = 0; id < factory.size(); ++id) {
+      benchmark::DoNotOptimize(factory[id]);
+    }
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FullDecodeShapes)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Decodes every shape lazily (see s2shapeutil::LazyDecodeShape).
+void BM_LazyDecodeShapes(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeShapes(*g.index, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder);
+    for (int id = 0; id < factory.size(); ++id) {
+      benchmark::DoNotOptimize(factory[id]);
+    }
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_LazyDecodeShapes)->ArgName("compact")->Arg(0)->Arg(1);
+
+////////////////////////////////// Index ///////////////////////////////////
+
+void BM_EncodeIndex(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  for (auto _ : state) {
+    encoder.clear();
+    EncodeIndex(*g.index, IsCompact(state), &encoder);
+  }
+  ReportSize(encoder, &state);
+  state.SetItemsProcessed(state.iterations() * g.num_edges);
+}
+BENCHMARK(BM_EncodeIndex)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Decodes the shapes and all index cells into a MutableS2ShapeIndex.
+void BM_FullDecodeIndex(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeIndex(*g.index, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    MutableS2ShapeIndex index;
+    S2_CHECK(index.Init(&decoder,
+                        s2shapeutil::FullDecodeShapeFactory(&decoder)));
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FullDecodeIndex)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Initializes an EncodedS2ShapeIndex, which decodes shapes and cells only
+// when they are first accessed.
+void BM_LazyDecodeIndex(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeIndex(*g.index, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2ShapeIndex index;
+    S2_CHECK(index.Init(&decoder,
+                        s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_LazyDecodeIndex)->ArgName("compact")->Arg(0)->Arg(1);
+
+void BM_FirstQueryEncodedIndex(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeIndex(*g.index, IsCompact(state), &encoder);
+  int64 iteration = 0;
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2ShapeIndex index;
+    S2_CHECK(index.Init(&decoder,
+                        s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+    benchmark::DoNotOptimize(MakeS2ContainsPointQuery(&index).Contains(
+        QueryPoint(g, iteration++)));
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FirstQueryEncodedIndex)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Like BM_FirstQueryEncodedIndex, but only the shapes are decoded (lazily)
+// and the index is rebuilt from them.
+void BM_FirstQueryRebuiltIndex(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodeShapes(*g.index, IsCompact(state), &encoder);
+  int64 iteration = 0;
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder);
+    MutableS2ShapeIndex index;
+    for (int id = 0; id < factory.size(); ++id) index.Add(factory[id]);
+    benchmark::DoNotOptimize(MakeS2ContainsPointQuery(&index).Contains(
+        QueryPoint(g, iteration++)));
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FirstQueryRebuiltIndex)->ArgName("compact")->Arg(0)->Arg(1);
+
+///////////////////////////////// Polygons /////////////////////////////////
+
+void BM_EncodePolygons(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  if (g.polygons.empty()) {
+    state.SkipWithError("No valid polygons in input");
+    return;
+  }
+  Encoder encoder;
+  for (auto _ : state) {
+    encoder.clear();
+    EncodePolygons(g.polygons, IsCompact(state), &encoder);
+  }
+  ReportSize(encoder, &state);
+  int num_vertices = 0;
+  for (const auto& polygon : g.polygons) {
+    num_vertices += polygon->num_vertices();
+  }
+  state.SetItemsProcessed(state.iterations() * num_vertices);
+}
+BENCHMARK(BM_EncodePolygons)->ArgName("compact")->Arg(0)->Arg(1);
+
+void BM_FullDecodePolygons(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  if (g.polygons.empty()) {
+    state.SkipWithError("No valid polygons in input");
+    return;
+  }
+  Encoder encoder;
+  EncodePolygons(g.polygons, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    for (int i = 0; i < g.polygons.size(); ++i) {
+      S2Polygon polygon;
+      S2_CHECK(polygon.Decode(&decoder));
+    }
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FullDecodePolygons)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Decodes the polygons with DecodeWithinScope(), which avoids copying the
+// vertices of uncompressed polygons.
+void BM_LazyDecodePolygons(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  if (g.polygons.empty()) {
+    state.SkipWithError("No valid polygons in input");
+    return;
+  }
+  Encoder encoder;
+  EncodePolygons(g.polygons, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    for (int i = 0; i < g.polygons.size(); ++i) {
+      S2Polygon polygon;
+      S2_CHECK(polygon.DecodeWithinScope(&decoder));
+    }
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_LazyDecodePolygons)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Decodes the first polygon and tests whether it contains a point (which
+// requires building its index).
+void BM_FirstQueryPolygon(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  if (g.polygons.empty()) {
+    state.SkipWithError("No valid polygons in input");
+    return;
+  }
+  Encoder encoder;
+  if (IsCompact(state)) {
+    g.polygons[0]->Encode(&encoder);
+  } else {
+    g.polygons[0]->EncodeUncompressed(&encoder);
+  }
+  int64 iteration = 0;
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    S2Polygon polygon;
+    S2_CHECK(polygon.DecodeWithinScope(&decoder));
+    benchmark::DoNotOptimize(polygon.Contains(QueryPoint(g, iteration++)));
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FirstQueryPolygon)->ArgName("compact")->Arg(0)->Arg(1);
+
+////////////////////////////////// Points //////////////////////////////////
+
+void BM_EncodePoints(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  for (auto _ : state) {
+    encoder.clear();
+    EncodePoints(g.vertices, IsCompact(state), &encoder);
+  }
+  ReportSize(encoder, &state);
+  state.SetItemsProcessed(state.iterations() * g.vertices.size());
+}
+BENCHMARK(BM_EncodePoints)->ArgName("compact")->Arg(0)->Arg(1);
+
+void BM_FullDecodePoints(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  Encoder encoder;
+  EncodePoints(g.vertices, IsCompact(state), &encoder);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    s2coding::EncodedS2PointVector points;
+    S2_CHECK(points.Init(&decoder));
+    benchmark::DoNotOptimize(points.Decode());
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FullDecodePoints)->ArgName("compact")->Arg(0)->Arg(1);
+
+// Initializes an EncodedS2PointVector and decodes one point.
+void BM_FirstQueryPoints(benchmark::State& state) {
+  const Geometry& g = GetGeometry();
+  if (g.vertices.empty()) {
+    state.SkipWithError("No vertices in input");
+    return;
+  }
+  Encoder encoder;
+  EncodePoints(g.vertices, IsCompact(state), &encoder);
+  int64 iteration = 0;
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    s2coding::EncodedS2PointVector points;
+    S2_CHECK(points.Init(&decoder));
+    benchmark::DoNotOptimize(points[iteration++ % points.size()]);
+  }
+  ReportSize(encoder, &state);
+}
+BENCHMARK(BM_FirstQueryPoints)->ArgName("compact")->Arg(0)->Arg(1);
+
+}  // namespace
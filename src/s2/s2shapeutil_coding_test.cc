@@ -17,12 +17,24 @@
 
 #include "s2/s2shapeutil_coding.h"
 
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "s2/base/mutex.h"
 #include "s2/util/coding/coder.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
 #include "s2/s2polygon.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
+using std::vector;
 
 namespace s2shapeutil {
 
@@ -51,4 +63,66 @@ TEST(FastEncodeTaggedShapes, MixedShapes) {
             s2textformat::ToString(decoded_index));
 }
 
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// An Encoder::Sink that appends its input to a string.
+class StringSink : public Encoder::Sink {
+ public:
+  explicit StringSink(string* output) : output_(output) {}
+  void Append(const char* data, size_t n) override {
+    output_->append(data, n);
+  }
+
+ private:
+  string* output_;
+};
+
+TEST(CompactEncodeTaggedShapes, SinkOutputIsIdentical) {
+  auto index = s2textformat::MakeIndexOrDie(
+      "0:0 | 0:1 # 1:1, 1:2, 1:3 # 2:2; 2:3, 2:4, 3:3");
+  Encoder expected;
+  ASSERT_TRUE(CompactEncodeTaggedShapes(*index, &expected));
+  string actual;
+  StringSink sink(&actual);
+  {
+    Encoder encoder(&sink, 8);
+    ASSERT_TRUE(CompactEncodeTaggedShapes(*index, &encoder));
+  }
+  EXPECT_EQ(string(expected.base(), expected.length()), actual);
+}
+
+TEST(CompactEncodeTaggedShapes, ParallelOutputIsIdentical) {
+  S2Testing::rnd.Reset(1);
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 100; ++i) {
+    S2Point center = S2Testing::RandomPoint();
+    index.Add(make_unique<S2Polygon::OwningShape>(make_unique<S2Polygon>(
+        S2Loop::MakeRegularLoop(center, S1Angle::Degrees(1), 100))));
+    vector<S2Point> vertices(5, center);
+    index.Add(make_unique<S2LaxPolylineShape>(vertices));
+  }
+  index.Release(7);
+  Encoder expected, actual;
+  ThreadPerTaskExecutor executor;
+  ASSERT_TRUE(CompactEncodeTaggedShapes(index, &expected));
+  ASSERT_TRUE(CompactEncodeTaggedShapes(index, &actual, &executor));
+  ASSERT_EQ(expected.length(), actual.length());
+  EXPECT_EQ(0, memcmp(expected.base(), actual.base(), expected.length()));
+}
+
 }  // namespace s2shapeutil
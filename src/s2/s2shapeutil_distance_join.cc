@@ -0,0 +1,279 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_distance_join.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_distances.h"
+#include "s2/util/thread/executor.h"
+
+using std::vector;
+
+namespace s2shapeutil {
+
+namespace {
+
+// A node of the cell hierarchy of one index.  If "cell" is not nullptr then
+// "id" is an index cell and "cell" is its contents; otherwise "id" is the
+// smallest S2CellId that contains a certain set of (at least two) index
+// cells.
+struct Node {
+  S2CellId id;
+  const S2ShapeIndexCell* cell;
+};
+
+struct NodePair {
+  Node a, b;
+};
+
+// Finds the shape pairs within distance for a set of node pairs.  Each
+// instance has its own iterators and results, so that several instances can
+// run concurrently.
+class DistanceJoiner {
+ public:
+  DistanceJoiner(const S2ShapeIndex& a_index, const S2ShapeIndex& b_index,
+                 S1ChordAngle max_distance)
+      : a_index_(a_index), b_index_(b_index),
+        a_iter_(&a_index, S2ShapeIndex::UNPOSITIONED),
+        b_iter_(&b_index, S2ShapeIndex::UNPOSITIONED),
+        max_distance_(max_distance),
+        // Allow for the error in computing the distance between cells.
+        cell_limit_(max_distance.PlusError(
+            S2::GetUpdateMinDistanceMaxError(max_distance))) {
+  }
+
+  // Appends the initial node pairs, i.e. all pairs of nearby faces.
+  void GetInitialPairs(vector<NodePair>* pairs);
+
+  // Either processes the given pair of index cells, or splits one of the
+  // nodes and appends the child pairs that are closer than max_distance to
+  // "pairs".
+  void ExpandPair(const NodePair& pair, vector<NodePair>* pairs);
+
+  // Processes all the given pairs and their descendants.
+  void Run(vector<NodePair> pairs);
+
+  // Merges the results into "results", keeping the minimum distance of each
+  // shape pair.
+  void MergeInto(std::unordered_map<uint64, S1ChordAngle>* results) const;
+
+ private:
+  static uint64 Key(int a_shape_id, int b_shape_id) {
+    return (static_cast<uint64>(a_shape_id) << 32) |
+           static_cast<uint32>(b_shape_id);
+  }
+
+  // Sets "node" to the node for the index cells contained by "id".  Returns
+  // false if there are no such cells.
+  static bool MakeNode(S2ShapeIndex::Iterator* iter, S2CellId id,
+                       Node* node);
+
+  // Appends the child pairs of (split, other) to "pairs", or (other, split)
+  // if "split_b" is true.
+  void SplitNode(S2ShapeIndex::Iterator* iter, const Node& split,
+                 const Node& other, bool split_b, vector<NodePair>* pairs);
+
+  bool IsNear(const Node& a, const Node& b) const {
+    return S2Cell(a.id).GetDistance(S2Cell(b.id)) < cell_limit_;
+  }
+
+  // Computes the distances between the edges of two index cells.
+  void ProcessCells(const S2ShapeIndexCell& a_cell,
+                    const S2ShapeIndexCell& b_cell);
+
+  const S2ShapeIndex& a_index_;
+  const S2ShapeIndex& b_index_;
+  S2ShapeIndex::Iterator a_iter_, b_iter_;
+  const S1ChordAngle max_distance_;
+  const S1ChordAngle cell_limit_;
+  std::unordered_map<uint64, S1ChordAngle> results_;
+};
+
+bool DistanceJoiner::MakeNode(S2ShapeIndex::Iterator* iter, S2CellId id,
+                              Node* node) {
+  S2ShapeIndex::CellRelation r = iter->Locate(id);
+  if (r == S2ShapeIndex::DISJOINT) return false;
+  if (r == S2ShapeIndex::INDEXED) {
+    *node = Node{iter->id(), &iter->cell()};
+    return true;
+  }
+  // Shrink the node so that it just covers the index cells that it contains.
+  S2CellId first = iter->id();
+  iter->Seek(id.range_max().next());
+  iter->Prev();
+  S2CellId last = iter->id();
+  if (first == last) {
+    *node = Node{first, &iter->cell()};
+  } else {
+    *node = Node{first.parent(first.GetCommonAncestorLevel(last)), nullptr};
+  }
+  return true;
+}
+
+void DistanceJoiner::GetInitialPairs(vector<NodePair>* pairs) {
+  vector<Node> a_nodes, b_nodes;
+  for (int face = 0; face < 6; ++face) {
+    Node node;
+    if (MakeNode(&a_iter_, S2CellId::FromFace(face), &node)) {
+      a_nodes.push_back(node);
+    }
+    if (MakeNode(&b_iter_, S2CellId::FromFace(face), &node)) {
+      b_nodes.push_back(node);
+    }
+  }
+  for (const Node& a : a_nodes) {
+    for (const Node& b : b_nodes) {
+      if (IsNear(a, b)) pairs->push_back(NodePair{a, b});
+    }
+  }
+}
+
+void DistanceJoiner::SplitNode(S2ShapeIndex::Iterator* iter,
+                               const Node& split, const Node& other,
+                               bool split_b, vector<NodePair>* pairs) {
+  S2CellId child = split.id.child_begin();
+  for (int i = 0; i < 4; ++i, child = child.next()) {
+    Node node;
+    if (!MakeNode(iter, child, &node) || !IsNear(node, other)) continue;
+    pairs->push_back(split_b ? NodePair{other, node} : NodePair{node, other});
+  }
+}
+
+void DistanceJoiner::ExpandPair(const NodePair& pair,
+                                vector<NodePair>* pairs) {
+  const Node& a = pair.a;
+  const Node& b = pair.b;
+  if (a.cell != nullptr && b.cell != nullptr) {
+    ProcessCells(*a.cell, *b.cell);
+  } else if (a.cell != nullptr ||
+             (b.cell == nullptr && b.id.level() < a.id.level())) {
+    // Split the larger node (or the only one that can be split).
+    SplitNode(&b_iter_, b, a, true /*split_b*/, pairs);
+  } else {
+    SplitNode(&a_iter_, a, b, false /*split_b*/, pairs);
+  }
+}
+
+void DistanceJoiner::Run(vector<NodePair> pairs) {
+  // Process the pairs depth-first to keep the stack small.
+  while (!pairs.empty()) {
+    NodePair pair = pairs.back();
+    pairs.pop_back();
+    ExpandPair(pair, &pairs);
+  }
+}
+
+void DistanceJoiner::ProcessCells(const S2ShapeIndexCell& a_cell,
+                                  const S2ShapeIndexCell& b_cell) {
+  for (int i = 0; i < a_cell.num_clipped(); ++i) {
+    const S2ClippedShape& a_clipped = a_cell.clipped(i);
+    if (a_clipped.num_edges() == 0) continue;
+    const S2Shape& a_shape = *a_index_.shape(a_clipped.shape_id());
+    for (int j = 0; j < b_cell.num_clipped(); ++j) {
+      const S2ClippedShape& b_clipped = b_cell.clipped(j);
+      if (b_clipped.num_edges() == 0) continue;
+      const S2Shape& b_shape = *b_index_.shape(b_clipped.shape_id());
+      uint64 key = Key(a_clipped.shape_id(), b_clipped.shape_id());
+      auto it = results_.find(key);
+      S1ChordAngle distance =
+          (it == results_.end()) ? max_distance_ : it->second;
+      if (distance == S1ChordAngle::Zero()) continue;
+      bool updated = false;
+      for (int ai = 0; ai < a_clipped.num_edges(); ++ai) {
+        S2Shape::Edge a_edge = a_shape.edge(a_clipped.edge(ai));
+        for (int bi = 0; bi < b_clipped.num_edges(); ++bi) {
+          S2Shape::Edge b_edge = b_shape.edge(b_clipped.edge(bi));
+          updated |= S2::UpdateEdgePairMinDistance(
+              a_edge.v0, a_edge.v1, b_edge.v0, b_edge.v1, &distance);
+        }
+      }
+      if (updated) results_[key] = distance;
+    }
+  }
+}
+
+void DistanceJoiner::MergeInto(
+    std::unordered_map<uint64, S1ChordAngle>* results) const {
+  for (const auto& entry : results_) {
+    auto inserted = results->insert(entry);
+    if (!inserted.second) {
+      inserted.first->second = std::min(inserted.first->second, entry.second);
+    }
+  }
+}
+
+}  // namespace
+
+vector<ShapePairDistance> FindShapePairsWithinDistance(
+    const S2ShapeIndex& a_index, const S2ShapeIndex& b_index,
+    S1ChordAngle max_distance, Executor* executor) {
+  std::unordered_map<uint64, S1ChordAngle> merged;
+  DistanceJoiner joiner(a_index, b_index, max_distance);
+  vector<NodePair> pairs;
+  joiner.GetInitialPairs(&pairs);
+  if (executor == nullptr) {
+    joiner.Run(std::move(pairs));
+    joiner.MergeInto(&merged);
+  } else {
+    // Expand the closest levels of the hierarchy breadth-first until there
+    // are enough independent pairs to keep all the threads busy.
+    const int kTasksPerThread = 8;
+    const size_t min_pairs = kTasksPerThread * executor->num_threads();
+    vector<NodePair> next;
+    while (!pairs.empty() && pairs.size() < min_pairs) {
+      next.clear();
+      for (const NodePair& pair : pairs) joiner.ExpandPair(pair, &next);
+      pairs.swap(next);
+    }
+    joiner.MergeInto(&merged);  // Results from pairs processed so far.
+    vector<std::unordered_map<uint64, S1ChordAngle>> task_results(
+        pairs.size());
+    ParallelFor(executor, pairs.size(), [&](int i) {
+      DistanceJoiner task_joiner(a_index, b_index, max_distance);
+      task_joiner.Run(vector<NodePair>{pairs[i]});
+      task_joiner.MergeInto(&task_results[i]);
+    });
+    for (const auto& task_result : task_results) {
+      for (const auto& entry : task_result) {
+        auto inserted = merged.insert(entry);
+        if (!inserted.second) {
+          inserted.first->second =
+              std::min(inserted.first->second, entry.second);
+        }
+      }
+    }
+  }
+  vector<ShapePairDistance> results;
+  results.reserve(merged.size());
+  for (const auto& entry : merged) {
+    results.push_back(ShapePairDistance(entry.first >> 32,
+                                        static_cast<uint32>(entry.first),
+                                        entry.second));
+  }
+  std::sort(results.begin(), results.end(),
+            [](const ShapePairDistance& x, const ShapePairDistance& y) {
+              return (x.a_shape_id < y.a_shape_id ||
+                      (x.a_shape_id == y.a_shape_id &&
+                       x.b_shape_id < y.b_shape_id));
+            });
+  return results;
+}
+
+}  // namespace s2shapeutil
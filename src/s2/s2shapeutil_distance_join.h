@@ -0,0 +1,70 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPEUTIL_DISTANCE_JOIN_H_
+#define S2_S2SHAPEUTIL_DISTANCE_JOIN_H_
+
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2shape_index.h"
+
+class Executor;
+
+namespace s2shapeutil {
+
+// A pair of shapes (one from each index) and the minimum distance between
+// their edges.
+struct ShapePairDistance {
+  int32 a_shape_id;
+  int32 b_shape_id;
+  S1ChordAngle distance;
+
+  ShapePairDistance(int32 _a_shape_id, int32 _b_shape_id,
+                    S1ChordAngle _distance)
+      : a_shape_id(_a_shape_id), b_shape_id(_b_shape_id),
+        distance(_distance) {}
+
+  friend bool operator==(const ShapePairDistance& x,
+                         const ShapePairDistance& y) {
+    return (x.a_shape_id == y.a_shape_id && x.b_shape_id == y.b_shape_id &&
+            x.distance == y.distance);
+  }
+};
+
+// Returns every pair of shapes (A, B), where A belongs to "a_index" and B
+// belongs to "b_index", such that some edge of A is closer than
+// "max_distance" to some edge of B, together with the minimum distance
+// between their edges.  The results are sorted by (a_shape_id, b_shape_id).
+// Note that only edges are considered, i.e. a polygon that contains a shape
+// without any of their edges being close is not reported.
+//
+// This is a dual-tree join: the cell hierarchies of both indexes are
+// traversed together, and pairs of cells are discarded as soon as the
+// distance between them is at least "max_distance".  Edge distances are only
+// computed for pairs of nearby index cells.  This is much faster than
+// running an S2ClosestEdgeQuery for every shape of one index, since nearby
+// edges of "a_index" share the work of finding their neighbors.
+//
+// If "executor" is not nullptr, the cell pairs are divided among several
+// tasks that run concurrently.  The results are identical either way.
+std::vector<ShapePairDistance> FindShapePairsWithinDistance(
+    const S2ShapeIndex& a_index, const S2ShapeIndex& b_index,
+    S1ChordAngle max_distance, Executor* executor = nullptr);
+
+}  // namespace s2shapeutil
+
+#endif  // S2_S2SHAPEUTIL_DISTANCE_JOIN_H_
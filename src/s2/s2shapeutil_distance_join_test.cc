@@ -0,0 +1,136 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_distance_join.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using s2shapeutil::FindShapePairsWithinDistance;
+using s2shapeutil::ShapePairDistance;
+using std::vector;
+
+namespace {
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// Adds "num_shapes" random polylines and loops within "cap" to "index".
+void AddRandomShapes(const S2Cap& cap, int num_shapes,
+                     MutableS2ShapeIndex* index) {
+  for (int i = 0; i < num_shapes; ++i) {
+    S2Point center = S2Testing::SamplePoint(cap);
+    S1Angle radius = S1Angle::Degrees(0.05 + S2Testing::rnd.RandDouble());
+    int num_vertices = 3 + S2Testing::rnd.Uniform(30);
+    if (S2Testing::rnd.OneIn(2)) {
+      S2Polygon polygon(S2Loop::MakeRegularLoop(center, radius, num_vertices));
+      index->Add(make_unique<S2LaxPolygonShape>(polygon));
+    } else {
+      vector<S2Point> vertices;
+      S2Cap shape_cap(center, radius);
+      for (int j = 0; j < num_vertices; ++j) {
+        vertices.push_back(S2Testing::SamplePoint(shape_cap));
+      }
+      index->Add(make_unique<S2LaxPolylineShape>(vertices));
+    }
+  }
+}
+
+vector<ShapePairDistance> BruteForceJoin(const S2ShapeIndex& a_index,
+                                         const S2ShapeIndex& b_index,
+                                         S1ChordAngle max_distance) {
+  vector<ShapePairDistance> results;
+  for (int a_id = 0; a_id < a_index.num_shape_ids(); ++a_id) {
+    const S2Shape& a_shape = *a_index.shape(a_id);
+    for (int b_id = 0; b_id < b_index.num_shape_ids(); ++b_id) {
+      const S2Shape& b_shape = *b_index.shape(b_id);
+      S1ChordAngle distance = max_distance;
+      for (int i = 0; i < a_shape.num_edges(); ++i) {
+        S2Shape::Edge a = a_shape.edge(i);
+        for (int j = 0; j < b_shape.num_edges(); ++j) {
+          S2Shape::Edge b = b_shape.edge(j);
+          S2::UpdateEdgePairMinDistance(a.v0, a.v1, b.v0, b.v1, &distance);
+        }
+      }
+      if (distance < max_distance) {
+        results.push_back(ShapePairDistance(a_id, b_id, distance));
+      }
+    }
+  }
+  return results;
+}
+
+TEST(FindShapePairsWithinDistance, EmptyIndexes) {
+  MutableS2ShapeIndex a_index, b_index;
+  AddRandomShapes(S2Cap(S2Point(1, 0, 0), S1Angle::Degrees(5)), 5, &a_index);
+  S1ChordAngle max_distance(S1Angle::Degrees(1));
+  EXPECT_TRUE(FindShapePairsWithinDistance(a_index, b_index,
+                                           max_distance).empty());
+  EXPECT_TRUE(FindShapePairsWithinDistance(b_index, a_index,
+                                           max_distance).empty());
+}
+
+TEST(FindShapePairsWithinDistance, MatchesBruteForce) {
+  S2Testing::rnd.Reset(1);
+  ThreadPerTaskExecutor executor;
+  for (int iter = 0; iter < 5; ++iter) {
+    S2Cap cap(S2Testing::RandomPoint(),
+              S1Angle::Degrees(iter == 0 ? 120 : 10));
+    MutableS2ShapeIndex a_index, b_index;
+    AddRandomShapes(cap, 25, &a_index);
+    AddRandomShapes(cap, 25, &b_index);
+    S1ChordAngle max_distance(
+        S1Angle::Degrees(S2Testing::rnd.RandDouble() * 2));
+    auto expected = BruteForceJoin(a_index, b_index, max_distance);
+    EXPECT_EQ(expected,
+              FindShapePairsWithinDistance(a_index, b_index, max_distance));
+    EXPECT_EQ(expected, FindShapePairsWithinDistance(
+        a_index, b_index, max_distance, &executor));
+  }
+}
+
+}  // namespace
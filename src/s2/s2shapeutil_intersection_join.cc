@@ -0,0 +1,123 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_intersection_join.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
+#include "s2/util/thread/executor.h"
+
+using std::pair;
+using std::vector;
+
+namespace s2shapeutil {
+
+namespace {
+
+using ShapePairSet = std::unordered_set<uint64>;
+
+inline uint64 ShapePairKey(int a_shape_id, int b_shape_id) {
+  return (static_cast<uint64>(a_shape_id) << 32) |
+         static_cast<uint32>(b_shape_id);
+}
+
+// Adds the pairs of shapes whose edges cross within the given face.
+void AddCrossingPairs(const S2ShapeIndex& a_index,
+                      const S2ShapeIndex& b_index, int face,
+                      ShapePairSet* pairs) {
+  VisitCrossingEdgePairs(
+      a_index, b_index, face, CrossingType::ALL,
+      [pairs](const ShapeEdge& a, const ShapeEdge& b, bool) {
+        pairs->insert(ShapePairKey(a.id().shape_id, b.id().shape_id));
+        return true;
+      });
+}
+
+// Adds the pairs where a point of shape "shape_id" of "index" is contained
+// by a shape of the index that "query" searches.  With the CLOSED vertex model this reports
+// points inside or on the boundary of polygons as well as shared vertices.
+// If "swapped" is true then "index" is index B.
+void AddContainmentPairs(const S2ShapeIndex& index, int shape_id,
+                         bool swapped,
+                         S2ContainsPointQuery<S2ShapeIndex>* query,
+                         ShapePairSet* pairs) {
+  const S2Shape* shape = index.shape(shape_id);
+  if (shape == nullptr) return;
+  // If the edges of two shapes do not cross, then each edge chain of one
+  // shape is either inside or outside the other shape, so testing one vertex
+  // per chain (in both directions) is enough.  Note that every point of a
+  // point shape is a separate chain.
+  for (int i = 0; i < shape->num_chains(); ++i) {
+    if (shape->chain(i).length == 0) continue;
+    S2Point p = shape->chain_edge(i, 0).v0;
+    query->VisitContainingShapes(p, [&](S2Shape* other) {
+      pairs->insert(swapped ? ShapePairKey(other->id(), shape_id)
+                            : ShapePairKey(shape_id, other->id()));
+      return true;
+    });
+  }
+}
+
+}  // namespace
+
+vector<pair<int, int>> FindIntersectingShapePairs(
+    const S2ShapeIndex& a_index, const S2ShapeIndex& b_index,
+    Executor* executor) {
+  // Tasks 0..5 find the crossings within each face, and the remaining tasks
+  // each test a range of shapes from one index for containment.
+  const int kShapesPerTask = 64;
+  const int a_tasks = (a_index.num_shape_ids() + kShapesPerTask - 1) /
+                      kShapesPerTask;
+  const int b_tasks = (b_index.num_shape_ids() + kShapesPerTask - 1) /
+                      kShapesPerTask;
+  vector<ShapePairSet> task_pairs(6 + a_tasks + b_tasks);
+  ParallelFor(executor, task_pairs.size(), [&](int task) {
+    ShapePairSet* pairs = &task_pairs[task];
+    if (task < 6) {
+      AddCrossingPairs(a_index, b_index, task, pairs);
+      return;
+    }
+    task -= 6;
+    bool swapped = (task >= a_tasks);
+    if (swapped) task -= a_tasks;
+    const S2ShapeIndex& index = swapped ? b_index : a_index;
+    auto query = MakeS2ContainsPointQuery(
+        swapped ? &a_index : &b_index,
+        S2ContainsPointQueryOptions(S2VertexModel::CLOSED));
+    int end = std::min(index.num_shape_ids(), (task + 1) * kShapesPerTask);
+    for (int id = task * kShapesPerTask; id < end; ++id) {
+      AddContainmentPairs(index, id, swapped, &query, pairs);
+    }
+  });
+  vector<uint64> keys;
+  for (const ShapePairSet& pairs : task_pairs) {
+    keys.insert(keys.end(), pairs.begin(), pairs.end());
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  vector<pair<int, int>> results;
+  results.reserve(keys.size());
+  for (uint64 key : keys) {
+    results.push_back(std::make_pair(static_cast<int>(key >> 32),
+                                     static_cast<int>(key & 0xffffffff)));
+  }
+  return results;
+}
+
+}  // namespace s2shapeutil
@@ -0,0 +1,50 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPEUTIL_INTERSECTION_JOIN_H_
+#define S2_S2SHAPEUTIL_INTERSECTION_JOIN_H_
+
+#include <utility>
+#include <vector>
+
+#include "s2/s2shape_index.h"
+
+class Executor;
+
+namespace s2shapeutil {
+
+// Returns every pair of shape ids (a, b), where "a" belongs to "a_index" and
+// "b" belongs to "b_index", such that the two shapes intersect.  Shapes are
+// treated as closed sets, i.e. shapes that only touch at a vertex or along
+// an edge are considered to intersect.  The results are sorted and contain
+// no duplicates.
+//
+// This is computed in one pass over both indexes rather than pair by pair:
+// the edge crossings are found by VisitCrossingEdgePairs (which merges the
+// two indexes by cell), and the pairs where one shape is entirely inside a
+// polygon of the other index are found by testing one vertex of each edge
+// chain with S2ContainsPointQuery.  Note that a point is only found to
+// intersect a polyline if it is one of its vertices, and that pairs of shapes
+// without any edges (such as two full polygons) are not reported.
+//
+// If "executor" is not nullptr, the six cube faces and the containment tests
+// are processed concurrently.
+std::vector<std::pair<int, int>> FindIntersectingShapePairs(
+    const S2ShapeIndex& a_index, const S2ShapeIndex& b_index,
+    Executor* executor = nullptr);
+
+}  // namespace s2shapeutil
+
+#endif  // S2_S2SHAPEUTIL_INTERSECTION_JOIN_H_
@@ -0,0 +1,158 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_intersection_join.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/base/mutex.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shapeutil_contains_brute_force.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/util/thread/executor.h"
+
+using absl::make_unique;
+using s2shapeutil::FindIntersectingShapePairs;
+using std::pair;
+using std::vector;
+
+namespace {
+
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// Adds "num_shapes" random polygons, polylines, and point sets of various
+// sizes within "cap" to "index".
+void AddRandomShapes(const S2Cap& cap, int num_shapes,
+                     MutableS2ShapeIndex* index) {
+  for (int i = 0; i < num_shapes; ++i) {
+    S2Point center = S2Testing::SamplePoint(cap);
+    S1Angle radius = S1Angle::Degrees(0.01 + 3 * S2Testing::rnd.RandDouble());
+    int num_vertices = 3 + S2Testing::rnd.Uniform(20);
+    S2Cap shape_cap(center, radius);
+    vector<S2Point> vertices;
+    for (int j = 0; j < num_vertices; ++j) {
+      vertices.push_back(S2Testing::SamplePoint(shape_cap));
+    }
+    switch (S2Testing::rnd.Uniform(3)) {
+      case 0: {
+        S2Polygon polygon(
+            S2Loop::MakeRegularLoop(center, radius, num_vertices));
+        index->Add(make_unique<S2LaxPolygonShape>(polygon));
+        break;
+      }
+      case 1:
+        index->Add(make_unique<S2LaxPolylineShape>(vertices));
+        break;
+      default:
+        index->Add(make_unique<S2PointVectorShape>(std::move(vertices)));
+        break;
+    }
+  }
+}
+
+bool BruteForceIntersects(const S2Shape& a, const S2Shape& b) {
+  for (int i = 0; i < a.num_edges(); ++i) {
+    S2Shape::Edge ae = a.edge(i);
+    for (int j = 0; j < b.num_edges(); ++j) {
+      S2Shape::Edge be = b.edge(j);
+      if (S2::CrossingSign(ae.v0, ae.v1, be.v0, be.v1) >= 0) return true;
+    }
+  }
+  if (a.dimension() == 2) {
+    for (int j = 0; j < b.num_edges(); ++j) {
+      if (s2shapeutil::ContainsBruteForce(a, b.edge(j).v0)) return true;
+    }
+  }
+  if (b.dimension() == 2) {
+    for (int i = 0; i < a.num_edges(); ++i) {
+      if (s2shapeutil::ContainsBruteForce(b, a.edge(i).v0)) return true;
+    }
+  }
+  return false;
+}
+
+vector<pair<int, int>> BruteForceJoin(const S2ShapeIndex& a_index,
+                                      const S2ShapeIndex& b_index) {
+  vector<pair<int, int>> results;
+  for (int a_id = 0; a_id < a_index.num_shape_ids(); ++a_id) {
+    for (int b_id = 0; b_id < b_index.num_shape_ids(); ++b_id) {
+      if (BruteForceIntersects(*a_index.shape(a_id), *b_index.shape(b_id))) {
+        results.push_back(std::make_pair(a_id, b_id));
+      }
+    }
+  }
+  return results;
+}
+
+TEST(FindIntersectingShapePairs, NestedAndTouching) {
+  auto a_index = s2textformat::MakeIndex(
+      "# # 0:0, 0:10, 10:10, 10:0; 4:4, 6:4, 6:6, 4:6");
+  auto b_index = s2textformat::MakeIndex(
+      "5:5 | 20:20 # 10:10, 12:12 | 1:1, 2:2 # 4.5:4.5, 4.5:5.5, 5.5:5.5");
+  // Shape 0 of A is a polygon with a hole.  The point 5:5 and the triangle
+  // are inside the hole, the first polyline touches a vertex, and the second
+  // polyline is inside the polygon.
+  vector<pair<int, int>> expected = {{0, 1}, {0, 2}};
+  EXPECT_EQ(expected, FindIntersectingShapePairs(*a_index, *b_index));
+}
+
+TEST(FindIntersectingShapePairs, MatchesBruteForce) {
+  S2Testing::rnd.Reset(1);
+  ThreadPerTaskExecutor executor;
+  for (int iter = 0; iter < 5; ++iter) {
+    S2Cap cap(S2Testing::RandomPoint(),
+              S1Angle::Degrees(iter == 0 ? 120 : 10));
+    MutableS2ShapeIndex a_index, b_index;
+    AddRandomShapes(cap, 30, &a_index);
+    AddRandomShapes(cap, 100, &b_index);
+    auto expected = BruteForceJoin(a_index, b_index);
+    EXPECT_EQ(expected, FindIntersectingShapePairs(a_index, b_index));
+    EXPECT_EQ(expected,
+              FindIntersectingShapePairs(a_index, b_index, &executor));
+  }
+}
+
+}  // namespace
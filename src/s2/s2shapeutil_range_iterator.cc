@@ -48,6 +48,11 @@ void RangeIterator::SeekBeyond(const RangeIterator& target) {
   Refresh();
 }
 
+void RangeIterator::Seek(S2CellId target) {
+  it_.Seek(target);
+  Refresh();
+}
+
 // This method is inline, but is only called by non-inline methods defined in
 // this file.  Putting the definition here enforces this requirement.
 inline void RangeIterator::Refresh() {
@@ -53,6 +53,10 @@ class RangeIterator {
   // first cell such that range_min() > target.range_max().
   void SeekBeyond(const RangeIterator& target);
 
+  // Position the iterator at the first cell such that id() >= target, or at
+  // the end of the index if no such cell exists.
+  void Seek(S2CellId target);
+
  private:
   // Updates internal state after the iterator has been repositioned.
   void Refresh();
@@ -39,6 +39,28 @@ void ExpectEqual(const S2Shape& a, const S2Shape& b) {
   }
 }
 
+int ExpectChainVerticesConsistent(const S2Shape& shape) {
+  int num_found = 0;
+  for (int i = 0; i < shape.num_chains(); ++i) {
+    S2PointSpan vertices;
+    if (!shape.GetChainVertices(i, &vertices)) continue;
+    ++num_found;
+    int chain_length = shape.chain(i).length;
+    if (shape.dimension() == 1) {
+      EXPECT_TRUE(vertices.size() == chain_length ||
+                  vertices.size() == chain_length + 1);
+    } else {
+      EXPECT_EQ(chain_length, vertices.size());
+    }
+    for (int j = 0; j < chain_length; ++j) {
+      EXPECT_EQ(shape.chain_edge(i, j),
+                S2Shape::Edge(vertices[j],
+                              vertices[(j + 1) % vertices.size()]));
+    }
+  }
+  return num_found;
+}
+
 // Verifies that all methods of the two S2ShapeIndexes return identical
 // results (including all the S2Shapes in both indexes).
 void ExpectEqual(const S2ShapeIndex& a, const S2ShapeIndex& b) {
@@ -27,6 +27,11 @@ namespace s2testing {
 // except for id() and type_tag().
 void ExpectEqual(const S2Shape& a, const S2Shape& b);
 
+// Verifies that for every chain where shape.GetChainVertices() succeeds, the
+// returned vertices match the edges returned by chain_edge().  Returns the
+// number of chains for which GetChainVertices() succeeded.
+int ExpectChainVerticesConsistent(const S2Shape& shape);
+
 // Verifies that two S2ShapeIndexes have identical contents (including all the
 // S2Shapes in both indexes).
 void ExpectEqual(const S2ShapeIndex& a, const S2ShapeIndex& b);
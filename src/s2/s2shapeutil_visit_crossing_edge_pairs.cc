@@ -17,11 +17,16 @@
 
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 
+#include <algorithm>
+#include <atomic>
+
+#include "s2/base/mutex.h"
 #include "s2/s2crossing_edge_query.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2error.h"
 #include "s2/s2shapeutil_range_iterator.h"
 #include "s2/s2wedge_relations.h"
+#include "s2/util/thread/executor.h"
 
 using std::vector;
 using ChainPosition = S2Shape::ChainPosition;
@@ -124,12 +129,57 @@ static bool VisitCrossings(
   return true;
 }
 
+// Like the above, but divides the index cells into ranges that are processed
+// concurrently using "executor".
+static bool VisitCrossings(
+    const S2ShapeIndex& index, CrossingType type, bool need_adjacent,
+    const EdgePairVisitor& visitor, Executor* executor) {
+  if (executor == nullptr) {
+    return VisitCrossings(index, type, need_adjacent, visitor);
+  }
+  // Collect the cell ids so that the cells can be divided into ranges with
+  // similar numbers of cells.  This does not decode the cell contents.
+  vector<S2CellId> cell_ids;
+  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    cell_ids.push_back(it.id());
+  }
+  const int kTasksPerThread = 8;
+  const int num_cells = cell_ids.size();
+  const int num_tasks =
+      std::min(num_cells, kTasksPerThread * executor->num_threads());
+  std::atomic<bool> cancelled(false);
+  ParallelFor(executor, num_tasks, [&](int task) {
+    int begin = static_cast<int64>(num_cells) * task / num_tasks;
+    int end = static_cast<int64>(num_cells) * (task + 1) / num_tasks;
+    ShapeEdgeVector shape_edges;
+    S2ShapeIndex::Iterator it(&index);
+    it.Seek(cell_ids[begin]);
+    for (int i = begin; i < end; ++i, it.Next()) {
+      if (cancelled.load(std::memory_order_relaxed)) return;
+      GetShapeEdges(index, it.cell(), &shape_edges);
+      if (!VisitCrossings(shape_edges, type, need_adjacent, visitor)) {
+        cancelled.store(true, std::memory_order_relaxed);
+        return;
+      }
+    }
+  });
+  return !cancelled.load();
+}
+
 bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
                             const EdgePairVisitor& visitor) {
   const bool need_adjacent = (type == CrossingType::ALL);
   return VisitCrossings(index, type, need_adjacent, visitor);
 }
 
+bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
+                            const EdgePairVisitor& visitor,
+                            Executor* executor) {
+  const bool need_adjacent = (type == CrossingType::ALL);
+  return VisitCrossings(index, type, need_adjacent, visitor, executor);
+}
+
 //////////////////////////////////////////////////////////////////////
 
 // IndexCrosser is a helper class for finding the edge crossings between a
@@ -307,46 +357,70 @@ bool IndexCrosser::VisitCrossings(RangeIterator* ai, RangeIterator* bi) {
   return true;
 }
 
-bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
-                            const S2ShapeIndex& b_index,
-                            CrossingType type, const EdgePairVisitor& visitor) {
+// Visits the crossings between A and B in all index cells that are
+// contained by the leaf cell range [ai.range_min(), last].
+static bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                                   const S2ShapeIndex& b_index,
+                                   RangeIterator* ai, RangeIterator* bi,
+                                   S2CellId last, CrossingType type,
+                                   const EdgePairVisitor& visitor) {
   // We look for S2CellId ranges where the indexes of A and B overlap, and
   // then test those edges for crossings.
-
-  // TODO(ericv): Use brute force if the total number of edges is small enough
-  // (using a larger threshold if the S2ShapeIndex is not constructed yet).
-  RangeIterator ai(a_index), bi(b_index);
   IndexCrosser ab(a_index, b_index, type, visitor, false);  // Tests A against B
   IndexCrosser ba(b_index, a_index, type, visitor, true);   // Tests B against A
-  while (!ai.done() || !bi.done()) {
-    if (ai.range_max() < bi.range_min()) {
+  // Note that done() iterators have a range_min() beyond any valid cell.
+  while (ai->range_min() <= last || bi->range_min() <= last) {
+    if (ai->range_max() < bi->range_min()) {
       // The A and B cells don't overlap, and A precedes B.
-      ai.SeekTo(bi);
-    } else if (bi.range_max() < ai.range_min()) {
+      ai->SeekTo(*bi);
+    } else if (bi->range_max() < ai->range_min()) {
       // The A and B cells don't overlap, and B precedes A.
-      bi.SeekTo(ai);
+      bi->SeekTo(*ai);
     } else {
       // One cell contains the other.  Determine which cell is larger.
-      int64 ab_relation = ai.id().lsb() - bi.id().lsb();
+      int64 ab_relation = ai->id().lsb() - bi->id().lsb();
       if (ab_relation > 0) {
         // A's index cell is larger.
-        if (!ab.VisitCrossings(&ai, &bi)) return false;
+        if (!ab.VisitCrossings(ai, bi)) return false;
       } else if (ab_relation < 0) {
         // B's index cell is larger.
-        if (!ba.VisitCrossings(&bi, &ai)) return false;
+        if (!ba.VisitCrossings(bi, ai)) return false;
       } else {
         // The A and B cells are the same.
-        if (ai.cell().num_edges() > 0 && bi.cell().num_edges() > 0) {
-          if (!ab.VisitCellCellCrossings(ai.cell(), bi.cell())) return false;
+        if (ai->cell().num_edges() > 0 && bi->cell().num_edges() > 0) {
+          if (!ab.VisitCellCellCrossings(ai->cell(), bi->cell())) return false;
         }
-        ai.Next();
-        bi.Next();
+        ai->Next();
+        bi->Next();
       }
     }
   }
   return true;
 }
 
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index,
+                            CrossingType type, const EdgePairVisitor& visitor) {
+  // TODO(ericv): Use brute force if the total number of edges is small enough
+  // (using a larger threshold if the S2ShapeIndex is not constructed yet).
+  RangeIterator ai(a_index), bi(b_index);
+  return VisitCrossingEdgePairs(a_index, b_index, &ai, &bi,
+                                S2CellId::FromFace(5).range_max(),
+                                type, visitor);
+}
+
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index, int face,
+                            CrossingType type, const EdgePairVisitor& visitor) {
+  S2_DCHECK(face >= 0 && face < 6);
+  S2CellId face_id = S2CellId::FromFace(face);
+  RangeIterator ai(a_index), bi(b_index);
+  ai.Seek(face_id.range_min());
+  bi.Seek(face_id.range_min());
+  return VisitCrossingEdgePairs(a_index, b_index, &ai, &bi,
+                                face_id.range_max(), type, visitor);
+}
+
 //////////////////////////////////////////////////////////////////////
 
 // Helper function that formats a loop error message.  If the loop belongs to
@@ -422,7 +496,8 @@ static bool FindCrossingError(const S2Shape& shape,
   return false;
 }
 
-bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error) {
+bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error,
+                          Executor* executor) {
   if (index.num_shape_ids() == 0) return false;
   S2_DCHECK_EQ(1, index.num_shape_ids());
   const S2Shape& shape = *index.shape(0);
@@ -430,11 +505,31 @@ bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error) {
   // Visit all crossing pairs except possibly for ones of the form (AB, BC),
   // since such pairs are very common and FindCrossingError() only needs pairs
   // of the form (AB, AC).
+  if (executor == nullptr) {
+    return !VisitCrossings(
+        index, CrossingType::ALL, false /*need_adjacent*/,
+        [&](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
+          return !FindCrossingError(shape, a, b, is_interior, error);
+        });
+  }
+  // Only the first error found is reported.
+  absl::Mutex mutex;
+  bool found = false;
   return !VisitCrossings(
       index, CrossingType::ALL, false /*need_adjacent*/,
       [&](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
-        return !FindCrossingError(shape, a, b, is_interior, error);
-      });
+        S2Error task_error;
+        if (!FindCrossingError(shape, a, b, is_interior, &task_error)) {
+          return true;
+        }
+        mutex.Lock();
+        if (!found) {
+          *error = task_error;
+          found = true;
+        }
+        mutex.Unlock();
+        return false;
+      }, executor);
 }
 
 }  // namespace s2shapeutil
@@ -23,6 +23,7 @@
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_shape_edge.h"
 
+class Executor;
 class S2Error;
 
 namespace s2shapeutil {
@@ -46,6 +47,18 @@ using EdgePairVisitor = std::function<
 bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
                             const EdgePairVisitor& visitor);
 
+// Like the above, but the index cells are divided into contiguous ranges of
+// S2CellIds that are processed concurrently using "executor" (if it is not
+// nullptr).  "visitor" must therefore be thread-safe.  If the visitor
+// returns false, the other ranges stop at the end of their current index
+// cell (so the visitor may still be called a few more times) and this
+// function returns false.
+//
+// CAVEAT: Crossings may be visited more than once.
+bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
+                            const EdgePairVisitor& visitor,
+                            Executor* executor);
+
 // Like the above, but visits all pairs of crossing edges where one edge comes
 // from each S2ShapeIndex.
 //
@@ -54,6 +67,17 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
                             const S2ShapeIndex& b_index,
                             CrossingType type, const EdgePairVisitor& visitor);
 
+// Like the above, but only visits the crossings found within the given cube
+// face (0..5).  Since index cells never span more than one face, the
+// crossings visited for the six faces together are exactly those visited by
+// the function above.  This allows the faces to be processed concurrently,
+// e.g. using ParallelFor() with a separate visitor for each face.
+//
+// CAVEAT: Crossings may be visited more than once.
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index, int face,
+                            CrossingType type, const EdgePairVisitor& visitor);
+
 // Given an S2ShapeIndex containing a single polygonal shape (e.g., an
 // S2Polygon or S2Loop), return true if any loop has a self-intersection
 // (including duplicate vertices) or crosses any other loop (including vertex
@@ -63,9 +87,14 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
 // This method is used to implement the FindValidationError methods of S2Loop
 // and S2Polygon.
 //
+// If "executor" is not nullptr, the index cells are checked concurrently.
+// In that case, if there are several errors it is unspecified which one is
+// reported.
+//
 // TODO(ericv): Add an option to support S2LaxPolygonShape rules (i.e.,
 // duplicate vertices and edges are allowed, but loop crossings are not).
-bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error);
+bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error,
+                          Executor* executor = nullptr);
 
 }  // namespace s2shapeutil
 
@@ -17,11 +17,14 @@
 
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/third_party/absl/memory/memory.h"
+#include "s2/base/mutex.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_vector_shape.h"
@@ -31,6 +34,7 @@
 #include "s2/s2shapeutil_contains_brute_force.h"
 #include "s2/s2shapeutil_edge_iterator.h"
 #include "s2/s2text_format.h"
+#include "s2/util/thread/executor.h"
 
 using absl::make_unique;
 using std::unique_ptr;
@@ -38,16 +42,42 @@ using std::vector;
 
 namespace s2shapeutil {
 
+// An Executor that runs each task in a new thread.
+class ThreadPerTaskExecutor : public Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+  void Schedule(std::function<void()> fn) override {
+    mutex_.Lock();
+    threads_.emplace_back(std::move(fn));
+    mutex_.Unlock();
+  }
+  int num_threads() const override { return 4; }
+
+ private:
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
 // A set of edge pairs within an S2ShapeIndex.
 using EdgePairVector = std::vector<std::pair<ShapeEdgeId, ShapeEdgeId>>;
 
-EdgePairVector GetCrossings(const S2ShapeIndex& index, CrossingType type) {
+EdgePairVector GetCrossings(const S2ShapeIndex& index, CrossingType type,
+                            Executor* executor = nullptr) {
   EdgePairVector edge_pairs;
-  VisitCrossingEdgePairs(
-      index, type, [&edge_pairs](const ShapeEdge& a, const ShapeEdge& b, bool) {
-        edge_pairs.push_back(std::make_pair(a.id(), b.id()));
-        return true;  // Continue visiting.
-      });
+  absl::Mutex mutex;
+  auto visitor = [&](const ShapeEdge& a, const ShapeEdge& b, bool) {
+    mutex.Lock();
+    edge_pairs.push_back(std::make_pair(a.id(), b.id()));
+    mutex.Unlock();
+    return true;  // Continue visiting.
+  };
+  if (executor == nullptr) {
+    VisitCrossingEdgePairs(index, type, visitor);
+  } else {
+    VisitCrossingEdgePairs(index, type, visitor, executor);
+  }
   if (edge_pairs.size() > 1) {
     std::sort(edge_pairs.begin(), edge_pairs.end());
     edge_pairs.erase(std::unique(edge_pairs.begin(), edge_pairs.end()),
@@ -98,6 +128,8 @@ void TestGetCrossingEdgePairs(const S2ShapeIndex& index,
       }
     }
   }
+  ThreadPerTaskExecutor executor;
+  EXPECT_EQ(expected, GetCrossings(index, type, &executor));
 }
 
 TEST(GetCrossingEdgePairs, NoIntersections) {
@@ -121,15 +153,45 @@ TEST(GetCrossingEdgePairs, EdgeGrid) {
   TestGetCrossingEdgePairs(index, CrossingType::INTERIOR);
 }
 
+TEST(GetCrossingEdgePairs, ParallelCancellation) {
+  const int kGridSize = 50;
+  MutableS2ShapeIndex index;
+  auto shape = make_unique<S2EdgeVectorShape>();
+  for (int i = 0; i <= kGridSize; ++i) {
+    shape->Add(S2LatLng::FromDegrees(0, 0.1 * i).ToPoint(),
+               S2LatLng::FromDegrees(0.1 * kGridSize, 0.1 * i).ToPoint());
+    shape->Add(S2LatLng::FromDegrees(0.1 * i, 0).ToPoint(),
+               S2LatLng::FromDegrees(0.1 * i, 0.1 * kGridSize).ToPoint());
+  }
+  index.Add(std::move(shape));
+  ThreadPerTaskExecutor executor;
+  std::atomic<int> num_visited(0);
+  EXPECT_FALSE(VisitCrossingEdgePairs(
+      index, CrossingType::ALL,
+      [&num_visited](const ShapeEdge& a, const ShapeEdge& b, bool) {
+        ++num_visited;
+        return false;
+      }, &executor));
+  // Each task stops after the first crossing that it visits.
+  EXPECT_GE(num_visited.load(), 1);
+  EXPECT_LE(num_visited.load(), 8 * executor.num_threads());
+}
+
 // Return true if any loop crosses any other loop (including vertex crossings
 // and duplicate edges), or any loop has a self-intersection (including
 // duplicate vertices).
 static bool HasSelfIntersection(const MutableS2ShapeIndex& index) {
+  ThreadPerTaskExecutor executor;
+  S2Error parallel_error;
+  bool parallel_result =
+      s2shapeutil::FindSelfIntersection(index, &parallel_error, &executor);
   S2Error error;
   if (s2shapeutil::FindSelfIntersection(index, &error)) {
     S2_VLOG(1) << error;
+    EXPECT_TRUE(parallel_result);
     return true;
   }
+  EXPECT_FALSE(parallel_result);
   return false;
 }
 
@@ -0,0 +1,303 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2SHARDED_POINT_INDEX_H_
+#define S2_S2SHARDED_POINT_INDEX_H_
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "s2/base/logging.h"
+#include "s2/base/mutex.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point_index.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+// S2ShardedPointIndex is a variant of S2PointIndex that allows points to be
+// added and removed by many threads at once.  The points are partitioned
+// into shards according to the cell at "shard_level" that contains them,
+// and each shard is an S2PointIndex with its own lock.  Threads that update
+// different shards therefore do not contend with each other.
+//
+// Since each shard covers a contiguous range of S2CellIds, the Iterator
+// class below presents the shards as a single index that can be iterated
+// and searched in S2CellId order (just like S2PointIndex::Iterator), e.g.:
+//
+//   S2ShardedPointIndex<int> index;
+//   ParallelFor(executor, points.size(), [&](int i) {
+//     index.Add(points[i], i);
+//   });
+//   for (S2ShardedPointIndex<int>::Iterator it(&index); !it.done();
+//        it.Next()) { ... }
+//
+// Methods that modify the index are thread-safe with respect to each other.
+// Iterators and the shard() accessor must not be used while the index is
+// being modified.
+template <class Data = std::tuple<> /*empty class*/>
+class S2ShardedPointIndex {
+ public:
+  using Index = S2PointIndex<Data>;
+  using PointData = typename Index::PointData;
+
+  // The index has one shard for each S2Cell at "shard_level", i.e.
+  // (6 * 4 ** shard_level) shards.  Level 1 (24 shards) is enough for most
+  // machines, but higher levels reduce contention further when the points
+  // are clustered.
+  //
+  // REQUIRES: 0 <= shard_level <= kMaxShardLevel
+  static const int kMaxShardLevel = 6;
+  explicit S2ShardedPointIndex(int shard_level = 1);
+
+  // Returns the number of shards.
+  int num_shards() const { return static_cast<int>(shards_.size()); }
+
+  // Returns the shard containing the given cell.  The shards are numbered in
+  // S2CellId order.
+  int GetShard(S2CellId id) const;
+
+  // Returns the points in the given shard.
+  const Index& shard(int i) const { return shards_[i]->index; }
+
+  // Returns the number of points in the index.
+  int num_points() const;
+
+  // Adds the given point to the index.  Invalidates all iterators.
+  // This method is thread-safe.
+  void Add(const S2Point& point, const Data& data);
+  void Add(const PointData& point_data);
+
+  // Convenience function for the case when Data is an empty class.
+  void Add(const S2Point& point);
+
+  // Removes the given point from the index.  Both the "point" and "data"
+  // fields must match the point to be removed.  Returns false if the given
+  // point was not present.  Invalidates all iterators.
+  // This method is thread-safe.
+  bool Remove(const S2Point& point, const Data& data);
+  bool Remove(const PointData& point_data);
+
+  // Resets the index to its original empty state.  Invalidates all
+  // iterators.
+  void Clear();
+
+  // An iterator over all the points in the index, in S2CellId order.  It
+  // has the same interface as S2PointIndex::Iterator.
+  class Iterator {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator() : index_(nullptr), shard_(0) {}
+
+    // Convenience constructor that calls Init().
+    explicit Iterator(const S2ShardedPointIndex* index) { Init(index); }
+
+    // Initializes an iterator for the given index.  If the index is
+    // non-empty, the iterator is positioned at the first point.
+    void Init(const S2ShardedPointIndex* index);
+
+    S2CellId id() const { return iter_.id(); }
+    const S2Point& point() const { return iter_.point(); }
+    const Data& data() const { return iter_.data(); }
+    const PointData& point_data() const { return iter_.point_data(); }
+
+    // Returns true if the iterator is positioned past the last point.
+    bool done() const { return shard_ == index_->num_shards(); }
+
+    // Positions the iterator at the first point (if any).
+    void Begin();
+
+    // Positions the iterator so that done() is true.
+    void Finish();
+
+    // Advances the iterator to the next point.
+    // REQUIRES: !done()
+    void Next();
+
+    // If the iterator is already positioned at the beginning, returns false.
+    // Otherwise positions the iterator at the previous point and returns
+    // true.
+    bool Prev();
+
+    // Positions the iterator at the first point with id() >= target, or at
+    // the end of the index if no such point exists.
+    void Seek(S2CellId target);
+
+   private:
+    // Positions the iterator at the first point of shard "i" or any
+    // following shard.
+    void SkipEmptyShards(int i);
+
+    const S2ShardedPointIndex* index_;
+    int shard_;
+    typename Index::Iterator iter_;
+  };
+
+ private:
+  struct Shard {
+    absl::Mutex mutex;
+    Index index;
+  };
+
+  Shard* GetShard(const S2Point& point) {
+    return shards_[GetShard(S2CellId(point))].get();
+  }
+
+  int shift_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  S2ShardedPointIndex(const S2ShardedPointIndex&) = delete;
+  void operator=(const S2ShardedPointIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Data>
+const int S2ShardedPointIndex<Data>::kMaxShardLevel;
+
+template <class Data>
+S2ShardedPointIndex<Data>::S2ShardedPointIndex(int shard_level)
+    : shift_(S2CellId::kPosBits - 2 * shard_level) {
+  S2_DCHECK_GE(shard_level, 0);
+  S2_DCHECK_LE(shard_level, kMaxShardLevel);
+  int num_shards = S2CellId::kNumFaces << (2 * shard_level);
+  shards_.reserve(num_shards);
+  for (int i = 0; i < num_shards; ++i) {
+    shards_.push_back(absl::make_unique<Shard>());
+  }
+}
+
+template <class Data>
+inline int S2ShardedPointIndex<Data>::GetShard(S2CellId id) const {
+  S2_DCHECK(id.is_valid());
+  return static_cast<int>(id.id() >> shift_);
+}
+
+template <class Data>
+int S2ShardedPointIndex<Data>::num_points() const {
+  int num_points = 0;
+  for (const auto& shard : shards_) num_points += shard->index.num_points();
+  return num_points;
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Add(const PointData& point_data) {
+  Shard* shard = GetShard(point_data.point());
+  shard->mutex.Lock();
+  shard->index.Add(point_data);
+  shard->mutex.Unlock();
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Add(const S2Point& point, const Data& data) {
+  Add(PointData(point, data));
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Add(const S2Point& point) {
+  static_assert(std::is_empty<Data>::value, "Data must be empty");
+  Add(point, {});
+}
+
+template <class Data>
+bool S2ShardedPointIndex<Data>::Remove(const PointData& point_data) {
+  Shard* shard = GetShard(point_data.point());
+  shard->mutex.Lock();
+  bool removed = shard->index.Remove(point_data);
+  shard->mutex.Unlock();
+  return removed;
+}
+
+template <class Data>
+bool S2ShardedPointIndex<Data>::Remove(const S2Point& point,
+                                       const Data& data) {
+  return Remove(PointData(point, data));
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Clear() {
+  for (const auto& shard : shards_) shard->index.Clear();
+}
+
+template <class Data>
+inline void S2ShardedPointIndex<Data>::Iterator::Init(
+    const S2ShardedPointIndex* index) {
+  index_ = index;
+  Begin();
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Iterator::SkipEmptyShards(int i) {
+  for (shard_ = i; shard_ < index_->num_shards(); ++shard_) {
+    iter_.Init(&index_->shard(shard_));
+    if (!iter_.done()) return;
+  }
+}
+
+template <class Data>
+inline void S2ShardedPointIndex<Data>::Iterator::Begin() {
+  SkipEmptyShards(0);
+}
+
+template <class Data>
+inline void S2ShardedPointIndex<Data>::Iterator::Finish() {
+  shard_ = index_->num_shards();
+}
+
+template <class Data>
+inline void S2ShardedPointIndex<Data>::Iterator::Next() {
+  S2_DCHECK(!done());
+  iter_.Next();
+  if (iter_.done()) SkipEmptyShards(shard_ + 1);
+}
+
+template <class Data>
+bool S2ShardedPointIndex<Data>::Iterator::Prev() {
+  if (!done() && iter_.Prev()) return true;
+  for (int i = shard_ - 1; i >= 0; --i) {
+    const Index& shard = index_->shard(i);
+    if (shard.num_points() == 0) continue;
+    shard_ = i;
+    iter_.Init(&shard);
+    iter_.Finish();
+    iter_.Prev();
+    return true;
+  }
+  return false;
+}
+
+template <class Data>
+void S2ShardedPointIndex<Data>::Iterator::Seek(S2CellId target) {
+  // "target" is not necessarily a valid cell id, so GetShard() can't be
+  // used here.
+  uint64 shard = target.id() >> index_->shift_;
+  if (shard >= static_cast<uint64>(index_->num_shards())) {
+    Finish();
+    return;
+  }
+  int i = static_cast<int>(shard);
+  iter_.Init(&index_->shard(i));
+  iter_.Seek(target);
+  if (iter_.done()) {
+    SkipEmptyShards(i + 1);
+  } else {
+    shard_ = i;
+  }
+}
+
+#endif  // S2_S2SHARDED_POINT_INDEX_H_
@@ -0,0 +1,118 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2sharded_point_index.h"
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point_index.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+using Index = S2ShardedPointIndex<int>;
+
+// Checks that iterating over "index" and seeking within it give the same
+// results as for an S2PointIndex containing the same points.
+void CheckMatchesPointIndex(const Index& index,
+                            const S2PointIndex<int>& expected) {
+  EXPECT_EQ(expected.num_points(), index.num_points());
+  S2PointIndex<int>::Iterator expected_it(&expected);
+  Index::Iterator it(&index);
+  for (; !expected_it.done(); expected_it.Next(), it.Next()) {
+    ASSERT_FALSE(it.done());
+    EXPECT_EQ(expected_it.id(), it.id());
+  }
+  EXPECT_TRUE(it.done());
+
+  // Iterate backwards from the end.
+  S2PointIndex<int>::Iterator expected_prev(&expected);
+  expected_prev.Finish();
+  it.Finish();
+  while (expected_prev.Prev()) {
+    ASSERT_TRUE(it.Prev());
+    EXPECT_EQ(expected_prev.id(), it.id());
+  }
+  EXPECT_FALSE(it.Prev());
+
+  for (int i = 0; i < 100; ++i) {
+    S2CellId target = S2Testing::GetRandomCellId();
+    expected_it.Seek(target);
+    it.Seek(target);
+    EXPECT_EQ(expected_it.done(), it.done());
+    if (!it.done()) EXPECT_EQ(expected_it.id(), it.id());
+  }
+  it.Seek(S2CellId::Sentinel());
+  EXPECT_TRUE(it.done());
+}
+
+TEST(S2ShardedPointIndex, Empty) {
+  for (int level : {0, 2}) {
+    Index index(level);
+    EXPECT_EQ(6 << (2 * level), index.num_shards());
+    CheckMatchesPointIndex(index, S2PointIndex<int>());
+  }
+}
+
+TEST(S2ShardedPointIndex, MatchesS2PointIndex) {
+  // Use a clustered set of points so that many shards are empty.
+  S2Testing::rnd.Reset(1);
+  Index index(2);
+  S2PointIndex<int> expected;
+  S2Cap cap(S2Testing::RandomPoint(), S1Angle::Degrees(40));
+  for (int i = 0; i < 1000; ++i) {
+    S2Point p = S2Testing::SamplePoint(cap);
+    index.Add(p, i);
+    expected.Add(p, i);
+  }
+  CheckMatchesPointIndex(index, expected);
+
+  S2PointIndex<int>::Iterator it(&expected);
+  EXPECT_TRUE(index.Remove(it.point(), it.data()));
+  EXPECT_FALSE(index.Remove(it.point(), it.data()));
+  expected.Remove(it.point(), it.data());
+  CheckMatchesPointIndex(index, expected);
+}
+
+TEST(S2ShardedPointIndex, ConcurrentAdds) {
+  S2Testing::rnd.Reset(1);
+  vector<S2Point> points;
+  for (int i = 0; i < 10000; ++i) points.push_back(S2Testing::RandomPoint());
+  Index index;
+  const int kNumThreads = 4;
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&index, &points, t]() {
+        for (int i = t; i < points.size(); i += kNumThreads) {
+          index.Add(points[i], i);
+        }
+      });
+  }
+  for (auto& thread : threads) thread.join();
+  S2PointIndex<int> expected;
+  for (int i = 0; i < points.size(); ++i) expected.Add(points[i], i);
+  CheckMatchesPointIndex(index, expected);
+}
+
+}  // namespace
@@ -15,12 +15,14 @@
 
 #include "s2/s2text_format.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <string>
 #include <vector>
 
 #include "s2/base/logging.h"
 #include "s2/base/stringprintf.h"
-#include "s2/strings/serialize.h"
 #include "s2/third_party/absl/memory/memory.h"
 #include "s2/third_party/absl/strings/str_split.h"
 #include "s2/third_party/absl/strings/string_view.h"
@@ -51,10 +53,117 @@ static vector<string_view> SplitString(string_view str, char separator) {
   return result;
 }
 
-static bool ParseDouble(const string& str, double* value) {
+// Powers of ten that are exactly representable as doubles.
+static const double kExactPowersOf10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static bool IsAsciiSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+static bool IsAsciiDigit(char c) { return c >= '0' && c <= '9'; }
+
+static void SkipSpaces(const char** p, const char* end) {
+  while (*p != end && IsAsciiSpace(**p)) ++*p;
+}
+
+// Parses a floating-point number starting at "*p" (after optional
+// whitespace) and advances "*p" past it.  The result is identical to that
+// of strtod().  Decimal numbers with at most 15 significant digits and
+// small exponents, which is what the text format normally contains, are
+// converted exactly without copying (since both the digits and the power
+// of ten are exactly representable, a single multiplication or division
+// yields the correctly rounded result).  Everything else (long mantissas,
+// large exponents, "inf", hex floats, ...) falls back to strtod().
+static bool ConsumeDouble(const char** p, const char* end, double* value) {
+  SkipSpaces(p, end);
+  const char* start = *p;
+  const char* q = start;
+  bool negative = false;
+  if (q != end && (*q == '-' || *q == '+')) negative = (*q++ == '-');
+  uint64 mantissa = 0;
+  int num_digits = 0, num_significant = 0, exponent = 0;
+  for (; q != end && IsAsciiDigit(*q); ++q, ++num_digits) {
+    if (mantissa == 0 && *q == '0') continue;
+    if (++num_significant <= 19) {
+      mantissa = 10 * mantissa + (*q - '0');
+    } else {
+      ++exponent;
+    }
+  }
+  if (q != end && *q == '.') {
+    for (++q; q != end && IsAsciiDigit(*q); ++q, ++num_digits) {
+      if (mantissa == 0 && *q == '0') {
+        --exponent;
+        continue;
+      }
+      if (++num_significant <= 19) {
+        mantissa = 10 * mantissa + (*q - '0');
+        --exponent;
+      }
+    }
+  }
+  bool fast = num_digits > 0;
+  if (fast && q != end && (*q == 'e' || *q == 'E')) {
+    const char* r = q + 1;
+    bool exp_negative = false;
+    if (r != end && (*r == '-' || *r == '+')) exp_negative = (*r++ == '-');
+    if (r != end && IsAsciiDigit(*r)) {
+      int exp = 0;
+      for (; r != end && IsAsciiDigit(*r); ++r) {
+        if (exp < 10000) exp = 10 * exp + (*r - '0');
+      }
+      exponent += exp_negative ? -exp : exp;
+      q = r;
+    }
+  }
+  // Any other alphanumeric character or '.' means that this is not a
+  // simple decimal number.
+  if (q != end && (isalnum(static_cast<unsigned char>(*q)) || *q == '.')) {
+    fast = false;
+  }
+  if (fast && num_significant <= 15 && exponent >= -22 && exponent <= 22) {
+    double v = static_cast<double>(mantissa);
+    v = (exponent >= 0) ? v * kExactPowersOf10[exponent]
+                        : v / kExactPowersOf10[-exponent];
+    *value = negative ? -v : v;
+    *p = q;
+    return true;
+  }
+  // Fall back to strtod() on a null-terminated copy of the token, which
+  // extends to the next separator.
+  q = start;
+  while (q != end && *q != ',' && *q != ':' && !IsAsciiSpace(*q)) ++q;
+  if (q == start) return false;
+  string token(start, q);
   char* end_ptr = nullptr;
-  *value = strtod(str.c_str(), &end_ptr);
-  return end_ptr && *end_ptr == 0;
+  *value = strtod(token.c_str(), &end_ptr);
+  if (end_ptr != token.c_str() + token.size()) return false;
+  *p = q;
+  return true;
+}
+
+// Parses a comma-separated list of "lat:lng" pairs (in degrees) in a single
+// pass without allocating, calling "fn" with each S2LatLng.
+template <class Fn>
+static bool ParseLatLngPairs(string_view str, const Fn& fn) {
+  const char* p = str.data();
+  const char* end = p + str.size();
+  if (p == end) return true;
+  for (;;) {
+    double lat, lng;
+    if (!ConsumeDouble(&p, end, &lat)) return false;
+    SkipSpaces(&p, end);
+    if (p == end || *p++ != ':') return false;
+    if (!ConsumeDouble(&p, end, &lng)) return false;
+    fn(S2LatLng::FromDegrees(lat, lng));
+    SkipSpaces(&p, end);
+    if (p == end) return true;
+    if (*p++ != ',') return false;
+  }
 }
 
 vector<S2LatLng> ParseLatLngsOrDie(string_view str) {
@@ -64,16 +173,11 @@ vector<S2LatLng> ParseLatLngsOrDie(string_view str) {
 }
 
 bool ParseLatLngs(string_view str, vector<S2LatLng>* latlngs) {
-  vector<pair<string, string>> ps;
-  if (!strings::DictionaryParse(str, &ps)) return false;
-  for (const auto& p : ps) {
-    double lat;
-    if (!ParseDouble(p.first, &lat)) return false;
-    double lng;
-    if (!ParseDouble(p.second, &lng)) return false;
-    latlngs->push_back(S2LatLng::FromDegrees(lat, lng));
-  }
-  return true;
+  latlngs->reserve(latlngs->size() + 1 +
+                   std::count(str.begin(), str.end(), ','));
+  return ParseLatLngPairs(str, [latlngs](const S2LatLng& latlng) {
+      latlngs->push_back(latlng);
+    });
 }
 
 vector<S2Point> ParsePointsOrDie(string_view str) {
@@ -83,12 +187,11 @@ vector<S2Point> ParsePointsOrDie(string_view str) {
 }
 
 bool ParsePoints(string_view str, vector<S2Point>* vertices) {
-  vector<S2LatLng> latlngs;
-  if (!ParseLatLngs(str, &latlngs)) return false;
-  for (const auto& latlng : latlngs) {
-    vertices->push_back(latlng.ToPoint());
-  }
-  return true;
+  vertices->reserve(vertices->size() + 1 +
+                    std::count(str.begin(), str.end(), ','));
+  return ParseLatLngPairs(str, [vertices](const S2LatLng& latlng) {
+      vertices->push_back(latlng.ToPoint());
+    });
 }
 
 S2Point MakePointOrDie(string_view str) {
@@ -179,7 +282,7 @@ bool MakeLoop(string_view str, unique_ptr<S2Loop>* loop,
   }
   vector<S2Point> vertices;
   if (!ParsePoints(str, &vertices)) return false;
-  *loop = make_unique<S2Loop>(vertices, debug_override);
+  *loop = make_unique<S2Loop>(std::move(vertices), debug_override);
   return true;
 }
 
@@ -291,9 +394,8 @@ bool MakeLaxPolygon(string_view str,
     if (loop_str == "full") {
       loops.push_back(vector<S2Point>());
     } else if (loop_str != "empty") {
-      vector<S2Point> points;
-      if (!ParsePoints(loop_str, &points)) return false;
-      loops.push_back(points);
+      loops.emplace_back();
+      if (!ParsePoints(loop_str, &loops.back())) return false;
     }
   }
   *lax_polygon = make_unique<S2LaxPolygonShape>(loops);
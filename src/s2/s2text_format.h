@@ -66,7 +66,10 @@ inline S2Point MakePoint(absl::string_view str) { return MakePointOrDie(str); }
 std::vector<S2LatLng> ParseLatLngsOrDie(absl::string_view str);
 
 // As above, but does not S2_CHECK-fail on invalid input. Returns true if
-// conversion is successful.
+// conversion is successful.  The coordinates are appended to "latlngs".
+// Parsing is done in a single pass without intermediate allocations, and
+// numbers are converted exactly as strtod() would convert them, so this is
+// suitable for loading large inputs.
 ABSL_MUST_USE_RESULT bool ParseLatLngs(absl::string_view str,
                                        std::vector<S2LatLng>* latlngs);
 
@@ -80,7 +83,7 @@ inline std::vector<S2LatLng> ParseLatLngs(absl::string_view str) {
 std::vector<S2Point> ParsePointsOrDie(absl::string_view str);
 
 // As above, but does not S2_CHECK-fail on invalid input. Returns true if
-// conversion is successful.
+// conversion is successful.  The points are appended to "vertices".
 ABSL_MUST_USE_RESULT bool ParsePoints(absl::string_view str,
                                       std::vector<S2Point>* vertices);
 
@@ -15,8 +15,11 @@
 
 #include "s2/s2text_format.h"
 
+#include <cmath>
+#include <cstdlib>
 #include <vector>
 #include <gtest/gtest.h>
+#include "s2/base/stringprintf.h"
 #include "s2/third_party/absl/strings/str_split.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
@@ -207,6 +210,50 @@ TEST(SafeParseLatLngs, InvalidInput) {
   EXPECT_FALSE(s2textformat::ParseLatLngs("blah", &latlngs));
 }
 
+TEST(SafeParseLatLngs, NumberFormats) {
+  // Each coordinate should be converted exactly as strtod() converts it,
+  // whether or not it is handled by the fast path.
+  const char* kValues[] = {
+    "0", "-0", "+1", "12.5", ".5", "5.", "0.001", "1e2", "1.5E-3",
+    "0.1234567890123456789", "123456789012345678901234", "1e-30",
+    "2.2250738585072014e-308", "0x1p-2", "inf", "-nan", "000012",
+  };
+  for (const char* value : kValues) {
+    std::vector<S2LatLng> latlngs;
+    string str = string(value) + ":" + value;
+    ASSERT_TRUE(s2textformat::ParseLatLngs(str, &latlngs)) << str;
+    ASSERT_EQ(1, latlngs.size());
+    double expected = strtod(value, nullptr);
+    S2LatLng ll = S2LatLng::FromDegrees(expected, expected);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(latlngs[0].lat().radians())) << value;
+    } else {
+      EXPECT_EQ(ll, latlngs[0]) << value;
+    }
+  }
+  for (int iter = 0; iter < kIters; ++iter) {
+    double value = S2Testing::rnd.UniformDouble(-180, 180);
+    string str = StringPrintf("%.*g:0", S2Testing::rnd.Uniform(18) + 1,
+                              value);
+    std::vector<S2LatLng> latlngs;
+    ASSERT_TRUE(s2textformat::ParseLatLngs(str, &latlngs));
+    EXPECT_EQ(S2LatLng::FromDegrees(strtod(str.c_str(), nullptr), 0),
+              latlngs[0]) << str;
+  }
+}
+
+TEST(SafeParseLatLngs, MalformedInput) {
+  std::vector<S2LatLng> latlngs;
+  for (const char* str : {"1", "1:", ":1", "1:2,", "1:2 3:4", "1:2:3",
+                          "1e:2", "1.2.3:4", "  ", "1:2,,3:4"}) {
+    EXPECT_FALSE(s2textformat::ParseLatLngs(str, &latlngs)) << str;
+  }
+  // The input does not need to be null-terminated.
+  EXPECT_TRUE(s2textformat::ParseLatLngs(absl::string_view("1:23", 3),
+                                         &latlngs));
+  EXPECT_EQ(S2LatLng::FromDegrees(1, 2), latlngs.back());
+}
+
 TEST(SafeParsePoints, ValidInput) {
   std::vector<S2Point> vertices;
   EXPECT_TRUE(
@@ -0,0 +1,463 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2wkb.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "s2/base/logging.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2loop_measures.h"
+#include "s2/s2point_span.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/util/coding/coder.h"
+#include "s2/util/endian/endian.h"
+
+using absl::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace s2wkb {
+
+namespace {
+
+// WKB geometry type codes.
+enum GeometryType : uint32 {
+  kPoint = 1,
+  kLineString = 2,
+  kPolygon = 3,
+  kMultiPoint = 4,
+  kMultiLineString = 5,
+  kMultiPolygon = 6,
+  kGeometryCollection = 7,
+};
+
+// PostGIS (EWKB) flags stored in the high bits of the geometry type.
+static const uint32 kEwkbZ = 0x80000000;
+static const uint32 kEwkbM = 0x40000000;
+static const uint32 kEwkbSrid = 0x20000000;
+
+// GeometryCollections nested more deeply than this are rejected, so that
+// malicious input cannot exhaust the stack.
+static const int kMaxDepth = 64;
+
+class WkbDecoder {
+ public:
+  WkbDecoder(absl::Span<const uint8> wkb,
+             vector<unique_ptr<S2Shape>>* shapes, S2Error* error)
+      : p_(wkb.data()), end_(wkb.data() + wkb.size()), shapes_(shapes),
+        error_(error) {}
+
+  bool Decode() {
+    if (!DecodeGeometry(0)) return false;
+    if (p_ != end_) return Fail("Unexpected data after WKB geometry");
+    return true;
+  }
+
+ private:
+  // The header of a geometry: its byte order, type, and number of
+  // coordinates per point.
+  struct Header {
+    bool big_endian;
+    uint32 type;
+    int dims;
+  };
+
+  bool Fail(const char* message) {
+    error_->Init(S2Error::DATA_LOSS, "%s", message);
+    return false;
+  }
+
+  bool ReadUint32(bool big_endian, uint32* value) {
+    if (end_ - p_ < 4) return Fail("Truncated WKB");
+    *value = big_endian ? BigEndian::Load32(p_) : LittleEndian::Load32(p_);
+    p_ += 4;
+    return true;
+  }
+
+  bool ReadDouble(bool big_endian, double* value) {
+    if (end_ - p_ < 8) return Fail("Truncated WKB");
+    uint64 bits = big_endian ? BigEndian::Load64(p_) : LittleEndian::Load64(p_);
+    std::memcpy(value, &bits, sizeof(bits));
+    p_ += 8;
+    return true;
+  }
+
+  // Reads a count of items that each occupy at least "min_bytes", and
+  // checks that enough data is left so that the count can be used to
+  // reserve memory.
+  bool ReadCount(bool big_endian, size_t min_bytes, uint32* count) {
+    if (!ReadUint32(big_endian, count)) return false;
+    if (*count > static_cast<size_t>(end_ - p_) / min_bytes) {
+      return Fail("Truncated WKB");
+    }
+    return true;
+  }
+
+  bool ReadHeader(Header* header) {
+    if (p_ == end_) return Fail("Truncated WKB");
+    uint8 order = *p_++;
+    if (order > 1) return Fail("Invalid WKB byte order");
+    header->big_endian = (order == 0);
+    uint32 type;
+    if (!ReadUint32(header->big_endian, &type)) return false;
+    bool has_z = (type & kEwkbZ) != 0, has_m = (type & kEwkbM) != 0;
+    if (type & kEwkbSrid) {
+      uint32 srid;
+      if (!ReadUint32(header->big_endian, &srid)) return false;
+    }
+    type &= ~(kEwkbZ | kEwkbM | kEwkbSrid);
+    // ISO WKB adds 1000, 2000, or 3000 for Z, M, and ZM coordinates.
+    if (type >= 4000) return Fail("Unsupported WKB geometry type");
+    has_z |= (type / 1000 == 1 || type / 1000 == 3);
+    has_m |= (type / 1000 == 2 || type / 1000 == 3);
+    header->type = type % 1000;
+    header->dims = 2 + has_z + has_m;
+    return true;
+  }
+
+  // Reads one point and sets "empty" if it is an empty point (represented
+  // by NaN coordinates).
+  bool ReadPoint(const Header& header, S2Point* point, bool* empty) {
+    double x, y, unused;
+    if (!ReadDouble(header.big_endian, &x) ||
+        !ReadDouble(header.big_endian, &y)) {
+      return false;
+    }
+    for (int i = 2; i < header.dims; ++i) {
+      if (!ReadDouble(header.big_endian, &unused)) return false;
+    }
+    *empty = std::isnan(x) && std::isnan(y);
+    if (*empty) return true;
+    if (!(std::fabs(y) <= 90) || !std::isfinite(x)) {
+      return Fail("Invalid WKB coordinates");
+    }
+    *point = S2LatLng::FromDegrees(y, x).Normalized().ToPoint();
+    return true;
+  }
+
+  // Reads a sequence of points preceded by their count.
+  bool ReadPoints(const Header& header, vector<S2Point>* points) {
+    uint32 n;
+    if (!ReadCount(header.big_endian, 8 * header.dims, &n)) return false;
+    points->resize(n);
+    for (uint32 i = 0; i < n; ++i) {
+      bool empty;
+      if (!ReadPoint(header, &(*points)[i], &empty)) return false;
+      if (empty) return Fail("Empty point in WKB sequence");
+    }
+    return true;
+  }
+
+  // Reads a polygon's rings and appends them to "loops", oriented as
+  // described in s2wkb.h.
+  bool ReadPolygon(const Header& header, vector<vector<S2Point>>* loops) {
+    uint32 num_rings;
+    if (!ReadCount(header.big_endian, 4, &num_rings)) return false;
+    for (uint32 i = 0; i < num_rings; ++i) {
+      vector<S2Point> ring;
+      if (!ReadPoints(header, &ring)) return false;
+      // WKB rings repeat their first vertex at the end.
+      if (ring.size() > 1 && ring.front() == ring.back()) ring.pop_back();
+      if (ring.empty()) continue;  // S2 would interpret this as a full loop.
+      if (ring.size() >= 3) {
+        bool shell = (i == 0);
+        if (S2::IsNormalized(S2PointLoopSpan(ring)) != shell) {
+          std::reverse(ring.begin(), ring.end());
+        }
+      }
+      loops->push_back(std::move(ring));
+    }
+    return true;
+  }
+
+  // Reads the header of a member of a multi-geometry and checks its type.
+  bool ReadMemberHeader(uint32 type, Header* header) {
+    if (!ReadHeader(header)) return false;
+    if (header->type != type) return Fail("Invalid WKB multi-geometry member");
+    return true;
+  }
+
+  bool DecodeGeometry(int depth) {
+    Header header;
+    if (!ReadHeader(&header)) return false;
+    switch (header.type) {
+      case kPoint: {
+        S2Point point;
+        bool empty;
+        if (!ReadPoint(header, &point, &empty)) return false;
+        if (!empty) {
+          shapes_->push_back(
+              make_unique<S2PointVectorShape>(vector<S2Point>{point}));
+        }
+        return true;
+      }
+      case kLineString: {
+        vector<S2Point> vertices;
+        if (!ReadPoints(header, &vertices)) return false;
+        AddPolyline(vertices);
+        return true;
+      }
+      case kPolygon: {
+        vector<vector<S2Point>> loops;
+        if (!ReadPolygon(header, &loops)) return false;
+        AddPolygon(loops);
+        return true;
+      }
+      case kMultiPoint: {
+        uint32 n;
+        if (!ReadCount(header.big_endian, 5, &n)) return false;
+        vector<S2Point> points;
+        points.reserve(n);
+        for (uint32 i = 0; i < n; ++i) {
+          Header member;
+          S2Point point;
+          bool empty;
+          if (!ReadMemberHeader(kPoint, &member) ||
+              !ReadPoint(member, &point, &empty)) {
+            return false;
+          }
+          if (!empty) points.push_back(point);
+        }
+        if (!points.empty()) {
+          shapes_->push_back(
+              make_unique<S2PointVectorShape>(std::move(points)));
+        }
+        return true;
+      }
+      case kMultiLineString: {
+        uint32 n;
+        if (!ReadCount(header.big_endian, 5, &n)) return false;
+        vector<S2Point> vertices;
+        for (uint32 i = 0; i < n; ++i) {
+          Header member;
+          if (!ReadMemberHeader(kLineString, &member) ||
+              !ReadPoints(member, &vertices)) {
+            return false;
+          }
+          AddPolyline(vertices);
+        }
+        return true;
+      }
+      case kMultiPolygon: {
+        uint32 n;
+        if (!ReadCount(header.big_endian, 5, &n)) return false;
+        vector<vector<S2Point>> loops;
+        for (uint32 i = 0; i < n; ++i) {
+          Header member;
+          if (!ReadMemberHeader(kPolygon, &member) ||
+              !ReadPolygon(member, &loops)) {
+            return false;
+          }
+        }
+        AddPolygon(loops);
+        return true;
+      }
+      case kGeometryCollection: {
+        if (depth >= kMaxDepth) return Fail("WKB nesting is too deep");
+        uint32 n;
+        if (!ReadCount(header.big_endian, 5, &n)) return false;
+        for (uint32 i = 0; i < n; ++i) {
+          if (!DecodeGeometry(depth + 1)) return false;
+        }
+        return true;
+      }
+      default:
+        error_->Init(S2Error::UNIMPLEMENTED,
+                     "Unsupported WKB geometry type %u", header.type);
+        return false;
+    }
+  }
+
+  void AddPolyline(const vector<S2Point>& vertices) {
+    if (vertices.empty()) return;
+    shapes_->push_back(make_unique<S2LaxPolylineShape>(vertices));
+  }
+
+  void AddPolygon(const vector<vector<S2Point>>& loops) {
+    if (loops.empty()) return;
+    shapes_->push_back(make_unique<S2LaxPolygonShape>(loops));
+  }
+
+  const uint8* p_;
+  const uint8* end_;
+  vector<unique_ptr<S2Shape>>* shapes_;
+  S2Error* error_;
+};
+
+void PutHeader(uint32 type, Encoder* encoder) {
+  encoder->Ensure(5);
+  encoder->put8(1);  // Little-endian.
+  encoder->put32(type);
+}
+
+void PutPoint(const S2Point& p, Encoder* encoder) {
+  S2LatLng ll(p);
+  encoder->putdouble(ll.lng().degrees());
+  encoder->putdouble(ll.lat().degrees());
+}
+
+// Writes the vertices of the given chain, repeating the first vertex at the
+// end if "closed" is true.
+void PutChain(const S2Shape& shape, int chain_id, bool closed,
+              Encoder* encoder) {
+  S2Shape::Chain chain = shape.chain(chain_id);
+  int n = (chain.length > 0) ? chain.length + 1 : 0;
+  encoder->Ensure(4 + 16 * n);
+  encoder->put32(n);
+  for (int j = 0; j < chain.length; ++j) {
+    PutPoint(shape.chain_edge(chain_id, j).v0, encoder);
+  }
+  if (chain.length > 0) {
+    PutPoint(closed ? shape.chain_edge(chain_id, 0).v0
+                    : shape.chain_edge(chain_id, chain.length - 1).v1,
+             encoder);
+  }
+}
+
+// Returns the vertices of a loop of a two-dimensional shape.
+vector<S2Point> GetLoopVertices(const S2Shape& shape, int chain_id) {
+  S2Shape::Chain chain = shape.chain(chain_id);
+  vector<S2Point> vertices(chain.length);
+  for (int j = 0; j < chain.length; ++j) {
+    vertices[j] = shape.chain_edge(chain_id, j).v0;
+  }
+  return vertices;
+}
+
+bool EncodePolygons(const S2Shape& shape, Encoder* encoder, S2Error* error) {
+  // Classify the loops into shells and holes, and assign each hole to the
+  // smallest shell that contains it.
+  const int num_loops = shape.num_chains();
+  vector<int> shells;
+  vector<double> shell_areas;
+  vector<unique_ptr<S2Loop>> shell_loops;
+  vector<vector<int>> holes;
+  vector<int> hole_ids;
+  for (int i = 0; i < num_loops; ++i) {
+    vector<S2Point> vertices = GetLoopVertices(shape, i);
+    if (vertices.empty()) {
+      error->Init(S2Error::INVALID_ARGUMENT,
+                  "Full loops cannot be encoded as WKB");
+      return false;
+    }
+    if (vertices.size() < 3 || S2::IsNormalized(S2PointLoopSpan(vertices))) {
+      shells.push_back(i);
+      shell_areas.push_back(S2::GetArea(S2PointLoopSpan(vertices)));
+      shell_loops.push_back(
+          make_unique<S2Loop>(vertices, S2Debug::DISABLE));
+    } else {
+      hole_ids.push_back(i);
+    }
+  }
+  holes.resize(shells.size());
+  for (int hole : hole_ids) {
+    S2Point p = shape.chain_edge(hole, 0).v0;
+    int best = -1;
+    for (int j = 0; j < shells.size(); ++j) {
+      if (shell_loops[j]->Contains(p) &&
+          (best < 0 || shell_areas[j] < shell_areas[best])) {
+        best = j;
+      }
+    }
+    if (best < 0) {
+      error->Init(S2Error::INVALID_ARGUMENT,
+                  "Loop %d encloses more than half of the sphere and is "
+                  "not inside any other loop", hole);
+      return false;
+    }
+    holes[best].push_back(hole);
+  }
+  bool multi = (shells.size() != 1);
+  if (multi) {
+    PutHeader(kMultiPolygon, encoder);
+    encoder->Ensure(4);
+    encoder->put32(shells.size());
+  }
+  for (int j = 0; j < shells.size(); ++j) {
+    PutHeader(kPolygon, encoder);
+    encoder->Ensure(4);
+    encoder->put32(1 + holes[j].size());
+    PutChain(shape, shells[j], true, encoder);
+    for (int hole : holes[j]) PutChain(shape, hole, true, encoder);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool DecodeShapes(absl::Span<const uint8> wkb,
+                  vector<unique_ptr<S2Shape>>* shapes, S2Error* error) {
+  error->Clear();
+  vector<unique_ptr<S2Shape>> decoded;
+  if (!WkbDecoder(wkb, &decoded, error).Decode()) return false;
+  for (auto& shape : decoded) shapes->push_back(std::move(shape));
+  return true;
+}
+
+bool DecodeShapes(absl::Span<const uint8> wkb, MutableS2ShapeIndex* index,
+                  S2Error* error) {
+  vector<unique_ptr<S2Shape>> shapes;
+  if (!DecodeShapes(wkb, &shapes, error)) return false;
+  for (auto& shape : shapes) index->Add(std::move(shape));
+  return true;
+}
+
+bool EncodeShape(const S2Shape& shape, Encoder* encoder, S2Error* error) {
+  error->Clear();
+  switch (shape.dimension()) {
+    case 0: {
+      const int n = shape.num_edges();
+      if (n != 1) {
+        PutHeader(kMultiPoint, encoder);
+        encoder->Ensure(4);
+        encoder->put32(n);
+      }
+      for (int e = 0; e < n; ++e) {
+        PutHeader(kPoint, encoder);
+        encoder->Ensure(16);
+        PutPoint(shape.edge(e).v0, encoder);
+      }
+      return true;
+    }
+    case 1: {
+      const int n = shape.num_chains();
+      if (n != 1) {
+        PutHeader(kMultiLineString, encoder);
+        encoder->Ensure(4);
+        encoder->put32(n);
+      }
+      for (int i = 0; i < n; ++i) {
+        PutHeader(kLineString, encoder);
+        PutChain(shape, i, false, encoder);
+      }
+      return true;
+    }
+    default:
+      return EncodePolygons(shape, encoder, error);
+  }
+}
+
+}  // namespace s2wkb
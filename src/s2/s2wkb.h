@@ -0,0 +1,85 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Conversion between S2 shapes and the OGC Well-Known Binary (WKB) format,
+// which is used by PostGIS, GeoParquet, and many other systems.
+//
+// WKB coordinates are interpreted as (longitude, latitude) pairs in
+// degrees, and edges are interpreted as geodesics.  Geometries are decoded
+// directly into S2PointVectorShape, S2LaxPolylineShape and
+// S2LaxPolygonShape objects, which (unlike S2Loop and S2Polygon) do not
+// validate their input or build an index, so decoding is fast:
+//
+//   std::vector<std::unique_ptr<S2Shape>> shapes;
+//   S2Error error;
+//   if (!s2wkb::DecodeShapes(wkb, &shapes, &error)) { ... }
+//
+// Every geometry type of the OGC Simple Features model is supported, in
+// either byte order, including the ISO and PostGIS (EWKB) variants with Z
+// and/or M coordinates (which are ignored) and an embedded SRID (which is
+// ignored as well).
+#ifndef S2_S2WKB_H_
+#define S2_S2WKB_H_
+
+#include <memory>
+#include <vector>
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/third_party/absl/types/span.h"
+#include "s2/s2error.h"
+#include "s2/s2shape.h"
+
+class Encoder;
+class MutableS2ShapeIndex;
+
+namespace s2wkb {
+
+// Decodes the WKB geometry in "wkb" and appends the resulting shapes to
+// "shapes".  Returns false and sets "error" (leaving "shapes" unchanged) if
+// "wkb" is not a single valid WKB geometry.
+//
+// Each Point or MultiPoint becomes one S2PointVectorShape, each LineString
+// (including each member of a MultiLineString) becomes one
+// S2LaxPolylineShape, and each Polygon or MultiPolygon becomes one
+// S2LaxPolygonShape.  The members of a GeometryCollection are decoded
+// recursively.  Empty geometries do not produce any shapes.
+//
+// Since WKB rings on the sphere do not have a well-defined interior, each
+// polygon shell is oriented so that it encloses at most half of the sphere
+// and each hole is oriented the opposite way.  This matches the usual
+// interpretation of geographic polygons, but polygons whose shells are
+// larger than a hemisphere cannot be represented.
+bool DecodeShapes(absl::Span<const uint8> wkb,
+                  std::vector<std::unique_ptr<S2Shape>>* shapes,
+                  S2Error* error);
+
+// Like DecodeShapes(), but adds the shapes directly to "index".  If an
+// error occurs, the shapes that were decoded so far are not added.
+bool DecodeShapes(absl::Span<const uint8> wkb, MutableS2ShapeIndex* index,
+                  S2Error* error);
+
+// Appends the little-endian WKB encoding of "shape" to "encoder".  Shapes
+// of dimension 0 become a Point (if they have one point) or a MultiPoint,
+// shapes of dimension 1 become a LineString or MultiLineString (one per
+// chain), and shapes of dimension 2 become a Polygon or MultiPolygon (where
+// each hole is assigned to the smallest shell that contains it).  Returns
+// false and sets "error" if the shape cannot be represented, e.g. because
+// it contains a full loop or a hole without an enclosing shell.
+bool EncodeShape(const S2Shape& shape, Encoder* encoder, S2Error* error);
+
+}  // namespace s2wkb
+
+#endif  // S2_S2WKB_H_
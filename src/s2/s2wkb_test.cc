@@ -0,0 +1,232 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2wkb.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2text_format.h"
+#include "s2/util/coding/coder.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Builds WKB byte strings for the tests.
+class WkbBuilder {
+ public:
+  explicit WkbBuilder(bool big_endian = false) : big_endian_(big_endian) {}
+
+  WkbBuilder& Header(uint32 type) {
+    bytes_.push_back(big_endian_ ? 0 : 1);
+    return Uint32(type);
+  }
+  WkbBuilder& Uint32(uint32 v) {
+    for (int i = 0; i < 4; ++i) {
+      int shift = big_endian_ ? 8 * (3 - i) : 8 * i;
+      bytes_.push_back((v >> shift) & 0xff);
+    }
+    return *this;
+  }
+  WkbBuilder& Double(double d) {
+    uint64 v;
+    memcpy(&v, &d, sizeof(v));
+    for (int i = 0; i < 8; ++i) {
+      int shift = big_endian_ ? 8 * (7 - i) : 8 * i;
+      bytes_.push_back((v >> shift) & 0xff);
+    }
+    return *this;
+  }
+  WkbBuilder& Point(double lng, double lat) { return Double(lng).Double(lat); }
+
+  const vector<uint8>& bytes() const { return bytes_; }
+
+ private:
+  bool big_endian_;
+  vector<uint8> bytes_;
+};
+
+vector<unique_ptr<S2Shape>> DecodeOrDie(const vector<uint8>& wkb) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  EXPECT_TRUE(s2wkb::DecodeShapes(wkb, &shapes, &error)) << error;
+  return shapes;
+}
+
+vector<uint8> EncodeOrDie(const S2Shape& shape) {
+  Encoder encoder;
+  S2Error error;
+  EXPECT_TRUE(s2wkb::EncodeShape(shape, &encoder, &error)) << error;
+  return vector<uint8>(encoder.base(), encoder.base() + encoder.length());
+}
+
+S2Point Point(double lat, double lng) {
+  return S2LatLng::FromDegrees(lat, lng).ToPoint();
+}
+
+TEST(S2Wkb, DecodePointBothByteOrders) {
+  for (bool big_endian : {false, true}) {
+    auto shapes = DecodeOrDie(
+        WkbBuilder(big_endian).Header(1).Point(30, 10).bytes());
+    ASSERT_EQ(1, shapes.size());
+    EXPECT_EQ(0, shapes[0]->dimension());
+    EXPECT_EQ(1, shapes[0]->num_edges());
+    EXPECT_TRUE(S2::ApproxEquals(Point(10, 30), shapes[0]->edge(0).v0));
+  }
+}
+
+TEST(S2Wkb, DecodeLineStringWithZAndSrid) {
+  // An EWKB LineString with Z coordinates and an SRID.
+  auto shapes = DecodeOrDie(WkbBuilder().Header(2 | 0x80000000 | 0x20000000)
+                            .Uint32(4326).Uint32(2)
+                            .Point(0, 0).Double(100)
+                            .Point(0, 5).Double(200).bytes());
+  ASSERT_EQ(1, shapes.size());
+  EXPECT_EQ(1, shapes[0]->dimension());
+  EXPECT_EQ(1, shapes[0]->num_edges());
+  EXPECT_TRUE(S2::ApproxEquals(Point(5, 0), shapes[0]->edge(0).v1));
+
+  // The same LineString in ISO format with M coordinates.
+  shapes = DecodeOrDie(WkbBuilder().Header(2002).Uint32(2)
+                       .Point(0, 0).Double(1).Point(0, 5).Double(2).bytes());
+  ASSERT_EQ(1, shapes.size());
+  EXPECT_EQ(1, shapes[0]->num_edges());
+}
+
+TEST(S2Wkb, DecodePolygonOrientsRings) {
+  // The shell is clockwise and the hole is counter-clockwise, the opposite
+  // of the OGC convention.  The rings are reoriented so that the shell
+  // encloses the small region.
+  WkbBuilder wkb;
+  wkb.Header(3).Uint32(2);
+  wkb.Uint32(5).Point(0, 0).Point(0, 10).Point(10, 10).Point(10, 0).Point(0, 0);
+  wkb.Uint32(5).Point(4, 4).Point(6, 4).Point(6, 6).Point(4, 6).Point(4, 4);
+  MutableS2ShapeIndex index;
+  S2Error error;
+  ASSERT_TRUE(s2wkb::DecodeShapes(wkb.bytes(), &index, &error)) << error;
+  ASSERT_EQ(1, index.num_shape_ids());
+  const S2Shape& shape = *index.shape(0);
+  EXPECT_EQ(2, shape.dimension());
+  EXPECT_EQ(2, shape.num_chains());
+  EXPECT_EQ(8, shape.num_edges());
+  auto expected = s2textformat::MakeLaxPolygonOrDie(
+      "0:10, 10:10, 10:0, 0:0; 6:4, 6:6, 4:6, 4:4");
+  MutableS2ShapeIndex expected_index;
+  expected_index.Add(std::move(expected));
+  EXPECT_EQ(s2textformat::ToString(expected_index),
+            s2textformat::ToString(index));
+}
+
+TEST(S2Wkb, DecodeCollections) {
+  WkbBuilder wkb;
+  wkb.Header(7).Uint32(3);
+  wkb.Header(4).Uint32(2).Header(1).Point(1, 1).Header(1).Point(2, 2);
+  wkb.Header(5).Uint32(2)
+      .Header(2).Uint32(2).Point(0, 0).Point(1, 0)
+      .Header(2).Uint32(2).Point(0, 1).Point(1, 1);
+  wkb.Header(7).Uint32(1).Header(1).Double(NAN).Double(NAN);  // Empty.
+  auto shapes = DecodeOrDie(wkb.bytes());
+  ASSERT_EQ(3, shapes.size());
+  EXPECT_EQ(2, shapes[0]->num_edges());
+  EXPECT_EQ(1, shapes[1]->dimension());
+  EXPECT_EQ(1, shapes[2]->dimension());
+}
+
+TEST(S2Wkb, DecodeInvalidInput) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  vector<uint8> truncated =
+      WkbBuilder().Header(2).Uint32(3).Point(0, 0).bytes();
+  EXPECT_FALSE(s2wkb::DecodeShapes(truncated, &shapes, &error));
+  EXPECT_EQ(S2Error::DATA_LOSS, error.code());
+
+  // A huge count must be rejected before any memory is reserved.
+  vector<uint8> huge = WkbBuilder().Header(4).Uint32(0xffffffff).bytes();
+  EXPECT_FALSE(s2wkb::DecodeShapes(huge, &shapes, &error));
+
+  vector<uint8> bad_type = WkbBuilder().Header(17).bytes();
+  EXPECT_FALSE(s2wkb::DecodeShapes(bad_type, &shapes, &error));
+
+  vector<uint8> bad_lat = WkbBuilder().Header(1).Point(0, 91).bytes();
+  EXPECT_FALSE(s2wkb::DecodeShapes(bad_lat, &shapes, &error));
+
+  vector<uint8> trailing = WkbBuilder().Header(1).Point(0, 0).Uint32(0).bytes();
+  EXPECT_FALSE(s2wkb::DecodeShapes(trailing, &shapes, &error));
+  EXPECT_TRUE(shapes.empty());
+}
+
+void ExpectRoundTrip(const S2Shape& shape) {
+  auto shapes = DecodeOrDie(EncodeOrDie(shape));
+  ASSERT_EQ(1, shapes.size());
+  const S2Shape& decoded = *shapes[0];
+  ASSERT_EQ(shape.dimension(), decoded.dimension());
+  ASSERT_EQ(shape.num_edges(), decoded.num_edges());
+  ASSERT_EQ(shape.num_chains(), decoded.num_chains());
+  for (int e = 0; e < shape.num_edges(); ++e) {
+    EXPECT_TRUE(S2::ApproxEquals(shape.edge(e).v0, decoded.edge(e).v0));
+    EXPECT_TRUE(S2::ApproxEquals(shape.edge(e).v1, decoded.edge(e).v1));
+  }
+}
+
+TEST(S2Wkb, RoundTrip) {
+  ExpectRoundTrip(S2PointVectorShape(
+      s2textformat::ParsePointsOrDie("1:2, 3:4, -5:170")));
+  ExpectRoundTrip(S2PointVectorShape(s2textformat::ParsePointsOrDie("1:2")));
+  ExpectRoundTrip(*s2textformat::MakeLaxPolylineOrDie("0:0, 0:5, 5:5"));
+  ExpectRoundTrip(*s2textformat::MakeLaxPolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 4:4, 6:4, 6:6, 4:6"));
+  ExpectRoundTrip(*s2textformat::MakeLaxPolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 20:20, 20:25, 25:25"));
+}
+
+TEST(S2Wkb, EncodeMultiPolygonAssignsHoles) {
+  // Two shells, each with a hole, given in an interleaved order.
+  auto polygon = s2textformat::MakeLaxPolygonOrDie(
+      "0:0, 0:10, 10:10, 10:0; 20:20, 20:30, 30:30, 30:20; "
+      "24:24, 26:24, 26:26, 24:26; 4:4, 6:4, 6:6, 4:6");
+  vector<uint8> wkb = EncodeOrDie(*polygon);
+  // Header of the MultiPolygon, followed by that of its first Polygon.
+  ASSERT_GE(wkb.size(), 18);
+  EXPECT_EQ(6, wkb[1]);
+  EXPECT_EQ(2, wkb[5]);
+  EXPECT_EQ(3, wkb[10]);
+  EXPECT_EQ(2, wkb[14]);  // The first polygon has two rings.
+  auto shapes = DecodeOrDie(wkb);
+  ASSERT_EQ(1, shapes.size());
+  EXPECT_EQ(4, shapes[0]->num_chains());
+  EXPECT_EQ(16, shapes[0]->num_edges());
+}
+
+TEST(S2Wkb, EncodeFullLoopFails) {
+  auto polygon = s2textformat::MakeLaxPolygonOrDie("full");
+  Encoder encoder;
+  S2Error error;
+  EXPECT_FALSE(s2wkb::EncodeShape(*polygon, &encoder, &error));
+  EXPECT_EQ(S2Error::INVALID_ARGUMENT, error.code());
+}
+
+}  // namespace
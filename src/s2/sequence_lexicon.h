@@ -69,6 +69,12 @@ class SequenceLexicon {
   // Clears all data from the lexicon.
   void Clear();
 
+  // Reserves space for the given total number of sequences and values, so
+  // that adding them does not cause any reallocation or rehashing.  This is
+  // useful before adding a large number of sequences at once (see also
+  // Merge).
+  void Reserve(uint32 num_sequences, size_t num_values);
+
   // Add the given sequence of values to the lexicon if it is not already
   // present, and return its integer id.  Ids are assigned sequentially
   // starting from zero.  "begin" and "end" are forward iterators over a
@@ -106,6 +112,12 @@ class SequenceLexicon {
   //   for (const auto& value : lexicon.sequence(id)) { ... }
   Sequence sequence(uint32 id) const;
 
+  // Adds all sequences of "other" to this lexicon, and returns a vector that
+  // maps each id of "other" to the id of the same sequence in this lexicon.
+  //
+  // REQUIRES: &other != this
+  std::vector<uint32> Merge(const SequenceLexicon& other);
+
  private:
   friend class IdKeyEqual;
   // Choose kEmptyKey to be the last key that will ever be generated.
@@ -135,6 +147,12 @@ class SequenceLexicon {
 
   std::vector<T> values_;
   std::vector<uint32> begins_;
+
+  // The hash value of each sequence.  These are computed once when a
+  // sequence is added, so that the hash table can be resized without
+  // rehashing the sequences, and so that most unequal sequences can be
+  // rejected without comparing their elements.
+  std::vector<uint64> hashes_;
   IdSet id_set_;
 };
 
@@ -157,13 +175,9 @@ const Hasher& SequenceLexicon<T, Hasher, KeyEqual>::IdHasher::hasher() const {
 }
 
 template <class T, class Hasher, class KeyEqual>
-size_t SequenceLexicon<T, Hasher, KeyEqual>::IdHasher::operator()(
+inline size_t SequenceLexicon<T, Hasher, KeyEqual>::IdHasher::operator()(
     uint32 id) const {
-  HashMix mix;
-  for (const auto& value : lexicon_->sequence(id)) {
-    mix.Mix(hasher_(value));
-  }
-  return mix.get();
+  return lexicon_->hashes_[id];
 }
 
 template <class T, class Hasher, class KeyEqual>
@@ -185,6 +199,7 @@ bool SequenceLexicon<T, Hasher, KeyEqual>::IdKeyEqual::operator()(
   if (id1 == lexicon_->kEmptyKey || id2 == lexicon_->kEmptyKey) {
     return false;
   }
+  if (lexicon_->hashes_[id1] != lexicon_->hashes_[id2]) return false;
   SequenceLexicon::Sequence seq1 = lexicon_->sequence(id1);
   SequenceLexicon::Sequence seq2 = lexicon_->sequence(id2);
   return (seq1.size() == seq2.size() &&
@@ -202,7 +217,7 @@ SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(const Hasher& hasher,
 
 template <class T, class Hasher, class KeyEqual>
 SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(const SequenceLexicon& x)
-    : values_(x.values_), begins_(x.begins_),
+    : values_(x.values_), begins_(x.begins_), hashes_(x.hashes_),
       // Unfortunately we can't copy "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
       id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
@@ -213,6 +228,7 @@ SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(const SequenceLexicon& x)
 template <class T, class Hasher, class KeyEqual>
 SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(SequenceLexicon&& x)
     : values_(std::move(x.values_)), begins_(std::move(x.begins_)),
+      hashes_(std::move(x.hashes_)),
       // Unfortunately we can't move "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
       id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
@@ -226,6 +242,7 @@ SequenceLexicon<T, Hasher, KeyEqual>::operator=(const SequenceLexicon& x) {
   // Note that self-assignment is handled correctly by this code.
   values_ = x.values_;
   begins_ = x.begins_;
+  hashes_ = x.hashes_;
   // Unfortunately we can't copy-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
   id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
@@ -240,6 +257,7 @@ SequenceLexicon<T, Hasher, KeyEqual>::operator=(SequenceLexicon&& x) {
   // Note that move self-assignment has undefined behavior.
   values_ = std::move(x.values_);
   begins_ = std::move(x.begins_);
+  hashes_ = std::move(x.hashes_);
   // Unfortunately we can't move-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
   id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
@@ -252,23 +270,38 @@ template <class T, class Hasher, class KeyEqual>
 void SequenceLexicon<T, Hasher, KeyEqual>::Clear() {
   values_.clear();
   begins_.clear();
+  hashes_.clear();
   id_set_.clear();
   begins_.push_back(0);
 }
 
+template <class T, class Hasher, class KeyEqual>
+void SequenceLexicon<T, Hasher, KeyEqual>::Reserve(uint32 num_sequences,
+                                                   size_t num_values) {
+  values_.reserve(num_values);
+  begins_.reserve(num_sequences + 1);
+  hashes_.reserve(num_sequences);
+  id_set_.resize(num_sequences);
+}
+
 template <class T, class Hasher, class KeyEqual>
 template <class FwdIterator>
 uint32 SequenceLexicon<T, Hasher, KeyEqual>::Add(FwdIterator begin,
                                                  FwdIterator end) {
+  const Hasher& hasher = id_set_.hash_funct().hasher();
+  HashMix mix;
   for (; begin != end; ++begin) {
     values_.push_back(*begin);
+    mix.Mix(hasher(values_.back()));
   }
   begins_.push_back(values_.size());
+  hashes_.push_back(mix.get());
   uint32 id = begins_.size() - 2;
   auto result = id_set_.insert(id);
   if (result.second) {
     return id;
   } else {
+    hashes_.pop_back();
     begins_.pop_back();
     values_.resize(begins_.back());
     return *result.first;
@@ -281,6 +314,19 @@ uint32 SequenceLexicon<T, Hasher, KeyEqual>::Add(const Container& container) {
   return Add(std::begin(container), std::end(container));
 }
 
+template <class T, class Hasher, class KeyEqual>
+std::vector<uint32> SequenceLexicon<T, Hasher, KeyEqual>::Merge(
+    const SequenceLexicon& other) {
+  Reserve(size() + other.size(), values_.size() + other.values_.size());
+  std::vector<uint32> ids;
+  ids.reserve(other.size());
+  for (uint32 id = 0; id < other.size(); ++id) {
+    Sequence sequence = other.sequence(id);
+    ids.push_back(Add(sequence.begin(), sequence.end()));
+  }
+  return ids;
+}
+
 template <class T, class Hasher, class KeyEqual>
 inline uint32 SequenceLexicon<T, Hasher, KeyEqual>::size() const {
   return begins_.size() - 1;
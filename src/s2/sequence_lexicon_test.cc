@@ -111,3 +111,43 @@ TEST(SequenceLexicon, MoveAssignmentOperator) {
   ExpectSequence(Seq{7, 8}, lex.sequence(1));
 }
 
+TEST(SequenceLexicon, Reserve) {
+  SequenceLexicon<int64> lex;
+  EXPECT_EQ(0, lex.Add(Seq{1, 2}));
+  lex.Reserve(1000, 2000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i + 1, lex.Add(Seq{i, -1}));
+  }
+  EXPECT_EQ(0, lex.Add(Seq{1, 2}));
+  EXPECT_EQ(1001, lex.size());
+}
+
+// Maps all values to the same hash, so that every sequence of a given length
+// has the same hash value.
+struct ConstantHasher {
+  size_t operator()(int64 value) const { return 1; }
+};
+
+TEST(SequenceLexicon, HashCollisions) {
+  SequenceLexicon<int64, ConstantHasher> lex;
+  EXPECT_EQ(0, lex.Add(Seq{1, 2}));
+  EXPECT_EQ(1, lex.Add(Seq{2, 1}));
+  EXPECT_EQ(2, lex.Add(Seq{1}));
+  EXPECT_EQ(1, lex.Add(Seq{2, 1}));
+  EXPECT_EQ(0, lex.Add(Seq{1, 2}));
+  SequenceLexicon<int64, ConstantHasher> copy(lex);
+  EXPECT_EQ(2, copy.Add(Seq{1}));
+  EXPECT_EQ(3, copy.Add(Seq{2}));
+}
+
+TEST(SequenceLexicon, Merge) {
+  SequenceLexicon<int64> lex, other;
+  EXPECT_EQ(0, lex.Add(Seq{1, 2}));
+  EXPECT_EQ(0, other.Add(Seq{3}));
+  EXPECT_EQ(1, other.Add(Seq{1, 2}));
+  EXPECT_EQ(2, other.Add(Seq{}));
+  EXPECT_EQ((std::vector<uint32>{1, 0, 2}), lex.Merge(other));
+  EXPECT_EQ(3, lex.size());
+  ExpectSequence(Seq{3}, lex.sequence(1));
+  ExpectSequence(Seq{}, lex.sequence(2));
+}
@@ -31,8 +31,16 @@ Encoder::Encoder()
   : underlying_buffer_(&kEmptyBuffer) {
 }
 
+Encoder::Encoder(Sink* sink, size_t chunk_size)
+  : underlying_buffer_(&kEmptyBuffer),
+    sink_(sink),
+    chunk_size_(std::max<size_t>(chunk_size, 1)) {
+  S2_DCHECK(sink != nullptr);
+}
+
 Encoder::~Encoder() {
   S2_CHECK_LE(buf_, limit_);  // Catch the buffer overflow.
+  if (sink_ != nullptr) Flush();
   if (underlying_buffer_ != &kEmptyBuffer) {
     std::allocator<unsigned char>().deallocate(
         underlying_buffer_, limit_ - orig_);
@@ -47,14 +55,31 @@ int Encoder::varint64_length(uint64 v) {
   return Varint::Length64(v);
 }
 
+void Encoder::Flush() {
+  S2_DCHECK(has_sink());
+  const size_t current_len = buf_ - orig_;
+  if (current_len == 0) return;
+  sink_->Append(reinterpret_cast<const char*>(orig_), current_len);
+  flushed_ += current_len;
+  buf_ = orig_;
+}
+
 void Encoder::EnsureSlowPath(size_t N) {
   S2_CHECK(ensure_allowed());
   assert(avail() < N);
-  assert(length() == 0 || orig_ == underlying_buffer_);
+  assert(buf_ == orig_ || orig_ == underlying_buffer_);
 
+  if (sink_ != nullptr) {
+    // Pass the encoded data to the sink and reuse the buffer if possible.
+    Flush();
+    if (avail() >= N) return;
+  }
   // Double buffer size, but make sure we always have at least N extra bytes
-  const size_t current_len = length();
-  const size_t new_capacity = std::max(current_len + N, 2 * current_len);
+  // (or for sink encoders, allocate a single chunk of at least N bytes).
+  const size_t current_len = buf_ - orig_;
+  const size_t new_capacity =
+      (sink_ != nullptr) ? std::max(N, chunk_size_)
+                         : std::max(current_len + N, 2 * current_len);
 
   unsigned char* new_buffer = std::allocator<unsigned char>().allocate(
       new_capacity);
@@ -72,12 +97,13 @@ void Encoder::EnsureSlowPath(size_t N) {
 }
 
 void Encoder::RemoveLast(size_t N) {
-  S2_CHECK(length() >= N);
+  S2_CHECK(static_cast<size_t>(buf_ - orig_) >= N);
   buf_ -= N;
 }
 
 void Encoder::Resize(size_t N) {
   S2_CHECK(length() >= N);
-  buf_ = orig_ + N;
+  S2_CHECK(N >= flushed_);
+  buf_ = orig_ + (N - flushed_);
   assert(length() == N);
 }
@@ -46,6 +46,44 @@ class Encoder {
   void reset(void* buf, size_t maxn);
   void clear();
 
+  // An interface for consuming encoded data incrementally, e.g. by writing
+  // it to a file or stream:
+  //
+  //   class OstreamSink : public Encoder::Sink {
+  //    public:
+  //     explicit OstreamSink(std::ostream* os) : os_(os) {}
+  //     void Append(const char* data, size_t n) override {
+  //       os_->write(data, n);
+  //     }
+  //    private:
+  //     std::ostream* os_;
+  //   };
+  class Sink {
+   public:
+    virtual ~Sink() {}
+    virtual void Append(const char* data, size_t n) = 0;
+  };
+
+  // Creates an Encoder that passes its output to "sink" in chunks of about
+  // "chunk_size" bytes rather than keeping it in one contiguous buffer.
+  // Whenever Ensure(N) finds fewer than N bytes available, the encoded data
+  // is passed to the sink and the buffer is reused (it grows only if N
+  // exceeds "chunk_size").  Any remaining data is flushed by Flush() or the
+  // destructor.  The sink must outlive the Encoder.
+  //
+  // Sink encoders support all the put routines and Ensure().  length()
+  // returns the total number of bytes encoded, including those that have
+  // already been passed to the sink, but base(), RemoveLast() and Resize()
+  // only apply to the data that has not been flushed yet.
+  Encoder(Sink* sink, size_t chunk_size);
+
+  // Returns true if this Encoder passes its output to a Sink.
+  bool has_sink() const { return sink_ != nullptr; }
+
+  // REQUIRES: has_sink()
+  // Passes all encoded data that has not been flushed yet to the sink.
+  void Flush();
+
   // Encoding routines.  Note that these do not check bounds
   void put8(unsigned char v);
   void put16(uint16 v);
@@ -145,6 +183,11 @@ class Encoder {
 
   static unsigned char kEmptyBuffer;
 
+  // The sink (if any) and the number of bytes already passed to it.
+  Sink* sink_ = nullptr;
+  size_t chunk_size_ = 0;
+  size_t flushed_ = 0;
+
 #ifndef SWIG
   Encoder(Encoder const&) = delete;
   void operator=(Encoder const&) = delete;
@@ -186,6 +229,12 @@ class Decoder {
   bool get_varint32(uint32* v);
   bool get_varint64(uint64* v);
 
+  // Decodes "n" consecutive varints into "v", which must have room for "n"
+  // values.  This is faster than calling get_varint32/64 in a loop.  Returns
+  // false (without advancing) if the input is truncated or invalid.
+  bool get_varint32_array(uint32* v, int n);
+  bool get_varint64_array(uint64* v, int n);
+
   size_t pos() const;
   // Return number of bytes decoded so far
 
@@ -220,6 +269,8 @@ inline Encoder::Encoder(void* b, size_t maxn) :
 inline void Encoder::reset(void* b, size_t maxn) {
   orig_ = buf_ = reinterpret_cast<unsigned char*>(b);
   limit_ = orig_ + maxn;
+  sink_ = nullptr;
+  flushed_ = 0;
   // Can't use the underlying buffer anymore
   if (underlying_buffer_ != &kEmptyBuffer) {
     delete[] underlying_buffer_;
@@ -241,7 +292,7 @@ inline void Encoder::Ensure(size_t N) {
 inline size_t Encoder::length() const {
   S2_DCHECK_GE(buf_, orig_);
   S2_CHECK_LE(buf_, limit_);  // Catch the buffer overflow.
-  return buf_ - orig_;
+  return flushed_ + (buf_ - orig_);
 }
 
 inline size_t Encoder::avail() const {
@@ -550,4 +601,28 @@ inline bool Decoder::get_varint64(uint64* v) {
   return true;
 }
 
+inline bool Decoder::get_varint32_array(uint32* v, int n) {
+  if (n == 0) return true;  // "buf_" may be nullptr.
+  const char* const r = Varint::Parse32ArrayWithLimit(
+      reinterpret_cast<const char*>(buf_),
+      reinterpret_cast<const char*>(limit_), n, v);
+  if (r == nullptr) {
+    return false;
+  }
+  buf_ = reinterpret_cast<const unsigned char*>(r);
+  return true;
+}
+
+inline bool Decoder::get_varint64_array(uint64* v, int n) {
+  if (n == 0) return true;  // "buf_" may be nullptr.
+  const char* const r = Varint::Parse64ArrayWithLimit(
+      reinterpret_cast<const char*>(buf_),
+      reinterpret_cast<const char*>(limit_), n, v);
+  if (r == nullptr) {
+    return false;
+  }
+  buf_ = reinterpret_cast<const unsigned char*>(r);
+  return true;
+}
+
 #endif  // S2_UTIL_CODING_CODER_H_
@@ -0,0 +1,81 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/util/coding/mapped_file.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::shared_ptr;
+using std::string;
+
+#ifdef _WIN32
+
+shared_ptr<const MappedFile> MappedFile::Open(const string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return nullptr;
+  file.seekg(0, std::ios::end);
+  size_t size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  char* data = new char[size > 0 ? size : 1];
+  if (!file.read(data, size)) {
+    delete[] data;
+    return nullptr;
+  }
+  return shared_ptr<const MappedFile>(new MappedFile(data, size, false));
+}
+
+#else  // _WIN32
+
+shared_ptr<const MappedFile> MappedFile::Open(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = st.st_size;
+  if (size == 0) {
+    // mmap() does not allow empty mappings.
+    close(fd);
+    return shared_ptr<const MappedFile>(new MappedFile(nullptr, 0, false));
+  }
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file descriptor is closed.
+  close(fd);
+  if (data == MAP_FAILED) return nullptr;
+  return shared_ptr<const MappedFile>(
+      new MappedFile(static_cast<const char*>(data), size, true));
+}
+
+#endif  // _WIN32
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (is_mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+    return;
+  }
+#endif
+  delete[] data_;
+}
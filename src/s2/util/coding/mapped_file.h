@@ -0,0 +1,64 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+//
+// A read-only view of the contents of a file, suitable for constructing a
+// Decoder that reads encoded data in place.
+
+#ifndef S2_UTIL_CODING_MAPPED_FILE_H_
+#define S2_UTIL_CODING_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "s2/util/coding/coder.h"
+
+// MappedFile maps an entire file into memory read-only.  The pages are backed
+// directly by the operating system's page cache, so opening a file is fast
+// regardless of its size, data is only read from disk as it is accessed, and
+// several processes that map the same file share a single copy in memory.
+//
+// On platforms without mmap() support the file contents are instead read
+// into a heap-allocated buffer.
+class MappedFile {
+ public:
+  // Maps the file at the given path, returning nullptr on failure.  The
+  // result is shared so that objects that decode data in place (such as
+  // shape factories) can keep the mapping alive for as long as they need it.
+  static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+  ~MappedFile();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Returns a Decoder positioned at the start of the file.
+  Decoder decoder() const { return Decoder(data_, size_); }
+
+ private:
+  MappedFile(const char* data, size_t size, bool is_mapped)
+      : data_(data), size_(size), is_mapped_(is_mapped) {
+  }
+
+  const char* data_;
+  size_t size_;
+  bool is_mapped_;  // True if data_ must be unmapped rather than deleted.
+
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+};
+
+#endif  // S2_UTIL_CODING_MAPPED_FILE_H_
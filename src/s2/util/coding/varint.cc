@@ -19,6 +19,7 @@
 #include <string>
 
 #include "s2/third_party/absl/base/integral_types.h"
+#include "s2/util/endian/endian.h"
 
 #ifndef _MSC_VER
 const int Varint::kMax32;
@@ -385,3 +386,60 @@ const char* Varint::DecodeTwo32ValuesWithLimit(const char* ptr,
   }
   return DecodeTwo32ValuesInternal<true>(ptr, limit, a, b);
 }
+
+namespace {
+
+// Attempts to decode a varint of at most "max_len" bytes (where max_len <= 8)
+// from the 8 bytes starting at "ptr".  Returns the length of the varint, or
+// 0 if it is longer than "max_len" bytes.
+inline int ParseShortVarint(const char* ptr, int max_len, uint64* value) {
+  uint64 word = LittleEndian::Load64(ptr);
+  uint64 stop_bits = ~word & 0x8080808080808080ULL;
+  if (stop_bits == 0) return 0;
+  int len = (Bits::FindLSBSetNonZero64(stop_bits) >> 3) + 1;
+  if (len > max_len) return 0;
+
+  // Discard the bytes following the varint and the continuation bits, and
+  // then pack the 7-bit groups together: first into 14-bit groups in each
+  // 16-bit lane, then 28-bit groups in each 32-bit lane, and finally into a
+  // single 56-bit value.
+  uint64 x = word & (~uint64{0} >> (64 - 8 * len)) & 0x7f7f7f7f7f7f7f7fULL;
+  x = ((x & 0x7f007f007f007f00ULL) >> 1) | (x & 0x007f007f007f007fULL);
+  x = ((x & 0x3fff00003fff0000ULL) >> 2) | (x & 0x00003fff00003fffULL);
+  x = ((x & 0x0fffffff00000000ULL) >> 4) | (x & 0x000000000fffffffULL);
+  *value = x;
+  return len;
+}
+
+}  // namespace
+
+const char* Varint::Parse32ArrayWithLimit(const char* p, const char* limit,
+                                          int n, uint32* out) {
+  for (int i = 0; i < n; ++i) {
+    uint64 value;
+    int len;
+    // Varints of up to 4 bytes always fit in 32 bits.
+    if (limit - p >= 8 && (len = ParseShortVarint(p, 4, &value)) > 0) {
+      out[i] = value;
+      p += len;
+    } else {
+      p = Parse32WithLimit(p, limit, &out[i]);
+      if (p == nullptr) return nullptr;
+    }
+  }
+  return p;
+}
+
+const char* Varint::Parse64ArrayWithLimit(const char* p, const char* limit,
+                                          int n, uint64* out) {
+  for (int i = 0; i < n; ++i) {
+    int len;
+    if (limit - p >= 8 && (len = ParseShortVarint(p, 8, &out[i])) > 0) {
+      p += len;
+    } else {
+      p = Parse64WithLimit(p, limit, &out[i]);
+      if (p == nullptr) return nullptr;
+    }
+  }
+  return p;
+}
@@ -148,6 +148,19 @@ class Varint {
   //            "out" stores the actual sum.
   static const char* FastDecodeDeltas(const char* ptr, int64 goal, int64* out);
 
+  // Decode "n" consecutive varints into "out".  Whenever at least 8 bytes of
+  // input remain, each varint of up to 8 bytes is decoded using a single
+  // 8-byte load and a fixed sequence of masks and shifts, so the cost does
+  // not depend on the varint lengths (which are typically unpredictable).
+  // Longer varints are decoded using the ParseXXWithLimit routines.
+  // REQUIRES   "out" has room for "n" values.
+  // EFFECTS    Returns a pointer just past the last byte read, or nullptr if
+  //            input beyond "limit" would be read or a varint is invalid.
+  static const char* Parse32ArrayWithLimit(const char* ptr, const char* limit,
+                                           int n, uint32* out);
+  static const char* Parse64ArrayWithLimit(const char* ptr, const char* limit,
+                                           int n, uint64* out);
+
  private:
   static const char* Parse32FallbackInline(const char* p, uint32* val);
   static const char* Parse32Fallback(const char* p, uint32* val);
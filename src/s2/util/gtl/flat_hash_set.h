@@ -0,0 +1,507 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+// gtl::flat_hash_set is an open-addressing hash set in the style of
+// "SwissTable".  In addition to the array of slots, it keeps one byte of
+// metadata per slot that records whether the slot is empty, deleted, or
+// full, and in the latter case holds 7 bits of the element's hash.  Lookups
+// examine the metadata for a group of 16 consecutive slots at once (using
+// SSE2 when available), so that the slots themselves are only touched when
+// their metadata matches.  A lookup therefore usually costs one cache miss
+// for the metadata and one for the matching slot, even in a heavily loaded
+// table.
+//
+// Unlike gtl::dense_hash_set, no empty or deleted key needs to be reserved.
+// Elements are not stable: insertions may move all elements, which
+// invalidates all iterators, pointers, and references into the set.
+//
+// Example usage:
+//
+//   gtl::flat_hash_set<ShapeEdgeId, ShapeEdgeIdHash> tested;
+//   if (tested.insert(id).second) { ... }
+
+#ifndef S2_UTIL_GTL_FLAT_HASH_SET_H_
+#define S2_UTIL_GTL_FLAT_HASH_SET_H_
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "s2/third_party/absl/base/integral_types.h"
+#include "s2/base/logging.h"
+#include "s2/util/bits/bits.h"
+
+namespace gtl {
+
+namespace internal_flat_hash_set {
+
+// Metadata values.  Full slots store the low 7 bits of their hash, which are
+// non-negative; empty and deleted slots are negative.
+using ctrl_t = int8;
+static const ctrl_t kEmpty = -128;
+static const ctrl_t kDeleted = -2;
+
+// A set of slot positions within a group, one bit per slot.
+class BitMask {
+ public:
+  explicit BitMask(uint32 mask) : mask_(mask) {}
+  explicit operator bool() const { return mask_ != 0; }
+
+  // Returns the lowest position in the set.  REQUIRES: the set is not empty.
+  int Lowest() const { return Bits::FindLSBSetNonZero(mask_); }
+
+  // Removes the lowest position from the set.
+  void ClearLowest() { mask_ &= mask_ - 1; }
+
+ private:
+  uint32 mask_;
+};
+
+// The metadata of a group of kWidth consecutive slots.
+class Group {
+ public:
+  static const int kWidth = 16;
+
+  explicit Group(const ctrl_t* ctrl) {
+#ifdef __SSE2__
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+    std::memcpy(ctrl_, ctrl, kWidth);
+#endif
+  }
+
+  // Returns the positions of the full slots whose metadata equals "h2".
+  BitMask Match(ctrl_t h2) const {
+#ifdef __SSE2__
+    return BitMask(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2),
+                                                    ctrl_)));
+#else
+    uint32 mask = 0;
+    for (int i = 0; i < kWidth; ++i) mask |= uint32{ctrl_[i] == h2} << i;
+    return BitMask(mask);
+#endif
+  }
+
+  // Returns the positions of the empty slots.
+  BitMask MatchEmpty() const { return Match(kEmpty); }
+
+  // Returns the positions of the empty and deleted slots.
+  BitMask MatchEmptyOrDeleted() const {
+#ifdef __SSE2__
+    // The sign bits are set exactly for the empty and deleted slots.
+    return BitMask(_mm_movemask_epi8(ctrl_));
+#else
+    uint32 mask = 0;
+    for (int i = 0; i < kWidth; ++i) mask |= uint32{ctrl_[i] < 0} << i;
+    return BitMask(mask);
+#endif
+  }
+
+ private:
+#ifdef __SSE2__
+  __m128i ctrl_;
+#else
+  ctrl_t ctrl_[kWidth];
+#endif
+};
+
+}  // namespace internal_flat_hash_set
+
+template <class Key, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class flat_hash_set {
+  using ctrl_t = internal_flat_hash_set::ctrl_t;
+  using Group = internal_flat_hash_set::Group;
+  using BitMask = internal_flat_hash_set::BitMask;
+
+ public:
+  using key_type = Key;
+  using value_type = Key;
+  using size_type = size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Key*;
+    using reference = const Key&;
+
+    const_iterator() : set_(nullptr), pos_(0) {}
+    reference operator*() const { return set_->slots_[pos_]; }
+    pointer operator->() const { return &set_->slots_[pos_]; }
+    const_iterator& operator++() {
+      ++pos_;
+      SkipUnused();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const const_iterator& x) const { return pos_ == x.pos_; }
+    bool operator!=(const const_iterator& x) const { return pos_ != x.pos_; }
+
+   private:
+    friend class flat_hash_set;
+    const_iterator(const flat_hash_set* set, size_type pos)
+        : set_(set), pos_(pos) {}
+    void SkipUnused() {
+      while (pos_ < set_->capacity_ && set_->ctrl_[pos_] < 0) ++pos_;
+    }
+
+    const flat_hash_set* set_;
+    size_type pos_;
+  };
+  using iterator = const_iterator;
+
+  // Constructs a set that can hold "expected_max_elements" elements without
+  // being resized.
+  explicit flat_hash_set(size_type expected_max_elements = 0,
+                         const Hash& hash = Hash(),
+                         const KeyEqual& eq = KeyEqual());
+  flat_hash_set(const flat_hash_set& x);
+  flat_hash_set(flat_hash_set&& x);
+  flat_hash_set& operator=(const flat_hash_set& x);
+  flat_hash_set& operator=(flat_hash_set&& x);
+  ~flat_hash_set();
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns the number of slots, which is always a multiple of Group::kWidth.
+  size_type bucket_count() const { return capacity_; }
+
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    if (capacity_ > 0) it.SkipUnused();
+    return it;
+  }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+
+  // Inserts "key" if it is not already present.  Returns an iterator to the
+  // element equal to "key" and whether an insertion took place.
+  std::pair<iterator, bool> insert(const Key& key);
+
+  const_iterator find(const Key& key) const;
+  size_type count(const Key& key) const { return find(key) != end(); }
+
+  // Removes the element equal to "key", if any, and returns the number of
+  // elements removed.
+  size_type erase(const Key& key);
+
+  // Removes all elements and releases the storage.
+  void clear();
+
+  // Removes all elements but keeps the storage, which is faster when the set
+  // is about to be refilled with a similar number of elements.
+  void clear_no_resize();
+
+  // Ensures that "n" elements can be held without resizing.
+  void reserve(size_type n);
+
+  void swap(flat_hash_set& x);
+
+  hasher hash_funct() const { return hash_; }
+  key_equal key_eq() const { return eq_; }
+
+ private:
+  // Returns the hash of "key".  The hash function is followed by a
+  // multiplicative mixing step, since the metadata uses the low bits of the
+  // hash and many hash functions (e.g. std::hash<int64>) are the identity.
+  size_t HashOf(const Key& key) const {
+    uint64 h = static_cast<uint64>(hash_(key)) * 0x9ddfea08eb382d69ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+  static ctrl_t H2(size_t hash) { return hash & 0x7f; }
+  static size_t H1(size_t hash) { return hash >> 7; }
+
+  // Returns the position of the element equal to "key", or capacity_.
+  size_type FindPos(const Key& key, size_t hash) const;
+
+  // Returns the first empty or deleted position in the probe sequence of
+  // "hash".  REQUIRES: capacity_ > 0.
+  size_type FindInsertPos(size_t hash) const;
+
+  // The maximum number of elements for a given capacity (a load factor of
+  // 7/8).
+  static size_type MaxSize(size_type capacity) {
+    return capacity - capacity / 8;
+  }
+
+  void SetCtrl(size_type pos, ctrl_t h) { ctrl_[pos] = h; }
+  void Rehash(size_type new_capacity);
+  void DestroySlots();
+  void Deallocate();
+  void CopyFrom(const flat_hash_set& x);
+
+  Hash hash_;
+  KeyEqual eq_;
+  ctrl_t* ctrl_ = nullptr;
+  Key* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+
+  // The number of elements that can be inserted into empty slots before the
+  // table must be rehashed.  Deleted slots do not count towards this.
+  size_type growth_left_ = 0;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>::flat_hash_set(
+    size_type expected_max_elements, const Hash& hash, const KeyEqual& eq)
+    : hash_(hash), eq_(eq) {
+  reserve(expected_max_elements);
+}
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>::flat_hash_set(const flat_hash_set& x)
+    : hash_(x.hash_), eq_(x.eq_) {
+  CopyFrom(x);
+}
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>::flat_hash_set(flat_hash_set&& x)
+    : hash_(x.hash_), eq_(x.eq_), ctrl_(x.ctrl_), slots_(x.slots_),
+      capacity_(x.capacity_), size_(x.size_), growth_left_(x.growth_left_) {
+  x.ctrl_ = nullptr;
+  x.slots_ = nullptr;
+  x.capacity_ = x.size_ = x.growth_left_ = 0;
+}
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>&
+flat_hash_set<Key, Hash, KeyEqual>::operator=(const flat_hash_set& x) {
+  if (this != &x) {
+    clear();
+    hash_ = x.hash_;
+    eq_ = x.eq_;
+    CopyFrom(x);
+  }
+  return *this;
+}
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>&
+flat_hash_set<Key, Hash, KeyEqual>::operator=(flat_hash_set&& x) {
+  flat_hash_set tmp(std::move(x));
+  swap(tmp);
+  return *this;
+}
+
+template <class Key, class Hash, class KeyEqual>
+flat_hash_set<Key, Hash, KeyEqual>::~flat_hash_set() {
+  clear();
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::CopyFrom(const flat_hash_set& x) {
+  reserve(x.size());
+  for (const Key& key : x) {
+    size_t hash = HashOf(key);
+    size_type pos = FindInsertPos(hash);
+    new (&slots_[pos]) Key(key);
+    SetCtrl(pos, H2(hash));
+  }
+  size_ = x.size();
+  growth_left_ -= x.size();
+}
+
+template <class Key, class Hash, class KeyEqual>
+typename flat_hash_set<Key, Hash, KeyEqual>::size_type
+flat_hash_set<Key, Hash, KeyEqual>::FindPos(const Key& key,
+                                            size_t hash) const {
+  if (capacity_ == 0) return capacity_;
+  // Groups are probed using triangular numbers, which visits every group
+  // since the number of groups is a power of two.
+  const size_type group_mask = capacity_ / Group::kWidth - 1;
+  const ctrl_t h2 = H2(hash);
+  size_type g = H1(hash) & group_mask;
+  for (size_type step = 1; ; ++step) {
+    const size_type base = g * Group::kWidth;
+    Group group(ctrl_ + base);
+    for (BitMask match = group.Match(h2); match; match.ClearLowest()) {
+      size_type pos = base + match.Lowest();
+      if (eq_(slots_[pos], key)) return pos;
+    }
+    if (group.MatchEmpty()) return capacity_;
+    if (step > group_mask) return capacity_;
+    g = (g + step) & group_mask;
+  }
+}
+
+template <class Key, class Hash, class KeyEqual>
+typename flat_hash_set<Key, Hash, KeyEqual>::size_type
+flat_hash_set<Key, Hash, KeyEqual>::FindInsertPos(size_t hash) const {
+  const size_type group_mask = capacity_ / Group::kWidth - 1;
+  size_type g = H1(hash) & group_mask;
+  for (size_type step = 1; ; ++step) {
+    const size_type base = g * Group::kWidth;
+    BitMask mask = Group(ctrl_ + base).MatchEmptyOrDeleted();
+    if (mask) return base + mask.Lowest();
+    S2_DCHECK_LE(step, group_mask);
+    g = (g + step) & group_mask;
+  }
+}
+
+template <class Key, class Hash, class KeyEqual>
+std::pair<typename flat_hash_set<Key, Hash, KeyEqual>::iterator, bool>
+flat_hash_set<Key, Hash, KeyEqual>::insert(const Key& key) {
+  size_t hash = HashOf(key);
+  size_type pos = FindPos(key, hash);
+  if (pos != capacity_) return std::make_pair(iterator(this, pos), false);
+  if (growth_left_ == 0) {
+    // Reclaim the deleted slots if they make up at least half of the
+    // table's capacity limit, otherwise double the capacity.
+    size_type new_capacity = capacity_;
+    if (capacity_ == 0 || size_ >= MaxSize(capacity_) / 2) {
+      new_capacity = capacity_ == 0 ? Group::kWidth : 2 * capacity_;
+    }
+    Rehash(new_capacity);
+  }
+  pos = FindInsertPos(hash);
+  if (ctrl_[pos] == internal_flat_hash_set::kEmpty) --growth_left_;
+  new (&slots_[pos]) Key(key);
+  SetCtrl(pos, H2(hash));
+  ++size_;
+  return std::make_pair(iterator(this, pos), true);
+}
+
+template <class Key, class Hash, class KeyEqual>
+typename flat_hash_set<Key, Hash, KeyEqual>::const_iterator
+flat_hash_set<Key, Hash, KeyEqual>::find(const Key& key) const {
+  return const_iterator(this, FindPos(key, HashOf(key)));
+}
+
+template <class Key, class Hash, class KeyEqual>
+typename flat_hash_set<Key, Hash, KeyEqual>::size_type
+flat_hash_set<Key, Hash, KeyEqual>::erase(const Key& key) {
+  size_type pos = FindPos(key, HashOf(key));
+  if (pos == capacity_) return 0;
+  slots_[pos].~Key();
+  --size_;
+  // A slot can only be marked empty if its group already has an empty slot,
+  // since otherwise probe sequences that continue past this group would be
+  // cut short.
+  size_type base = pos - pos % Group::kWidth;
+  if (Group(ctrl_ + base).MatchEmpty()) {
+    SetCtrl(pos, internal_flat_hash_set::kEmpty);
+    ++growth_left_;
+  } else {
+    SetCtrl(pos, internal_flat_hash_set::kDeleted);
+  }
+  return 1;
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::DestroySlots() {
+  if (std::is_trivially_destructible<Key>::value) return;
+  for (size_type pos = 0; pos < capacity_; ++pos) {
+    if (ctrl_[pos] >= 0) slots_[pos].~Key();
+  }
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::Deallocate() {
+  std::allocator<Key>().deallocate(slots_, capacity_);
+  delete[] ctrl_;
+  ctrl_ = nullptr;
+  slots_ = nullptr;
+  capacity_ = 0;
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::clear() {
+  if (capacity_ == 0) return;
+  DestroySlots();
+  Deallocate();
+  size_ = growth_left_ = 0;
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::clear_no_resize() {
+  if (capacity_ == 0) return;
+  if (size_ > 0) DestroySlots();
+  std::memset(ctrl_, internal_flat_hash_set::kEmpty, capacity_);
+  size_ = 0;
+  growth_left_ = MaxSize(capacity_);
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::reserve(size_type n) {
+  if (n <= size_ + growth_left_) return;
+  size_type new_capacity = Group::kWidth;
+  while (MaxSize(new_capacity) < n) new_capacity *= 2;
+  Rehash(new_capacity);
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::Rehash(size_type new_capacity) {
+  S2_DCHECK_EQ(0, new_capacity % Group::kWidth);
+  ctrl_t* old_ctrl = ctrl_;
+  Key* old_slots = slots_;
+  size_type old_capacity = capacity_;
+  ctrl_ = new ctrl_t[new_capacity];
+  std::memset(ctrl_, internal_flat_hash_set::kEmpty, new_capacity);
+  slots_ = std::allocator<Key>().allocate(new_capacity);
+  capacity_ = new_capacity;
+  for (size_type i = 0; i < old_capacity; ++i) {
+    if (old_ctrl[i] < 0) continue;
+    size_t hash = HashOf(old_slots[i]);
+    size_type pos = FindInsertPos(hash);
+    new (&slots_[pos]) Key(std::move(old_slots[i]));
+    old_slots[i].~Key();
+    SetCtrl(pos, H2(hash));
+  }
+  growth_left_ = MaxSize(capacity_) - size_;
+  if (old_capacity > 0) {
+    std::allocator<Key>().deallocate(old_slots, old_capacity);
+    delete[] old_ctrl;
+  }
+}
+
+template <class Key, class Hash, class KeyEqual>
+void flat_hash_set<Key, Hash, KeyEqual>::swap(flat_hash_set& x) {
+  using std::swap;
+  swap(hash_, x.hash_);
+  swap(eq_, x.eq_);
+  swap(ctrl_, x.ctrl_);
+  swap(slots_, x.slots_);
+  swap(capacity_, x.capacity_);
+  swap(size_, x.size_);
+  swap(growth_left_, x.growth_left_);
+}
+
+}  // namespace gtl
+
+#endif  // S2_UTIL_GTL_FLAT_HASH_SET_H_
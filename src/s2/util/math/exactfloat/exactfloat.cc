@@ -31,6 +31,8 @@
 #include "s2/third_party/absl/base/integral_types.h"
 #include "s2/third_party/absl/base/macros.h"
 #include "s2/third_party/absl/container/fixed_array.h"
+#include "s2/third_party/absl/numeric/int128.h"
+#include "s2/util/bits/bits.h"
 
 using std::max;
 using std::min;
@@ -39,6 +41,7 @@ using std::min;
 const int ExactFloat::kMinExp;
 const int ExactFloat::kMaxExp;
 const int ExactFloat::kMaxPrec;
+const int ExactFloat::kMaxInlinePrec;
 const int32 ExactFloat::kExpNaN;
 const int32 ExactFloat::kExpInfinity;
 const int32 ExactFloat::kExpZero;
@@ -53,61 +56,19 @@ static_assert(
     ExactFloat::kMinExp - ExactFloat::kMaxPrec >= INT_MIN / 2,
     "exactfloat exponent might overflow");
 
-// We define a few simple extensions to the OpenSSL's BIGNUM interface.
-// In some cases these depend on BIGNUM internal fields, so they might
-// require tweaking if the BIGNUM implementation changes significantly.
-// These are just thin wrappers for BoringSSL.
+// We define a simple extension to the OpenSSL's BIGNUM interface.  In some
+// cases it depends on BIGNUM internal fields, so it might require tweaking if
+// the BIGNUM implementation changes significantly.  It is just a thin
+// wrapper for BoringSSL.
 
 #ifdef OPENSSL_IS_BORINGSSL
 
-inline static void BN_ext_set_uint64(BIGNUM* bn, uint64 v) {
-  S2_CHECK(BN_set_u64(bn, v));
-}
-
-// Return the absolute value of a BIGNUM as a 64-bit unsigned integer.
-// Requires that BIGNUM fits into 64 bits.
-inline static uint64 BN_ext_get_uint64(const BIGNUM* bn) {
-  uint64_t u64;
-  if (!BN_get_u64(bn, &u64)) {
-    S2_DCHECK(false) << "BN has " << BN_num_bits(bn) << " bits";
-    return 0;
-  }
-  return u64;
-}
-
 static int BN_ext_count_low_zero_bits(const BIGNUM* bn) {
   return BN_count_low_zero_bits(bn);
 }
 
 #else  // !defined(OPENSSL_IS_BORINGSSL)
 
-// Set a BIGNUM to the given unsigned 64-bit value.
-inline static void BN_ext_set_uint64(BIGNUM* bn, uint64 v) {
-#if BN_BITS2 == 64
-  S2_CHECK(BN_set_word(bn, v));
-#else
-  static_assert(BN_BITS2 == 32, "at least 32 bit openssl build needed");
-  S2_CHECK(BN_set_word(bn, static_cast<uint32>(v >> 32)));
-  S2_CHECK(BN_lshift(bn, bn, 32));
-  S2_CHECK(BN_add_word(bn, static_cast<uint32>(v)));
-#endif
-}
-
-// Return the absolute value of a BIGNUM as a 64-bit unsigned integer.
-// Requires that BIGNUM fits into 64 bits.
-inline static uint64 BN_ext_get_uint64(const BIGNUM* bn) {
-  S2_DCHECK_LE(BN_num_bytes(bn), sizeof(uint64));
-#if BN_BITS2 == 64
-  return BN_get_word(bn);
-#else
-  static_assert(BN_BITS2 == 32, "at least 32 bit openssl build needed");
-  if (bn->top == 0) return 0;
-  if (bn->top == 1) return BN_get_word(bn);
-  S2_DCHECK_EQ(bn->top, 2);
-  return (static_cast<uint64>(bn->d[1]) << 32) + bn->d[0];
-#endif
-}
-
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
 
 // Count the number of low-order zero bits in the given BIGNUM (ignoring its
@@ -156,6 +117,303 @@ static int BN_ext_count_low_zero_bits(const BIGNUM* bn) {
 
 #endif  // !defined(OPENSSL_IS_BORINGSSL)
 
+ExactFloat::Mantissa::Mantissa(const Mantissa& b)
+    : size_(b.size_), is_big_(false) {
+  memcpy(words_, b.words_, size_ * sizeof(words_[0]));
+  if (b.is_big_) {
+    S2_CHECK(BN_copy(big(), b.big_->get()));
+    is_big_ = true;
+  }
+}
+
+ExactFloat::Mantissa& ExactFloat::Mantissa::operator=(const Mantissa& b) {
+  if (this != &b) {
+    size_ = b.size_;
+    memcpy(words_, b.words_, size_ * sizeof(words_[0]));
+    is_big_ = false;
+    if (b.is_big_) {
+      S2_CHECK(BN_copy(big(), b.big_->get()));
+      is_big_ = true;
+    }
+  }
+  return *this;
+}
+
+bool ExactFloat::Mantissa::is_zero() const {
+  return is_big_ ? BN_is_zero(big_->get()) : size_ == 0;
+}
+
+bool ExactFloat::Mantissa::is_odd() const {
+  return is_big_ ? BN_is_odd(big_->get()) : size_ > 0 && (words_[0] & 1);
+}
+
+int ExactFloat::Mantissa::num_bits() const {
+  if (is_big_) return BN_num_bits(big_->get());
+  if (size_ == 0) return 0;
+  return 64 * (size_ - 1) + Bits::FindMSBSetNonZero64(words_[size_ - 1]) + 1;
+}
+
+int ExactFloat::Mantissa::count_low_zero_bits() const {
+  if (is_big_) return BN_ext_count_low_zero_bits(big_->get());
+  for (int i = 0; i < size_; ++i) {
+    if (words_[i] != 0) {
+      return 64 * i + Bits::FindLSBSetNonZero64(words_[i]);
+    }
+  }
+  return 0;
+}
+
+bool ExactFloat::Mantissa::is_bit_set(int n) const {
+  if (is_big_) return BN_is_bit_set(big_->get(), n);
+  return n / 64 < size_ && ((words_[n / 64] >> (n % 64)) & 1);
+}
+
+uint64 ExactFloat::Mantissa::get_uint64() const {
+  // Values this small are always stored inline.
+  S2_DCHECK(!is_big_ && size_ <= 1);
+  return (size_ == 0) ? 0 : words_[0];
+}
+
+void ExactFloat::Mantissa::set_zero() {
+  size_ = 0;
+  is_big_ = false;
+}
+
+void ExactFloat::Mantissa::set_uint64(uint64 v) {
+  words_[0] = v;
+  size_ = (v != 0);
+  is_big_ = false;
+}
+
+void ExactFloat::Mantissa::ToBIGNUM(BIGNUM* bn) const {
+  if (is_big_) {
+    S2_CHECK(BN_copy(bn, big_->get()));
+    return;
+  }
+  // Convert the words to big-endian bytes, since this format is supported by
+  // all versions of OpenSSL.
+  unsigned char bytes[8 * kMaxWords];
+  for (int i = 0; i < size_; ++i) {
+    uint64 w = words_[size_ - 1 - i];
+    for (int j = 0; j < 8; ++j) {
+      bytes[8 * i + j] = static_cast<unsigned char>(w >> (56 - 8 * j));
+    }
+  }
+  S2_CHECK(BN_bin2bn(bytes, 8 * size_, bn));
+}
+
+const BIGNUM* ExactFloat::Mantissa::GetBIGNUM(const Mantissa& a,
+                                              BigNum* tmp) {
+  if (a.is_big_) return a.big_->get();
+  a.ToBIGNUM(tmp->get());
+  return tmp->get();
+}
+
+BIGNUM* ExactFloat::Mantissa::big() {
+  if (big_ == nullptr) big_.reset(new BigNum);
+  return big_->get();
+}
+
+void ExactFloat::Mantissa::SetBig() {
+  const BIGNUM* bn = big_->get();
+  int num_bytes = BN_num_bytes(bn);
+  if (num_bytes > 8 * kMaxWords) {
+    is_big_ = true;
+    return;
+  }
+  unsigned char bytes[8 * kMaxWords];
+  BN_bn2bin(bn, bytes);
+  size_ = (num_bytes + 7) / 8;
+  for (int i = 0; i < size_; ++i) words_[i] = 0;
+  for (int i = 0; i < num_bytes; ++i) {
+    int k = num_bytes - 1 - i;  // Byte position, starting from the low end.
+    words_[k / 8] |= static_cast<uint64>(bytes[i]) << (8 * (k % 8));
+  }
+  is_big_ = false;
+}
+
+void ExactFloat::Mantissa::Trim() {
+  while (size_ > 0 && words_[size_ - 1] == 0) --size_;
+}
+
+int ExactFloat::Mantissa::Compare(const Mantissa& a, const Mantissa& b) {
+  if (a.is_big_ || b.is_big_) {
+    BigNum a_tmp, b_tmp;
+    return BN_ucmp(GetBIGNUM(a, &a_tmp), GetBIGNUM(b, &b_tmp));
+  }
+  if (a.size_ != b.size_) return (a.size_ < b.size_) ? -1 : 1;
+  for (int i = a.size_ - 1; i >= 0; --i) {
+    if (a.words_[i] != b.words_[i]) {
+      return (a.words_[i] < b.words_[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+void ExactFloat::Mantissa::LeftShift(const Mantissa& a, int n) {
+  S2_DCHECK_GE(n, 0);
+  if (a.is_zero()) {
+    set_zero();
+    return;
+  }
+  int bits = a.num_bits() + n;
+  if (a.is_big_ || bits > kMaxInlinePrec) {
+    BigNum tmp;
+    const BIGNUM* bn = GetBIGNUM(a, &tmp);
+    S2_CHECK(BN_lshift(big(), bn, n));
+    SetBig();
+    return;
+  }
+  // Words are processed from high to low so that "a" may be this object.
+  int word_shift = n / 64, bit_shift = n % 64;
+  int a_size = a.size_;
+  size_ = (bits + 63) / 64;
+  for (int i = size_ - 1; i >= 0; --i) {
+    int j = i - word_shift;
+    uint64 w = (j >= 0 && j < a_size) ? a.words_[j] << bit_shift : 0;
+    if (bit_shift > 0 && j >= 1 && j - 1 < a_size) {
+      w |= a.words_[j - 1] >> (64 - bit_shift);
+    }
+    words_[i] = w;
+  }
+  is_big_ = false;
+}
+
+void ExactFloat::Mantissa::RightShift(const Mantissa& a, int n) {
+  S2_DCHECK_GE(n, 0);
+  if (a.is_big_) {
+    S2_CHECK(BN_rshift(big(), a.big_->get(), n));
+    SetBig();
+    return;
+  }
+  // Words are processed from low to high so that "a" may be this object.
+  int word_shift = n / 64, bit_shift = n % 64;
+  int a_size = a.size_;
+  size_ = max(0, a_size - word_shift);
+  for (int i = 0; i < size_; ++i) {
+    int j = i + word_shift;
+    uint64 w = a.words_[j] >> bit_shift;
+    if (bit_shift > 0 && j + 1 < a_size) {
+      w |= a.words_[j + 1] << (64 - bit_shift);
+    }
+    words_[i] = w;
+  }
+  is_big_ = false;
+  Trim();
+}
+
+void ExactFloat::Mantissa::Increment() {
+  if (!is_big_) {
+    for (int i = 0; i < size_; ++i) {
+      if (++words_[i] != 0) return;
+    }
+    if (size_ < kMaxWords) {
+      words_[size_++] = 1;
+      return;
+    }
+    // The value is 2**kMaxInlinePrec - 1, which is stored in a BIGNUM
+    // below before incrementing it.
+    ToBIGNUM(big());
+  }
+  S2_CHECK(BN_add_word(big(), 1));
+  SetBig();
+}
+
+void ExactFloat::Mantissa::Add(const Mantissa& a, const Mantissa& b) {
+  if (!a.is_big_ && !b.is_big_) {
+    int n = max(a.size_, b.size_);
+    uint64 sum[kMaxWords + 1];
+    uint64 carry = 0;
+    for (int i = 0; i < n; ++i) {
+      uint64 x = (i < a.size_) ? a.words_[i] : 0;
+      uint64 y = (i < b.size_) ? b.words_[i] : 0;
+      uint64 s = x + y;
+      uint64 c = (s < x);
+      sum[i] = s + carry;
+      carry = c + (sum[i] < s);
+    }
+    sum[n] = carry;
+    if (n + carry <= kMaxWords) {
+      size_ = n + carry;
+      memcpy(words_, sum, size_ * sizeof(sum[0]));
+      is_big_ = false;
+      return;
+    }
+  }
+  BigNum a_tmp, b_tmp;
+  const BIGNUM* a_bn = GetBIGNUM(a, &a_tmp);
+  const BIGNUM* b_bn = GetBIGNUM(b, &b_tmp);
+  S2_CHECK(BN_add(big(), a_bn, b_bn));
+  SetBig();
+}
+
+int ExactFloat::Mantissa::Subtract(const Mantissa& a, const Mantissa& b) {
+  int sign = Compare(a, b);
+  const Mantissa* x = &a;
+  const Mantissa* y = &b;
+  if (sign < 0) std::swap(x, y);
+  if (!x->is_big_ && !y->is_big_) {
+    // Since x >= y, "y" is also inline.
+    uint64 borrow = 0;
+    int x_size = x->size_, y_size = y->size_;
+    for (int i = 0; i < x_size; ++i) {
+      uint64 xi = x->words_[i];
+      uint64 yi = (i < y_size) ? y->words_[i] : 0;
+      uint64 d = xi - yi;
+      uint64 b1 = (xi < yi);
+      words_[i] = d - borrow;
+      borrow = b1 + (d < borrow);
+    }
+    S2_DCHECK_EQ(borrow, 0);
+    size_ = x_size;
+    is_big_ = false;
+    Trim();
+    return sign;
+  }
+  BigNum x_tmp, y_tmp;
+  const BIGNUM* x_bn = GetBIGNUM(*x, &x_tmp);
+  const BIGNUM* y_bn = GetBIGNUM(*y, &y_tmp);
+  S2_CHECK(BN_sub(big(), x_bn, y_bn));
+  SetBig();
+  return sign;
+}
+
+void ExactFloat::Mantissa::Multiply(const Mantissa& a, const Mantissa& b) {
+  if (a.is_zero() || b.is_zero()) {
+    set_zero();
+    return;
+  }
+  if (!a.is_big_ && !b.is_big_ && a.size_ + b.size_ <= kMaxWords) {
+    // Schoolbook multiplication.  The product of two words plus two more
+    // words always fits in 128 bits.
+    uint64 product[kMaxWords];
+    int n = a.size_ + b.size_;
+    for (int i = 0; i < n; ++i) product[i] = 0;
+    for (int i = 0; i < a.size_; ++i) {
+      uint64 carry = 0;
+      for (int j = 0; j < b.size_; ++j) {
+        absl::uint128 t = absl::uint128(a.words_[i]) * b.words_[j] +
+                          product[i + j] + carry;
+        product[i + j] = absl::Uint128Low64(t);
+        carry = absl::Uint128High64(t);
+      }
+      product[i + b.size_] = carry;
+    }
+    size_ = n;
+    memcpy(words_, product, n * sizeof(product[0]));
+    is_big_ = false;
+    Trim();
+    return;
+  }
+  BigNum a_tmp, b_tmp;
+  const BIGNUM* a_bn = GetBIGNUM(a, &a_tmp);
+  const BIGNUM* b_bn = GetBIGNUM(b, &b_tmp);
+  BN_CTX* ctx = BN_CTX_new();
+  S2_CHECK(BN_mul(big(), a_bn, b_bn, ctx));
+  BN_CTX_free(ctx);
+  SetBig();
+}
+
 ExactFloat::ExactFloat(double v) {
   sign_ = std::signbit(v) ? -1 : 1;
   if (std::isnan(v)) {
@@ -172,7 +430,7 @@ ExactFloat::ExactFloat(double v) {
     int exp;
     double f = frexp(fabs(v), &exp);
     uint64 m = static_cast<uint64>(ldexp(f, kDoubleMantissaBits));
-    BN_ext_set_uint64(bn_.get(), m);
+    bn_.set_uint64(m);
     bn_exp_ = exp - kDoubleMantissaBits;
     Canonicalize();
   }
@@ -180,17 +438,17 @@ ExactFloat::ExactFloat(double v) {
 
 ExactFloat::ExactFloat(int v) {
   sign_ = (v >= 0) ? 1 : -1;
-  // Note that this works even for INT_MIN because the parameter type for
-  // BN_set_word() is unsigned.
-  S2_CHECK(BN_set_word(bn_.get(), abs(v)));
+  // Note that this works even for INT_MIN because the absolute value is
+  // computed using 64-bit integers.
+  bn_.set_uint64(std::abs(static_cast<int64>(v)));
   bn_exp_ = 0;
   Canonicalize();
 }
 
 ExactFloat::ExactFloat(const ExactFloat& b)
     : sign_(b.sign_),
-      bn_exp_(b.bn_exp_) {
-  BN_copy(bn_.get(), b.bn_.get());
+      bn_exp_(b.bn_exp_),
+      bn_(b.bn_) {
 }
 
 ExactFloat ExactFloat::SignedZero(int sign) {
@@ -212,30 +470,30 @@ ExactFloat ExactFloat::NaN() {
 }
 
 int ExactFloat::prec() const {
-  return BN_num_bits(bn_.get());
+  return bn_.num_bits();
 }
 
 int ExactFloat::exp() const {
   S2_DCHECK(is_normal());
-  return bn_exp_ + BN_num_bits(bn_.get());
+  return bn_exp_ + bn_.num_bits();
 }
 
 void ExactFloat::set_zero(int sign) {
   sign_ = sign;
   bn_exp_ = kExpZero;
-  if (!BN_is_zero(bn_.get())) BN_zero(bn_.get());
+  bn_.set_zero();
 }
 
 void ExactFloat::set_inf(int sign) {
   sign_ = sign;
   bn_exp_ = kExpInfinity;
-  if (!BN_is_zero(bn_.get())) BN_zero(bn_.get());
+  bn_.set_zero();
 }
 
 void ExactFloat::set_nan() {
   sign_ = 1;
   bn_exp_ = kExpNaN;
-  if (!BN_is_zero(bn_.get())) BN_zero(bn_.get());
+  bn_.set_zero();
 }
 
 double ExactFloat::ToDouble() const {
@@ -249,13 +507,13 @@ double ExactFloat::ToDouble() const {
 }
 
 double ExactFloat::ToDoubleHelper() const {
-  S2_DCHECK_LE(BN_num_bits(bn_.get()), kDoubleMantissaBits);
+  S2_DCHECK_LE(bn_.num_bits(), kDoubleMantissaBits);
   if (!is_normal()) {
     if (is_zero()) return copysign(0, sign_);
     if (is_inf()) return copysign(INFINITY, sign_);
     return copysign(NAN, sign_);
   }
-  uint64 d_mantissa = BN_ext_get_uint64(bn_.get());
+  uint64 d_mantissa = bn_.get_uint64();
   // We rely on ldexp() to handle overflow and underflow.  (It will return a
   // signed zero or infinity if the result is too small or too large.)
   return sign_ * ldexp(static_cast<double>(d_mantissa), bn_exp_);
@@ -306,11 +564,11 @@ ExactFloat ExactFloat::RoundToPowerOf2(int bit_exp, RoundingMode mode) const {
     // Never increment.
   } else if (mode == kRoundTiesAwayFromZero) {
     // Increment if the highest discarded bit is 1.
-    if (BN_is_bit_set(bn_.get(), shift - 1))
+    if (bn_.is_bit_set(shift - 1))
       increment = true;
   } else if (mode == kRoundAwayFromZero) {
     // Increment unless all discarded bits are zero.
-    if (BN_ext_count_low_zero_bits(bn_.get()) < shift)
+    if (bn_.count_low_zero_bits() < shift)
       increment = true;
   } else {
     S2_DCHECK_EQ(mode, kRoundTiesToEven);
@@ -320,16 +578,16 @@ ExactFloat ExactFloat::RoundToPowerOf2(int bit_exp, RoundingMode mode) const {
     //    0/10*       ->    Don't increment (fraction = 1/2, kept part even)
     //    1/10*       ->    Increment (fraction = 1/2, kept part odd)
     //    ./1.*1.*    ->    Increment (fraction > 1/2)
-    if (BN_is_bit_set(bn_.get(), shift - 1) &&
-        ((BN_is_bit_set(bn_.get(), shift) ||
-          BN_ext_count_low_zero_bits(bn_.get()) < shift - 1))) {
+    if (bn_.is_bit_set(shift - 1) &&
+        ((bn_.is_bit_set(shift) ||
+          bn_.count_low_zero_bits() < shift - 1))) {
       increment = true;
     }
   }
   r.bn_exp_ = bn_exp_ + shift;
-  S2_CHECK(BN_rshift(r.bn_.get(), bn_.get(), shift));
+  r.bn_.RightShift(bn_, shift);
   if (increment) {
-    S2_CHECK(BN_add_word(r.bn_.get(), 1));
+    r.bn_.Increment();
   }
   r.sign_ = sign_;
   r.Canonicalize();
@@ -432,11 +690,13 @@ int ExactFloat::GetDecimalDigits(int max_digits, string* digits) const {
   S2_DCHECK(is_normal());
   // Convert the value to the form (bn * (10 ** bn_exp10)) where "bn" is a
   // positive integer (BIGNUM).
+  BIGNUM* mantissa = BN_new();
+  bn_.ToBIGNUM(mantissa);
   BIGNUM* bn = BN_new();
   int bn_exp10;
   if (bn_exp_ >= 0) {
     // The easy case: bn = bn_ * (2 ** bn_exp_)), bn_exp10 = 0.
-    S2_CHECK(BN_lshift(bn, bn_.get(), bn_exp_));
+    S2_CHECK(BN_lshift(bn, mantissa, bn_exp_));
     bn_exp10 = 0;
   } else {
     // Set bn = bn_ * (5 ** -bn_exp_) and bn_exp10 = bn_exp_.  This is
@@ -446,11 +706,12 @@ int ExactFloat::GetDecimalDigits(int max_digits, string* digits) const {
     S2_CHECK(BN_set_word(bn, 5));
     BN_CTX* ctx = BN_CTX_new();
     S2_CHECK(BN_exp(bn, bn, power, ctx));
-    S2_CHECK(BN_mul(bn, bn, bn_.get(), ctx));
+    S2_CHECK(BN_mul(bn, bn, mantissa, ctx));
     BN_CTX_free(ctx);
     BN_free(power);
     bn_exp10 = bn_exp_;
   }
+  BN_free(mantissa);
   // Now convert "bn" to a decimal string.
   char* all_digits = BN_bn2dec(bn);
   S2_DCHECK(all_digits != nullptr);
@@ -502,7 +763,7 @@ ExactFloat& ExactFloat::operator=(const ExactFloat& b) {
   if (this != &b) {
     sign_ = b.sign_;
     bn_exp_ = b.bn_exp_;
-    BN_copy(bn_.get(), b.bn_.get());
+    bn_ = b.bn_;
   }
   return *this;
 }
@@ -550,26 +811,24 @@ ExactFloat ExactFloat::SignedSum(int a_sign, const ExactFloat* a,
   // Shift "a" if necessary so that both values have the same bn_exp_.
   ExactFloat r;
   if (a->bn_exp_ > b->bn_exp_) {
-    S2_CHECK(BN_lshift(r.bn_.get(), a->bn_.get(), a->bn_exp_ - b->bn_exp_));
+    r.bn_.LeftShift(a->bn_, a->bn_exp_ - b->bn_exp_);
     a = &r;  // The only field of "a" used below is bn_.
   }
   r.bn_exp_ = b->bn_exp_;
   if (a_sign == b_sign) {
-    S2_CHECK(BN_add(r.bn_.get(), a->bn_.get(), b->bn_.get()));
+    r.bn_.Add(a->bn_, b->bn_);
     r.sign_ = a_sign;
   } else {
-    // Note that the BIGNUM documentation is out of date -- all methods now
-    // allow the result to be the same as any input argument, so it is okay if
-    // (a == &r) due to the shift above.
-    S2_CHECK(BN_sub(r.bn_.get(), a->bn_.get(), b->bn_.get()));
-    if (BN_is_zero(r.bn_.get())) {
+    // Note that all Mantissa methods allow the result to be the same as any
+    // input argument, so it is okay if (a == &r) due to the shift above.
+    int cmp = r.bn_.Subtract(a->bn_, b->bn_);
+    if (cmp == 0) {
       r.sign_ = +1;
-    } else if (BN_is_negative(r.bn_.get())) {
+    } else if (cmp < 0) {
       // The magnitude of "b" was larger.
       r.sign_ = b_sign;
-      BN_set_negative(r.bn_.get(), false);
     } else {
-      // They were equal, or the magnitude of "a" was larger.
+      // The magnitude of "a" was larger.
       r.sign_ = a_sign;
     }
   }
@@ -583,16 +842,16 @@ void ExactFloat::Canonicalize() {
   // Underflow/overflow occurs if exp() is not in [kMinExp, kMaxExp].
   // We also convert a zero mantissa to signed zero.
   int my_exp = exp();
-  if (my_exp < kMinExp || BN_is_zero(bn_.get())) {
+  if (my_exp < kMinExp || bn_.is_zero()) {
     set_zero(sign_);
   } else if (my_exp > kMaxExp) {
     set_inf(sign_);
-  } else if (!BN_is_odd(bn_.get())) {
+  } else if (!bn_.is_odd()) {
     // Remove any low-order zero bits from the mantissa.
-    S2_DCHECK(!BN_is_zero(bn_.get()));
-    int shift = BN_ext_count_low_zero_bits(bn_.get());
+    S2_DCHECK(!bn_.is_zero());
+    int shift = bn_.count_low_zero_bits();
     if (shift > 0) {
-      S2_CHECK(BN_rshift(bn_.get(), bn_.get(), shift));
+      bn_.RightShift(bn_, shift);
       bn_exp_ += shift;
     }
   }
@@ -624,9 +883,7 @@ ExactFloat operator*(const ExactFloat& a, const ExactFloat& b) {
   ExactFloat r;
   r.sign_ = result_sign;
   r.bn_exp_ = a.bn_exp_ + b.bn_exp_;
-  BN_CTX* ctx = BN_CTX_new();
-  S2_CHECK(BN_mul(r.bn_.get(), a.bn_.get(), b.bn_.get(), ctx));
-  BN_CTX_free(ctx);
+  r.bn_.Multiply(a.bn_, b.bn_);
   r.Canonicalize();
   return r;
 }
@@ -644,14 +901,15 @@ bool operator==(const ExactFloat& a, const ExactFloat& b) {
 
   // Otherwise, the signs and mantissas must match.  Note that non-normal
   // values such as infinity have a mantissa of zero.
-  return a.sign_ == b.sign_ && BN_ucmp(a.bn_.get(), b.bn_.get()) == 0;
+  return (a.sign_ == b.sign_ &&
+          ExactFloat::Mantissa::Compare(a.bn_, b.bn_) == 0);
 }
 
 int ExactFloat::ScaleAndCompare(const ExactFloat& b) const {
   S2_DCHECK(is_normal() && b.is_normal() && bn_exp_ >= b.bn_exp_);
   ExactFloat tmp = *this;
-  S2_CHECK(BN_lshift(tmp.bn_.get(), tmp.bn_.get(), bn_exp_ - b.bn_exp_));
-  return BN_ucmp(tmp.bn_.get(), b.bn_.get());
+  tmp.bn_.LeftShift(tmp.bn_, bn_exp_ - b.bn_exp_);
+  return Mantissa::Compare(tmp.bn_, b.bn_);
 }
 
 bool ExactFloat::UnsignedLess(const ExactFloat& b) const {
@@ -747,7 +1005,7 @@ T ExactFloat::ToInteger(RoundingMode mode) const {
   if (!r.is_inf()) {
     // If the unsigned value has more than 63 bits it is always clamped.
     if (r.exp() < 64) {
-      int64 value = BN_ext_get_uint64(r.bn_.get()) << r.bn_exp_;
+      int64 value = r.bn_.get_uint64() << r.bn_exp_;
       if (r.sign_ < 0) value = -value;
       return max(kMinValue, min(kMaxValue, value));
     }
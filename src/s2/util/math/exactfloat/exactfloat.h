@@ -105,6 +105,10 @@
 // The current precision of an ExactFloat (i.e., the number of bits in its
 // mantissa) is returned by prec().  The precision is increased as necessary
 // so that the result of every operation can be represented exactly.
+//
+// Mantissas with at most kMaxInlinePrec bits are stored inline in the
+// ExactFloat object, so that calculations involving such values do not
+// allocate memory.  Larger mantissas are stored using an OpenSSL BIGNUM.
 
 #ifndef S2_UTIL_MATH_EXACTFLOAT_EXACTFLOAT_H_
 #define S2_UTIL_MATH_EXACTFLOAT_EXACTFLOAT_H_
@@ -114,6 +118,7 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include <openssl/bn.h>
@@ -139,6 +144,10 @@ class ExactFloat {
   // users of this class will never want this much precision.)
   static const int kMaxPrec = 64 << 20;  // About 20 million digits
 
+  // The maximum number of mantissa bits that are stored without allocating
+  // memory.  Larger mantissas are allocated on the heap.
+  static const int kMaxInlinePrec = 512;
+
   // Rounding modes.  kRoundTiesToEven and kRoundTiesAwayFromZero both round
   // to the nearest representable value unless two values are equally close.
   // In that case kRoundTiesToEven rounds to the nearest even value, while
@@ -532,6 +541,95 @@ class ExactFloat {
   };
 #endif
 
+  // The mantissa of an ExactFloat, i.e. an arbitrary-precision non-negative
+  // integer.  Values with at most kMaxInlinePrec bits are stored inline as
+  // an array of 64-bit words, and larger values are stored in a BIGNUM
+  // (which is allocated the first time it is needed).  The result of every
+  // operation is stored inline whenever it is small enough, and all methods
+  // that modify the mantissa allow it to be the same object as an argument.
+  class Mantissa {
+   public:
+    Mantissa() : size_(0), is_big_(false) {}
+    Mantissa(const Mantissa& b);
+    Mantissa& operator=(const Mantissa& b);
+
+    bool is_zero() const;
+    bool is_odd() const;
+
+    // Returns the number of bits in the value, or 0 if the value is zero.
+    int num_bits() const;
+
+    // Returns the number of low-order zero bits, or 0 if the value is zero.
+    int count_low_zero_bits() const;
+
+    // Returns true if bit "n" (where bit 0 is the low-order bit) is set.
+    bool is_bit_set(int n) const;
+
+    // Returns the value as a 64-bit integer.
+    // REQUIRES: num_bits() <= 64
+    uint64 get_uint64() const;
+
+    void set_zero();
+    void set_uint64(uint64 v);
+
+    // Sets this mantissa to a BIGNUM with the same value.
+    void ToBIGNUM(BIGNUM* bn) const;
+
+    // Returns -1, 0, or +1 according to whether "a" is less than, equal to,
+    // or greater than "b".
+    static int Compare(const Mantissa& a, const Mantissa& b);
+
+    // Sets this mantissa to (a << n) or (a >> n) respectively.
+    void LeftShift(const Mantissa& a, int n);
+    void RightShift(const Mantissa& a, int n);
+
+    // Adds one to this mantissa.
+    void Increment();
+
+    // Sets this mantissa to (a + b).
+    void Add(const Mantissa& a, const Mantissa& b);
+
+    // Sets this mantissa to |a - b| and returns the sign of (a - b).
+    int Subtract(const Mantissa& a, const Mantissa& b);
+
+    // Sets this mantissa to (a * b).
+    void Multiply(const Mantissa& a, const Mantissa& b);
+
+   private:
+    static const int kMaxWords = kMaxInlinePrec / 64;
+
+    // Returns a BIGNUM with the value of "a", which is either the BIGNUM
+    // stored by "a" or "tmp" (after setting it to the value of "a").
+    static const BIGNUM* GetBIGNUM(const Mantissa& a, BigNum* tmp);
+
+    // Returns the BIGNUM where the result of an operation should be stored
+    // when it is too large to be stored inline.  The caller must call
+    // SetBig() after storing the result.
+    BIGNUM* big();
+
+    // Switches to the BIGNUM representation after a value has been stored in
+    // big(), or back to the inline representation if the value is small
+    // enough.
+    void SetBig();
+
+    // Removes high-order zero words from an inline value.
+    void Trim();
+
+    // The number of words used by an inline value.  If non-zero, the
+    // highest word used is non-zero.
+    int size_;
+
+    // True if the value is stored in big_ rather than words_.
+    bool is_big_;
+
+    // The words of an inline value, starting with the low-order word.
+    uint64 words_[kMaxWords];
+
+    // Storage for large values.  This is kept (even when the value is stored
+    // inline) so that it can be reused.
+    std::unique_ptr<BigNum> big_;
+  };
+
   // Non-normal numbers are represented using special exponent values and a
   // mantissa of zero.  Do not change these values; methods such as
   // is_normal() make assumptions about their ordering.  Non-normal numbers
@@ -542,11 +640,11 @@ class ExactFloat {
 
   // Normal numbers are represented as (sign_ * bn_ * (2 ** bn_exp_)), where:
   //  - sign_ is either +1 or -1
-  //  - bn_ is a BIGNUM with a positive value
+  //  - bn_ is a Mantissa with a positive value
   //  - bn_exp_ is the base-2 exponent applied to bn_.
   int32 sign_;
   int32 bn_exp_;
-  BigNum bn_;
+  Mantissa bn_;
 
   // A standard IEEE "double" has a 53-bit mantissa consisting of a 52-bit
   // fraction plus an implicit leading "1" bit.
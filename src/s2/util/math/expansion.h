@@ -0,0 +1,306 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Expansion is a fixed-capacity exact floating-point type based on the
+// adaptive-precision arithmetic of Jonathan Shewchuk ("Adaptive Precision
+// Floating-Point Arithmetic and Fast Robust Geometric Predicates", 1997).
+// A value is represented exactly as the unevaluated sum of a sequence of
+// doubles ("components") that are sorted by increasing magnitude and do not
+// overlap, so that the sign of the value is the sign of its largest
+// component.  Sums, differences and products are computed exactly using
+// error-free transformations, and the components are stored inline so that
+// no memory is allocated.
+//
+// Expansion supports the subset of the ExactFloat interface needed by the
+// exact predicates in s2predicates.cc (+, -, *, and sgn()), so that it can
+// be used as a template argument to Vector3 and to the predicate templates.
+//
+// Unlike ExactFloat, an Expansion cannot represent every result:
+//
+//  - Each value can have at most kMaxSize components.
+//
+//  - The results are exact only if no intermediate product underflows or
+//    overflows.  (For example, products of many numbers that are much
+//    smaller than 1 eventually underflow.)
+//
+// When the first condition is violated the result is marked as not ok(),
+// and this state propagates to all values computed from it.  The second
+// condition must be ensured by the caller, e.g. by scaling the inputs by a
+// power of two (see s2pred::ExpansionSign for an example).
+
+#ifndef S2_UTIL_MATH_EXPANSION_H_
+#define S2_UTIL_MATH_EXPANSION_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "s2/_fp_contract_off.h"
+
+class Expansion {
+ public:
+  // The maximum number of components.
+  static constexpr int kMaxSize = 64;
+
+  // Constructs the value zero.
+  Expansion() : size_(0), ok_(true) {}
+
+  // Constructs an Expansion equal to the given double.  (This conversion is
+  // implicit so that doubles may be mixed with Expansions in expressions,
+  // just like ExactFloat.)
+  Expansion(double x) : size_(x != 0), ok_(std::isfinite(x)) {  // NOLINT
+    c_[0] = x;
+  }
+
+  Expansion(const Expansion& x) : size_(x.size_), ok_(x.ok_) {
+    std::copy(x.c_, x.c_ + x.size_, c_);
+  }
+  Expansion& operator=(const Expansion& x) {
+    size_ = x.size_;
+    ok_ = x.ok_;
+    std::copy(x.c_, x.c_ + x.size_, c_);
+    return *this;
+  }
+
+  // Returns true if this value was computed exactly, i.e. no intermediate
+  // result exceeded the maximum number of components.  Values that are not
+  // ok() have an unspecified sign.
+  bool ok() const { return ok_; }
+
+  // Returns +1 if the value is positive, -1 if it is negative, and 0 if it is
+  // zero.
+  int sgn() const { return size_ == 0 ? 0 : (c_[size_ - 1] > 0 ? 1 : -1); }
+
+  // Returns the number of components.
+  int size() const { return size_; }
+
+  // Returns an approximation of the value (the sum of its components).
+  double ToDouble() const {
+    double sum = 0;
+    for (int i = 0; i < size_; ++i) sum += c_[i];
+    return sum;
+  }
+
+  friend Expansion operator-(const Expansion& a) {
+    Expansion result;
+    result.size_ = a.size_;
+    result.ok_ = a.ok_;
+    for (int i = 0; i < a.size_; ++i) result.c_[i] = -a.c_[i];
+    return result;
+  }
+  friend Expansion operator+(const Expansion& a, const Expansion& b) {
+    double h[2 * kMaxSize];
+    int n = Sum(a.c_, a.size_, b.c_, b.size_, h);
+    return Expansion(h, n, a.ok_ && b.ok_);
+  }
+  friend Expansion operator-(const Expansion& a, const Expansion& b) {
+    return a + (-b);
+  }
+  friend Expansion operator*(const Expansion& a, const Expansion& b);
+
+  Expansion& operator+=(const Expansion& b) { return *this = *this + b; }
+  Expansion& operator-=(const Expansion& b) { return *this = *this - b; }
+  Expansion& operator*=(const Expansion& b) { return *this = *this * b; }
+
+ private:
+  // Constructs an Expansion from "n" components, compressing them as
+  // necessary to fit.
+  Expansion(double* c, int n, bool ok);
+
+  // Error-free transformations: x + y == a + b and x + y == a * b exactly,
+  // where x is the rounded result.  FastTwoSum requires |a| >= |b|.
+  static void TwoSum(double a, double b, double* x, double* y);
+  static void FastTwoSum(double a, double b, double* x, double* y);
+  static void Split(double a, double* hi, double* lo);
+  static void TwoProduct(double a, double b, double bhi, double blo,
+                         double* x, double* y);
+
+  // Sets "h" to e + f and returns its size, which is at most elen + flen.
+  static int Sum(const double* e, int elen, const double* f, int flen,
+                 double* h);
+
+  // Sets "h" to e * b and returns its size, which is at most 2 * elen.
+  static int Scale(const double* e, int elen, double b, double* h);
+
+  // Compresses the expansion "e" in place and returns its new size.
+  static int Compress(double* e, int elen);
+
+  int size_;
+  bool ok_;
+  double c_[kMaxSize];
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline Expansion::Expansion(double* c, int n, bool ok) : ok_(ok) {
+  if (n > kMaxSize) n = Compress(c, n);
+  if (n > kMaxSize || (n > 0 && !std::isfinite(c[n - 1]))) {
+    size_ = 0;
+    ok_ = false;
+    return;
+  }
+  size_ = n;
+  std::copy(c, c + n, c_);
+}
+
+inline void Expansion::TwoSum(double a, double b, double* x, double* y) {
+  *x = a + b;
+  double b_virtual = *x - a;
+  double a_virtual = *x - b_virtual;
+  *y = (a - a_virtual) + (b - b_virtual);
+}
+
+inline void Expansion::FastTwoSum(double a, double b, double* x, double* y) {
+  *x = a + b;
+  *y = b - (*x - a);
+}
+
+inline void Expansion::Split(double a, double* hi, double* lo) {
+  // Splits a 53-bit mantissa into two 26-bit halves.
+  const double kSplitter = 134217729.0;  // 2^27 + 1
+  double c = kSplitter * a;
+  *hi = c - (c - a);
+  *lo = a - *hi;
+}
+
+inline void Expansion::TwoProduct(double a, double b, double bhi, double blo,
+                                  double* x, double* y) {
+  *x = a * b;
+  double ahi, alo;
+  Split(a, &ahi, &alo);
+  double err1 = *x - ahi * bhi;
+  double err2 = err1 - alo * bhi;
+  double err3 = err2 - ahi * blo;
+  *y = alo * blo - err3;
+}
+
+inline int Expansion::Sum(const double* e, int elen, const double* f,
+                          int flen, double* h) {
+  // This is Shewchuk's FAST-EXPANSION-SUM with zero elimination, which
+  // merges the components of "e" and "f" in order of increasing magnitude.
+  if (elen == 0 || flen == 0) {
+    if (elen == 0) std::copy(f, f + flen, h);
+    else           std::copy(e, e + elen, h);
+    return elen + flen;
+  }
+  int ei = 0, fi = 0, hi = 0;
+  double q, q_new, hh;
+  if ((f[0] > e[0]) == (f[0] > -e[0])) {
+    q = e[ei++];
+  } else {
+    q = f[fi++];
+  }
+  if (ei < elen && fi < flen) {
+    if ((f[fi] > e[ei]) == (f[fi] > -e[ei])) {
+      FastTwoSum(e[ei++], q, &q_new, &hh);
+    } else {
+      FastTwoSum(f[fi++], q, &q_new, &hh);
+    }
+    q = q_new;
+    if (hh != 0) h[hi++] = hh;
+    while (ei < elen && fi < flen) {
+      if ((f[fi] > e[ei]) == (f[fi] > -e[ei])) {
+        TwoSum(q, e[ei++], &q_new, &hh);
+      } else {
+        TwoSum(q, f[fi++], &q_new, &hh);
+      }
+      q = q_new;
+      if (hh != 0) h[hi++] = hh;
+    }
+  }
+  while (ei < elen) {
+    TwoSum(q, e[ei++], &q_new, &hh);
+    q = q_new;
+    if (hh != 0) h[hi++] = hh;
+  }
+  while (fi < flen) {
+    TwoSum(q, f[fi++], &q_new, &hh);
+    q = q_new;
+    if (hh != 0) h[hi++] = hh;
+  }
+  if (q != 0) h[hi++] = q;
+  return hi;
+}
+
+inline int Expansion::Scale(const double* e, int elen, double b, double* h) {
+  // This is Shewchuk's SCALE-EXPANSION with zero elimination.
+  if (elen == 0 || b == 0) return 0;
+  double bhi, blo;
+  Split(b, &bhi, &blo);
+  double q, hh;
+  int hi = 0;
+  TwoProduct(e[0], b, bhi, blo, &q, &hh);
+  if (hh != 0) h[hi++] = hh;
+  for (int i = 1; i < elen; ++i) {
+    double product1, product0, sum;
+    TwoProduct(e[i], b, bhi, blo, &product1, &product0);
+    TwoSum(q, product0, &sum, &hh);
+    if (hh != 0) h[hi++] = hh;
+    FastTwoSum(product1, sum, &q, &hh);
+    if (hh != 0) h[hi++] = hh;
+  }
+  if (q != 0) h[hi++] = q;
+  return hi;
+}
+
+inline int Expansion::Compress(double* e, int elen) {
+  // This is Shewchuk's COMPRESS, which produces an equivalent expansion
+  // whose largest component approximates the value to within one ulp.
+  if (elen == 0) return 0;
+  int bottom = elen - 1;
+  double q = e[bottom];
+  for (int i = elen - 2; i >= 0; --i) {
+    double q_new, small;
+    FastTwoSum(q, e[i], &q_new, &small);
+    if (small != 0) {
+      e[bottom--] = q_new;
+      q = small;
+    } else {
+      q = q_new;
+    }
+  }
+  int top = 0;
+  for (int i = bottom + 1; i < elen; ++i) {
+    double q_new, small;
+    FastTwoSum(e[i], q, &q_new, &small);
+    if (small != 0) e[top++] = small;
+    q = q_new;
+  }
+  if (q != 0) e[top++] = q;
+  return top;
+}
+
+inline Expansion operator*(const Expansion& a, const Expansion& b) {
+  // The product is accumulated by scaling "a" by each component of "b" and
+  // compressing the partial sums, which keeps the intermediate results
+  // small.
+  const Expansion& e = (a.size_ >= b.size_) ? a : b;
+  const Expansion& f = (a.size_ >= b.size_) ? b : a;
+  bool ok = a.ok_ && b.ok_;
+  double acc[3 * Expansion::kMaxSize], term[2 * Expansion::kMaxSize];
+  double sum[3 * Expansion::kMaxSize];
+  int acc_size = 0;
+  for (int i = 0; i < f.size_ && ok; ++i) {
+    int term_size = Expansion::Scale(e.c_, e.size_, f.c_[i], term);
+    int sum_size = Expansion::Sum(acc, acc_size, term, term_size, sum);
+    acc_size = Expansion::Compress(sum, sum_size);
+    if (acc_size > Expansion::kMaxSize) ok = false;
+    std::copy(sum, sum + acc_size, acc);
+  }
+  return Expansion(acc, ok ? acc_size : 0, ok);
+}
+
+#endif  // S2_UTIL_MATH_EXPANSION_H_
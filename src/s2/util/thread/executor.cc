@@ -0,0 +1,80 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/util/thread/executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "s2/base/mutex.h"
+
+namespace {
+
+// The state shared between the calling thread and the executor tasks.  It is
+// reference counted because executor tasks may start running after the
+// calling thread has already finished all the work and returned.
+struct ParallelForState {
+  ParallelForState(int _n, const std::function<void(int)>* _fn)
+      : n(_n), fn(_fn), next(0), num_done(0) {
+  }
+
+  // Claims and runs items until none are left.  "fn" is only dereferenced
+  // after successfully claiming an item, which guarantees that the calling
+  // thread is still waiting in ParallelFor().
+  void Run() {
+    int num_run = 0;
+    for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n; ) {
+      (*fn)(i);
+      ++num_run;
+    }
+    if (num_run == 0) return;
+    mutex.Lock();
+    num_done += num_run;
+    if (num_done == n) all_done.Signal();
+    mutex.Unlock();
+  }
+
+  const int n;
+  const std::function<void(int)>* const fn;
+  std::atomic<int> next;
+
+  // The following fields are guarded by "mutex".
+  absl::Mutex mutex;
+  absl::CondVar all_done;
+  int num_done;
+};
+
+}  // namespace
+
+void ParallelFor(Executor* executor, int n,
+                 const std::function<void(int)>& fn) {
+  if (n <= 0) return;
+  if (executor == nullptr || n == 1) {
+    for (int i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  auto state = std::make_shared<ParallelForState>(n, &fn);
+  int num_helpers = std::min(n, std::max(1, executor->num_threads())) - 1;
+  for (int i = 0; i < num_helpers; ++i) {
+    executor->Schedule([state]() { state->Run(); });
+  }
+  state->Run();
+  state->mutex.Lock();
+  while (state->num_done < n) {
+    state->all_done.Wait(&state->mutex);
+  }
+  state->mutex.Unlock();
+}
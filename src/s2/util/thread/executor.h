@@ -0,0 +1,51 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+//
+// A minimal interface that allows clients to supply their own threads to
+// S2 algorithms that can split their work into independent tasks.  The
+// algorithms never create threads themselves; instead the client implements
+// Executor on top of whatever thread pool or scheduler it already uses, or
+// uses WorkStealingExecutor (see work_stealing_executor.h).
+
+#ifndef S2_UTIL_THREAD_EXECUTOR_H_
+#define S2_UTIL_THREAD_EXECUTOR_H_
+
+#include <functional>
+
+class Executor {
+ public:
+  virtual ~Executor() {}
+
+  // Arranges for "fn" to be called exactly once, possibly in another thread.
+  // This method may return before "fn" has started running.
+  virtual void Schedule(std::function<void()> fn) = 0;
+
+  // Returns the maximum number of closures that are likely to be running at
+  // once.  This is only used as a hint for dividing up the work.
+  virtual int num_threads() const = 0;
+};
+
+// Calls fn(i) for every value of "i" in the range [0, n) and returns after
+// all calls have completed.  Calls may occur concurrently and in any order.
+// If "executor" is nullptr, the calls are made sequentially in the current
+// thread.
+//
+// The calling thread also participates in the work, so this function makes
+// progress (and does not deadlock) even if every thread of "executor" is
+// busy, e.g. because ParallelFor() was itself called from an executor task.
+void ParallelFor(Executor* executor, int n, const std::function<void(int)>& fn);
+
+#endif  // S2_UTIL_THREAD_EXECUTOR_H_
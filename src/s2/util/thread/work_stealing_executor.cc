@@ -0,0 +1,116 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/util/thread/work_stealing_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "s2/third_party/absl/memory/memory.h"
+
+namespace {
+
+// Identifies the executor and queue of the current worker thread, so that
+// closures scheduled from within a closure go to the local queue.
+thread_local const WorkStealingExecutor* current_executor = nullptr;
+thread_local int current_queue = -1;
+
+}  // namespace
+
+WorkStealingExecutor::WorkStealingExecutor(int num_threads)
+    : next_queue_(0), num_pending_(0), shutdown_(false) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(absl::make_unique<Queue>());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  mutex_.Lock();
+  shutdown_ = true;
+  wakeup_.SignalAll();
+  mutex_.Unlock();
+  for (auto& thread : threads_) thread.join();
+}
+
+int WorkStealingExecutor::num_threads() const {
+  return threads_.size();
+}
+
+void WorkStealingExecutor::Schedule(std::function<void()> fn) {
+  int i = (current_executor == this) ? current_queue :
+          next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  // The closure is counted before it is pushed so that "num_pending_" never
+  // becomes negative and the workers cannot exit while it is in flight.
+  mutex_.Lock();
+  ++num_pending_;
+  mutex_.Unlock();
+
+  Queue* queue = queues_[i].get();
+  queue->mutex.Lock();
+  queue->tasks.push_back(std::move(fn));
+  queue->mutex.Unlock();
+  wakeup_.Signal();
+}
+
+bool WorkStealingExecutor::TakeTask(int i, std::function<void()>* fn) {
+  const int n = queues_.size();
+  for (int k = 0; k < n; ++k) {
+    Queue* queue = queues_[(i + k) % n].get();
+    queue->mutex.Lock();
+    if (!queue->tasks.empty()) {
+      // Run local work newest-first and stolen work oldest-first.
+      if (k == 0) {
+        *fn = std::move(queue->tasks.back());
+        queue->tasks.pop_back();
+      } else {
+        *fn = std::move(queue->tasks.front());
+        queue->tasks.pop_front();
+      }
+      queue->mutex.Unlock();
+      mutex_.Lock();
+      --num_pending_;
+      mutex_.Unlock();
+      return true;
+    }
+    queue->mutex.Unlock();
+  }
+  return false;
+}
+
+void WorkStealingExecutor::WorkerLoop(int i) {
+  current_executor = this;
+  current_queue = i;
+  std::function<void()> fn;
+  for (;;) {
+    if (TakeTask(i, &fn)) {
+      fn();
+      fn = nullptr;
+      continue;
+    }
+    // A closure may have been counted but not yet pushed, in which case we
+    // simply try again.  Otherwise sleep until there is more work.
+    mutex_.Lock();
+    while (num_pending_ == 0 && !shutdown_) wakeup_.Wait(&mutex_);
+    bool done = shutdown_ && num_pending_ == 0;
+    mutex_.Unlock();
+    if (done) return;
+  }
+}
@@ -0,0 +1,86 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+//
+// A default Executor for clients that do not already have a thread pool.
+// Each worker thread owns a double-ended queue of closures.  Closures that
+// are scheduled from a worker thread (e.g. by a nested ParallelFor) are
+// pushed onto that worker's own queue and run in LIFO order, which keeps
+// related work on the same thread.  Closures scheduled from other threads
+// are distributed round-robin.  A worker whose queue is empty steals the
+// oldest closure from another worker's queue.
+//
+// Example usage:
+//
+//   WorkStealingExecutor executor(4);
+//   MutableS2ShapeIndex::Options options;
+//   options.set_executor(&executor);
+//
+// The executor must outlive every algorithm that uses it.  The destructor
+// waits until all scheduled closures (including closures scheduled while it
+// is waiting) have finished running.
+
+#ifndef S2_UTIL_THREAD_WORK_STEALING_EXECUTOR_H_
+#define S2_UTIL_THREAD_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "s2/base/mutex.h"
+#include "s2/util/thread/executor.h"
+
+class WorkStealingExecutor final : public Executor {
+ public:
+  // Starts "num_threads" worker threads.  If "num_threads" is not positive,
+  // one thread per hardware thread is started.
+  explicit WorkStealingExecutor(int num_threads);
+  ~WorkStealingExecutor() override;
+
+  void Schedule(std::function<void()> fn) override;
+  int num_threads() const override;
+
+ private:
+  struct Queue {
+    absl::Mutex mutex;
+    std::deque<std::function<void()>> tasks;  // Guarded by "mutex".
+  };
+
+  // Removes a closure from the back of queue "i", or from the front of any
+  // other queue.  Returns false if all queues were empty.
+  bool TakeTask(int i, std::function<void()>* fn);
+
+  // The main loop of worker thread "i".
+  void WorkerLoop(int i);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<unsigned> next_queue_;
+
+  // The number of closures that have been scheduled but not yet taken from
+  // a queue.  Idle workers sleep on "wakeup_" while this is zero.
+  absl::Mutex mutex_;
+  absl::CondVar wakeup_;
+  int num_pending_;  // Guarded by "mutex_".
+  bool shutdown_;    // Guarded by "mutex_".
+
+  WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+  void operator=(const WorkStealingExecutor&) = delete;
+};
+
+#endif  // S2_UTIL_THREAD_WORK_STEALING_EXECUTOR_H_
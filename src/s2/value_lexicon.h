@@ -72,6 +72,14 @@ class ValueLexicon {
   // Return the value with the given id.
   const T& value(uint32 id) const;
 
+  // Adds all values of "other" to this lexicon, and returns a vector that
+  // maps each id of "other" to the id of the same value in this lexicon.
+  // This allows lexicons built independently (e.g., by different threads)
+  // to be combined in time proportional to the size of "other".
+  //
+  // REQUIRES: &other != this
+  std::vector<uint32> Merge(const ValueLexicon& other);
+
  private:
   friend class IdKeyEqual;
   // Choose kEmptyKey to be the last key that will ever be generated.
@@ -221,6 +229,15 @@ uint32 ValueLexicon<T, Hasher, KeyEqual>::Add(const T& value) {
   }
 }
 
+template <class T, class Hasher, class KeyEqual>
+std::vector<uint32> ValueLexicon<T, Hasher, KeyEqual>::Merge(
+    const ValueLexicon& other) {
+  std::vector<uint32> ids;
+  ids.reserve(other.size());
+  for (const T& value : other.values_) ids.push_back(Add(value));
+  return ids;
+}
+
 template <class T, class Hasher, class KeyEqual>
 inline uint32 ValueLexicon<T, Hasher, KeyEqual>::size() const {
   return values_.size();
@@ -119,3 +119,15 @@ TEST(ValueLexicon, MoveAssignmentOperator) {
   EXPECT_EQ(20, lex.value(1));
 }
 
+
+TEST(ValueLexicon, Merge) {
+  ValueLexicon<int64> lex, other;
+  EXPECT_EQ(0, lex.Add(5));
+  EXPECT_EQ(1, lex.Add(10));
+  EXPECT_EQ(0, other.Add(10));
+  EXPECT_EQ(1, other.Add(20));
+  EXPECT_EQ(2, other.Add(5));
+  EXPECT_EQ((std::vector<uint32>{1, 2, 0}), lex.Merge(other));
+  EXPECT_EQ(3, lex.size());
+  EXPECT_EQ(20, lex.value(2));
+}